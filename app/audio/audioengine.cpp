@@ -0,0 +1,549 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "audioengine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <QAudioDeviceInfo>
+#include <QAudioOutput>
+#include <QFileInfo>
+
+#include "audiomixer.h"
+#include "config/config.h"
+#include "node/block/clip/clip.h"
+#include "node/input/media/media.h"
+#include "node/output/timeline/timeline.h"
+#include "project/item/footage/audiostream.h"
+#include "project/item/footage/footage.h"
+#include "task/conform/conform.h"
+#include "task/taskmanager.h"
+
+AudioEngine::AudioEngine(QObject *parent) :
+  QObject(parent),
+  timeline_(nullptr),
+  sample_rate_(0),
+  speed_(1),
+  mix_position_(0),
+  played_frames_(0),
+  latency_frames_(0),
+  running_(false),
+  quit_(false),
+  mix_thread_(this),
+  device_thread_(this),
+  device_(this)
+{
+  mix_thread_.setObjectName(QStringLiteral("AudioMixer"));
+  device_thread_.setObjectName(QStringLiteral("AudioDevice"));
+}
+
+AudioEngine::~AudioEngine()
+{
+  Stop();
+}
+
+void AudioEngine::Start(TimelineOutput *timeline, const rational &time, int sample_rate, int speed)
+{
+  Stop();
+
+  if (timeline == nullptr || sample_rate <= 0 || !IsAudibleSpeed(speed)) {
+    return;
+  }
+
+  timeline_ = timeline;
+  sample_rate_ = sample_rate;
+  speed_ = speed;
+  mix_position_ = qRound64(time.toDouble() * sample_rate_);
+
+  // At speeds other than 1, each block played needs `speed` blocks of the timeline
+  bus_.resize(kAudioMixBlockSize * speed_ * 2);
+
+  if (speed_ != 1) {
+    stretcher_.Reset(sample_rate_, speed_);
+    stretch_buffer_.resize(kAudioMixBlockSize * 2);
+  }
+  fifo_.Allocate(sample_rate_ * kAudioMixAhead / 1000, 2);
+
+  format_.setSampleRate(sample_rate_);
+  format_.setChannelCount(2);
+  format_.setCodec(QStringLiteral("audio/pcm"));
+  format_.setByteOrder(QAudioFormat::LittleEndian);
+  format_.setSampleType(QAudioFormat::Float);
+  format_.setSampleSize(32);
+
+  if (!QAudioDeviceInfo::defaultOutputDevice().isFormatSupported(format_)) {
+    // Every device takes 16-bit, the device thread converts to it
+    format_.setSampleType(QAudioFormat::SignedInt);
+    format_.setSampleSize(16);
+  }
+
+  device_buffer_.resize(kAudioMixBlockSize * 2);
+
+  played_frames_ = 0;
+  latency_frames_ = 0;
+  quit_ = false;
+  running_ = true;
+
+  // Unbuffered so reads go straight to readData() without QIODevice allocating anything on the device thread
+  device_.open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+
+  mix_thread_.start(QThread::HighPriority);
+  device_thread_.start(QThread::TimeCriticalPriority);
+}
+
+void AudioEngine::Stop()
+{
+  if (!running_) {
+    return;
+  }
+
+  device_thread_.quit();
+  device_thread_.wait();
+
+  mix_lock_.lock();
+  quit_ = true;
+  mix_cond_.wakeAll();
+  mix_lock_.unlock();
+
+  mix_thread_.wait();
+
+  device_.close();
+  fifo_.Clear();
+
+  timeline_ = nullptr;
+  running_ = false;
+}
+
+bool AudioEngine::IsAudibleSpeed(int speed)
+{
+  return speed >= 1 && speed <= kMaxStretchSpeed;
+}
+
+bool AudioEngine::IsRunning() const
+{
+  return running_;
+}
+
+qint64 AudioEngine::ElapsedUSecs() const
+{
+  qint64 heard = played_frames_.load() - latency_frames_.load();
+
+  if (heard <= 0) {
+    return -1;
+  }
+
+  return heard * 1000000 / sample_rate_;
+}
+
+void AudioEngine::MixLoop()
+{
+  // How long a block lasts, the FIFO will have room for another one at least this often
+  unsigned long block_msecs = static_cast<unsigned long>(qMax(1, kAudioMixBlockSize * 1000 / sample_rate_));
+
+  while (!quit_) {
+    if (fifo_.Space() < kAudioMixBlockSize) {
+      mix_lock_.lock();
+
+      if (!quit_) {
+        mix_cond_.wait(&mix_lock_, block_msecs);
+      }
+
+      mix_lock_.unlock();
+      continue;
+    }
+
+    if (speed_ == 1) {
+      MixBlock(kAudioMixBlockSize);
+
+      fifo_.Write(bus_.constData(), kAudioMixBlockSize);
+    } else {
+      while (stretcher_.Available() < kAudioMixBlockSize) {
+        int frames = kAudioMixBlockSize * speed_;
+
+        MixBlock(frames);
+
+        stretcher_.Push(bus_.constData(), frames);
+      }
+
+      stretcher_.Pull(stretch_buffer_.data(), kAudioMixBlockSize);
+
+      fifo_.Write(stretch_buffer_.constData(), kAudioMixBlockSize);
+    }
+  }
+
+  foreach (const ClipSource& source, sources_) {
+    if (source.decoder != nullptr) {
+      source.decoder->Close();
+    }
+  }
+
+  sources_.clear();
+}
+
+void AudioEngine::MixBlock(int frames)
+{
+  std::fill(bus_.begin(), bus_.begin() + frames * 2, 0.0f);
+
+  QList<MixSegment> segments = GetSegments(mix_position_, frames);
+
+  foreach (const MixSegment& segment, segments) {
+    MixSegmentIntoBus(segment, mix_position_);
+  }
+
+  mix_position_ += frames;
+
+  // Close the decoders of clips that haven't been heard for a second (e.g. ones we've played past)
+  QHash<ClipBlock*, ClipSource>::iterator it = sources_.begin();
+
+  while (it != sources_.end()) {
+    if (mix_position_ - it.value().last_used > sample_rate_) {
+      if (it.value().decoder != nullptr) {
+        it.value().decoder->Close();
+      }
+
+      it = sources_.erase(it);
+    } else {
+      it++;
+    }
+  }
+}
+
+QList<AudioEngine::MixSegment> AudioEngine::GetSegments(qint64 position, int frames)
+{
+  QList<MixSegment> segments;
+
+  // Lock the whole graph the same way the renderer does, dependencies in a global order so we can't deadlock with it
+  QList<Node*> nodes = timeline_->GetDependencies();
+  nodes.append(timeline_);
+
+  std::sort(nodes.begin(), nodes.end());
+  nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+  foreach (Node* n, nodes) {
+    n->Lock();
+  }
+
+  qint64 end = position + frames;
+
+  foreach (TrackOutput* track, timeline_->tracks()) {
+    qint64 pos = position;
+
+    while (pos < end) {
+      rational time(pos, sample_rate_);
+
+      Block* block = track->BlockAtTime(time);
+
+      if (block == nullptr) {
+        break;
+      }
+
+      qint64 segment_end = qMin(end, static_cast<qint64>(std::ceil(block->out().toDouble() * sample_rate_)));
+
+      if (segment_end <= pos) {
+        break;
+      }
+
+      if (block->type() == Block::kClip) {
+        ClipBlock* clip = static_cast<ClipBlock*>(block);
+
+        StreamPtr stream = GetAudioStream(clip);
+
+        float volume = clip->volume_input()->get_value(time).toFloat() * 0.01f;
+
+        if (stream != nullptr && volume > 0.0f) {
+          MixSegment segment;
+
+          segment.clip = clip;
+          segment.stream = stream;
+          segment.decoder_id = stream->footage()->decoder();
+          segment.media_time = time - clip->in() + clip->media_in();
+          segment.offset = static_cast<int>(pos - position);
+          segment.frames = static_cast<int>(segment_end - pos);
+
+          AudioMixer::PanGains(volume,
+                               clip->pan_input()->get_value(time).toFloat() * 0.01f,
+                               &segment.left_gain,
+                               &segment.right_gain);
+
+          segments.append(segment);
+        }
+      }
+
+      pos = segment_end;
+    }
+  }
+
+  foreach (Node* n, nodes) {
+    n->Unlock();
+  }
+
+  return segments;
+}
+
+void AudioEngine::MixSegmentIntoBus(const AudioEngine::MixSegment &segment, qint64 position)
+{
+  int src_rate = static_cast<AudioStream*>(segment.stream.get())->sample_rate();
+
+  if (src_rate <= 0) {
+    return;
+  }
+
+  ClipSource& source = sources_[segment.clip];
+
+  if (source.stream != segment.stream) {
+    // New source or the clip's footage has changed
+    if (source.decoder != nullptr) {
+      source.decoder->Close();
+    }
+
+    source = ClipSource();
+    source.stream = segment.stream;
+    source.conform_checked = position - sample_rate_;
+  }
+
+  source.last_used = position;
+
+  if (source.conformed == nullptr && position - source.conform_checked >= sample_rate_) {
+    source.conform_checked = position;
+    source.conformed = ConformedAudio::Load(ConformedAudio::GetFilename(segment.stream.get(), sample_rate_));
+
+    // Once conformed, the decoder isn't needed anymore
+    if (source.conformed != nullptr && source.decoder != nullptr) {
+      source.decoder->Close();
+      source.decoder = nullptr;
+    }
+  }
+
+  if (source.conformed != nullptr) {
+    MixConformedIntoBus(segment, source.conformed.get());
+    return;
+  }
+
+  if (source.decoder == nullptr) {
+    source.decoder = Decoder::CreateFromID(segment.decoder_id);
+
+    if (source.decoder != nullptr) {
+      source.decoder->set_stream(segment.stream);
+
+      if (!source.decoder->Open()) {
+        source.decoder = nullptr;
+      }
+    }
+
+    if (source.decoder == nullptr) {
+      sources_.remove(segment.clip);
+      return;
+    }
+  }
+
+  // Work out which source samples cover this segment, with one to spare for interpolating the last one
+  double src_start = segment.media_time.toDouble() * src_rate;
+  qint64 first = static_cast<qint64>(std::floor(src_start));
+  double offset = src_start - static_cast<double>(first);
+  double step = static_cast<double>(src_rate) / sample_rate_;
+  int src_frames = static_cast<int>(std::ceil(offset + (segment.frames - 1) * step)) + 2;
+
+  FramePtr frame = source.decoder->Retrieve(rational(first, src_rate), rational(src_frames, src_rate));
+
+  if (frame == nullptr || frame->sample_count() <= 0) {
+    return;
+  }
+
+  int count = frame->sample_count();
+
+  convert_buffer_.resize(count * 2);
+
+  AudioMixer::ToStereo(frame->const_data(),
+                       static_cast<olive::SampleFormat>(frame->format()),
+                       frame->channel_count(),
+                       count,
+                       convert_buffer_.data());
+
+  const float* src = convert_buffer_.constData();
+  int frames = qMin(segment.frames, count);
+
+  if (src_rate != sample_rate_ || offset > 0.0) {
+    resample_buffer_.resize(segment.frames * 2);
+
+    AudioMixer::Resample(src, count, offset, step, resample_buffer_.data(), segment.frames);
+
+    src = resample_buffer_.constData();
+    frames = segment.frames;
+  }
+
+  AudioMixer::MixStereo(bus_.data() + segment.offset * 2, src, frames, segment.left_gain, segment.right_gain);
+}
+
+void AudioEngine::MixConformedIntoBus(const AudioEngine::MixSegment &segment, ConformedAudio *conformed)
+{
+  // Conformed audio is already at the bus's rate, so sample positions map one to one
+  qint64 start = qRound64(segment.media_time.toDouble() * sample_rate_);
+
+  // Anything outside the media is silence
+  qint64 first = qMax(start, static_cast<qint64>(0));
+  qint64 last = qMin(start + segment.frames, static_cast<qint64>(conformed->sample_count()));
+
+  if (last <= first) {
+    return;
+  }
+
+  AudioMixer::MixStereo(bus_.data() + (segment.offset + (first - start)) * 2,
+                        conformed->data() + first * 2,
+                        static_cast<int>(last - first),
+                        segment.left_gain,
+                        segment.right_gain);
+}
+
+StreamPtr AudioEngine::GetAudioStream(ClipBlock *clip)
+{
+  MediaInput* media = nullptr;
+
+  foreach (Node* dep, clip->GetDependencies()) {
+    media = dynamic_cast<MediaInput*>(dep);
+
+    if (media != nullptr) {
+      break;
+    }
+  }
+
+  Footage* footage = (media != nullptr) ? media->footage() : nullptr;
+
+  if (footage != nullptr) {
+    for (int i=0;i<footage->stream_count();i++) {
+      if (footage->stream(i)->type() == Stream::kAudio) {
+        return footage->stream(i);
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+void AudioEngine::ConformStreams(TimelineOutput *timeline, int sample_rate)
+{
+  if (timeline == nullptr || sample_rate <= 0) {
+    return;
+  }
+
+  QList<StreamPtr> queued;
+
+  foreach (Node* dep, timeline->GetDependencies()) {
+    ClipBlock* clip = dynamic_cast<ClipBlock*>(dep);
+
+    if (clip == nullptr) {
+      continue;
+    }
+
+    StreamPtr stream = GetAudioStream(clip);
+
+    if (stream == nullptr || queued.contains(stream)) {
+      continue;
+    }
+
+    QString filename = ConformedAudio::GetFilename(stream.get(), sample_rate);
+
+    if (!ConformTask::IsQueued(filename) && !QFileInfo::exists(filename)) {
+      olive::task_manager.AddTask(std::make_shared<ConformTask>(stream, sample_rate));
+    }
+
+    queued.append(stream);
+  }
+}
+
+qint64 AudioEngine::Pull(char *data, qint64 maxlen)
+{
+  int bytes_per_frame = format_.bytesPerFrame();
+  int frames = static_cast<int>(maxlen / bytes_per_frame);
+  int read = 0;
+
+  if (format_.sampleType() == QAudioFormat::Float) {
+    read = fifo_.Read(reinterpret_cast<float*>(data), frames);
+  } else {
+    int16_t* dst = reinterpret_cast<int16_t*>(data);
+    int chunk_size = device_buffer_.size() / 2;
+
+    while (read < frames) {
+      int chunk = fifo_.Read(device_buffer_.data(), qMin(chunk_size, frames - read));
+
+      AudioMixer::ToS16(device_buffer_.constData(), dst + read * 2, chunk * 2);
+
+      read += chunk;
+
+      if (chunk < chunk_size) {
+        break;
+      }
+    }
+  }
+
+  played_frames_ += read;
+
+  // If the mixer has fallen behind, play silence rather than waiting for it
+  memset(data + read * bytes_per_frame, 0, static_cast<size_t>((frames - read) * bytes_per_frame));
+
+  return static_cast<qint64>(frames) * bytes_per_frame;
+}
+
+AudioEngine::MixThread::MixThread(AudioEngine *parent) :
+  parent_(parent)
+{
+}
+
+void AudioEngine::MixThread::run()
+{
+  parent_->MixLoop();
+}
+
+AudioEngine::DeviceThread::DeviceThread(AudioEngine *parent) :
+  parent_(parent)
+{
+}
+
+void AudioEngine::DeviceThread::run()
+{
+  QAudioOutput output(parent_->format_);
+
+  output.start(&parent_->device_);
+
+  // What the device has taken but not played yet, so ElapsedUSecs() reports what's actually being heard
+  parent_->latency_frames_ = output.bufferSize() / parent_->format_.bytesPerFrame();
+
+  exec();
+
+  output.stop();
+}
+
+AudioEngine::Device::Device(AudioEngine *parent) :
+  parent_(parent)
+{
+}
+
+qint64 AudioEngine::Device::readData(char *data, qint64 maxlen)
+{
+  return parent_->Pull(data, maxlen);
+}
+
+qint64 AudioEngine::Device::writeData(const char *data, qint64 len)
+{
+  Q_UNUSED(data)
+  Q_UNUSED(len)
+
+  return -1;
+}
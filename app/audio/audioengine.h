@@ -0,0 +1,280 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef AUDIOENGINE_H
+#define AUDIOENGINE_H
+
+#include <atomic>
+#include <QAudioFormat>
+#include <QHash>
+#include <QIODevice>
+#include <QMutex>
+#include <QThread>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "audiofifo.h"
+#include "timestretcher.h"
+#include "common/rational.h"
+#include "decoder/conformedaudio.h"
+#include "decoder/decoder.h"
+
+class ClipBlock;
+class TimelineOutput;
+
+/**
+ * @brief Plays the audio of every clip on a timeline
+ *
+ * A mixing thread pulls samples for every ClipBlock with audio on every track, applies each clip's volume and pan,
+ * and mixes them into a stereo float bus a block of kAudioMixBlockSize samples at a time. Mixed blocks are handed to
+ * the audio device's thread through an AudioFIFO, and the device thread does nothing but copy them out (converting
+ * to 16-bit if the device doesn't take float), so it never locks, allocates, or waits on decoding. If the mixer falls
+ * behind, the device plays silence rather than waiting.
+ *
+ * Since what's heard can't be sped up or slowed down the way video frames can be dropped, playback should follow the
+ * audio: ElapsedUSecs() is the position the listener is hearing, for PlaybackClock::SyncToAudio().
+ *
+ * Clips are read from ConformedAudio where it exists, so mixing them costs no decoding at all. Until then (e.g. the
+ * first time a sequence is played) they're decoded as they're mixed, see ConformStreams().
+ *
+ * Forward shuttle playback up to kMaxStretchSpeed is mixed too, sped up by a TimeStretcher so it keeps its pitch.
+ * Reverse and faster playback is silent.
+ */
+class AudioEngine : public QObject
+{
+  Q_OBJECT
+public:
+  AudioEngine(QObject* parent = nullptr);
+
+  virtual ~AudioEngine() override;
+
+  /**
+   * @brief Start playing `timeline` from `time` at `speed` times normal speed, mixed at `sample_rate`
+   *
+   * Restarts playback if it's already running. The timeline must stay valid until Stop() is called.
+   */
+  void Start(TimelineOutput* timeline, const rational& time, int sample_rate, int speed = 1);
+
+  /**
+   * @brief Returns TRUE if playback at `speed` is heard (see Start())
+   */
+  static bool IsAudibleSpeed(int speed);
+
+  void Stop();
+
+  bool IsRunning() const;
+
+  /**
+   * @brief Microseconds of audio the device has played since Start(), or -1 if nothing has been heard yet
+   *
+   * Thread-safe.
+   */
+  qint64 ElapsedUSecs() const;
+
+  /**
+   * @brief Queue a ConformTask for every audio stream used in `timeline` that hasn't been conformed to `sample_rate`
+   *
+   * Must be called from the main thread.
+   */
+  static void ConformStreams(TimelineOutput* timeline, int sample_rate);
+
+private:
+  /**
+   * @brief Runs MixLoop()
+   */
+  class MixThread : public QThread
+  {
+  public:
+    MixThread(AudioEngine* parent);
+
+  protected:
+    virtual void run() override;
+
+  private:
+    AudioEngine* parent_;
+  };
+
+  /**
+   * @brief Owns the QAudioOutput, whose pulls (see Device) then happen on this thread
+   */
+  class DeviceThread : public QThread
+  {
+  public:
+    DeviceThread(AudioEngine* parent);
+
+  protected:
+    virtual void run() override;
+
+  private:
+    AudioEngine* parent_;
+  };
+
+  /**
+   * @brief The QIODevice the audio device pulls from, reads straight out of the FIFO
+   */
+  class Device : public QIODevice
+  {
+  public:
+    Device(AudioEngine* parent);
+
+  protected:
+    virtual qint64 readData(char* data, qint64 maxlen) override;
+
+    virtual qint64 writeData(const char* data, qint64 len) override;
+
+  private:
+    AudioEngine* parent_;
+  };
+
+  /**
+   * @brief Where a clip's audio is read from
+   *
+   * Either the stream's ConformedAudio or, if it hasn't been conformed yet, a decoder kept open between blocks so
+   * contiguous reads never seek.
+   */
+  struct ClipSource {
+    StreamPtr stream;
+
+    DecoderPtr decoder;
+
+    ConformedAudioPtr conformed;
+
+    /// Mix position conformed audio was last looked for at, so a missing file is only looked for once a second
+    qint64 conform_checked;
+
+    /// Mix position the source was last used at, sources that haven't been used for a while are closed
+    qint64 last_used;
+  };
+
+  /**
+   * @brief A stretch of a clip that's heard in the block being mixed
+   */
+  struct MixSegment {
+    ClipBlock* clip;
+    StreamPtr stream;
+    QString decoder_id;
+
+    /// Media time of the first sample
+    rational media_time;
+
+    /// Offset into the block and length, in bus samples
+    int offset;
+    int frames;
+
+    float left_gain;
+    float right_gain;
+  };
+
+  /**
+   * @brief Main loop of the mixing thread, keeps the FIFO topped up until Stop()
+   */
+  void MixLoop();
+
+  /**
+   * @brief Mix `frames` samples of the timeline from the mix position into the bus and advance the mix position
+   */
+  void MixBlock(int frames);
+
+  /**
+   * @brief Find every clip heard in the block starting at `position` (in bus samples)
+   */
+  QList<MixSegment> GetSegments(qint64 position, int frames);
+
+  /**
+   * @brief Read a segment from its source and add it to `bus`
+   */
+  void MixSegmentIntoBus(const MixSegment& segment, qint64 position);
+
+  /**
+   * @brief Add a segment to `bus` straight from conformed audio
+   */
+  void MixConformedIntoBus(const MixSegment& segment, ConformedAudio* conformed);
+
+  /**
+   * @brief Returns the audio stream of the footage a clip shows, or nullptr if it has none
+   */
+  static StreamPtr GetAudioStream(ClipBlock* clip);
+
+  /**
+   * @brief Convert and send as much of the FIFO as fits in `data` to the device, padding with silence
+   *
+   * Called on the device thread.
+   */
+  qint64 Pull(char* data, qint64 maxlen);
+
+  TimelineOutput* timeline_;
+
+  int sample_rate_;
+
+  int speed_;
+
+  /**
+   * @brief Mix position (in bus samples since the start of the timeline) of the next block to be mixed
+   */
+  qint64 mix_position_;
+
+  QVector<float> bus_;
+
+  /// Shortens the mixed timeline for speeds other than 1, and its output
+  TimeStretcher stretcher_;
+  QVector<float> stretch_buffer_;
+
+  /// Scratch buffers for converting and resampling clip audio to the bus format
+  QVector<float> convert_buffer_;
+  QVector<float> resample_buffer_;
+
+  QHash<ClipBlock*, ClipSource> sources_;
+
+  AudioFIFO fifo_;
+
+  QAudioFormat format_;
+
+  /**
+   * @brief Scratch buffer for converting to 16-bit on the device thread, allocated in Start()
+   */
+  QVector<float> device_buffer_;
+
+  /**
+   * @brief Sample frames of mixed audio the device has taken from the FIFO
+   */
+  std::atomic<qint64> played_frames_;
+
+  /**
+   * @brief Sample frames the device buffers before they're heard
+   */
+  std::atomic<qint64> latency_frames_;
+
+  bool running_;
+
+  std::atomic<bool> quit_;
+
+  QMutex mix_lock_;
+
+  QWaitCondition mix_cond_;
+
+  MixThread mix_thread_;
+
+  DeviceThread device_thread_;
+
+  Device device_;
+
+};
+
+#endif // AUDIOENGINE_H
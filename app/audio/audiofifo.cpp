@@ -0,0 +1,100 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "audiofifo.h"
+
+#include <cstring>
+
+AudioFIFO::AudioFIFO() :
+  capacity_(0),
+  channels_(0),
+  read_pos_(0),
+  write_pos_(0)
+{
+}
+
+void AudioFIFO::Allocate(int capacity, int channels)
+{
+  capacity_ = capacity;
+  channels_ = channels;
+
+  buffer_.resize(capacity_ * channels_);
+
+  Clear();
+}
+
+void AudioFIFO::Clear()
+{
+  read_pos_.store(0, std::memory_order_relaxed);
+  write_pos_.store(0, std::memory_order_relaxed);
+}
+
+int AudioFIFO::Write(const float *data, int frames)
+{
+  qint64 write_pos = write_pos_.load(std::memory_order_relaxed);
+
+  frames = qMin(frames, capacity_ - static_cast<int>(write_pos - read_pos_.load(std::memory_order_acquire)));
+
+  // Copy in up to two parts, the second when the write wraps around the end of the buffer
+  int offset = static_cast<int>(write_pos % capacity_);
+  int first = qMin(frames, capacity_ - offset);
+
+  memcpy(buffer_.data() + offset * channels_, data, static_cast<size_t>(first * channels_) * sizeof(float));
+  memcpy(buffer_.data(), data + first * channels_, static_cast<size_t>((frames - first) * channels_) * sizeof(float));
+
+  write_pos_.store(write_pos + frames, std::memory_order_release);
+
+  return frames;
+}
+
+int AudioFIFO::Read(float *data, int frames)
+{
+  qint64 read_pos = read_pos_.load(std::memory_order_relaxed);
+
+  frames = qMin(frames, static_cast<int>(write_pos_.load(std::memory_order_acquire) - read_pos));
+
+  int offset = static_cast<int>(read_pos % capacity_);
+  int first = qMin(frames, capacity_ - offset);
+
+  // constData() so the device thread can never trigger a detach
+  memcpy(data, buffer_.constData() + offset * channels_, static_cast<size_t>(first * channels_) * sizeof(float));
+  memcpy(data + first * channels_,
+         buffer_.constData(),
+         static_cast<size_t>((frames - first) * channels_) * sizeof(float));
+
+  read_pos_.store(read_pos + frames, std::memory_order_release);
+
+  return frames;
+}
+
+int AudioFIFO::Available() const
+{
+  return static_cast<int>(write_pos_.load(std::memory_order_acquire) - read_pos_.load(std::memory_order_acquire));
+}
+
+int AudioFIFO::Space() const
+{
+  return capacity_ - Available();
+}
+
+const int &AudioFIFO::channels() const
+{
+  return channels_;
+}
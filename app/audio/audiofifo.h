@@ -0,0 +1,101 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef AUDIOFIFO_H
+#define AUDIOFIFO_H
+
+#include <atomic>
+#include <QVector>
+
+/**
+ * @brief A wait-free single-producer/single-consumer FIFO of interleaved float audio
+ *
+ * Used to hand mixed audio from the mixing thread to the audio device's thread. Write() and Read() never lock or
+ * allocate, so the device thread can't be held up by the mixer (or anything the mixer waits on). Positions are in
+ * sample frames (one sample for every channel).
+ *
+ * Allocate() and Clear() must only be called while neither side is using the FIFO.
+ */
+class AudioFIFO
+{
+public:
+  AudioFIFO();
+
+  /**
+   * @brief Allocate room for `capacity` sample frames of `channels` channels, clearing the FIFO
+   */
+  void Allocate(int capacity, int channels);
+
+  void Clear();
+
+  /**
+   * @brief Append up to `frames` sample frames, returns how many there was room for. Only call from the producer.
+   */
+  int Write(const float* data, int frames);
+
+  /**
+   * @brief Take up to `frames` sample frames, returns how many there were. Only call from the consumer.
+   */
+  int Read(float* data, int frames);
+
+  /**
+   * @brief Number of sample frames waiting to be read
+   */
+  int Available() const;
+
+  /**
+   * @brief Number of sample frames that can be written
+   */
+  int Space() const;
+
+  const int& channels() const;
+
+private:
+  QVector<float> buffer_;
+
+  int capacity_;
+
+  int channels_;
+
+  /**
+   * @brief Keeps the positions off each other's (and the fields above's) cache lines
+   *
+   * Explicit padding rather than alignas(), since the FIFO is held by value in objects created with a plain `new`,
+   * which C++11 doesn't align past the default.
+   */
+  char pad_before_read_[64];
+
+  /**
+   * @brief Total sample frames ever read, only written by the consumer
+   */
+  std::atomic<qint64> read_pos_;
+
+  char pad_before_write_[64 - sizeof(std::atomic<qint64>)];
+
+  /**
+   * @brief Total sample frames ever written, only written by the producer
+   */
+  std::atomic<qint64> write_pos_;
+
+  char pad_after_write_[64 - sizeof(std::atomic<qint64>)];
+
+};
+
+#endif // AUDIOFIFO_H
@@ -0,0 +1,258 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "audiomixer.h"
+
+#include <QtGlobal>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OLIVE_MIX_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#define OLIVE_MIX_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+template <typename T>
+float SampleToFloat(T sample);
+
+template <>
+float SampleToFloat(uint8_t sample)
+{
+  return static_cast<float>(static_cast<int>(sample) - 128) / 128.0f;
+}
+
+template <>
+float SampleToFloat(int16_t sample)
+{
+  return static_cast<float>(sample) / 32768.0f;
+}
+
+template <>
+float SampleToFloat(int32_t sample)
+{
+  return static_cast<float>(sample) / 2147483648.0f;
+}
+
+template <>
+float SampleToFloat(float sample)
+{
+  return sample;
+}
+
+template <>
+float SampleToFloat(double sample)
+{
+  return static_cast<float>(sample);
+}
+
+template <typename T>
+void ConvertToStereo(const uint8_t* src, int channels, int frames, float* dst)
+{
+  const T* samples = reinterpret_cast<const T*>(src);
+
+  if (channels == 1) {
+    for (int i=0;i<frames;i++) {
+      float s = SampleToFloat<T>(samples[i]);
+
+      dst[i*2] = s;
+      dst[i*2+1] = s;
+    }
+  } else {
+    for (int i=0;i<frames;i++) {
+      dst[i*2] = SampleToFloat<T>(samples[i*channels]);
+      dst[i*2+1] = SampleToFloat<T>(samples[i*channels+1]);
+    }
+  }
+}
+
+}
+
+void AudioMixer::ToStereo(const uint8_t *src, const olive::SampleFormat &format, int channels, int frames, float *dst)
+{
+  if (channels <= 0) {
+    for (int i=0;i<frames*2;i++) {
+      dst[i] = 0.0f;
+    }
+    return;
+  }
+
+  switch (format) {
+  case olive::SAMPLE_FMT_U8:
+    ConvertToStereo<uint8_t>(src, channels, frames, dst);
+    break;
+  case olive::SAMPLE_FMT_S16:
+    ConvertToStereo<int16_t>(src, channels, frames, dst);
+    break;
+  case olive::SAMPLE_FMT_S32:
+    ConvertToStereo<int32_t>(src, channels, frames, dst);
+    break;
+  case olive::SAMPLE_FMT_FLT:
+    ConvertToStereo<float>(src, channels, frames, dst);
+    break;
+  case olive::SAMPLE_FMT_DBL:
+    ConvertToStereo<double>(src, channels, frames, dst);
+    break;
+  case olive::SAMPLE_FMT_INVALID:
+  case olive::SAMPLE_FMT_COUNT:
+    for (int i=0;i<frames*2;i++) {
+      dst[i] = 0.0f;
+    }
+    break;
+  }
+}
+
+void AudioMixer::Resample(const float *src, int src_frames, double offset, double step, float *dst, int dst_frames)
+{
+  for (int i=0;i<dst_frames;i++) {
+    double pos = offset + i * step;
+    int index = qMin(static_cast<int>(pos), src_frames - 1);
+    int next = qMin(index + 1, src_frames - 1);
+    float t = static_cast<float>(pos - index);
+
+    dst[i*2] = src[index*2] + (src[next*2] - src[index*2]) * t;
+    dst[i*2+1] = src[index*2+1] + (src[next*2+1] - src[index*2+1]) * t;
+  }
+}
+
+void AudioMixer::MixStereo(float *bus, const float *src, int frames, float left_gain, float right_gain)
+{
+  int i = 0;
+
+  // Two stereo frames per vector, so the gains alternate left, right, left, right
+#if defined(OLIVE_MIX_SSE2)
+  __m128 gains = _mm_setr_ps(left_gain, right_gain, left_gain, right_gain);
+
+  for (;i+2<=frames;i+=2) {
+    __m128 mixed = _mm_add_ps(_mm_loadu_ps(bus + i*2), _mm_mul_ps(_mm_loadu_ps(src + i*2), gains));
+
+    _mm_storeu_ps(bus + i*2, mixed);
+  }
+#elif defined(OLIVE_MIX_NEON)
+  const float gain_values[4] = {left_gain, right_gain, left_gain, right_gain};
+  float32x4_t gains = vld1q_f32(gain_values);
+
+  for (;i+2<=frames;i+=2) {
+    vst1q_f32(bus + i*2, vmlaq_f32(vld1q_f32(bus + i*2), vld1q_f32(src + i*2), gains));
+  }
+#endif
+
+  for (;i<frames;i++) {
+    bus[i*2] += src[i*2] * left_gain;
+    bus[i*2+1] += src[i*2+1] * right_gain;
+  }
+}
+
+void AudioMixer::PanGains(float volume, float pan, float *left_gain, float *right_gain)
+{
+  pan = qBound(-1.0f, pan, 1.0f);
+
+  *left_gain = volume * qMin(1.0f, 1.0f - pan);
+  *right_gain = volume * qMin(1.0f, 1.0f + pan);
+}
+
+float AudioMixer::Correlate(const float *a, const float *b, int samples)
+{
+  int i = 0;
+  float sum = 0.0f;
+
+#if defined(OLIVE_MIX_SSE2)
+  __m128 sums = _mm_setzero_ps();
+
+  for (;i+4<=samples;i+=4) {
+    sums = _mm_add_ps(sums, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+
+  float lanes[4];
+  _mm_storeu_ps(lanes, sums);
+  sum = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(OLIVE_MIX_NEON)
+  float32x4_t sums = vdupq_n_f32(0.0f);
+
+  for (;i+4<=samples;i+=4) {
+    sums = vmlaq_f32(sums, vld1q_f32(a + i), vld1q_f32(b + i));
+  }
+
+  sum = vaddvq_f32(sums);
+#endif
+
+  for (;i<samples;i++) {
+    sum += a[i] * b[i];
+  }
+
+  return sum;
+}
+
+void AudioMixer::Crossfade(const float *from, const float *to, const float *fade, float *dst, int samples)
+{
+  int i = 0;
+
+#if defined(OLIVE_MIX_SSE2)
+  for (;i+4<=samples;i+=4) {
+    __m128 f = _mm_loadu_ps(from + i);
+    __m128 diff = _mm_sub_ps(_mm_loadu_ps(to + i), f);
+
+    _mm_storeu_ps(dst + i, _mm_add_ps(f, _mm_mul_ps(diff, _mm_loadu_ps(fade + i))));
+  }
+#elif defined(OLIVE_MIX_NEON)
+  for (;i+4<=samples;i+=4) {
+    float32x4_t f = vld1q_f32(from + i);
+    float32x4_t diff = vsubq_f32(vld1q_f32(to + i), f);
+
+    vst1q_f32(dst + i, vmlaq_f32(f, diff, vld1q_f32(fade + i)));
+  }
+#endif
+
+  for (;i<samples;i++) {
+    dst[i] = from[i] + (to[i] - from[i]) * fade[i];
+  }
+}
+
+void AudioMixer::ToS16(const float *src, int16_t *dst, int samples)
+{
+  int i = 0;
+
+#if defined(OLIVE_MIX_SSE2)
+  __m128 scale = _mm_set1_ps(32767.0f);
+
+  // Converting to 32-bit and packing with signed saturation clips for free
+  for (;i+8<=samples;i+=8) {
+    __m128i low = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i), scale));
+    __m128i high = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(src + i + 4), scale));
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(low, high));
+  }
+#elif defined(OLIVE_MIX_NEON)
+  float32x4_t scale = vdupq_n_f32(32767.0f);
+
+  for (;i+8<=samples;i+=8) {
+    int32x4_t low = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i), scale));
+    int32x4_t high = vcvtq_s32_f32(vmulq_f32(vld1q_f32(src + i + 4), scale));
+
+    vst1q_s16(dst + i, vcombine_s16(vqmovn_s32(low), vqmovn_s32(high)));
+  }
+#endif
+
+  for (;i<samples;i++) {
+    dst[i] = static_cast<int16_t>(qBound(-32768.0f, src[i] * 32767.0f, 32767.0f));
+  }
+}
@@ -0,0 +1,82 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef AUDIOMIXER_H
+#define AUDIOMIXER_H
+
+#include <stdint.h>
+
+#include "render/sampleformat.h"
+
+/**
+ * @brief Static sample processing functions used by AudioEngine
+ *
+ * The mix bus is always interleaved stereo float. Mixing, time-stretching, and the conversion for the audio device are
+ * vectorized with SSE2 or NEON where available.
+ */
+class AudioMixer
+{
+public:
+  /**
+   * @brief Convert packed audio of any channel count to interleaved stereo float
+   *
+   * Mono is copied to both channels, anything with more than two channels only keeps the first two (front left and
+   * right in every FFmpeg layout).
+   */
+  static void ToStereo(const uint8_t* src, const olive::SampleFormat& format, int channels, int frames, float* dst);
+
+  /**
+   * @brief Linearly resample interleaved stereo audio
+   *
+   * Output frame `i` is taken from input position `offset + i * step` (in frames), which must stay within
+   * `src_frames - 1`.
+   */
+  static void Resample(const float* src, int src_frames, double offset, double step, float* dst, int dst_frames);
+
+  /**
+   * @brief Add stereo audio to the bus, scaling the left and right channels by their own gain
+   */
+  static void MixStereo(float* bus, const float* src, int frames, float left_gain, float right_gain);
+
+  /**
+   * @brief Get the left and right gain for a volume (1.0 is unity) and pan (-1.0 is left, 1.0 is right)
+   *
+   * Panning is a balance control, the channel being panned towards stays at unity and the other is attenuated.
+   */
+  static void PanGains(float volume, float pan, float* left_gain, float* right_gain);
+
+  /**
+   * @brief Returns the dot product of `a` and `b`, used as a cross-correlation by TimeStretcher
+   */
+  static float Correlate(const float* a, const float* b, int samples);
+
+  /**
+   * @brief Blend `from` into `to`, `dst[i] = from[i] + (to[i] - from[i]) * fade[i]`
+   */
+  static void Crossfade(const float* from, const float* to, const float* fade, float* dst, int samples);
+
+  /**
+   * @brief Convert float samples to clipped signed 16-bit
+   */
+  static void ToS16(const float* src, int16_t* dst, int samples);
+
+};
+
+#endif // AUDIOMIXER_H
@@ -0,0 +1,195 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "timestretcher.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <QtMath>
+
+#include "audiomixer.h"
+#include "config/config.h"
+
+/**
+ * @brief Spacing (in frames) of the coarse alignment search, the fine search then checks every frame around the best
+ */
+const int kCoarseSearchStep = 4;
+
+TimeStretcher::TimeStretcher() :
+  speed_(1.0),
+  overlap_(0),
+  search_(0),
+  input_start_(0),
+  analysis_pos_(0.0),
+  first_segment_(true)
+{
+}
+
+void TimeStretcher::Reset(int sample_rate, double speed)
+{
+  speed_ = speed;
+  overlap_ = qMax(1, sample_rate * kTimeStretchOverlap / 1000);
+  search_ = qMax(1, sample_rate * kTimeStretchSearch / 1000);
+
+  input_.clear();
+  input_mono_.clear();
+  output_.clear();
+
+  input_start_ = 0;
+  analysis_pos_ = 0.0;
+  first_segment_ = true;
+
+  // Reserve the most we can hold between processing so the mixing thread doesn't reallocate while playing
+  int max_input = qRound(overlap_ * (speed_ + 2.0)) + search_ * 2 + kAudioMixBlockSize * kMaxStretchSpeed;
+
+  input_.reserve(max_input * 2);
+  input_mono_.reserve(max_input);
+  output_.reserve((kAudioMixBlockSize + overlap_) * 2);
+
+  tail_.resize(overlap_ * 2);
+  tail_mono_.resize(overlap_);
+  fade_.resize(overlap_ * 2);
+
+  for (int i=0;i<overlap_;i++) {
+    float f = 0.5f - 0.5f * std::cos(static_cast<float>(M_PI) * (static_cast<float>(i) + 0.5f) / static_cast<float>(overlap_));
+
+    fade_[i*2] = f;
+    fade_[i*2+1] = f;
+  }
+}
+
+void TimeStretcher::Push(const float *data, int frames)
+{
+  int old_frames = input_mono_.size();
+
+  input_.resize((old_frames + frames) * 2);
+  input_mono_.resize(old_frames + frames);
+
+  std::copy(data, data + frames * 2, input_.data() + old_frames * 2);
+
+  for (int i=0;i<frames;i++) {
+    input_mono_[old_frames + i] = data[i*2] + data[i*2+1];
+  }
+
+  Process();
+}
+
+int TimeStretcher::Available() const
+{
+  return output_.size() / 2;
+}
+
+int TimeStretcher::Pull(float *data, int frames)
+{
+  frames = qMin(frames, Available());
+
+  std::copy(output_.constBegin(), output_.constBegin() + frames * 2, data);
+
+  output_.remove(0, frames * 2);
+
+  return frames;
+}
+
+void TimeStretcher::Process()
+{
+  forever {
+    qint64 ideal = static_cast<qint64>(analysis_pos_);
+    qint64 first = ideal;
+    qint64 last = ideal;
+
+    if (!first_segment_) {
+      first = qMax(ideal - search_, input_start_);
+      last = ideal + search_;
+    }
+
+    // Each segment is crossfaded in and then continues as the next tail
+    if (last + overlap_ * 2 > input_start_ + input_mono_.size()) {
+      break;
+    }
+
+    qint64 pos = first_segment_ ? first : FindBestPosition(first, last);
+    int index = static_cast<int>(pos - input_start_);
+    const float* segment = input_.constData() + index * 2;
+
+    int out_index = output_.size();
+    output_.resize(out_index + overlap_ * 2);
+
+    if (first_segment_) {
+      std::copy(segment, segment + overlap_ * 2, output_.data() + out_index);
+    } else {
+      AudioMixer::Crossfade(tail_.constData(), segment, fade_.constData(), output_.data() + out_index, overlap_ * 2);
+    }
+
+    std::copy(segment + overlap_ * 2, segment + overlap_ * 4, tail_.data());
+    std::copy(input_mono_.constBegin() + index + overlap_,
+              input_mono_.constBegin() + index + overlap_ * 2,
+              tail_mono_.data());
+
+    first_segment_ = false;
+    analysis_pos_ += overlap_ * speed_;
+  }
+
+  // Drop input no later segment can start in
+  qint64 keep_from = qMax(input_start_, static_cast<qint64>(analysis_pos_) - search_);
+  int drop = qMin(static_cast<int>(keep_from - input_start_), input_mono_.size());
+
+  if (drop > 0) {
+    input_.remove(0, drop * 2);
+    input_mono_.remove(0, drop);
+    input_start_ += drop;
+  }
+}
+
+qint64 TimeStretcher::FindBestPosition(qint64 first, qint64 last) const
+{
+  qint64 best = first;
+  float best_score = -std::numeric_limits<float>::max();
+
+  for (qint64 pos=first;pos<=last;pos+=kCoarseSearchStep) {
+    float score = Similarity(pos);
+
+    if (score > best_score) {
+      best_score = score;
+      best = pos;
+    }
+  }
+
+  qint64 fine_first = qMax(first, best - kCoarseSearchStep + 1);
+  qint64 fine_last = qMin(last, best + kCoarseSearchStep - 1);
+
+  for (qint64 pos=fine_first;pos<=fine_last;pos++) {
+    float score = Similarity(pos);
+
+    if (score > best_score) {
+      best_score = score;
+      best = pos;
+    }
+  }
+
+  return best;
+}
+
+float TimeStretcher::Similarity(qint64 pos) const
+{
+  return AudioMixer::Correlate(tail_mono_.constData(),
+                               input_mono_.constData() + (pos - input_start_),
+                               overlap_);
+}
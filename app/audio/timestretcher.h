@@ -0,0 +1,116 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef TIMESTRETCHER_H
+#define TIMESTRETCHER_H
+
+#include <QVector>
+
+/**
+ * @brief Speeds up interleaved stereo audio without changing its pitch
+ *
+ * Uses WSOLA (waveform similarity overlap-add): output is built from short segments of the input taken `speed` times
+ * further apart than they're played, and each segment is nudged within a small search range to where it best lines
+ * up with the end of the previous one before the two are crossfaded, so the waveform stays continuous instead of
+ * clicking or phasing.
+ *
+ * Used by AudioEngine so shuttle playback stays audible. The alignment search runs on a mono sum with a coarse pass
+ * then a fine one, so the cost per output sample is fixed by the segment and search lengths and doesn't depend on the
+ * speed or the number of clips. Latency is at most two segments plus the search range.
+ *
+ * Not thread-safe, it's used only by the mixing thread.
+ */
+class TimeStretcher
+{
+public:
+  TimeStretcher();
+
+  /**
+   * @brief Clear all audio and start stretching audio at `sample_rate` by `speed` (e.g. 2.0 plays twice as fast)
+   */
+  void Reset(int sample_rate, double speed);
+
+  /**
+   * @brief Add input audio
+   */
+  void Push(const float* data, int frames);
+
+  /**
+   * @brief Returns the number of output frames ready to be pulled
+   */
+  int Available() const;
+
+  /**
+   * @brief Take up to `frames` frames of output audio
+   *
+   * @return
+   *
+   * The number of frames written to `data`.
+   */
+  int Pull(float* data, int frames);
+
+private:
+  /**
+   * @brief Produce as many output segments as the input allows
+   */
+  void Process();
+
+  /**
+   * @brief Returns the input frame (absolute) between `first` and `last` that best continues the previous segment
+   */
+  qint64 FindBestPosition(qint64 first, qint64 last) const;
+
+  /**
+   * @brief Returns how well the segment starting at input frame `pos` (absolute) continues the previous one
+   */
+  float Similarity(qint64 pos) const;
+
+  double speed_;
+
+  /// Length of the crossfade between segments in frames, also the amount of output each segment produces
+  int overlap_;
+
+  /// How far (in frames) a segment may move from where it ideally starts
+  int search_;
+
+  /// Input audio, interleaved stereo and a mono sum for the alignment search
+  QVector<float> input_;
+  QVector<float> input_mono_;
+
+  /// Absolute frame index of the first frame in `input_`
+  qint64 input_start_;
+
+  /// Absolute input position the next segment ideally starts at
+  double analysis_pos_;
+
+  bool first_segment_;
+
+  /// The audio that naturally follows the previous segment, the next segment is faded in over it
+  QVector<float> tail_;
+  QVector<float> tail_mono_;
+
+  /// Raised-cosine fade in, with each value repeated for both channels
+  QVector<float> fade_;
+
+  QVector<float> output_;
+
+};
+
+#endif // TIMESTRETCHER_H
@@ -0,0 +1,57 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "benchmarkframe.h"
+
+#include <random>
+#include <vector>
+
+#include "common/define.h"
+#include "render/pixelconversion.h"
+
+FramePtr CreateBenchmarkFrame(const olive::PixelFormat &format)
+{
+  FramePtr frame = Frame::Create();
+
+  frame->set_width(kBenchmarkFrameWidth);
+  frame->set_height(kBenchmarkFrameHeight);
+  frame->set_format(format);
+  frame->allocate();
+
+  int channel_count = kBenchmarkFrameWidth * kBenchmarkFrameHeight * kRGBAChannels;
+
+  std::vector<float> values(static_cast<size_t>(channel_count));
+
+  std::mt19937 generator(2019);
+  std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+
+  for (size_t i=0;i<values.size();i++) {
+    values[i] = distribution(generator);
+  }
+
+  // Make every 16th pixel fully transparent
+  for (size_t i=3;i<values.size();i+=static_cast<size_t>(16 * kRGBAChannels)) {
+    values[i] = 0.0f;
+  }
+
+  olive::pixel::FromFloat(values.data(), frame->data(), format, channel_count);
+
+  return frame;
+}
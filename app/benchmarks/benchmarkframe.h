@@ -0,0 +1,41 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef BENCHMARKFRAME_H
+#define BENCHMARKFRAME_H
+
+#include "decoder/frame.h"
+#include "render/pixelformat.h"
+
+/**
+ * @brief The size of frames used by image benchmarks (1080p)
+ */
+const int kBenchmarkFrameWidth = 1920;
+const int kBenchmarkFrameHeight = 1080;
+
+/**
+ * @brief Create a kBenchmarkFrameWidth x kBenchmarkFrameHeight frame filled with the same pseudo-random pixels every run
+ *
+ * Colors and alphas are spread over the whole 0.0-1.0 range, with some fully transparent pixels so the alpha
+ * functions' special cases are included.
+ */
+FramePtr CreateBenchmarkFrame(const olive::PixelFormat& format);
+
+#endif // BENCHMARKFRAME_H
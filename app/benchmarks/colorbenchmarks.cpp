@@ -0,0 +1,126 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <cstring>
+#include <benchmark/benchmark.h>
+
+#include "benchmarkframe.h"
+#include "render/colorservice.h"
+#include "render/pixelconversion.h"
+#include "render/pixelservice.h"
+
+namespace {
+
+/**
+ * @brief Run `function` on a fresh copy of a benchmark frame every iteration
+ *
+ * The alpha functions work in place, so without restoring the frame repeated association would push every color
+ * towards zero (and into denormals) and time something other than real frames.
+ */
+template <typename Function>
+void RunOnFrame(benchmark::State& state, const olive::PixelFormat& format, Function function)
+{
+  FramePtr original = CreateBenchmarkFrame(format);
+  FramePtr frame = CreateBenchmarkFrame(format);
+
+  size_t frame_size = static_cast<size_t>(PixelService::GetBufferSize(format,
+                                                                      kBenchmarkFrameWidth,
+                                                                      kBenchmarkFrameHeight));
+
+  for (auto _ : state) {
+    state.PauseTiming();
+    memcpy(frame->data(), original->const_data(), frame_size);
+    state.ResumeTiming();
+
+    function(frame);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBenchmarkFrameWidth * kBenchmarkFrameHeight);
+}
+
+void BM_AssociateAlpha(benchmark::State& state)
+{
+  RunOnFrame(state, static_cast<olive::PixelFormat>(state.range(0)), ColorService::AssociateAlpha);
+}
+BENCHMARK(BM_AssociateAlpha)->DenseRange(0, olive::PIX_FMT_COUNT - 1)->ArgName("format")->Unit(benchmark::kMillisecond);
+
+void BM_DisassociateAlpha(benchmark::State& state)
+{
+  RunOnFrame(state, static_cast<olive::PixelFormat>(state.range(0)), ColorService::DisassociateAlpha);
+}
+BENCHMARK(BM_DisassociateAlpha)->DenseRange(0, olive::PIX_FMT_COUNT - 1)->ArgName("format")->Unit(benchmark::kMillisecond);
+
+void BM_ReassociateAlpha(benchmark::State& state)
+{
+  RunOnFrame(state, static_cast<olive::PixelFormat>(state.range(0)), ColorService::ReassociateAlpha);
+}
+BENCHMARK(BM_ReassociateAlpha)->DenseRange(0, olive::PIX_FMT_COUNT - 1)->ArgName("format")->Unit(benchmark::kMillisecond);
+
+/**
+ * @brief Run an alpha kernel (the dispatched one or the scalar reference) over a 32-bit float frame
+ */
+template <typename Kernel>
+void RunAlphaKernel(benchmark::State& state, Kernel kernel)
+{
+  RunOnFrame(state, olive::PIX_FMT_RGBA32F, [kernel](FramePtr frame) {
+    kernel(reinterpret_cast<float*>(frame->data()), kBenchmarkFrameWidth * kBenchmarkFrameHeight);
+  });
+}
+
+void BM_MultiplyAlpha(benchmark::State& state)
+{
+  RunAlphaKernel(state, [](float* data, int count) {
+    olive::pixel::MultiplyAlpha(data, count, false);
+  });
+}
+BENCHMARK(BM_MultiplyAlpha)->Unit(benchmark::kMillisecond);
+
+void BM_MultiplyAlphaReference(benchmark::State& state)
+{
+  RunAlphaKernel(state, [](float* data, int count) {
+    olive::pixel::reference::MultiplyAlpha(data, count, false);
+  });
+}
+BENCHMARK(BM_MultiplyAlphaReference)->Unit(benchmark::kMillisecond);
+
+void BM_DivideAlpha(benchmark::State& state)
+{
+  RunAlphaKernel(state, olive::pixel::DivideAlpha);
+}
+BENCHMARK(BM_DivideAlpha)->Unit(benchmark::kMillisecond);
+
+void BM_DivideAlphaReference(benchmark::State& state)
+{
+  RunAlphaKernel(state, olive::pixel::reference::DivideAlpha);
+}
+BENCHMARK(BM_DivideAlphaReference)->Unit(benchmark::kMillisecond);
+
+void BM_OCIOConvertFrame(benchmark::State& state)
+{
+  ColorServicePtr service = ColorService::Get(OCIO::ROLE_SCENE_LINEAR, "srgb");
+
+  RunOnFrame(state, olive::PIX_FMT_RGBA32F, [service](FramePtr frame) {
+    service->ConvertFrame(frame);
+  });
+}
+BENCHMARK(BM_OCIOConvertFrame)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+}
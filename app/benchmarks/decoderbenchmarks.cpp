@@ -0,0 +1,196 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <algorithm>
+#include <climits>
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "decoder/ffmpeg/ffmpegdecoder.h"
+#include "project/item/footage/footage.h"
+
+/**
+ * @brief Opens the video in OLIVE_BENCHMARK_MEDIA and exposes the parts of FFmpegDecoder being measured
+ *
+ * This is a friend of FFmpegDecoder, so it can't be in an anonymous namespace.
+ */
+class FFmpegDecoderBenchmark
+{
+public:
+  /**
+   * @brief Open and index the first video stream, or skip the benchmark with an error if that isn't possible
+   */
+  bool Open(benchmark::State& state)
+  {
+    QString filename = QString::fromLocal8Bit(qgetenv("OLIVE_BENCHMARK_MEDIA"));
+
+    if (filename.isEmpty()) {
+      state.SkipWithError("Set OLIVE_BENCHMARK_MEDIA to a video file to run decoder benchmarks");
+      return false;
+    }
+
+    footage_.set_filename(filename);
+
+    FFmpegDecoder probe_decoder;
+
+    if (!probe_decoder.Probe(&footage_)) {
+      state.SkipWithError("OLIVE_BENCHMARK_MEDIA couldn't be probed");
+      return false;
+    }
+
+    for (int i=0;i<footage_.stream_count();i++) {
+      if (footage_.stream(i)->type() == Stream::kVideo) {
+        decoder_.set_stream(footage_.stream(i));
+        break;
+      }
+    }
+
+    if (decoder_.stream() == nullptr) {
+      state.SkipWithError("OLIVE_BENCHMARK_MEDIA has no video stream");
+      return false;
+    }
+
+    // Indexes are saved, so only the first run of the benchmarks has to build one
+    if (!decoder_.Analyze() || decoder_.frame_index_ == nullptr || decoder_.frame_index_->count() == 0) {
+      state.SkipWithError("OLIVE_BENCHMARK_MEDIA couldn't be indexed");
+      return false;
+    }
+
+    return true;
+  }
+
+  /**
+   * @brief The presentation timestamps of up to `max_count` frames from the start of the stream, in order
+   */
+  std::vector<int64_t> GetTimestamps(int max_count)
+  {
+    std::vector<int64_t> timestamps;
+
+    int count = qMin(max_count, decoder_.frame_index_->count());
+
+    for (int i=0;i<count;i++) {
+      timestamps.push_back(decoder_.frame_index_->pts(i));
+    }
+
+    return timestamps;
+  }
+
+  rational GetTime(const int64_t& timestamp)
+  {
+    return rational(timestamp) * decoder_.frame_index_->timebase();
+  }
+
+  FramePtr Retrieve(const int64_t& timestamp)
+  {
+    return decoder_.Retrieve(GetTime(timestamp));
+  }
+
+  int64_t GetClosestTimestampInIndex(const int64_t& timestamp)
+  {
+    return decoder_.GetClosestTimestampInIndex(timestamp);
+  }
+
+private:
+  Footage footage_;
+
+  FFmpegDecoder decoder_;
+};
+
+namespace {
+
+// Enough frames to cross several GOPs in most long-GOP media
+const int kRetrieveFrameCount = 240;
+
+void RunRetrieve(benchmark::State& state, bool shuffled)
+{
+  FFmpegDecoderBenchmark media;
+
+  if (!media.Open(state)) {
+    return;
+  }
+
+  std::vector<int64_t> timestamps = media.GetTimestamps(kRetrieveFrameCount);
+
+  if (shuffled) {
+    std::shuffle(timestamps.begin(), timestamps.end(), std::mt19937(2019));
+  }
+
+  size_t i = 0;
+
+  for (auto _ : state) {
+    FramePtr frame = media.Retrieve(timestamps[i]);
+
+    if (frame == nullptr) {
+      state.SkipWithError("Failed to retrieve frame");
+      break;
+    }
+
+    i = (i + 1) % timestamps.size();
+  }
+
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_FFmpegRetrieveSequential(benchmark::State& state)
+{
+  RunRetrieve(state, false);
+}
+BENCHMARK(BM_FFmpegRetrieveSequential)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_FFmpegRetrieveRandom(benchmark::State& state)
+{
+  RunRetrieve(state, true);
+}
+BENCHMARK(BM_FFmpegRetrieveRandom)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+void BM_GetClosestTimestampInIndex(benchmark::State& state)
+{
+  const int kLookupCount = 1024;
+
+  FFmpegDecoderBenchmark media;
+
+  if (!media.Open(state)) {
+    return;
+  }
+
+  std::vector<int64_t> index_timestamps = media.GetTimestamps(INT_MAX);
+
+  // Timestamps anywhere in the stream, mostly between frames
+  std::mt19937 generator(2019);
+  std::uniform_int_distribution<int64_t> distribution(index_timestamps.front(), index_timestamps.back());
+
+  std::vector<int64_t> lookups;
+
+  for (int i=0;i<kLookupCount;i++) {
+    lookups.push_back(distribution(generator));
+  }
+
+  for (auto _ : state) {
+    for (size_t i=0;i<lookups.size();i++) {
+      benchmark::DoNotOptimize(media.GetClosestTimestampInIndex(lookups[i]));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kLookupCount);
+}
+BENCHMARK(BM_GetClosestTimestampInIndex);
+
+}
@@ -0,0 +1,161 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "legacyrational.h"
+
+int LegacyRational::activeInstances = 0;
+
+LegacyRational::~LegacyRational()
+{
+  activeInstances--;
+}
+
+void LegacyRational::fixSigns()
+{
+  if(denom < 0)
+    {
+      denom = -denom;
+      numer = -numer;
+    }
+  if(numer == 0 || denom == 0)
+    {
+      numer = 0;
+      denom = 0;
+    }
+}
+
+void LegacyRational::reduce()
+{
+  int64_t d = 1;
+
+  if(denom != 0 && numer !=0)
+    d = gcd(numer, denom);
+
+  if(d > 1)
+    {
+      numer /= d;
+      denom /= d;
+    }
+}
+
+int64_t LegacyRational::gcd(int64_t &x, int64_t &y)
+{
+  if(y == 0)
+    return x;
+  else
+    {
+      int64_t tmp = x % y;
+
+      return gcd(y, tmp);
+    }
+}
+
+double LegacyRational::toDouble() const
+{
+  if(denom != 0)
+    return static_cast<double>(numer) / static_cast<double>(denom);
+  else
+    return static_cast<double>(0);
+}
+
+const LegacyRational& LegacyRational::operator=(const LegacyRational &rhs)
+{
+  if(this != &rhs)
+    {
+      numer = rhs.numer;
+      denom = rhs.denom;
+    }
+  return *this;
+}
+
+const LegacyRational& LegacyRational::operator+=(const LegacyRational &rhs)
+{
+  if(numer * denom == 0 && rhs.numer * rhs.denom == 0)
+    {
+      numer = 0;
+      denom = 0;
+    }
+  else
+    if(numer * denom != 0 && rhs.numer * rhs.denom == 0)
+      {
+
+      }
+    else
+      if(numer * denom == 0 && rhs.numer * rhs.denom != 0)
+        {
+          numer = rhs.numer;
+          denom = rhs.denom;
+        }
+      else
+        {
+          numer = (numer * rhs.denom) + (rhs.numer * denom);
+          denom = denom * rhs.denom;
+          fixSigns();
+          reduce();
+        }
+  return *this;
+}
+
+const LegacyRational& LegacyRational::operator*=(const LegacyRational &rhs)
+{
+  numer = numer * rhs.numer;
+  denom = denom * rhs.denom;
+  fixSigns();
+  reduce();
+  return *this;
+}
+
+LegacyRational LegacyRational::operator+(const LegacyRational &rhs) const
+{
+  LegacyRational answer(*this);
+  answer += rhs;
+  return answer;
+}
+
+LegacyRational LegacyRational::operator*(const LegacyRational &rhs) const
+{
+  LegacyRational answer(*this);
+  answer *= rhs;
+  return answer;
+}
+
+bool LegacyRational::operator<(const LegacyRational &rhs) const
+{
+  if(numer * denom == 0 && rhs.numer * rhs.denom == 0)
+    return false;
+  else
+    if(numer * denom != 0 && rhs.numer * rhs.denom == 0)
+      {
+        if(numer * denom < 0)
+          return true;
+        else
+          return false;
+      }
+    else
+      if(numer * denom == 0 && rhs.numer * rhs.denom != 0)
+        {
+          if(rhs.numer * rhs.denom < 0)
+            return false;
+          else
+            return true;
+        }
+      else
+        return ((numer * rhs.denom) < (denom * rhs.numer));
+}
@@ -0,0 +1,92 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef LEGACYRATIONAL_H
+#define LEGACYRATIONAL_H
+
+#include <cstdint>
+
+/**
+ * @brief The rational class as it was before it was made trivially copyable, kept as a baseline for benchmarks
+ *
+ * Only the operations the rational benchmarks use are kept. Like the original, every constructor and destructor
+ * updates a global instance counter, every result runs fixSigns() and a recursive reduce(), and the operators are
+ * defined out of line in their own translation unit.
+ */
+class LegacyRational
+{
+public:
+  LegacyRational(const int64_t &numerator = 0)
+    :numer(numerator), denom(1)
+  {
+    activeInstances++;
+    if(numer == 0)
+      denom = 0;
+  }
+
+  LegacyRational(const int64_t &numerator, const int64_t &denominator)
+    :numer(numerator), denom(denominator)
+  {
+    activeInstances++;
+    if(denom != 0)
+      {
+        if(numer != 0)
+          {
+            fixSigns();
+            reduce();
+          }
+        else
+          denom = 0;
+      }
+    else
+      numer = 0;
+  }
+
+  LegacyRational(const LegacyRational &rhs)
+    :numer(rhs.numer), denom(rhs.denom)
+  {
+    activeInstances++;
+  }
+
+  ~LegacyRational();
+
+  const LegacyRational& operator=(const LegacyRational &rhs);
+  const LegacyRational& operator+=(const LegacyRational &rhs);
+  const LegacyRational& operator*=(const LegacyRational &rhs);
+
+  LegacyRational operator+(const LegacyRational &rhs) const;
+  LegacyRational operator*(const LegacyRational &rhs) const;
+
+  bool operator<(const LegacyRational &rhs) const;
+
+  double toDouble() const;
+
+private:
+  static int activeInstances;
+
+  int64_t numer;
+  int64_t denom;
+
+  void fixSigns();
+  void reduce();
+  int64_t gcd(int64_t &x, int64_t &y);
+};
+
+#endif // LEGACYRATIONAL_H
@@ -0,0 +1,67 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+/**
+ * olive-benchmarks measures the CPU hot paths of the editor in isolation (build with -DBUILD_BENCHMARKS=ON).
+ *
+ * Every benchmark uses fixed sizes and fixed random seeds so results are comparable across commits. To compare two
+ * builds, save each run as JSON and diff them with Google Benchmark's tools/compare.py:
+ *
+ *   olive-benchmarks --benchmark_out=before.json --benchmark_out_format=json
+ *   olive-benchmarks --benchmark_out=after.json --benchmark_out_format=json
+ *   compare.py benchmarks before.json after.json
+ *
+ * Decoder benchmarks need a video file to decode, set OLIVE_BENCHMARK_MEDIA to its path to run them.
+ */
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <benchmark/benchmark.h>
+#include <QCoreApplication>
+
+#include "render/colorservice.h"
+
+int main(int argc, char *argv[]) {
+  benchmark::Initialize(&argc, argv);
+
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+
+  QCoreApplication a(argc, argv);
+
+  // Indexes and caches are found in the same place as the editor's
+  QCoreApplication::setOrganizationName("olivevideoeditor.org");
+  QCoreApplication::setOrganizationDomain("olivevideoeditor.org");
+  QCoreApplication::setApplicationName("Olive");
+
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+  av_register_all();
+#endif
+
+  // Load the OCIO config now so it isn't measured by the first color benchmark
+  ColorService::Init();
+
+  benchmark::RunSpecifiedBenchmarks();
+
+  return 0;
+}
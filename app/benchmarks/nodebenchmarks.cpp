@@ -0,0 +1,173 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "node/blend/alphaover/alphaover.h"
+#include "node/block/gap/gap.h"
+#include "node/generator/solid/solid.h"
+#include "node/graph.h"
+#include "node/output/track/track.h"
+
+namespace {
+
+/**
+ * @brief A chain of `depth` AlphaOverBlends, each blending another SolidGenerator over the result of the last
+ *
+ * Returns the last blend, whose output depends on every other node in the graph.
+ */
+AlphaOverBlend* CreateBlendChain(NodeGraph* graph, int depth)
+{
+  SolidGenerator* base = new SolidGenerator();
+  graph->AddNode(base);
+
+  NodeOutput* previous = base->texture_output();
+  AlphaOverBlend* blend = nullptr;
+
+  for (int i=0;i<depth;i++) {
+    SolidGenerator* solid = new SolidGenerator();
+    graph->AddNode(solid);
+
+    blend = new AlphaOverBlend();
+    graph->AddNode(blend);
+
+    NodeParam::ConnectEdge(previous, blend->base_input());
+    NodeParam::ConnectEdge(solid->texture_output(), blend->blend_input());
+
+    previous = blend->texture_output();
+  }
+
+  return blend;
+}
+
+void BM_NodeHash(benchmark::State& state)
+{
+  NodeGraph graph;
+  AlphaOverBlend* output = CreateBlendChain(&graph, static_cast<int>(state.range(0)));
+  QList<Node*> nodes = graph.nodes();
+
+  rational time(1001, 30000);
+
+  for (auto _ : state) {
+    // Discard every node's memoized hash so the whole graph is hashed again
+    state.PauseTiming();
+    foreach (Node* n, nodes) {
+      n->InvalidateCache(RATIONAL_MIN, RATIONAL_MAX);
+    }
+    state.ResumeTiming();
+
+    benchmark::DoNotOptimize(output->CachedHash(output->texture_output(), time));
+  }
+
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+BENCHMARK(BM_NodeHash)->Arg(1)->Arg(8)->Arg(64)->ArgName("depth");
+
+void BM_NodeCachedHash(benchmark::State& state)
+{
+  NodeGraph graph;
+  AlphaOverBlend* output = CreateBlendChain(&graph, static_cast<int>(state.range(0)));
+
+  rational time(1001, 30000);
+
+  // Memoize it once, every iteration afterwards is a lookup
+  output->CachedHash(output->texture_output(), time);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(output->CachedHash(output->texture_output(), time));
+  }
+}
+BENCHMARK(BM_NodeCachedHash)->Arg(1)->Arg(8)->Arg(64)->ArgName("depth");
+
+/**
+ * @brief Fill a track with `count` gaps between 1 and 300 frames long, the same every run
+ */
+TrackOutput* CreateTrack(NodeGraph* graph, int count)
+{
+  TrackOutput* track = new TrackOutput();
+  graph->AddNode(track);
+
+  std::mt19937 generator(2019);
+  std::uniform_int_distribution<int> distribution(1, 300);
+
+  track->BeginEdit();
+
+  for (int i=0;i<count;i++) {
+    GapBlock* gap = new GapBlock();
+    gap->set_length(rational(distribution(generator) * 1001, 30000));
+    track->AppendBlock(gap);
+  }
+
+  track->EndEdit();
+
+  return track;
+}
+
+void RunBlockAtTime(benchmark::State& state, bool random)
+{
+  const int kLookupCount = 1024;
+
+  NodeGraph graph;
+  TrackOutput* track = CreateTrack(&graph, static_cast<int>(state.range(0)));
+
+  // Times spread over the whole track, either in order as during playback or jumping around as when scrubbing
+  double track_length = track->in().toDouble();
+
+  std::vector<rational> times;
+
+  if (random) {
+    std::mt19937 generator(2019);
+    std::uniform_int_distribution<int> distribution(0, static_cast<int>(track_length * 30000 / 1001) - 1);
+
+    for (int i=0;i<kLookupCount;i++) {
+      times.push_back(rational(distribution(generator) * 1001, 30000));
+    }
+  } else {
+    int step = qMax(1, static_cast<int>(track_length * 30000 / 1001) / kLookupCount);
+
+    for (int i=0;i<kLookupCount;i++) {
+      times.push_back(rational(i * step * 1001, 30000));
+    }
+  }
+
+  for (auto _ : state) {
+    for (size_t i=0;i<times.size();i++) {
+      benchmark::DoNotOptimize(track->BlockAtTime(times[i]));
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kLookupCount);
+}
+
+void BM_TrackBlockAtTimeSequential(benchmark::State& state)
+{
+  RunBlockAtTime(state, false);
+}
+BENCHMARK(BM_TrackBlockAtTimeSequential)->Arg(16)->Arg(256)->Arg(4096)->ArgName("blocks");
+
+void BM_TrackBlockAtTimeRandom(benchmark::State& state)
+{
+  RunBlockAtTime(state, true);
+}
+BENCHMARK(BM_TrackBlockAtTimeRandom)->Arg(16)->Arg(256)->Arg(4096)->ArgName("blocks");
+
+}
@@ -0,0 +1,155 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "benchmarkframe.h"
+#include "common/define.h"
+#include "render/pixelconversion.h"
+#include "render/pixelservice.h"
+
+namespace {
+
+/**
+ * @brief Every conversion between two different formats, as (source, destination) pairs
+ */
+void AllFormatPairs(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({"from", "to"});
+
+  for (int i=0;i<olive::PIX_FMT_COUNT;i++) {
+    for (int j=0;j<olive::PIX_FMT_COUNT;j++) {
+      if (i != j) {
+        b->Args({i, j});
+      }
+    }
+  }
+}
+
+void AllFormats(benchmark::internal::Benchmark* b)
+{
+  b->ArgName("format");
+
+  for (int i=0;i<olive::PIX_FMT_COUNT;i++) {
+    b->Arg(i);
+  }
+}
+
+void BM_ConvertPixelFormat(benchmark::State& state)
+{
+  olive::PixelFormat source_format = static_cast<olive::PixelFormat>(state.range(0));
+  olive::PixelFormat dest_format = static_cast<olive::PixelFormat>(state.range(1));
+
+  FramePtr frame = CreateBenchmarkFrame(source_format);
+
+  for (auto _ : state) {
+    FramePtr converted = PixelService::ConvertPixelFormat(frame, dest_format);
+    benchmark::DoNotOptimize(converted->data());
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBenchmarkFrameWidth * kBenchmarkFrameHeight);
+  state.SetBytesProcessed(state.iterations()
+                          * PixelService::GetBufferSize(source_format, kBenchmarkFrameWidth, kBenchmarkFrameHeight));
+}
+BENCHMARK(BM_ConvertPixelFormat)->Apply(AllFormatPairs)->Unit(benchmark::kMillisecond);
+
+void BM_FillAlpha(benchmark::State& state)
+{
+  olive::PixelFormat format = static_cast<olive::PixelFormat>(state.range(0));
+
+  FramePtr frame = CreateBenchmarkFrame(format);
+
+  for (auto _ : state) {
+    PixelService::FillAlpha(frame);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBenchmarkFrameWidth * kBenchmarkFrameHeight);
+  state.SetBytesProcessed(state.iterations()
+                          * PixelService::GetBufferSize(format, kBenchmarkFrameWidth, kBenchmarkFrameHeight));
+}
+BENCHMARK(BM_FillAlpha)->Apply(AllFormats)->Unit(benchmark::kMicrosecond);
+
+const int kBenchmarkChannelCount = kBenchmarkFrameWidth * kBenchmarkFrameHeight * kRGBAChannels;
+
+/**
+ * @brief Convert a frame of `format` to float with `function` (the dispatched kernel or the scalar reference)
+ */
+void RunToFloat(benchmark::State& state,
+                void (*function)(const void*, const olive::PixelFormat&, float*, int))
+{
+  olive::PixelFormat format = static_cast<olive::PixelFormat>(state.range(0));
+
+  FramePtr frame = CreateBenchmarkFrame(format);
+  std::vector<float> destination(static_cast<size_t>(kBenchmarkChannelCount));
+
+  for (auto _ : state) {
+    function(frame->const_data(), format, destination.data(), kBenchmarkChannelCount);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBenchmarkFrameWidth * kBenchmarkFrameHeight);
+}
+
+/**
+ * @brief Convert a frame from float to `format` with `function` (the dispatched kernel or the scalar reference)
+ */
+void RunFromFloat(benchmark::State& state,
+                  void (*function)(const float*, void*, const olive::PixelFormat&, int))
+{
+  olive::PixelFormat format = static_cast<olive::PixelFormat>(state.range(0));
+
+  FramePtr source = CreateBenchmarkFrame(olive::PIX_FMT_RGBA32F);
+  FramePtr destination = CreateBenchmarkFrame(format);
+
+  for (auto _ : state) {
+    function(reinterpret_cast<const float*>(source->const_data()), destination->data(), format, kBenchmarkChannelCount);
+    benchmark::ClobberMemory();
+  }
+
+  state.SetItemsProcessed(state.iterations() * kBenchmarkFrameWidth * kBenchmarkFrameHeight);
+}
+
+void BM_ToFloat(benchmark::State& state)
+{
+  RunToFloat(state, olive::pixel::ToFloat);
+}
+BENCHMARK(BM_ToFloat)->Apply(AllFormats)->Unit(benchmark::kMillisecond);
+
+void BM_ToFloatReference(benchmark::State& state)
+{
+  RunToFloat(state, olive::pixel::reference::ToFloat);
+}
+BENCHMARK(BM_ToFloatReference)->Apply(AllFormats)->Unit(benchmark::kMillisecond);
+
+void BM_FromFloat(benchmark::State& state)
+{
+  RunFromFloat(state, olive::pixel::FromFloat);
+}
+BENCHMARK(BM_FromFloat)->Apply(AllFormats)->Unit(benchmark::kMillisecond);
+
+void BM_FromFloatReference(benchmark::State& state)
+{
+  RunFromFloat(state, olive::pixel::reference::FromFloat);
+}
+BENCHMARK(BM_FromFloatReference)->Apply(AllFormats)->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,189 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include "common/rational.h"
+#include "legacyrational.h"
+
+namespace {
+
+const int kRationalCount = 1024;
+
+/*
+ * Every benchmark is instantiated for rational and for LegacyRational, the implementation before it was made
+ * trivially copyable, so the difference shows up in every run.
+ */
+
+/**
+ * @brief Times as they appear in the graph: frame numbers in common timebases, the same every run
+ */
+template <typename Rational>
+std::vector<Rational> CreateTimes()
+{
+  const int kTimebaseCount = 7;
+  const int kTimebases[kTimebaseCount] = {24, 25, 30, 48, 50, 60, 48000};
+
+  std::mt19937 generator(2019);
+  std::uniform_int_distribution<int> frame_distribution(0, 100000);
+  std::uniform_int_distribution<int> timebase_distribution(0, kTimebaseCount - 1);
+
+  std::vector<Rational> times;
+  times.reserve(static_cast<size_t>(kRationalCount));
+
+  for (int i=0;i<kRationalCount;i++) {
+    int timebase = kTimebases[timebase_distribution(generator)];
+
+    // NTSC rates are stored as 1001/30000 etc.
+    if (timebase == 30 || timebase == 60) {
+      times.push_back(Rational(frame_distribution(generator) * 1001, timebase * 1000));
+    } else {
+      times.push_back(Rational(frame_distribution(generator), timebase));
+    }
+  }
+
+  return times;
+}
+
+template <typename Rational>
+void BM_RationalConstruct(benchmark::State& state)
+{
+  std::mt19937 generator(2019);
+  std::uniform_int_distribution<int> distribution(1, 100000);
+
+  std::vector<int> numerators(static_cast<size_t>(kRationalCount));
+
+  for (int i=0;i<kRationalCount;i++) {
+    numerators[static_cast<size_t>(i)] = distribution(generator);
+  }
+
+  for (auto _ : state) {
+    for (int i=0;i<kRationalCount;i++) {
+      Rational r(numerators[static_cast<size_t>(i)], 30000);
+      benchmark::DoNotOptimize(r);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kRationalCount);
+}
+BENCHMARK_TEMPLATE(BM_RationalConstruct, rational);
+BENCHMARK_TEMPLATE(BM_RationalConstruct, LegacyRational);
+
+template <typename Rational>
+void BM_RationalAdd(benchmark::State& state)
+{
+  std::vector<Rational> times = CreateTimes<Rational>();
+
+  for (auto _ : state) {
+    for (size_t i=1;i<times.size();i++) {
+      Rational r = times[i - 1] + times[i];
+      benchmark::DoNotOptimize(r);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * (kRationalCount - 1));
+}
+BENCHMARK_TEMPLATE(BM_RationalAdd, rational);
+BENCHMARK_TEMPLATE(BM_RationalAdd, LegacyRational);
+
+template <typename Rational>
+void BM_RationalAddSameTimebase(benchmark::State& state)
+{
+  // Stepping through a sequence frame by frame
+  Rational frame_length(1001, 30000);
+
+  for (auto _ : state) {
+    Rational time;
+
+    for (int i=0;i<kRationalCount;i++) {
+      time += frame_length;
+    }
+
+    benchmark::DoNotOptimize(time);
+  }
+
+  state.SetItemsProcessed(state.iterations() * kRationalCount);
+}
+BENCHMARK_TEMPLATE(BM_RationalAddSameTimebase, rational);
+BENCHMARK_TEMPLATE(BM_RationalAddSameTimebase, LegacyRational);
+
+template <typename Rational>
+void BM_RationalMultiply(benchmark::State& state)
+{
+  std::vector<Rational> times = CreateTimes<Rational>();
+  Rational speed(3, 2);
+
+  for (auto _ : state) {
+    for (size_t i=0;i<times.size();i++) {
+      Rational r = times[i] * speed;
+      benchmark::DoNotOptimize(r);
+    }
+  }
+
+  state.SetItemsProcessed(state.iterations() * kRationalCount);
+}
+BENCHMARK_TEMPLATE(BM_RationalMultiply, rational);
+BENCHMARK_TEMPLATE(BM_RationalMultiply, LegacyRational);
+
+template <typename Rational>
+void BM_RationalCompare(benchmark::State& state)
+{
+  std::vector<Rational> times = CreateTimes<Rational>();
+
+  for (auto _ : state) {
+    int less = 0;
+
+    for (size_t i=1;i<times.size();i++) {
+      if (times[i - 1] < times[i]) {
+        less++;
+      }
+    }
+
+    benchmark::DoNotOptimize(less);
+  }
+
+  state.SetItemsProcessed(state.iterations() * (kRationalCount - 1));
+}
+BENCHMARK_TEMPLATE(BM_RationalCompare, rational);
+BENCHMARK_TEMPLATE(BM_RationalCompare, LegacyRational);
+
+template <typename Rational>
+void BM_RationalToDouble(benchmark::State& state)
+{
+  std::vector<Rational> times = CreateTimes<Rational>();
+
+  for (auto _ : state) {
+    double sum = 0.0;
+
+    for (size_t i=0;i<times.size();i++) {
+      sum += times[i].toDouble();
+    }
+
+    benchmark::DoNotOptimize(sum);
+  }
+
+  state.SetItemsProcessed(state.iterations() * kRationalCount);
+}
+BENCHMARK_TEMPLATE(BM_RationalToDouble, rational);
+BENCHMARK_TEMPLATE(BM_RationalToDouble, LegacyRational);
+
+}
@@ -1,5 +1,7 @@
 #include "debug.h"
 
+#include "ringlog.h"
+
 
 void DebugHandler(QtMsgType type, const QMessageLogContext &context, const QString &msg)
 {
@@ -25,4 +27,9 @@ void DebugHandler(QtMsgType type, const QMessageLogContext &context, const QStri
   }
 
   fprintf(stderr, "[%s] %s (%s:%u)\n", msg_type, localMsg.constData(), context.function, context.line);
+
+  // Keep what the hot paths logged leading up to this, we won't get to Stop()
+  if (type == QtFatalMsg && !olive::ring_log.dump_filename().isEmpty()) {
+    olive::ring_log.Dump(olive::ring_log.dump_filename());
+  }
 }
@@ -0,0 +1,169 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "fasthash.h"
+
+#include <cstring>
+#include <QtEndian>
+
+const quint64 kC1 = Q_UINT64_C(0x87c37b91114253d5);
+const quint64 kC2 = Q_UINT64_C(0x4cf5ad432745937f);
+
+inline quint64 RotateLeft(quint64 x, int r)
+{
+  return (x << r) | (x >> (64 - r));
+}
+
+inline quint64 FinalMix(quint64 k)
+{
+  k ^= k >> 33;
+  k *= Q_UINT64_C(0xff51afd7ed558ccd);
+  k ^= k >> 33;
+  k *= Q_UINT64_C(0xc4ceb3fe1a85ec53);
+  k ^= k >> 33;
+
+  return k;
+}
+
+inline quint64 MixK1(quint64 k1)
+{
+  k1 *= kC1;
+  k1 = RotateLeft(k1, 31);
+  k1 *= kC2;
+
+  return k1;
+}
+
+inline quint64 MixK2(quint64 k2)
+{
+  k2 *= kC2;
+  k2 = RotateLeft(k2, 33);
+  k2 *= kC1;
+
+  return k2;
+}
+
+FastHash::FastHash() :
+  h1_(0),
+  h2_(0),
+  tail_length_(0),
+  total_length_(0)
+{
+}
+
+void FastHash::addData(const char *data, int length)
+{
+  const uchar* bytes = reinterpret_cast<const uchar*>(data);
+
+  total_length_ += static_cast<quint64>(length);
+
+  // Complete any partial block left over from the last call
+  if (tail_length_ > 0) {
+    int copy = qMin(kBlockSize - tail_length_, length);
+
+    memcpy(tail_ + tail_length_, bytes, static_cast<size_t>(copy));
+    tail_length_ += copy;
+    bytes += copy;
+    length -= copy;
+
+    if (tail_length_ < kBlockSize) {
+      return;
+    }
+
+    ProcessBlock(tail_);
+    tail_length_ = 0;
+  }
+
+  while (length >= kBlockSize) {
+    ProcessBlock(bytes);
+    bytes += kBlockSize;
+    length -= kBlockSize;
+  }
+
+  // Keep the remainder for the next call or result()
+  memcpy(tail_, bytes, static_cast<size_t>(length));
+  tail_length_ = length;
+}
+
+void FastHash::addData(const QByteArray &data)
+{
+  addData(data.constData(), data.size());
+}
+
+QByteArray FastHash::result() const
+{
+  quint64 h1 = h1_;
+  quint64 h2 = h2_;
+
+  quint64 k1 = 0;
+  quint64 k2 = 0;
+
+  for (int i=tail_length_-1;i>=8;i--) {
+    k2 ^= static_cast<quint64>(tail_[i]) << ((i - 8) * 8);
+  }
+
+  if (tail_length_ > 8) {
+    h2 ^= MixK2(k2);
+  }
+
+  for (int i=qMin(tail_length_, 8)-1;i>=0;i--) {
+    k1 ^= static_cast<quint64>(tail_[i]) << (i * 8);
+  }
+
+  if (tail_length_ > 0) {
+    h1 ^= MixK1(k1);
+  }
+
+  h1 ^= total_length_;
+  h2 ^= total_length_;
+
+  h1 += h2;
+  h2 += h1;
+
+  h1 = FinalMix(h1);
+  h2 = FinalMix(h2);
+
+  h1 += h2;
+  h2 += h1;
+
+  QByteArray digest;
+  digest.resize(kBlockSize);
+
+  qToLittleEndian(h1, digest.data());
+  qToLittleEndian(h2, digest.data() + sizeof(quint64));
+
+  return digest;
+}
+
+void FastHash::ProcessBlock(const uchar *block)
+{
+  quint64 k1 = qFromLittleEndian<quint64>(block);
+  quint64 k2 = qFromLittleEndian<quint64>(block + sizeof(quint64));
+
+  h1_ ^= MixK1(k1);
+  h1_ = RotateLeft(h1_, 27);
+  h1_ += h2_;
+  h1_ = h1_ * 5 + 0x52dce729;
+
+  h2_ ^= MixK2(k2);
+  h2_ = RotateLeft(h2_, 31);
+  h2_ += h1_;
+  h2_ = h2_ * 5 + 0x38495ab5;
+}
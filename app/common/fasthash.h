@@ -0,0 +1,62 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FASTHASH_H
+#define FASTHASH_H
+
+#include <QByteArray>
+#include <QtGlobal>
+
+/**
+ * @brief A fast, non-cryptographic 128-bit hash (MurmurHash3 x64 128)
+ *
+ * Used in place of QCryptographicHash where hashes only need to be unique rather than secure, e.g. for identifying
+ * rendered frames. The interface mirrors QCryptographicHash's so that data can be added incrementally.
+ */
+class FastHash
+{
+public:
+  FastHash();
+
+  void addData(const char* data, int length);
+
+  void addData(const QByteArray& data);
+
+  /**
+   * @brief Return the 16-byte hash of all the data added so far
+   */
+  QByteArray result() const;
+
+private:
+  static const int kBlockSize = 16;
+
+  void ProcessBlock(const uchar* block);
+
+  quint64 h1_;
+  quint64 h2_;
+
+  uchar tail_[kBlockSize];
+  int tail_length_;
+
+  quint64 total_length_;
+
+};
+
+#endif // FASTHASH_H
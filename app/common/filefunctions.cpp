@@ -23,8 +23,21 @@
 #include <QCryptographicHash>
 #include <QDateTime>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QStandardPaths>
+#include <QStorageInfo>
+
+/**
+ * @brief Render cache location set with SetRenderCacheLocation() or SetSharedRenderCacheLocation(), empty for the
+ * default location
+ */
+static QString render_cache_location;
+
+/**
+ * @brief Whether render_cache_location is shared with other machines
+ */
+static bool render_cache_shared = false;
 
 QString GetUniqueFileIdentifier(const QString &filename)
 {
@@ -45,6 +58,65 @@ QString GetUniqueFileIdentifier(const QString &filename)
   return QString(result.toHex());
 }
 
+bool ReplaceFile(const QString &partial_filename, const QString &filename)
+{
+  if (!QFileInfo::exists(filename)) {
+    return QFile::rename(partial_filename, filename);
+  }
+
+  // QFile::rename() won't overwrite, so the old file is moved aside rather than deleted before the new one is in place
+  QString backup_filename = QStringLiteral("%1.backup").arg(filename);
+
+  QFile::remove(backup_filename);
+
+  if (!QFile::rename(filename, backup_filename)) {
+    return false;
+  }
+
+  if (!QFile::rename(partial_filename, filename)) {
+    QFile::rename(backup_filename, filename);
+    return false;
+  }
+
+  QFile::remove(backup_filename);
+
+  return true;
+}
+
+bool IsNetworkFileSystem(const QByteArray &type)
+{
+  static const char* kNetworkFileSystems[] = {
+    "nfs", "nfs4", "cifs", "smbfs", "smb2", "afpfs", "webdav", "9p", "fuse.sshfs"
+  };
+
+  for (const char* network_type : kNetworkFileSystems) {
+    if (type == network_type) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+bool IsRemoteFile(const QString &filename)
+{
+  // URLs other than local files (http, https, etc.)
+  int scheme_end = filename.indexOf(QStringLiteral("://"));
+
+  if (scheme_end > 1 && !filename.startsWith(QStringLiteral("file:"))) {
+    return true;
+  }
+
+  // UNC paths (\\server\share) are always on another machine
+  if (filename.startsWith(QStringLiteral("\\\\")) || filename.startsWith(QStringLiteral("//"))) {
+    return true;
+  }
+
+  QStorageInfo storage(QFileInfo(filename).absolutePath());
+
+  return storage.isValid() && IsNetworkFileSystem(storage.fileSystemType());
+}
+
 QString GetMediaIndexLocation()
 {
   QDir local_appdata_dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
@@ -73,3 +145,74 @@ QString GetMediaCacheLocation()
 
   return media_cache_dir.absolutePath();
 }
+
+QString GetMediaMirrorLocation()
+{
+  QDir local_appdata_dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+
+  QDir media_mirror_dir = local_appdata_dir.filePath("mediamirror");
+
+  // Attempt to ensure this folder exists
+  media_mirror_dir.mkpath(".");
+
+  return media_mirror_dir.absolutePath();
+}
+
+QString GetRenderCacheLocation()
+{
+  if (!render_cache_location.isEmpty()) {
+    QDir(render_cache_location).mkpath(".");
+
+    return render_cache_location;
+  }
+
+  QDir local_appdata_dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+
+  QDir render_cache_dir = local_appdata_dir.filePath("rendercache");
+
+  // Attempt to ensure this folder exists
+  render_cache_dir.mkpath(".");
+
+  return render_cache_dir.absolutePath();
+}
+
+void SetRenderCacheLocation(const QString &path)
+{
+  render_cache_location = path.isEmpty() ? QString() : QDir(path).absolutePath();
+  render_cache_shared = false;
+}
+
+void SetSharedRenderCacheLocation(const QString &path)
+{
+  render_cache_location = path.isEmpty() ? QString() : QDir(path).absolutePath();
+  render_cache_shared = !render_cache_location.isEmpty();
+}
+
+bool HasSharedRenderCache()
+{
+  return render_cache_shared;
+}
+
+QString GetColorCacheLocation()
+{
+  QDir local_appdata_dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+
+  QDir color_cache_dir = local_appdata_dir.filePath("colorcache");
+
+  // Attempt to ensure this folder exists
+  color_cache_dir.mkpath(".");
+
+  return color_cache_dir.absolutePath();
+}
+
+QString GetAutosaveLocation()
+{
+  QDir local_appdata_dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+
+  QDir autosave_dir = local_appdata_dir.filePath("autosave");
+
+  // Attempt to ensure this folder exists
+  autosave_dir.mkpath(".");
+
+  return autosave_dir.absolutePath();
+}
@@ -21,14 +21,72 @@
 #ifndef FILEFUNCTIONS_H
 #define FILEFUNCTIONS_H
 
+#include <QByteArray>
 #include <QString>
 
 QString GetUniqueFileIdentifier(const QString& filename);
 
+/**
+ * @brief Returns TRUE if `type` (e.g. from QStorageInfo::fileSystemType()) is accessed over a network
+ */
+bool IsNetworkFileSystem(const QByteArray& type);
+
+/**
+ * @brief Returns TRUE if `filename` is a URL or a file on a network file system (NFS, SMB, etc.)
+ *
+ * Reads from these have network latency, so they're worth caching and reading ahead of.
+ */
+bool IsRemoteFile(const QString& filename);
+
+/**
+ * @brief Move a completely written `partial_filename` over `filename`
+ *
+ * The existing file is moved aside until the new one is in place and restored if that fails, so `filename` is never
+ * lost. Returns FALSE if it couldn't be replaced, in which case `partial_filename` is left where it is.
+ */
+bool ReplaceFile(const QString& partial_filename, const QString& filename);
+
 QString GetMediaIndexLocation();
 
 QString GetMediaIndexFilename(const QString& filename);
 
 QString GetMediaCacheLocation();
 
+/**
+ * @brief Directory that local copies of media on network storage are kept in (see MediaMirror)
+ */
+QString GetMediaMirrorLocation();
+
+QString GetRenderCacheLocation();
+
+/**
+ * @brief Use a different render cache directory on this machine (e.g. an empty one to render everything from scratch)
+ *
+ * Must be set before anything is rendered. An empty path restores the default location.
+ */
+void SetRenderCacheLocation(const QString& path);
+
+/**
+ * @brief Use a render cache directory shared with other machines instead of the local one
+ *
+ * Frames are named by their content hash, so any machine rendering the same frame with the same parameters produces
+ * the same file, and frames rendered by any of them are usable by all of them. Must be set before anything is
+ * rendered. An empty path restores the local cache.
+ */
+void SetSharedRenderCacheLocation(const QString& path);
+
+/**
+ * @brief Returns TRUE if the render cache is shared (see SetSharedRenderCacheLocation())
+ *
+ * Other machines may add frames to a shared cache at any time, so it can't be indexed just once.
+ */
+bool HasSharedRenderCache();
+
+QString GetColorCacheLocation();
+
+/**
+ * @brief Directory that project autosaves are written to (see ProjectAutosave)
+ */
+QString GetAutosaveLocation();
+
 #endif // FILEFUNCTIONS_H
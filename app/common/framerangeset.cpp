@@ -0,0 +1,145 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "framerangeset.h"
+
+#include <QtGlobal>
+
+void FrameRangeSet::Insert(int64_t start, int64_t end)
+{
+  if (end < start) {
+    return;
+  }
+
+  QMap<int64_t, int64_t>::iterator it = ranges_.upperBound(start);
+
+  // Merge with the range before if it overlaps or ends right before this one
+  if (it != ranges_.begin()) {
+    QMap<int64_t, int64_t>::iterator prev = it - 1;
+
+    if (prev.value() >= start - 1) {
+      start = prev.key();
+      end = qMax(end, prev.value());
+      it = ranges_.erase(prev);
+    }
+  }
+
+  // And with any after that it overlaps or touches
+  while (it != ranges_.end() && it.key() <= end + 1) {
+    end = qMax(end, it.value());
+    it = ranges_.erase(it);
+  }
+
+  ranges_.insert(start, end);
+}
+
+void FrameRangeSet::Remove(int64_t start, int64_t end)
+{
+  if (end < start) {
+    return;
+  }
+
+  QMap<int64_t, int64_t>::iterator it = ranges_.upperBound(start);
+
+  // The range before may start before `start` and end inside or after it
+  if (it != ranges_.begin()) {
+    QMap<int64_t, int64_t>::iterator prev = it - 1;
+    int64_t prev_end = prev.value();
+
+    if (prev_end >= start) {
+      if (prev.key() < start) {
+        prev.value() = start - 1;
+      } else {
+        ranges_.erase(prev);
+      }
+
+      if (prev_end > end) {
+        ranges_.insert(end + 1, prev_end);
+        return;
+      }
+    }
+  }
+
+  while (it != ranges_.end() && it.key() <= end) {
+    int64_t it_end = it.value();
+
+    it = ranges_.erase(it);
+
+    if (it_end > end) {
+      ranges_.insert(end + 1, it_end);
+      break;
+    }
+  }
+}
+
+bool FrameRangeSet::Contains(int64_t frame) const
+{
+  QMap<int64_t, int64_t>::const_iterator it = ranges_.upperBound(frame);
+
+  if (it == ranges_.constBegin()) {
+    return false;
+  }
+
+  --it;
+
+  return it.value() >= frame;
+}
+
+int64_t FrameRangeSet::NextOutside(int64_t frame) const
+{
+  QMap<int64_t, int64_t>::const_iterator it = ranges_.upperBound(frame);
+
+  if (it == ranges_.constBegin()) {
+    return frame;
+  }
+
+  --it;
+
+  // Ranges never touch, so the frame after one is never in the next
+  return (it.value() >= frame) ? it.value() + 1 : frame;
+}
+
+QVector<FrameRangeSet::Range> FrameRangeSet::Ranges(int64_t start, int64_t end) const
+{
+  QVector<Range> ranges;
+
+  QMap<int64_t, int64_t>::const_iterator it = ranges_.upperBound(start);
+
+  // Start from the range that contains `start`, if any
+  if (it != ranges_.constBegin() && (it - 1).value() >= start) {
+    --it;
+  }
+
+  for (;it!=ranges_.constEnd() && it.key()<=end;++it) {
+    ranges.append(Range(qMax(it.key(), start), qMin(it.value(), end)));
+  }
+
+  return ranges;
+}
+
+bool FrameRangeSet::IsEmpty() const
+{
+  return ranges_.isEmpty();
+}
+
+void FrameRangeSet::Clear()
+{
+  ranges_.clear();
+}
@@ -0,0 +1,79 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FRAMERANGESET_H
+#define FRAMERANGESET_H
+
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <stdint.h>
+
+/**
+ * @brief A set of frames stored as sorted, disjoint ranges
+ *
+ * Each range is kept by its first frame in a map, so looking up a frame or the end of the range it's in takes O(log n)
+ * in the number of ranges however many frames they cover. Overlapping and adjacent ranges are merged as they're
+ * inserted, so a contiguous run of frames is always a single range.
+ *
+ * Ranges are inclusive of their first and last frames.
+ */
+class FrameRangeSet
+{
+public:
+  using Range = QPair<int64_t, int64_t>;
+
+  /**
+   * @brief Add every frame from `start` to `end`
+   */
+  void Insert(int64_t start, int64_t end);
+
+  /**
+   * @brief Remove every frame from `start` to `end`, splitting any range that only partly overlaps
+   */
+  void Remove(int64_t start, int64_t end);
+
+  bool Contains(int64_t frame) const;
+
+  /**
+   * @brief Return the first frame at or after `frame` that isn't in the set
+   *
+   * Lets a caller walk the gaps between ranges without visiting the frames inside them.
+   */
+  int64_t NextOutside(int64_t frame) const;
+
+  /**
+   * @brief Return the ranges that overlap `start` to `end`, clipped to it
+   */
+  QVector<Range> Ranges(int64_t start, int64_t end) const;
+
+  bool IsEmpty() const;
+
+  void Clear();
+
+private:
+  /**
+   * @brief The last frame of each range by its first
+   */
+  QMap<int64_t, int64_t> ranges_;
+
+};
+
+#endif // FRAMERANGESET_H
@@ -0,0 +1,180 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "memorystats.h"
+
+#include <QCoreApplication>
+
+MemoryStats olive::memory_stats;
+
+/**
+ * @brief Raise a high-water mark to `value` if it's higher
+ */
+static void RaisePeak(QAtomicInteger<qint64>* peak, qint64 value)
+{
+  qint64 current = peak->loadAcquire();
+
+  while (value > current && !peak->testAndSetOrdered(current, value, current)) {
+  }
+}
+
+MemoryStats::MemoryStats() :
+  enabled_(0)
+{
+  for (int i=0;i<kSubsystemCount;i++) {
+    counters_[i].bytes.storeRelease(0);
+    counters_[i].objects.storeRelease(0);
+    counters_[i].peak_bytes.storeRelease(0);
+    counters_[i].peak_objects.storeRelease(0);
+    counters_[i].allocated_bytes.storeRelease(0);
+    counters_[i].allocations.storeRelease(0);
+  }
+}
+
+void MemoryStats::Enable()
+{
+  enabled_.ref();
+}
+
+void MemoryStats::Disable()
+{
+  enabled_.deref();
+}
+
+bool MemoryStats::IsEnabled() const
+{
+  return enabled_.load() > 0;
+}
+
+MemoryStats::Snapshot MemoryStats::GetSnapshot() const
+{
+  Snapshot s;
+
+  for (int i=0;i<kSubsystemCount;i++) {
+    s.subsystems[i].bytes = counters_[i].bytes.loadAcquire();
+    s.subsystems[i].objects = counters_[i].objects.loadAcquire();
+    s.subsystems[i].peak_bytes = counters_[i].peak_bytes.loadAcquire();
+    s.subsystems[i].peak_objects = counters_[i].peak_objects.loadAcquire();
+    s.subsystems[i].allocated_bytes = counters_[i].allocated_bytes.loadAcquire();
+    s.subsystems[i].allocations = counters_[i].allocations.loadAcquire();
+  }
+
+  return s;
+}
+
+void MemoryStats::ResetPeaks()
+{
+  for (int i=0;i<kSubsystemCount;i++) {
+    counters_[i].peak_bytes.storeRelease(counters_[i].bytes.loadAcquire());
+    counters_[i].peak_objects.storeRelease(counters_[i].objects.loadAcquire());
+  }
+}
+
+QString MemoryStats::SubsystemName(MemoryStats::Subsystem s)
+{
+  switch (s) {
+  case kFrames:
+    return QCoreApplication::translate("MemoryStats", "Frames");
+  case kTextures:
+    return QCoreApplication::translate("MemoryStats", "Textures (VRAM)");
+  case kKeyframes:
+    return QCoreApplication::translate("MemoryStats", "Keyframes");
+  case kFrameIndexes:
+    return QCoreApplication::translate("MemoryStats", "Frame Indexes");
+  case kUndo:
+    return QCoreApplication::translate("MemoryStats", "Undo History");
+  case kSubsystemCount:
+    break;
+  }
+
+  return QString();
+}
+
+void MemoryStats::Adjust(MemoryStats::Subsystem s, qint64 bytes, qint64 objects)
+{
+  AtomicCounters& c = counters_[s];
+
+  if (bytes != 0) {
+    RaisePeak(&c.peak_bytes, c.bytes.fetchAndAddRelaxed(bytes) + bytes);
+
+    if (bytes > 0) {
+      c.allocated_bytes.fetchAndAddRelaxed(bytes);
+    }
+  }
+
+  if (objects != 0) {
+    RaisePeak(&c.peak_objects, c.objects.fetchAndAddRelaxed(objects) + objects);
+
+    if (objects > 0) {
+      c.allocations.fetchAndAddRelaxed(objects);
+    }
+  }
+}
+
+MemoryTracker::MemoryTracker(MemoryStats::Subsystem subsystem) :
+  subsystem_(subsystem),
+  counted_(olive::memory_stats.IsEnabled()),
+  bytes_(0),
+  objects_(1)
+{
+  if (counted_) {
+    olive::memory_stats.Adjust(subsystem_, 0, objects_);
+  }
+}
+
+MemoryTracker::MemoryTracker(const MemoryTracker &other) :
+  MemoryTracker(other.subsystem_)
+{
+  Set(other.bytes_, other.objects_);
+}
+
+MemoryTracker &MemoryTracker::operator=(const MemoryTracker &other)
+{
+  // Each object keeps its own tracker, it just takes on the other's size
+  Set(other.bytes_, other.objects_);
+
+  return *this;
+}
+
+MemoryTracker::~MemoryTracker()
+{
+  if (counted_) {
+    olive::memory_stats.Adjust(subsystem_, -bytes_, -objects_);
+  }
+}
+
+void MemoryTracker::SetBytes(qint64 bytes)
+{
+  Set(bytes, objects_);
+}
+
+void MemoryTracker::Set(qint64 bytes, qint64 objects)
+{
+  if (counted_) {
+    olive::memory_stats.Adjust(subsystem_, bytes - bytes_, objects - objects_);
+  } else if (olive::memory_stats.IsEnabled()) {
+    // Start counting now, all of it since none of it has been counted yet
+    counted_ = true;
+    olive::memory_stats.Adjust(subsystem_, bytes, objects);
+  }
+
+  bytes_ = bytes;
+  objects_ = objects;
+}
@@ -0,0 +1,161 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MEMORYSTATS_H
+#define MEMORYSTATS_H
+
+#include <QAtomicInteger>
+#include <QString>
+
+/**
+ * @brief Live bytes and object counts per subsystem, for finding leaks and bloat without a heap profiler
+ *
+ * Accounting is opt-in (see Enable()) since it costs an atomic per tracked object, so it's off unless Olive is started
+ * with `--memory-stats` or a MemoryView is shown. Objects are counted by a MemoryTracker member, which only starts
+ * counting its object once it's created or changes size while accounting is enabled, so the totals stay consistent if
+ * it's enabled partway through (objects that were already alive and never change are just never counted).
+ *
+ * Like RenderStats, every value is an atomic so nothing here takes a lock.
+ */
+class MemoryStats
+{
+public:
+  enum Subsystem {
+    // Decoded video and audio buffers (Frame::allocate(), wrapped decoder memory counts as objects only)
+    kFrames,
+
+    // GPU textures (RenderTexture), in bytes of VRAM
+    kTextures,
+
+    // Keyframes, whose values are boxed in QVariants
+    kKeyframes,
+
+    // Memory-mapped frame indexes (FrameIndex)
+    kFrameIndexes,
+
+    // Commands kept in the undo history (UndoStack::memory_usage())
+    kUndo,
+
+    kSubsystemCount
+  };
+
+  struct Counters {
+    qint64 bytes;
+    qint64 objects;
+
+    /// High-water marks since the last ResetPeaks()
+    qint64 peak_bytes;
+    qint64 peak_objects;
+
+    /// Only ever go up, the difference between two snapshots gives the allocation rate
+    qint64 allocated_bytes;
+    qint64 allocations;
+  };
+
+  struct Snapshot {
+    Counters subsystems[kSubsystemCount];
+  };
+
+  MemoryStats();
+
+  /**
+   * @brief Start counting objects created from now on, until a matching call to Disable()
+   */
+  void Enable();
+
+  void Disable();
+
+  bool IsEnabled() const;
+
+  Snapshot GetSnapshot() const;
+
+  /**
+   * @brief Set the high-water marks back to the current values
+   */
+  void ResetPeaks();
+
+  static QString SubsystemName(Subsystem s);
+
+private:
+  friend class MemoryTracker;
+
+  /**
+   * @brief Add to a subsystem's totals, negative to remove
+   */
+  void Adjust(Subsystem s, qint64 bytes, qint64 objects);
+
+  struct AtomicCounters {
+    QAtomicInteger<qint64> bytes;
+    QAtomicInteger<qint64> objects;
+    QAtomicInteger<qint64> peak_bytes;
+    QAtomicInteger<qint64> peak_objects;
+    QAtomicInteger<qint64> allocated_bytes;
+    QAtomicInteger<qint64> allocations;
+  };
+
+  QAtomicInt enabled_;
+
+  AtomicCounters counters_[kSubsystemCount];
+
+};
+
+/**
+ * @brief Counts the object it's a member of in olive::memory_stats
+ *
+ * Counts as one object of its subsystem from when it's constructed or its size is set while accounting is enabled,
+ * until it's destroyed. Copies are counted as objects of their own with the same size.
+ */
+class MemoryTracker
+{
+public:
+  MemoryTracker(MemoryStats::Subsystem subsystem);
+
+  MemoryTracker(const MemoryTracker& other);
+
+  MemoryTracker& operator=(const MemoryTracker& other);
+
+  ~MemoryTracker();
+
+  /**
+   * @brief Set how many bytes the object is using
+   */
+  void SetBytes(qint64 bytes);
+
+  /**
+   * @brief Set the bytes and number of objects for something that holds many (e.g. the commands in an UndoStack)
+   */
+  void Set(qint64 bytes, qint64 objects);
+
+private:
+  MemoryStats::Subsystem subsystem_;
+
+  bool counted_;
+
+  qint64 bytes_;
+
+  qint64 objects_;
+
+};
+
+namespace olive {
+extern MemoryStats memory_stats;
+}
+
+#endif // MEMORYSTATS_H
@@ -3,17 +3,15 @@
 
 #include "rational.h"
 
-int rational::activeInstances = 0;
+#include <cmath>
+#include <limits>
 
 rational::rational(const AVRational &r) :
   numer(r.num),
-  denom(r.den)
+  denom(r.den),
+  dbl(0.0)
 {
-}
-
-rational::~rational()
-{
-  activeInstances--;
+  normalize();
 }
 
 //Function: print number to cout
@@ -23,65 +21,153 @@ void rational::print(ostream &out) const
   out << this->numer << "/" << this->denom;
 }
 
-//Function: ensures denom >= 0
+//Function: create from a numerator and denominator already in lowest form
 
-void rational::fixSigns()
+rational rational::fromNormalized(const intType &numerator, const intType &denominator)
 {
-  if(denom < 0)
+  rational r;
+
+  if(numerator != 0 && denominator != 0)
     {
-      denom = -denom;
-      numer = -numer;
+      r.numer = numerator;
+      r.denom = denominator;
+      r.dbl = static_cast<double>(numerator) / static_cast<double>(denominator);
     }
+
+  return r;
+}
+
+//Function: nearest rational to `value` with denominator `denominator`
+
+rational rational::approximate(double value, intType denominator)
+{
+  if(denominator <= 0)
+    denominator = 1;
+
+  // Use a coarser denominator until the numerator fits
+  const double limit = static_cast<double>(std::numeric_limits<intType>::max());
+
+  while(denominator > 1 && std::fabs(value * static_cast<double>(denominator)) >= limit)
+    denominator /= 2;
+
+  double scaled = value * static_cast<double>(denominator);
+
+  if(std::fabs(scaled) >= limit)
+    return rational();
+
+  return rational(static_cast<intType>(std::llround(scaled)), denominator);
+}
+
+//Function: ensures denom >= 0, lowest form and updates dbl
+
+void rational::normalize()
+{
   if(numer == intType(0) || denom == intType(0))
     {
       numer = intType(0);
       denom = intType(0);
+      dbl = 0.0;
+      return;
     }
-}
-
-//Function: ensures lowest form
 
-void rational::reduce()
-{
-  intType d = 1;
-
-  if(denom != 0 && numer !=0)
-    d = gcd(numer, denom);
+  if(denom < 0)
+    {
+      denom = -denom;
+      numer = -numer;
+    }
 
-  if(d > 1)
+  if(denom != 1)
     {
-      numer /= d;
-      denom /= d;
+      intType d = gcd(numer, denom);
+
+      if(d > 1)
+        {
+          numer /= d;
+          denom /= d;
+        }
     }
+
+  dbl = static_cast<double>(numer) / static_cast<double>(denom);
 }
 
 //Function: finds greatest common denominator
 
-intType rational::gcd(intType &x, intType &y)
+intType rational::gcd(intType x, intType y)
 {
-  if(y == 0)
-    return x;
-  else
+  if(x < 0)
+    x = -x;
+  if(y < 0)
+    y = -y;
+
+  while(y != 0)
     {
       intType tmp = x % y;
+      x = y;
+      y = tmp;
+    }
 
-      return gcd(y, tmp);
+  return x;
+}
+
+bool rational::checkedMultiply(const intType &x, const intType &y, intType *result)
+{
+  const intType max = std::numeric_limits<intType>::max();
+  const intType min = std::numeric_limits<intType>::min();
+
+  if(x > 0)
+    {
+      if(y > 0 ? x > max / y : y < min / x)
+        return false;
+    }
+  else if(x < 0)
+    {
+      if(y > 0 ? x < min / y : (y != 0 && x < max / y))
+        return false;
     }
+
+  *result = x * y;
+  return true;
 }
 
-//Function: convert to double
+bool rational::checkedAdd(const intType &x, const intType &y, intType *result)
+{
+  if((y > 0 && x > std::numeric_limits<intType>::max() - y)
+     || (y < 0 && x < std::numeric_limits<intType>::min() - y))
+    return false;
+
+  *result = x + y;
+  return true;
+}
 
-double rational::toDouble() const
+int rational::compare(const rational &rhs) const
 {
-  if(denom != 0)
-    return static_cast<double>(numer) / static_cast<double>(denom);
-  else
-    return static_cast<double>(0);
+  if(denom == rhs.denom)
+    {
+      // Includes both being zero (0/0)
+      return (numer < rhs.numer) ? -1 : (numer > rhs.numer) ? 1 : 0;
+    }
+
+  // Zero is stored as 0/0, compare it as 0/1
+  intType lhs_denom = (denom == 0) ? 1 : denom;
+  intType rhs_denom = (rhs.denom == 0) ? 1 : rhs.denom;
+
+  intType a, b;
+
+  if(!checkedMultiply(numer, rhs_denom, &a) || !checkedMultiply(rhs.numer, lhs_denom, &b))
+    {
+      // Too large to compare exactly, doubles are close enough here
+      return (dbl < rhs.dbl) ? -1 : (dbl > rhs.dbl) ? 1 : 0;
+    }
+
+  return (a < b) ? -1 : (a > b) ? 1 : 0;
 }
 
 rational rational::flipped() const
 {
-  return rational(denom, numer);
+  if(numer < 0)
+    return fromNormalized(-denom, -numer);
+
+  return fromNormalized(denom, numer);
 }
 
 bool rational::isNull() const
@@ -89,13 +175,6 @@ bool rational::isNull() const
   return denominator() == 0;
 }
 
-//Function: get active instances
-
-int rational::getActiveInstances()
-{
-  return activeInstances;
-}
-
 const intType &rational::numerator() const
 {
   return numer;
@@ -108,87 +187,90 @@ const intType &rational::denominator() const
 
 //Assignment Operators
 
-const rational& rational::operator=(const rational &rhs)
-{
-  if(this != &rhs)
-    {
-      numer = rhs.numer;
-      denom = rhs.denom;
-    }
-  return *this;
-}
-
 const rational& rational::operator+=(const rational &rhs)
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
+  if(rhs.denom == 0)
+    return *this;
+
+  if(denom == 0)
     {
-      numer = intType(0);
-      denom = intType(0);
+      *this = rhs;
+      return *this;
     }
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
 
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
+  intType n;
+
+  if(denom == rhs.denom)
+    {
+      // Common case (e.g. two times in the same timebase), no need to find a common denominator
+      if(checkedAdd(numer, rhs.numer, &n))
         {
-          numer = rhs.numer;
-          denom = rhs.denom;
+          if(denom == 1)
+            *this = fromNormalized(n, 1);
+          else
+            *this = rational(n, denom);
+
+          return *this;
         }
-      else
+    }
+  else
+    {
+      // Add over the least common multiple of the denominators to keep the intermediate values small
+      intType g = gcd(denom, rhs.denom);
+      intType lhs_scale = rhs.denom / g;
+      intType rhs_scale = denom / g;
+      intType a, b, d;
+
+      if(checkedMultiply(numer, lhs_scale, &a)
+         && checkedMultiply(rhs.numer, rhs_scale, &b)
+         && checkedMultiply(denom, lhs_scale, &d)
+         && checkedAdd(a, b, &n))
         {
-          numer = (numer * rhs.denom) + (rhs.numer * denom);
-          denom = denom * rhs.denom;
-          fixSigns();
-          reduce();
+          *this = rational(n, d);
+          return *this;
         }
+    }
+
+  *this = approximate(dbl + rhs.dbl, qMax(denom, rhs.denom));
   return *this;
 }
 
 const rational& rational::operator-=(const rational &rhs)
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    {
-      numer = intType(0);
-      denom = intType(0);
-    }
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          numer = -(rhs.numer);
-          denom = rhs.denom;
-        }
-      else
-        {
-          numer = (numer * rhs.denom) - (rhs.numer * denom);
-          denom = denom * rhs.denom;
-          fixSigns();
-          reduce();
-        }
-  return *this;
+  return *this += -rhs;
 }
 
 const rational& rational::operator/=(const rational &rhs)
 {
-  numer = numer * rhs.denom;
-  denom = denom * rhs.numer;
-  fixSigns();
-  reduce();
-  return *this;
+  // Dividing by zero gives zero, see "Zero Handling"
+  if(rhs.denom == 0)
+    {
+      *this = rational();
+      return *this;
+    }
+
+  return *this *= rhs.flipped();
 }
 
 const rational& rational::operator*=(const rational &rhs)
 {
-  numer = numer * rhs.numer;
-  denom = denom * rhs.denom;
-  fixSigns();
-  reduce();
+  if(denom == 0 || rhs.denom == 0)
+    {
+      *this = rational();
+      return *this;
+    }
+
+  // Both operands are in lowest form, so cross-reducing them gives a result in lowest form without another GCD
+  intType g1 = gcd(numer, rhs.denom);
+  intType g2 = gcd(rhs.numer, denom);
+  intType n, d;
+
+  if(checkedMultiply(numer / g1, rhs.numer / g2, &n)
+     && checkedMultiply(denom / g2, rhs.denom / g1, &d))
+    *this = fromNormalized(n, d);
+  else
+    *this = approximate(dbl * rhs.dbl, qMax(denom, rhs.denom));
+
   return *this;
 }
 
@@ -226,99 +308,22 @@ rational rational::operator*(const rational &rhs) const
 
 bool rational::operator<(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return false;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom < intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom < intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) < (denom * rhs.numer));
+  return compare(rhs) < 0;
 }
 
 bool rational::operator<=(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return true;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom < intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom < intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) <= (denom * rhs.numer));
+  return compare(rhs) <= 0;
 }
 
 bool rational::operator>(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return false;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom > intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom > intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-        return ((numer * rhs.denom) > (denom * rhs.numer));
+  return compare(rhs) > 0;
 }
 
 bool rational::operator>=(const rational &rhs) const
 {
-  if(numer * denom == intType(0) && rhs.numer * rhs.denom == intType(0))
-    return true;
-  else
-    if(numer * denom != intType(0) && rhs.numer * rhs.denom == intType(0))
-      {
-        if(numer * denom > intType(0))
-          return true;
-        else
-          return false;
-      }
-    else
-      if(numer * denom == intType(0) && rhs.numer * rhs.denom != intType(0))
-        {
-          if(rhs.numer * rhs.denom > intType(0))
-            return false;
-          else
-            return true;
-        }
-      else
-
-  return ((numer * rhs.denom) >= (denom * rhs.numer));
+  return compare(rhs) >= 0;
 }
 
 bool rational::operator==(const rational &rhs) const
@@ -336,28 +341,25 @@ bool rational::operator!=(const rational &rhs) const
 
 const rational& rational::operator++()
 {
-  numer += denom;
-  return *this;
+  return *this += rational(1);
 }
 
 rational rational::operator++(int)
 {
   rational tmp = *this;
-  numer += denom;
+  *this += rational(1);
   return tmp;
 }
 
 const rational& rational::operator--()
 {
-  numer -= denom;
-  return *this;
-
+  return *this -= rational(1);
 }
 
 rational rational::operator--(int)
 {
-  rational tmp;
-  numer -= denom;
+  rational tmp = *this;
+  *this -= rational(1);
   return tmp;
 }
 
@@ -368,7 +370,7 @@ const rational& rational::operator+() const
 
 rational rational::operator-() const
 {
-  return rational(numer, -denom);
+  return fromNormalized(-numer, denom);
 }
 
 bool rational::operator!() const
@@ -400,14 +402,12 @@ istream& operator>>(istream &in, rational &value)
   if(!in.eof())
     {
       if(ch == '/')
-        {
-          in >> value.denom;
-          value.fixSigns();
-          value.reduce();
-        }
+        in >> value.denom;
       else
         in.putback(ch);
     }
+
+  value.normalize();
+
   return in;
 }
-
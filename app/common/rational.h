@@ -5,6 +5,7 @@
 
 #ifndef RATIONAL_H
 #define RATIONAL_H
+#include <cstdint>
 #include <iostream>
 
 #include <QMetaType>
@@ -15,56 +16,40 @@ extern "C" {
 
 using namespace std;
 
-typedef long intType;
+typedef int64_t intType;
 /*
  * Zero Handling
  * 0/0        = 0
  * 0/non-zero = 0
  * non-zero/0 = 0
+ *
+ * Rationals are always kept in lowest form with a positive denominator (or 0/0), so equality is a comparison of the
+ * numerator and denominator. There's no global state, so rationals are trivially copyable and safe to use from any
+ * thread. The double value is computed once whenever the value changes, since toDouble() is called far more often
+ * than arithmetic.
+ *
+ * Arithmetic avoids reducing where the result is already known to be in lowest form (e.g. integers or when the
+ * operands are cross-reduced before multiplying), and is overflow checked. If a result can't be represented, it's
+ * approximated from the doubles instead of overflowing.
 */
 class rational
 {
 public:
   //constructors
-  rational(const intType &numerator = 0)
-    :numer(numerator), denom(1)
+  constexpr rational(const intType &numerator = 0)
+    :numer(numerator), denom(numerator == 0 ? 0 : 1), dbl(static_cast<double>(numerator))
   {
-    activeInstances++;
-    if(numer == 0)
-      denom = 0;
   }
-  
+
   rational(const intType &numerator, const intType &denominator)
-    :numer(numerator), denom(denominator)
-  {
-    activeInstances++;
-    if(denom != intType(0))
-      {
-        if(numer != intType(0))
-          {
-            fixSigns();
-            reduce();
-          }
-        else
-          denom = intType(0);
-      }
-    else
-      numer = intType(0);
-  }
-  
-  rational(const rational &rhs)
-    :numer(rhs.numer), denom(rhs.denom)
+    :numer(numerator), denom(denominator), dbl(0.0)
   {
-    activeInstances++;
+    normalize();
   }
 
   rational(const AVRational& r);
-  
-  //destructor
-  ~rational();
-  
+
   //Assignment Operators
-  const rational& operator=(const rational &rhs);
   const rational& operator+=(const rational &rhs);
   const rational& operator-=(const rational &rhs);
   const rational& operator/=(const rational &rhs);
@@ -75,7 +60,7 @@ public:
   rational operator-(const rational &rhs) const;
   rational operator/(const rational &rhs) const;
   rational operator*(const rational &rhs) const;
-  
+
   //Relational and equality operators
   bool operator<(const rational &rhs) const;
   bool operator<=(const rational &rhs) const;
@@ -83,7 +68,7 @@ public:
   bool operator>=(const rational &rhs) const;
   bool operator==(const rational &rhs) const;
   bool operator!=(const rational &rhs) const;
-  
+
   //Unary operators
   const rational& operator++(); //prefix
   rational operator++(int);     //postfix
@@ -94,41 +79,53 @@ public:
   bool operator!() const;
 
   //Function: convert to double
-  double toDouble() const;
+  double toDouble() const
+  {
+    return dbl;
+  }
 
   // Produce "flipped" version
   rational flipped() const;
 
   // Returns whether the rational is null or not
   bool isNull() const;
-  
+
   //Function: print number to cout
   void print(ostream &out = cout) const;
 
-  //Function: get active instances
-  int getActiveInstances();
-
   //IO
   friend ostream& operator<<(ostream &out, const rational &value);
   friend istream& operator>>(istream &in, rational &value);
 
   const intType& numerator() const;
   const intType& denominator() const;
-  
-private:
-  //number of active instances
-  static int activeInstances;
 
+private:
   //numerator and denominator
   intType numer;
   intType denom;
-  
-  //Function: ensures denom >= 0
-  void fixSigns();
-  //Function: ensures lowest form
-  void reduce();
-  //Function: finds greatest common denominator
-  intType gcd(intType &x, intType &y);
+
+  //cached numer / denom
+  double dbl;
+
+  //Function: create from a numerator and denominator already in lowest form
+  static rational fromNormalized(const intType& numerator, const intType& denominator);
+
+  //Function: nearest rational to `value` with denominator `denominator` (used when a result would overflow)
+  static rational approximate(double value, intType denominator);
+
+  //Function: ensures denom >= 0, lowest form and updates dbl
+  void normalize();
+
+  //Function: finds greatest common denominator of the absolute values
+  static intType gcd(intType x, intType y);
+
+  //Function: x*y and x+y, returning false instead if the result would overflow
+  static bool checkedMultiply(const intType& x, const intType& y, intType* result);
+  static bool checkedAdd(const intType& x, const intType& y, intType* result);
+
+  //Function: returns -1, 0 or 1 if this is less than, equal to or greater than rhs
+  int compare(const rational& rhs) const;
 };
 
 #define RATIONAL_MIN rational(INT32_MIN, 1)
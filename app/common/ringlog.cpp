@@ -0,0 +1,380 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "ringlog.h"
+
+#include <algorithm>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QFile>
+#include <QThread>
+#include <QWaitCondition>
+
+RingLog olive::ring_log;
+
+struct RingLog::Ring {
+  Ring() :
+    write_index(0),
+    read_index(0),
+    thread(0)
+  {
+  }
+
+  Entry entries[kRingLogSize];
+
+  /// Only written by the thread that owns the ring
+  QAtomicInteger<quint64> write_index;
+
+  /// Only touched by Flush() with lock_ held
+  quint64 read_index;
+
+  int thread;
+};
+
+/**
+ * @brief Holds a thread's ring and returns it to the log when the thread exits
+ */
+class RingLog::RingHandle
+{
+public:
+  RingHandle() :
+    ring_(nullptr)
+  {
+  }
+
+  ~RingHandle()
+  {
+    if (ring_ != nullptr) {
+      olive::ring_log.ReleaseRing(ring_);
+    }
+  }
+
+  Ring* Get()
+  {
+    if (ring_ == nullptr) {
+      ring_ = olive::ring_log.AcquireRing();
+    }
+
+    return ring_;
+  }
+
+private:
+  Ring* ring_;
+};
+
+/**
+ * @brief Calls Flush() every kRingLogFlushInterval milliseconds until it's stopped
+ */
+class RingLog::FlushThread : public QThread
+{
+public:
+  FlushThread() :
+    stop_(false)
+  {
+    setObjectName(QStringLiteral("Log"));
+  }
+
+  void Stop()
+  {
+    mutex_.lock();
+    stop_ = true;
+    wait_cond_.wakeAll();
+    mutex_.unlock();
+
+    wait();
+  }
+
+protected:
+  virtual void run() override
+  {
+    mutex_.lock();
+
+    while (!stop_) {
+      wait_cond_.wait(&mutex_, kRingLogFlushInterval);
+
+      mutex_.unlock();
+      olive::ring_log.Flush();
+      mutex_.lock();
+    }
+
+    mutex_.unlock();
+  }
+
+private:
+  bool stop_;
+
+  QMutex mutex_;
+
+  QWaitCondition wait_cond_;
+};
+
+RingLog::RingLog() :
+  next_thread_(0),
+  flush_thread_(nullptr)
+{
+  clock_.start();
+}
+
+RingLog::~RingLog()
+{
+  Stop();
+}
+
+void RingLog::Start()
+{
+  if (flush_thread_ != nullptr) {
+    return;
+  }
+
+  flush_thread_ = new FlushThread();
+  flush_thread_->start(QThread::LowPriority);
+}
+
+void RingLog::Stop()
+{
+  if (flush_thread_ == nullptr) {
+    return;
+  }
+
+  flush_thread_->Stop();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+
+  Flush();
+
+  if (!dump_filename_.isEmpty() && !Dump(dump_filename_)) {
+    qWarning() << "Failed to write log dump to" << dump_filename_;
+  }
+}
+
+void RingLog::Flush()
+{
+  QVector<Entry> entries;
+  QVector<int> dropped;
+
+  {
+    QMutexLocker locker(&lock_);
+
+    for (const std::unique_ptr<Ring>& ring : rings_) {
+      quint64 begin = ring->read_index;
+
+      ring->read_index = CopyRing(ring.get(), begin, &entries);
+
+      // Anything more than a ring behind was overwritten before we got to it
+      if (ring->read_index > begin + kRingLogSize) {
+        dropped.append(static_cast<int>(ring->read_index - begin - kRingLogSize));
+      }
+    }
+  }
+
+  // Messages are formatted here, on whichever thread is flushing, rather than on the thread that logged them
+  foreach (const Entry& e, entries) {
+    QMessageLogger logger(e.file, e.line, e.function);
+
+    QDebug stream = (e.level == kWarning) ? logger.warning() : (e.level == kInfo) ? logger.info() : logger.debug();
+
+    stream << e.message;
+
+    for (int i=0;i<e.arg_count;i++) {
+      if (e.args[i].integer) {
+        stream << e.args[i].i;
+      } else {
+        stream << e.args[i].d;
+      }
+    }
+  }
+
+  foreach (int count, dropped) {
+    qWarning() << "Log overflowed," << count << "messages were dropped";
+  }
+}
+
+void RingLog::SetDumpFilename(const QString &filename)
+{
+  dump_filename_ = filename;
+}
+
+const QString &RingLog::dump_filename() const
+{
+  return dump_filename_;
+}
+
+bool RingLog::Dump(const QString &filename)
+{
+  if (!lock_.tryLock(static_cast<int>(kRingLogFlushInterval))) {
+    return false;
+  }
+
+  QVector<Entry> entries;
+
+  for (const std::unique_ptr<Ring>& ring : rings_) {
+    CopyRing(ring.get(), 0, &entries);
+  }
+
+  QStringList threads = thread_names_;
+
+  lock_.unlock();
+
+  std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+    return a.time < b.time;
+  });
+
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    return false;
+  }
+
+  QDataStream stream(&file);
+
+  stream.writeRawData("OLOG", 4);
+  stream << static_cast<quint32>(1);
+
+  stream << threads;
+
+  stream << static_cast<quint32>(entries.size());
+
+  foreach (const Entry& e, entries) {
+    stream << QByteArray(e.message)
+           << QByteArray(e.file)
+           << QByteArray(e.function)
+           << static_cast<qint32>(e.line)
+           << static_cast<qint32>(e.level)
+           << static_cast<qint32>(e.thread)
+           << e.time
+           << static_cast<qint32>(e.arg_count);
+
+    for (int i=0;i<e.arg_count;i++) {
+      stream << e.args[i].integer;
+
+      if (e.args[i].integer) {
+        stream << e.args[i].i;
+      } else {
+        stream << e.args[i].d;
+      }
+    }
+  }
+
+  return stream.status() == QDataStream::Ok && file.error() == QFile::NoError;
+}
+
+RingLog::Arg RingLog::MakeArg(double d)
+{
+  Arg a;
+  a.integer = false;
+  a.d = d;
+  return a;
+}
+
+RingLog::Arg RingLog::MakeArg(const rational &r)
+{
+  return MakeArg(r.toDouble());
+}
+
+void RingLog::Write(Level level, const char *file, int line, const char *function, const char *message,
+                    const Arg *args, int arg_count)
+{
+  static thread_local RingHandle handle;
+
+  Ring* ring = handle.Get();
+
+  quint64 index = ring->write_index.load();
+
+  Entry& e = ring->entries[index % kRingLogSize];
+
+  e.message = message;
+  e.file = file;
+  e.function = function;
+  e.line = line;
+  e.level = level;
+  e.thread = ring->thread;
+  e.time = clock_.nsecsElapsed();
+  e.arg_count = arg_count;
+
+  for (int i=0;i<arg_count;i++) {
+    e.args[i] = args[i];
+  }
+
+  ring->write_index.storeRelease(index + 1);
+}
+
+RingLog::Ring *RingLog::AcquireRing()
+{
+  QMutexLocker locker(&lock_);
+
+  Ring* ring;
+
+  if (free_rings_.isEmpty()) {
+    ring = new Ring();
+    rings_.push_back(std::unique_ptr<Ring>(ring));
+  } else {
+    ring = free_rings_.takeLast();
+  }
+
+  // A reused ring's old entries belong to a thread that's gone, they're still kept for dumps
+  ring->thread = next_thread_;
+  next_thread_++;
+
+  QThread* thread = QThread::currentThread();
+  QString name = thread->objectName();
+
+  if (name.isEmpty()) {
+    if (QCoreApplication::instance() != nullptr && thread == QCoreApplication::instance()->thread()) {
+      name = QStringLiteral("Main");
+    } else {
+      name = QString::fromLatin1(thread->metaObject()->className());
+    }
+  }
+
+  thread_names_.append(QStringLiteral("%1 %2").arg(name, QString::number(ring->thread)));
+
+  return ring;
+}
+
+void RingLog::ReleaseRing(RingLog::Ring *ring)
+{
+  QMutexLocker locker(&lock_);
+
+  free_rings_.append(ring);
+}
+
+quint64 RingLog::CopyRing(RingLog::Ring *ring, quint64 from, QVector<RingLog::Entry> *entries)
+{
+  quint64 end = ring->write_index.loadAcquire();
+
+  quint64 begin = qMax(from, (end > kRingLogSize) ? end - kRingLogSize : Q_UINT64_C(0));
+
+  int first = entries->size();
+
+  for (quint64 i=begin;i<end;i++) {
+    entries->append(ring->entries[i % kRingLogSize]);
+  }
+
+  // The owning thread keeps logging while we copy, drop any it may have overwritten in the meantime
+  quint64 written = ring->write_index.loadAcquire();
+
+  if (written > begin + kRingLogSize) {
+    int overwritten = static_cast<int>(qMin(written - kRingLogSize - begin, end - begin));
+
+    entries->remove(first, overwritten);
+  }
+
+  return end;
+}
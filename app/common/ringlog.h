@@ -0,0 +1,225 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef RINGLOG_H
+#define RINGLOG_H
+
+#include <memory>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+#include <type_traits>
+#include <vector>
+
+#include "common/rational.h"
+#include "config/config.h"
+
+/**
+ * @brief Log for messages from hot paths (e.g. every frame or edit) that would be too expensive to send to qDebug()
+ *
+ * A message is recorded to a ring buffer belonging to the thread that logged it as a string literal and up to
+ * kRingLogMaxArgs numbers, so logging never formats a string, takes a lock or allocates. A thread started with Start()
+ * flushes the rings to Qt's message handler (see DebugHandler()) every kRingLogFlushInterval milliseconds. Rings are a
+ * fixed size, so messages are lost (and the loss is reported) if a thread logs faster than they're flushed.
+ *
+ * Use the OLIVE_LOG_* macros rather than calling Record() directly. Levels below OLIVE_LOG_LEVEL are compiled out
+ * entirely, by default that's debug messages in release builds.
+ *
+ * Rings keep the last kRingLogSize messages of each thread after they're flushed, so they can be written to a binary
+ * file with Dump() after something has gone wrong.
+ */
+class RingLog
+{
+public:
+  enum Level {
+    kDebug,
+    kInfo,
+    kWarning
+  };
+
+  struct Arg {
+    bool integer;
+
+    union {
+      qint64 i;
+      double d;
+    };
+  };
+
+  struct Entry {
+    /// String literal logged, never freed
+    const char* message;
+
+    /// Where the message was logged from, string literals from the macros
+    const char* file;
+    const char* function;
+    int line;
+
+    Level level;
+
+    /// Identifies the thread the message was logged on
+    int thread;
+
+    /// Nanoseconds since the log was created that the message was logged at
+    qint64 time;
+
+    int arg_count;
+    Arg args[kRingLogMaxArgs];
+  };
+
+  RingLog();
+
+  ~RingLog();
+
+  /**
+   * @brief Start flushing the rings in the background
+   */
+  void Start();
+
+  /**
+   * @brief Stop flushing in the background and flush whatever's left, writing a dump if one was asked for
+   */
+  void Stop();
+
+  /**
+   * @brief Send every message logged since the last call to Qt's message handler
+   */
+  void Flush();
+
+  /**
+   * @brief File Stop() dumps the rings to, or empty to not dump them
+   */
+  void SetDumpFilename(const QString& filename);
+
+  const QString& dump_filename() const;
+
+  /**
+   * @brief Write the last kRingLogSize messages of every thread to a binary file
+   *
+   * The file is a QDataStream starting with the magic "OLOG" and a version, followed by the thread names and then
+   * every entry in the order they were logged, with its message, file and function written out as strings.
+   *
+   * Meant to be safe enough to call from a fatal message handler, so it gives up rather than waiting for the log's
+   * lock.
+   */
+  bool Dump(const QString& filename);
+
+  /**
+   * @brief Record a message to the calling thread's ring
+   */
+  template <typename... Args>
+  void Record(Level level, const char* file, int line, const char* function, const char* message, const Args&... args)
+  {
+    static_assert(sizeof...(Args) <= static_cast<size_t>(kRingLogMaxArgs), "Too many arguments for a RingLog entry");
+
+    // One extra so there's never a zero-sized array
+    Arg values[sizeof...(Args) + 1] = {MakeArg(args)..., MakeArg(0)};
+
+    Write(level, file, line, function, message, values, static_cast<int>(sizeof...(Args)));
+  }
+
+  static Arg MakeArg(double d);
+
+  static Arg MakeArg(const rational& r);
+
+  template <typename T>
+  static typename std::enable_if<std::is_integral<T>::value, Arg>::type MakeArg(T i)
+  {
+    Arg a;
+    a.integer = true;
+    a.i = static_cast<qint64>(i);
+    return a;
+  }
+
+private:
+  struct Ring;
+
+  class RingHandle;
+
+  class FlushThread;
+
+  void Write(Level level, const char* file, int line, const char* function, const char* message,
+             const Arg* args, int arg_count);
+
+  Ring* AcquireRing();
+
+  void ReleaseRing(Ring* ring);
+
+  /**
+   * @brief Copy every entry still in a ring since index `from`, dropping any overwritten while copying
+   *
+   * Returns the index the ring had been written up to.
+   */
+  static quint64 CopyRing(Ring* ring, quint64 from, QVector<Entry>* entries);
+
+  QElapsedTimer clock_;
+
+  std::vector<std::unique_ptr<Ring>> rings_;
+
+  /// Rings of threads that have exited, reused by new threads
+  QVector<Ring*> free_rings_;
+
+  int next_thread_;
+
+  QStringList thread_names_;
+
+  QString dump_filename_;
+
+  FlushThread* flush_thread_;
+
+  QMutex lock_;
+
+};
+
+namespace olive {
+extern RingLog ring_log;
+}
+
+/**
+ * Messages below this level are compiled out (0 = debug, 1 = info, 2 = warning)
+ */
+#ifndef OLIVE_LOG_LEVEL
+#ifdef QT_NO_DEBUG
+#define OLIVE_LOG_LEVEL 1
+#else
+#define OLIVE_LOG_LEVEL 0
+#endif
+#endif
+
+#if OLIVE_LOG_LEVEL <= 0
+#define OLIVE_LOG_DEBUG(...) olive::ring_log.Record(RingLog::kDebug, __FILE__, __LINE__, Q_FUNC_INFO, __VA_ARGS__)
+#else
+#define OLIVE_LOG_DEBUG(...) do {} while (0)
+#endif
+
+#if OLIVE_LOG_LEVEL <= 1
+#define OLIVE_LOG_INFO(...) olive::ring_log.Record(RingLog::kInfo, __FILE__, __LINE__, Q_FUNC_INFO, __VA_ARGS__)
+#else
+#define OLIVE_LOG_INFO(...) do {} while (0)
+#endif
+
+#if OLIVE_LOG_LEVEL <= 2
+#define OLIVE_LOG_WARNING(...) olive::ring_log.Record(RingLog::kWarning, __FILE__, __LINE__, Q_FUNC_INFO, __VA_ARGS__)
+#else
+#define OLIVE_LOG_WARNING(...) do {} while (0)
+#endif
+
+#endif // RINGLOG_H
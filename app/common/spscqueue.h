@@ -0,0 +1,132 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <QVector>
+
+/**
+ * @brief A bounded lock-free queue for exactly one producer thread and one consumer thread
+ *
+ * Push() and Pop() never lock or allocate, each is a couple of atomic operations on indices that live on their own
+ * cache lines so the two threads don't contend. Capacity is rounded up to a power of two.
+ *
+ * The queue doesn't block, a consumer that wants to sleep while it's empty has to pair it with its own wake-up (see
+ * RendererDownloadThread for an example that only signals when the consumer is actually idle).
+ */
+template <typename T>
+class SPSCQueue
+{
+public:
+  SPSCQueue(int capacity) :
+    head_(0),
+    tail_(0)
+  {
+    int size = 1;
+
+    while (size < capacity) {
+      size *= 2;
+    }
+
+    buffer_.resize(size);
+    mask_ = static_cast<quint64>(size - 1);
+  }
+
+  /**
+   * @brief Add a value to the back of the queue, returns FALSE if it's full. Only call from the producer thread.
+   */
+  bool Push(const T& value)
+  {
+    quint64 tail = tail_.load(std::memory_order_relaxed);
+
+    if (tail - head_.load(std::memory_order_acquire) == static_cast<quint64>(buffer_.size())) {
+      return false;
+    }
+
+    buffer_[static_cast<int>(tail & mask_)] = value;
+
+    tail_.store(tail + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  /**
+   * @brief Take the value at the front of the queue, returns FALSE if it's empty. Only call from the consumer thread.
+   */
+  bool Pop(T* value)
+  {
+    quint64 head = head_.load(std::memory_order_relaxed);
+
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    T& slot = buffer_[static_cast<int>(head & mask_)];
+
+    *value = slot;
+
+    // Don't keep the value alive in the slot until it's overwritten
+    slot = T();
+
+    head_.store(head + 1, std::memory_order_release);
+
+    return true;
+  }
+
+  /**
+   * @brief Returns TRUE if the queue is empty, exact from the consumer thread and a snapshot from anywhere else
+   */
+  bool IsEmpty() const
+  {
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+private:
+  QVector<T> buffer_;
+
+  quint64 mask_;
+
+  /**
+   * @brief Keeps the indices off each other's (and the fields above's) cache lines
+   *
+   * Explicit padding rather than alignas(), since queues are created with std::make_shared, which C++11 doesn't
+   * align past the default.
+   */
+  char pad_before_head_[64];
+
+  /**
+   * @brief Index of the next value to pop, only written by the consumer
+   */
+  std::atomic<quint64> head_;
+
+  char pad_before_tail_[64 - sizeof(std::atomic<quint64>)];
+
+  /**
+   * @brief Index of the next value to push, only written by the producer
+   */
+  std::atomic<quint64> tail_;
+
+  char pad_after_tail_[64 - sizeof(std::atomic<quint64>)];
+
+};
+
+#endif // SPSCQUEUE_H
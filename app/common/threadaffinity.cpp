@@ -0,0 +1,180 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "threadaffinity.h"
+
+#include <algorithm>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "config/config.h"
+
+namespace {
+
+thread_local int current_node = -1;
+
+#if defined(Q_OS_LINUX)
+/**
+ * @brief Parse a sysfs CPU list such as "0-7,16-23"
+ */
+QVector<int> ParseCPUList(const QByteArray& list)
+{
+  QVector<int> cpus;
+
+  foreach (const QByteArray& range, list.trimmed().split(',')) {
+    if (range.isEmpty()) {
+      continue;
+    }
+
+    int dash = range.indexOf('-');
+
+    if (dash < 0) {
+      cpus.append(range.toInt());
+    } else {
+      int first = range.left(dash).toInt();
+      int last = range.mid(dash + 1).toInt();
+
+      for (int i=first;i<=last;i++) {
+        cpus.append(i);
+      }
+    }
+  }
+
+  return cpus;
+}
+
+/**
+ * @brief CPUs of each node that has any, read from sysfs
+ */
+QVector< QVector<int> > ReadTopology()
+{
+  QVector< QVector<int> > nodes;
+
+  QDir node_dir(QStringLiteral("/sys/devices/system/node"));
+
+  QStringList entries = node_dir.entryList(QStringList() << QStringLiteral("node*"), QDir::Dirs);
+
+  // Keep nodes in numeric order so node indices are stable between runs
+  std::sort(entries.begin(), entries.end(), [](const QString& a, const QString& b) {
+    return a.mid(4).toInt() < b.mid(4).toInt();
+  });
+
+  foreach (const QString& entry, entries) {
+    QFile cpulist(node_dir.filePath(entry + QStringLiteral("/cpulist")));
+
+    if (!cpulist.open(QFile::ReadOnly)) {
+      continue;
+    }
+
+    QVector<int> cpus = ParseCPUList(cpulist.readAll());
+
+    // Memory-only nodes have no CPUs to run on
+    if (!cpus.isEmpty()) {
+      nodes.append(cpus);
+    }
+  }
+
+  return nodes;
+}
+
+const QVector< QVector<int> >& Topology()
+{
+  static const QVector< QVector<int> > topology = ReadTopology();
+
+  return topology;
+}
+#endif
+
+}
+
+int ThreadAffinity::NodeCount()
+{
+  if (!kPinThreadsToNUMANodes) {
+    return 1;
+  }
+
+#if defined(Q_OS_LINUX)
+  return qMax(1, Topology().size());
+#elif defined(Q_OS_WIN)
+  ULONG highest_node;
+
+  if (GetNumaHighestNodeNumber(&highest_node)) {
+    return static_cast<int>(highest_node) + 1;
+  }
+
+  return 1;
+#else
+  return 1;
+#endif
+}
+
+void ThreadAffinity::PinCurrentThread(int node)
+{
+  int node_count = NodeCount();
+
+  if (node < 0 || node_count <= 1) {
+    return;
+  }
+
+  node %= node_count;
+
+  if (current_node == node) {
+    return;
+  }
+
+#if defined(Q_OS_LINUX)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+
+  foreach (int cpu, Topology().at(node)) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(static_cast<size_t>(cpu), &set);
+    }
+  }
+
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    return;
+  }
+#elif defined(Q_OS_WIN)
+  GROUP_AFFINITY affinity;
+
+  if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity)
+      || !SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr)) {
+    return;
+  }
+#else
+  return;
+#endif
+
+  current_node = node;
+}
+
+int ThreadAffinity::CurrentNode()
+{
+  return current_node;
+}
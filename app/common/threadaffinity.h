@@ -0,0 +1,58 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef THREADAFFINITY_H
+#define THREADAFFINITY_H
+
+/**
+ * @brief Keeps threads that share data on the same NUMA node
+ *
+ * On machines with more than one memory node, a frame decoded on one node and rendered or written on another is pulled
+ * across the interconnect at every step. Threads pin themselves to a node with PinCurrentThread() so their working set
+ * stays local, and since memory is placed on the node of the thread that first touches it, buffers allocated by a
+ * pinned thread end up there too.
+ *
+ * The topology is read once from the OS. On single node machines (or if kPinThreadsToNUMANodes is FALSE) every
+ * function here is a no-op and CurrentNode() always returns -1.
+ */
+class ThreadAffinity
+{
+public:
+  /**
+   * @brief Number of NUMA nodes that threads are spread over, 1 if pinning is disabled or unsupported
+   */
+  static int NodeCount();
+
+  /**
+   * @brief Restrict the calling thread to the CPUs of a node
+   *
+   * `node` may be any non-negative number (e.g. a thread index), it's wrapped around NodeCount() so consecutive indices
+   * are spread across nodes. A negative node does nothing.
+   */
+  static void PinCurrentThread(int node);
+
+  /**
+   * @brief The node the calling thread was pinned to with PinCurrentThread(), or -1 if it hasn't been
+   */
+  static int CurrentNode();
+
+};
+
+#endif // THREADAFFINITY_H
@@ -22,6 +22,7 @@
 #define CONFIG_H
 
 #include "common/timecodefunctions.h"
+#include "render/cacheformat.h"
 
 /**
  * @brief Temporary variables that will definitely be configurable but aren't yet
@@ -31,4 +32,318 @@ const olive::TimecodeDisplay kTimecodeDisplay = olive::kTimecodeFrames;
 
 const rational kDefaultImageLength = 2;
 
+const bool kUseHardwareDecoding = true;
+
+const int kDecoderPrefetchDepth = 8;
+
+const int kDecoderOpenThreads = 2;
+
+const int kGOPParallelDecoders = 3;
+
+const int kGOPParallelBufferFrames = 16;
+
+const int kDecoderOpenLookahead = 5;
+
+const bool kUseDecoderProcesses = false;
+
+const int kDecoderProcessSegments = 16;
+
+const int kDecoderIdleTimeout = 30;
+
+const int kDecoderIdleBudget = 16;
+
+const int kMediaIdleTimeout = 30;
+
+const int kMediaResidentBudget = 32;
+
+const int kMulticamMaxAngles = 16;
+
+/**
+ * @brief Width in pixels (at full resolution) of the outline around the selected angle in a multicam grid
+ */
+const int kMulticamHighlightWidth = 4;
+
+const bool kUseRemoteIOCache = true;
+
+const int kIOBlockSize = 1024 * 1024;
+
+const qint64 kIOBlockCacheSize = Q_INT64_C(512) * 1024 * 1024;
+
+const int kIOReadAheadBlocks = 16;
+
+/**
+ * @brief Copy media on network storage used by open sequences to local storage (see MediaMirror)
+ */
+const bool kUseMediaMirror = true;
+
+const qint64 kMediaMirrorSize = Q_INT64_C(100) * 1024 * 1024 * 1024;
+
+const rational kDefaultImageSequenceTimebase = rational(1, 24);
+
+const int kImageSequenceLookahead = 8;
+
+const qint64 kImageSequenceCacheSize = Q_INT64_C(2048) * 1024 * 1024;
+
+/**
+ * @brief Read stills and image sequences through one OIIO::ImageCache shared by every OIIODecoder
+ */
+const bool kUseOIIOImageCache = false;
+
+const int kOIIOImageCacheSizeMB = 1024;
+
+const int kOIIOImageCacheMaxOpenFiles = 100;
+
+/**
+ * @brief Tile size untiled images are split into in the OIIO::ImageCache, so partial reads only read what they need
+ */
+const int kOIIOImageCacheAutoTile = 64;
+const int kMaximumConcurrentProbes = 8;
+const int kMaximumConcurrentIOTasks = 4;
+const int kMaximumConcurrentIOTasksPerDevice = 4;
+const int kMaximumConcurrentIOTasksPerNetworkDevice = 2;
+
+const int kProxyMinimumHeight = 2160;
+
+const int kProxyDivider = 2;
+const qint64 kRenderMemoryBudget = Q_INT64_C(1024) * 1024 * 1024;
+
+const qint64 kRenderMemoryCacheSize = Q_INT64_C(2048) * 1024 * 1024;
+
+const qint64 kSourceFrameCacheSize = Q_INT64_C(1024) * 1024 * 1024;
+
+const qint64 kIntermediateCacheSize = Q_INT64_C(512) * 1024 * 1024;
+
+/**
+ * @brief Nanoseconds a step of a frame (including everything below it) must take to render to be kept in
+ * RendererIntermediateCache
+ */
+const qint64 kIntermediateCacheMinimumCost = Q_INT64_C(8000000);
+
+const int kDownloadBufferCount = 3;
+
+const int kDownloadQueueSize = 64;
+
+const int kUploadBufferCount = 3;
+
+const int kViewerQueueSize = 4;
+
+const int kDiskReadAheadFrames = 16;
+
+const int kDiskReadThreads = 4;
+
+/**
+ * @brief Frames of an invalidated range each of RendererProcessor's rehash tasks works out the hashes of
+ */
+const int kRehashChunkFrames = 256;
+
+const int kExportFramesInFlight = 4;
+
+const int kExportQueueSize = 4;
+
+const int kExportThreadsPerChunk = 4;
+
+const int kExportMinChunkFrames = 48;
+
+const int kExportMaximumTileSize = 4096;
+
+/**
+ * @brief Defaults for the frames DecoderBenchmark retrieves from each file, and the seed its seeks are generated from
+ */
+const int kDecoderBenchmarkSequentialFrames = 240;
+const int kDecoderBenchmarkSeeks = 100;
+const quint64 kDecoderBenchmarkSeed = 5489;
+
+/**
+ * @brief Untimed passes GPUBenchmark runs of each test first, and timed passes after them
+ */
+const int kGPUBenchmarkWarmup = 5;
+const int kGPUBenchmarkIterations = 60;
+
+const quint64 kProfilerRingSize = 8192;
+
+const int kProfilerFrameWindow = 240;
+
+/**
+ * @brief Maximum timer queries each GPUProfiler creates, GPU work isn't timed while they're all waiting for results
+ */
+const int kGPUProfilerMaxQueries = 4096;
+
+/**
+ * @brief Messages each thread's RingLog ring holds before the oldest are overwritten
+ */
+const quint64 kRingLogSize = 4096;
+
+const int kRingLogMaxArgs = 4;
+
+/**
+ * @brief Milliseconds between RingLog flushes
+ */
+const unsigned long kRingLogFlushInterval = 100;
+
+/**
+ * @brief Milliseconds between applying a dragged parameter's value, so a drag updates the graph about once a frame
+ */
+const int kParamDragUpdateInterval = 16;
+
+/**
+ * @brief Largest difference from OCIO's CPU path (relative to the value for values above 1) that its GPU path may have
+ * on every color of a test pattern for it to be used when rendering online (see ShaderCache::IsOCIOPipelineAccurate())
+ */
+const float kGPUColorTolerance = 0.002f;
+
+const olive::CachePriority kDefaultCachePriority = olive::kCachePrioritizeBalanced;
+
+/**
+ * @brief Cache format used for olive::kCachePrioritizeReview, either olive::kCacheFormatYUV420 or kCacheFormatYUV422
+ */
+const olive::CacheFormat kReviewCacheFormat = olive::kCacheFormatYUV420;
+
+const qint64 kDiskCacheQuota = Q_INT64_C(20) * 1024 * 1024 * 1024;
+
+/**
+ * @brief Fill the render cache of every open Sequence once there's been no input for kIdleRenderDelay seconds
+ */
+const bool kUseIdleRender = true;
+
+const int kIdleRenderDelay = 120;
+
+/**
+ * @brief Idle rendering stops once the disk cache reaches this much of its quota, so it never evicts frames
+ */
+const double kIdleRenderQuotaRatio = 0.9;
+
+/**
+ * @brief Frames in each range RenderFarmCoordinator hands out to a render farm worker
+ *
+ * Small enough that the last ranges are spread over every worker, large enough that starting a worker (loading the
+ * project and starting the renderer) doesn't take longer than rendering.
+ */
+const int kRenderFarmRangeFrames = 240;
+
+const qint64 kCachePackSegmentSize = Q_INT64_C(256) * 1024 * 1024;
+
+const qint64 kIndexRecheckInterval = 2000;
+
+const int kRenderTexturePoolSize = 16;
+
+const qint64 kFrameBufferPoolBudget = Q_INT64_C(512) * 1024 * 1024;
+
+const qint64 kImageCacheMemoryBudget = Q_INT64_C(4096) * 1024 * 1024;
+
+const qint64 kImageCacheTextureBudget = Q_INT64_C(2048) * 1024 * 1024;
+
+const double kImageCacheSystemMemoryRatio = 0.5;
+
+const double kImageCachePressureRatio = 0.9;
+
+/**
+ * @brief Milliseconds between queries of the driver for free VRAM (see VRAMMonitor)
+ */
+const int kVRAMQueryInterval = 500;
+
+/**
+ * @brief Free VRAM below which VRAMMonitor reports pressure
+ */
+const qint64 kVRAMPressureHeadroom = Q_INT64_C(1024) * 1024 * 1024;
+
+/**
+ * @brief Free VRAM below which VRAMMonitor reports critical pressure
+ */
+const qint64 kVRAMCriticalHeadroom = Q_INT64_C(256) * 1024 * 1024;
+
+/**
+ * @brief VRAM assumed to be available to us if the driver can't tell
+ */
+const qint64 kVRAMFallbackBudget = Q_INT64_C(4096) * 1024 * 1024;
+
+/**
+ * @brief Milliseconds pressure stays critical for after a texture allocation fails
+ */
+const int kVRAMFailureHoldTime = 5000;
+
+/**
+ * @brief Milliseconds between each step RendererProcessor takes to use less VRAM while pressure is critical
+ */
+const int kVRAMDegradeInterval = 2000;
+
+/**
+ * @brief Seconds without VRAM pressure before RendererProcessor undoes what it did to use less
+ */
+const int kVRAMRecoveryDelay = 30;
+
+const bool kPinThreadsToNUMANodes = true;
+
+const bool kUseBakedColorLUT = false;
+
+const int kColorLUTEdgeSize = 65;
+
+const int kDefaultSampleRate = 48000;
+
+const int kAudioMixBlockSize = 512;
+
+const int kAudioMixAhead = 100;
+
+const int kMaxStretchSpeed = 4;
+
+const int kTimeStretchOverlap = 10;
+
+const int kTimeStretchSearch = 5;
+
+const int kShuttleKeyframeSpeed = 2;
+
+const int kShuttleMaximumSpeed = 32;
+
+const int kShuttleDivider = 2;
+
+const int kMaximumPlaybackDivider = 4;
+
+const int kPlaybackDividerSamples = 8;
+
+const int kScrubPreviewDivider = 2;
+
+const bool kMatchDisplayResolution = true;
+
+const int kMaximumDisplayDivider = 8;
+
+const int kScrubRestInterval = 150;
+
+const int kReverseBufferSize = 32;
+
+const int kMaxCompositeLayers = 8;
+
+const int kParamCacheSize = 4;
+
+const qint64 kUndoMemoryBudget = Q_INT64_C(512) * 1024 * 1024;
+
+/**
+ * @brief Clips on each track of the short benchmark PerformanceProfile::AutoTune() runs on first launch
+ */
+const int kAutoTuneClips = 2;
+
+/**
+ * @brief How much faster more render threads have to be for AutoTune() to prefer them over fewer
+ */
+const double kAutoTuneThreadGain = 1.1;
+
+/**
+ * @brief Share of the render cache disk's free space AutoTune() sets the disk cache quota to (up to kDiskCacheQuota)
+ */
+const double kAutoTuneDiskCacheRatio = 0.5;
+
+/**
+ * @brief Milliseconds after the project changes before an active search in ProjectExplorer is run again
+ */
+const int kProjectSearchRefreshInterval = 250;
+
+/**
+ * @brief Maximum number of search results FootageComboBox lists
+ */
+const int kFootageSearchMaxResults = 200;
+
+/**
+ * @brief Number of frames FrameServer keeps in its shared memory ring, so consumers have time to read one before it's
+ * overwritten
+ */
+const int kFrameServerSlotCount = 3;
+
 #endif // CONFIG_H
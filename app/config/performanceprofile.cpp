@@ -0,0 +1,256 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "performanceprofile.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QStorageInfo>
+#include <QThread>
+#include <QVector>
+
+#include "common/filefunctions.h"
+#include "config/config.h"
+#include "render/diskcachemanager.h"
+#include "render/imagecache.h"
+#include "render/renderbenchmark.h"
+#include "task/taskmanager.h"
+
+PerformanceProfile olive::performance_profile;
+
+PerformanceProfile::PerformanceProfile() :
+  values_(Defaults())
+{
+}
+
+PerformanceProfile::Values PerformanceProfile::Defaults()
+{
+  Values values;
+
+  values.render_threads = QThread::idealThreadCount();
+  values.download_threads = QThread::idealThreadCount();
+  values.task_threads = QThread::idealThreadCount();
+
+  // Same as ImageCache's own default
+  values.memory_budget = kImageCacheMemoryBudget;
+
+  qint64 system_memory = ImageCache::SystemMemory();
+
+  if (system_memory > 0) {
+    values.memory_budget = qMin(values.memory_budget,
+                                static_cast<qint64>(static_cast<double>(system_memory) * kImageCacheSystemMemoryRatio));
+  }
+
+  values.texture_budget = kImageCacheTextureBudget;
+  values.disk_cache_quota = kDiskCacheQuota;
+  values.decoder_prefetch_depth = kDecoderPrefetchDepth;
+  values.image_sequence_lookahead = kImageSequenceLookahead;
+  values.cache_priority = kDefaultCachePriority;
+
+  return values;
+}
+
+PerformanceProfile::Values PerformanceProfile::values()
+{
+  QMutexLocker locker(&lock_);
+
+  return values_;
+}
+
+void PerformanceProfile::SetValues(const PerformanceProfile::Values &values)
+{
+  lock_.lock();
+  values_ = values;
+  lock_.unlock();
+
+  olive::image_cache.SetBudget(ImageCache::kMemBuf, values.memory_budget);
+  olive::image_cache.SetBudget(ImageCache::kTexBuf, values.texture_budget);
+
+  olive::disk_cache_manager.SetQuota(values.disk_cache_quota);
+
+  olive::task_manager.thread_pool(Task::kCategoryCPU)->setMaxThreadCount(values.task_threads);
+
+  emit Changed();
+}
+
+bool PerformanceProfile::Load()
+{
+  Values defaults = Defaults();
+
+  QFile file(Filename());
+
+  if (!file.open(QFile::ReadOnly)) {
+    SetValues(defaults);
+    return false;
+  }
+
+  QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+
+  if (!doc.isObject()) {
+    qWarning() << "Failed to read performance profile" << Filename();
+    SetValues(defaults);
+    return false;
+  }
+
+  QJsonObject root = doc.object();
+
+  // Anything missing (e.g. added in a later version) keeps its default, and counts are never less than 1
+  Values values;
+
+  values.render_threads = qMax(1, root.value("render_threads").toInt(defaults.render_threads));
+  values.download_threads = qMax(1, root.value("download_threads").toInt(defaults.download_threads));
+  values.task_threads = qMax(1, root.value("task_threads").toInt(defaults.task_threads));
+  values.memory_budget = static_cast<qint64>(root.value("memory_budget").toDouble(
+                                               static_cast<double>(defaults.memory_budget)));
+  values.texture_budget = static_cast<qint64>(root.value("texture_budget").toDouble(
+                                                static_cast<double>(defaults.texture_budget)));
+  values.disk_cache_quota = static_cast<qint64>(root.value("disk_cache_quota").toDouble(
+                                                  static_cast<double>(defaults.disk_cache_quota)));
+  values.decoder_prefetch_depth = qMax(0, root.value("decoder_prefetch_depth").toInt(defaults.decoder_prefetch_depth));
+  values.image_sequence_lookahead = qMax(0, root.value("image_sequence_lookahead").toInt(
+                                           defaults.image_sequence_lookahead));
+
+  int cache_priority = root.value("cache_priority").toInt(defaults.cache_priority);
+
+  if (cache_priority >= olive::kCachePrioritizeSpeed && cache_priority <= olive::kCachePrioritizeReview) {
+    values.cache_priority = static_cast<olive::CachePriority>(cache_priority);
+  } else {
+    values.cache_priority = defaults.cache_priority;
+  }
+
+  SetValues(values);
+
+  return true;
+}
+
+bool PerformanceProfile::Save()
+{
+  Values v = values();
+
+  QJsonObject root;
+  root.insert("render_threads", v.render_threads);
+  root.insert("download_threads", v.download_threads);
+  root.insert("task_threads", v.task_threads);
+  root.insert("memory_budget", static_cast<double>(v.memory_budget));
+  root.insert("texture_budget", static_cast<double>(v.texture_budget));
+  root.insert("disk_cache_quota", static_cast<double>(v.disk_cache_quota));
+  root.insert("decoder_prefetch_depth", v.decoder_prefetch_depth);
+  root.insert("image_sequence_lookahead", v.image_sequence_lookahead);
+  root.insert("cache_priority", static_cast<int>(v.cache_priority));
+
+  QFile file(Filename());
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    qWarning() << "Failed to write performance profile" << Filename();
+    return false;
+  }
+
+  file.write(QJsonDocument(root).toJson());
+
+  return true;
+}
+
+bool PerformanceProfile::AutoTune()
+{
+  Values tuned = Defaults();
+
+  // A shorter version of the default benchmark, still long enough to keep every thread busy for a moment
+  RenderBenchmark::Params params = RenderBenchmark::DefaultParams();
+  params.clips = kAutoTuneClips;
+
+  int ideal = QThread::idealThreadCount();
+
+  QVector<int> candidates;
+  candidates.append(qMax(1, ideal / 4));
+  candidates.append(qMax(1, ideal / 2));
+  candidates.append(ideal);
+
+  double best_fps = 0.0;
+  int best_threads = ideal;
+  bool ran = false;
+
+  // Fewest threads first, more threads leave less of the machine for decoding and the UI so they have to be clearly
+  // faster to be chosen
+  for (int i=0;i<candidates.size();i++) {
+    if (i > 0 && candidates.at(i) == candidates.at(i-1)) {
+      continue;
+    }
+
+    Values trial = tuned;
+    trial.render_threads = candidates.at(i);
+    trial.download_threads = candidates.at(i);
+    SetValues(trial);
+
+    RenderBenchmark benchmark(params);
+
+    if (!benchmark.Run()) {
+      qWarning().noquote() << "Failed to tune performance:" << benchmark.error();
+      continue;
+    }
+
+    ran = true;
+
+    double fps = benchmark.Throughput();
+
+    if (fps > best_fps * kAutoTuneThreadGain) {
+      best_fps = fps;
+      best_threads = candidates.at(i);
+    }
+  }
+
+  tuned.render_threads = best_threads;
+  tuned.download_threads = best_threads;
+
+  // Leave room on the disk for everything else, the frames already cached count towards the quota anyway
+  QStorageInfo storage(GetRenderCacheLocation());
+
+  if (storage.isValid()) {
+    qint64 available = storage.bytesAvailable() + olive::disk_cache_manager.size();
+
+    tuned.disk_cache_quota = qMin(kDiskCacheQuota,
+                                  static_cast<qint64>(static_cast<double>(available) * kAutoTuneDiskCacheRatio));
+  }
+
+  SetValues(tuned);
+
+  if (!ran) {
+    // Saved anyway so a machine that can't run the benchmark doesn't try again on every launch
+    Save();
+    return false;
+  }
+
+  qInfo() << "Tuned performance profile:" << best_threads << "render threads at" << best_fps << "frames/s";
+
+  return Save();
+}
+
+QString PerformanceProfile::Filename()
+{
+  QDir local_appdata_dir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+
+  // Attempt to ensure this folder exists
+  local_appdata_dir.mkpath(".");
+
+  return local_appdata_dir.filePath("performance.json");
+}
@@ -0,0 +1,130 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PERFORMANCEPROFILE_H
+#define PERFORMANCEPROFILE_H
+
+#include <QMutex>
+#include <QObject>
+
+#include "render/cacheformat.h"
+
+/**
+ * @brief Performance settings that can be changed while Olive is running, tuned for and stored on each machine
+ *
+ * The constants in config.h are a starting point that Defaults() adjusts to the machine (e.g. its thread count and
+ * physical memory). On first launch, AutoTune() runs a short RenderBenchmark to choose the render thread counts and
+ * sizes the disk cache to the disk it's on, then saves the result to Filename(), which is in the machine's local
+ * app data so each machine keeps its own. Core runs it in a process of its own (with --auto-tune) once the window is
+ * up, then calls Load() to apply the result. Load() reads it back on later launches too.
+ *
+ * SetValues() applies the budgets and the task thread pool size straight away and emits Changed(), which
+ * RendererProcessors respond to by restarting their threads with the new counts. Anything else reads its values with
+ * values() whenever it needs them. This class is thread-safe, though SetValues(), Load() and AutoTune() must be
+ * called from the main thread.
+ */
+class PerformanceProfile : public QObject
+{
+  Q_OBJECT
+public:
+  struct Values {
+    /// Threads each RendererProcessor renders frames on
+    int render_threads;
+
+    /// Threads each RendererProcessor reads rendered frames back from the GPU on
+    int download_threads;
+
+    /// Size of the thread pool TaskManager runs CPU Tasks on
+    int task_threads;
+
+    /// Budgets of ImageCache::kMemBuf and ImageCache::kTexBuf in bytes
+    qint64 memory_budget;
+    qint64 texture_budget;
+
+    /// Quota of DiskCacheManager in bytes
+    qint64 disk_cache_quota;
+
+    /// Frames each video decoder decodes ahead (see DecoderPrefetcher), 0 to disable
+    int decoder_prefetch_depth;
+
+    /// Frames of an image sequence OIIODecoder reads ahead
+    int image_sequence_lookahead;
+
+    /// Cache priority (and so cache format) that new Sequences start with
+    olive::CachePriority cache_priority;
+  };
+
+  PerformanceProfile();
+
+  /**
+   * @brief Returns the values for this machine before it's been tuned
+   */
+  static Values Defaults();
+
+  Values values();
+
+  /**
+   * @brief Apply a new set of values, this doesn't save them (see Save())
+   */
+  void SetValues(const Values& values);
+
+  /**
+   * @brief Load and apply the values saved on this machine
+   *
+   * @return
+   *
+   * FALSE if there are none yet (or they couldn't be read), in which case Defaults() are applied instead.
+   */
+  bool Load();
+
+  bool Save();
+
+  /**
+   * @brief Benchmark this machine, apply the best values found and save them
+   *
+   * Runs a few short RenderBenchmarks and blocks until they're finished (a few seconds), so it should only be run
+   * while nothing else is rendering. Returns FALSE if the benchmark couldn't run, in which case Defaults() are applied
+   * and saved so it isn't run again on every launch.
+   */
+  bool AutoTune();
+
+  /**
+   * @brief The file values are saved to on this machine
+   */
+  static QString Filename();
+
+signals:
+  /**
+   * @brief Emitted from the main thread whenever SetValues() is called
+   */
+  void Changed();
+
+private:
+  Values values_;
+
+  QMutex lock_;
+
+};
+
+namespace olive {
+extern PerformanceProfile performance_profile;
+}
+
+#endif // PERFORMANCEPROFILE_H
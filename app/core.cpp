@@ -20,21 +20,44 @@
 
 #include "core.h"
 
+#include <algorithm>
 #include <QApplication>
 #include <QCommandLineParser>
 #include <QDebug>
+#include <QEvent>
+#include <QEventLoop>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QMessageBox>
+#include <QtMath>
 #include <QHBoxLayout>
-
+#include <QRunnable>
+#include <QThreadPool>
+
+#include "common/filefunctions.h"
+#include "common/memorystats.h"
+#include "common/ringlog.h"
+#include "config/config.h"
+#include "config/performanceprofile.h"
+#include "decoder/decoderbenchmark.h"
+#include "dialog/performance/performance.h"
 #include "dialog/sequence/sequence.h"
+#include "node/input/media/media.h"
 #include "panel/panelmanager.h"
 #include "panel/project/project.h"
 #include "project/item/footage/footage.h"
 #include "project/item/sequence/sequence.h"
+#include "project/projectfile.h"
 #include "render/colorservice.h"
+#include "render/diskcachemanager.h"
+#include "render/gpubenchmark.h"
+#include "render/profiler.h"
+#include "render/renderfarmcoordinator.h"
+#include "render/renderfarmworker.h"
+#include "task/export/export.h"
 #include "task/import/import.h"
+#include "task/mirror/mirror.h"
+#include "task/proxy/proxy.h"
 #include "task/taskmanager.h"
 #include "ui/style/style.h"
 #include "undo/undostack.h"
@@ -43,15 +66,102 @@
 
 Core olive::core;
 
+/**
+ * @brief Add every Sequence below `item` to `list`
+ */
+static void ListSequences(Item* item, QList<Sequence*>* list)
+{
+  for (int i=0;i<item->child_count();i++) {
+    Item* child = item->child(i);
+
+    if (child->type() == Item::kSequence) {
+      list->append(static_cast<Sequence*>(child));
+    }
+
+    ListSequences(child, list);
+  }
+}
+
+/**
+ * @brief Add every Footage below `item` to `list`
+ */
+static void ListFootage(Item* item, QList<FootagePtr>* list)
+{
+  for (int i=0;i<item->child_count();i++) {
+    Item* child = item->child(i);
+
+    if (child->type() == Item::kFootage) {
+      list->append(std::static_pointer_cast<Footage>(item->shared_ptr_from_raw(child)));
+    }
+
+    ListFootage(child, list);
+  }
+}
+
+/**
+ * @brief Find the renderer of a Sequence whose nodes have been loaded
+ */
+static RendererProcessor* GetSequenceRenderer(Sequence* sequence)
+{
+  foreach (Node* node, sequence->nodes()) {
+    RendererProcessor* renderer = dynamic_cast<RendererProcessor*>(node);
+
+    if (renderer != nullptr) {
+      return renderer;
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * @brief Runs a function on a thread pool, for startup work the main window doesn't have to wait for
+ */
+class StartupRunnable : public QRunnable
+{
+public:
+  StartupRunnable(void (*function)()) :
+    function_(function)
+  {
+  }
+
+  virtual void run() override
+  {
+    function_();
+  }
+
+private:
+  void (*function_)();
+};
+
 Core::Core() :
   main_window_(nullptr),
+  frame_server_(nullptr),
+  headless_(false),
+  benchmark_(false),
+  benchmark_params_(RenderBenchmark::DefaultParams()),
+  decoder_benchmark_seeks_(kDecoderBenchmarkSeeks),
+  gpu_benchmark_(false),
+  auto_tune_(false),
+  render_farm_(false),
   tool_(olive::tool::kPointer),
-  snapping_(true)
+  snapping_(true),
+  render_stats_visible_(false),
+  trace_startup_(false),
+  performance_tuned_(false)
 {
+  trace_timer_.setInterval(100);
+  connect(&trace_timer_, SIGNAL(timeout()), this, SLOT(CollectTraceSamples()));
+
+  idle_timer_.setSingleShot(true);
+  idle_timer_.setInterval(kIdleRenderDelay * 1000);
+  connect(&idle_timer_, SIGNAL(timeout()), this, SLOT(StartIdleRender()));
 }
 
 void Core::Start()
 {
+  startup_timer_.start();
+
   //
   // Parse command line arguments
   //
@@ -71,11 +181,147 @@ void Core::Start()
   QCommandLineOption fullscreen_option({"f", "fullscreen"}, tr("Start in full screen mode"));
   parser.addOption(fullscreen_option);
 
+  // Create headless render options
+  QCommandLineOption render_option("render", tr("Render a sequence from the project without starting the GUI"));
+  parser.addOption(render_option);
+
+  QCommandLineOption sequence_option("sequence", tr("Sequence to render (defaults to the first)"), tr("name"));
+  parser.addOption(sequence_option);
+
+  QCommandLineOption output_option("out",
+                                   tr("File to render to, repeat to render to several files while only rendering "
+                                      "each frame once"),
+                                   tr("file"));
+  parser.addOption(output_option);
+
+  QCommandLineOption output_size_option("out-size",
+                                        tr("Resolution of each file given with --out, in the same order (defaults to "
+                                           "the sequence's)"),
+                                        tr("width>x<height"));
+  parser.addOption(output_size_option);
+
+  QCommandLineOption output_codec_option("out-codec",
+                                         tr("Codec of each file given with --out, in the same order (e.g. prores, "
+                                            "defaults to h264)"),
+                                         tr("name"));
+  parser.addOption(output_codec_option);
+
+  // Render cache shared with other machines (e.g. a render farm)
+  QCommandLineOption render_cache_option("render-cache",
+                                         tr("Use a render cache directory shared with other machines"),
+                                         tr("directory"));
+  parser.addOption(render_cache_option);
+
+  QCommandLineOption auto_tune_option("auto-tune",
+                                      tr("Benchmark this machine and save the performance settings that suit it "
+                                         "best, then exit (this is done on first launch)"));
+  parser.addOption(auto_tune_option);
+
+  // Render farm options, workers render a range each into the shared render cache
+  QCommandLineOption render_range_option("render-range",
+                                         tr("Render frames <in> to <out> of the sequence into the render cache without "
+                                            "starting the GUI (as a worker of --render-farm)"),
+                                         tr("in>-<out"));
+  parser.addOption(render_range_option);
+
+  QCommandLineOption render_farm_option("render-farm",
+                                        tr("Split the sequence into ranges and render them into the render cache given "
+                                           "with --render-cache on the workers given with --render-worker"));
+  parser.addOption(render_farm_option);
+
+  QCommandLineOption render_worker_option("render-worker",
+                                          tr("Command that starts Olive on a machine of the render farm through a "
+                                             "remote shell (e.g. \"ssh gpu01 olive\"), repeat for each machine "
+                                             "(defaults to this machine)"),
+                                          tr("command"));
+  parser.addOption(render_worker_option);
+
+  // Create benchmark options
+  QCommandLineOption benchmark_option("benchmark",
+                                      tr("Render a generated sequence without starting the GUI and report how fast it "
+                                         "rendered (and write the results to the file given with --out)"));
+  parser.addOption(benchmark_option);
+
+  QCommandLineOption tracks_option("tracks", tr("Number of tracks in the benchmark sequence"), tr("count"));
+  parser.addOption(tracks_option);
+
+  QCommandLineOption clips_option("clips", tr("Number of clips on each track of the benchmark sequence"), tr("count"));
+  parser.addOption(clips_option);
+
+  QCommandLineOption clip_length_option("clip-length",
+                                        tr("Length of each clip in the benchmark sequence"),
+                                        tr("frames"));
+  parser.addOption(clip_length_option);
+
+  QCommandLineOption effects_option("effects",
+                                    tr("Number of effects on each clip in the benchmark sequence"),
+                                    tr("count"));
+  parser.addOption(effects_option);
+
+  QCommandLineOption size_option("size", tr("Resolution of the benchmark sequence"), tr("width>x<height"));
+  parser.addOption(size_option);
+
+  QCommandLineOption format_option("format",
+                                   tr("Pixel format of the benchmark sequence (rgba8, rgba16u, rgba16f, rgba32f or rgb10a2)"),
+                                   tr("format"));
+  parser.addOption(format_option);
+
+  QCommandLineOption decoder_benchmark_option("decoder-benchmark",
+                                              tr("Time opening, indexing, decoding and seeking every file in a "
+                                                 "directory of media without starting the GUI (and write the results "
+                                                 "to the file given with --out as CSV, or JSON if it ends in .json)"),
+                                              tr("directory"));
+  parser.addOption(decoder_benchmark_option);
+
+  QCommandLineOption seeks_option("seeks", tr("Number of random seeks per file in the decoder benchmark"), tr("count"));
+  parser.addOption(seeks_option);
+
+  QCommandLineOption gpu_benchmark_option("gpu-benchmark",
+                                          tr("Time uploads, readbacks, blits and node passes on the GPU without "
+                                             "starting the GUI, at the resolution and pixel format given with --size "
+                                             "and --format or a few common ones (and write the results to the file "
+                                             "given with --out as CSV, or JSON if it ends in .json)"));
+  parser.addOption(gpu_benchmark_option);
+
+  QCommandLineOption trace_startup_option("trace-startup", tr("Log how long each stage of startup takes"));
+  parser.addOption(trace_startup_option);
+
+  QCommandLineOption log_dump_option("log-dump",
+                                     tr("Write the most recent messages logged by each thread to a binary file on exit "
+                                        "(or crash) for post-mortem analysis"),
+                                     tr("file"));
+  parser.addOption(log_dump_option);
+
+  QCommandLineOption memory_stats_option("memory-stats",
+                                         tr("Count memory use per subsystem from startup (see the Memory panel)"));
+  parser.addOption(memory_stats_option);
+
+  QCommandLineOption frame_server_option("frame-server",
+                                         tr("Publish the viewer's frames to other processes through shared memory "
+                                            "with this name"),
+                                         tr("name"));
+  parser.addOption(frame_server_option);
+
   // Parse options
   parser.process(*app);
 
   QStringList args = parser.positionalArguments();
 
+  trace_startup_ = parser.isSet(trace_startup_option);
+
+  if (parser.isSet(log_dump_option)) {
+    olive::ring_log.SetDumpFilename(parser.value(log_dump_option));
+  }
+
+  if (parser.isSet(memory_stats_option)) {
+    // Never disabled, so the totals include everything from here on
+    olive::memory_stats.Enable();
+  }
+
+  if (parser.isSet(render_cache_option)) {
+    SetSharedRenderCacheLocation(parser.value(render_cache_option));
+  }
+
   // Detect project to load on startup
   if (!args.isEmpty()) {
     startup_project_ = args.first();
@@ -84,6 +330,119 @@ void Core::Start()
   // Declare custom types for Qt signal/slot syste
   DeclareTypesForQt();
 
+  // Apply this machine's performance settings before anything starts using them
+  performance_tuned_ = olive::performance_profile.Load();
+
+  if (parser.isSet(benchmark_option)) {
+    headless_ = true;
+    benchmark_ = true;
+    render_output_ = parser.value(output_option);
+
+    // Invalid values are left as 0 (or PIX_FMT_INVALID) for RenderBenchmark::Run() to reject
+    if (parser.isSet(tracks_option)) {
+      benchmark_params_.tracks = parser.value(tracks_option).toInt();
+    }
+
+    if (parser.isSet(clips_option)) {
+      benchmark_params_.clips = parser.value(clips_option).toInt();
+    }
+
+    if (parser.isSet(clip_length_option)) {
+      benchmark_params_.clip_length = parser.value(clip_length_option).toInt();
+    }
+
+    if (parser.isSet(effects_option)) {
+      benchmark_params_.effects = parser.value(effects_option).toInt();
+    }
+
+    if (parser.isSet(size_option)) {
+      QStringList size = parser.value(size_option).split('x');
+
+      benchmark_params_.width = (size.size() == 2) ? size.at(0).toInt() : 0;
+      benchmark_params_.height = (size.size() == 2) ? size.at(1).toInt() : 0;
+    }
+
+    if (parser.isSet(format_option)) {
+      benchmark_params_.format = RenderBenchmark::FormatFromName(parser.value(format_option));
+    }
+
+    // Nothing from the GUI is started, RunHeadless() takes it from here
+    return;
+  }
+
+  if (parser.isSet(decoder_benchmark_option)) {
+    headless_ = true;
+    decoder_benchmark_dir_ = parser.value(decoder_benchmark_option);
+    render_output_ = parser.value(output_option);
+
+    // Invalid values are set to -1 for DecoderBenchmark::Run() to reject
+    if (parser.isSet(seeks_option)) {
+      bool ok;
+      decoder_benchmark_seeks_ = parser.value(seeks_option).toInt(&ok);
+
+      if (!ok) {
+        decoder_benchmark_seeks_ = -1;
+      }
+    }
+
+    // Nothing from the GUI is started, RunHeadless() takes it from here
+    return;
+  }
+
+  if (parser.isSet(gpu_benchmark_option)) {
+    headless_ = true;
+    gpu_benchmark_ = true;
+    render_output_ = parser.value(output_option);
+
+    // Invalid values are passed on as an empty size (or PIX_FMT_INVALID) for GPUBenchmark::Run() to reject
+    if (parser.isSet(size_option)) {
+      QStringList size = parser.value(size_option).split('x');
+
+      if (size.size() == 2) {
+        gpu_benchmark_sizes_.append(QSize(size.at(0).toInt(), size.at(1).toInt()));
+      } else {
+        gpu_benchmark_sizes_.append(QSize(0, 0));
+      }
+    }
+
+    if (parser.isSet(format_option)) {
+      gpu_benchmark_formats_.append(RenderBenchmark::FormatFromName(parser.value(format_option)));
+    }
+
+    // Nothing from the GUI is started, RunHeadless() takes it from here
+    return;
+  }
+
+  if (parser.isSet(auto_tune_option)) {
+    headless_ = true;
+    auto_tune_ = true;
+
+    // Nothing from the GUI is started, RunHeadless() takes it from here
+    return;
+  }
+
+  if (parser.isSet(render_range_option) || parser.isSet(render_farm_option)) {
+    headless_ = true;
+    render_sequence_ = parser.value(sequence_option);
+    render_range_ = parser.value(render_range_option);
+    render_farm_ = parser.isSet(render_farm_option);
+    render_workers_ = parser.values(render_worker_option);
+
+    // Nothing from the GUI is started, RunHeadless() takes it from here
+    return;
+  }
+
+  if (parser.isSet(render_option)) {
+    headless_ = true;
+    render_sequence_ = parser.value(sequence_option);
+    render_output_ = parser.value(output_option);
+    render_outputs_ = parser.values(output_option);
+    render_output_sizes_ = parser.values(output_size_option);
+    render_output_codecs_ = parser.values(output_codec_option);
+
+    // Nothing from the GUI is started, RunHeadless() takes it from here
+    return;
+  }
 
   //
   // Start GUI (FIXME CLI mode)
@@ -91,16 +450,278 @@ void Core::Start()
 
   StartGUI(parser.isSet(fullscreen_option));
 
-  // Create new project on startup
-  // FIXME: Load project from startup_project_ instead if not empty
-  AddOpenProject(std::make_shared<Project>());
+  if (parser.isSet(frame_server_option)) {
+    StartFrameServer(parser.value(frame_server_option));
+  }
+
+  RecoverAutosavedProjects();
+
+  // Open the project from the command line, or create a new project on startup if none were recovered
+  if ((startup_project_.isEmpty() || !OpenProject(startup_project_)) && open_projects_.isEmpty()) {
+    AddOpenProject(std::make_shared<Project>());
+  }
+
+  StartupMilestone("Project opened");
+
+  // The event loop starts once we return, and the window is painted before this is called
+  QTimer::singleShot(0, this, SLOT(StartupFinished()));
 }
 
 void Core::Stop()
 {
+  // Nothing left to be idle for
+  qApp->removeEventFilter(this);
+  UserActive();
+  idle_timer_.stop();
+
+  // Projects are being closed normally, so their autosaves are no longer needed
+  qDeleteAll(autosaves_);
+  autosaves_.clear();
+
+  // The frame server reads back the viewer's textures, so it has to stop before the viewer goes
+  if (frame_server_ != nullptr) {
+    frame_server_->Cancel();
+    delete frame_server_;
+    frame_server_ = nullptr;
+  }
+
   delete main_window_;
 }
 
+bool Core::IsHeadless() const
+{
+  return headless_;
+}
+
+int Core::RunHeadless()
+{
+  if (auto_tune_) {
+    return olive::performance_profile.AutoTune() ? 0 : 1;
+  }
+
+  if (benchmark_) {
+    RenderBenchmark benchmark(benchmark_params_);
+
+    if (!benchmark.Run()) {
+      qCritical().noquote() << benchmark.error();
+      return 1;
+    }
+
+    qInfo().noquote() << benchmark.Report();
+
+    if (!render_output_.isEmpty() && !benchmark.WriteReport(render_output_)) {
+      qCritical() << "Failed to write benchmark results to" << render_output_;
+      return 1;
+    }
+
+    return 0;
+  }
+
+  if (!decoder_benchmark_dir_.isEmpty()) {
+    DecoderBenchmark benchmark(decoder_benchmark_dir_);
+    benchmark.set_seeks(decoder_benchmark_seeks_);
+
+    if (!benchmark.Run()) {
+      qCritical().noquote() << benchmark.error();
+      return 1;
+    }
+
+    qInfo().noquote() << benchmark.Report();
+
+    if (!render_output_.isEmpty() && !benchmark.WriteReport(render_output_)) {
+      qCritical() << "Failed to write benchmark results to" << render_output_;
+      return 1;
+    }
+
+    return 0;
+  }
+
+  if (gpu_benchmark_) {
+    GPUBenchmark benchmark;
+
+    if (!gpu_benchmark_sizes_.isEmpty()) {
+      benchmark.set_sizes(gpu_benchmark_sizes_);
+    }
+
+    if (!gpu_benchmark_formats_.isEmpty()) {
+      benchmark.set_formats(gpu_benchmark_formats_);
+    }
+
+    if (!benchmark.Run()) {
+      qCritical().noquote() << benchmark.error();
+      return 1;
+    }
+
+    qInfo().noquote() << benchmark.Report();
+
+    if (!render_output_.isEmpty() && !benchmark.WriteReport(render_output_)) {
+      qCritical() << "Failed to write benchmark results to" << render_output_;
+      return 1;
+    }
+
+    return 0;
+  }
+
+  if (startup_project_.isEmpty()) {
+    qCritical() << "No project specified to render";
+    return 1;
+  }
+
+  // Render farms only render into the cache
+  if (render_output_.isEmpty() && !render_farm_ && render_range_.isEmpty()) {
+    qCritical() << "No output file specified, use --out";
+    return 1;
+  }
+
+  if (!QFileInfo::exists(startup_project_)) {
+    qCritical() << "Project" << startup_project_ << "does not exist";
+    return 1;
+  }
+
+  QString error;
+  ProjectPtr project = ProjectFile::Load(startup_project_, &error);
+
+  if (project == nullptr) {
+    qCritical().noquote() << error;
+    return 1;
+  }
+
+  // Find the sequence to render (the first if none was specified)
+  QList<Sequence*> sequences;
+  ListSequences(project->root(), &sequences);
+
+  Sequence* sequence = nullptr;
+
+  foreach (Sequence* s, sequences) {
+    if (render_sequence_.isEmpty() || s->name() == render_sequence_) {
+      sequence = s;
+      break;
+    }
+  }
+
+  if (sequence == nullptr) {
+    qCritical() << "Project" << startup_project_ << "has no sequence named" << render_sequence_;
+    return 1;
+  }
+
+  // Only the nodes of the sequence being rendered are loaded
+  RendererProcessor* renderer = sequence->LoadDeferredGraph() ? GetSequenceRenderer(sequence) : nullptr;
+
+  if (renderer == nullptr) {
+    qCritical() << "Sequence" << sequence->name() << "has no renderer";
+    return 1;
+  }
+
+  if (render_farm_) {
+    // The workers load the sequence themselves, only its length is needed here
+    int64_t frame_count = qCeil((renderer->length_input()->get_value(0).toRational()
+                                 / sequence->video_time_base()).toDouble());
+
+    sequence->Release();
+
+    RenderFarmCoordinator coordinator(startup_project_, render_sequence_, frame_count, render_workers_);
+
+    if (!coordinator.Run()) {
+      qCritical().noquote() << coordinator.error();
+      return 1;
+    }
+
+    return 0;
+  }
+
+  if (!render_range_.isEmpty()) {
+    QStringList range = render_range_.split('-');
+    bool start_ok = false;
+    bool end_ok = false;
+    int64_t start = 0;
+    int64_t end = 0;
+
+    if (range.size() == 2) {
+      start = range.at(0).toLongLong(&start_ok);
+      end = range.at(1).toLongLong(&end_ok);
+    }
+
+    if (!start_ok || !end_ok) {
+      qCritical() << "Invalid range" << render_range_ << "- use <in>-<out>";
+      sequence->Release();
+      return 1;
+    }
+
+    RenderFarmWorker worker(renderer, start, end);
+
+    bool rendered = worker.Run();
+
+    sequence->Release();
+
+    if (!rendered) {
+      qCritical().noquote() << worker.error();
+      return 1;
+    }
+
+    return 0;
+  }
+
+  QVector<ExportParams> targets;
+
+  for (int i=0;i<render_outputs_.size();i++) {
+    ExportParams params;
+    params.filename = render_outputs_.at(i);
+    params.width = sequence->video_width();
+    params.height = sequence->video_height();
+    params.timebase = sequence->video_time_base();
+
+    if (i < render_output_sizes_.size()) {
+      QStringList size = render_output_sizes_.at(i).split('x');
+      bool width_ok = false;
+      bool height_ok = false;
+
+      if (size.size() == 2) {
+        params.width = size.at(0).toInt(&width_ok);
+        params.height = size.at(1).toInt(&height_ok);
+      }
+
+      if (!width_ok || !height_ok || params.width <= 0 || params.height <= 0) {
+        qCritical() << "Invalid size" << render_output_sizes_.at(i) << "for" << params.filename;
+        sequence->Release();
+        return 1;
+      }
+    }
+
+    if (i < render_output_codecs_.size()) {
+      const AVCodecDescriptor* desc = avcodec_descriptor_get_by_name(render_output_codecs_.at(i).toUtf8().constData());
+
+      if (desc == nullptr || desc->type != AVMEDIA_TYPE_VIDEO) {
+        qCritical() << "Unknown codec" << render_output_codecs_.at(i) << "for" << params.filename;
+        sequence->Release();
+        return 1;
+      }
+
+      params.codec = desc->id;
+    }
+
+    targets.append(params);
+  }
+
+  // The renderer creates its own offscreen context since there's no GUI
+  ExportTask task(renderer, targets);
+
+  QEventLoop loop;
+  connect(&task, SIGNAL(Finished()), &loop, SLOT(quit()));
+
+  if (task.Start()) {
+    loop.exec();
+  }
+
+  sequence->Release();
+
+  if (task.status() != Task::kFinished) {
+    qCritical().noquote() << task.error();
+    return 1;
+  }
+
+  return 0;
+}
+
 olive::MainWindow *Core::main_window()
 {
   return main_window_;
@@ -126,6 +747,16 @@ const bool &Core::snapping()
   return snapping_;
 }
 
+bool Core::IsRecordingTrace()
+{
+  return olive::profiler.IsTracing();
+}
+
+bool Core::render_stats_visible()
+{
+  return render_stats_visible_;
+}
+
 void Core::StartModalTask(Task *t)
 {
   QDialog dialog(main_window_);
@@ -160,6 +791,44 @@ void Core::SetSnapping(const bool &b)
   emit SnappingChanged(snapping_);
 }
 
+void Core::SetRenderStatsVisible(bool visible)
+{
+  render_stats_visible_ = visible;
+
+  emit RenderStatsVisibleChanged(render_stats_visible_);
+}
+
+void Core::SetTraceRecording(bool record)
+{
+  if (record == olive::profiler.IsTracing()) {
+    return;
+  }
+
+  if (record) {
+    QString filename = QFileDialog::getSaveFileName(main_window_,
+                                                    tr("Record performance trace..."),
+                                                    QString(),
+                                                    tr("Chrome Trace Files (*.json)"));
+
+    if (filename.isEmpty()) {
+      return;
+    }
+
+    trace_filename_ = filename;
+
+    olive::profiler.StartTrace();
+    trace_timer_.start();
+  } else {
+    trace_timer_.stop();
+
+    if (!olive::profiler.StopTrace(trace_filename_)) {
+      QMessageBox::critical(main_window_,
+                            tr("Failed to record trace"),
+                            tr("Failed to write trace to \"%1\"").arg(trace_filename_));
+    }
+  }
+}
+
 void Core::DialogImportShow()
 {
   // Open dialog for user to select files
@@ -186,6 +855,134 @@ void Core::DialogImportShow()
   }
 }
 
+void Core::DialogExportShow()
+{
+  ProjectPanel* active_project_panel = olive::panel_focus_manager->MostRecentlyFocused<ProjectPanel>();
+
+  if (active_project_panel == nullptr) {
+    QMessageBox::critical(main_window_, tr("Failed to export"), tr("Failed to find active Project panel"));
+    return;
+  }
+
+  // Export the first selected sequence
+  Sequence* sequence = nullptr;
+
+  foreach (Item* item, active_project_panel->SelectedItems()) {
+    if (item->type() == Item::kSequence) {
+      sequence = static_cast<Sequence*>(item);
+      break;
+    }
+  }
+
+  if (sequence == nullptr) {
+    QMessageBox::critical(main_window_, tr("Failed to export"), tr("Select a sequence to export"));
+    return;
+  }
+
+  if (!sequence->LoadDeferredGraph()) {
+    QMessageBox::critical(main_window_, tr("Failed to export"), tr("Failed to load this sequence"));
+    return;
+  }
+
+  RendererProcessor* renderer = GetSequenceRenderer(sequence);
+
+  if (renderer == nullptr) {
+    QMessageBox::critical(main_window_, tr("Failed to export"), tr("This sequence has no renderer"));
+    return;
+  }
+
+  QString filename = QFileDialog::getSaveFileName(main_window_,
+                                                  tr("Export sequence..."),
+                                                  QString(),
+                                                  tr("Video Files (*.mp4 *.mov *.mkv)"));
+
+  if (filename.isEmpty()) {
+    return;
+  }
+
+  if (QFileInfo(filename).suffix().isEmpty()) {
+    filename.append(QStringLiteral(".mp4"));
+  }
+
+  ExportParams params;
+  params.filename = filename;
+  params.width = sequence->video_width();
+  params.height = sequence->video_height();
+  params.timebase = sequence->video_time_base();
+
+  olive::task_manager.AddTask(std::make_shared<ExportTask>(renderer, params));
+}
+
+void Core::DialogPerformanceShow()
+{
+  PerformanceDialog pd(main_window_);
+  pd.exec();
+}
+
+void Core::DialogOpenProjectShow()
+{
+  QString filename = QFileDialog::getOpenFileName(main_window_,
+                                                  tr("Open project..."),
+                                                  QString(),
+                                                  tr("Olive Projects (*.ove)"));
+
+  if (!filename.isEmpty()) {
+    OpenProject(filename);
+  }
+}
+
+void Core::SaveActiveProject()
+{
+  Project* project = GetActiveProject();
+
+  if (project == nullptr) {
+    QMessageBox::critical(main_window_, tr("Failed to save project"), tr("Failed to find active Project panel"));
+    return;
+  }
+
+  if (project->filename().isEmpty()) {
+    SaveActiveProjectAs();
+  } else {
+    SaveProject(project, project->filename());
+  }
+}
+
+void Core::SaveActiveProjectAs()
+{
+  Project* project = GetActiveProject();
+
+  if (project == nullptr) {
+    QMessageBox::critical(main_window_, tr("Failed to save project"), tr("Failed to find active Project panel"));
+    return;
+  }
+
+  QString filename = QFileDialog::getSaveFileName(main_window_,
+                                                  tr("Save project as..."),
+                                                  project->filename(),
+                                                  tr("Olive Projects (*.ove);;XML Files (*.xml)"));
+
+  if (filename.isEmpty()) {
+    return;
+  }
+
+  if (QFileInfo(filename).suffix().compare(QStringLiteral("xml"), Qt::CaseInsensitive) == 0) {
+    // XML is only an export, the project is still saved wherever it was before
+    QString error;
+
+    if (!ProjectFile::ExportXml(project, filename, &error)) {
+      QMessageBox::critical(main_window_, tr("Failed to export project"), error);
+    }
+
+    return;
+  }
+
+  if (QFileInfo(filename).suffix().isEmpty()) {
+    filename.append(QStringLiteral(".ove"));
+  }
+
+  SaveProject(project, filename);
+}
+
 void Core::CreateNewFolder()
 {
   // Locate the most recently focused Project panel (assume that's the panel the user wants to import into)
@@ -225,6 +1022,7 @@ void Core::CreateNewFolder()
 #include "node/output/track/track.h"
 #include "node/output/viewer/viewer.h"
 #include "node/processor/renderer/renderer.h"
+#include "node/processor/renderer/renderercachecodec.h"
 #include "panel/panelmanager.h"
 #include "panel/node/node.h"
 #include "panel/viewer/viewer.h"
@@ -285,8 +1083,8 @@ void Core::CreateNewSequence()
                       olive::RenderMode::kOffline,
                       2);
 
-    // Set the "cache name" only here to aid the cache ID's uniqueness
-    rp->SetCacheName(new_sequence->name());
+    rp->SetCacheFormat(RendererCacheCodec::FormatForPriority(new_sequence->cache_priority()));
+
     rp->SetTimebase(new_sequence->video_time_base());
 
     new_sequence->AddNode(rp);
@@ -298,8 +1096,8 @@ void Core::CreateNewSequence()
     TrackOutput* to = new TrackOutput();
     new_sequence->AddNode(to);
 
-    // Connect track to renderer
-    NodeParam::ConnectEdge(to->texture_output(), rp->texture_input());
+    // Connect the composite of every track to the renderer
+    NodeParam::ConnectEdge(tb->texture_output(), rp->texture_input());
 
     // Connect renderer to viewer
     NodeParam::ConnectEdge(rp->texture_output(), vo->texture_input());
@@ -317,21 +1115,133 @@ void Core::CreateNewSequence()
     new_sequence->AddNode(opac);
     // End test code
 
-    vo->AttachViewer(olive::panel_focus_manager->MostRecentlyFocused<ViewerPanel>());
-    tb->AttachTimeline(olive::panel_focus_manager->MostRecentlyFocused<TimelinePanel>());
-    olive::panel_focus_manager->MostRecentlyFocused<NodePanel>()->SetGraph(new_sequence.get());
+    OpenSequence(new_sequence.get());
 
     olive::undo_stack.push(aic);
   }
 }
 
+void Core::OpenSequence(Sequence *sequence)
+{
+  if (!sequence->LoadDeferredGraph()) {
+    QMessageBox::critical(main_window_,
+                          tr("Failed to open sequence"),
+                          tr("Failed to load \"%1\" from the project file").arg(sequence->name()));
+    return;
+  }
+
+  foreach (Node* node, sequence->nodes()) {
+    ViewerOutput* viewer = dynamic_cast<ViewerOutput*>(node);
+
+    if (viewer != nullptr) {
+      if (!sequence->audio_time_base().isNull()) {
+        viewer->SetSampleRate(qRound(sequence->audio_time_base().flipped().toDouble()));
+      }
+
+      viewer->AttachViewer(olive::panel_focus_manager->MostRecentlyFocused<ViewerPanel>());
+    }
+
+    TimelineOutput* timeline = dynamic_cast<TimelineOutput*>(node);
+
+    if (timeline != nullptr) {
+      timeline->AttachTimeline(olive::panel_focus_manager->MostRecentlyFocused<TimelinePanel>());
+    }
+
+    // Copy media on network storage to local storage so decoding it doesn't wait on the network
+    MediaInput* media = dynamic_cast<MediaInput*>(node);
+
+    if (media != nullptr && media->footage() != nullptr) {
+      MirrorTask::Queue(media->footage()->filename());
+    }
+  }
+
+  olive::panel_focus_manager->MostRecentlyFocused<NodePanel>()->SetGraph(sequence);
+
+  recent_sequences_.removeAll(sequence);
+  recent_sequences_.prepend(sequence);
+}
+
 void Core::AddOpenProject(ProjectPtr p)
 {
   open_projects_.append(p);
 
+  if (!headless_) {
+    autosaves_.append(new ProjectAutosave(p.get(), this));
+
+    // Proxies aren't saved in the project, attach the ones its footage already has in the media cache
+    QList<FootagePtr> footage;
+    ListFootage(p->root(), &footage);
+
+    foreach (FootagePtr f, footage) {
+      if (ProxyTask::CanHaveProxies(f.get())) {
+        olive::task_manager.AddTask(std::make_shared<ProxyTask>(f));
+      }
+    }
+  }
+
   emit ProjectOpened(p.get());
 }
 
+void Core::RecoverAutosavedProjects()
+{
+  foreach (const QString& journal, ProjectAutosave::FindRecoverable()) {
+    QString original = ProjectAutosave::GetOriginalFilename(journal);
+
+    QString project_name = original.isEmpty() ? tr("an untitled project") : QFileInfo(original).fileName();
+
+    if (QMessageBox::question(main_window_,
+                              tr("Recover Project"),
+                              tr("Olive didn't close properly while %1 was open. Would you like to recover it from "
+                                 "its last autosave?").arg(project_name),
+                              QMessageBox::Yes | QMessageBox::No) == QMessageBox::Yes) {
+      QString error;
+
+      ProjectPtr project = ProjectAutosave::Recover(journal, &error);
+
+      if (project == nullptr) {
+        // Leave the autosave where it is so recovering it can be tried again
+        QMessageBox::critical(main_window_, tr("Failed to recover project"), error);
+        continue;
+      }
+
+      AddOpenProject(project);
+    }
+
+    ProjectAutosave::DiscardJournal(journal);
+  }
+}
+
+bool Core::OpenProject(const QString &filename)
+{
+  QString error;
+
+  ProjectPtr project = ProjectFile::Load(filename, &error);
+
+  if (project == nullptr) {
+    QMessageBox::critical(main_window_, tr("Failed to open project"), error);
+    return false;
+  }
+
+  AddOpenProject(project);
+
+  return true;
+}
+
+bool Core::SaveProject(Project *p, const QString &filename)
+{
+  QString error;
+
+  if (!ProjectFile::Save(p, filename, &error)) {
+    QMessageBox::critical(main_window_, tr("Failed to save project"), error);
+    return false;
+  }
+
+  p->set_filename(filename);
+  p->set_name(QFileInfo(filename).completeBaseName());
+
+  return true;
+}
+
 void Core::DeclareTypesForQt()
 {
   qRegisterMetaType<Task::Status>("Task::Status");
@@ -342,9 +1252,20 @@ void Core::DeclareTypesForQt()
 
 void Core::StartGUI(bool full_screen)
 {
+  // Neither of these are needed to show the window, so they run in the background while it's created
+  QThreadPool* io_pool = olive::task_manager.thread_pool(Task::kCategoryIO);
+
+  // Parse the OCIO config before the first viewer needs it
+  io_pool->start(new StartupRunnable(ColorService::Init));
+
+  // Rebuild the render cache's index (this also enforces the cache quota)
+  io_pool->start(new StartupRunnable([]() { olive::disk_cache_manager.Init(); }));
+
   // Set UI style
   olive::style::AppSetDefault();
 
+  StartupMilestone("Style loaded");
+
   // Set up shared menus
   olive::menu_shared.Initialize();
 
@@ -365,11 +1286,33 @@ void Core::StartGUI(bool full_screen)
     main_window_->showMaximized();
   }
 
+  StartupMilestone("Main window shown");
+
   // When a new project is opened, update the mainwindow
   connect(this, SIGNAL(ProjectOpened(Project*)), main_window_, SLOT(ProjectOpen(Project*)));
 
-  // Initialize color service
-  ColorService::Init();
+  if (kUseIdleRender) {
+    qApp->installEventFilter(this);
+    idle_timer_.start();
+  }
+}
+
+void Core::StartFrameServer(const QString &name)
+{
+  ViewerPanel* viewer = olive::panel_focus_manager->MostRecentlyFocused<ViewerPanel>();
+
+  // Every context shares with the global one in GUI mode, so the viewer's textures can be read back from ours
+  QOpenGLContext* share_ctx = QOpenGLContext::globalShareContext();
+
+  if (viewer == nullptr || share_ctx == nullptr) {
+    qWarning() << "Failed to start frame server" << name;
+    return;
+  }
+
+  frame_server_ = new FrameServer(share_ctx, name);
+  frame_server_->StartThread();
+
+  connect(viewer, SIGNAL(TextureChanged(RenderTexturePtr)), frame_server_, SLOT(SetTexture(RenderTexturePtr)));
 }
 
 Project *Core::GetActiveProject()
@@ -385,3 +1328,134 @@ Project *Core::GetActiveProject()
   // Otherwise, return the project panel's project (which may be nullptr but in most cases shouldn't be)
   return active_project_panel->project();
 }
+
+void Core::StartupMilestone(const char *name)
+{
+  if (trace_startup_) {
+    qInfo() << "Startup:" << name << "after" << startup_timer_.elapsed() << "ms";
+  }
+}
+
+void Core::StartupFinished()
+{
+  StartupMilestone("First frame");
+
+  // Tuning renders for several seconds, so it's done by a process of its own rather than holding up the window
+  if (!performance_tuned_) {
+    QProcess* process = new QProcess(this);
+
+    process->setProcessChannelMode(QProcess::ForwardedChannels);
+
+    connect(process,
+            SIGNAL(finished(int, QProcess::ExitStatus)),
+            this,
+            SLOT(AutoTuneFinished(int, QProcess::ExitStatus)));
+
+    process->start(QCoreApplication::applicationFilePath(), QStringList(QStringLiteral("--auto-tune")));
+  }
+}
+
+void Core::AutoTuneFinished(int exit_code, QProcess::ExitStatus exit_status)
+{
+  sender()->deleteLater();
+
+  if (exit_status == QProcess::CrashExit) {
+    // Nothing was saved, save the defaults that are in use so a benchmark that crashes isn't run on every launch
+    qWarning() << "Performance tuning crashed, using the default performance settings";
+    performance_tuned_ = olive::performance_profile.Save();
+    return;
+  }
+
+  if (exit_code != 0) {
+    qWarning() << "Performance tuning failed, using the default performance settings";
+  }
+
+  // Saved either way, the running renderers pick up the new thread counts in place
+  performance_tuned_ = olive::performance_profile.Load();
+}
+
+void Core::CollectTraceSamples()
+{
+  // The samples are kept for the trace, we don't need them here
+  olive::profiler.Collect();
+}
+
+bool Core::eventFilter(QObject *watched, QEvent *event)
+{
+  switch (event->type()) {
+  case QEvent::KeyPress:
+  case QEvent::MouseButtonPress:
+  case QEvent::MouseMove:
+  case QEvent::Wheel:
+  case QEvent::TabletPress:
+  case QEvent::TabletMove:
+  case QEvent::TouchBegin:
+    UserActive();
+    break;
+  default:
+    break;
+  }
+
+  return QObject::eventFilter(watched, event);
+}
+
+void Core::UserActive()
+{
+  // Later Tasks are waiting on earlier ones, so they're paused first to keep them from starting
+  for (int i=idle_tasks_.size()-1;i>=0;i--) {
+    if (idle_tasks_.at(i) != nullptr) {
+      idle_tasks_.at(i)->Pause();
+    }
+  }
+
+  idle_tasks_.clear();
+
+  idle_timer_.start();
+}
+
+void Core::StartIdleRender()
+{
+  QList<Sequence*> sequences;
+
+  foreach (ProjectPtr project, open_projects_) {
+    ListSequences(project->root(), &sequences);
+  }
+
+  // Sequences that have never been opened aren't loaded, and loading every one of them would take too much memory
+  QList<Sequence*> loaded;
+
+  foreach (Sequence* sequence, sequences) {
+    if (!sequence->HasDeferredGraph()) {
+      loaded.append(sequence);
+    }
+  }
+
+  std::stable_sort(loaded.begin(), loaded.end(), [this](Sequence* a, Sequence* b) {
+    int a_index = recent_sequences_.indexOf(a);
+    int b_index = recent_sequences_.indexOf(b);
+
+    return a_index >= 0 && (b_index < 0 || a_index < b_index);
+  });
+
+  // One at a time, the renderers all share the GPU and the disk cache anyway
+  IdleRenderTask* previous = nullptr;
+
+  foreach (Sequence* sequence, loaded) {
+    RendererProcessor* renderer = GetSequenceRenderer(sequence);
+
+    if (renderer == nullptr) {
+      continue;
+    }
+
+    std::shared_ptr<IdleRenderTask> task = std::make_shared<IdleRenderTask>(sequence, renderer);
+
+    if (previous != nullptr) {
+      task->AddDependency(previous);
+    }
+
+    previous = task.get();
+    idle_tasks_.append(task.get());
+
+    olive::task_manager.AddTask(task);
+  }
+}
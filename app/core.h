@@ -21,11 +21,23 @@
 #ifndef CORE_H
 #define CORE_H
 
+#include <QElapsedTimer>
 #include <QList>
-
+#include <QPointer>
+#include <QProcess>
+#include <QSize>
+#include <QStringList>
+#include <QTimer>
+#include <QVector>
+
+#include "project/item/sequence/sequence.h"
 #include "project/project.h"
+#include "project/projectautosave.h"
 #include "project/projectviewmodel.h"
+#include "render/frameserver.h"
+#include "render/renderbenchmark.h"
 #include "window/mainwindow/mainwindow.h"
+#include "task/idlerender/idlerender.h"
 #include "task/task.h"
 #include "tool/tool.h"
 
@@ -63,6 +75,24 @@ public:
    */
   void Stop();
 
+  /**
+   * @brief Returns whether Start() was asked to render from the command line instead of starting the GUI
+   *
+   * If this is true, call RunHeadless() rather than entering the application's event loop.
+   */
+  bool IsHeadless() const;
+
+  /**
+   * @brief Render the sequence given on the command line (or run a benchmark with --benchmark, --decoder-benchmark or
+   * --gpu-benchmark, tune with --auto-tune, or fill the render cache as a render farm with --render-range or
+   * --render-farm) without a GUI
+   *
+   * @return
+   *
+   * Exit code for the application, 0 if the render succeeded.
+   */
+  int RunHeadless();
+
   /**
    * @brief Retrieve main window instance
    *
@@ -92,6 +122,16 @@ public:
    */
   const bool& snapping();
 
+  /**
+   * @brief Returns whether a performance trace is being recorded (see SetTraceRecording())
+   */
+  bool IsRecordingTrace();
+
+  /**
+   * @brief Returns whether viewers show render statistics over the image
+   */
+  bool render_stats_visible();
+
   /**
    * @brief Starts a modal task
    *
@@ -101,6 +141,11 @@ public:
    */
   void StartModalTask(Task* t);
 
+  /**
+   * @brief Show a Sequence in the viewer, timeline and node panels, loading its nodes first if they haven't been
+   */
+  void OpenSequence(Sequence* sequence);
+
 public slots:
   /**
    * @brief Set the current application-wide tool
@@ -114,11 +159,48 @@ public slots:
    */
   void SetSnapping(const bool& b);
 
+  /**
+   * @brief Start or stop recording a performance trace of rendering and decoding
+   *
+   * Starting asks where to save the trace, which is written once recording stops (see Profiler::StopTrace()).
+   */
+  void SetTraceRecording(bool record);
+
+  /**
+   * @brief Set whether viewers show render statistics over the image (see ViewerStatsOverlay)
+   */
+  void SetRenderStatsVisible(bool visible);
+
+  /**
+   * @brief Show a dialog for opening a project file
+   */
+  void DialogOpenProjectShow();
+
+  /**
+   * @brief Save the active project, asking where to if it's never been saved
+   */
+  void SaveActiveProject();
+
+  /**
+   * @brief Save the active project to a new file (or export it as XML if the file ends in ".xml")
+   */
+  void SaveActiveProjectAs();
+
   /**
    * @brief Open the import footage dialog and import the files selected (runs ImportFiles())
    */
   void DialogImportShow();
 
+  /**
+   * @brief Show a dialog for exporting the sequence selected in the active Project panel
+   */
+  void DialogExportShow();
+
+  /**
+   * @brief Show a dialog for editing this machine's PerformanceProfile
+   */
+  void DialogPerformanceShow();
+
   /**
    * @brief Create a new folder in the currently active project
    */
@@ -149,12 +231,38 @@ signals:
    */
   void SnappingChanged(const bool& b);
 
+  /**
+   * @brief Signal emitted when viewers start or stop showing render statistics
+   */
+  void RenderStatsVisibleChanged(bool visible);
+
+protected:
+  /**
+   * @brief Watches the application's input to pause idle rendering as soon as the user comes back
+   */
+  virtual bool eventFilter(QObject* watched, QEvent* event) override;
+
 private:
   /**
    * @brief Creates an empty project and adds it to the "open projects"
    */
   void AddOpenProject(ProjectPtr p);
 
+  /**
+   * @brief Offer to recover any projects that were autosaved when Olive last didn't close properly
+   */
+  void RecoverAutosavedProjects();
+
+  /**
+   * @brief Load a project file and add it to the "open projects" (showing an error if it couldn't be loaded)
+   */
+  bool OpenProject(const QString& filename);
+
+  /**
+   * @brief Save a project to a file (showing an error if it couldn't be saved)
+   */
+  bool SaveProject(Project* p, const QString& filename);
+
   /**
    * @brief Declare custom types/classes for Qt's signal/slot system
    *
@@ -171,6 +279,11 @@ private:
    */
   void StartGUI(bool full_screen);
 
+  /**
+   * @brief Publish the viewer's frames to other processes through shared memory (see FrameServer)
+   */
+  void StartFrameServer(const QString& name);
+
   /**
    * @brief Get the currently active project
    *
@@ -188,6 +301,11 @@ private:
    */
   olive::MainWindow* main_window_;
 
+  /**
+   * @brief Started by --frame-server, nullptr if it wasn't passed
+   */
+  FrameServer* frame_server_;
+
   /**
    * @brief Internal startup project object
    *
@@ -196,11 +314,93 @@ private:
    */
   QString startup_project_;
 
+  /**
+   * @brief Set by Start() if the user passed --render on the command line
+   */
+  bool headless_;
+
+  /**
+   * @brief Set by Start() if the user passed --benchmark on the command line
+   */
+  bool benchmark_;
+
+  /**
+   * @brief Sequence to generate for the benchmark, from the command line
+   */
+  RenderBenchmark::Params benchmark_params_;
+
+  /**
+   * @brief Directory of media to run DecoderBenchmark over, set by Start() from --decoder-benchmark
+   */
+  QString decoder_benchmark_dir_;
+
+  /**
+   * @brief Number of random seeks per file for DecoderBenchmark, from --seeks (or the default)
+   */
+  int decoder_benchmark_seeks_;
+
+  /**
+   * @brief Set by Start() if the user passed --gpu-benchmark on the command line
+   */
+  bool gpu_benchmark_;
+
+  /**
+   * @brief Resolutions and pixel formats GPUBenchmark is limited to by --size and --format, empty for its defaults
+   */
+  QVector<QSize> gpu_benchmark_sizes_;
+  QVector<olive::PixelFormat> gpu_benchmark_formats_;
+
+  /**
+   * @brief Set by Start() if the user passed --auto-tune on the command line (see PerformanceProfile::AutoTune())
+   */
+  bool auto_tune_;
+
+  /**
+   * @brief Name of the sequence to render in headless mode
+   */
+  QString render_sequence_;
+
+  /**
+   * @brief Output filename to render to in headless mode
+   */
+  QString render_output_;
+
+  /**
+   * @brief Every output filename given for a headless render, each frame is rendered once and encoded to all of them
+   */
+  QStringList render_outputs_;
+
+  /**
+   * @brief Resolution and codec name of each of render_outputs_, missing entries use the defaults
+   */
+  QStringList render_output_sizes_;
+  QStringList render_output_codecs_;
+
+  /**
+   * @brief Range of frames to render into the cache as a render farm worker (see RenderFarmWorker), from --render-range
+   */
+  QString render_range_;
+
+  /**
+   * @brief Set by Start() if the user passed --render-farm (see RenderFarmCoordinator)
+   */
+  bool render_farm_;
+
+  /**
+   * @brief Command that starts each render farm worker, from --render-worker
+   */
+  QStringList render_workers_;
+
   /**
    * @brief List of currently open projects
    */
   QList<ProjectPtr> open_projects_;
 
+  /**
+   * @brief Autosave of each open project (only in the GUI)
+   */
+  QList<ProjectAutosave*> autosaves_;
+
   /**
    * @brief Currently active tool
    */
@@ -211,6 +411,81 @@ private:
    */
   bool snapping_;
 
+  /**
+   * @brief Whether viewers show render statistics
+   */
+  bool render_stats_visible_;
+
+  /**
+   * @brief File the trace being recorded is saved to once it stops
+   */
+  QString trace_filename_;
+
+  /**
+   * @brief Collects profiler samples regularly while recording a trace so none are lost
+   */
+  QTimer trace_timer_;
+
+  /**
+   * @brief Times out once there's been no input for kIdleRenderDelay seconds (see StartIdleRender())
+   */
+  QTimer idle_timer_;
+
+  /**
+   * @brief Tasks created by StartIdleRender() that haven't been paused yet
+   */
+  QList<QPointer<IdleRenderTask> > idle_tasks_;
+
+  /**
+   * @brief Sequences passed to OpenSequence(), most recent first
+   *
+   * Only compared against the Sequences of open projects, never dereferenced, since they may have been deleted since.
+   */
+  QList<Sequence*> recent_sequences_;
+
+  /**
+   * @brief Pause any idle rendering and start waiting for the user to be idle again
+   */
+  void UserActive();
+
+  /**
+   * @brief Log how long it's been since Start() was called if the user passed --trace-startup
+   */
+  void StartupMilestone(const char* name);
+
+  /**
+   * @brief Started at the beginning of Start()
+   */
+  QElapsedTimer startup_timer_;
+
+  /**
+   * @brief Set by Start() if the user passed --trace-startup on the command line
+   */
+  bool trace_startup_;
+
+  /**
+   * @brief Whether this machine's performance profile was loaded by Start(), if not it's tuned once startup finishes
+   */
+  bool performance_tuned_;
+
+private slots:
+  void CollectTraceSamples();
+
+  /**
+   * @brief Called from the first event loop iteration, once the main window has been painted for the first time
+   */
+  void StartupFinished();
+
+  /**
+   * @brief Apply the performance profile the --auto-tune process started by StartupFinished() saved
+   */
+  void AutoTuneFinished(int exit_code, QProcess::ExitStatus exit_status);
+
+  /**
+   * @brief Fill the render cache of every open Sequence, most recently opened first, one after the other
+   */
+  void StartIdleRender();
+
 };
 
 namespace olive {
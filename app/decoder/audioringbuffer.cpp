@@ -0,0 +1,155 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "audioringbuffer.h"
+
+#include <cstring>
+#include <QtGlobal>
+
+AudioRingBuffer::AudioRingBuffer() :
+  capacity_(0),
+  bytes_per_sample_frame_(0),
+  start_(0),
+  count_(0)
+{
+}
+
+void AudioRingBuffer::Allocate(int capacity, int bytes_per_sample_frame)
+{
+  capacity_ = capacity;
+  bytes_per_sample_frame_ = bytes_per_sample_frame;
+
+  data_.resize(capacity_ * bytes_per_sample_frame_);
+
+  Reset(0);
+}
+
+void AudioRingBuffer::Reset(const int64_t &start)
+{
+  start_ = start;
+  count_ = 0;
+}
+
+void AudioRingBuffer::Write(const uint8_t *data, int count)
+{
+  if (capacity_ == 0 || count <= 0) {
+    return;
+  }
+
+  // If we're writing more than the buffer can hold, only the end of it will survive anyway
+  if (count > capacity_) {
+    data += (count - capacity_) * bytes_per_sample_frame_;
+    start_ = end() + (count - capacity_);
+    count_ = 0;
+    count = capacity_;
+  }
+
+  int64_t write_pos = end();
+
+  while (count > 0) {
+    // Write up to the physical end of the buffer, then wrap around
+    int offset = Offset(write_pos);
+    int chunk = qMin(count, capacity_ - offset);
+
+    memcpy(PositionPointer(write_pos), data, static_cast<size_t>(chunk * bytes_per_sample_frame_));
+
+    data += chunk * bytes_per_sample_frame_;
+    write_pos += chunk;
+    count -= chunk;
+  }
+
+  // Drop the oldest audio if it was overwritten
+  count_ = static_cast<int>(qMin(write_pos - start_, static_cast<int64_t>(capacity_)));
+  start_ = write_pos - count_;
+}
+
+int AudioRingBuffer::Read(const int64_t &start, int count, uint8_t *dst) const
+{
+  // Find the part of the requested range that we have
+  int64_t read_start = qMax(start, start_);
+  int64_t read_end = qMin(start + count, end());
+
+  if (read_end <= read_start) {
+    return 0;
+  }
+
+  dst += (read_start - start) * bytes_per_sample_frame_;
+
+  int64_t read_pos = read_start;
+
+  while (read_pos < read_end) {
+    int offset = Offset(read_pos);
+    int chunk = static_cast<int>(qMin(read_end - read_pos, static_cast<int64_t>(capacity_ - offset)));
+
+    memcpy(dst, PositionPointer(read_pos), static_cast<size_t>(chunk * bytes_per_sample_frame_));
+
+    dst += chunk * bytes_per_sample_frame_;
+    read_pos += chunk;
+  }
+
+  return static_cast<int>(read_end - read_start);
+}
+
+bool AudioRingBuffer::Contains(const int64_t &start, int count) const
+{
+  return (start >= start_ && start + count <= end());
+}
+
+const int64_t &AudioRingBuffer::start() const
+{
+  return start_;
+}
+
+int64_t AudioRingBuffer::end() const
+{
+  return start_ + count_;
+}
+
+const int &AudioRingBuffer::count() const
+{
+  return count_;
+}
+
+const int &AudioRingBuffer::capacity() const
+{
+  return capacity_;
+}
+
+int AudioRingBuffer::Offset(const int64_t &pos) const
+{
+  // Positions can be negative (e.g. encoder delay at the start of a stream) so make sure we wrap to a valid offset
+  int64_t offset = pos % capacity_;
+
+  if (offset < 0) {
+    offset += capacity_;
+  }
+
+  return static_cast<int>(offset);
+}
+
+uint8_t *AudioRingBuffer::PositionPointer(const int64_t &pos)
+{
+  return reinterpret_cast<uint8_t*>(data_.data()) + Offset(pos) * bytes_per_sample_frame_;
+}
+
+const uint8_t *AudioRingBuffer::PositionPointer(const int64_t &pos) const
+{
+  return reinterpret_cast<const uint8_t*>(data_.constData()) + Offset(pos) * bytes_per_sample_frame_;
+}
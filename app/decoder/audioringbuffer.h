@@ -0,0 +1,125 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef AUDIORINGBUFFER_H
+#define AUDIORINGBUFFER_H
+
+#include <QByteArray>
+#include <stdint.h>
+
+/**
+ * @brief A fixed-size circular buffer of packed audio covering a contiguous range of sample positions
+ *
+ * Decoders write decoded audio to the end of the buffer as they go. Once it's full, the oldest audio is overwritten,
+ * so the buffer always holds the most recent capacity() samples. Any window within [start(), end()) can be read back
+ * without decoding again, which means contiguous playback (where each request starts roughly where the last one
+ * ended) only ever has to decode each sample once.
+ *
+ * Positions are in samples (per channel) from the start of the stream. This class isn't thread-safe.
+ */
+class AudioRingBuffer
+{
+public:
+  AudioRingBuffer();
+
+  /**
+   * @brief Allocate the buffer, clearing any audio it already contains
+   *
+   * @param capacity
+   *
+   * Maximum number of samples (per channel) the buffer can hold.
+   *
+   * @param bytes_per_sample_frame
+   *
+   * Size in bytes of one sample for every channel (i.e. channels * bytes per sample).
+   */
+  void Allocate(int capacity, int bytes_per_sample_frame);
+
+  /**
+   * @brief Clear the buffer and set the position that the next Write() will start at
+   */
+  void Reset(const int64_t& start);
+
+  /**
+   * @brief Append audio to the buffer at end(), discarding the oldest audio if there isn't room
+   */
+  void Write(const uint8_t* data, int count);
+
+  /**
+   * @brief Copy any audio the buffer holds in [start, start + count) into `dst`
+   *
+   * Parts of the range that aren't in the buffer are left untouched in `dst`.
+   *
+   * @return
+   *
+   * The number of samples copied.
+   */
+  int Read(const int64_t& start, int count, uint8_t* dst) const;
+
+  /**
+   * @brief Returns TRUE if the whole range [start, start + count) is in the buffer
+   */
+  bool Contains(const int64_t& start, int count) const;
+
+  /**
+   * @brief Position of the oldest sample in the buffer
+   */
+  const int64_t& start() const;
+
+  /**
+   * @brief Position after the newest sample in the buffer
+   */
+  int64_t end() const;
+
+  /**
+   * @brief Number of samples currently in the buffer
+   */
+  const int& count() const;
+
+  /**
+   * @brief Maximum number of samples the buffer can hold
+   */
+  const int& capacity() const;
+
+private:
+  /**
+   * @brief Returns the index (in samples) in the buffer that a certain position is stored at
+   */
+  int Offset(const int64_t& pos) const;
+
+  /**
+   * @brief Returns a pointer to where a certain position is (or will be) stored in the buffer
+   */
+  uint8_t* PositionPointer(const int64_t& pos);
+  const uint8_t* PositionPointer(const int64_t& pos) const;
+
+  QByteArray data_;
+
+  int capacity_;
+
+  int bytes_per_sample_frame_;
+
+  int64_t start_;
+
+  int count_;
+
+};
+
+#endif // AUDIORINGBUFFER_H
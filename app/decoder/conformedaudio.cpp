@@ -0,0 +1,146 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "conformedaudio.h"
+
+#include <cstring>
+#include <QDebug>
+#include <QDir>
+#include <QMap>
+#include <QMutex>
+
+#include "common/filefunctions.h"
+#include "project/item/footage/footage.h"
+
+namespace {
+
+const char kMagic[4] = {'O', 'C', 'N', 'F'};
+
+/**
+ * @brief All conformed audio currently loaded in this process
+ */
+QMap<QString, std::weak_ptr<ConformedAudio> > loaded_audio;
+QMutex loaded_audio_lock;
+
+}
+
+ConformedAudio::ConformedAudio() :
+  map_(nullptr),
+  header_(nullptr)
+{
+}
+
+ConformedAudio::~ConformedAudio()
+{
+  if (map_ != nullptr) {
+    file_.unmap(map_);
+  }
+
+  file_.close();
+}
+
+ConformedAudioPtr ConformedAudio::Load(const QString &filename)
+{
+  QMutexLocker locker(&loaded_audio_lock);
+
+  ConformedAudioPtr existing = loaded_audio.value(filename).lock();
+
+  if (existing != nullptr) {
+    return existing;
+  }
+
+  ConformedAudioPtr audio(new ConformedAudio());
+
+  audio->file_.setFileName(filename);
+
+  if (!audio->file_.open(QFile::ReadOnly)) {
+    return nullptr;
+  }
+
+  qint64 file_size = audio->file_.size();
+
+  if (file_size < static_cast<qint64>(sizeof(Header))) {
+    return nullptr;
+  }
+
+  audio->map_ = audio->file_.map(0, file_size);
+
+  if (audio->map_ == nullptr) {
+    qWarning() << "Failed to map conformed audio" << filename;
+    return nullptr;
+  }
+
+  audio->header_ = reinterpret_cast<const Header*>(audio->map_);
+
+  const Header* header = audio->header_;
+
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0
+      || header->version != kVersion
+      || header->channels != kChannels
+      || header->sample_rate <= 0
+      || header->sample_count < 0
+      || static_cast<qint64>(sizeof(Header))
+         + header->sample_count * kChannels * static_cast<qint64>(sizeof(float)) > file_size) {
+    return nullptr;
+  }
+
+  loaded_audio.insert(filename, audio);
+
+  return audio;
+}
+
+QString ConformedAudio::GetFilename(Stream *stream, int sample_rate)
+{
+  QString filename = GetUniqueFileIdentifier(stream->footage()->filename());
+
+  filename.append(QString::number(stream->index()));
+  filename.append(QStringLiteral("."));
+  filename.append(QString::number(sample_rate));
+  filename.append(QStringLiteral(".pcm"));
+
+  return QDir(GetMediaCacheLocation()).filePath(filename);
+}
+
+bool ConformedAudio::WriteHeader(QFile *file, int sample_rate, int64_t sample_count)
+{
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.channels = kChannels;
+  header.sample_rate = sample_rate;
+  header.sample_count = sample_count;
+
+  return file->write(reinterpret_cast<const char*>(&header), sizeof(Header)) == static_cast<qint64>(sizeof(Header));
+}
+
+int ConformedAudio::sample_rate() const
+{
+  return header_->sample_rate;
+}
+
+int64_t ConformedAudio::sample_count() const
+{
+  return header_->sample_count;
+}
+
+const float *ConformedAudio::data() const
+{
+  return reinterpret_cast<const float*>(map_ + sizeof(Header));
+}
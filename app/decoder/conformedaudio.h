@@ -0,0 +1,108 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef CONFORMEDAUDIO_H
+#define CONFORMEDAUDIO_H
+
+#include <memory>
+#include <QFile>
+#include <stdint.h>
+
+#include "project/item/footage/stream.h"
+
+class ConformedAudio;
+using ConformedAudioPtr = std::shared_ptr<ConformedAudio>;
+
+/**
+ * @brief An audio stream decoded in full to interleaved stereo float PCM at a sequence's sample rate
+ *
+ * Compressed audio (AAC, Opus, MP3, etc.) can only be seeked approximately and costs a decode every time it's read,
+ * which adds up quickly when scrubbing or looping. ConformTask decodes each stream used in a sequence once, in the
+ * background, into one of these files, after which AudioEngine reads any range of samples straight out of the
+ * mapping with sample-accurate positions and no decoding at all.
+ *
+ * Files live in the media cache (see GetMediaCacheLocation()) and are memory-mapped when loaded. Like Waveform,
+ * loaded files are shared, so every clip using the same stream reads from the same mapping. This class is thread-safe.
+ */
+class ConformedAudio
+{
+public:
+  /// Version of the file layout, files with a different version are ignored (and rebuilt)
+  static const uint32_t kVersion = 1;
+
+  /// Conformed audio is always stereo, matching AudioEngine's mix bus
+  static const int kChannels = 2;
+
+  /**
+   * @brief Layout of the start of a conformed audio file, samples follow it
+   */
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    int32_t channels;
+    int32_t sample_rate;
+    int64_t sample_count;
+  };
+
+  ~ConformedAudio();
+
+  /**
+   * @brief Load a conformed audio file, or get the already loaded copy if another caller has it
+   *
+   * @return
+   *
+   * The audio, or nullptr if the file doesn't exist or isn't valid.
+   */
+  static ConformedAudioPtr Load(const QString& filename);
+
+  /**
+   * @brief Returns the filename a stream conformed to `sample_rate` is stored at
+   */
+  static QString GetFilename(Stream* stream, int sample_rate);
+
+  /**
+   * @brief Write the header a file of `sample_count` samples starts with
+   */
+  static bool WriteHeader(QFile* file, int sample_rate, int64_t sample_count);
+
+  int sample_rate() const;
+
+  /**
+   * @brief Number of samples (per channel) in the file
+   */
+  int64_t sample_count() const;
+
+  /**
+   * @brief Interleaved stereo samples, sample_count() of them
+   */
+  const float* data() const;
+
+private:
+  ConformedAudio();
+
+  QFile file_;
+
+  uchar* map_;
+
+  const Header* header_;
+
+};
+
+#endif // CONFORMEDAUDIO_H
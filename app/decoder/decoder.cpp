@@ -24,17 +24,31 @@
 #include <QDebug>
 #include <QFileInfo>
 
+#include "config/config.h"
 #include "decoder/ffmpeg/ffmpegdecoder.h"
 #include "decoder/oiio/oiiodecoder.h"
+#include "decoder/probecache.h"
 
 Decoder::Decoder() :
   open_(false),
+  planar_output_allowed_(false),
+  divider_(1),
+  playback_speed_(0),
+  read_ahead_(false),
+  analysis_cancelled_(false),
+  cancel_flag_(nullptr),
   stream_(nullptr)
 {
 }
 
 Decoder::Decoder(Stream *fs) :
   open_(false),
+  planar_output_allowed_(false),
+  divider_(1),
+  playback_speed_(0),
+  read_ahead_(false),
+  analysis_cancelled_(false),
+  cancel_flag_(nullptr),
   stream_(fs)
 {
 }
@@ -55,6 +69,100 @@ void Decoder::set_stream(StreamPtr fs)
   stream_ = fs;
 }
 
+bool Decoder::SupportsExtension(const QString &)
+{
+  return false;
+}
+
+rational Decoder::GetFrameDuration()
+{
+  return 0;
+}
+
+rational Decoder::GetNextKeyframe(const rational &)
+{
+  return RATIONAL_MIN;
+}
+
+void Decoder::Preroll(const rational &)
+{
+}
+
+bool Decoder::Analyze()
+{
+  return true;
+}
+
+void Decoder::CancelAnalysis()
+{
+  analysis_cancelled_ = true;
+}
+
+bool Decoder::analysis_cancelled()
+{
+  return analysis_cancelled_;
+}
+
+void Decoder::set_planar_output_allowed(bool e)
+{
+  planar_output_allowed_ = e;
+}
+
+bool Decoder::planar_output_allowed() const
+{
+  return planar_output_allowed_;
+}
+
+void Decoder::set_divider(int divider)
+{
+  divider_ = qMax(divider, 1);
+}
+
+int Decoder::divider() const
+{
+  return divider_;
+}
+
+void Decoder::set_playback_speed(int speed)
+{
+  playback_speed_ = speed;
+}
+
+int Decoder::playback_speed() const
+{
+  return playback_speed_;
+}
+
+void Decoder::set_read_ahead(bool e)
+{
+  read_ahead_ = e;
+}
+
+bool Decoder::read_ahead() const
+{
+  return read_ahead_;
+}
+
+bool Decoder::keyframes_only() const
+{
+  return KeyframesOnlyAtSpeed(playback_speed_);
+}
+
+bool Decoder::KeyframesOnlyAtSpeed(int speed)
+{
+  return qAbs(speed) >= kShuttleKeyframeSpeed;
+}
+
+void Decoder::set_cancel_flag(const QAtomicInt *flag)
+{
+  cancel_flag_ = flag;
+}
+
+bool Decoder::retrieve_cancelled() const
+{
+  return cancel_flag_ != nullptr && cancel_flag_->loadAcquire() != 0;
+}
+
 /*
  * DECODER STATIC PUBLIC MEMBERS
  */
@@ -88,9 +196,28 @@ bool Decoder::ProbeMedia(Footage *f)
   // Reset Footage state for probing
   f->Clear();
 
+  // Reuse the results from the last time this file was probed if it hasn't changed since
+  if (ProbeCache::Load(f)) {
+    f->set_status(Footage::kReady);
+    return true;
+  }
+
   // Create list to iterate through
   QVector<DecoderPtr> decoder_list = ReceiveListOfAllDecoders();
 
+  // Move the Decoders that claim this extension to the front (keeping their priority order among themselves)
+  QString extension = QFileInfo(f->filename()).suffix().toLower();
+  QVector<DecoderPtr> unlikely_decoders;
+
+  for (int i=0;i<decoder_list.size();i++) {
+    if (!decoder_list.at(i)->SupportsExtension(extension)) {
+      unlikely_decoders.append(decoder_list.takeAt(i));
+      i--;
+    }
+  }
+
+  decoder_list.append(unlikely_decoders);
+
   // Pass Footage through each Decoder's probe function
   for (int i=0;i<decoder_list.size();i++) {
 
@@ -104,7 +231,8 @@ bool Decoder::ProbeMedia(Footage *f)
       // Attach the successful Decoder to this Footage object
       f->set_decoder(decoder->id());
 
-      // FIXME: Cache the results so we don't have to probe if this media is added a second time
+      // Cache the results so we don't have to probe if this media is added a second time
+      ProbeCache::Save(f);
 
       return true;
     }
@@ -21,6 +21,7 @@
 #ifndef DECODER_H
 #define DECODER_H
 
+#include <QAtomicInt>
 #include <QObject>
 #include <stdint.h>
 
@@ -110,6 +111,15 @@ public:
    */
   virtual bool Probe(Footage* f) = 0;
 
+  /**
+   * @brief Returns TRUE if files with this extension (lowercase, without the dot) are likely to be readable by Probe()
+   *
+   * Used by ProbeMedia() to try the most likely Decoders first, since every failed Probe() opens the file for nothing.
+   * This is only a hint, Decoders that don't claim an extension are still tried afterwards. The default
+   * implementation returns FALSE.
+   */
+  virtual bool SupportsExtension(const QString& extension);
+
   /**
    * @brief Open media/allocate memory
    *
@@ -160,6 +170,15 @@ public:
    */
   virtual void Close() = 0;
 
+  /**
+   * @brief Get ready to Retrieve() a certain time without actually retrieving it
+   *
+   * Called on freshly opened decoders for clips that are about to start playing, so the seek and the decoding up to
+   * the clip's first frame happen in the background rather than on the frame where the clip starts. The default
+   * implementation does nothing.
+   */
+  virtual void Preroll(const rational& time);
+
   /**
    * @brief Get a media file's internal timestamp
    *
@@ -167,13 +186,113 @@ public:
    */
   virtual int64_t GetTimestampFromTime(const rational& time) = 0;
 
+  /**
+   * @brief Get the (approximate) length of time each frame shows for
+   *
+   * Used to predict which frames will be requested next, e.g. for prefetching. Variable frame rate media should return
+   * the average. The default implementation returns 0, meaning unknown.
+   */
+  virtual rational GetFrameDuration();
+
+  /**
+   * @brief Get the time of the first keyframe after `time`
+   *
+   * Used to split a range of the media into GOPs that can be decoded independently of each other (see
+   * DecoderPrefetcher). The default implementation returns RATIONAL_MIN, meaning unknown, which is also returned if
+   * there are no more keyframes.
+   */
+  virtual rational GetNextKeyframe(const rational& time);
+
+  /**
+   * @brief Perform any lengthy preparation this media needs (e.g. indexing) ahead of time
+   *
+   * Analysis can take a long time so it's intended to be run in a background thread (see IndexTask). Decoders should
+   * still be able to Retrieve() media that hasn't been analyzed, even if it's slower or less accurate. Progress is
+   * reported with AnalysisProgress() and analysis should stop as soon as possible after CancelAnalysis() is called.
+   *
+   * The default implementation does nothing and returns TRUE.
+   *
+   * @return
+   *
+   * TRUE if analysis completed, FALSE if it failed or was cancelled.
+   */
+  virtual bool Analyze();
+
+  /**
+   * @brief Signal a running Analyze() to stop
+   *
+   * Safe to call from any thread.
+   */
+  void CancelAnalysis();
+
+  /**
+   * @brief Set whether Retrieve() may return native planar YUV frames
+   *
+   * Planar frames (see Frame::yuv_info()) avoid a CPU conversion to RGBA but can only be used by code that converts
+   * them on the GPU. Defaults to FALSE. Decoders that don't produce YUV data can ignore this.
+   */
+  void set_planar_output_allowed(bool e);
+  bool planar_output_allowed() const;
+
+  /**
+   * @brief Set the factor the renderer is reducing the resolution by (e.g. 2 for half resolution)
+   *
+   * Decoders may use this to decode or scale video to 1/divider of its full size, which saves both decoding time and
+   * memory. Frames retrieved will then be smaller than the stream's dimensions, so callers should use the stream's
+   * dimensions rather than the frame's when working out how large the media is. Defaults to 1.
+   */
+  void set_divider(int divider);
+  int divider() const;
+
+  /**
+   * @brief Set the speed of the playback frames are being retrieved for (see RendererProcessor::SetPlaybackSpeed())
+   *
+   * Decoders may use this to change how they decode. At shuttle speeds (see keyframes_only()) only keyframes need to
+   * be decoded, and when playing in reverse, frames can be decoded ahead of time and served backwards. Defaults to 0
+   * (not playing).
+   */
+  void set_playback_speed(int speed);
+  int playback_speed() const;
+
+  /**
+   * @brief Set whether frames are being retrieved in order through a range rather than for immediate display
+   *
+   * Set for export and background cache fills (see RenderInstance::read_ahead()). Decoders may then decode further
+   * ahead than they would for playback, e.g. DecoderPrefetcher decoding upcoming GOPs in parallel. Defaults to FALSE.
+   */
+  void set_read_ahead(bool e);
+  bool read_ahead() const;
+
+  /**
+   * @brief Returns TRUE if the playback speed is fast enough that decoding only keyframes is preferred
+   *
+   * When TRUE, GetTimestampFromTime() and Retrieve() snap to the keyframe at or before the requested time so that
+   * every frame is a single decode rather than a seek and then a decode through the GOP.
+   */
+  bool keyframes_only() const;
+
+  /**
+   * @brief Returns TRUE if keyframes_only() would be TRUE at this playback speed
+   */
+  static bool KeyframesOnlyAtSpeed(int speed);
+
+  /**
+   * @brief Set a flag that's raised if the frame being retrieved is no longer wanted (see RenderInstance::cancelled())
+   *
+   * Decoders should check retrieve_cancelled() while seeking or decoding through a GOP and return nullptr from
+   * Retrieve() as soon as possible if it's TRUE. The flag must remain valid until it's unset (with nullptr), which
+   * is the default.
+   */
+  void set_cancel_flag(const QAtomicInt* flag);
+
   /**
    * @brief Try to probe a Footage file by passing it through all available Decoders
    *
    * This is a helper function designed to abstract the process of communicating with several Decoders from the rest of
    * the application. This function will take a Footage file and manually pass it through the available Decoders' Probe()
    * functions until one indicates that it can decode this file. That Decoder will then dump information about the file
-   * into the Footage object for use throughout the program.
+   * into the Footage object for use throughout the program. Decoders that support the file's extension (see
+   * SupportsExtension()) are tried first.
    *
    * Probing may be a lengthy process and it's recommended to run this in a separate thread.
    *
@@ -197,9 +316,37 @@ public:
    */
   static DecoderPtr CreateFromID(const QString& id);
 
+signals:
+  /**
+   * @brief Emitted throughout Analyze() with a percentage (0-100) of how far along it is
+   */
+  void AnalysisProgress(int p);
+
 protected:
+  /**
+   * @brief Returns whether CancelAnalysis() has been called since Analyze() started
+   */
+  bool analysis_cancelled();
+
+  /**
+   * @brief Returns whether the flag set with set_cancel_flag() has been raised
+   */
+  bool retrieve_cancelled() const;
+
   bool open_;
 
+  bool planar_output_allowed_;
+
+  int divider_;
+
+  int playback_speed_;
+
+  bool read_ahead_;
+
+  bool analysis_cancelled_;
+
+  const QAtomicInt* cancel_flag_;
+
 private:
   StreamPtr stream_;
 };
@@ -0,0 +1,360 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "decoderbenchmark.h"
+
+#include <algorithm>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QtMath>
+#include <random>
+
+#include "config/config.h"
+#include "decoder/decoder.h"
+#include "decoder/frameindex.h"
+#include "project/item/footage/imagestream.h"
+
+/**
+ * @brief Returns the percentile `p` (0.0 - 1.0) of sorted nanosecond latencies in milliseconds
+ */
+static double Percentile(const QVector<qint64>& sorted, double p)
+{
+  if (sorted.isEmpty()) {
+    return -1.0;
+  }
+
+  return static_cast<double>(sorted.at(qMax(0, qCeil(sorted.size() * p) - 1))) / 1000000.0;
+}
+
+/**
+ * @brief Returns nanoseconds in milliseconds
+ */
+static double ToMilliseconds(qint64 ns)
+{
+  return static_cast<double>(ns) / 1000000.0;
+}
+
+DecoderBenchmark::DecoderBenchmark(const QString &directory) :
+  directory_(directory),
+  sequential_frames_(kDecoderBenchmarkSequentialFrames),
+  seeks_(kDecoderBenchmarkSeeks)
+{
+}
+
+void DecoderBenchmark::set_sequential_frames(int frames)
+{
+  sequential_frames_ = frames;
+}
+
+void DecoderBenchmark::set_seeks(int seeks)
+{
+  seeks_ = seeks;
+}
+
+bool DecoderBenchmark::Run()
+{
+  QDir dir(directory_);
+
+  if (!dir.exists()) {
+    error_ = tr("Directory %1 does not exist").arg(directory_);
+    return false;
+  }
+
+  if (sequential_frames_ < 0 || seeks_ < 0) {
+    error_ = tr("Invalid number of frames or seeks");
+    return false;
+  }
+
+  results_.clear();
+
+  // Sorted so results line up between runs
+  QFileInfoList files = dir.entryInfoList(QDir::Files | QDir::Readable, QDir::Name);
+
+  foreach (const QFileInfo& info, files) {
+    Result result;
+
+    if (RunFile(info.absoluteFilePath(), &result)) {
+      results_.append(result);
+    } else {
+      qWarning() << "Skipping" << info.fileName() << "- not media Olive can open";
+    }
+  }
+
+  if (results_.isEmpty()) {
+    error_ = tr("No media in %1 could be opened").arg(directory_);
+    return false;
+  }
+
+  return true;
+}
+
+const QString &DecoderBenchmark::error() const
+{
+  return error_;
+}
+
+const QVector<DecoderBenchmark::Result> &DecoderBenchmark::results() const
+{
+  return results_;
+}
+
+QString DecoderBenchmark::Report() const
+{
+  QStringList lines;
+
+  lines.append(tr("File\tDecoder\tOpen (ms)\tIndex (ms)\tSequential (fps)\tSeek p50 (ms)\tSeek p99 (ms)\tFailures"));
+
+  foreach (const Result& r, results_) {
+    lines.append(QStringLiteral("%1\t%2\t%3\t%4\t%5\t%6\t%7\t%8").arg(
+                   QFileInfo(r.filename).fileName(),
+                   r.decoder,
+                   QString::number(r.open_time, 'f', 2),
+                   QString::number(r.index_time, 'f', 2),
+                   QString::number(r.sequential_fps, 'f', 2),
+                   QString::number(r.seek_p50, 'f', 2),
+                   QString::number(r.seek_p99, 'f', 2),
+                   QString::number(r.failures)));
+  }
+
+  return lines.join('\n');
+}
+
+bool DecoderBenchmark::WriteReport(const QString &filename) const
+{
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    return false;
+  }
+
+  if (filename.endsWith(QStringLiteral(".json"), Qt::CaseInsensitive)) {
+    QJsonArray files;
+
+    foreach (const Result& r, results_) {
+      QJsonObject o;
+      o.insert("file", QFileInfo(r.filename).fileName());
+      o.insert("decoder", r.decoder);
+      o.insert("width", r.width);
+      o.insert("height", r.height);
+      o.insert("probe_ms", r.probe_time);
+      o.insert("open_ms", r.open_time);
+      o.insert("index_ms", r.index_time);
+      o.insert("sequential_frames", r.sequential_frames);
+      o.insert("sequential_fps", r.sequential_fps);
+      o.insert("seeks", r.seeks);
+      o.insert("seek_p50_ms", r.seek_p50);
+      o.insert("seek_p99_ms", r.seek_p99);
+      o.insert("failures", r.failures);
+      files.append(o);
+    }
+
+    QJsonObject root;
+    root.insert("seed", static_cast<double>(kDecoderBenchmarkSeed));
+    root.insert("files", files);
+
+    file.write(QJsonDocument(root).toJson());
+  } else {
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+
+    stream << "file,decoder,width,height,probe_ms,open_ms,index_ms,sequential_frames,sequential_fps,seeks,"
+              "seek_p50_ms,seek_p99_ms,failures\n";
+
+    foreach (const Result& r, results_) {
+      QString name = QFileInfo(r.filename).fileName();
+
+      // Quote the name in case it has a comma in it
+      stream << '"' << name.replace('"', QStringLiteral("\"\"")) << "\","
+             << r.decoder << ','
+             << r.width << ','
+             << r.height << ','
+             << QString::number(r.probe_time, 'f', 3) << ','
+             << QString::number(r.open_time, 'f', 3) << ','
+             << QString::number(r.index_time, 'f', 3) << ','
+             << r.sequential_frames << ','
+             << QString::number(r.sequential_fps, 'f', 3) << ','
+             << r.seeks << ','
+             << QString::number(r.seek_p50, 'f', 3) << ','
+             << QString::number(r.seek_p99, 'f', 3) << ','
+             << r.failures << '\n';
+    }
+
+    stream.flush();
+  }
+
+  return file.error() == QFile::NoError;
+}
+
+bool DecoderBenchmark::RunFile(const QString &filename, DecoderBenchmark::Result *result)
+{
+  result->filename = filename;
+  result->width = 0;
+  result->height = 0;
+  result->probe_time = -1.0;
+  result->open_time = -1.0;
+  result->index_time = -1.0;
+  result->sequential_frames = 0;
+  result->sequential_fps = 0.0;
+  result->seeks = 0;
+  result->seek_p50 = -1.0;
+  result->seek_p99 = -1.0;
+  result->failures = 0;
+
+  QElapsedTimer timer;
+
+  FootagePtr footage = std::make_shared<Footage>();
+  footage->set_filename(filename);
+
+  timer.start();
+
+  if (!Decoder::ProbeMedia(footage.get())) {
+    return false;
+  }
+
+  result->probe_time = ToMilliseconds(timer.nsecsElapsed());
+
+  // Only pictures are benchmarked, audio is decoded in bulk rather than seeked around
+  StreamPtr stream;
+
+  for (int i=0;i<footage->stream_count();i++) {
+    Stream::Type type = footage->stream(i)->type();
+
+    if (type == Stream::kVideo || type == Stream::kImage) {
+      stream = footage->stream(i);
+      break;
+    }
+  }
+
+  if (stream == nullptr) {
+    return false;
+  }
+
+  ImageStreamPtr image_stream = std::static_pointer_cast<ImageStream>(stream);
+  result->width = image_stream->width();
+  result->height = image_stream->height();
+
+  result->decoder = footage->decoder();
+
+  // Index from scratch, otherwise every run after the first would only be timing loading the index
+  if (stream->type() == Stream::kVideo) {
+    QFile::remove(FrameIndex::GetFilename(stream.get()));
+
+    DecoderPtr indexer = Decoder::CreateFromID(footage->decoder());
+
+    if (indexer == nullptr) {
+      return false;
+    }
+
+    indexer->set_stream(stream);
+
+    timer.restart();
+
+    if (indexer->Analyze()) {
+      result->index_time = ToMilliseconds(timer.nsecsElapsed());
+    }
+
+    indexer->Close();
+  }
+
+  DecoderPtr decoder = Decoder::CreateFromID(footage->decoder());
+
+  if (decoder == nullptr) {
+    return false;
+  }
+
+  decoder->set_stream(stream);
+
+  timer.restart();
+
+  if (!decoder->Open()) {
+    return false;
+  }
+
+  result->open_time = ToMilliseconds(timer.nsecsElapsed());
+
+  rational frame_duration = decoder->GetFrameDuration();
+
+  if (frame_duration == 0) {
+    frame_duration = stream->timebase();
+  }
+
+  // Still images are a single frame
+  int64_t frame_count = 1;
+
+  if (stream->type() == Stream::kVideo && frame_duration > 0) {
+    double length = (rational(stream->duration()) * stream->timebase()).toDouble();
+
+    frame_count = qMax(Q_INT64_C(1), static_cast<int64_t>(length / frame_duration.toDouble()));
+  }
+
+  // Sequential, like playback
+  int sequential = static_cast<int>(qMin(static_cast<int64_t>(sequential_frames_), frame_count));
+
+  timer.restart();
+
+  for (int i=0;i<sequential;i++) {
+    if (decoder->Retrieve(rational(i) * frame_duration) == nullptr) {
+      result->failures++;
+    }
+  }
+
+  qint64 sequential_elapsed = timer.nsecsElapsed();
+
+  result->sequential_frames = sequential;
+
+  if (sequential_elapsed > 0) {
+    result->sequential_fps = static_cast<double>(sequential) * 1000000000.0 / static_cast<double>(sequential_elapsed);
+  }
+
+  // Random, like scrubbing
+  std::mt19937_64 generator(kDecoderBenchmarkSeed);
+  std::uniform_int_distribution<int64_t> distribution(0, frame_count - 1);
+
+  QVector<qint64> latencies;
+  latencies.reserve(seeks_);
+
+  for (int i=0;i<seeks_;i++) {
+    rational time = rational(distribution(generator)) * frame_duration;
+
+    timer.restart();
+
+    if (decoder->Retrieve(time) == nullptr) {
+      result->failures++;
+    }
+
+    latencies.append(timer.nsecsElapsed());
+  }
+
+  decoder->Close();
+
+  std::sort(latencies.begin(), latencies.end());
+
+  result->seeks = latencies.size();
+  result->seek_p50 = Percentile(latencies, 0.5);
+  result->seek_p99 = Percentile(latencies, 0.99);
+
+  return true;
+}
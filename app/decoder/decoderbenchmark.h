@@ -0,0 +1,125 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef DECODERBENCHMARK_H
+#define DECODERBENCHMARK_H
+
+#include <QCoreApplication>
+#include <QVector>
+
+/**
+ * @brief Measures how quickly every file in a directory of sample media opens, indexes, decodes and seeks
+ *
+ * Each file is probed like an import and its first video (or image) stream is opened with the Decoder it would be
+ * played with, timing:
+ *
+ * - Opening the decoder
+ * - Indexing the stream from scratch (any existing index is deleted first)
+ * - Retrieving frames in order from the start, as playback does
+ * - Retrieving frames at random, as scrubbing does, reported as the 50th and 99th percentile latency
+ *
+ * Seeks are generated from a fixed seed, so runs over the same directory retrieve the same frames and can be compared
+ * between versions to catch regressions in Retrieve()'s seeking. Used by `--decoder-benchmark` (see
+ * Core::RunHeadless()).
+ */
+class DecoderBenchmark
+{
+  Q_DECLARE_TR_FUNCTIONS(DecoderBenchmark)
+public:
+  struct Result {
+    QString filename;
+
+    /// ID of the Decoder the file was opened with, empty if it couldn't be opened
+    QString decoder;
+
+    int width;
+    int height;
+
+    /// Milliseconds each step took, -1 if it didn't run
+    double probe_time;
+    double open_time;
+    double index_time;
+
+    /// Frames retrieved in order, and how many per second
+    int sequential_frames;
+    double sequential_fps;
+
+    int seeks;
+
+    /// Milliseconds
+    double seek_p50;
+    double seek_p99;
+
+    /// Retrieve() calls that returned nothing
+    int failures;
+  };
+
+  DecoderBenchmark(const QString& directory);
+
+  /**
+   * @brief Set how many frames are retrieved in order from the start of each file
+   */
+  void set_sequential_frames(int frames);
+
+  /**
+   * @brief Set how many frames are retrieved at random from each file
+   */
+  void set_seeks(int seeks);
+
+  /**
+   * @brief Benchmark every file in the directory, blocking until they're all done
+   *
+   * Returns FALSE if the directory doesn't exist or has no media Olive can open, see error().
+   */
+  bool Run();
+
+  const QString& error() const;
+
+  const QVector<Result>& results() const;
+
+  /**
+   * @brief Returns a human-readable table of the results of Run()
+   */
+  QString Report() const;
+
+  /**
+   * @brief Write the results of Run() to a file, as JSON if it ends in ".json" and CSV otherwise
+   */
+  bool WriteReport(const QString& filename) const;
+
+private:
+  /**
+   * @brief Benchmark a single file, returns FALSE if it isn't media Olive can open
+   */
+  bool RunFile(const QString& filename, Result* result);
+
+  QString directory_;
+
+  int sequential_frames_;
+
+  int seeks_;
+
+  QString error_;
+
+  QVector<Result> results_;
+
+};
+
+#endif // DECODERBENCHMARK_H
@@ -0,0 +1,361 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "decoderpool.h"
+
+#include <QDateTime>
+#include <QRunnable>
+
+#include "config/config.h"
+#include "config/performanceprofile.h"
+#include "decoder/decoderprefetcher.h"
+#include "decoder/remote/remotedecoder.h"
+
+DecoderPool olive::decoder_pool;
+
+class DecoderPool::Opener : public QRunnable
+{
+public:
+  Opener(DecoderPool* parent, DecoderPtr decoder, const rational& time, bool preroll) :
+    parent_(parent),
+    decoder_(decoder),
+    time_(time),
+    preroll_(preroll)
+  {
+  }
+
+  virtual void run() override
+  {
+    bool success = decoder_->Open();
+
+    if (success && preroll_) {
+      decoder_->Preroll(time_);
+    }
+
+    parent_->OpenFinished(decoder_, time_, success);
+  }
+
+private:
+  DecoderPool* parent_;
+
+  DecoderPtr decoder_;
+
+  rational time_;
+
+  bool preroll_;
+};
+
+DecoderPool::DecoderPool(int max_instances_per_stream) :
+  max_instances_per_stream_(max_instances_per_stream),
+  last_idle_check_(0)
+{
+  open_pool_.setMaxThreadCount(kDecoderOpenThreads);
+}
+
+DecoderPtr DecoderPool::Lease(StreamPtr stream, const rational &time)
+{
+  if (stream == nullptr || stream->footage() == nullptr) {
+    return nullptr;
+  }
+
+  QMutexLocker locker(&mutex_);
+
+  while (true) {
+    QList<PooledDecoder>& instances = decoders_[stream.get()];
+
+    // Find the idle instance closest behind the requested time, or failing that any idle instance
+    int best = -1;
+
+    for (int i=0;i<instances.size();i++) {
+      const PooledDecoder& d = instances.at(i);
+
+      if (d.leased) {
+        continue;
+      }
+
+      if (best == -1) {
+        best = i;
+      } else {
+        const PooledDecoder& current_best = instances.at(best);
+
+        bool d_behind = (d.last_time <= time);
+        bool best_behind = (current_best.last_time <= time);
+
+        if ((d_behind && !best_behind)
+            || (d_behind && best_behind && d.last_time > current_best.last_time)) {
+          best = i;
+        }
+      }
+    }
+
+    if (best > -1) {
+      instances[best].leased = true;
+      return instances.at(best).decoder;
+    }
+
+    bool opening = false;
+
+    foreach (const PooledDecoder& d, instances) {
+      if (d.opening) {
+        opening = true;
+        break;
+      }
+    }
+
+    // No idle instances, create a new one if we're allowed to (unless one is about to be ready anyway)
+    if (!opening && instances.size() < max_instances_per_stream_) {
+      DecoderPtr decoder = CreateDecoder(stream);
+
+      if (decoder == nullptr) {
+        return nullptr;
+      }
+
+      PooledDecoder d;
+      d.decoder = decoder;
+      d.leased = true;
+      d.opening = false;
+      d.last_time = RATIONAL_MIN;
+      d.last_used = QDateTime::currentMSecsSinceEpoch();
+      instances.append(d);
+
+      return decoder;
+    }
+
+    // Otherwise wait for an instance to be returned
+    wait_cond_.wait(&mutex_);
+  }
+}
+
+void DecoderPool::Return(DecoderPtr decoder, const rational &time)
+{
+  if (decoder == nullptr) {
+    return;
+  }
+
+  QMutexLocker locker(&mutex_);
+
+  QList<PooledDecoder>& instances = decoders_[decoder->stream().get()];
+
+  for (int i=0;i<instances.size();i++) {
+    if (instances.at(i).decoder == decoder) {
+      instances[i].leased = false;
+      instances[i].last_time = time;
+      instances[i].last_used = QDateTime::currentMSecsSinceEpoch();
+      break;
+    }
+  }
+
+  wait_cond_.wakeAll();
+
+  QList<DecoderPtr> idle = TakeIdleDecoders();
+
+  locker.unlock();
+
+  foreach (DecoderPtr d, idle) {
+    d->Close();
+  }
+}
+
+void DecoderPool::Prepare(StreamPtr stream, const rational &time, bool preroll)
+{
+  if (stream == nullptr || stream->footage() == nullptr) {
+    return;
+  }
+
+  QMutexLocker locker(&mutex_);
+
+  QList<PooledDecoder>& instances = decoders_[stream.get()];
+
+  if (preroll) {
+    if (instances.size() >= max_instances_per_stream_) {
+      return;
+    }
+
+    foreach (const PooledDecoder& d, instances) {
+      if (d.last_time == time) {
+        return;
+      }
+    }
+  } else if (!instances.isEmpty()) {
+    return;
+  }
+
+  DecoderPtr decoder = CreateDecoder(stream);
+
+  if (decoder == nullptr) {
+    return;
+  }
+
+  PooledDecoder d;
+  d.decoder = decoder;
+  d.leased = true;
+  d.opening = true;
+
+  // Not leasable yet, but this stops the same time being prepared twice
+  d.last_time = time;
+  d.last_used = QDateTime::currentMSecsSinceEpoch();
+  instances.append(d);
+
+  open_pool_.start(new Opener(this, decoder, time, preroll));
+}
+
+void DecoderPool::Clear(Stream *stream)
+{
+  QMutexLocker locker(&mutex_);
+
+  ClearInternal(stream);
+}
+
+void DecoderPool::Clear()
+{
+  QMutexLocker locker(&mutex_);
+
+  QList<Stream*> streams = decoders_.keys();
+
+  foreach (Stream* s, streams) {
+    ClearInternal(s);
+  }
+}
+
+DecoderPtr DecoderPool::CreateDecoder(StreamPtr stream)
+{
+  DecoderPtr decoder;
+
+  if (kUseDecoderProcesses && stream->type() == Stream::kVideo) {
+    // Decode in a worker process, so a decoder that crashes or leaks can't take the editor down with it
+    decoder = std::make_shared<RemoteDecoder>(stream->footage()->decoder());
+  } else {
+    decoder = Decoder::CreateFromID(stream->footage()->decoder());
+  }
+
+  if (decoder == nullptr) {
+    return nullptr;
+  }
+
+  decoder->set_stream(stream);
+
+  // Decode video ahead of time so retrieving is usually instant
+  int prefetch_depth = olive::performance_profile.values().decoder_prefetch_depth;
+
+  if (stream->type() == Stream::kVideo && prefetch_depth > 0) {
+    decoder = std::make_shared<DecoderPrefetcher>(decoder, prefetch_depth);
+  }
+
+  return decoder;
+}
+
+void DecoderPool::OpenFinished(DecoderPtr decoder, const rational &time, bool success)
+{
+  QMutexLocker locker(&mutex_);
+
+  QList<PooledDecoder>& instances = decoders_[decoder->stream().get()];
+
+  for (int i=0;i<instances.size();i++) {
+    if (instances.at(i).decoder == decoder) {
+      if (success) {
+        instances[i].leased = false;
+        instances[i].opening = false;
+
+        // Positioned just before where it's expected to be used, so it's the one Lease() picks
+        instances[i].last_time = time;
+        instances[i].last_used = QDateTime::currentMSecsSinceEpoch();
+      } else {
+        instances.removeAt(i);
+      }
+      break;
+    }
+  }
+
+  wait_cond_.wakeAll();
+}
+
+QList<DecoderPtr> DecoderPool::TakeIdleDecoders()
+{
+  QList<DecoderPtr> taken;
+
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+  if (now - last_idle_check_ < 1000) {
+    return taken;
+  }
+
+  last_idle_check_ = now;
+
+  // Every idle instance, least recently used first
+  QMultiMap<qint64, DecoderPtr> idle;
+
+  QMap<Stream*, QList<PooledDecoder> >::const_iterator i;
+
+  for (i=decoders_.constBegin();i!=decoders_.constEnd();i++) {
+    foreach (const PooledDecoder& d, i.value()) {
+      if (!d.leased) {
+        idle.insert(d.last_used, d.decoder);
+      }
+    }
+  }
+
+  int remaining = idle.size();
+
+  QMultiMap<qint64, DecoderPtr>::const_iterator j;
+
+  for (j=idle.constBegin();j!=idle.constEnd();j++) {
+    if (remaining <= kDecoderIdleBudget && now - j.key() < kDecoderIdleTimeout * 1000) {
+      break;
+    }
+
+    taken.append(j.value());
+    remaining--;
+  }
+
+  foreach (DecoderPtr decoder, taken) {
+    Stream* stream = decoder->stream().get();
+    QList<PooledDecoder>& instances = decoders_[stream];
+
+    for (int k=0;k<instances.size();k++) {
+      if (instances.at(k).decoder == decoder) {
+        instances.removeAt(k);
+        break;
+      }
+    }
+
+    if (instances.isEmpty()) {
+      decoders_.remove(stream);
+    }
+  }
+
+  return taken;
+}
+
+void DecoderPool::ClearInternal(Stream *stream)
+{
+  QList<PooledDecoder>& instances = decoders_[stream];
+
+  for (int i=0;i<instances.size();i++) {
+    if (!instances.at(i).leased) {
+      instances.at(i).decoder->Close();
+      instances.removeAt(i);
+      i--;
+    }
+  }
+
+  if (instances.isEmpty()) {
+    decoders_.remove(stream);
+  }
+}
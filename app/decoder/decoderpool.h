@@ -0,0 +1,176 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef DECODERPOOL_H
+#define DECODERPOOL_H
+
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "decoder/decoder.h"
+
+/**
+ * @brief A shared pool of open Decoders keyed by footage stream
+ *
+ * Opening a Decoder is expensive (file handles, codec contexts, frame indexes) so rather than every MediaInput node
+ * owning its own, nodes lease a Decoder from this pool for the duration of a retrieval and return it afterwards. The
+ * pool remembers the last time each instance was used for so that leases can be served by whichever instance is
+ * positioned closest behind the requested time (allowing the decoder to simply decode forward rather than seek).
+ *
+ * The number of instances open for a single stream is capped. If all instances are leased, Lease() blocks until one
+ * is returned.
+ *
+ * Video decoders are wrapped in a DecoderPrefetcher (see PerformanceProfile::Values::decoder_prefetch_depth) so each
+ * instance decodes ahead of where it was last used.
+ *
+ * Opening can also be done ahead of time with Prepare(), which opens an instance on a background thread so that the
+ * render thread that first needs the stream doesn't have to wait on file I/O.
+ *
+ * Idle instances are closed once they haven't been used for kDecoderIdleTimeout seconds, or least recently used first
+ * when more than kDecoderIdleBudget are idle, so a long timeline doesn't keep every file it ever played open. They're
+ * opened again on demand (or ahead of time by Prepare()).
+ *
+ * This class is thread-safe.
+ */
+class DecoderPool
+{
+public:
+  DecoderPool(int max_instances_per_stream = 4);
+
+  /**
+   * @brief Lease a Decoder for a stream
+   *
+   * @param stream
+   *
+   * The stream to retrieve a Decoder for.
+   *
+   * @param time
+   *
+   * The time the caller intends to retrieve. Used to pick the instance that will retrieve this time the fastest.
+   *
+   * @return
+   *
+   * A Decoder with its stream set, or nullptr if no Decoder could be created for this stream. Every non-null Decoder
+   * must be given back with Return().
+   */
+  DecoderPtr Lease(StreamPtr stream, const rational& time);
+
+  /**
+   * @brief Return a Decoder previously leased with Lease()
+   *
+   * @param time
+   *
+   * The last time this Decoder retrieved, used to keep track of its position for future leases.
+   */
+  void Return(DecoderPtr decoder, const rational& time);
+
+  /**
+   * @brief Open a Decoder for a stream in the background (e.g. because it's about to be played)
+   *
+   * Does nothing if the stream already has an instance, unless `preroll` is set. Until the Decoder has opened,
+   * Lease() waits for it rather than opening another one.
+   *
+   * @param time
+   *
+   * The time the stream is expected to be retrieved from first.
+   *
+   * @param preroll
+   *
+   * Also seek and decode up to `time` once the Decoder is open (see Decoder::Preroll()). A new instance is started for
+   * this (within the instance limit) unless one has already been prepared for the same time, since the existing ones
+   * are most likely busy somewhere else in the stream.
+   */
+  void Prepare(StreamPtr stream, const rational& time, bool preroll = false);
+
+  /**
+   * @brief Close and remove all idle Decoders for a stream (e.g. if its footage is being removed)
+   */
+  void Clear(Stream* stream);
+
+  /**
+   * @brief Close and remove all idle Decoders
+   */
+  void Clear();
+
+private:
+  /**
+   * @brief Opens a Decoder started with Prepare()
+   */
+  class Opener;
+
+  struct PooledDecoder {
+    DecoderPtr decoder;
+    bool leased;
+
+    /// Being opened by an Opener, also leased until it's done
+    bool opening;
+
+    rational last_time;
+
+    /// When this instance was last returned (msecs since epoch), for closing idle instances
+    qint64 last_used;
+  };
+
+  /**
+   * @brief Create a Decoder for a stream (not opened yet)
+   */
+  static DecoderPtr CreateDecoder(StreamPtr stream);
+
+  /**
+   * @brief Called by an Opener when it's done, makes the Decoder available or removes it if it failed to open
+   */
+  void OpenFinished(DecoderPtr decoder, const rational& time, bool success);
+
+  /**
+   * @brief Remove idle instances that are past kDecoderIdleTimeout or over kDecoderIdleBudget
+   *
+   * Assumes mutex_ is already locked. The removed Decoders are returned so they can be closed after unlocking, since
+   * closing one can take a while. Only does anything once a second.
+   */
+  QList<DecoderPtr> TakeIdleDecoders();
+
+  /**
+   * @brief Internal function for Clear(), assumes mutex_ is already locked
+   */
+  void ClearInternal(Stream* stream);
+
+  QMap<Stream*, QList<PooledDecoder> > decoders_;
+
+  int max_instances_per_stream_;
+
+  QMutex mutex_;
+
+  QWaitCondition wait_cond_;
+
+  QThreadPool open_pool_;
+
+  /// The last time TakeIdleDecoders() checked (msecs since epoch)
+  qint64 last_idle_check_;
+
+};
+
+namespace olive {
+extern DecoderPool decoder_pool;
+}
+
+#endif // DECODERPOOL_H
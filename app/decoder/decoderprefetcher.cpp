@@ -0,0 +1,591 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "decoderprefetcher.h"
+
+#include "common/threadaffinity.h"
+#include "config/config.h"
+#include "render/imagecache.h"
+#include "render/profiler.h"
+
+/**
+ * @brief GOP jobs are at least this many frames long, shorter GOPs (e.g. intra-only media) are grouped together
+ */
+const int kGOPMinFrames = 8;
+
+/**
+ * @brief How far behind the last frame taken from a GOP job its frames are kept
+ *
+ * Several frames can be rendered at once, so they aren't necessarily retrieved in order.
+ */
+const int kGOPReorderFrames = 4;
+
+class DecoderPrefetcher::GOPRunner : public QRunnable
+{
+public:
+  GOPRunner(DecoderPrefetcher* parent, GOPJobPtr job) :
+    parent_(parent),
+    job_(job)
+  {
+  }
+
+  virtual void run() override
+  {
+    parent_->RunGOP(job_);
+  }
+
+private:
+  DecoderPrefetcher* parent_;
+
+  GOPJobPtr job_;
+};
+
+DecoderPrefetcher::DecoderPrefetcher(DecoderPtr decoder, int depth) :
+  decoder_(decoder),
+  depth_(depth),
+  next_time_(0),
+  step_(0),
+  last_request_time_(RATIONAL_MIN),
+  generation_(0),
+  active_(false),
+  quit_(false),
+  consumer_node_(-1),
+  prefetch_limit_(RATIONAL_MAX),
+  worker_(this)
+{
+  set_stream(decoder_->stream());
+
+  gop_pool_.setMaxThreadCount(kGOPParallelDecoders);
+
+  worker_.setObjectName(QStringLiteral("DecoderPrefetcher"));
+  worker_.start(QThread::LowPriority);
+}
+
+DecoderPrefetcher::~DecoderPrefetcher()
+{
+  queue_lock_.lock();
+  quit_ = true;
+  queue_cond_.wakeAll();
+  queue_lock_.unlock();
+
+  worker_.wait();
+
+  Close();
+}
+
+QString DecoderPrefetcher::id()
+{
+  return decoder_->id();
+}
+
+bool DecoderPrefetcher::Probe(Footage *f)
+{
+  QMutexLocker locker(&decoder_lock_);
+
+  return decoder_->Probe(f);
+}
+
+bool DecoderPrefetcher::Open()
+{
+  QMutexLocker locker(&decoder_lock_);
+
+  open_ = decoder_->Open();
+
+  return open_;
+}
+
+FramePtr DecoderPrefetcher::Retrieve(const rational &timecode, const rational &length)
+{
+  // Only video is prefetched, audio windows vary too much to predict
+  if (stream()->type() != Stream::kVideo) {
+    QMutexLocker locker(&decoder_lock_);
+
+    return decoder_->Retrieve(timecode, length);
+  }
+
+  int64_t target_ts = GetTimestampFromTime(timecode);
+
+  if (read_ahead()) {
+    // Get the following GOPs going before waiting on anything
+    ScheduleGOPs(timecode);
+
+    FramePtr gop_frame = TakeGOPFrame(timecode, target_ts);
+
+    if (gop_frame != nullptr) {
+      QMutexLocker locker(&queue_lock_);
+
+      // The GOP jobs have taken over from here
+      DropQueue();
+      active_ = false;
+      last_request_time_ = timecode;
+
+      return gop_frame;
+    }
+  } else {
+    gop_lock_.lock();
+    DropGOPs();
+    gop_lock_.unlock();
+  }
+
+  QMutexLocker locker(&queue_lock_);
+
+  consumer_node_ = ThreadAffinity::CurrentNode();
+
+  // Work out which direction we're going in
+  bool forward = (timecode >= last_request_time_);
+  bool direction_changed = (step_ != 0 && forward != (step_ > 0));
+
+  last_request_time_ = timecode;
+
+  FramePtr frame = nullptr;
+
+  if (!direction_changed) {
+    // See if the worker already has this frame, any frames before it won't be needed anymore
+    for (int i=0;i<queue_.size();i++) {
+      const QueuedFrame& q = queue_.at(i);
+
+      if (q.frame->native_timestamp() == target_ts
+          && q.planar_output_allowed == planar_output_allowed()
+          && q.divider == divider()
+          && q.playback_speed == playback_speed()) {
+        frame = q.frame;
+
+        queue_.erase(queue_.begin(), queue_.begin() + i + 1);
+        break;
+      }
+    }
+  }
+
+  if (frame == nullptr) {
+    // This is a seek, nothing in the queue is useful anymore
+    DropQueue();
+
+    QMutexLocker decoder_locker(&decoder_lock_);
+
+    decoder_->set_planar_output_allowed(planar_output_allowed());
+    decoder_->set_divider(divider());
+    decoder_->set_playback_speed(playback_speed());
+    frame = decoder_->Retrieve(timecode, length);
+
+    // Playback faster than real-time skips frames, so prefetch the ones it will actually ask for
+    step_ = decoder_->GetFrameDuration() * qMax(1, qAbs(playback_speed()));
+
+    decoder_locker.unlock();
+
+    if (!forward) {
+      step_ = -step_;
+    }
+
+    next_time_ = timecode + step_;
+  }
+
+  // Keep the worker going from here
+  active_ = (frame != nullptr && step_ != 0);
+  queue_cond_.wakeAll();
+
+  return frame;
+}
+
+void DecoderPrefetcher::Close()
+{
+  gop_lock_.lock();
+  DropGOPs();
+  gop_lock_.unlock();
+
+  gop_pool_.waitForDone();
+
+  // Nothing is running now so the helpers can be closed without the lock
+  foreach (DecoderPtr helper, gop_decoders_) {
+    helper->Close();
+  }
+  gop_decoders_.clear();
+
+  queue_lock_.lock();
+  DropQueue();
+  active_ = false;
+  last_request_time_ = RATIONAL_MIN;
+  step_ = 0;
+  queue_lock_.unlock();
+
+  QMutexLocker locker(&decoder_lock_);
+
+  decoder_->Close();
+
+  open_ = false;
+}
+
+void DecoderPrefetcher::Preroll(const rational &time)
+{
+  QMutexLocker locker(&decoder_lock_);
+
+  decoder_->Preroll(time);
+}
+
+int64_t DecoderPrefetcher::GetTimestampFromTime(const rational &time)
+{
+  QMutexLocker locker(&decoder_lock_);
+
+  // Shuttle speeds change which frame a time maps to
+  decoder_->set_playback_speed(playback_speed());
+
+  return decoder_->GetTimestampFromTime(time);
+}
+
+rational DecoderPrefetcher::GetFrameDuration()
+{
+  QMutexLocker locker(&decoder_lock_);
+
+  return decoder_->GetFrameDuration();
+}
+
+rational DecoderPrefetcher::GetNextKeyframe(const rational &time)
+{
+  QMutexLocker locker(&decoder_lock_);
+
+  return decoder_->GetNextKeyframe(time);
+}
+
+bool DecoderPrefetcher::Analyze()
+{
+  QMutexLocker locker(&decoder_lock_);
+
+  return decoder_->Analyze();
+}
+
+int DecoderPrefetcher::depth()
+{
+  QMutexLocker locker(&queue_lock_);
+
+  return depth_;
+}
+
+void DecoderPrefetcher::set_depth(int depth)
+{
+  QMutexLocker locker(&queue_lock_);
+
+  depth_ = depth;
+
+  while (queue_.size() > depth_) {
+    queue_.removeLast();
+  }
+
+  queue_cond_.wakeAll();
+}
+
+void DecoderPrefetcher::PrefetchLoop()
+{
+  queue_lock_.lock();
+
+  while (!quit_) {
+    // Every queued frame holds a full frame buffer, so only stay one frame ahead while memory is short
+    int depth = olive::image_cache.UnderPressure(ImageCache::kMemBuf) ? qMin(depth_, 1) : depth_;
+
+    if (!active_ || queue_.size() >= depth || (step_ > 0 && next_time_ >= prefetch_limit_)) {
+      // Nothing to do until a Retrieve() takes a frame from the queue
+      queue_cond_.wait(&queue_lock_);
+      continue;
+    }
+
+    rational time = next_time_;
+    int generation = generation_;
+    bool planar_allowed = planar_output_allowed();
+    int frame_divider = divider();
+    int frame_playback_speed = playback_speed();
+    int node = consumer_node_;
+
+    // Don't hold the queue while decoding so Retrieve() can still take frames that are ready
+    queue_lock_.unlock();
+
+    // Frame buffers are placed on the node of the thread that first writes them, so decode on the consumer's node
+    ThreadAffinity::PinCurrentThread(node);
+
+    decoder_lock_.lock();
+    decoder_->set_planar_output_allowed(planar_allowed);
+    decoder_->set_divider(frame_divider);
+    decoder_->set_playback_speed(frame_playback_speed);
+    FramePtr frame;
+    {
+      ProfilerTimer timer(Profiler::kPrefetch, -1, time);
+
+      frame = decoder_->Retrieve(time);
+    }
+    decoder_lock_.unlock();
+
+    queue_lock_.lock();
+
+    if (generation != generation_) {
+      // The queue was dropped while we were decoding, this frame is no longer wanted
+      continue;
+    }
+
+    if (frame == nullptr) {
+      // Probably reached the start or end of the media
+      active_ = false;
+      continue;
+    }
+
+    // Variable frame rate media may give us the same frame again, just move on if so
+    if (queue_.isEmpty() || queue_.last().frame->native_timestamp() != frame->native_timestamp()) {
+      QueuedFrame q;
+      q.time = time;
+      q.frame = frame;
+      q.planar_output_allowed = planar_allowed;
+      q.divider = frame_divider;
+      q.playback_speed = frame_playback_speed;
+      queue_.append(q);
+    }
+
+    next_time_ = time + step_;
+
+    // Don't go past the start of the media
+    if (next_time_ < 0) {
+      active_ = false;
+    }
+  }
+
+  queue_lock_.unlock();
+}
+
+void DecoderPrefetcher::DropQueue()
+{
+  queue_.clear();
+  generation_++;
+}
+
+FramePtr DecoderPrefetcher::TakeGOPFrame(const rational &timecode, const int64_t &target_ts)
+{
+  QMutexLocker locker(&gop_lock_);
+
+  GOPJobPtr job = nullptr;
+
+  foreach (GOPJobPtr j, gops_) {
+    if (timecode >= j->start && (j->end == RATIONAL_MIN || timecode < j->end)) {
+      job = j;
+      break;
+    }
+  }
+
+  if (job == nullptr
+      || job->planar_output_allowed != planar_output_allowed()
+      || job->divider != divider()) {
+    return nullptr;
+  }
+
+  // Playback has moved on from any jobs before this one
+  while (gops_.first() != job) {
+    gops_.first()->cancelled = true;
+    gops_.removeFirst();
+  }
+
+  gop_cond_.wakeAll();
+
+  while (true) {
+    for (int i=0;i<job->frames.size();i++) {
+      int64_t ts = job->frames.at(i)->native_timestamp();
+
+      if (ts == target_ts) {
+        FramePtr frame = job->frames.takeAt(i);
+
+        // Frames well behind this one won't be asked for anymore, free up room for the job to continue
+        if (i > kGOPReorderFrames) {
+          job->frames.erase(job->frames.begin(), job->frames.begin() + (i - kGOPReorderFrames));
+        }
+
+        gop_cond_.wakeAll();
+
+        return frame;
+      }
+
+      if (ts > target_ts) {
+        // Already taken or never decoded, either way it isn't coming
+        return nullptr;
+      }
+    }
+
+    if (job->done || job->cancelled || retrieve_cancelled()) {
+      return nullptr;
+    }
+
+    gop_cond_.wait(&gop_lock_);
+  }
+}
+
+void DecoderPrefetcher::ScheduleGOPs(const rational &timecode)
+{
+  QMutexLocker locker(&gop_lock_);
+
+  // Jobs that have been played through
+  while (!gops_.isEmpty() && gops_.first()->end != RATIONAL_MIN && gops_.first()->end <= timecode) {
+    gops_.first()->cancelled = true;
+    gops_.removeFirst();
+  }
+
+  // Jobs from before a seek backwards won't be needed, nor will jobs decoding with other settings
+  if (!gops_.isEmpty()
+      && (timecode < gop_anchor_
+          || gops_.first()->planar_output_allowed != planar_output_allowed()
+          || gops_.first()->divider != divider())) {
+    DropGOPs();
+  }
+
+  rational next;
+
+  if (gops_.isEmpty()) {
+    gop_step_ = GetFrameDuration();
+
+    if (gop_step_ <= 0) {
+      return;
+    }
+
+    // The first job starts at the end of this GOP, which is the same for any time until then
+    gop_anchor_ = timecode;
+    next = GetNextKeyframe(timecode);
+  } else {
+    next = gops_.last()->end;
+  }
+
+  while (next != RATIONAL_MIN && gops_.size() < kGOPParallelDecoders) {
+    GOPJobPtr job = std::make_shared<GOPJob>();
+
+    job->start = next;
+
+    // Short GOPs are grouped so each job is worth starting
+    job->end = GetNextKeyframe(next);
+
+    while (job->end != RATIONAL_MIN && job->end < next + gop_step_ * kGOPMinFrames) {
+      job->end = GetNextKeyframe(job->end);
+    }
+
+    job->step = gop_step_;
+    job->last_ts = INT64_MIN;
+    job->planar_output_allowed = planar_output_allowed();
+    job->divider = divider();
+    job->done = false;
+    job->cancelled = false;
+
+    gops_.append(job);
+    gop_pool_.start(new GOPRunner(this, job));
+
+    next = job->end;
+  }
+
+  // The current GOP is still decoded by the main decoder, but not past where the jobs start
+  queue_lock_.lock();
+  prefetch_limit_ = gops_.isEmpty() ? RATIONAL_MAX : gops_.first()->start;
+  queue_lock_.unlock();
+}
+
+void DecoderPrefetcher::DropGOPs()
+{
+  if (gops_.isEmpty()) {
+    return;
+  }
+
+  foreach (GOPJobPtr job, gops_) {
+    job->cancelled = true;
+  }
+
+  gops_.clear();
+
+  gop_cond_.wakeAll();
+
+  queue_lock_.lock();
+  prefetch_limit_ = RATIONAL_MAX;
+  queue_lock_.unlock();
+}
+
+void DecoderPrefetcher::RunGOP(GOPJobPtr job)
+{
+  QMutexLocker locker(&gop_lock_);
+
+  DecoderPtr helper;
+
+  if (gop_decoders_.isEmpty()) {
+    locker.unlock();
+
+    helper = Decoder::CreateFromID(id());
+
+    if (helper != nullptr) {
+      helper->set_stream(stream());
+    }
+
+    locker.relock();
+  } else {
+    helper = gop_decoders_.takeLast();
+  }
+
+  rational time = job->start;
+
+  while (helper != nullptr && !job->cancelled && (job->end == RATIONAL_MIN || time < job->end)) {
+    // Every buffered frame holds a full frame buffer, so only stay one frame ahead while memory is short
+    int depth = olive::image_cache.UnderPressure(ImageCache::kMemBuf) ? 1 : kGOPParallelBufferFrames;
+
+    if (job->frames.size() >= depth) {
+      gop_cond_.wait(&gop_lock_);
+      continue;
+    }
+
+    locker.unlock();
+
+    helper->set_planar_output_allowed(job->planar_output_allowed);
+    helper->set_divider(job->divider);
+
+    FramePtr frame;
+    {
+      ProfilerTimer timer(Profiler::kPrefetch, -1, time);
+
+      frame = helper->Retrieve(time);
+    }
+
+    locker.relock();
+
+    if (frame == nullptr) {
+      // Probably reached the end of the media
+      break;
+    }
+
+    if (frame->native_timestamp() != job->last_ts) {
+      job->frames.append(frame);
+      job->last_ts = frame->native_timestamp();
+
+      gop_cond_.wakeAll();
+    }
+
+    time += job->step;
+  }
+
+  job->done = true;
+
+  if (helper != nullptr) {
+    gop_decoders_.append(helper);
+  }
+
+  gop_cond_.wakeAll();
+}
+
+DecoderPrefetcher::Worker::Worker(DecoderPrefetcher *parent) :
+  parent_(parent)
+{
+}
+
+void DecoderPrefetcher::Worker::run()
+{
+  parent_->PrefetchLoop();
+}
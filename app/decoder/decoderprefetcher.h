@@ -0,0 +1,262 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef DECODERPREFETCHER_H
+#define DECODERPREFETCHER_H
+
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include "decoder/decoder.h"
+
+/**
+ * @brief A Decoder that wraps another Decoder and decodes frames ahead of time on a worker thread
+ *
+ * Retrieve() is usually called from the render thread, so without prefetching every frame's decode time is added to
+ * the time it takes to render it. DecoderPrefetcher keeps a worker thread decoding the next depth() frames after the
+ * last requested time (in whichever direction playback is going) into a bounded queue. As long as requests follow on
+ * from each other, Retrieve() just takes the next frame out of the queue.
+ *
+ * If a request isn't in the queue (e.g. the user seeked or changed direction), the queue is dropped, the frame is
+ * retrieved directly, and prefetching restarts from there.
+ *
+ * When frames are retrieved through a range in order (see Decoder::read_ahead(), e.g. during export), one decoder can't
+ * keep up with long-GOP media however far ahead it works, since every frame depends on the one before it. The range
+ * after the current GOP is then split at its keyframes and up to kGOPParallelDecoders GOPs are decoded in parallel on
+ * helper Decoders of their own. Retrieve() takes their frames in order once playback reaches them.
+ *
+ * Only video retrieval is prefetched, other calls are passed straight through to the wrapped Decoder. This class is
+ * thread-safe as far as its own Decoder functions are concerned (the wrapped Decoder is only accessed with a lock).
+ */
+class DecoderPrefetcher : public Decoder
+{
+public:
+  DecoderPrefetcher(DecoderPtr decoder, int depth);
+
+  virtual ~DecoderPrefetcher() override;
+
+  virtual QString id() override;
+
+  virtual bool Probe(Footage* f) override;
+
+  virtual bool Open() override;
+
+  virtual FramePtr Retrieve(const rational& timecode, const rational& length = 0) override;
+
+  virtual void Close() override;
+
+  virtual void Preroll(const rational& time) override;
+
+  virtual int64_t GetTimestampFromTime(const rational& time) override;
+
+  virtual rational GetFrameDuration() override;
+
+  virtual rational GetNextKeyframe(const rational& time) override;
+
+  virtual bool Analyze() override;
+
+  /**
+   * @brief Maximum number of frames to decode ahead of the last requested time
+   */
+  int depth();
+  void set_depth(int depth);
+
+private:
+  /**
+   * @brief Thread that runs PrefetchLoop()
+   */
+  class Worker : public QThread
+  {
+  public:
+    Worker(DecoderPrefetcher* parent);
+
+  protected:
+    virtual void run() override;
+
+  private:
+    DecoderPrefetcher* parent_;
+  };
+
+  /**
+   * @brief Runs RunGOP() for a job on gop_pool_
+   */
+  class GOPRunner;
+
+  /**
+   * @brief A range of the media starting on a keyframe that's decoded by a helper Decoder
+   */
+  struct GOPJob {
+    rational start;
+
+    /// Where the job stops (the keyframe of the next job), RATIONAL_MIN for the end of the media
+    rational end;
+
+    rational step;
+
+    /// Frames decoded that Retrieve() hasn't taken yet, in order
+    QList<FramePtr> frames;
+
+    /// Timestamp of the last frame decoded, variable frame rate media may give us the same frame twice
+    int64_t last_ts;
+
+    /// Settings of planar_output_allowed() and divider() the job decodes with
+    bool planar_output_allowed;
+    int divider;
+
+    bool done;
+    bool cancelled;
+  };
+
+  using GOPJobPtr = std::shared_ptr<GOPJob>;
+
+  struct QueuedFrame {
+    rational time;
+    FramePtr frame;
+
+    /// Settings of planar_output_allowed(), divider(), and playback_speed() when this frame was decoded
+    bool planar_output_allowed;
+    int divider;
+    int playback_speed;
+  };
+
+  /**
+   * @brief Main loop of the worker thread
+   */
+  void PrefetchLoop();
+
+  /**
+   * @brief Drop every queued frame and stop any frame being prefetched from being queued, assumes queue_lock_ is held
+   */
+  void DropQueue();
+
+  /**
+   * @brief Take the frame at `target_ts` from the GOP job covering `timecode`, waiting for it to be decoded if needed
+   *
+   * Returns nullptr if no job covers `timecode` (or it can't provide the frame), in which case the frame should be
+   * retrieved normally. Jobs before this one are no longer needed and are dropped.
+   */
+  FramePtr TakeGOPFrame(const rational& timecode, const int64_t& target_ts);
+
+  /**
+   * @brief Start jobs for the GOPs following `timecode` until kGOPParallelDecoders are running
+   *
+   * Jobs that don't follow on from `timecode` (because the request was a seek) are dropped first.
+   */
+  void ScheduleGOPs(const rational& timecode);
+
+  /**
+   * @brief Cancel every GOP job, assumes gop_lock_ is held
+   */
+  void DropGOPs();
+
+  /**
+   * @brief Decode a GOP job's frames on a helper Decoder until it reaches its end or is cancelled
+   */
+  void RunGOP(GOPJobPtr job);
+
+  DecoderPtr decoder_;
+
+  /**
+   * @brief Locked whenever decoder_ is used
+   */
+  QMutex decoder_lock_;
+
+  QList<QueuedFrame> queue_;
+
+  int depth_;
+
+  /**
+   * @brief Time of the next frame the worker should prefetch
+   */
+  rational next_time_;
+
+  /**
+   * @brief Length of time between prefetched frames, negative when playing backwards
+   */
+  rational step_;
+
+  rational last_request_time_;
+
+  /**
+   * @brief Incremented every time the queue is dropped so the worker can tell if the frame it just decoded is stale
+   */
+  int generation_;
+
+  /**
+   * @brief Whether the worker should be prefetching at all (e.g. FALSE after Close() or after reaching the end)
+   */
+  bool active_;
+
+  bool quit_;
+
+  /**
+   * @brief NUMA node of the thread calling Retrieve(), the worker moves there so frames are decoded into its memory
+   */
+  int consumer_node_;
+
+  /**
+   * @brief The worker doesn't prefetch forward past this as it's where the first GOP job starts
+   */
+  rational prefetch_limit_;
+
+  /**
+   * @brief Guards every member above except decoder_
+   */
+  QMutex queue_lock_;
+
+  QWaitCondition queue_cond_;
+
+  /**
+   * @brief GOP jobs in order, the first one is either ahead of or covering the last requested time
+   */
+  QList<GOPJobPtr> gops_;
+
+  /**
+   * @brief Helper Decoders that aren't running a job
+   */
+  QList<DecoderPtr> gop_decoders_;
+
+  /**
+   * @brief The time the current run of jobs was scheduled from, requests before it are seeks
+   */
+  rational gop_anchor_;
+
+  /**
+   * @brief Frame duration the jobs step by
+   */
+  rational gop_step_;
+
+  /**
+   * @brief Guards every GOP member above and the jobs in gops_
+   */
+  QMutex gop_lock_;
+
+  QWaitCondition gop_cond_;
+
+  QThreadPool gop_pool_;
+
+  Worker worker_;
+
+};
+
+#endif // DECODERPREFETCHER_H
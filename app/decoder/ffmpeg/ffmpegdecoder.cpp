@@ -23,15 +23,44 @@
 extern "C" {
 #include <libavformat/avformat.h>
 #include <libavcodec/avcodec.h>
+#include <libavutil/hwcontext.h>
 }
 
+#include <algorithm>
+#include <cstring>
 #include <QDebug>
+#include <QElapsedTimer>
 #include <QFile>
 #include <QString>
 #include <QtMath>
 
 #include "common/filefunctions.h"
+#include "config/config.h"
+#include "decoder/mediamirror.h"
+#include "ffmpegio.h"
 #include "render/pixelservice.h"
+#include "render/renderstats.h"
+#include "render/sampleservice.h"
+
+/**
+ * @brief Number of frames indexed between saves of the partial index
+ */
+const int kIndexPartialSaveInterval = 2000;
+
+/**
+ * @brief Number of packets at the start of a stream IndexUniform() checks, and the most it reads at the end
+ */
+const int kIndexUniformProbePackets = 32;
+
+/**
+ * @brief Minimum length (in seconds) of decoded audio kept in the ring buffer
+ */
+const int kAudioBufferLength = 10;
+
+/**
+ * @brief How far ahead (in seconds) of the buffered audio a request can start before we seek rather than decode to it
+ */
+const int kAudioSeekThreshold = 1;
 
 FFmpegDecoder::FFmpegDecoder() :
   fmt_ctx_(nullptr),
@@ -40,7 +69,15 @@ FFmpegDecoder::FFmpegDecoder() :
   frame_(nullptr),
   pkt_(nullptr),
   scale_ctx_(nullptr),
-  resample_ctx_(nullptr)
+  resample_ctx_(nullptr),
+  ideal_pix_fmt_(AV_PIX_FMT_NONE),
+  ideal_sample_fmt_(AV_SAMPLE_FMT_NONE),
+  lowres_(0),
+  hw_device_ctx_(nullptr),
+  hw_pix_fmt_(AV_PIX_FMT_NONE),
+  sw_frame_(nullptr),
+  audio_eof_(false),
+  seeked_(false)
 {
 }
 
@@ -57,30 +94,17 @@ bool FFmpegDecoder::Open()
 
   int error_code;
 
-  // Convert QString to a C strng
-  QByteArray ba = stream()->footage()->filename().toUtf8();
-  const char* filename = ba.constData();
-
-  // Open file in a format context
-  error_code = avformat_open_input(&fmt_ctx_, filename, nullptr, nullptr);
-
-  // Handle format context error
-  if (error_code != 0) {
-    FFmpegError(error_code);
-    return false;
-  }
-
-  // Get stream information from format
-  error_code = avformat_find_stream_info(fmt_ctx_, nullptr);
+  // Share a demuxer with the decoders of this file's other streams so the file is only read once
+  // Read from the local copy of this file if there's one (see MediaMirror)
+  demuxer_ = FFmpegDemuxer::Acquire(MediaMirror::Instance()->Resolve(stream()->footage()->filename()),
+                                    stream()->index());
 
-  // Handle get stream information error
-  if (error_code < 0) {
-    FFmpegError(error_code);
+  if (demuxer_ == nullptr) {
+    Error(tr("Failed to open %1").arg(stream()->footage()->filename()));
     return false;
   }
 
-  // Dump format information
-  av_dump_format(fmt_ctx_, stream()->index(), filename, 0);
+  fmt_ctx_ = demuxer_->format_context();
 
   // Get reference to correct AVStream
   avstream_ = fmt_ctx_->streams[stream()->index()];
@@ -111,6 +135,19 @@ bool FFmpegDecoder::Open()
     return false;
   }
 
+  // Try to decode on the GPU if possible, the software decoder is used if this fails
+  if (kUseHardwareDecoding && codec_ctx_->codec_type == AVMEDIA_TYPE_VIDEO) {
+    SetupHardwareDecoding(codec);
+  }
+
+  // Decode at reduced resolution if the codec supports it (hardware decoders don't)
+  lowres_ = 0;
+
+  if (codec_ctx_->codec_type == AVMEDIA_TYPE_VIDEO && hw_device_ctx_ == nullptr) {
+    lowres_ = GetLowresForDivider(codec);
+    codec_ctx_->lowres = lowres_;
+  }
+
   // enable multithreading on decoding
   error_code = av_dict_set(&opts_, "threads", "auto", 0);
 
@@ -133,11 +170,11 @@ bool FFmpegDecoder::Open()
     AVPixelFormat pix_fmt = static_cast<AVPixelFormat>(avstream_->codecpar->format);
 
     // Get an Olive compatible AVPixelFormat
-    AVPixelFormat ideal_pix_fmt = GetCompatiblePixelFormat(pix_fmt);
+    ideal_pix_fmt_ = GetCompatiblePixelFormat(pix_fmt);
 
     // Determine which Olive native pixel format we retrieved
     // Note that FFmpeg doesn't support float formats
-    switch (ideal_pix_fmt) {
+    switch (ideal_pix_fmt_) {
     case AV_PIX_FMT_RGBA:
       output_fmt_ = olive::PIX_FMT_RGBA8;
       break;
@@ -149,19 +186,60 @@ bool FFmpegDecoder::Open()
       return false;
     }
 
-    scale_ctx_ = sws_getContext(avstream_->codecpar->width,
-                                avstream_->codecpar->height,
-                                pix_fmt,
-                                avstream_->codecpar->width,
-                                avstream_->codecpar->height,
-                                ideal_pix_fmt,
-                                0,
-                                nullptr,
-                                nullptr,
-                                nullptr);
-
+    // The scaler is set up in Retrieve() since the size and format of the frames it converts can change
   } else if (codec_ctx_->codec_type == AVMEDIA_TYPE_AUDIO) {
-    // FIXME: Fill this in
+    // Set up sample format conversion for audio
+    ideal_sample_fmt_ = GetCompatibleSampleFormat(codec_ctx_->sample_fmt);
+
+    switch (ideal_sample_fmt_) {
+    case AV_SAMPLE_FMT_U8:
+      output_fmt_ = olive::SAMPLE_FMT_U8;
+      break;
+    case AV_SAMPLE_FMT_S16:
+      output_fmt_ = olive::SAMPLE_FMT_S16;
+      break;
+    case AV_SAMPLE_FMT_S32:
+      output_fmt_ = olive::SAMPLE_FMT_S32;
+      break;
+    case AV_SAMPLE_FMT_DBL:
+      output_fmt_ = olive::SAMPLE_FMT_DBL;
+      break;
+    default:
+      output_fmt_ = olive::SAMPLE_FMT_FLT;
+    }
+
+    // Some files don't specify a layout, assume the default one for this many channels
+    int64_t channel_layout = static_cast<int64_t>(codec_ctx_->channel_layout);
+    if (channel_layout == 0) {
+      channel_layout = av_get_default_channel_layout(codec_ctx_->channels);
+    }
+
+    // Keep the stream's layout and sample rate, we only convert the sample format here
+    resample_ctx_ = swr_alloc_set_opts(nullptr,
+                                       channel_layout,
+                                       ideal_sample_fmt_,
+                                       codec_ctx_->sample_rate,
+                                       channel_layout,
+                                       codec_ctx_->sample_fmt,
+                                       codec_ctx_->sample_rate,
+                                       0,
+                                       nullptr);
+
+    if (resample_ctx_ == nullptr) {
+      Error(tr("Failed to allocate resampler"));
+      return false;
+    }
+
+    error_code = swr_init(resample_ctx_);
+    if (error_code < 0) {
+      FFmpegError(error_code);
+      return false;
+    }
+
+    audio_buffer_.Allocate(kAudioBufferLength * codec_ctx_->sample_rate,
+                           SampleService::BytesPerSample(static_cast<olive::SampleFormat>(output_fmt_))
+                           * codec_ctx_->channels);
+    audio_eof_ = false;
   }
 
   // Allocate a packet for reading
@@ -182,6 +260,16 @@ bool FFmpegDecoder::Open()
     return false;
   }
 
+  // Allocate a frame for downloading hardware frames into
+  if (hw_device_ctx_ != nullptr) {
+    sw_frame_ = av_frame_alloc();
+
+    if (sw_frame_ == nullptr) {
+      Error(tr("Failed to allocate AVFrame"));
+      return false;
+    }
+  }
+
   // All allocation succeeded so we set the state to open
   open_ = true;
 
@@ -194,6 +282,19 @@ FramePtr FFmpegDecoder::Retrieve(const rational &timecode, const rational &lengt
     return nullptr;
   }
 
+  if (avstream_->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
+    return RetrieveAudio(timecode, length);
+  }
+
+  // The codec has to be reopened to change the resolution it decodes at
+  if (hw_device_ctx_ == nullptr && GetLowresForDivider(codec_ctx_->codec) != lowres_) {
+    Close();
+
+    if (!Open()) {
+      return nullptr;
+    }
+  }
+
   // Convert timecode to AVStream timebase
   int64_t target_ts = GetTimestampFromTime(timecode);
 
@@ -202,41 +303,50 @@ FramePtr FFmpegDecoder::Retrieve(const rational &timecode, const rational &lengt
     return nullptr;
   }
 
+  // Finding and decoding the frame is timed for the render stats, converting it afterwards isn't
+  QElapsedTimer decode_timer;
+  decode_timer.start();
+
+  seeked_ = false;
+
   // Cache FFmpeg error code returns
   int ret = 0;
 
-  // Set up seeking loop
-  int64_t seek_ts = target_ts;
-  int64_t second_ts = qRound(rational(avstream_->time_base).flipped().toDouble());
-  bool got_frame = false;
-  bool last_backtrack = false;
-
-  // FFmpeg frame retrieve loop
-  while (ret >= 0 && frame_->pts != target_ts) {
+  bool estimated = (frame_index_ == nullptr || frame_index_->count() == 0);
 
-    // If the frame timestamp is too large, we need to seek back a little
-    if (got_frame && (frame_->pts > target_ts || frame_->pts == AV_NOPTS_VALUE)) {
-      // If we already tried seeking to 0 though, there's nothing we can do so we error here
-      if (last_backtrack) {
-        // Must be the earliest frame in the file
-        break;
-      }
+  // While shuttling, GetTimestampFromTime() has already snapped the target to a keyframe, so the decoder doesn't need
+  // to spend any time on the frames in between
+  codec_ctx_->skip_frame = keyframes_only() ? AVDISCARD_NONKEY : AVDISCARD_DEFAULT;
 
-      // We can't seek earlier than 0, so if this is a 0-seek, don't try any more times after this attempt
-      if (seek_ts <= 0) {
-        seek_ts = 0;
-        last_backtrack = true;
-      }
+  // The frame the output is made from, either frame_ or one buffered for reverse playback
+  AVFrame* decoded = nullptr;
 
-      avcodec_flush_buffers(codec_ctx_);
-      av_seek_frame(fmt_ctx_, avstream_->index, seek_ts, AVSEEK_FLAG_BACKWARD);
+  bool reverse = (playback_speed() < 0 && !keyframes_only());
 
-      // FFmpeg doesn't always seek correctly, if we have to seek again we wrangle it into seeking back far enough
-      seek_ts -= second_ts;
+  if (!reverse) {
+    ClearReverseFrames();
+  } else if (!estimated) {
+    // Playing backwards, so decode the target's GOP forward once and serve the frames before it from the buffer
+    if (!reverse_frames_.contains(target_ts)) {
+      BufferReverseFrames(target_ts);
     }
 
-    ret = GetFrame();
-    got_frame = true;
+    // If that somehow missed the target, fall back to retrieving it normally
+    decoded = reverse_frames_.value(target_ts, nullptr);
+  }
+
+  if (decoded != nullptr) {
+    // Served from the reverse playback buffer, nothing to decode
+  } else if (estimated) {
+    // No index yet (it's probably still being built by an IndexTask), so seek to the estimated timestamp
+    ret = RetrieveEstimated(target_ts);
+  } else if (frame_->pts != target_ts) {
+    ret = DecodeToTimestamp(target_ts);
+  }
+
+  // Nobody wants this frame anymore, so this isn't an error
+  if (ret == AVERROR_EXIT && retrieve_cancelled()) {
+    return nullptr;
   }
 
   // Handle any errors received during the frame retrieve process
@@ -245,37 +355,153 @@ FramePtr FFmpegDecoder::Retrieve(const rational &timecode, const rational &lengt
     return nullptr;
   }
 
+  if (decoded == nullptr) {
+    decoded = frame_;
+  }
+
+  olive::render_stats.Add(seeked_ ? RenderStats::kDecodeSeek : RenderStats::kDecodeSequential);
+  olive::render_stats.Add(RenderStats::kDecodeTime, decode_timer.nsecsElapsed());
+
+  // If this frame was decoded on the GPU, download it so we can convert it
+  AVFrame* src_frame = decoded;
+
+  if (hw_pix_fmt_ != AV_PIX_FMT_NONE && decoded->format == hw_pix_fmt_) {
+    // Frames returned earlier may still hold references to the last download's buffers, so drop ours and let the
+    // transfer allocate new ones rather than writing over pixels that are still in use
+    av_frame_unref(sw_frame_);
+
+    ret = av_hwframe_transfer_data(sw_frame_, decoded, 0);
+
+    if (ret < 0) {
+      FFmpegError(ret);
+      return nullptr;
+    }
+
+    src_frame = sw_frame_;
+  }
+
+  // Whatever resolution the codec decoded at, scale the rest of the way to 1/divider of the full size
+  int dst_width = qMax((avstream_->codecpar->width + divider() - 1) / divider(), 1);
+  int dst_height = qMax((avstream_->codecpar->height + divider() - 1) / divider(), 1);
+
   // Frame was valid, now we create an Olive frame to place the data into
   FramePtr frame_container = Frame::Create();
-  frame_container->set_width(frame_->width);
-  frame_container->set_height(frame_->height);
+  frame_container->set_width(dst_width);
+  frame_container->set_height(dst_height);
   frame_container->set_format(output_fmt_);
-  frame_container->set_timestamp(rational(frame_->pts * avstream_->time_base.num, avstream_->time_base.den));
-  frame_container->set_native_timestamp(frame_->pts);
-  frame_container->allocate();
+  frame_container->set_timestamp(rational(decoded->pts * avstream_->time_base.num, avstream_->time_base.den));
+  // If the timestamp was estimated, we use the estimate so it matches what GetTimestampFromTime() returns
+  frame_container->set_native_timestamp(estimated ? target_ts : decoded->pts);
 
-  // Convert pixel format/linesize if necessary
-  uint8_t* dst_data = frame_container->data();
   int dst_linesize = frame_container->width() * PixelService::BytesPerPixel(static_cast<olive::PixelFormat>(output_fmt_));
 
-  // Perform pixel conversion
-  sws_scale(scale_ctx_,
-            frame_->data,
-            frame_->linesize,
-            0,
-            frame_->height,
-            &dst_data,
-            &dst_linesize);
+  olive::YUVInfo yuv_info;
+
+  bool dst_size_matches = (src_frame->width == dst_width && src_frame->height == dst_height);
+
+  if (planar_output_allowed_ && GetYUVInfo(src_frame, &yuv_info)) {
+    // Pass native YUV planes straight through so they can be converted on the GPU. These are at whatever size the
+    // codec decoded at, the GPU takes care of any scaling that's left.
+    frame_container->set_width(src_frame->width);
+    frame_container->set_height(src_frame->height);
+
+    AVFrame* ref = av_frame_clone(src_frame);
+
+    if (ref == nullptr) {
+      Error(tr("Failed to allocate AVFrame"));
+      return nullptr;
+    }
+
+    std::shared_ptr<AVFrame> owner(ref, [](AVFrame* f) {
+      av_frame_free(&f);
+    });
+
+    frame_container->wrap((yuv_info.layout == olive::YUV_LAYOUT_SEMIPLANAR) ? 2 : 3, ref->data, ref->linesize, owner);
+    frame_container->set_yuv_info(yuv_info);
+  } else if (dst_size_matches && src_frame->format == ideal_pix_fmt_ && src_frame->linesize[0] == dst_linesize) {
+    // The decoded data is already in the format we need, so rather than copying it we take a reference to the
+    // AVFrame's buffers and let the Frame wrap them
+    AVFrame* ref = av_frame_clone(src_frame);
 
-  // Audio decoding will use a length value eventually
-  Q_UNUSED(length)
+    if (ref == nullptr) {
+      Error(tr("Failed to allocate AVFrame"));
+      return nullptr;
+    }
+
+    std::shared_ptr<AVFrame> owner(ref, [](AVFrame* f) {
+      av_frame_free(&f);
+    });
+
+    frame_container->wrap(1, ref->data, ref->linesize, owner);
+  } else {
+    // Hardware frames download in a different pixel format (e.g. NV12) to the one the stream reports, so the
+    // scaler is set up from the frame rather than the stream
+    scale_ctx_ = sws_getCachedContext(scale_ctx_,
+                                      src_frame->width,
+                                      src_frame->height,
+                                      static_cast<AVPixelFormat>(src_frame->format),
+                                      dst_width,
+                                      dst_height,
+                                      ideal_pix_fmt_,
+                                      SWS_FAST_BILINEAR,
+                                      nullptr,
+                                      nullptr,
+                                      nullptr);
+
+    if (scale_ctx_ == nullptr) {
+      Error(tr("Failed to create scaling context"));
+      return nullptr;
+    }
+
+    frame_container->allocate();
+
+    // Convert pixel format/linesize if necessary
+    uint8_t* dst_data = frame_container->data();
+
+    // Perform pixel conversion
+    sws_scale(scale_ctx_,
+              src_frame->data,
+              src_frame->linesize,
+              0,
+              src_frame->height,
+              &dst_data,
+              &dst_linesize);
+  }
 
   return frame_container;
 }
 
+void FFmpegDecoder::Preroll(const rational &time)
+{
+  if (!open_
+      || avstream_->codecpar->codec_type != AVMEDIA_TYPE_VIDEO
+      || frame_index_ == nullptr
+      || frame_index_->count() == 0) {
+    return;
+  }
+
+  int64_t target_ts = GetTimestampFromTime(time);
+
+  if (target_ts < 0 || frame_->pts == target_ts) {
+    return;
+  }
+
+  codec_ctx_->skip_frame = AVDISCARD_DEFAULT;
+
+  int ret = DecodeToTimestamp(target_ts);
+
+  if (ret < 0 && ret != AVERROR_EXIT) {
+    FFmpegError(ret);
+  }
+}
+
 void FFmpegDecoder::Close()
 {
-  frame_index_.clear();
+  ClearReverseFrames();
+
+  frame_index_ = nullptr;
+  building_index_.clear();
+  index_check_timer_.invalidate();
 
   if (scale_ctx_ != nullptr) {
     sws_freeContext(scale_ctx_);
@@ -297,6 +523,11 @@ void FFmpegDecoder::Close()
     frame_ = nullptr;
   }
 
+  if (sw_frame_ != nullptr) {
+    av_frame_free(&sw_frame_);
+    sw_frame_ = nullptr;
+  }
+
   if (opts_ != nullptr) {
     av_dict_free(&opts_);
     opts_ = nullptr;
@@ -307,11 +538,27 @@ void FFmpegDecoder::Close()
     codec_ctx_ = nullptr;
   }
 
-  if (fmt_ctx_ != nullptr) {
-    avformat_close_input(&fmt_ctx_);
+  if (demuxer_ != nullptr) {
+    // The format context belongs to the demuxer
+    demuxer_->Release(avstream_->index);
+    demuxer_ = nullptr;
     fmt_ctx_ = nullptr;
+  } else if (fmt_ctx_ != nullptr) {
+    FFmpegIO::CloseInput(&fmt_ctx_);
+    fmt_ctx_ = nullptr;
+  }
+
+  if (hw_device_ctx_ != nullptr) {
+    av_buffer_unref(&hw_device_ctx_);
+    hw_device_ctx_ = nullptr;
   }
 
+  hw_pix_fmt_ = AV_PIX_FMT_NONE;
+
+  audio_buffer_.Allocate(0, 0);
+  audio_convert_buffer_.clear();
+  audio_eof_ = false;
+
   open_ = false;
 }
 
@@ -332,9 +579,46 @@ int64_t FFmpegDecoder::GetTimestampFromTime(const rational &time)
   // Find closest actual timebase in the file
   target_ts = GetClosestTimestampInIndex(target_ts);
 
+  // While shuttling, only keyframes are retrieved (see Decoder::keyframes_only())
+  if (keyframes_only()
+      && avstream_->codecpar->codec_type == AVMEDIA_TYPE_VIDEO
+      && frame_index_ != nullptr
+      && frame_index_->count() > 0) {
+    target_ts = frame_index_->pts(frame_index_->GetKeyframeBefore(frame_index_->GetClosestEntry(target_ts)));
+  }
+
   return target_ts;
 }
 
+rational FFmpegDecoder::GetFrameDuration()
+{
+  if ((!open_ && !Open()) || avstream_->codecpar->codec_type != AVMEDIA_TYPE_VIDEO) {
+    return 0;
+  }
+
+  return rational(GetEstimatedFrameDuration() * avstream_->time_base.num, avstream_->time_base.den);
+}
+
+rational FFmpegDecoder::GetNextKeyframe(const rational &time)
+{
+  if ((!open_ && !Open())
+      || avstream_->codecpar->codec_type != AVMEDIA_TYPE_VIDEO
+      || frame_index_ == nullptr
+      || frame_index_->count() == 0) {
+    return RATIONAL_MIN;
+  }
+
+  int64_t ts = qRound64(time.toDouble() * rational(avstream_->time_base).flipped().toDouble());
+
+  for (int i=frame_index_->GetClosestEntry(ts)+1;i<frame_index_->count();i++) {
+    if (frame_index_->keyframe(i)) {
+      return rational(frame_index_->pts(i) * avstream_->time_base.num, avstream_->time_base.den);
+    }
+  }
+
+  return RATIONAL_MIN;
+}
+
 bool FFmpegDecoder::Probe(Footage *f)
 {
   if (open_) {
@@ -348,18 +632,16 @@ bool FFmpegDecoder::Probe(Footage *f)
   // Result to return
   bool result = false;
 
-  // Convert QString to a C strng
-  QByteArray ba = f->filename().toUtf8();
-  const char* filename = ba.constData();
-
   // Open file in a format context
-  error_code = avformat_open_input(&fmt_ctx_, filename, nullptr, nullptr);
+  error_code = FFmpegIO::OpenInput(&fmt_ctx_, f->filename());
 
   // Handle format context error
   if (error_code == 0) {
 
+#ifndef NDEBUG
     // Retrieve metadata about the media
-    av_dump_format(fmt_ctx_, 0, filename, 0);
+    av_dump_format(fmt_ctx_, 0, f->filename().toUtf8().constData(), 0);
+#endif
 
     // Dump it into the Footage object
     for (unsigned int i=0;i<fmt_ctx_->nb_streams;i++) {
@@ -434,6 +716,14 @@ bool FFmpegDecoder::Probe(Footage *f)
   return result;
 }
 
+bool FFmpegDecoder::SupportsExtension(const QString &extension)
+{
+  // Demuxers list their extensions (and for some, like "mov,mp4,m4a", their names are extensions too)
+  static const QSet<QString> extensions = GetDemuxerExtensions();
+
+  return extensions.contains(extension);
+}
+
 void FFmpegDecoder::FFmpegError(int error_code)
 {
   char err[1024];
@@ -451,6 +741,29 @@ void FFmpegDecoder::Error(const QString &s)
   Close();
 }
 
+bool FFmpegDecoder::Analyze()
+{
+  analysis_cancelled_ = false;
+
+  if (!open_ && !Open()) {
+    return false;
+  }
+
+  // Only video streams are indexed at the moment
+  if (avstream_->codecpar->codec_type != AVMEDIA_TYPE_VIDEO) {
+    return true;
+  }
+
+  // Nothing to do if this stream has already been indexed
+  if (LoadFrameIndex(GetIndexFilename())) {
+    return true;
+  }
+
+  Index();
+
+  return (frame_index_ != nullptr);
+}
+
 void FFmpegDecoder::Index()
 {
   if (!open_) {
@@ -459,78 +772,297 @@ void FFmpegDecoder::Index()
   }
 
   // This should be unnecessary, but just in case...
-  frame_index_.clear();
+  frame_index_ = nullptr;
+  building_index_.clear();
 
-  // Iterate through every single frame and get each timestamp
-  // NOTE: Expects no frames to have been read so far
+  if (!IndexUniform()) {
+    demuxer_->Seek(avstream_->index, 0, AVSEEK_FLAG_BACKWARD);
 
-  int ret = 0;
+    // Most containers store enough information in their packets to index without decoding anything, which is orders
+    // of magnitude faster. If this one doesn't, we fall back to decoding every frame.
+    if (!IndexPackets() && !analysis_cancelled()) {
+      building_index_.clear();
 
-  while (true) {
-    ret = GetFrame();
+      avcodec_flush_buffers(codec_ctx_);
+      demuxer_->Seek(avstream_->index, 0, AVSEEK_FLAG_BACKWARD);
 
-    if (ret < 0) {
-      break;
-    } else {
-      frame_index_.append(frame_->pts);
+      IndexFrames();
     }
+
+    // Packets are read in decode order rather than presentation order, lookups rely on the index being sorted
+    std::sort(building_index_.begin(),
+              building_index_.end(),
+              [](const FrameIndex::Entry& a, const FrameIndex::Entry& b) {
+      return a.pts < b.pts;
+    });
+
+    // Save index to file
+    SaveFrameIndex(GetPartialIndexFilename());
+  }
+
+  // Leave a cancelled partial index for next time, but don't use it for retrieving since it's incomplete
+  if (!analysis_cancelled()) {
+    // Promote the partial index to the real one. Doing it this way ensures other decoders never read a half-written
+    // index.
+    QFile::remove(GetIndexFilename());
+    QFile::rename(GetPartialIndexFilename(), GetIndexFilename());
+
+    LoadFrameIndex(GetIndexFilename());
   }
 
-  // Save index to file
-  SaveFrameIndex();
+  building_index_.clear();
 
   // Reset state
   avcodec_flush_buffers(codec_ctx_);
-  av_seek_frame(fmt_ctx_, avstream_->index, 0, AVSEEK_FLAG_BACKWARD);
+  demuxer_->Seek(avstream_->index, 0, AVSEEK_FLAG_BACKWARD);
 }
 
-QString FFmpegDecoder::GetIndexFilename()
+bool FFmpegDecoder::IndexUniform()
 {
-  if (!open_) {
-    qWarning() << tr("GetIndexFilename tried to run while decoder was closed");
-    return QString();
+  const AVCodecDescriptor* desc = avcodec_descriptor_get(avstream_->codecpar->codec_id);
+
+  // Every frame of an intra-only codec is a keyframe, so only the timestamps need checking
+  if (desc == nullptr || !(desc->props & AV_CODEC_PROP_INTRA_ONLY) || avstream_->nb_frames < 2) {
+    return false;
+  }
+
+  int64_t start = AV_NOPTS_VALUE;
+  int64_t step = 0;
+  int64_t last = AV_NOPTS_VALUE;
+  int packets = 0;
+  bool uniform = true;
+
+  // Check the spacing of the first few packets
+  while (uniform && packets < kIndexUniformProbePackets && !analysis_cancelled()) {
+    av_packet_unref(pkt_);
+
+    if (demuxer_->ReadPacket(avstream_->index, pkt_) < 0) {
+      break;
+    }
+
+    if (pkt_->stream_index != avstream_->index || (pkt_->flags & AV_PKT_FLAG_DISCARD)) {
+      continue;
+    }
+
+    if (pkt_->pts == AV_NOPTS_VALUE || !(pkt_->flags & AV_PKT_FLAG_KEY)) {
+      uniform = false;
+    } else if (start == AV_NOPTS_VALUE) {
+      start = pkt_->pts;
+    } else if (step == 0) {
+      step = pkt_->pts - start;
+      uniform = (step > 0);
+    } else {
+      uniform = (pkt_->pts == last + step);
+    }
+
+    last = pkt_->pts;
+    packets++;
+  }
+
+  if (!uniform || step <= 0 || analysis_cancelled()) {
+    av_packet_unref(pkt_);
+    return false;
+  }
+
+  // Then check the end of the stream is where the frame count says it is, still on the same grid
+  int64_t expected_last = start + (avstream_->nb_frames - 1) * step;
+
+  if (demuxer_->Seek(avstream_->index, expected_last, AVSEEK_FLAG_BACKWARD) < 0) {
+    av_packet_unref(pkt_);
+    return false;
   }
 
-  return GetMediaIndexFilename(GetUniqueFileIdentifier(stream()->footage()->filename()))
-      .append(QString::number(avstream_->index));
+  last = AV_NOPTS_VALUE;
+  packets = 0;
+
+  while (uniform && !analysis_cancelled()) {
+    av_packet_unref(pkt_);
+
+    if (demuxer_->ReadPacket(avstream_->index, pkt_) < 0) {
+      break;
+    }
+
+    if (pkt_->stream_index != avstream_->index || (pkt_->flags & AV_PKT_FLAG_DISCARD)) {
+      continue;
+    }
+
+    // If the seek landed a long way back, something doesn't add up
+    packets++;
+
+    uniform = (packets <= kIndexUniformProbePackets
+               && pkt_->pts != AV_NOPTS_VALUE
+               && (pkt_->flags & AV_PKT_FLAG_KEY)
+               && (pkt_->pts - start) % step == 0);
+
+    last = qMax(last, pkt_->pts);
+  }
+
+  av_packet_unref(pkt_);
+
+  if (!uniform || last != expected_last || analysis_cancelled()) {
+    return false;
+  }
+
+  if (!FrameIndex::SaveUniform(GetPartialIndexFilename(),
+                               avstream_->index,
+                               avstream_->time_base,
+                               start,
+                               step,
+                               avstream_->nb_frames)) {
+    qWarning() << tr("Failed to save index for %1").arg(stream()->footage()->filename());
+    return false;
+  }
+
+  return true;
 }
 
-bool FFmpegDecoder::LoadFrameIndex()
+bool FFmpegDecoder::IndexPackets()
 {
-  // Load index from file
-  QFile index_file(GetIndexFilename());
+  int ret;
 
-  if (!index_file.exists()) {
-    return false;
+  int last_progress = -1;
+
+  while (!analysis_cancelled()) {
+    av_packet_unref(pkt_);
+
+    ret = demuxer_->ReadPacket(avstream_->index, pkt_);
+
+    if (ret < 0) {
+      // Reached the end of the file (or an error we can't do anything about)
+      break;
+    }
+
+    if (pkt_->stream_index != avstream_->index || (pkt_->flags & AV_PKT_FLAG_DISCARD)) {
+      continue;
+    }
+
+    // Without presentation timestamps on every packet we'd need the decoder to work out the frame order
+    if (pkt_->pts == AV_NOPTS_VALUE) {
+      av_packet_unref(pkt_);
+      return false;
+    }
+
+    FrameIndex::Entry entry;
+    entry.pts = pkt_->pts;
+    entry.pos = pkt_->pos;
+    entry.keyframe = (pkt_->flags & AV_PKT_FLAG_KEY);
+    building_index_.append(entry);
+
+    ReportIndexProgress(pkt_->pts, &last_progress);
   }
 
-  if (index_file.open(QFile::ReadOnly)) {
-    // Resize based on filesize
-    frame_index_.resize(static_cast<int>(static_cast<size_t>(index_file.size()) / sizeof(int64_t)));
+  av_packet_unref(pkt_);
 
-    // Read frame index into vector
-    index_file.read(reinterpret_cast<char*>(frame_index_.data()),
-                    index_file.size());
+  return !building_index_.isEmpty();
+}
 
-    index_file.close();
+void FFmpegDecoder::IndexFrames()
+{
+  int ret = 0;
 
-    return true;
+  // If a previous index was interrupted, pick up where it left off
+  int64_t resume_pts = AV_NOPTS_VALUE;
+
+  FrameIndexPtr partial = FrameIndex::Load(GetPartialIndexFilename());
+
+  if (partial != nullptr && partial->count() > 0) {
+    building_index_ = partial->ToEntries();
+    resume_pts = building_index_.last().pts;
+
+    ret = Seek(partial->entry(partial->GetKeyframeBefore(partial->count() - 1)));
+
+    if (ret < 0) {
+      // Couldn't seek to where we left off, start again from the beginning
+      building_index_.clear();
+      resume_pts = AV_NOPTS_VALUE;
+
+      avcodec_flush_buffers(codec_ctx_);
+      demuxer_->Seek(avstream_->index, 0, AVSEEK_FLAG_BACKWARD);
+    }
   }
 
-  return false;
+  // The partial file gets overwritten as we go, so don't keep it mapped
+  partial = nullptr;
+
+  // Iterate through every single frame and get each timestamp
+  // NOTE: Expects no frames to have been read so far
+
+  int last_progress = -1;
+  int frames_since_save = 0;
+
+  while (!analysis_cancelled()) {
+    ret = GetFrame();
+
+    if (ret < 0) {
+      break;
+    }
+
+    // Skip frames we already have from a partial index
+    if (resume_pts != AV_NOPTS_VALUE && frame_->pts <= resume_pts) {
+      continue;
+    }
+
+    FrameIndex::Entry entry;
+    entry.pts = frame_->pts;
+    entry.pos = frame_->pkt_pos;
+    entry.keyframe = (frame_->key_frame != 0);
+    building_index_.append(entry);
+
+    // Periodically save what we have so an interrupted index doesn't have to start over
+    frames_since_save++;
+
+    if (frames_since_save == kIndexPartialSaveInterval) {
+      SaveFrameIndex(GetPartialIndexFilename());
+      frames_since_save = 0;
+    }
+
+    ReportIndexProgress(frame_->pts, &last_progress);
+  }
 }
 
-void FFmpegDecoder::SaveFrameIndex()
+void FFmpegDecoder::ReportIndexProgress(const int64_t &pts, int *last_progress)
 {
-  // Save index to file
-  QFile index_file(GetIndexFilename());
-  if (index_file.open(QFile::WriteOnly)) {
-    // Write index in binary
-    index_file.write(reinterpret_cast<const char*>(frame_index_.constData()),
-                     frame_index_.size() * static_cast<int>(sizeof(int64_t)));
+  if (avstream_->duration <= 0 || pts == AV_NOPTS_VALUE) {
+    return;
+  }
 
-    index_file.close();
-  } else {
+  int64_t start_time = (avstream_->start_time == AV_NOPTS_VALUE) ? 0 : avstream_->start_time;
+
+  int progress = static_cast<int>(qBound(static_cast<int64_t>(0),
+                                         100 * (pts - start_time) / avstream_->duration,
+                                         static_cast<int64_t>(100)));
+
+  if (progress != *last_progress) {
+    emit AnalysisProgress(progress);
+    *last_progress = progress;
+  }
+}
+
+QString FFmpegDecoder::GetIndexFilename()
+{
+  if (!open_) {
+    qWarning() << tr("GetIndexFilename tried to run while decoder was closed");
+    return QString();
+  }
+
+  return FrameIndex::GetFilename(stream().get());
+}
+
+QString FFmpegDecoder::GetPartialIndexFilename()
+{
+  return GetIndexFilename().append(QStringLiteral(".partial"));
+}
+
+bool FFmpegDecoder::LoadFrameIndex(const QString &filename)
+{
+  frame_index_ = FrameIndex::Load(filename);
+
+  return (frame_index_ != nullptr);
+}
+
+void FFmpegDecoder::SaveFrameIndex(const QString &filename)
+{
+  if (!FrameIndex::Save(filename, building_index_, avstream_->index, avstream_->time_base)) {
     qWarning() << tr("Failed to save index for %1").arg(stream()->footage()->filename());
   }
 }
@@ -546,14 +1078,11 @@ int FFmpegDecoder::GetFrame()
 
   while ((ret = avcodec_receive_frame(codec_ctx_, frame_)) == AVERROR(EAGAIN) && !eof) {
 
-    // Find next packet in the correct stream index
-    do {
-      // Free buffer in packet if there is one
-      av_packet_unref(pkt_);
+    // Free buffer in packet if there is one
+    av_packet_unref(pkt_);
 
-      // Read packet from file
-      ret = av_read_frame(fmt_ctx_, pkt_);
-    } while (pkt_->stream_index != avstream_->index && ret >= 0);
+    // Read next packet of this stream from file
+    ret = demuxer_->ReadPacket(avstream_->index, pkt_);
 
     if (ret == AVERROR_EOF) {
       // Don't break so that receive gets called again, but don't try to read again
@@ -580,6 +1109,215 @@ int FFmpegDecoder::GetFrame()
   return ret;
 }
 
+int FFmpegDecoder::DecodeToTimestamp(const int64_t &target_ts)
+{
+  int ret = 0;
+
+  // Find the keyframe the target frame depends on so we only need to decode a single GOP
+  int keyframe = frame_index_->GetKeyframeBefore(frame_index_->GetClosestEntry(target_ts));
+
+  // If the last decoded frame is earlier in the same GOP as the target (e.g. sequential playback or a short jump
+  // forward), decoding through is always cheaper than seeking and flushing the decoder
+  if (frame_->pts != AV_NOPTS_VALUE
+      && frame_->pts < target_ts
+      && frame_->pts >= frame_index_->pts(keyframe)) {
+    ret = DecodeUntil(target_ts);
+
+    // If that didn't work, fall through to a regular seek (which flushes the decoder)
+    if (ret < 0 || frame_->pts != target_ts) {
+      ret = 0;
+    }
+  }
+
+  while (frame_->pts != target_ts) {
+    if (retrieve_cancelled()) {
+      ret = AVERROR_EXIT;
+      break;
+    }
+
+    ret = Seek(frame_index_->entry(keyframe));
+
+    if (ret < 0) {
+      break;
+    }
+
+    ret = DecodeUntil(target_ts);
+
+    // If the demuxer didn't land where we asked, fall back to the keyframe before this one
+    if (ret < 0 || frame_->pts == target_ts || keyframe == 0) {
+      break;
+    }
+
+    keyframe = frame_index_->GetKeyframeBefore(keyframe - 1);
+  }
+
+  return ret;
+}
+
+FramePtr FFmpegDecoder::RetrieveAudio(const rational &timecode, const rational &length)
+{
+  int sample_rate = codec_ctx_->sample_rate;
+
+  int64_t start = qRound64(timecode.toDouble() * sample_rate);
+  int count = static_cast<int>(qRound64(length.toDouble() * sample_rate));
+
+  if (count <= 0) {
+    return nullptr;
+  }
+
+  olive::SampleFormat sample_fmt = static_cast<olive::SampleFormat>(output_fmt_);
+
+  // Make sure the whole request fits in the buffer with room to spare for the frame that overshoots it
+  if (count * 2 > audio_buffer_.capacity()) {
+    audio_buffer_.Allocate(count * 2, SampleService::BytesPerSample(sample_fmt) * codec_ctx_->channels);
+  }
+
+  int ret = 0;
+
+  if (!audio_buffer_.Contains(start, count)) {
+    // If the request starts before what we have or too far after it, seek. Otherwise decoding forward to it is
+    // cheaper and keeps contiguous playback from ever seeking.
+    if (audio_buffer_.count() == 0
+        || start < audio_buffer_.start()
+        || start > audio_buffer_.end() + kAudioSeekThreshold * sample_rate) {
+      ret = SeekAudio(start);
+    }
+
+    while (ret >= 0 && !audio_eof_ && audio_buffer_.end() < start + count) {
+      ret = GetFrame();
+
+      if (ret == AVERROR_EOF) {
+        // Nothing more to decode, the rest of the request will be silence
+        audio_eof_ = true;
+        ret = 0;
+      } else if (ret >= 0) {
+        ret = BufferAudioFrame();
+      }
+    }
+  }
+
+  if (ret < 0) {
+    FFmpegError(ret);
+    return nullptr;
+  }
+
+  FramePtr frame_container = Frame::Create();
+  frame_container->set_sample_count(count);
+  frame_container->set_channel_count(codec_ctx_->channels);
+  frame_container->set_sample_rate(sample_rate);
+  frame_container->set_format(output_fmt_);
+  frame_container->set_timestamp(rational(start, sample_rate));
+  frame_container->set_native_timestamp(start);
+  frame_container->allocate();
+
+  // Anything the buffer doesn't have (before the stream starts or after it ends) is silence
+  memset(frame_container->data(),
+         SampleService::SilenceByte(sample_fmt),
+         static_cast<size_t>(frame_container->linesize()));
+
+  audio_buffer_.Read(start, count, frame_container->data());
+
+  return frame_container;
+}
+
+int FFmpegDecoder::SeekAudio(const int64_t &sample)
+{
+  avcodec_flush_buffers(codec_ctx_);
+
+  int64_t ts = av_rescale_q(sample, {1, codec_ctx_->sample_rate}, avstream_->time_base);
+
+  int ret = demuxer_->Seek(avstream_->index, ts, AVSEEK_FLAG_BACKWARD);
+
+  if (ret < 0) {
+    return ret;
+  }
+
+  // Drop any samples the resampler was still holding from before the seek
+  ret = swr_init(resample_ctx_);
+
+  if (ret < 0) {
+    return ret;
+  }
+
+  // The buffer's position gets set by the first frame we decode
+  audio_buffer_.Reset(0);
+  audio_eof_ = false;
+
+  return 0;
+}
+
+int FFmpegDecoder::BufferAudioFrame()
+{
+  int out_count = swr_get_out_samples(resample_ctx_, frame_->nb_samples);
+
+  if (out_count <= 0) {
+    return 0;
+  }
+
+  int out_size = av_samples_get_buffer_size(nullptr, codec_ctx_->channels, out_count, ideal_sample_fmt_, 1);
+
+  if (out_size < 0) {
+    return out_size;
+  }
+
+  if (audio_convert_buffer_.size() < out_size) {
+    audio_convert_buffer_.resize(out_size);
+  }
+
+  uint8_t* out_data = reinterpret_cast<uint8_t*>(audio_convert_buffer_.data());
+
+  int converted = swr_convert(resample_ctx_,
+                              &out_data,
+                              out_count,
+                              const_cast<const uint8_t**>(frame_->extended_data),
+                              frame_->nb_samples);
+
+  if (converted < 0) {
+    return converted;
+  }
+
+  // The first frame after a seek tells us where in the stream we are, after that the audio is contiguous
+  if (audio_buffer_.count() == 0) {
+    int64_t frame_start = (frame_->pts == AV_NOPTS_VALUE)
+        ? 0
+        : av_rescale_q(frame_->pts, avstream_->time_base, {1, codec_ctx_->sample_rate});
+
+    audio_buffer_.Reset(frame_start);
+  }
+
+  audio_buffer_.Write(out_data, converted);
+
+  return 0;
+}
+
+AVSampleFormat FFmpegDecoder::GetCompatibleSampleFormat(const AVSampleFormat &sample_fmt)
+{
+  AVSampleFormat packed_fmt = av_get_packed_sample_fmt(sample_fmt);
+
+  switch (packed_fmt) {
+  case AV_SAMPLE_FMT_U8:
+  case AV_SAMPLE_FMT_S16:
+  case AV_SAMPLE_FMT_S32:
+  case AV_SAMPLE_FMT_FLT:
+  case AV_SAMPLE_FMT_DBL:
+    return packed_fmt;
+  default:
+    return AV_SAMPLE_FMT_FLT;
+  }
+}
+
+int FFmpegDecoder::GetLowresForDivider(const AVCodec *codec)
+{
+  int lowres = 0;
+
+  // Each lowres level halves the resolution, so use the largest one that doesn't go below 1/divider
+  while (lowres < codec->max_lowres && (1 << (lowres + 1)) <= divider()) {
+    lowres++;
+  }
+
+  return lowres;
+}
+
 AVPixelFormat FFmpegDecoder::GetCompatiblePixelFormat(const AVPixelFormat &pix_fmt)
 {
   AVPixelFormat possible_pix_fmts[] = {
@@ -594,29 +1332,330 @@ AVPixelFormat FFmpegDecoder::GetCompatiblePixelFormat(const AVPixelFormat &pix_f
                                            nullptr);
 }
 
+bool FFmpegDecoder::SetupHardwareDecoding(AVCodec *codec)
+{
+  for (int i=0;;i++) {
+    const AVCodecHWConfig* config = avcodec_get_hw_config(codec, i);
+
+    // No more configurations available, this codec can't be decoded in hardware on this system
+    if (config == nullptr) {
+      return false;
+    }
+
+    if (!(config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX)) {
+      continue;
+    }
+
+    // Try to create a device for this configuration
+    if (av_hwdevice_ctx_create(&hw_device_ctx_, config->device_type, nullptr, nullptr, 0) < 0) {
+      hw_device_ctx_ = nullptr;
+      continue;
+    }
+
+    hw_pix_fmt_ = config->pix_fmt;
+
+    codec_ctx_->hw_device_ctx = av_buffer_ref(hw_device_ctx_);
+    codec_ctx_->opaque = this;
+    codec_ctx_->get_format = GetHardwarePixelFormat;
+
+    return true;
+  }
+}
+
+bool FFmpegDecoder::GetYUVInfo(const AVFrame *frame, olive::YUVInfo *info)
+{
+  bool jpeg_range = false;
+
+  switch (static_cast<AVPixelFormat>(frame->format)) {
+  case AV_PIX_FMT_YUVJ420P:
+    jpeg_range = true;
+    /* fall through */
+  case AV_PIX_FMT_YUV420P:
+  case AV_PIX_FMT_YUV420P10LE:
+    info->layout = olive::YUV_LAYOUT_PLANAR;
+    info->chroma_shift_w = 1;
+    info->chroma_shift_h = 1;
+    break;
+  case AV_PIX_FMT_YUVJ422P:
+    jpeg_range = true;
+    /* fall through */
+  case AV_PIX_FMT_YUV422P:
+  case AV_PIX_FMT_YUV422P10LE:
+    info->layout = olive::YUV_LAYOUT_PLANAR;
+    info->chroma_shift_w = 1;
+    info->chroma_shift_h = 0;
+    break;
+  case AV_PIX_FMT_YUVJ444P:
+    jpeg_range = true;
+    /* fall through */
+  case AV_PIX_FMT_YUV444P:
+  case AV_PIX_FMT_YUV444P10LE:
+    info->layout = olive::YUV_LAYOUT_PLANAR;
+    info->chroma_shift_w = 0;
+    info->chroma_shift_h = 0;
+    break;
+  case AV_PIX_FMT_NV12:
+  case AV_PIX_FMT_P010LE:
+    info->layout = olive::YUV_LAYOUT_SEMIPLANAR;
+    info->chroma_shift_w = 1;
+    info->chroma_shift_h = 1;
+    break;
+  default:
+    return false;
+  }
+
+  switch (static_cast<AVPixelFormat>(frame->format)) {
+  case AV_PIX_FMT_YUV420P10LE:
+  case AV_PIX_FMT_YUV422P10LE:
+  case AV_PIX_FMT_YUV444P10LE:
+    info->bit_depth = 10;
+    info->msb_aligned = false;
+    break;
+  case AV_PIX_FMT_P010LE:
+    info->bit_depth = 10;
+    info->msb_aligned = true;
+    break;
+  default:
+    info->bit_depth = 8;
+    info->msb_aligned = false;
+  }
+
+  switch (frame->colorspace) {
+  case AVCOL_SPC_BT709:
+    info->colorspace = olive::YUV_COLORSPACE_BT709;
+    break;
+  case AVCOL_SPC_BT470BG:
+  case AVCOL_SPC_SMPTE170M:
+    info->colorspace = olive::YUV_COLORSPACE_BT601;
+    break;
+  case AVCOL_SPC_BT2020_NCL:
+  case AVCOL_SPC_BT2020_CL:
+    info->colorspace = olive::YUV_COLORSPACE_BT2020;
+    break;
+  default:
+    // Unspecified, guess based on the resolution like most players do
+    info->colorspace = (frame->height >= 720) ? olive::YUV_COLORSPACE_BT709 : olive::YUV_COLORSPACE_BT601;
+  }
+
+  info->full_range = (jpeg_range || frame->color_range == AVCOL_RANGE_JPEG);
+
+  return true;
+}
+
+AVPixelFormat FFmpegDecoder::GetHardwarePixelFormat(AVCodecContext *ctx, const AVPixelFormat *pix_fmts)
+{
+  FFmpegDecoder* decoder = static_cast<FFmpegDecoder*>(ctx->opaque);
+
+  for (const AVPixelFormat* p = pix_fmts; *p != AV_PIX_FMT_NONE; p++) {
+    if (*p == decoder->hw_pix_fmt_) {
+      return *p;
+    }
+  }
+
+  // The device can't handle this stream, fall back to a software format
+  qWarning() << "Hardware decoding unavailable for this stream, falling back to software";
+
+  decoder->hw_pix_fmt_ = AV_PIX_FMT_NONE;
+
+  return avcodec_default_get_format(ctx, pix_fmts);
+}
+
 int64_t FFmpegDecoder::GetClosestTimestampInIndex(const int64_t &ts)
 {
-  // Index now if we haven't already
-  if (frame_index_.isEmpty() && !LoadFrameIndex()) {
-    Index();
+  // Indexing happens in the background (see IndexTask), so if we don't have an index yet, periodically check whether
+  // it's finished
+  if (frame_index_ == nullptr
+      && (!index_check_timer_.isValid() || index_check_timer_.elapsed() >= kIndexRecheckInterval)) {
+    index_check_timer_.start();
+
+    LoadFrameIndex(GetIndexFilename());
   }
 
-  if (frame_index_.isEmpty()) {
-    return -1;
+  // No index available, estimate the timestamp instead
+  if (frame_index_ == nullptr || frame_index_->count() == 0) {
+    return GetEstimatedTimestamp(ts);
   }
 
   if (ts <= 0) {
     return 0;
   }
 
-  // Use index to find closest frame in file
-  for (int i=1;i<frame_index_.size();i++) {
-    if (frame_index_.at(i) == ts) {
-      return ts;
-    } else if (frame_index_.at(i) > ts) {
-      return frame_index_.at(i - 1);
+  return frame_index_->pts(frame_index_->GetClosestEntry(ts));
+}
+
+int64_t FFmpegDecoder::GetEstimatedTimestamp(const int64_t &ts)
+{
+  // Assume a constant frame rate from the stream's start time
+  int64_t frame_duration = GetEstimatedFrameDuration();
+  int64_t start_time = (avstream_->start_time == AV_NOPTS_VALUE) ? 0 : avstream_->start_time;
+
+  int64_t frame_number = qMax((ts - start_time) / frame_duration, static_cast<int64_t>(0));
+
+  return start_time + frame_number * frame_duration;
+}
+
+int64_t FFmpegDecoder::GetEstimatedFrameDuration()
+{
+  AVRational frame_rate = av_guess_frame_rate(fmt_ctx_, avstream_, nullptr);
+
+  if (frame_rate.num <= 0 || frame_rate.den <= 0) {
+    return 1;
+  }
+
+  return qMax(av_rescale_q(1, av_inv_q(frame_rate), avstream_->time_base), static_cast<int64_t>(1));
+}
+
+int FFmpegDecoder::RetrieveEstimated(const int64_t &target_ts)
+{
+  int64_t frame_duration = GetEstimatedFrameDuration();
+
+  // The current frame may already be the one showing at this time
+  if (frame_->pts != AV_NOPTS_VALUE && frame_->pts >= target_ts && frame_->pts < target_ts + frame_duration) {
+    return 0;
+  }
+
+  // Decode forward if we're less than a second behind the target, otherwise seek
+  int64_t second_ts = qRound64(rational(avstream_->time_base).flipped().toDouble());
+
+  if (frame_->pts == AV_NOPTS_VALUE || frame_->pts > target_ts || target_ts - frame_->pts > second_ts) {
+    FrameIndex::Entry entry;
+    entry.pts = target_ts;
+    entry.pos = -1;
+    entry.keyframe = true;
+
+    int ret = Seek(entry);
+
+    if (ret < 0) {
+      return ret;
+    }
+  }
+
+  return DecodeUntil(target_ts);
+}
+
+int FFmpegDecoder::Seek(const FrameIndex::Entry &entry)
+{
+  seeked_ = true;
+
+  // Clear any frames still in the decoder
+  avcodec_flush_buffers(codec_ctx_);
+
+  int ret = demuxer_->Seek(avstream_->index, entry.pts, AVSEEK_FLAG_BACKWARD);
+
+  // Fall back to seeking by byte position if the container couldn't seek by timestamp
+  if (ret < 0 && entry.pos >= 0 && !(fmt_ctx_->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+    ret = demuxer_->Seek(avstream_->index, entry.pos, AVSEEK_FLAG_BYTE);
+  }
+
+  return ret;
+}
+
+int FFmpegDecoder::BufferReverseFrames(const int64_t &target_ts)
+{
+  ClearReverseFrames();
+
+  int ret = Seek(frame_index_->entry(frame_index_->GetKeyframeBefore(frame_index_->GetClosestEntry(target_ts))));
+
+  if (ret < 0) {
+    return ret;
+  }
+
+  do {
+    ret = GetFrame();
+
+    if (ret < 0 || frame_->pts == AV_NOPTS_VALUE) {
+      break;
+    }
+
+    AVFrame* copy;
+
+    if (hw_pix_fmt_ != AV_PIX_FMT_NONE && frame_->format == hw_pix_fmt_) {
+      // Hardware decoders only have a few surfaces to decode into, so don't hold onto them
+      copy = av_frame_alloc();
+
+      if (copy != nullptr
+          && (av_hwframe_transfer_data(copy, frame_, 0) < 0 || av_frame_copy_props(copy, frame_) < 0)) {
+        av_frame_free(&copy);
+      }
+    } else {
+      copy = av_frame_clone(frame_);
+    }
+
+    if (copy == nullptr) {
+      ret = AVERROR(ENOMEM);
+      break;
+    }
+
+    reverse_frames_.insert(copy->pts, copy);
+
+    // For long GOPs, only keep the frames closest to the target since those are the ones needed next
+    if (reverse_frames_.size() > kReverseBufferSize) {
+      AVFrame* earliest = reverse_frames_.take(reverse_frames_.firstKey());
+      av_frame_free(&earliest);
+    }
+  } while (frame_->pts < target_ts);
+
+  return ret;
+}
+
+void FFmpegDecoder::ClearReverseFrames()
+{
+  foreach (AVFrame* f, reverse_frames_) {
+    av_frame_free(&f);
+  }
+
+  reverse_frames_.clear();
+}
+
+int FFmpegDecoder::DecodeUntil(const int64_t &target_ts)
+{
+  int ret;
+
+  do {
+    // Long GOPs can take a while to decode through, stop if the frame is no longer wanted
+    if (retrieve_cancelled()) {
+      return AVERROR_EXIT;
+    }
+
+    ret = GetFrame();
+  } while (ret >= 0 && frame_->pts != AV_NOPTS_VALUE && frame_->pts < target_ts);
+
+  return ret;
+}
+
+QSet<QString> FFmpegDecoder::GetDemuxerExtensions()
+{
+  QSet<QString> extensions;
+
+  const AVInputFormat* fmt = nullptr;
+
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+  while ((fmt = av_iformat_next(fmt)) != nullptr) {
+#else
+  void* opaque = nullptr;
+  while ((fmt = av_demuxer_iterate(&opaque)) != nullptr) {
+#endif
+    QStringList names = QString(fmt->name).split(',');
+
+    if (fmt->extensions != nullptr) {
+      names.append(QString(fmt->extensions).split(','));
+    }
+
+    foreach (const QString& name, names) {
+      extensions.insert(name.trimmed().toLower());
+    }
+  }
+
+  // The image2 demuxer claims every image format, we'd rather leave those to more specific decoders
+  const AVInputFormat* image2 = av_find_input_format("image2");
+
+  if (image2 != nullptr && image2->extensions != nullptr) {
+    QStringList image_extensions = QString(image2->extensions).split(',');
+
+    foreach (const QString& ext, image_extensions) {
+      extensions.remove(ext.trimmed().toLower());
     }
   }
 
-  return frame_index_.last();
+  return extensions;
 }
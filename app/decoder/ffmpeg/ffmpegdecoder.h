@@ -27,9 +27,16 @@ extern "C" {
 #include <libswresample/swresample.h>
 }
 
+#include <QElapsedTimer>
+#include <QMap>
+#include <QSet>
 #include <QVector>
 
+#include "decoder/audioringbuffer.h"
 #include "decoder/decoder.h"
+#include "decoder/ffmpeg/ffmpegdemuxer.h"
+#include "decoder/frameindex.h"
+#include "render/sampleformat.h"
 
 /**
  * @brief A Decoder derivative that wraps FFmpeg functions as on Olive decoder
@@ -45,15 +52,36 @@ public:
 
   virtual bool Probe(Footage *f) override;
 
+  virtual bool SupportsExtension(const QString& extension) override;
+
   virtual bool Open() override;
   virtual FramePtr Retrieve(const rational &timecode, const rational &length = 0) override;
   virtual void Close() override;
 
+  /**
+   * @brief Seeks and decodes up to `time` so a following Retrieve() of it only has to convert the frame
+   *
+   * Only indexed video streams are prerolled, anything else would seek again on Retrieve() anyway.
+   */
+  virtual void Preroll(const rational& time) override;
+
   virtual QString id() override;
 
   virtual int64_t GetTimestampFromTime(const rational& time) override;
 
+  virtual rational GetFrameDuration() override;
+
+  virtual rational GetNextKeyframe(const rational& time) override;
+
+  /**
+   * @brief Builds the frame index for this stream if one doesn't already exist
+   */
+  virtual bool Analyze() override;
+
 private:
+  // Measures GetClosestTimestampInIndex() in the olive-benchmarks target
+  friend class FFmpegDecoderBenchmark;
+
   /**
    * @brief Handle an error
    *
@@ -82,19 +110,76 @@ private:
    */
   int GetFrame();
 
+  /**
+   * @brief Decode forward from the current position until a frame at or after `target_ts` is reached
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
+   */
+  int DecodeUntil(const int64_t& target_ts);
+
+  /**
+   * @brief Get frame_ to the frame at `target_ts` using the index, seeking only if decoding forward won't reach it
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
+   */
+  int DecodeToTimestamp(const int64_t& target_ts);
+
   /**
    * @brief Create an index for this media
    *
-   * Indexes are used to improve speed and reliability of imported media. Calling Retrieve() will automatically check
-   * for an index and create one if it doesn't exist.
+   * Indexes are used to improve speed and reliability of imported media. Until an index exists, Retrieve() estimates
+   * timestamps from the stream's frame rate.
+   *
+   * Indexing is slow so it's run in a background thread through Analyze() (see IndexTask). Index() must be called
+   * while the Decoder is open, and does not automatically call Open() and Close() the Decoder. The caller must call
+   * these manually.
    *
-   * Indexing is slow so it's recommended to do it in a background thread. Index() must be called while the Decoder is
-   * open, and does not automatically call Open() and Close() the Decoder. The caller must call thse manually.
+   * Constant frame rate intra streams are recognized from a few packets at each end (see IndexUniform()) and don't
+   * need the rest of the file read at all. Otherwise the index is built from packets where possible (see
+   * IndexPackets()), which only needs to demux the file. When decoding is necessary, progress is saved to a partial index periodically so that if indexing is cancelled, it can
+   * resume where it left off next time.
    *
    * FIXME: This should perhaps become a common function for the base Decoder class
    */
   void Index();
 
+  /**
+   * @brief Write a uniform index (see FrameIndex) to the partial index file if the stream is intra-only with evenly
+   * spaced timestamps
+   *
+   * Only the first kIndexUniformProbePackets packets and the last few are read: if they're all keyframes on the same
+   * grid and the last one is where the container's frame count says it should be, the rest are assumed to be too.
+   *
+   * @return
+   *
+   * TRUE if a uniform index was written, FALSE if the stream has to be indexed the normal way.
+   */
+  bool IndexUniform();
+
+  /**
+   * @brief Fill building_index_ by reading packets only (no decoding)
+   *
+   * @return
+   *
+   * TRUE if the stream could be indexed from packets. FALSE if it couldn't (e.g. packets without presentation
+   * timestamps) in which case IndexFrames() should be used instead.
+   */
+  bool IndexPackets();
+
+  /**
+   * @brief Fill building_index_ by decoding every frame, resuming from a partial index if there is one
+   */
+  void IndexFrames();
+
+  /**
+   * @brief Emit AnalysisProgress() if indexing has reached a new percentage
+   */
+  void ReportIndexProgress(const int64_t& pts, int* last_progress);
+
   /**
    * @brief Returns the filename for the index
    *
@@ -104,6 +189,11 @@ private:
    */
   QString GetIndexFilename();
 
+  /**
+   * @brief Returns the filename for an index that is still being built
+   */
+  QString GetPartialIndexFilename();
+
   /**
    * @brief Used internally to load a frame index into frame_index_ (video only)
    *
@@ -112,15 +202,87 @@ private:
    * TRUE if a frame index was successfully loaded. FALSE usually means the file didn't exist and Index() should be
    * run to create it.
    */
-  bool LoadFrameIndex();
+  bool LoadFrameIndex(const QString& filename);
+
+  /**
+   * @brief Used in Index() to save building_index_ to a file that can be loaded later
+   */
+  void SaveFrameIndex(const QString& filename);
+
+  /**
+   * @brief Estimate the timestamp showing at `ts` from the stream's frame rate, used while there's no index
+   */
+  int64_t GetEstimatedTimestamp(const int64_t& ts);
+
+  /**
+   * @brief Estimate the duration of one frame in the stream's timebase
+   */
+  int64_t GetEstimatedFrameDuration();
 
   /**
-   * @brief Used in Index() to save the just created frame index to a file that can be loaded later
+   * @brief Decode the frame at an estimated timestamp, used while there's no index
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
    */
-  void SaveFrameIndex();
+  int RetrieveEstimated(const int64_t& target_ts);
 
+  /**
+   * @brief Returns the timestamp of the frame that is showing at timestamp `ts`
+   *
+   * Uses a binary search through frame_index_ so lookups are O(log n) regardless of media length. If there's no index
+   * yet, the timestamp is estimated.
+   */
   int64_t GetClosestTimestampInIndex(const int64_t& ts);
 
+  /**
+   * @brief Retrieve packed audio for [timecode, timecode + length) (audio streams only)
+   *
+   * Decoded audio is kept in audio_buffer_ so requests that overlap or follow on from previous ones decode forward
+   * instead of seeking.
+   */
+  FramePtr RetrieveAudio(const rational& timecode, const rational& length);
+
+  /**
+   * @brief Seek the audio stream so that decoding continues from just before a sample position
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
+   */
+  int SeekAudio(const int64_t& sample);
+
+  /**
+   * @brief Resample the audio in frame_ to the output format and append it to audio_buffer_
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
+   */
+  int BufferAudioFrame();
+
+  /**
+   * @brief Returns the packed sample format that audio will be converted to for a given native format
+   *
+   * Olive's formats are all packed, so planar audio is interleaved. Formats Olive doesn't support are converted to
+   * float.
+   */
+  static AVSampleFormat GetCompatibleSampleFormat(const AVSampleFormat& sample_fmt);
+
+  /**
+   * @brief Collect the file extensions of every demuxer FFmpeg was built with (except image formats)
+   */
+  static QSet<QString> GetDemuxerExtensions();
+
+  /**
+   * @brief Returns the `lowres` level to open the codec with for the current divider
+   *
+   * Some codecs (e.g. JPEG, JPEG 2000, MPEG-4 part 2) can decode directly at 1/2, 1/4, or 1/8 resolution, which is
+   * much faster than decoding at full size and scaling down afterwards.
+   */
+  int GetLowresForDivider(const AVCodec* codec);
+
   /**
    * @brief Returns an AVPixelFormat that can be
    * @param pix_fmt
@@ -128,6 +290,32 @@ private:
    */
   AVPixelFormat GetCompatiblePixelFormat(const AVPixelFormat& pix_fmt);
 
+  /**
+   * @brief Try to set up a hardware device for decoding with this codec
+   *
+   * Must be called after codec_ctx_ is allocated and before it's opened.
+   *
+   * @return
+   *
+   * TRUE if a hardware device was set up. FALSE means decoding will happen in software.
+   */
+  bool SetupHardwareDecoding(AVCodec* codec);
+
+  /**
+   * @brief AVCodecContext::get_format callback that selects the hardware pixel format if the device supports it
+   */
+  /**
+   * @brief Determine whether a frame's pixel format can be passed to the renderer as native YUV
+   *
+   * @return
+   *
+   * TRUE and fills `info` if the frame is in a supported YUV format, FALSE if it must be converted to RGBA.
+   */
+  static bool GetYUVInfo(const AVFrame* frame, olive::YUVInfo* info);
+
+  static AVPixelFormat GetHardwarePixelFormat(AVCodecContext* ctx, const AVPixelFormat* pix_fmts);
+
+  FFmpegDemuxerPtr demuxer_;
   AVFormatContext* fmt_ctx_;
   AVCodecContext* codec_ctx_;
   AVStream* avstream_;
@@ -138,8 +326,79 @@ private:
   SwsContext* scale_ctx_;
   SwrContext* resample_ctx_;
   int output_fmt_;
+  AVPixelFormat ideal_pix_fmt_;
+  AVSampleFormat ideal_sample_fmt_;
+
+  /**
+   * @brief The `lowres` level the codec was opened with
+   */
+  int lowres_;
+
+  AVBufferRef* hw_device_ctx_;
+  AVPixelFormat hw_pix_fmt_;
+  AVFrame* sw_frame_;
+
+  /**
+   * @brief Seek the demuxer to a keyframe in the index and flush the decoder
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
+   */
+  int Seek(const FrameIndex::Entry& entry);
+
+  /**
+   * @brief Decode the GOP containing a timestamp up to that timestamp, keeping each frame in reverse_frames_
+   *
+   * Used for reverse playback so that each GOP only has to be decoded once rather than once for every frame in it.
+   *
+   * @return
+   *
+   * An FFmpeg error code, or >= 0 on success
+   */
+  int BufferReverseFrames(const int64_t& target_ts);
+
+  /**
+   * @brief Free every frame in reverse_frames_
+   */
+  void ClearReverseFrames();
+
+  /**
+   * @brief Frames decoded for reverse playback by their pts (at most kReverseBufferSize)
+   */
+  QMap<int64_t, AVFrame*> reverse_frames_;
+
+  /**
+   * @brief Index of every frame in the stream, or nullptr if it hasn't been built yet
+   */
+  FrameIndexPtr frame_index_;
+
+  /**
+   * @brief Index entries collected while Index() is running
+   */
+  QVector<FrameIndex::Entry> building_index_;
+
+  QElapsedTimer index_check_timer_;
 
-  QVector<int64_t> frame_index_;
+  /**
+   * @brief Most recently decoded audio in the output format
+   */
+  AudioRingBuffer audio_buffer_;
+
+  /**
+   * @brief Temporary buffer that swr_convert() writes into before it's copied to audio_buffer_
+   */
+  QByteArray audio_convert_buffer_;
+
+  /**
+   * @brief Set when the audio stream has been decoded to the end since the last seek
+   */
+  bool audio_eof_;
+
+  /**
+   * @brief Set by Seek() so Retrieve() can tell whether it had to seek to the frame it returns
+   */
+  bool seeked_;
 
 };
 
@@ -0,0 +1,343 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ffmpegdemuxer.h"
+
+#include <QDebug>
+#include <QList>
+
+#include "decoder/probecache.h"
+#include "ffmpegio.h"
+
+namespace {
+
+/**
+ * @brief All demuxers currently open in this process, by filename
+ */
+QMap<QString, QList<std::weak_ptr<FFmpegDemuxer> > > open_demuxers;
+QMutex open_demuxers_lock;
+
+}
+
+const int FFmpegDemuxer::kQueueLimit = 1024;
+
+FFmpegDemuxer::StreamState::StreamState() :
+  discontinuous(false),
+  skipping(false),
+  has_last(false),
+  last_dts(AV_NOPTS_VALUE),
+  last_pos(-1),
+  seek_timestamp(0),
+  seek_flags(AVSEEK_FLAG_BACKWARD)
+{
+}
+
+FFmpegDemuxer::FFmpegDemuxer() :
+  fmt_ctx_(nullptr),
+  moved_(false)
+{
+}
+
+FFmpegDemuxer::~FFmpegDemuxer()
+{
+  for (QMap<int, StreamState>::iterator i=streams_.begin();i!=streams_.end();i++) {
+    ClearQueue(i.value());
+  }
+
+  if (fmt_ctx_ != nullptr) {
+    FFmpegIO::CloseInput(&fmt_ctx_);
+  }
+}
+
+FFmpegDemuxerPtr FFmpegDemuxer::Acquire(const QString &filename, int stream_index)
+{
+  {
+    QMutexLocker locker(&open_demuxers_lock);
+
+    QList<std::weak_ptr<FFmpegDemuxer> >& demuxers = open_demuxers[filename];
+
+    // See if a demuxer for this file is free to read this stream
+    for (int i=0;i<demuxers.size();i++) {
+      FFmpegDemuxerPtr demuxer = demuxers.at(i).lock();
+
+      if (demuxer == nullptr) {
+        demuxers.removeAt(i);
+        i--;
+        continue;
+      }
+
+      QMutexLocker demuxer_locker(&demuxer->lock_);
+
+      if (!demuxer->streams_.contains(stream_index)) {
+        StreamState state;
+
+        // Other streams have moved the file's position, so this one has to seek to the start before its first read
+        state.discontinuous = demuxer->moved_;
+
+        demuxer->streams_.insert(stream_index, state);
+
+        return demuxer;
+      }
+    }
+  }
+
+  // Opening may take a while so we don't hold the lock while doing it
+  FFmpegDemuxerPtr demuxer(new FFmpegDemuxer());
+
+  if (!demuxer->Open(filename)) {
+    return nullptr;
+  }
+
+  if (stream_index < 0 || stream_index >= static_cast<int>(demuxer->fmt_ctx_->nb_streams)) {
+    qWarning() << "Tried to read stream" << stream_index << "which doesn't exist in" << filename;
+    return nullptr;
+  }
+
+  demuxer->streams_.insert(stream_index, StreamState());
+
+  QMutexLocker locker(&open_demuxers_lock);
+
+  open_demuxers[filename].append(demuxer);
+
+  return demuxer;
+}
+
+void FFmpegDemuxer::Release(int stream_index)
+{
+  QMutexLocker locker(&lock_);
+
+  QMap<int, StreamState>::iterator i = streams_.find(stream_index);
+
+  if (i != streams_.end()) {
+    ClearQueue(i.value());
+    streams_.erase(i);
+  }
+}
+
+AVFormatContext *FFmpegDemuxer::format_context()
+{
+  return fmt_ctx_;
+}
+
+int FFmpegDemuxer::ReadPacket(int stream_index, AVPacket *pkt)
+{
+  QMutexLocker locker(&lock_);
+
+  QMap<int, StreamState>::iterator it = streams_.find(stream_index);
+
+  if (it == streams_.end()) {
+    return AVERROR(EINVAL);
+  }
+
+  StreamState& state = it.value();
+
+  if (!state.queue.isEmpty()) {
+    // Another stream already read this packet for us
+    AVPacket* queued = state.queue.dequeue();
+    av_packet_move_ref(pkt, queued);
+    av_packet_free(&queued);
+  } else {
+    if (state.discontinuous) {
+      int ret = Resume(stream_index);
+
+      if (ret < 0) {
+        return ret;
+      }
+    }
+
+    while (true) {
+      int ret = av_read_frame(fmt_ctx_, pkt);
+
+      if (ret < 0) {
+        return ret;
+      }
+
+      moved_ = true;
+
+      if (pkt->stream_index == stream_index) {
+        if (state.skipping && !IsPastLastPacket(state, pkt)) {
+          // We received this packet before another stream seeked
+          av_packet_unref(pkt);
+          continue;
+        }
+
+        state.skipping = false;
+        break;
+      }
+
+      // Queue this packet if another reader wants it
+      QMap<int, StreamState>::iterator other = streams_.find(pkt->stream_index);
+
+      if (other != streams_.end() && !other.value().discontinuous) {
+        if (other.value().queue.size() < kQueueLimit) {
+          AVPacket* queued = av_packet_alloc();
+          av_packet_move_ref(queued, pkt);
+          other.value().queue.enqueue(queued);
+          continue;
+        }
+
+        // That reader isn't keeping up, it'll resume from the end of its queue instead
+        other.value().discontinuous = true;
+      }
+
+      av_packet_unref(pkt);
+    }
+  }
+
+  state.has_last = true;
+  state.last_dts = pkt->dts;
+  state.last_pos = pkt->pos;
+
+  return 0;
+}
+
+int FFmpegDemuxer::Seek(int stream_index, int64_t timestamp, int flags)
+{
+  QMutexLocker locker(&lock_);
+
+  QMap<int, StreamState>::iterator it = streams_.find(stream_index);
+
+  if (it == streams_.end()) {
+    return AVERROR(EINVAL);
+  }
+
+  StreamState& state = it.value();
+
+  ClearQueue(state);
+  state.discontinuous = false;
+  state.skipping = false;
+  state.has_last = false;
+  state.seek_timestamp = timestamp;
+  state.seek_flags = flags;
+
+  int ret = av_seek_frame(fmt_ctx_, stream_index, timestamp, flags);
+
+  moved_ = true;
+
+  MarkOthersDiscontinuous(stream_index);
+
+  return ret;
+}
+
+bool FFmpegDemuxer::Open(const QString &filename)
+{
+  int error_code = FFmpegIO::OpenInput(&fmt_ctx_, filename);
+
+  // Files we've probed before are known to be readable, so if their header says enough there's no need to read on
+  if (error_code == 0 && !(ProbeCache::Contains(filename) && HasStreamParameters(fmt_ctx_))) {
+    error_code = avformat_find_stream_info(fmt_ctx_, nullptr);
+  }
+
+  if (error_code < 0) {
+    char err[1024];
+    av_strerror(error_code, err, 1024);
+
+    qWarning() << "Failed to open" << filename << "-" << error_code << err;
+
+    FFmpegIO::CloseInput(&fmt_ctx_);
+
+    return false;
+  }
+
+#ifndef NDEBUG
+  av_dump_format(fmt_ctx_, 0, filename.toUtf8().constData(), 0);
+#endif
+
+  return true;
+}
+
+bool FFmpegDemuxer::HasStreamParameters(AVFormatContext *ctx)
+{
+  for (unsigned int i=0;i<ctx->nb_streams;i++) {
+    const AVCodecParameters* par = ctx->streams[i]->codecpar;
+
+    switch (par->codec_type) {
+    case AVMEDIA_TYPE_VIDEO:
+      if (par->codec_id == AV_CODEC_ID_NONE || par->width <= 0 || par->height <= 0 || par->format < 0) {
+        return false;
+      }
+      break;
+    case AVMEDIA_TYPE_AUDIO:
+      if (par->codec_id == AV_CODEC_ID_NONE || par->sample_rate <= 0 || par->channels <= 0 || par->format < 0) {
+        return false;
+      }
+      break;
+    default:
+      // We don't decode anything else
+      break;
+    }
+  }
+
+  return true;
+}
+
+int FFmpegDemuxer::Resume(int stream_index)
+{
+  StreamState& state = streams_[stream_index];
+
+  int ret;
+
+  if (state.has_last && state.last_dts != AV_NOPTS_VALUE) {
+    ret = av_seek_frame(fmt_ctx_, stream_index, state.last_dts, AVSEEK_FLAG_BACKWARD);
+  } else if (state.has_last && state.last_pos >= 0 && !(fmt_ctx_->iformat->flags & AVFMT_NO_BYTE_SEEK)) {
+    ret = av_seek_frame(fmt_ctx_, stream_index, state.last_pos, AVSEEK_FLAG_BYTE);
+  } else {
+    // Nothing has been received since the last seek, so just repeat it
+    ret = av_seek_frame(fmt_ctx_, stream_index, state.seek_timestamp, state.seek_flags);
+  }
+
+  state.discontinuous = false;
+  state.skipping = state.has_last;
+
+  MarkOthersDiscontinuous(stream_index);
+
+  return ret;
+}
+
+bool FFmpegDemuxer::IsPastLastPacket(const FFmpegDemuxer::StreamState &state, const AVPacket *pkt)
+{
+  if (state.last_dts != AV_NOPTS_VALUE && pkt->dts != AV_NOPTS_VALUE) {
+    return pkt->dts > state.last_dts;
+  }
+
+  if (state.last_pos >= 0 && pkt->pos >= 0) {
+    return pkt->pos > state.last_pos;
+  }
+
+  // No way of telling, carry on from here rather than dropping everything
+  return true;
+}
+
+void FFmpegDemuxer::MarkOthersDiscontinuous(int stream_index)
+{
+  for (QMap<int, StreamState>::iterator i=streams_.begin();i!=streams_.end();i++) {
+    if (i.key() != stream_index) {
+      i.value().discontinuous = true;
+    }
+  }
+}
+
+void FFmpegDemuxer::ClearQueue(FFmpegDemuxer::StreamState &state)
+{
+  while (!state.queue.isEmpty()) {
+    AVPacket* pkt = state.queue.dequeue();
+    av_packet_free(&pkt);
+  }
+}
@@ -0,0 +1,166 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FFMPEGDEMUXER_H
+#define FFMPEGDEMUXER_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <memory>
+#include <QMap>
+#include <QMutex>
+#include <QQueue>
+#include <QString>
+
+class FFmpegDemuxer;
+using FFmpegDemuxerPtr = std::shared_ptr<FFmpegDemuxer>;
+
+/**
+ * @brief A format context shared by the FFmpegDecoders reading different streams of the same file
+ *
+ * Without sharing, every decoder opens the file separately and reads (and throws away) every other stream's packets,
+ * so decoding a video stream and eight audio streams means reading the file nine times. A shared demuxer reads each
+ * packet once and queues it for the decoder of its stream.
+ *
+ * Each stream has at most one reader per demuxer. Readers can seek independently: when one stream seeks, the others
+ * stop queuing and, once they've used up what's already queued, seek back to where they left off and skip the
+ * packets they've already received. This is transparent to readers, who see each stream as if they had the file to
+ * themselves. Queues are bounded by kQueueLimit so that an idle reader doesn't grow its queue forever (it resumes the
+ * same way instead).
+ *
+ * This class is thread-safe.
+ */
+class FFmpegDemuxer
+{
+public:
+  ~FFmpegDemuxer();
+
+  /**
+   * @brief Get a demuxer for reading a stream of a file
+   *
+   * Returns an existing demuxer for this file that doesn't already have a reader on this stream, or opens a new one.
+   * The stream is registered to the caller until Release() is called.
+   *
+   * @return
+   *
+   * A demuxer or nullptr if the file couldn't be opened.
+   */
+  static FFmpegDemuxerPtr Acquire(const QString& filename, int stream_index);
+
+  /**
+   * @brief Unregister a stream acquired with Acquire()
+   */
+  void Release(int stream_index);
+
+  /**
+   * @brief Access the format context
+   *
+   * Must only be used for reading stream information, packets must be read and seeked through this class.
+   */
+  AVFormatContext* format_context();
+
+  /**
+   * @brief Read the next packet of a stream
+   *
+   * @return
+   *
+   * An FFmpeg error code (e.g. AVERROR_EOF), or >= 0 on success
+   */
+  int ReadPacket(int stream_index, AVPacket* pkt);
+
+  /**
+   * @brief Seek a stream, equivalent to av_seek_frame()
+   */
+  int Seek(int stream_index, int64_t timestamp, int flags);
+
+private:
+  struct StreamState {
+    StreamState();
+
+    QQueue<AVPacket*> queue;
+
+    /// Another stream has seeked since this stream's last read, so new packets don't follow on from its queue
+    bool discontinuous;
+
+    /// Resuming after a discontinuity, packets up to the last one received are dropped
+    bool skipping;
+
+    /// Whether any packets have been received since this stream's last seek
+    bool has_last;
+    int64_t last_dts;
+    int64_t last_pos;
+
+    /// The last seek this stream asked for, used to resume if no packets have been received since
+    int64_t seek_timestamp;
+    int seek_flags;
+  };
+
+  FFmpegDemuxer();
+
+  bool Open(const QString& filename);
+
+  /**
+   * @brief Returns TRUE if the header gave every stream the parameters a decoder needs to open it
+   *
+   * If so, and the file has been probed before, avformat_find_stream_info() (which can read and decode seconds of
+   * the file) isn't needed.
+   */
+  static bool HasStreamParameters(AVFormatContext* ctx);
+
+  /**
+   * @brief Seek back to where a discontinuous stream left off
+   */
+  int Resume(int stream_index);
+
+  /**
+   * @brief Returns TRUE if a packet comes after the last one a resuming stream received
+   */
+  static bool IsPastLastPacket(const StreamState& state, const AVPacket* pkt);
+
+  /**
+   * @brief Called after the format context seeks on behalf of one stream to flag all of the others
+   */
+  void MarkOthersDiscontinuous(int stream_index);
+
+  static void ClearQueue(StreamState& state);
+
+  /**
+   * @brief Maximum number of packets queued for a stream before it's treated as discontinuous instead
+   */
+  static const int kQueueLimit;
+
+  AVFormatContext* fmt_ctx_;
+
+  /**
+   * @brief Registered streams
+   */
+  QMap<int, StreamState> streams_;
+
+  /**
+   * @brief Whether the format context has moved from the start of the file (by reading or seeking)
+   */
+  bool moved_;
+
+  QMutex lock_;
+};
+
+#endif // FFMPEGDEMUXER_H
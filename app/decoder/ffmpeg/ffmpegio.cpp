@@ -0,0 +1,316 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ffmpegio.h"
+
+#include <climits>
+#include <cstring>
+#include <QDebug>
+
+#include "common/filefunctions.h"
+#include "config/config.h"
+
+/**
+ * @brief Size of the buffer between FFmpeg and Reader, reads are served from cached blocks so this can be small
+ */
+const int kIOContextBufferSize = 64 * 1024;
+
+int FFmpegIO::OpenInput(AVFormatContext **ctx, const QString &filename)
+{
+  QByteArray ba = filename.toUtf8();
+
+  if (!kUseRemoteIOCache || !IsRemoteFile(filename)) {
+    return avformat_open_input(ctx, ba.constData(), nullptr, nullptr);
+  }
+
+  Reader* reader = new Reader(filename);
+
+  if (!reader->Open()) {
+    // Not something we can cache (e.g. a live stream), let FFmpeg deal with it
+    delete reader;
+
+    return avformat_open_input(ctx, ba.constData(), nullptr, nullptr);
+  }
+
+  uint8_t* buffer = static_cast<uint8_t*>(av_malloc(kIOContextBufferSize));
+
+  AVIOContext* pb = avio_alloc_context(buffer, kIOContextBufferSize, 0, reader, ReadPacket, nullptr, SeekPacket);
+
+  *ctx = avformat_alloc_context();
+  (*ctx)->pb = pb;
+
+  int error_code = avformat_open_input(ctx, ba.constData(), nullptr, nullptr);
+
+  if (error_code < 0) {
+    // FFmpeg frees the format context on failure, but never a custom AVIOContext
+    FreeIOContext(pb);
+  }
+
+  return error_code;
+}
+
+void FFmpegIO::CloseInput(AVFormatContext **ctx)
+{
+  if (*ctx == nullptr) {
+    return;
+  }
+
+  AVIOContext* pb = ((*ctx)->flags & AVFMT_FLAG_CUSTOM_IO) ? (*ctx)->pb : nullptr;
+
+  avformat_close_input(ctx);
+
+  if (pb != nullptr) {
+    FreeIOContext(pb);
+  }
+}
+
+int FFmpegIO::ReadPacket(void *opaque, uint8_t *buf, int buf_size)
+{
+  return static_cast<Reader*>(opaque)->Read(buf, buf_size);
+}
+
+int64_t FFmpegIO::SeekPacket(void *opaque, int64_t offset, int whence)
+{
+  return static_cast<Reader*>(opaque)->Seek(offset, whence);
+}
+
+void FFmpegIO::FreeIOContext(AVIOContext *pb)
+{
+  delete static_cast<Reader*>(pb->opaque);
+
+  av_freep(&pb->buffer);
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 80, 100)
+  avio_context_free(&pb);
+#else
+  av_freep(&pb);
+#endif
+}
+
+FFmpegIO::Reader::Reader(const QString &filename) :
+  filename_(filename),
+  url_(nullptr),
+  file_id_(0),
+  size_(0),
+  pos_(0),
+  last_block_(-1),
+  read_ahead_(1)
+{
+}
+
+FFmpegIO::Reader::~Reader()
+{
+  if (url_ != nullptr) {
+    avio_closep(&url_);
+  }
+}
+
+bool FFmpegIO::Reader::Open()
+{
+  QString identifier;
+
+  if (filename_.contains(QStringLiteral("://"))) {
+    QByteArray ba = filename_.toUtf8();
+
+    if (avio_open2(&url_, ba.constData(), AVIO_FLAG_READ, nullptr, nullptr) < 0) {
+      return false;
+    }
+
+    size_ = avio_size(url_);
+
+    // URLs don't tell us when they change, so they're assumed not to
+    identifier = filename_;
+  } else {
+    file_.setFileName(filename_);
+
+    if (!file_.open(QFile::ReadOnly)) {
+      return false;
+    }
+
+    size_ = file_.size();
+
+    identifier = GetUniqueFileIdentifier(filename_);
+  }
+
+  // Blocks can only be cached if we know where the file ends
+  if (size_ <= 0 || identifier.isEmpty()) {
+    return false;
+  }
+
+  file_id_ = IOBlockCache::instance()->GetFileID(identifier);
+
+  return true;
+}
+
+int FFmpegIO::Reader::Read(uint8_t *buf, int size)
+{
+  if (pos_ >= size_) {
+    return AVERROR_EOF;
+  }
+
+  qint64 index = pos_ / kIOBlockSize;
+
+  IOBlockCache::BlockPtr block = GetBlock(index);
+
+  if (block == nullptr) {
+    return AVERROR(EIO);
+  }
+
+  int offset = static_cast<int>(pos_ - index * kIOBlockSize);
+  int count = qMin(size, block->size() - offset);
+
+  if (count <= 0) {
+    return AVERROR_EOF;
+  }
+
+  memcpy(buf, block->data() + offset, static_cast<size_t>(count));
+
+  pos_ += count;
+
+  return count;
+}
+
+int64_t FFmpegIO::Reader::Seek(int64_t offset, int whence)
+{
+  qint64 pos;
+
+  switch (whence & ~AVSEEK_FORCE) {
+  case AVSEEK_SIZE:
+    return size_;
+  case SEEK_SET:
+    pos = offset;
+    break;
+  case SEEK_CUR:
+    pos = pos_ + offset;
+    break;
+  case SEEK_END:
+    pos = size_ + offset;
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+
+  if (pos < 0) {
+    return AVERROR(EINVAL);
+  }
+
+  // Seeking is free, nothing's read until the demuxer asks for it
+  pos_ = pos;
+
+  return pos_;
+}
+
+IOBlockCache::BlockPtr FFmpegIO::Reader::GetBlock(qint64 index)
+{
+  IOBlockCache* cache = IOBlockCache::instance();
+
+  // Read further ahead the longer access stays sequential, back to a single block when it jumps
+  if (index == last_block_ + 1) {
+    read_ahead_ = qMin(read_ahead_ * 2, kIOReadAheadBlocks);
+  } else if (index != last_block_) {
+    read_ahead_ = 1;
+  }
+
+  last_block_ = index;
+
+  IOBlockCache::BlockPtr block = cache->Get(file_id_, index);
+
+  if (block != nullptr) {
+    return block;
+  }
+
+  // Fetch this block and the read-ahead in one request, stopping early at any that are already cached
+  qint64 block_count = (size_ + kIOBlockSize - 1) / kIOBlockSize;
+  int count = static_cast<int>(qMin(static_cast<qint64>(read_ahead_), block_count - index));
+
+  for (int i=1;i<count;i++) {
+    if (cache->Get(file_id_, index + i) != nullptr) {
+      count = i;
+      break;
+    }
+  }
+
+  qint64 start = index * kIOBlockSize;
+  qint64 length = qMin(static_cast<qint64>(count) * kIOBlockSize, size_ - start);
+
+  fetch_buffer_.resize(static_cast<int>(length));
+
+  uint8_t* data = reinterpret_cast<uint8_t*>(fetch_buffer_.data());
+
+  if (!Fetch(start, data, length)) {
+    qWarning() << "Failed to read" << length << "bytes at" << start << "from" << filename_;
+    return nullptr;
+  }
+
+  for (int i=0;i<count;i++) {
+    qint64 block_start = static_cast<qint64>(i) * kIOBlockSize;
+    int block_size = static_cast<int>(qMin(static_cast<qint64>(kIOBlockSize), length - block_start));
+
+    IOBlockCache::BlockPtr b = std::make_shared<IOBlockCache::Block>(block_size);
+
+    memcpy(b->data(), data + block_start, static_cast<size_t>(block_size));
+
+    cache->Insert(file_id_, index + i, b);
+
+    if (i == 0) {
+      block = b;
+    }
+  }
+
+  return block;
+}
+
+bool FFmpegIO::Reader::Fetch(qint64 offset, uint8_t *data, qint64 size)
+{
+  qint64 done = 0;
+
+  if (url_ != nullptr) {
+    if (avio_seek(url_, offset, SEEK_SET) < 0) {
+      return false;
+    }
+
+    while (done < size) {
+      int chunk = static_cast<int>(qMin(size - done, static_cast<qint64>(INT_MAX)));
+      int read = avio_read(url_, data + done, chunk);
+
+      if (read <= 0) {
+        return false;
+      }
+
+      done += read;
+    }
+  } else {
+    if (!file_.seek(offset)) {
+      return false;
+    }
+
+    while (done < size) {
+      qint64 read = file_.read(reinterpret_cast<char*>(data + done), size - done);
+
+      if (read <= 0) {
+        return false;
+      }
+
+      done += read;
+    }
+  }
+
+  return true;
+}
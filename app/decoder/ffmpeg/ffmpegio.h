@@ -0,0 +1,124 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FFMPEGIO_H
+#define FFMPEGIO_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include "ioblockcache.h"
+
+/**
+ * @brief Opens format contexts, reading remote media through IOBlockCache
+ *
+ * FFmpeg reads files in small pieces at whatever offsets the demuxer asks for, which is fine locally but on NFS/SMB
+ * or over HTTP makes every seek and every small read a round trip. For remote files (see IsRemoteFile()), OpenInput()
+ * gives the format context a custom AVIOContext instead that reads whole kIOBlockSize blocks at aligned offsets,
+ * fetches up to kIOReadAheadBlocks blocks in one request while reading sequentially, and shares blocks between every
+ * reader of the file through IOBlockCache. Local files are opened by FFmpeg directly.
+ *
+ * Local paths (including mounted network shares) are read with QFile, URLs with FFmpeg's own protocols, so anything
+ * FFmpeg can seek in (e.g. HTTP with range requests, including presigned object storage URLs) can be cached.
+ */
+class FFmpegIO
+{
+public:
+  /**
+   * @brief Equivalent to avformat_open_input() with no format or options
+   *
+   * Contexts opened with this must be closed with CloseInput().
+   */
+  static int OpenInput(AVFormatContext** ctx, const QString& filename);
+
+  /**
+   * @brief Equivalent to avformat_close_input(), also frees the AVIOContext OpenInput() may have created
+   */
+  static void CloseInput(AVFormatContext** ctx);
+
+private:
+  /**
+   * @brief Reads a file through IOBlockCache on behalf of one AVIOContext
+   */
+  class Reader
+  {
+  public:
+    Reader(const QString& filename);
+
+    ~Reader();
+
+    bool Open();
+
+    /**
+     * @brief AVIOContext read callback, returns bytes read or an FFmpeg error code
+     */
+    int Read(uint8_t* buf, int size);
+
+    /**
+     * @brief AVIOContext seek callback
+     */
+    int64_t Seek(int64_t offset, int whence);
+
+  private:
+    /**
+     * @brief Get a block from the cache, fetching it (and any read-ahead) if it isn't there
+     */
+    IOBlockCache::BlockPtr GetBlock(qint64 index);
+
+    /**
+     * @brief Read `size` bytes at `offset` from the file itself
+     */
+    bool Fetch(qint64 offset, uint8_t* data, qint64 size);
+
+    QString filename_;
+
+    /// Used for local paths
+    QFile file_;
+
+    /// Used for URLs
+    AVIOContext* url_;
+
+    int file_id_;
+
+    qint64 size_;
+
+    qint64 pos_;
+
+    /// Block last read, and how many blocks the next fetch reads (doubling while access is sequential)
+    qint64 last_block_;
+    int read_ahead_;
+
+    QByteArray fetch_buffer_;
+  };
+
+  static int ReadPacket(void* opaque, uint8_t* buf, int buf_size);
+
+  static int64_t SeekPacket(void* opaque, int64_t offset, int whence);
+
+  static void FreeIOContext(AVIOContext* pb);
+
+};
+
+#endif // FFMPEGIO_H
@@ -0,0 +1,129 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ioblockcache.h"
+
+extern "C" {
+#include <libavutil/mem.h>
+}
+
+#include "config/config.h"
+
+IOBlockCache::Block::Block(int size) :
+  data_(static_cast<uint8_t*>(av_malloc(static_cast<size_t>(size)))),
+  size_(size)
+{
+}
+
+IOBlockCache::Block::~Block()
+{
+  av_free(data_);
+}
+
+uint8_t *IOBlockCache::Block::data() const
+{
+  return data_;
+}
+
+int IOBlockCache::Block::size() const
+{
+  return size_;
+}
+
+IOBlockCache *IOBlockCache::instance()
+{
+  static IOBlockCache cache;
+
+  return &cache;
+}
+
+int IOBlockCache::GetFileID(const QString &identifier)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<QString, int>::const_iterator it = file_ids_.constFind(identifier);
+
+  if (it != file_ids_.constEnd()) {
+    return it.value();
+  }
+
+  int id = file_ids_.size();
+
+  file_ids_.insert(identifier, id);
+
+  return id;
+}
+
+IOBlockCache::BlockPtr IOBlockCache::Get(int file, qint64 index)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<quint64, Entry>::iterator it = blocks_.find(Key(file, index));
+
+  if (it == blocks_.end()) {
+    return nullptr;
+  }
+
+  // Move to the front of the LRU list
+  lru_.splice(lru_.begin(), lru_, it.value().lru);
+
+  return it.value().block;
+}
+
+void IOBlockCache::Insert(int file, qint64 index, IOBlockCache::BlockPtr block)
+{
+  QMutexLocker locker(&lock_);
+
+  quint64 key = Key(file, index);
+
+  if (blocks_.contains(key)) {
+    // Another reader got here first, both are the same data
+    return;
+  }
+
+  lru_.push_front(key);
+
+  Entry entry;
+  entry.block = block;
+  entry.lru = lru_.begin();
+
+  blocks_.insert(key, entry);
+  size_ += block->size();
+
+  // Readers still holding an evicted block keep it alive until they're done with it
+  while (size_ > kIOBlockCacheSize && lru_.size() > 1) {
+    quint64 oldest = lru_.back();
+
+    size_ -= blocks_.value(oldest).block->size();
+    blocks_.remove(oldest);
+    lru_.pop_back();
+  }
+}
+
+IOBlockCache::IOBlockCache() :
+  size_(0)
+{
+}
+
+quint64 IOBlockCache::Key(int file, qint64 index)
+{
+  // 40 bits of block index is far more than any file has
+  return (static_cast<quint64>(file) << 40) | static_cast<quint64>(index);
+}
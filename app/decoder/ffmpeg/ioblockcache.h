@@ -0,0 +1,104 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef IOBLOCKCACHE_H
+#define IOBLOCKCACHE_H
+
+#include <list>
+#include <memory>
+#include <QHash>
+#include <QMutex>
+#include <stdint.h>
+
+/**
+ * @brief A process-wide LRU cache of fixed-size blocks of remote media files
+ *
+ * Blocks are kIOBlockSize bytes at block-aligned offsets of a file (the last block of a file may be shorter), so every
+ * FFmpegIO reader of the same file shares them no matter where it's reading. The cache holds at most
+ * kIOBlockCacheSize bytes, dropping the least recently used blocks first.
+ *
+ * This class is thread-safe.
+ */
+class IOBlockCache
+{
+public:
+  /**
+   * @brief A cached block, its data is aligned for SIMD and immutable once inserted
+   */
+  class Block
+  {
+  public:
+    Block(int size);
+
+    ~Block();
+
+    uint8_t* data() const;
+
+    int size() const;
+
+  private:
+    uint8_t* data_;
+
+    int size_;
+  };
+
+  using BlockPtr = std::shared_ptr<Block>;
+
+  static IOBlockCache* instance();
+
+  /**
+   * @brief Returns a file's ID, used with its block indices to look blocks up
+   *
+   * `identifier` should change when the file does, e.g. GetUniqueFileIdentifier().
+   */
+  int GetFileID(const QString& identifier);
+
+  /**
+   * @brief Returns block `index` of a file, or nullptr if it isn't cached
+   */
+  BlockPtr Get(int file, qint64 index);
+
+  void Insert(int file, qint64 index, BlockPtr block);
+
+private:
+  IOBlockCache();
+
+  static quint64 Key(int file, qint64 index);
+
+  struct Entry {
+    BlockPtr block;
+
+    std::list<quint64>::iterator lru;
+  };
+
+  QHash<QString, int> file_ids_;
+
+  QHash<quint64, Entry> blocks_;
+
+  /// Keys from most to least recently used
+  std::list<quint64> lru_;
+
+  qint64 size_;
+
+  QMutex lock_;
+
+};
+
+#endif // IOBLOCKCACHE_H
@@ -0,0 +1,220 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "filmstrip.h"
+
+#include <algorithm>
+#include <cstring>
+#include <QDebug>
+#include <QMap>
+#include <QMutex>
+
+#include "common/filefunctions.h"
+#include "project/item/footage/footage.h"
+
+namespace {
+
+const char kMagic[4] = {'O', 'F', 'L', 'M'};
+
+/**
+ * @brief All filmstrips currently loaded in this process
+ */
+QMap<QString, std::weak_ptr<Filmstrip> > loaded_filmstrips;
+QMutex loaded_filmstrips_lock;
+
+}
+
+Filmstrip::Filmstrip() :
+  map_(nullptr),
+  header_(nullptr),
+  times_(nullptr),
+  pixels_(nullptr)
+{
+}
+
+Filmstrip::~Filmstrip()
+{
+  if (map_ != nullptr) {
+    file_.unmap(map_);
+  }
+
+  file_.close();
+}
+
+FilmstripPtr Filmstrip::Load(const QString &filename)
+{
+  QMutexLocker locker(&loaded_filmstrips_lock);
+
+  FilmstripPtr existing = loaded_filmstrips.value(filename).lock();
+
+  if (existing != nullptr) {
+    return existing;
+  }
+
+  FilmstripPtr filmstrip(new Filmstrip());
+
+  filmstrip->file_.setFileName(filename);
+
+  if (!filmstrip->file_.open(QFile::ReadOnly)) {
+    return nullptr;
+  }
+
+  qint64 file_size = filmstrip->file_.size();
+
+  if (file_size < static_cast<qint64>(sizeof(Header))) {
+    return nullptr;
+  }
+
+  filmstrip->map_ = filmstrip->file_.map(0, file_size);
+
+  if (filmstrip->map_ == nullptr) {
+    qWarning() << "Failed to map filmstrip" << filename;
+    return nullptr;
+  }
+
+  filmstrip->header_ = reinterpret_cast<const Header*>(filmstrip->map_);
+
+  const Header* header = filmstrip->header_;
+
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0
+      || header->version != kVersion
+      || header->width <= 0
+      || header->height <= 0
+      || header->count < 0) {
+    return nullptr;
+  }
+
+  qint64 table_end = static_cast<qint64>(sizeof(Header))
+      + static_cast<qint64>(sizeof(double)) * header->count;
+  qint64 thumbnail_size = static_cast<qint64>(header->width) * header->height * 4;
+
+  if (file_size < table_end + thumbnail_size * header->count) {
+    return nullptr;
+  }
+
+  filmstrip->times_ = reinterpret_cast<const double*>(filmstrip->map_ + sizeof(Header));
+  filmstrip->pixels_ = filmstrip->map_ + table_end;
+
+  loaded_filmstrips.insert(filename, filmstrip);
+
+  return filmstrip;
+}
+
+QString Filmstrip::GetFilename(Stream *stream)
+{
+  return GetMediaIndexFilename(GetUniqueFileIdentifier(stream->footage()->filename()))
+      .append(QString::number(stream->index()))
+      .append(QStringLiteral(".filmstrip"));
+}
+
+int Filmstrip::thumbnail_width() const
+{
+  return header_->width;
+}
+
+int Filmstrip::thumbnail_height() const
+{
+  return header_->height;
+}
+
+int Filmstrip::count() const
+{
+  return header_->count;
+}
+
+double Filmstrip::time(int index) const
+{
+  return times_[index];
+}
+
+int Filmstrip::GetThumbnailAt(double time) const
+{
+  const double* end = times_ + header_->count;
+  const double* after = std::upper_bound(times_, end, time);
+
+  return qMax(0, static_cast<int>(after - times_) - 1);
+}
+
+QImage Filmstrip::thumbnail(int index) const
+{
+  int bytes_per_line = header_->width * 4;
+
+  return QImage(pixels_ + static_cast<qint64>(index) * bytes_per_line * header_->height,
+                header_->width,
+                header_->height,
+                bytes_per_line,
+                QImage::Format_RGB32);
+}
+
+FilmstripBuilder::FilmstripBuilder(int width, int height) :
+  width_(width),
+  height_(height)
+{
+}
+
+void FilmstripBuilder::AddThumbnail(double time, const QImage &image)
+{
+  QImage thumbnail = image;
+
+  if (thumbnail.width() != width_ || thumbnail.height() != height_) {
+    thumbnail = thumbnail.scaled(width_, height_, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+  }
+
+  times_.append(time);
+  images_.append(thumbnail.convertToFormat(QImage::Format_RGB32));
+}
+
+int FilmstripBuilder::count() const
+{
+  return times_.size();
+}
+
+bool FilmstripBuilder::Save(const QString &filename)
+{
+  QFile f(filename);
+
+  if (!f.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  Filmstrip::Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = Filmstrip::kVersion;
+  header.width = width_;
+  header.height = height_;
+  header.count = times_.size();
+  header.reserved = 0;
+
+  f.write(reinterpret_cast<const char*>(&header), sizeof(Filmstrip::Header));
+  f.write(reinterpret_cast<const char*>(times_.constData()), static_cast<qint64>(sizeof(double)) * times_.size());
+
+  // Write rows individually since QImage may pad its scanlines
+  for (int i=0;i<images_.size();i++) {
+    const QImage& image = images_.at(i);
+
+    for (int j=0;j<height_;j++) {
+      f.write(reinterpret_cast<const char*>(image.constScanLine(j)), width_ * 4);
+    }
+  }
+
+  f.close();
+
+  return true;
+}
@@ -0,0 +1,168 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FILMSTRIP_H
+#define FILMSTRIP_H
+
+#include <memory>
+#include <QFile>
+#include <QImage>
+#include <QVector>
+#include <stdint.h>
+
+#include "project/item/footage/stream.h"
+
+class Filmstrip;
+using FilmstripPtr = std::shared_ptr<Filmstrip>;
+
+/**
+ * @brief A strip of small thumbnails of a video stream, sampled at regular intervals
+ *
+ * Clips on the timeline show their video as a row of thumbnails, but decoding frames while painting would make
+ * scrolling unusable. Instead, FilmstripTask decodes one keyframe per interval at a reduced resolution in the
+ * background and stores the results as one atlas of equally sized thumbnails. Painting then only needs to pick the
+ * thumbnail closest to each tile and draw it.
+ *
+ * Like Waveform, filmstrip files live next to the media indexes and are memory-mapped and shared when loaded.
+ */
+class Filmstrip
+{
+public:
+  /// Version of the file layout, files with a different version are ignored (and rebuilt)
+  static const uint32_t kVersion = 1;
+
+  /// Height of each thumbnail in pixels, roughly the height of a track
+  static const int kThumbnailHeight = 54;
+
+  /// Seconds between thumbnails
+  static const int kInterval = 1;
+
+  /// Maximum thumbnails stored per stream, long media uses a larger interval to stay under this
+  static const int kMaxThumbnails = 600;
+
+  ~Filmstrip();
+
+  /**
+   * @brief Load a filmstrip file, or get the already loaded copy if another caller has it
+   *
+   * @return
+   *
+   * The filmstrip, or nullptr if the file doesn't exist or isn't valid.
+   */
+  static FilmstripPtr Load(const QString& filename);
+
+  /**
+   * @brief Returns the filename the filmstrip for a stream is stored at
+   */
+  static QString GetFilename(Stream* stream);
+
+  int thumbnail_width() const;
+
+  int thumbnail_height() const;
+
+  int count() const;
+
+  /**
+   * @brief Returns the media time (in seconds) of a thumbnail
+   */
+  double time(int index) const;
+
+  /**
+   * @brief Returns the index of the last thumbnail at or before `time` (in seconds), or the first if there are none
+   */
+  int GetThumbnailAt(double time) const;
+
+  /**
+   * @brief Returns a thumbnail as an image
+   *
+   * The image references the mapped file rather than copying it, so it's only valid while this Filmstrip exists.
+   */
+  QImage thumbnail(int index) const;
+
+private:
+  /**
+   * @brief Layout of the start of a filmstrip file
+   *
+   * The header is followed by `count` doubles holding each thumbnail's time, and then each thumbnail's pixels in
+   * QImage::Format_RGB32.
+   */
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    int32_t width;
+    int32_t height;
+    int32_t count;
+    int32_t reserved;
+  };
+
+  Filmstrip();
+
+  QFile file_;
+
+  uchar* map_;
+
+  const Header* header_;
+
+  const double* times_;
+
+  const uchar* pixels_;
+
+  friend class FilmstripBuilder;
+
+};
+
+/**
+ * @brief Collects thumbnails and writes a filmstrip file
+ */
+class FilmstripBuilder
+{
+public:
+  FilmstripBuilder(int width, int height);
+
+  /**
+   * @brief Add a thumbnail for a media time (in seconds), scaling the image to the thumbnail size if necessary
+   *
+   * Thumbnails must be added in ascending time order.
+   */
+  void AddThumbnail(double time, const QImage& image);
+
+  int count() const;
+
+  /**
+   * @brief Write every thumbnail to a file
+   *
+   * @return
+   *
+   * TRUE on success
+   */
+  bool Save(const QString& filename);
+
+private:
+  int width_;
+
+  int height_;
+
+  QVector<double> times_;
+
+  QVector<QImage> images_;
+
+};
+
+#endif // FILMSTRIP_H
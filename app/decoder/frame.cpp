@@ -23,15 +23,26 @@
 #include <QDebug>
 #include <QtGlobal>
 
+#include "decoder/framebufferpool.h"
 #include "render/pixelservice.h"
+#include "render/sampleservice.h"
 
 Frame::Frame() :
   width_(0),
   height_(0),
+  sample_count_(0),
+  channel_count_(0),
+  sample_rate_(0),
   format_(-1),
+  plane_count_(0),
   timestamp_(0),
-  native_timestamp_(0)
+  native_timestamp_(0),
+  memory_tracker_(MemoryStats::kFrames)
 {
+  for (int i=0;i<kMaxPlanes;i++) {
+    planes_[i] = nullptr;
+    linesizes_[i] = 0;
+  }
 }
 
 FramePtr Frame::Create()
@@ -59,6 +70,36 @@ void Frame::set_height(const int &height)
   height_ = height;
 }
 
+const int &Frame::sample_count()
+{
+  return sample_count_;
+}
+
+void Frame::set_sample_count(const int &sample_count)
+{
+  sample_count_ = sample_count;
+}
+
+const int &Frame::channel_count()
+{
+  return channel_count_;
+}
+
+void Frame::set_channel_count(const int &channel_count)
+{
+  channel_count_ = channel_count;
+}
+
+const int &Frame::sample_rate()
+{
+  return sample_rate_;
+}
+
+void Frame::set_sample_rate(const int &sample_rate)
+{
+  sample_rate_ = sample_rate;
+}
+
 const rational &Frame::timestamp()
 {
   return timestamp_;
@@ -89,27 +130,96 @@ void Frame::set_format(const int &format)
   format_ = format;
 }
 
-uint8_t *Frame::data()
+const olive::YUVInfo &Frame::yuv_info()
+{
+  return yuv_info_;
+}
+
+void Frame::set_yuv_info(const olive::YUVInfo &info)
+{
+  yuv_info_ = info;
+}
+
+uint8_t *Frame::data(int plane)
 {
-  return data_.data();
+  return planes_[plane];
 }
 
-const uint8_t *Frame::const_data()
+const uint8_t *Frame::const_data(int plane)
 {
-  return data_.constData();
+  return planes_[plane];
+}
+
+int Frame::linesize(int plane)
+{
+  return linesizes_[plane];
+}
+
+const int &Frame::plane_count()
+{
+  return plane_count_;
 }
 
 void Frame::allocate()
 {
-  // Assume this frame is intended to be a video frame
+  destroy();
+
+  int size;
+
+  // Video frames have dimensions, audio frames have samples
   if (width_ > 0 && height_ > 0) {
-    data_.resize(PixelService::GetBufferSize(static_cast<olive::PixelFormat>(format_), width_, height_));
+    size = PixelService::GetBufferSize(static_cast<olive::PixelFormat>(format_), width_, height_);
+    linesizes_[0] = PixelService::BytesPerPixel(static_cast<olive::PixelFormat>(format_)) * width_;
+  } else if (sample_count_ > 0 && channel_count_ > 0) {
+    // All audio is packed so a single plane is enough
+    size = SampleService::GetBufferSize(static_cast<olive::SampleFormat>(format_), channel_count_, sample_count_);
+    linesizes_[0] = size;
+  } else {
+    return;
+  }
+
+  // NOTE: Pooled buffers aren't initialized, which is what we want since it'll all be overwritten anyway
+  std::shared_ptr<uint8_t> buffer = FrameBufferPool::Instance()->Get(size);
+
+  if (buffer == nullptr) {
+    qWarning() << "Failed to allocate" << size << "bytes for frame";
+    linesizes_[0] = 0;
+    return;
   }
 
-  // FIXME: Audio sample allocation
+  planes_[0] = buffer.get();
+  plane_count_ = 1;
+
+  memory_tracker_.SetBytes(size);
+
+  // The buffer goes back to the pool once nothing is using this frame's data anymore
+  owner_ = buffer;
 }
 
 void Frame::destroy()
 {
-  data_.clear();
+  owner_ = nullptr;
+
+  for (int i=0;i<kMaxPlanes;i++) {
+    planes_[i] = nullptr;
+    linesizes_[i] = 0;
+  }
+
+  plane_count_ = 0;
+
+  memory_tracker_.SetBytes(0);
+}
+
+void Frame::wrap(int plane_count, uint8_t * const *data, const int *linesize, std::shared_ptr<void> owner)
+{
+  destroy();
+
+  plane_count_ = qMin(plane_count, static_cast<int>(kMaxPlanes));
+
+  for (int i=0;i<plane_count_;i++) {
+    planes_[i] = data[i];
+    linesizes_[i] = linesize[i];
+  }
+
+  owner_ = owner;
 }
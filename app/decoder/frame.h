@@ -22,10 +22,13 @@
 #define FRAME_H
 
 #include <memory>
-#include <QVector>
+#include <QByteArray>
 
+#include "common/memorystats.h"
 #include "common/rational.h"
 #include "render/pixelformat.h"
+#include "render/sampleformat.h"
+#include "render/yuvformat.h"
 
 class Frame;
 using FramePtr = std::shared_ptr<Frame>;
@@ -35,11 +38,18 @@ using FramePtr = std::shared_ptr<Frame>;
  *
  * Abstraction from AVFrame. Currently a simple AVFrame wrapper.
  *
+ * A frame either owns its own memory buffer from the FrameBufferPool (see allocate()) or wraps memory owned by
+ * something else, e.g. a ref-counted AVFrame from the decoder (see wrap()). Wrapping allows decoded data to be passed
+ * through without copying it. Frames can have up to kMaxPlanes planes of data for planar formats.
+ *
  * This class does not support copying at this time.
  */
 class Frame
 {
 public:
+  /// Maximum number of data planes a frame can have
+  static const int kMaxPlanes = 4;
+
   /// Normal constructor
   Frame();
 
@@ -57,6 +67,24 @@ public:
   const int& height();
   void set_height(const int& height);
 
+  /**
+   * @brief Get the number of audio samples (per channel) in this frame
+   */
+  const int& sample_count();
+  void set_sample_count(const int& sample_count);
+
+  /**
+   * @brief Get the number of audio channels in this frame
+   */
+  const int& channel_count();
+  void set_channel_count(const int& channel_count);
+
+  /**
+   * @brief Get the audio sample rate of this frame in Hz
+   */
+  const int& sample_rate();
+  void set_sample_rate(const int& sample_rate);
+
   /**
    * @brief Get frame's timestamp.
    *
@@ -78,22 +106,44 @@ public:
   const int& format();
   void set_format(const int& format);
 
+  /**
+   * @brief Get the native YUV layout of this frame's data
+   *
+   * If the layout is YUV_LAYOUT_INVALID (the default), the data is packed in the pixel format returned by format().
+   * Otherwise the planes contain native YUV data which should be uploaded with a PlanarTexture and converted to
+   * format() on the GPU.
+   */
+  const olive::YUVInfo& yuv_info();
+  void set_yuv_info(const olive::YUVInfo& info);
+
   /**
    * @brief Get the data buffer of this frame
    */
-  uint8_t* data();
+  uint8_t* data(int plane = 0);
 
   /**
    * @brief Get the const data buffer of this frame
    */
-  const uint8_t* const_data();
+  const uint8_t* const_data(int plane = 0);
+
+  /**
+   * @brief Get the size in bytes of one line of data in a plane (may be larger than width * bytes per pixel)
+   */
+  int linesize(int plane = 0);
+
+  /**
+   * @brief Get the number of data planes in this frame
+   */
+  const int& plane_count();
 
   /**
    * @brief Allocate memory buffer to store data based on parameters
    *
-   * For video frames, the width(), height(), and format() must be set for this function to work.
+   * For video frames, the width(), height(), and format() must be set for this function to work. For audio frames,
+   * the sample_count(), channel_count(), and format() must be set instead and the samples are packed (interleaved).
    *
-   * If a memory buffer has been previously allocated without destroying, this function will destroy it.
+   * The buffer comes from FrameBufferPool, so it's aligned to FrameBufferPool::kAlignment and its contents are
+   * uninitialized. If a memory buffer has been previously allocated without destroying, this function will destroy it.
    */
   void allocate();
 
@@ -102,19 +152,51 @@ public:
    */
   void destroy();
 
+  /**
+   * @brief Use memory owned by something else as this frame's data rather than allocating a buffer
+   *
+   * If a memory buffer has been previously allocated, this function will destroy it.
+   *
+   * @param plane_count
+   *
+   * Number of planes in `data` and `linesize`. Must be <= kMaxPlanes.
+   *
+   * @param owner
+   *
+   * The object that owns the data. The frame keeps a reference to it for as long as the data is in use and releases
+   * it in destroy() or when the frame is deleted.
+   */
+  void wrap(int plane_count, uint8_t* const* data, const int* linesize, std::shared_ptr<void> owner);
+
 private:
   int width_;
 
   int height_;
 
+  int sample_count_;
+
+  int channel_count_;
+
+  int sample_rate_;
+
   int format_;
 
-  QVector<uint8_t> data_;
+  olive::YUVInfo yuv_info_;
+
+  uint8_t* planes_[kMaxPlanes];
+
+  int linesizes_[kMaxPlanes];
+
+  int plane_count_;
+
+  std::shared_ptr<void> owner_;
 
   rational timestamp_;
 
   int64_t native_timestamp_;
 
+  MemoryTracker memory_tracker_;
+
 };
 
 #endif // FRAME_H
@@ -0,0 +1,224 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "framebufferpool.h"
+
+#include <QtGlobal>
+
+#ifdef Q_OS_LINUX
+#include <stdlib.h>
+#include <sys/mman.h>
+#endif
+
+#include "common/threadaffinity.h"
+#include "config/config.h"
+
+namespace {
+
+/**
+ * @brief Size (and alignment) of a huge page, buffers at least this large are backed by them where possible
+ */
+const qint64 kHugePageSize = Q_INT64_C(2) * 1024 * 1024;
+
+/**
+ * @brief Granularity of the smallest size classes
+ */
+const qint64 kMinimumSizeStep = 4096;
+
+}
+
+FrameBufferPool *FrameBufferPool::Instance()
+{
+  static FrameBufferPool* instance = new FrameBufferPool();
+
+  return instance;
+}
+
+FrameBufferPool::FrameBufferPool() :
+  free_size_(0)
+{
+  olive::image_cache.AddClient(this);
+}
+
+std::shared_ptr<uint8_t> FrameBufferPool::Get(qint64 size)
+{
+  qint64 size_class = SizeClass(size);
+
+  PooledBuffer buffer = {nullptr, ThreadAffinity::CurrentNode()};
+
+  lock_.lock();
+
+  QMap<qint64, QList<PooledBuffer> >::iterator it = free_buffers_.find(size_class);
+
+  if (it != free_buffers_.end()) {
+    QList<PooledBuffer>& list = it.value();
+
+    // Prefer the most recently returned buffer that's local to this thread's node, otherwise any will do
+    int index = list.size() - 1;
+
+    for (int i=list.size()-1;i>=0;i--) {
+      if (list.at(i).node == buffer.node) {
+        index = i;
+        break;
+      }
+    }
+
+    buffer = list.takeAt(index);
+    free_size_ -= size_class;
+
+    if (it.value().isEmpty()) {
+      free_buffers_.erase(it);
+    }
+  }
+
+  lock_.unlock();
+
+  if (buffer.data == nullptr) {
+    buffer.data = AllocateBuffer(size_class);
+
+    if (buffer.data == nullptr) {
+      return nullptr;
+    }
+  }
+
+  return std::shared_ptr<uint8_t>(buffer.data, [this, buffer, size_class](uint8_t*) { Return(buffer, size_class); });
+}
+
+void FrameBufferPool::Clear()
+{
+  QMap<qint64, QList<PooledBuffer> > buffers;
+
+  lock_.lock();
+  buffers.swap(free_buffers_);
+  free_size_ = 0;
+  lock_.unlock();
+
+  for (QMap<qint64, QList<PooledBuffer> >::const_iterator it=buffers.constBegin();it!=buffers.constEnd();it++) {
+    foreach (const PooledBuffer& buffer, it.value()) {
+      FreeBuffer(buffer.data, it.key());
+    }
+  }
+}
+
+void FrameBufferPool::Evict(const ImageCache::BufferType &type, const qint64 &bytes)
+{
+  if (type != ImageCache::kMemBuf) {
+    return;
+  }
+
+  QList<QPair<uint8_t*, qint64> > buffers;
+  qint64 taken = 0;
+
+  lock_.lock();
+
+  // Largest buffers first, they're the least likely to be asked for again soon
+  while (taken < bytes && !free_buffers_.isEmpty()) {
+    QMap<qint64, QList<PooledBuffer> >::iterator it = free_buffers_.end() - 1;
+
+    buffers.append({it.value().takeLast().data, it.key()});
+    taken += it.key();
+    free_size_ -= it.key();
+
+    if (it.value().isEmpty()) {
+      free_buffers_.erase(it);
+    }
+  }
+
+  lock_.unlock();
+
+  for (int i=0;i<buffers.size();i++) {
+    FreeBuffer(buffers.at(i).first, buffers.at(i).second);
+  }
+}
+
+qint64 FrameBufferPool::SizeClass(qint64 size)
+{
+  // Round up to a multiple of an eighth of the next power of two, which makes four classes per power of two
+  qint64 step = kMinimumSizeStep;
+
+  while (step * 8 <= size) {
+    step *= 2;
+  }
+
+  return qMax(step, (size + step - 1) / step * step);
+}
+
+uint8_t *FrameBufferPool::AllocateBuffer(qint64 size)
+{
+  uint8_t* buffer = AllocateBufferInternal(size);
+
+  if (buffer != nullptr) {
+    olive::image_cache.Allocated(ImageCache::kMemBuf, size);
+  }
+
+  return buffer;
+}
+
+uint8_t *FrameBufferPool::AllocateBufferInternal(qint64 size)
+{
+#ifdef Q_OS_LINUX
+  if (size >= kHugePageSize) {
+    void* buffer;
+
+    if (posix_memalign(&buffer, static_cast<size_t>(kHugePageSize), static_cast<size_t>(size)) != 0) {
+      return nullptr;
+    }
+
+#ifdef MADV_HUGEPAGE
+    // Huge pages take far fewer page faults (and TLB entries) to fill a frame this large
+    madvise(buffer, static_cast<size_t>(size), MADV_HUGEPAGE);
+#endif
+
+    return static_cast<uint8_t*>(buffer);
+  }
+#endif
+
+  return static_cast<uint8_t*>(qMallocAligned(static_cast<size_t>(size), static_cast<size_t>(kAlignment)));
+}
+
+void FrameBufferPool::FreeBuffer(uint8_t *buffer, qint64 size)
+{
+  olive::image_cache.Freed(ImageCache::kMemBuf, size);
+
+#ifdef Q_OS_LINUX
+  if (size >= kHugePageSize) {
+    free(buffer);
+    return;
+  }
+#endif
+
+  qFreeAligned(buffer);
+}
+
+void FrameBufferPool::Return(const PooledBuffer &buffer, qint64 size)
+{
+  lock_.lock();
+
+  if (free_size_ + size > kFrameBufferPoolBudget) {
+    lock_.unlock();
+
+    FreeBuffer(buffer.data, size);
+    return;
+  }
+
+  free_buffers_[size].append(buffer);
+  free_size_ += size;
+
+  lock_.unlock();
+}
@@ -0,0 +1,118 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef FRAMEBUFFERPOOL_H
+#define FRAMEBUFFERPOOL_H
+
+#include <memory>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <stdint.h>
+
+#include "render/imagecache.h"
+
+/**
+ * @brief A pool of reusable, aligned memory buffers for Frame data
+ *
+ * Decoded and converted frames are often tens of megabytes each and are usually freed again as soon as they've been
+ * uploaded, so allocating each one fresh costs a lot of allocator work and page faults. Frame::allocate() gets its
+ * buffer from here instead and the buffer comes back when the frame is done with it. Buffers aren't initialized.
+ *
+ * Buffers are grouped into size classes (four per power of two, so a buffer is never more than a quarter larger than
+ * requested) and are reused by any request in the same class. Every buffer is aligned to kAlignment bytes, and large
+ * ones are backed by transparent huge pages where the platform supports them. At most kFrameBufferPoolBudget bytes of
+ * free buffers are kept.
+ *
+ * Pages end up on the NUMA node of the thread that first writes them, so each buffer remembers the node it was
+ * allocated from (see ThreadAffinity) and free buffers are handed back out to threads on the same node first.
+ *
+ * Every buffer, in use or not, is accounted for in olive::image_cache, and free buffers are released when it runs short
+ * of system memory.
+ *
+ * This class is thread-safe.
+ */
+class FrameBufferPool : public ImageCache::Client
+{
+public:
+  /**
+   * @brief Alignment of every buffer, enough for any SIMD loads and a whole cache line
+   */
+  static const int kAlignment = 64;
+
+  /**
+   * @brief The pool used by every Frame
+   *
+   * Never destroyed, so frames released while the application is shutting down can still return their buffers.
+   */
+  static FrameBufferPool* Instance();
+
+  /**
+   * @brief Retrieve an uninitialized buffer of at least `size` bytes
+   *
+   * The buffer goes back to the pool when its last reference is released (from any thread). Returns nullptr if
+   * memory couldn't be allocated.
+   */
+  std::shared_ptr<uint8_t> Get(qint64 size);
+
+  /**
+   * @brief Free every buffer that isn't currently in use
+   */
+  void Clear();
+
+  virtual void Evict(const ImageCache::BufferType& type, const qint64& bytes) override;
+
+private:
+  FrameBufferPool();
+
+  /**
+   * @brief Returns the size buffers for a request of `size` bytes are allocated at
+   */
+  static qint64 SizeClass(qint64 size);
+
+  /**
+   * @brief Allocate a buffer and account for it in olive::image_cache, which may evict other buffers to make room
+   */
+  static uint8_t* AllocateBuffer(qint64 size);
+
+  static uint8_t* AllocateBufferInternal(qint64 size);
+
+  static void FreeBuffer(uint8_t* buffer, qint64 size);
+
+  struct PooledBuffer {
+    uint8_t* data;
+
+    /// NUMA node of the thread that allocated the buffer, -1 if it wasn't pinned
+    int node;
+  };
+
+  void Return(const PooledBuffer& buffer, qint64 size);
+
+  /**
+   * @brief Free buffers by size class
+   */
+  QMap<qint64, QList<PooledBuffer> > free_buffers_;
+
+  qint64 free_size_;
+
+  QMutex lock_;
+
+};
+
+#endif // FRAMEBUFFERPOOL_H
@@ -0,0 +1,432 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "frameindex.h"
+
+#include <algorithm>
+#include <cstring>
+#include <QDebug>
+#include <QMap>
+#include <QMutex>
+
+#include "common/filefunctions.h"
+#include "project/item/footage/footage.h"
+
+namespace {
+
+const char kMagic[4] = {'O', 'I', 'D', 'X'};
+
+/**
+ * @brief The uniform layout is used when at most one in this many frames is off the grid or isn't a keyframe
+ */
+const int kUniformExceptionRatio = 16;
+
+/**
+ * @brief All indexes currently loaded in this process
+ */
+QMap<QString, std::weak_ptr<FrameIndex> > loaded_indexes;
+QMutex loaded_indexes_lock;
+
+}
+
+FrameIndex::FrameIndex() :
+  map_(nullptr),
+  header_(nullptr),
+  pts_(nullptr),
+  pos_(nullptr),
+  keyframes_(nullptr),
+  uniform_(nullptr),
+  pts_exceptions_(nullptr),
+  non_keyframes_(nullptr),
+  memory_tracker_(MemoryStats::kFrameIndexes)
+{
+}
+
+FrameIndex::~FrameIndex()
+{
+  if (map_ != nullptr) {
+    file_.unmap(map_);
+  }
+
+  file_.close();
+}
+
+FrameIndexPtr FrameIndex::Load(const QString &filename)
+{
+  QMutexLocker locker(&loaded_indexes_lock);
+
+  // See if this index is already loaded somewhere
+  FrameIndexPtr existing = loaded_indexes.value(filename).lock();
+
+  if (existing != nullptr) {
+    return existing;
+  }
+
+  FrameIndexPtr index(new FrameIndex());
+
+  index->file_.setFileName(filename);
+
+  if (!index->file_.open(QFile::ReadOnly)) {
+    return nullptr;
+  }
+
+  qint64 file_size = index->file_.size();
+
+  if (file_size < static_cast<qint64>(sizeof(Header))) {
+    return nullptr;
+  }
+
+  index->map_ = index->file_.map(0, file_size);
+
+  if (index->map_ == nullptr) {
+    qWarning() << "Failed to map index" << filename;
+    return nullptr;
+  }
+
+  index->memory_tracker_.SetBytes(file_size);
+
+  index->header_ = reinterpret_cast<const Header*>(index->map_);
+
+  // Validate header
+  if (memcmp(index->header_->magic, kMagic, sizeof(kMagic)) != 0
+      || index->header_->version != kVersion
+      || index->header_->frame_count < 0) {
+    return nullptr;
+  }
+
+  int64_t frame_count = index->header_->frame_count;
+
+  if (index->header_->layout == kLayoutExplicit) {
+    qint64 expected_size = static_cast<qint64>(sizeof(Header))
+        + frame_count * static_cast<qint64>(sizeof(int64_t)) * 2
+        + (frame_count + 7) / 8;
+
+    if (file_size < expected_size) {
+      return nullptr;
+    }
+
+    index->pts_ = reinterpret_cast<const int64_t*>(index->map_ + sizeof(Header));
+    index->pos_ = index->pts_ + frame_count;
+    index->keyframes_ = reinterpret_cast<const uint8_t*>(index->pos_ + frame_count);
+  } else if (index->header_->layout == kLayoutUniform) {
+    if (file_size < static_cast<qint64>(sizeof(Header) + sizeof(UniformHeader))) {
+      return nullptr;
+    }
+
+    index->uniform_ = reinterpret_cast<const UniformHeader*>(index->map_ + sizeof(Header));
+
+    if (index->uniform_->step <= 0
+        || index->uniform_->pts_exception_count < 0
+        || index->uniform_->non_keyframe_count < 0) {
+      return nullptr;
+    }
+
+    qint64 expected_size = static_cast<qint64>(sizeof(Header) + sizeof(UniformHeader))
+        + (index->uniform_->pts_exception_count * 2 + index->uniform_->non_keyframe_count)
+        * static_cast<qint64>(sizeof(int64_t));
+
+    if (file_size < expected_size) {
+      return nullptr;
+    }
+
+    index->pts_exceptions_ = reinterpret_cast<const int64_t*>(index->uniform_ + 1);
+    index->non_keyframes_ = index->pts_exceptions_ + index->uniform_->pts_exception_count * 2;
+  } else {
+    return nullptr;
+  }
+
+  loaded_indexes.insert(filename, index);
+
+  return index;
+}
+
+QString FrameIndex::GetFilename(Stream *stream)
+{
+  return GetMediaIndexFilename(GetUniqueFileIdentifier(stream->footage()->filename()))
+      .append(QString::number(stream->index()));
+}
+
+bool FrameIndex::Save(const QString &filename,
+                      const QVector<FrameIndex::Entry> &entries,
+                      const int &stream_index,
+                      const rational &timebase)
+{
+  Header header;
+
+  if (entries.size() >= 2) {
+    UniformHeader uniform;
+    uniform.start_pts = entries.first().pts;
+    uniform.step = entries.at(1).pts - uniform.start_pts;
+
+    if (uniform.step > 0) {
+      QVector<int64_t> pts_exceptions;
+      QVector<int64_t> non_keyframes;
+
+      for (int i=0;i<entries.size();i++) {
+        if (entries.at(i).pts != uniform.start_pts + i * uniform.step) {
+          pts_exceptions.append(i);
+          pts_exceptions.append(entries.at(i).pts);
+        }
+
+        if (!entries.at(i).keyframe) {
+          non_keyframes.append(i);
+        }
+      }
+
+      if ((pts_exceptions.size() / 2 + non_keyframes.size()) * kUniformExceptionRatio <= entries.size()) {
+        uniform.pts_exception_count = pts_exceptions.size() / 2;
+        uniform.non_keyframe_count = non_keyframes.size();
+
+        FillHeader(&header, kLayoutUniform, stream_index, timebase, entries.size());
+
+        return WriteUniform(filename, header, uniform, pts_exceptions, non_keyframes);
+      }
+    }
+  }
+
+  QFile f(filename);
+
+  if (!f.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  FillHeader(&header, kLayoutExplicit, stream_index, timebase, entries.size());
+
+  QVector<int64_t> pts(entries.size());
+  QVector<int64_t> pos(entries.size());
+  QByteArray keyframes((entries.size() + 7) / 8, 0);
+
+  for (int i=0;i<entries.size();i++) {
+    pts[i] = entries.at(i).pts;
+    pos[i] = entries.at(i).pos;
+
+    if (entries.at(i).keyframe) {
+      keyframes[i / 8] = static_cast<char>(keyframes.at(i / 8) | (1 << (i % 8)));
+    }
+  }
+
+  f.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  f.write(reinterpret_cast<const char*>(pts.constData()), static_cast<qint64>(sizeof(int64_t)) * pts.size());
+  f.write(reinterpret_cast<const char*>(pos.constData()), static_cast<qint64>(sizeof(int64_t)) * pos.size());
+  f.write(keyframes);
+
+  f.close();
+
+  return true;
+}
+
+bool FrameIndex::SaveUniform(const QString &filename,
+                             const int &stream_index,
+                             const rational &timebase,
+                             const int64_t &start_pts,
+                             const int64_t &step,
+                             const int64_t &count)
+{
+  Header header;
+  FillHeader(&header, kLayoutUniform, stream_index, timebase, count);
+
+  UniformHeader uniform;
+  uniform.start_pts = start_pts;
+  uniform.step = step;
+  uniform.pts_exception_count = 0;
+  uniform.non_keyframe_count = 0;
+
+  return WriteUniform(filename, header, uniform, QVector<int64_t>(), QVector<int64_t>());
+}
+
+void FrameIndex::FillHeader(FrameIndex::Header *header,
+                            FrameIndex::Layout layout,
+                            int stream_index,
+                            const rational &timebase,
+                            int64_t count)
+{
+  memcpy(header->magic, kMagic, sizeof(kMagic));
+  header->version = kVersion;
+  header->stream_index = stream_index;
+  header->timebase_num = static_cast<int32_t>(timebase.numerator());
+  header->timebase_den = static_cast<int32_t>(timebase.denominator());
+  header->layout = layout;
+  header->frame_count = count;
+}
+
+bool FrameIndex::WriteUniform(const QString &filename,
+                              const FrameIndex::Header &header,
+                              const FrameIndex::UniformHeader &uniform,
+                              const QVector<int64_t> &pts_exceptions,
+                              const QVector<int64_t> &non_keyframes)
+{
+  QFile f(filename);
+
+  if (!f.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  f.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+  f.write(reinterpret_cast<const char*>(&uniform), sizeof(UniformHeader));
+  f.write(reinterpret_cast<const char*>(pts_exceptions.constData()),
+          static_cast<qint64>(sizeof(int64_t)) * pts_exceptions.size());
+  f.write(reinterpret_cast<const char*>(non_keyframes.constData()),
+          static_cast<qint64>(sizeof(int64_t)) * non_keyframes.size());
+
+  f.close();
+
+  return true;
+}
+
+bool FrameIndex::is_uniform() const
+{
+  return (uniform_ != nullptr);
+}
+
+int FrameIndex::count() const
+{
+  return static_cast<int>(header_->frame_count);
+}
+
+int FrameIndex::stream_index() const
+{
+  return header_->stream_index;
+}
+
+rational FrameIndex::timebase() const
+{
+  return rational(header_->timebase_num, header_->timebase_den);
+}
+
+int64_t FrameIndex::pts(int i) const
+{
+  if (is_uniform()) {
+    // Exceptions are (frame, pts) pairs sorted by frame
+    int64_t lo = 0;
+    int64_t hi = uniform_->pts_exception_count;
+
+    while (lo < hi) {
+      int64_t mid = (lo + hi) / 2;
+
+      if (pts_exceptions_[mid * 2] < i) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+
+    if (lo < uniform_->pts_exception_count && pts_exceptions_[lo * 2] == i) {
+      return pts_exceptions_[lo * 2 + 1];
+    }
+
+    return uniform_->start_pts + i * uniform_->step;
+  }
+
+  return pts_[i];
+}
+
+int64_t FrameIndex::pos(int i) const
+{
+  if (is_uniform()) {
+    return -1;
+  }
+
+  return pos_[i];
+}
+
+bool FrameIndex::keyframe(int i) const
+{
+  if (is_uniform()) {
+    return !std::binary_search(non_keyframes_, non_keyframes_ + uniform_->non_keyframe_count, static_cast<int64_t>(i));
+  }
+
+  return (keyframes_[i / 8] & (1 << (i % 8)));
+}
+
+FrameIndex::Entry FrameIndex::entry(int i) const
+{
+  Entry e;
+  e.pts = pts(i);
+  e.pos = pos(i);
+  e.keyframe = keyframe(i);
+  return e;
+}
+
+QVector<FrameIndex::Entry> FrameIndex::ToEntries() const
+{
+  QVector<Entry> entries(count());
+
+  for (int i=0;i<entries.size();i++) {
+    entries[i] = entry(i);
+  }
+
+  return entries;
+}
+
+int FrameIndex::GetClosestEntry(const int64_t &ts) const
+{
+  if (count() == 0) {
+    return -1;
+  }
+
+  if (is_uniform()) {
+    int64_t i = (ts <= uniform_->start_pts) ? 0 : (ts - uniform_->start_pts) / uniform_->step;
+
+    i = qMin(i, static_cast<int64_t>(count() - 1));
+
+    // Frames off the grid can move the answer by a frame or so either way
+    while (i + 1 < count() && pts(static_cast<int>(i + 1)) <= ts) {
+      i++;
+    }
+
+    while (i > 0 && pts(static_cast<int>(i)) > ts) {
+      i--;
+    }
+
+    return static_cast<int>(i);
+  }
+
+  // Find the first entry that comes after this timestamp, the entry before it is the one showing at `ts`
+  const int64_t* it = std::upper_bound(pts_, pts_ + count(), ts);
+
+  if (it == pts_) {
+    return 0;
+  }
+
+  return static_cast<int>(it - pts_) - 1;
+}
+
+int FrameIndex::GetKeyframeBefore(int entry) const
+{
+  // Walk back to the closest keyframe, GOPs are short enough that this doesn't need to be smarter
+  while (entry > 0 && !keyframe(entry)) {
+    entry--;
+  }
+
+  return qMax(entry, 0);
+}
+
+int64_t FrameIndex::GetTimestampFromTime(const rational &time, bool keyframe) const
+{
+  int64_t ts = qRound64(time.toDouble() * timebase().flipped().toDouble());
+
+  ts = (ts <= 0) ? 0 : pts(GetClosestEntry(ts));
+
+  if (keyframe) {
+    ts = pts(GetKeyframeBefore(GetClosestEntry(ts)));
+  }
+
+  return ts;
+}
@@ -0,0 +1,221 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FRAMEINDEX_H
+#define FRAMEINDEX_H
+
+#include <memory>
+#include <QFile>
+#include <QVector>
+#include <stdint.h>
+
+#include "common/memorystats.h"
+#include "common/rational.h"
+
+class FrameIndex;
+class Stream;
+using FrameIndexPtr = std::shared_ptr<FrameIndex>;
+
+/**
+ * @brief A read-only, memory-mapped index of every frame in a media stream
+ *
+ * Indexes are stored on disk in a versioned format, starting with a Header (magic, version, stream parameters, layout
+ * and frame count). Most indexes use the explicit layout:
+ *
+ * - `frame_count` int64 presentation timestamps (sorted ascending)
+ * - `frame_count` int64 packet byte positions (-1 if unknown)
+ * - A keyframe bitmap of `(frame_count + 7) / 8` bytes
+ *
+ * Streams whose timestamps are evenly spaced and whose frames are nearly all keyframes (constant frame rate intra
+ * codecs like ProRes and DNxHR) use the uniform layout instead, which describes timestamps arithmetically and only
+ * lists the frames that don't fit:
+ *
+ * - A UniformHeader (first timestamp, spacing, and the lengths of the following lists)
+ * - `pts_exception_count` pairs of int64 (frame, timestamp) for frames off the grid, sorted by frame
+ * - `non_keyframe_count` int64 frame numbers that aren't keyframes, sorted
+ *
+ * Uniform indexes are a few dozen bytes no matter how long the stream is and look frames up in constant time, but
+ * don't store byte positions.
+ *
+ * The file is mapped into memory and used in place, so loading an index is effectively instant regardless of its
+ * length. Indexes are shared: every call to Load() for the same file returns the same instance while it's still in
+ * use anywhere in the process.
+ *
+ * This class is thread-safe since it's immutable after loading.
+ */
+class FrameIndex
+{
+public:
+  /**
+   * @brief A single frame, used for building indexes and seeking
+   */
+  struct Entry {
+    int64_t pts;
+    int64_t pos;
+    bool keyframe;
+  };
+
+  /**
+   * @brief Version of the on-disk layout, bump this whenever it changes so that stale indexes aren't misread
+   */
+  static const uint32_t kVersion = 4;
+
+  ~FrameIndex();
+
+  FrameIndex(const FrameIndex& other) = delete;
+  FrameIndex(FrameIndex&& other) = delete;
+  FrameIndex& operator=(const FrameIndex& other) = delete;
+  FrameIndex& operator=(FrameIndex&& other) = delete;
+
+  /**
+   * @brief Load (or retrieve the already loaded) index at `filename`
+   *
+   * @return
+   *
+   * The index, or nullptr if the file doesn't exist or isn't a valid index of the current version.
+   */
+  static FrameIndexPtr Load(const QString& filename);
+
+  /**
+   * @brief Returns the filename the index of a stream is stored at
+   */
+  static QString GetFilename(Stream* stream);
+
+  /**
+   * @brief Write an index to `filename`
+   *
+   * Uses the uniform layout if the entries fit it well enough, the explicit layout otherwise.
+   *
+   * @param entries
+   *
+   * Frames to write, must already be sorted by pts.
+   */
+  static bool Save(const QString& filename,
+                   const QVector<Entry>& entries,
+                   const int& stream_index,
+                   const rational& timebase);
+
+  /**
+   * @brief Write a uniform index of `count` keyframes at `start_pts`, `start_pts + step`, etc. to `filename`
+   *
+   * For when a stream is known to be uniform without reading every packet.
+   */
+  static bool SaveUniform(const QString& filename,
+                          const int& stream_index,
+                          const rational& timebase,
+                          const int64_t& start_pts,
+                          const int64_t& step,
+                          const int64_t& count);
+
+  int count() const;
+
+  int stream_index() const;
+
+  rational timebase() const;
+
+  int64_t pts(int i) const;
+
+  int64_t pos(int i) const;
+
+  bool keyframe(int i) const;
+
+  Entry entry(int i) const;
+
+  /**
+   * @brief Copy the index into a list of entries (e.g. to continue building a partial index)
+   */
+  QVector<Entry> ToEntries() const;
+
+  /**
+   * @brief Returns the index of the frame that is showing at timestamp `ts` (O(log n))
+   */
+  int GetClosestEntry(const int64_t& ts) const;
+
+  /**
+   * @brief Returns the index of the closest keyframe at or before `entry`
+   */
+  int GetKeyframeBefore(int entry) const;
+
+  /**
+   * @brief Returns the timestamp of the frame showing at `time`, the same as FFmpegDecoder::GetTimestampFromTime()
+   *
+   * @param keyframe
+   *
+   * Return the timestamp of the keyframe at or before that frame instead (see Decoder::keyframes_only()).
+   */
+  int64_t GetTimestampFromTime(const rational& time, bool keyframe) const;
+
+private:
+  enum Layout {
+    kLayoutExplicit,
+    kLayoutUniform
+  };
+
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    int32_t stream_index;
+    int32_t timebase_num;
+    int32_t timebase_den;
+    int32_t layout;
+    int64_t frame_count;
+  };
+
+  struct UniformHeader {
+    int64_t start_pts;
+    int64_t step;
+    int64_t pts_exception_count;
+    int64_t non_keyframe_count;
+  };
+
+  FrameIndex();
+
+  static void FillHeader(Header* header, Layout layout, int stream_index, const rational& timebase, int64_t count);
+
+  static bool WriteUniform(const QString& filename,
+                           const Header& header,
+                           const UniformHeader& uniform,
+                           const QVector<int64_t>& pts_exceptions,
+                           const QVector<int64_t>& non_keyframes);
+
+  bool is_uniform() const;
+
+  QFile file_;
+
+  uchar* map_;
+
+  const Header* header_;
+
+  const int64_t* pts_;
+
+  const int64_t* pos_;
+
+  const uint8_t* keyframes_;
+
+  /// Uniform layout only
+  const UniformHeader* uniform_;
+  const int64_t* pts_exceptions_;
+  const int64_t* non_keyframes_;
+
+  MemoryTracker memory_tracker_;
+
+};
+
+#endif // FRAMEINDEX_H
@@ -0,0 +1,75 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "frameindexservice.h"
+
+#include "common/filefunctions.h"
+#include "config/config.h"
+#include "project/item/footage/footage.h"
+
+FrameIndexService olive::frame_index_service;
+
+bool FrameIndexService::GetTimestampFromTime(Stream *stream,
+                                             const rational &time,
+                                             bool keyframes_only,
+                                             int64_t *timestamp)
+{
+  // A still image will always return the same frame (see OIIODecoder::GetTimestampFromTime())
+  if (stream->type() == Stream::kImage) {
+    *timestamp = 0;
+    return true;
+  }
+
+  if (stream->type() != Stream::kVideo) {
+    return false;
+  }
+
+  FrameIndexPtr index = GetIndex(stream);
+
+  if (index == nullptr || index->count() == 0) {
+    return false;
+  }
+
+  *timestamp = index->GetTimestampFromTime(time, keyframes_only);
+
+  return true;
+}
+
+FrameIndexPtr FrameIndexService::GetIndex(Stream *stream)
+{
+  QString key = QStringLiteral("%1:%2").arg(QString::number(stream->index()), stream->footage()->filename());
+
+  QMutexLocker locker(&lock_);
+
+  Index& index = indexes_[key];
+
+  if (index.index == nullptr
+      && (!index.last_check.isValid() || index.last_check.elapsed() >= kIndexRecheckInterval)) {
+    index.last_check.start();
+
+    // The same filename FFmpegDecoder indexes to (see FFmpegDecoder::GetIndexFilename())
+    QString file_id = GetUniqueFileIdentifier(stream->footage()->filename());
+
+    if (!file_id.isEmpty()) {
+      index.index = FrameIndex::Load(GetMediaIndexFilename(file_id).append(QString::number(stream->index())));
+    }
+  }
+
+  return index.index;
+}
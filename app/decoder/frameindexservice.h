@@ -0,0 +1,84 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef FRAMEINDEXSERVICE_H
+#define FRAMEINDEXSERVICE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+
+#include "decoder/frameindex.h"
+#include "project/item/footage/stream.h"
+
+/**
+ * @brief Resolves which frame of a stream shows at a given time without opening a Decoder
+ *
+ * Hashing a frame only needs its timestamp, which a Decoder can only provide after opening the file (and possibly
+ * indexing it). This service answers from the stream's memory-mapped FrameIndex instead, so checking whether a frame
+ * is already cached never touches the media file. Indexes are shared with the decoders using them (see
+ * FrameIndex::Load()) and are looked for again periodically while they don't exist yet (e.g. while an IndexTask is
+ * still building one).
+ *
+ * This class is thread-safe.
+ */
+class FrameIndexService
+{
+public:
+  FrameIndexService() = default;
+
+  /**
+   * @brief Find the timestamp of the frame showing at `time`, as Decoder::GetTimestampFromTime() would
+   *
+   * @param keyframes_only
+   *
+   * Whether the decoder would be retrieving only keyframes (see Decoder::keyframes_only()).
+   *
+   * @return
+   *
+   * TRUE if `timestamp` was set. FALSE if it can't be resolved without a Decoder (e.g. the stream hasn't been indexed
+   * yet, or isn't indexed at all like image sequences).
+   */
+  bool GetTimestampFromTime(Stream* stream, const rational& time, bool keyframes_only, int64_t* timestamp);
+
+private:
+  struct Index {
+    FrameIndexPtr index;
+    QElapsedTimer last_check;
+  };
+
+  /**
+   * @brief Returns the index of the stream, loading it if it's time to look for it again
+   */
+  FrameIndexPtr GetIndex(Stream* stream);
+
+  /**
+   * @brief Indexes keyed by footage filename and stream index
+   */
+  QHash<QString, Index> indexes_;
+
+  QMutex lock_;
+
+};
+
+namespace olive {
+extern FrameIndexService frame_index_service;
+}
+
+#endif // FRAMEINDEXSERVICE_H
@@ -0,0 +1,165 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "imagesequence.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QSet>
+#include <QStringList>
+
+ImageSequence::ImageSequence() :
+  padding_(0),
+  first_(0),
+  last_(-1)
+{
+}
+
+bool ImageSequence::Detect(const QString &filename, ImageSequence *seq)
+{
+  QFileInfo info(filename);
+
+  QString prefix, number, suffix;
+
+  if (!Split(info.fileName(), &prefix, &number, &suffix)) {
+    return false;
+  }
+
+  QDir dir = info.absoluteDir();
+
+  seq->prefix_ = dir.filePath(prefix);
+  seq->suffix_ = suffix;
+  seq->padding_ = number.size();
+
+  int64_t frame = number.toLongLong();
+
+  // Collect every frame number in the directory that belongs to this sequence
+  QStringList filters;
+  filters.append(QStringLiteral("%1*%2").arg(prefix, suffix));
+
+  QStringList entries = dir.entryList(filters, QDir::Files);
+
+  QSet<int64_t> frames;
+
+  foreach (const QString& entry, entries) {
+    QString entry_prefix, entry_number, entry_suffix;
+
+    if (Split(entry, &entry_prefix, &entry_number, &entry_suffix)
+        && entry_prefix == prefix
+        && entry_suffix == suffix) {
+      int64_t entry_frame = entry_number.toLongLong();
+
+      // Make sure this isn't a differently padded file (e.g. "plate.1.exr" alongside "plate.0001.exr")
+      if (QFileInfo(seq->GetFilename(entry_frame)).fileName() == entry) {
+        frames.insert(entry_frame);
+      }
+    }
+  }
+
+  // Expand outwards from the file we were given to find the contiguous range it's in
+  seq->first_ = frame;
+  seq->last_ = frame;
+
+  while (frames.contains(seq->first_ - 1)) {
+    seq->first_--;
+  }
+
+  while (frames.contains(seq->last_ + 1)) {
+    seq->last_++;
+  }
+
+  return true;
+}
+
+QString ImageSequence::GetFilename(const int64_t &frame) const
+{
+  return QStringLiteral("%1%2%3").arg(prefix_, QStringLiteral("%1").arg(frame, padding_, 10, QChar('0')), suffix_);
+}
+
+QString ImageSequence::GetDisplayName() const
+{
+  QString first = QStringLiteral("%1").arg(first_, padding_, 10, QChar('0'));
+  QString last = QStringLiteral("%1").arg(last_, padding_, 10, QChar('0'));
+
+  return QStringLiteral("%1[%2-%3]%4").arg(QFileInfo(prefix_).fileName(), first, last, suffix_);
+}
+
+bool ImageSequence::Contains(const QString &filename) const
+{
+  QFileInfo info(filename);
+
+  QString prefix, number, suffix;
+
+  if (!Split(info.fileName(), &prefix, &number, &suffix)
+      || info.absoluteDir().filePath(prefix) != prefix_
+      || suffix != suffix_) {
+    return false;
+  }
+
+  int64_t frame = number.toLongLong();
+
+  return (frame >= first_ && frame <= last_ && GetFilename(frame) == info.absoluteFilePath());
+}
+
+const int64_t &ImageSequence::first() const
+{
+  return first_;
+}
+
+const int64_t &ImageSequence::last() const
+{
+  return last_;
+}
+
+int64_t ImageSequence::count() const
+{
+  return last_ - first_ + 1;
+}
+
+bool ImageSequence::Split(const QString &filename, QString *prefix, QString *number, QString *suffix)
+{
+  // The extension is taken off first since it can contain digits itself (e.g. ".jp2" or ".j2k"), unless it's all
+  // digits, in which case it's the frame number of a sequence without an extension (e.g. "plate.0001")
+  static const QRegularExpression digits(QStringLiteral("^\\d+$"));
+
+  QString extension = QFileInfo(filename).suffix();
+
+  if (digits.match(extension).hasMatch()) {
+    extension.clear();
+  }
+
+  QString base_name = extension.isEmpty() ? filename : filename.left(filename.size() - extension.size() - 1);
+
+  // The last run of digits of what's left, e.g. "plate." "0001"
+  static const QRegularExpression regex(QStringLiteral("^(.*?)(\\d+)$"));
+
+  QRegularExpressionMatch match = regex.match(base_name);
+
+  if (!match.hasMatch()) {
+    return false;
+  }
+
+  *prefix = match.captured(1);
+  *number = match.captured(2);
+  *suffix = extension.isEmpty() ? QString() : QStringLiteral(".%1").arg(extension);
+
+  return true;
+}
@@ -0,0 +1,92 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef IMAGESEQUENCE_H
+#define IMAGESEQUENCE_H
+
+#include <QString>
+#include <stdint.h>
+
+/**
+ * @brief A range of numbered image files (e.g. "plate.0001.exr" to "plate.0250.exr") that make up a single clip
+ *
+ * Frame numbers are the numbers in the filenames, so the first frame of a sequence isn't necessarily 0 or 1.
+ */
+class ImageSequence
+{
+public:
+  ImageSequence();
+
+  /**
+   * @brief Find the sequence a file belongs to
+   *
+   * Looks for a number at the end of the filename (before the extension) and scans the file's directory for the
+   * contiguous range of files around it with the same name apart from the number.
+   *
+   * @return
+   *
+   * TRUE if the filename is numbered and `seq` was filled. A numbered file with no neighbors is still a sequence, just
+   * with a count() of 1.
+   */
+  static bool Detect(const QString& filename, ImageSequence* seq);
+
+  /**
+   * @brief Returns the filename of a frame in this sequence
+   */
+  QString GetFilename(const int64_t& frame) const;
+
+  /**
+   * @brief Returns a name for the whole sequence suitable for showing to the user (e.g. "plate.[0001-0250].exr")
+   */
+  QString GetDisplayName() const;
+
+  /**
+   * @brief Returns TRUE if this filename is one of the frames in the sequence
+   */
+  bool Contains(const QString& filename) const;
+
+  const int64_t& first() const;
+
+  const int64_t& last() const;
+
+  int64_t count() const;
+
+private:
+  /**
+   * @brief Split a filename into the part before the number, the number, and the part after it
+   */
+  static bool Split(const QString& filename, QString* prefix, QString* number, QString* suffix);
+
+  /// Absolute path of the directory and the part of the filename before the number
+  QString prefix_;
+
+  /// The part of the filename after the number (usually the extension)
+  QString suffix_;
+
+  /// Minimum number of digits in the number (numbers are zero-padded to this)
+  int padding_;
+
+  int64_t first_;
+
+  int64_t last_;
+
+};
+
+#endif // IMAGESEQUENCE_H
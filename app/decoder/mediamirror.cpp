@@ -0,0 +1,171 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "mediamirror.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "common/filefunctions.h"
+#include "config/config.h"
+
+MediaMirror *MediaMirror::Instance()
+{
+  static MediaMirror instance;
+
+  return &instance;
+}
+
+MediaMirror::MediaMirror() :
+  size_(0),
+  use_counter_(0)
+{
+  // Pick up the copies made in previous sessions, oldest first so they're evicted in roughly the order they were made
+  QFileInfoList files = QDir(GetMediaMirrorLocation()).entryInfoList(QDir::Files, QDir::Time | QDir::Reversed);
+
+  foreach (const QFileInfo& info, files) {
+    // Left behind by a copy that never finished
+    if (info.fileName().endsWith(QStringLiteral(".partial"))) {
+      QFile::remove(info.absoluteFilePath());
+      continue;
+    }
+
+    Copy copy;
+    copy.size = info.size();
+    copy.last_used = ++use_counter_;
+
+    copies_.insert(info.fileName(), copy);
+    size_ += copy.size;
+  }
+}
+
+QString MediaMirror::Resolve(const QString &filename)
+{
+  if (!kUseMediaMirror) {
+    return filename;
+  }
+
+  QMutexLocker locker(&lock_);
+
+  QString identifier = sources_.value(filename);
+
+  if (identifier.isEmpty()) {
+    return filename;
+  }
+
+  locker.unlock();
+
+  // The identifier includes the modification time, so this fails if the source has changed since it was copied
+  QString mirror_filename = GetMirrorFilename(identifier);
+
+  bool valid = (GetUniqueFileIdentifier(filename) == identifier && QFileInfo::exists(mirror_filename));
+
+  locker.relock();
+
+  QHash<QString, Copy>::iterator copy = copies_.find(identifier);
+
+  if (!valid || copy == copies_.end()) {
+    // Any outdated copy is left to be evicted
+    sources_.remove(filename);
+    return filename;
+  }
+
+  copy->last_used = ++use_counter_;
+
+  return mirror_filename;
+}
+
+bool MediaMirror::IsMirrored(const QString &filename)
+{
+  QMutexLocker locker(&lock_);
+
+  return sources_.contains(filename);
+}
+
+void MediaMirror::Add(const QString &filename, const QString &identifier, qint64 size)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<QString, Copy>::iterator copy = copies_.find(identifier);
+
+  if (copy == copies_.end()) {
+    Copy new_copy;
+    new_copy.size = size;
+    new_copy.last_used = ++use_counter_;
+
+    copies_.insert(identifier, new_copy);
+    size_ += size;
+  } else {
+    copy->last_used = ++use_counter_;
+  }
+
+  sources_.insert(filename, identifier);
+
+  Trim(identifier);
+}
+
+bool MediaMirror::IsMirrorable(const QString &filename)
+{
+  // URLs can't be copied like files, and image sequences would need every frame copied
+  if (filename.contains(QStringLiteral("://")) || !QFileInfo(filename).isFile()) {
+    return false;
+  }
+
+  return IsRemoteFile(filename);
+}
+
+QString MediaMirror::GetMirrorFilename(const QString &identifier)
+{
+  return QDir(GetMediaMirrorLocation()).filePath(identifier);
+}
+
+void MediaMirror::Trim(const QString &keep)
+{
+  while (size_ > kMediaMirrorSize) {
+    QHash<QString, Copy>::iterator oldest = copies_.end();
+
+    for (QHash<QString, Copy>::iterator i=copies_.begin();i!=copies_.end();i++) {
+      if (i.key() != keep && (oldest == copies_.end() || i->last_used < oldest->last_used)) {
+        oldest = i;
+      }
+    }
+
+    if (oldest == copies_.end()) {
+      break;
+    }
+
+    // If a decoder still has this copy open the delete may fail (e.g. on Windows), either way it's no longer used
+    QFile::remove(GetMirrorFilename(oldest.key()));
+
+    QString identifier = oldest.key();
+
+    size_ -= oldest->size;
+    copies_.erase(oldest);
+
+    for (QHash<QString, QString>::iterator i=sources_.begin();i!=sources_.end();) {
+      if (i.value() == identifier) {
+        i = sources_.erase(i);
+      } else {
+        i++;
+      }
+    }
+  }
+}
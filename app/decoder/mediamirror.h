@@ -0,0 +1,113 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MEDIAMIRROR_H
+#define MEDIAMIRROR_H
+
+#include <QHash>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief Local copies of media files that live on network storage
+ *
+ * Decoding straight from a NAS means every read waits on the network, so decode latency depends on how busy it is.
+ * MirrorTask copies the files used by open sequences to GetMediaMirrorLocation(), and decoders open the copy instead
+ * (see Resolve()) once it's been verified.
+ *
+ * Copies are named by GetUniqueFileIdentifier() of their source, which changes whenever the source is modified, so a
+ * copy is never used in place of a newer file. The least recently used copies are deleted to keep the mirror within
+ * kMediaMirrorSize.
+ */
+class MediaMirror
+{
+public:
+  static MediaMirror* Instance();
+
+  MediaMirror(const MediaMirror& other) = delete;
+  MediaMirror(MediaMirror&& other) = delete;
+  MediaMirror& operator=(const MediaMirror& other) = delete;
+  MediaMirror& operator=(MediaMirror&& other) = delete;
+
+  /**
+   * @brief Returns the filename a decoder should open for `filename`
+   *
+   * This is the local copy if there's one and it still matches the source, otherwise `filename` itself. Only files
+   * added with Add() this session are checked, anything else is returned straight away.
+   */
+  QString Resolve(const QString& filename);
+
+  /**
+   * @brief Returns TRUE if Resolve() has a local copy of this file
+   */
+  bool IsMirrored(const QString& filename);
+
+  /**
+   * @brief Start resolving `filename` to its verified local copy
+   *
+   * Called by MirrorTask once the copy at GetMirrorFilename(identifier) is complete, and evicts older copies if the
+   * mirror is now over kMediaMirrorSize.
+   */
+  void Add(const QString& filename, const QString& identifier, qint64 size);
+
+  /**
+   * @brief Returns TRUE if `filename` is a file on network storage that can be mirrored
+   */
+  static bool IsMirrorable(const QString& filename);
+
+  /**
+   * @brief Get the filename of the local copy of a file with this GetUniqueFileIdentifier()
+   */
+  static QString GetMirrorFilename(const QString& identifier);
+
+private:
+  MediaMirror();
+
+  /**
+   * @brief Delete the least recently used copies (other than `keep`) until the mirror is within kMediaMirrorSize
+   */
+  void Trim(const QString& keep);
+
+  struct Copy {
+    qint64 size;
+
+    /// Value of use_counter_ when this copy was last resolved, lower is less recent
+    quint64 last_used;
+  };
+
+  /**
+   * @brief Copies in the mirror, by identifier
+   */
+  QHash<QString, Copy> copies_;
+
+  /**
+   * @brief Identifiers of the copies of source files added this session, by source filename
+   */
+  QHash<QString, QString> sources_;
+
+  qint64 size_;
+
+  quint64 use_counter_;
+
+  QMutex lock_;
+
+};
+
+#endif // MEDIAMIRROR_H
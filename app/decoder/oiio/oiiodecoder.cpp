@@ -20,14 +20,84 @@
 
 #include "oiiodecoder.h"
 
+#include <cstring>
 #include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QRunnable>
+#include <QtEndian>
 
 #include "common/define.h"
+#include "config/config.h"
+#include "config/performanceprofile.h"
+#include "decoder/mediamirror.h"
+#include "project/item/footage/videostream.h"
+
+/**
+ * @brief Reads one frame of an image sequence on OIIODecoder's thread pool
+ */
+class OIIODecoder::FrameReader : public QRunnable
+{
+public:
+  FrameReader(OIIODecoder* decoder, const int64_t& frame, int divider, bool planar) :
+    decoder_(decoder),
+    frame_(frame),
+    divider_(divider),
+    planar_(planar)
+  {
+  }
+
+  virtual void run() override
+  {
+    QString filename = decoder_->sequence_.GetFilename(frame_);
+
+    FramePtr f;
+
+    if (planar_) {
+      f = decoder_->ReadMappedImage(filename);
+    }
+
+    if (f == nullptr) {
+      f = decoder_->ReadImage(filename, divider_);
+    }
+
+    decoder_->FrameRead(frame_, divider_, planar_, f);
+  }
+
+private:
+  OIIODecoder* decoder_;
+
+  int64_t frame_;
+
+  int divider_;
+
+  bool planar_;
+};
+
+/**
+ * @brief Size of the DPX file header up to and including the first image element's fields that we use
+ */
+const int kDPXHeaderSize = 816;
+
+/**
+ * @brief DPX image element descriptor for interleaved RGB
+ */
+const int kDPXDescriptorRGB = 50;
 
 OIIODecoder::OIIODecoder() :
-  image_(nullptr),
-  frame_(nullptr)
+  frame_(nullptr),
+  frame_divider_(0),
+  cache_divider_(1),
+  cache_planar_(false),
+  cache_size_(0),
+  last_frame_(0)
 {
+  read_pool_.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+OIIODecoder::~OIIODecoder()
+{
+  Close();
 }
 
 QString OIIODecoder::id()
@@ -37,36 +107,66 @@ QString OIIODecoder::id()
 
 bool OIIODecoder::Probe(Footage *f)
 {
-  auto in = OIIO::ImageInput::open(f->filename().toStdString());
+  OIIO::ImageSpec spec;
 
-  if (!in) {
+  if (!ReadSpec(f->filename(), &spec)) {
     return false;
   }
 
   // Get stats for this image and dump them into the Footage file
-  const OIIO::ImageSpec& spec = in->spec();
 
-  ImageStreamPtr image_stream = std::make_shared<ImageStream>();
-  image_stream->set_width(spec.width);
-  image_stream->set_height(spec.height);
-  f->add_stream(image_stream);
+  ImageSequence seq;
 
-  // If we're here, we have a successful image open
-  in->close();
+  if (GetImageSequence(f->filename(), &seq)) {
+    // This is one frame of a sequence, so the Footage is a video of every frame
+    VideoStreamPtr video_stream = std::make_shared<VideoStream>();
+    video_stream->set_width(spec.width);
+    video_stream->set_height(spec.height);
+    video_stream->set_timebase(kDefaultImageSequenceTimebase);
+    video_stream->set_duration(seq.count());
+    f->add_stream(video_stream);
+  } else {
+    ImageStreamPtr image_stream = std::make_shared<ImageStream>();
+    image_stream->set_width(spec.width);
+    image_stream->set_height(spec.height);
+    f->add_stream(image_stream);
+  }
 
   return true;
 }
 
+bool OIIODecoder::SupportsExtension(const QString &extension)
+{
+  static const QSet<QString> extensions = GetReadableExtensions();
+
+  return extensions.contains(extension);
+}
+
 bool OIIODecoder::Open()
 {
-  image_ = OIIO::ImageInput::open(stream()->footage()->filename().toStdString());
+  if (open_) {
+    return true;
+  }
+
+  QString filename = stream()->footage()->filename();
+
+  if (IsSequence() && !ImageSequence::Detect(filename, &sequence_)) {
+    return false;
+  }
+
+  // Stills are read from the local copy of the file if there's one (see MediaMirror)
+  if (!IsSequence()) {
+    filename = MediaMirror::Instance()->Resolve(filename);
+  }
+
+  // Frames are read separately (see ReadImage()), so we only need the spec here
+  OIIO::ImageSpec spec;
 
-  if (!image_) {
+  if (!ReadSpec(filename, &spec)) {
     return false;
   }
 
   // Check if we can work with this pixel format
-  const OIIO::ImageSpec& spec = image_->spec();
 
   width_ = spec.width;
   height_ = spec.height;
@@ -91,6 +191,8 @@ bool OIIODecoder::Open()
 
   pix_fmt_info_ = PixelService::GetPixelFormatInfo(static_cast<olive::PixelFormat>(pix_fmt_));
 
+  open_ = true;
+
   return true;
 }
 
@@ -100,24 +202,15 @@ FramePtr OIIODecoder::Retrieve(const rational &timecode, const rational &length)
     return nullptr;
   }
 
-  Q_UNUSED(timecode)
   Q_UNUSED(length)
 
-  if (frame_ == nullptr) {
-    frame_ = Frame::Create();
-
-    frame_->set_width(width_);
-    frame_->set_height(height_);
-    frame_->set_format(pix_fmt_);
-    frame_->allocate();
-
-    // Use the native format to determine what format OIIO should return
-    // FIXME: Behavior of RGB images as opposed to RGBA?
-    image_->read_image(pix_fmt_info_.oiio_desc, frame_->data());
+  if (IsSequence()) {
+    return RetrieveSequenceFrame(GetTimestampFromTime(timecode));
+  }
 
-    if (!is_rgba_) {
-      PixelService::ConvertRGBtoRGBA(frame_);
-    }
+  if (frame_ == nullptr || frame_divider_ != divider()) {
+    frame_ = ReadImage(MediaMirror::Instance()->Resolve(stream()->footage()->filename()), divider());
+    frame_divider_ = divider();
   }
 
   return frame_;
@@ -125,19 +218,421 @@ FramePtr OIIODecoder::Retrieve(const rational &timecode, const rational &length)
 
 void OIIODecoder::Close()
 {
-  if (image_ != nullptr) {
-    image_->close();
-    image_ = nullptr;
-  }
+  // Wait for any frames still being read
+  read_pool_.clear();
+  read_pool_.waitForDone();
+
+  cache_lock_.lock();
+  cache_.clear();
+  pending_.clear();
+  cache_size_ = 0;
+  last_frame_ = 0;
+  cache_lock_.unlock();
 
   frame_ = nullptr;
+
+  open_ = false;
 }
 
 int64_t OIIODecoder::GetTimestampFromTime(const rational &time)
 {
-  Q_UNUSED(time)
-
   // A still image will always return the same frame
+  if (!IsSequence()) {
+    return 0;
+  }
+
+  if (!open_ && !Open()) {
+    return -1;
+  }
+
+  rational frames = time / stream()->timebase();
+
+  int64_t timestamp = frames.numerator() / frames.denominator();
+
+  return qBound(static_cast<int64_t>(0), timestamp, sequence_.count() - 1);
+}
+
+bool OIIODecoder::GetImageSequence(const QString &filename, ImageSequence *seq)
+{
+  // Check by extension that this is an image format before scanning the directory
+  if (!OIIO::ImageInput::create(filename.toStdString())) {
+    return false;
+  }
+
+  return (ImageSequence::Detect(filename, seq) && seq->count() > 1);
+}
+
+bool OIIODecoder::IsSequence()
+{
+  return (stream()->type() == Stream::kVideo);
+}
+
+OIIO::ImageCache *OIIODecoder::SharedImageCache()
+{
+  static OIIO::ImageCache* cache = []() {
+    OIIO::ImageCache* c = OIIO::ImageCache::create(true);
+
+    c->attribute("max_memory_MB", static_cast<float>(kOIIOImageCacheSizeMB));
+    c->attribute("max_open_files", kOIIOImageCacheMaxOpenFiles);
+    c->attribute("autotile", kOIIOImageCacheAutoTile);
+    c->attribute("automip", 1);
+
+    return c;
+  }();
+
+  return cache;
+}
+
+bool OIIODecoder::ReadSpec(const QString &filename, OIIO::ImageSpec *spec)
+{
+  if (kUseOIIOImageCache) {
+    // The file's own pixel format rather than whatever the cache stores it as
+    return SharedImageCache()->get_imagespec(OIIO::ustring(filename.toStdString()), *spec, 0, 0, true);
+  }
+
+  auto in = OIIO::ImageInput::open(filename.toStdString());
+
+  if (!in) {
+    return false;
+  }
+
+  *spec = in->spec();
+
+  in->close();
+
+  return true;
+}
+
+FramePtr OIIODecoder::ReadImage(const QString &filename, int divider)
+{
+  if (kUseOIIOImageCache) {
+    return ReadCachedImage(filename, divider);
+  }
+
+  auto in = OIIO::ImageInput::open(filename.toStdString());
+
+  if (!in) {
+    qWarning() << "Failed to open image" << filename;
+    return nullptr;
+  }
+
+  // Find the smallest MIP level that's still large enough, each one is usually half the size of the last. Images
+  // without MIP levels only have level 0 so this does nothing for them.
+  if (divider > 1) {
+    int full_width = in->spec().width;
+    int miplevel = 0;
+
+    while (in->seek_subimage(0, miplevel + 1) && in->spec().width * divider >= full_width) {
+      miplevel++;
+    }
+
+    in->seek_subimage(0, miplevel);
+  }
+
+  const OIIO::ImageSpec& spec = in->spec();
+
+  FramePtr frame = Frame::Create();
+
+  frame->set_width(spec.width);
+  frame->set_height(spec.height);
+  frame->set_format(pix_fmt_);
+  frame->allocate();
+
+  // Use the native format to determine what format OIIO should return. RGB images are read straight into the RGBA
+  // pixels by striding over the alpha channel, which then only needs filling in.
+  in->read_image(pix_fmt_info_.oiio_desc,
+                 frame->data(),
+                 PixelService::BytesPerPixel(static_cast<olive::PixelFormat>(pix_fmt_)),
+                 frame->linesize());
+
+  in->close();
+
+  if (!is_rgba_) {
+    PixelService::FillAlpha(frame);
+  }
+
+  return frame;
+}
+
+FramePtr OIIODecoder::ReadCachedImage(const QString &filename, int divider)
+{
+  OIIO::ImageCache* cache = SharedImageCache();
+
+  OIIO::ustring name(filename.toStdString());
+
+  OIIO::ImageSpec spec;
+
+  if (!cache->get_imagespec(name, spec)) {
+    qWarning() << "Failed to open image" << filename << QString::fromStdString(cache->geterror());
+    return nullptr;
+  }
+
+  // Same as ReadImage(), except that automip gives every image MIP levels to choose from
+  int miplevel = 0;
+
+  if (divider > 1) {
+    int miplevels = 1;
+    cache->get_image_info(name, 0, 0, OIIO::ustring("miplevels"), OIIO::TypeDesc::INT, &miplevels);
+
+    int full_width = spec.width;
+    OIIO::ImageSpec level_spec;
+
+    while (miplevel + 1 < miplevels
+           && cache->get_imagespec(name, level_spec, 0, miplevel + 1)
+           && level_spec.width * divider >= full_width) {
+      miplevel++;
+      spec = level_spec;
+    }
+  }
+
+  FramePtr frame = Frame::Create();
+
+  frame->set_width(spec.width);
+  frame->set_height(spec.height);
+  frame->set_format(pix_fmt_);
+  frame->allocate();
+
+  // RGB images stride over the alpha channel the same way as in ReadImage()
+  if (!cache->get_pixels(name,
+                         0,
+                         miplevel,
+                         spec.x, spec.x + spec.width,
+                         spec.y, spec.y + spec.height,
+                         0, 1,
+                         0, qMin(spec.nchannels, kRGBAChannels),
+                         pix_fmt_info_.oiio_desc,
+                         frame->data(),
+                         PixelService::BytesPerPixel(static_cast<olive::PixelFormat>(pix_fmt_)),
+                         frame->linesize())) {
+    qWarning() << "Failed to read image" << filename << QString::fromStdString(cache->geterror());
+    return nullptr;
+  }
+
+  if (!is_rgba_) {
+    PixelService::FillAlpha(frame);
+  }
+
+  return frame;
+}
+
+FramePtr OIIODecoder::ReadMappedImage(const QString &filename)
+{
+  if (QFileInfo(filename).suffix().compare(QStringLiteral("dpx"), Qt::CaseInsensitive) != 0) {
+    return nullptr;
+  }
+
+  std::shared_ptr<QFile> file = std::make_shared<QFile>(filename);
+
+  if (!file->open(QFile::ReadOnly) || file->size() < kDPXHeaderSize) {
+    return nullptr;
+  }
+
+  // The mapping lasts until the file is closed, i.e. when the last frame referencing it is destroyed
+  const uchar* data = file->map(0, file->size());
+
+  if (data == nullptr) {
+    return nullptr;
+  }
+
+  // The magic number tells us the byte order of the header and of the pixel data
+  bool big_endian;
+
+  if (memcmp(data, "SDPX", 4) == 0) {
+    big_endian = true;
+  } else if (memcmp(data, "XPDS", 4) == 0) {
+    big_endian = false;
+  } else {
+    return nullptr;
+  }
+
+  auto read_u16 = [data, big_endian](int offset) {
+    return big_endian ? qFromBigEndian<quint16>(data + offset) : qFromLittleEndian<quint16>(data + offset);
+  };
+
+  auto read_u32 = [data, big_endian](int offset) {
+    return big_endian ? qFromBigEndian<quint32>(data + offset) : qFromLittleEndian<quint32>(data + offset);
+  };
+
+  quint16 orientation = read_u16(768);
+  quint32 width = read_u32(772);
+  quint32 height = read_u32(776);
+  quint8 descriptor = data[800];
+  quint8 bit_size = data[803];
+  quint16 packing = read_u16(804);
+  quint16 encoding = read_u16(806);
+  quint32 data_offset = read_u32(808);
+  quint32 eol_padding = read_u32(812);
+
+  // Only top-to-bottom, unpadded, uncompressed 10-bit RGB "filled method A" (three samples in the high 30 bits of each
+  // 32-bit word) can be handed to the GPU as-is, anything else is left to OIIO
+  if (read_u16(770) < 1
+      || orientation != 0
+      || descriptor != kDPXDescriptorRGB
+      || bit_size != 10
+      || packing != 1
+      || encoding != 0
+      || (eol_padding != 0 && eol_padding != 0xFFFFFFFF)
+      || static_cast<int>(width) != width_
+      || static_cast<int>(height) != height_) {
+    return nullptr;
+  }
+
+  // Older writers leave the element's offset unset and rely on the file header's one
+  if (data_offset == 0 || data_offset == 0xFFFFFFFF) {
+    data_offset = read_u32(4);
+  }
+
+  int linesize = width_ * 4;
+
+  if (static_cast<qint64>(data_offset) + static_cast<qint64>(linesize) * height_ > file->size()) {
+    return nullptr;
+  }
+
+  FramePtr frame = Frame::Create();
+
+  frame->set_width(width_);
+  frame->set_height(height_);
+  frame->set_format(pix_fmt_);
+
+  uint8_t* planes[] = {const_cast<uint8_t*>(data + data_offset)};
+
+  frame->wrap(1, planes, &linesize, file);
+
+  olive::YUVInfo info;
+  info.layout = olive::YUV_LAYOUT_PACKED_RGB10;
+  info.bit_depth = 10;
+  info.full_range = true;
+  info.big_endian = big_endian;
+  frame->set_yuv_info(info);
+
+  return frame;
+}
+
+FramePtr OIIODecoder::RetrieveSequenceFrame(const int64_t &timestamp)
+{
+  if (timestamp < 0) {
+    return nullptr;
+  }
+
+  int64_t frame = sequence_.first() + timestamp;
+
+  QMutexLocker locker(&cache_lock_);
+
+  // Frames read at a different resolution are no use anymore, nor are packed frames once planar output isn't allowed
+  if (cache_divider_ != divider() || cache_planar_ != planar_output_allowed()) {
+    cache_.clear();
+    cache_size_ = 0;
+    cache_divider_ = divider();
+    cache_planar_ = planar_output_allowed();
+  }
+
+  // Read ahead in whichever direction we're going
+  int direction = (frame >= last_frame_) ? 1 : -1;
+
+  last_frame_ = frame;
+
+  QueueReads(frame, direction);
+
+  // Wait for the frame we need to be read
+  while (!cache_.contains(frame) && pending_.value(frame, 0) == cache_divider_) {
+    cache_cond_.wait(&cache_lock_);
+  }
+
+  // The playhead moved, so different frames may be furthest away now
+  EvictCache();
+
+  return cache_.value(frame);
+}
+
+void OIIODecoder::QueueReads(const int64_t &frame, int direction)
+{
+  int lookahead = olive::performance_profile.values().image_sequence_lookahead;
+
+  for (int i=0;i<=lookahead;i++) {
+    int64_t f = frame + i * direction;
+
+    if (f < sequence_.first() || f > sequence_.last()) {
+      break;
+    }
+
+    // Frames being read at an old divider will be thrown away, so they need reading again
+    if (!cache_.contains(f) && pending_.value(f, 0) != cache_divider_) {
+      pending_.insert(f, cache_divider_);
+
+      // Frames closer to the playhead are more urgent
+      read_pool_.start(new FrameReader(this, f, cache_divider_, cache_planar_), lookahead - i);
+    }
+  }
+}
+
+void OIIODecoder::FrameRead(const int64_t &frame, int divider, bool planar, FramePtr f)
+{
+  QMutexLocker locker(&cache_lock_);
+
+  // This frame may have been queued again at a different divider since we started reading it
+  if (pending_.value(frame, 0) == divider) {
+    pending_.remove(frame);
+  }
+
+  // Ignore frames that were read for a divider we're no longer using (or were read twice)
+  if (f != nullptr && divider == cache_divider_ && planar == cache_planar_ && !cache_.contains(frame)) {
+    int64_t timestamp = frame - sequence_.first();
+
+    f->set_timestamp(rational(timestamp) * stream()->timebase());
+    f->set_native_timestamp(timestamp);
+
+    cache_.insert(frame, f);
+    cache_size_ += PixelService::GetBufferSize(static_cast<olive::PixelFormat>(f->format()), f->width(), f->height());
+
+    EvictCache();
+  }
+
+  cache_cond_.wakeAll();
+}
+
+void OIIODecoder::EvictCache()
+{
+  while (cache_size_ > kImageSequenceCacheSize && cache_.size() > 1) {
+    // The cache is sorted by frame number, so the furthest frame from the playhead is always at one of the ends
+    int64_t first_distance = qAbs(cache_.firstKey() - last_frame_);
+    int64_t last_distance = qAbs(cache_.lastKey() - last_frame_);
+
+    QMap<int64_t, FramePtr>::iterator it = (first_distance > last_distance) ? cache_.begin() : cache_.end() - 1;
+
+    FramePtr evicted = it.value();
+
+    cache_size_ -= PixelService::GetBufferSize(static_cast<olive::PixelFormat>(evicted->format()),
+                                               evicted->width(),
+                                               evicted->height());
+
+    cache_.erase(it);
+  }
+}
+
+QSet<QString> OIIODecoder::GetReadableExtensions()
+{
+  QSet<QString> extensions;
+
+  // OIIO lists its formats as "tiff:tif,tiff;jpeg:jpg,jpeg;..."
+  std::string extension_list;
+  OIIO::getattribute("extension_list", extension_list);
+
+  QStringList formats = QString::fromStdString(extension_list).split(';');
+
+  foreach (const QString& format, formats) {
+    int colon = format.indexOf(':');
+
+    // Video files are better handled by FFmpegDecoder even if OIIO was built with its own FFmpeg plugin
+    if (colon < 0 || format.left(colon) == QStringLiteral("ffmpeg")) {
+      continue;
+    }
+
+    QStringList format_extensions = format.mid(colon + 1).split(',');
+
+    foreach (const QString& ext, format_extensions) {
+      extensions.insert(ext.toLower());
+    }
+  }
 
-  return 0;
+  return extensions;
 }
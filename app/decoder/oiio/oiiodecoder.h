@@ -21,20 +21,44 @@
 #ifndef OIIODECODER_H
 #define OIIODECODER_H
 
+#include <OpenImageIO/imagecache.h>
 #include <OpenImageIO/imageio.h>
+#include <QMap>
+#include <QMutex>
+#include <QSet>
+#include <QThreadPool>
+#include <QWaitCondition>
 
 #include "decoder/decoder.h"
+#include "decoder/imagesequence.h"
 #include "render/pixelservice.h"
 
+/**
+ * @brief A Decoder derivative that reads still images and image sequences through OpenImageIO
+ *
+ * A still image is read once and the same frame is returned for every time. For image sequences, each frame is a
+ * separate file that can be read independently, so frames are read ahead of the playhead on a pool of threads
+ * (formats like EXR are CPU-bound to decompress and parallelize well). Read frames are kept in a cache that's limited
+ * to kImageSequenceCacheSize bytes, evicting the frames furthest from the playhead first.
+ *
+ * If kUseOIIOImageCache is set, files are read through an OIIO::ImageCache shared by every OIIODecoder (see
+ * SharedImageCache()) rather than each read opening its own ImageInput. Stills used by several MediaInputs are then
+ * only read once, partial and reduced resolution reads come from its tile and MIP cache, and the number of open files
+ * is limited across all of them.
+ */
 class OIIODecoder : public Decoder
 {
 public:
   OIIODecoder();
 
+  virtual ~OIIODecoder() override;
+
   virtual QString id() override;
 
   virtual bool Probe(Footage *f) override;
 
+  virtual bool SupportsExtension(const QString& extension) override;
+
   virtual bool Open() override;
 
   virtual FramePtr Retrieve(const rational &timecode, const rational &length = 0) override;
@@ -43,8 +67,89 @@ public:
 
   virtual int64_t GetTimestampFromTime(const rational &time) override;
 
+  /**
+   * @brief Find the image sequence a file is part of
+   *
+   * @return
+   *
+   * TRUE if the file is an image format OIIO can read and it has numbered neighbors (i.e. `seq` has more than one
+   * frame). Used by Probe() and when importing, so that the frames of a sequence become one Footage.
+   */
+  static bool GetImageSequence(const QString& filename, ImageSequence* seq);
+
 private:
-  std::unique_ptr<OIIO::ImageInput> image_;
+  class FrameReader;
+
+  /**
+   * @brief Collect the file extensions of every image format OIIO can read
+   */
+  static QSet<QString> GetReadableExtensions();
+
+  /**
+   * @brief The process-wide OIIO::ImageCache, configured the first time it's needed
+   *
+   * Its memory budget is kOIIOImageCacheSizeMB, and images without tiles or MIP levels of their own are tiled and
+   * MIP-mapped in the cache as they're read. Safe to call from any thread.
+   */
+  static OIIO::ImageCache* SharedImageCache();
+
+  /**
+   * @brief Read an image file's spec, from SharedImageCache() if it's in use
+   */
+  static bool ReadSpec(const QString& filename, OIIO::ImageSpec* spec);
+
+  /**
+   * @brief Read an image file into a new Frame through SharedImageCache() (see ReadImage())
+   */
+  FramePtr ReadCachedImage(const QString& filename, int divider);
+
+  /**
+   * @brief Returns TRUE if this decoder's stream is an image sequence rather than a still
+   */
+  bool IsSequence();
+
+  /**
+   * @brief Read an image file into a new Frame
+   *
+   * If the file has MIP levels (e.g. tiled EXR or TIFF), the smallest level that's still at least 1/divider of the full
+   * size is read instead of the full image, which saves reading and decompressing data we'd only scale away.
+   *
+   * Safe to call from any thread.
+   */
+  FramePtr ReadImage(const QString& filename, int divider);
+
+  /**
+   * @brief Map an uncompressed 10-bit RGB DPX file into memory and wrap its pixels in a planar Frame
+   *
+   * The frame references the mapped pages directly (YUV_LAYOUT_PACKED_RGB10) and is unpacked on the GPU, so nothing is
+   * decoded or copied on the CPU. Only used for sequences while planar output is allowed. DPX has no MIP levels so the
+   * frame is always full size, the GPU scales it like any other planar frame.
+   *
+   * Safe to call from any thread.
+   *
+   * @return The frame, or nullptr if the file isn't a DPX this fast path can handle (read it with ReadImage() instead).
+   */
+  FramePtr ReadMappedImage(const QString& filename);
+
+  /**
+   * @brief Retrieve a frame of an image sequence, reading ahead of it in the background
+   */
+  FramePtr RetrieveSequenceFrame(const int64_t& timestamp);
+
+  /**
+   * @brief Queue reading any frames around `frame` that aren't cached or being read, assumes cache_lock_ is held
+   */
+  void QueueReads(const int64_t& frame, int direction);
+
+  /**
+   * @brief Called by FrameReader when a frame has finished reading
+   */
+  void FrameRead(const int64_t& frame, int divider, bool planar, FramePtr f);
+
+  /**
+   * @brief Remove frames from the cache until it's within kImageSequenceCacheSize, assumes cache_lock_ is held
+   */
+  void EvictCache();
 
   int width_;
 
@@ -58,6 +163,49 @@ private:
 
   FramePtr frame_;
 
+  /**
+   * @brief The divider frame_ was read at
+   */
+  int frame_divider_;
+
+  ImageSequence sequence_;
+
+  /**
+   * @brief Sequence frames that have been read, keyed by frame number
+   */
+  QMap<int64_t, FramePtr> cache_;
+
+  /**
+   * @brief The divider that frames in cache_ were read at
+   */
+  int cache_divider_;
+
+  /**
+   * @brief Whether frames in cache_ were read while planar output was allowed (and so may be packed)
+   */
+  bool cache_planar_;
+
+  /**
+   * @brief Total size in bytes of the frames in cache_
+   */
+  qint64 cache_size_;
+
+  /**
+   * @brief Frame numbers currently being read by the thread pool, and the divider they're being read at
+   */
+  QMap<int64_t, int> pending_;
+
+  /**
+   * @brief The frame number most recently requested from Retrieve()
+   */
+  int64_t last_frame_;
+
+  QMutex cache_lock_;
+
+  QWaitCondition cache_cond_;
+
+  QThreadPool read_pool_;
+
 };
 
 #endif // OIIODECODER_H
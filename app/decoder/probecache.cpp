@@ -0,0 +1,236 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "probecache.h"
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+
+#include "common/filefunctions.h"
+
+const quint32 ProbeCache::kMagic = 0x4F50524F; // "OPRO"
+const quint32 ProbeCache::kVersion = 1;
+
+bool ProbeCache::Load(Footage *f)
+{
+  QString cache_filename = GetCacheFilename(f->filename());
+
+  if (cache_filename.isEmpty()) {
+    return false;
+  }
+
+  QFile file(cache_filename);
+
+  if (!file.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  QDataStream in(&file);
+
+  quint32 magic, version;
+  in >> magic >> version;
+
+  if (magic != kMagic || version != kVersion) {
+    return false;
+  }
+
+  QString decoder;
+  in >> decoder;
+
+  // Read everything before touching the Footage so a truncated file leaves it as it was
+  QList<StreamPtr> streams;
+
+  if (!ReadStreams(in, &streams)) {
+    return false;
+  }
+
+  if (in.status() != QDataStream::Ok || decoder.isEmpty()) {
+    return false;
+  }
+
+  foreach (StreamPtr s, streams) {
+    f->add_stream(s);
+  }
+
+  f->set_decoder(decoder);
+
+  return true;
+}
+
+bool ProbeCache::Contains(const QString &filename)
+{
+  QString cache_filename = GetCacheFilename(filename);
+
+  return !cache_filename.isEmpty() && QFileInfo::exists(cache_filename);
+}
+
+bool ProbeCache::Save(Footage *f)
+{
+  // An image sequence is identified by its first frame, which doesn't change when frames are added or removed, so its
+  // length can't be trusted from the cache
+  for (int i=0;i<f->stream_count();i++) {
+    if (f->stream(i)->type() == Stream::kVideo && f->decoder() == QStringLiteral("oiio")) {
+      return false;
+    }
+  }
+
+  QString cache_filename = GetCacheFilename(f->filename());
+
+  if (cache_filename.isEmpty()) {
+    return false;
+  }
+
+  // Write to a temporary file first so that a concurrent Load() never reads a half-written cache
+  QString partial_filename = cache_filename;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  QFile file(partial_filename);
+
+  if (!file.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  QDataStream out(&file);
+
+  out << kMagic << kVersion << f->decoder();
+
+  WriteStreams(out, f);
+
+  file.close();
+
+  if (out.status() != QDataStream::Ok) {
+    QFile::remove(partial_filename);
+    return false;
+  }
+
+  QFile::remove(cache_filename);
+
+  return QFile::rename(partial_filename, cache_filename);
+}
+
+bool ProbeCache::ReadStreams(QDataStream &in, QList<StreamPtr> *streams)
+{
+  qint32 stream_count;
+  in >> stream_count;
+
+  for (qint32 i=0;i<stream_count && in.status() == QDataStream::Ok;i++) {
+    qint32 type, index;
+    qint64 timebase_num, timebase_den, duration;
+
+    in >> type >> index >> timebase_num >> timebase_den >> duration;
+
+    StreamPtr s;
+
+    switch (static_cast<Stream::Type>(type)) {
+    case Stream::kVideo:
+    case Stream::kImage:
+    {
+      qint32 width, height;
+      in >> width >> height;
+
+      ImageStreamPtr image_stream;
+
+      if (type == Stream::kVideo) {
+        image_stream = std::make_shared<VideoStream>();
+      } else {
+        image_stream = std::make_shared<ImageStream>();
+      }
+
+      image_stream->set_width(width);
+      image_stream->set_height(height);
+
+      s = image_stream;
+      break;
+    }
+    case Stream::kAudio:
+    {
+      qint32 channels, sample_rate;
+      quint64 layout;
+      in >> channels >> layout >> sample_rate;
+
+      AudioStreamPtr audio_stream = std::make_shared<AudioStream>();
+      audio_stream->set_channels(channels);
+      audio_stream->set_layout(layout);
+      audio_stream->set_sample_rate(sample_rate);
+
+      s = audio_stream;
+      break;
+    }
+    default:
+      s = std::make_shared<Stream>();
+      s->set_type(static_cast<Stream::Type>(type));
+    }
+
+    s->set_index(index);
+    s->set_timebase(rational(timebase_num, timebase_den));
+    s->set_duration(duration);
+
+    streams->append(s);
+  }
+
+  return (in.status() == QDataStream::Ok);
+}
+
+void ProbeCache::WriteStreams(QDataStream &out, Footage *f)
+{
+  out << static_cast<qint32>(f->stream_count());
+
+  for (int i=0;i<f->stream_count();i++) {
+    StreamPtr s = f->stream(i);
+
+    out << static_cast<qint32>(s->type())
+        << static_cast<qint32>(s->index())
+        << static_cast<qint64>(s->timebase().numerator())
+        << static_cast<qint64>(s->timebase().denominator())
+        << static_cast<qint64>(s->duration());
+
+    switch (s->type()) {
+    case Stream::kVideo:
+    case Stream::kImage:
+    {
+      ImageStream* image_stream = static_cast<ImageStream*>(s.get());
+      out << static_cast<qint32>(image_stream->width()) << static_cast<qint32>(image_stream->height());
+      break;
+    }
+    case Stream::kAudio:
+    {
+      AudioStream* audio_stream = static_cast<AudioStream*>(s.get());
+      out << static_cast<qint32>(audio_stream->channels())
+          << static_cast<quint64>(audio_stream->layout())
+          << static_cast<qint32>(audio_stream->sample_rate());
+      break;
+    }
+    default:
+      break;
+    }
+  }
+}
+
+QString ProbeCache::GetCacheFilename(const QString &filename)
+{
+  QString id = GetUniqueFileIdentifier(filename);
+
+  if (id.isEmpty()) {
+    return QString();
+  }
+
+  return GetMediaIndexFilename(id).append(QStringLiteral(".probe"));
+}
@@ -0,0 +1,94 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROBECACHE_H
+#define PROBECACHE_H
+
+#include <QDataStream>
+#include <QString>
+
+#include "project/item/footage/footage.h"
+
+/**
+ * @brief A persistent cache of probe results so that files don't have to be probed again every time they're imported
+ *
+ * Results (the decoder ID and every stream's metadata) are stored in the media index location under the file's
+ * unique identifier (see GetUniqueFileIdentifier()), which changes whenever the file is modified. Probing a file
+ * over a network link can take much longer than reading this, and the cache is shared by every project.
+ *
+ * Decoder::ProbeMedia() reads from and writes to this cache automatically. Image sequences aren't cached since
+ * their first frame (and therefore identifier) stays the same when frames are added.
+ */
+class ProbeCache
+{
+public:
+  /**
+   * @brief Fill a Footage object with previously cached probe results
+   *
+   * @param f
+   *
+   * A Footage object with a valid filename and no streams.
+   *
+   * @return
+   *
+   * TRUE if cached results were found and loaded, FALSE if the file needs to be probed. The Footage is left
+   * untouched if this returns FALSE.
+   */
+  static bool Load(Footage* f);
+
+  /**
+   * @brief Store a successfully probed Footage object's results
+   */
+  static bool Save(Footage* f);
+
+  /**
+   * @brief Returns TRUE if a file has been probed before (and hasn't changed since)
+   *
+   * Decoders opening a file use this to trust what's in the file's header instead of reading ahead for more.
+   */
+  static bool Contains(const QString& filename);
+
+  /**
+   * @brief Read a list of streams written by WriteStreams()
+   *
+   * Also used by ProjectFile, so projects store their Footage's streams the same way.
+   *
+   * @return
+   *
+   * FALSE if the data was truncated or invalid, in which case `streams` may contain some of the streams.
+   */
+  static bool ReadStreams(QDataStream& in, QList<StreamPtr>* streams);
+
+  /**
+   * @brief Write every stream's metadata of a Footage object
+   */
+  static void WriteStreams(QDataStream& out, Footage* f);
+
+private:
+  /**
+   * @brief Get the cache filename for a media file (empty if the file doesn't exist)
+   */
+  static QString GetCacheFilename(const QString& filename);
+
+  static const quint32 kMagic;
+  static const quint32 kVersion;
+};
+
+#endif // PROBECACHE_H
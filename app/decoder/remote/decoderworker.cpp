@@ -0,0 +1,279 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "decoderworker.h"
+
+#include <cstdio>
+#include <cstring>
+#include <QDataStream>
+#include <QFile>
+
+#include "decoder/framebufferpool.h"
+#include "decoder/probecache.h"
+#include "decoder/remote/remotedecoder.h"
+
+/**
+ * @brief Segments the worker stays attached to, older ones are detached once there are more
+ *
+ * Replaced segments get new keys (see RemoteDecoder::AcquireSegment()), so without a limit the worker would keep every
+ * segment the RemoteDecoder ever had alive.
+ */
+const int kMaxAttachedSegments = 32;
+
+DecoderWorker::DecoderWorker()
+{
+}
+
+int DecoderWorker::Run()
+{
+  QFile in;
+  QFile out;
+
+  if (!in.open(stdin, QFile::ReadOnly | QFile::Unbuffered)
+      || !out.open(stdout, QFile::WriteOnly | QFile::Unbuffered)) {
+    return 1;
+  }
+
+  QByteArray request;
+
+  while (RemoteDecoder::ReadMessage(&in, &request, -1)) {
+    QByteArray reply;
+
+    if (!HandleRequest(request, &reply) || !RemoteDecoder::WriteMessage(&out, reply)) {
+      break;
+    }
+  }
+
+  Close();
+
+  qDeleteAll(segments_);
+  segments_.clear();
+
+  return 0;
+}
+
+bool DecoderWorker::HandleRequest(const QByteArray &request, QByteArray *reply)
+{
+  QDataStream in(request);
+  QDataStream out(reply, QIODevice::WriteOnly);
+
+  quint8 command;
+  in >> command;
+
+  switch (static_cast<RemoteDecoder::Command>(command)) {
+  case RemoteDecoder::kOpen:
+  {
+    Close();
+
+    QString filename, decoder_id;
+    qint32 stream_index;
+
+    in >> filename >> decoder_id >> stream_index;
+
+    QList<StreamPtr> streams;
+
+    bool opened = false;
+
+    if (ProbeCache::ReadStreams(in, &streams) && stream_index >= 0 && stream_index < streams.size()) {
+      footage_.reset(new Footage());
+      footage_->set_filename(filename);
+      footage_->set_decoder(decoder_id);
+
+      foreach (StreamPtr s, streams) {
+        footage_->add_stream(s);
+      }
+
+      decoder_ = Decoder::CreateFromID(decoder_id);
+
+      if (decoder_ != nullptr) {
+        decoder_->set_stream(footage_->stream(stream_index));
+        opened = decoder_->Open();
+      }
+    }
+
+    out << opened;
+    break;
+  }
+  case RemoteDecoder::kClose:
+    Close();
+    break;
+  case RemoteDecoder::kRetrieve:
+  {
+    rational time = RemoteDecoder::ReadTime(in);
+    rational length = RemoteDecoder::ReadTime(in);
+
+    bool planar_output_allowed;
+    qint32 divider, playback_speed;
+
+    in >> planar_output_allowed >> divider >> playback_speed;
+
+    frame_ = nullptr;
+
+    if (decoder_ != nullptr) {
+      decoder_->set_planar_output_allowed(planar_output_allowed);
+      decoder_->set_divider(divider);
+      decoder_->set_playback_speed(playback_speed);
+
+      frame_ = decoder_->Retrieve(time, length);
+    }
+
+    out << (frame_ != nullptr);
+
+    if (frame_ == nullptr) {
+      break;
+    }
+
+    const olive::YUVInfo& yuv_info = frame_->yuv_info();
+
+    // Planes are laid out one after another, each aligned the same way FrameBufferPool aligns its buffers
+    int size = 0;
+
+    for (int i=0;i<frame_->plane_count();i++) {
+      rows_[i] = frame_->height();
+
+      // Chroma planes of YUV frames are subsampled
+      if (i > 0 && yuv_info.layout != olive::YUV_LAYOUT_INVALID) {
+        rows_[i] = (frame_->height() + (1 << yuv_info.chroma_shift_h) - 1) >> yuv_info.chroma_shift_h;
+      }
+
+      offsets_[i] = size;
+
+      size += frame_->linesize(i) * rows_[i];
+      size = (size + FrameBufferPool::kAlignment - 1) / FrameBufferPool::kAlignment * FrameBufferPool::kAlignment;
+    }
+
+    out << static_cast<qint32>(frame_->width())
+        << static_cast<qint32>(frame_->height())
+        << static_cast<qint32>(frame_->format());
+
+    RemoteDecoder::WriteTime(out, frame_->timestamp());
+
+    out << static_cast<qint64>(frame_->native_timestamp());
+
+    out << static_cast<qint32>(yuv_info.layout)
+        << static_cast<qint32>(yuv_info.chroma_shift_w)
+        << static_cast<qint32>(yuv_info.chroma_shift_h)
+        << static_cast<qint32>(yuv_info.bit_depth)
+        << yuv_info.msb_aligned
+        << static_cast<qint32>(yuv_info.colorspace)
+        << yuv_info.full_range
+        << yuv_info.big_endian;
+
+    out << static_cast<qint32>(frame_->plane_count()) << static_cast<qint32>(size);
+
+    for (int i=0;i<frame_->plane_count();i++) {
+      out << static_cast<qint32>(frame_->linesize(i)) << static_cast<qint32>(offsets_[i]);
+    }
+    break;
+  }
+  case RemoteDecoder::kDeliver:
+  {
+    QString key;
+    in >> key;
+
+    out << Deliver(key);
+    break;
+  }
+  case RemoteDecoder::kTimestamp:
+  {
+    rational time = RemoteDecoder::ReadTime(in);
+
+    qint32 playback_speed;
+    in >> playback_speed;
+
+    qint64 timestamp = -1;
+
+    if (decoder_ != nullptr) {
+      decoder_->set_playback_speed(playback_speed);
+      timestamp = decoder_->GetTimestampFromTime(time);
+    }
+
+    out << timestamp;
+    break;
+  }
+  case RemoteDecoder::kFrameDuration:
+    RemoteDecoder::WriteTime(out, (decoder_ != nullptr) ? decoder_->GetFrameDuration() : rational(0));
+    break;
+  case RemoteDecoder::kNextKeyframe:
+  {
+    rational time = RemoteDecoder::ReadTime(in);
+
+    RemoteDecoder::WriteTime(out, (decoder_ != nullptr) ? decoder_->GetNextKeyframe(time) : RATIONAL_MIN);
+    break;
+  }
+  default:
+    return false;
+  }
+
+  return (in.status() == QDataStream::Ok);
+}
+
+bool DecoderWorker::Deliver(const QString &key)
+{
+  if (frame_ == nullptr) {
+    return false;
+  }
+
+  QSharedMemory* segment = segments_.value(key);
+
+  if (segment == nullptr) {
+    if (segments_.size() >= kMaxAttachedSegments) {
+      qDeleteAll(segments_);
+      segments_.clear();
+    }
+
+    segment = new QSharedMemory(key);
+
+    if (!segment->attach()) {
+      delete segment;
+      return false;
+    }
+
+    segments_.insert(key, segment);
+  }
+
+  uint8_t* dst = static_cast<uint8_t*>(segment->data());
+
+  for (int i=0;i<frame_->plane_count();i++) {
+    size_t plane_size = static_cast<size_t>(frame_->linesize(i) * rows_[i]);
+
+    if (offsets_[i] + static_cast<int>(plane_size) > segment->size()) {
+      return false;
+    }
+
+    memcpy(dst + offsets_[i], frame_->const_data(i), plane_size);
+  }
+
+  frame_ = nullptr;
+
+  return true;
+}
+
+void DecoderWorker::Close()
+{
+  frame_ = nullptr;
+
+  if (decoder_ != nullptr) {
+    decoder_->Close();
+    decoder_ = nullptr;
+  }
+
+  footage_ = nullptr;
+}
@@ -0,0 +1,89 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef DECODERWORKER_H
+#define DECODERWORKER_H
+
+#include <QHash>
+#include <QSharedMemory>
+
+#include "decoder/decoder.h"
+#include "project/item/footage/footage.h"
+
+/**
+ * @brief The main loop of a decoder worker process (see RemoteDecoder)
+ *
+ * Started by running the application with `--decoder-worker`. Requests are read from stdin and answered on stdout
+ * until stdin is closed. The worker hosts a single Decoder for the stream it's opened with, and frames it retrieves are
+ * copied into shared memory segments created by the RemoteDecoder.
+ */
+class DecoderWorker
+{
+public:
+  DecoderWorker();
+
+  /**
+   * @brief Serve requests until stdin is closed, returns the process's exit code
+   */
+  int Run();
+
+private:
+  /**
+   * @brief Answer a single request, returns FALSE if it couldn't be read
+   */
+  bool HandleRequest(const QByteArray& request, QByteArray* reply);
+
+  /**
+   * @brief Copy frame_ into the shared memory segment with this key
+   */
+  bool Deliver(const QString& key);
+
+  /**
+   * @brief Close the Decoder and free the Footage it was opened with
+   */
+  void Close();
+
+  std::unique_ptr<Footage> footage_;
+
+  DecoderPtr decoder_;
+
+  /**
+   * @brief The last frame retrieved, until it's delivered
+   */
+  FramePtr frame_;
+
+  /**
+   * @brief Where each of frame_'s planes goes in a segment
+   */
+  int offsets_[Frame::kMaxPlanes];
+
+  /**
+   * @brief Number of rows in each of frame_'s planes
+   */
+  int rows_[Frame::kMaxPlanes];
+
+  /**
+   * @brief Segments delivered to before, keyed by their key
+   */
+  QHash<QString, QSharedMemory*> segments_;
+
+};
+
+#endif // DECODERWORKER_H
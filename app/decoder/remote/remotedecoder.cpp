@@ -0,0 +1,544 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "remotedecoder.h"
+
+#include <cstring>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QProcess>
+
+#include "config/config.h"
+#include "decoder/probecache.h"
+#include "project/item/footage/footage.h"
+
+/**
+ * @brief How long to wait for a worker to reply before treating it as hung (in msecs)
+ *
+ * Generous since a first Retrieve() may have to seek through a long GOP or read from a slow network share.
+ */
+const int kReplyTimeout = 30000;
+
+RemoteDecoder::RemoteDecoder(const QString &decoder_id) :
+  decoder_id_(decoder_id),
+  segment_pool_(std::make_shared<SegmentPool>())
+{
+}
+
+RemoteDecoder::~RemoteDecoder()
+{
+  Close();
+}
+
+QString RemoteDecoder::id()
+{
+  return decoder_id_;
+}
+
+bool RemoteDecoder::Probe(Footage *)
+{
+  return false;
+}
+
+bool RemoteDecoder::Open()
+{
+  if (open_) {
+    return true;
+  }
+
+  QByteArray request;
+  QDataStream out(&request, QIODevice::WriteOnly);
+
+  out << static_cast<quint8>(kOpen)
+      << stream()->footage()->filename()
+      << decoder_id_
+      << static_cast<qint32>(stream()->index());
+
+  ProbeCache::WriteStreams(out, stream()->footage());
+
+  QByteArray reply;
+
+  if (!Request(request, &reply)) {
+    return false;
+  }
+
+  QDataStream in(reply);
+
+  bool opened;
+  in >> opened;
+
+  open_ = opened;
+
+  return open_;
+}
+
+FramePtr RemoteDecoder::Retrieve(const rational &timecode, const rational &length)
+{
+  if (!open_ && !Open()) {
+    return nullptr;
+  }
+
+  QByteArray request;
+  QDataStream out(&request, QIODevice::WriteOnly);
+
+  out << static_cast<quint8>(kRetrieve);
+  WriteTime(out, timecode);
+  WriteTime(out, length);
+  out << planar_output_allowed_ << static_cast<qint32>(divider_) << static_cast<qint32>(playback_speed_);
+
+  QByteArray reply;
+
+  if (!Request(request, &reply)) {
+    return nullptr;
+  }
+
+  QDataStream in(reply);
+
+  bool retrieved;
+  in >> retrieved;
+
+  if (!retrieved) {
+    return nullptr;
+  }
+
+  qint32 width, height, format, plane_count, size;
+  qint32 layout, chroma_shift_w, chroma_shift_h, bit_depth, colorspace;
+  bool msb_aligned, full_range, big_endian;
+  qint64 native_timestamp;
+
+  in >> width >> height >> format;
+  rational timestamp = ReadTime(in);
+  in >> native_timestamp;
+  in >> layout >> chroma_shift_w >> chroma_shift_h >> bit_depth >> msb_aligned >> colorspace >> full_range >> big_endian;
+  in >> plane_count >> size;
+
+  qint32 linesizes[Frame::kMaxPlanes];
+  qint32 offsets[Frame::kMaxPlanes];
+
+  for (int i=0;i<plane_count;i++) {
+    in >> linesizes[i] >> offsets[i];
+  }
+
+  if (in.status() != QDataStream::Ok || plane_count < 1 || plane_count > Frame::kMaxPlanes || size <= 0) {
+    qWarning() << "Received an invalid frame from decoder process for" << stream()->footage()->filename();
+    return nullptr;
+  }
+
+  SegmentPtr segment = AcquireSegment(size);
+
+  if (segment == nullptr) {
+    return nullptr;
+  }
+
+  std::shared_ptr<SegmentPool> pool = segment_pool_;
+
+  // Frames hold on to their segment until they're released, then it can be written to again
+  std::shared_ptr<void> owner(segment.get(), [pool, segment](void*) {
+    QMutexLocker locker(&pool->lock);
+
+    segment->in_use = false;
+    pool->freed.wakeAll();
+  });
+
+  request.clear();
+  QDataStream deliver(&request, QIODevice::WriteOnly);
+
+  deliver << static_cast<quint8>(kDeliver) << segment->memory.key();
+
+  if (!Request(request, &reply)) {
+    return nullptr;
+  }
+
+  QDataStream delivered_in(reply);
+
+  bool delivered;
+  delivered_in >> delivered;
+
+  if (!delivered) {
+    return nullptr;
+  }
+
+  uint8_t* data[Frame::kMaxPlanes];
+  int linesize[Frame::kMaxPlanes];
+
+  for (int i=0;i<plane_count;i++) {
+    data[i] = static_cast<uint8_t*>(segment->memory.data()) + offsets[i];
+    linesize[i] = linesizes[i];
+  }
+
+  olive::YUVInfo yuv_info;
+  yuv_info.layout = static_cast<olive::YUVLayout>(layout);
+  yuv_info.chroma_shift_w = chroma_shift_w;
+  yuv_info.chroma_shift_h = chroma_shift_h;
+  yuv_info.bit_depth = bit_depth;
+  yuv_info.msb_aligned = msb_aligned;
+  yuv_info.colorspace = static_cast<olive::YUVColorspace>(colorspace);
+  yuv_info.full_range = full_range;
+  yuv_info.big_endian = big_endian;
+
+  FramePtr frame = Frame::Create();
+  frame->set_width(width);
+  frame->set_height(height);
+  frame->set_format(format);
+  frame->set_timestamp(timestamp);
+  frame->set_native_timestamp(native_timestamp);
+  frame->set_yuv_info(yuv_info);
+  frame->wrap(plane_count, data, linesize, owner);
+
+  return frame;
+}
+
+void RemoteDecoder::Close()
+{
+  if (link_ != nullptr && open_) {
+    QByteArray request;
+    QDataStream out(&request, QIODevice::WriteOnly);
+
+    out << static_cast<quint8>(kClose);
+
+    QByteArray reply;
+    Request(request, &reply);
+  }
+
+  // Stops the worker process
+  link_ = nullptr;
+
+  open_ = false;
+}
+
+int64_t RemoteDecoder::GetTimestampFromTime(const rational &time)
+{
+  if (!open_ && !Open()) {
+    return -1;
+  }
+
+  QByteArray request;
+  QDataStream out(&request, QIODevice::WriteOnly);
+
+  out << static_cast<quint8>(kTimestamp);
+  WriteTime(out, time);
+  out << static_cast<qint32>(playback_speed_);
+
+  QByteArray reply;
+
+  if (!Request(request, &reply)) {
+    return -1;
+  }
+
+  QDataStream in(reply);
+
+  qint64 timestamp;
+  in >> timestamp;
+
+  return timestamp;
+}
+
+rational RemoteDecoder::GetFrameDuration()
+{
+  if (!open_ && !Open()) {
+    return 0;
+  }
+
+  QByteArray request;
+  QDataStream out(&request, QIODevice::WriteOnly);
+
+  out << static_cast<quint8>(kFrameDuration);
+
+  QByteArray reply;
+
+  if (!Request(request, &reply)) {
+    return 0;
+  }
+
+  QDataStream in(reply);
+
+  return ReadTime(in);
+}
+
+rational RemoteDecoder::GetNextKeyframe(const rational &time)
+{
+  if (!open_ && !Open()) {
+    return RATIONAL_MIN;
+  }
+
+  QByteArray request;
+  QDataStream out(&request, QIODevice::WriteOnly);
+
+  out << static_cast<quint8>(kNextKeyframe);
+  WriteTime(out, time);
+
+  QByteArray reply;
+
+  if (!Request(request, &reply)) {
+    return RATIONAL_MIN;
+  }
+
+  QDataStream in(reply);
+
+  return ReadTime(in);
+}
+
+void RemoteDecoder::WriteTime(QDataStream &out, const rational &time)
+{
+  out << static_cast<qint64>(time.numerator()) << static_cast<qint64>(time.denominator());
+}
+
+rational RemoteDecoder::ReadTime(QDataStream &in)
+{
+  qint64 num, den;
+
+  in >> num >> den;
+
+  // Whole numbers (including 0) are stored with a denominator of 0 (see rational's constructor)
+  if (den == 0) {
+    return rational(num);
+  }
+
+  return rational(num, den);
+}
+
+bool RemoteDecoder::WriteMessage(QIODevice *device, const QByteArray &message)
+{
+  quint32 size = static_cast<quint32>(message.size());
+
+  if (device->write(reinterpret_cast<const char*>(&size), sizeof(size)) != sizeof(size)
+      || device->write(message) != message.size()) {
+    return false;
+  }
+
+  while (device->bytesToWrite() > 0) {
+    if (!device->waitForBytesWritten(kReplyTimeout)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool RemoteDecoder::ReadMessage(QIODevice *device, QByteArray *message, int timeout)
+{
+  quint32 size = 0;
+
+  QByteArray buffer;
+  qint64 wanted = sizeof(size);
+  bool have_size = false;
+
+  while (true) {
+    while (buffer.size() < wanted) {
+      QByteArray chunk = device->read(wanted - buffer.size());
+
+      if (!chunk.isEmpty()) {
+        buffer.append(chunk);
+        continue;
+      }
+
+      // Pipes on a QFile block in read(), so nothing read means the other end has gone. QProcess needs waiting on.
+      if (device->atEnd() && !device->waitForReadyRead(timeout)) {
+        return false;
+      }
+    }
+
+    if (have_size) {
+      break;
+    }
+
+    memcpy(&size, buffer.constData(), sizeof(size));
+    buffer.clear();
+    wanted = size;
+    have_size = true;
+  }
+
+  *message = buffer;
+
+  return true;
+}
+
+bool RemoteDecoder::Request(const QByteArray &request, QByteArray *reply)
+{
+  if (link_ == nullptr) {
+    link_.reset(new Link());
+    link_->start();
+
+    // A new worker doesn't have anything open yet
+    if (open_ && static_cast<Command>(request.at(0)) != kOpen) {
+      open_ = false;
+
+      if (!Open()) {
+        return false;
+      }
+    }
+  }
+
+  if (link_->Request(request, reply)) {
+    return true;
+  }
+
+  qWarning() << "Decoder process for" << stream()->footage()->filename() << "failed, it will be restarted";
+
+  link_ = nullptr;
+  open_ = false;
+
+  return false;
+}
+
+RemoteDecoder::SegmentPtr RemoteDecoder::AcquireSegment(int size)
+{
+  static QAtomicInt key_counter;
+
+  QMutexLocker locker(&segment_pool_->lock);
+
+  while (true) {
+    SegmentPtr too_small = nullptr;
+
+    foreach (SegmentPtr s, segment_pool_->segments) {
+      if (!s->in_use) {
+        if (s->memory.size() >= size) {
+          s->in_use = true;
+          return s;
+        }
+
+        too_small = s;
+      }
+    }
+
+    SegmentPtr segment = nullptr;
+
+    if (segment_pool_->segments.size() < kDecoderProcessSegments) {
+      segment = std::make_shared<Segment>();
+      segment_pool_->segments.append(segment);
+    } else if (too_small != nullptr) {
+      // Frames got bigger (e.g. the divider changed), replace one that's too small
+      too_small->memory.detach();
+      segment = too_small;
+    }
+
+    if (segment != nullptr) {
+      // Every segment gets a new key, the worker may still be attached to the old one
+      segment->memory.setKey(QStringLiteral("olive-decoder-%1-%2").arg(QCoreApplication::applicationPid())
+                                                                   .arg(key_counter.fetchAndAddRelaxed(1)));
+
+      if (!segment->memory.create(size)) {
+        qWarning() << "Failed to create shared memory for decoder process:" << segment->memory.errorString();
+        segment_pool_->segments.removeOne(segment);
+        return nullptr;
+      }
+
+      segment->in_use = true;
+      return segment;
+    }
+
+    // Everything's in use, wait for a frame to be released
+    if (!segment_pool_->freed.wait(&segment_pool_->lock, kReplyTimeout)) {
+      qWarning() << "Timed out waiting for a free decoder process segment";
+      return nullptr;
+    }
+  }
+}
+
+RemoteDecoder::Link::Link() :
+  pending_(false),
+  succeeded_(false),
+  quit_(false)
+{
+  setObjectName(QStringLiteral("DecoderProcessLink"));
+}
+
+RemoteDecoder::Link::~Link()
+{
+  lock_.lock();
+  quit_ = true;
+  cond_.wakeAll();
+  lock_.unlock();
+
+  wait();
+}
+
+bool RemoteDecoder::Link::Request(const QByteArray &request, QByteArray *reply)
+{
+  QMutexLocker locker(&lock_);
+
+  request_ = request;
+  pending_ = true;
+  cond_.wakeAll();
+
+  while (pending_) {
+    cond_.wait(&lock_);
+  }
+
+  *reply = reply_;
+
+  return succeeded_;
+}
+
+void RemoteDecoder::Link::run()
+{
+  QProcess process;
+
+  // The worker's log goes wherever ours does
+  process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+  process.start(QCoreApplication::applicationFilePath(), {QStringLiteral("--decoder-worker")});
+
+  bool alive = process.waitForStarted();
+
+  if (!alive) {
+    qWarning() << "Failed to start decoder process:" << process.errorString();
+  }
+
+  QMutexLocker locker(&lock_);
+
+  while (!quit_) {
+    if (!pending_) {
+      cond_.wait(&lock_);
+      continue;
+    }
+
+    QByteArray request = request_;
+
+    locker.unlock();
+
+    QByteArray reply;
+
+    if (alive) {
+      alive = (WriteMessage(&process, request) && ReadMessage(&process, &reply, kReplyTimeout));
+
+      if (!alive) {
+        // Crashed or hung, either way it's no use anymore
+        process.kill();
+      }
+    }
+
+    locker.relock();
+
+    reply_ = reply;
+    succeeded_ = alive;
+    pending_ = false;
+    cond_.wakeAll();
+  }
+
+  locker.unlock();
+
+  // Closing stdin tells the worker to exit
+  process.closeWriteChannel();
+
+  if (!process.waitForFinished(1000)) {
+    process.kill();
+    process.waitForFinished();
+  }
+}
@@ -0,0 +1,199 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef REMOTEDECODER_H
+#define REMOTEDECODER_H
+
+#include <QDataStream>
+#include <QIODevice>
+#include <QMutex>
+#include <QSharedMemory>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "decoder/decoder.h"
+
+/**
+ * @brief A Decoder that runs another Decoder in a separate worker process (see DecoderWorker)
+ *
+ * Some decoders serialize on internal locks, leak, or crash on bad files. Hosting them in worker processes lets
+ * decoding scale across processes and keeps a crash from taking the editor down with it. If the worker dies or stops
+ * responding, the request fails, the worker is killed, and a new one is started on the next Open() or Retrieve().
+ *
+ * Requests and replies go over the worker's stdin and stdout. Frames are written by the worker into shared memory
+ * segments owned by this class, and the Frames returned by Retrieve() wrap those segments directly so render threads
+ * read them without another copy. A segment is reused once every Frame wrapping it has been released.
+ *
+ * Probing stays in the editor's process, as does everything but video (see DecoderPool::CreateDecoder()).
+ */
+class RemoteDecoder : public Decoder
+{
+public:
+  /**
+   * @brief Requests sent to a DecoderWorker, each is answered with a single reply
+   */
+  enum Command : quint8 {
+    /// Footage filename, decoder ID, stream index and streams (see ProbeCache::WriteStreams()), replies success
+    kOpen,
+
+    /// Replies nothing
+    kClose,
+
+    /// Time, length and the decoder settings, replies success and then the frame's description (see Retrieve())
+    kRetrieve,
+
+    /// Shared memory key to copy the last retrieved frame into, replies success
+    kDeliver,
+
+    /// Time and playback speed, replies the timestamp
+    kTimestamp,
+
+    /// Replies the frame duration
+    kFrameDuration,
+
+    /// Time, replies the next keyframe's time
+    kNextKeyframe
+  };
+
+  RemoteDecoder(const QString& decoder_id);
+
+  virtual ~RemoteDecoder() override;
+
+  virtual QString id() override;
+
+  /**
+   * @brief Always returns FALSE, media is probed in the editor's process
+   */
+  virtual bool Probe(Footage* f) override;
+
+  virtual bool Open() override;
+  virtual FramePtr Retrieve(const rational& timecode, const rational& length = 0) override;
+  virtual void Close() override;
+
+  virtual int64_t GetTimestampFromTime(const rational& time) override;
+
+  virtual rational GetFrameDuration() override;
+
+  virtual rational GetNextKeyframe(const rational& time) override;
+
+  /**
+   * @brief Write a rational to a request or reply
+   */
+  static void WriteTime(QDataStream& out, const rational& time);
+
+  /**
+   * @brief Read a rational written with WriteTime()
+   */
+  static rational ReadTime(QDataStream& in);
+
+  /**
+   * @brief Write a length-prefixed message to a device, waiting until it's been written
+   */
+  static bool WriteMessage(QIODevice* device, const QByteArray& message);
+
+  /**
+   * @brief Read a message written with WriteMessage(), waiting up to `timeout` msecs (-1 for forever) for data
+   */
+  static bool ReadMessage(QIODevice* device, QByteArray* message, int timeout);
+
+private:
+  /**
+   * @brief Thread that owns the worker process and passes requests to it
+   *
+   * QProcess can only be used from the thread it belongs to, whereas Decoders are used from whichever thread leased
+   * them, so the process lives on a thread of its own.
+   */
+  class Link : public QThread
+  {
+  public:
+    Link();
+
+    virtual ~Link() override;
+
+    /**
+     * @brief Send a request to the worker and wait for its reply
+     *
+     * Returns FALSE if the worker couldn't be started, crashed, or didn't reply in time, after which every request
+     * fails.
+     */
+    bool Request(const QByteArray& request, QByteArray* reply);
+
+  protected:
+    virtual void run() override;
+
+  private:
+    QMutex lock_;
+
+    QWaitCondition cond_;
+
+    QByteArray request_;
+
+    QByteArray reply_;
+
+    bool pending_;
+
+    bool succeeded_;
+
+    bool quit_;
+  };
+
+  struct Segment {
+    QSharedMemory memory;
+
+    /// TRUE while a Frame wraps this segment or it's being written to
+    bool in_use;
+  };
+
+  using SegmentPtr = std::shared_ptr<Segment>;
+
+  /**
+   * @brief Segments shared with the Frames wrapping them, so the Frames can outlive this Decoder
+   */
+  struct SegmentPool {
+    QMutex lock;
+
+    QWaitCondition freed;
+
+    QList<SegmentPtr> segments;
+  };
+
+  /**
+   * @brief Send a request to the worker, starting it if necessary
+   *
+   * If the worker fails it's discarded and the Decoder is marked closed, so the next Retrieve() starts over.
+   */
+  bool Request(const QByteArray& request, QByteArray* reply);
+
+  /**
+   * @brief Find or create a segment of at least `size` bytes that isn't in use and mark it in use
+   *
+   * Waits for a Frame to release one if kDecoderProcessSegments are already in use. Returns nullptr on failure.
+   */
+  SegmentPtr AcquireSegment(int size);
+
+  QString decoder_id_;
+
+  std::unique_ptr<Link> link_;
+
+  std::shared_ptr<SegmentPool> segment_pool_;
+
+};
+
+#endif // REMOTEDECODER_H
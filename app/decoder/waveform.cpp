@@ -0,0 +1,368 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "waveform.h"
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <QDebug>
+#include <QMap>
+#include <QMutex>
+
+#include "common/filefunctions.h"
+#include "project/item/footage/footage.h"
+#include "render/sampleservice.h"
+
+namespace {
+
+const char kMagic[4] = {'O', 'W', 'A', 'V'};
+
+/**
+ * @brief All waveforms currently loaded in this process
+ */
+QMap<QString, std::weak_ptr<Waveform> > loaded_waveforms;
+QMutex loaded_waveforms_lock;
+
+}
+
+Waveform::Waveform() :
+  map_(nullptr),
+  header_(nullptr),
+  levels_(nullptr)
+{
+}
+
+Waveform::~Waveform()
+{
+  if (map_ != nullptr) {
+    file_.unmap(map_);
+  }
+
+  file_.close();
+}
+
+WaveformPtr Waveform::Load(const QString &filename)
+{
+  QMutexLocker locker(&loaded_waveforms_lock);
+
+  WaveformPtr existing = loaded_waveforms.value(filename).lock();
+
+  if (existing != nullptr) {
+    return existing;
+  }
+
+  WaveformPtr waveform(new Waveform());
+
+  waveform->file_.setFileName(filename);
+
+  if (!waveform->file_.open(QFile::ReadOnly)) {
+    return nullptr;
+  }
+
+  qint64 file_size = waveform->file_.size();
+
+  if (file_size < static_cast<qint64>(sizeof(Header))) {
+    return nullptr;
+  }
+
+  waveform->map_ = waveform->file_.map(0, file_size);
+
+  if (waveform->map_ == nullptr) {
+    qWarning() << "Failed to map waveform" << filename;
+    return nullptr;
+  }
+
+  waveform->header_ = reinterpret_cast<const Header*>(waveform->map_);
+
+  const Header* header = waveform->header_;
+
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0
+      || header->version != kVersion
+      || header->channels <= 0
+      || header->level_count <= 0) {
+    return nullptr;
+  }
+
+  qint64 table_end = static_cast<qint64>(sizeof(Header))
+      + static_cast<qint64>(sizeof(Level)) * header->level_count;
+
+  if (file_size < table_end) {
+    return nullptr;
+  }
+
+  waveform->levels_ = reinterpret_cast<const Level*>(waveform->map_ + sizeof(Header));
+
+  // Make sure every level is actually in the file
+  for (int i=0;i<header->level_count;i++) {
+    const Level& level = waveform->levels_[i];
+
+    if (level.samples_per_peak <= 0
+        || level.peak_count < 0
+        || level.offset < table_end
+        || level.offset + level.peak_count * header->channels * static_cast<qint64>(sizeof(Peak)) > file_size) {
+      return nullptr;
+    }
+  }
+
+  loaded_waveforms.insert(filename, waveform);
+
+  return waveform;
+}
+
+QString Waveform::GetFilename(Stream *stream)
+{
+  return GetMediaIndexFilename(GetUniqueFileIdentifier(stream->footage()->filename()))
+      .append(QString::number(stream->index()))
+      .append(QStringLiteral(".waveform"));
+}
+
+int Waveform::channels() const
+{
+  return header_->channels;
+}
+
+int Waveform::sample_rate() const
+{
+  return header_->sample_rate;
+}
+
+int Waveform::level_count() const
+{
+  return header_->level_count;
+}
+
+int64_t Waveform::samples_per_peak(int level) const
+{
+  return levels_[level].samples_per_peak;
+}
+
+int64_t Waveform::peak_count(int level) const
+{
+  return levels_[level].peak_count;
+}
+
+int Waveform::GetLevelForSamplesPerPixel(double samples_per_pixel) const
+{
+  int level = 0;
+
+  while (level + 1 < level_count() && samples_per_peak(level + 1) <= samples_per_pixel) {
+    level++;
+  }
+
+  return level;
+}
+
+Waveform::Peak Waveform::GetPeak(int level, int channel, const int64_t &start_sample, const int64_t &end_sample) const
+{
+  Peak summary;
+  summary.min = 0.0f;
+  summary.max = 0.0f;
+  summary.rms = 0.0f;
+
+  const Level& l = levels_[level];
+
+  int64_t first = qMax(start_sample / l.samples_per_peak, static_cast<int64_t>(0));
+  int64_t last = qMin((end_sample + l.samples_per_peak - 1) / l.samples_per_peak, l.peak_count);
+
+  if (last <= first) {
+    return summary;
+  }
+
+  const Peak* peaks = reinterpret_cast<const Peak*>(map_ + l.offset);
+
+  float min = FLT_MAX;
+  float max = -FLT_MAX;
+  double sum_squares = 0;
+
+  for (int64_t i=first;i<last;i++) {
+    const Peak& p = peaks[i * header_->channels + channel];
+
+    min = qMin(min, p.min);
+    max = qMax(max, p.max);
+    sum_squares += static_cast<double>(p.rms) * static_cast<double>(p.rms);
+  }
+
+  summary.min = min;
+  summary.max = max;
+  summary.rms = static_cast<float>(std::sqrt(sum_squares / static_cast<double>(last - first)));
+
+  return summary;
+}
+
+WaveformBuilder::WaveformBuilder(int channels, int sample_rate) :
+  channels_(channels),
+  sample_rate_(sample_rate),
+  current_peak_(channels),
+  current_sum_squares_(channels),
+  current_sample_count_(0)
+{
+}
+
+void WaveformBuilder::AddSamples(const uint8_t *data, const olive::SampleFormat &format, int count)
+{
+  int bytes_per_sample = SampleService::BytesPerSample(format);
+
+  for (int i=0;i<count;i++) {
+    if (current_sample_count_ == 0) {
+      for (int j=0;j<channels_;j++) {
+        current_peak_[j].min = FLT_MAX;
+        current_peak_[j].max = -FLT_MAX;
+        current_sum_squares_[j] = 0;
+      }
+    }
+
+    for (int j=0;j<channels_;j++) {
+      float sample = SampleToFloat(data, format);
+
+      current_peak_[j].min = qMin(current_peak_[j].min, sample);
+      current_peak_[j].max = qMax(current_peak_[j].max, sample);
+      current_sum_squares_[j] += static_cast<double>(sample) * static_cast<double>(sample);
+
+      data += bytes_per_sample;
+    }
+
+    current_sample_count_++;
+
+    if (current_sample_count_ == Waveform::kBaseSamplesPerPeak) {
+      FinishPeak();
+    }
+  }
+}
+
+bool WaveformBuilder::Save(const QString &filename)
+{
+  // Include any samples left over at the end
+  if (current_sample_count_ > 0) {
+    FinishPeak();
+  }
+
+  // Build each level from the one before it
+  QVector< QVector<Waveform::Peak> > levels;
+  levels.append(base_level_);
+
+  for (int i=1;i<Waveform::kLevelCount;i++) {
+    const QVector<Waveform::Peak>& src = levels.last();
+    int src_count = src.size() / channels_;
+    int dst_count = (src_count + Waveform::kLevelFactor - 1) / Waveform::kLevelFactor;
+
+    QVector<Waveform::Peak> dst(dst_count * channels_);
+
+    for (int j=0;j<dst_count;j++) {
+      int group_start = j * Waveform::kLevelFactor;
+      int group_end = qMin(group_start + Waveform::kLevelFactor, src_count);
+
+      for (int k=0;k<channels_;k++) {
+        Waveform::Peak& p = dst[j * channels_ + k];
+        p.min = FLT_MAX;
+        p.max = -FLT_MAX;
+
+        double sum_squares = 0;
+
+        for (int l=group_start;l<group_end;l++) {
+          const Waveform::Peak& s = src.at(l * channels_ + k);
+
+          p.min = qMin(p.min, s.min);
+          p.max = qMax(p.max, s.max);
+          sum_squares += static_cast<double>(s.rms) * static_cast<double>(s.rms);
+        }
+
+        p.rms = static_cast<float>(std::sqrt(sum_squares / (group_end - group_start)));
+      }
+    }
+
+    levels.append(dst);
+  }
+
+  QFile f(filename);
+
+  if (!f.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  Waveform::Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = Waveform::kVersion;
+  header.channels = channels_;
+  header.sample_rate = sample_rate_;
+  header.level_count = levels.size();
+  header.reserved = 0;
+
+  f.write(reinterpret_cast<const char*>(&header), sizeof(Waveform::Header));
+
+  // Write level table, peaks follow it in level order
+  int64_t offset = static_cast<int64_t>(sizeof(Waveform::Header))
+      + static_cast<int64_t>(sizeof(Waveform::Level)) * levels.size();
+  int64_t samples_per_peak = Waveform::kBaseSamplesPerPeak;
+
+  for (int i=0;i<levels.size();i++) {
+    Waveform::Level level;
+    level.samples_per_peak = samples_per_peak;
+    level.peak_count = levels.at(i).size() / channels_;
+    level.offset = offset;
+
+    f.write(reinterpret_cast<const char*>(&level), sizeof(Waveform::Level));
+
+    offset += static_cast<int64_t>(sizeof(Waveform::Peak)) * levels.at(i).size();
+    samples_per_peak *= Waveform::kLevelFactor;
+  }
+
+  for (int i=0;i<levels.size();i++) {
+    f.write(reinterpret_cast<const char*>(levels.at(i).constData()),
+            static_cast<qint64>(sizeof(Waveform::Peak)) * levels.at(i).size());
+  }
+
+  f.close();
+
+  return true;
+}
+
+float WaveformBuilder::SampleToFloat(const uint8_t *data, const olive::SampleFormat &format)
+{
+  switch (format) {
+  case olive::SAMPLE_FMT_U8:
+    return static_cast<float>(*data - 128) / 128.0f;
+  case olive::SAMPLE_FMT_S16:
+    return static_cast<float>(*reinterpret_cast<const int16_t*>(data)) / 32768.0f;
+  case olive::SAMPLE_FMT_S32:
+    return static_cast<float>(static_cast<double>(*reinterpret_cast<const int32_t*>(data)) / 2147483648.0);
+  case olive::SAMPLE_FMT_FLT:
+    return *reinterpret_cast<const float*>(data);
+  case olive::SAMPLE_FMT_DBL:
+    return static_cast<float>(*reinterpret_cast<const double*>(data));
+  case olive::SAMPLE_FMT_INVALID:
+  case olive::SAMPLE_FMT_COUNT:
+    break;
+  }
+
+  return 0.0f;
+}
+
+void WaveformBuilder::FinishPeak()
+{
+  for (int i=0;i<channels_;i++) {
+    Waveform::Peak p = current_peak_.at(i);
+    p.rms = static_cast<float>(std::sqrt(current_sum_squares_.at(i) / current_sample_count_));
+
+    base_level_.append(p);
+  }
+
+  current_sample_count_ = 0;
+}
@@ -0,0 +1,201 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include <memory>
+#include <QFile>
+#include <QVector>
+#include <stdint.h>
+
+#include "project/item/footage/stream.h"
+#include "render/sampleformat.h"
+
+class Waveform;
+using WaveformPtr = std::shared_ptr<Waveform>;
+
+/**
+ * @brief A precomputed min/max/RMS summary of an audio stream at several resolutions
+ *
+ * Drawing a waveform straight from audio means decoding every sample on screen, which is far too slow for a timeline
+ * with many clips. Instead, WaveformTask decodes each audio stream once and stores "peaks" (the minimum, maximum, and
+ * RMS of a group of samples) for each channel at kLevelCount levels, where each level uses kLevelFactor times as many
+ * samples per peak as the one before it. Painting at any zoom level then only needs to read roughly one peak per
+ * pixel from the closest level.
+ *
+ * Waveform files live next to the media indexes (see GetMediaIndexLocation()) and are memory-mapped when loaded.
+ * Like FrameIndex, loaded waveforms are shared, so every clip using the same stream reads from the same mapping.
+ */
+class Waveform
+{
+public:
+  /**
+   * @brief The summary of a group of samples in one channel
+   */
+  struct Peak {
+    float min;
+    float max;
+    float rms;
+  };
+
+  /// Version of the file layout, files with a different version are ignored (and rebuilt)
+  static const uint32_t kVersion = 1;
+
+  /// Samples per peak in the most detailed level
+  static const int kBaseSamplesPerPeak = 128;
+
+  /// How many more samples per peak each level has than the previous one
+  static const int kLevelFactor = 4;
+
+  /// Number of levels stored
+  static const int kLevelCount = 7;
+
+  ~Waveform();
+
+  /**
+   * @brief Load a waveform file, or get the already loaded copy if another caller has it
+   *
+   * @return
+   *
+   * The waveform, or nullptr if the file doesn't exist or isn't valid.
+   */
+  static WaveformPtr Load(const QString& filename);
+
+  /**
+   * @brief Returns the filename the waveform for a stream is stored at
+   */
+  static QString GetFilename(Stream* stream);
+
+  int channels() const;
+
+  int sample_rate() const;
+
+  int level_count() const;
+
+  int64_t samples_per_peak(int level) const;
+
+  int64_t peak_count(int level) const;
+
+  /**
+   * @brief Returns the most detailed level that doesn't have more than one peak per `samples_per_pixel` samples
+   */
+  int GetLevelForSamplesPerPixel(double samples_per_pixel) const;
+
+  /**
+   * @brief Summarize the samples in [start_sample, end_sample) of a channel using the peaks in a level
+   *
+   * This is what a waveform painter should call once per pixel column.
+   */
+  Peak GetPeak(int level, int channel, const int64_t& start_sample, const int64_t& end_sample) const;
+
+private:
+  /**
+   * @brief Layout of the start of a waveform file
+   */
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    int32_t channels;
+    int32_t sample_rate;
+    int32_t level_count;
+    int32_t reserved;
+  };
+
+  /**
+   * @brief Layout of each level's entry in the table after the header
+   */
+  struct Level {
+    int64_t samples_per_peak;
+    int64_t peak_count;
+
+    /// Byte offset of this level's peaks from the start of the file
+    int64_t offset;
+  };
+
+  Waveform();
+
+  QFile file_;
+
+  uchar* map_;
+
+  const Header* header_;
+
+  const Level* levels_;
+
+  friend class WaveformBuilder;
+
+};
+
+/**
+ * @brief Accumulates decoded audio into peaks and writes a waveform file
+ */
+class WaveformBuilder
+{
+public:
+  WaveformBuilder(int channels, int sample_rate);
+
+  /**
+   * @brief Add packed audio to the waveform
+   *
+   * @param count
+   *
+   * Number of samples (per channel) in `data`.
+   */
+  void AddSamples(const uint8_t* data, const olive::SampleFormat& format, int count);
+
+  /**
+   * @brief Write every level of the waveform to a file
+   *
+   * @return
+   *
+   * TRUE on success
+   */
+  bool Save(const QString& filename);
+
+private:
+  /**
+   * @brief Convert a single sample to a float in the range [-1.0, 1.0]
+   */
+  static float SampleToFloat(const uint8_t* data, const olive::SampleFormat& format);
+
+  /**
+   * @brief Add the current group of samples to the most detailed level
+   */
+  void FinishPeak();
+
+  int channels_;
+
+  int sample_rate_;
+
+  /**
+   * @brief Peaks of the most detailed level, interleaved by channel
+   */
+  QVector<Waveform::Peak> base_level_;
+
+  QVector<Waveform::Peak> current_peak_;
+
+  QVector<double> current_sum_squares_;
+
+  int current_sample_count_;
+
+};
+
+#endif // WAVEFORM_H
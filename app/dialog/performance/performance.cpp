@@ -0,0 +1,175 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "performance.h"
+
+#include <QApplication>
+#include <QDialogButtonBox>
+#include <QGridLayout>
+#include <QGroupBox>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+/**
+ * @brief Bytes in a mebibyte and a gibibyte, the units budgets and the quota are shown in
+ */
+const qint64 kMebibyte = Q_INT64_C(1024) * 1024;
+const qint64 kGibibyte = kMebibyte * 1024;
+
+PerformanceDialog::PerformanceDialog(QWidget *parent) :
+  QDialog(parent)
+{
+  QVBoxLayout* layout = new QVBoxLayout(this);
+
+  // Set up threads section
+  QGroupBox* threads_group = new QGroupBox();
+  threads_group->setTitle(tr("Threads"));
+  QGridLayout* threads_layout = new QGridLayout(threads_group);
+  threads_layout->addWidget(new QLabel(tr("Render Threads:")), 0, 0);
+  render_threads_field_ = new QSpinBox();
+  render_threads_field_->setRange(1, 256);
+  threads_layout->addWidget(render_threads_field_, 0, 1);
+  threads_layout->addWidget(new QLabel(tr("Download Threads:")), 1, 0);
+  download_threads_field_ = new QSpinBox();
+  download_threads_field_->setRange(1, 256);
+  threads_layout->addWidget(download_threads_field_, 1, 1);
+  threads_layout->addWidget(new QLabel(tr("Background Task Threads:")), 2, 0);
+  task_threads_field_ = new QSpinBox();
+  task_threads_field_->setRange(1, 256);
+  threads_layout->addWidget(task_threads_field_, 2, 1);
+  layout->addWidget(threads_group);
+
+  // Set up memory section
+  QGroupBox* memory_group = new QGroupBox();
+  memory_group->setTitle(tr("Memory"));
+  QGridLayout* memory_layout = new QGridLayout(memory_group);
+  memory_layout->addWidget(new QLabel(tr("RAM Budget:")), 0, 0);
+  memory_budget_field_ = new QSpinBox();
+  memory_budget_field_->setRange(64, 1048576);
+  memory_budget_field_->setSuffix(tr(" MiB"));
+  memory_layout->addWidget(memory_budget_field_, 0, 1);
+  memory_layout->addWidget(new QLabel(tr("VRAM Budget:")), 1, 0);
+  texture_budget_field_ = new QSpinBox();
+  texture_budget_field_->setRange(64, 1048576);
+  texture_budget_field_->setSuffix(tr(" MiB"));
+  memory_layout->addWidget(texture_budget_field_, 1, 1);
+  memory_layout->addWidget(new QLabel(tr("Disk Cache Quota:")), 2, 0);
+  disk_cache_quota_field_ = new QSpinBox();
+  disk_cache_quota_field_->setRange(1, 1048576);
+  disk_cache_quota_field_->setSuffix(tr(" GiB"));
+  memory_layout->addWidget(disk_cache_quota_field_, 2, 1);
+  layout->addWidget(memory_group);
+
+  // Set up playback section
+  QGroupBox* playback_group = new QGroupBox();
+  playback_group->setTitle(tr("Playback"));
+  QGridLayout* playback_layout = new QGridLayout(playback_group);
+  playback_layout->addWidget(new QLabel(tr("Video Prefetch Depth:")), 0, 0);
+  decoder_prefetch_field_ = new QSpinBox();
+  decoder_prefetch_field_->setRange(0, 256);
+  decoder_prefetch_field_->setSuffix(tr(" frames"));
+  playback_layout->addWidget(decoder_prefetch_field_, 0, 1);
+  playback_layout->addWidget(new QLabel(tr("Image Sequence Lookahead:")), 1, 0);
+  image_sequence_lookahead_field_ = new QSpinBox();
+  image_sequence_lookahead_field_->setRange(0, 256);
+  image_sequence_lookahead_field_->setSuffix(tr(" frames"));
+  playback_layout->addWidget(image_sequence_lookahead_field_, 1, 1);
+  playback_layout->addWidget(new QLabel(tr("Default Cache Priority:")), 2, 0);
+  cache_priority_field_ = new QComboBox();
+  cache_priority_field_->addItem(tr("Speed"), static_cast<int>(olive::kCachePrioritizeSpeed));
+  cache_priority_field_->addItem(tr("Balanced"), static_cast<int>(olive::kCachePrioritizeBalanced));
+  cache_priority_field_->addItem(tr("Disk Space"), static_cast<int>(olive::kCachePrioritizeDiskSpace));
+  cache_priority_field_->addItem(tr("Bandwidth"), static_cast<int>(olive::kCachePrioritizeBandwidth));
+  cache_priority_field_->addItem(tr("Review"), static_cast<int>(olive::kCachePrioritizeReview));
+  playback_layout->addWidget(cache_priority_field_, 2, 1);
+  layout->addWidget(playback_group);
+
+  // Set up dialog buttons
+  QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
+  buttons->setCenterButtons(true);
+  QPushButton* auto_tune_button = buttons->addButton(tr("Auto-Tune"), QDialogButtonBox::ActionRole);
+  connect(auto_tune_button, SIGNAL(clicked(bool)), this, SLOT(AutoTune()));
+  connect(buttons, SIGNAL(accepted()), this, SLOT(accept()));
+  connect(buttons, SIGNAL(rejected()), this, SLOT(reject()));
+  layout->addWidget(buttons);
+
+  setWindowTitle(tr("Performance"));
+
+  SetFields(olive::performance_profile.values());
+}
+
+void PerformanceDialog::accept()
+{
+  PerformanceProfile::Values values;
+
+  values.render_threads = render_threads_field_->value();
+  values.download_threads = download_threads_field_->value();
+  values.task_threads = task_threads_field_->value();
+  values.memory_budget = memory_budget_field_->value() * kMebibyte;
+  values.texture_budget = texture_budget_field_->value() * kMebibyte;
+  values.disk_cache_quota = disk_cache_quota_field_->value() * kGibibyte;
+  values.decoder_prefetch_depth = decoder_prefetch_field_->value();
+  values.image_sequence_lookahead = image_sequence_lookahead_field_->value();
+  values.cache_priority = static_cast<olive::CachePriority>(cache_priority_field_->currentData().toInt());
+
+  olive::performance_profile.SetValues(values);
+
+  if (!olive::performance_profile.Save()) {
+    QMessageBox::warning(this,
+                         tr("Failed to save"),
+                         tr("These settings have been applied, but couldn't be saved to \"%1\"").arg(
+                           PerformanceProfile::Filename()));
+  }
+
+  QDialog::accept();
+}
+
+void PerformanceDialog::SetFields(const PerformanceProfile::Values &values)
+{
+  render_threads_field_->setValue(values.render_threads);
+  download_threads_field_->setValue(values.download_threads);
+  task_threads_field_->setValue(values.task_threads);
+  memory_budget_field_->setValue(static_cast<int>(values.memory_budget / kMebibyte));
+  texture_budget_field_->setValue(static_cast<int>(values.texture_budget / kMebibyte));
+  disk_cache_quota_field_->setValue(static_cast<int>(values.disk_cache_quota / kGibibyte));
+  decoder_prefetch_field_->setValue(values.decoder_prefetch_depth);
+  image_sequence_lookahead_field_->setValue(values.image_sequence_lookahead);
+  cache_priority_field_->setCurrentIndex(cache_priority_field_->findData(static_cast<int>(values.cache_priority)));
+}
+
+void PerformanceDialog::AutoTune()
+{
+  QApplication::setOverrideCursor(Qt::WaitCursor);
+  setEnabled(false);
+
+  bool tuned = olive::performance_profile.AutoTune();
+
+  setEnabled(true);
+  QApplication::restoreOverrideCursor();
+
+  if (!tuned) {
+    QMessageBox::critical(this, tr("Auto-Tune Failed"), tr("The benchmark couldn't be run on this machine"));
+  }
+
+  // Either way, the values it applied are shown
+  SetFields(olive::performance_profile.values());
+}
@@ -0,0 +1,74 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PERFORMANCEDIALOG_H
+#define PERFORMANCEDIALOG_H
+
+#include <QComboBox>
+#include <QDialog>
+#include <QSpinBox>
+
+#include "config/performanceprofile.h"
+
+/**
+ * @brief A dialog for editing this machine's PerformanceProfile
+ *
+ * Accepting the dialog applies the values straight away and saves them, nothing has to be restarted.
+ */
+class PerformanceDialog : public QDialog
+{
+  Q_OBJECT
+public:
+  PerformanceDialog(QWidget* parent = nullptr);
+
+public slots:
+  /**
+   * @brief Function called when the user presses OK
+   */
+  virtual void accept() override;
+
+private:
+  /**
+   * @brief Fill every field in from `values`
+   */
+  void SetFields(const PerformanceProfile::Values& values);
+
+  QSpinBox* render_threads_field_;
+  QSpinBox* download_threads_field_;
+  QSpinBox* task_threads_field_;
+
+  QSpinBox* memory_budget_field_;
+  QSpinBox* texture_budget_field_;
+  QSpinBox* disk_cache_quota_field_;
+
+  QSpinBox* decoder_prefetch_field_;
+  QSpinBox* image_sequence_lookahead_field_;
+
+  QComboBox* cache_priority_field_;
+
+private slots:
+  /**
+   * @brief Run PerformanceProfile::AutoTune() and show the values it chose
+   */
+  void AutoTune();
+
+};
+
+#endif // PERFORMANCEDIALOG_H
@@ -31,15 +31,67 @@ extern "C" {
 #include <libavfilter/avfilter.h>
 }
 
+#include <cstring>
+#include <memory>
 #include <QApplication>
 #include <QSurfaceFormat>
 
 #include "core.h"
 #include "common/debug.h"
+#include "common/ringlog.h"
+#include "decoder/remote/decoderworker.h"
+
+int main(int argc, char *argv[]) {
+  // Decoder worker processes (see RemoteDecoder) only need enough of the application to decode
+  if (argc > 1 && !strcmp(argv[1], "--decoder-worker")) {
+    QCoreApplication worker_app(argc, argv);
+
+    // Indexes are found in the same place as the editor's
+    QCoreApplication::setOrganizationName("olivevideoeditor.org");
+    QCoreApplication::setOrganizationDomain("olivevideoeditor.org");
+    QCoreApplication::setApplicationName("Olive");
+
+#if LIBAVFORMAT_VERSION_INT < AV_VERSION_INT(58, 9, 100)
+    av_register_all();
+#endif
+
+    return DecoderWorker().Run();
+  }
+
+  // Rendering from the command line doesn't need widgets, so check for it before the application is created
+  bool headless = false;
+
+  for (int i=1;i<argc;i++) {
+    if (!strcmp(argv[i], "--render")
+        || !strcmp(argv[i], "--render-range")
+        || !strcmp(argv[i], "--render-farm")
+        || !strcmp(argv[i], "--auto-tune")
+        || !strcmp(argv[i], "--benchmark")) {
+      headless = true;
+      break;
+    }
+  }
 
-int main(int argc, char *argv[]) {  
   // Create application instance
-  QApplication a(argc, argv);
+  std::unique_ptr<QGuiApplication> a;
+
+  if (headless) {
+#ifdef Q_OS_LINUX
+    // Without a display server, fall back to a platform that can still provide an OpenGL context
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")
+        && qEnvironmentVariableIsEmpty("DISPLAY")
+        && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+      qputenv("QT_QPA_PLATFORM", "minimalegl");
+    }
+#endif
+
+    a.reset(new QGuiApplication(argc, argv));
+  } else {
+    // Panels such as the scopes sample the viewer's textures, and docks can be floated into windows of their own
+    QCoreApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+
+    a.reset(new QApplication(argc, argv));
+  }
 
   // Set application metadata
   QCoreApplication::setOrganizationName("olivevideoeditor.org");
@@ -63,6 +115,9 @@ int main(int argc, char *argv[]) {
   // Set up debug handler
   qInstallMessageHandler(DebugHandler);
 
+  // Hot paths log to rings that are sent to the handler in the background
+  olive::ring_log.Start();
+
   // Set OpenGL display profile (3.2 Core)
   QSurfaceFormat format;
   format.setVersion(3, 2);
@@ -81,11 +136,19 @@ int main(int argc, char *argv[]) {
   // Start core
   olive::core.Start();
 
-  // Run application loop and receive exit code
-  int exit_code = a.exec();
+  // Run application loop (or the headless render) and receive exit code
+  int exit_code;
+
+  if (olive::core.IsHeadless()) {
+    exit_code = olive::core.RunHeadless();
+  } else {
+    exit_code = a->exec();
+  }
 
   // Clear core memory
   olive::core.Stop();
 
+  olive::ring_log.Stop();
+
   return exit_code;
 }
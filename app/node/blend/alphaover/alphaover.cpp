@@ -49,7 +49,7 @@ void AlphaOverBlend::Release()
 {
 }
 
-QVariant AlphaOverBlend::Value(NodeOutput *param, const rational &time)
+NodeValue AlphaOverBlend::Value(NodeOutput *param, const rational &time)
 {
   // Find the current Renderer instance
   RenderInstance* renderer = RendererProcessor::CurrentInstance();
@@ -61,17 +61,20 @@ QVariant AlphaOverBlend::Value(NodeOutput *param, const rational &time)
 
   // The only parameter should be texture output, but for future proofing we put this here
   if (param == texture_output()) {
-    RenderTexturePtr base = base_input()->get_value(time).value<RenderTexturePtr>();
-    RenderTexturePtr blend = blend_input()->get_value(time).value<RenderTexturePtr>();
+    RenderTexturePtr base = base_input()->get_value(time).takeTexture();
+    RenderTexturePtr blend = blend_input()->get_value(time).takeTexture();
 
     if (base == nullptr && blend == nullptr) {
       return 0;
     } else if (base == nullptr) {
-      return QVariant::fromValue(blend);
+      return NodeValue(std::move(blend));
     } else if (blend == nullptr) {
-      return QVariant::fromValue(base);
+      return NodeValue(std::move(base));
     }
 
+    // We draw into base, so any operations deferred on it have to be in its pixels first
+    base = renderer->ResolvePendingOps(base);
+
     // Attach framebuffer to the backbuffer of base
     renderer->buffer()->Attach(base);
     renderer->buffer()->Bind();
@@ -82,8 +85,18 @@ QVariant AlphaOverBlend::Value(NodeOutput *param, const rational &time)
     // Set compositing strategy to alpha over
     renderer->context()->functions()->glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Draw blend on base
-    olive::gl::Blit(renderer->default_pipeline());
+    // Draw blend on base, applying blend's deferred opacity in the same pass
+    ShaderPtr pipeline = renderer->default_pipeline();
+
+    pipeline->bind();
+    pipeline->setUniformValue("opacity", blend->pending_opacity());
+    pipeline->release();
+
+    olive::gl::Blit(pipeline);
+
+    pipeline->bind();
+    pipeline->setUniformValue("opacity", 1.0f);
+    pipeline->release();
 
     // Release all
     blend->Release();
@@ -92,7 +105,7 @@ QVariant AlphaOverBlend::Value(NodeOutput *param, const rational &time)
 
     // Return base texture which now has blend composited on top
     // NOTE: Blend texture will be implicitly deleted here (if it's not used anywhere else)
-    return QVariant::fromValue(base);
+    return NodeValue(std::move(base));
   }
 
   return 0;
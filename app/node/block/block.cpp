@@ -70,6 +70,8 @@ void Block::set_length(const rational &length)
 
   Unlock();
 
+  SetModified(true);
+
   Refresh();
 }
 
@@ -88,13 +90,13 @@ NodeInput *Block::previous_input()
   return previous_input_;
 }
 
-QVariant Block::Value(NodeOutput *output, const rational &time)
+NodeValue Block::Value(NodeOutput *output, const rational &time)
 {
   Q_UNUSED(time)
 
   if (output == block_output_) {
     // Simply set the output value to a pointer to this Block
-    return PtrToValue(this);
+    return NodeValue::FromPtr(this);
   }
 
   return 0;
@@ -172,6 +174,8 @@ void Block::set_media_in(const rational &media_in)
   if (media_in_ != media_in) {
     media_in_ = media_in;
 
+    SetModified(true);
+
     // Signal that this clips contents have changed
     SendInvalidateCache(in(), out());
   }
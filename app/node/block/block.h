@@ -92,7 +92,7 @@ signals:
   void Refreshed();
 
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
   rational SequenceToMediaTime(const rational& sequence_time);
 
@@ -27,6 +27,18 @@ ClipBlock::ClipBlock()
   texture_input_ = new NodeInput("tex_in");
   texture_input_->add_data_input(NodeInput::kTexture);
   AddParameter(texture_input_);
+
+  volume_input_ = new NodeInput("volume_in");
+  volume_input_->add_data_input(NodeParam::kFloat);
+  volume_input_->set_value(100.0);
+  volume_input_->set_minimum(0.0);
+  AddParameter(volume_input_);
+
+  pan_input_ = new NodeInput("pan_in");
+  pan_input_->add_data_input(NodeParam::kFloat);
+  pan_input_->set_minimum(-100.0);
+  pan_input_->set_maximum(100.0);
+  AddParameter(pan_input_);
 }
 
 Block *ClipBlock::copy()
@@ -67,7 +79,23 @@ NodeInput *ClipBlock::texture_input()
   return texture_input_;
 }
 
-QVariant ClipBlock::Value(NodeOutput* param, const rational& time)
+NodeInput *ClipBlock::volume_input()
+{
+  return volume_input_;
+}
+
+NodeInput *ClipBlock::pan_input()
+{
+  return pan_input_;
+}
+
+void ClipBlock::Retranslate()
+{
+  volume_input_->set_name(tr("Volume"));
+  pan_input_->set_name(tr("Pan"));
+}
+
+NodeValue ClipBlock::Value(NodeOutput* param, const rational& time)
 {
   if (param == texture_output()) {
     // If the time retrieved is within this block, get texture information
@@ -95,6 +123,11 @@ void ClipBlock::InvalidateCache(const rational &start_range, const rational &end
     start = qMax(start, in());
     end = qMin(end, out());
 
+    // The change was entirely in media this clip doesn't show (e.g. a keyframe outside of its trim)
+    if (start > end) {
+      return;
+    }
+
     Node::InvalidateCache(start, end, from);
   } else {
     // Otherwise, pass signal along normally
@@ -102,6 +135,37 @@ void ClipBlock::InvalidateCache(const rational &start_range, const rational &end
   }
 }
 
+void ClipBlock::StaticRange(NodeOutput *output, const rational &time, rational *in, rational *out)
+{
+  if (output != texture_output() || !texture_input_->IsConnected() || time < this->in() || time >= this->out()) {
+    Node::StaticRange(output, time, in, out);
+    return;
+  }
+
+  InputsStaticRange(time, in, out);
+
+  // Limited to this clip, beyond it the track shows something else
+  IntersectStaticRange(time, this->in(), this->out(), in, out);
+
+  if (*in == *out) {
+    return;
+  }
+
+  // Find the media's range and convert it back to sequence time
+  rational media_in, media_out;
+  texture_input_->get_connected_node()->StaticRange(texture_input_->get_connected_output(),
+                                                    SequenceToMediaTime(time),
+                                                    &media_in,
+                                                    &media_out);
+
+  if (media_in == media_out) {
+    *in = time;
+    *out = time;
+  } else {
+    IntersectStaticRange(time, MediaToSequenceTime(media_in), MediaToSequenceTime(media_out), in, out);
+  }
+}
+
 QList<NodeDependency> ClipBlock::RunDependencies(NodeOutput *output, const rational &time)
 {
   QList<NodeDependency> deps;
@@ -42,16 +42,34 @@ public:
 
   NodeInput* texture_input();
 
+  /**
+   * @brief Volume of the clip's audio in percent (100 is unity)
+   */
+  NodeInput* volume_input();
+
+  /**
+   * @brief Pan of the clip's audio in percent, from -100 (left) to 100 (right)
+   */
+  NodeInput* pan_input();
+
+  virtual void Retranslate() override;
+
   virtual void InvalidateCache(const rational &start_range, const rational &end_range, NodeInput *from = nullptr) override;
 
   virtual QList<NodeDependency> RunDependencies(NodeOutput *output, const rational &time) override;
 
+  virtual void StaticRange(NodeOutput* output, const rational& time, rational* in, rational* out) override;
+
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
 private:
   NodeInput* texture_input_;
 
+  NodeInput* volume_input_;
+
+  NodeInput* pan_input_;
+
 };
 
 #endif // TIMELINEBLOCK_H
@@ -21,7 +21,6 @@
 #include "opacity.h"
 
 #include "node/processor/renderer/renderer.h"
-#include "render/gl/functions.h"
 #include "render/rendertexture.h"
 
 OpacityNode::OpacityNode()
@@ -62,7 +61,7 @@ QString OpacityNode::id()
   return "org.olivevideoeditor.Olive.opacity";
 }
 
-QVariant OpacityNode::Value(NodeOutput *output, const rational &time)
+NodeValue OpacityNode::Value(NodeOutput *output, const rational &time)
 {
   // Find the current Renderer instance
   RenderInstance* renderer = RendererProcessor::CurrentInstance();
@@ -73,42 +72,17 @@ QVariant OpacityNode::Value(NodeOutput *output, const rational &time)
   }
 
   if (output == texture_output_) {
-    RenderTexturePtr input_tex = texture_input_->get_value(time).value<RenderTexturePtr>();
+    RenderTexturePtr input_tex = texture_input_->get_value(time).takeTexture();
 
     if (input_tex == nullptr) {
       return 0;
     }
 
-    // Attach texture's back buffer as frame buffer
-    renderer->buffer()->AttachBackBuffer(input_tex);
-    renderer->buffer()->Bind();
+    // Rather than drawing a whole pass just to multiply by opacity, defer it to whatever samples this texture next
+    // (which also merges consecutive opacity nodes into one multiplication)
+    input_tex->set_pending_opacity(input_tex->pending_opacity() * opacity_input_->get_value(time).toFloat() * 0.01f);
 
-    // Bind texture's front buffer to draw with
-    input_tex->Bind();
-
-    // Set opacity to value
-    ShaderPtr pipeline = renderer->default_pipeline();
-    pipeline->bind();
-    pipeline->setUniformValue("opacity", opacity_input_->get_value(time).toFloat()*0.01f);
-    pipeline->release();
-
-    renderer->context()->functions()->glBlendFunc(GL_ONE, GL_ZERO);
-
-    // Blit
-    olive::gl::Blit(pipeline);
-
-    // Reset to full opacity
-    pipeline->bind();
-    pipeline->setUniformValue("opacity", 1.0f);
-    pipeline->release();
-
-    input_tex->Release();
-    renderer->buffer()->Release();
-    renderer->buffer()->Detach();
-
-    input_tex->SwapFrontAndBack();
-
-    return QVariant::fromValue(input_tex);
+    return NodeValue(std::move(input_tex));
   }
 
   return 0;
@@ -119,6 +93,13 @@ void OpacityNode::Retranslate()
   opacity_input_->set_name(tr("Opacity"));
 }
 
+bool OpacityNode::IsIdentity(NodeOutput *output, const rational &time)
+{
+  return output == texture_output_
+      && !opacity_input_->IsConnected()
+      && qFuzzyCompare(opacity_input_->get_value(time).toFloat(), 100.0f);
+}
+
 NodeInput *OpacityNode::texture_input()
 {
   return texture_input_;
@@ -36,10 +36,12 @@ public:
 
   virtual QString id() override;
 
-  virtual QVariant Value(NodeOutput *output, const rational &time) override;
+  virtual NodeValue Value(NodeOutput *output, const rational &time) override;
 
   virtual void Retranslate() override;
 
+  virtual bool IsIdentity(NodeOutput* output, const rational& time) override;
+
   NodeInput* texture_input();
 
   NodeOutput* texture_output();
@@ -20,7 +20,6 @@
 
 #include "transform.h"
 
-#include <QMatrix4x4>
 #include <QVector2D>
 
 TransformDistort::TransformDistort()
@@ -42,6 +41,10 @@ TransformDistort::TransformDistort()
   anchor_input_->add_data_input(NodeParam::kVec2);
   AddParameter(anchor_input_);
 
+  matrix_input_ = new NodeInput("matrix_in");
+  matrix_input_->add_data_input(NodeParam::kMatrix);
+  AddParameter(matrix_input_);
+
   matrix_output_ = new NodeOutput("matrix_out");
   matrix_output_->set_data_type(NodeParam::kMatrix);
   AddParameter(matrix_output_);
@@ -67,6 +70,11 @@ QString TransformDistort::Description()
   return tr("Apply transformations to position, rotation, and scale.");
 }
 
+NodeInput *TransformDistort::matrix_input()
+{
+  return matrix_input_;
+}
+
 NodeOutput *TransformDistort::matrix_output()
 {
   return matrix_output_;
@@ -78,28 +86,56 @@ void TransformDistort::Retranslate()
   rotation_input_->set_name(tr("Rotation"));
   scale_input_->set_name(tr("Scale"));
   anchor_input_->set_name(tr("Anchor Point"));
+  matrix_input_->set_name(tr("Matrix"));
 }
 
-QVariant TransformDistort::Value(NodeOutput *output, const rational &time)
+bool TransformDistort::IsTimeInvariant(NodeOutput *output)
 {
-  if (output == matrix_output_) {
-    QMatrix4x4 mat;
+  Q_UNUSED(output)
 
-    // Position translate
-    QVector2D pos = position_input_->get_value(time).value<QVector2D>();
-    mat.translate(pos);
-
-    // Rotation
-    mat.rotate(rotation_input_->get_value(time).toFloat(), 0, 0, 1);
+  return InputsAreTimeInvariant();
+}
 
-    // Scale
-    mat.scale(scale_input_->get_value(time).value<QVector2D>()*0.01f);
+bool TransformDistort::IsIdentity(NodeOutput *output, const rational &time)
+{
+  if (output != matrix_output_
+      || position_input_->IsConnected()
+      || rotation_input_->IsConnected()
+      || scale_input_->IsConnected()
+      || anchor_input_->IsConnected()) {
+    return false;
+  }
 
-    // Anchor Point
-    mat.translate(anchor_input_->get_value(time).value<QVector2D>());
+  // Passes the connected matrix through untouched
+  return LocalMatrix(time).isIdentity();
+}
 
-    return mat;
+NodeValue TransformDistort::Value(NodeOutput *output, const rational &time)
+{
+  if (output == matrix_output_) {
+    // Compose with whatever this is stacked on so the media is only ever sampled with one matrix
+    return LocalMatrix(time) * matrix_input_->get_value(time).toMatrix();
   }
 
   return 0;
 }
+
+QMatrix4x4 TransformDistort::LocalMatrix(const rational &time)
+{
+  QMatrix4x4 mat;
+
+  // Position translate
+  QVector2D pos = position_input_->get_value(time).toVec2();
+  mat.translate(pos);
+
+  // Rotation
+  mat.rotate(rotation_input_->get_value(time).toFloat(), 0, 0, 1);
+
+  // Scale
+  mat.scale(scale_input_->get_value(time).toVec2()*0.01f);
+
+  // Anchor Point
+  mat.translate(anchor_input_->get_value(time).toVec2());
+
+  return mat;
+}
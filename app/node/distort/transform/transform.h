@@ -21,8 +21,16 @@
 #ifndef TRANSFORMDISTORT_H
 #define TRANSFORMDISTORT_H
 
+#include <QMatrix4x4>
+
 #include "node/node.h"
 
+/**
+ * @brief Outputs a matrix from position, rotation, scale and anchor point
+ *
+ * Transforms can be chained through matrix_input(): each one composes its matrix with the one connected to it, so
+ * however many are stacked, the media they end up in (see MediaInput) is only resampled once with the final matrix.
+ */
 class TransformDistort : public Node
 {
   Q_OBJECT
@@ -34,14 +42,28 @@ public:
   virtual QString Category() override;
   virtual QString Description() override;
 
+  /**
+   * @brief Matrix of the transform this one is applied on top of (identity if nothing is connected)
+   */
+  NodeInput* matrix_input();
+
   NodeOutput* matrix_output();
 
   virtual void Retranslate() override;
 
+  virtual bool IsTimeInvariant(NodeOutput* output) override;
+
+  virtual bool IsIdentity(NodeOutput* output, const rational& time) override;
+
 protected:
-  virtual QVariant Value(NodeOutput *output, const rational &time) override;
+  virtual NodeValue Value(NodeOutput *output, const rational &time) override;
 
 private:
+  /**
+   * @brief Matrix of this node's own parameters, without matrix_input()
+   */
+  QMatrix4x4 LocalMatrix(const rational& time);
+
   NodeInput* position_input_;
 
   NodeInput* rotation_input_;
@@ -50,6 +72,8 @@ private:
 
   NodeInput* anchor_input_;
 
+  NodeInput* matrix_input_;
+
   NodeOutput* matrix_output_;
 
 };
@@ -0,0 +1,104 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "executionplan.h"
+
+#include "node/node.h"
+
+NodeExecutionPlan::NodeExecutionPlan()
+{
+}
+
+NodeExecutionPlan NodeExecutionPlan::Compile(NodeOutput *output, const rational &time)
+{
+  NodeExecutionPlan plan;
+
+  QList<NodeDependency> deps = output->parent()->RunDependencies(output, time);
+
+  foreach (const NodeDependency& dep, deps) {
+    plan.AddDependency(dep, &plan.output_deps_);
+  }
+
+  return plan;
+}
+
+const QList<NodeDependency> &NodeExecutionPlan::steps() const
+{
+  return steps_;
+}
+
+const QVector<int> &NodeExecutionPlan::StepDependencies(int index) const
+{
+  return step_deps_.at(index);
+}
+
+const QVector<int> &NodeExecutionPlan::OutputDependencies() const
+{
+  return output_deps_;
+}
+
+int NodeExecutionPlan::StepCount() const
+{
+  return steps_.size();
+}
+
+bool NodeExecutionPlan::IsEmpty() const
+{
+  return steps_.isEmpty();
+}
+
+void NodeExecutionPlan::AddDependency(const NodeDependency &dep, QVector<int> *steps)
+{
+  // Dependencies shared by several nodes only need evaluating once
+  for (int i=0;i<steps_.size();i++) {
+    if (steps_.at(i).node() == dep.node() && steps_.at(i).time() == dep.time()) {
+      if (!steps->contains(i)) {
+        steps->append(i);
+      }
+      return;
+    }
+  }
+
+  Node* node = dep.node()->parent();
+
+  // Add everything this dependency needs first so that it always comes after them
+  QVector<int> deps;
+
+  QList<NodeDependency> children = node->RunDependencies(dep.node(), dep.time());
+
+  foreach (const NodeDependency& child, children) {
+    AddDependency(child, &deps);
+  }
+
+  if (node->IsIdentity(dep.node(), dep.time())) {
+    // Not worth a step of its own, whatever needs this needs its dependencies instead
+    foreach (int child_step, deps) {
+      if (!steps->contains(child_step)) {
+        steps->append(child_step);
+      }
+    }
+    return;
+  }
+
+  steps_.append(dep);
+  step_deps_.append(deps);
+
+  steps->append(steps_.size() - 1);
+}
@@ -0,0 +1,101 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef NODEEXECUTIONPLAN_H
+#define NODEEXECUTIONPLAN_H
+
+#include <QList>
+#include <QVector>
+
+#include "node/dependency.h"
+
+/**
+ * @brief A flattened, topologically sorted schedule of everything an output depends on at a given time
+ *
+ * Evaluating a node graph by calling NodeOutput::get_value() on the final output recurses all the way down the graph
+ * through Node::Value() and NodeInput::get_value(). A plan instead lists every dependency (found through
+ * Node::RunDependencies()) as a step, ordered so that every step comes after the steps it depends on, along with the
+ * indices of those steps.
+ *
+ * Evaluating the steps in order (with NodeOutput::get_value()) means every node's inputs are already cached by the
+ * time it runs, so evaluation never recurses. Any step can also be evaluated as soon as its own dependencies are done,
+ * so independent branches (e.g. the tracks of a composite) can be evaluated in parallel.
+ *
+ * The plan doesn't include the output itself, which should be evaluated once every step is done. Identity nodes (see
+ * Node::IsIdentity()) don't get steps either, the steps below them take their place and they're evaluated inline by
+ * whatever requests their value.
+ */
+class NodeExecutionPlan
+{
+public:
+  NodeExecutionPlan();
+
+  /**
+   * @brief Compile the plan for `output` at `time`
+   *
+   * The nodes involved should be locked while compiling since this walks the graph.
+   */
+  static NodeExecutionPlan Compile(NodeOutput* output, const rational& time);
+
+  /**
+   * @brief Every dependency, in an order where each comes after everything it depends on
+   */
+  const QList<NodeDependency>& steps() const;
+
+  /**
+   * @brief Indices (into steps()) of the steps that step `index` depends on
+   */
+  const QVector<int>& StepDependencies(int index) const;
+
+  /**
+   * @brief Indices (into steps()) of the steps the output itself depends on
+   */
+  const QVector<int>& OutputDependencies() const;
+
+  /**
+   * @brief Returns the total number of dependencies in the plan
+   */
+  int StepCount() const;
+
+  /**
+   * @brief Returns TRUE if the output has no dependencies to evaluate first
+   */
+  bool IsEmpty() const;
+
+private:
+  /**
+   * @brief Add a dependency and everything below it to the plan
+   *
+   * @param steps
+   *
+   * The indices of the steps evaluating the dependency needs are added here: normally just its own, or those of its
+   * dependencies if it's an identity node
+   */
+  void AddDependency(const NodeDependency& dep, QVector<int>* steps);
+
+  QList<NodeDependency> steps_;
+
+  QVector< QVector<int> > step_deps_;
+
+  QVector<int> output_deps_;
+
+};
+
+#endif // NODEEXECUTIONPLAN_H
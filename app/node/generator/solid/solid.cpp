@@ -20,11 +20,15 @@
 
 #include "solid.h"
 
-SolidGenerator::SolidGenerator() :
-  texture_(nullptr)
+#include <QColor>
+
+#include "node/processor/renderer/renderer.h"
+
+SolidGenerator::SolidGenerator()
 {
   color_input_ = new NodeInput("color_in");
   color_input_->add_data_input(NodeParam::kColor);
+  color_input_->set_value(QColor(Qt::black));
   AddParameter(color_input_);
 
   texture_output_ = new NodeOutput("tex_out");
@@ -52,28 +56,44 @@ QString SolidGenerator::Description()
   return tr("Generate a solid color.");
 }
 
+NodeInput *SolidGenerator::color_input()
+{
+  return color_input_;
+}
+
 NodeOutput *SolidGenerator::texture_output()
 {
   return texture_output_;
 }
 
-QVariant SolidGenerator::Value(NodeOutput *output, const rational &time)
+NodeValue SolidGenerator::Value(NodeOutput *output, const rational &time)
 {
-  Q_UNUSED(output)
-  Q_UNUSED(time)
+  RenderInstance* renderer = RendererProcessor::CurrentInstance();
 
-  /*
-  // FIXME: Test code
-  if (texture_ == nullptr) {
-    QImage img(1920, 1080, QImage::Format_RGBA8888_Premultiplied);
-    img.fill(Qt::red);
-
-    texture_ = new QOpenGLTexture(img);
+  if (renderer == nullptr || output != texture_output_) {
+    return 0;
   }
 
-  texture_output_->set_value(texture_->textureId());
-  // End test code
-  */
+  QColor color = color_input_->get_value(time).toColor();
+
+  RenderTexturePtr texture = renderer->texture_pool()->Get(renderer->width(),
+                                                           renderer->height(),
+                                                           renderer->format(),
+                                                           RenderTexture::kDoubleBuffer);
+
+  renderer->buffer()->Attach(texture);
+  renderer->buffer()->Bind();
+
+  // Textures are composited as premultiplied alpha
+  QOpenGLFunctions* f = renderer->context()->functions();
+  f->glClearColor(static_cast<GLfloat>(color.redF() * color.alphaF()),
+                  static_cast<GLfloat>(color.greenF() * color.alphaF()),
+                  static_cast<GLfloat>(color.blueF() * color.alphaF()),
+                  static_cast<GLfloat>(color.alphaF()));
+  f->glClear(GL_COLOR_BUFFER_BIT);
+
+  renderer->buffer()->Release();
+  renderer->buffer()->Detach();
 
-  return 0;
+  return NodeValue(std::move(texture));
 }
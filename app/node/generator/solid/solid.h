@@ -21,8 +21,6 @@
 #ifndef SOLIDGENERATOR_H
 #define SOLIDGENERATOR_H
 
-#include <QOpenGLTexture>
-
 #include "node/node.h"
 
 /**
@@ -39,17 +37,17 @@ public:
   virtual QString Category() override;
   virtual QString Description() override;
 
+  NodeInput* color_input();
+
   NodeOutput* texture_output();
 
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
 private:
   NodeInput* color_input_;
 
   NodeOutput* texture_output_;
-
-  QOpenGLTexture* texture_;
 };
 
 #endif // SOLIDGENERATOR_H
@@ -25,13 +25,16 @@
 
 NodeInput::NodeInput(const QString& id) :
   NodeParam(id),
+  keyframe_hint_(-1),
   keyframing_(false),
   dependent_(true),
   has_minimum_(false),
   has_maximum_(false)
 {
   // Have at least one keyframe/value active at any time
-  keyframes_.append(NodeKeyframe());
+  QList<NodeKeyframe> keyframes;
+  keyframes.append(NodeKeyframe());
+  PublishKeyframes(keyframes);
 }
 
 NodeParam::Type NodeInput::type()
@@ -42,6 +45,11 @@ NodeParam::Type NodeInput::type()
 void NodeInput::add_data_input(const NodeParam::DataType &data_type)
 {
   inputs_.append(data_type);
+
+  // The first data type is the one values are stored in, so the track has to be rebuilt for it
+  if (inputs_.size() == 1) {
+    PublishKeyframes(std::atomic_load(&keyframes_)->keyframes());
+  }
 }
 
 bool NodeInput::can_accept_type(const NodeParam::DataType &data_type)
@@ -69,45 +77,61 @@ Node *NodeInput::get_connected_node()
   return nullptr;
 }
 
-QVariant NodeInput::get_value(const rational& time)
+NodeValue NodeInput::get_value(const rational& time)
 {
-  QVariant v;
+  NodeValue v;
+
+  if (GetCachedValue(time, &v)) {
+    return v;
+  }
+
+  int generation = CacheGeneration();
+
+  // The range of time the value is constant for, just this time unless it's known to be static
+  rational in = time;
+  rational out = time;
 
-  if (time_ != time || !value_caching_) {
-    // Retrieve the value
-    if (!edges_.isEmpty()) {
-      // A connection - use the output of the connected Node
-      value_ = get_connected_output()->get_value(time);
+  // Retrieve the value
+  if (!edges_.isEmpty()) {
+    // A connection - use the output of the connected Node
+    v = get_connected_output()->get_value(time);
+  } else {
+    // No connections - use the internal value from the latest published snapshot
+    std::shared_ptr<const NodeKeyframeTrack> track = std::atomic_load(&keyframes_);
+
+    if (keyframing_ && track->count() > 1) {
+      int hint = keyframe_hint_.loadAcquire();
+      v = track->Value(time, &hint, &in, &out);
+      keyframe_hint_.storeRelease(hint);
     } else {
-      // No connections - use the internal value
-      // FIXME: Re-implement keyframing
-      value_ = keyframes_.first().value();
+      // Not animated, so this value holds until the input is changed (which invalidates the cache)
+      v = track->FirstValue();
+      in = RATIONAL_MIN;
+      out = RATIONAL_MAX;
     }
-
-    time_ = time;
   }
 
-  v = value_;
+  InsertCachedValue(time, in, out, generation, v);
 
   return v;
 }
 
 void NodeInput::set_value(const QVariant &value)
 {
-  bool lock_mutex = (parent() != nullptr);
-
-  if (lock_mutex) parent()->Lock();
-
   if (keyframing()) {
     // FIXME: Keyframing code using time()
   } else {
-    // Not keyframing, so invalidate entire time length
-    keyframes_.first().set_value(value);
+    // Copy the current keyframes, modify the copy, and publish it. Render threads reading the old snapshot carry on
+    // with it undisturbed, so there's no need to wait for them by locking the Node.
+    QList<NodeKeyframe> keyframes = std::atomic_load(&keyframes_)->keyframes();
+
+    keyframes[0].set_value(value);
 
+    PublishKeyframes(keyframes);
+
+    // Not keyframing, so invalidate entire time length
     emit ValueChanged(RATIONAL_MIN, RATIONAL_MAX);
   }
-
-  if (lock_mutex) parent()->Unlock();
 }
 
 bool NodeInput::keyframing()
@@ -115,9 +139,145 @@ bool NodeInput::keyframing()
   return keyframing_;
 }
 
+bool NodeInput::IsAnimated()
+{
+  // Matches the check in get_value()
+  return keyframing_ && std::atomic_load(&keyframes_)->count() > 1;
+}
+
+void NodeInput::StaticRange(const rational &time, rational *in, rational *out)
+{
+  std::shared_ptr<const NodeKeyframeTrack> track = std::atomic_load(&keyframes_);
+
+  if (keyframing_ && track->count() > 1) {
+    int hint = keyframe_hint_.loadAcquire();
+    track->Value(time, &hint, in, out);
+    keyframe_hint_.storeRelease(hint);
+  } else {
+    *in = RATIONAL_MIN;
+    *out = RATIONAL_MAX;
+  }
+}
+
 void NodeInput::set_keyframing(bool k)
 {
+  if (keyframing_ == k) {
+    return;
+  }
+
+  bool was_animated = IsAnimated();
+
   keyframing_ = k;
+
+  // Switching between the first value and the animation changes the value everywhere
+  if (IsAnimated() != was_animated) {
+    emit ValueChanged(RATIONAL_MIN, RATIONAL_MAX);
+  }
+}
+
+QList<NodeKeyframe> NodeInput::keyframes()
+{
+  return std::atomic_load(&keyframes_)->keyframes();
+}
+
+void NodeInput::insert_keyframe(const NodeKeyframe &key)
+{
+  std::shared_ptr<const NodeKeyframeTrack> old_track = std::atomic_load(&keyframes_);
+
+  QList<NodeKeyframe> keyframes = old_track->keyframes();
+
+  bool replaced = false;
+
+  for (int i=0;i<keyframes.size();i++) {
+    if (keyframes.at(i).time() == key.time()) {
+      keyframes[i] = key;
+      replaced = true;
+      break;
+    }
+  }
+
+  if (!replaced) {
+    keyframes.append(key);
+  }
+
+  PublishKeyframes(keyframes);
+
+  EmitKeyframeRangeChanged(old_track, std::atomic_load(&keyframes_), key.time());
+}
+
+void NodeInput::remove_keyframe(const rational &time)
+{
+  std::shared_ptr<const NodeKeyframeTrack> old_track = std::atomic_load(&keyframes_);
+
+  QList<NodeKeyframe> keyframes = old_track->keyframes();
+
+  if (keyframes.size() < 2) {
+    return;
+  }
+
+  for (int i=0;i<keyframes.size();i++) {
+    if (keyframes.at(i).time() == time) {
+      keyframes.removeAt(i);
+
+      PublishKeyframes(keyframes);
+
+      EmitKeyframeRangeChanged(old_track, std::atomic_load(&keyframes_), time);
+      return;
+    }
+  }
+}
+
+void NodeInput::set_keyframes(const QList<NodeKeyframe> &keyframes)
+{
+  if (keyframes.isEmpty()) {
+    return;
+  }
+
+  PublishKeyframes(keyframes);
+
+  emit ValueChanged(RATIONAL_MIN, RATIONAL_MAX);
+}
+
+void NodeInput::PublishKeyframes(const QList<NodeKeyframe> &keyframes)
+{
+  // Values are stored in the first data type, regardless of what's connected
+  NodeParam::DataType type = inputs_.isEmpty() ? kNone : inputs_.first();
+
+  std::shared_ptr<const NodeKeyframeTrack> track = std::make_shared<NodeKeyframeTrack>(keyframes, type);
+
+  std::atomic_store(&keyframes_, track);
+}
+
+void NodeInput::EmitKeyframeRangeChanged(const std::shared_ptr<const NodeKeyframeTrack> &old_track,
+                                         const std::shared_ptr<const NodeKeyframeTrack> &new_track,
+                                         const rational &time)
+{
+  bool was_animated = (keyframing_ && old_track->count() > 1);
+  bool is_animated = (keyframing_ && new_track->count() > 1);
+
+  if (!was_animated && !is_animated) {
+    // Only the first keyframe is used, so nothing changes unless it did
+    if (old_track->keyframes().first().time() == new_track->keyframes().first().time()
+        && old_track->keyframes().first().value() == new_track->keyframes().first().value()) {
+      return;
+    }
+
+    emit ValueChanged(RATIONAL_MIN, RATIONAL_MAX);
+    return;
+  }
+
+  if (was_animated != is_animated) {
+    // Going between one constant value and an animation can change the value anywhere
+    emit ValueChanged(RATIONAL_MIN, RATIONAL_MAX);
+    return;
+  }
+
+  // The keyframes on either side of `time` are the same in both tracks (only the one at `time` changed), and they
+  // bound the segments that were interpolated from it
+  rational start, end;
+  new_track->NeighborRange(time, &start, &end);
+
+  emit ValueChanged(start, end);
 }
 
 bool NodeInput::dependent()
@@ -186,7 +346,8 @@ const QList<NodeParam::DataType> &NodeInput::inputs()
 void NodeInput::CopyValues(NodeInput *source, NodeInput *dest)
 {
   // Copy values
-  dest->keyframes_ = source->keyframes_;
+  // Snapshots are immutable, so the destination can share the source's
+  std::atomic_store(&dest->keyframes_, std::atomic_load(&source->keyframes_));
 
   // Copy keyframing state
   dest->set_keyframing(source->keyframing());
@@ -21,7 +21,10 @@
 #ifndef NODEINPUT_H
 #define NODEINPUT_H
 
+#include <memory>
+
 #include "keyframe.h"
+#include "keyframetrack.h"
 #include "param.h"
 
 /**
@@ -93,7 +96,7 @@ public:
    * If no output is connected, this will return a user-defined value, either a static value if this input is not
    * keyframed, or an interpolated value between the keyframes at this time.
    */
-  QVariant get_value(const rational &time);
+  NodeValue get_value(const rational &time);
 
   /**
    * @brief Set the value at a given time
@@ -112,6 +115,43 @@ public:
    */
   void set_keyframing(bool k);
 
+  /**
+   * @brief Returns whether this input's own value changes over time (keyframing is enabled with more than one keyframe)
+   *
+   * Doesn't take connections into account.
+   */
+  bool IsAnimated();
+
+  /**
+   * @brief Find the range of time around `time` this input's own value holds for (see Node::StaticRange())
+   *
+   * Doesn't take connections into account.
+   */
+  void StaticRange(const rational& time, rational* in, rational* out);
+
+  /**
+   * @brief Returns a snapshot of this input's keyframes sorted by time
+   */
+  QList<NodeKeyframe> keyframes();
+
+  /**
+   * @brief Add a keyframe, replacing any keyframe already at its time
+   */
+  void insert_keyframe(const NodeKeyframe& key);
+
+  /**
+   * @brief Remove the keyframe at `time` (if there is one, and it's not the only one)
+   */
+  void remove_keyframe(const rational& time);
+
+  /**
+   * @brief Replace every keyframe at once (e.g. when loading a project)
+   *
+   * Cheaper than inserting each with insert_keyframe() since the track is only published once. Does nothing if
+   * `keyframes` is empty, since there must always be at least one.
+   */
+  void set_keyframes(const QList<NodeKeyframe>& keyframes);
+
   /**
    * @brief Return whether the Node is dependent on this input or not
    *
@@ -156,12 +196,36 @@ private:
   QList<DataType> inputs_;
 
   /**
-   * @brief Internal keyframe array
+   * @brief Replace keyframes_ with a track built from `keyframes`
+   */
+  void PublishKeyframes(const QList<NodeKeyframe>& keyframes);
+
+  /**
+   * @brief Emit ValueChanged() for the time changing the keyframe at `time` affected
    *
-   * All internal/user-defined data is stored in this array. Even if keyframing is not enabled, this array will contain
+   * That's from the keyframe before it to the one after (see NodeKeyframeTrack::NeighborRange()), unless the change
+   * started or stopped the input being animated, in which case it's the whole time range. Nothing is emitted if the
+   * input isn't animated and its value didn't change.
+   */
+  void EmitKeyframeRangeChanged(const std::shared_ptr<const NodeKeyframeTrack>& old_track,
+                                const std::shared_ptr<const NodeKeyframeTrack>& new_track,
+                                const rational& time);
+
+  /**
+   * @brief Internal keyframe track
+   *
+   * All internal/user-defined data is stored in this track. Even if keyframing is not enabled, this track will contain
    * one entry which will be used, and its time value will be ignored.
+   *
+   * The track is an immutable snapshot: it's never modified in place, but replaced with a modified copy (always through
+   * std::atomic_load() and std::atomic_store()), so it can be read from any thread without locking.
+   */
+  std::shared_ptr<const NodeKeyframeTrack> keyframes_;
+
+  /**
+   * @brief The keyframe the last value was interpolated from (see NodeKeyframeTrack::FindKeyframe())
    */
-  QList<NodeKeyframe> keyframes_;
+  QAtomicInt keyframe_hint_;
 
   /**
    * @brief Internal keyframing enabled setting
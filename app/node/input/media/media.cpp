@@ -20,27 +20,110 @@
 
 #include "media.h"
 
+#include <QDateTime>
 #include <QDebug>
 #include <QOpenGLPixelTransferOptions>
+#include <QtMath>
+#include <QVector2D>
 
-#include "decoder/ffmpeg/ffmpegdecoder.h"
+#include "common/ringlog.h"
+#include "config/config.h"
+#include "decoder/decoderpool.h"
+#include "decoder/frameindexservice.h"
 #include "node/processor/renderer/renderer.h"
 #include "project/item/footage/footage.h"
-#include "render/gl/shadergenerators.h"
+#include "project/item/footage/imagestream.h"
 #include "render/gl/functions.h"
+#include "render/gl/shadercache.h"
+#include "render/gl/shadergenerators.h"
 #include "render/pixelservice.h"
+#include "render/profiler.h"
+#include "render/sourceframecache.h"
+#include "render/stilltexturecache.h"
+
+namespace {
+
+/**
+ * @brief Extra pixels kept around the visible region so filtering at its edges samples the right neighbors
+ */
+const int kRegionPadding = 2;
+
+/**
+ * @brief If the visible region covers more than this fraction of the frame, the whole frame is used instead
+ *
+ * Cropping only saves much when a small part is kept, and a whole frame stays valid however the transform animates.
+ */
+const double kFullRegionThreshold = 0.5;
+
+/**
+ * @brief The color space media is converted from
+ *
+ * FIXME: Hardcoded value for testing
+ */
+const char* const kMediaColorSpace = "srgb";
+
+/**
+ * @brief Whether media's alpha is associated
+ *
+ * FIXME: Hardcoded value
+ */
+const bool kMediaAlphaIsAssociated = false;
+
+/**
+ * @brief Create a frame that refers to a region of a packed frame's data without copying it
+ */
+FramePtr CropFrame(FramePtr frame, const QRect& region)
+{
+  FramePtr cropped = Frame::Create();
+
+  cropped->set_width(region.width());
+  cropped->set_height(region.height());
+  cropped->set_format(frame->format());
+  cropped->set_timestamp(frame->timestamp());
+  cropped->set_native_timestamp(frame->native_timestamp());
+
+  uint8_t* data = frame->data()
+      + region.y() * frame->linesize()
+      + region.x() * PixelService::BytesPerPixel(static_cast<olive::PixelFormat>(frame->format()));
+  int linesize = frame->linesize();
+
+  cropped->wrap(1, &data, &linesize, frame);
+
+  return cropped;
+}
+
+}
+
+QList<MediaInput*> MediaInput::instances_;
+QMutex MediaInput::instances_lock_;
+qint64 MediaInput::last_idle_check_ = 0;
 
 MediaInput::MediaInput() :
-  decoder_(nullptr),
   color_service_(nullptr),
-  pipeline_(nullptr),
-  ocio_texture_(0),
-  frame_(nullptr)
+  frame_(nullptr),
+  frame_divider_(0),
+  frame_stream_(nullptr),
+  frame_converted_(false),
+  tex_converted_(false),
+  last_used_(0),
+  resident_(false)
 {
+  instances_lock_.lock();
+  instances_.append(this);
+  instances_lock_.unlock();
+
+  internal_tex_ = std::make_shared<RenderTexture>();
+
   footage_input_ = new NodeInput("footage_in");
   footage_input_->add_data_input(NodeInput::kFootage);
   AddParameter(footage_input_);
 
+  // Index of the footage stream to show, -1 picks the first visual stream
+  stream_input_ = new NodeInput("stream_in");
+  stream_input_->add_data_input(NodeInput::kInt);
+  stream_input_->set_value(-1);
+  AddParameter(stream_input_);
+
   matrix_input_ = new NodeInput("matrix_in");
   matrix_input_->add_data_input(NodeInput::kMatrix);
   AddParameter(matrix_input_);
@@ -51,6 +134,13 @@ MediaInput::MediaInput() :
   AddParameter(texture_output_);
 }
 
+MediaInput::~MediaInput()
+{
+  instances_lock_.lock();
+  instances_.removeOne(this);
+  instances_lock_.unlock();
+}
+
 QString MediaInput::Name()
 {
   return tr("Media");
@@ -73,16 +163,15 @@ QString MediaInput::Description()
 
 void MediaInput::Release()
 {
-  internal_tex_.Destroy();
+  internal_tex_->Destroy();
+  planar_tex_.Destroy();
 
   frame_ = nullptr;
-  decoder_ = nullptr;
+  frame_converted_ = false;
+  source_frame_key_.clear();
+  tex_region_ = QRect();
   color_service_ = nullptr;
-  pipeline_ = nullptr;
-
-  if (ocio_texture_ != 0) {
-    ocio_ctx_->functions()->glDeleteTextures(1, &ocio_texture_);
-  }
+  yuv_pipeline_ = nullptr;
 }
 
 NodeInput *MediaInput::matrix_input()
@@ -95,40 +184,88 @@ NodeOutput *MediaInput::texture_output()
   return texture_output_;
 }
 
+Footage *MediaInput::footage()
+{
+  return ValueToPtr<Footage>(footage_input_->get_value(0));
+}
+
 void MediaInput::SetFootage(Footage *f)
 {
   footage_input_->set_value(PtrToValue(f));
 }
 
-void MediaInput::Hash(QCryptographicHash *hash, NodeOutput *from, const rational &time)
+void MediaInput::SetStream(StreamPtr s)
+{
+  SetFootage(s->footage());
+  stream_input_->set_value(s->index());
+}
+
+void MediaInput::Hash(FastHash *hash, NodeOutput *from, const rational &time)
 {
   Node::Hash(hash, from, time);
 
-  // Use frame value from Decoder
   if (from == texture_output_) {
-    if (!SetupDecoder()) {
-      qDebug() << "Failed to setup decoder for hashing";
+    StreamPtr stream = GetStream();
+
+    if (stream == nullptr) {
       return;
     }
 
-    int64_t timestamp = decoder_->GetTimestampFromTime(time);
+    // This is memoized by time alone (see Node::CachedHash()), so it's always the full quality frame. Shuttle frames
+    // are told apart by RendererScheduler::AddPlaybackToHash() instead.
+    int64_t timestamp;
+
+    // The media's index can usually tell which frame this is, so cached frames are found without opening the file.
+    // Otherwise use frame value from Decoder.
+    if (!olive::frame_index_service.GetTimestampFromTime(stream.get(), time, false, &timestamp)) {
+      DecoderPtr decoder = olive::decoder_pool.Lease(stream, time);
+
+      if (decoder == nullptr) {
+        OLIVE_LOG_WARNING("Failed to setup decoder for hashing");
+        return;
+      }
+
+      // Leased decoders may have been left shuttling
+      decoder->set_playback_speed(0);
+
+      timestamp = decoder->GetTimestampFromTime(time);
+
+      olive::decoder_pool.Return(decoder, time);
+    }
 
-    qDebug() << "Hashed timestamp" << timestamp;
+    OLIVE_LOG_DEBUG("Hashed timestamp", timestamp);
 
     QByteArray pts_bytes;
     pts_bytes.resize(sizeof(int64_t));
     memcpy(pts_bytes.data(), &timestamp, sizeof(int64_t));
 
     hash->addData(pts_bytes);
-    // FIXME: Add OCIO data
-    // FIXME: Add alpha association value
+
+    // The color transform and alpha association change the pixels too (see Value())
+    hash->addData(OCIO::GetCurrentConfig()->getCacheID());
+    hash->addData(kMediaColorSpace);
+    hash->addData(OCIO::ROLE_SCENE_LINEAR);
+    hash->addData(QByteArray::number(kMediaAlphaIsAssociated ? 1 : 0));
   }
 }
 
-QVariant MediaInput::Value(NodeOutput *output, const rational &time)
+void MediaInput::StaticRange(NodeOutput *output, const rational &time, rational *in, rational *out)
 {
-  // FIXME: Hardcoded value
-  bool alpha_is_associated = false;
+  StreamPtr stream = GetStream();
+
+  if (output == texture_output_ && (stream == nullptr || stream->type() != Stream::kImage)) {
+    *in = time;
+    *out = time;
+    return;
+  }
+
+  // A still is decoded the same at every time (see OIIODecoder::GetTimestampFromTime())
+  Node::StaticRange(output, time, in, out);
+}
+
+NodeValue MediaInput::Value(NodeOutput *output, const rational &time)
+{
+  bool alpha_is_associated = kMediaAlphaIsAssociated;
 
   if (output == texture_output_) {
     // Find the current Renderer instance
@@ -139,101 +276,239 @@ QVariant MediaInput::Value(NodeOutput *output, const rational &time)
       return 0;
     }
 
-    // Make sure decoder is set up
-    if (!SetupDecoder()) {
+    instances_lock_.lock();
+    last_used_ = QDateTime::currentMSecsSinceEpoch();
+    resident_ = true;
+    instances_lock_.unlock();
+
+    // A context is current here, so this is a good time to free what other clips are no longer using
+    ReleaseIdle();
+
+    // Lease a decoder for this footage (or its proxy)
+    StreamPtr stream = GetDecodingStream(renderer);
+
+    DecoderPtr decoder = olive::decoder_pool.Lease(stream, time);
+
+    if (decoder == nullptr) {
       return 0;
     }
 
-    // Check if we need to get a frame or not
-    if (frame_ == nullptr || frame_->native_timestamp() != decoder_->GetTimestampFromTime(time)) {
-      // Get frame from Decoder
-      frame_ = decoder_->Retrieve(time);
+    bool using_proxy = (stream != GetStream());
+
+    if (color_service_ == nullptr) {
+      // FIXME: Hardcoded values for testing
+      color_service_ = ColorService::Get(kMediaColorSpace, OCIO::ROLE_SCENE_LINEAR);
+    }
+
+    // OpenColorIO v1's color transforms can be done on GPU, which improves performance but may reduce accuracy. When
+    // online, we prefer accuracy over performance so we use the CPU path instead, unless the GPU path has been shown
+    // to match it for this transform.
+    // NOTE: OCIO v2 boasts 1:1 results with the CPU and GPU path so this won't be necessary forever
+    ShaderCache* shader_cache = ShaderCache::Get(renderer->context());
+
+    bool cpu_color = (renderer->mode() == olive::RenderMode::kOnline
+                      && !shader_cache->IsOCIOPipelineAccurate(color_service_->GetProcessor()));
+
+    // Let the decoder skip decoding detail we're not going to render (proxies are already reduced)
+    int decode_divider = renderer->divider();
+
+    if (using_proxy) {
+      decode_divider = qMax(1, decode_divider / kProxyDivider);
+    }
+
+    // Shuttle speeds only show each frame briefly, so trade resolution for speed there too
+    decoder->set_playback_speed(renderer->playback_speed());
+    decoder->set_read_ahead(renderer->read_ahead());
+
+    if (decoder->keyframes_only()) {
+      decode_divider *= kShuttleDivider;
+    }
+
+    // Playback that can't keep up reduces resolution further until it can (see RendererProcessor::playback_divider())
+    decode_divider *= renderer->playback_divider();
+
+    int64_t timestamp = decoder->GetTimestampFromTime(time);
+
+    // Check if we need to get a frame or not. Frames that are already color converted are no use to the GPU path.
+    if (frame_ == nullptr
+        || frame_divider_ != decode_divider
+        || frame_stream_ != stream.get()
+        || frame_->native_timestamp() != timestamp
+        || (frame_converted_ && !cpu_color)) {
+      // Video frames converted on the CPU may have been converted by other nodes showing this frame already. Stills
+      // don't need this since they're kept resident once converted (see GetStillTexture()).
+      source_frame_key_.clear();
+      frame_converted_ = false;
+
+      if (cpu_color && stream->type() == Stream::kVideo) {
+        source_frame_key_ = SourceFrameCache::Key(stream->footage()->filename(),
+                                                  stream->index(),
+                                                  timestamp,
+                                                  decode_divider,
+                                                  renderer->format(),
+                                                  kMediaColorSpace,
+                                                  alpha_is_associated);
+
+        frame_ = SourceFrameCache::Instance()->Get(source_frame_key_);
+
+        frame_converted_ = (frame_ != nullptr);
+      }
+
+      if (!frame_converted_) {
+        // Native YUV frames are converted on the GPU, which we only do on the GPU color path
+        decoder->set_planar_output_allowed(!cpu_color);
+
+        decoder->set_divider(decode_divider);
+
+        // Get frame from Decoder
+        ProfilerTimer timer(Profiler::kDecode);
+
+        // Give up on decoding if the frame is cancelled part way through
+        decoder->set_cancel_flag(renderer->cancel_flag());
+        frame_ = decoder->Retrieve(time);
+        decoder->set_cancel_flag(nullptr);
+      }
+
+      frame_divider_ = decode_divider;
+      frame_stream_ = stream.get();
+
+      olive::decoder_pool.Return(decoder, time);
 
       if (frame_ == nullptr) {
-        qDebug() << "Received a null frame while time was" << time.toDouble();
+        OLIVE_LOG_WARNING("Received a null frame while time was", time);
         return 0;
       }
 
-      if (color_service_ == nullptr) {
-        // FIXME: Hardcoded values for testing
-        color_service_ = std::make_shared<ColorService>("srgb", OCIO::ROLE_SCENE_LINEAR);
-      }
+      // The new frame hasn't been uploaded yet
+      tex_region_ = QRect();
+    } else {
+      olive::decoder_pool.Return(decoder, time);
+    }
 
-      // OpenColorIO v1's color transforms can be done on GPU, which improves performance but reduces accuracy. When
-      // online, we prefer accuracy over performance so we use the CPU path instead:
-      // NOTE: OCIO v2 boasts 1:1 results with the CPU and GPU path so this won't be necessary forever
-      if (renderer->mode() == olive::RenderMode::kOnline) {
-        // Convert to 32F, which is required for OpenColorIO's color transformation
-        frame_ = PixelService::ConvertPixelFormat(frame_, olive::PIX_FMT_RGBA32F);
+    // The media is placed in the whole frame, if only a tile of it is being rendered this moves it into the tile
+    QMatrix4x4 transform = renderer->tile_matrix();
 
-        if (alpha_is_associated) {
-          // Unassociate alpha here if associated
-          ColorService::DisassociateAlpha(frame_);
+    // Scale texture to a square for incoming matrix transformation
+    transform.scale(static_cast<float>(renderer->frame_height()) / static_cast<float>(renderer->frame_width()), 1.0f);
+
+    // Multiply by input transformation
+    transform *= matrix_input_->get_value(time).toMatrix();
+
+    // Frames may have been decoded at a reduced resolution, so use the stream's full size to work out how large the
+    // media is
+    ImageStream* image_stream = static_cast<ImageStream*>(GetStream().get());
+
+    // Scale texture to the media's aspect ratio
+    transform.scale(static_cast<float>(image_stream->width()) / static_cast<float>(image_stream->height()), 1.0f);
+
+    float media_size = static_cast<float>(image_stream->height())
+        / static_cast<float>(renderer->frame_height() * renderer->divider());
+    transform.scale(media_size, media_size);
+
+    // Only the part of the frame that ends up inside the output needs converting and uploading. Native YUV frames are
+    // converted on the GPU as a whole, which is cheap enough that they're always uploaded in full.
+    bool planar = (frame_->yuv_info().layout != olive::YUV_LAYOUT_INVALID);
+
+    // Stills look the same at every time, so they're uploaded in full once and shared by every node showing them
+    bool still = (stream->type() == Stream::kImage && !planar);
+
+    RenderTexturePtr source_tex = internal_tex_;
+    QRect source_region;
+
+    if (still) {
+      source_tex = GetStillTexture(stream.get(), decode_divider, alpha_is_associated, cpu_color, renderer);
+      source_region = QRect(0, 0, frame_->width(), frame_->height());
+    } else {
+      QRect region = planar ? QRect(0, 0, frame_->width(), frame_->height()) : GetVisibleRegion(transform, renderer);
+
+      // We use an internal texture to bring the texture into GPU space before performing transformations, which can
+      // be reused as long as it already holds the region
+      if (!tex_region_.contains(region) || tex_converted_ != cpu_color) {
+        FramePtr region_frame = frame_;
+
+        if (region != QRect(0, 0, frame_->width(), frame_->height())) {
+          region_frame = CropFrame(frame_, region);
         }
 
-        // Transform color to reference space
-        color_service_->ConvertFrame(frame_);
+        if (cpu_color && !planar && !frame_converted_) {
+          // Transform color to reference space, unassociating alpha first if it's associated and (re)associating it
+          // afterwards. OpenColorIO needs 32F, but that's only used per band while transforming, the result is in the
+          // renderer's working format so uploading and everything downstream works at that precision.
+          region_frame = color_service_->ConvertFrameAndAssociateAlpha(region_frame,
+                                                                       renderer->format(),
+                                                                       alpha_is_associated);
 
-        if (alpha_is_associated) {
-          // If alpha was associated, reassociate here
-          ColorService::ReassociateAlpha(frame_);
-        } else {
-          // If alpha was not associated, associate here
-          ColorService::AssociateAlpha(frame_);
+          // A whole converted frame can be shared, and any region needed later can be cropped from it
+          if (region_frame != frame_ && region == QRect(0, 0, frame_->width(), frame_->height())
+              && !source_frame_key_.isEmpty()) {
+            region_frame->set_native_timestamp(frame_->native_timestamp());
+
+            SourceFrameCache::Instance()->Insert(source_frame_key_, region_frame);
+
+            frame_ = region_frame;
+            frame_converted_ = true;
+          }
         }
-      }
 
-      // We use an internal texture to bring the texture into GPU space before performing transformations
+        // Ensure the texture is the accurate to the region
+        if (internal_tex_->width() != region_frame->width()
+            || internal_tex_->height() != region_frame->height()
+            || internal_tex_->format() != region_frame->format()) {
+          internal_tex_->Destroy();
+        }
 
-      // Ensure the texture is the accurate to the frame
-      if (internal_tex_.width() != frame_->width()
-          || internal_tex_.height() != frame_->height()
-          || internal_tex_.format() != frame_->format()) {
-        internal_tex_.Destroy();
-      }
+        // Create or upload the new data to the texture
+        if (planar) {
+          ConvertPlanarFrame(renderer);
+        } else {
+          if (!internal_tex_->IsCreated()) {
+            internal_tex_->Create(renderer->context(),
+                                  region_frame->width(),
+                                  region_frame->height(),
+                                  static_cast<olive::PixelFormat>(region_frame->format()));
+          }
+
+          internal_tex_->Upload(region_frame->data(), region_frame->linesize());
+        }
 
-      // Create or upload the new data to the texture
-      if (!internal_tex_.IsCreated()) {
-        internal_tex_.Create(renderer->context(),
-                             frame_->width(),
-                             frame_->height(),
-                             static_cast<olive::PixelFormat>(frame_->format()),
-                             frame_->data());
-      } else {
-        internal_tex_.Upload(frame_->data());
+        tex_region_ = region;
+        tex_converted_ = cpu_color;
       }
+
+      source_region = tex_region_;
     }
 
-    // Create new texture in reference space to send throughout the rest of the graph
+    // Map the blit's quad onto the region of the frame that the texture holds
+    float frame_width = static_cast<float>(frame_->width());
+    float frame_height = static_cast<float>(frame_->height());
 
-    RenderTexturePtr output_texture = std::make_shared<RenderTexture>();
+    transform.translate((static_cast<float>(source_region.x()) * 2.0f + static_cast<float>(source_region.width()))
+                        / frame_width - 1.0f,
+                        (static_cast<float>(source_region.y()) * 2.0f + static_cast<float>(source_region.height()))
+                        / frame_height - 1.0f);
+    transform.scale(static_cast<float>(source_region.width()) / frame_width,
+                    static_cast<float>(source_region.height()) / frame_height);
 
-    output_texture->Create(renderer->context(),
-                    renderer->width(),
-                    renderer->height(),
-                    renderer->format(),
-                    RenderTexture::kDoubleBuffer);
+    // Create new texture in reference space to send throughout the rest of the graph
+
+    RenderTexturePtr output_texture = renderer->texture_pool()->Get(renderer->width(),
+                                                                    renderer->height(),
+                                                                    renderer->format(),
+                                                                    RenderTexture::kDoubleBuffer);
 
     // Using the transformation matrix, blit our internal texture (in frame format) to our output texture (in
     // reference format)
 
-    if (renderer->mode() == olive::RenderMode::kOffline) {
-      // For offline rendering, OCIO's GPU path is acceptable:
-      // NOTE: OCIO v2 boasts 1:1 results with the CPU and GPU path so this won't be necessary forever
+    ShaderPtr pipeline;
+    GLuint ocio_texture = 0;
 
+    // Pipelines are compiled once per context and shared between every media node
+    if (!cpu_color) {
       // Use an OCIO pipeline shader (which wraps in a default pipeline and will also handle alpha association)
-      if (pipeline_ == nullptr) {
-        pipeline_ = olive::ShaderGenerator::OCIOPipeline(renderer->context(),
-                                                         ocio_texture_, // FIXME: A raw GLuint texture, should wrap this up
-                                                         color_service_->GetProcessor(),
-                                                         alpha_is_associated);
-
-        // Used for cleanup later
-        ocio_ctx_ = renderer->context();
-      }
-    } else if (pipeline_ == nullptr) {
-      // In online, the color transformation was performed on the CPU (see above), so we only need to blit
-      pipeline_ = olive::ShaderGenerator::DefaultPipeline();
+      pipeline = shader_cache->OCIOPipeline(color_service_->GetProcessor(), alpha_is_associated, &ocio_texture);
+    } else {
+      // The color transformation was performed on the CPU (see above), so we only need to blit
+      pipeline = shader_cache->DefaultPipeline();
     }
 
     renderer->context()->functions()->glBlendFunc(GL_ONE, GL_ZERO);
@@ -242,67 +517,268 @@ QVariant MediaInput::Value(NodeOutput *output, const rational &time)
     renderer->buffer()->Attach(output_texture);
     renderer->buffer()->Bind();
 
-    // Draw with the internal texture
-    internal_tex_.Bind();
-
-    QMatrix4x4 transform;
-
-    // Scale texture to a square for incoming matrix transformation
-    transform.scale(static_cast<float>(renderer->height()) / static_cast<float>(renderer->width()), 1.0f);
-
-    // Multiply by input transformation
-    transform *= matrix_input_->get_value(time).value<QMatrix4x4>();
+    // Draw with the internal (or still) texture
+    source_tex->Bind();
 
-    // Scale texture to the media's aspect ratio
-    transform.scale(static_cast<float>(frame_->width()) / static_cast<float>(frame_->height()), 1.0f);
-
-    float media_size = static_cast<float>(frame_->height()) / static_cast<float>(renderer->height() * renderer->divider());
-    transform.scale(media_size, media_size);
+    // Only bother with mipmaps if the media is being scaled down (stills already have theirs)
+    bool minified = olive::gl::IsMinified(transform, source_tex->height(), renderer->width(), renderer->height());
 
     // Use pipeline to blit using transformation matrix from input
-    if (renderer->mode() == olive::RenderMode::kOffline) {
-      olive::gl::OCIOBlit(pipeline_, ocio_texture_, false, transform);
+    if (!cpu_color) {
+      olive::gl::OCIOBlit(pipeline, ocio_texture, false, transform, minified, still);
     } else {
-      olive::gl::Blit(pipeline_, false, transform);
+      olive::gl::Blit(pipeline, false, transform, minified, still);
     }
 
     // Release everything
-    internal_tex_.Release();
+    source_tex->Release();
     renderer->buffer()->Detach();
     renderer->buffer()->Release();
 
-    return QVariant::fromValue(output_texture);
+    return NodeValue(std::move(output_texture));
   }
 
   return 0;
 }
 
-bool MediaInput::SetupDecoder()
+QRect MediaInput::GetVisibleRegion(const QMatrix4x4 &transform, RenderInstance *renderer)
 {
-  if (decoder_ != nullptr) {
-    return true;
+  QRect full(0, 0, frame_->width(), frame_->height());
+
+  bool invertible;
+  QMatrix4x4 inverse = transform.inverted(&invertible);
+
+  if (!invertible) {
+    return full;
+  }
+
+  // Map the output's corners back onto the blit's quad, where the frame covers -1.0 to 1.0 on both axes
+  QPointF corners[] = {
+    inverse.map(QPointF(-1.0, -1.0)),
+    inverse.map(QPointF(1.0, -1.0)),
+    inverse.map(QPointF(-1.0, 1.0)),
+    inverse.map(QPointF(1.0, 1.0))
+  };
+
+  qreal left = corners[0].x();
+  qreal right = left;
+  qreal top = corners[0].y();
+  qreal bottom = top;
+
+  for (const QPointF& corner : corners) {
+    left = qMin(left, corner.x());
+    right = qMax(right, corner.x());
+    top = qMin(top, corner.y());
+    bottom = qMax(bottom, corner.y());
   }
 
+  // How many frame pixels one output pixel spans, which is how far apart mipmapping samples are
+  qreal half_width = frame_->width() * 0.5;
+  qreal half_height = frame_->height() * 0.5;
+  QVector3D step_x = inverse.mapVector(QVector3D(2.0f / static_cast<float>(renderer->width()), 0.0f, 0.0f));
+  QVector3D step_y = inverse.mapVector(QVector3D(0.0f, 2.0f / static_cast<float>(renderer->height()), 0.0f));
+  qreal footprint = qMax(QVector2D(static_cast<float>(step_x.x() * half_width),
+                                   static_cast<float>(step_x.y() * half_height)).length(),
+                         QVector2D(static_cast<float>(step_y.x() * half_width),
+                                   static_cast<float>(step_y.y() * half_height)).length());
+
+  int padding = kRegionPadding + qCeil(footprint);
+
+  QRect region(QPoint(qFloor((left + 1.0) * half_width) - padding,
+                      qFloor((top + 1.0) * half_height) - padding),
+               QPoint(qCeil((right + 1.0) * half_width) + padding - 1,
+                      qCeil((bottom + 1.0) * half_height) + padding - 1));
+
+  region &= full;
+
+  // The media is entirely outside the output, keep a single pixel so there's still something to blit
+  if (region.isEmpty()) {
+    return QRect(0, 0, 1, 1);
+  }
+
+  if (static_cast<double>(region.width()) * region.height()
+      > kFullRegionThreshold * static_cast<double>(full.width()) * full.height()) {
+    return full;
+  }
+
+  return region;
+}
+
+StreamPtr MediaInput::GetStream()
+{
   // Get currently selected Footage
   Footage* footage = ValueToPtr<Footage>(footage_input_->get_value(0));
 
   // If no footage is selected, return nothing
-  if (footage == nullptr) {
-    return false;
+  if (footage == nullptr || footage->stream_count() == 0) {
+    return nullptr;
+  }
+
+  int index = stream_input_->get_value(0).toInt();
+
+  if (index >= 0 && index < footage->stream_count()) {
+    StreamPtr s = footage->stream(index);
+
+    if (s->type() == Stream::kVideo || s->type() == Stream::kImage) {
+      return s;
+    }
+  }
+
+  for (int i=0;i<footage->stream_count();i++) {
+    StreamPtr s = footage->stream(i);
+
+    if (s->type() == Stream::kVideo || s->type() == Stream::kImage) {
+      return s;
+    }
+  }
+
+  return nullptr;
+}
+
+void MediaInput::ReleaseIdle()
+{
+  QMutexLocker locker(&instances_lock_);
+
+  qint64 now = QDateTime::currentMSecsSinceEpoch();
+
+  if (now - last_idle_check_ < 1000) {
+    return;
+  }
+
+  last_idle_check_ = now;
+
+  // Every resident input, least recently used first
+  QMultiMap<qint64, MediaInput*> resident;
+
+  foreach (MediaInput* input, instances_) {
+    if (input->resident_) {
+      resident.insert(input->last_used_, input);
+    }
   }
 
-  // Otherwise try to get frame of footage from decoder
+  int remaining = resident.size();
+
+  QMultiMap<qint64, MediaInput*>::const_iterator i;
+
+  for (i=resident.constBegin();i!=resident.constEnd();i++) {
+    if (remaining <= kMediaResidentBudget && now - i.key() < kMediaIdleTimeout * 1000) {
+      break;
+    }
+
+    MediaInput* input = i.value();
+
+    // Never wait here, an input that's locked is being rendered (or is the one calling this)
+    if (input->TryLock()) {
+      input->Release();
+      input->Unlock();
 
-  // Determine which decoder to use
-  if (decoder_ == nullptr
-      && (decoder_ = Decoder::CreateFromID(footage->decoder())) == nullptr) {
-    return false;
+      input->resident_ = false;
+      remaining--;
+    }
   }
+}
+
+StreamPtr MediaInput::GetDecodingStream(RenderInstance *renderer)
+{
+  StreamPtr stream = GetStream();
 
-  if (decoder_->stream() == nullptr) {
-    // FIXME: Hardcoded stream 0
-    decoder_->set_stream(footage->stream(0));
+  if (stream == nullptr || stream->type() != Stream::kVideo) {
+    return stream;
   }
 
-  return true;
+  FootagePtr proxy = static_cast<VideoStream*>(stream.get())->proxy();
+
+  if (proxy != nullptr
+      && proxy->stream_count() > 0
+      && (renderer->mode() == olive::RenderMode::kOffline || renderer->divider() >= 2)) {
+    return proxy->stream(0);
+  }
+
+  return stream;
+}
+
+void MediaInput::ConvertPlanarFrame(RenderInstance *renderer)
+{
+  QOpenGLFunctions* f = renderer->context()->functions();
+
+  if (!internal_tex_->IsCreated()) {
+    internal_tex_->Create(renderer->context(),
+                          frame_->width(),
+                          frame_->height(),
+                          static_cast<olive::PixelFormat>(frame_->format()));
+  }
+
+  bool yuv_info_changed = (planar_tex_.info() != frame_->yuv_info());
+
+  // Upload the native planes
+  planar_tex_.Upload(renderer->context(), frame_);
+
+  if (yuv_pipeline_ == nullptr || yuv_info_changed) {
+    yuv_pipeline_ = olive::ShaderGenerator::YUVPipeline(frame_->yuv_info());
+  }
+
+  f->glBlendFunc(GL_ONE, GL_ZERO);
+
+  // Convert into the internal texture, which is frame-sized rather than renderer-sized
+  renderer->buffer()->Attach(internal_tex_);
+  renderer->buffer()->Bind();
+  f->glViewport(0, 0, frame_->width(), frame_->height());
+
+  planar_tex_.Bind();
+
+  olive::gl::Blit(yuv_pipeline_);
+
+  planar_tex_.Release();
+
+  f->glViewport(0, 0, renderer->width(), renderer->height());
+  renderer->buffer()->Detach();
+  renderer->buffer()->Release();
+}
+
+RenderTexturePtr MediaInput::GetStillTexture(Stream *stream,
+                                             int divider,
+                                             bool alpha_is_associated,
+                                             bool cpu_color,
+                                             RenderInstance *renderer)
+{
+  QString key = StillTextureCache::Key(renderer->context(),
+                                       stream->footage()->filename(),
+                                       stream->index(),
+                                       divider,
+                                       renderer->format(),
+                                       cpu_color);
+
+  RenderTexturePtr texture = StillTextureCache::Instance()->Get(key);
+
+  if (texture != nullptr) {
+    // The still may have been uploaded in another thread's context
+    texture->WaitFence();
+
+    return texture;
+  }
+
+  FramePtr frame = frame_;
+
+  // Color is converted on the CPU unless the GPU path is accurate enough, like the internal texture (see Value())
+  if (cpu_color) {
+    frame = color_service_->ConvertFrameAndAssociateAlpha(frame, renderer->format(), alpha_is_associated);
+  }
+
+  texture = std::make_shared<RenderTexture>();
+  texture->Create(renderer->context(),
+                  frame->width(),
+                  frame->height(),
+                  static_cast<olive::PixelFormat>(frame->format()));
+  texture->Upload(frame->data(), frame->linesize());
+
+  // Generate the mipmaps now so drawing the still small never has to
+  texture->Bind();
+  renderer->context()->functions()->glGenerateMipmap(GL_TEXTURE_2D);
+  texture->Release();
+
+  texture->Fence();
+
+  StillTextureCache::Instance()->Insert(key, texture);
+
+  return texture;
 }
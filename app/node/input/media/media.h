@@ -21,11 +21,15 @@
 #ifndef IMAGE_H
 #define IMAGE_H
 
+#include <QMatrix4x4>
 #include <QOpenGLTexture>
+#include <QRect>
 
 #include "decoder/decoder.h"
 #include "node/node.h"
 #include "render/colorservice.h"
+#include "render/planartexture.h"
+#include "render/renderinstance.h"
 #include "render/rendertexture.h"
 #include "render/gl/shadergenerators.h"
 
@@ -38,6 +42,8 @@ class MediaInput : public Node
 public:
   MediaInput();
 
+  virtual ~MediaInput() override;
+
   virtual QString Name() override;
   virtual QString id() override;
   virtual QString Category() override;
@@ -49,35 +55,146 @@ public:
 
   NodeOutput* texture_output();
 
+  Footage* footage();
   void SetFootage(Footage* f);
 
-  virtual void Hash(QCryptographicHash *hash, NodeOutput* from, const rational &time) override;
+  /**
+   * @brief Set the footage and which of its streams this node shows
+   */
+  void SetStream(StreamPtr s);
+
+  /**
+   * @brief Returns the footage stream this node is set to, or nullptr if none is set
+   *
+   * If no stream has been chosen (or the chosen stream isn't visual), this is the footage's first video or image
+   * stream.
+   */
+  StreamPtr GetStream();
+
+  virtual void Hash(FastHash *hash, NodeOutput* from, const rational &time) override;
+
+  /**
+   * @brief Override only allows ranges for still images, video frames are hashed by their timestamp
+   */
+  virtual void StaticRange(NodeOutput* output, const rational& time, rational* in, rational* out) override;
 
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
 private:
-  bool SetupDecoder();
+  /**
+   * @brief Release the frames and textures of MediaInputs that haven't been rendered for a while
+   *
+   * Release() only runs when the whole graph is released, and a clip is only rendered while the playhead is over it,
+   * so otherwise every clip ever shown would keep its frame and textures resident. Inputs unused for kMediaIdleTimeout
+   * seconds are released, as are the least recently used beyond kMediaResidentBudget, and they simply retrieve their
+   * frame again if they're rendered again.
+   *
+   * A context in the renderers' share group must be current. Inputs that are locked (i.e. being rendered) are
+   * skipped, and this only does anything once a second.
+   */
+  static void ReleaseIdle();
+
+  static QList<MediaInput*> instances_;
+
+  static QMutex instances_lock_;
+
+  /**
+   * @brief The last time ReleaseIdle() checked (msecs since epoch)
+   */
+  static qint64 last_idle_check_;
+
+  /**
+   * @brief Returns the stream frames should be decoded from for this renderer
+   *
+   * This is GetStream() unless it has a proxy and the renderer doesn't need full quality (offline mode or a divider
+   * of 2 or more), in which case the proxy's stream is returned.
+   */
+  StreamPtr GetDecodingStream(RenderInstance* renderer);
+
+  /**
+   * @brief Returns the region of frame_ (in its pixels) that's visible in the renderer's output
+   *
+   * @param transform
+   *
+   * The matrix the frame is blitted with, mapping the frame's quad to the output.
+   */
+  QRect GetVisibleRegion(const QMatrix4x4& transform, RenderInstance* renderer);
+
+  /**
+   * @brief Upload a native YUV frame_ and convert it to RGBA into internal_tex_ on the GPU
+   */
+  void ConvertPlanarFrame(RenderInstance* renderer);
+
+  /**
+   * @brief Returns the resident texture of the still in frame_, uploading it (in full, with mipmaps) if needed
+   *
+   * See StillTextureCache.
+   */
+  RenderTexturePtr GetStillTexture(Stream* stream,
+                                   int divider,
+                                   bool alpha_is_associated,
+                                   bool cpu_color,
+                                   RenderInstance* renderer);
 
   NodeInput* footage_input_;
 
+  NodeInput* stream_input_;
+
   NodeInput* matrix_input_;
 
   NodeOutput* texture_output_;
 
-  RenderTexture internal_tex_;
+  RenderTexturePtr internal_tex_;
 
-  DecoderPtr decoder_;
+  PlanarTexture planar_tex_;
 
-  ColorServicePtr color_service_;
-
-  ShaderPtr pipeline_;
+  ShaderPtr yuv_pipeline_;
 
-  QOpenGLContext* ocio_ctx_;
-  GLuint ocio_texture_;
+  ColorServicePtr color_service_;
 
   FramePtr frame_;
 
+  /**
+   * @brief The decoder divider frame_ was retrieved at (see Decoder::set_divider())
+   */
+  int frame_divider_;
+
+  /**
+   * @brief The stream frame_ was retrieved from (either GetStream() or its proxy)
+   */
+  Stream* frame_stream_;
+
+  /**
+   * @brief Whether frame_ is already in the reference space, having come from (or been added to) SourceFrameCache
+   */
+  bool frame_converted_;
+
+  /**
+   * @brief The key of frame_ in SourceFrameCache, empty if it isn't shared there
+   */
+  QString source_frame_key_;
+
+  /**
+   * @brief The region of frame_ that's been uploaded to internal_tex_, null if nothing has been
+   */
+  QRect tex_region_;
+
+  /**
+   * @brief Whether internal_tex_ was color converted on the CPU when it was uploaded (see Value())
+   */
+  bool tex_converted_;
+
+  /**
+   * @brief The last time this was rendered (msecs since epoch), protected by instances_lock_
+   */
+  qint64 last_used_;
+
+  /**
+   * @brief Whether this has been rendered since ReleaseIdle() last released it, protected by instances_lock_
+   */
+  bool resident_;
+
 };
 
 #endif // IMAGE_H
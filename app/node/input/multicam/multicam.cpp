@@ -0,0 +1,411 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "multicam.h"
+
+#include <QOpenGLFunctions>
+#include <QtMath>
+
+#include "config/config.h"
+#include "decoder/decoderpool.h"
+#include "node/processor/renderer/renderer.h"
+#include "render/gl/functions.h"
+
+MulticamNode::MulticamNode()
+{
+  for (int i=0;i<kMulticamMaxAngles;i++) {
+    NodeInput* footage_input = new NodeInput(QStringLiteral("footage_in_%1").arg(i));
+    footage_input->add_data_input(NodeInput::kFootage);
+    AddParameter(footage_input);
+
+    footage_inputs_.append(footage_input);
+
+    // Not parented to this, every child of a Node is a NodeParam
+    angles_.append(new MediaInput());
+  }
+
+  angle_input_ = new NodeInput("angle_in");
+  angle_input_->add_data_input(NodeInput::kInt);
+  angle_input_->set_minimum(0);
+  angle_input_->set_maximum(kMulticamMaxAngles - 1);
+  AddParameter(angle_input_);
+
+  grid_input_ = new NodeInput("grid_in");
+  grid_input_->add_data_input(NodeInput::kBoolean);
+  grid_input_->set_value(true);
+  AddParameter(grid_input_);
+
+  texture_output_ = new NodeOutput("tex_out");
+  texture_output_->set_data_type(NodeOutput::kTexture);
+  texture_output_->SetValueCachingEnabled(false);
+  AddParameter(texture_output_);
+}
+
+MulticamNode::~MulticamNode()
+{
+  qDeleteAll(angles_);
+}
+
+QString MulticamNode::Name()
+{
+  return tr("Multicam");
+}
+
+QString MulticamNode::id()
+{
+  return "org.olivevideoeditor.Olive.multicam";
+}
+
+QString MulticamNode::Category()
+{
+  return tr("Input");
+}
+
+QString MulticamNode::Description()
+{
+  return tr("Switch between several angles of the same scene, optionally previewing them all at once in a grid.");
+}
+
+void MulticamNode::Release()
+{
+  foreach (MediaInput* angle, angles_) {
+    angle->Release();
+  }
+}
+
+void MulticamNode::Retranslate()
+{
+  for (int i=0;i<footage_inputs_.size();i++) {
+    footage_inputs_.at(i)->set_name(tr("Angle %1").arg(i + 1));
+  }
+
+  angle_input_->set_name(tr("Selected Angle"));
+  grid_input_->set_name(tr("Show Grid"));
+}
+
+NodeInput *MulticamNode::footage_input(int index)
+{
+  return footage_inputs_.at(index);
+}
+
+NodeInput *MulticamNode::angle_input()
+{
+  return angle_input_;
+}
+
+NodeInput *MulticamNode::grid_input()
+{
+  return grid_input_;
+}
+
+NodeOutput *MulticamNode::texture_output()
+{
+  return texture_output_;
+}
+
+void MulticamNode::SwitchAngle(int index, const rational &time)
+{
+  QList<NodeKeyframe> keyframes = angle_input_->keyframes();
+
+  // Without keyframing, the first keyframe holds the angle for all time, so it's what's cut from
+  if (!angle_input_->keyframing()) {
+    NodeKeyframe first = keyframes.first();
+    first.set_time(0);
+
+    keyframes = {first};
+  }
+
+  bool replaced = false;
+
+  for (int i=0;i<keyframes.size();i++) {
+    keyframes[i].set_type(NodeKeyframe::kHold);
+
+    if (keyframes.at(i).time() == time) {
+      keyframes[i].set_value(index);
+      replaced = true;
+    }
+  }
+
+  if (!replaced) {
+    NodeKeyframe key;
+    key.set_time(time);
+    key.set_value(index);
+    key.set_type(NodeKeyframe::kHold);
+
+    keyframes.append(key);
+  }
+
+  angle_input_->set_keyframing(true);
+  angle_input_->set_keyframes(keyframes);
+}
+
+void MulticamNode::InvalidateCache(const rational &start_range, const rational &end_range, NodeInput *from)
+{
+  int index = footage_inputs_.indexOf(from);
+
+  if (index >= 0) {
+    MediaInput* angle = angles_.at(index);
+    Footage* footage = ValueToPtr<Footage>(from->get_value(0));
+
+    if (angle->footage() != footage) {
+      angle->SetFootage(footage);
+
+      // Angles are decoded side by side, so have them all open by the time they're shown
+      StreamPtr stream = angle->GetStream();
+
+      if (stream != nullptr) {
+        olive::decoder_pool.Prepare(stream, 0);
+      }
+    }
+  }
+
+  Node::InvalidateCache(start_range, end_range, from);
+}
+
+void MulticamNode::Hash(FastHash *hash, NodeOutput *from, const rational &time)
+{
+  Node::Hash(hash, from, time);
+
+  if (from == texture_output_) {
+    RenderInstance* renderer = RendererProcessor::CurrentInstance();
+
+    // The grid input alone doesn't say whether the grid is shown, that depends on the renderer too
+    hash->addData(QByteArray::number(ShowsGrid(renderer, time) ? 1 : 0));
+
+    QVector<int> shown = ShownAngles(renderer, time);
+
+    foreach (int index, shown) {
+      angles_.at(index)->Hash(hash, angles_.at(index)->texture_output(), time);
+    }
+  }
+}
+
+void MulticamNode::StaticRange(NodeOutput *output, const rational &time, rational *in, rational *out)
+{
+  InputsStaticRange(time, in, out);
+
+  if (output != texture_output_) {
+    return;
+  }
+
+  QVector<int> shown = ShownAngles(RendererProcessor::CurrentInstance(), time);
+
+  foreach (int index, shown) {
+    if (*in == *out) {
+      // Can't get any narrower
+      return;
+    }
+
+    rational angle_in, angle_out;
+    angles_.at(index)->StaticRange(angles_.at(index)->texture_output(), time, &angle_in, &angle_out);
+
+    IntersectStaticRange(time, angle_in, angle_out, in, out);
+  }
+}
+
+NodeValue MulticamNode::Value(NodeOutput *output, const rational &time)
+{
+  RenderInstance* renderer = RendererProcessor::CurrentInstance();
+
+  if (renderer == nullptr || output != texture_output_) {
+    return 0;
+  }
+
+  QVector<int> shown = ShownAngles(renderer, time);
+
+  if (shown.isEmpty()) {
+    return 0;
+  }
+
+  if (!ShowsGrid(renderer, time)) {
+    // Only the selected angle is decoded, at the renderer's resolution
+    return angles_.at(shown.first())->texture_output()->get_value(time);
+  }
+
+  // Each angle only fills a cell, so decode it at the cell's size. Angles are rendered at the output's size all the
+  // same, which is cheap next to decoding at full resolution.
+  int columns = GridColumns(shown.size());
+
+  int playback_divider = renderer->playback_divider();
+  renderer->set_playback_divider(playback_divider * columns);
+
+  QVector<RenderTexturePtr> textures;
+  textures.reserve(shown.size());
+
+  foreach (int index, shown) {
+    if (renderer->cancelled()) {
+      break;
+    }
+
+    textures.append(angles_.at(index)->texture_output()->get_value(time).takeTexture());
+  }
+
+  renderer->set_playback_divider(playback_divider);
+
+  if (renderer->cancelled()) {
+    return 0;
+  }
+
+  return NodeValue(DrawGrid(renderer, shown, textures, SelectedAngle(time)));
+}
+
+bool MulticamNode::ShowsGrid(RenderInstance *renderer, const rational &time)
+{
+  return (renderer == nullptr || renderer->mode() == olive::RenderMode::kOffline)
+      && grid_input_->get_value(time).toBool();
+}
+
+int MulticamNode::SelectedAngle(const rational &time)
+{
+  int index = angle_input_->get_value(time).toInt();
+
+  if (index < 0 || index >= angles_.size() || angles_.at(index)->footage() == nullptr) {
+    return -1;
+  }
+
+  return index;
+}
+
+QVector<int> MulticamNode::ShownAngles(RenderInstance *renderer, const rational &time)
+{
+  QVector<int> shown;
+
+  if (ShowsGrid(renderer, time)) {
+    // Empty angles don't get a cell
+    for (int i=0;i<angles_.size();i++) {
+      if (angles_.at(i)->footage() != nullptr) {
+        shown.append(i);
+      }
+    }
+  } else {
+    int selected = SelectedAngle(time);
+
+    if (selected >= 0) {
+      shown.append(selected);
+    }
+  }
+
+  return shown;
+}
+
+int MulticamNode::GridColumns(int count)
+{
+  return qMax(1, qCeil(qSqrt(count)));
+}
+
+RenderTexturePtr MulticamNode::DrawGrid(RenderInstance *renderer,
+                                        const QVector<int> &angles,
+                                        const QVector<RenderTexturePtr> &textures,
+                                        int selected)
+{
+  int columns = GridColumns(angles.size());
+  int rows = (angles.size() + columns - 1) / columns;
+
+  // Cells keep the frame's aspect ratio, so grids with fewer rows than columns are centered vertically
+  float cell_scale = 1.0f / static_cast<float>(columns);
+
+  RenderTexturePtr output_texture = renderer->texture_pool()->Get(renderer->width(),
+                                                                  renderer->height(),
+                                                                  renderer->format(),
+                                                                  RenderTexture::kDoubleBuffer);
+
+  renderer->buffer()->Attach(output_texture);
+  renderer->buffer()->Bind();
+
+  QOpenGLFunctions* f = renderer->context()->functions();
+
+  f->glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  f->glClear(GL_COLOR_BUFFER_BIT);
+
+  f->glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+  ShaderPtr pipeline = renderer->default_pipeline();
+
+  QRect selected_cell;
+
+  for (int i=0;i<textures.size();i++) {
+    int column = i % columns;
+    int row = i / columns;
+
+    float x = static_cast<float>(2 * column + 1) * cell_scale - 1.0f;
+    float y = static_cast<float>(rows - 2 * row - 1) * cell_scale;
+
+    if (angles.at(i) == selected) {
+      // In the frame's pixels from the bottom-left like tile()
+      float frame_width = static_cast<float>(renderer->frame_width());
+      float frame_height = static_cast<float>(renderer->frame_height());
+
+      selected_cell = QRect(qRound((x - cell_scale + 1.0f) * 0.5f * frame_width),
+                            qRound((y - cell_scale + 1.0f) * 0.5f * frame_height),
+                            qRound(cell_scale * frame_width),
+                            qRound(cell_scale * frame_height));
+    }
+
+    const RenderTexturePtr& texture = textures.at(i);
+
+    if (texture == nullptr) {
+      continue;
+    }
+
+    QMatrix4x4 matrix = renderer->tile_matrix();
+    matrix.translate(x, y);
+    matrix.scale(cell_scale, cell_scale);
+
+    pipeline->bind();
+    pipeline->setUniformValue("opacity", texture->pending_opacity());
+    pipeline->release();
+
+    // The angle was decoded at the cell's size and scaled up, so sampling it back down doesn't need mipmaps
+    texture->Bind();
+    olive::gl::Blit(pipeline, false, matrix);
+    texture->Release();
+  }
+
+  pipeline->bind();
+  pipeline->setUniformValue("opacity", 1.0f);
+  pipeline->release();
+
+  // Outline the selected angle by clearing a border around its cell
+  if (!selected_cell.isNull()) {
+    QRect cell = selected_cell.translated(-renderer->tile().topLeft());
+    int width = qMax(1, kMulticamHighlightWidth / renderer->divider());
+
+    QRect edges[] = {
+      QRect(cell.left(), cell.top(), cell.width(), width),
+      QRect(cell.left(), cell.top() + cell.height() - width, cell.width(), width),
+      QRect(cell.left(), cell.top(), width, cell.height()),
+      QRect(cell.left() + cell.width() - width, cell.top(), width, cell.height())
+    };
+
+    f->glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
+    f->glEnable(GL_SCISSOR_TEST);
+
+    for (const QRect& edge : edges) {
+      f->glScissor(edge.x(), edge.y(), edge.width(), edge.height());
+      f->glClear(GL_COLOR_BUFFER_BIT);
+    }
+
+    f->glDisable(GL_SCISSOR_TEST);
+  }
+
+  renderer->buffer()->Release();
+  renderer->buffer()->Detach();
+
+  return output_texture;
+}
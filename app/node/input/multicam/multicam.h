@@ -0,0 +1,130 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef MULTICAMNODE_H
+#define MULTICAMNODE_H
+
+#include <QVector>
+
+#include "node/input/media/media.h"
+#include "node/node.h"
+
+/**
+ * @brief A node that switches between several angles of the same scene
+ *
+ * Each angle is a footage input, decoded by a MediaInput owned by this node (outside of any graph). The angle input
+ * picks the angle that's output and is keyframed with hold keyframes to cut between angles (see SwitchAngle()).
+ *
+ * With the grid input enabled, offline renders (i.e. the viewer) show every angle at once in a grid with the selected
+ * angle outlined. Each angle is then decoded at the size of its cell (through RenderInstance::playback_divider()) and
+ * they're all composited into the output in one pass. Online renders (exports) always output the selected angle
+ * alone at full resolution, and no other angle is decoded.
+ */
+class MulticamNode : public Node
+{
+  Q_OBJECT
+public:
+  MulticamNode();
+
+  virtual ~MulticamNode() override;
+
+  virtual QString Name() override;
+  virtual QString id() override;
+  virtual QString Category() override;
+  virtual QString Description() override;
+
+  virtual void Release() override;
+
+  virtual void Retranslate() override;
+
+  /**
+   * @brief Footage input of angle `index` (0 to kMulticamMaxAngles - 1)
+   */
+  NodeInput* footage_input(int index);
+
+  NodeInput* angle_input();
+
+  NodeInput* grid_input();
+
+  NodeOutput* texture_output();
+
+  /**
+   * @brief Cut to angle `index` from `time` onwards by adding a hold keyframe to angle_input()
+   *
+   * Every other keyframe is made a hold keyframe too, since angles can't be interpolated between.
+   */
+  void SwitchAngle(int index, const rational& time);
+
+  virtual void InvalidateCache(const rational &start_range, const rational &end_range, NodeInput *from) override;
+
+  virtual void Hash(FastHash *hash, NodeOutput* from, const rational &time) override;
+
+  /**
+   * @brief Override intersects the ranges of the angles that are shown, since they aren't dependencies
+   */
+  virtual void StaticRange(NodeOutput* output, const rational& time, rational* in, rational* out) override;
+
+protected:
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
+
+private:
+  /**
+   * @brief Returns whether `renderer` (which may be nullptr) shows the grid at `time`
+   */
+  bool ShowsGrid(RenderInstance* renderer, const rational& time);
+
+  /**
+   * @brief Returns the selected angle at `time`, or -1 if it has no footage
+   */
+  int SelectedAngle(const rational& time);
+
+  /**
+   * @brief Returns the indices of the angles shown at `time`, in the order of their cells in the grid
+   */
+  QVector<int> ShownAngles(RenderInstance* renderer, const rational& time);
+
+  /**
+   * @brief Columns (and rows, at most) of a grid that fits `count` angles
+   */
+  static int GridColumns(int count);
+
+  /**
+   * @brief Composite the textures of `angles` (already rendered at the size of their cells) into a grid
+   */
+  RenderTexturePtr DrawGrid(RenderInstance* renderer,
+                            const QVector<int>& angles,
+                            const QVector<RenderTexturePtr>& textures,
+                            int selected);
+
+  QVector<NodeInput*> footage_inputs_;
+
+  NodeInput* angle_input_;
+
+  NodeInput* grid_input_;
+
+  NodeOutput* texture_output_;
+
+  /**
+   * @brief Decodes each angle, kept set to the footage of footage_inputs_ by InvalidateCache()
+   */
+  QVector<MediaInput*> angles_;
+
+};
+
+#endif // MULTICAMNODE_H
@@ -18,22 +18,35 @@
 
 ***/
 
-#include "taskthread.h"
+#include "interactiveedit.h"
 
-#include "task/task.h"
+NodeInteractiveEdit::NodeInteractiveEdit() :
+  depth_(0)
+{
+}
 
-TaskThread::TaskThread(Task *parent) :
-  parent_(parent),
-  result_(false)
+NodeInteractiveEdit *NodeInteractiveEdit::Get()
 {
+  static NodeInteractiveEdit instance;
+
+  return &instance;
 }
 
-void TaskThread::run()
+void NodeInteractiveEdit::Begin()
 {
-  result_ = parent_->Action();
+  depth_++;
+}
+
+void NodeInteractiveEdit::End()
+{
+  depth_--;
+
+  if (depth_ == 0) {
+    emit Finished();
+  }
 }
 
-bool TaskThread::result()
+bool NodeInteractiveEdit::IsActive() const
 {
-  return result_;
+  return (depth_ > 0);
 }
@@ -0,0 +1,60 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef NODEINTERACTIVEEDIT_H
+#define NODEINTERACTIVEEDIT_H
+
+#include <QObject>
+
+/**
+ * @brief Marks when a value is being changed continuously (e.g. a slider being dragged)
+ *
+ * While an interactive edit is active, renderers only re-render the frame at the playhead when they're invalidated
+ * and remember the rest of the range. When the edit finishes they queue everything they skipped at once, so dragging
+ * a slider re-renders one frame per update rather than the whole clip each time.
+ *
+ * Edits nest and are only used from the main thread.
+ */
+class NodeInteractiveEdit : public QObject
+{
+  Q_OBJECT
+public:
+  static NodeInteractiveEdit* Get();
+
+  void Begin();
+
+  void End();
+
+  bool IsActive() const;
+
+signals:
+  /**
+   * @brief Emitted when the outermost edit ends
+   */
+  void Finished();
+
+private:
+  NodeInteractiveEdit();
+
+  int depth_;
+
+};
+
+#endif // NODEINTERACTIVEEDIT_H
@@ -0,0 +1,121 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "invalidationbatch.h"
+
+#include <algorithm>
+#include <QThread>
+
+#include "node/node.h"
+
+int NodeInvalidationBatch::depth_ = 0;
+bool NodeInvalidationBatch::flushing_ = false;
+QThread* NodeInvalidationBatch::thread_ = nullptr;
+QMap<Node*, NodeInvalidationBatch::Pending> NodeInvalidationBatch::pending_;
+
+NodeInvalidationBatch::NodeInvalidationBatch()
+{
+  if (depth_ == 0 && !flushing_) {
+    thread_ = QThread::currentThread();
+  }
+
+  // Batches on other threads while one is active here are no-ops
+  if (QThread::currentThread() == thread_) {
+    depth_++;
+  }
+}
+
+NodeInvalidationBatch::~NodeInvalidationBatch()
+{
+  if (QThread::currentThread() != thread_) {
+    return;
+  }
+
+  depth_--;
+
+  if (depth_ == 0 && !flushing_) {
+    Flush();
+
+    thread_ = nullptr;
+  }
+}
+
+bool NodeInvalidationBatch::Defer(Node *node, const rational &start_range, const rational &end_range)
+{
+  if ((depth_ == 0 && !flushing_) || QThread::currentThread() != thread_) {
+    return false;
+  }
+
+  Pending& p = pending_[node];
+
+  if (p.node.isNull()) {
+    // Either new or a deleted Node's address being reused, in which case its ranges are meaningless
+    p.node = node;
+    p.ranges.clear();
+  }
+
+  p.ranges.append(Range(start_range, end_range));
+
+  return true;
+}
+
+void NodeInvalidationBatch::Flush()
+{
+  flushing_ = true;
+
+  while (!pending_.isEmpty()) {
+    QMap<Node*, Pending> round = pending_;
+    pending_.clear();
+
+    QMap<Node*, Pending>::const_iterator i;
+
+    for (i=round.constBegin();i!=round.constEnd();i++) {
+      // The Node may have been deleted since it signalled
+      if (i.value().node.isNull()) {
+        continue;
+      }
+
+      QList<Range> ranges = MergeRanges(i.value().ranges);
+
+      foreach (const Range& r, ranges) {
+        i.value().node->PropagateInvalidateCache(r.first, r.second);
+      }
+    }
+  }
+
+  flushing_ = false;
+}
+
+QList<NodeInvalidationBatch::Range> NodeInvalidationBatch::MergeRanges(QList<Range> ranges)
+{
+  std::sort(ranges.begin(), ranges.end());
+
+  QList<Range> merged;
+
+  foreach (const Range& r, ranges) {
+    if (!merged.isEmpty() && r.first <= merged.last().second) {
+      merged.last().second = qMax(merged.last().second, r.second);
+    } else {
+      merged.append(r);
+    }
+  }
+
+  return merged;
+}
@@ -0,0 +1,92 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef NODEINVALIDATIONBATCH_H
+#define NODEINVALIDATIONBATCH_H
+
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QPointer>
+
+#include "common/rational.h"
+
+class Node;
+class QThread;
+
+/**
+ * @brief Collects cache invalidations and propagates them once when it goes out of scope
+ *
+ * A single edit (e.g. dragging several clips at once) can make Nodes call Node::SendInvalidateCache() many times, and
+ * each call walks the rest of the graph and re-queues frames in any RendererProcessor. While a batch exists, these
+ * calls are recorded per Node instead. When the outermost batch is destroyed, each Node's ranges are merged where they
+ * overlap and sent once. Anything downstream that signals again in response is batched the same way, so every Node
+ * is reached once per merged range.
+ *
+ * Batches nest and only affect the thread that created them (usually the main thread). Nodes still clear their own
+ * caches immediately, only the propagation is deferred.
+ *
+ * TrackOutput::BlockInvalidateCache() is different in that it discards signals rather than deferring them, since a
+ * TrackOutput knows the exact area an operation affects. Edits to a timeline are better grouped with
+ * TimelineOutput::BeginEdit(), which merges everything its tracks send into one range.
+ */
+class NodeInvalidationBatch
+{
+public:
+  NodeInvalidationBatch();
+
+  ~NodeInvalidationBatch();
+
+  /**
+   * @brief Record an invalidation from `node` if a batch is active on this thread
+   *
+   * Returns true if the invalidation was deferred, in which case the caller shouldn't propagate it itself.
+   */
+  static bool Defer(Node* node, const rational& start_range, const rational& end_range);
+
+private:
+  typedef QPair<rational, rational> Range;
+
+  struct Pending {
+    QPointer<Node> node;
+    QList<Range> ranges;
+  };
+
+  /**
+   * @brief Send every pending invalidation, repeating until nothing downstream defers any more
+   */
+  static void Flush();
+
+  /**
+   * @brief Sort `ranges` and merge the ones that overlap or touch
+   */
+  static QList<Range> MergeRanges(QList<Range> ranges);
+
+  static int depth_;
+
+  static bool flushing_;
+
+  static QThread* thread_;
+
+  static QMap<Node*, Pending> pending_;
+
+};
+
+#endif // NODEINVALIDATIONBATCH_H
@@ -23,12 +23,14 @@
 NodeKeyframe::NodeKeyframe() :
   time_(0),
   value_(0),
-  type_(kLinear)
+  type_(kLinear),
+  memory_tracker_(MemoryStats::kKeyframes)
 {
+  memory_tracker_.SetBytes(static_cast<qint64>(sizeof(NodeKeyframe)));
 
 }
 
-const rational &NodeKeyframe::time()
+const rational &NodeKeyframe::time() const
 {
   return time_;
 }
@@ -38,7 +40,7 @@ void NodeKeyframe::set_time(const rational &time)
   time_ = time;
 }
 
-const QVariant &NodeKeyframe::value()
+const QVariant &NodeKeyframe::value() const
 {
   return value_;
 }
@@ -48,7 +50,7 @@ void NodeKeyframe::set_value(const QVariant &value)
   value_ = value;
 }
 
-const NodeKeyframe::Type &NodeKeyframe::type()
+const NodeKeyframe::Type &NodeKeyframe::type() const
 {
   return type_;
 }
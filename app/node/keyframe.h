@@ -23,6 +23,7 @@
 
 #include <QVariant>
 
+#include "common/memorystats.h"
 #include "common/rational.h"
 
 /**
@@ -49,19 +50,19 @@ public:
   /**
    * @brief The time this keyframe is set at
    */
-  const rational& time();
+  const rational& time() const;
   void set_time(const rational& time);
 
   /**
    * @brief The value of this keyframe (i.e. the value to use at this keyframe's time)
    */
-  const QVariant& value();
+  const QVariant& value() const;
   void set_value(const QVariant &value);
 
   /**
    * @brief The method of interpolation to use with this keyframe
    */
-  const Type& type();
+  const Type& type() const;
   void set_type(const Type& type);
 
 private:
@@ -70,6 +71,8 @@ private:
   QVariant value_;
 
   Type type_;
+
+  MemoryTracker memory_tracker_;
 };
 
 #endif // NODEKEYFRAME_H
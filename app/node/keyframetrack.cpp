@@ -0,0 +1,290 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "keyframetrack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <QColor>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+
+namespace {
+
+bool KeyframeTimeLessThan(const NodeKeyframe& a, const NodeKeyframe& b)
+{
+  return a.time() < b.time();
+}
+
+}
+
+NodeKeyframeTrack::NodeKeyframeTrack(const QList<NodeKeyframe> &keyframes, const NodeParam::DataType &type) :
+  keyframes_(keyframes),
+  type_(type),
+  components_(ComponentCount(type))
+{
+  std::stable_sort(keyframes_.begin(), keyframes_.end(), KeyframeTimeLessThan);
+
+  times_.resize(keyframes_.size());
+  values_.resize(keyframes_.size());
+
+  for (int i=0;i<keyframes_.size();i++) {
+    times_[i] = keyframes_.at(i).time().toDouble();
+    values_[i] = NodeParam::VariantToValue(type_, keyframes_.at(i).value());
+  }
+
+  if (components_ == 0 || keyframes_.size() < 2) {
+    // Nothing to interpolate
+    return;
+  }
+
+  segments_.resize(keyframes_.size() - 1);
+
+  float start[kMaxComponents];
+  float end[kMaxComponents];
+
+  Unpack(values_.first(), end);
+
+  for (int i=0;i<segments_.size();i++) {
+    Segment& s = segments_[i];
+
+    memcpy(start, end, sizeof(start));
+    Unpack(values_.at(i + 1), end);
+
+    double duration = times_.at(i + 1) - times_.at(i);
+    s.inv_duration = (duration > 0.0) ? 1.0 / duration : 0.0;
+
+    for (int j=0;j<components_;j++) {
+      float delta = end[j] - start[j];
+
+      s.a[j] = start[j];
+
+      switch (keyframes_.at(i).type()) {
+      case NodeKeyframe::kHold:
+        s.b[j] = 0.0f;
+        s.c[j] = 0.0f;
+        s.d[j] = 0.0f;
+        break;
+      case NodeKeyframe::kBezier:
+        // A cubic bezier with flat handles a third of the way along the segment, which eases in and out
+        s.b[j] = 0.0f;
+        s.c[j] = 3.0f * delta;
+        s.d[j] = -2.0f * delta;
+        break;
+      case NodeKeyframe::kLinear:
+      default:
+        s.b[j] = delta;
+        s.c[j] = 0.0f;
+        s.d[j] = 0.0f;
+        break;
+      }
+    }
+  }
+}
+
+const QList<NodeKeyframe> &NodeKeyframeTrack::keyframes() const
+{
+  return keyframes_;
+}
+
+int NodeKeyframeTrack::count() const
+{
+  return keyframes_.size();
+}
+
+const NodeParam::DataType &NodeKeyframeTrack::type() const
+{
+  return type_;
+}
+
+int NodeKeyframeTrack::FindKeyframe(const double &time, int *hint) const
+{
+  int n = times_.size();
+  int h = *hint;
+
+  // Try the hinted segment and the one after it first
+  for (int i=h;i<=h+1;i++) {
+    if (i >= 0
+        && i < n
+        && times_.at(i) <= time
+        && (i + 1 == n || time < times_.at(i + 1))) {
+      *hint = i;
+      return i;
+    }
+  }
+
+  int index = static_cast<int>(std::upper_bound(times_.constBegin(), times_.constEnd(), time) - times_.constBegin()) - 1;
+
+  *hint = index;
+
+  return index;
+}
+
+NodeValue NodeKeyframeTrack::Value(const rational &time, int *hint, rational *in, rational *out) const
+{
+  if (values_.isEmpty()) {
+    return NodeValue();
+  }
+
+  int index = FindKeyframe(time.toDouble(), hint);
+
+  if (index < 0) {
+    // Before the first keyframe, the value holds until it
+    if (in != nullptr) {
+      *in = RATIONAL_MIN;
+      *out = keyframes_.first().time();
+    }
+
+    return values_.first();
+  }
+
+  if (index >= segments_.size() || keyframes_.at(index).type() == NodeKeyframe::kHold) {
+    // Either after the last keyframe, a hold keyframe or a type that can't be interpolated, so the value holds until
+    // the next keyframe
+    if (in != nullptr) {
+      *in = keyframes_.at(index).time();
+      *out = (index + 1 < keyframes_.size()) ? keyframes_.at(index + 1).time() : RATIONAL_MAX;
+    }
+
+    return values_.at(index);
+  }
+
+  if (in != nullptr) {
+    *in = time;
+    *out = time;
+  }
+
+  const Segment& s = segments_.at(index);
+
+  float t = static_cast<float>((time.toDouble() - times_.at(index)) * s.inv_duration);
+
+  float values[kMaxComponents];
+
+  for (int j=0;j<components_;j++) {
+    values[j] = s.a[j] + t * (s.b[j] + t * (s.c[j] + t * s.d[j]));
+  }
+
+  return Pack(values);
+}
+
+void NodeKeyframeTrack::NeighborRange(const rational &time, rational *in, rational *out) const
+{
+  // The first keyframe at or after `time`
+  QList<NodeKeyframe>::const_iterator it = std::lower_bound(keyframes_.constBegin(),
+                                                            keyframes_.constEnd(),
+                                                            time,
+                                                            [](const NodeKeyframe& key, const rational& t) {
+    return key.time() < t;
+  });
+
+  *in = (it == keyframes_.constBegin()) ? RATIONAL_MIN : (it - 1)->time();
+
+  // Skip the keyframe at `time` itself
+  if (it != keyframes_.constEnd() && it->time() == time) {
+    it++;
+  }
+
+  *out = (it == keyframes_.constEnd()) ? RATIONAL_MAX : it->time();
+}
+
+const NodeValue &NodeKeyframeTrack::FirstValue() const
+{
+  return values_.first();
+}
+
+int NodeKeyframeTrack::ComponentCount(const NodeParam::DataType &type)
+{
+  switch (type) {
+  case NodeParam::kInt:
+  case NodeParam::kFloat:
+    return 1;
+  case NodeParam::kVec2:
+    return 2;
+  case NodeParam::kVec3:
+    return 3;
+  case NodeParam::kVec4:
+  case NodeParam::kColor:
+    return 4;
+  default:
+    return 0;
+  }
+}
+
+void NodeKeyframeTrack::Unpack(const NodeValue &value, float *out) const
+{
+  switch (type_) {
+  case NodeParam::kInt:
+  case NodeParam::kFloat:
+    out[0] = value.toFloat();
+    break;
+  case NodeParam::kVec2:
+  {
+    QVector2D v = value.toVec2();
+    out[0] = v.x();
+    out[1] = v.y();
+    break;
+  }
+  case NodeParam::kVec3:
+  {
+    QVector3D v = value.toVec3();
+    out[0] = v.x();
+    out[1] = v.y();
+    out[2] = v.z();
+    break;
+  }
+  case NodeParam::kVec4:
+  case NodeParam::kColor:
+  {
+    // Colors are stored as RGBA floats, so they unpack the same way as a vec4
+    QVector4D v = value.toVec4();
+    out[0] = v.x();
+    out[1] = v.y();
+    out[2] = v.z();
+    out[3] = v.w();
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+NodeValue NodeKeyframeTrack::Pack(const float *values) const
+{
+  switch (type_) {
+  case NodeParam::kInt:
+    return NodeValue(qRound(values[0]));
+  case NodeParam::kFloat:
+    return NodeValue(static_cast<double>(values[0]));
+  case NodeParam::kVec2:
+    return NodeValue(QVector2D(values[0], values[1]));
+  case NodeParam::kVec3:
+    return NodeValue(QVector3D(values[0], values[1], values[2]));
+  case NodeParam::kVec4:
+    return NodeValue(QVector4D(values[0], values[1], values[2], values[3]));
+  case NodeParam::kColor:
+    return NodeValue(QColor::fromRgbF(static_cast<qreal>(qBound(0.0f, values[0], 1.0f)),
+                                      static_cast<qreal>(qBound(0.0f, values[1], 1.0f)),
+                                      static_cast<qreal>(qBound(0.0f, values[2], 1.0f)),
+                                      static_cast<qreal>(qBound(0.0f, values[3], 1.0f))));
+  default:
+    return NodeValue();
+  }
+}
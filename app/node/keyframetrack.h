@@ -0,0 +1,149 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef NODEKEYFRAMETRACK_H
+#define NODEKEYFRAMETRACK_H
+
+#include <QList>
+#include <QVector>
+
+#include "keyframe.h"
+#include "param.h"
+
+/**
+ * @brief An immutable, sorted set of keyframes compiled for fast evaluation
+ *
+ * Keyframe times are stored as a contiguous array of doubles that's binary searched, and keyframe values are
+ * converted from their QVariants to NodeValues once, when the track is built. Every
+ * segment between two keyframes has its cubic polynomial precomputed, so evaluating a time is a search (usually
+ * skipped with the hint, see Evaluate()) and a few multiply-adds per component.
+ *
+ * Types that can't be interpolated (strings, matrices, etc.) hold the value of the keyframe before the time.
+ */
+class NodeKeyframeTrack
+{
+public:
+  /**
+   * @brief Maximum number of float components a value can have (e.g. 4 for kVec4 or kColor)
+   */
+  static const int kMaxComponents = 4;
+
+  /**
+   * @brief Build a track from `keyframes`, which don't have to be sorted
+   *
+   * @param type
+   *
+   * The data type of the values, determines how they're unpacked and interpolated.
+   */
+  NodeKeyframeTrack(const QList<NodeKeyframe>& keyframes, const NodeParam::DataType& type);
+
+  /**
+   * @brief The keyframes of this track, sorted by time
+   */
+  const QList<NodeKeyframe>& keyframes() const;
+
+  int count() const;
+
+  const NodeParam::DataType& type() const;
+
+  /**
+   * @brief Returns the index of the last keyframe at or before `time`, or -1 if `time` is before the first
+   *
+   * @param hint
+   *
+   * A previous result of this function (or -1). If `time` is in the same or the following segment as the hint, no
+   * search is needed, which makes sequential evaluation (e.g. during playback) O(1). Updated with the result.
+   */
+  int FindKeyframe(const double& time, int* hint) const;
+
+  /**
+   * @brief Return the value at `time` in the track's data type
+   *
+   * @param hint
+   *
+   * See FindKeyframe().
+   *
+   * @param in, out
+   *
+   * If non-null, set to the range of time the value is constant over ([in, out), or exactly `time` if in == out).
+   */
+  NodeValue Value(const rational& time, int* hint, rational* in = nullptr, rational* out = nullptr) const;
+
+  /**
+   * @brief Returns the range changing a keyframe at `time` affects, from the keyframe before it to the one after
+   *
+   * Segments are only interpolated from the keyframes at either end, so nothing outside this range changes. `in` is
+   * RATIONAL_MIN if there's no keyframe before `time` and `out` is RATIONAL_MAX if there's none after, since the
+   * first and last values hold forever. O(log n).
+   */
+  void NeighborRange(const rational& time, rational* in, rational* out) const;
+
+  /**
+   * @brief The value of the first keyframe, used when an input isn't keyframed
+   */
+  const NodeValue& FirstValue() const;
+
+  /**
+   * @brief Returns the number of float components values of `type` are interpolated as, or 0 if they can't be
+   */
+  static int ComponentCount(const NodeParam::DataType& type);
+
+private:
+  /**
+   * @brief Cubic polynomial coefficients of one segment for each component
+   *
+   * The value at normalized time `t` (0.0 at the segment's first keyframe, 1.0 at its second) is
+   * `a + t*(b + t*(c + t*d))`.
+   */
+  struct Segment {
+    float a[kMaxComponents];
+    float b[kMaxComponents];
+    float c[kMaxComponents];
+    float d[kMaxComponents];
+
+    /// 1.0 / the segment's duration
+    double inv_duration;
+  };
+
+  /**
+   * @brief Unpack a value into `components` floats
+   */
+  void Unpack(const NodeValue& value, float* out) const;
+
+  /**
+   * @brief Pack `components` floats into a value of the track's data type
+   */
+  NodeValue Pack(const float* values) const;
+
+  QList<NodeKeyframe> keyframes_;
+
+  NodeParam::DataType type_;
+
+  int components_;
+
+  QVector<double> times_;
+
+  QVector<NodeValue> values_;
+
+  QVector<Segment> segments_;
+
+};
+
+#endif // NODEKEYFRAMETRACK_H
@@ -21,11 +21,37 @@
 #include "node.h"
 
 #include <QDebug>
+#include <QSet>
 
 #include "common/qobjectlistcast.h"
+#include "node/blend/alphaover/alphaover.h"
+#include "node/block/clip/clip.h"
+#include "node/block/gap/gap.h"
+#include "node/color/opacity/opacity.h"
+#include "node/distort/transform/transform.h"
+#include "node/generator/solid/solid.h"
+#include "node/input/media/media.h"
+#include "node/input/multicam/multicam.h"
+#include "node/invalidationbatch.h"
+#ifdef OLIVE_USE_OPENFX
+#include "node/ofx/ofxhost.h"
+#endif
+#include "node/output/timeline/timeline.h"
+#include "node/output/track/track.h"
+#include "node/output/viewer/viewer.h"
+#include "node/processor/renderer/renderer.h"
+#include "render/gpuprofiler.h"
+#include "render/profiler.h"
+
+QAtomicInt Node::topology_version_(0);
 
 Node::Node() :
-  last_processed_time_(-1)
+  last_processed_time_(-1),
+  hash_cache_generation_(0),
+  dependencies_version_(-1),
+  profiler_source_(-1),
+  file_key_(-1),
+  modified_(true)
 {
 }
 
@@ -77,10 +103,23 @@ void Node::InvalidateCache(const rational &start_range, const rational &end_rang
 
   ClearCachedValuesInParameters(start_range, end_range);
 
+  ClearCachedHashes(start_range, end_range);
+
+  ClearCachedExecutionPlans(start_range, end_range);
+
   SendInvalidateCache(start_range, end_range);
 }
 
 void Node::SendInvalidateCache(const rational &start_range, const rational &end_range)
+{
+  if (NodeInvalidationBatch::Defer(this, start_range, end_range)) {
+    return;
+  }
+
+  PropagateInvalidateCache(start_range, end_range);
+}
+
+void Node::PropagateInvalidateCache(const rational &start_range, const rational &end_range)
 {
   QList<NodeParam *> params = parameters();
 
@@ -104,7 +143,12 @@ void Node::SendInvalidateCache(const rational &start_range, const rational &end_
 
 void Node::Lock()
 {
-  lock_.lock();
+  // Only time the lock when it's contended so the common case stays cheap
+  if (!lock_.tryLock()) {
+    ProfilerTimer timer(Profiler::kLockWait);
+
+    lock_.lock();
+  }
 }
 
 void Node::Unlock()
@@ -112,6 +156,11 @@ void Node::Unlock()
   lock_.unlock();
 }
 
+bool Node::TryLock()
+{
+  return lock_.tryLock();
+}
+
 void Node::CopyInputs(Node *source, Node *destination)
 {
   Q_ASSERT(source->id() == destination->id());
@@ -132,6 +181,81 @@ void Node::CopyInputs(Node *source, Node *destination)
   }
 }
 
+template<class T>
+static Node* CreateNodeOfType()
+{
+  return new T();
+}
+
+typedef Node* (*NodeCreator)();
+
+static QHash<QString, NodeCreator> CreateNodeCreatorTable()
+{
+  QList<NodeCreator> creators;
+
+  creators.append(CreateNodeOfType<AlphaOverBlend>);
+  creators.append(CreateNodeOfType<ClipBlock>);
+  creators.append(CreateNodeOfType<GapBlock>);
+  creators.append(CreateNodeOfType<OpacityNode>);
+  creators.append(CreateNodeOfType<TransformDistort>);
+  creators.append(CreateNodeOfType<SolidGenerator>);
+  creators.append(CreateNodeOfType<MediaInput>);
+  creators.append(CreateNodeOfType<MulticamNode>);
+  creators.append(CreateNodeOfType<TimelineOutput>);
+  creators.append(CreateNodeOfType<TrackOutput>);
+  creators.append(CreateNodeOfType<ViewerOutput>);
+  creators.append(CreateNodeOfType<RendererProcessor>);
+
+  // Create each Node once to learn its ID, so loading a project doesn't create one of every Node for each Node
+  QHash<QString, NodeCreator> table;
+
+  foreach (NodeCreator c, creators) {
+    Node* n = c();
+    table.insert(n->id(), c);
+    delete n;
+  }
+
+  return table;
+}
+
+Node *Node::CreateFromID(const QString &id)
+{
+  static const QHash<QString, NodeCreator> creators = CreateNodeCreatorTable();
+
+  NodeCreator c = creators.value(id, nullptr);
+
+  if (c == nullptr) {
+#ifdef OLIVE_USE_OPENFX
+    // Nodes that aren't built in may be OpenFX plugins
+    return OFXHost::Instance()->CreateNode(id);
+#else
+    return nullptr;
+#endif
+  }
+
+  return c();
+}
+
+int Node::file_key() const
+{
+  return file_key_;
+}
+
+void Node::set_file_key(int key)
+{
+  file_key_ = key;
+}
+
+bool Node::IsModified() const
+{
+  return modified_;
+}
+
+void Node::SetModified(bool modified)
+{
+  modified_ = modified;
+}
+
 rational Node::LastProcessedTime()
 {
   rational t;
@@ -173,11 +297,22 @@ void Node::ClearCachedValuesInParameters(const rational &start_range, const rati
   }
 }
 
-QVariant Node::Run(NodeOutput* output, const rational& time)
+NodeValue Node::Run(NodeOutput* output, const rational& time)
 {
   run_lock_.lock();
 
-  QVariant v = Value(output, time);
+  if (profiler_source_ < 0 && olive::profiler.IsEnabled()) {
+    profiler_source_ = olive::profiler.RegisterSource(Name());
+  }
+
+  NodeValue v;
+
+  {
+    ProfilerTimer timer(Profiler::kNodeRun, profiler_source_, time);
+    GPUTimer gpu_timer(Profiler::kGPUNode, profiler_source_, time);
+
+    v = Value(output, time);
+  }
 
   run_lock_.unlock();
 
@@ -211,23 +346,31 @@ int Node::IndexOfParameter(NodeParam *param)
  *
  * TRUE to recursively traverse each node for a complete dependency graph. FALSE to return only the immediate
  * dependencies.
+ *
+ * @param visited
+ *
+ * The contents of `list` as a set for constant time lookups. Nodes already in it aren't traversed again, so Nodes
+ * shared by several branches of the graph are only visited once.
  */
-void GetDependenciesInternal(Node* n, QList<Node*>& list, bool traverse) {
+void GetDependenciesInternal(Node* n, QList<Node*>& list, QSet<Node*>& visited, bool traverse) {
   QList<NodeParam*> params = n->parameters();
 
   foreach (NodeParam* p, params) {
     if (p->type() == NodeParam::kInput) {
-      QVector<NodeEdgePtr> param_edges = p->edges();
+      const QVector<NodeEdgePtr>& param_edges = p->edges();
 
       foreach (NodeEdgePtr edge, param_edges) {
         Node* connected_node = edge->output()->parent();
 
-        if (!list.contains(connected_node)) {
-          list.append(connected_node);
+        if (visited.contains(connected_node)) {
+          continue;
         }
 
+        visited.insert(connected_node);
+        list.append(connected_node);
+
         if (traverse) {
-          GetDependenciesInternal(connected_node, list, traverse);
+          GetDependenciesInternal(connected_node, list, visited, traverse);
         }
       }
     }
@@ -236,16 +379,51 @@ void GetDependenciesInternal(Node* n, QList<Node*>& list, bool traverse) {
 
 QList<Node *> Node::GetDependencies()
 {
-  QList<Node *> node_list;
+  QMutexLocker locker(&dependencies_lock_);
 
-  GetDependenciesInternal(this, node_list, true);
+  UpdateDependencies();
 
-  return node_list;
+  return dependencies_;
+}
+
+void Node::UpdateDependencies()
+{
+  int version = topology_version_.loadAcquire();
+
+  if (dependencies_version_ != version) {
+    QSet<Node*> visited;
+
+    dependencies_.clear();
+
+    GetDependenciesInternal(this, dependencies_, visited, true);
+
+    exclusive_dependencies_ = FilterExclusiveDependencies(dependencies_);
+
+    dependencies_version_ = version;
+  }
+}
+
+void Node::TopologyChanged()
+{
+  topology_version_.fetchAndAddOrdered(1);
 }
 
 QList<Node *> Node::GetExclusiveDependencies()
 {
-  QList<Node*> deps = GetDependencies();
+  QMutexLocker locker(&dependencies_lock_);
+
+  UpdateDependencies();
+
+  return exclusive_dependencies_;
+}
+
+QList<Node *> Node::FilterExclusiveDependencies(QList<Node *> deps)
+{
+  QSet<Node*> dep_set;
+
+  foreach (Node* n, deps) {
+    dep_set.insert(n);
+  }
 
   // Filter out any dependencies that are used elsewhere
   for (int i=0;i<deps.size();i++) {
@@ -263,7 +441,8 @@ QList<Node *> Node::GetExclusiveDependencies()
 
           // If any edge goes to from an output here to an input of a Node that isn't in this dep list, it's NOT an
           // exclusive dependency
-          if (deps.contains(edge->input()->parent())) {
+          if (dep_set.contains(edge->input()->parent())) {
+            dep_set.remove(deps.at(i));
             deps.removeAt(i);
 
             i--;                // -1 since we just removed a Node in this list
@@ -281,8 +460,9 @@ QList<Node *> Node::GetExclusiveDependencies()
 QList<Node *> Node::GetImmediateDependencies()
 {
   QList<Node *> node_list;
+  QSet<Node *> visited;
 
-  GetDependenciesInternal(this, node_list, false);
+  GetDependenciesInternal(this, node_list, visited, false);
 
   return node_list;
 }
@@ -312,6 +492,109 @@ QList<NodeDependency> Node::RunDependencies(NodeOutput *output, const rational &
   return run_deps;
 }
 
+bool Node::IsTimeInvariant(NodeOutput *output)
+{
+  Q_UNUSED(output)
+
+  return false;
+}
+
+bool Node::IsIdentity(NodeOutput *output, const rational &time)
+{
+  Q_UNUSED(output)
+  Q_UNUSED(time)
+
+  return false;
+}
+
+bool Node::InputsAreTimeInvariant()
+{
+  QList<NodeParam*> params = parameters();
+
+  foreach (NodeParam* p, params) {
+    if (p->type() == NodeParam::kInput) {
+      NodeInput* input = static_cast<NodeInput*>(p);
+      NodeOutput* connected = input->get_connected_output();
+
+      if (connected != nullptr) {
+        if (!connected->parent()->IsTimeInvariant(connected)) {
+          return false;
+        }
+      } else if (input->IsAnimated()) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void Node::StaticRange(NodeOutput *output, const rational &time, rational *in, rational *out)
+{
+  InputsStaticRange(time, in, out);
+
+  QList<NodeDependency> deps = RunDependencies(output, time);
+
+  foreach (const NodeDependency& dep, deps) {
+    if (*in == *out) {
+      // Can't get any narrower
+      return;
+    }
+
+    if (dep.time() != time) {
+      // There's no telling how the time was changed, so the range can't be mapped back
+      *in = time;
+      *out = time;
+      return;
+    }
+
+    rational dep_in, dep_out;
+    dep.node()->parent()->StaticRange(dep.node(), time, &dep_in, &dep_out);
+
+    IntersectStaticRange(time, dep_in, dep_out, in, out);
+  }
+}
+
+void Node::InputsStaticRange(const rational &time, rational *in, rational *out)
+{
+  *in = RATIONAL_MIN;
+  *out = RATIONAL_MAX;
+
+  QList<NodeParam*> params = parameters();
+
+  // Matches the inputs hashed by Hash()
+  foreach (NodeParam* p, params) {
+    if (p->type() == NodeParam::kInput
+        && !p->IsConnected()
+        && static_cast<NodeInput*>(p)->dependent()) {
+      rational input_in, input_out;
+      static_cast<NodeInput*>(p)->StaticRange(time, &input_in, &input_out);
+
+      IntersectStaticRange(time, input_in, input_out, in, out);
+
+      if (*in == *out) {
+        return;
+      }
+    }
+  }
+}
+
+void Node::IntersectStaticRange(const rational &time,
+                                const rational &range_in,
+                                const rational &range_out,
+                                rational *in,
+                                rational *out)
+{
+  if (*in == *out || range_in == range_out) {
+    *in = time;
+    *out = time;
+    return;
+  }
+
+  *in = qMax(*in, range_in);
+  *out = qMin(*out, range_out);
+}
+
 bool Node::OutputsTo(Node *n)
 {
   QList<NodeParam*> params = parameters();
@@ -331,7 +614,7 @@ bool Node::OutputsTo(Node *n)
   return false;
 }
 
-void Node::Hash(QCryptographicHash *hash, NodeOutput* from, const rational &time)
+void Node::Hash(FastHash *hash, NodeOutput* from, const rational &time)
 {
   // Add this Node's ID
   hash->addData(id().toUtf8());
@@ -343,7 +626,7 @@ void Node::Hash(QCryptographicHash *hash, NodeOutput* from, const rational &time
         && !param->IsConnected()
         && static_cast<NodeInput*>(param)->dependent()) {
       // Get the value at this time
-      QVariant v = static_cast<NodeInput*>(param)->get_value(time);
+      NodeValue v = static_cast<NodeInput*>(param)->get_value(time);
 
       hash->addData(NodeParam::ValueToBytes(param->data_type(), v));
     }
@@ -352,8 +635,99 @@ void Node::Hash(QCryptographicHash *hash, NodeOutput* from, const rational &time
   // Add each dependency node
   QList<NodeDependency> deps = RunDependencies(from, time);
   foreach (const NodeDependency& dep, deps) {
-    // Hash the connected node
-    dep.node()->parent()->Hash(hash, dep.node(), dep.time());
+    // Add the connected node's hash (which is memoized so unchanged subtrees aren't hashed again)
+    hash->addData(dep.node()->parent()->CachedHash(dep.node(), dep.time()));
+  }
+}
+
+QByteArray Node::CachedHash(NodeOutput *from, const rational &time)
+{
+  hash_cache_lock_.lock();
+
+  QByteArray cached = hash_cache_.value(from).value(time);
+  quint64 generation = hash_cache_generation_;
+
+  hash_cache_lock_.unlock();
+
+  if (!cached.isEmpty()) {
+    return cached;
+  }
+
+  FastHash hash;
+  Hash(&hash, from, time);
+  QByteArray result = hash.result();
+
+  hash_cache_lock_.lock();
+  if (hash_cache_generation_ == generation) {
+    hash_cache_[from].insert(time, result);
+  }
+  hash_cache_lock_.unlock();
+
+  return result;
+}
+
+void Node::ClearCachedHashes(const rational &start_range, const rational &end_range)
+{
+  QMutexLocker locker(&hash_cache_lock_);
+
+  hash_cache_generation_++;
+
+  QHash<NodeOutput*, QMap<rational, QByteArray> >::iterator i;
+
+  for (i=hash_cache_.begin();i!=hash_cache_.end();i++) {
+    QMap<rational, QByteArray>& times = i.value();
+
+    QMap<rational, QByteArray>::iterator j = times.lowerBound(start_range);
+
+    while (j != times.end() && j.key() <= end_range) {
+      j = times.erase(j);
+    }
+  }
+}
+
+NodeExecutionPlan Node::CachedExecutionPlan(NodeOutput *from, const rational &time)
+{
+  plan_cache_lock_.lock();
+
+  QHash<NodeOutput*, QMap<rational, NodeExecutionPlan> >::const_iterator times = plan_cache_.constFind(from);
+
+  if (times != plan_cache_.constEnd()) {
+    QMap<rational, NodeExecutionPlan>::const_iterator cached = times.value().constFind(time);
+
+    if (cached != times.value().constEnd()) {
+      NodeExecutionPlan plan = cached.value();
+
+      plan_cache_lock_.unlock();
+
+      return plan;
+    }
+  }
+
+  plan_cache_lock_.unlock();
+
+  NodeExecutionPlan plan = NodeExecutionPlan::Compile(from, time);
+
+  plan_cache_lock_.lock();
+  plan_cache_[from].insert(time, plan);
+  plan_cache_lock_.unlock();
+
+  return plan;
+}
+
+void Node::ClearCachedExecutionPlans(const rational &start_range, const rational &end_range)
+{
+  QMutexLocker locker(&plan_cache_lock_);
+
+  QHash<NodeOutput*, QMap<rational, NodeExecutionPlan> >::iterator i;
+
+  for (i=plan_cache_.begin();i!=plan_cache_.end();i++) {
+    QMap<rational, NodeExecutionPlan>& times = i.value();
+
+    QMap<rational, NodeExecutionPlan>::iterator j = times.lowerBound(start_range);
+
+    while (j != times.end() && j.key() <= end_range) {
+      j = times.erase(j);
+    }
   }
 }
 
@@ -379,6 +753,8 @@ bool Node::HasParamWithID(const QString &id)
 
 void Node::InputChanged(rational start, rational end)
 {
+  modified_ = true;
+
   InvalidateCache(start, end, static_cast<NodeInput*>(sender()));
 }
 
@@ -386,5 +762,7 @@ void Node::InputConnectionChanged(NodeEdgePtr edge)
 {
   Q_UNUSED(edge)
 
+  modified_ = true;
+
   InvalidateCache(RATIONAL_MIN, RATIONAL_MAX, static_cast<NodeInput*>(sender()));
 }
@@ -21,12 +21,15 @@
 #ifndef NODE_H
 #define NODE_H
 
-#include <QCryptographicHash>
+#include <QHash>
+#include <QMap>
 #include <QMutex>
 #include <QObject>
 
+#include "common/fasthash.h"
 #include "common/rational.h"
 #include "node/dependency.h"
+#include "node/executionplan.h"
 #include "node/input.h"
 #include "node/output.h"
 
@@ -118,9 +121,18 @@ public:
 
   /**
    * @brief Return a list of all Nodes that this Node's inputs are connected to (does not include this Node)
+   *
+   * The list is only recomputed when an edge has been added or removed anywhere since the last call (see
+   * TopologyChanged()), so calling this for every frame doesn't traverse the graph each time. Nodes shared by several
+   * branches are only traversed once.
    */
   QList<Node*> GetDependencies();
 
+  /**
+   * @brief Signal that an edge was added or removed somewhere, invalidating every Node's GetDependencies() list
+   */
+  static void TopologyChanged();
+
   /**
    * @brief Returns a list of Nodes that this Node is dependent on, provided no other Nodes are dependent on them
    * outside of this hierarchy.
@@ -139,7 +151,7 @@ public:
    *
    * It's recommended to call this directly over Value(), yet in derivatives of Node, override Value().
    */
-  QVariant Run(NodeOutput* output, const rational& time);
+  NodeValue Run(NodeOutput* output, const rational& time);
 
   /**
    * @brief For nodes that have different dependencies at different times, this function can be used for that purpose
@@ -148,27 +160,83 @@ public:
    */
   virtual QList<NodeDependency> RunDependencies(NodeOutput* output, const rational& time);
 
+  /**
+   * @brief Returns whether `output` has the same value at every time
+   *
+   * Time-invariant values (other than textures) are cached for all time (see NodeOutput::get_value()), so they're
+   * only evaluated once until something they depend on changes. Defaults to FALSE, nodes whose values only depend on
+   * their inputs can return InputsAreTimeInvariant().
+   */
+  virtual bool IsTimeInvariant(NodeOutput* output);
+
+  /**
+   * @brief Returns whether evaluating `output` at `time` costs next to nothing and leaves what it's given unchanged
+   *
+   * Identity nodes (e.g. 100% opacity) are left out of execution plans (see NodeExecutionPlan), whatever consumes them
+   * evaluates them inline instead. This is called while compiling plans, so implementations may only read inputs that
+   * aren't connected. Defaults to FALSE.
+   */
+  virtual bool IsIdentity(NodeOutput* output, const rational& time);
+
+  /**
+   * @brief Find the range of time around `time` that `output` hashes (and renders) the same for
+   *
+   * The range is half-open ([in, out)), or just `time` if `in == out`, like NodeParam's cached values. Renderers use it
+   * to render a held still once and map the whole range to it.
+   *
+   * The default intersects the ranges of every dependent input that isn't connected and every dependency, which is
+   * correct for nodes using the default Hash() that pass `time` on to their dependencies. Nodes that override Hash()
+   * or change the time of their dependencies should override this too.
+   */
+  virtual void StaticRange(NodeOutput* output, const rational& time, rational* in, rational* out);
+
   /**
    * @brief Returns whether this Node outputs data to the Node `n` in any way
    */
   bool OutputsTo(Node* n);
 
   /**
-   * @brief Add's unique information about this Node at the given time to a QCryptographicHash
+   * @brief Add's unique information about this Node at the given time to a FastHash
+   *
+   * Dependencies are included through their CachedHash() rather than by hashing them again.
+   */
+  virtual void Hash(FastHash* hash, NodeOutput *from, const rational& time);
+
+  /**
+   * @brief Return the hash of this Node and everything it depends on at the given time
+   *
+   * The result is memoized until InvalidateCache() is called with a range that includes `time`, so hashing a frame of
+   * an unchanged graph only costs a lookup per Node.
    */
-  virtual void Hash(QCryptographicHash* hash, NodeOutput *from, const rational& time);
+  QByteArray CachedHash(NodeOutput* from, const rational& time);
 
   /**
-   * @brief Convert a pointer to a value that can be sent between NodeParams
+   * @brief Return the execution plan of everything this Node depends on when evaluating `from` at the given time
+   *
+   * Plans are compiled with NodeExecutionPlan::Compile() and memoized the same way as CachedHash(), so they're only
+   * recompiled after the graph (or a value) changes.
+   */
+  NodeExecutionPlan CachedExecutionPlan(NodeOutput* from, const rational& time);
+
+  /**
+   * @brief Convert a pointer to a QVariant that can be set on a NodeInput or stored in the UI
+   *
+   * Node::Value() implementations should return NodeValue::FromPtr() instead.
    */
   static QVariant PtrToValue(void* ptr);
 
   template<class T>
   /**
-   * @brief Convert a NodeParam value to a pointer of any kind
+   * @brief Convert a QVariant created by PtrToValue() to a pointer of any kind
    */
   static T* ValueToPtr(const QVariant& ptr);
 
+  template<class T>
+  /**
+   * @brief Convert a NodeParam value to a pointer of any kind
+   */
+  static T* ValueToPtr(const NodeValue& ptr);
+
   /**
    * @brief Signal all dependent Nodes that anything cached between start_range and end_range is now invalid and
    *        requires re-rendering
@@ -190,6 +258,11 @@ public:
    */
   void Unlock();
 
+  /**
+   * @brief Lock mutex if it's free, returns TRUE if it was locked
+   */
+  bool TryLock();
+
   /**
    * @brief Copies inputs from from Node to another including connections
    *
@@ -197,6 +270,36 @@ public:
    */
   static void CopyInputs(Node* source, Node* destination);
 
+  /**
+   * @brief Create a new Node from its ID (see id())
+   *
+   * Used when loading projects. The caller takes ownership of the Node.
+   *
+   * @return
+   *
+   * A new Node or nullptr if no Node has this ID.
+   */
+  static Node* CreateFromID(const QString& id);
+
+  /**
+   * @brief Number identifying this Node in project files and autosave journals (see ProjectFile)
+   *
+   * Unique within its Project (see Project::TakeFileKey()), -1 until the Node is first saved. Copies of a Node get a
+   * key of their own.
+   */
+  int file_key() const;
+  void set_file_key(int key);
+
+  /**
+   * @brief Returns whether anything that's saved with this Node has changed since it was last saved or autosaved
+   *
+   * Set when an input's value or keyframes change, when an input is connected or disconnected (edges are saved with
+   * the Node they're connected to the input of) and when a Block's length or media in point changes. Only used on
+   * the main thread.
+   */
+  bool IsModified() const;
+  void SetModified(bool modified);
+
 protected:
   /**
    * @brief Add a parameter to this node
@@ -227,7 +330,7 @@ protected:
    * corresponding output if it's connected to one. If your node doesn't directly deal with time, the default behavior
    * of the NodeParam objects will handle everything related to it automatically.
    */
-  virtual QVariant Value(NodeOutput* output, const rational& time) = 0;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) = 0;
 
   /**
    * @brief Retrieve the last timecode Process() was called with
@@ -241,6 +344,44 @@ protected:
 
   void ClearCachedValuesInParameters(const rational& start_range, const rational& end_range);
 
+  /**
+   * @brief Returns TRUE if no input is animated or connected to an output that isn't time-invariant
+   *
+   * \see IsTimeInvariant()
+   */
+  bool InputsAreTimeInvariant();
+
+  /**
+   * @brief Start a StaticRange() with the range of every dependent input that isn't connected
+   */
+  void InputsStaticRange(const rational& time, rational* in, rational* out);
+
+  /**
+   * @brief Narrow [in, out) to the part it shares with [range_in, range_out), both must contain `time`
+   *
+   * If either range is only `time` itself (see StaticRange()), so is the result.
+   */
+  static void IntersectStaticRange(const rational& time,
+                                   const rational& range_in,
+                                   const rational& range_out,
+                                   rational* in,
+                                   rational* out);
+
+  /**
+   * @brief Discard memoized hashes (see CachedHash()) between two times inclusive
+   */
+  void ClearCachedHashes(const rational& start_range, const rational& end_range);
+
+  /**
+   * @brief Discard memoized execution plans (see CachedExecutionPlan()) between two times inclusive
+   */
+  void ClearCachedExecutionPlans(const rational& start_range, const rational& end_range);
+
+  /**
+   * @brief Invalidate everything connected to this Node's outputs between two times
+   *
+   * Deferred and merged with other invalidations if a NodeInvalidationBatch is active.
+   */
   void SendInvalidateCache(const rational& start_range, const rational& end_range);
 
 public slots:
@@ -265,6 +406,13 @@ signals:
   void EdgeRemoved(NodeEdgePtr edge);
 
 private:
+  friend class NodeInvalidationBatch;
+
+  /**
+   * @brief Call InvalidateCache() on every Node connected to this Node's outputs
+   */
+  void PropagateInvalidateCache(const rational& start_range, const rational& end_range);
+
   /**
    * @brief Return whether a parameter with ID `id` has already been added to this Node
    */
@@ -290,6 +438,66 @@ private:
    */
   QMutex run_lock_;
 
+  /**
+   * @brief Memoized results of CachedHash() for each output
+   */
+  QHash<NodeOutput*, QMap<rational, QByteArray> > hash_cache_;
+
+  QMutex hash_cache_lock_;
+
+  /**
+   * @brief Incremented by ClearCachedHashes()
+   *
+   * CachedHash() hashes without holding hash_cache_lock_, so it only memoizes its result if this hasn't changed in
+   * the meantime. Otherwise a hash worked out before an invalidation could outlive it.
+   */
+  quint64 hash_cache_generation_;
+
+  /**
+   * @brief Memoized results of CachedExecutionPlan() for each output
+   */
+  QHash<NodeOutput*, QMap<rational, NodeExecutionPlan> > plan_cache_;
+
+  QMutex plan_cache_lock_;
+
+  /**
+   * @brief Incremented every time an edge is added or removed in any graph
+   */
+  static QAtomicInt topology_version_;
+
+  /**
+   * @brief Recompute dependencies_ and exclusive_dependencies_ if the topology has changed since they were
+   *
+   * dependencies_lock_ must be held.
+   */
+  void UpdateDependencies();
+
+  /**
+   * @brief Remove the Nodes from `deps` that are used outside of it (see GetExclusiveDependencies())
+   */
+  static QList<Node*> FilterExclusiveDependencies(QList<Node*> deps);
+
+  /**
+   * @brief Memoized results of GetDependencies() and GetExclusiveDependencies() and the topology version they were
+   * computed at
+   */
+  QList<Node*> dependencies_;
+
+  QList<Node*> exclusive_dependencies_;
+
+  int dependencies_version_;
+
+  QMutex dependencies_lock_;
+
+  /**
+   * @brief ID of this Node in olive::profiler, registered the first time it's run while profiling
+   */
+  int profiler_source_;
+
+  int file_key_;
+
+  bool modified_;
+
 private slots:
   void InputChanged(rational start, rational end);
 
@@ -303,4 +511,10 @@ T* Node::ValueToPtr(const QVariant &ptr)
   return reinterpret_cast<T*>(ptr.value<quintptr>());
 }
 
+template<class T>
+T* Node::ValueToPtr(const NodeValue &ptr)
+{
+  return ptr.toPtr<T>();
+}
+
 #endif // NODE_H
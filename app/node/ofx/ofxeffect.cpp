@@ -0,0 +1,591 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ofxeffect.h"
+
+#include <QColor>
+#include <QThread>
+#include <QVector2D>
+#include <QVector3D>
+
+OFXParam::OFXParam(const QByteArray &name, const QByteArray &type) :
+  name_(name),
+  type_(type),
+  input_(nullptr)
+{
+  properties_.SetString(kOfxPropType, kOfxTypeParameter);
+  properties_.SetString(kOfxPropName, name);
+  properties_.SetString(kOfxPropLabel, name);
+  properties_.SetString(kOfxParamPropType, type);
+  properties_.SetString(kOfxParamPropScriptName, name);
+  properties_.SetString(kOfxParamPropHint, QByteArray());
+  properties_.SetString(kOfxParamPropParent, QByteArray());
+  properties_.SetInt(kOfxParamPropEnabled, 1);
+  properties_.SetInt(kOfxParamPropSecret, 0);
+  properties_.SetInt(kOfxParamPropEvaluateOnChange, 1);
+  properties_.SetInt(kOfxParamPropPersistant, 1);
+  properties_.SetInt(kOfxParamPropCanUndo, 1);
+  properties_.SetInt(kOfxParamPropIsAnimating, 0);
+  properties_.SetPointer(kOfxParamPropDataPtr, nullptr);
+
+  NodeParam::DataType data_type = this->data_type();
+
+  properties_.SetInt(kOfxParamPropAnimates, data_type == NodeParam::kFloat
+                     || data_type == NodeParam::kColor
+                     || data_type == NodeParam::kVec2
+                     || data_type == NodeParam::kVec3
+                     || type == kOfxParamTypeInteger);
+
+  // Plugins often read their own defaults back, so every parameter with a value starts with one
+  if (data_type == NodeParam::kString) {
+    properties_.SetString(kOfxParamPropDefault, QByteArray());
+  } else if (data_type == NodeParam::kFloat || data_type == NodeParam::kColor) {
+    properties_.SetDoubles(kOfxParamPropDefault, QVector<double>(dimension(), 0.0));
+  } else if (data_type != NodeParam::kNone) {
+    if (type == kOfxParamTypeDouble2D || type == kOfxParamTypeDouble3D) {
+      properties_.SetDoubles(kOfxParamPropDefault, QVector<double>(dimension(), 0.0));
+    } else {
+      properties_.SetInts(kOfxParamPropDefault, QVector<int>(dimension(), 0));
+    }
+  }
+}
+
+const QByteArray &OFXParam::name() const
+{
+  return name_;
+}
+
+const QByteArray &OFXParam::type() const
+{
+  return type_;
+}
+
+OFXPropertySet *OFXParam::properties()
+{
+  return &properties_;
+}
+
+NodeInput *OFXParam::input() const
+{
+  return input_;
+}
+
+void OFXParam::set_input(NodeInput *input)
+{
+  input_ = input;
+}
+
+NodeParam::DataType OFXParam::data_type() const
+{
+  if (type_ == kOfxParamTypeInteger || type_ == kOfxParamTypeChoice) {
+    return NodeParam::kInt;
+  } else if (type_ == kOfxParamTypeDouble) {
+    return NodeParam::kFloat;
+  } else if (type_ == kOfxParamTypeBoolean) {
+    return NodeParam::kBoolean;
+  } else if (type_ == kOfxParamTypeRGB || type_ == kOfxParamTypeRGBA) {
+    return NodeParam::kColor;
+  } else if (type_ == kOfxParamTypeDouble2D || type_ == kOfxParamTypeInteger2D) {
+    return NodeParam::kVec2;
+  } else if (type_ == kOfxParamTypeDouble3D || type_ == kOfxParamTypeInteger3D) {
+    return NodeParam::kVec3;
+  } else if (type_ == kOfxParamTypeString || type_ == kOfxParamTypeCustom) {
+    return NodeParam::kString;
+  }
+
+  // Groups, pages and push buttons only exist for the UI
+  return NodeParam::kNone;
+}
+
+int OFXParam::dimension() const
+{
+  if (type_ == kOfxParamTypeRGBA) {
+    return 4;
+  } else if (type_ == kOfxParamTypeRGB || type_ == kOfxParamTypeDouble3D || type_ == kOfxParamTypeInteger3D) {
+    return 3;
+  } else if (type_ == kOfxParamTypeDouble2D || type_ == kOfxParamTypeInteger2D) {
+    return 2;
+  } else if (data_type() == NodeParam::kNone) {
+    return 0;
+  }
+
+  return 1;
+}
+
+OfxStatus OFXParam::GetValue(const rational &time, va_list args)
+{
+  NodeParam::DataType data_type = this->data_type();
+
+  if (data_type == NodeParam::kNone) {
+    return kOfxStatErrBadHandle;
+  }
+
+  if (data_type == NodeParam::kString) {
+    QByteArray value;
+
+    if (input_ == nullptr) {
+      value = properties_.GetString(kOfxParamPropDefault);
+    } else {
+      value = input_->get_value(time).toString().toUtf8();
+    }
+
+    QMutexLocker locker(&string_lock_);
+
+    string_value_ = value;
+    *va_arg(args, char**) = string_value_.data();
+
+    return kOfxStatOK;
+  }
+
+  bool is_int = (type_ == kOfxParamTypeInteger
+                 || type_ == kOfxParamTypeChoice
+                 || type_ == kOfxParamTypeBoolean
+                 || type_ == kOfxParamTypeInteger2D
+                 || type_ == kOfxParamTypeInteger3D);
+
+  QVector<double> components = GetComponents(time);
+
+  foreach (double c, components) {
+    if (is_int) {
+      *va_arg(args, int*) = qRound(c);
+    } else {
+      *va_arg(args, double*) = c;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXParam::SetValue(va_list args)
+{
+  if (input_ == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  // Plugins may only change values in response to instance changes, which are sent from the main thread
+  if (QThread::currentThread() != input_->thread()) {
+    return kOfxStatFailed;
+  }
+
+  QVariant value = ReadValue(args);
+
+  if (value.isNull()) {
+    return kOfxStatErrBadHandle;
+  }
+
+  input_->set_value(value);
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXParam::SetValueAtTime(const rational &time, va_list args)
+{
+  if (input_ == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  if (QThread::currentThread() != input_->thread()) {
+    return kOfxStatFailed;
+  }
+
+  QVariant value = ReadValue(args);
+
+  if (value.isNull()) {
+    return kOfxStatErrBadHandle;
+  }
+
+  if (input_->keyframing()) {
+    NodeKeyframe key;
+    key.set_time(time);
+    key.set_value(value);
+    input_->insert_keyframe(key);
+  } else {
+    input_->set_value(value);
+  }
+
+  return kOfxStatOK;
+}
+
+OfxParamHandle OFXParam::handle()
+{
+  return reinterpret_cast<OfxParamHandle>(this);
+}
+
+OFXParam *OFXParam::FromHandle(OfxParamHandle handle)
+{
+  return reinterpret_cast<OFXParam*>(handle);
+}
+
+QVariant OFXParam::ReadValue(va_list args)
+{
+  if (data_type() == NodeParam::kString) {
+    return QString::fromUtf8(va_arg(args, const char*));
+  }
+
+  bool is_int = (type_ == kOfxParamTypeInteger
+                 || type_ == kOfxParamTypeChoice
+                 || type_ == kOfxParamTypeBoolean
+                 || type_ == kOfxParamTypeInteger2D
+                 || type_ == kOfxParamTypeInteger3D);
+
+  QVector<double> components(dimension());
+
+  for (int i=0;i<components.size();i++) {
+    components[i] = is_int ? va_arg(args, int) : va_arg(args, double);
+  }
+
+  return ValueFromComponents(components);
+}
+
+QVariant OFXParam::ValueFromComponents(const QVector<double> &components) const
+{
+  // Colors without alpha stay opaque
+  QVector<double> c(4, 1.0);
+
+  for (int i=0;i<components.size() && i<c.size();i++) {
+    c[i] = components.at(i);
+  }
+
+  switch (data_type()) {
+  case NodeParam::kInt:
+    return qRound(c.at(0));
+  case NodeParam::kFloat:
+    return c.at(0);
+  case NodeParam::kBoolean:
+    return (c.at(0) != 0.0);
+  case NodeParam::kColor:
+    return QColor::fromRgbF(c.at(0), c.at(1), c.at(2), c.at(3));
+  case NodeParam::kVec2:
+    return QVector2D(static_cast<float>(c.at(0)), static_cast<float>(c.at(1)));
+  case NodeParam::kVec3:
+    return QVector3D(static_cast<float>(c.at(0)), static_cast<float>(c.at(1)), static_cast<float>(c.at(2)));
+  default:
+    break;
+  }
+
+  return QVariant();
+}
+
+QVector<double> OFXParam::GetComponents(const rational &time)
+{
+  QVector<double> components(dimension(), 0.0);
+
+  if (input_ == nullptr) {
+    QVector<double> defaults = properties_.GetDoubles(kOfxParamPropDefault);
+
+    for (int i=0;i<components.size() && i<defaults.size();i++) {
+      components[i] = defaults.at(i);
+    }
+
+    return components;
+  }
+
+  NodeValue v = input_->get_value(time);
+
+  switch (data_type()) {
+  case NodeParam::kInt:
+    components[0] = v.toInt();
+    break;
+  case NodeParam::kFloat:
+    components[0] = v.toDouble();
+    break;
+  case NodeParam::kBoolean:
+    components[0] = v.toBool() ? 1.0 : 0.0;
+    break;
+  case NodeParam::kColor:
+  {
+    QColor color = v.toColor();
+    double rgba[] = {color.redF(), color.greenF(), color.blueF(), color.alphaF()};
+
+    for (int i=0;i<components.size();i++) {
+      components[i] = rgba[i];
+    }
+    break;
+  }
+  case NodeParam::kVec2:
+  {
+    QVector2D vec = v.toVec2();
+    components[0] = static_cast<double>(vec.x());
+    components[1] = static_cast<double>(vec.y());
+    break;
+  }
+  case NodeParam::kVec3:
+  {
+    QVector3D vec = v.toVec3();
+    components[0] = static_cast<double>(vec.x());
+    components[1] = static_cast<double>(vec.y());
+    components[2] = static_cast<double>(vec.z());
+    break;
+  }
+  default:
+    break;
+  }
+
+  return components;
+}
+
+OFXParamSet::OFXParamSet(OFXEffect *effect) :
+  effect_(effect)
+{
+  properties_.SetString(kOfxPropType, kOfxTypeParameter);
+}
+
+OFXParamSet::~OFXParamSet()
+{
+  qDeleteAll(params_);
+}
+
+OFXParam *OFXParamSet::Define(const QByteArray &name, const QByteArray &type)
+{
+  if (Get(name) != nullptr) {
+    return nullptr;
+  }
+
+  OFXParam* param = new OFXParam(name, type);
+
+  params_.append(param);
+
+  return param;
+}
+
+OFXParam *OFXParamSet::Get(const QByteArray &name) const
+{
+  foreach (OFXParam* param, params_) {
+    if (param->name() == name) {
+      return param;
+    }
+  }
+
+  return nullptr;
+}
+
+const QList<OFXParam *> &OFXParamSet::params() const
+{
+  return params_;
+}
+
+OFXPropertySet *OFXParamSet::properties()
+{
+  return &properties_;
+}
+
+OFXEffect *OFXParamSet::effect() const
+{
+  return effect_;
+}
+
+OfxParamSetHandle OFXParamSet::handle()
+{
+  return reinterpret_cast<OfxParamSetHandle>(this);
+}
+
+OFXParamSet *OFXParamSet::FromHandle(OfxParamSetHandle handle)
+{
+  return reinterpret_cast<OFXParamSet*>(handle);
+}
+
+OFXClip::OFXClip(OFXEffect *effect, const QByteArray &name) :
+  effect_(effect),
+  name_(name),
+  input_(nullptr)
+{
+  properties_.SetString(kOfxPropType, kOfxTypeClip);
+  properties_.SetString(kOfxPropName, name);
+  properties_.SetString(kOfxPropLabel, name);
+  properties_.SetStrings(kOfxImageEffectPropSupportedComponents, {kOfxImageComponentRGBA});
+  properties_.SetInt(kOfxImageEffectPropTemporalClipAccess, 0);
+  properties_.SetInt(kOfxImageClipPropOptional, 0);
+  properties_.SetInt(kOfxImageClipPropIsMask, 0);
+  properties_.SetInt(kOfxImageEffectPropSupportsTiles, 1);
+  properties_.SetString(kOfxImageClipPropFieldExtraction, kOfxImageFieldDoubled);
+}
+
+const QByteArray &OFXClip::name() const
+{
+  return name_;
+}
+
+OFXPropertySet *OFXClip::properties()
+{
+  return &properties_;
+}
+
+OFXEffect *OFXClip::effect() const
+{
+  return effect_;
+}
+
+bool OFXClip::IsOutput() const
+{
+  return name_ == kOfxImageEffectOutputClipName;
+}
+
+NodeInput *OFXClip::input() const
+{
+  return input_;
+}
+
+void OFXClip::set_input(NodeInput *input)
+{
+  input_ = input;
+}
+
+const RenderTexturePtr &OFXClip::texture() const
+{
+  return texture_;
+}
+
+void OFXClip::set_texture(RenderTexturePtr texture)
+{
+  texture_ = texture;
+}
+
+QVector<float> &OFXClip::pixels()
+{
+  return pixels_;
+}
+
+const QRect &OFXClip::bounds() const
+{
+  return bounds_;
+}
+
+void OFXClip::set_bounds(const QRect &bounds)
+{
+  bounds_ = bounds;
+}
+
+OfxImageClipHandle OFXClip::handle()
+{
+  return reinterpret_cast<OfxImageClipHandle>(this);
+}
+
+OFXClip *OFXClip::FromHandle(OfxImageClipHandle handle)
+{
+  return reinterpret_cast<OFXClip*>(handle);
+}
+
+OFXEffect::OFXEffect(OFXPlugin *plugin, OFXEffect *descriptor) :
+  plugin_(plugin),
+  param_set_(this),
+  node_(nullptr)
+{
+  if (descriptor == nullptr) {
+    // Defaults for everything a plugin may leave unset while describing itself
+    properties_.SetString(kOfxPropType, kOfxTypeImageEffect);
+    properties_.SetString(kOfxPropLabel, QByteArray());
+    properties_.SetString(kOfxImageEffectPropGrouping, QByteArray());
+    properties_.SetString(kOfxImageEffectPluginRenderThreadSafety, kOfxImageEffectRenderInstanceSafe);
+    properties_.SetInt(kOfxImageEffectPluginPropSingleInstance, 0);
+    properties_.SetInt(kOfxImageEffectPluginPropHostFrameThreading, 0);
+    properties_.SetInt(kOfxImageEffectPropSupportsMultiResolution, 1);
+    properties_.SetInt(kOfxImageEffectPropSupportsTiles, 1);
+    properties_.SetInt(kOfxImageEffectPropTemporalClipAccess, 0);
+    properties_.SetInt(kOfxImageEffectPropSupportsMultipleClipDepths, 0);
+    properties_.SetInt(kOfxImageEffectPropSupportsMultipleClipPARs, 0);
+    properties_.SetString(kOfxImageEffectPropOpenGLRenderSupported, "false");
+    return;
+  }
+
+  properties_ = descriptor->properties_;
+
+  *param_set_.properties() = *descriptor->param_set_.properties();
+
+  foreach (OFXParam* desc_param, descriptor->param_set_.params()) {
+    OFXParam* param = param_set_.Define(desc_param->name(), desc_param->type());
+
+    *param->properties() = *desc_param->properties();
+  }
+
+  foreach (OFXClip* desc_clip, descriptor->clips_) {
+    OFXClip* clip = DefineClip(desc_clip->name());
+
+    *clip->properties() = *desc_clip->properties();
+  }
+}
+
+OFXEffect::~OFXEffect()
+{
+  qDeleteAll(clips_);
+}
+
+OFXPlugin *OFXEffect::plugin() const
+{
+  return plugin_;
+}
+
+OFXPropertySet *OFXEffect::properties()
+{
+  return &properties_;
+}
+
+OFXParamSet *OFXEffect::param_set()
+{
+  return &param_set_;
+}
+
+OFXClip *OFXEffect::DefineClip(const QByteArray &name)
+{
+  if (GetClip(name) != nullptr) {
+    return nullptr;
+  }
+
+  OFXClip* clip = new OFXClip(this, name);
+
+  clips_.append(clip);
+
+  return clip;
+}
+
+OFXClip *OFXEffect::GetClip(const QByteArray &name) const
+{
+  foreach (OFXClip* clip, clips_) {
+    if (clip->name() == name) {
+      return clip;
+    }
+  }
+
+  return nullptr;
+}
+
+const QList<OFXClip *> &OFXEffect::clips() const
+{
+  return clips_;
+}
+
+OFXNode *OFXEffect::node() const
+{
+  return node_;
+}
+
+void OFXEffect::set_node(OFXNode *node)
+{
+  node_ = node;
+}
+
+OfxImageEffectHandle OFXEffect::handle()
+{
+  return reinterpret_cast<OfxImageEffectHandle>(this);
+}
+
+OFXEffect *OFXEffect::FromHandle(OfxImageEffectHandle handle)
+{
+  return reinterpret_cast<OFXEffect*>(handle);
+}
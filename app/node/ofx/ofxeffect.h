@@ -0,0 +1,285 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OFXEFFECT_H
+#define OFXEFFECT_H
+
+#include <cstdarg>
+#include <ofxImageEffect.h>
+#include <ofxParam.h>
+#include <QList>
+#include <QMutex>
+#include <QRect>
+
+#include "common/rational.h"
+#include "node/input.h"
+#include "node/ofx/ofxpropertyset.h"
+#include "render/rendertexture.h"
+
+class OFXEffect;
+class OFXNode;
+class OFXPlugin;
+
+/**
+ * @brief An OpenFX parameter, backing an OfxParamHandle
+ *
+ * Descriptors only have properties. Instances (see OFXNode) store their value in a NodeInput, so parameters are
+ * keyframed, saved and hashed like any other Node's.
+ */
+class OFXParam
+{
+public:
+  OFXParam(const QByteArray& name, const QByteArray& type);
+
+  const QByteArray& name() const;
+
+  const QByteArray& type() const;
+
+  OFXPropertySet* properties();
+
+  NodeInput* input() const;
+  void set_input(NodeInput* input);
+
+  /**
+   * @brief The type of NodeInput this parameter is stored in, or kNone if it has no value (e.g. groups and pages)
+   */
+  NodeParam::DataType data_type() const;
+
+  /**
+   * @brief The number of values plugins get or set at once (e.g. 3 for RGB)
+   */
+  int dimension() const;
+
+  /**
+   * @brief Write this parameter's value at `time` to the pointers in `args` (see OfxParameterSuiteV1::paramGetValue)
+   *
+   * Descriptors return their default.
+   */
+  OfxStatus GetValue(const rational& time, va_list args);
+
+  /**
+   * @brief Set this parameter's value from the values in `args` (see OfxParameterSuiteV1::paramSetValue)
+   *
+   * Only instances have a value to set, and only from the main thread.
+   */
+  OfxStatus SetValue(va_list args);
+
+  /**
+   * @brief Set a keyframe at `time` from the values in `args`, or the value if the input isn't keyframed
+   */
+  OfxStatus SetValueAtTime(const rational& time, va_list args);
+
+  /**
+   * @brief Get this parameter's numeric value at `time` as doubles, one per dimension()
+   */
+  QVector<double> GetComponents(const rational& time);
+
+  /**
+   * @brief Convert values from GetComponents() to what input() stores for this parameter
+   */
+  QVariant ValueFromComponents(const QVector<double>& components) const;
+
+  OfxParamHandle handle();
+
+  static OFXParam* FromHandle(OfxParamHandle handle);
+
+private:
+  /**
+   * @brief Read a value of this parameter's type from `args`, or a null QVariant if it doesn't have a value
+   */
+  QVariant ReadValue(va_list args);
+
+  QByteArray name_;
+
+  QByteArray type_;
+
+  OFXPropertySet properties_;
+
+  NodeInput* input_;
+
+  /**
+   * @brief String values handed to plugins, which must stay valid after GetValue() returns
+   */
+  QByteArray string_value_;
+
+  QMutex string_lock_;
+
+};
+
+/**
+ * @brief The parameters of an effect, backing an OfxParamSetHandle
+ */
+class OFXParamSet
+{
+public:
+  OFXParamSet(OFXEffect* effect);
+
+  ~OFXParamSet();
+
+  OFXParamSet(const OFXParamSet& other) = delete;
+  OFXParamSet(OFXParamSet&& other) = delete;
+  OFXParamSet& operator=(const OFXParamSet& other) = delete;
+  OFXParamSet& operator=(OFXParamSet&& other) = delete;
+
+  /**
+   * @brief Add a parameter, or return nullptr if one with this name already exists
+   */
+  OFXParam* Define(const QByteArray& name, const QByteArray& type);
+
+  OFXParam* Get(const QByteArray& name) const;
+
+  /**
+   * @brief Parameters in the order they were defined
+   */
+  const QList<OFXParam*>& params() const;
+
+  OFXPropertySet* properties();
+
+  OFXEffect* effect() const;
+
+  OfxParamSetHandle handle();
+
+  static OFXParamSet* FromHandle(OfxParamSetHandle handle);
+
+private:
+  OFXEffect* effect_;
+
+  QList<OFXParam*> params_;
+
+  OFXPropertySet properties_;
+
+};
+
+/**
+ * @brief An OpenFX clip, backing an OfxImageClipHandle
+ *
+ * Instances hold the image being rendered for the duration of a render, set up by OFXNode beforehand.
+ */
+class OFXClip
+{
+public:
+  OFXClip(OFXEffect* effect, const QByteArray& name);
+
+  const QByteArray& name() const;
+
+  OFXPropertySet* properties();
+
+  OFXEffect* effect() const;
+
+  bool IsOutput() const;
+
+  NodeInput* input() const;
+  void set_input(NodeInput* input);
+
+  /**
+   * @brief The texture being rendered from (or into, for the output), nullptr when the clip isn't connected
+   */
+  const RenderTexturePtr& texture() const;
+  void set_texture(RenderTexturePtr texture);
+
+  /**
+   * @brief RGBA float pixels of texture() for plugins rendering on the CPU, the size of bounds()
+   */
+  QVector<float>& pixels();
+
+  /**
+   * @brief The region of the frame (in pixels) texture() covers
+   */
+  const QRect& bounds() const;
+  void set_bounds(const QRect& bounds);
+
+  OfxImageClipHandle handle();
+
+  static OFXClip* FromHandle(OfxImageClipHandle handle);
+
+private:
+  OFXEffect* effect_;
+
+  QByteArray name_;
+
+  OFXPropertySet properties_;
+
+  NodeInput* input_;
+
+  RenderTexturePtr texture_;
+
+  QVector<float> pixels_;
+
+  QRect bounds_;
+
+};
+
+/**
+ * @brief An OpenFX image effect descriptor or instance, backing an OfxImageEffectHandle
+ */
+class OFXEffect
+{
+public:
+  /**
+   * @brief Create an effect, copying the properties, parameters and clips of `descriptor` if it isn't nullptr
+   */
+  OFXEffect(OFXPlugin* plugin, OFXEffect* descriptor = nullptr);
+
+  ~OFXEffect();
+
+  OFXEffect(const OFXEffect& other) = delete;
+  OFXEffect(OFXEffect&& other) = delete;
+  OFXEffect& operator=(const OFXEffect& other) = delete;
+  OFXEffect& operator=(OFXEffect&& other) = delete;
+
+  OFXPlugin* plugin() const;
+
+  OFXPropertySet* properties();
+
+  OFXParamSet* param_set();
+
+  /**
+   * @brief Add a clip, or return nullptr if one with this name already exists
+   */
+  OFXClip* DefineClip(const QByteArray& name);
+
+  OFXClip* GetClip(const QByteArray& name) const;
+
+  const QList<OFXClip*>& clips() const;
+
+  /**
+   * @brief The Node this instance belongs to, nullptr for descriptors
+   */
+  OFXNode* node() const;
+  void set_node(OFXNode* node);
+
+  OfxImageEffectHandle handle();
+
+  static OFXEffect* FromHandle(OfxImageEffectHandle handle);
+
+private:
+  OFXPlugin* plugin_;
+
+  OFXPropertySet properties_;
+
+  OFXParamSet param_set_;
+
+  QList<OFXClip*> clips_;
+
+  OFXNode* node_;
+
+};
+
+#endif // OFXEFFECT_H
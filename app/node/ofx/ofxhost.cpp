@@ -0,0 +1,256 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ofxhost.h"
+
+#include <ofxGPURender.h>
+#include <ofxMemory.h>
+#include <ofxMessage.h>
+#include <ofxMultiThread.h>
+#include <ofxParam.h>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+
+#include "node/ofx/ofxnode.h"
+#include "node/ofx/ofxsuites.h"
+
+OFXHost *OFXHost::Instance()
+{
+  static OFXHost host;
+
+  return &host;
+}
+
+OFXHost::~OFXHost()
+{
+  // Binaries are left loaded, plugins may have registered things (e.g. atexit handlers) that outlive them
+  qDeleteAll(plugins_);
+  qDeleteAll(libraries_);
+}
+
+Node *OFXHost::CreateNode(const QString &id)
+{
+  if (!id.startsWith(OFXNode::IDPrefix())) {
+    return nullptr;
+  }
+
+  OFXPlugin* plugin = GetPlugin(id.mid(OFXNode::IDPrefix().size()));
+
+  if (plugin == nullptr || !plugin->Load()) {
+    return nullptr;
+  }
+
+  OFXNode* node = new OFXNode(plugin);
+
+  if (!node->IsValid()) {
+    delete node;
+    return nullptr;
+  }
+
+  return node;
+}
+
+OFXPlugin *OFXHost::GetPlugin(const QString &identifier) const
+{
+  foreach (OFXPlugin* plugin, plugins_) {
+    if (plugin->identifier() == identifier) {
+      return plugin;
+    }
+  }
+
+  return nullptr;
+}
+
+const QList<OFXPlugin *> &OFXHost::plugins() const
+{
+  return plugins_;
+}
+
+OfxHost *OFXHost::host()
+{
+  return &host_;
+}
+
+QThreadPool *OFXHost::thread_pool()
+{
+  return &thread_pool_;
+}
+
+OFXHost::OFXHost()
+{
+  properties_.SetString(kOfxPropType, kOfxTypeImageEffectHost);
+  properties_.SetString(kOfxPropName, "org.olivevideoeditor.Olive");
+  properties_.SetString(kOfxPropLabel, "Olive");
+  properties_.SetInts(kOfxPropAPIVersion, {1, 4});
+  properties_.SetInts(kOfxPropVersion, {0, 1, 0});
+  properties_.SetString(kOfxPropVersionLabel, "0.1.0");
+  properties_.SetInt(kOfxImageEffectHostPropIsBackground, 0);
+  properties_.SetInt(kOfxImageEffectPropSupportsOverlays, 0);
+  properties_.SetInt(kOfxImageEffectPropSupportsMultiResolution, 1);
+  properties_.SetInt(kOfxImageEffectPropSupportsTiles, 1);
+  properties_.SetInt(kOfxImageEffectPropTemporalClipAccess, 0);
+  properties_.SetStrings(kOfxImageEffectPropSupportedComponents, {kOfxImageComponentRGBA});
+  properties_.SetStrings(kOfxImageEffectPropSupportedPixelDepths, {kOfxBitDepthFloat});
+  properties_.SetStrings(kOfxImageEffectPropSupportedContexts, {kOfxImageEffectContextFilter,
+                                                                kOfxImageEffectContextGeneral,
+                                                                kOfxImageEffectContextGenerator});
+  properties_.SetInt(kOfxImageEffectPropSupportsMultipleClipDepths, 0);
+  properties_.SetInt(kOfxImageEffectPropSupportsMultipleClipPARs, 0);
+  properties_.SetInt(kOfxImageEffectPropSetableFrameRate, 0);
+  properties_.SetInt(kOfxImageEffectPropSetableFielding, 0);
+  properties_.SetInt(kOfxParamHostPropSupportsCustomInteract, 0);
+  properties_.SetInt(kOfxParamHostPropSupportsStringAnimation, 0);
+  properties_.SetInt(kOfxParamHostPropSupportsChoiceAnimation, 0);
+  properties_.SetInt(kOfxParamHostPropSupportsBooleanAnimation, 0);
+  properties_.SetInt(kOfxParamHostPropSupportsCustomAnimation, 0);
+  properties_.SetInt(kOfxParamHostPropMaxParameters, -1);
+  properties_.SetInt(kOfxParamHostPropMaxPages, 0);
+  properties_.SetInts(kOfxParamHostPropPageRowColumnCount, {0, 0});
+  properties_.SetString(kOfxImageEffectPropOpenGLRenderSupported, "true");
+
+  host_.host = properties_.handle();
+  host_.fetchSuite = FetchSuite;
+
+  foreach (const QString& path, GetSearchPaths()) {
+    // Bundles may be grouped into subdirectories
+    QDirIterator it(path, {QStringLiteral("*.ofx.bundle")}, QDir::Dirs, QDirIterator::Subdirectories);
+
+    while (it.hasNext()) {
+      QString bundle = it.next();
+
+      QString binary = QDir(bundle).filePath(QStringLiteral("Contents/%1/%2").arg(GetArchitectureDirectory(),
+                                                                                  it.fileInfo().completeBaseName()));
+
+      if (QFileInfo::exists(binary)) {
+        LoadBinary(binary, bundle);
+      }
+    }
+  }
+}
+
+void OFXHost::LoadBinary(const QString &filename, const QString &bundle)
+{
+  typedef OfxStatus (*SetHostFunction)(const OfxHost*);
+  typedef int (*GetNumberOfPluginsFunction)();
+  typedef OfxPlugin* (*GetPluginFunction)(int);
+
+  QLibrary* library = new QLibrary(filename);
+
+  if (!library->load()) {
+    qWarning() << "Failed to load OpenFX binary" << filename << library->errorString();
+    delete library;
+    return;
+  }
+
+  GetNumberOfPluginsFunction get_count =
+      reinterpret_cast<GetNumberOfPluginsFunction>(library->resolve("OfxGetNumberOfPlugins"));
+  GetPluginFunction get_plugin = reinterpret_cast<GetPluginFunction>(library->resolve("OfxGetPlugin"));
+
+  if (get_count == nullptr || get_plugin == nullptr) {
+    qWarning() << filename << "isn't an OpenFX binary";
+    library->unload();
+    delete library;
+    return;
+  }
+
+  // Binaries from OFX 1.4 on may want the host before they're asked about their plugins
+  SetHostFunction set_host = reinterpret_cast<SetHostFunction>(library->resolve("OfxSetHost"));
+
+  if (set_host != nullptr) {
+    set_host(&host_);
+  }
+
+  int count = get_count();
+
+  for (int i=0;i<count;i++) {
+    OfxPlugin* plugin = get_plugin(i);
+
+    if (OFXPlugin::IsSupported(plugin)
+        && GetPlugin(QString::fromUtf8(plugin->pluginIdentifier)) == nullptr) {
+      plugins_.append(new OFXPlugin(plugin, bundle));
+    }
+  }
+
+  libraries_.append(library);
+}
+
+QStringList OFXHost::GetSearchPaths()
+{
+  QStringList paths = QString::fromLocal8Bit(qgetenv("OFX_PLUGIN_PATH")).split(QDir::listSeparator(),
+                                                                               QString::SkipEmptyParts);
+
+#if defined(Q_OS_WIN)
+  QString common_files = QString::fromLocal8Bit(qgetenv("CommonProgramFiles"));
+
+  if (common_files.isEmpty()) {
+    common_files = QStringLiteral("C:/Program Files/Common Files");
+  }
+
+  paths.append(QDir(common_files).filePath(QStringLiteral("OFX/Plugins")));
+#elif defined(Q_OS_MAC)
+  paths.append(QStringLiteral("/Library/OFX/Plugins"));
+#else
+  paths.append(QStringLiteral("/usr/OFX/Plugins"));
+#endif
+
+  return paths;
+}
+
+QString OFXHost::GetArchitectureDirectory()
+{
+#if defined(Q_OS_WIN)
+  return (QT_POINTER_SIZE == 8) ? QStringLiteral("Win64") : QStringLiteral("Win32");
+#elif defined(Q_OS_MAC)
+  return QStringLiteral("MacOS");
+#elif defined(Q_PROCESSOR_ARM)
+  return (QT_POINTER_SIZE == 8) ? QStringLiteral("Linux-arm64") : QStringLiteral("Linux-arm");
+#else
+  return (QT_POINTER_SIZE == 8) ? QStringLiteral("Linux-x86-64") : QStringLiteral("Linux-x86");
+#endif
+}
+
+const void *OFXHost::FetchSuite(OfxPropertySetHandle host, const char *suite_name, int suite_version)
+{
+  Q_UNUSED(host)
+
+  if (suite_version != 1) {
+    return nullptr;
+  }
+
+  if (qstrcmp(suite_name, kOfxPropertySuite) == 0) {
+    return OFXPropertySet::Suite();
+  } else if (qstrcmp(suite_name, kOfxImageEffectSuite) == 0) {
+    return olive::ofx::ImageEffectSuite();
+  } else if (qstrcmp(suite_name, kOfxParameterSuite) == 0) {
+    return olive::ofx::ParameterSuite();
+  } else if (qstrcmp(suite_name, kOfxMemorySuite) == 0) {
+    return olive::ofx::MemorySuite();
+  } else if (qstrcmp(suite_name, kOfxMultiThreadSuite) == 0) {
+    return olive::ofx::MultiThreadSuite();
+  } else if (qstrcmp(suite_name, kOfxMessageSuite) == 0) {
+    return olive::ofx::MessageSuite();
+  } else if (qstrcmp(suite_name, kOfxOpenGLRenderSuite) == 0) {
+    return olive::ofx::OpenGLRenderSuite();
+  }
+
+  return nullptr;
+}
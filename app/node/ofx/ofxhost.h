@@ -0,0 +1,105 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OFXHOST_H
+#define OFXHOST_H
+
+#include <ofxCore.h>
+#include <QLibrary>
+#include <QList>
+#include <QThreadPool>
+
+#include "node/node.h"
+#include "node/ofx/ofxplugin.h"
+#include "node/ofx/ofxpropertyset.h"
+
+/**
+ * @brief Finds OpenFX plugins and provides the host side of the API to them
+ *
+ * Bundles are searched for in OFX_PLUGIN_PATH and the platform's standard OFX directory when the host is first used,
+ * and their binaries are kept loaded for the rest of the session. Plugins get the property, image effect, parameter,
+ * memory, multi-thread, message and OpenGL render suites.
+ */
+class OFXHost
+{
+public:
+  static OFXHost* Instance();
+
+  ~OFXHost();
+
+  OFXHost(const OFXHost& other) = delete;
+  OFXHost(OFXHost&& other) = delete;
+  OFXHost& operator=(const OFXHost& other) = delete;
+  OFXHost& operator=(OFXHost&& other) = delete;
+
+  /**
+   * @brief Create a Node for the plugin with this Node ID (see OFXNode::id())
+   *
+   * Returns nullptr if `id` isn't an OpenFX Node's or the plugin isn't installed or fails to load. Must be called
+   * from the main thread.
+   */
+  Node* CreateNode(const QString& id);
+
+  OFXPlugin* GetPlugin(const QString& identifier) const;
+
+  const QList<OFXPlugin*>& plugins() const;
+
+  OfxHost* host();
+
+  /**
+   * @brief Threads plugins run their work on through OfxMultiThreadSuiteV1
+   *
+   * Kept apart from QThreadPool::globalInstance() so plugins can't starve tasks and vice versa.
+   */
+  QThreadPool* thread_pool();
+
+private:
+  OFXHost();
+
+  /**
+   * @brief Load a plugin binary and add every image effect plugin in it
+   */
+  void LoadBinary(const QString& filename, const QString& bundle);
+
+  /**
+   * @brief Directories to search for *.ofx.bundle directories in
+   */
+  static QStringList GetSearchPaths();
+
+  /**
+   * @brief The directory within a bundle's Contents that has this platform's binary
+   */
+  static QString GetArchitectureDirectory();
+
+  static const void* FetchSuite(OfxPropertySetHandle host, const char* suite_name, int suite_version);
+
+  OFXPropertySet properties_;
+
+  OfxHost host_;
+
+  QList<QLibrary*> libraries_;
+
+  QList<OFXPlugin*> plugins_;
+
+  QThreadPool thread_pool_;
+
+};
+
+#endif // OFXHOST_H
@@ -0,0 +1,560 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ofxnode.h"
+
+#include <ofxGPURender.h>
+#include <QDebug>
+#include <QOpenGLFunctions>
+
+#include "common/define.h"
+#include "node/processor/renderer/renderer.h"
+#include "render/rendertexture.h"
+
+namespace {
+
+/**
+ * @brief Read a texture's pixels as RGBA floats into `pixels`
+ */
+void DownloadPixels(RenderInstance* renderer, const RenderTexturePtr& texture, QVector<float>* pixels)
+{
+  pixels->resize(texture->width() * texture->height() * kRGBAChannels);
+
+  renderer->buffer()->Attach(texture);
+
+  QOpenGLFunctions* f = renderer->context()->functions();
+
+  f->glBindFramebuffer(GL_READ_FRAMEBUFFER, renderer->buffer()->buffer());
+  f->glReadPixels(0, 0, texture->width(), texture->height(), GL_RGBA, GL_FLOAT, pixels->data());
+  f->glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+  renderer->buffer()->Detach();
+}
+
+/**
+ * @brief Write RGBA float pixels to a texture (of any format) the same size
+ */
+void UploadPixels(RenderInstance* renderer, const RenderTexturePtr& texture, const QVector<float>& pixels)
+{
+  texture->Bind();
+
+  renderer->context()->functions()->glTexSubImage2D(GL_TEXTURE_2D,
+                                                    0,
+                                                    0,
+                                                    0,
+                                                    texture->width(),
+                                                    texture->height(),
+                                                    GL_RGBA,
+                                                    GL_FLOAT,
+                                                    pixels.constData());
+
+  texture->Release();
+}
+
+}
+
+OFXNode::OFXNode(OFXPlugin *plugin) :
+  plugin_(plugin),
+  instance_(nullptr),
+  valid_(false),
+  renderer_(nullptr),
+  frame_varying_(false),
+  attached_context_(nullptr),
+  changing_(false)
+{
+  instance_ = new OFXEffect(plugin, plugin->descriptor());
+  instance_->set_node(this);
+
+  OFXPropertySet* props = instance_->properties();
+  props->SetString(kOfxPropType, kOfxTypeImageEffectInstance);
+  props->SetString(kOfxImageEffectPropContext, plugin->context());
+  props->SetPointer(kOfxPropInstanceData, nullptr);
+  props->SetInt(kOfxPropIsInteractive, 0);
+  props->SetInt(kOfxImageEffectInstancePropSequentialRender, 0);
+  props->SetDouble(kOfxImageEffectPropFrameRate, 1.0);
+  props->SetDouble(kOfxImageEffectInstancePropEffectDuration, RATIONAL_MAX.toDouble());
+  props->SetDouble(kOfxImageEffectPropProjectPixelAspectRatio, 1.0);
+  props->SetDoubles(kOfxImageEffectPropProjectOffset, {0.0, 0.0});
+
+  // Until the first render says otherwise, assume the default sequence size
+  props->SetDoubles(kOfxImageEffectPropProjectSize, {1920.0, 1080.0});
+  props->SetDoubles(kOfxImageEffectPropProjectExtent, {1920.0, 1080.0});
+
+  // Parameters with a value become inputs, starting at their default
+  foreach (OFXParam* param, instance_->param_set()->params()) {
+    NodeParam::DataType data_type = param->data_type();
+
+    if (data_type == NodeParam::kNone) {
+      continue;
+    }
+
+    NodeInput* input = new NodeInput(QString::fromUtf8(param->name()));
+    input->add_data_input(data_type);
+
+    OFXPropertySet* param_props = param->properties();
+
+    if (data_type == NodeParam::kString) {
+      input->set_value(QString::fromUtf8(param_props->GetString(kOfxParamPropDefault)));
+    } else {
+      input->set_value(param->ValueFromComponents(param->GetComponents(0)));
+    }
+
+    if (param->type() == kOfxParamTypeChoice) {
+      input->set_minimum(0);
+      input->set_maximum(qMax(0, param_props->GetStrings(kOfxParamPropChoiceOption).size() - 1));
+    } else if (data_type == NodeParam::kInt || data_type == NodeParam::kFloat) {
+      if (param_props->Has(kOfxParamPropMin)) {
+        input->set_minimum(param_props->GetDouble(kOfxParamPropMin));
+      }
+
+      if (param_props->Has(kOfxParamPropMax)) {
+        input->set_maximum(param_props->GetDouble(kOfxParamPropMax));
+      }
+    }
+
+    QString label = QString::fromUtf8(param_props->GetString(kOfxPropLabel));
+    input->set_name(label.isEmpty() ? input->id() : label);
+
+    param->set_input(input);
+    AddParameter(input);
+
+    connect(input, SIGNAL(ValueChanged(rational, rational)), this, SLOT(ParamValueChanged(rational, rational)));
+  }
+
+  // Input clips become texture inputs
+  foreach (OFXClip* clip, instance_->clips()) {
+    SetClipProperties(clip);
+
+    if (clip->IsOutput()) {
+      continue;
+    }
+
+    // Clips and parameters have separate namespaces in OFX
+    NodeInput* input = new NodeInput(QStringLiteral("clip:%1").arg(QString::fromUtf8(clip->name())));
+    input->add_data_input(NodeParam::kTexture);
+
+    QString label = QString::fromUtf8(clip->properties()->GetString(kOfxPropLabel));
+    input->set_name(label.isEmpty() ? QString::fromUtf8(clip->name()) : label);
+
+    clip->set_input(input);
+    AddParameter(input);
+  }
+
+  texture_output_ = new NodeOutput("tex_out");
+  texture_output_->set_data_type(NodeParam::kTexture);
+  AddParameter(texture_output_);
+
+  // Every context this host uses has an output clip, but a broken plugin may not have defined it
+  if (instance_->GetClip(kOfxImageEffectOutputClipName) == nullptr) {
+    qWarning() << "OpenFX plugin" << plugin_->identifier() << "has no output clip";
+    return;
+  }
+
+  OfxStatus status = Action(kOfxActionCreateInstance, nullptr, nullptr);
+
+  valid_ = (status == kOfxStatOK || status == kOfxStatReplyDefault);
+
+  if (valid_) {
+    UpdateClipPreferences();
+  } else {
+    qWarning() << "OpenFX plugin" << plugin_->identifier() << "failed to create an instance";
+  }
+}
+
+OFXNode::~OFXNode()
+{
+  if (valid_) {
+    // The plugin's GL resources can only be released with the context it made them in
+    if (attached_context_ != nullptr && QOpenGLContext::currentContext() == attached_context_) {
+      Action(kOfxActionOpenGLContextDetached, nullptr, nullptr);
+    }
+
+    Action(kOfxActionDestroyInstance, nullptr, nullptr);
+  }
+
+  delete instance_;
+}
+
+bool OFXNode::IsValid() const
+{
+  return valid_;
+}
+
+QString OFXNode::Name()
+{
+  return plugin_->label();
+}
+
+QString OFXNode::Category()
+{
+  QString grouping = plugin_->grouping();
+
+  return grouping.isEmpty() ? tr("OpenFX") : grouping;
+}
+
+QString OFXNode::Description()
+{
+  return plugin_->description();
+}
+
+QString OFXNode::id()
+{
+  return IDPrefix() + plugin_->identifier();
+}
+
+void OFXNode::Hash(FastHash *hash, NodeOutput *from, const rational &time)
+{
+  Node::Hash(hash, from, time);
+
+  // A new version of the plugin may render differently with the same parameters
+  hash->addData(plugin_->version().toUtf8());
+
+  if (frame_varying_) {
+    hash->addData(NodeParam::ValueToBytes(NodeParam::kRational, time));
+  }
+}
+
+void OFXNode::StaticRange(NodeOutput *output, const rational &time, rational *in, rational *out)
+{
+  if (frame_varying_) {
+    *in = time;
+    *out = time;
+    return;
+  }
+
+  Node::StaticRange(output, time, in, out);
+}
+
+NodeOutput *OFXNode::texture_output()
+{
+  return texture_output_;
+}
+
+QString OFXNode::IDPrefix()
+{
+  return QStringLiteral("ofx:");
+}
+
+RenderInstance *OFXNode::renderer() const
+{
+  return renderer_;
+}
+
+const rational &OFXNode::current_time() const
+{
+  return current_time_;
+}
+
+OfxTime OFXNode::ToOFXTime(const rational &time)
+{
+  return time.toDouble();
+}
+
+rational OFXNode::FromOFXTime(OfxTime time) const
+{
+  // Plugins mostly ask about the time they were given, which converts back exactly
+  if (time == ToOFXTime(current_time_)) {
+    return current_time_;
+  }
+
+  const intType kResolution = 1000000;
+
+  return rational(qRound64(time * kResolution), kResolution);
+}
+
+NodeValue OFXNode::Value(NodeOutput *output, const rational &time)
+{
+  // Find the current Renderer instance
+  RenderInstance* renderer = RendererProcessor::CurrentInstance();
+
+  // If nothing is available, don't return a texture
+  if (renderer == nullptr || output != texture_output_ || !valid_) {
+    return 0;
+  }
+
+  QMutexLocker instance_locker(&instance_lock_);
+
+  // Plugins that aren't thread safe at all only render one frame at a time across every instance
+  QMutexLocker plugin_locker(plugin_->render_lock());
+
+  bool use_gl = plugin_->SupportsOpenGL();
+  const QRect& tile = renderer->tile();
+
+  foreach (OFXClip* clip, instance_->clips()) {
+    if (clip->IsOutput()) {
+      continue;
+    }
+
+    RenderTexturePtr texture = clip->input()->get_value(time).takeTexture();
+
+    if (texture != nullptr) {
+      // Plugins sample the texture's pixels, so anything deferred on it has to be in them
+      texture = renderer->ResolvePendingOps(texture);
+
+      if (!use_gl) {
+        DownloadPixels(renderer, texture, &clip->pixels());
+      }
+    }
+
+    clip->properties()->SetInt(kOfxImageClipPropConnected, texture != nullptr);
+    clip->set_texture(texture);
+    clip->set_bounds(tile);
+  }
+
+  renderer_ = renderer;
+  current_time_ = time;
+
+  SetProjectProperties(renderer);
+
+  RenderTexturePtr result;
+
+  OFXPropertySet identity_args;
+  OFXPropertySet identity_out;
+  SetRenderArguments(&identity_args, renderer, time, use_gl);
+  identity_out.SetString(kOfxPropName, QByteArray());
+  identity_out.SetDouble(kOfxPropTime, ToOFXTime(time));
+
+  if (Action(kOfxImageEffectActionIsIdentity, &identity_args, &identity_out) == kOfxStatOK) {
+    // Pass the clip through rather than rendering a copy of it
+    OFXClip* clip = instance_->GetClip(identity_out.GetString(kOfxPropName));
+
+    if (clip != nullptr && !clip->IsOutput()) {
+      result = clip->texture();
+    }
+  } else {
+    OFXClip* output_clip = instance_->GetClip(kOfxImageEffectOutputClipName);
+
+    RenderTexturePtr output_tex = renderer->texture_pool()->Get(tile.width(),
+                                                                tile.height(),
+                                                                renderer->format(),
+                                                                RenderTexture::kDoubleBuffer);
+
+    output_clip->set_texture(output_tex);
+    output_clip->set_bounds(tile);
+
+    QOpenGLFunctions* f = renderer->context()->functions();
+
+    // Plugins are free to change GL state, so restore what the rest of the renderer expects afterwards
+    GLint viewport[4] = {0, 0, tile.width(), tile.height()};
+    GLint blend_src = GL_ONE;
+    GLint blend_dst = GL_ZERO;
+    GLboolean blend_enabled = GL_FALSE;
+
+    if (use_gl) {
+      AttachContext(renderer->context());
+
+      f->glGetIntegerv(GL_VIEWPORT, viewport);
+      f->glGetIntegerv(GL_BLEND_SRC_RGB, &blend_src);
+      f->glGetIntegerv(GL_BLEND_DST_RGB, &blend_dst);
+      blend_enabled = f->glIsEnabled(GL_BLEND);
+
+      // Plugins render into whatever framebuffer is bound
+      renderer->buffer()->Attach(output_tex);
+      renderer->buffer()->Bind();
+      f->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+      f->glClear(GL_COLOR_BUFFER_BIT);
+    } else {
+      output_clip->pixels().fill(0.0f, tile.width() * tile.height() * kRGBAChannels);
+    }
+
+    OFXPropertySet sequence_args;
+    SetRenderArguments(&sequence_args, renderer, time, use_gl);
+    sequence_args.SetDoubles(kOfxImageEffectPropFrameRange, {ToOFXTime(time), ToOFXTime(time)});
+    sequence_args.SetDouble(kOfxImageEffectPropFrameStep, 1.0);
+    sequence_args.SetInt(kOfxPropIsInteractive, 0);
+
+    OFXPropertySet render_args;
+    SetRenderArguments(&render_args, renderer, time, use_gl);
+
+    OfxStatus status = Action(kOfxImageEffectActionBeginSequenceRender, &sequence_args, nullptr);
+
+    if (status == kOfxStatOK || status == kOfxStatReplyDefault) {
+      status = Action(kOfxImageEffectActionRender, &render_args, nullptr);
+
+      Action(kOfxImageEffectActionEndSequenceRender, &sequence_args, nullptr);
+    }
+
+    if (use_gl) {
+      renderer->buffer()->Release();
+      renderer->buffer()->Detach();
+
+      f->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+      f->glBlendFunc(static_cast<GLenum>(blend_src), static_cast<GLenum>(blend_dst));
+
+      if (blend_enabled) {
+        f->glEnable(GL_BLEND);
+      } else {
+        f->glDisable(GL_BLEND);
+      }
+
+      f->glActiveTexture(GL_TEXTURE0);
+    } else if (status == kOfxStatOK) {
+      UploadPixels(renderer, output_tex, output_clip->pixels());
+    }
+
+    if (status == kOfxStatOK) {
+      result = output_tex;
+    } else if (status != kOfxStatErrAbort) {
+      qWarning() << "OpenFX plugin" << plugin_->identifier() << "failed to render" << status;
+    }
+  }
+
+  // Images only live for the duration of a render, and they can be large
+  foreach (OFXClip* clip, instance_->clips()) {
+    clip->set_texture(nullptr);
+    clip->pixels() = QVector<float>();
+  }
+
+  renderer_ = nullptr;
+
+  if (result == nullptr) {
+    return 0;
+  }
+
+  return NodeValue(std::move(result));
+}
+
+OfxStatus OFXNode::Action(const char *action, OFXPropertySet *in_args, OFXPropertySet *out_args)
+{
+  return plugin_->Action(action, instance_->handle(), in_args, out_args);
+}
+
+void OFXNode::SetClipProperties(OFXClip *clip)
+{
+  OFXPropertySet* props = clip->properties();
+
+  props->SetString(kOfxImageEffectPropPixelDepth, kOfxBitDepthFloat);
+  props->SetString(kOfxImageEffectPropComponents, kOfxImageComponentRGBA);
+  props->SetString(kOfxImageClipPropUnmappedPixelDepth, kOfxBitDepthFloat);
+  props->SetString(kOfxImageClipPropUnmappedComponents, kOfxImageComponentRGBA);
+  props->SetString(kOfxImageEffectPropPreMultiplication, kOfxImagePreMultiplied);
+  props->SetString(kOfxImageClipPropFieldOrder, kOfxImageFieldNone);
+  props->SetDouble(kOfxImagePropPixelAspectRatio, 1.0);
+  props->SetDouble(kOfxImageEffectPropFrameRate, 1.0);
+  props->SetDouble(kOfxImageEffectPropUnmappedFrameRate, 1.0);
+  props->SetDoubles(kOfxImageEffectPropFrameRange, {0.0, RATIONAL_MAX.toDouble()});
+  props->SetDoubles(kOfxImageEffectPropUnmappedFrameRange, {0.0, RATIONAL_MAX.toDouble()});
+  props->SetInt(kOfxImageClipPropContinuousSamples, 0);
+  props->SetInt(kOfxImageClipPropConnected, 0);
+}
+
+void OFXNode::SetProjectProperties(RenderInstance *renderer)
+{
+  // Project properties are in canonical coordinates, which are pixels at full resolution
+  QVector<double> size = {static_cast<double>(renderer->frame_width() * renderer->divider()),
+                          static_cast<double>(renderer->frame_height() * renderer->divider())};
+
+  instance_->properties()->SetDoubles(kOfxImageEffectPropProjectSize, size);
+  instance_->properties()->SetDoubles(kOfxImageEffectPropProjectExtent, size);
+}
+
+void OFXNode::SetRenderArguments(OFXPropertySet *args, RenderInstance *renderer, const rational &time, bool use_gl)
+{
+  const QRect& tile = renderer->tile();
+  double scale = 1.0 / renderer->divider();
+
+  args->SetDouble(kOfxPropTime, ToOFXTime(time));
+  args->SetString(kOfxImageEffectPropFieldToRender, kOfxImageFieldNone);
+  args->SetInts(kOfxImageEffectPropRenderWindow, {tile.x(),
+                                                  tile.y(),
+                                                  tile.x() + tile.width(),
+                                                  tile.y() + tile.height()});
+  args->SetDoubles(kOfxImageEffectPropRenderScale, {scale, scale});
+  args->SetInt(kOfxImageEffectPropSequentialRenderStatus, 0);
+  args->SetInt(kOfxImageEffectPropInteractiveRenderStatus, 0);
+  args->SetInt(kOfxImageEffectPropRenderQualityDraft, 0);
+  args->SetInt(kOfxImageEffectPropOpenGLEnabled, use_gl);
+}
+
+void OFXNode::UpdateClipPreferences()
+{
+  OFXPropertySet out_args;
+
+  out_args.SetInt(kOfxImageEffectFrameVarying, 0);
+  out_args.SetDouble(kOfxImageEffectPropFrameRate, 1.0);
+  out_args.SetString(kOfxImageEffectPropPreMultiplication, kOfxImagePreMultiplied);
+  out_args.SetInt(kOfxImageClipPropContinuousSamples, 0);
+
+  Action(kOfxImageEffectActionGetClipPreferences, nullptr, &out_args);
+
+  frame_varying_ = out_args.GetInt(kOfxImageEffectFrameVarying);
+}
+
+void OFXNode::AttachContext(QOpenGLContext *context)
+{
+  if (attached_context_ == context) {
+    return;
+  }
+
+  // Render threads share resources with each other, so only per-context state (e.g. VAOs) is lost in the switch
+  if (attached_context_ != nullptr) {
+    Action(kOfxActionOpenGLContextDetached, nullptr, nullptr);
+  }
+
+  Action(kOfxActionOpenGLContextAttached, nullptr, nullptr);
+
+  attached_context_ = context;
+}
+
+void OFXNode::ParamValueChanged(const rational &start, const rational &end)
+{
+  Q_UNUSED(end)
+
+  if (changing_ || !valid_) {
+    return;
+  }
+
+  NodeInput* input = static_cast<NodeInput*>(sender());
+  OFXParam* param = nullptr;
+
+  foreach (OFXParam* p, instance_->param_set()->params()) {
+    if (p->input() == input) {
+      param = p;
+      break;
+    }
+  }
+
+  if (param == nullptr) {
+    return;
+  }
+
+  QMutexLocker locker(&instance_lock_);
+
+  changing_ = true;
+  current_time_ = (start == RATIONAL_MIN) ? rational() : start;
+
+  OFXPropertySet reason_args;
+  reason_args.SetString(kOfxPropChangeReason, kOfxChangeUserEdited);
+
+  OFXPropertySet changed_args;
+  changed_args.SetString(kOfxPropType, kOfxTypeParameter);
+  changed_args.SetString(kOfxPropName, param->name());
+  changed_args.SetString(kOfxPropChangeReason, kOfxChangeUserEdited);
+  changed_args.SetDouble(kOfxPropTime, ToOFXTime(current_time_));
+  changed_args.SetDoubles(kOfxImageEffectPropRenderScale, {1.0, 1.0});
+
+  Action(kOfxActionBeginInstanceChanged, &reason_args, nullptr);
+  Action(kOfxActionInstanceChanged, &changed_args, nullptr);
+  Action(kOfxActionEndInstanceChanged, &reason_args, nullptr);
+
+  UpdateClipPreferences();
+
+  changing_ = false;
+}
@@ -0,0 +1,150 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OFXNODE_H
+#define OFXNODE_H
+
+#include <ofxCore.h>
+#include <QMutex>
+#include <QOpenGLContext>
+
+#include "node/node.h"
+#include "node/ofx/ofxeffect.h"
+#include "node/ofx/ofxplugin.h"
+#include "render/renderinstance.h"
+
+/**
+ * @brief A Node running an instance of an OpenFX image effect plugin
+ *
+ * Each of the plugin's parameters is a NodeInput of the nearest type (choices are ints) and each of its input clips
+ * is a texture input, so the default Hash() covers the plugin's parameters and whatever feeds it, and its output is
+ * cached like any other Node's.
+ *
+ * Plugins render the RenderInstance's current tile, at the instance's divider as their render scale. Plugins that
+ * support OpenGL render straight into the output texture from the input textures, others are given images downloaded
+ * from them. OFX time is in seconds, since Nodes don't know the timebase of what they're rendered for.
+ */
+class OFXNode : public Node
+{
+  Q_OBJECT
+public:
+  OFXNode(OFXPlugin* plugin);
+
+  virtual ~OFXNode() override;
+
+  /**
+   * @brief Returns FALSE if the plugin failed to create its instance, in which case this Node is unusable
+   */
+  bool IsValid() const;
+
+  virtual QString Name() override;
+  virtual QString Category() override;
+  virtual QString Description() override;
+
+  virtual QString id() override;
+
+  virtual void Hash(FastHash* hash, NodeOutput* from, const rational& time) override;
+
+  virtual void StaticRange(NodeOutput* output, const rational& time, rational* in, rational* out) override;
+
+  NodeOutput* texture_output();
+
+  /**
+   * @brief What OFXNode IDs start with, the rest is the plugin's identifier
+   */
+  static QString IDPrefix();
+
+  /**
+   * @brief The RenderInstance of the render in progress, nullptr outside of one
+   */
+  RenderInstance* renderer() const;
+
+  /**
+   * @brief The time of the render or instance change in progress, for parameters read without a time
+   */
+  const rational& current_time() const;
+
+  static OfxTime ToOFXTime(const rational& time);
+
+  rational FromOFXTime(OfxTime time) const;
+
+protected:
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
+
+private:
+  OfxStatus Action(const char* action, OFXPropertySet* in_args, OFXPropertySet* out_args);
+
+  /**
+   * @brief Set the properties instances of clips have on top of their descriptor's
+   */
+  void SetClipProperties(OFXClip* clip);
+
+  /**
+   * @brief Update the instance's project properties for the frame `renderer` is rendering
+   */
+  void SetProjectProperties(RenderInstance* renderer);
+
+  /**
+   * @brief Fill in the arguments render actions share (see kOfxImageEffectActionRender)
+   */
+  void SetRenderArguments(OFXPropertySet* args, RenderInstance* renderer, const rational& time, bool use_gl);
+
+  /**
+   * @brief Ask the plugin whether its output varies over time when its inputs don't
+   */
+  void UpdateClipPreferences();
+
+  /**
+   * @brief Tell the plugin the OpenGL context it'll render with if it isn't the one it was last told about
+   */
+  void AttachContext(QOpenGLContext* context);
+
+  OFXPlugin* plugin_;
+
+  OFXEffect* instance_;
+
+  bool valid_;
+
+  NodeOutput* texture_output_;
+
+  RenderInstance* renderer_;
+
+  rational current_time_;
+
+  bool frame_varying_;
+
+  QOpenGLContext* attached_context_;
+
+  /**
+   * @brief Set while the plugin is handling an instance change, so values it sets don't send another
+   */
+  bool changing_;
+
+  /**
+   * @brief Keeps instance changes (on the main thread) from running while a frame renders
+   */
+  QMutex instance_lock_;
+
+private slots:
+  void ParamValueChanged(const rational& start, const rational& end);
+
+};
+
+#endif // OFXNODE_H
@@ -0,0 +1,205 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ofxplugin.h"
+
+#include <QDebug>
+
+#include "node/ofx/ofxhost.h"
+
+OFXPlugin::OFXPlugin(OfxPlugin *plugin, const QString &bundle) :
+  plugin_(plugin),
+  bundle_(bundle),
+  loaded_(false),
+  load_failed_(false),
+  describe_descriptor_(nullptr),
+  context_descriptor_(nullptr)
+{
+}
+
+OFXPlugin::~OFXPlugin()
+{
+  if (loaded_) {
+    Action(kOfxActionUnload, nullptr, nullptr, nullptr);
+  }
+
+  delete context_descriptor_;
+  delete describe_descriptor_;
+}
+
+QString OFXPlugin::identifier() const
+{
+  return QString::fromUtf8(plugin_->pluginIdentifier);
+}
+
+QString OFXPlugin::version() const
+{
+  return QStringLiteral("%1.%2").arg(QString::number(plugin_->pluginVersionMajor),
+                                     QString::number(plugin_->pluginVersionMinor));
+}
+
+bool OFXPlugin::Load()
+{
+  if (loaded_ || load_failed_) {
+    return loaded_;
+  }
+
+  // Assume failure until every step has succeeded
+  load_failed_ = true;
+
+  plugin_->setHost(OFXHost::Instance()->host());
+
+  OfxStatus status = Action(kOfxActionLoad, nullptr, nullptr, nullptr);
+
+  if (status != kOfxStatOK && status != kOfxStatReplyDefault) {
+    qWarning() << "Failed to load OpenFX plugin" << identifier() << "from" << bundle_;
+    return false;
+  }
+
+  describe_descriptor_ = new OFXEffect(this);
+
+  status = Action(kOfxActionDescribe, describe_descriptor_->handle(), nullptr, nullptr);
+
+  if (status != kOfxStatOK && status != kOfxStatReplyDefault) {
+    qWarning() << "OpenFX plugin" << identifier() << "failed to describe itself";
+    Action(kOfxActionUnload, nullptr, nullptr, nullptr);
+    return false;
+  }
+
+  // Every image this host hands out is RGBA float
+  QVector<QByteArray> depths = describe_descriptor_->properties()->GetStrings(kOfxImageEffectPropSupportedPixelDepths);
+
+  if (!depths.isEmpty() && !depths.contains(kOfxBitDepthFloat)) {
+    qWarning() << "OpenFX plugin" << identifier() << "doesn't support float images";
+    Action(kOfxActionUnload, nullptr, nullptr, nullptr);
+    return false;
+  }
+
+  QVector<QByteArray> contexts = describe_descriptor_->properties()->GetStrings(kOfxImageEffectPropSupportedContexts);
+
+  if (contexts.contains(kOfxImageEffectContextFilter)) {
+    context_ = kOfxImageEffectContextFilter;
+  } else if (contexts.contains(kOfxImageEffectContextGeneral)) {
+    context_ = kOfxImageEffectContextGeneral;
+  } else if (contexts.contains(kOfxImageEffectContextGenerator)) {
+    context_ = kOfxImageEffectContextGenerator;
+  } else {
+    qWarning() << "OpenFX plugin" << identifier() << "doesn't support any context this host does";
+    Action(kOfxActionUnload, nullptr, nullptr, nullptr);
+    return false;
+  }
+
+  // The in-context description builds on what was described outside of any context
+  context_descriptor_ = new OFXEffect(this, describe_descriptor_);
+  context_descriptor_->properties()->SetString(kOfxImageEffectPropContext, context_);
+
+  OFXPropertySet in_args;
+  in_args.SetString(kOfxImageEffectPropContext, context_);
+
+  status = Action(kOfxImageEffectActionDescribeInContext, context_descriptor_->handle(), &in_args, nullptr);
+
+  if (status != kOfxStatOK && status != kOfxStatReplyDefault) {
+    qWarning() << "OpenFX plugin" << identifier() << "failed to describe itself in" << context_;
+    Action(kOfxActionUnload, nullptr, nullptr, nullptr);
+    return false;
+  }
+
+  loaded_ = true;
+  load_failed_ = false;
+
+  return true;
+}
+
+OFXEffect *OFXPlugin::descriptor() const
+{
+  return context_descriptor_;
+}
+
+const QByteArray &OFXPlugin::context() const
+{
+  return context_;
+}
+
+QString OFXPlugin::label() const
+{
+  QString label;
+
+  if (describe_descriptor_ != nullptr) {
+    label = QString::fromUtf8(describe_descriptor_->properties()->GetString(kOfxPropLabel));
+  }
+
+  return label.isEmpty() ? identifier() : label;
+}
+
+QString OFXPlugin::grouping() const
+{
+  if (describe_descriptor_ == nullptr) {
+    return QString();
+  }
+
+  return QString::fromUtf8(describe_descriptor_->properties()->GetString(kOfxImageEffectPropGrouping));
+}
+
+QString OFXPlugin::description() const
+{
+  if (describe_descriptor_ == nullptr) {
+    return QString();
+  }
+
+  return QString::fromUtf8(describe_descriptor_->properties()->GetString(kOfxPropPluginDescription));
+}
+
+bool OFXPlugin::SupportsOpenGL() const
+{
+  if (context_descriptor_ == nullptr) {
+    return false;
+  }
+
+  QByteArray supported = context_descriptor_->properties()->GetString(kOfxImageEffectPropOpenGLRenderSupported);
+
+  return supported == "true" || supported == "needed";
+}
+
+QMutex *OFXPlugin::render_lock()
+{
+  if (context_descriptor_ != nullptr
+      && context_descriptor_->properties()->GetString(kOfxImageEffectPluginRenderThreadSafety)
+      == kOfxImageEffectRenderUnsafe) {
+    return &render_lock_;
+  }
+
+  // Instance safe plugins are already serialized by their Node (see Node::Run()), fully safe ones need nothing
+  return nullptr;
+}
+
+OfxStatus OFXPlugin::Action(const char *action, void *handle, OFXPropertySet *in_args, OFXPropertySet *out_args)
+{
+  return plugin_->mainEntry(action,
+                            handle,
+                            in_args ? in_args->handle() : nullptr,
+                            out_args ? out_args->handle() : nullptr);
+}
+
+bool OFXPlugin::IsSupported(OfxPlugin *plugin)
+{
+  return plugin != nullptr
+      && qstrcmp(plugin->pluginApi, kOfxImageEffectPluginApi) == 0
+      && plugin->apiVersion == kOfxImageEffectPluginApiVersion;
+}
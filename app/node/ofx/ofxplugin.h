@@ -0,0 +1,122 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OFXPLUGIN_H
+#define OFXPLUGIN_H
+
+#include <ofxImageEffect.h>
+#include <QMutex>
+#include <QString>
+
+#include "node/ofx/ofxeffect.h"
+
+/**
+ * @brief One OpenFX image effect plugin from a bundle found by OFXHost
+ *
+ * Plugins are only loaded (kOfxActionLoad) and described when the first Node using them is created, so installing
+ * lots of plugins doesn't slow startup down. Each plugin is used in one context, the first of Filter, General and
+ * Generator that it supports.
+ */
+class OFXPlugin
+{
+public:
+  OFXPlugin(OfxPlugin* plugin, const QString& bundle);
+
+  ~OFXPlugin();
+
+  OFXPlugin(const OFXPlugin& other) = delete;
+  OFXPlugin(OFXPlugin&& other) = delete;
+  OFXPlugin& operator=(const OFXPlugin& other) = delete;
+  OFXPlugin& operator=(OFXPlugin&& other) = delete;
+
+  QString identifier() const;
+
+  /**
+   * @brief The plugin's version, nodes hash it so upgrading a plugin invalidates what it cached
+   */
+  QString version() const;
+
+  /**
+   * @brief Load and describe this plugin if it hasn't been already
+   *
+   * Must be called from the main thread. Returns FALSE if the plugin failed to load or can't be used by this host, in
+   * which case it's never tried again.
+   */
+  bool Load();
+
+  /**
+   * @brief The plugin's description in context(), which instances copy their parameters and clips from
+   */
+  OFXEffect* descriptor() const;
+
+  const QByteArray& context() const;
+
+  QString label() const;
+
+  QString grouping() const;
+
+  QString description() const;
+
+  /**
+   * @brief Returns TRUE if this plugin can render with OpenGL textures rather than images in memory
+   */
+  bool SupportsOpenGL() const;
+
+  /**
+   * @brief Lock for plugins that can't render more than one frame at once across all instances, or nullptr
+   */
+  QMutex* render_lock();
+
+  /**
+   * @brief Call the plugin's main entry point
+   */
+  OfxStatus Action(const char* action, void* handle, OFXPropertySet* in_args, OFXPropertySet* out_args);
+
+  /**
+   * @brief Returns TRUE if this plugin uses an API this host implements
+   */
+  static bool IsSupported(OfxPlugin* plugin);
+
+private:
+  OfxPlugin* plugin_;
+
+  QString bundle_;
+
+  bool loaded_;
+
+  bool load_failed_;
+
+  /**
+   * @brief The plugin's description of itself from kOfxActionDescribe
+   */
+  OFXEffect* describe_descriptor_;
+
+  /**
+   * @brief The plugin's description in context_ from kOfxImageEffectActionDescribeInContext
+   */
+  OFXEffect* context_descriptor_;
+
+  QByteArray context_;
+
+  QMutex render_lock_;
+
+};
+
+#endif // OFXPLUGIN_H
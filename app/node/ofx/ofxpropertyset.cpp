@@ -0,0 +1,582 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ofxpropertyset.h"
+
+#include <QMutexLocker>
+
+OFXPropertySet::OFXPropertySet(const OFXPropertySet &other)
+{
+  QMutexLocker locker(&other.lock_);
+
+  properties_ = other.properties_;
+}
+
+OFXPropertySet &OFXPropertySet::operator=(const OFXPropertySet &other)
+{
+  if (this != &other) {
+    QMutexLocker other_locker(&other.lock_);
+    QMutexLocker locker(&lock_);
+
+    properties_ = other.properties_;
+  }
+
+  return *this;
+}
+
+void OFXPropertySet::SetPointer(const char *name, void *value, int index)
+{
+  QMutexLocker locker(&lock_);
+
+  Prepare(name, kPointer, index)->pointers[index] = value;
+}
+
+void OFXPropertySet::SetString(const char *name, const QByteArray &value, int index)
+{
+  QMutexLocker locker(&lock_);
+
+  Prepare(name, kString, index)->strings[index] = value;
+}
+
+void OFXPropertySet::SetDouble(const char *name, double value, int index)
+{
+  QMutexLocker locker(&lock_);
+
+  Prepare(name, kDouble, index)->doubles[index] = value;
+}
+
+void OFXPropertySet::SetInt(const char *name, int value, int index)
+{
+  QMutexLocker locker(&lock_);
+
+  Prepare(name, kInt, index)->ints[index] = value;
+}
+
+void OFXPropertySet::SetStrings(const char *name, const QVector<QByteArray> &values)
+{
+  QMutexLocker locker(&lock_);
+
+  Property& p = properties_[name];
+  p = Property();
+  p.type = kString;
+  p.strings = values;
+}
+
+void OFXPropertySet::SetDoubles(const char *name, const QVector<double> &values)
+{
+  QMutexLocker locker(&lock_);
+
+  Property& p = properties_[name];
+  p = Property();
+  p.type = kDouble;
+  p.doubles = values;
+}
+
+void OFXPropertySet::SetInts(const char *name, const QVector<int> &values)
+{
+  QMutexLocker locker(&lock_);
+
+  Property& p = properties_[name];
+  p = Property();
+  p.type = kInt;
+  p.ints = values;
+}
+
+void *OFXPropertySet::GetPointer(const char *name, int index, void *default_value) const
+{
+  QMutexLocker locker(&lock_);
+
+  auto it = properties_.constFind(name);
+
+  if (it == properties_.constEnd() || it->type != kPointer || index >= it->pointers.size()) {
+    return default_value;
+  }
+
+  return it->pointers.at(index);
+}
+
+QByteArray OFXPropertySet::GetString(const char *name, int index, const QByteArray &default_value) const
+{
+  QMutexLocker locker(&lock_);
+
+  auto it = properties_.constFind(name);
+
+  if (it == properties_.constEnd() || it->type != kString || index >= it->strings.size()) {
+    return default_value;
+  }
+
+  return it->strings.at(index);
+}
+
+double OFXPropertySet::GetDouble(const char *name, int index, double default_value) const
+{
+  QMutexLocker locker(&lock_);
+
+  auto it = properties_.constFind(name);
+
+  if (it == properties_.constEnd()) {
+    return default_value;
+  }
+
+  if (it->type == kDouble && index < it->doubles.size()) {
+    return it->doubles.at(index);
+  } else if (it->type == kInt && index < it->ints.size()) {
+    return it->ints.at(index);
+  }
+
+  return default_value;
+}
+
+int OFXPropertySet::GetInt(const char *name, int index, int default_value) const
+{
+  QMutexLocker locker(&lock_);
+
+  auto it = properties_.constFind(name);
+
+  if (it == properties_.constEnd()) {
+    return default_value;
+  }
+
+  if (it->type == kInt && index < it->ints.size()) {
+    return it->ints.at(index);
+  } else if (it->type == kDouble && index < it->doubles.size()) {
+    return qRound(it->doubles.at(index));
+  }
+
+  return default_value;
+}
+
+QVector<QByteArray> OFXPropertySet::GetStrings(const char *name) const
+{
+  QMutexLocker locker(&lock_);
+
+  auto it = properties_.constFind(name);
+
+  if (it == properties_.constEnd() || it->type != kString) {
+    return QVector<QByteArray>();
+  }
+
+  return it->strings;
+}
+
+QVector<double> OFXPropertySet::GetDoubles(const char *name) const
+{
+  QMutexLocker locker(&lock_);
+
+  auto it = properties_.constFind(name);
+
+  if (it == properties_.constEnd()) {
+    return QVector<double>();
+  }
+
+  if (it->type == kInt) {
+    QVector<double> doubles(it->ints.size());
+
+    for (int i=0;i<it->ints.size();i++) {
+      doubles[i] = it->ints.at(i);
+    }
+
+    return doubles;
+  } else if (it->type == kDouble) {
+    return it->doubles;
+  }
+
+  return QVector<double>();
+}
+
+bool OFXPropertySet::Has(const char *name) const
+{
+  QMutexLocker locker(&lock_);
+
+  return properties_.contains(name);
+}
+
+OfxPropertySetHandle OFXPropertySet::handle()
+{
+  return reinterpret_cast<OfxPropertySetHandle>(this);
+}
+
+OFXPropertySet *OFXPropertySet::FromHandle(OfxPropertySetHandle handle)
+{
+  return reinterpret_cast<OFXPropertySet*>(handle);
+}
+
+const OfxPropertySuiteV1 *OFXPropertySet::Suite()
+{
+  static const OfxPropertySuiteV1 suite = {
+    SetPointerSuite,
+    SetStringSuite,
+    SetDoubleSuite,
+    SetIntSuite,
+    SetPointerNSuite,
+    SetStringNSuite,
+    SetDoubleNSuite,
+    SetIntNSuite,
+    GetPointerSuite,
+    GetStringSuite,
+    GetDoubleSuite,
+    GetIntSuite,
+    GetPointerNSuite,
+    GetStringNSuite,
+    GetDoubleNSuite,
+    GetIntNSuite,
+    ResetSuite,
+    GetDimensionSuite
+  };
+
+  return &suite;
+}
+
+int OFXPropertySet::Property::dimension() const
+{
+  switch (type) {
+  case kPointer:
+    return pointers.size();
+  case kString:
+    return strings.size();
+  case kDouble:
+    return doubles.size();
+  case kInt:
+    return ints.size();
+  }
+
+  return 0;
+}
+
+OFXPropertySet::Property *OFXPropertySet::Prepare(const char *name, OFXPropertySet::Type type, int index)
+{
+  Property& p = properties_[name];
+
+  // Setting a property as another type replaces it, plugins are the only ones who know what their own properties are
+  if (p.type != type) {
+    p = Property();
+    p.type = type;
+  }
+
+  if (index >= p.dimension()) {
+    switch (type) {
+    case kPointer:
+      p.pointers.resize(index + 1);
+      break;
+    case kString:
+      p.strings.resize(index + 1);
+      break;
+    case kDouble:
+      p.doubles.resize(index + 1);
+      break;
+    case kInt:
+      p.ints.resize(index + 1);
+      break;
+    }
+  }
+
+  return &p;
+}
+
+OfxStatus OFXPropertySet::SetPointerSuite(OfxPropertySetHandle handle, const char *name, int index, void *value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  } else if (index < 0) {
+    return kOfxStatErrBadIndex;
+  }
+
+  FromHandle(handle)->SetPointer(name, value, index);
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::SetStringSuite(OfxPropertySetHandle handle, const char *name, int index, const char *value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  } else if (index < 0) {
+    return kOfxStatErrBadIndex;
+  }
+
+  FromHandle(handle)->SetString(name, value, index);
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::SetDoubleSuite(OfxPropertySetHandle handle, const char *name, int index, double value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  } else if (index < 0) {
+    return kOfxStatErrBadIndex;
+  }
+
+  FromHandle(handle)->SetDouble(name, value, index);
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::SetIntSuite(OfxPropertySetHandle handle, const char *name, int index, int value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  } else if (index < 0) {
+    return kOfxStatErrBadIndex;
+  }
+
+  FromHandle(handle)->SetInt(name, value, index);
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::SetPointerNSuite(OfxPropertySetHandle handle,
+                                           const char *name,
+                                           int count,
+                                           void * const *value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = SetPointerSuite(handle, name, i, value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::SetStringNSuite(OfxPropertySetHandle handle,
+                                          const char *name,
+                                          int count,
+                                          const char * const *value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = SetStringSuite(handle, name, i, value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::SetDoubleNSuite(OfxPropertySetHandle handle, const char *name, int count, const double *value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = SetDoubleSuite(handle, name, i, value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::SetIntNSuite(OfxPropertySetHandle handle, const char *name, int count, const int *value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = SetIntSuite(handle, name, i, value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::GetPointerSuite(OfxPropertySetHandle handle, const char *name, int index, void **value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  return FromHandle(handle)->Get(name, index, kPointer, value);
+}
+
+OfxStatus OFXPropertySet::GetStringSuite(OfxPropertySetHandle handle, const char *name, int index, char **value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  return FromHandle(handle)->Get(name, index, kString, value);
+}
+
+OfxStatus OFXPropertySet::GetDoubleSuite(OfxPropertySetHandle handle, const char *name, int index, double *value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  return FromHandle(handle)->Get(name, index, kDouble, value);
+}
+
+OfxStatus OFXPropertySet::GetIntSuite(OfxPropertySetHandle handle, const char *name, int index, int *value)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  return FromHandle(handle)->Get(name, index, kInt, value);
+}
+
+OfxStatus OFXPropertySet::GetPointerNSuite(OfxPropertySetHandle handle, const char *name, int count, void **value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = GetPointerSuite(handle, name, i, &value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::GetStringNSuite(OfxPropertySetHandle handle, const char *name, int count, char **value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = GetStringSuite(handle, name, i, &value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::GetDoubleNSuite(OfxPropertySetHandle handle, const char *name, int count, double *value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = GetDoubleSuite(handle, name, i, &value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::GetIntNSuite(OfxPropertySetHandle handle, const char *name, int count, int *value)
+{
+  for (int i=0;i<count;i++) {
+    OfxStatus status = GetIntSuite(handle, name, i, &value[i]);
+
+    if (status != kOfxStatOK) {
+      return status;
+    }
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::ResetSuite(OfxPropertySetHandle handle, const char *name)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXPropertySet* set = FromHandle(handle);
+
+  QMutexLocker locker(&set->lock_);
+
+  auto it = set->properties_.find(name);
+
+  if (it == set->properties_.end()) {
+    return kOfxStatErrUnknown;
+  }
+
+  // There's no record of defaults, so resetting clears the values while keeping the dimension
+  Property& p = *it;
+
+  p.pointers.fill(nullptr);
+  p.strings.fill(QByteArray());
+  p.doubles.fill(0.0);
+  p.ints.fill(0);
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::GetDimensionSuite(OfxPropertySetHandle handle, const char *name, int *count)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXPropertySet* set = FromHandle(handle);
+
+  QMutexLocker locker(&set->lock_);
+
+  auto it = set->properties_.constFind(name);
+
+  if (it == set->properties_.constEnd()) {
+    return kOfxStatErrUnknown;
+  }
+
+  *count = it->dimension();
+
+  return kOfxStatOK;
+}
+
+OfxStatus OFXPropertySet::Get(const char *name, int index, OFXPropertySet::Type type, void *value)
+{
+  QMutexLocker locker(&lock_);
+
+  auto it = properties_.find(name);
+
+  if (it == properties_.end()) {
+    return kOfxStatErrUnknown;
+  }
+
+  Property& p = *it;
+
+  if (index < 0 || index >= p.dimension()) {
+    return kOfxStatErrBadIndex;
+  }
+
+  if (type == kDouble && p.type == kInt) {
+    *static_cast<double*>(value) = p.ints.at(index);
+    return kOfxStatOK;
+  } else if (type == kInt && p.type == kDouble) {
+    *static_cast<int*>(value) = qRound(p.doubles.at(index));
+    return kOfxStatOK;
+  } else if (type != p.type) {
+    return kOfxStatErrValue;
+  }
+
+  switch (type) {
+  case kPointer:
+    *static_cast<void**>(value) = p.pointers.at(index);
+    break;
+  case kString:
+    // Detaches from any copy of this set so the pointer belongs to this one
+    *static_cast<char**>(value) = p.strings[index].data();
+    break;
+  case kDouble:
+    *static_cast<double*>(value) = p.doubles.at(index);
+    break;
+  case kInt:
+    *static_cast<int*>(value) = p.ints.at(index);
+    break;
+  }
+
+  return kOfxStatOK;
+}
@@ -0,0 +1,139 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OFXPROPERTYSET_H
+#define OFXPROPERTYSET_H
+
+#include <ofxProperty.h>
+#include <QByteArray>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+/**
+ * @brief Storage behind an OpenFX property set handle (see OfxPropertySuiteV1)
+ *
+ * Every OFX object (the host, effects, clips, parameters, images, action arguments) describes itself with one of
+ * these. Properties are created by whichever side sets them first, plugins are free to add their own, and reading a
+ * property that was never set fails with kOfxStatErrUnknown.
+ *
+ * Strings are handed to plugins as pointers into the set, so they stay valid until the property is set again.
+ */
+class OFXPropertySet
+{
+public:
+  OFXPropertySet() = default;
+
+  OFXPropertySet(const OFXPropertySet& other);
+  OFXPropertySet& operator=(const OFXPropertySet& other);
+
+  virtual ~OFXPropertySet() = default;
+
+  void SetPointer(const char* name, void* value, int index = 0);
+  void SetString(const char* name, const QByteArray& value, int index = 0);
+  void SetDouble(const char* name, double value, int index = 0);
+  void SetInt(const char* name, int value, int index = 0);
+
+  void SetStrings(const char* name, const QVector<QByteArray>& values);
+  void SetDoubles(const char* name, const QVector<double>& values);
+  void SetInts(const char* name, const QVector<int>& values);
+
+  /**
+   * @brief Getters for the host's side, returning `default_value` if the property isn't set
+   */
+  void* GetPointer(const char* name, int index = 0, void* default_value = nullptr) const;
+  QByteArray GetString(const char* name, int index = 0, const QByteArray& default_value = QByteArray()) const;
+  double GetDouble(const char* name, int index = 0, double default_value = 0.0) const;
+  int GetInt(const char* name, int index = 0, int default_value = 0) const;
+
+  QVector<QByteArray> GetStrings(const char* name) const;
+  QVector<double> GetDoubles(const char* name) const;
+
+  bool Has(const char* name) const;
+
+  OfxPropertySetHandle handle();
+
+  static OFXPropertySet* FromHandle(OfxPropertySetHandle handle);
+
+  /**
+   * @brief The suite plugins read and write every property set through
+   */
+  static const OfxPropertySuiteV1* Suite();
+
+private:
+  enum Type {
+    kPointer,
+    kString,
+    kDouble,
+    kInt
+  };
+
+  /**
+   * @brief One property, only the vector matching `type` is used
+   *
+   * Doubles and ints convert to each other when read as the other type, since plugins aren't consistent about which
+   * they use for some properties.
+   */
+  struct Property {
+    Type type = kPointer;
+    QVector<void*> pointers;
+    QVector<QByteArray> strings;
+    QVector<double> doubles;
+    QVector<int> ints;
+
+    int dimension() const;
+  };
+
+  Property* Prepare(const char* name, Type type, int index);
+
+  static OfxStatus SetPointerSuite(OfxPropertySetHandle handle, const char* name, int index, void* value);
+  static OfxStatus SetStringSuite(OfxPropertySetHandle handle, const char* name, int index, const char* value);
+  static OfxStatus SetDoubleSuite(OfxPropertySetHandle handle, const char* name, int index, double value);
+  static OfxStatus SetIntSuite(OfxPropertySetHandle handle, const char* name, int index, int value);
+  static OfxStatus SetPointerNSuite(OfxPropertySetHandle handle, const char* name, int count, void* const* value);
+  static OfxStatus SetStringNSuite(OfxPropertySetHandle handle, const char* name, int count, const char* const* value);
+  static OfxStatus SetDoubleNSuite(OfxPropertySetHandle handle, const char* name, int count, const double* value);
+  static OfxStatus SetIntNSuite(OfxPropertySetHandle handle, const char* name, int count, const int* value);
+  static OfxStatus GetPointerSuite(OfxPropertySetHandle handle, const char* name, int index, void** value);
+  static OfxStatus GetStringSuite(OfxPropertySetHandle handle, const char* name, int index, char** value);
+  static OfxStatus GetDoubleSuite(OfxPropertySetHandle handle, const char* name, int index, double* value);
+  static OfxStatus GetIntSuite(OfxPropertySetHandle handle, const char* name, int index, int* value);
+  static OfxStatus GetPointerNSuite(OfxPropertySetHandle handle, const char* name, int count, void** value);
+  static OfxStatus GetStringNSuite(OfxPropertySetHandle handle, const char* name, int count, char** value);
+  static OfxStatus GetDoubleNSuite(OfxPropertySetHandle handle, const char* name, int count, double* value);
+  static OfxStatus GetIntNSuite(OfxPropertySetHandle handle, const char* name, int count, int* value);
+  static OfxStatus ResetSuite(OfxPropertySetHandle handle, const char* name);
+  static OfxStatus GetDimensionSuite(OfxPropertySetHandle handle, const char* name, int* count);
+
+  /**
+   * @brief Fetch one value of a property for a plugin, converting between doubles and ints
+   */
+  OfxStatus Get(const char* name, int index, Type type, void* value);
+
+  QHash<QByteArray, Property> properties_;
+
+  /**
+   * @brief Plugins may read instance properties from their own threads while the host writes to them
+   */
+  mutable QMutex lock_;
+
+};
+
+#endif // OFXPROPERTYSET_H
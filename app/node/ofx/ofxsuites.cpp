@@ -0,0 +1,1059 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "ofxsuites.h"
+
+#include <cstdlib>
+#include <QAtomicInt>
+#include <QDebug>
+#include <QMutex>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+
+#include "common/define.h"
+#include "node/ofx/ofxeffect.h"
+#include "node/ofx/ofxhost.h"
+#include "node/ofx/ofxnode.h"
+
+namespace {
+
+/// Time step used to approximate derivatives and integrals of parameters, in OFX time (seconds)
+const double kParamTimeStep = 0.001;
+
+/// Number of steps integrals of parameters are approximated with
+const int kParamIntegralSteps = 32;
+
+/// The index of the multiThread() call the current thread is running, 0 outside of one
+thread_local unsigned int current_thread_index = 0;
+
+/// Whether the current thread was started by multiThread()
+thread_local bool is_spawned_thread = false;
+
+/**
+ * @brief Returns the Node a clip's effect belongs to if it's rendering at `time`, or nullptr
+ */
+OFXNode* RenderingNode(OFXClip* clip, OfxTime time)
+{
+  OFXNode* node = clip->effect()->node();
+
+  // Temporal clip access isn't supported, so there are only images for the time being rendered
+  if (node == nullptr
+      || node->renderer() == nullptr
+      || time != OFXNode::ToOFXTime(node->current_time())) {
+    return nullptr;
+  }
+
+  return node;
+}
+
+/**
+ * @brief Set the properties images and textures of a clip being rendered share
+ */
+void SetImageProperties(OFXClip* clip, OFXNode* node, OFXPropertySet* image, const QByteArray& pixel_depth)
+{
+  RenderInstance* renderer = node->renderer();
+  const QRect& bounds = clip->bounds();
+  double scale = 1.0 / renderer->divider();
+
+  image->SetString(kOfxPropType, kOfxTypeImage);
+  image->SetString(kOfxImageEffectPropPixelDepth, pixel_depth);
+  image->SetString(kOfxImageEffectPropComponents, kOfxImageComponentRGBA);
+  image->SetString(kOfxImageEffectPropPreMultiplication, kOfxImagePreMultiplied);
+  image->SetString(kOfxImagePropField, kOfxImageFieldNone);
+  image->SetDouble(kOfxImagePropPixelAspectRatio, 1.0);
+  image->SetDoubles(kOfxImageEffectPropRenderScale, {scale, scale});
+  image->SetInts(kOfxImagePropBounds, {bounds.x(),
+                                       bounds.y(),
+                                       bounds.x() + bounds.width(),
+                                       bounds.y() + bounds.height()});
+  image->SetInts(kOfxImagePropRegionOfDefinition, {0, 0, renderer->frame_width(), renderer->frame_height()});
+
+  // Unique to the texture the image came from, which is never reused while it's referenced
+  image->SetString(kOfxImagePropUniqueIdentifier,
+                   QByteArray::number(static_cast<qulonglong>(reinterpret_cast<quintptr>(clip->texture().get())), 16));
+}
+
+/**
+ * @brief Returns TRUE if a parameter's values are doubles, the only ones with derivatives and integrals
+ */
+bool IsDoubleParam(OFXParam* param)
+{
+  const QByteArray& type = param->type();
+
+  return type == kOfxParamTypeDouble
+      || type == kOfxParamTypeDouble2D
+      || type == kOfxParamTypeDouble3D
+      || type == kOfxParamTypeRGB
+      || type == kOfxParamTypeRGBA;
+}
+
+/**
+ * @brief Convert an OFX time for a parameter, descriptors don't have a Node so their time doesn't matter
+ */
+rational ParamTime(OFXParam* param, OfxTime time)
+{
+  if (param->input() == nullptr) {
+    return rational();
+  }
+
+  return static_cast<OFXNode*>(param->input()->parent())->FromOFXTime(time);
+}
+
+/**
+ * @brief Returns TRUE if the calling thread may edit this parameter's keyframes
+ */
+bool CanEditParam(OFXParam* param)
+{
+  return param->input() != nullptr && QThread::currentThread() == param->input()->thread();
+}
+
+/**
+ * @brief Memory allocated by imageMemoryAlloc()
+ */
+struct ImageMemory {
+  void* data;
+};
+
+/**
+ * @brief One multiThread() call, each thread runs indices until there are none left
+ */
+class ThreadJob
+{
+public:
+  ThreadJob(OfxThreadFunctionV1* func, unsigned int count, void* arg) :
+    func_(func),
+    count_(count),
+    arg_(arg)
+  {
+  }
+
+  void Run()
+  {
+    int index;
+
+    while ((index = next_index_.fetchAndAddOrdered(1)) < static_cast<int>(count_)) {
+      current_thread_index = static_cast<unsigned int>(index);
+
+      func_(current_thread_index, count_, arg_);
+    }
+  }
+
+  QSemaphore& finished_workers()
+  {
+    return finished_workers_;
+  }
+
+private:
+  OfxThreadFunctionV1* func_;
+
+  unsigned int count_;
+
+  void* arg_;
+
+  QAtomicInt next_index_;
+
+  QSemaphore finished_workers_;
+};
+
+/**
+ * @brief Helps a ThreadJob on OFXHost::thread_pool()
+ */
+class ThreadWorker : public QRunnable
+{
+public:
+  ThreadWorker(ThreadJob* job) :
+    job_(job)
+  {
+  }
+
+  virtual void run() override
+  {
+    is_spawned_thread = true;
+
+    job_->Run();
+
+    is_spawned_thread = false;
+    current_thread_index = 0;
+
+    // The job may be destroyed as soon as this is released
+    job_->finished_workers().release();
+  }
+
+private:
+  ThreadJob* job_;
+};
+
+OfxStatus GetPropertySet(OfxImageEffectHandle handle, OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  *props = OFXEffect::FromHandle(handle)->properties()->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus GetParamSet(OfxImageEffectHandle handle, OfxParamSetHandle* param_set)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  *param_set = OFXEffect::FromHandle(handle)->param_set()->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipDefine(OfxImageEffectHandle handle, const char* name, OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXClip* clip = OFXEffect::FromHandle(handle)->DefineClip(name);
+
+  if (clip == nullptr) {
+    return kOfxStatErrExists;
+  }
+
+  *props = clip->properties()->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipGetHandle(OfxImageEffectHandle handle,
+                        const char* name,
+                        OfxImageClipHandle* clip_handle,
+                        OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXClip* clip = OFXEffect::FromHandle(handle)->GetClip(name);
+
+  if (clip == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  *clip_handle = clip->handle();
+
+  if (props != nullptr) {
+    *props = clip->properties()->handle();
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipGetPropertySet(OfxImageClipHandle handle, OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  *props = OFXClip::FromHandle(handle)->properties()->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipGetImage(OfxImageClipHandle handle, OfxTime time, const OfxRectD* region, OfxPropertySetHandle* image)
+{
+  // Images always cover the whole tile, which is at least the region the plugin asked for
+  Q_UNUSED(region)
+
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXClip* clip = OFXClip::FromHandle(handle);
+  OFXNode* node = RenderingNode(clip, time);
+
+  // Unconnected clips and plugins rendering with OpenGL have no image in memory
+  if (node == nullptr || clip->texture() == nullptr || clip->pixels().isEmpty()) {
+    return kOfxStatFailed;
+  }
+
+  OFXPropertySet* props = new OFXPropertySet();
+
+  SetImageProperties(clip, node, props, kOfxBitDepthFloat);
+  props->SetPointer(kOfxImagePropData, clip->pixels().data());
+  props->SetInt(kOfxImagePropRowBytes, clip->bounds().width() * kRGBAChannels * static_cast<int>(sizeof(float)));
+
+  *image = props->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipReleaseImage(OfxPropertySetHandle image)
+{
+  if (image == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  // Pixels belong to the clip, only the description is the image's
+  delete OFXPropertySet::FromHandle(image);
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipGetRegionOfDefinition(OfxImageClipHandle handle, OfxTime time, OfxRectD* bounds)
+{
+  Q_UNUSED(time)
+
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXEffect* effect = OFXClip::FromHandle(handle)->effect();
+
+  // Every clip covers the whole frame, which is the project size in canonical coordinates
+  QVector<double> size = effect->properties()->GetDoubles(kOfxImageEffectPropProjectSize);
+
+  bounds->x1 = 0.0;
+  bounds->y1 = 0.0;
+  bounds->x2 = size.value(0);
+  bounds->y2 = size.value(1);
+
+  return kOfxStatOK;
+}
+
+int Abort(OfxImageEffectHandle handle)
+{
+  if (handle == nullptr) {
+    return 0;
+  }
+
+  OFXNode* node = OFXEffect::FromHandle(handle)->node();
+
+  return node != nullptr && node->renderer() != nullptr && node->renderer()->cancelled();
+}
+
+OfxStatus ImageMemoryAlloc(OfxImageEffectHandle handle, size_t size, OfxImageMemoryHandle* memory_handle)
+{
+  Q_UNUSED(handle)
+
+  void* data = std::malloc(size);
+
+  if (data == nullptr) {
+    return kOfxStatErrMemory;
+  }
+
+  *memory_handle = reinterpret_cast<OfxImageMemoryHandle>(new ImageMemory{data});
+
+  return kOfxStatOK;
+}
+
+OfxStatus ImageMemoryFree(OfxImageMemoryHandle memory_handle)
+{
+  if (memory_handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  ImageMemory* memory = reinterpret_cast<ImageMemory*>(memory_handle);
+
+  std::free(memory->data);
+  delete memory;
+
+  return kOfxStatOK;
+}
+
+OfxStatus ImageMemoryLock(OfxImageMemoryHandle memory_handle, void** data)
+{
+  if (memory_handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  // Memory is never moved, so locking only hands out the pointer
+  *data = reinterpret_cast<ImageMemory*>(memory_handle)->data;
+
+  return kOfxStatOK;
+}
+
+OfxStatus ImageMemoryUnlock(OfxImageMemoryHandle memory_handle)
+{
+  return (memory_handle == nullptr) ? kOfxStatErrBadHandle : kOfxStatOK;
+}
+
+OfxStatus ParamDefine(OfxParamSetHandle handle, const char* type, const char* name, OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParamSet::FromHandle(handle)->Define(name, type);
+
+  if (param == nullptr) {
+    return kOfxStatErrExists;
+  }
+
+  if (props != nullptr) {
+    *props = param->properties()->handle();
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamGetHandle(OfxParamSetHandle handle,
+                         const char* name,
+                         OfxParamHandle* param_handle,
+                         OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParamSet::FromHandle(handle)->Get(name);
+
+  if (param == nullptr) {
+    return kOfxStatErrUnknown;
+  }
+
+  *param_handle = param->handle();
+
+  if (props != nullptr) {
+    *props = param->properties()->handle();
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamSetGetPropertySet(OfxParamSetHandle handle, OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  *props = OFXParamSet::FromHandle(handle)->properties()->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamGetPropertySet(OfxParamHandle handle, OfxPropertySetHandle* props)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  *props = OFXParam::FromHandle(handle)->properties()->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamGetValue(OfxParamHandle handle, ...)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  rational time;
+
+  if (param->input() != nullptr) {
+    time = static_cast<OFXNode*>(param->input()->parent())->current_time();
+  }
+
+  va_list args;
+  va_start(args, handle);
+  OfxStatus status = param->GetValue(time, args);
+  va_end(args);
+
+  return status;
+}
+
+OfxStatus ParamGetValueAtTime(OfxParamHandle handle, OfxTime time, ...)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  va_list args;
+  va_start(args, time);
+  OfxStatus status = param->GetValue(ParamTime(param, time), args);
+  va_end(args);
+
+  return status;
+}
+
+OfxStatus ParamGetDerivative(OfxParamHandle handle, OfxTime time, ...)
+{
+  if (handle == nullptr || !IsDoubleParam(OFXParam::FromHandle(handle))) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  // Central difference, keyframes are interpolated by NodeInput so there's no curve to differentiate directly
+  QVector<double> before = param->GetComponents(ParamTime(param, time - kParamTimeStep));
+  QVector<double> after = param->GetComponents(ParamTime(param, time + kParamTimeStep));
+
+  va_list args;
+  va_start(args, time);
+
+  for (int i=0;i<before.size();i++) {
+    *va_arg(args, double*) = (after.at(i) - before.at(i)) / (2.0 * kParamTimeStep);
+  }
+
+  va_end(args);
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamGetIntegral(OfxParamHandle handle, OfxTime time1, OfxTime time2, ...)
+{
+  if (handle == nullptr || !IsDoubleParam(OFXParam::FromHandle(handle))) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  // Trapezoidal rule
+  double step = (time2 - time1) / kParamIntegralSteps;
+  QVector<double> sum(param->dimension(), 0.0);
+  QVector<double> last = param->GetComponents(ParamTime(param, time1));
+
+  for (int i=1;i<=kParamIntegralSteps;i++) {
+    QVector<double> next = param->GetComponents(ParamTime(param, time1 + step * i));
+
+    for (int j=0;j<sum.size();j++) {
+      sum[j] += (last.at(j) + next.at(j)) * 0.5 * step;
+    }
+
+    last = next;
+  }
+
+  va_list args;
+  va_start(args, time2);
+
+  foreach (double s, sum) {
+    *va_arg(args, double*) = s;
+  }
+
+  va_end(args);
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamSetValue(OfxParamHandle handle, ...)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  va_list args;
+  va_start(args, handle);
+  OfxStatus status = OFXParam::FromHandle(handle)->SetValue(args);
+  va_end(args);
+
+  return status;
+}
+
+OfxStatus ParamSetValueAtTime(OfxParamHandle handle, OfxTime time, ...)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  va_list args;
+  va_start(args, time);
+  OfxStatus status = param->SetValueAtTime(ParamTime(param, time), args);
+  va_end(args);
+
+  return status;
+}
+
+OfxStatus ParamGetNumKeys(OfxParamHandle handle, unsigned int* count)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  *count = (param->input() == nullptr) ? 0 : static_cast<unsigned int>(param->input()->keyframes().size());
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamGetKeyTime(OfxParamHandle handle, unsigned int index, OfxTime* time)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  if (param->input() == nullptr) {
+    return kOfxStatErrBadIndex;
+  }
+
+  QList<NodeKeyframe> keys = param->input()->keyframes();
+
+  if (index >= static_cast<unsigned int>(keys.size())) {
+    return kOfxStatErrBadIndex;
+  }
+
+  *time = OFXNode::ToOFXTime(keys.at(static_cast<int>(index)).time());
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamGetKeyIndex(OfxParamHandle handle, OfxTime time, int direction, int* index)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  if (param->input() == nullptr) {
+    return kOfxStatFailed;
+  }
+
+  QList<NodeKeyframe> keys = param->input()->keyframes();
+  rational t = ParamTime(param, time);
+
+  for (int i=0;i<keys.size();i++) {
+    const rational& key_time = keys.at(i).time();
+
+    if (direction == 0 && key_time == t) {
+      *index = i;
+      return kOfxStatOK;
+    } else if (direction > 0 && key_time > t) {
+      *index = i;
+      return kOfxStatOK;
+    } else if (direction < 0 && key_time >= t) {
+      // The previous key was the last one before `time`
+      if (i == 0) {
+        return kOfxStatFailed;
+      }
+
+      *index = i - 1;
+      return kOfxStatOK;
+    }
+  }
+
+  if (direction < 0 && !keys.isEmpty()) {
+    *index = keys.size() - 1;
+    return kOfxStatOK;
+  }
+
+  return kOfxStatFailed;
+}
+
+OfxStatus ParamDeleteKey(OfxParamHandle handle, OfxTime time)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  if (!CanEditParam(param)) {
+    return kOfxStatFailed;
+  }
+
+  param->input()->remove_keyframe(ParamTime(param, time));
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamDeleteAllKeys(OfxParamHandle handle)
+{
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* param = OFXParam::FromHandle(handle);
+
+  if (!CanEditParam(param)) {
+    return kOfxStatFailed;
+  }
+
+  param->input()->set_keyframes(QList<NodeKeyframe>());
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamCopy(OfxParamHandle to, OfxParamHandle from, OfxTime offset, const OfxRangeD* range)
+{
+  Q_UNUSED(offset)
+  Q_UNUSED(range)
+
+  if (to == nullptr || from == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXParam* dst = OFXParam::FromHandle(to);
+  OFXParam* src = OFXParam::FromHandle(from);
+
+  if (!CanEditParam(dst) || src->input() == nullptr || src->type() != dst->type()) {
+    return kOfxStatFailed;
+  }
+
+  // Copies everything, offsetting and restricting keyframes isn't supported
+  NodeInput::CopyValues(src->input(), dst->input());
+
+  return kOfxStatOK;
+}
+
+OfxStatus ParamEditBegin(OfxParamSetHandle handle, const char* name)
+{
+  Q_UNUSED(name)
+
+  // Edits aren't grouped into one undo command
+  return (handle == nullptr) ? kOfxStatErrBadHandle : kOfxStatOK;
+}
+
+OfxStatus ParamEditEnd(OfxParamSetHandle handle)
+{
+  return (handle == nullptr) ? kOfxStatErrBadHandle : kOfxStatOK;
+}
+
+OfxStatus MemoryAlloc(void* handle, size_t size, void** data)
+{
+  Q_UNUSED(handle)
+
+  *data = std::malloc(size);
+
+  return (*data == nullptr) ? kOfxStatErrMemory : kOfxStatOK;
+}
+
+OfxStatus MemoryFree(void* data)
+{
+  std::free(data);
+
+  return kOfxStatOK;
+}
+
+OfxStatus MultiThread(OfxThreadFunctionV1 func, unsigned int count, void* arg)
+{
+  if (func == nullptr) {
+    return kOfxStatFailed;
+  }
+
+  count = qMax(1U, count);
+
+  // The calling thread may itself be running an index of an outer call
+  unsigned int outer_index = current_thread_index;
+
+  ThreadJob job(func, count, arg);
+
+  // Only use threads that are free right now, this thread does whatever work is left over. Calls from threads this
+  // suite started run in that thread alone, the pool is busy with their siblings.
+  int workers = 0;
+
+  if (!is_spawned_thread) {
+    QThreadPool* pool = OFXHost::Instance()->thread_pool();
+
+    for (unsigned int i=1;i<count;i++) {
+      ThreadWorker* worker = new ThreadWorker(&job);
+
+      if (!pool->tryStart(worker)) {
+        delete worker;
+        break;
+      }
+
+      workers++;
+    }
+  }
+
+  job.Run();
+
+  job.finished_workers().acquire(workers);
+
+  current_thread_index = outer_index;
+
+  return kOfxStatOK;
+}
+
+OfxStatus MultiThreadNumCPUs(unsigned int* count)
+{
+  *count = static_cast<unsigned int>(qMax(1, OFXHost::Instance()->thread_pool()->maxThreadCount()));
+
+  return kOfxStatOK;
+}
+
+OfxStatus MultiThreadIndex(unsigned int* index)
+{
+  *index = current_thread_index;
+
+  return kOfxStatOK;
+}
+
+int MultiThreadIsSpawnedThread()
+{
+  return is_spawned_thread;
+}
+
+OfxStatus MutexCreate(OfxMutexHandle* mutex, int lock_count)
+{
+  // OFX mutexes are recursive
+  QMutex* m = new QMutex(QMutex::Recursive);
+
+  for (int i=0;i<lock_count;i++) {
+    m->lock();
+  }
+
+  *mutex = reinterpret_cast<OfxMutexHandle>(m);
+
+  return kOfxStatOK;
+}
+
+OfxStatus MutexDestroy(const OfxMutexHandle mutex)
+{
+  if (mutex == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  delete reinterpret_cast<QMutex*>(mutex);
+
+  return kOfxStatOK;
+}
+
+OfxStatus MutexLock(const OfxMutexHandle mutex)
+{
+  if (mutex == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  reinterpret_cast<QMutex*>(mutex)->lock();
+
+  return kOfxStatOK;
+}
+
+OfxStatus MutexUnlock(const OfxMutexHandle mutex)
+{
+  if (mutex == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  reinterpret_cast<QMutex*>(mutex)->unlock();
+
+  return kOfxStatOK;
+}
+
+OfxStatus MutexTryLock(const OfxMutexHandle mutex)
+{
+  if (mutex == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  return reinterpret_cast<QMutex*>(mutex)->tryLock() ? kOfxStatOK : kOfxStatFailed;
+}
+
+OfxStatus Message(void* handle, const char* type, const char* id, const char* format, ...)
+{
+  Q_UNUSED(handle)
+  Q_UNUSED(id)
+
+  va_list args;
+  va_start(args, format);
+  QString message = QString::vasprintf(format, args);
+  va_end(args);
+
+  if (qstrcmp(type, kOfxMessageFatal) == 0 || qstrcmp(type, kOfxMessageError) == 0) {
+    qWarning().noquote() << "OpenFX:" << message;
+  } else {
+    qDebug().noquote() << "OpenFX:" << message;
+  }
+
+  // Plugins may ask while rendering, where nobody can answer
+  if (qstrcmp(type, kOfxMessageQuestion) == 0) {
+    return kOfxStatReplyDefault;
+  }
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipLoadTexture(OfxImageClipHandle handle,
+                          OfxTime time,
+                          const char* format,
+                          const OfxRectD* region,
+                          OfxPropertySetHandle* texture_handle)
+{
+  // Textures are always the tile in the renderer's format, GL converts whatever the plugin samples
+  Q_UNUSED(format)
+  Q_UNUSED(region)
+
+  if (handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  OFXClip* clip = OFXClip::FromHandle(handle);
+  OFXNode* node = RenderingNode(clip, time);
+
+  if (node == nullptr || clip->texture() == nullptr) {
+    return kOfxStatFailed;
+  }
+
+  QByteArray depth;
+
+  switch (clip->texture()->format()) {
+  case olive::PIX_FMT_RGBA8:
+    depth = kOfxBitDepthByte;
+    break;
+  case olive::PIX_FMT_RGBA16U:
+  case olive::PIX_FMT_RGB10A2:
+    depth = kOfxBitDepthShort;
+    break;
+  case olive::PIX_FMT_RGBA16F:
+    depth = kOfxBitDepthHalf;
+    break;
+  default:
+    depth = kOfxBitDepthFloat;
+    break;
+  }
+
+  OFXPropertySet* props = new OFXPropertySet();
+
+  SetImageProperties(clip, node, props, depth);
+  props->SetInt(kOfxImageEffectPropOpenGLTextureIndex, static_cast<int>(clip->texture()->texture()));
+  props->SetInt(kOfxImageEffectPropOpenGLTextureTarget, GL_TEXTURE_2D);
+
+  *texture_handle = props->handle();
+
+  return kOfxStatOK;
+}
+
+OfxStatus ClipFreeTexture(OfxPropertySetHandle texture_handle)
+{
+  if (texture_handle == nullptr) {
+    return kOfxStatErrBadHandle;
+  }
+
+  // The texture itself belongs to the clip
+  delete OFXPropertySet::FromHandle(texture_handle);
+
+  return kOfxStatOK;
+}
+
+OfxStatus FlushResources()
+{
+  return kOfxStatOK;
+}
+
+}
+
+namespace olive {
+namespace ofx {
+
+const OfxImageEffectSuiteV1 *ImageEffectSuite()
+{
+  static const OfxImageEffectSuiteV1 suite = {
+    GetPropertySet,
+    GetParamSet,
+    ClipDefine,
+    ClipGetHandle,
+    ClipGetPropertySet,
+    ClipGetImage,
+    ClipReleaseImage,
+    ClipGetRegionOfDefinition,
+    Abort,
+    ImageMemoryAlloc,
+    ImageMemoryFree,
+    ImageMemoryLock,
+    ImageMemoryUnlock
+  };
+
+  return &suite;
+}
+
+const OfxParameterSuiteV1 *ParameterSuite()
+{
+  static const OfxParameterSuiteV1 suite = {
+    ParamDefine,
+    ParamGetHandle,
+    ParamSetGetPropertySet,
+    ParamGetPropertySet,
+    ParamGetValue,
+    ParamGetValueAtTime,
+    ParamGetDerivative,
+    ParamGetIntegral,
+    ParamSetValue,
+    ParamSetValueAtTime,
+    ParamGetNumKeys,
+    ParamGetKeyTime,
+    ParamGetKeyIndex,
+    ParamDeleteKey,
+    ParamDeleteAllKeys,
+    ParamCopy,
+    ParamEditBegin,
+    ParamEditEnd
+  };
+
+  return &suite;
+}
+
+const OfxMemorySuiteV1 *MemorySuite()
+{
+  static const OfxMemorySuiteV1 suite = {
+    MemoryAlloc,
+    MemoryFree
+  };
+
+  return &suite;
+}
+
+const OfxMultiThreadSuiteV1 *MultiThreadSuite()
+{
+  static const OfxMultiThreadSuiteV1 suite = {
+    MultiThread,
+    MultiThreadNumCPUs,
+    MultiThreadIndex,
+    MultiThreadIsSpawnedThread,
+    MutexCreate,
+    MutexDestroy,
+    MutexLock,
+    MutexUnlock,
+    MutexTryLock
+  };
+
+  return &suite;
+}
+
+const OfxMessageSuiteV1 *MessageSuite()
+{
+  static const OfxMessageSuiteV1 suite = {
+    Message
+  };
+
+  return &suite;
+}
+
+const OfxImageEffectOpenGLRenderSuiteV1 *OpenGLRenderSuite()
+{
+  static const OfxImageEffectOpenGLRenderSuiteV1 suite = {
+    ClipLoadTexture,
+    ClipFreeTexture,
+    FlushResources
+  };
+
+  return &suite;
+}
+
+}
+}
@@ -0,0 +1,64 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef OFXSUITES_H
+#define OFXSUITES_H
+
+#include <ofxGPURender.h>
+#include <ofxImageEffect.h>
+#include <ofxMemory.h>
+#include <ofxMessage.h>
+#include <ofxMultiThread.h>
+#include <ofxParam.h>
+
+namespace olive {
+namespace ofx {
+
+/**
+ * @brief The host side of each OpenFX suite other than properties (see OFXPropertySet::Suite())
+ *
+ * Handles are pointers to the objects in ofxeffect.h. Images live in OFXClip for the duration of a render, which
+ * OFXNode sets up, so the image suites fail outside of one.
+ */
+const OfxImageEffectSuiteV1* ImageEffectSuite();
+
+const OfxParameterSuiteV1* ParameterSuite();
+
+const OfxMemorySuiteV1* MemorySuite();
+
+/**
+ * @brief Runs plugins' threads on OFXHost::thread_pool()
+ *
+ * The calling thread always takes part, and only threads that are free right now are added, so plugins rendering in
+ * parallel on several render threads don't oversubscribe the CPU.
+ */
+const OfxMultiThreadSuiteV1* MultiThreadSuite();
+
+const OfxMessageSuiteV1* MessageSuite();
+
+/**
+ * @brief Hands plugins the RenderTexture of each clip directly so OpenGL plugins render without a round trip
+ */
+const OfxImageEffectOpenGLRenderSuiteV1* OpenGLRenderSuite();
+
+}
+}
+
+#endif // OFXSUITES_H
@@ -59,29 +59,37 @@ void NodeOutput::set_data_type(const NodeParam::DataType &type)
   }
 }
 
-QVariant NodeOutput::get_value(const rational& time)
+NodeValue NodeOutput::get_value(const rational& time)
 {
   mutex_.lock();
 
-  QVariant v;
+  NodeValue v;
 
-  if (time_ != time || !value_caching_) {
-    // Update the value
-    value_ = parent()->Run(this, time);
+  if (!GetCachedValue(time, &v)) {
+    int generation = CacheGeneration();
 
-    time_ = time;
+    // Update the value
+    v = parent()->Run(this, time);
+
+    // Values that are the same at every time only need evaluating once. Textures are excluded since they're specific
+    // to the instance that rendered them (its size and context) and nodes downstream may modify them (e.g. opacity).
+    if (data_type_ != kTexture && parent()->IsTimeInvariant(this)) {
+      InsertCachedValue(time, RATIONAL_MIN, RATIONAL_MAX, generation, v);
+    } else {
+      InsertCachedValue(time, time, time, generation, v);
+    }
   }
 
-  v = value_;
-
   mutex_.unlock();
 
   return v;
 }
 
-void NodeOutput::push_value(const QVariant &v, const rational &time)
+void NodeOutput::push_value(NodeValue v, const rational &time)
 {
-  value_ = v;
-  time_ = time;
-}
+  mutex_.lock();
+
+  InsertCachedValue(time, time, time, CacheGeneration(), v);
 
+  mutex_.unlock();
+}
@@ -21,12 +21,19 @@
 #include "timeline.h"
 
 #include <QDebug>
+#include <QOpenGLFunctions>
 
+#include "config/config.h"
 #include "node/block/gap/gap.h"
 #include "node/graph.h"
+#include "node/processor/renderer/renderer.h"
+#include "render/gl/functions.h"
+#include "render/gl/shadercache.h"
 
 TimelineOutput::TimelineOutput() :
-  attached_timeline_(nullptr)
+  attached_timeline_(nullptr),
+  edit_depth_(0),
+  has_pending_invalidation_(false)
 {
   track_input_ = new NodeInput("track_in");
   track_input_->add_data_input(NodeParam::kTrack);
@@ -36,6 +43,10 @@ TimelineOutput::TimelineOutput() :
   length_output_->set_data_type(NodeParam::kRational);
   AddParameter(length_output_);
 
+  texture_output_ = new NodeOutput("tex_out");
+  texture_output_->set_data_type(NodeParam::kTexture);
+  AddParameter(texture_output_);
+
   connect(this, SIGNAL(EdgeAdded(NodeEdgePtr)), this, SLOT(TrackConnectionAdded(NodeEdgePtr)));
   connect(this, SIGNAL(EdgeRemoved(NodeEdgePtr)), this, SLOT(TrackConnectionRemoved(NodeEdgePtr)));
 }
@@ -69,6 +80,8 @@ void TimelineOutput::AttachTimeline(TimelinePanel *timeline)
     disconnect(view, SIGNAL(RequestPlaceBlock(Block*, rational, int)), this, SLOT(PlaceBlock(Block*, rational, int)));
     disconnect(view, SIGNAL(RequestReplaceBlock(Block*, Block*, int)), this, SLOT(ReplaceBlock(Block*, Block*, int)));
     disconnect(view, SIGNAL(RequestSplitAtTime(rational, int)), this, SLOT(SplitAtTime(rational, int)));
+    disconnect(view, SIGNAL(RequestBeginEdit()), this, SLOT(BeginEdit()));
+    disconnect(view, SIGNAL(RequestEndEdit()), this, SLOT(EndEdit()));
 
     // Remove existing UI objects from TimelinePanel
     attached_timeline_->Clear();
@@ -92,6 +105,8 @@ void TimelineOutput::AttachTimeline(TimelinePanel *timeline)
     connect(view, SIGNAL(RequestPlaceBlock(Block*, rational, int)), this, SLOT(PlaceBlock(Block*, rational, int)));
     connect(view, SIGNAL(RequestReplaceBlock(Block*, Block*, int)), this, SLOT(ReplaceBlock(Block*, Block*, int)));
     connect(view, SIGNAL(RequestSplitAtTime(rational, int)), this, SLOT(SplitAtTime(rational, int)));
+    connect(view, SIGNAL(RequestBeginEdit()), this, SLOT(BeginEdit()));
+    connect(view, SIGNAL(RequestEndEdit()), this, SLOT(EndEdit()));
   }
 }
 
@@ -105,24 +120,177 @@ NodeOutput *TimelineOutput::length_output()
   return length_output_;
 }
 
-QVariant TimelineOutput::Value(NodeOutput *output, const rational &time)
+const QVector<TrackOutput *> &TimelineOutput::tracks()
+{
+  return track_cache_;
+}
+
+NodeOutput *TimelineOutput::texture_output()
+{
+  return texture_output_;
+}
+
+QList<NodeDependency> TimelineOutput::RunDependencies(NodeOutput *output, const rational &time)
+{
+  if (output != texture_output_) {
+    return Node::RunDependencies(output, time);
+  }
+
+  QList<NodeDependency> deps;
+
+  foreach (TrackOutput* track, track_cache_) {
+    if (track->HasClipAtTime(time)) {
+      deps.append(NodeDependency(track->texture_output(), time));
+    }
+  }
+
+  return deps;
+}
+
+void TimelineOutput::StaticRange(NodeOutput *output, const rational &time, rational *in, rational *out)
+{
+  if (output != texture_output_) {
+    Node::StaticRange(output, time, in, out);
+    return;
+  }
+
+  InputsStaticRange(time, in, out);
+
+  foreach (TrackOutput* track, track_cache_) {
+    if (*in == *out) {
+      return;
+    }
+
+    rational track_in, track_out;
+    track->StaticRange(track->texture_output(), time, &track_in, &track_out);
+
+    IntersectStaticRange(time, track_in, track_out, in, out);
+  }
+}
+
+void TimelineOutput::InvalidateCache(const rational &start_range, const rational &end_range, NodeInput *from)
+{
+  if (edit_depth_ == 0) {
+    Node::InvalidateCache(start_range, end_range, from);
+    return;
+  }
+
+  if (has_pending_invalidation_) {
+    pending_invalidation_in_ = qMin(pending_invalidation_in_, start_range);
+    pending_invalidation_out_ = qMax(pending_invalidation_out_, end_range);
+  } else {
+    pending_invalidation_in_ = start_range;
+    pending_invalidation_out_ = end_range;
+    has_pending_invalidation_ = true;
+  }
+}
+
+void TimelineOutput::RippleRemoveArea(const rational &in, const rational &out)
+{
+  BeginEdit();
+
+  foreach (TrackOutput* track, track_cache_) {
+    track->RippleRemoveArea(in, out);
+  }
+
+  EndEdit();
+}
+
+NodeValue TimelineOutput::Value(NodeOutput *output, const rational &time)
 {
   if (output == length_output_) {
     Q_UNUSED(time)
 
-    rational length;
+    return NodeValue(length_);
+  } else if (output == texture_output_) {
+    QList<RenderTexturePtr> layers;
 
-    // Retrieve each track's end point and return the longest of the tracks
     foreach (TrackOutput* track, track_cache_) {
-      length = qMax(track->in(), length);
+      if (!track->HasClipAtTime(time)) {
+        continue;
+      }
+
+      RenderTexturePtr texture = track->texture_output()->get_value(time).takeTexture();
+
+      // Fully transparent layers have nothing to contribute
+      if (texture != nullptr && texture->pending_opacity() > 0.0f) {
+        layers.append(texture);
+      }
     }
 
-    return QVariant::fromValue(length);
+    if (layers.isEmpty()) {
+      return 0;
+    } else if (layers.size() == 1) {
+      // Nothing to composite, its deferred operations are left to whoever uses it
+      return NodeValue(layers.first());
+    }
+
+    return CompositeTracks(layers);
   }
 
   return 0;
 }
 
+NodeValue TimelineOutput::CompositeTracks(const QList<RenderTexturePtr> &layers)
+{
+  RenderInstance* renderer = RendererProcessor::CurrentInstance();
+
+  if (renderer == nullptr) {
+    return 0;
+  }
+
+  QOpenGLFunctions* f = renderer->context()->functions();
+
+  RenderTexturePtr output = renderer->texture_pool()->Get(renderer->width(),
+                                                          renderer->height(),
+                                                          renderer->format(),
+                                                          RenderTexture::kDoubleBuffer);
+
+  renderer->buffer()->Attach(output);
+  renderer->buffer()->Bind();
+
+  for (int start=0;start<layers.size();start+=kMaxCompositeLayers) {
+    int count = qMin(kMaxCompositeLayers, layers.size() - start);
+
+    ShaderPtr pipeline = ShaderCache::Get(renderer->context())->CompositePipeline(count);
+
+    pipeline->bind();
+
+    for (int i=0;i<count;i++) {
+      const RenderTexturePtr& layer = layers.at(start + i);
+
+      f->glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+      layer->Bind();
+
+      // Opacity deferred on the track's texture is applied here rather than in a separate pass
+      pipeline->setUniformValue(QString("layer%1_opacity").arg(i).toUtf8().constData(), layer->pending_opacity());
+    }
+
+    f->glActiveTexture(GL_TEXTURE0);
+
+    pipeline->release();
+
+    // The first pass replaces whatever was in the texture, later passes go over the passes before them
+    if (start == 0) {
+      f->glBlendFunc(GL_ONE, GL_ZERO);
+    } else {
+      f->glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    olive::gl::Blit(pipeline);
+
+    for (int i=count-1;i>=0;i--) {
+      f->glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+      layers.at(start + i)->Release();
+    }
+  }
+
+  renderer->buffer()->Release();
+  renderer->buffer()->Detach();
+
+  return NodeValue(std::move(output));
+}
+
 int TimelineOutput::GetTrackIndex(TrackOutput *track)
 {
   return track_cache_.indexOf(track);
@@ -130,13 +298,34 @@ int TimelineOutput::GetTrackIndex(TrackOutput *track)
 
 rational TimelineOutput::GetSequenceLength()
 {
-  rational length = 0;
+  return length_;
+}
 
-  foreach (TrackOutput* track, track_cache_) {
-    length = qMax(length, track->in());
+void TimelineOutput::AddTrackLength(TrackOutput *track, const rational &length)
+{
+  track_lengths_.insert(track, length);
+  track_ends_[length]++;
+
+  length_ = track_ends_.rbegin()->first;
+}
+
+void TimelineOutput::RemoveTrackLength(TrackOutput *track)
+{
+  QHash<TrackOutput*, rational>::iterator it = track_lengths_.find(track);
+
+  if (it == track_lengths_.end()) {
+    return;
   }
 
-  return length;
+  std::map<rational, int>::iterator end = track_ends_.find(it.value());
+
+  if (--end->second == 0) {
+    track_ends_.erase(end);
+  }
+
+  track_lengths_.erase(it);
+
+  length_ = track_ends_.empty() ? rational(0) : track_ends_.rbegin()->first;
 }
 
 TrackOutput *TimelineOutput::attached_track()
@@ -154,9 +343,12 @@ void TimelineOutput::AttachTrack(TrackOutput *track)
     connect(current_track, SIGNAL(EdgeRemoved(NodeEdgePtr)), this, SLOT(TrackEdgeRemoved(NodeEdgePtr)));
     connect(current_track, SIGNAL(BlockAdded(Block*)), this, SLOT(TrackAddedBlock(Block*)));
     connect(current_track, SIGNAL(BlockRemoved(Block*)), this, SLOT(TrackRemovedBlock(Block*)));
+    connect(current_track, SIGNAL(LengthChanged(const rational&)), this, SLOT(TrackLengthChanged(const rational&)));
 
     track_cache_.append(current_track);
 
+    AddTrackLength(current_track, current_track->in());
+
     // This function must be called after the track is added to track_cache_, since it uses track_cache_ to determine
     // the track's index
     current_track->GenerateBlockWidgets();
@@ -177,9 +369,12 @@ void TimelineOutput::DetachTrack(TrackOutput *track)
     disconnect(current_track, SIGNAL(EdgeRemoved(NodeEdgePtr)), this, SLOT(TrackEdgeRemoved(NodeEdgePtr)));
     disconnect(current_track, SIGNAL(BlockAdded(Block*)), this, SLOT(TrackAddedBlock(Block*)));
     disconnect(current_track, SIGNAL(BlockRemoved(Block*)), this, SLOT(TrackRemovedBlock(Block*)));
+    disconnect(current_track, SIGNAL(LengthChanged(const rational&)), this, SLOT(TrackLengthChanged(const rational&)));
 
     track_cache_.removeAll(current_track);
 
+    RemoveTrackLength(current_track);
+
     current_track = current_track->next_track();
   }
 }
@@ -233,6 +428,12 @@ void TimelineOutput::TrackConnectionRemoved(NodeEdgePtr edge)
 
 void TimelineOutput::TrackAddedBlock(Block *block)
 {
+  // Tracks re-announce their Blocks whenever a panel is attached, so this may already be indexed
+  RemoveBlockEditPoints(block);
+  AddBlockEditPoints(block);
+
+  connect(block, SIGNAL(Refreshed()), this, SLOT(BlockRefreshed()), Qt::UniqueConnection);
+
   if (attached_timeline_ != nullptr) {
     attached_timeline_->view()->AddBlock(block, GetTrackIndex(static_cast<TrackOutput*>(sender())));
   }
@@ -240,11 +441,40 @@ void TimelineOutput::TrackAddedBlock(Block *block)
 
 void TimelineOutput::TrackRemovedBlock(Block *block)
 {
+  disconnect(block, SIGNAL(Refreshed()), this, SLOT(BlockRefreshed()));
+
+  RemoveBlockEditPoints(block);
+
   if (attached_timeline_ != nullptr) {
     attached_timeline_->view()->RemoveBlock(block);
   }
 }
 
+void TimelineOutput::TrackLengthChanged(const rational &length)
+{
+  // Assume this signal was sent from a TrackOutput
+  TrackOutput* track = static_cast<TrackOutput*>(sender());
+
+  RemoveTrackLength(track);
+  AddTrackLength(track, length);
+}
+
+void TimelineOutput::BlockRefreshed()
+{
+  // Assume this signal was sent from a Block
+  Block* block = static_cast<Block*>(sender());
+
+  QHash<Block*, QPair<rational, rational> >::const_iterator it = block_edit_points_.constFind(block);
+
+  // Most Blocks that refresh haven't actually moved
+  if (it != block_edit_points_.constEnd() && it.value().first == block->in() && it.value().second == block->out()) {
+    return;
+  }
+
+  RemoveBlockEditPoints(block);
+  AddBlockEditPoints(block);
+}
+
 void TimelineOutput::TrackEdgeAdded(NodeEdgePtr edge)
 {
   // Assume this signal was sent from a TrackOutput
@@ -271,6 +501,133 @@ void TimelineOutput::TrackEdgeRemoved(NodeEdgePtr edge)
   }
 }
 
+void TimelineOutput::AddBlockEditPoints(Block *block)
+{
+  block_edit_points_.insert(block, QPair<rational, rational>(block->in(), block->out()));
+
+  edit_points_[block->in()]++;
+  edit_points_[block->out()]++;
+}
+
+void TimelineOutput::RemoveBlockEditPoints(Block *block)
+{
+  QHash<Block*, QPair<rational, rational> >::iterator it = block_edit_points_.find(block);
+
+  if (it == block_edit_points_.end()) {
+    return;
+  }
+
+  RemoveEditPoint(it.value().first);
+  RemoveEditPoint(it.value().second);
+
+  block_edit_points_.erase(it);
+}
+
+void TimelineOutput::RemoveEditPoint(const rational &point)
+{
+  std::map<rational, int>::iterator it = edit_points_.find(point);
+
+  if (it != edit_points_.end() && --it->second == 0) {
+    edit_points_.erase(it);
+  }
+}
+
+bool TimelineOutput::GetPreviousEditPoint(const rational &time, rational *point) const
+{
+  std::map<rational, int>::const_iterator it = edit_points_.lower_bound(time);
+
+  if (it == edit_points_.begin()) {
+    return false;
+  }
+
+  *point = (--it)->first;
+
+  return true;
+}
+
+bool TimelineOutput::GetNextEditPoint(const rational &time, rational *point) const
+{
+  std::map<rational, int>::const_iterator it = edit_points_.upper_bound(time);
+
+  if (it == edit_points_.end()) {
+    return false;
+  }
+
+  *point = it->first;
+
+  return true;
+}
+
+bool TimelineOutput::GetNearestEditPoint(const rational &time, rational *point) const
+{
+  std::map<rational, int>::const_iterator it = edit_points_.find(time);
+
+  if (it != edit_points_.end()) {
+    *point = time;
+    return true;
+  }
+
+  rational previous, next;
+  bool has_previous = GetPreviousEditPoint(time, &previous);
+  bool has_next = GetNextEditPoint(time, &next);
+
+  if (has_previous && has_next) {
+    *point = (time - previous <= next - time) ? previous : next;
+  } else if (has_previous) {
+    *point = previous;
+  } else if (has_next) {
+    *point = next;
+  } else {
+    return false;
+  }
+
+  return true;
+}
+
+void TimelineOutput::BeginEdit()
+{
+  edit_depth_++;
+
+  if (edit_depth_ > 1) {
+    return;
+  }
+
+  edit_tracks_.resize(track_cache_.size());
+
+  for (int i=0;i<track_cache_.size();i++) {
+    edit_tracks_[i] = track_cache_.at(i);
+    track_cache_.at(i)->BeginEdit();
+  }
+}
+
+void TimelineOutput::EndEdit()
+{
+  edit_depth_--;
+
+  if (edit_depth_ > 0) {
+    return;
+  }
+
+  // Tracks settle their Block lists first, which may invalidate further (still merged since they're edits)
+  edit_depth_++;
+
+  foreach (const QPointer<TrackOutput>& track, edit_tracks_) {
+    if (!track.isNull()) {
+      track->EndEdit();
+    }
+  }
+
+  edit_depth_--;
+
+  edit_tracks_.clear();
+
+  if (has_pending_invalidation_) {
+    has_pending_invalidation_ = false;
+
+    Node::InvalidateCache(pending_invalidation_in_, pending_invalidation_out_);
+  }
+}
+
 void TimelineOutput::PlaceBlock(Block *block, rational start, int track)
 {
   Q_ASSERT(track >= 0);
@@ -21,9 +21,15 @@
 #ifndef TIMELINEOUTPUT_H
 #define TIMELINEOUTPUT_H
 
+#include <map>
+#include <QHash>
+#include <QPair>
+#include <QPointer>
+
 #include "node/block/block.h"
 #include "node/output/track/track.h"
 #include "panel/timeline/timeline.h"
+#include "render/rendertexture.h"
 
 /**
  * @brief Node that represents the end of the Timeline as well as a time traversal Node
@@ -47,14 +53,84 @@ public:
 
   NodeOutput* length_output();
 
+  /**
+   * @brief Every connected track, in the order they were attached
+   */
+  const QVector<TrackOutput*>& tracks();
+
+  /**
+   * @brief Output of every track composited together, bottom track (the first) first
+   */
+  NodeOutput* texture_output();
+
+  /**
+   * @brief Depends on the texture of every track with a clip at `time`
+   *
+   * The tracks don't depend on each other, so the scheduler renders them in parallel before they're composited.
+   * Tracks that only have a gap (or nothing) at `time` are skipped entirely.
+   */
+  virtual QList<NodeDependency> RunDependencies(NodeOutput* output, const rational& time) override;
+
+  /**
+   * @brief Override includes every track, since tracks without a clip at `time` may have one elsewhere in the range
+   */
+  virtual void StaticRange(NodeOutput* output, const rational& time, rational* in, rational* out) override;
+
+  /**
+   * @brief Override merges every invalidation received during an edit (see BeginEdit()) into one
+   */
+  virtual void InvalidateCache(const rational& start_range, const rational& end_range, NodeInput* from = nullptr) override;
+
+  /**
+   * @brief Clears the area between `in` and `out` on every track, see TrackOutput::RippleRemoveArea()
+   */
+  void RippleRemoveArea(const rational& in, const rational& out);
+
+  /**
+   * @brief Finds the last edit point (the in or out point of a Block on any track) before `time`
+   *
+   * O(log n) in the number of edit points. Returns FALSE if there isn't one.
+   */
+  bool GetPreviousEditPoint(const rational& time, rational* point) const;
+
+  /**
+   * @brief Finds the first edit point after `time`, see GetPreviousEditPoint()
+   */
+  bool GetNextEditPoint(const rational& time, rational* point) const;
+
+  /**
+   * @brief Finds the edit point closest to `time` (including `time` itself), see GetPreviousEditPoint()
+   */
+  bool GetNearestEditPoint(const rational& time, rational* point) const;
+
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
 private:
+  /**
+   * @brief Composite track textures (bottom first) into one texture
+   *
+   * Up to kMaxCompositeLayers textures are drawn per pass using ShaderCache::CompositePipeline().
+   */
+  NodeValue CompositeTracks(const QList<RenderTexturePtr>& layers);
+
   int GetTrackIndex(TrackOutput* track);
 
+  /**
+   * @brief Returns the end of the longest track (O(1))
+   */
   rational GetSequenceLength();
 
+  void AddTrackLength(TrackOutput* track, const rational& length);
+
+  void RemoveTrackLength(TrackOutput* track);
+
+  void AddBlockEditPoints(Block* block);
+
+  void RemoveBlockEditPoints(Block* block);
+
+  void RemoveEditPoint(const rational& point);
+
   TrackOutput* attached_track();
 
   void AttachTrack(TrackOutput *track);
@@ -65,18 +141,72 @@ private:
 
   TimelinePanel* attached_timeline_;
 
+  int edit_depth_;
+
+  /**
+   * @brief Tracks that were told to begin editing in BeginEdit(), tracks added during the edit aren't in here
+   */
+  QVector<QPointer<TrackOutput> > edit_tracks_;
+
+  /**
+   * @brief Union of every invalidation received during an edit, only valid if has_pending_invalidation_ is set
+   */
+  rational pending_invalidation_in_;
+  rational pending_invalidation_out_;
+
+  bool has_pending_invalidation_;
+
   NodeInput* track_input_;
 
   NodeOutput* length_output_;
 
+  NodeOutput* texture_output_;
+
   /**
    * @brief A cache of connected Tracks
    */
   QVector<TrackOutput*> track_cache_;
 
+  /**
+   * @brief The last length each attached track reported
+   */
+  QHash<TrackOutput*, rational> track_lengths_;
+
+  /**
+   * @brief How many attached tracks end at each point, so the longest is always the last key
+   *
+   * Updated as tracks report their lengths changing rather than asking every track when the length is needed.
+   */
+  std::map<rational, int> track_ends_;
+
+  rational length_;
+
+  /**
+   * @brief How many Block in and out points across all attached tracks fall on each point
+   *
+   * Updated as Blocks are added, removed and moved so tools and the playhead can find edit points without going
+   * through every Block.
+   */
+  std::map<rational, int> edit_points_;
+
+  /**
+   * @brief The in and out point each Block was indexed at in edit_points_
+   */
+  QHash<Block*, QPair<rational, rational> > block_edit_points_;
+
   rational timebase_;
 
 private slots:
+  /**
+   * @brief Begins an edit that may involve several tracks
+   *
+   * Until the matching EndEdit(), every track defers updating its Block list (see TrackOutput::BeginEdit()) and
+   * invalidations from all of them are merged. EndEdit() then sends the merged range on once, so an edit across many
+   * tracks reaches the renderer as one invalidation rather than one per track (and per Block). Edits can nest.
+   */
+  void BeginEdit();
+  void EndEdit();
+
   /**
    * @brief Slot for when the track connection is added
    */
@@ -97,6 +227,16 @@ private slots:
    */
   void TrackRemovedBlock(Block* block);
 
+  /**
+   * @brief Slot for when an attached Track's end moves, keeps the sequence length up to date
+   */
+  void TrackLengthChanged(const rational& length);
+
+  /**
+   * @brief Slot for when a Block on an attached Track moves, keeps edit_points_ up to date
+   */
+  void BlockRefreshed();
+
   /**
    * @brief Slot for when an attached Track has an edge added
    */
@@ -20,14 +20,20 @@
 
 #include "track.h"
 
-#include <QDebug>
+#include <algorithm>
+#include <climits>
+#include <QSet>
 
+#include "common/ringlog.h"
 #include "node/block/gap/gap.h"
 #include "node/graph.h"
 
 TrackOutput::TrackOutput() :
   current_block_(this),
-  block_invalidate_cache_stack_(0)
+  block_invalidate_cache_stack_(0),
+  block_edit_stack_(0),
+  block_cache_stale_(false),
+  dirty_index_(INT_MAX)
 {
   track_input_ = new NodeInput("track_in");
   track_input_->add_data_input(NodeParam::kTrack);
@@ -76,22 +82,73 @@ void TrackOutput::set_length(const rational &)
 }
 
 void TrackOutput::Refresh()
+{
+  // Our own edit functions keep block_cache_ up to date themselves, so there's nothing to check until they're done
+  if (block_edit_stack_ == 0) {
+    // Otherwise Blocks were changed from elsewhere (e.g. a Block's length or a loaded project). The chain usually
+    // still matches the cache and only the out points have moved, so only rescan if it doesn't.
+    if (!UpdateOutPointsFromChain()) {
+      RescanBlocks();
+    }
+  }
+
+  rational old_length = in();
+
+  Block::Refresh();
+
+  if (in() != old_length) {
+    emit LengthChanged(in());
+  }
+}
+
+bool TrackOutput::UpdateOutPointsFromChain()
+{
+  int index = block_cache_.size() - 1;
+
+  Block* previous = attached_block();
+
+  while (previous != nullptr) {
+    if (index < 0 || block_cache_.at(index) != previous) {
+      return false;
+    }
+
+    block_out_points_[index] = previous->out();
+
+    previous = previous->previous();
+    index--;
+  }
+
+  return (index < 0);
+}
+
+void TrackOutput::RescanBlocks()
 {
   QVector<Block*> detect_attached_blocks;
+  QSet<Block*> detect_attached_set;
 
+  QSet<Block*> cached_set;
+  cached_set.reserve(block_cache_.size());
+  foreach (Block* b, block_cache_) {
+    cached_set.insert(b);
+  }
+
+  // Walk back from the end of the track (collected in reverse, then flipped)
   Block* previous = attached_block();
   while (previous != nullptr) {
-    detect_attached_blocks.prepend(previous);
+    detect_attached_blocks.append(previous);
+    detect_attached_set.insert(previous);
 
-    if (!block_cache_.contains(previous)) {
+    if (!cached_set.contains(previous)) {
       emit BlockAdded(previous);
     }
 
     previous = previous->previous();
   }
 
+  std::reverse(detect_attached_blocks.begin(), detect_attached_blocks.end());
+
   foreach (Block* b, block_cache_) {
-    if (!detect_attached_blocks.contains(b)) {
+    if (!detect_attached_set.contains(b)) {
       // If the current block was removed, stop referencing it
       if (current_block_ == b) {
         current_block_ = this;
@@ -103,8 +160,117 @@ void TrackOutput::Refresh()
 
   block_cache_ = detect_attached_blocks;
 
-  Block::Refresh();
-  qDebug() << "Refreshed with in point" << in().toDouble() << "(from connected block" << previous << ")";
+  block_out_points_.resize(block_cache_.size());
+  for (int i=0;i<block_cache_.size();i++) {
+    block_out_points_[i] = block_cache_.at(i)->out();
+  }
+}
+
+void TrackOutput::BeginEdit()
+{
+  BeginBlockEdit();
+}
+
+void TrackOutput::EndEdit()
+{
+  EndBlockEdit();
+}
+
+void TrackOutput::BeginBlockEdit()
+{
+  block_edit_stack_++;
+}
+
+void TrackOutput::EndBlockEdit()
+{
+  block_edit_stack_--;
+
+  if (block_edit_stack_ > 0) {
+    return;
+  }
+
+  if (block_cache_stale_) {
+    RescanBlocks();
+
+    block_cache_stale_ = false;
+  } else {
+    // Every Block from the first one the edit touched onwards may have moved
+    for (int i=qMax(0, dirty_index_);i<block_cache_.size();i++) {
+      block_out_points_[i] = block_cache_.at(i)->out();
+    }
+  }
+
+  dirty_index_ = INT_MAX;
+}
+
+int TrackOutput::IndexOfBlock(Block *block) const
+{
+  if (block == this) {
+    return block_cache_.size();
+  }
+
+  // Blocks are sorted by time so the index can usually be found from its in point, unless it has no length
+  QVector<rational>::const_iterator it = std::upper_bound(block_out_points_.constBegin(),
+                                                          block_out_points_.constEnd(),
+                                                          block->in());
+
+  if (it != block_out_points_.constEnd()) {
+    int index = static_cast<int>(it - block_out_points_.constBegin());
+
+    if (block_cache_.at(index) == block) {
+      return index;
+    }
+  }
+
+  return block_cache_.indexOf(block);
+}
+
+void TrackOutput::MarkBlockDirty(Block *block)
+{
+  int index = IndexOfBlock(block);
+
+  if (index >= 0) {
+    dirty_index_ = qMin(dirty_index_, index);
+  }
+}
+
+void TrackOutput::CacheInsertBlock(Block *block, int index)
+{
+  if (index < 0 || block_cache_.contains(block)) {
+    // Moving a Block within the track or inserting relative to a Block we don't have isn't worth tracking
+    // incrementally, rescan once the edit is done
+    block_cache_stale_ = true;
+    return;
+  }
+
+  block_cache_.insert(index, block);
+  block_out_points_.insert(index, block->out());
+
+  dirty_index_ = qMin(dirty_index_, index);
+
+  emit BlockAdded(block);
+}
+
+void TrackOutput::CacheRemoveBlock(Block *block)
+{
+  int index = IndexOfBlock(block);
+
+  if (index < 0 || index == block_cache_.size()) {
+    block_cache_stale_ = true;
+    return;
+  }
+
+  block_cache_.remove(index);
+  block_out_points_.remove(index);
+
+  dirty_index_ = qMin(dirty_index_, index);
+
+  // If the current block was removed, stop referencing it
+  if (current_block_ == block) {
+    current_block_ = this;
+  }
+
+  emit BlockRemoved(block);
 }
 
 QList<NodeDependency> TrackOutput::RunDependencies(NodeOutput* output, const rational &time)
@@ -122,6 +288,33 @@ QList<NodeDependency> TrackOutput::RunDependencies(NodeOutput* output, const rat
   return deps;
 }
 
+void TrackOutput::StaticRange(NodeOutput *output, const rational &time, rational *in, rational *out)
+{
+  if (output != texture_output()) {
+    Node::StaticRange(output, time, in, out);
+    return;
+  }
+
+  InputsStaticRange(time, in, out);
+
+  ValidateCurrentBlock(time);
+
+  if (current_block_ == this) {
+    // Nothing is shown from the end of the track onwards
+    IntersectStaticRange(time, this->in(), RATIONAL_MAX, in, out);
+    return;
+  }
+
+  IntersectStaticRange(time, current_block_->in(), current_block_->out(), in, out);
+
+  if (*in != *out) {
+    rational block_in, block_out;
+    current_block_->StaticRange(current_block_->texture_output(), time, &block_in, &block_out);
+
+    IntersectStaticRange(time, block_in, block_out, in, out);
+  }
+}
+
 void TrackOutput::GenerateBlockWidgets()
 {
   foreach (Block* block, block_cache_) {
@@ -155,18 +348,18 @@ void TrackOutput::InvalidateCache(const rational &start_range, const rational &e
 {
   // We intercept IC signals from Blocks since we may be performing several options and they may over-signal
   if (block_invalidate_cache_stack_ == 0) {
-    qDebug() << "Received IC Signal:" << start_range.toDouble() << "to" << end_range.toDouble();
-    qDebug() << "Limiting IC Signal To:" << qMax(start_range, rational(0)).toDouble() << "to" << qMin(end_range, in()).toDouble();
+    OLIVE_LOG_DEBUG("Received IC Signal (start, end, limited start, limited end):",
+                    start_range, end_range, qMax(start_range, rational(0)), qMin(end_range, in()));
 
     Node::InvalidateCache(qMax(start_range, rational(0)), qMin(end_range, in()), from);
   }
 }
 
-QVariant TrackOutput::Value(NodeOutput *output, const rational &time)
+NodeValue TrackOutput::Value(NodeOutput *output, const rational &time)
 {
   if (output == track_output_) {
     // Set track output correctly
-    return PtrToValue(this);
+    return NodeValue::FromPtr(this);
   } else if (output == texture_output()) {
     ValidateCurrentBlock(time);
 
@@ -185,11 +378,19 @@ QVariant TrackOutput::Value(NodeOutput *output, const rational &time)
 
 void TrackOutput::InsertBlockBetweenBlocks(Block *block, Block *before, Block *after)
 {
+  BeginBlockEdit();
+
+  int index = IndexOfBlock(after);
+
   AddBlockToGraph(block);
 
   Block::DisconnectBlocks(before, after);
   Block::ConnectBlocks(before, block);
   Block::ConnectBlocks(block, after);
+
+  CacheInsertBlock(block, index);
+
+  EndBlockEdit();
 }
 
 void TrackOutput::InsertBlockBefore(Block* block, Block* after)
@@ -200,10 +401,18 @@ void TrackOutput::InsertBlockBefore(Block* block, Block* after)
   if (before != nullptr) {
     InsertBlockBetweenBlocks(block, before, after);
   } else {
+    BeginBlockEdit();
+
+    int index = IndexOfBlock(after);
+
     AddBlockToGraph(block);
 
     // Otherwise, just connect the block since there's no before clip to insert between
     Block::ConnectBlocks(block, after);
+
+    CacheInsertBlock(block, index);
+
+    EndBlockEdit();
   }
 }
 
@@ -224,7 +433,13 @@ void TrackOutput::PrependBlock(Block *block)
   if (block_cache_.isEmpty()) {
     ConnectBlockInternal(block);
   } else {
+    BeginBlockEdit();
+
     Block::ConnectBlocks(block, block_cache_.first());
+
+    CacheInsertBlock(block, 0);
+
+    EndBlockEdit();
   }
 }
 
@@ -275,9 +490,15 @@ void TrackOutput::AppendBlock(Block *block)
 
 void TrackOutput::ConnectBlockInternal(Block *block)
 {
+  BeginBlockEdit();
+
   AddBlockToGraph(block);
 
   Block::ConnectBlocks(block, this);
+
+  CacheInsertBlock(block, 0);
+
+  EndBlockEdit();
 }
 
 void TrackOutput::AddBlockToGraph(Block *block)
@@ -295,17 +516,40 @@ void TrackOutput::ValidateCurrentBlock(const rational &time)
     return;
   }
 
-  // If we're here, we need to find the current clip to display
+  // During playback the time is usually still within the last Block found
+  if (current_block_ != this && time >= current_block_->in() && time < current_block_->out()) {
+    return;
+  }
+
+  // Otherwise, binary search for it
+  Block* block = BlockAtTime(time);
 
-  // If the time requested is an earlier Block, traverse earlier until we find it
-  while (time < current_block_->in()) {
-    current_block_ = current_block_->previous();
+  current_block_ = (block != nullptr) ? block : this;
+}
+
+Block *TrackOutput::BlockAtTime(const rational &time) const
+{
+  if (time < 0) {
+    return nullptr;
   }
 
-  // If the time requested is in a later Block, traverse later
-  while (time >= current_block_->out()) {
-    current_block_ = current_block_->next();
+  // Find the first Block that ends after this time
+  QVector<rational>::const_iterator it = std::upper_bound(block_out_points_.constBegin(),
+                                                          block_out_points_.constEnd(),
+                                                          time);
+
+  if (it == block_out_points_.constEnd()) {
+    return nullptr;
   }
+
+  return block_cache_.at(static_cast<int>(it - block_out_points_.constBegin()));
+}
+
+bool TrackOutput::HasClipAtTime(const rational &time) const
+{
+  Block* block = BlockAtTime(time);
+
+  return (block != nullptr && block->type() == kClip);
 }
 
 void TrackOutput::BlockInvalidateCache()
@@ -324,6 +568,8 @@ void TrackOutput::PlaceBlock(Block *block, rational start)
     return;
   }
 
+  BeginBlockEdit();
+
   AddBlockToGraph(block);
 
   // Check if the placement location is past the end of the timeline
@@ -336,11 +582,12 @@ void TrackOutput::PlaceBlock(Block *block, rational start)
     }
 
     AppendBlock(block);
-    return;
+  } else {
+    // Place the Block at this point
+    RippleRemoveArea(start, start + block->length(), block);
   }
 
-  // Place the Block at this point
-  RippleRemoveArea(start, start + block->length(), block);
+  EndBlockEdit();
 }
 
 void TrackOutput::RemoveBlock(Block *block)
@@ -351,6 +598,8 @@ void TrackOutput::RemoveBlock(Block *block)
   Block* previous = block->previous();
   Block* next = block->next();
 
+  BeginBlockEdit();
+
   // Remove block
   RippleRemoveBlock(block);
 
@@ -360,17 +609,23 @@ void TrackOutput::RemoveBlock(Block *block)
   } else {
     InsertBlockBetweenBlocks(gap, previous, next);
   }
+
+  EndBlockEdit();
 }
 
 void TrackOutput::RippleRemoveBlock(Block *block)
 {
   BlockInvalidateCache();
+  BeginBlockEdit();
 
   rational remove_in = block->in();
 
   Block* previous = block->previous();
   Block* next = block->next();
 
+  // Done before disconnecting while the Block's in point can still be used to find it
+  CacheRemoveBlock(block);
+
   if (previous != nullptr) {
     Block::DisconnectBlocks(previous, block);
   }
@@ -383,6 +638,7 @@ void TrackOutput::RippleRemoveBlock(Block *block)
     Block::ConnectBlocks(previous, next);
   }
 
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   InvalidateCache(remove_in, in());
@@ -397,6 +653,9 @@ Block* TrackOutput::SplitBlock(Block *block, rational time)
   }
 
   BlockInvalidateCache();
+  BeginBlockEdit();
+
+  MarkBlockDirty(block);
 
   rational original_length = block->length();
 
@@ -410,6 +669,7 @@ Block* TrackOutput::SplitBlock(Block *block, rational time)
 
   Node::CopyInputs(block, copy);
 
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   return copy;
@@ -418,17 +678,11 @@ Block* TrackOutput::SplitBlock(Block *block, rational time)
 void TrackOutput::SplitAtTime(rational time)
 {
   // Find Block that contains this time
-  for (int i=0;i<block_cache_.size();i++) {
-    Block* b = block_cache_.at(i);
-
-    if (b->out() == time) {
-      // This time is between blocks, no split needs to occur
-      return;
-    } else if (b->in() < time && b->out() > time) {
-      // We found the Block, split it
-      SplitBlock(b, time);
-      return;
-    }
+  Block* b = BlockAtTime(time);
+
+  // If this time is between blocks, no split needs to occur
+  if (b != nullptr && b->in() < time) {
+    SplitBlock(b, time);
   }
 }
 
@@ -467,6 +721,18 @@ void TrackOutput::RippleRemoveArea(rational in, rational out, Block *insert)
   }
 
   BlockInvalidateCache();
+  BeginBlockEdit();
+
+  // Every Block after the area moves, and the ones either side of it are trimmed
+  if (splice != nullptr) {
+    MarkBlockDirty(splice);
+  } else if (trim_out_to_in != nullptr) {
+    MarkBlockDirty(trim_out_to_in);
+  } else if (!remove.isEmpty()) {
+    MarkBlockDirty(remove.first());
+  } else if (trim_in_to_out != nullptr) {
+    MarkBlockDirty(trim_in_to_out);
+  }
 
   // If we picked up a block to splice
   if (splice != nullptr) {
@@ -515,6 +781,7 @@ void TrackOutput::RippleRemoveArea(rational in, rational out, Block *insert)
     }
   }
 
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   InvalidateCache(in, out);
@@ -528,6 +795,9 @@ void TrackOutput::ReplaceBlock(Block *old, Block *replace)
   Block* next = old->next();
 
   BlockInvalidateCache();
+  BeginBlockEdit();
+
+  int index = IndexOfBlock(old);
 
   AddBlockToGraph(replace);
 
@@ -542,6 +812,10 @@ void TrackOutput::ReplaceBlock(Block *old, Block *replace)
     Block::ConnectBlocks(replace, next);
   }
 
+  CacheRemoveBlock(old);
+  CacheInsertBlock(replace, index);
+
+  EndBlockEdit();
   UnblockInvalidateCache();
 
   InvalidateCache(replace->in(), replace->out());
@@ -51,6 +51,11 @@ public:
    */
   virtual QList<NodeDependency> RunDependencies(NodeOutput* param, const rational& time) override;
 
+  /**
+   * @brief Override limits the range to the Block at `time`, see Node::StaticRange()
+   */
+  virtual void StaticRange(NodeOutput* output, const rational& time, rational* in, rational* out) override;
+
   void GenerateBlockWidgets();
 
   void DestroyBlockWidgets();
@@ -63,6 +68,16 @@ public:
 
   virtual void InvalidateCache(const rational& start_range, const rational& end_range, NodeInput* from = nullptr) override;
 
+  /**
+   * @brief Returns the Block showing at `time`, or nullptr if `time` is outside the track (O(log n))
+   */
+  Block* BlockAtTime(const rational& time) const;
+
+  /**
+   * @brief Returns TRUE if a clip (rather than a gap or nothing) is showing at `time`
+   */
+  bool HasClipAtTime(const rational& time) const;
+
   /**
    * @brief Adds Block `block` at the very beginning of the Sequence before all other clips
    */
@@ -151,6 +166,14 @@ public:
    */
   void ReplaceBlock(Block* old, Block* replace);
 
+  /**
+   * @brief Groups several of the edits above so the Block list's out points are only updated once, at EndEdit()
+   *
+   * Edits can nest. See TimelineOutput::BeginEdit() for grouping edits across tracks.
+   */
+  void BeginEdit();
+  void EndEdit();
+
 signals:
   /**
    * @brief Signal emitted when a Block is added to this Track
@@ -162,8 +185,13 @@ signals:
    */
   void BlockRemoved(Block* block);
 
+  /**
+   * @brief Signal emitted when the end of this Track (its in point) moves
+   */
+  void LengthChanged(const rational& length);
+
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
 private:
   /**
@@ -185,16 +213,66 @@ private:
 
   /**
    * @brief Sets current_block_ to the correct attached Block based on `time`
+   *
+   * O(log n) in the number of Blocks, or O(1) if `time` is still in current_block_.
    */
   void ValidateCurrentBlock(const rational& time);
 
   void BlockInvalidateCache();
   void UnblockInvalidateCache();
 
+  /**
+   * @brief Brackets an edit that keeps block_cache_ up to date itself, rather than Refresh() checking it every time an
+   * edge changes
+   *
+   * Edits can nest, the out points from the first Block that changed are updated once the outermost one ends.
+   */
+  void BeginBlockEdit();
+  void EndBlockEdit();
+
+  /**
+   * @brief Updates block_out_points_ walking back from the end of the track
+   *
+   * @return
+   *
+   * FALSE if the Blocks connected no longer match block_cache_, in which case RescanBlocks() is needed
+   */
+  bool UpdateOutPointsFromChain();
+
+  /**
+   * @brief Rebuilds block_cache_ from the Blocks connected, emitting BlockAdded() and BlockRemoved() for the difference
+   */
+  void RescanBlocks();
+
+  /**
+   * @brief Returns the index of `block` in block_cache_, block_cache_.size() for this track, or -1 if it isn't there
+   */
+  int IndexOfBlock(Block* block) const;
+
+  /**
+   * @brief Marks `block` and everything after it as moved so their out points are updated when the edit ends
+   */
+  void MarkBlockDirty(Block* block);
+
+  /**
+   * @brief Adds `block` to block_cache_ at `index` during an edit and emits BlockAdded()
+   */
+  void CacheInsertBlock(Block* block, int index);
+
+  /**
+   * @brief Removes `block` from block_cache_ during an edit and emits BlockRemoved()
+   */
+  void CacheRemoveBlock(Block* block);
+
   Block* attached_block();
 
   QVector<Block*> block_cache_;
 
+  /**
+   * @brief The out point of each Block in block_cache_ (sorted since Blocks are sequential), used for binary searching
+   */
+  QVector<rational> block_out_points_;
+
   Block* current_block_;
 
   NodeInput* track_input_;
@@ -203,6 +281,18 @@ private:
 
   int block_invalidate_cache_stack_;
 
+  int block_edit_stack_;
+
+  /**
+   * @brief Set if an edit couldn't keep block_cache_ up to date, it's rescanned once the edit ends
+   */
+  bool block_cache_stale_;
+
+  /**
+   * @brief Index of the first Block in block_cache_ that the current edit moved
+   */
+  int dirty_index_;
+
 private slots:
 
 };
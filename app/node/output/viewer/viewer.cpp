@@ -20,8 +20,16 @@
 
 #include "viewer.h"
 
+#include "config/config.h"
+#include "decoder/decoderpool.h"
+#include "node/block/clip/clip.h"
+#include "node/input/media/media.h"
+#include "node/output/timeline/timeline.h"
+#include "node/processor/renderer/renderer.h"
+
 ViewerOutput::ViewerOutput() :
-  attached_viewer_(nullptr)
+  attached_viewer_(nullptr),
+  sample_rate_(kDefaultSampleRate)
 {
   texture_input_ = new NodeInput("tex_out");
   texture_input_->add_data_input(NodeInput::kTexture);
@@ -57,6 +65,11 @@ void ViewerOutput::SetTimebase(const rational &timebase)
   }
 }
 
+void ViewerOutput::SetSampleRate(int sample_rate)
+{
+  sample_rate_ = sample_rate;
+}
+
 NodeInput *ViewerOutput::texture_input()
 {
   return texture_input_;
@@ -67,9 +80,18 @@ void ViewerOutput::AttachViewer(ViewerPanel *viewer)
   // Disconnect old viewer if there's one attached
   if (attached_viewer_ != nullptr) {
     disconnect(attached_viewer_, SIGNAL(TimeChanged(const rational&)), this, SLOT(ViewerTimeChanged(const rational&)));
+    disconnect(attached_viewer_, SIGNAL(PlaybackSpeedChanged(int)), this, SLOT(ViewerPlaybackSpeedChanged(int)));
+    disconnect(attached_viewer_,
+               SIGNAL(DisplaySizeChanged(const QSize&)),
+               this,
+               SLOT(ViewerDisplaySizeChanged(const QSize&)));
+
+    // The old viewer can't be playing us anymore
+    ViewerPlaybackSpeedChanged(0);
 
     // Clear any existing texture
-    attached_viewer_->SetTexture(0);
+    attached_viewer_->SetTexture(nullptr);
+    attached_viewer_->SetCacheRanges(FrameRangeSet(), FrameRangeSet());
   }
 
   // FIXME: Currently this attaches to ViewerPanels, but should it attached to Viewers instead?
@@ -77,8 +99,23 @@ void ViewerOutput::AttachViewer(ViewerPanel *viewer)
 
   if (attached_viewer_ != nullptr) {
     connect(attached_viewer_, SIGNAL(TimeChanged(const rational&)), this, SLOT(ViewerTimeChanged(const rational&)));
+    connect(attached_viewer_, SIGNAL(PlaybackSpeedChanged(int)), this, SLOT(ViewerPlaybackSpeedChanged(int)));
+    connect(attached_viewer_,
+            SIGNAL(DisplaySizeChanged(const QSize&)),
+            this,
+            SLOT(ViewerDisplaySizeChanged(const QSize&)));
     SetTimebase(timebase_);
 
+    // Render at the size this viewer shows frames at
+    ViewerDisplaySizeChanged(attached_viewer_->GetDisplaySize());
+
+    RendererProcessor* renderer = GetRenderer();
+
+    if (renderer != nullptr) {
+      connect(renderer, SIGNAL(CacheRangesChanged()), this, SLOT(RendererCacheRangesChanged()), Qt::UniqueConnection);
+      RendererCacheRangesChanged();
+    }
+
     // Update the texture
     ViewerTimeChanged(attached_viewer_->GetTime());
   }
@@ -102,7 +139,7 @@ void ViewerOutput::ForceUpdateViewer()
   ViewerTimeChanged(attached_viewer_->GetTime());
 }
 
-QVariant ViewerOutput::Value(NodeOutput *output, const rational &time)
+NodeValue ViewerOutput::Value(NodeOutput *output, const rational &time)
 {
   Q_UNUSED(output)
   Q_UNUSED(time)
@@ -112,13 +149,142 @@ QVariant ViewerOutput::Value(NodeOutput *output, const rational &time)
 
 void ViewerOutput::ViewerTimeChanged(const rational &t)
 {
+  PrepareDecoders(t);
+
   // Get the texture from whatever Node is currently connected (usually a Renderer of some kind)
-  RenderTexturePtr current_texture = texture_input_->get_value(t).value<RenderTexturePtr>();
+  NodeValue value = texture_input_->get_value(t);
+
+  if (texture_input_->IsConnected() && value.type() == NodeValue::kNone) {
+    // The frame is still being prepared and will be sent through InvalidateCache() once it's ready, keep showing the
+    // current one until then
+    return;
+  }
+
+  // Send the texture to the Viewer (the viewer holds on to it so it isn't reused while on screen)
+  attached_viewer_->SetTexture(value.takeTexture());
+}
+
+TimelineOutput *ViewerOutput::GetTimeline()
+{
+  foreach (Node* dep, GetDependencies()) {
+    TimelineOutput* timeline = dynamic_cast<TimelineOutput*>(dep);
+
+    if (timeline != nullptr) {
+      return timeline;
+    }
+  }
+
+  return nullptr;
+}
+
+RendererProcessor *ViewerOutput::GetRenderer()
+{
+  foreach (Node* dep, GetDependencies()) {
+    RendererProcessor* renderer = dynamic_cast<RendererProcessor*>(dep);
+
+    if (renderer != nullptr) {
+      return renderer;
+    }
+  }
+
+  return nullptr;
+}
+
+void ViewerOutput::PrepareDecoders(const rational &time)
+{
+  TimelineOutput* timeline = GetTimeline();
+
+  if (timeline == nullptr) {
+    return;
+  }
+
+  rational end = time + kDecoderOpenLookahead;
+
+  foreach (TrackOutput* track, timeline->tracks()) {
+    Block* block = track->BlockAtTime(time);
 
-  // Send the texture to the Viewer
-  if (current_texture != nullptr) {
-    attached_viewer_->SetTexture(current_texture->texture());
+    while (block != nullptr && block->in() < end) {
+      if (block->type() == Block::kClip) {
+        ClipBlock* clip = static_cast<ClipBlock*>(block);
+
+        // Where the clip will first be retrieved from
+        rational media_time = qMax(time, clip->in()) - clip->in() + clip->media_in();
+
+        // Clips that haven't started yet also get a decoder sitting on their first frame, even if their footage is
+        // already open elsewhere, so the cut itself doesn't have to wait on a seek
+        bool upcoming = (clip->in() > time);
+
+        foreach (Node* dep, clip->GetDependencies()) {
+          MediaInput* media = dynamic_cast<MediaInput*>(dep);
+
+          if (media != nullptr) {
+            olive::decoder_pool.Prepare(media->GetStream(), media_time, upcoming);
+          }
+        }
+      }
+
+      block = block->next();
+    }
+  }
+}
+
+void ViewerOutput::ViewerPlaybackSpeedChanged(int speed)
+{
+  QList<Node*> dependencies = GetDependencies();
+  TimelineOutput* timeline = nullptr;
+
+  foreach (Node* dep, dependencies) {
+    RendererProcessor* renderer = dynamic_cast<RendererProcessor*>(dep);
+
+    if (renderer != nullptr) {
+      renderer->SetPlaybackSpeed(speed);
+    }
+
+    if (timeline == nullptr) {
+      timeline = dynamic_cast<TimelineOutput*>(dep);
+    }
+  }
+
+  // Forward playback is heard up to a few times normal speed, anything else is silent
+  if (AudioEngine::IsAudibleSpeed(speed) && timeline != nullptr && attached_viewer_ != nullptr) {
+    // Clips are decoded live until their audio has been conformed
+    AudioEngine::ConformStreams(timeline, sample_rate_);
+
+    audio_engine_.Start(timeline, attached_viewer_->GetTime(), sample_rate_, speed);
+    attached_viewer_->SetAudioSource(&audio_engine_);
   } else {
-    attached_viewer_->SetTexture(0);
+    if (attached_viewer_ != nullptr) {
+      attached_viewer_->SetAudioSource(nullptr);
+    }
+
+    audio_engine_.Stop();
+  }
+}
+
+void ViewerOutput::ViewerDisplaySizeChanged(const QSize &size)
+{
+  QList<Node*> dependencies = GetDependencies();
+  bool divider_changed = false;
+
+  foreach (Node* dep, dependencies) {
+    RendererProcessor* renderer = dynamic_cast<RendererProcessor*>(dep);
+
+    if (renderer != nullptr && renderer->SetDisplaySize(size)) {
+      divider_changed = true;
+    }
+  }
+
+  // Frames at the old divider belong to a different cache, so request the current one again
+  if (divider_changed && attached_viewer_ != nullptr) {
+    ForceUpdateViewer();
+  }
+}
+
+void ViewerOutput::RendererCacheRangesChanged()
+{
+  RendererProcessor* renderer = GetRenderer();
+
+  if (attached_viewer_ != nullptr && renderer != nullptr) {
+    attached_viewer_->SetCacheRanges(renderer->cached_ranges(), renderer->dirty_ranges());
   }
 }
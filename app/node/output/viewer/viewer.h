@@ -21,10 +21,14 @@
 #ifndef VIEWER_H
 #define VIEWER_H
 
+#include "audio/audioengine.h"
 #include "node/node.h"
 #include "panel/viewer/viewer.h"
 #include "render/rendertexture.h"
 
+class RendererProcessor;
+class TimelineOutput;
+
 /**
  * @brief A bridge between a node system and a ViewerPanel
  *
@@ -43,6 +47,11 @@ public:
 
   void SetTimebase(const rational& timebase);
 
+  /**
+   * @brief Set the sample rate the sequence's audio is mixed at during playback
+   */
+  void SetSampleRate(int sample_rate);
+
   NodeInput* texture_input();
 
   void AttachViewer(ViewerPanel* viewer);
@@ -50,20 +59,59 @@ public:
   virtual void InvalidateCache(const rational &start_range, const rational &end_range, NodeInput *from = nullptr) override;
 
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
 private:
   void ForceUpdateViewer();
 
+  /**
+   * @brief Returns the timeline this viewer shows, or nullptr if it isn't showing one
+   */
+  TimelineOutput* GetTimeline();
+
+  /**
+   * @brief Returns the renderer this viewer shows, or nullptr if it isn't showing one
+   */
+  RendererProcessor* GetRenderer();
+
+  /**
+   * @brief Open the decoders of clips within kDecoderOpenLookahead seconds of `time` in the background
+   *
+   * Keeps opening files off the render threads, which would otherwise stall on it the first time they reach a clip.
+   */
+  void PrepareDecoders(const rational& time);
+
   NodeInput* texture_input_;
 
   ViewerPanel* attached_viewer_;
 
   rational timebase_;
 
+  int sample_rate_;
+
+  /**
+   * @brief Plays the timeline's audio while the attached viewer is playing, and is the viewer's clock while it does
+   */
+  AudioEngine audio_engine_;
+
 private slots:
   void ViewerTimeChanged(const rational& t);
 
+  /**
+   * @brief Pass the attached viewer's playback speed on to any renderers this node depends on, and start or stop audio
+   */
+  void ViewerPlaybackSpeedChanged(int speed);
+
+  /**
+   * @brief Pass the attached viewer's display size on to any renderers this node depends on
+   */
+  void ViewerDisplaySizeChanged(const QSize& size);
+
+  /**
+   * @brief Pass the renderer's cached and invalidated frames on to the attached viewer's render bar
+   */
+  void RendererCacheRangesChanged();
+
 };
 
 #endif // VIEWER_H
@@ -27,13 +27,18 @@
 #include <QVector3D>
 #include <QVector4D>
 
+#include "config/config.h"
 #include "node/node.h"
 #include "node/input.h"
 #include "node/output.h"
+#include "project/item/footage/footage.h"
 
 NodeParam::NodeParam(const QString &id) :
-  time_(-1),
   value_caching_(true),
+  cache_next_(0),
+  cache_generation_(0),
+  time_(-1),
+  time_generation_(-1),
   id_(id)
 {
   Q_ASSERT(!id_.isEmpty());
@@ -167,6 +172,8 @@ NodeEdgePtr NodeParam::ConnectEdge(NodeOutput *output, NodeInput *input)
 
   input->ClearCachedValue();
 
+  Node::TopologyChanged();
+
   output->parent()->Unlock();
   input->parent()->Unlock();
 
@@ -189,6 +196,8 @@ void NodeParam::DisconnectEdge(NodeEdgePtr edge)
 
   input->ClearCachedValue();
 
+  Node::TopologyChanged();
+
   output->parent()->Unlock();
   input->parent()->Unlock();
 
@@ -246,22 +255,28 @@ QString NodeParam::GetDefaultDataTypeName(const DataType& type)
   return QString();
 }
 
-QByteArray NodeParam::ValueToBytes(const NodeParam::DataType &type, const QVariant &value)
+QByteArray NodeParam::ValueToBytes(const NodeParam::DataType &type, const NodeValue &value)
 {
   switch (type) {
-  case kInt: return ValueToBytesInternal<int>(value);
-  case kFloat: return ValueToBytesInternal<float>(value);
-  case kColor: return ValueToBytesInternal<QColor>(value);
-  case kString: return ValueToBytesInternal<QString>(value);
-  case kBoolean: return ValueToBytesInternal<bool>(value);
-  case kFont: return ValueToBytesInternal<QString>(value); // FIXME: This should probably be a QFont?
-  case kFile: return ValueToBytesInternal<QString>(value);
-  case kMatrix: return ValueToBytesInternal<QMatrix4x4>(value);
-  case kFootage: return ValueToBytesInternal<float>(value); // FIXME: Unsustainble, find some other way to match Footage
-  case kRational: return ValueToBytesInternal<rational>(value);
-  case kVec2: return ValueToBytesInternal<QVector2D>(value);
-  case kVec3: return ValueToBytesInternal<QVector3D>(value);
-  case kVec4: return ValueToBytesInternal<QVector4D>(value);
+  case kInt: return ValueToBytesInternal<int>(value.toInt());
+  case kFloat: return ValueToBytesInternal<float>(value.toFloat());
+  case kColor: return ValueToBytesInternal<QColor>(value.toColor());
+  case kString: return ValueToBytesInternal<QString>(value.toString());
+  case kBoolean: return ValueToBytesInternal<bool>(value.toBool());
+  case kFont: return ValueToBytesInternal<QString>(value.toString()); // FIXME: This should probably be a QFont?
+  case kFile: return ValueToBytesInternal<QString>(value.toString());
+  case kMatrix: return ValueToBytesInternal<QMatrix4x4>(value.toMatrix());
+  case kFootage:
+  {
+    // Hashed by file rather than address so frames are found again in later sessions (and on other machines)
+    Footage* footage = value.toPtr<Footage>();
+
+    return (footage != nullptr) ? footage->unique_identifier().toUtf8() : QByteArray();
+  }
+  case kRational: return ValueToBytesInternal<rational>(value.toRational());
+  case kVec2: return ValueToBytesInternal<QVector2D>(value.toVec2());
+  case kVec3: return ValueToBytesInternal<QVector3D>(value.toVec3());
+  case kVec4: return ValueToBytesInternal<QVector4D>(value.toVec4());
 
   // These types have no persistent input
   case kNone:
@@ -275,18 +290,123 @@ QByteArray NodeParam::ValueToBytes(const NodeParam::DataType &type, const QVaria
   return QByteArray();
 }
 
+NodeValue NodeParam::VariantToValue(const NodeParam::DataType &type, const QVariant &value)
+{
+  if (value.isNull()) {
+    return NodeValue();
+  }
+
+  switch (type) {
+  case kInt: return NodeValue(value.toInt());
+  case kFloat: return NodeValue(value.toDouble());
+  case kColor: return NodeValue(value.value<QColor>());
+  case kString:
+  case kFont:
+  case kFile:
+    return NodeValue(value.toString());
+  case kBoolean: return NodeValue(value.toBool());
+  case kMatrix: return NodeValue(value.value<QMatrix4x4>());
+  case kRational: return NodeValue(value.value<rational>());
+  case kVec2: return NodeValue(value.value<QVector2D>());
+  case kVec3: return NodeValue(value.value<QVector3D>());
+  case kVec4: return NodeValue(value.value<QVector4D>());
+  case kTexture: return NodeValue(value.value<RenderTexturePtr>());
+  case kBlock:
+  case kFootage:
+  case kTrack:
+    return NodeValue::FromPtr(reinterpret_cast<void*>(value.value<quintptr>()));
+  case kNone:
+  case kAny:
+    break;
+  }
+
+  return NodeValue();
+}
+
 void NodeParam::ClearCachedValue()
 {
-  // Since get_value() will (read: should) never receive a negative number, this will effectively invalidate any value
-  // currently cached
-  time_ = -1;
+  // This only touches an atomic so it never has to wait for a render thread that's using the cached value
+  cache_generation_.fetchAndAddOrdered(1);
 }
 
-const rational &NodeParam::LastRequestedTime()
+rational NodeParam::LastRequestedTime()
 {
+  if (time_generation_ != cache_generation_.loadAcquire()) {
+    return -1;
+  }
+
   return time_;
 }
 
+int NodeParam::CacheGeneration()
+{
+  return cache_generation_.loadAcquire();
+}
+
+bool NodeParam::GetCachedValue(const rational &time, NodeValue *value)
+{
+  int generation = cache_generation_.loadAcquire();
+
+  if (!value_caching_) {
+    return false;
+  }
+
+  for (int i=0;i<cache_.size();i++) {
+    const CacheEntry& entry = cache_.at(i);
+
+    if (entry.generation == generation
+        && (time == entry.in || (time >= entry.in && time < entry.out))) {
+      *value = entry.value;
+
+      time_ = time;
+      time_generation_ = generation;
+
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void NodeParam::InsertCachedValue(const rational &time, const rational &in, const rational &out, int generation,
+                                  const NodeValue &value)
+{
+  time_ = time;
+  time_generation_ = generation;
+
+  if (!value_caching_) {
+    return;
+  }
+
+  // Drop entries that have been invalidated so they don't hold on to anything (e.g. textures) longer than needed, and
+  // any that this value supersedes
+  int current_generation = cache_generation_.loadAcquire();
+
+  for (int i=0;i<cache_.size();i++) {
+    const CacheEntry& existing = cache_.at(i);
+
+    if (existing.generation != current_generation
+        || time == existing.in
+        || (time >= existing.in && time < existing.out)) {
+      cache_.removeAt(i);
+      i--;
+    }
+  }
+
+  if (cache_next_ >= cache_.size()) {
+    cache_next_ = 0;
+  }
+
+  CacheEntry entry = {in, out, generation, value};
+
+  if (cache_.size() < kParamCacheSize) {
+    cache_.append(entry);
+  } else {
+    cache_[cache_next_] = entry;
+    cache_next_ = (cache_next_ + 1) % kParamCacheSize;
+  }
+}
+
 bool NodeParam::ValueCachingEnabled()
 {
   return value_caching_;
@@ -298,15 +418,14 @@ void NodeParam::SetValueCachingEnabled(bool enabled)
 }
 
 template<typename T>
-QByteArray NodeParam::ValueToBytesInternal(const QVariant &v)
+QByteArray NodeParam::ValueToBytesInternal(const T &v)
 {
   QByteArray bytes;
 
   int size_of_type = sizeof(T);
 
   bytes.resize(size_of_type);
-  T raw_val = v.value<T>();
-  memcpy(bytes.data(), &raw_val, static_cast<size_t>(size_of_type));
+  memcpy(bytes.data(), &v, static_cast<size_t>(size_of_type));
 
   return bytes;
 }
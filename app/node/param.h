@@ -21,6 +21,7 @@
 #ifndef NODEPARAM_H
 #define NODEPARAM_H
 
+#include <QAtomicInt>
 #include <QMutex>
 #include <QObject>
 #include <QVariant>
@@ -28,6 +29,7 @@
 
 #include "common/rational.h"
 #include "node/edge.h"
+#include "node/value.h"
 
 class Node;
 
@@ -243,17 +245,26 @@ public:
   /**
    * @brief Convert a value from a NodeParam into bytes
    */
-  static QByteArray ValueToBytes(const DataType &type, const QVariant& value);
+  static QByteArray ValueToBytes(const DataType &type, const NodeValue& value);
+
+  /**
+   * @brief Convert a QVariant (e.g. from a NodeKeyframe or the UI) to a value of the given data type
+   */
+  static NodeValue VariantToValue(const DataType &type, const QVariant& value);
 
   /**
    * @brief Clear the cached value
+   *
+   * Safe to call from any thread (e.g. the main thread while a render thread is using the value).
    */
   void ClearCachedValue();
 
   /**
    * @brief Retrieve the last time this parameter had a value requested from
+   *
+   * Returns -1 if the cached value has been cleared since.
    */
-  const rational& LastRequestedTime();
+  rational LastRequestedTime();
 
   bool ValueCachingEnabled();
   void SetValueCachingEnabled(bool enabled);
@@ -284,26 +295,79 @@ protected:
   QVector<NodeEdgePtr> edges_;
 
   /**
-   * @brief Currently cached value
+   * @brief Returns the current cache generation, read this before computing a value to be cached
+   *
+   * Reading it first means a ClearCachedValue() during the computation makes the value stale instead of being lost.
    */
-  QVariant value_;
+  int CacheGeneration();
 
   /**
-   * @brief Last timecode that a value was requested with
+   * @brief Look up a cached value that covers `time`
+   *
+   * Records `time` as the last requested time. Returns false if no entry from the current generation covers it (or
+   * value caching is disabled).
    */
-  rational time_;
+  bool GetCachedValue(const rational& time, NodeValue* value);
 
+  /**
+   * @brief Cache a value that was requested at `time` and is constant between `in` and `out`
+   *
+   * The range is half-open ([in, out)), except that an entry with `in == out` covers that time exactly. The least
+   * recently inserted entry is replaced once the cache is full.
+   *
+   * @param generation
+   *
+   * The CacheGeneration() from before the value was computed.
+   */
+  void InsertCachedValue(const rational& time, const rational& in, const rational& out, int generation,
+                         const NodeValue& value);
+
+  /**
+   * @brief Internal value for whether value caching is enabled
   /**
    * @brief Internal value for whether value caching is enabled
    */
   bool value_caching_;
 
 private:
+  /**
+   * @brief A cached value and the range of time it's valid for
+   */
+  struct CacheEntry {
+    rational in;
+    rational out;
+    int generation;
+    NodeValue value;
+  };
+
+  /**
+   * @brief Small set of cached values, so render threads requesting different times don't evict each other's
+   *
+   * Only accessed by whichever thread is retrieving values (with the Node locked).
+   */
+  QVector<CacheEntry> cache_;
+
+  /**
+   * @brief Index of the entry in cache_ to be replaced next
+   */
+  int cache_next_;
+
+  /**
+   * @brief Incremented atomically by ClearCachedValue(), entries from older generations are stale
+   */
+  QAtomicInt cache_generation_;
+
+  /**
+   * @brief Last timecode that a value was requested with and the generation it was requested in
+   */
+  rational time_;
+  int time_generation_;
+
   /**
    * @brief Internal function for returning a value in the form of bytes
    */
   template<typename T>
-  static QByteArray ValueToBytesInternal(const QVariant& v);
+  static QByteArray ValueToBytesInternal(const T& v);
 
   /**
    * @brief Internal name string
@@ -20,23 +20,153 @@
 
 #include "renderer.h"
 
-#include <OpenImageIO/imageio.h>
 #include <QApplication>
 #include <QCryptographicHash>
-#include <QDateTime>
 #include <QDebug>
 #include <QDir>
+#include <QFileInfo>
+#include <QRunnable>
 #include <QtMath>
 
 #include "common/filefunctions.h"
+#include "common/ringlog.h"
+#include "common/threadaffinity.h"
+#include "config/config.h"
+#include "config/performanceprofile.h"
+#include "node/interactiveedit.h"
+#include "render/cachepack.h"
+#include "render/diskcachemanager.h"
+#include "render/gl/blockcompressor.h"
+#include "render/imagecache.h"
 #include "render/pixelservice.h"
+#include "render/profiler.h"
+#include "render/renderstats.h"
+#include "render/vrammonitor.h"
+#include "renderercachecodec.h"
+
+/**
+ * @brief Reads a frame from the disk cache into the memory cache so the upload thread finds it there
+ */
+class RendererProcessor::DiskReader : public QRunnable
+{
+public:
+  DiskReader(RendererProcessor* parent, const QByteArray& hash, const QString& filename) :
+    parent_(parent),
+    hash_(hash),
+    filename_(filename)
+  {
+  }
+
+  virtual void run() override
+  {
+    QByteArray frame;
+
+    if (!parent_->memory_cache_.Contains(hash_)
+        && RendererCacheCodec::Read(filename_,
+                                    parent_->cache_format_,
+                                    parent_->effective_width_,
+                                    parent_->effective_height_,
+                                    parent_->format_,
+                                    &frame)) {
+      parent_->memory_cache_.Insert(hash_, frame);
+
+      olive::disk_cache_manager.Touch(filename_);
+    }
+
+    parent_->pending_reads_lock_.lock();
+    parent_->pending_reads_.remove(hash_);
+    parent_->pending_reads_lock_.unlock();
+  }
+
+private:
+  RendererProcessor* parent_;
+
+  QByteArray hash_;
+
+  QString filename_;
+};
+
+/**
+ * @brief Works out the hashes of a chunk of an invalidated range on RendererProcessor's rehash pool
+ */
+class RendererProcessor::Rehasher : public QRunnable
+{
+public:
+  Rehasher(RendererProcessor* parent, quint64 job, NodeOutput* output, const int64_t& start, const int64_t& end) :
+    parent_(parent),
+    job_(job),
+    output_(output),
+    start_(start),
+    end_(end)
+  {
+  }
+
+  virtual void run() override
+  {
+    QVector<RehashResult> results;
+    results.reserve(static_cast<int>(end_ - start_ + 1));
+
+    Node* node = output_->parent();
+
+    // Hashing reads the same values and edges the workers do, so lock the nodes the same way they do
+    QList<Node*> nodes = node->GetDependencies();
+    nodes.append(node);
+
+    for (int64_t i=start_;i<=end_;i++) {
+      RendererScheduler::LockNodes(nodes);
+      results.append({job_, i, node->CachedHash(output_, parent_->TimestampToTime(i))});
+      RendererScheduler::UnlockNodes(nodes);
+    }
+
+    parent_->completions_lock_.lock();
+    parent_->rehashed_frames_.append(results);
+    parent_->finished_rehash_chunks_.append(job_);
+    parent_->completions_lock_.unlock();
+
+    parent_->ScheduleDrain();
+  }
+
+private:
+  RendererProcessor* parent_;
+
+  quint64 job_;
+
+  NodeOutput* output_;
+
+  int64_t start_;
+  int64_t end_;
+};
 
 RendererProcessor::RendererProcessor() :
+  scheduler_(this),
   started_(false),
+  share_ctx_(nullptr),
   width_(0),
   height_(0),
   divider_(1),
-  caching_(false)
+  cache_format_(RendererCacheCodec::FormatForPriority(kDefaultCachePriority)),
+  filling_(false),
+  has_cache_range_(false),
+  cache_range_start_(0),
+  cache_range_end_(0),
+  playback_speed_(0),
+  playback_divider_(1),
+  average_render_time_(0),
+  render_time_samples_(0),
+  last_requested_frame_(-1),
+  max_frames_in_flight_(1),
+  render_thread_count_(0),
+  vram_thread_limit_(0),
+  vram_divider_(1),
+  memory_cache_(kRenderMemoryCacheSize),
+  intermediate_cache_(kIntermediateCacheSize),
+  cache_ranges_changed_(false),
+  published_frames_in_flight_(0),
+  published_queue_length_(0),
+  published_download_backlog_(0),
+  has_interactive_range_(false),
+  next_rehash_job_(0),
+  drain_pending_(0)
 {
   texture_input_ = new NodeInput("tex_in");
   texture_input_->add_data_input(NodeInput::kTexture);
@@ -49,6 +179,39 @@ RendererProcessor::RendererProcessor() :
   texture_output_ = new NodeOutput("tex_out");
   texture_output_->set_data_type(NodeInput::kTexture);
   AddParameter(texture_output_);
+
+  // Runs in the worker's thread, which only schedules a drain in this object's thread (see DrainCompletions())
+  connect(&scheduler_, SIGNAL(FrameFinished()), this, SLOT(SchedulerFrameFinished()), Qt::DirectConnection);
+
+  read_pool_.setMaxThreadCount(kDiskReadThreads);
+
+  scrub_timer_.setSingleShot(true);
+  scrub_timer_.setInterval(kScrubRestInterval);
+  connect(&scrub_timer_, SIGNAL(timeout()), this, SLOT(ScrubRested()));
+
+  connect(&olive::disk_cache_manager,
+          SIGNAL(FileEvicted(const QString&)),
+          this,
+          SLOT(DiskCacheFileEvicted(const QString&)),
+          Qt::QueuedConnection);
+
+  connect(NodeInteractiveEdit::Get(), SIGNAL(Finished()), this, SLOT(InteractiveEditFinished()));
+
+  connect(&olive::performance_profile, SIGNAL(Changed()), this, SLOT(PerformanceProfileChanged()));
+
+  // Pressure can change in any thread that allocates a texture
+  connect(&olive::vram_monitor, SIGNAL(PressureChanged()), this, SLOT(CheckVRAM()), Qt::QueuedConnection);
+
+  vram_timer_.setInterval(kVRAMDegradeInterval);
+  connect(&vram_timer_, SIGNAL(timeout()), this, SLOT(CheckVRAM()));
+}
+
+RendererProcessor::~RendererProcessor()
+{
+  // Take this renderer's frames out of the totals
+  PublishGauge(RenderStats::kFramesInFlight, 0, &published_frames_in_flight_);
+  PublishGauge(RenderStats::kQueueLength, 0, &published_queue_length_);
+  PublishGauge(RenderStats::kDownloadBacklog, 0, &published_download_backlog_);
 }
 
 QString RendererProcessor::Name()
@@ -71,15 +234,7 @@ QString RendererProcessor::id()
   return "org.olivevideoeditor.Olive.renderervenus";
 }
 
-void RendererProcessor::SetCacheName(const QString &s)
-{
-  cache_name_ = s;
-  cache_time_ = QDateTime::currentMSecsSinceEpoch();
-
-  GenerateCacheIDInternal();
-}
-
-QVariant RendererProcessor::Value(NodeOutput* output, const rational& time)
+NodeValue RendererProcessor::Value(NodeOutput* output, const rational& time)
 {
   if (output == texture_output_) {
     if (!texture_input_->IsConnected()) {
@@ -97,25 +252,47 @@ QVariant RendererProcessor::Value(NodeOutput* output, const rational& time)
       return 0;
     }
 
-    // Find frame in map
-    if (time_hash_map_.contains(time)) {
-      QString fn = CachePathName(time_hash_map_[time]);
+    if (started_ && playback_speed_ != 0) {
+      // Frames the playhead has already passed won't be needed for this playback, drop them in favor of ones ahead
+      scheduler_.CancelPending(time, playback_speed_ < 0);
+    }
+
+    // Everything past this point works in frame indices
+    int64_t frame = TimeToTimestamp(time);
+
+    bool playhead_moved = (frame != last_requested_frame_);
+    last_requested_frame_ = frame;
 
-      if (QFileInfo::exists(fn)) {
-        auto in = OIIO::ImageInput::open(fn.toStdString());
+    // Find frame in map
+    if (time_hash_map_.Contains(frame)) {
+      QByteArray hash = time_hash_map_.Value(frame);
 
-        if (in) {
-          in->read_image(PixelService::GetPixelFormatInfo(format_).oiio_desc, cache_frame_load_buffer_.data());
+      // Keep the frames ahead of the playhead coming while playing
+      PrefetchFrames(frame);
 
-          in->close();
+      // Use the frame if the upload thread has already prepared it
+      ReadyFrame ready = ready_frames_.value(frame);
 
-          master_texture_->Upload(cache_frame_load_buffer_.data());
+      if (ready.texture != nullptr && ready.hash == hash) {
+        olive::render_stats.Add(RenderStats::kVRAMHit);
 
-          return QVariant::fromValue(master_texture_);
-        } else {
-          qWarning() << "OIIO Error:" << OIIO::geterror().c_str();
-        }
+        return NodeValue(std::move(ready.texture));
       }
+
+      // Otherwise have the upload thread load it. It'll be pushed to the output once it's ready, and until then the
+      // viewer keeps showing whatever it has.
+      QueueUpload(frame, hash);
+
+      return NodeValue();
+    }
+
+    // Not rendered yet
+    olive::render_stats.Add(RenderStats::kMiss);
+
+    if (playback_speed_ == 0 && playhead_moved) {
+      // The playhead is being moved around while paused, show something straight away and refine it once it rests
+      SubmitPreview(frame);
+      scrub_timer_.start();
     }
   }
 
@@ -124,6 +301,11 @@ QVariant RendererProcessor::Value(NodeOutput* output, const rational& time)
 
 void RendererProcessor::Release()
 {
+  // Rehashers walk the graph, which may be about to be unloaded
+  rehash_pool_.clear();
+  rehash_pool_.waitForDone();
+
+  StopFill();
   Stop();
 }
 
@@ -137,64 +319,217 @@ void RendererProcessor::InvalidateCache(const rational &start_range, const ratio
 
   // Adjust range to min/max values
   rational start_range_adj = qMax(rational(0), start_range);
-  rational end_range_adj = qMin(length_input()->get_value(0).value<rational>(), end_range);
+  rational end_range_adj = qMin(length_input()->get_value(0).toRational(), end_range);
+
+  OLIVE_LOG_DEBUG("Cache invalidated between (start, end)", start_range_adj, end_range_adj);
+
+  // Convert range to timestamps in our timebase
+  int64_t start_frame = TimeToTimestamp(start_range_adj);
+  int64_t end_frame = TimeToTimestamp(end_range_adj);
+
+  // Frames in the range keep their old hash until they're rendered again, but they're no longer up to date
+  if (end_frame >= start_frame) {
+    cached_ranges_.Remove(start_frame, end_frame);
+    dirty_ranges_.Insert(start_frame, end_frame);
+    emit CacheRangesChanged();
+  }
+
+  // Anything already rendering in this range would be out of date, stop it where it is so it can start over
+  if (started_) {
+    scheduler_.CancelRange(TimestampToTime(start_frame), TimestampToTime(end_frame));
+  }
+
+  // Frames are ordered by their distance from the playhead when they're taken from the queue
+  int64_t playhead = TimeToTimestamp(texture_output()->LastRequestedTime());
+
+  cache_queue_.SetPlayhead(playhead);
 
-  qDebug() << "Cache invalidated between"
-           << start_range_adj.toDouble()
-           << "and"
-           << end_range_adj.toDouble();
+  if (NodeInteractiveEdit::Get()->IsActive()) {
+    // The value is still changing, so only preview it at the playhead and queue the rest once it settles
+    if (has_interactive_range_) {
+      interactive_in_ = qMin(interactive_in_, start_range_adj);
+      interactive_out_ = qMax(interactive_out_, end_range_adj);
+    } else {
+      interactive_in_ = start_range_adj;
+      interactive_out_ = end_range_adj;
+      has_interactive_range_ = true;
+    }
+
+    if (playhead >= start_frame && playhead <= end_frame) {
+      cache_queue_.Insert(playhead);
+    }
+
+    RehashRange(start_frame, end_frame, false);
+  } else if (texture_input_->IsConnected()) {
+    // The playhead's frame goes ahead straight away, the rest only render if they hash to something new
+    if (playhead >= start_frame && playhead <= end_frame) {
+      cache_queue_.Insert(playhead);
+    }
+
+    RehashRange(start_frame, end_frame, true);
+  } else {
+    for (int64_t i=start_frame;i<=end_frame;i++) {
+      cache_queue_.Insert(i);
+    }
+  }
+
+  CacheNext();
+
+  PublishStats();
+}
+
+void RendererProcessor::InteractiveEditFinished()
+{
+  if (!has_interactive_range_) {
+    return;
+  }
+
+  has_interactive_range_ = false;
+
+  InvalidateCache(interactive_in_, interactive_out_);
+}
+
+void RendererProcessor::PerformanceProfileChanged()
+{
+  if (!started_) {
+    return;
+  }
+
+  PerformanceProfile::Values profile = olive::performance_profile.values();
+
+  // Budgets are applied by PerformanceProfile itself, only the thread counts need changing here
+  if (EffectiveRenderThreadCount() != render_thread_count_ || profile.download_threads != download_threads_.size()) {
+    ResizeThreads();
+    CacheNext();
+  }
+}
+
+void RendererProcessor::CheckVRAM()
+{
+  // Critical pressure from a failed allocation wears off without anything else changing
+  olive::vram_monitor.Update();
+
+  VRAMMonitor::Pressure pressure = olive::vram_monitor.pressure();
+  bool degraded = (vram_thread_limit_ > 0 || vram_divider_ > 1);
 
-  // Snap start_range to timebase
-  double start_range_dbl = start_range_adj.toDouble();
-  double start_range_numf = start_range_dbl * static_cast<double>(timebase_.denominator());
-  int64_t start_range_numround = qFloor(start_range_numf/static_cast<double>(timebase_.numerator())) * timebase_.numerator();
-  rational true_start_range(start_range_numround, timebase_.denominator());
+  if (pressure != VRAMMonitor::kNormal) {
+    vram_normal_since_.invalidate();
+  }
+
+  if (pressure == VRAMMonitor::kCritical
+      && started_
+      && (!vram_last_degrade_.isValid() || vram_last_degrade_.elapsed() >= kVRAMDegradeInterval)) {
+    if (render_thread_count_ > 1) {
+      vram_thread_limit_ = render_thread_count_ / 2;
+
+      qWarning() << "VRAM is short, reducing render threads to" << vram_thread_limit_;
+
+      ResizeThreads();
+      CacheNext();
 
-  for (rational r=true_start_range;r<=end_range_adj;r+=timebase_) {
-    // Try to order the queue from closest to the playhead to furthest
-    rational last_time = texture_output()->LastRequestedTime();
+      vram_last_degrade_.start();
+      degraded = true;
+    } else if (mode_ == olive::RenderMode::kOffline && DisplayDivider() < kMaximumDisplayDivider) {
+      // Exports (online) have to be rendered at full resolution, so they can only wait for frames to be freed
+      vram_divider_ *= 2;
 
-    rational diff = r - last_time;
+      qWarning() << "VRAM is short, increasing divider to" << DisplayDivider();
 
-    if (diff < 0) {
-      // FIXME: Hardcoded number
-      // If the number is before the playhead, we still prioritize its closeness but not nearly as much (5:1 in this
-      // example)
-      diff = qAbs(diff) * 5;
+      UpdateDisplayDivider();
+      CacheNext();
+
+      vram_last_degrade_.start();
+      degraded = true;
     }
+  } else if (pressure == VRAMMonitor::kNormal && degraded) {
+    if (!vram_normal_since_.isValid()) {
+      vram_normal_since_.start();
+    } else if (vram_normal_since_.elapsed() >= kVRAMRecoveryDelay * 1000) {
+      qInfo() << "VRAM has recovered, restoring render threads and divider";
 
-    bool contains = false;
-    bool added = false;
-    QLinkedList<rational>::iterator insert_iterator;
+      vram_thread_limit_ = 0;
+      vram_divider_ = 1;
+      vram_normal_since_.invalidate();
+      degraded = false;
 
-    for (QLinkedList<rational>::iterator i = cache_queue_.begin();i != cache_queue_.end();i++) {
-      rational compare = *i;
+      UpdateDisplayDivider();
 
-      if (!added) {
-        rational compare_diff = compare - last_time;
+      ResizeThreads();
 
-        if (compare_diff > diff) {
-          insert_iterator = i;
-          added = true;
-        }
-      }
+      CacheNext();
+    }
+  }
 
-      if (compare == r) {
-        contains = true;
-        break;
-      }
+  // Keep checking while there's anything to step down from or recover from
+  if (pressure != VRAMMonitor::kNormal || degraded) {
+    if (!vram_timer_.isActive()) {
+      vram_timer_.start();
     }
+  } else {
+    vram_timer_.stop();
+  }
+}
 
-    if (!contains) {
-      if (added) {
-        cache_queue_.insert(insert_iterator, r);
-      } else {
-        cache_queue_.append(r);
+void RendererProcessor::FillCache()
+{
+  if (!texture_input_->IsConnected() || timebase_.isNull()) {
+    return;
+  }
+
+  filling_ = true;
+
+  if (!FillQuotaReached()) {
+    int64_t length = TimeToTimestamp(length_input()->get_value(0).toRational());
+
+    int64_t start = 0;
+
+    if (has_cache_range_) {
+      start = cache_range_start_;
+      length = qMin(length, cache_range_end_ + 1);
+    }
+
+    // Cached frames are always mapped, so only the gaps between them need checking
+    for (int64_t i=cached_ranges_.NextOutside(start);i<length;i=cached_ranges_.NextOutside(i + 1)) {
+      if (!time_hash_map_.Contains(i) && !cache_queue_.Contains(i)) {
+        fill_queue_.Insert(i);
       }
     }
+
+    CacheNext();
   }
 
-  CacheNext();
+  CheckFillFinished();
+}
+
+void RendererProcessor::StopFill()
+{
+  fill_queue_.Clear();
+
+  // Frames that have started finish (they're nearly done anyway), the rest are thrown away when they come back
+  if (started_ && !fill_frames_.isEmpty()) {
+    scheduler_.CancelPending();
+  }
+
+  if (filling_) {
+    filling_ = false;
+    emit FillFinished();
+  }
+}
+
+void RendererProcessor::SetCacheRange(const int64_t &start, const int64_t &end)
+{
+  has_cache_range_ = true;
+  cache_range_start_ = start;
+  cache_range_end_ = end;
+}
+
+bool RendererProcessor::IsCacheBusy() const
+{
+  return !cache_queue_.IsEmpty()
+      || !cache_futures_.isEmpty()
+      || !preview_futures_.isEmpty()
+      || !deferred_maps_.isEmpty()
+      || !rehash_jobs_.isEmpty();
 }
 
 void RendererProcessor::SetTimebase(const rational &timebase)
@@ -209,9 +544,11 @@ void RendererProcessor::SetParameters(const int &width,
                                       const olive::RenderMode &mode,
                                       const int& divider)
 {
-  // Since we're changing parameters, all the existing threads are invalid and must be removed. They will start again
-  // next time this Node has to process anything.
-  Stop();
+  // The cache format depends on the mode (see Start()), so only a change of mode needs the threads started again.
+  // Anything else is applied to them in place once the new parameters are set.
+  if (mode != mode_) {
+    Stop();
+  }
 
   // Set new parameters
   width_ = width;
@@ -220,7 +557,9 @@ void RendererProcessor::SetParameters(const int &width,
   mode_ = mode;
 
   // divider's default value is 0, so we can assume if it's 0 a divider wasn't specified
-  if (divider > 0) {
+  if (kMatchDisplayResolution && !display_size_.isEmpty()) {
+    divider_ = DisplayDivider();
+  } else if (divider > 0) {
     divider_ = divider;
   }
 
@@ -228,274 +567,1324 @@ void RendererProcessor::SetParameters(const int &width,
 
   // Regenerate the cache ID
   GenerateCacheIDInternal();
+
+  Reconfigure();
 }
 
 void RendererProcessor::SetDivider(const int &divider)
 {
   Q_ASSERT(divider_ > 0);
 
-  Stop();
-
   divider_ = divider;
 
   CalculateEffectiveDimensions();
 
   // Regenerate the cache ID
   GenerateCacheIDInternal();
+
+  Reconfigure();
 }
 
-void RendererProcessor::Start()
+bool RendererProcessor::SetDisplaySize(const QSize &size)
 {
-  if (started_) {
-    return;
+  if (size.isEmpty()) {
+    return false;
   }
 
-  QOpenGLContext* ctx = QOpenGLContext::currentContext();
-
-  int background_thread_count = QThread::idealThreadCount();
-
-  threads_.resize(background_thread_count);
+  display_size_ = size;
 
-  for (int i=0;i<threads_.size();i++) {
-    threads_[i] = std::make_shared<RendererProcessThread>(this, ctx, effective_width_, effective_height_, divider_, format_, mode_);
-    threads_[i]->StartThread(QThread::LowPriority);
-
-    // Ensure this connection is "Queued" so that it always runs in this object's threaded rather than any of the
-    // other threads
-    connect(threads_.at(i).get(),
-            SIGNAL(RequestSibling(NodeDependency)),
-            this,
-            SLOT(ThreadRequestSibling(NodeDependency)),
-            Qt::QueuedConnection);
+  if (!kMatchDisplayResolution) {
+    return false;
   }
 
-  // Connect first thread (master thread) to the callback
-  connect(threads_.first().get(),
-          SIGNAL(CachedFrame(RenderTexturePtr, const rational&, const QByteArray&)),
-          this,
-          SLOT(ThreadCallback(RenderTexturePtr, const rational&, const QByteArray&)),
-          Qt::QueuedConnection);
-  connect(threads_.first().get(),
-          SIGNAL(FrameSkipped(const rational&, const QByteArray&)),
-          this,
-          SLOT(ThreadSkippedFrame(const rational&, const QByteArray&)),
-          Qt::QueuedConnection);
-
-  download_threads_.resize(background_thread_count);
+  int divider = DisplayDivider();
 
-  for (int i=0;i<download_threads_.size();i++) {
-    // Create download thread
-    download_threads_[i] = std::make_shared<RendererDownloadThread>(ctx, effective_width_, effective_height_, divider_, format_, mode_);
-    download_threads_[i]->StartThread(QThread::LowPriority);
-
-    connect(download_threads_[i].get(),
-            SIGNAL(Downloaded(const QByteArray&)),
-            this,
-            SLOT(DownloadThreadComplete(const QByteArray&)),
-            Qt::QueuedConnection);
+  if (divider == divider_) {
+    return false;
   }
 
-  last_download_thread_ = 0;
+  SetDivider(divider);
+
+  return true;
+}
 
-  // Create master texture (the one sent to the viewer)
-  master_texture_ = std::make_shared<RenderTexture>();
-  master_texture_->Create(ctx, effective_width_, effective_height_, format_);
+void RendererProcessor::SetCacheFormat(const olive::CacheFormat &format)
+{
+  Stop();
 
-  cache_frame_load_buffer_.resize(PixelService::GetBufferSize(format_, effective_width_, effective_height_));
+  cache_format_ = format;
 
-  started_ = true;
+  // Regenerate the cache ID
+  GenerateCacheIDInternal();
 }
 
-void RendererProcessor::Stop()
+void RendererProcessor::SetPlaybackSpeed(const int &speed)
 {
-  if (!started_) {
-    return;
-  }
+  playback_speed_ = speed;
 
-  started_ = false;
+  cache_queue_.SetPlaybackSpeed(playback_speed_);
 
-  foreach (RendererDownloadThreadPtr download_thread_, download_threads_) {
-    download_thread_->Cancel();
+  if (playback_speed_ != 0 && scrub_timer_.isActive()) {
+    // Playback needs the queue straight away, previews are recached once it stops again
+    scrub_timer_.stop();
+    CacheNext();
   }
-  download_threads_.clear();
 
-  foreach (RendererProcessThreadPtr process_thread, threads_) {
-    process_thread->Cancel();
+  if (qAbs(playback_speed_) < kShuttleKeyframeSpeed && !shuttle_frames_.isEmpty()) {
+    RecacheShuttleFrames();
+    CacheNext();
   }
-  threads_.clear();
 
-  master_texture_ = nullptr;
+  if (playback_speed_ == 0) {
+    // Start from full quality next time, the load may be different by then
+    playback_divider_ = 1;
+    render_time_samples_ = 0;
 
-  cache_frame_load_buffer_.clear();
+    if (!reduced_frames_.isEmpty()) {
+      RecacheReducedFrames();
+      CacheNext();
+    }
+  }
 }
 
-void RendererProcessor::GenerateCacheIDInternal()
+const int &RendererProcessor::playback_speed() const
 {
-  if (cache_name_.isEmpty() || effective_width_ == 0 || effective_height_ == 0) {
-    return;
-  }
-
-  // Generate an ID that is more or less guaranteed to be unique to this Sequence
-  QCryptographicHash hash(QCryptographicHash::Sha1);
-  hash.addData(cache_name_.toUtf8());
-  hash.addData(QString::number(cache_time_).toUtf8());
-  hash.addData(QString::number(width_).toUtf8());
-  hash.addData(QString::number(height_).toUtf8());
-  hash.addData(QString::number(format_).toUtf8());
-  hash.addData(QString::number(divider_).toUtf8());
+  return playback_speed_;
+}
 
-  QByteArray bytes = hash.result();
-  cache_id_ = bytes.toHex();
+const int &RendererProcessor::playback_divider() const
+{
+  return playback_divider_;
 }
 
-void RendererProcessor::CacheNext()
+void RendererProcessor::Start()
 {
-  if (cache_queue_.isEmpty() || !texture_input_->IsConnected() || caching_) {
+  if (started_) {
     return;
   }
 
-  // Make sure cache has started
-  Start();
+  QOpenGLContext* ctx = QOpenGLContext::currentContext();
 
-  rational cache_frame = cache_queue_.takeFirst();
+  if (ctx == nullptr) {
+    // No widget has made a context current (e.g. when rendering from the command line), so share with our own instead
+    ctx = OffscreenContext();
 
-  qDebug() << "Caching" << cache_frame.toDouble();
+    if (ctx == nullptr) {
+      qWarning() << "RendererProcessor failed to create an OpenGL context";
+      return;
+    }
+  }
 
-  threads_.first()->Queue(NodeDependency(texture_input_->get_connected_output(), cache_frame), true);
+  share_ctx_ = ctx;
 
-  caching_ = true;
-}
+  if (cache_format_ == olive::kCacheFormatBC7) {
+    // Checking the context's extensions needs it current, which our own offscreen context isn't yet
+    bool made_current = (QOpenGLContext::currentContext() != ctx && ctx->makeCurrent(offscreen_surface_.get()));
 
-QString RendererProcessor::CachePathName(const QByteArray &hash)
-{
-  QDir this_cache_dir = QDir(GetMediaCacheLocation()).filePath(cache_id_);
-  this_cache_dir.mkpath(".");
+    bool supported = BlockCompressor::IsSupported(ctx);
 
-  QString filename = QString("%1.exr").arg(QString(hash.toHex()));
+    if (made_current) {
+      ctx->doneCurrent();
+    }
 
-  return this_cache_dir.filePath(filename);
-}
+    if (!supported) {
+      qWarning() << "GPU can't compress cache frames, caching them as packed YUV instead";
 
-void RendererProcessor::DeferMap(const rational &time, const QByteArray &hash)
-{
-  deferred_maps_.append({time, hash});
-}
+      cache_format_ = olive::kCacheFormatYUV420;
+      GenerateCacheIDInternal();
+    }
+  }
 
-bool RendererProcessor::HasHash(const QByteArray &hash)
-{
-  return QFileInfo::exists(CachePathName(hash));
-}
+  if (RendererCacheCodec::IsYUV(cache_format_) && mode_ == olive::RenderMode::kOnline) {
+    // Chroma subsampling is fine for previews but not for frames that end up in an export
+    cache_format_ = olive::kCacheFormatRaw;
+    GenerateCacheIDInternal();
+  }
 
-bool RendererProcessor::IsCaching(const QByteArray &hash)
-{
-  cache_hash_list_mutex_.lock();
+  ScanDiskCache();
 
-  bool is_caching = cache_hash_list_.contains(hash);
+  PerformanceProfile::Values profile = olive::performance_profile.values();
 
-  cache_hash_list_mutex_.unlock();
+  render_thread_count_ = EffectiveRenderThreadCount();
 
-  return is_caching;
-}
+  scheduler_.Start(ctx, effective_width_, effective_height_, divider_, format_, mode_, render_thread_count_);
 
-bool RendererProcessor::TryCache(const QByteArray &hash)
-{
-  cache_hash_list_mutex_.lock();
+  CalculateMaximumFramesInFlight(render_thread_count_);
 
-  bool is_caching = cache_hash_list_.contains(hash);
+  download_threads_.resize(profile.download_threads);
 
-  if (!is_caching) {
-    cache_hash_list_.append(hash);
+  for (int i=0;i<download_threads_.size();i++) {
+    StartDownloadThread(i);
   }
 
-  cache_hash_list_mutex_.unlock();
+  last_download_thread_ = 0;
+
+  upload_thread_ = std::make_shared<RendererUploadThread>(ctx,
+                                                          effective_width_,
+                                                          effective_height_,
+                                                          divider_,
+                                                          format_,
+                                                          mode_,
+                                                          cache_format_,
+                                                          &memory_cache_);
+  upload_thread_->StartThread(QThread::HighPriority);
+
+  connect(upload_thread_.get(),
+          SIGNAL(FrameUploaded(RenderTexturePtr, const rational&, const QByteArray&)),
+          this,
+          SLOT(UploadThreadComplete(RenderTexturePtr, const rational&, const QByteArray&)),
+          Qt::QueuedConnection);
 
-  return !is_caching;
+  started_ = true;
 }
 
-void RendererProcessor::CalculateEffectiveDimensions()
+void RendererProcessor::StartDownloadThread(int index)
 {
-  effective_width_ = width_ / divider_;
-  effective_height_ = height_ / divider_;
+  download_threads_[index] = std::make_shared<RendererDownloadThread>(share_ctx_,
+                                                                       effective_width_,
+                                                                       effective_height_,
+                                                                       divider_,
+                                                                       format_,
+                                                                       mode_,
+                                                                       cache_format_,
+                                                                       &memory_cache_,
+                                                                       &write_pool_);
+
+  // Spread across NUMA nodes the same way as the scheduler's workers so each node has its own downloaders
+  download_threads_[index]->SetAffinityNode(index);
+  download_threads_[index]->StartThread(QThread::LowPriority);
+
+  connect(download_threads_[index].get(),
+          SIGNAL(Downloaded(const QByteArray&)),
+          this,
+          SLOT(HashDownloaded(const QByteArray&)),
+          Qt::DirectConnection);
 }
 
-void RendererProcessor::ThreadCallback(RenderTexturePtr texture, const rational& time, const QByteArray& hash)
+void RendererProcessor::ResizeThreads()
 {
-  // Threads are all done now, time to proceed
-  caching_ = false;
-
-  DeferMap(time, hash);
+  if (!started_) {
+    return;
+  }
 
-  if (texture != nullptr) {
-    // We received a texture, time to start downloading it
-    QString fn = CachePathName(hash);
+  int render_thread_count = EffectiveRenderThreadCount();
 
-    download_threads_[last_download_thread_%download_threads_.size()]->Queue(texture,
-                                                                             fn,
-                                                                             hash);
+  if (render_thread_count != render_thread_count_) {
+    scheduler_.SetThreadCount(share_ctx_,
+                              effective_width_,
+                              effective_height_,
+                              divider_,
+                              format_,
+                              mode_,
+                              render_thread_count);
 
-    last_download_thread_++;
-  } else {
-    // There was no texture here, we must update the viewer
-    DownloadThreadComplete(hash);
-  }
+    render_thread_count_ = render_thread_count;
 
-  // If the connected output is using this time, signal it to update
-  if (texture_output_->IsConnected()
-      && texture_output_->LastRequestedTime() == time) {
-    texture_output_->push_value(QVariant::fromValue(texture), time);
-    SendInvalidateCache(time, time);
+    CalculateMaximumFramesInFlight(render_thread_count_);
   }
 
-  CacheNext();
-}
+  int download_thread_count = olive::performance_profile.values().download_threads;
+  int old_download_thread_count = download_threads_.size();
 
-void RendererProcessor::ThreadRequestSibling(NodeDependency dep)
-{
-  // Try to queue another thread to run this dep in advance
-  for (int i=1;i<threads_.size();i++) {
-    if (threads_.at(i)->Queue(dep, false)) {
-      return;
+  if (download_thread_count < old_download_thread_count) {
+    // Frames already queued on the threads being removed are still downloaded, so nothing that's caching is lost
+    for (int i=download_thread_count;i<old_download_thread_count;i++) {
+      download_threads_.at(i)->Finish();
     }
-  }
-}
 
-void RendererProcessor::ThreadSkippedFrame(const rational& time, const QByteArray& hash)
-{
-  caching_ = false;
-
-  DeferMap(time, hash);
+    // Writers reference their download thread
+    write_pool_.waitForDone();
 
-  if (!IsCaching(hash)) {
-    DownloadThreadComplete(hash);
+    download_threads_.resize(download_thread_count);
+  } else if (download_thread_count > old_download_thread_count) {
+    download_threads_.resize(download_thread_count);
 
-    // Signal output to update value
-    if (texture_output_->IsConnected()
-        && texture_output_->LastRequestedTime() == time) {
-      texture_output_->ClearCachedValue();
-      SendInvalidateCache(time, time);
+    for (int i=old_download_thread_count;i<download_thread_count;i++) {
+      StartDownloadThread(i);
     }
   }
 
-  CacheNext();
+  last_download_thread_ = 0;
+
+  PublishStats();
+}
+
+void RendererProcessor::Stop()
+{
+  if (!started_) {
+    return;
+  }
+
+  started_ = false;
+
+  foreach (RendererDownloadThreadPtr download_thread_, download_threads_) {
+    download_thread_->Cancel();
+  }
+
+  // Writers reference their download thread, so let them finish before the threads are destroyed
+  write_pool_.waitForDone();
+
+  // Readers use the current parameters, which are about to change
+  read_pool_.clear();
+  read_pool_.waitForDone();
+  pending_reads_.clear();
+
+  download_threads_.clear();
+
+  scheduler_.Stop();
+
+  // Frames in progress were discarded, so they're no longer being cached
+  cache_futures_.clear();
+  preview_futures_.clear();
+  fill_frames_.clear();
+
+  scrub_timer_.stop();
+
+  cache_hash_list_.Clear();
+
+  // Return the prepared textures to the upload thread's pool before it's destroyed
+  ready_frames_.clear();
+  pending_uploads_.clear();
+
+  upload_thread_->Cancel();
+  upload_thread_ = nullptr;
+
+  // Hashes don't include the dimensions or format, so frames in memory may no longer match the new parameters
+  memory_cache_.Clear();
+
+  // The workers' contexts are gone, and intermediates don't include the dimensions or format in their hashes either
+  intermediate_cache_.Clear();
+
+  PublishStats();
+}
+
+void RendererProcessor::Reconfigure()
+{
+  if (!started_) {
+    return;
+  }
+
+  // Blocks until every worker has finished or abandoned what it was rendering and switched over
+  scheduler_.Reconfigure(effective_width_, effective_height_, divider_, format_, mode_);
+
+  // Frames in progress were cancelled, so they're no longer being cached
+  cache_futures_.clear();
+  preview_futures_.clear();
+  fill_frames_.clear();
+
+  scrub_timer_.stop();
+
+  // Readers use the old parameters
+  read_pool_.clear();
+  read_pool_.waitForDone();
+  pending_reads_.clear();
+
+  // Downloads already queued are written with the old parameters before their threads switch over
+  foreach (RendererDownloadThreadPtr download_thread, download_threads_) {
+    download_thread->Reconfigure(effective_width_, effective_height_, divider_, format_, mode_);
+  }
+
+  foreach (RendererDownloadThreadPtr download_thread, download_threads_) {
+    download_thread->WaitForReconfigure();
+  }
+
+  write_pool_.waitForDone();
+
+  cache_hash_list_.Clear();
+
+  ready_frames_.clear();
+  pending_uploads_.clear();
+
+  upload_thread_->Reconfigure(effective_width_, effective_height_, divider_, format_, mode_);
+  upload_thread_->WaitForReconfigure();
+
+  // As in Stop(), neither cache includes the dimensions or format in its hashes
+  memory_cache_.Clear();
+  intermediate_cache_.Clear();
+
+  // The cache ID has changed, so this is a different directory now
+  ScanDiskCache();
+
+  CalculateMaximumFramesInFlight(render_thread_count_);
+
+  PublishStats();
+}
+
+QOpenGLContext *RendererProcessor::OffscreenContext()
+{
+  if (offscreen_context_ != nullptr) {
+    return offscreen_context_.get();
+  }
+
+  // The surface has to be created in the main thread, which this always is
+  offscreen_surface_.reset(new QOffscreenSurface());
+  offscreen_surface_->setFormat(QSurfaceFormat::defaultFormat());
+  offscreen_surface_->create();
+
+  std::unique_ptr<QOpenGLContext> ctx(new QOpenGLContext());
+  ctx->setFormat(QSurfaceFormat::defaultFormat());
+
+  if (!offscreen_surface_->isValid() || !ctx->create()) {
+    offscreen_surface_ = nullptr;
+    return nullptr;
+  }
+
+  offscreen_context_ = std::move(ctx);
+
+  return offscreen_context_.get();
+}
+
+void RendererProcessor::GenerateCacheIDInternal()
+{
+  if (effective_width_ == 0 || effective_height_ == 0) {
+    return;
+  }
+
+  // Frames are named by their hash, so the ID only needs to separate frames rendered with different parameters. This
+  // lets any Sequence (in this session or a later one) reuse frames that have already been rendered.
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  hash.addData(QString::number(width_).toUtf8());
+  hash.addData(QString::number(height_).toUtf8());
+  hash.addData(QString::number(format_).toUtf8());
+  hash.addData(QString::number(divider_).toUtf8());
+  hash.addData(QString::number(cache_format_).toUtf8());
+
+  QByteArray bytes = hash.result();
+  cache_id_ = bytes.toHex();
+
+  cache_dir_ = QDir(GetRenderCacheLocation()).filePath(cache_id_);
+}
+
+void RendererProcessor::CacheNext()
+{
+  if ((cache_queue_.IsEmpty() && fill_queue_.IsEmpty()) || !texture_input_->IsConnected()) {
+    return;
+  }
+
+  ProfilerTimer timer(Profiler::kSchedule);
+
+  // Make sure cache has started
+  Start();
+
+  if (!started_) {
+    return;
+  }
+
+  // Hold off while the playhead is being dragged, these frames are likely to be left behind before they're shown
+  if (scrub_timer_.isActive()) {
+    return;
+  }
+
+  // Keep as many frames in flight as we're allowed to
+  // The playhead may have moved since these frames were queued
+  cache_queue_.SetPlayhead(TimeToTimestamp(texture_output()->LastRequestedTime()));
+
+  while (!cache_queue_.IsEmpty() && cache_futures_.size() < MaximumFramesInFlight()) {
+    int64_t frame = cache_queue_.TakeFirst();
+
+    if (!IsInCacheRange(frame)) {
+      continue;
+    }
+
+    cache_futures_.append(scheduler_.Submit(NodeDependency(texture_input_->get_connected_output(),
+                                                           TimestampToTime(frame)),
+                                            QRect(),
+                                            IsInteractive(frame) ? RendererScheduler::kPriorityInteractive
+                                                                 : RendererScheduler::kPriorityBackground));
+  }
+
+  // Idle rendering only uses what's left over once the frames that were actually invalidated have been submitted
+  if (!cache_queue_.IsEmpty() || fill_queue_.IsEmpty()) {
+    return;
+  }
+
+  if (FillQuotaReached()) {
+    fill_queue_.Clear();
+    return;
+  }
+
+  fill_queue_.SetPlayhead(TimeToTimestamp(texture_output()->LastRequestedTime()));
+
+  while (!fill_queue_.IsEmpty() && cache_futures_.size() < MaximumFramesInFlight()) {
+    int64_t frame = fill_queue_.TakeFirst();
+
+    // Rendered since it was queued
+    if (time_hash_map_.Contains(frame)) {
+      continue;
+    }
+
+    fill_frames_.insert(frame);
+
+    cache_futures_.append(scheduler_.Submit(NodeDependency(texture_input_->get_connected_output(),
+                                                           TimestampToTime(frame))));
+  }
+}
+
+bool RendererProcessor::IsInteractive(const int64_t &frame)
+{
+  int64_t playhead = TimeToTimestamp(texture_output_->LastRequestedTime());
+
+  if (frame == playhead) {
+    return true;
+  }
+
+  if (playback_speed_ == 0) {
+    return false;
+  }
+
+  // The frames the viewer will show next, as far ahead as it keeps ready (see PrefetchFrames())
+  int64_t ahead = (frame - playhead) * (playback_speed_ < 0 ? -1 : 1);
+
+  return ahead > 0 && ahead < kViewerQueueSize * qAbs(playback_speed_);
+}
+
+int64_t RendererProcessor::TimeToTimestamp(const rational &time)
+{
+  if (time.isNull() || timebase_.isNull()) {
+    return 0;
+  }
+
+  // Snap to the timebase, rounding down. This is exact integer math so times on a frame boundary never land on the
+  // frame before it.
+  int64_t num = time.numerator() * timebase_.denominator();
+  int64_t den = time.denominator() * timebase_.numerator();
+
+  int64_t frame = num / den;
+
+  if ((num % den != 0) && ((num < 0) != (den < 0))) {
+    frame--;
+  }
+
+  return frame;
+}
+
+rational RendererProcessor::TimestampToTime(const int64_t &timestamp)
+{
+  return rational(timestamp * timebase_.numerator(), timebase_.denominator());
+}
+
+QString RendererProcessor::CachePathName(const QByteArray &hash)
+{
+  QString filename = QString("%1.%2").arg(QString(hash.toHex()), RendererCacheCodec::GetExtension(cache_format_));
+
+  return QDir(cache_dir_).filePath(filename);
+}
+
+void RendererProcessor::ScanDiskCache()
+{
+  QDir this_cache_dir(cache_dir_);
+  this_cache_dir.mkpath(".");
+
+  QStringList filters;
+  filters.append(QString("*.%1").arg(RendererCacheCodec::GetExtension(cache_format_)));
+
+  QStringList cached_frames = this_cache_dir.entryList(filters, QDir::Files);
+
+  QWriteLocker locker(&disk_cache_index_lock_);
+
+  disk_cache_index_.clear();
+  disk_cache_index_.reserve(cached_frames.size());
+
+  foreach (const QString& fn, cached_frames) {
+    // Skip frames still being written (see RendererCacheCodec::Write())
+    if (fn.startsWith('.')) {
+      continue;
+    }
+
+    // Filenames are the hex representation of the frame's hash
+    disk_cache_index_.insert(QByteArray::fromHex(QFileInfo(fn).completeBaseName().toLatin1()));
+  }
+
+  // Frames written to this directory's pack (see RendererCacheCodec::Write())
+  if (!HasSharedRenderCache()) {
+    CachePack* pack = CachePack::Get(cache_dir_, RendererCacheCodec::GetExtension(cache_format_));
+
+    foreach (const QByteArray& hash, pack->Hashes()) {
+      disk_cache_index_.insert(hash);
+    }
+  }
+}
+
+void RendererProcessor::DeferMap(const int64_t &frame, const QByteArray &hash)
+{
+  deferred_maps_.insert(hash, frame);
+}
+
+void RendererProcessor::MapStaticRange(const RenderResult &result)
+{
+  if (result.static_in == result.static_out || timebase_.isNull()) {
+    return;
+  }
+
+  // Only frames that start inside the range show the same image
+  int64_t start = TimeToTimestamp(qMax(result.static_in, rational(0)));
+
+  if (TimestampToTime(start) < result.static_in) {
+    start++;
+  }
+
+  int64_t end = TimeToTimestamp(qMin(result.static_out, length_input()->get_value(0).toRational()));
+
+  if (TimestampToTime(end) >= result.static_out) {
+    end--;
+  }
+
+  if (end <= start) {
+    // Just the frame that was rendered
+    return;
+  }
+
+  for (int64_t i=start;i<=end;i++) {
+    cache_queue_.Remove(i);
+    fill_queue_.Remove(i);
+  }
+
+  if (IsCaching(result.hash)) {
+    // Mapped along with the rendered frame once it's been downloaded
+    deferred_ranges_.insert(result.hash, qMakePair(start, end));
+  } else {
+    MapFrameRange(start, end, result.hash);
+  }
+}
+
+void RendererProcessor::MapFrameRange(const int64_t &start, const int64_t &end, const QByteArray &hash)
+{
+  MapFrames(start, end, hash);
+
+  if (!texture_output_->IsConnected()) {
+    return;
+  }
+
+  // The viewer may be waiting on one of these frames
+  rational requested = texture_output_->LastRequestedTime();
+  int64_t playhead = TimeToTimestamp(requested);
+
+  if (requested >= 0 && playhead >= start && playhead <= end) {
+    texture_output_->ClearCachedValue();
+    SendInvalidateCache(requested, requested);
+  }
+}
+
+bool RendererProcessor::HasHash(const QByteArray &hash)
+{
+  if (memory_cache_.Contains(hash)) {
+    return true;
+  }
+
+  QReadLocker locker(&disk_cache_index_lock_);
+
+  if (disk_cache_index_.contains(hash)) {
+    return true;
+  }
+
+  locker.unlock();
+
+  // Other machines sharing the cache add frames without us knowing, so look for them on disk too
+  if (HasSharedRenderCache() && QFileInfo::exists(CachePathName(hash))) {
+    QWriteLocker write_locker(&disk_cache_index_lock_);
+
+    disk_cache_index_.insert(hash);
+
+    return true;
+  }
+
+  return false;
+}
+
+const FrameRangeSet &RendererProcessor::cached_ranges() const
+{
+  return cached_ranges_;
+}
+
+const FrameRangeSet &RendererProcessor::dirty_ranges() const
+{
+  return dirty_ranges_;
+}
+
+bool RendererProcessor::IsCaching(const QByteArray &hash)
+{
+  return cache_hash_list_.Contains(hash);
+}
+
+bool RendererProcessor::TryCache(const QByteArray &hash)
+{
+  return cache_hash_list_.Insert(hash);
+}
+
+RendererIntermediateCache *RendererProcessor::intermediate_cache()
+{
+  return &intermediate_cache_;
+}
+
+void RendererProcessor::CalculateEffectiveDimensions()
+{
+  effective_width_ = width_ / divider_;
+  effective_height_ = height_ / divider_;
+}
+
+int RendererProcessor::DisplayDivider() const
+{
+  int divider = 1;
+
+  // Both axes have to stay at or above the display, the viewer could be stretched differently to the frame
+  while (divider < kMaximumDisplayDivider
+         && width_ / (divider * 2) >= display_size_.width()
+         && height_ / (divider * 2) >= display_size_.height()) {
+    divider *= 2;
+  }
+
+  return qMin(divider * vram_divider_, kMaximumDisplayDivider);
+}
+
+void RendererProcessor::UpdateDisplayDivider()
+{
+  if (!kMatchDisplayResolution || display_size_.isEmpty()) {
+    return;
+  }
+
+  int divider = DisplayDivider();
+
+  if (divider == divider_) {
+    return;
+  }
+
+  SetDivider(divider);
+
+  // Frames at the old divider belong to a different cache, so have the viewer request the current one again
+  rational requested = texture_output_->LastRequestedTime();
+
+  if (texture_output_->IsConnected() && requested >= 0) {
+    texture_output_->ClearCachedValue();
+    SendInvalidateCache(requested, requested);
+  }
+}
+
+int RendererProcessor::EffectiveRenderThreadCount() const
+{
+  int threads = olive::performance_profile.values().render_threads;
+
+  if (vram_thread_limit_ > 0) {
+    threads = qMin(threads, vram_thread_limit_);
+  }
+
+  return threads;
+}
+
+void RendererProcessor::CalculateMaximumFramesInFlight(int thread_count)
+{
+  qint64 frame_size = PixelService::GetBufferSize(format_, effective_width_, effective_height_);
+
+  int memory_limit = static_cast<int>(qMin(kRenderMemoryBudget / qMax(frame_size, Q_INT64_C(1)),
+                                           static_cast<qint64>(thread_count)));
+
+  max_frames_in_flight_ = qMax(1, memory_limit);
+}
+
+int RendererProcessor::MaximumFramesInFlight() const
+{
+  // Frames in flight hold textures until they're downloaded and memory until they're written, so render one at a time
+  // while either is short
+  if (olive::image_cache.UnderPressure(ImageCache::kMemBuf)
+      || olive::image_cache.UnderPressure(ImageCache::kTexBuf)
+      || olive::vram_monitor.pressure() != VRAMMonitor::kNormal) {
+    return 1;
+  }
+
+  return max_frames_in_flight_;
+}
+
+void RendererProcessor::SchedulerFrameFinished()
+{
+  ScheduleDrain();
+}
+
+void RendererProcessor::HashDownloaded(const QByteArray &hash)
+{
+  completions_lock_.lock();
+  downloaded_hashes_.append(hash);
+  completions_lock_.unlock();
+
+  ScheduleDrain();
+}
+
+void RendererProcessor::ScheduleDrain()
+{
+  if (drain_pending_.testAndSetOrdered(0, 1)) {
+    QMetaObject::invokeMethod(this, "DrainCompletions", Qt::QueuedConnection);
+  }
+}
+
+void RendererProcessor::DrainCompletions()
+{
+  // Lowered first so anything completing from here on queues another drain rather than being missed
+  drain_pending_.storeRelease(0);
+
+  completions_lock_.lock();
+  QVector<QByteArray> downloaded = downloaded_hashes_;
+  downloaded_hashes_.clear();
+  QVector<RehashResult> rehashed = rehashed_frames_;
+  rehashed_frames_.clear();
+  QVector<quint64> finished_rehash_chunks = finished_rehash_chunks_;
+  finished_rehash_chunks_.clear();
+  completions_lock_.unlock();
+
+  HandleFinishedFrames();
+
+  foreach (const QByteArray& hash, downloaded) {
+    DownloadThreadComplete(hash);
+  }
+
+  if (!finished_rehash_chunks.isEmpty()) {
+    HandleRehashedFrames(rehashed, finished_rehash_chunks);
+  }
+
+  // Shuttling or playback may have stopped while these were rendering (previews are refined once scrubbing stops)
+  if (!scrub_timer_.isActive()) {
+    if (qAbs(playback_speed_) < kShuttleKeyframeSpeed) {
+      RecacheShuttleFrames();
+    }
+
+    if (playback_speed_ == 0) {
+      RecacheReducedFrames();
+    }
+  }
+
+  CacheNext();
+
+  PublishStats();
+
+  if (cache_ranges_changed_) {
+    cache_ranges_changed_ = false;
+    emit CacheRangesChanged();
+  }
+
+  CheckCacheFinished();
+
+  CheckFillFinished();
+}
+
+void RendererProcessor::HandleFinishedFrames()
+{
+  // Frames can finish in any order, but they're handled in the order they were submitted so that the frames closest
+  // to the playhead are mapped and downloaded first
+  while (!cache_futures_.isEmpty()
+         && cache_futures_.first().wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+    RenderResult result = cache_futures_.takeFirst().get();
+
+    bool fill_frame = fill_frames_.remove(TimeToTimestamp(result.time));
+
+    if (!result.cancelled) {
+      if (qAbs(result.playback_speed) >= kShuttleKeyframeSpeed) {
+        shuttle_frames_.insert(TimeToTimestamp(result.time));
+      } else {
+        shuttle_frames_.remove(TimeToTimestamp(result.time));
+      }
+
+      if (result.playback_divider > 1) {
+        reduced_frames_.insert(TimeToTimestamp(result.time));
+      } else {
+        reduced_frames_.remove(TimeToTimestamp(result.time));
+      }
+
+      // Only frames that were actually rendered say anything about how long rendering takes
+      if (result.cached && result.playback_speed != 0) {
+        UpdatePlaybackDivider(result);
+      }
+    }
+
+    if (result.cancelled) {
+      // Frames cancelled part way through had reserved their hash
+      if (result.cached) {
+        cache_hash_list_.Remove(result.hash);
+      }
+
+      // The frame still needs caching, it'll be prioritized against the rest of the queue again
+      if (!fill_frame) {
+        cache_queue_.Insert(TimeToTimestamp(result.time));
+      } else if (filling_) {
+        fill_queue_.Insert(TimeToTimestamp(result.time));
+      }
+    } else if (result.cached) {
+      FrameCached(result.texture, result.time, result.hash, result.node);
+    } else {
+      FrameSkipped(result.time, result.hash);
+    }
+
+    // Reduced frames will be cached again at full quality, so they can't stand in for any others
+    if (!result.cancelled && result.playback_divider == 1 && qAbs(result.playback_speed) < kShuttleKeyframeSpeed) {
+      MapStaticRange(result);
+    }
+  }
+
+  // Previews are independent of each other, handle them as soon as they're ready
+  for (int i=0;i<preview_futures_.size();i++) {
+    if (preview_futures_.at(i).wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      PreviewFinished(preview_futures_.takeAt(i).get());
+      i--;
+    }
+  }
+}
+
+void RendererProcessor::SubmitPreview(const int64_t &frame)
+{
+  Start();
+
+  if (!started_) {
+    return;
+  }
+
+  // Whatever hasn't started was for where the playhead used to be, full quality frames go back in the queue
+  scheduler_.CancelPending();
+
+  preview_futures_.append(scheduler_.SubmitPreview(NodeDependency(texture_input_->get_connected_output(),
+                                                                  TimestampToTime(frame))));
+
+  PublishStats();
+}
+
+void RendererProcessor::PreviewFinished(const RenderResult &result)
+{
+  if (result.cancelled) {
+    if (result.cached) {
+      cache_hash_list_.Remove(result.hash);
+    }
+
+    // The playhead has moved on, the full quality frame is still in the queue
+    return;
+  }
+
+  // Previews are keyframes at a reduced resolution, so they're cached again at full quality later
+  shuttle_frames_.insert(TimeToTimestamp(result.time));
+  reduced_frames_.insert(TimeToTimestamp(result.time));
+
+  if (result.cached) {
+    FrameCached(result.texture, result.time, result.hash, result.node);
+  } else {
+    FrameSkipped(result.time, result.hash);
+  }
+}
+
+void RendererProcessor::ScrubRested()
+{
+  RecacheShuttleFrames();
+  RecacheReducedFrames();
+
+  CacheNext();
+
+  PublishStats();
+}
+
+void RendererProcessor::RecacheShuttleFrames()
+{
+  foreach (int64_t frame, shuttle_frames_) {
+    cache_queue_.Insert(frame);
+  }
+
+  shuttle_frames_.clear();
+}
+
+void RendererProcessor::RecacheReducedFrames()
+{
+  if (reduced_frames_.isEmpty()) {
+    return;
+  }
+
+  // Node values are cached by time alone, so drop any the reduced frames left behind or they'd be reused
+  if (texture_input_->IsConnected()) {
+    Node* connected = texture_input_->get_connected_output()->parent();
+
+    QList<Node*> nodes = connected->GetDependencies();
+    nodes.append(connected);
+
+    foreach (Node* n, nodes) {
+      foreach (NodeParam* param, n->parameters()) {
+        param->ClearCachedValue();
+      }
+    }
+  }
+
+  foreach (int64_t frame, reduced_frames_) {
+    cache_queue_.Insert(frame);
+  }
+
+  reduced_frames_.clear();
+}
+
+void RendererProcessor::UpdatePlaybackDivider(const RenderResult &result)
+{
+  // Frames submitted before the divider last changed don't reflect it
+  if (result.playback_divider != playback_divider_ || timebase_.isNull()) {
+    return;
+  }
+
+  if (render_time_samples_ == 0) {
+    average_render_time_ = result.render_time;
+  } else {
+    average_render_time_ = (average_render_time_ * 7 + result.render_time) / 8;
+  }
+
+  render_time_samples_++;
+
+  if (render_time_samples_ < kPlaybackDividerSamples) {
+    return;
+  }
+
+  // Frames render in parallel, so each one has as long as all the frames in flight are shown for
+  qint64 budget = static_cast<qint64>(timebase_dbl_ * 1000000000.0 * max_frames_in_flight_
+                                      / qAbs(playback_speed_));
+
+  if (average_render_time_ > budget && playback_divider_ < kMaximumPlaybackDivider) {
+    playback_divider_ *= 2;
+    render_time_samples_ = 0;
+  } else if (playback_divider_ > 1 && average_render_time_ * 4 < budget) {
+    // Halving the divider means up to four times the pixels, so only refine once that would still fit
+    playback_divider_ /= 2;
+    render_time_samples_ = 0;
+  }
+}
+
+void RendererProcessor::FrameCached(RenderTexturePtr texture, const rational& time, const QByteArray& hash, int node)
+{
+  DeferMap(TimeToTimestamp(time), hash);
+
+  if (texture != nullptr) {
+    // We received a texture, time to start downloading it
+    QString fn = CachePathName(hash);
+
+    // Round robin, but only among the download threads on the node the frame was rendered on (if any)
+    int node_count = ThreadAffinity::NodeCount();
+    int thread_index = last_download_thread_ % download_threads_.size();
+
+    for (int i=0;i<download_threads_.size();i++) {
+      int candidate = (last_download_thread_ + i) % download_threads_.size();
+
+      if (node < 0 || candidate % node_count == node) {
+        thread_index = candidate;
+        break;
+      }
+    }
+
+    download_threads_[thread_index]->Queue(texture,
+                                           fn,
+                                           hash);
+
+    last_download_thread_ = thread_index + 1;
+  } else {
+    // There was no texture here, we must update the viewer
+    DownloadThreadComplete(hash);
+  }
+
+  // If the connected output is using this time, signal it to update
+  if (texture_output_->IsConnected()
+      && texture_output_->LastRequestedTime() == time) {
+    texture_output_->push_value(NodeValue(texture), time);
+    SendInvalidateCache(time, time);
+  }
+}
+
+void RendererProcessor::FrameSkipped(const rational& time, const QByteArray& hash)
+{
+  DeferMap(TimeToTimestamp(time), hash);
+
+  if (!IsCaching(hash)) {
+    DownloadThreadComplete(hash);
+
+    // Signal output to update value
+    if (texture_output_->IsConnected()
+        && texture_output_->LastRequestedTime() == time) {
+      texture_output_->ClearCachedValue();
+      SendInvalidateCache(time, time);
+    }
+  }
 }
 
 void RendererProcessor::DownloadThreadComplete(const QByteArray &hash)
 {
-  cache_hash_list_mutex_.lock();
-  cache_hash_list_.removeAll(hash);
-  cache_hash_list_mutex_.unlock();
+  disk_cache_index_lock_.lockForWrite();
+  disk_cache_index_.insert(hash);
+  disk_cache_index_lock_.unlock();
 
-  for (int i=0;i<deferred_maps_.size();i++) {
-    const HashTimeMapping& deferred = deferred_maps_.at(i);
+  cache_hash_list_.Remove(hash);
 
-    if (deferred_maps_.at(i).hash == hash) {
-      // Insert into hash map
-      time_hash_map_.insert(deferred.time, deferred.hash);
+  // Insert any frames waiting on this hash into the hash map
+  QList<int64_t> deferred_frames = deferred_maps_.values(hash);
 
-      deferred_maps_.removeAt(i);
-      i--;
+  foreach (int64_t frame, deferred_frames) {
+    MapFrames(frame, frame, hash);
+  }
+
+  deferred_maps_.remove(hash);
+
+  QList<QPair<int64_t, int64_t> > deferred_ranges = deferred_ranges_.values(hash);
+
+  for (int i=0;i<deferred_ranges.size();i++) {
+    MapFrameRange(deferred_ranges.at(i).first, deferred_ranges.at(i).second, hash);
+  }
+
+  deferred_ranges_.remove(hash);
+}
+
+void RendererProcessor::MapFrames(const int64_t &start, const int64_t &end, const QByteArray &hash)
+{
+  time_hash_map_.InsertRange(start, end, hash);
+
+  // The map ignores negative frames, so do the ranges
+  int64_t first = qMax(Q_INT64_C(0), start);
+
+  if (end >= first) {
+    cached_ranges_.Insert(first, end);
+    dirty_ranges_.Remove(first, end);
+    cache_ranges_changed_ = true;
+  }
+}
+
+void RendererProcessor::RehashRange(const int64_t &start, const int64_t &end, bool dispatch)
+{
+  if (end < start || (!dispatch && rehash_jobs_.isEmpty())) {
+    // Nothing to rehash, or nothing earlier that this range could supersede
+    return;
+  }
+
+  RehashJob job = {next_rehash_job_++, start, end, 0};
+
+  if (dispatch) {
+    NodeOutput* output = texture_input_->get_connected_output();
+
+    for (int64_t i=start;i<=end;i+=kRehashChunkFrames) {
+      rehash_pool_.start(new Rehasher(this, job.id, output, i, qMin(end, i + kRehashChunkFrames - 1)));
+      job.remaining++;
+    }
+  }
+
+  rehash_jobs_.append(job);
+}
+
+void RendererProcessor::HandleRehashedFrames(const QVector<RehashResult> &results,
+                                             const QVector<quint64> &finished_jobs)
+{
+  foreach (const RehashResult& result, results) {
+    if (IsRehashSuperseded(result.job, result.frame)) {
+      continue;
+    }
+
+    if (HasHash(result.hash)) {
+      // Already rendered (often the same hash as before, e.g. for frames a moved clip didn't touch)
+      cache_queue_.Remove(result.frame);
+      MapFrameRange(result.frame, result.frame, result.hash);
+    } else if (IsCaching(result.hash)) {
+      // Another frame is rendering the same image, this one is mapped along with it
+      cache_queue_.Remove(result.frame);
+      DeferMap(result.frame, result.hash);
+    } else {
+      cache_queue_.Insert(result.frame);
+    }
+  }
+
+  foreach (quint64 id, finished_jobs) {
+    for (int i=0;i<rehash_jobs_.size();i++) {
+      if (rehash_jobs_.at(i).id == id) {
+        rehash_jobs_[i].remaining--;
+        break;
+      }
+    }
+  }
+
+  while (!rehash_jobs_.isEmpty() && rehash_jobs_.first().remaining == 0) {
+    rehash_jobs_.removeFirst();
+  }
+}
+
+bool RendererProcessor::IsRehashSuperseded(quint64 job, const int64_t &frame) const
+{
+  // Jobs are in order, so only those at the back can be later than this one
+  for (int i=rehash_jobs_.size()-1;i>=0 && rehash_jobs_.at(i).id>job;i--) {
+    if (frame >= rehash_jobs_.at(i).start && frame <= rehash_jobs_.at(i).end) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void RendererProcessor::PublishStats()
+{
+  PublishGauge(RenderStats::kFramesInFlight,
+               cache_futures_.size() + preview_futures_.size(),
+               &published_frames_in_flight_);
+  PublishGauge(RenderStats::kQueueLength, cache_queue_.Count(), &published_queue_length_);
+  PublishGauge(RenderStats::kDownloadBacklog, deferred_maps_.uniqueKeys().size(), &published_download_backlog_);
+}
+
+void RendererProcessor::PublishGauge(RenderStats::Value gauge, qint64 value, qint64 *published)
+{
+  olive::render_stats.Add(gauge, value - *published);
+  *published = value;
+}
+
+void RendererProcessor::CheckCacheFinished()
+{
+  if (!IsCacheBusy()) {
+    emit CacheFinished();
+  }
+}
+
+void RendererProcessor::CheckFillFinished()
+{
+  if (filling_ && fill_queue_.IsEmpty() && fill_frames_.isEmpty()) {
+    filling_ = false;
+    emit FillFinished();
+  }
+}
+
+bool RendererProcessor::FillQuotaReached() const
+{
+  return !has_cache_range_
+      && static_cast<double>(olive::disk_cache_manager.size())
+         >= static_cast<double>(olive::disk_cache_manager.quota()) * kIdleRenderQuotaRatio;
+}
+
+bool RendererProcessor::IsInCacheRange(const int64_t &frame) const
+{
+  return !has_cache_range_ || (frame >= cache_range_start_ && frame <= cache_range_end_);
+}
+
+void RendererProcessor::UploadThreadComplete(RenderTexturePtr texture, const rational &time, const QByteArray &hash)
+{
+  // Ignore frames from an upload thread that has since been stopped
+  if (sender() != upload_thread_.get()) {
+    return;
+  }
+
+  // Likewise frames it uploaded before it was reconfigured
+  if (texture != nullptr
+      && (texture->width() != effective_width_
+          || texture->height() != effective_height_
+          || (cache_format_ != olive::kCacheFormatBC7 && texture->format() != format_))) {
+    return;
+  }
+
+  int64_t frame = TimeToTimestamp(time);
+
+  if (pending_uploads_.value(frame) == hash) {
+    pending_uploads_.remove(frame);
+  }
+
+  if (texture != nullptr) {
+    ready_frames_.insert(frame, {hash, texture});
+
+    PruneReadyFrames();
+  }
+
+  // If the connected output is waiting on this time, signal it to update
+  if (texture_output_->IsConnected()
+      && texture_output_->LastRequestedTime() == time) {
+    texture_output_->push_value(NodeValue(texture), time);
+    SendInvalidateCache(time, time);
+  }
+}
+
+void RendererProcessor::QueueUpload(const int64_t &frame, const QByteArray &hash)
+{
+  if (!started_ || pending_uploads_.value(frame) == hash) {
+    // Already on its way
+    return;
+  }
+
+  pending_uploads_.insert(frame, hash);
+
+  upload_thread_->Queue(TimestampToTime(frame), hash, CachePathName(hash));
+}
+
+void RendererProcessor::PrefetchFrames(const int64_t &playhead)
+{
+  if (playback_speed_ == 0) {
+    return;
+  }
+
+  for (int i=1;i<kViewerQueueSize;i++) {
+    // The viewer skips frames at faster speeds, so only prepare the ones it'll show
+    int64_t frame = playhead + i * playback_speed_;
+
+    if (!time_hash_map_.Contains(frame)) {
+      // Not cached yet, nothing to prepare
+      continue;
+    }
+
+    QByteArray hash = time_hash_map_.Value(frame);
+
+    if (ready_frames_.value(frame).hash != hash) {
+      QueueUpload(frame, hash);
+    }
+  }
+}
+
+  ReadAheadFrames(playhead);
+}
+
+void RendererProcessor::ReadAheadFrames(const int64_t &playhead)
+{
+  for (int i=kViewerQueueSize;i<kViewerQueueSize+kDiskReadAheadFrames;i++) {
+    int64_t frame = playhead + i * playback_speed_;
+
+    if (!time_hash_map_.Contains(frame)) {
+      continue;
+    }
+
+    QByteArray hash = time_hash_map_.Value(frame);
+
+    if (memory_cache_.Contains(hash)) {
+      continue;
+    }
+
+    // Frames that are only in the memory cache (or still being written) can't be read from disk
+    disk_cache_index_lock_.lockForRead();
+    bool on_disk = disk_cache_index_.contains(hash);
+    disk_cache_index_lock_.unlock();
+
+    if (!on_disk) {
+      continue;
+    }
+
+    QMutexLocker locker(&pending_reads_lock_);
+
+    if (!pending_reads_.contains(hash)) {
+      pending_reads_.insert(hash);
+
+      read_pool_.start(new DiskReader(this, hash, CachePathName(hash)));
+    }
+  }
+}
+
+void RendererProcessor::PruneReadyFrames()
+{
+  int64_t playhead = TimeToTimestamp(texture_output_->LastRequestedTime());
+
+  while (ready_frames_.size() > kViewerQueueSize) {
+    // Discard the frame furthest from the playhead
+    QMap<int64_t, ReadyFrame>::iterator furthest = ready_frames_.begin();
+
+    for (QMap<int64_t, ReadyFrame>::iterator it=ready_frames_.begin();it!=ready_frames_.end();it++) {
+      if (qAbs(it.key() - playhead) > qAbs(furthest.key() - playhead)) {
+        furthest = it;
+      }
     }
+
+    ready_frames_.erase(furthest);
+  }
+}
+
+void RendererProcessor::DiskCacheFileEvicted(const QString &filename)
+{
+  QFileInfo info(filename);
+
+  if (info.absolutePath() != cache_dir_) {
+    // Not one of our frames
+    return;
   }
+
+  disk_cache_index_lock_.lockForWrite();
+  disk_cache_index_.remove(QByteArray::fromHex(info.completeBaseName().toLatin1()));
+  disk_cache_index_lock_.unlock();
 }
 
 RendererThreadBase* RendererProcessor::CurrentThread()
@@ -503,6 +1892,13 @@ RendererThreadBase* RendererProcessor::CurrentThread()
   return dynamic_cast<RendererThreadBase*>(QThread::currentThread());
 }
 
+QOpenGLContext *RendererProcessor::ShareContext()
+{
+  Start();
+
+  return started_ ? share_ctx_ : nullptr;
+}
+
 RenderInstance *RendererProcessor::CurrentInstance()
 {
   RendererThreadBase* thread = CurrentThread();
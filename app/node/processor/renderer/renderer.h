@@ -21,14 +21,32 @@
 #ifndef RENDERER_H
 #define RENDERER_H
 
-#include <QLinkedList>
+#include <memory>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
 #include <QOpenGLTexture>
+#include <QReadWriteLock>
+#include <QSet>
+#include <QSize>
+#include <QTimer>
 
+#include "common/framerangeset.h"
 #include "node/node.h"
 #include "render/pixelformat.h"
 #include "render/rendermodes.h"
+#include "render/renderstats.h"
+#include "render/cacheformat.h"
 #include "rendererdownloadthread.h"
-#include "rendererprocessthread.h"
+#include "renderercachequeue.h"
+#include "rendererframemap.h"
+#include "rendererhashset.h"
+#include "rendererintermediatecache.h"
+#include "renderermemorycache.h"
+#include "rendererscheduler.h"
+#include "rendereruploadthread.h"
 
 /**
  * @brief A multithreaded OpenGL based renderer for node systems
@@ -45,13 +63,13 @@ public:
    */
   RendererProcessor();
 
+  virtual ~RendererProcessor() override;
+
   virtual QString Name() override;
   virtual QString Category() override;
   virtual QString Description() override;
   virtual QString id() override;
 
-  void SetCacheName(const QString& s);
-
   virtual void Release() override;
 
   virtual void InvalidateCache(const rational &start_range, const rational &end_range, NodeInput *from = nullptr) override;
@@ -62,7 +80,8 @@ public:
    * @brief Set parameters of the Renderer
    *
    * The Renderer owns the buffers that are used in the rendering process and this function sets the kind of buffers
-   * to use. The Renderer must be stopped when calling this function.
+   * to use. Frames in flight are discarded, but unless the mode changes the threads and their contexts are kept and
+   * only reconfigured (see Reconfigure()).
    *
    * @param width
    *
@@ -75,6 +94,11 @@ public:
    * @param format
    *
    * Buffer pixel format
+   *
+   * @param divider
+   *
+   * Resolution divider, only used until a display size is known if kMatchDisplayResolution is set (see
+   * SetDisplaySize())
    */
   void SetParameters(const int& width,
                      const int& height,
@@ -84,11 +108,84 @@ public:
 
   void SetDivider(const int& divider);
 
+  /**
+   * @brief Set the size in device pixels the output is shown at
+   *
+   * If kMatchDisplayResolution is set, the divider follows it: the largest power of two (up to kMaximumDisplayDivider)
+   * that still renders at least as many pixels as are displayed. Frames at other dividers are cached under a different
+   * cache ID, so a smaller viewer never replaces full resolution frames on disk.
+   *
+   * @return TRUE if the divider changed and the displayed frame should be requested again
+   */
+  bool SetDisplaySize(const QSize& size);
+
+  /**
+   * @brief Set the format frames are stored in on disk
+   *
+   * Use RendererCacheCodec::FormatForPriority() to choose one from a Sequence's cache priority.
+   */
+  void SetCacheFormat(const olive::CacheFormat& format);
+
+  /**
+   * @brief Set the speed the attached viewer is playing at (negative for reverse, 0 when paused)
+   *
+   * Frames ahead of the playhead are prioritized during playback, and frames that haven't started rendering are
+   * cancelled once the playhead passes them.
+   */
+  void SetPlaybackSpeed(const int& speed);
+  const int& playback_speed() const;
+
+  /**
+   * @brief How much media is reduced during playback to keep up (see RenderInstance::playback_divider())
+   *
+   * Chosen automatically from how long frames take to render against how long each one is shown for: doubled (up to
+   * kMaximumPlaybackDivider) while playback falls behind and halved once there's room again. Frames rendered reduced
+   * are cached again at full quality once playback stops. Unlike SetDivider(), this never reconfigures the threads
+   * or changes the cache ID. Always 1 while paused.
+   */
+  const int& playback_divider() const;
+
+  /**
+   * @brief Queue every frame of the sequence that isn't cached yet, to be rendered in the background
+   *
+   * These are only taken once nothing else is queued, and stop once the disk cache reaches kIdleRenderQuotaRatio of
+   * its quota. FillFinished() is emitted once they've all been rendered or StopFill() is called.
+   */
+  void FillCache();
+
+  /**
+   * @brief Discard the frames queued by FillCache() and cancel any that haven't started rendering yet
+   */
+  void StopFill();
+
+  /**
+   * @brief Only cache frames `start` to `end` (inclusive, in the renderer's timebase), e.g. a render farm worker's share
+   *
+   * Invalidated frames outside the range are dropped instead of rendered, and FillCache() only queues frames inside
+   * it. The range was asked for explicitly, so filling it isn't limited by the idle render quota either.
+   */
+  void SetCacheRange(const int64_t& start, const int64_t& end);
+
+  /**
+   * @brief Returns TRUE while any frame is still queued, rendering or downloading (see CacheFinished())
+   */
+  bool IsCacheBusy() const;
+
   /**
    * @brief Return whether a frame with this hash already exists
    */
   bool HasHash(const QByteArray& hash);
 
+  /**
+   * @brief Frames (in the renderer's timebase) that are cached and up to date
+   */
+  const FrameRangeSet& cached_ranges() const;
+
+  /**
+   * @brief Frames that have been invalidated and not cached again yet, they may still show an older version
+   */
+  const FrameRangeSet& dirty_ranges() const;
+
   /**
    * @brief Return whether a frame is currently being cached
    */
@@ -99,6 +196,11 @@ public:
    */
   bool TryCache(const QByteArray& hash);
 
+  /**
+   * @brief Textures rendered part way up the graph that RendererScheduler can reuse for later frames
+   */
+  RendererIntermediateCache* intermediate_cache();
+
   /**
    * @brief Return current instance of a RenderThread (or nullptr if there is none)
    *
@@ -107,6 +209,14 @@ public:
    */
   static RendererThreadBase* CurrentThread();
 
+  /**
+   * @brief Return the context the render threads share resources with, starting the backend if necessary
+   *
+   * Other threads that render or read back the same nodes' textures (e.g. ExportTask) should share with this context
+   * too. Must be called from the main thread. Returns nullptr if the backend couldn't be started.
+   */
+  QOpenGLContext* ShareContext();
+
   static RenderInstance* CurrentInstance();
 
   NodeInput* texture_input();
@@ -115,15 +225,26 @@ public:
 
   NodeOutput* texture_output();
 
+signals:
+  /**
+   * @brief Emitted whenever every queued frame has been rendered and written to the disk cache
+   */
+  void CacheFinished();
+
+  /**
+   * @brief Emitted when the frames queued by FillCache() have all been rendered or StopFill() was called
+   */
+  void FillFinished();
+
+  /**
+   * @brief Emitted when cached_ranges() or dirty_ranges() change, at most once per batch of completed frames
+   */
+  void CacheRangesChanged();
+
 protected:
-  virtual QVariant Value(NodeOutput* output, const rational& time) override;
+  virtual NodeValue Value(NodeOutput* output, const rational& time) override;
 
 private:
-  struct HashTimeMapping {
-    rational time;
-    QByteArray hash;
-  };
-
   /**
    * @brief Allocate and start the multithreaded backend
    */
@@ -134,6 +255,37 @@ private:
    */
   void Stop();
 
+  /**
+   * @brief Switch the running backend over to the current size and format without stopping it
+   *
+   * Frames in flight are cancelled and the threads change their RenderInstances in place once they're idle (see
+   * RendererThreadBase::Reconfigure()), so their contexts and compiled shaders survive. What's cached in memory is
+   * thrown away as it is with Stop(). Does nothing if the backend isn't started.
+   */
+  void Reconfigure();
+
+  /**
+   * @brief Create and start download thread `index`, which must already have a slot in download_threads_
+   */
+  void StartDownloadThread(int index);
+
+  /**
+   * @brief Add or remove render and download threads to match the performance profile, keeping the rest running
+   *
+   * Render threads are changed through RendererScheduler::SetThreadCount(). Removed download threads finish what
+   * they've been given first. Does nothing if the backend isn't started.
+   */
+  void ResizeThreads();
+
+  /**
+   * @brief Return a context for the render threads to share when none is current, creating it if necessary
+   *
+   * Normally the renderer shares the context the viewer made current. Without a GUI (see Core::RunHeadless()) there
+   * isn't one, so the renderer creates its own on a QOffscreenSurface, which doesn't need a display. Returns nullptr
+   * if the context couldn't be created.
+   */
+  QOpenGLContext* OffscreenContext();
+
   /**
    * @brief Internal function for generating the cache ID
    */
@@ -146,25 +298,140 @@ private:
    */
   void CacheNext();
 
+  /**
+   * @brief Queue the frames in shuttle_frames_ to be cached again at normal quality
+   */
+  void RecacheShuttleFrames();
+
+  /**
+   * @brief Queue the frames in reduced_frames_ to be cached again at full quality
+   */
+  void RecacheReducedFrames();
+
+  /**
+   * @brief Show a low resolution version of a frame that isn't cached yet while the playhead is being dragged
+   *
+   * Anything submitted that hasn't started is cancelled first since the playhead has moved on from it. The full
+   * quality frame is rendered once the playhead rests (see ScrubRested()).
+   */
+  void SubmitPreview(const int64_t& frame);
+
+  /**
+   * @brief Handle the result of a frame submitted with SubmitPreview()
+   */
+  void PreviewFinished(const RenderResult& result);
+
+  /**
+   * @brief Adjust playback_divider_ with the time a frame took to render during playback
+   */
+  void UpdatePlaybackDivider(const RenderResult& result);
+
   bool ShouldPushTexture(const rational &time);
 
+  /**
+   * @brief Emit CacheFinished() if there's nothing left to render or download
+   */
+  void CheckCacheFinished();
+
+  /**
+   * @brief Emit FillFinished() if every frame queued by FillCache() has been rendered
+   */
+  void CheckFillFinished();
+
+  /**
+   * @brief Returns TRUE if the disk cache has grown too large for FillCache() to add to it
+   */
+  bool FillQuotaReached() const;
+
+  /**
+   * @brief Returns whether `frame` is within the range set with SetCacheRange() (always TRUE if none was set)
+   */
+  bool IsInCacheRange(const int64_t& frame) const;
+
+  /**
+   * @brief Update this renderer's share of the gauges in olive::render_stats
+   */
+  void PublishStats();
+
+  static void PublishGauge(RenderStats::Value gauge, qint64 value, qint64* published);
+
+  /**
+   * @brief Returns TRUE if the viewer is waiting on this frame or will show it shortly during playback
+   *
+   * These frames are submitted as RendererScheduler::kPriorityInteractive so they preempt background cache work.
+   */
+  bool IsInteractive(const int64_t& frame);
+
+  /**
+   * @brief Convert a time to a timestamp in timebase_, rounding down to the nearest frame
+   */
+  int64_t TimeToTimestamp(const rational& time);
+
+  rational TimestampToTime(const int64_t& timestamp);
+
   /**
    * @brief Return the path of the cached image at this time
    */
   QString CachePathName(const QByteArray &hash);
 
-  void DeferMap(const rational &time, const QByteArray &hash);
+  /**
+   * @brief Map `frame` to `hash` once the hash has finished downloading
+   */
+  void DeferMap(const int64_t &frame, const QByteArray &hash);
+
+  /**
+   * @brief Map every other frame a finished frame's hash holds for to it too (see RenderResult::static_in)
+   *
+   * They're taken out of the cache queue, so a held still is only rendered and hashed once.
+   */
+  void MapStaticRange(const RenderResult& result);
 
   /**
-   * @brief Internal list of RenderProcessThreads
+   * @brief Map frames `start` to `end` inclusive to a hash that's been cached, updating the viewer if it's among them
    */
-  QVector<RendererProcessThreadPtr> threads_;
+  void MapFrameRange(const int64_t& start, const int64_t& end, const QByteArray& hash);
+
+  /**
+   * @brief Called when a frame has finished rendering (and needs downloading)
+   *
+   * `node` is the NUMA node it was rendered on (see RenderResult::node), a download thread on the same node is used.
+   */
+  void FrameCached(RenderTexturePtr texture, const rational& time, const QByteArray& hash, int node);
+
+  /**
+   * @brief Called when a frame didn't need rendering because it's already cached
+   */
+  void FrameSkipped(const rational &time, const QByteArray &hash);
+
+  /**
+   * @brief Map the frames waiting on a hash now that it's cached
+   */
+  void DownloadThreadComplete(const QByteArray &hash);
+
+  /**
+   * @brief Handle every submitted frame whose future is ready, in the order they were submitted
+   */
+  void HandleFinishedFrames();
+
+  /**
+   * @brief Have DrainCompletions() run on this object's thread, unless it's already going to
+   *
+   * Safe to call from any thread.
+   */
+  void ScheduleDrain();
+
+  /**
+   * @brief Schedules rendering on the background threads
+   */
+  RendererScheduler scheduler_;
 
   /**
    * @brief Internal variable that contains whether the Renderer has started or not
    */
   bool started_;
 
+  QOpenGLContext* share_ctx_;
+
   NodeInput* texture_input_;
 
   NodeInput* length_input_;
@@ -176,7 +443,41 @@ private:
 
   void CalculateEffectiveDimensions();
 
+  /**
+   * @brief Divider matching display_size_ for the current dimensions (see SetDisplaySize())
+   *
+   * Multiplied by vram_divider_ while VRAM is short.
+   */
+  int DisplayDivider() const;
+
+  /**
+   * @brief Switch to DisplayDivider() if it's changed and have the viewer request its frame again
+   */
+  void UpdateDisplayDivider();
+
+  /**
+   * @brief Number of render threads to start with, the profile's unless VRAM pressure has limited it
+   */
+  int EffectiveRenderThreadCount() const;
+
+  /**
+   * @brief Determine how many frames can be rendered at once for the current parameters
+   *
+   * Every frame in flight holds its textures in VRAM until it's downloaded, so this is limited by both the number of
+   * render threads and kRenderMemoryBudget.
+   */
+  void CalculateMaximumFramesInFlight(int thread_count);
+
+  /**
+   * @brief Returns the number of frames that can be rendered at once right now
+   *
+   * Normally the result of CalculateMaximumFramesInFlight(), but only 1 while olive::image_cache or
+   * olive::vram_monitor is under pressure.
+   */
+  int MaximumFramesInFlight() const;
+
   int divider_;
+  QSize display_size_;
   int effective_width_;
   int effective_height_;
 
@@ -184,37 +485,403 @@ private:
 
   olive::RenderMode mode_;
 
+  olive::CacheFormat cache_format_;
+
+  std::unique_ptr<QOffscreenSurface> offscreen_surface_;
+  std::unique_ptr<QOpenGLContext> offscreen_context_;
+
   rational timebase_;
   double timebase_dbl_;
 
-  QLinkedList<rational> cache_queue_;
-  QString cache_name_;
-  qint64 cache_time_;
+  /**
+   * @brief Frames waiting to be cached, as timestamps in timebase_
+   */
+  RendererCacheQueue cache_queue_;
+
+  /**
+   * @brief Frames queued by FillCache(), only taken once cache_queue_ is empty
+   */
+  RendererCacheQueue fill_queue_;
+
+  /**
+   * @brief Frames taken from fill_queue_ that are being rendered
+   */
+  QSet<int64_t> fill_frames_;
+
+  bool filling_;
+
+  /**
+   * @brief Set by SetCacheRange()
+   */
+  bool has_cache_range_;
+  int64_t cache_range_start_;
+  int64_t cache_range_end_;
+
+  int playback_speed_;
+
+  /**
+   * @brief Frames (as timestamps in timebase_) that were last cached while shuttling
+   *
+   * Shuttle frames are reduced quality keyframes (see Decoder::keyframes_only()), so these are cached again once
+   * shuttling stops.
+   */
+  QSet<int64_t> shuttle_frames_;
+
+  int playback_divider_;
+
+  /**
+   * @brief Moving average of how long frames have taken to render at the current playback_divider_, in nanoseconds
+   */
+  qint64 average_render_time_;
+
+  /**
+   * @brief Number of frames average_render_time_ was measured from
+   */
+  int render_time_samples_;
+
+  /**
+   * @brief Frames (as timestamps in timebase_) that were last cached with a playback_divider_ above 1
+   */
+  QSet<int64_t> reduced_frames_;
+
   QString cache_id_;
 
-  bool caching_;
-  QVector<uchar*> cache_frame_load_buffer_;
+  /**
+   * @brief Directory containing this renderer's cached frames, updated whenever the cache ID changes
+   */
+  QString cache_dir_;
+
+  /**
+   * @brief Frames submitted to the scheduler that haven't been handled yet, in the order they were submitted
+   */
+  QList<RenderFuture> cache_futures_;
+
+  /**
+   * @brief Previews submitted to the scheduler that haven't been handled yet (see SubmitPreview())
+   */
+  QList<RenderFuture> preview_futures_;
+
+  /**
+   * @brief Last frame (as a timestamp in timebase_) the viewer asked for, or -1 if it hasn't asked yet
+   */
+  int64_t last_requested_frame_;
+
+  /**
+   * @brief Running while the playhead is being dragged, times out once it has rested for kScrubRestInterval
+   *
+   * Nothing new is taken from cache_queue_ while it's running so previews don't wait behind full quality frames the
+   * playhead is about to leave.
+   */
+  QTimer scrub_timer_;
+
+  /**
+   * @brief Maximum number of frames to render at once (see CalculateMaximumFramesInFlight())
+   */
+  int max_frames_in_flight_;
+
+  /**
+   * @brief Number of threads the scheduler was started with (see PerformanceProfile::Values::render_threads)
+   */
+  int render_thread_count_;
+
+  /**
+   * @brief Maximum render threads while VRAM is short (see CheckVRAM()), 0 for no limit
+   */
+  int vram_thread_limit_;
+
+  /**
+   * @brief Extra divider while VRAM is short (see CheckVRAM()), 1 for none
+   */
+  int vram_divider_;
+
+  /**
+   * @brief Checks VRAM again every kVRAMDegradeInterval while it's short or we're using less because it was
+   */
+  QTimer vram_timer_;
+
+  /**
+   * @brief Started when VRAM pressure returns to normal, invalid while there's pressure
+   */
+  QElapsedTimer vram_normal_since_;
+
+  /**
+   * @brief Started each time CheckVRAM() takes a step to use less VRAM
+   */
+  QElapsedTimer vram_last_degrade_;
+
+  /**
+   * @brief Decoded frames kept in memory in front of the disk cache
+   */
+  RendererMemoryCache memory_cache_;
+
+  RendererIntermediateCache intermediate_cache_;
 
   QVector<RendererDownloadThreadPtr> download_threads_;
+
+  /**
+   * @brief I/O threads that encode downloaded frames and write them to the disk cache
+   */
+  QThreadPool write_pool_;
+
   int last_download_thread_;
 
-  RenderTexturePtr master_texture_;
+  /**
+   * @brief Loads cached frames into textures for the viewer so the GUI thread never does
+   */
+  RendererUploadThreadPtr upload_thread_;
+
+  struct ReadyFrame {
+    QByteArray hash;
+    RenderTexturePtr texture;
+  };
+
+  /**
+   * @brief Frames the upload thread has prepared, at most kViewerQueueSize of the ones closest to the playhead
+   */
+  QMap<int64_t, ReadyFrame> ready_frames_;
+
+  /**
+   * @brief Frames queued on the upload thread that haven't come back yet
+   */
+  QMap<int64_t, QByteArray> pending_uploads_;
+
+  /**
+   * @brief Have the upload thread prepare a frame unless it's already been asked to
+   */
+  void QueueUpload(const int64_t& frame, const QByteArray& hash);
+
+  /**
+   * @brief During playback, have the upload thread prepare the next frames after this one
+   */
+  void PrefetchFrames(const int64_t& playhead);
+
+  /**
+   * @brief Discard ready frames beyond kViewerQueueSize, furthest from the playhead first
+   */
+  void PruneReadyFrames();
+
+  class DiskReader;
 
-  QMap<rational, QByteArray> time_hash_map_;
+  /**
+   * @brief I/O threads that read cached frames from the disk cache into memory_cache_ ahead of playback
+   *
+   * Decoding a cached frame usually takes longer than showing it, so reading several at once keeps cached playback
+   * limited by disk bandwidth rather than by the upload thread reading one frame at a time.
+   */
+  QThreadPool read_pool_;
 
-  QMutex cache_hash_list_mutex_;
-  QVector<QByteArray> cache_hash_list_;
+  /**
+   * @brief Hashes of the frames read_pool_ is reading, so that each is only read once
+   */
+  QSet<QByteArray> pending_reads_;
+  QMutex pending_reads_lock_;
 
-  QList<HashTimeMapping> deferred_maps_;
+  /**
+   * @brief During playback, read the kDiskReadAheadFrames cached frames after the upload thread's into memory
+   */
+  void ReadAheadFrames(const int64_t& playhead);
+
+  /**
+   * @brief The hash of each frame (as a timestamp in timebase_) that has been cached
+   */
+  RendererFrameMap time_hash_map_;
+
+  /**
+   * @brief Ranges of time_hash_map_ that are up to date, and ranges invalidated since they were mapped
+   *
+   * Maintained alongside time_hash_map_ so spans of cached frames can be found (and skipped) without looking up every
+   * frame, and so the viewer can draw them.
+   */
+  FrameRangeSet cached_ranges_;
+  FrameRangeSet dirty_ranges_;
+
+  /**
+   * @brief Set when the ranges change, CacheRangesChanged() is emitted once the current batch has been handled
+   */
+  bool cache_ranges_changed_;
+
+  /**
+   * @brief Map frames from `start` to `end` to a hash in time_hash_map_, keeping the cached ranges current
+   */
+  void MapFrames(const int64_t& start, const int64_t& end, const QByteArray& hash);
+
+  class Rehasher;
+
+  /**
+   * @brief A frame's hash worked out by a Rehasher after it was invalidated
+   */
+  struct RehashResult {
+    quint64 job;
+    int64_t frame;
+    QByteArray hash;
+  };
+
+  /**
+   * @brief An invalidated range being rehashed, split into chunks of kRehashChunkFrames across rehash_pool_
+   */
+  struct RehashJob {
+    quint64 id;
+    int64_t start;
+    int64_t end;
+
+    /// Chunks that haven't been handled yet
+    int remaining;
+  };
+
+  /**
+   * @brief Work out the new hashes of an invalidated range in the background
+   *
+   * Frames whose new hash is already cached are mapped to it straight away by HandleRehashedFrames(), only the rest are
+   * queued to render. If `dispatch` is FALSE nothing is hashed, the range is only recorded so results of earlier jobs
+   * for it are discarded (e.g. while an interactive edit is still changing it).
+   */
+  void RehashRange(const int64_t& start, const int64_t& end, bool dispatch);
+
+  /**
+   * @brief Map or queue rehashed frames, and retire the jobs whose chunks have all finished
+   */
+  void HandleRehashedFrames(const QVector<RehashResult>& results, const QVector<quint64>& finished_jobs);
+
+  /**
+   * @brief Returns whether a later job covers `frame`, making `job`'s hash of it out of date
+   */
+  bool IsRehashSuperseded(quint64 job, const int64_t& frame) const;
+
+  /**
+   * @brief Hashes of every frame in the disk cache
+   *
+   * Filled by scanning cache_dir_ once in Start() and kept current as downloads complete so HasHash() doesn't need to
+   * touch the filesystem.
+   */
+  QSet<QByteArray> disk_cache_index_;
+  QReadWriteLock disk_cache_index_lock_;
+
+  /**
+   * @brief Fill disk_cache_index_ from the contents of cache_dir_
+   */
+  void ScanDiskCache();
+
+  /**
+   * @brief Hashes of frames currently being rendered or downloaded
+   */
+  RendererHashSet cache_hash_list_;
+
+  /**
+   * @brief Frames waiting for their hash to finish downloading before they're mapped to it
+   */
+  QMultiHash<QByteArray, int64_t> deferred_maps_;
+
+  /**
+   * @brief Ranges of frames (first and last inclusive) waiting for their hash like deferred_maps_
+   *
+   * See MapStaticRange().
+   *
+   * Always accompanied by an entry in deferred_maps_ for the frame the hash was rendered for.
+   */
+  QMultiHash<QByteArray, QPair<int64_t, int64_t> > deferred_ranges_;
+
+  /**
+   * @brief The values this renderer last added to olive::render_stats's gauges (see PublishStats())
+   */
+  qint64 published_frames_in_flight_;
+  qint64 published_queue_length_;
+  qint64 published_download_backlog_;
+
+  /**
+   * @brief Range invalidated during an interactive edit that hasn't been queued yet (see NodeInteractiveEdit)
+   */
+  bool has_interactive_range_;
+  rational interactive_in_;
+  rational interactive_out_;
+
+  /**
+   * @brief Jobs started by RehashRange(), oldest first
+   *
+   * Jobs are only retired from the front, so a job's results can always be checked against every later one.
+   */
+  QList<RehashJob> rehash_jobs_;
+
+  quint64 next_rehash_job_;
+
+  /**
+   * @brief Hashes written to the disk cache since the last DrainCompletions(), protected by completions_lock_
+   */
+  QVector<QByteArray> downloaded_hashes_;
+
+  /**
+   * @brief Frames rehashed since the last DrainCompletions() and the job of each chunk that finished, protected by
+   * completions_lock_
+   */
+  QVector<RehashResult> rehashed_frames_;
+  QVector<quint64> finished_rehash_chunks_;
+
+  QMutex completions_lock_;
+
+  /**
+   * @brief Raised while a DrainCompletions() is queued, so completions in the meantime don't queue another
+   */
+  QAtomicInt drain_pending_;
+
+  /**
+   * @brief Threads that rehash invalidated ranges (see RehashRange())
+   *
+   * Declared last so it's destroyed (and waits for its Rehashers) before anything they use.
+   */
+  QThreadPool rehash_pool_;
 
 private slots:
-  void ThreadCallback(RenderTexturePtr texture, const rational& time, const QByteArray& hash);
+  /**
+   * @brief Receives RendererScheduler::FrameFinished() (in a worker thread) and schedules a drain
+   */
+  void SchedulerFrameFinished();
 
-  void ThreadRequestSibling(NodeDependency dep);
+  /**
+   * @brief Receives RendererDownloadThread::Downloaded() (in a write thread) and schedules a drain
+   */
+  void HashDownloaded(const QByteArray &hash);
 
-  void ThreadSkippedFrame(const rational &time, const QByteArray &hash);
+  /**
+   * @brief Handle every frame and download completed since the last drain, then update everything that depends on
+   * them once
+   *
+   * Completions arrive from worker and write threads one at a time, which would otherwise flood this thread's event
+   * loop with a queued call each during a fast cache fill.
+   */
+  void DrainCompletions();
 
-  void DownloadThreadComplete(const QByteArray &hash);
+  /**
+   * @brief Receives scrub_timer_'s timeout and queues the frames previewed while scrubbing at full quality
+   */
+  void ScrubRested();
+
+  /**
+   * @brief Receives RendererUploadThread::FrameUploaded() and passes the frame on to the output if it's waiting on it
+   */
+  void UploadThreadComplete(RenderTexturePtr texture, const rational& time, const QByteArray& hash);
+
+  /**
+   * @brief Receives DiskCacheManager::FileEvicted() and removes the frame from disk_cache_index_ if it's one of ours
+   */
+  void DiskCacheFileEvicted(const QString& filename);
+
+  /**
+   * @brief Receives NodeInteractiveEdit::Finished() and queues the range invalidated during the edit
+   */
+  void InteractiveEditFinished();
+
+  /**
+   * @brief Receives PerformanceProfile::Changed() and adds or removes threads if their counts have changed
+   */
+  void PerformanceProfileChanged();
+
+  /**
+   * @brief Use less VRAM while olive::vram_monitor's pressure is critical, and go back to normal once it's recovered
+   *
+   * Each kVRAMDegradeInterval that pressure stays critical, the render threads are halved, or when there's only one
+   * left, the divider of an offline render is doubled. Everything is restored once there's been no pressure for
+   * kVRAMRecoveryDelay.
+   */
+  void CheckVRAM();
 
 };
 
@@ -0,0 +1,518 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderercachecodec.h"
+
+#include <climits>
+#include <cstring>
+#include <OpenImageIO/filesystem.h>
+#include <OpenImageIO/imageio.h>
+#include <QAtomicInt>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "common/define.h"
+#include "config/config.h"
+#include "common/filefunctions.h"
+#include "render/cachepack.h"
+#include "render/gl/blockcompressor.h"
+#include "render/gl/yuvpacker.h"
+#include "render/pixelservice.h"
+#include "render/profiler.h"
+
+/// Identifies a raw cache frame ("ORAW")
+const quint32 kRawMagic = 0x4F524157;
+
+const quint32 kRawVersion = 1;
+
+/// Size of the raw frame header (magic, version, width, height and pixel format)
+const qint64 kRawHeaderSize = static_cast<qint64>(5 * sizeof(quint32));
+
+/// Identifies a frame of BC7 blocks ("OBC7")
+const quint32 kBlocksMagic = 0x4F424337;
+
+const quint32 kBlocksVersion = 1;
+
+/// Size of the block frame header (magic, version, width and height)
+const qint64 kBlocksHeaderSize = static_cast<qint64>(4 * sizeof(quint32));
+
+/// Identifies a packed YUV frame ("OYUV")
+const quint32 kYUVMagic = 0x4F595556;
+
+const quint32 kYUVVersion = 1;
+
+/// Size of the packed YUV frame header (magic, version, width, height and vertical subsampling)
+const qint64 kYUVHeaderSize = static_cast<qint64>(5 * sizeof(quint32));
+
+/// Makes the temporary filenames of concurrent writes unique within this process
+static QAtomicInt working_file_counter;
+
+olive::CacheFormat RendererCacheCodec::FormatForPriority(const olive::CachePriority &priority)
+{
+  switch (priority) {
+  case olive::kCachePrioritizeSpeed:
+    return olive::kCacheFormatRaw;
+  case olive::kCachePrioritizeBalanced:
+    return olive::kCacheFormatLossless;
+  case olive::kCachePrioritizeBandwidth:
+    return olive::kCacheFormatBC7;
+  case olive::kCachePrioritizeReview:
+    return kReviewCacheFormat;
+  case olive::kCachePrioritizeDiskSpace:
+    break;
+  }
+
+  return olive::kCacheFormatEXR;
+}
+
+bool RendererCacheCodec::IsYUV(const olive::CacheFormat &format)
+{
+  return (format == olive::kCacheFormatYUV422 || format == olive::kCacheFormatYUV420);
+}
+
+bool RendererCacheCodec::IsVerticallySubsampled(const olive::CacheFormat &format)
+{
+  return (format == olive::kCacheFormatYUV420);
+}
+
+QString RendererCacheCodec::GetExtension(const olive::CacheFormat &format)
+{
+  switch (format) {
+  case olive::kCacheFormatRaw:
+    return "raw";
+  case olive::kCacheFormatBC7:
+    return "bc7";
+  case olive::kCacheFormatYUV422:
+  case olive::kCacheFormatYUV420:
+    return "yuv";
+  case olive::kCacheFormatLossless:
+  case olive::kCacheFormatEXR:
+    break;
+  }
+
+  return "exr";
+}
+
+bool RendererCacheCodec::Write(const QString &filename,
+                               const olive::CacheFormat &format,
+                               const int &width,
+                               const int &height,
+                               const olive::PixelFormat &pix_fmt,
+                               const QByteArray &pixels)
+{
+  ProfilerTimer timer(Profiler::kDiskWrite);
+
+  QByteArray data;
+
+  switch (format) {
+  case olive::kCacheFormatRaw:
+    data = EncodeRaw(width, height, pix_fmt, pixels);
+    break;
+  case olive::kCacheFormatLossless:
+    data = EncodeEXR("zip", width, height, pix_fmt, pixels);
+    break;
+  case olive::kCacheFormatBC7:
+    data = EncodeBlocks(width, height, pixels);
+    break;
+  case olive::kCacheFormatYUV422:
+  case olive::kCacheFormatYUV420:
+    data = EncodeYUV(width, height, IsVerticallySubsampled(format), pixels);
+    break;
+  case olive::kCacheFormatEXR:
+  default:
+    data = EncodeEXR("dwaa:200", width, height, pix_fmt, pixels);
+    break;
+  }
+
+  if (data.isEmpty()) {
+    qWarning() << "Failed to encode cache frame" << filename;
+    return false;
+  }
+
+  // Several machines can't safely append to the same pack, so shared caches keep a file per frame
+  if (HasSharedRenderCache()) {
+    return WriteFile(filename, data);
+  }
+
+  QByteArray hash;
+  CachePack* pack = CachePack::ForFilename(filename, &hash);
+
+  // Neither can several processes on this one, so only the one that owns the pack appends to it
+  if (!pack->IsOwned()) {
+    return WriteFile(filename, data);
+  }
+
+  return pack->Write(hash, data);
+}
+
+bool RendererCacheCodec::Read(const QString &filename,
+                              const olive::CacheFormat &format,
+                              const int &width,
+                              const int &height,
+                              const olive::PixelFormat &pix_fmt,
+                              QByteArray *pixels)
+{
+  // Allocate the destination buffer for every format, block and YUV frames are kept packed until they're drawn
+  if (format == olive::kCacheFormatBC7) {
+    pixels->resize(BlockCompressor::GetCompressedSize(width, height));
+  } else if (IsYUV(format)) {
+    pixels->resize(YUVPacker::GetPackedSize(width, height, IsVerticallySubsampled(format)));
+  } else {
+    pixels->resize(PixelService::GetBufferSize(pix_fmt, width, height));
+  }
+
+  if (!HasSharedRenderCache()) {
+    QByteArray hash;
+    CachePack* pack = CachePack::ForFilename(filename, &hash);
+
+    QByteArray data;
+
+    if (pack->Read(hash, &data)) {
+      return Decode(data, format, width, height, pix_fmt, pixels);
+    }
+  }
+
+  // Shared caches store frames as files, as did caches written before packs were used
+  return ReadFile(filename, format, width, height, pix_fmt, pixels);
+}
+
+bool RendererCacheCodec::WriteFile(const QString &filename, const QByteArray &data)
+{
+  // The process ID keeps the name unique between machines sharing the cache too
+  QFileInfo info(filename);
+
+  QString working_filename = info.dir().filePath(QStringLiteral(".%1.%2-%3.%4").arg(
+                                                   info.completeBaseName(),
+                                                   QString::number(QCoreApplication::applicationPid()),
+                                                   QString::number(working_file_counter.fetchAndAddRelaxed(1)),
+                                                   info.suffix()));
+
+  QFile file(working_filename);
+
+  if (!file.open(QFile::WriteOnly)) {
+    qWarning() << "Failed to open cache frame" << working_filename << "for writing";
+    return false;
+  }
+
+  bool ok = (file.write(data) == data.size());
+
+  file.close();
+
+  if (!ok) {
+    qWarning() << "Failed to write cache frame" << working_filename;
+  } else if (!QFile::rename(working_filename, filename)) {
+    // Frames are named by their content, so if another writer got there first its frame is just as good
+    ok = QFileInfo::exists(filename);
+
+    if (!ok) {
+      qWarning() << "Failed to move cache frame into place at" << filename;
+    }
+  }
+
+  if (!ok || QFileInfo::exists(working_filename)) {
+    QFile::remove(working_filename);
+  }
+
+  return ok;
+}
+
+bool RendererCacheCodec::ReadFile(const QString &filename,
+                                  const olive::CacheFormat &format,
+                                  const int &width,
+                                  const int &height,
+                                  const olive::PixelFormat &pix_fmt,
+                                  QByteArray *pixels)
+{
+  QFile file(filename);
+
+  if (!file.open(QFile::ReadOnly) || file.size() > INT_MAX) {
+    return false;
+  }
+
+  // Map the file rather than reading it so it's decoded straight from the page cache
+  uchar* mapped = file.map(0, file.size());
+
+  if (!mapped) {
+    return false;
+  }
+
+  bool ok = Decode(QByteArray::fromRawData(reinterpret_cast<const char*>(mapped), static_cast<int>(file.size())),
+                   format,
+                   width,
+                   height,
+                   pix_fmt,
+                   pixels);
+
+  file.unmap(mapped);
+
+  if (!ok) {
+    qWarning() << "Cache frame" << filename << "is invalid";
+  }
+
+  return ok;
+}
+
+bool RendererCacheCodec::Decode(const QByteArray &data,
+                                const olive::CacheFormat &format,
+                                const int &width,
+                                const int &height,
+                                const olive::PixelFormat &pix_fmt,
+                                QByteArray *pixels)
+{
+  if (format == olive::kCacheFormatRaw) {
+    return DecodeRaw(data, width, height, pix_fmt, pixels);
+  }
+
+  if (format == olive::kCacheFormatBC7) {
+    return DecodeBlocks(data, width, height, pixels);
+  }
+
+  if (IsYUV(format)) {
+    return DecodeYUV(data, width, height, IsVerticallySubsampled(format), pixels);
+  }
+
+  return DecodeEXR(data, pix_fmt, pixels);
+}
+
+QByteArray RendererCacheCodec::EncodeRaw(const int &width,
+                                         const int &height,
+                                         const olive::PixelFormat &pix_fmt,
+                                         const QByteArray &pixels)
+{
+  QByteArray data;
+  data.reserve(static_cast<int>(kRawHeaderSize) + pixels.size());
+
+  QDataStream stream(&data, QIODevice::WriteOnly);
+
+  stream << kRawMagic
+         << kRawVersion
+         << static_cast<quint32>(width)
+         << static_cast<quint32>(height)
+         << static_cast<quint32>(pix_fmt);
+
+  data.append(pixels);
+
+  return data;
+}
+
+bool RendererCacheCodec::DecodeRaw(const QByteArray &data,
+                                   const int &width,
+                                   const int &height,
+                                   const olive::PixelFormat &pix_fmt,
+                                   QByteArray *pixels)
+{
+  QDataStream stream(data);
+
+  quint32 magic, version, frame_width, frame_height, frame_format;
+
+  stream >> magic >> version >> frame_width >> frame_height >> frame_format;
+
+  // Make sure this frame matches what we expect, the parameters may have changed since it was written
+  if (stream.status() != QDataStream::Ok
+      || magic != kRawMagic
+      || version != kRawVersion
+      || frame_width != static_cast<quint32>(width)
+      || frame_height != static_cast<quint32>(height)
+      || frame_format != static_cast<quint32>(pix_fmt)
+      || data.size() != kRawHeaderSize + pixels->size()) {
+    return false;
+  }
+
+  memcpy(pixels->data(), data.constData() + kRawHeaderSize, static_cast<size_t>(pixels->size()));
+
+  return true;
+}
+
+QByteArray RendererCacheCodec::EncodeBlocks(const int &width, const int &height, const QByteArray &blocks)
+{
+  QByteArray data;
+  data.reserve(static_cast<int>(kBlocksHeaderSize) + blocks.size());
+
+  QDataStream stream(&data, QIODevice::WriteOnly);
+
+  stream << kBlocksMagic
+         << kBlocksVersion
+         << static_cast<quint32>(width)
+         << static_cast<quint32>(height);
+
+  data.append(blocks);
+
+  return data;
+}
+
+bool RendererCacheCodec::DecodeBlocks(const QByteArray &data, const int &width, const int &height, QByteArray *blocks)
+{
+  QDataStream stream(data);
+
+  quint32 magic, version, frame_width, frame_height;
+
+  stream >> magic >> version >> frame_width >> frame_height;
+
+  if (stream.status() != QDataStream::Ok
+      || magic != kBlocksMagic
+      || version != kBlocksVersion
+      || frame_width != static_cast<quint32>(width)
+      || frame_height != static_cast<quint32>(height)
+      || data.size() != kBlocksHeaderSize + blocks->size()) {
+    return false;
+  }
+
+  memcpy(blocks->data(), data.constData() + kBlocksHeaderSize, static_cast<size_t>(blocks->size()));
+
+  return true;
+}
+
+QByteArray RendererCacheCodec::EncodeYUV(const int &width,
+                                         const int &height,
+                                         bool vertical_subsampling,
+                                         const QByteArray &packed)
+{
+  QByteArray data;
+  data.reserve(static_cast<int>(kYUVHeaderSize) + packed.size());
+
+  QDataStream stream(&data, QIODevice::WriteOnly);
+
+  stream << kYUVMagic
+         << kYUVVersion
+         << static_cast<quint32>(width)
+         << static_cast<quint32>(height)
+         << static_cast<quint32>(vertical_subsampling);
+
+  data.append(packed);
+
+  return data;
+}
+
+bool RendererCacheCodec::DecodeYUV(const QByteArray &data,
+                                   const int &width,
+                                   const int &height,
+                                   bool vertical_subsampling,
+                                   QByteArray *packed)
+{
+  QDataStream stream(data);
+
+  quint32 magic, version, frame_width, frame_height, frame_vertical_subsampling;
+
+  stream >> magic >> version >> frame_width >> frame_height >> frame_vertical_subsampling;
+
+  if (stream.status() != QDataStream::Ok
+      || magic != kYUVMagic
+      || version != kYUVVersion
+      || frame_width != static_cast<quint32>(width)
+      || frame_height != static_cast<quint32>(height)
+      || frame_vertical_subsampling != static_cast<quint32>(vertical_subsampling)
+      || data.size() != kYUVHeaderSize + packed->size()) {
+    return false;
+  }
+
+  memcpy(packed->data(), data.constData() + kYUVHeaderSize, static_cast<size_t>(packed->size()));
+
+  return true;
+}
+
+QByteArray RendererCacheCodec::EncodeEXR(const char *compression,
+                                         const int &width,
+                                         const int &height,
+                                         const olive::PixelFormat &pix_fmt,
+                                         const QByteArray &pixels)
+{
+  PixelFormatInfo format_info = PixelService::GetPixelFormatInfo(pix_fmt);
+
+  const char* source = pixels.constData();
+  QByteArray unpacked;
+
+  // OIIO can't write packed pixels, so they're unpacked to the 16-bit type their PixelFormatInfo gives first
+  if (pix_fmt == olive::PIX_FMT_RGB10A2) {
+    unpacked.resize(PixelService::GetBufferSize(olive::PIX_FMT_RGBA16U, width, height));
+    PixelService::ConvertPixels(source, pix_fmt, unpacked.data(), olive::PIX_FMT_RGBA16U, width * height);
+    source = unpacked.constData();
+  }
+
+  // OpenImageIO writes through this proxy into memory instead of to a file
+  std::vector<unsigned char> buffer;
+  OIIO::Filesystem::IOVecOutput proxy(buffer);
+  void* proxy_ptr = &proxy;
+
+  OIIO::ImageSpec spec(width, height, kRGBAChannels, format_info.oiio_desc);
+  spec.attribute("compression", compression);
+  spec.attribute("oiio:ioproxy", OIIO::TypeDesc::PTR, &proxy_ptr);
+
+  std::unique_ptr<OIIO::ImageOutput> out = OIIO::ImageOutput::create("exr");
+
+  if (!out) {
+    qWarning() << "OIIO Error:" << OIIO::geterror().c_str();
+    return QByteArray();
+  }
+
+  bool ok = out->open("frame.exr", spec) && out->write_image(format_info.oiio_desc, source);
+  out->close();
+
+  if (!ok) {
+    return QByteArray();
+  }
+
+  return QByteArray(reinterpret_cast<const char*>(buffer.data()), static_cast<int>(buffer.size()));
+}
+
+bool RendererCacheCodec::DecodeEXR(const QByteArray &data, const olive::PixelFormat &pix_fmt, QByteArray *pixels)
+{
+  OIIO::Filesystem::IOMemReader proxy(const_cast<char*>(data.constData()), static_cast<size_t>(data.size()));
+  void* proxy_ptr = &proxy;
+
+  OIIO::ImageSpec config;
+  config.attribute("oiio:ioproxy", OIIO::TypeDesc::PTR, &proxy_ptr);
+
+  auto in = OIIO::ImageInput::open("frame.exr", &config);
+
+  if (!in) {
+    qWarning() << "OIIO Error:" << OIIO::geterror().c_str();
+    return false;
+  }
+
+  if (pix_fmt != olive::PIX_FMT_RGB10A2) {
+    bool ok = in->read_image(PixelService::GetPixelFormatInfo(pix_fmt).oiio_desc, pixels->data());
+
+    in->close();
+
+    return ok;
+  }
+
+  // Packed pixels are read as 16-bit and packed afterwards (see EncodeEXR())
+  const OIIO::ImageSpec& spec = in->spec();
+  int pixel_count = spec.width * spec.height;
+
+  QByteArray unpacked;
+  unpacked.resize(PixelService::GetBufferSize(olive::PIX_FMT_RGBA16U, spec.width, spec.height));
+
+  bool ok = in->read_image(OIIO::TypeDesc::UINT16, unpacked.data())
+      && PixelService::GetBufferSize(pix_fmt, spec.width, spec.height) == pixels->size();
+
+  in->close();
+
+  if (ok) {
+    PixelService::ConvertPixels(unpacked.constData(), olive::PIX_FMT_RGBA16U, pixels->data(), pix_fmt, pixel_count);
+  }
+
+  return ok;
+}
@@ -0,0 +1,148 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERERCACHECODEC_H
+#define RENDERERCACHECODEC_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "render/cacheformat.h"
+#include "render/pixelformat.h"
+
+/**
+ * @brief Static functions for storing rendered frames in the disk cache in any of the olive::CacheFormat formats
+ */
+class RendererCacheCodec
+{
+public:
+  /**
+   * @brief Return the format best suited to a Sequence's disk space vs. speed priority
+   */
+  static olive::CacheFormat FormatForPriority(const olive::CachePriority& priority);
+
+  /**
+   * @brief Return the file extension (without the dot) used for frames of this format
+   */
+  static QString GetExtension(const olive::CacheFormat& format);
+
+  /**
+   * @brief Returns TRUE for the packed YUV formats (see YUVPacker)
+   */
+  static bool IsYUV(const olive::CacheFormat& format);
+
+  /**
+   * @brief Returns TRUE if a packed YUV format subsamples chroma vertically as well as horizontally (i.e. 4:2:0)
+   */
+  static bool IsVerticallySubsampled(const olive::CacheFormat& format);
+
+  /**
+   * @brief Write a frame buffer to the disk cache
+   *
+   * For olive::kCacheFormatBC7, `pixels` holds the frame's blocks (see BlockCompressor) rather than pixels, and for the
+   * YUV formats it holds the packed frame (see YUVPacker). Read() returns them the same way.
+   *
+   * Frames are appended to the CachePack of the directory they're in, unless the cache is shared with other machines
+   * (see HasSharedRenderCache()) or another process owns the pack (see CachePack::IsOwned()), in which case they're
+   * written to `filename` itself. Files are written to a temporary
+   * file and moved into place once they're complete, so readers (including other machines sharing the cache) never see
+   * a partially written frame. Temporary files start with a dot.
+   *
+   * @return TRUE on success, FALSE if the frame couldn't be written
+   */
+  static bool Write(const QString& filename,
+                    const olive::CacheFormat& format,
+                    const int& width,
+                    const int& height,
+                    const olive::PixelFormat& pix_fmt,
+                    const QByteArray& pixels);
+
+  /**
+   * @brief Read a frame written by Write() into a frame buffer
+   *
+   * @return TRUE on success, FALSE if the frame couldn't be read or doesn't match the parameters provided
+   */
+  static bool Read(const QString& filename,
+                   const olive::CacheFormat& format,
+                   const int& width,
+                   const int& height,
+                   const olive::PixelFormat& pix_fmt,
+                   QByteArray* pixels);
+
+private:
+  static bool WriteFile(const QString& filename, const QByteArray& data);
+
+  static bool ReadFile(const QString& filename,
+                       const olive::CacheFormat& format,
+                       const int& width,
+                       const int& height,
+                       const olive::PixelFormat& pix_fmt,
+                       QByteArray* pixels);
+
+  static bool Decode(const QByteArray& data,
+                     const olive::CacheFormat& format,
+                     const int& width,
+                     const int& height,
+                     const olive::PixelFormat& pix_fmt,
+                     QByteArray* pixels);
+
+  static QByteArray EncodeRaw(const int& width,
+                              const int& height,
+                              const olive::PixelFormat& pix_fmt,
+                              const QByteArray& pixels);
+
+  static bool DecodeRaw(const QByteArray& data,
+                        const int& width,
+                        const int& height,
+                        const olive::PixelFormat& pix_fmt,
+                        QByteArray* pixels);
+
+  /**
+   * @brief Prefix the BC7 blocks of a frame (see BlockCompressor) with a header so they can be validated when read
+   */
+  static QByteArray EncodeBlocks(const int& width, const int& height, const QByteArray& blocks);
+
+  static bool DecodeBlocks(const QByteArray& data, const int& width, const int& height, QByteArray* blocks);
+
+  /**
+   * @brief Prefix a packed YUV frame (see YUVPacker) with a header so it can be validated when read
+   */
+  static QByteArray EncodeYUV(const int& width, const int& height, bool vertical_subsampling, const QByteArray& packed);
+
+  static bool DecodeYUV(const QByteArray& data,
+                        const int& width,
+                        const int& height,
+                        bool vertical_subsampling,
+                        QByteArray* packed);
+
+  /**
+   * @brief Encode an EXR in memory, returns an empty array on failure
+   */
+  static QByteArray EncodeEXR(const char* compression,
+                              const int& width,
+                              const int& height,
+                              const olive::PixelFormat& pix_fmt,
+                              const QByteArray& pixels);
+
+  static bool DecodeEXR(const QByteArray& data, const olive::PixelFormat& pix_fmt, QByteArray* pixels);
+
+};
+
+#endif // RENDERERCACHECODEC_H
@@ -0,0 +1,232 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderercachequeue.h"
+
+#include <QtGlobal>
+
+/// Frames behind the playhead are still cached by their closeness but count as this many times further away
+const int64_t kBehindPlayheadPenalty = 5;
+
+/// Offset added to the priority of frames behind the playhead during playback so they sort after every frame ahead
+const int64_t kBehindPlayheadWhilePlaying = INT32_MAX;
+
+RendererCacheQueue::RendererCacheQueue() :
+  playhead_(0),
+  playback_speed_(0),
+  dirty_(false)
+{
+}
+
+void RendererCacheQueue::SetPlayhead(const int64_t &playhead)
+{
+  if (playhead_ != playhead) {
+    playhead_ = playhead;
+    dirty_ = true;
+  }
+}
+
+void RendererCacheQueue::SetPlaybackSpeed(const int &speed)
+{
+  if (playback_speed_ != speed) {
+    playback_speed_ = speed;
+    dirty_ = true;
+  }
+}
+
+void RendererCacheQueue::Insert(const int64_t &frame)
+{
+  if (positions_.contains(frame)) {
+    return;
+  }
+
+  heap_.append(frame);
+  positions_.insert(frame, heap_.size() - 1);
+
+  // If the heap is getting rebuilt anyway, there's no point sorting this frame now
+  if (!dirty_) {
+    SiftUp(heap_.size() - 1);
+  }
+}
+
+int64_t RendererCacheQueue::TakeFirst()
+{
+  Q_ASSERT(!heap_.isEmpty());
+
+  Reorder();
+
+  int64_t first = heap_.first();
+
+  Swap(0, heap_.size() - 1);
+
+  heap_.removeLast();
+  positions_.remove(first);
+
+  if (!heap_.isEmpty()) {
+    SiftDown(0);
+  }
+
+  return first;
+}
+
+void RendererCacheQueue::Remove(const int64_t &frame)
+{
+  QHash<int64_t, int>::const_iterator position = positions_.constFind(frame);
+
+  if (position == positions_.constEnd()) {
+    return;
+  }
+
+  int index = position.value();
+
+  Swap(index, heap_.size() - 1);
+
+  heap_.removeLast();
+  positions_.remove(frame);
+
+  // The frame moved into its place may belong higher or lower
+  if (index < heap_.size() && !dirty_) {
+    if (index > 0 && HigherPriority(index, (index - 1) / 2)) {
+      SiftUp(index);
+    } else {
+      SiftDown(index);
+    }
+  }
+}
+
+bool RendererCacheQueue::Contains(const int64_t &frame) const
+{
+  return positions_.contains(frame);
+}
+
+bool RendererCacheQueue::IsEmpty() const
+{
+  return heap_.isEmpty();
+}
+
+int RendererCacheQueue::Count() const
+{
+  return heap_.size();
+}
+
+void RendererCacheQueue::Clear()
+{
+  heap_.clear();
+  positions_.clear();
+  dirty_ = false;
+}
+
+int64_t RendererCacheQueue::Priority(const int64_t &frame) const
+{
+  int64_t diff = frame - playhead_;
+
+  // In reverse, frames before the playhead are the ones ahead of it
+  if (playback_speed_ < 0) {
+    diff = -diff;
+  }
+
+  if (diff < 0) {
+    if (playback_speed_ != 0) {
+      // The playhead is moving away from this frame, so cache it after everything ahead of the playhead
+      return kBehindPlayheadWhilePlaying - diff;
+    }
+
+    diff = -diff * kBehindPlayheadPenalty;
+  }
+
+  return diff;
+}
+
+bool RendererCacheQueue::HigherPriority(int a, int b) const
+{
+  int64_t priority_a = Priority(heap_.at(a));
+  int64_t priority_b = Priority(heap_.at(b));
+
+  // Break ties with the earlier frame so the order is stable
+  if (priority_a == priority_b) {
+    return heap_.at(a) < heap_.at(b);
+  }
+
+  return priority_a < priority_b;
+}
+
+void RendererCacheQueue::SiftUp(int index)
+{
+  while (index > 0) {
+    int parent = (index - 1) / 2;
+
+    if (!HigherPriority(index, parent)) {
+      break;
+    }
+
+    Swap(index, parent);
+    index = parent;
+  }
+}
+
+void RendererCacheQueue::SiftDown(int index)
+{
+  while (true) {
+    int left = index * 2 + 1;
+    int right = left + 1;
+    int highest = index;
+
+    if (left < heap_.size() && HigherPriority(left, highest)) {
+      highest = left;
+    }
+
+    if (right < heap_.size() && HigherPriority(right, highest)) {
+      highest = right;
+    }
+
+    if (highest == index) {
+      break;
+    }
+
+    Swap(index, highest);
+    index = highest;
+  }
+}
+
+void RendererCacheQueue::Swap(int a, int b)
+{
+  if (a == b) {
+    return;
+  }
+
+  qSwap(heap_[a], heap_[b]);
+
+  positions_[heap_.at(a)] = a;
+  positions_[heap_.at(b)] = b;
+}
+
+void RendererCacheQueue::Reorder()
+{
+  if (!dirty_) {
+    return;
+  }
+
+  // Floyd's heap construction, sifting down every parent from the bottom up
+  for (int i=heap_.size()/2-1;i>=0;i--) {
+    SiftDown(i);
+  }
+
+  dirty_ = false;
+}
@@ -0,0 +1,112 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERERCACHEQUEUE_H
+#define RENDERERCACHEQUEUE_H
+
+#include <QHash>
+#include <QVector>
+#include <stdint.h>
+
+/**
+ * @brief A priority queue of frames waiting to be cached, ordered by their distance from the playhead
+ *
+ * Frames are stored as timestamps (in the renderer's timebase) in a binary heap, with a hash of each frame's position
+ * in the heap so duplicates can be rejected in constant time. Inserting or taking a frame is O(log n).
+ *
+ * Priorities depend on the playhead, so moving it only marks the heap as dirty. The heap is rebuilt in O(n) the next
+ * time a frame is taken rather than every time the playhead moves.
+ */
+class RendererCacheQueue
+{
+public:
+  RendererCacheQueue();
+
+  /**
+   * @brief Set the timestamp that frames are prioritized by their distance from
+   */
+  void SetPlayhead(const int64_t& playhead);
+
+  /**
+   * @brief Set the current playback speed in frames per frame (negative for reverse, 0 when paused)
+   *
+   * While playing, every frame ahead of the playhead in the direction of playback is cached before any frame behind
+   * it. While paused, frames on either side are cached by their closeness with frames behind the playhead penalized.
+   */
+  void SetPlaybackSpeed(const int& speed);
+
+  /**
+   * @brief Add a frame to the queue if it isn't already queued
+   */
+  void Insert(const int64_t& frame);
+
+  /**
+   * @brief Remove and return the frame with the highest priority (i.e. nearest to the playhead)
+   *
+   * The queue must not be empty.
+   */
+  int64_t TakeFirst();
+
+  /**
+   * @brief Remove a frame from the queue if it's queued (e.g. because it's been mapped along with another)
+   */
+  void Remove(const int64_t& frame);
+
+  bool Contains(const int64_t& frame) const;
+
+  bool IsEmpty() const;
+
+  int Count() const;
+
+  void Clear();
+
+private:
+  /**
+   * @brief Return a frame's distance from the playhead, lower values are cached first
+   */
+  int64_t Priority(const int64_t& frame) const;
+
+  bool HigherPriority(int a, int b) const;
+
+  void SiftUp(int index);
+
+  void SiftDown(int index);
+
+  void Swap(int a, int b);
+
+  /**
+   * @brief Rebuild the heap if the playhead moved since it was last ordered
+   */
+  void Reorder();
+
+  QVector<int64_t> heap_;
+
+  /// Position of each queued frame in heap_
+  QHash<int64_t, int> positions_;
+
+  int64_t playhead_;
+
+  int playback_speed_;
+
+  bool dirty_;
+
+};
+
+#endif // RENDERERCACHEQUEUE_H
@@ -1,32 +1,99 @@
 #include "rendererdownloadthread.h"
 
+#include <QDebug>
 #include <QFile>
 #include <QFloat16>
-#include <OpenImageIO/imageio.h>
+#include <QRunnable>
 
 #include "common/define.h"
+#include "config/config.h"
+#include "render/diskcachemanager.h"
+#include "render/gl/blockcompressor.h"
+#include "render/gl/yuvpacker.h"
+#include "render/imagecache.h"
 #include "render/pixelservice.h"
 
+class RendererDownloadThread::Writer : public QRunnable
+{
+public:
+  Writer(RendererDownloadThread* parent, RenderInstance* instance, const DownloadQueueEntry& entry, const QByteArray& buffer) :
+    parent_(parent),
+    width_(instance->width()),
+    height_(instance->height()),
+    format_(instance->format()),
+    entry_(entry),
+    buffer_(buffer)
+  {
+  }
+
+  virtual void run() override
+  {
+    if (RendererCacheCodec::Write(entry_.filename,
+                                  parent_->cache_format_,
+                                  width_,
+                                  height_,
+                                  format_,
+                                  buffer_)) {
+      olive::disk_cache_manager.Add(entry_.filename);
+
+      emit parent_->Downloaded(entry_.hash);
+    }
+  }
+
+private:
+  RendererDownloadThread* parent_;
+
+  // Copied from the RenderInstance since it's destroyed when the download thread exits, possibly before we run
+  int width_;
+  int height_;
+  olive::PixelFormat format_;
+
+  DownloadQueueEntry entry_;
+
+  QByteArray buffer_;
+};
+
 RendererDownloadThread::RendererDownloadThread(QOpenGLContext *share_ctx,
                                                const int &width,
                                                const int &height,
                                                const int &divider,
                                                const olive::PixelFormat &format,
-                                               const olive::RenderMode &mode) :
+                                               const olive::RenderMode &mode,
+                                               const olive::CacheFormat &cache_format,
+                                               RendererMemoryCache *memory_cache,
+                                               QThreadPool *write_pool) :
   RendererThreadBase(share_ctx, width, height, divider, format, mode),
-  cancelled_(false)
+  cache_format_(cache_format),
+  memory_cache_(memory_cache),
+  write_pool_(write_pool),
+  texture_queue_(kDownloadQueueSize),
+  sleeping_(false),
+  cancelled_(false),
+  finishing_(false)
 {
 }
 
 void RendererDownloadThread::Queue(RenderTexturePtr texture, const QString& fn, const QByteArray &hash)
 {
-  texture_queue_lock_.lock();
+  DownloadQueueEntry entry = {texture, fn, hash};
 
-  texture_queue_.append({texture, fn, hash});
+  while (!texture_queue_.Push(entry)) {
+    if (cancelled_) {
+      return;
+    }
 
-  wait_cond_.wakeAll();
+    // The download thread is far behind, give it a chance to catch up
+    QThread::yieldCurrentThread();
+  }
 
-  texture_queue_lock_.unlock();
+  // Pairs with the fence in ProcessLoop(), either we see it's sleeping or it sees the entry we just pushed
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  if (sleeping_.load(std::memory_order_relaxed)) {
+    texture_queue_lock_.lock();
+    wait_cond_.wakeAll();
+    texture_queue_lock_.unlock();
+  }
 }
 
 void RendererDownloadThread::Cancel()
@@ -40,89 +107,146 @@ void RendererDownloadThread::Cancel()
   wait();
 }
 
-void RendererDownloadThread::ProcessLoop()
+void RendererDownloadThread::Finish()
 {
-  QOpenGLFunctions* f = render_instance()->context()->functions();
-  QOpenGLExtraFunctions* xf = render_instance()->context()->extraFunctions();
+  finishing_ = true;
 
-  f->glGenFramebuffers(1, &read_buffer_);
+  Wake();
 
-  DownloadQueueEntry entry;
+  wait();
+}
 
-  int buffer_size = PixelService::GetBufferSize(render_instance()->format(),
-                                                render_instance()->width(),
-                                                render_instance()->height());
+void RendererDownloadThread::Wake()
+{
+  texture_queue_lock_.lock();
+  wait_cond_.wakeAll();
+  texture_queue_lock_.unlock();
+}
 
-  QVector<uchar> data_buffer;
-  data_buffer.resize(buffer_size);
+void RendererDownloadThread::ProcessLoop()
+{
+  // Ring of pixel buffers that textures are read back into
+  DownloadRing ring(render_instance()->context(), kDownloadBufferCount);
 
-  PixelFormatInfo format_info = PixelService::GetPixelFormatInfo(render_instance()->format());
+  // Block frames are compressed on the GPU first so only the blocks are read back
+  std::unique_ptr<BlockCompressor> compressor;
 
-  // Set up OIIO::ImageSpec for compressing cached images on disk
-  OIIO::ImageSpec spec(render_instance()->width(), render_instance()->height(), kRGBAChannels, format_info.oiio_desc);
-  spec.attribute("compression", "dwaa:200");
+  if (cache_format_ == olive::kCacheFormatBC7) {
+    compressor = std::unique_ptr<BlockCompressor>(new BlockCompressor(render_instance()->context(),
+                                                                      kDownloadBufferCount));
+  }
 
-  while (!cancelled_) {
-    // Check queue for textures to download (use mutex to prevent collisions)
-    texture_queue_lock_.lock();
+  // Likewise YUV frames are packed first
+  std::unique_ptr<YUVPacker> packer;
 
-    while (texture_queue_.isEmpty()) {
-      // Main waiting condition
-      wait_cond_.wait(&texture_queue_lock_);
+  if (RendererCacheCodec::IsYUV(cache_format_)) {
+    packer = std::unique_ptr<YUVPacker>(new YUVPacker(RendererCacheCodec::IsVerticallySubsampled(cache_format_)));
+  }
 
-      if (cancelled_) {
-        break;
+  DownloadQueueEntry entry;
+
+  while (!cancelled_) {
+    bool has_entry = texture_queue_.Pop(&entry);
+
+    // Only sleep if there's nothing pending either, otherwise we'll finish off the pending downloads
+    if (!has_entry && ring.IsEmpty()) {
+      // Everything queued before the reconfiguration has been written with the old parameters by now
+      if (IsReconfigurePending()) {
+        ApplyReconfigure();
+        continue;
       }
-    }
-    if (cancelled_) {
-      texture_queue_lock_.unlock();
-      break;
-    }
 
-    entry = texture_queue_.takeFirst();
+      if (finishing_) {
+        break;
+      }
 
-    texture_queue_lock_.unlock();
+      texture_queue_lock_.lock();
 
-    // Download the texture
+      sleeping_.store(true, std::memory_order_relaxed);
 
-    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, read_buffer_);
+      // Pairs with the fence in Queue(), either we see its entry or it sees that we're sleeping and wakes us
+      std::atomic_thread_fence(std::memory_order_seq_cst);
 
-    xf->glFramebufferTexture2D(GL_READ_FRAMEBUFFER,
-                               GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_2D,
-                               entry.texture->texture(),
-                               0);
+      if (!cancelled_ && !finishing_ && texture_queue_.IsEmpty() && !IsReconfigurePending()) {
+        wait_cond_.wait(&texture_queue_lock_);
+      }
 
-    f->glReadPixels(0,
-                    0,
-                    entry.texture->width(),
-                    entry.texture->height(),
-                    format_info.pixel_format,
-                    format_info.pixel_type,
-                    data_buffer.data());
+      sleeping_.store(false, std::memory_order_relaxed);
 
-    xf->glFramebufferTexture2D(GL_READ_FRAMEBUFFER,
-                               GL_COLOR_ATTACHMENT0,
-                               GL_TEXTURE_2D,
-                               0,
-                               0);
+      texture_queue_lock_.unlock();
 
-    f->glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+      continue;
+    }
 
-    std::string working_fn_std = entry.filename.toStdString();
+    if (has_entry) {
+      // If every buffer is in use, the oldest has to finish before we can reuse it
+      if (ring.IsFull()) {
+        FinishDownload(&ring);
+      }
 
-    std::unique_ptr<OIIO::ImageOutput> out = OIIO::ImageOutput::create(working_fn_std);
+      if (compressor) {
+        int width = entry.texture->width();
+        int height = entry.texture->height();
+
+        GLuint blocks = compressor->Compress(entry.texture);
+
+        if (blocks == 0) {
+          qWarning() << "Failed to compress frame for the disk cache";
+          continue;
+        }
+
+        ring.Start(blocks,
+                   BlockCompressor::GetBlockCount(width),
+                   BlockCompressor::GetBlockCount(height),
+                   GL_RGBA_INTEGER,
+                   GL_UNSIGNED_INT,
+                   BlockCompressor::GetCompressedSize(width, height));
+      } else if (packer) {
+        ring.Start(packer->Pack(render_instance(), entry.texture));
+      } else {
+        ring.Start(entry.texture);
+      }
 
-    if (out) {
-      out->open(working_fn_std, spec);
-      out->write_image(format_info.oiio_desc, data_buffer.data());
-      out->close();
+      pending_downloads_.append(entry);
 
-      emit Downloaded(entry.hash);
+      // Hand off any downloads that have already finished without waiting on the others
+      while (!ring.IsEmpty() && ring.IsOldestReady()) {
+        FinishDownload(&ring);
+      }
     } else {
-      qWarning() << tr("Failed to open output file \"%1\"").arg(entry.filename);
+      // Nothing else to start, so wait on the oldest download
+      FinishDownload(&ring);
     }
   }
 
-  f->glDeleteFramebuffers(1, &read_buffer_);
+  // Downloads still in progress are discarded along with the ring
+  pending_downloads_.clear();
+
+  // As are any that were never started
+  while (texture_queue_.Pop(&entry)) {}
+}
+
+void RendererDownloadThread::FinishDownload(DownloadRing *ring)
+{
+  DownloadQueueEntry entry = pending_downloads_.takeFirst();
+
+  QByteArray pixels = ring->Finish();
+
+  if (pixels.isEmpty()) {
+    return;
+  }
+
+  // Keep a copy in memory so the viewer doesn't have to read this frame back from disk
+  memory_cache_->Insert(entry.hash, pixels);
+
+  Writer* writer = new Writer(this, render_instance(), entry, pixels);
+
+  if (olive::image_cache.UnderPressure(ImageCache::kMemBuf)) {
+    // Frames waiting on the write pool aren't accounted for anywhere, so don't let them pile up while memory is short
+    writer->run();
+    delete writer;
+  } else {
+    // Encoding the image is slow, so do it on the write pool rather than stalling the downloads
+    write_pool_->start(writer);
+  }
 }
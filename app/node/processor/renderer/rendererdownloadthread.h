@@ -1,8 +1,23 @@
 #ifndef RENDERERDOWNLOADTHREAD_H
 #define RENDERERDOWNLOADTHREAD_H
 
+#include <atomic>
+#include <QThreadPool>
+
+#include "common/spscqueue.h"
+#include "render/cacheformat.h"
+#include "render/gl/downloadring.h"
+#include "renderercachecodec.h"
+#include "renderermemorycache.h"
 #include "rendererthreadbase.h"
 
+/**
+ * @brief A thread that downloads rendered textures and writes them to the disk cache
+ *
+ * Textures are read back asynchronously through a ring of pixel buffer objects so the GPU can copy one frame while
+ * the previous ones are still being rendered. Once a copy has finished, the pixels are handed to a separate pool of
+ * I/O threads to be encoded (see RendererCacheCodec) and written so this thread never waits on compression.
+ */
 class RendererDownloadThread : public RendererThreadBase
 {
   Q_OBJECT
@@ -12,10 +27,27 @@ public:
                          const int& height,
                          const int &divider,
                          const olive::PixelFormat& format,
-                         const olive::RenderMode& mode);
+                         const olive::RenderMode& mode,
+                         const olive::CacheFormat& cache_format,
+                         RendererMemoryCache* memory_cache,
+                         QThreadPool* write_pool);
 
+  /**
+   * @brief Queue a texture to be downloaded and cached
+   *
+   * Must only be called from one thread (the renderer's). Doesn't lock, the download thread is only woken if it's
+   * actually asleep. If kDownloadQueueSize textures are already waiting, this yields until one has been taken.
+   */
   void Queue(RenderTexturePtr texture, const QString &fn, const QByteArray &hash);
 
+  /**
+   * @brief Download everything already queued and hand it to the write pool, then exit
+   *
+   * Blocks until the thread has exited. Unlike Cancel(), nothing queued is lost, though its writers may still be
+   * running afterwards.
+   */
+  void Finish();
+
 public slots:
   virtual void Cancel() override;
 
@@ -25,21 +57,49 @@ signals:
 protected:
   virtual void ProcessLoop() override;
 
+  virtual void Wake() override;
+
 private:
+  class Writer;
+
   struct DownloadQueueEntry {
     RenderTexturePtr texture;
     QString filename;
     QByteArray hash;
   };
 
-  GLuint read_buffer_;
+  /**
+   * @brief Wait for the oldest pending download to finish and hand its pixels to the write pool
+   */
+  void FinishDownload(DownloadRing* ring);
+
+  /**
+   * @brief Entries whose textures are being read back by the ring, in the order they were started
+   */
+  QList<DownloadQueueEntry> pending_downloads_;
 
-  QVector<DownloadQueueEntry> texture_queue_;
+  olive::CacheFormat cache_format_;
 
+  RendererMemoryCache* memory_cache_;
+
+  QThreadPool* write_pool_;
+
+  SPSCQueue<DownloadQueueEntry> texture_queue_;
+
+  /**
+   * @brief TRUE while the download thread is (about to be) waiting on wait_cond_ for something to be queued
+   */
+  std::atomic<bool> sleeping_;
+
+  /**
+   * @brief Only taken to sleep and to wake the download thread, never to queue
+   */
   QMutex texture_queue_lock_;
 
   QAtomicInt cancelled_;
 
+  QAtomicInt finishing_;
+
   QByteArray hash_;
 
 };
@@ -0,0 +1,162 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "rendererframemap.h"
+
+RendererFrameMap::RendererFrameMap()
+{
+}
+
+void RendererFrameMap::Insert(const int64_t &frame, const QByteArray &hash)
+{
+  if (frame < 0) {
+    return;
+  }
+
+  Grow(frame);
+
+  int index = Intern(hash);
+
+  int& f = frames_[static_cast<int>(frame)];
+
+  if (f >= 0) {
+    Release(f);
+  }
+
+  f = index;
+}
+
+void RendererFrameMap::InsertRange(const int64_t &start, const int64_t &end, const QByteArray &hash)
+{
+  int64_t first = qMax(start, Q_INT64_C(0));
+
+  if (end < first) {
+    return;
+  }
+
+  Grow(end);
+
+  // Take a reference for every frame at once (Intern() takes the first)
+  int index = Intern(hash);
+  hash_refs_[index] += static_cast<int>(end - first);
+
+  for (int i=static_cast<int>(first);i<=static_cast<int>(end);i++) {
+    int& f = frames_[i];
+
+    if (f >= 0) {
+      Release(f);
+    }
+
+    f = index;
+  }
+}
+
+bool RendererFrameMap::Contains(const int64_t &frame) const
+{
+  return frame >= 0 && frame < frames_.size() && frames_.at(static_cast<int>(frame)) >= 0;
+}
+
+QByteArray RendererFrameMap::Value(const int64_t &frame) const
+{
+  if (!Contains(frame)) {
+    return QByteArray();
+  }
+
+  // Implicitly shared, so this doesn't copy the hash
+  return hashes_.at(frames_.at(static_cast<int>(frame)));
+}
+
+void RendererFrameMap::Remove(const int64_t &frame)
+{
+  if (!Contains(frame)) {
+    return;
+  }
+
+  int& f = frames_[static_cast<int>(frame)];
+
+  Release(f);
+
+  f = -1;
+}
+
+void RendererFrameMap::Clear()
+{
+  frames_.clear();
+  hashes_.clear();
+  hash_refs_.clear();
+  hash_indices_.clear();
+  free_indices_.clear();
+}
+
+void RendererFrameMap::Grow(const int64_t &frame)
+{
+  if (frame < frames_.size()) {
+    return;
+  }
+
+  // Grow geometrically so mapping frames in order doesn't reallocate each time
+  int old_size = frames_.size();
+  int new_size = qMax(static_cast<int>(frame) + 1, old_size * 2);
+
+  frames_.resize(new_size);
+
+  for (int i=old_size;i<new_size;i++) {
+    frames_[i] = -1;
+  }
+}
+
+int RendererFrameMap::Intern(const QByteArray &hash)
+{
+  QHash<QByteArray, int>::const_iterator existing = hash_indices_.constFind(hash);
+
+  int index;
+
+  if (existing != hash_indices_.constEnd()) {
+    index = existing.value();
+  } else {
+    if (free_indices_.isEmpty()) {
+      index = hashes_.size();
+
+      hashes_.append(hash);
+      hash_refs_.append(0);
+    } else {
+      index = free_indices_.takeLast();
+
+      hashes_[index] = hash;
+    }
+
+    hash_indices_.insert(hash, index);
+  }
+
+  hash_refs_[index]++;
+
+  return index;
+}
+
+void RendererFrameMap::Release(int index)
+{
+  hash_refs_[index]--;
+
+  if (hash_refs_.at(index) == 0) {
+    hash_indices_.remove(hashes_.at(index));
+    hashes_[index] = QByteArray();
+    free_indices_.append(index);
+  }
+}
@@ -0,0 +1,110 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERERFRAMEMAP_H
+#define RENDERERFRAMEMAP_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <stdint.h>
+
+/**
+ * @brief Maps frames (as timestamps in the renderer's timebase) to the hash of the image cached for them
+ *
+ * Frames are a dense array indexed by timestamp, so lookups are O(1) with no tree to walk. Each element is only the
+ * index of its hash in a table of interned hashes, which frames with identical images (e.g. a held still) share. A
+ * long sequence costs four bytes per frame plus one QByteArray per unique image, rather than a tree node and a heap
+ * allocated QByteArray for every frame.
+ *
+ * Hashes are reference counted and their slots are reused once no frame uses them.
+ *
+ * This class is NOT thread-safe.
+ */
+class RendererFrameMap
+{
+public:
+  RendererFrameMap();
+
+  /**
+   * @brief Set the hash of `frame`, replacing any it already had
+   *
+   * Negative frames are ignored since they're never rendered.
+   */
+  void Insert(const int64_t& frame, const QByteArray& hash);
+
+  /**
+   * @brief Set the hash of every frame from `start` to `end` inclusive, e.g. for a held still
+   *
+   * The hash is only looked up once however long the range is.
+   */
+  void InsertRange(const int64_t& start, const int64_t& end, const QByteArray& hash);
+
+  bool Contains(const int64_t& frame) const;
+
+  /**
+   * @brief Return the hash of `frame` or an empty QByteArray if it has none
+   */
+  QByteArray Value(const int64_t& frame) const;
+
+  void Remove(const int64_t& frame);
+
+  void Clear();
+
+private:
+  /**
+   * @brief Make sure frames_ has an element for `frame`
+   */
+  void Grow(const int64_t& frame);
+
+  /**
+   * @brief Return the index of `hash` in hashes_, adding it if it isn't there yet
+   */
+  int Intern(const QByteArray& hash);
+
+  /**
+   * @brief Release a frame's reference to the hash at `index`
+   */
+  void Release(int index);
+
+  /**
+   * @brief The hash index of every frame, or -1 if the frame has no hash
+   */
+  QVector<int> frames_;
+
+  /**
+   * @brief Interned hashes, and the number of frames using each one
+   */
+  QVector<QByteArray> hashes_;
+  QVector<int> hash_refs_;
+
+  /**
+   * @brief The index of each hash in hashes_
+   */
+  QHash<QByteArray, int> hash_indices_;
+
+  /**
+   * @brief Indices in hashes_ that no frame uses any more, reused before hashes_ grows
+   */
+  QVector<int> free_indices_;
+
+};
+
+#endif // RENDERERFRAMEMAP_H
@@ -0,0 +1,72 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "rendererhashset.h"
+
+RendererHashSet::RendererHashSet()
+{
+}
+
+bool RendererHashSet::Insert(const QByteArray &hash)
+{
+  Shard& shard = ShardFor(hash);
+
+  QMutexLocker locker(&shard.lock);
+
+  if (shard.hashes.contains(hash)) {
+    return false;
+  }
+
+  shard.hashes.insert(hash);
+
+  return true;
+}
+
+bool RendererHashSet::Contains(const QByteArray &hash)
+{
+  Shard& shard = ShardFor(hash);
+
+  QMutexLocker locker(&shard.lock);
+
+  return shard.hashes.contains(hash);
+}
+
+void RendererHashSet::Remove(const QByteArray &hash)
+{
+  Shard& shard = ShardFor(hash);
+
+  QMutexLocker locker(&shard.lock);
+
+  shard.hashes.remove(hash);
+}
+
+void RendererHashSet::Clear()
+{
+  for (int i=0;i<kShardCount;i++) {
+    QMutexLocker locker(&shards_[i].lock);
+
+    shards_[i].hashes.clear();
+  }
+}
+
+RendererHashSet::Shard &RendererHashSet::ShardFor(const QByteArray &hash)
+{
+  return shards_[qHash(hash) % kShardCount];
+}
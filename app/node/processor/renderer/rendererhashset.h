@@ -0,0 +1,66 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERERHASHSET_H
+#define RENDERERHASHSET_H
+
+#include <QByteArray>
+#include <QMutex>
+#include <QSet>
+
+/**
+ * @brief A thread-safe set of frame hashes
+ *
+ * Hashes are spread across several independently locked shards so threads working on different frames rarely wait on
+ * each other.
+ */
+class RendererHashSet
+{
+public:
+  RendererHashSet();
+
+  /**
+   * @brief Add a hash to the set
+   *
+   * @return TRUE if the hash was added, FALSE if it was already in the set
+   */
+  bool Insert(const QByteArray& hash);
+
+  bool Contains(const QByteArray& hash);
+
+  void Remove(const QByteArray& hash);
+
+  void Clear();
+
+private:
+  static const int kShardCount = 16;
+
+  struct Shard {
+    QMutex lock;
+    QSet<QByteArray> hashes;
+  };
+
+  Shard& ShardFor(const QByteArray& hash);
+
+  Shard shards_[kShardCount];
+
+};
+
+#endif // RENDERERHASHSET_H
@@ -0,0 +1,133 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "rendererintermediatecache.h"
+
+#include "render/pixelservice.h"
+
+RendererIntermediateCache::RendererIntermediateCache(const qint64 &budget) :
+  budget_(budget),
+  size_(0)
+{
+  olive::image_cache.AddClient(this);
+}
+
+RendererIntermediateCache::~RendererIntermediateCache()
+{
+  olive::image_cache.RemoveClient(this);
+
+  Clear();
+}
+
+void RendererIntermediateCache::Insert(const QByteArray &hash, RenderTexturePtr texture)
+{
+  QList<RenderTexturePtr> discarded;
+
+  lock_.lock();
+
+  if (textures_.contains(hash)) {
+    discarded.append(textures_.value(hash));
+    size_ -= TextureSize(textures_.value(hash).get());
+    usage_.removeOne(hash);
+  }
+
+  textures_.insert(hash, texture);
+  usage_.append(hash);
+  size_ += TextureSize(texture.get());
+
+  Trim(budget_, &discarded);
+
+  lock_.unlock();
+
+  // Returning textures to their pools happens as `discarded` goes out of scope, outside of our lock
+}
+
+RenderTexturePtr RendererIntermediateCache::Get(const QByteArray &hash)
+{
+  RenderTexturePtr texture;
+
+  lock_.lock();
+
+  QHash<QByteArray, RenderTexturePtr>::iterator it = textures_.find(hash);
+
+  if (it != textures_.end()) {
+    if (it.value()->IsCreated()) {
+      texture = it.value();
+
+      // Move this texture to the most recently used end
+      usage_.removeOne(hash);
+      usage_.append(hash);
+    } else {
+      // The context the texture was created in has been destroyed, which destroyed the texture too
+      size_ -= TextureSize(it.value().get());
+
+      textures_.erase(it);
+      usage_.removeOne(hash);
+    }
+  }
+
+  lock_.unlock();
+
+  return texture;
+}
+
+void RendererIntermediateCache::Clear()
+{
+  QList<RenderTexturePtr> discarded;
+
+  lock_.lock();
+  Trim(0, &discarded);
+  lock_.unlock();
+}
+
+void RendererIntermediateCache::Evict(const ImageCache::BufferType &type, const qint64 &bytes)
+{
+  if (type != ImageCache::kTexBuf) {
+    return;
+  }
+
+  QList<RenderTexturePtr> discarded;
+
+  lock_.lock();
+  Trim(qMax(Q_INT64_C(0), size_ - bytes), &discarded);
+  lock_.unlock();
+}
+
+qint64 RendererIntermediateCache::TextureSize(RenderTexture *texture)
+{
+  qint64 size = PixelService::GetBufferSize(texture->format(), texture->width(), texture->height());
+
+  if (texture->back_texture() != 0) {
+    size *= 2;
+  }
+
+  return size;
+}
+
+void RendererIntermediateCache::Trim(const qint64 &limit, QList<RenderTexturePtr> *discarded)
+{
+  while (size_ > limit && !usage_.isEmpty()) {
+    RenderTexturePtr oldest = textures_.take(usage_.takeFirst());
+
+    size_ -= TextureSize(oldest.get());
+
+    discarded->append(oldest);
+  }
+}
@@ -0,0 +1,102 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERERINTERMEDIATECACHE_H
+#define RENDERERINTERMEDIATECACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QLinkedList>
+#include <QMutex>
+
+#include "render/imagecache.h"
+#include "render/rendertexture.h"
+
+/**
+ * @brief A thread-safe LRU cache of textures rendered part way up a frame's graph
+ *
+ * RendererProcessor only caches whole frames, so without this, changing a cheap node near the top of the graph (e.g.
+ * the opacity of the top track) renders every branch below it again too. RendererScheduler times every step of a
+ * frame's NodeExecutionPlan including the steps below it, and keeps a copy of the output of any step that took at least
+ * kIntermediateCacheMinimumCost here. Steps are keyed by their CachedHash(), which covers everything below them, so
+ * a later frame whose hash differs only above a cached step copies it from here and skips that whole branch.
+ *
+ * Textures come from the workers' RenderTexturePools, which account for their VRAM. Discarding one returns it to its
+ * pool, from where the pool can free it when VRAM runs short. Once the cached textures exceed the budget, the least
+ * recently used ones are discarded.
+ */
+class RendererIntermediateCache : public ImageCache::Client
+{
+public:
+  RendererIntermediateCache(const qint64& budget);
+
+  virtual ~RendererIntermediateCache() override;
+
+  /**
+   * @brief Store a texture, replacing any existing texture with the same hash
+   *
+   * The texture must not be modified after this, so call RenderTexture::Fence() first.
+   */
+  void Insert(const QByteArray& hash, RenderTexturePtr texture);
+
+  /**
+   * @brief Retrieve a texture and mark it as recently used
+   *
+   * Call RenderTexture::WaitFence() before sampling it, and copy it rather than drawing into it.
+   *
+   * @return The texture, or nullptr if this hash isn't cached (or its context has since been destroyed)
+   */
+  RenderTexturePtr Get(const QByteArray& hash);
+
+  /**
+   * @brief Discard all cached textures, e.g. when the workers and their contexts are stopped
+   */
+  void Clear();
+
+  virtual void Evict(const ImageCache::BufferType& type, const qint64& bytes) override;
+
+private:
+  /**
+   * @brief Returns the number of VRAM bytes used by a texture
+   */
+  static qint64 TextureSize(RenderTexture* texture);
+
+  /**
+   * @brief Take least recently used textures out of the cache until it's at most `limit` bytes
+   *
+   * Assumes lock_ is already held. The textures are moved into `discarded` so they can be returned to their pools
+   * after the lock is released.
+   */
+  void Trim(const qint64& limit, QList<RenderTexturePtr>* discarded);
+
+  qint64 budget_;
+
+  qint64 size_;
+
+  QHash<QByteArray, RenderTexturePtr> textures_;
+
+  /// Hashes ordered from least recently used to most recently used
+  QLinkedList<QByteArray> usage_;
+
+  QMutex lock_;
+
+};
+
+#endif // RENDERERINTERMEDIATECACHE_H
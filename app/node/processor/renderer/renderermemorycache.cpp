@@ -0,0 +1,134 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderermemorycache.h"
+
+RendererMemoryCache::RendererMemoryCache(const qint64 &budget) :
+  budget_(budget),
+  size_(0)
+{
+  olive::image_cache.AddClient(this);
+}
+
+RendererMemoryCache::~RendererMemoryCache()
+{
+  olive::image_cache.RemoveClient(this);
+
+  Clear();
+}
+
+void RendererMemoryCache::Insert(const QByteArray &hash, const QByteArray &buffer)
+{
+  qint64 freed = 0;
+
+  lock_.lock();
+
+  if (buffers_.contains(hash)) {
+    freed += buffers_.value(hash).size();
+    size_ -= buffers_.value(hash).size();
+    usage_.removeOne(hash);
+  }
+
+  buffers_.insert(hash, buffer);
+  usage_.append(hash);
+  size_ += buffer.size();
+
+  freed += Trim(budget_);
+
+  lock_.unlock();
+
+  // Report outside of our lock since the image cache may call Evict() on us
+  olive::image_cache.Freed(ImageCache::kMemBuf, freed);
+  olive::image_cache.Allocated(ImageCache::kMemBuf, buffer.size());
+}
+
+QByteArray RendererMemoryCache::Get(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<QByteArray, QByteArray>::const_iterator it = buffers_.constFind(hash);
+
+  if (it == buffers_.constEnd()) {
+    return QByteArray();
+  }
+
+  // Move this frame to the most recently used end
+  usage_.removeOne(hash);
+  usage_.append(hash);
+
+  return it.value();
+}
+
+bool RendererMemoryCache::Contains(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  return buffers_.contains(hash);
+}
+
+void RendererMemoryCache::Clear()
+{
+  lock_.lock();
+
+  qint64 freed = size_;
+
+  buffers_.clear();
+  usage_.clear();
+  size_ = 0;
+
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kMemBuf, freed);
+}
+
+const qint64 &RendererMemoryCache::budget() const
+{
+  return budget_;
+}
+
+void RendererMemoryCache::Evict(const ImageCache::BufferType &type, const qint64 &bytes)
+{
+  if (type != ImageCache::kMemBuf) {
+    return;
+  }
+
+  lock_.lock();
+  qint64 freed = Trim(qMax(Q_INT64_C(0), size_ - bytes));
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kMemBuf, freed);
+}
+
+qint64 RendererMemoryCache::Trim(const qint64 &limit)
+{
+  qint64 freed = 0;
+
+  // Always keep the most recent frame, even if it alone is larger than the limit
+  while (size_ > limit && usage_.size() > 1) {
+    QByteArray oldest = usage_.takeFirst();
+
+    qint64 sz = buffers_.take(oldest).size();
+
+    size_ -= sz;
+    freed += sz;
+  }
+
+  return freed;
+}
@@ -0,0 +1,94 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERERMEMORYCACHE_H
+#define RENDERERMEMORYCACHE_H
+
+#include <QByteArray>
+#include <QHash>
+#include <QLinkedList>
+#include <QMutex>
+
+#include "render/imagecache.h"
+
+/**
+ * @brief A thread-safe LRU cache of rendered frame buffers kept in system memory
+ *
+ * Frames are keyed by their render hash and stored exactly as they'd be uploaded to a RenderTexture, so a hit can be
+ * uploaded without touching the disk cache or decompressing an image. Once the total size of the cached frames
+ * exceeds the budget, the least recently used frames are discarded.
+ *
+ * Every frame is also accounted for in olive::image_cache, which can evict frames from here when system memory as a
+ * whole runs short.
+ */
+class RendererMemoryCache : public ImageCache::Client
+{
+public:
+  RendererMemoryCache(const qint64& budget);
+
+  virtual ~RendererMemoryCache() override;
+
+  /**
+   * @brief Store a frame buffer, replacing any existing buffer with the same hash
+   */
+  void Insert(const QByteArray& hash, const QByteArray& buffer);
+
+  /**
+   * @brief Retrieve a frame buffer and mark it as recently used
+   *
+   * @return The buffer, or a null QByteArray if this hash isn't cached
+   */
+  QByteArray Get(const QByteArray& hash);
+
+  bool Contains(const QByteArray& hash);
+
+  /**
+   * @brief Discard all cached frames, e.g. when the frame dimensions or format change
+   */
+  void Clear();
+
+  const qint64& budget() const;
+
+  virtual void Evict(const ImageCache::BufferType& type, const qint64& bytes) override;
+
+private:
+  /**
+   * @brief Discard least recently used frames until the cache is at most `limit` bytes
+   *
+   * Assumes lock_ is already held.
+   *
+   * @return The number of bytes freed
+   */
+  qint64 Trim(const qint64& limit);
+
+  qint64 budget_;
+
+  qint64 size_;
+
+  QHash<QByteArray, QByteArray> buffers_;
+
+  /// Frame hashes ordered from least recently used to most recently used
+  QLinkedList<QByteArray> usage_;
+
+  QMutex lock_;
+
+};
+
+#endif // RENDERERMEMORYCACHE_H
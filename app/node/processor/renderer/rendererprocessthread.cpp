@@ -20,9 +20,10 @@
 
 #include "rendererprocessthread.h"
 
-#include "renderer.h"
+#include "rendererscheduler.h"
 
-RendererProcessThread::RendererProcessThread(RendererProcessor* parent,
+RendererProcessThread::RendererProcessThread(RendererScheduler* scheduler,
+                                             int index,
                                              QOpenGLContext *share_ctx,
                                              const int &width,
                                              const int &height,
@@ -30,117 +31,20 @@ RendererProcessThread::RendererProcessThread(RendererProcessor* parent,
                                              const olive::PixelFormat &format,
                                              const olive::RenderMode &mode) :
   RendererThreadBase(share_ctx, width, height, divider, format, mode),
-  parent_(parent),
-  cancelled_(false)
+  scheduler_(scheduler),
+  index_(index)
 {
 
 }
 
-bool RendererProcessThread::Queue(const NodeDependency& dep, bool wait)
-{
-  if (wait) {
-    // Wait for thread to be available
-    mutex_.lock();
-  } else if (!mutex_.tryLock()) {
-    return false;
-  }
-
-  // We can now change params without the other thread using them
-  path_ = dep;
-
-  // Prepare to wait for thread to respond
-  caller_mutex_.lock();
-
-  // Wake up our main thread
-  wait_cond_.wakeAll();
-  mutex_.unlock();
-
-  // Wait for thread to start before returning
-  wait_cond_.wait(&caller_mutex_);
-  caller_mutex_.unlock();
-
-  return true;
-}
-
 void RendererProcessThread::Cancel()
 {
-  cancelled_ = true;
-
-  mutex_.lock();
-  wait_cond_.wakeAll();
-  mutex_.unlock();
+  scheduler_->RequestStop();
 
   wait();
 }
 
 void RendererProcessThread::ProcessLoop()
 {
-  while (!cancelled_) {
-    // Main waiting condition
-    wait_cond_.wait(&mutex_);
-
-    if (cancelled_) {
-      break;
-    }
-
-    // Wake up main thread
-    caller_mutex_.lock();
-    wait_cond_.wakeAll();
-    caller_mutex_.unlock();
-
-    // Process the Node
-    NodeOutput* output_to_process = path_.node();
-    Node* node_to_process = output_to_process->parent();
-
-    node_to_process->Lock();
-
-    QList<Node*> all_deps = node_to_process->GetDependencies();
-    foreach (Node* dep, all_deps) {
-      dep->Lock();
-    }
-
-    // Check hash
-    QCryptographicHash hasher(QCryptographicHash::Sha1);
-    node_to_process->Hash(&hasher, output_to_process, path_.time());
-    hash_ = hasher.result();
-
-    texture_ = nullptr;
-
-    bool has_hash = parent_->HasHash(hash_);
-    bool can_cache = false;
-
-    if (!has_hash){
-
-      if ((can_cache = parent_->TryCache(hash_))) {
-
-        QList<NodeDependency> deps = node_to_process->RunDependencies(output_to_process, path_.time());
-
-        // Ask for other threads to run these deps while we're here
-        if (!deps.isEmpty()) {
-          for (int i=1;i<deps.size();i++) {
-            emit RequestSibling(deps.at(i));
-          }
-        }
-
-        // Get the requested value
-        texture_ = output_to_process->get_value(path_.time()).value<RenderTexturePtr>();
-
-        render_instance()->context()->functions()->glFinish();
-      }
-    }
-
-    foreach (Node* dep, all_deps) {
-      dep->Unlock();
-    }
-
-    node_to_process->Unlock();
-
-    if (can_cache) {
-      // We cached this frame, signal that it will need to be downloaded to disk
-      emit CachedFrame(texture_, path_.time(), hash_);
-    } else {
-      // This hash already exists, no need to cache, just map it
-      emit FrameSkipped(path_.time(), hash_);
-    }
-  }
+  scheduler_->WorkerLoop(index_);
 }
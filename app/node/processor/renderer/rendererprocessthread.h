@@ -23,44 +23,36 @@
 
 #include "rendererthreadbase.h"
 
-class RendererProcessor;
-
+class RendererScheduler;
+
+/**
+ * @brief A worker thread of RendererScheduler
+ *
+ * Provides the OpenGL context (through RendererThreadBase) that render tasks run in, the scheduling itself is done by
+ * RendererScheduler::WorkerLoop().
+ */
 class RendererProcessThread : public RendererThreadBase
 {
   Q_OBJECT
 public:
-  RendererProcessThread(RendererProcessor* parent,
+  RendererProcessThread(RendererScheduler* scheduler,
+                        int index,
                         QOpenGLContext* share_ctx,
                         const int& width,
                         const int& height, const int &divider,
                         const olive::PixelFormat& format,
                         const olive::RenderMode& mode);
 
-  bool Queue(const NodeDependency &dep, bool wait);
-
 public slots:
   virtual void Cancel() override;
 
 protected:
   virtual void ProcessLoop() override;
 
-signals:
-  void RequestSibling(NodeDependency dep);
-
-  void CachedFrame(RenderTexturePtr texture, const rational& time, const QByteArray& hash);
-
-  void FrameSkipped(const rational& time, const QByteArray& hash);
-
 private:
-  RendererProcessor* parent_;
-
-  NodeDependency path_;
-
-  QByteArray hash_;
-
-  RenderTexturePtr texture_;
+  RendererScheduler* scheduler_;
 
-  QAtomicInt cancelled_;
+  int index_;
 
 };
 
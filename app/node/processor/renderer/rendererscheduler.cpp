@@ -0,0 +1,1023 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "rendererscheduler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include "common/threadaffinity.h"
+#include "config/config.h"
+#include "decoder/decoder.h"
+#include "renderer.h"
+#include "render/profiler.h"
+#include "render/vrammonitor.h"
+
+RendererScheduler::RendererScheduler(RendererProcessor *parent) :
+  parent_(parent),
+  submitted_(std::make_shared<TaskDeque>()),
+  interactive_pending_(0),
+  stopping_(false),
+  paused_(false),
+  parked_(0),
+  worker_count_(0)
+{
+}
+
+RendererScheduler::~RendererScheduler()
+{
+  Stop();
+}
+
+void RendererScheduler::Start(QOpenGLContext *share_ctx,
+                              const int &width,
+                              const int &height,
+                              const int &divider,
+                              const olive::PixelFormat &format,
+                              const olive::RenderMode &mode,
+                              int thread_count)
+{
+  stopping_ = false;
+  paused_ = false;
+  parked_ = 0;
+  worker_count_ = thread_count;
+
+  deques_.resize(thread_count);
+  threads_.resize(thread_count);
+
+  for (int i=0;i<thread_count;i++) {
+    deques_[i] = std::make_shared<TaskDeque>();
+  }
+
+  for (int i=0;i<thread_count;i++) {
+    StartWorker(i, share_ctx, width, height, divider, format, mode);
+  }
+}
+
+void RendererScheduler::SetThreadCount(QOpenGLContext *share_ctx,
+                                       const int &width,
+                                       const int &height,
+                                       const int &divider,
+                                       const olive::PixelFormat &format,
+                                       const olive::RenderMode &mode,
+                                       int thread_count)
+{
+  int old_count = threads_.size();
+
+  if (old_count == 0 || thread_count == old_count) {
+    return;
+  }
+
+  // Frames that are rendering would keep their workers from parking, they're fulfilled as cancelled and queued again
+  running_lock_.lock();
+  foreach (TaskPtr task, running_) {
+    task->cancelled->storeRelease(1);
+  }
+  running_lock_.unlock();
+
+  // Workers walk deques_ and threads_ when they look for work, so they can't change while any of them are running
+  wait_lock_.lock();
+
+  worker_count_ = thread_count;
+  paused_ = true;
+  wait_cond_.wakeAll();
+
+  while (parked_ < old_count) {
+    parked_cond_.wait(&wait_lock_);
+  }
+
+  wait_lock_.unlock();
+
+  for (int i=thread_count;i<old_count;i++) {
+    threads_.at(i)->wait();
+
+    // These can only be steps of the frames that were just cancelled, but something may still be waiting on them
+    deques_.first()->tasks.append(deques_.at(i)->tasks);
+  }
+
+  if (thread_count < old_count) {
+    threads_.resize(thread_count);
+    deques_.resize(thread_count);
+
+    wait_lock_.lock();
+    parked_ -= old_count - thread_count;
+    wait_lock_.unlock();
+  } else {
+    deques_.resize(thread_count);
+    threads_.resize(thread_count);
+
+    for (int i=old_count;i<thread_count;i++) {
+      deques_[i] = std::make_shared<TaskDeque>();
+    }
+  }
+
+  wait_lock_.lock();
+  paused_ = false;
+  wait_cond_.wakeAll();
+  wait_lock_.unlock();
+
+  for (int i=old_count;i<thread_count;i++) {
+    StartWorker(i, share_ctx, width, height, divider, format, mode);
+  }
+}
+
+void RendererScheduler::StartWorker(int index,
+                                    QOpenGLContext *share_ctx,
+                                    const int &width,
+                                    const int &height,
+                                    const int &divider,
+                                    const olive::PixelFormat &format,
+                                    const olive::RenderMode &mode)
+{
+  threads_[index] = std::make_shared<RendererProcessThread>(this, index, share_ctx, width, height, divider, format, mode);
+
+  // Workers are spread round robin across NUMA nodes, so worker `i` shares a node with every `i + n * NodeCount()`
+  threads_[index]->SetAffinityNode(index);
+  threads_[index]->StartThread(QThread::LowPriority);
+}
+
+void RendererScheduler::Stop()
+{
+  RequestStop();
+
+  foreach (RendererProcessThreadPtr thread, threads_) {
+    thread->wait();
+  }
+  threads_.clear();
+
+  // Any tasks left were never started, their promises are dropped along with them
+  deques_.clear();
+  interactive_pending_ = 0;
+
+  submitted_->lock.lock();
+  submitted_->tasks.clear();
+  submitted_->lock.unlock();
+}
+
+void RendererScheduler::Reconfigure(const int &width,
+                                    const int &height,
+                                    const int &divider,
+                                    const olive::PixelFormat &format,
+                                    const olive::RenderMode &mode)
+{
+  CancelPending();
+
+  running_lock_.lock();
+  foreach (TaskPtr task, running_) {
+    task->cancelled->storeRelease(1);
+  }
+  running_lock_.unlock();
+
+  foreach (RendererProcessThreadPtr thread, threads_) {
+    thread->Reconfigure(width, height, divider, format, mode);
+  }
+
+  // Workers pick it up in WorkerLoop(), between frames
+  WakeAll();
+
+  foreach (RendererProcessThreadPtr thread, threads_) {
+    thread->WaitForReconfigure();
+  }
+}
+
+void RendererScheduler::RequestStop()
+{
+  stopping_ = true;
+
+  WakeAll();
+}
+
+RenderFuture RendererScheduler::Submit(const NodeDependency &frame, const QRect &tile, Priority priority)
+{
+  Q_ASSERT(tile.isNull() || parent_ == nullptr);
+
+  TaskPtr task = CreateFrameTask(frame,
+                                 (parent_ != nullptr) ? parent_->playback_speed() : 0,
+                                 (parent_ != nullptr) ? parent_->playback_divider() : 1);
+  task->tile = tile;
+  task->priority = priority;
+
+  RenderFuture future = task->promise.get_future().share();
+
+  if (priority == kPriorityInteractive) {
+    // Start after the other interactive frames but ahead of all the background ones
+    submitted_->lock.lock();
+
+    int position = 0;
+
+    while (position < submitted_->tasks.size()
+           && submitted_->tasks.at(position)->priority == kPriorityInteractive) {
+      position++;
+    }
+
+    submitted_->tasks.insert(position, task);
+
+    submitted_->lock.unlock();
+
+    WakeAll();
+  } else {
+    Push(submitted_, task);
+  }
+
+  return future;
+}
+
+RenderFuture RendererScheduler::SubmitPreview(const NodeDependency &frame)
+{
+  TaskPtr task = CreateFrameTask(frame, kShuttleKeyframeSpeed, kScrubPreviewDivider);
+  task->preview = true;
+  task->priority = kPriorityInteractive;
+
+  RenderFuture future = task->promise.get_future().share();
+
+  // Jump the queue, the viewer is waiting on this one
+  submitted_->lock.lock();
+  submitted_->tasks.prepend(task);
+  submitted_->lock.unlock();
+
+  WakeAll();
+
+  return future;
+}
+
+void RendererScheduler::CancelPending(const rational &playhead, bool backwards)
+{
+  QList<TaskPtr> cancelled;
+
+  submitted_->lock.lock();
+
+  for (int i=0;i<submitted_->tasks.size();i++) {
+    const rational& time = submitted_->tasks.at(i)->dep.time();
+
+    if (backwards ? (time > playhead) : (time < playhead)) {
+      cancelled.append(submitted_->tasks.takeAt(i));
+      i--;
+    }
+  }
+
+  submitted_->lock.unlock();
+
+  FinishCancelled(cancelled);
+
+  // Frames that have started finish early (see RunFrame()), their futures are fulfilled as usual
+  running_lock_.lock();
+  foreach (TaskPtr task, running_) {
+    const rational& time = task->dep.time();
+
+    if (backwards ? (time > playhead) : (time < playhead)) {
+      task->cancelled->storeRelease(1);
+    }
+  }
+  running_lock_.unlock();
+}
+
+void RendererScheduler::CancelPending()
+{
+  submitted_->lock.lock();
+  QList<TaskPtr> cancelled = submitted_->tasks;
+  submitted_->tasks.clear();
+  submitted_->lock.unlock();
+
+  FinishCancelled(cancelled);
+
+  // Previews are only useful for where the playhead is right now
+  running_lock_.lock();
+  foreach (TaskPtr task, running_) {
+    if (task->preview) {
+      task->cancelled->storeRelease(1);
+    }
+  }
+  running_lock_.unlock();
+}
+
+void RendererScheduler::CancelRange(const rational &start, const rational &end)
+{
+  QList<TaskPtr> cancelled;
+
+  submitted_->lock.lock();
+
+  for (int i=0;i<submitted_->tasks.size();i++) {
+    const rational& time = submitted_->tasks.at(i)->dep.time();
+
+    if (time >= start && time <= end) {
+      cancelled.append(submitted_->tasks.takeAt(i));
+      i--;
+    }
+  }
+
+  submitted_->lock.unlock();
+
+  FinishCancelled(cancelled);
+
+  running_lock_.lock();
+  foreach (TaskPtr task, running_) {
+    const rational& time = task->dep.time();
+
+    if (time >= start && time <= end) {
+      task->cancelled->storeRelease(1);
+    }
+  }
+  running_lock_.unlock();
+}
+
+void RendererScheduler::FinishCancelled(const QList<TaskPtr> &cancelled)
+{
+  if (cancelled.isEmpty()) {
+    return;
+  }
+
+  foreach (TaskPtr task, cancelled) {
+    RenderResult result;
+    result.time = task->dep.time();
+    result.cached = false;
+    result.cancelled = true;
+    result.playback_speed = task->playback_speed;
+    result.playback_divider = task->playback_divider;
+    result.render_time = 0;
+    result.node = -1;
+    result.static_in = result.time;
+    result.static_out = result.time;
+
+    task->promise.set_value(result);
+  }
+
+  emit FrameFinished();
+}
+
+void RendererScheduler::WorkerLoop(int index)
+{
+  RendererProcessThreadPtr thread = threads_.at(index);
+
+  while (!stopping_) {
+    if (paused_.loadAcquire()) {
+      if (!Park(index)) {
+        break;
+      }
+
+      continue;
+    }
+
+    // Nothing's rendering on this worker between frames, so it can safely change its instance here
+    thread->ApplyReconfigure();
+
+    TaskPtr task = TakeTask(index, true);
+
+    if (task != nullptr) {
+      Run(index, task);
+      continue;
+    }
+
+    // Nothing to do, sleep until a task is added. Checking inside the lock ensures we can't miss the wake-up.
+    wait_lock_.lock();
+
+    if (!stopping_ && !paused_ && !HasTask(true) && !thread->IsReconfigurePending()) {
+      ProfilerTimer timer(Profiler::kIdle);
+
+      wait_cond_.wait(&wait_lock_);
+    }
+
+    wait_lock_.unlock();
+  }
+}
+
+bool RendererScheduler::Park(int index)
+{
+  QMutexLocker locker(&wait_lock_);
+
+  parked_++;
+  parked_cond_.wakeAll();
+
+  if (index >= worker_count_) {
+    // Stays counted as parked until SetThreadCount() has removed it
+    return false;
+  }
+
+  while (paused_.loadAcquire() && !stopping_) {
+    wait_cond_.wait(&wait_lock_);
+  }
+
+  parked_--;
+
+  return true;
+}
+
+RendererScheduler::TaskPtr RendererScheduler::TakeTask(int index, bool include_frames)
+{
+  // Interactive work preempts everything else
+  TaskPtr task = TakeInteractiveTask(index);
+
+  if (task != nullptr) {
+    return task;
+  }
+
+  // Our own deque is used like a stack so that the most recently pushed (and most likely still hot) work runs first
+  task = TakeFrom(deques_.at(index), true, false);
+
+  if (task != nullptr) {
+    return task;
+  }
+
+  // Steal the oldest task from another worker, starting with the next one along so that stealing is spread out.
+  // Workers on our own NUMA node are tried first so a stolen task's inputs are more likely to be in local memory.
+  int node_count = ThreadAffinity::NodeCount();
+
+  for (int local=1;local>=0;local--) {
+    for (int i=1;i<deques_.size();i++) {
+      int victim = (index + i) % deques_.size();
+
+      if ((victim % node_count == index % node_count) != static_cast<bool>(local)) {
+        continue;
+      }
+
+      task = TakeFrom(deques_.at(victim), false, false);
+
+      if (task != nullptr) {
+        return task;
+      }
+    }
+  }
+
+  if (include_frames) {
+    submitted_->lock.lock();
+    if (!submitted_->tasks.isEmpty()) {
+      task = submitted_->tasks.takeFirst();
+    }
+    submitted_->lock.unlock();
+  }
+
+  return task;
+}
+
+RendererScheduler::TaskPtr RendererScheduler::TakeInteractiveTask(int index)
+{
+  if (interactive_pending_.loadAcquire() <= 0) {
+    return nullptr;
+  }
+
+  TaskPtr task = TakeFrom(deques_.at(index), true, true);
+
+  for (int i=1;i<deques_.size() && task == nullptr;i++) {
+    task = TakeFrom(deques_.at((index + i) % deques_.size()), false, true);
+  }
+
+  return task;
+}
+
+RendererScheduler::TaskPtr RendererScheduler::TakeFrom(TaskDequePtr deque, bool from_back, bool interactive_only)
+{
+  TaskPtr task;
+
+  QMutexLocker locker(&deque->lock);
+
+  for (int i=0;i<deque->tasks.size();i++) {
+    int position = from_back ? deque->tasks.size() - 1 - i : i;
+    const TaskPtr& candidate = deque->tasks.at(position);
+
+    if ((!interactive_only || candidate->priority == kPriorityInteractive) && IsReady(candidate)) {
+      task = deque->tasks.takeAt(position);
+      break;
+    }
+  }
+
+  if (task != nullptr && task->type == Task::kDependency && task->priority == kPriorityInteractive) {
+    interactive_pending_.deref();
+  }
+
+  return task;
+}
+
+void RendererScheduler::YieldToInteractive(int index)
+{
+  while (!stopping_) {
+    TaskPtr task = TakeInteractiveTask(index);
+
+    if (task == nullptr) {
+      break;
+    }
+
+    Run(index, task);
+  }
+}
+
+bool RendererScheduler::HasTask(bool include_frames)
+{
+  QVector<TaskDequePtr> deques = deques_;
+
+  if (include_frames) {
+    deques.append(submitted_);
+  }
+
+  foreach (TaskDequePtr deque, deques) {
+    QMutexLocker locker(&deque->lock);
+
+    foreach (TaskPtr task, deque->tasks) {
+      if (IsReady(task)) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool RendererScheduler::IsReady(TaskPtr task)
+{
+  foreach (const RenderFuture& future, task->waits_on) {
+    if (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool RendererScheduler::IsCancelled(TaskPtr task)
+{
+  return task->cancelled->loadAcquire() != 0;
+}
+
+RendererScheduler::TaskPtr RendererScheduler::CreateFrameTask(const NodeDependency &frame,
+                                                              int playback_speed,
+                                                              int playback_divider)
+{
+  TaskPtr task = std::make_shared<Task>();
+  task->type = Task::kFrame;
+  task->dep = frame;
+  task->playback_speed = playback_speed;
+  task->playback_divider = playback_divider;
+  task->preview = false;
+  task->priority = kPriorityBackground;
+  task->cancelled = std::make_shared<QAtomicInt>(0);
+
+  return task;
+}
+
+RendererScheduler::TaskPtr RendererScheduler::CreateDependencyTask(TaskPtr frame, const NodeDependency &step)
+{
+  TaskPtr task = std::make_shared<Task>();
+  task->type = Task::kDependency;
+  task->dep = step;
+  task->playback_speed = frame->playback_speed;
+  task->playback_divider = frame->playback_divider;
+  task->tile = frame->tile;
+  task->preview = frame->preview;
+  task->priority = frame->priority;
+  task->cancelled = frame->cancelled;
+
+  return task;
+}
+
+void RendererScheduler::AddPlaybackToHash(QByteArray *hash, int playback_speed, int playback_divider)
+{
+  // Node hashes are memoized by time alone, so anything that depends on how the frame is played back is added here
+  // rather than in Node::Hash()
+
+  // Frames rendered at a reduced resolution for playback are cached apart from the full quality ones
+  if (playback_divider > 1) {
+    hash->append(QByteArray::number(playback_divider));
+  }
+
+  // Shuttle frames are decoded from keyframes at a lower resolution (see MediaInput::Value()), so they mustn't be
+  // mistaken for the full quality frame either
+  if (Decoder::KeyframesOnlyAtSpeed(playback_speed)) {
+    hash->append(QByteArrayLiteral("shuttle"));
+    hash->append(QByteArray::number(kShuttleDivider));
+  }
+}
+
+QVector<QByteArray> RendererScheduler::StepHashes(const NodeExecutionPlan &plan,
+                                                  int playback_speed,
+                                                  int playback_divider)
+{
+  const QList<NodeDependency>& steps = plan.steps();
+
+  QVector<QByteArray> hashes(steps.size());
+
+  for (int i=0;i<steps.size();i++) {
+    NodeOutput* output = steps.at(i).node();
+
+    if (output->data_type() != NodeParam::kTexture) {
+      continue;
+    }
+
+    hashes[i] = output->parent()->CachedHash(output, steps.at(i).time());
+
+    // Same as the frame's hash, media decoded differently for playback is cached apart from full quality
+    AddPlaybackToHash(&hashes[i], playback_speed, playback_divider);
+  }
+
+  return hashes;
+}
+
+void RendererScheduler::WaitForTexture(const RenderFuture &future)
+{
+  if (future.valid()
+      && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready
+      && future.get().texture != nullptr) {
+    future.get().texture->WaitFence();
+  }
+}
+
+void RendererScheduler::Push(TaskDequePtr deque, TaskPtr task)
+{
+  deque->lock.lock();
+  deque->tasks.append(task);
+
+  if (task->type == Task::kDependency && task->priority == kPriorityInteractive) {
+    interactive_pending_.ref();
+  }
+
+  deque->lock.unlock();
+
+  WakeAll();
+}
+
+void RendererScheduler::Run(int index, TaskPtr task)
+{
+  RenderInstance* instance = RendererProcessor::CurrentInstance();
+
+  // Tasks can run nested inside others while they wait (see WaitHelping()), so put back whatever tile was set
+  QRect previous_tile = instance->tile();
+  const QAtomicInt* previous_cancel_flag = instance->cancel_flag();
+
+  // Workers run at a low priority so they don't compete with the GUI, except when the viewer is waiting on them
+  QThread::Priority previous_priority = QThread::currentThread()->priority();
+  QThread::Priority priority = (task->priority == kPriorityInteractive) ? QThread::NormalPriority
+                                                                        : QThread::LowPriority;
+
+  if (priority != previous_priority) {
+    QThread::currentThread()->setPriority(priority);
+  }
+
+  instance->set_playback_speed(task->playback_speed);
+  instance->set_playback_divider(task->playback_divider);
+
+  // Frames that nobody is waiting on to display are rendered through a range, so decoders can work further ahead
+  instance->set_read_ahead(task->priority == kPriorityBackground && task->playback_speed == 0 && !task->preview);
+  instance->set_tile(task->tile);
+  instance->set_cancel_flag(task->cancelled.get());
+
+  if (task->type == Task::kFrame) {
+    RunFrame(index, task);
+  } else {
+    RunDependency(index, task);
+  }
+
+  instance->set_tile(previous_tile);
+  instance->set_cancel_flag(previous_cancel_flag);
+
+  // Throttled, so most tasks return straight away
+  olive::vram_monitor.Query(instance->context());
+
+  // Pick up GPU timings from earlier tasks that have finished by now
+  instance->gpu_profiler()->Resolve();
+
+  if (priority != previous_priority) {
+    QThread::currentThread()->setPriority(previous_priority);
+  }
+
+  // Wake anyone waiting on this task's future
+  WakeAll();
+}
+
+void RendererScheduler::RunFrame(int index, TaskPtr task)
+{
+  NodeOutput* output_to_process = task->dep.node();
+  Node* node_to_process = output_to_process->parent();
+  const rational& time = task->dep.time();
+
+  // Times the whole frame, from checking its hash to the last node finishing
+  ProfilerTimer timer(Profiler::kFrame, -1, time);
+
+  QElapsedTimer render_timer;
+  render_timer.start();
+
+  running_lock_.lock();
+  running_.append(task);
+  running_lock_.unlock();
+
+  QList<Node*> all_nodes = node_to_process->GetDependencies();
+  all_nodes.append(node_to_process);
+
+  LockNodes(all_nodes);
+
+  // Values from another tile of this time (or from its full quality frame) would otherwise be reused for this one
+  if (!task->tile.isNull() || task->preview) {
+    foreach (Node* n, all_nodes) {
+      foreach (NodeParam* param, n->parameters()) {
+        param->ClearCachedValue();
+      }
+    }
+  }
+
+  // Check hash
+  RenderResult result;
+  result.time = time;
+  result.hash = node_to_process->CachedHash(output_to_process, time);
+  AddPlaybackToHash(&result.hash, task->playback_speed, task->playback_divider);
+
+  // Without a renderer there's no cache to check, so the frame is always rendered
+  result.cached = (parent_ == nullptr || (!parent_->HasHash(result.hash) && parent_->TryCache(result.hash)));
+  result.cancelled = false;
+  result.node = ThreadAffinity::CurrentNode();
+  result.playback_speed = task->playback_speed;
+  result.playback_divider = task->playback_divider;
+
+  // Held stills hash the same for a whole range, which the renderer can map without visiting each frame
+  node_to_process->StaticRange(output_to_process, time, &result.static_in, &result.static_out);
+
+  NodeExecutionPlan plan;
+  QVector<QByteArray> step_hashes;
+
+  if (result.cached && !IsCancelled(task)) {
+    plan = node_to_process->CachedExecutionPlan(output_to_process, time);
+
+    // Previews are decoded from keyframes only, so their steps aren't worth keeping (or reusing)
+    if (parent_ != nullptr && !task->preview) {
+      step_hashes = StepHashes(plan, task->playback_speed, task->playback_divider);
+    }
+  }
+
+  UnlockNodes(all_nodes);
+
+  if (result.cached) {
+    // Evaluate the graph bottom-up so no node has to recurse into its inputs
+    const QList<NodeDependency>& steps = plan.steps();
+
+    // Copy steps from the intermediate cache where we can, and only run the steps below them that something else needs
+    QVector<RenderTexturePtr> hits(steps.size());
+    QVector<bool> needed(steps.size(), false);
+
+    for (int i=0;i<step_hashes.size();i++) {
+      if (!step_hashes.at(i).isEmpty()) {
+        hits[i] = parent_->intermediate_cache()->Get(step_hashes.at(i));
+      }
+    }
+
+    foreach (int dep_index, plan.OutputDependencies()) {
+      needed[dep_index] = true;
+    }
+
+    // Steps come after everything they depend on, so walking backwards visits every consumer before its dependencies
+    for (int i=steps.size()-1;i>=0;i--) {
+      if (needed.at(i) && hits.at(i) == nullptr) {
+        foreach (int dep_index, plan.StepDependencies(i)) {
+          needed[dep_index] = true;
+        }
+      }
+    }
+
+    QVector<TaskPtr> step_tasks;
+
+    for (int i=0;i<steps.size();i++) {
+      if (!needed.at(i)) {
+        continue;
+      }
+
+      TaskPtr dep_task = CreateDependencyTask(task, steps.at(i));
+
+      if (!step_hashes.isEmpty()) {
+        dep_task->hash = step_hashes.at(i);
+        dep_task->cached_texture = hits.at(i);
+      }
+
+      step_tasks.append(dep_task);
+    }
+
+    if (step_tasks.size() == 1) {
+      // Nothing to parallelize, just run it here
+      RunDependency(index, step_tasks.first());
+    } else if (!step_tasks.isEmpty()) {
+      // Queue every step at once, each becomes available to workers as soon as the steps it depends on are done, so
+      // independent branches run in parallel however deep they are
+      QVector<RenderFuture> step_futures(steps.size());
+
+      for (int i=0, j=0;i<steps.size();i++) {
+        if (!needed.at(i)) {
+          continue;
+        }
+
+        TaskPtr dep_task = step_tasks.at(j);
+        j++;
+
+        // Steps copied from the cache don't wait on anything
+        if (dep_task->cached_texture == nullptr) {
+          foreach (int dep_index, plan.StepDependencies(i)) {
+            dep_task->waits_on.append(step_futures.at(dep_index));
+          }
+        }
+
+        step_futures[i] = dep_task->promise.get_future().share();
+
+        Push(deques_.at(index), dep_task);
+      }
+
+      foreach (const RenderFuture& future, step_futures) {
+        // Steps below a cached one were never queued
+        if (future.valid()) {
+          WaitHelping(index, future);
+        }
+      }
+
+      // The steps may have been rendered in other workers' contexts, have ours wait for them on the GPU
+      if (!stopping_ && !IsCancelled(task)) {
+        foreach (int dep_index, plan.OutputDependencies()) {
+          WaitForTexture(step_futures.at(dep_index));
+        }
+      }
+    }
+
+    if (!stopping_ && !IsCancelled(task)) {
+      LockNodes(all_nodes);
+
+      // Get the requested value (every dependency in the plan will already have its value)
+      result.texture = output_to_process->get_value(time).takeTexture();
+
+      // Nothing downstream of the frame can apply deferred operations, so draw them in now
+      result.texture = RendererProcessor::CurrentInstance()->ResolvePendingOps(result.texture);
+
+      // Consumers wait on this fence rather than us stalling until the GPU is done
+      if (result.texture != nullptr) {
+        result.texture->Fence();
+      }
+
+      UnlockNodes(all_nodes);
+    }
+  }
+
+  running_lock_.lock();
+  running_.removeOne(task);
+  running_lock_.unlock();
+
+  // Cancelled part way through, whatever was rendered is incomplete
+  if (IsCancelled(task)) {
+    result.cancelled = true;
+    result.texture = nullptr;
+
+    // Values are cached by time, so the incomplete ones mustn't be reused when this frame is rendered again
+    if (result.cached) {
+      LockNodes(all_nodes);
+
+      foreach (Node* n, all_nodes) {
+        foreach (NodeParam* param, n->parameters()) {
+          param->ClearCachedValue();
+        }
+      }
+
+      UnlockNodes(all_nodes);
+    }
+  }
+
+  result.render_time = render_timer.nsecsElapsed();
+
+  task->promise.set_value(result);
+
+  emit FrameFinished();
+}
+
+void RendererScheduler::RunDependency(int index, TaskPtr task)
+{
+  // Let the frames the viewer is waiting on go first, this one can wait
+  if (task->priority == kPriorityBackground) {
+    YieldToInteractive(index);
+  }
+
+  NodeOutput* output_to_process = task->dep.node();
+  Node* node_to_process = output_to_process->parent();
+
+  QList<Node*> all_nodes = node_to_process->GetDependencies();
+  all_nodes.append(node_to_process);
+
+  // Steps we depend on may have been rendered in other workers' contexts
+  foreach (const RenderFuture& future, task->waits_on) {
+    WaitForTexture(future);
+  }
+
+  RenderResult result;
+  result.render_time = 0;
+
+  // Nodes are evaluated one step at a time, so this is where a cancelled frame stops
+  if (!IsCancelled(task)) {
+    LockNodes(all_nodes);
+
+    QElapsedTimer step_timer;
+    step_timer.start();
+
+    RenderInstance* instance = RendererProcessor::CurrentInstance();
+
+    if (task->cached_texture != nullptr) {
+      // Consumers may draw into their inputs, so they get a copy rather than the cached texture itself
+      task->cached_texture->WaitFence();
+
+      result.texture = instance->CopyTexture(task->cached_texture);
+
+      output_to_process->push_value(NodeValue(result.texture), task->dep.time());
+    } else {
+      result.texture = output_to_process->get_value(task->dep.time()).takeTexture();
+    }
+
+    // What caching this step saves is the time it took plus the time of the steps it waited on
+    result.render_time = step_timer.nsecsElapsed();
+
+    foreach (const RenderFuture& future, task->waits_on) {
+      result.render_time += future.get().render_time;
+    }
+
+    // Keep a copy of expensive steps before anything downstream gets to modify their texture
+    if (!task->hash.isEmpty()
+        && task->cached_texture == nullptr
+        && result.texture != nullptr
+        && result.render_time >= kIntermediateCacheMinimumCost
+        && !IsCancelled(task)) {
+      RenderTexturePtr copy = instance->CopyTexture(result.texture);
+      copy->Fence();
+
+      parent_->intermediate_cache()->Insert(task->hash, copy);
+    }
+
+    // Textures rendered here may be used from another worker's context, which will wait on this fence
+    if (result.texture != nullptr) {
+      result.texture->Fence();
+    }
+
+    UnlockNodes(all_nodes);
+  }
+
+  result.cached = false;
+  result.cancelled = false;
+  result.playback_speed = task->playback_speed;
+  result.playback_divider = task->playback_divider;
+  result.node = ThreadAffinity::CurrentNode();
+  result.static_in = task->dep.time();
+  result.static_out = task->dep.time();
+
+  task->promise.set_value(result);
+}
+
+void RendererScheduler::WaitHelping(int index, const RenderFuture &future)
+{
+  while (!stopping_ && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    // Only help with dependencies, starting new frames here could nest arbitrarily deep
+    TaskPtr task = TakeTask(index, false);
+
+    if (task != nullptr) {
+      Run(index, task);
+      continue;
+    }
+
+    // Our dependency is running on another worker, sleep until something finishes
+    wait_lock_.lock();
+
+    if (!stopping_
+        && future.wait_for(std::chrono::seconds(0)) != std::future_status::ready
+        && !HasTask(false)) {
+      wait_cond_.wait(&wait_lock_);
+    }
+
+    wait_lock_.unlock();
+  }
+}
+
+void RendererScheduler::WakeAll()
+{
+  wait_lock_.lock();
+  wait_cond_.wakeAll();
+  wait_lock_.unlock();
+}
+
+void RendererScheduler::LockNodes(QList<Node *> &nodes)
+{
+  // Dependencies can be shared, so remove duplicates and use a global order
+  std::sort(nodes.begin(), nodes.end());
+  nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+
+  foreach (Node* n, nodes) {
+    n->Lock();
+  }
+}
+
+void RendererScheduler::UnlockNodes(const QList<Node *> &nodes)
+{
+  foreach (Node* n, nodes) {
+    n->Unlock();
+  }
+}
@@ -0,0 +1,454 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERERSCHEDULER_H
+#define RENDERERSCHEDULER_H
+
+#include <future>
+#include <memory>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QObject>
+#include <QRect>
+#include <QVector>
+#include <QWaitCondition>
+
+#include "node/dependency.h"
+#include "render/rendertexture.h"
+#include "rendererprocessthread.h"
+
+class NodeExecutionPlan;
+class RendererProcessor;
+
+/**
+ * @brief The outcome of rendering one frame with RendererScheduler
+ */
+struct RenderResult {
+  /// The rendered texture, or nullptr if the frame was skipped or the node produced nothing
+  RenderTexturePtr texture;
+
+  rational time;
+
+  QByteArray hash;
+
+  /// TRUE if this frame was rendered, FALSE if it was skipped (because it's already cached or being cached)
+  bool cached;
+
+  /// TRUE if this frame was cancelled (see RendererScheduler::CancelPending()), either before it started rendering or
+  /// part way through, in which case `cached` may be TRUE but there's no texture
+  bool cancelled;
+
+  /// The playback speed the frame was rendered for (see RenderInstance::playback_speed())
+  int playback_speed;
+
+  /// The reduction media was decoded at for playback (see RenderInstance::playback_divider())
+  int playback_divider;
+
+  /// How long the frame took from being picked up by a worker to finishing, in nanoseconds. For the steps of a frame,
+  /// how long the step took plus the steps it waited on.
+  qint64 render_time;
+
+  /// The NUMA node of the worker that rendered the frame (see ThreadAffinity), -1 if workers aren't pinned
+  int node;
+
+  /// The range of time the frame's hash is the same for (see Node::StaticRange()), both are `time` if it's only that
+  rational static_in;
+  rational static_out;
+};
+
+using RenderFuture = std::shared_future<RenderResult>;
+
+/**
+ * @brief A work-stealing scheduler that runs render work on a set of RendererProcessThreads
+ *
+ * Frames are submitted with Submit() and their results are returned through a future. Each worker thread has its own
+ * deque of tasks: when rendering a frame, the worker pushes a task for every step of the frame's NodeExecutionPlan onto its
+ * deque and then helps run them while it waits. A step's task only becomes available once the steps it depends on are
+ * done, and idle workers steal from the front of other workers' deques, so independent branches of one frame (e.g. the
+ * clips of several tracks) are decoded and rendered in parallel in different contexts, joined through fences.
+ *
+ * Dependency tasks compute their output's value in advance (see NodeOutput::get_value()) so that when the frame's node
+ * runs, its dependency values are already available. Nodes are always locked in the same order (see LockNodes()) to
+ * prevent tasks with overlapping dependencies from deadlocking.
+ *
+ * Frames are either interactive (the viewer is waiting on them) or background (filling the cache). Interactive frames
+ * are started before background ones, and their steps preempt background work at node granularity: workers take them
+ * before anything else, and a background step that's about to run lets any pending interactive steps go first.
+ *
+ * Steps that are expensive to render (including everything below them) have a copy of their output kept in the
+ * RendererProcessor's RendererIntermediateCache. Before a frame's steps are queued, any step found there is copied
+ * from the cache instead of being evaluated, and the steps only it depended on aren't queued at all.
+ *
+ * FrameFinished() is emitted (from a worker thread) every time a frame's future becomes ready.
+ *
+ * The scheduler can also run without a RendererProcessor (e.g. for ExportTask), in which case there's no cache to
+ * check and every submitted frame is rendered.
+ */
+class RendererScheduler : public QObject
+{
+  Q_OBJECT
+public:
+  RendererScheduler(RendererProcessor* parent = nullptr);
+
+  virtual ~RendererScheduler() override;
+
+  enum Priority {
+    /// Frames rendered ahead of time for the cache (or for export)
+    kPriorityBackground,
+
+    /// Frames the viewer is waiting on or is about to show during playback
+    kPriorityInteractive
+  };
+
+  /**
+   * @brief Create and start the worker threads
+   *
+   * The parameters are references that must remain valid until Stop() (as with RendererThreadBase).
+   */
+  void Start(QOpenGLContext* share_ctx,
+             const int& width,
+             const int& height,
+             const int& divider,
+             const olive::PixelFormat& format,
+             const olive::RenderMode& mode,
+             int thread_count);
+
+  /**
+   * @brief Stop all worker threads and discard any work that hasn't started
+   *
+   * Futures of discarded frames are never fulfilled, so they should be discarded too.
+   */
+  void Stop();
+
+  /**
+   * @brief Change the size and format the workers render at without stopping them
+   *
+   * Every submitted frame is cancelled (see CancelRange()), and this blocks until each worker has finished or
+   * abandoned what it was doing and reconfigured its RenderInstance (see RendererThreadBase::Reconfigure()). Frames
+   * submitted afterwards are rendered with the new parameters.
+   */
+  void Reconfigure(const int& width,
+                   const int& height,
+                   const int& divider,
+                   const olive::PixelFormat& format,
+                   const olive::RenderMode& mode);
+
+  /**
+   * @brief Add or remove workers without stopping the others
+   *
+   * Every worker is parked while the set of workers changes. Frames that are already rendering are cancelled so they
+   * can't hold the workers up (see CancelRange()), frames that haven't started stay submitted. Removed workers are the
+   * last ones, and the steps left on their deques move to the first worker's. New workers are started like Start()'s,
+   * so the parameters are the same references.
+   */
+  void SetThreadCount(QOpenGLContext* share_ctx,
+                      const int& width,
+                      const int& height,
+                      const int& divider,
+                      const olive::PixelFormat& format,
+                      const olive::RenderMode& mode,
+                      int thread_count);
+
+  /**
+   * @brief Signal the worker threads to stop without waiting for them
+   *
+   * Safe to call from any thread.
+   */
+  void RequestStop();
+
+  /**
+   * @brief Queue a frame for rendering
+   *
+   * @param frame
+   *
+   * The output and time to render.
+   *
+   * @param tile
+   *
+   * The region of the frame to render (see RenderInstance::tile()), or a null rect for the whole frame. Node values
+   * are cached by time only, so tiles of the same time must not be in flight at once and each tile drops the values
+   * the previous one left behind. Tiles aren't supported with a RendererProcessor as its cache would mix them up.
+   *
+   * @param priority
+   *
+   * Interactive frames are started after any other interactive frames but before every background frame, and their
+   * steps are run ahead of background ones.
+   */
+  RenderFuture Submit(const NodeDependency& frame,
+                      const QRect& tile = QRect(),
+                      Priority priority = kPriorityBackground);
+
+  /**
+   * @brief Queue a quick low resolution version of a frame ahead of every other submitted frame
+   *
+   * Previews are interactive (see Submit()) and decode keyframes only and at kScrubPreviewDivider on top of the
+   * shuttle reduction, so they can be shown while the playhead is being dragged until the full quality frame is
+   * rendered.
+   */
+  RenderFuture SubmitPreview(const NodeDependency& frame);
+
+  /**
+   * @brief Cancel submitted frames that are behind the playhead
+   *
+   * Frames that no worker has started yet are discarded, and frames that are rendering stop at the next node (or
+   * decoder seek) that checks their cancellation flag (see RenderInstance::cancelled()). Either way, their futures are
+   * fulfilled with RenderResult::cancelled set to TRUE so they can be queued again later.
+   *
+   * @param backwards
+   *
+   * TRUE if playback is in reverse, in which case "behind" means later than the playhead.
+   */
+  void CancelPending(const rational& playhead, bool backwards);
+
+  /**
+   * @brief Discard every submitted frame that no worker has started yet, and cancel previews that are rendering
+   */
+  void CancelPending();
+
+  /**
+   * @brief Cancel every submitted frame between two times (inclusive), whether it has started rendering or not
+   *
+   * Used when these frames have been invalidated, so whatever they render would be out of date.
+   */
+  void CancelRange(const rational& start, const rational& end);
+
+  /**
+   * @brief The main loop of a worker thread, returns once the scheduler is stopped
+   */
+  void WorkerLoop(int index);
+
+  /**
+   * @brief Lock a set of nodes in a consistent order
+   *
+   * Duplicates are removed from `nodes`. Anything else that reads the graph off the main thread (e.g.
+   * RendererProcessor's rehashing) must lock the same way to avoid deadlocking with the workers.
+   */
+  static void LockNodes(QList<Node*>& nodes);
+
+  static void UnlockNodes(const QList<Node*>& nodes);
+
+signals:
+  void FrameFinished();
+
+private:
+  struct Task {
+    enum Type {
+      kFrame,
+      kDependency
+    };
+
+    Type type;
+
+    NodeDependency dep;
+
+    /// The playback speed when the frame was submitted, dependency tasks inherit their frame's
+    int playback_speed;
+
+    /// The playback divider when the frame was submitted, dependency tasks inherit their frame's
+    int playback_divider;
+
+    /// The region of the frame to render, null for all of it, dependency tasks inherit their frame's
+    QRect tile;
+
+    /// TRUE if this frame was submitted with SubmitPreview(), dependency tasks inherit their frame's
+    bool preview;
+
+    /// The frame's priority class, dependency tasks inherit their frame's
+    Priority priority;
+
+    /// Raised when the frame is no longer wanted, dependency tasks share their frame's
+    std::shared_ptr<QAtomicInt> cancelled;
+
+    /// For steps with a texture output, the hash of the step in the intermediate cache, empty if it isn't cached
+    QByteArray hash;
+
+    /// For steps found in the intermediate cache, the cached texture, which is copied rather than evaluating the step
+    RenderTexturePtr cached_texture;
+
+    /// Futures of other tasks that must be finished before this one can start
+    QList<RenderFuture> waits_on;
+
+    std::promise<RenderResult> promise;
+  };
+
+  using TaskPtr = std::shared_ptr<Task>;
+
+  struct TaskDeque {
+    QMutex lock;
+    QList<TaskPtr> tasks;
+  };
+
+  using TaskDequePtr = std::shared_ptr<TaskDeque>;
+
+  /**
+   * @brief Find the next task for a worker
+   *
+   * In order: interactive steps (see TakeInteractiveTask()), the back of its own deque, the front of other workers'
+   * deques, and (if `include_frames` is TRUE) newly submitted frames. Tasks that are still waiting on others (see
+   * IsReady()) are skipped, so a worker never blocks inside a task.
+   */
+  TaskPtr TakeTask(int index, bool include_frames);
+
+  /**
+   * @brief Find a ready interactive step for a worker, from its own deque first and then from other workers'
+   *
+   * Returns nullptr straight away if there aren't any queued (see interactive_pending_).
+   */
+  TaskPtr TakeInteractiveTask(int index);
+
+  /**
+   * @brief Take the first ready task from a deque, searching from the back if `from_back` is TRUE
+   */
+  TaskPtr TakeFrom(TaskDequePtr deque, bool from_back, bool interactive_only);
+
+  /**
+   * @brief Before a background step runs, run any interactive steps that are ready on this worker instead
+   */
+  void YieldToInteractive(int index);
+
+  /**
+   * @brief Returns TRUE if there's any task available to a worker
+   */
+  bool HasTask(bool include_frames);
+
+  /**
+   * @brief Returns TRUE if every task this task waits on has finished
+   */
+  static bool IsReady(TaskPtr task);
+
+  /**
+   * @brief Returns TRUE if this task's frame has been cancelled since it was submitted
+   */
+  static bool IsCancelled(TaskPtr task);
+
+  /**
+   * @brief Create a frame task for Submit() and SubmitPreview()
+   */
+  TaskPtr CreateFrameTask(const NodeDependency& frame, int playback_speed, int playback_divider);
+
+  /**
+   * @brief Create a task for one step of a frame's plan, inheriting the frame's settings
+   */
+  static TaskPtr CreateDependencyTask(TaskPtr frame, const NodeDependency& step);
+
+  /**
+   * @brief Returns the intermediate cache hash of each step of a plan, empty for steps that don't output a texture
+   *
+   * The nodes involved must be locked.
+   */
+  static QVector<QByteArray> StepHashes(const NodeExecutionPlan& plan, int playback_speed, int playback_divider);
+
+  /**
+   * @brief Add how a frame is being played back (shuttling or at a reduced resolution) to its memoized hash
+   */
+  static void AddPlaybackToHash(QByteArray* hash, int playback_speed, int playback_divider);
+
+  /**
+   * @brief Have the current context wait on the GPU for a finished task's texture (see RenderTexture::WaitFence())
+   */
+  static void WaitForTexture(const RenderFuture& future);
+
+  void Push(TaskDequePtr deque, TaskPtr task);
+
+  /**
+   * @brief Wait in WorkerLoop() while SetThreadCount() changes the workers
+   *
+   * Returns FALSE if this worker has been removed, in which case it should leave WorkerLoop() straight away.
+   */
+  bool Park(int index);
+
+  /**
+   * @brief Create and start worker `index`, whose deque must already exist
+   */
+  void StartWorker(int index,
+                   QOpenGLContext* share_ctx,
+                   const int& width,
+                   const int& height,
+                   const int& divider,
+                   const olive::PixelFormat& format,
+                   const olive::RenderMode& mode);
+
+  /**
+   * @brief Fulfill the futures of tasks taken out of submitted_ as cancelled
+   */
+  void FinishCancelled(const QList<TaskPtr>& cancelled);
+
+  void Run(int index, TaskPtr task);
+
+  void RunFrame(int index, TaskPtr task);
+
+  void RunDependency(int index, TaskPtr task);
+
+  /**
+   * @brief Run other tasks on this worker until a future is ready (or the scheduler is stopping)
+   */
+  void WaitHelping(int index, const RenderFuture& future);
+
+  /**
+   * @brief Wake every sleeping worker (e.g. because a task was added or finished)
+   */
+  void WakeAll();
+
+  RendererProcessor* parent_;
+
+  QVector<RendererProcessThreadPtr> threads_;
+
+  QVector<TaskDequePtr> deques_;
+
+  /**
+   * @brief Frames submitted with Submit() that haven't been picked up by a worker yet
+   */
+  TaskDequePtr submitted_;
+
+  /**
+   * @brief Frames that workers are currently rendering, so they can be cancelled part way through
+   */
+  QList<TaskPtr> running_;
+  QMutex running_lock_;
+
+  /**
+   * @brief Number of interactive steps in the workers' deques, so background work can check cheaply
+   */
+  QAtomicInt interactive_pending_;
+
+  QMutex wait_lock_;
+  QWaitCondition wait_cond_;
+
+  QAtomicInt stopping_;
+
+  /**
+   * @brief Raised by SetThreadCount() to have every worker park (see Park())
+   */
+  QAtomicInt paused_;
+
+  /**
+   * @brief Number of workers waiting in Park() (or that have left because they were removed), guarded by wait_lock_
+   */
+  int parked_;
+
+  /**
+   * @brief Number of workers wanted, ones with an index past this leave when they park, guarded by wait_lock_
+   */
+  int worker_count_;
+
+  QWaitCondition parked_cond_;
+};
+
+#endif // RENDERERSCHEDULER_H
@@ -22,6 +22,8 @@
 
 #include <QDebug>
 
+#include "common/threadaffinity.h"
+
 RendererThreadBase::RendererThreadBase(QOpenGLContext *share_ctx, const int &width, const int &height, const int &divider, const olive::PixelFormat &format, const olive::RenderMode &mode) :
   share_ctx_(share_ctx),
   width_(width),
@@ -29,7 +31,14 @@ RendererThreadBase::RendererThreadBase(QOpenGLContext *share_ctx, const int &wid
   divider_(divider),
   format_(format),
   mode_(mode),
-  render_instance_(nullptr)
+  render_instance_(nullptr),
+  affinity_node_(-1),
+  reconfigure_pending_(0),
+  pending_width_(width),
+  pending_height_(height),
+  pending_divider_(divider),
+  pending_format_(format),
+  pending_mode_(mode)
 {
   connect(share_ctx_, SIGNAL(aboutToBeDestroyed()), this, SLOT(Cancel()));
 }
@@ -39,8 +48,16 @@ RenderInstance *RendererThreadBase::render_instance()
   return render_instance_;
 }
 
+void RendererThreadBase::SetAffinityNode(int node)
+{
+  affinity_node_ = node;
+}
+
 void RendererThreadBase::run()
 {
+  // Pin before anything is allocated so the context and its buffers are created on this thread's node
+  ThreadAffinity::PinCurrentThread(affinity_node_);
+
   // Lock mutex for main loop
   mutex_.lock();
 
@@ -66,6 +83,12 @@ void RendererThreadBase::run()
   render_instance_ = nullptr;
   instance.Stop();
 
+  // Nothing's left to apply a reconfiguration to, so don't keep anyone waiting on one
+  reconfigure_lock_.lock();
+  reconfigure_pending_ = 0;
+  reconfigure_cond_.wakeAll();
+  reconfigure_lock_.unlock();
+
   // Unlock mutex before exiting
   mutex_.unlock();
 }
@@ -82,3 +105,58 @@ void RendererThreadBase::StartThread(QThread::Priority priority)
 
   caller_mutex_.unlock();
 }
+
+void RendererThreadBase::Reconfigure(const int &width,
+                                     const int &height,
+                                     const int &divider,
+                                     const olive::PixelFormat &format,
+                                     const olive::RenderMode &mode)
+{
+  reconfigure_lock_.lock();
+
+  pending_width_ = width;
+  pending_height_ = height;
+  pending_divider_ = divider;
+  pending_format_ = format;
+  pending_mode_ = mode;
+
+  reconfigure_pending_.storeRelease(1);
+
+  reconfigure_lock_.unlock();
+
+  Wake();
+}
+
+void RendererThreadBase::WaitForReconfigure()
+{
+  QMutexLocker locker(&reconfigure_lock_);
+
+  while (reconfigure_pending_.loadAcquire() && isRunning()) {
+    reconfigure_cond_.wait(&reconfigure_lock_);
+  }
+}
+
+bool RendererThreadBase::IsReconfigurePending() const
+{
+  return reconfigure_pending_.loadAcquire();
+}
+
+void RendererThreadBase::ApplyReconfigure()
+{
+  if (!reconfigure_pending_.loadAcquire()) {
+    return;
+  }
+
+  QMutexLocker locker(&reconfigure_lock_);
+
+  if (render_instance_ != nullptr) {
+    render_instance_->Reconfigure(pending_width_, pending_height_, pending_divider_, pending_format_, pending_mode_);
+  }
+
+  reconfigure_pending_ = 0;
+  reconfigure_cond_.wakeAll();
+}
+
+void RendererThreadBase::Wake()
+{
+}
@@ -22,6 +22,7 @@
 #define RENDERTHREAD_H
 
 #include <memory>
+#include <QAtomicInt>
 #include <QMutex>
 #include <QThread>
 #include <QWaitCondition>
@@ -42,8 +43,42 @@ public:
 
   RenderInstance* render_instance();
 
+  /**
+   * @brief Pin the thread to a NUMA node once it starts (see ThreadAffinity::PinCurrentThread()), call before StartThread()
+   */
+  void SetAffinityNode(int node);
+
   void StartThread(Priority priority = InheritPriority);
 
+  /**
+   * @brief Change the size and format of this thread's RenderInstance without recreating its context
+   *
+   * The thread applies it (see RenderInstance::Reconfigure()) the next time it has no work in progress, use
+   * WaitForReconfigure() to block until it has.
+   */
+  void Reconfigure(const int& width,
+                   const int& height,
+                   const int& divider,
+                   const olive::PixelFormat& format,
+                   const olive::RenderMode& mode);
+
+  /**
+   * @brief Block until a Reconfigure() has been applied (or the thread has exited)
+   */
+  void WaitForReconfigure();
+
+  /**
+   * @brief Returns TRUE if there's a Reconfigure() this thread hasn't applied yet
+   */
+  bool IsReconfigurePending() const;
+
+  /**
+   * @brief Apply a pending Reconfigure(), if any
+   *
+   * Must be called from this thread with its context current and nothing in progress, usually by ProcessLoop().
+   */
+  void ApplyReconfigure();
+
   virtual void run() override;
 
 public slots:
@@ -52,6 +87,13 @@ public slots:
 protected:
   virtual void ProcessLoop() = 0;
 
+  /**
+   * @brief Wake ProcessLoop() if it's sleeping so it can apply a Reconfigure()
+   *
+   * Does nothing by default, for threads whose owner wakes them itself (e.g. RendererScheduler's workers).
+   */
+  virtual void Wake();
+
   QWaitCondition wait_cond_;
 
   QMutex mutex_;
@@ -73,6 +115,24 @@ private:
 
   RenderInstance* render_instance_;
 
+  int affinity_node_;
+
+  QMutex reconfigure_lock_;
+
+  QWaitCondition reconfigure_cond_;
+
+  QAtomicInt reconfigure_pending_;
+
+  int pending_width_;
+
+  int pending_height_;
+
+  int pending_divider_;
+
+  olive::PixelFormat pending_format_;
+
+  olive::RenderMode pending_mode_;
+
 };
 
 using RendererThreadPtr = std::shared_ptr<RendererThreadBase>;
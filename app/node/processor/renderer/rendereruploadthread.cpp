@@ -0,0 +1,179 @@
+#include "rendereruploadthread.h"
+
+#include "config/config.h"
+#include "render/diskcachemanager.h"
+#include "render/renderstats.h"
+#include "renderercachecodec.h"
+
+RendererUploadThread::RendererUploadThread(QOpenGLContext *share_ctx,
+                                           const int &width,
+                                           const int &height,
+                                           const int &divider,
+                                           const olive::PixelFormat &format,
+                                           const olive::RenderMode &mode,
+                                           const olive::CacheFormat &cache_format,
+                                           RendererMemoryCache *memory_cache) :
+  RendererThreadBase(share_ctx, width, height, divider, format, mode),
+  cache_format_(cache_format),
+  memory_cache_(memory_cache),
+  cancelled_(false)
+{
+}
+
+void RendererUploadThread::Queue(const rational &time, const QByteArray &hash, const QString &fn)
+{
+  upload_queue_lock_.lock();
+
+  upload_queue_.append({time, hash, fn});
+
+  while (upload_queue_.size() > kViewerQueueSize) {
+    upload_queue_.removeFirst();
+  }
+
+  wait_cond_.wakeAll();
+
+  upload_queue_lock_.unlock();
+}
+
+void RendererUploadThread::Cancel()
+{
+  cancelled_ = true;
+
+  upload_queue_lock_.lock();
+  wait_cond_.wakeAll();
+  upload_queue_lock_.unlock();
+
+  wait();
+}
+
+void RendererUploadThread::Wake()
+{
+  upload_queue_lock_.lock();
+  wait_cond_.wakeAll();
+  upload_queue_lock_.unlock();
+}
+
+void RendererUploadThread::ProcessLoop()
+{
+  if (RendererCacheCodec::IsYUV(cache_format_)) {
+    yuv_packer_ = std::unique_ptr<YUVPacker>(new YUVPacker(RendererCacheCodec::IsVerticallySubsampled(cache_format_)));
+  }
+
+  UploadQueueEntry entry;
+
+  while (!cancelled_) {
+    upload_queue_lock_.lock();
+
+    while (upload_queue_.isEmpty() && !IsReconfigurePending()) {
+      wait_cond_.wait(&upload_queue_lock_);
+
+      if (cancelled_) {
+        break;
+      }
+    }
+    if (cancelled_) {
+      upload_queue_lock_.unlock();
+      break;
+    }
+
+    if (IsReconfigurePending()) {
+      // Frames queued so far are in the old size or format, whoever wanted them asks again
+      upload_queue_.clear();
+
+      upload_queue_lock_.unlock();
+
+      ApplyReconfigure();
+      continue;
+    }
+
+    entry = upload_queue_.takeFirst();
+
+    upload_queue_lock_.unlock();
+
+    emit FrameUploaded(Upload(entry), entry.time, entry.hash);
+  }
+
+  // Destroy the block textures while our context is still current, any the viewer still holds are destroyed with it
+  compressed_textures_.clear();
+
+  yuv_packer_ = nullptr;
+}
+
+RenderTexturePtr RendererUploadThread::Upload(const RendererUploadThread::UploadQueueEntry &entry)
+{
+  RenderInstance* instance = render_instance();
+
+  QByteArray frame = memory_cache_->Get(entry.hash);
+
+  if (frame.isNull()) {
+    // Frame isn't in memory, try loading it from the disk cache
+    if (!RendererCacheCodec::Read(entry.filename,
+                                  cache_format_,
+                                  instance->width(),
+                                  instance->height(),
+                                  instance->format(),
+                                  &frame)) {
+      olive::render_stats.Add(RenderStats::kMiss);
+      return nullptr;
+    }
+
+    memory_cache_->Insert(entry.hash, frame);
+
+    olive::disk_cache_manager.Touch(entry.filename);
+
+    olive::render_stats.Add(RenderStats::kDiskHit);
+  } else {
+    olive::render_stats.Add(RenderStats::kRAMHit);
+  }
+
+  if (cache_format_ == olive::kCacheFormatBC7) {
+    return UploadBlocks(frame);
+  }
+
+  if (yuv_packer_) {
+    RenderTexturePtr texture = yuv_packer_->Unpack(instance, frame);
+
+    texture->Fence();
+
+    return texture;
+  }
+
+  RenderTexturePtr texture = instance->texture_pool()->Get(instance->width(),
+                                                           instance->height(),
+                                                           instance->format(),
+                                                           RenderTexture::kSingleBuffer);
+
+  texture->Upload(frame.constData());
+
+  // The viewer draws this in its own context
+  texture->Fence();
+
+  return texture;
+}
+
+RenderTexturePtr RendererUploadThread::UploadBlocks(const QByteArray &blocks)
+{
+  RenderInstance* instance = render_instance();
+
+  RenderTexturePtr texture;
+
+  // Reuse a texture only we still hold, the pool can't since compressed textures can't be rendered into
+  foreach (const RenderTexturePtr& t, compressed_textures_) {
+    if (t.use_count() == 1) {
+      texture = t;
+      break;
+    }
+  }
+
+  if (!texture) {
+    texture = std::make_shared<RenderTexture>();
+    compressed_textures_.append(texture);
+  }
+
+  texture->CreateCompressed(instance->context(), instance->width(), instance->height(), blocks.constData(), blocks.size());
+
+  // The viewer draws this in its own context
+  texture->Fence();
+
+  return texture;
+}
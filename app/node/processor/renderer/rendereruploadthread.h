@@ -0,0 +1,95 @@
+#ifndef RENDERERUPLOADTHREAD_H
+#define RENDERERUPLOADTHREAD_H
+
+#include <memory>
+
+#include "render/cacheformat.h"
+#include "render/gl/yuvpacker.h"
+#include "renderermemorycache.h"
+#include "rendererthreadbase.h"
+
+/**
+ * @brief A thread that prepares cached frames for display
+ *
+ * Reading a frame back from the disk cache (or even just uploading it from the memory cache) is too slow to do on the
+ * GUI thread while scrubbing or playing. This thread loads the frames queued with Queue() and uploads them into
+ * textures in its own context, so by the time FrameUploaded() is received all that's left for the viewer is drawing.
+ */
+class RendererUploadThread : public RendererThreadBase
+{
+  Q_OBJECT
+public:
+  RendererUploadThread(QOpenGLContext* share_ctx,
+                       const int& width,
+                       const int& height,
+                       const int &divider,
+                       const olive::PixelFormat& format,
+                       const olive::RenderMode& mode,
+                       const olive::CacheFormat& cache_format,
+                       RendererMemoryCache* memory_cache);
+
+  /**
+   * @brief Queue a frame to be loaded and uploaded
+   *
+   * Frames are prepared in the order they're queued. If the queue grows past kViewerQueueSize, the oldest requests are
+   * dropped since whatever asked for them has moved on.
+   */
+  void Queue(const rational& time, const QByteArray& hash, const QString& fn);
+
+public slots:
+  virtual void Cancel() override;
+
+signals:
+  /**
+   * @brief Emitted when a frame is ready to draw
+   *
+   * The texture has been fenced (see RenderTexture::Fence()), or is nullptr if the frame couldn't be loaded.
+   */
+  void FrameUploaded(RenderTexturePtr texture, const rational& time, const QByteArray& hash);
+
+protected:
+  virtual void ProcessLoop() override;
+
+  virtual void Wake() override;
+
+private:
+  struct UploadQueueEntry {
+    rational time;
+    QByteArray hash;
+    QString filename;
+  };
+
+  RenderTexturePtr Upload(const UploadQueueEntry& entry);
+
+  /**
+   * @brief Upload an olive::kCacheFormatBC7 frame's blocks as they are, the GPU decompresses them when they're drawn
+   */
+  RenderTexturePtr UploadBlocks(const QByteArray& blocks);
+
+  olive::CacheFormat cache_format_;
+
+  RendererMemoryCache* memory_cache_;
+
+  QList<UploadQueueEntry> upload_queue_;
+
+  QMutex upload_queue_lock_;
+
+  QAtomicInt cancelled_;
+
+  /**
+   * @brief Textures created by UploadBlocks()
+   *
+   * Kept here so they're only ever destroyed in our context. They're reused once nothing else holds them.
+   */
+  QList<RenderTexturePtr> compressed_textures_;
+
+  /**
+   * @brief Unpacks olive::kCacheFormatYUV422 and olive::kCacheFormatYUV420 frames, created in ProcessLoop()
+   */
+  std::unique_ptr<YUVPacker> yuv_packer_;
+
+};
+
+using RendererUploadThreadPtr = std::shared_ptr<RendererUploadThread>;
+
+#endif // RENDERERUPLOADTHREAD_H
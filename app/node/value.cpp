@@ -0,0 +1,269 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "value.h"
+
+#include <cstring>
+
+NodeValue::NodeValue() :
+  type_(kNone)
+{
+  data_.ptr_ = nullptr;
+}
+
+NodeValue::NodeValue(int i) :
+  type_(kInt)
+{
+  data_.int_ = i;
+}
+
+NodeValue::NodeValue(double f) :
+  type_(kFloat)
+{
+  data_.float_ = f;
+}
+
+NodeValue::NodeValue(bool b) :
+  type_(kBoolean)
+{
+  data_.bool_ = b;
+}
+
+NodeValue::NodeValue(const rational &r) :
+  type_(kRational)
+{
+  data_.rational_[0] = r.numerator();
+  data_.rational_[1] = r.denominator();
+}
+
+NodeValue::NodeValue(const QVector2D &v) :
+  type_(kVec2)
+{
+  data_.floats_[0] = v.x();
+  data_.floats_[1] = v.y();
+}
+
+NodeValue::NodeValue(const QVector3D &v) :
+  type_(kVec3)
+{
+  data_.floats_[0] = v.x();
+  data_.floats_[1] = v.y();
+  data_.floats_[2] = v.z();
+}
+
+NodeValue::NodeValue(const QVector4D &v) :
+  type_(kVec4)
+{
+  data_.floats_[0] = v.x();
+  data_.floats_[1] = v.y();
+  data_.floats_[2] = v.z();
+  data_.floats_[3] = v.w();
+}
+
+NodeValue::NodeValue(const QColor &c) :
+  type_(kColor)
+{
+  data_.floats_[0] = static_cast<float>(c.redF());
+  data_.floats_[1] = static_cast<float>(c.greenF());
+  data_.floats_[2] = static_cast<float>(c.blueF());
+  data_.floats_[3] = static_cast<float>(c.alphaF());
+}
+
+NodeValue::NodeValue(const QMatrix4x4 &m) :
+  type_(kMatrix)
+{
+  memcpy(data_.floats_, m.constData(), sizeof(data_.floats_));
+}
+
+NodeValue::NodeValue(const QString &s) :
+  type_(kString),
+  string_(s)
+{
+  data_.ptr_ = nullptr;
+}
+
+NodeValue::NodeValue(const RenderTexturePtr &texture) :
+  type_(kTexture),
+  texture_(texture)
+{
+  data_.ptr_ = nullptr;
+}
+
+NodeValue::NodeValue(RenderTexturePtr &&texture) :
+  type_(kTexture),
+  texture_(std::move(texture))
+{
+  data_.ptr_ = nullptr;
+}
+
+NodeValue NodeValue::FromPtr(void *ptr)
+{
+  NodeValue v;
+  v.type_ = kPointer;
+  v.data_.ptr_ = ptr;
+  return v;
+}
+
+const NodeValue::Type &NodeValue::type() const
+{
+  return type_;
+}
+
+bool NodeValue::isNull() const
+{
+  return type_ == kNone || (type_ == kTexture && texture_ == nullptr);
+}
+
+int NodeValue::toInt() const
+{
+  switch (type_) {
+  case kInt: return data_.int_;
+  case kFloat: return qRound(data_.float_);
+  case kBoolean: return data_.bool_ ? 1 : 0;
+  default: return 0;
+  }
+}
+
+double NodeValue::toDouble() const
+{
+  switch (type_) {
+  case kInt: return data_.int_;
+  case kFloat: return data_.float_;
+  case kBoolean: return data_.bool_ ? 1.0 : 0.0;
+  case kRational: return toRational().toDouble();
+  default: return 0.0;
+  }
+}
+
+float NodeValue::toFloat() const
+{
+  return static_cast<float>(toDouble());
+}
+
+bool NodeValue::toBool() const
+{
+  switch (type_) {
+  case kInt: return data_.int_ != 0;
+  case kFloat: return !qFuzzyIsNull(data_.float_);
+  case kBoolean: return data_.bool_;
+  default: return false;
+  }
+}
+
+rational NodeValue::toRational() const
+{
+  if (type_ == kRational) {
+    return rational(data_.rational_[0], data_.rational_[1]);
+  }
+
+  if (type_ == kInt) {
+    return rational(data_.int_);
+  }
+
+  return rational();
+}
+
+QVector2D NodeValue::toVec2() const
+{
+  if (type_ == kVec2 || type_ == kVec3 || type_ == kVec4) {
+    return QVector2D(data_.floats_[0], data_.floats_[1]);
+  }
+
+  return QVector2D();
+}
+
+QVector3D NodeValue::toVec3() const
+{
+  if (type_ == kVec3 || type_ == kVec4) {
+    return QVector3D(data_.floats_[0], data_.floats_[1], data_.floats_[2]);
+  }
+
+  return QVector3D();
+}
+
+QVector4D NodeValue::toVec4() const
+{
+  if (type_ == kVec4 || type_ == kColor) {
+    return QVector4D(data_.floats_[0], data_.floats_[1], data_.floats_[2], data_.floats_[3]);
+  }
+
+  return QVector4D();
+}
+
+QColor NodeValue::toColor() const
+{
+  if (type_ == kColor) {
+    return QColor::fromRgbF(static_cast<qreal>(data_.floats_[0]),
+                            static_cast<qreal>(data_.floats_[1]),
+                            static_cast<qreal>(data_.floats_[2]),
+                            static_cast<qreal>(data_.floats_[3]));
+  }
+
+  return QColor();
+}
+
+QMatrix4x4 NodeValue::toMatrix() const
+{
+  QMatrix4x4 m;
+
+  if (type_ == kMatrix) {
+    // QMatrix4x4::data() is column-major like constData(), unlike the QMatrix4x4(const float*) constructor
+    memcpy(m.data(), data_.floats_, sizeof(data_.floats_));
+  }
+
+  return m;
+}
+
+const QString &NodeValue::toString() const
+{
+  return string_;
+}
+
+const RenderTexturePtr &NodeValue::toTexture() const
+{
+  return texture_;
+}
+
+RenderTexturePtr NodeValue::takeTexture()
+{
+  return std::move(texture_);
+}
+
+QVariant NodeValue::ToVariant() const
+{
+  switch (type_) {
+  case kInt: return data_.int_;
+  case kFloat: return data_.float_;
+  case kBoolean: return data_.bool_;
+  case kRational: return QVariant::fromValue(toRational());
+  case kVec2: return QVariant::fromValue(toVec2());
+  case kVec3: return QVariant::fromValue(toVec3());
+  case kVec4: return QVariant::fromValue(toVec4());
+  case kColor: return QVariant::fromValue(toColor());
+  case kMatrix: return QVariant::fromValue(toMatrix());
+  case kString: return string_;
+  case kTexture: return QVariant::fromValue(texture_);
+  case kPointer: return reinterpret_cast<quintptr>(data_.ptr_);
+  case kNone:
+    break;
+  }
+
+  return QVariant();
+}
@@ -0,0 +1,156 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef NODEVALUE_H
+#define NODEVALUE_H
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QString>
+#include <QVariant>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+
+#include "common/rational.h"
+#include "render/rendertexture.h"
+
+/**
+ * @brief A value passed between NodeParams during graph evaluation
+ *
+ * A small typed variant over the NodeParam::DataType values. Numbers, vectors, matrices, colors, rationals and
+ * pointers are stored inline, so passing them from an output to an input is a plain copy with no heap allocation or
+ * type registry lookup like QVariant needs. Textures are stored as the RenderTexturePtr itself and are moved wherever
+ * possible to avoid reference count traffic.
+ *
+ * QVariant is still used where values meet the UI or are serialized (e.g. NodeKeyframe), see ToVariant() and
+ * NodeParam::VariantToValue().
+ */
+class NodeValue
+{
+public:
+  /**
+   * @brief How a value is stored
+   *
+   * Several NodeParam::DataTypes share a storage type (e.g. kString, kFile and kFont are all kString, and kBlock,
+   * kTrack and kFootage are all kPointer).
+   */
+  enum Type {
+    kNone,
+    kInt,
+    kFloat,
+    kBoolean,
+    kRational,
+    kVec2,
+    kVec3,
+    kVec4,
+    kColor,
+    kMatrix,
+    kString,
+    kTexture,
+    kPointer
+  };
+
+  NodeValue();
+  NodeValue(int i);
+  NodeValue(double f);
+  NodeValue(bool b);
+  NodeValue(const rational& r);
+  NodeValue(const QVector2D& v);
+  NodeValue(const QVector3D& v);
+  NodeValue(const QVector4D& v);
+  NodeValue(const QColor& c);
+  NodeValue(const QMatrix4x4& m);
+  NodeValue(const QString& s);
+  NodeValue(const RenderTexturePtr& texture);
+  NodeValue(RenderTexturePtr&& texture);
+
+  /**
+   * @brief Pointers must go through FromPtr(), this stops them from silently converting to kBoolean
+   */
+  NodeValue(const void* ptr) = delete;
+
+  NodeValue(const NodeValue& other) = default;
+  NodeValue(NodeValue&& other) = default;
+  NodeValue& operator=(const NodeValue& other) = default;
+  NodeValue& operator=(NodeValue&& other) = default;
+
+  /**
+   * @brief Create a value that points to an object (e.g. a Block or Footage)
+   */
+  static NodeValue FromPtr(void* ptr);
+
+  const Type& type() const;
+
+  bool isNull() const;
+
+  int toInt() const;
+  double toDouble() const;
+  float toFloat() const;
+  bool toBool() const;
+  rational toRational() const;
+  QVector2D toVec2() const;
+  QVector3D toVec3() const;
+  QVector4D toVec4() const;
+  QColor toColor() const;
+  QMatrix4x4 toMatrix() const;
+  const QString& toString() const;
+  const RenderTexturePtr& toTexture() const;
+
+  /**
+   * @brief Move the texture out of this value, leaving it null
+   *
+   * Use this instead of toTexture() when this value is a temporary to skip a reference count increment/decrement.
+   */
+  RenderTexturePtr takeTexture();
+
+  template<class T>
+  T* toPtr() const;
+
+  /**
+   * @brief Convert to a QVariant for the UI or serialization
+   */
+  QVariant ToVariant() const;
+
+private:
+  Type type_;
+
+  union {
+    int int_;
+    double float_;
+    bool bool_;
+    intType rational_[2];
+    float floats_[16];
+    void* ptr_;
+  } data_;
+
+  QString string_;
+
+  RenderTexturePtr texture_;
+
+};
+
+template<class T>
+T* NodeValue::toPtr() const
+{
+  return (type_ == kPointer) ? static_cast<T*>(data_.ptr_) : nullptr;
+}
+
+#endif // NODEVALUE_H
@@ -0,0 +1,45 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MEMORY_PANEL_H
+#define MEMORY_PANEL_H
+
+#include "widget/memoryview/memoryview.h"
+#include "widget/panel/panel.h"
+
+/**
+ * @brief A PanelWidget wrapper around a MemoryView widget
+ */
+class MemoryPanel : public PanelWidget
+{
+  Q_OBJECT
+public:
+  MemoryPanel(QWidget* parent);
+
+protected:
+  virtual void changeEvent(QEvent* e) override;
+
+private:
+  void Retranslate();
+
+  MemoryView* view_;
+};
+
+#endif // MEMORY_PANEL_H
@@ -0,0 +1,47 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "profiler.h"
+
+ProfilerPanel::ProfilerPanel(QWidget* parent) :
+  PanelWidget(parent)
+{
+  // Create profiler view
+  view_ = new ProfilerView(this);
+
+  // Set it as the main widget
+  setWidget(view_);
+
+  // Set strings
+  Retranslate();
+}
+
+void ProfilerPanel::changeEvent(QEvent *e)
+{
+  if (e->type() == QEvent::LanguageChange) {
+    Retranslate();
+  }
+  QDockWidget::changeEvent(e);
+}
+
+void ProfilerPanel::Retranslate()
+{
+  SetTitle(tr("Profiler"));
+}
@@ -24,6 +24,7 @@
 #include <QVBoxLayout>
 
 #include "core.h"
+#include "project/item/sequence/sequence.h"
 #include "widget/menu/menushared.h"
 #include "widget/projecttoolbar/projecttoolbar.h"
 
@@ -49,6 +50,9 @@ ProjectPanel::ProjectPanel(QWidget *parent) :
   layout->addWidget(explorer_);
   connect(explorer_, SIGNAL(DoubleClickedItem(Item*)), this, SLOT(ItemDoubleClickSlot(Item*)));
 
+  // Filter the explorer as the user types in the toolbar's search field
+  connect(toolbar, SIGNAL(SearchChanged(const QString&)), explorer_, SLOT(SetSearch(const QString&)));
+
   // Set toolbar's view to the explorer's view
   toolbar->SetView(explorer_->view_type());
 
@@ -118,9 +122,12 @@ void ProjectPanel::ItemDoubleClickSlot(Item *item)
   if (item == nullptr) {
     // If the user double clicks on empty space, show the import dialog
     olive::core.DialogImportShow();
+  } else if (item->type() == Item::kSequence) {
+    // Opening a sequence loads its nodes if the project was loaded without them
+    olive::core.OpenSequence(static_cast<Sequence*>(item));
   }
 
-  // FIXME: Double click Item should do something
+  // FIXME: Double clicking other Items should do something
 }
 
 void ProjectPanel::ShowNewMenu()
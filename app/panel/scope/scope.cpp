@@ -0,0 +1,75 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "scope.h"
+
+#include <QVBoxLayout>
+
+ScopePanel::ScopePanel(QWidget* parent) :
+  PanelWidget(parent)
+{
+  QWidget* central = new QWidget(this);
+
+  QVBoxLayout* layout = new QVBoxLayout(central);
+  layout->setMargin(0);
+  layout->setSpacing(0);
+
+  type_combobox_ = new QComboBox(central);
+  layout->addWidget(type_combobox_);
+
+  scope_ = new ScopeWidget(central);
+  layout->addWidget(scope_);
+
+  // Items are named in Retranslate() and are in the same order as olive::ScopeType
+  for (int i=0;i<olive::kScopeTypeCount;i++) {
+    type_combobox_->addItem(QString());
+  }
+
+  connect(type_combobox_, SIGNAL(currentIndexChanged(int)), scope_, SLOT(SetType(int)));
+
+  // Set it as the main widget
+  setWidget(central);
+
+  // Set strings
+  Retranslate();
+}
+
+void ScopePanel::SetTexture(RenderTexturePtr tex)
+{
+  scope_->SetTexture(tex);
+}
+
+void ScopePanel::changeEvent(QEvent *e)
+{
+  if (e->type() == QEvent::LanguageChange) {
+    Retranslate();
+  }
+  QDockWidget::changeEvent(e);
+}
+
+void ScopePanel::Retranslate()
+{
+  SetTitle(tr("Scopes"));
+
+  type_combobox_->setItemText(olive::kScopeWaveform, tr("Waveform"));
+  type_combobox_->setItemText(olive::kScopeParade, tr("RGB Parade"));
+  type_combobox_->setItemText(olive::kScopeVectorscope, tr("Vectorscope"));
+  type_combobox_->setItemText(olive::kScopeHistogram, tr("Histogram"));
+}
@@ -18,35 +18,40 @@
 
 ***/
 
-#ifndef TIMELINEVIEWPLAYHEADITEM_H
-#define TIMELINEVIEWPLAYHEADITEM_H
+#ifndef SCOPE_PANEL_H
+#define SCOPE_PANEL_H
 
-#include "timelineplayhead.h"
-#include "timelineviewrect.h"
+#include <QComboBox>
+
+#include "widget/panel/panel.h"
+#include "widget/scope/scopewidget.h"
 
 /**
- * @brief A graphical representation of the playhead on the Timeline
+ * @brief A PanelWidget showing a ScopeWidget, with a choice of which scope to show
  */
-class TimelineViewPlayheadItem : public TimelineViewRect
+class ScopePanel : public PanelWidget
 {
+  Q_OBJECT
 public:
-  TimelineViewPlayheadItem(QGraphicsItem* parent = nullptr);
-
-  void SetPlayhead(const int64_t& playhead);
-
-  void SetTimebase(const rational& timebase);
+  ScopePanel(QWidget* parent);
 
-  virtual void UpdateRect() override;
+public slots:
+  /**
+   * @brief Set the frame to show the scope of
+   *
+   * Connect this to a viewer's TextureChanged() signal.
+   */
+  void SetTexture(RenderTexturePtr tex);
 
 protected:
-  virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+  virtual void changeEvent(QEvent* e) override;
 
 private:
-  int64_t playhead_;
+  void Retranslate();
 
-  rational timebase_;
+  QComboBox* type_combobox_;
 
-  TimelinePlayhead style_;
+  ScopeWidget* scope_;
 };
 
-#endif // TIMELINEVIEWPLAYHEADITEM_H
+#endif // SCOPE_PANEL_H
@@ -20,16 +20,24 @@
 
 #include "viewer.h"
 
+#include "core.h"
+
 ViewerPanel::ViewerPanel(QWidget *parent) :
   PanelWidget(parent)
 {
   // QObject system handles deleting this
   viewer_ = new ViewerWidget(this);
   connect(viewer_, SIGNAL(TimeChanged(const rational&)), this, SIGNAL(TimeChanged(const rational&)));
+  connect(viewer_, SIGNAL(PlaybackSpeedChanged(int)), this, SIGNAL(PlaybackSpeedChanged(int)));
+  connect(viewer_, SIGNAL(TextureChanged(RenderTexturePtr)), this, SIGNAL(TextureChanged(RenderTexturePtr)));
+  connect(viewer_, SIGNAL(DisplaySizeChanged(const QSize&)), this, SIGNAL(DisplaySizeChanged(const QSize&)));
 
   // Set ViewerWidget as the central widget
   setWidget(viewer_);
 
+  viewer_->SetStatsOverlayVisible(olive::core.render_stats_visible());
+  connect(&olive::core, SIGNAL(RenderStatsVisibleChanged(bool)), viewer_, SLOT(SetStatsOverlayVisible(bool)));
+
   // Set strings
   Retranslate();
 }
@@ -59,6 +67,21 @@ void ViewerPanel::PlayPause()
   viewer_->TogglePlayPause();
 }
 
+void ViewerPanel::ShuttleLeft()
+{
+  viewer_->ShuttleLeft();
+}
+
+void ViewerPanel::ShuttleStop()
+{
+  viewer_->ShuttleStop();
+}
+
+void ViewerPanel::ShuttleRight()
+{
+  viewer_->ShuttleRight();
+}
+
 void ViewerPanel::NextFrame()
 {
   viewer_->NextFrame();
@@ -79,7 +102,22 @@ rational ViewerPanel::GetTime()
   return viewer_->GetTime();
 }
 
-void ViewerPanel::SetTexture(GLuint tex)
+QSize ViewerPanel::GetDisplaySize()
+{
+  return viewer_->display_size();
+}
+
+void ViewerPanel::SetAudioSource(AudioEngine *engine)
+{
+  viewer_->SetAudioSource(engine);
+}
+
+void ViewerPanel::SetCacheRanges(const FrameRangeSet &cached, const FrameRangeSet &dirty)
+{
+  viewer_->SetCacheRanges(cached, dirty);
+}
+
+void ViewerPanel::SetTexture(RenderTexturePtr tex)
 {
   viewer_->SetTexture(tex);
 }
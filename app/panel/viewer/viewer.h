@@ -44,6 +44,12 @@ public:
 
   virtual void PlayPause() override;
 
+  virtual void ShuttleLeft() override;
+
+  virtual void ShuttleStop() override;
+
+  virtual void ShuttleRight() override;
+
   virtual void NextFrame() override;
 
   virtual void GoToEnd() override;
@@ -52,6 +58,21 @@ public:
 
   rational GetTime();
 
+  /**
+   * @brief Size the viewer draws images at in device pixels (see ViewerWidget::display_size())
+   */
+  QSize GetDisplaySize();
+
+  /**
+   * @brief Wrapper for ViewerWidget::SetAudioSource()
+   */
+  void SetAudioSource(AudioEngine* engine);
+
+  /**
+   * @brief Wrapper for ViewerWidget::SetCacheRanges()
+   */
+  void SetCacheRanges(const FrameRangeSet& cached, const FrameRangeSet& dirty);
+
 public slots:
   /**
    * @brief Set the texture to draw and draw it
@@ -60,7 +81,7 @@ public slots:
    *
    * @param tex
    */
-  void SetTexture(GLuint tex);
+  void SetTexture(RenderTexturePtr tex);
 
 protected:
   virtual void changeEvent(QEvent* e) override;
@@ -68,6 +89,15 @@ protected:
 signals:
   void TimeChanged(const rational&);
 
+  void PlaybackSpeedChanged(int speed);
+
+  /**
+   * @brief Emitted whenever the viewer shows a new texture (see ViewerWidget::TextureChanged())
+   */
+  void TextureChanged(RenderTexturePtr tex);
+
+  void DisplaySizeChanged(const QSize& size);
+
 private:
   void Retranslate();
 
@@ -21,7 +21,9 @@
 #include "footage.h"
 
 #include <QCoreApplication>
+#include <QStringList>
 
+#include "common/filefunctions.h"
 #include "ui/icons/icons.h"
 
 Footage::Footage()
@@ -46,6 +48,9 @@ void Footage::set_status(const Footage::Status &status)
   UpdateIcon();
 
   UpdateTooltip();
+
+  // Probing fills in the streams searched by SearchMetadata()
+  UpdateSearchIndex();
 }
 
 void Footage::Clear()
@@ -53,6 +58,11 @@ void Footage::Clear()
   // Clear all streams
   ClearStreams();
 
+  // Re-probing means the file may have changed
+  unique_identifier_lock_.lock();
+  unique_identifier_.clear();
+  unique_identifier_lock_.unlock();
+
   // Reset ready state
   set_status(kUnprobed);
 }
@@ -65,6 +75,23 @@ const QString &Footage::filename()
 void Footage::set_filename(const QString &s)
 {
   filename_ = s;
+
+  unique_identifier_lock_.lock();
+  unique_identifier_.clear();
+  unique_identifier_lock_.unlock();
+
+  UpdateSearchIndex();
+}
+
+QString Footage::unique_identifier()
+{
+  QMutexLocker locker(&unique_identifier_lock_);
+
+  if (unique_identifier_.isEmpty()) {
+    unique_identifier_ = GetUniqueFileIdentifier(filename_);
+  }
+
+  return unique_identifier_;
 }
 
 const QDateTime &Footage::timestamp()
@@ -168,6 +195,38 @@ void Footage::UpdateIcon()
   }
 }
 
+QString Footage::SearchMetadata()
+{
+  QStringList metadata;
+
+  metadata.append(filename_);
+  metadata.append(decoder_);
+
+  foreach (StreamPtr s, streams_) {
+    switch (s->type()) {
+    case Stream::kVideo:
+    case Stream::kImage:
+    {
+      ImageStreamPtr vs = std::static_pointer_cast<ImageStream>(s);
+
+      metadata.append(QStringLiteral("%1x%2").arg(QString::number(vs->width()), QString::number(vs->height())));
+      break;
+    }
+    case Stream::kAudio:
+    {
+      AudioStreamPtr as = std::static_pointer_cast<AudioStream>(s);
+
+      metadata.append(QStringLiteral("%1 Hz").arg(as->sample_rate()));
+      break;
+    }
+    default:
+      break;
+    }
+  }
+
+  return metadata.join('\n');
+}
+
 void Footage::UpdateTooltip()
 {
   switch (status_) {
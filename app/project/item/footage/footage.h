@@ -23,6 +23,7 @@
 
 #include <QList>
 #include <QDateTime>
+#include <QMutex>
 
 #include "common/rational.h"
 #include "project/item/item.h"
@@ -128,6 +129,14 @@ public:
    */
   void set_filename(const QString& s);
 
+  /**
+   * @brief Returns GetUniqueFileIdentifier() of the file, which identifies this footage across sessions
+   *
+   * Frames are hashed by this (see NodeParam::ValueToBytes()) so it's only worked out once, until the footage is
+   * relinked or re-probed. Thread-safe.
+   */
+  QString unique_identifier();
+
   /**
    * @brief Retrieve the last modified time/date
    *
@@ -200,6 +209,11 @@ public:
    */
   void set_decoder(const QString& id);
 
+  /**
+   * @brief Item::SearchMetadata() override, the filename, decoder and the resolution or sample rate of each stream
+   */
+  virtual QString SearchMetadata() override;
+
 private:
   /**
    * @brief Internal function to delete all Stream children and empty the array
@@ -241,6 +255,16 @@ private:
    */
   QDateTime timestamp_;
 
+  /**
+   * @brief Cached unique_identifier(), empty if it hasn't been worked out yet
+   */
+  QString unique_identifier_;
+
+  /**
+   * @brief Lock for unique_identifier_, which is read from the render threads
+   */
+  QMutex unique_identifier_lock_;
+
   /**
    * @brief Internal streams array
    */
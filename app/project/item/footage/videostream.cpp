@@ -20,7 +20,21 @@
 
 #include "videostream.h"
 
+#include <atomic>
+
+#include "footage.h"
+
 VideoStream::VideoStream()
 {
   set_type(kVideo);
 }
+
+std::shared_ptr<Footage> VideoStream::proxy()
+{
+  return std::atomic_load(&proxy_);
+}
+
+void VideoStream::set_proxy(std::shared_ptr<Footage> proxy)
+{
+  std::atomic_store(&proxy_, proxy);
+}
@@ -23,10 +23,28 @@
 
 #include "imagestream.h"
 
+class Footage;
+
 class VideoStream : public ImageStream
 {
 public:
   VideoStream();
+
+  /**
+   * @brief Retrieve the lower resolution proxy of this stream (nullptr if there isn't one)
+   *
+   * A proxy is a separate Footage file (see ProxyAnalyzer) whose first stream has the same timing as this one, but is
+   * quicker to decode. Thread-safe, render threads read this while proxies are attached from the main thread.
+   */
+  std::shared_ptr<Footage> proxy();
+
+  /**
+   * @brief Attach a proxy to this stream, thread-safe
+   */
+  void set_proxy(std::shared_ptr<Footage> proxy);
+
+private:
+  std::shared_ptr<Footage> proxy_;
 };
 
 using VideoStreamPtr = std::shared_ptr<VideoStream>;
@@ -20,8 +20,13 @@
 
 #include "item.h"
 
+#include "project/projectsearchindex.h"
+
 Item::Item() :
-  parent_(nullptr)
+  parent_(nullptr),
+  row_(-1),
+  file_key_(-1),
+  search_index_(nullptr)
 {
 }
 
@@ -39,8 +44,18 @@ void Item::add_child(ItemPtr c)
     c->parent_->remove_child(c.get());
   }
 
+  c->row_ = children_.size();
   children_.append(c);
   c->parent_ = this;
+
+  children_by_name_.insert(c->name_, c.get());
+  children_by_type_[c->type()].insert(c.get());
+
+  ProjectSearchIndex* index = search_index();
+
+  if (index != nullptr) {
+    index->Insert(c.get());
+  }
 }
 
 void Item::remove_child(Item *c)
@@ -49,15 +64,24 @@ void Item::remove_child(Item *c)
     return;
   }
 
-  // Remove all instances of this child in the list
-  for (int i=0;i<children_.size();i++) {
-    if (children_.at(i).get() == c) {
-      children_.removeAt(i);
-      i--;
-    }
+  ProjectSearchIndex* index = search_index();
+
+  if (index != nullptr) {
+    index->Remove(c);
+  }
+
+  children_.removeAt(c->row_);
+
+  // Every child after this one has moved up a row
+  for (int i=c->row_;i<children_.size();i++) {
+    children_.at(i)->row_ = i;
   }
 
+  children_by_name_.remove(c->name_, c);
+  children_by_type_[c->type()].remove(c);
+
   c->parent_ = nullptr;
+  c->row_ = -1;
 }
 
 int Item::child_count() const
@@ -70,12 +94,26 @@ Item *Item::child(int i) const
   return children_.at(i).get();
 }
 
+int Item::row() const
+{
+  return row_;
+}
+
+QList<Item *> Item::children_of_type(Item::Type type) const
+{
+  QList<Item*> children;
+
+  foreach (Item* child, children_by_type_.value(type)) {
+    children.append(child);
+  }
+
+  return children;
+}
+
 ItemPtr Item::shared_ptr_from_raw(Item *item)
 {
-  for (int i=0;i<children_.size();i++) {
-    if (children_.at(i).get() == item) {
-      return children_.at(i);
-    }
+  if (item->parent_ == this) {
+    return children_.at(item->row_);
   }
 
   return nullptr;
@@ -88,7 +126,15 @@ const QString &Item::name() const
 
 void Item::set_name(const QString &n)
 {
+  if (parent_ != nullptr) {
+    parent_->children_by_name_.remove(name_, this);
+    parent_->children_by_name_.insert(n, this);
+  }
+
   name_ = n;
+
+  // Everything inside a folder is searched by its path too
+  UpdateSearchIndex();
 }
 
 const QString &Item::tooltip() const
@@ -139,21 +185,53 @@ bool Item::ChildExistsWithName(const QString &name)
 
 bool Item::ChildExistsWithNameInternal(const QString &name, Item *folder)
 {
-  // Loop through all children
-  for (int i=0;i<folder->child_count();i++) {
-    Item* child = folder->child(i);
+  // Check this folder's immediate children
+  if (folder->children_by_name_.contains(name)) {
+    return true;
+  }
 
-    // If this child has the same name, return true
-    if (child->name() == name) {
+  // Then search any folders inside it
+  foreach (Item* child, folder->children_by_type_.value(kFolder)) {
+    if (ChildExistsWithNameInternal(name, child)) {
+      // If it returns true, we've found a child so we can return now
       return true;
-    } else if (child->CanHaveChildren()) {
-      // If the child has children, run function recursively on this item
-      if (ChildExistsWithNameInternal(name, child)) {
-        // If it returns true, we've found a child so we can return now
-        return true;
-      }
     }
   }
 
   return false;
 }
+
+int Item::file_key() const
+{
+  return file_key_;
+}
+
+void Item::set_file_key(int key)
+{
+  file_key_ = key;
+}
+
+ProjectSearchIndex *Item::search_index() const
+{
+  return root()->search_index_;
+}
+
+void Item::set_search_index(ProjectSearchIndex *index)
+{
+  search_index_ = index;
+}
+
+QString Item::SearchMetadata()
+{
+  return QString();
+}
+
+void Item::UpdateSearchIndex()
+{
+  // Items that haven't been added to a folder yet are indexed once they are
+  ProjectSearchIndex* index = search_index();
+
+  if (index != nullptr && parent_ != nullptr) {
+    index->Update(this);
+  }
+}
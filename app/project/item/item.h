@@ -22,14 +22,18 @@
 #define ITEM_H
 
 #include <memory>
+#include <QHash>
 #include <QIcon>
 #include <QList>
+#include <QMultiHash>
 #include <QMutex>
+#include <QSet>
 #include <QString>
 
 #include "common/threadedobject.h"
 
 class Item;
+class ProjectSearchIndex;
 using ItemPtr = std::shared_ptr<Item>;
 
 /**
@@ -84,6 +88,18 @@ public:
   int child_count() const;
   Item* child(int i) const;
 
+  /**
+   * @brief Returns this item's index in its parent's children, or -1 if it has no parent
+   *
+   * Kept up to date by add_child() and remove_child() so it's constant time, views ask for this constantly.
+   */
+  int row() const;
+
+  /**
+   * @brief Returns the immediate children of a certain type
+   */
+  QList<Item*> children_of_type(Type type) const;
+
   ItemPtr shared_ptr_from_raw(Item* item);
 
   const QString& name() const;
@@ -102,6 +118,40 @@ public:
 
   bool ChildExistsWithName(const QString& name);
 
+  /**
+   * @brief Number identifying this Item in project files and autosave journals (see ProjectFile)
+   *
+   * Unique within its Project (see Project::TakeFileKey()) and kept across saves, so Nodes can refer to Footage by it.
+   * -1 until the Item is first saved.
+   */
+  int file_key() const;
+  void set_file_key(int key);
+
+  /**
+   * @brief Returns the search index of the Project this Item is in, or nullptr if it isn't in one
+   *
+   * Items keep it up to date themselves as they're added, removed and renamed.
+   */
+  ProjectSearchIndex* search_index() const;
+
+  /**
+   * @brief Set the index that this Item and everything added inside it are kept in
+   *
+   * Only set on a Project's root folder (see Project::search_index()).
+   */
+  void set_search_index(ProjectSearchIndex* index);
+
+  /**
+   * @brief Returns text other than the name that this Item can be searched by (e.g. resolution or codec)
+   */
+  virtual QString SearchMetadata();
+
+protected:
+  /**
+   * @brief Reindex this Item, for subclasses to call when something SearchMetadata() returns changes
+   */
+  void UpdateSearchIndex();
+
 private:
   bool ChildExistsWithNameInternal(const QString& name, Item* folder);
 
@@ -109,12 +159,28 @@ private:
 
   Item* parent_;
 
+  int row_;
+
+  /**
+   * @brief Immediate children by name, for ChildExistsWithName() on folders with many children
+   */
+  QMultiHash<QString, Item*> children_by_name_;
+
+  /**
+   * @brief Immediate children by type, so searches can skip straight to child folders
+   */
+  QHash<int, QSet<Item*> > children_by_type_;
+
   QString name_;
 
   QIcon icon_;
 
   QString tooltip_;
 
+  int file_key_;
+
+  ProjectSearchIndex* search_index_;
+
 };
 
 #endif // ITEM_H
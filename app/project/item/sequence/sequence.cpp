@@ -21,9 +21,14 @@
 #include "sequence.h"
 
 #include "common/channellayout.h"
+#include "config/config.h"
+#include "config/performanceprofile.h"
+#include "project/projectfile.h"
 #include "ui/icons/icons.h"
 
-Sequence::Sequence()
+Sequence::Sequence() :
+  cache_priority_(kDefaultCachePriority),
+  deferred_chunk_(-1)
 {
   set_icon(olive::icon::Sequence);
 }
@@ -41,6 +46,8 @@ const int &Sequence::video_width()
 void Sequence::set_video_width(const int &width)
 {
   video_width_ = width;
+
+  UpdateSearchIndex();
 }
 
 const int &Sequence::video_height() const
@@ -51,6 +58,8 @@ const int &Sequence::video_height() const
 void Sequence::set_video_height(const int &height)
 {
   video_height_ = height;
+
+  UpdateSearchIndex();
 }
 
 const rational &Sequence::video_time_base()
@@ -63,6 +72,11 @@ void Sequence::set_video_time_base(const rational &time_base)
   video_time_base_ = time_base;
 }
 
+QString Sequence::SearchMetadata()
+{
+  return QStringLiteral("%1x%2").arg(QString::number(video_width_), QString::number(video_height_));
+}
+
 const rational &Sequence::audio_time_base()
 {
   return audio_time_base_;
@@ -83,6 +97,16 @@ void Sequence::set_audio_channel_layout(const uint64_t &channel_layout)
   audio_channel_layout_ = channel_layout;
 }
 
+const olive::CachePriority &Sequence::cache_priority() const
+{
+  return cache_priority_;
+}
+
+void Sequence::set_cache_priority(const olive::CachePriority &priority)
+{
+  cache_priority_ = priority;
+}
+
 void Sequence::SetDefaultParameters()
 {
   // FIXME: Make these configurable
@@ -92,4 +116,41 @@ void Sequence::SetDefaultParameters()
 
   set_audio_time_base(rational(1, 48000));
   set_audio_channel_layout(AV_CH_LAYOUT_STEREO);
+
+  set_cache_priority(olive::performance_profile.values().cache_priority);
+}
+
+void Sequence::SetDeferredGraph(std::shared_ptr<ProjectFile> file, int chunk)
+{
+  deferred_file_ = file;
+  deferred_chunk_ = chunk;
+}
+
+bool Sequence::HasDeferredGraph() const
+{
+  return (deferred_file_ != nullptr);
+}
+
+const std::shared_ptr<ProjectFile> &Sequence::deferred_file() const
+{
+  return deferred_file_;
+}
+
+int Sequence::deferred_chunk() const
+{
+  return deferred_chunk_;
+}
+
+bool Sequence::LoadDeferredGraph()
+{
+  if (deferred_file_ == nullptr) {
+    return true;
+  }
+
+  bool loaded = deferred_file_->LoadGraph(deferred_chunk_, this);
+
+  deferred_file_ = nullptr;
+  deferred_chunk_ = -1;
+
+  return loaded;
 }
@@ -21,9 +21,14 @@
 #ifndef SEQUENCE_H
 #define SEQUENCE_H
 
+#include <memory>
+
 #include "common/rational.h"
 #include "node/graph.h"
 #include "project/item/item.h"
+#include "render/cacheformat.h"
+
+class ProjectFile;
 
 /**
  * @brief The main timeline object, an graph of edited clips that forms a complete edit
@@ -49,6 +54,11 @@ public:
   const rational& video_time_base();
   void set_video_time_base(const rational& time_base);
 
+  /**
+   * @brief Item::SearchMetadata() override, the sequence's resolution
+   */
+  virtual QString SearchMetadata() override;
+
   /* AUDIO GETTER/SETTER FUNCTIONS */
 
   const rational& audio_time_base();
@@ -57,8 +67,44 @@ public:
   const uint64_t& audio_channel_layout();
   void set_audio_channel_layout(const uint64_t& channel_layout);
 
+  /* CACHE GETTER/SETTER FUNCTIONS */
+
+  /**
+   * @brief Whether this Sequence's render cache should favor speed or disk space
+   */
+  const olive::CachePriority& cache_priority() const;
+  void set_cache_priority(const olive::CachePriority& priority);
+
   void SetDefaultParameters();
 
+  /**
+   * @brief Set the project file chunk this Sequence's nodes are to be loaded from when they're needed
+   */
+  void SetDeferredGraph(std::shared_ptr<ProjectFile> file, int chunk);
+
+  /**
+   * @brief Returns whether this Sequence's nodes still need to be loaded with LoadDeferredGraph()
+   */
+  bool HasDeferredGraph() const;
+
+  /**
+   * @brief The project file and chunk set with SetDeferredGraph(), if the nodes haven't been loaded yet
+   */
+  const std::shared_ptr<ProjectFile>& deferred_file() const;
+  int deferred_chunk() const;
+
+  /**
+   * @brief Load this Sequence's nodes from its project file if they haven't been already
+   *
+   * Must be called before anything uses nodes() (e.g. when the Sequence is opened), since projects are loaded
+   * without them (see ProjectFile). Once loaded, the Sequence no longer keeps the file open.
+   *
+   * @return
+   *
+   * FALSE if the nodes couldn't be loaded. The Sequence won't try again, so it's left empty.
+   */
+  bool LoadDeferredGraph();
+
 private:
   int video_width_;
   int video_height_;
@@ -66,6 +112,12 @@ private:
 
   rational audio_time_base_;
   uint64_t audio_channel_layout_;
+
+  olive::CachePriority cache_priority_;
+
+  std::shared_ptr<ProjectFile> deferred_file_;
+
+  int deferred_chunk_;
 };
 
 using SequencePtr = std::shared_ptr<Sequence>;
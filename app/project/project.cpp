@@ -20,9 +20,12 @@
 
 #include "project.h"
 
-Project::Project()
+Project::Project() :
+  next_file_key_(0)
 {
   name_ = tr("(untitled)");
+
+  root_.set_search_index(&search_index_);
 }
 
 Folder *Project::root()
@@ -39,3 +42,33 @@ void Project::set_name(const QString &s)
 {
   name_ = s;
 }
+
+const QString &Project::filename()
+{
+  return filename_;
+}
+
+void Project::set_filename(const QString &s)
+{
+  filename_ = s;
+}
+
+int Project::TakeFileKey()
+{
+  return next_file_key_++;
+}
+
+int Project::next_file_key()
+{
+  return next_file_key_;
+}
+
+void Project::set_next_file_key(int key)
+{
+  next_file_key_ = key;
+}
+
+ProjectSearchIndex *Project::search_index()
+{
+  return &search_index_;
+}
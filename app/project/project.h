@@ -25,6 +25,7 @@
 #include <memory>
 
 #include "project/item/folder/folder.h"
+#include "project/projectsearchindex.h"
 
 /**
  * @brief A project instance containing all the data pertaining to the user's project
@@ -48,10 +49,39 @@ public:
   const QString& name();
   void set_name(const QString& s);
 
+  /**
+   * @brief The file this project was last loaded from or saved to, empty if it's never been saved
+   */
+  const QString& filename();
+  void set_filename(const QString& s);
+
+  /**
+   * @brief Return a file key (see Item::file_key() and Node::file_key()) that hasn't been used in this project yet
+   */
+  int TakeFileKey();
+
+  /**
+   * @brief The key TakeFileKey() will return next, stored in project files so keys are never reused
+   */
+  int next_file_key();
+  void set_next_file_key(int key);
+
+  /**
+   * @brief Index of every item in this project, for searching them quickly
+   */
+  ProjectSearchIndex* search_index();
+
 private:
+  /// Declared before root_ so it outlives the items it refers to
+  ProjectSearchIndex search_index_;
+
   Folder root_;
 
   QString name_;
+
+  QString filename_;
+
+  int next_file_key_;
 };
 
 using ProjectPtr = std::shared_ptr<Project>;
@@ -0,0 +1,580 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "projectautosave.h"
+
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUuid>
+
+#include "common/filefunctions.h"
+#include "project/item/sequence/sequence.h"
+#include "project/projectfile.h"
+
+namespace {
+
+const quint32 kJournalMagic = 0x4F4C564A; // "OLVJ"
+const quint32 kEntryMagic = 0x4F4C5645; // "OLVE"
+const quint32 kJournalVersion = 1;
+
+/// Fixed so journals written by one version of Qt are read the same way by another
+const QDataStream::Version kStreamVersion = QDataStream::Qt_5_6;
+
+/// Milliseconds between autosaves
+const int kInterval = 30000;
+
+/// The journal is compacted into a new snapshot once it has this many entries or bytes
+const int kMaxEntries = 200;
+const qint64 kMaxJournalSize = 32 * 1024 * 1024;
+
+/**
+ * @brief Add every Sequence below `item` to `sequences` by its file key
+ */
+void ListSequences(Item* item, QHash<int, Sequence*>* sequences)
+{
+  for (int i=0;i<item->child_count();i++) {
+    Item* child = item->child(i);
+
+    if (child->type() == Item::kSequence) {
+      sequences->insert(child->file_key(), static_cast<Sequence*>(child));
+    }
+
+    ListSequences(child, sequences);
+  }
+}
+
+}
+
+ProjectAutosave::ProjectAutosave(Project *project, QObject *parent) :
+  QObject(parent),
+  project_(project),
+  journal_filename_(QDir(GetAutosaveLocation()).filePath(QUuid::createUuid().toString().mid(1, 36)
+                                                         .append(QStringLiteral(".journal")))),
+  lock_(QStringLiteral("%1.lock").arg(journal_filename_)),
+  worker_(this),
+  quit_(false),
+  snapshot_needed_(1),
+  snapshot_count_(0),
+  entry_count_(0),
+  journal_size_(0)
+{
+  // A lock that's never released (e.g. in a crash) is only considered stale once its process is gone
+  lock_.setStaleLockTime(0);
+
+  if (!lock_.tryLock()) {
+    qWarning() << "Failed to lock" << journal_filename_;
+  }
+
+  worker_.start(QThread::LowPriority);
+
+  connect(&timer_, SIGNAL(timeout()), this, SLOT(Save()));
+  timer_.start(kInterval);
+}
+
+ProjectAutosave::~ProjectAutosave()
+{
+  timer_.stop();
+
+  queue_lock_.lock();
+  quit_ = true;
+  queue_cond_.wakeAll();
+  queue_lock_.unlock();
+
+  worker_.wait();
+
+  DiscardJournal(journal_filename_);
+
+  lock_.unlock();
+}
+
+QStringList ProjectAutosave::FindRecoverable()
+{
+  QDir dir(GetAutosaveLocation());
+
+  QStringList journals;
+
+  foreach (const QString& name, dir.entryList({QStringLiteral("*.journal")}, QDir::Files)) {
+    QString journal = dir.filePath(name);
+
+    QLockFile lock(QStringLiteral("%1.lock").arg(journal));
+    lock.setStaleLockTime(0);
+
+    // Journals that are still being written to are locked by the instance writing them
+    if (lock.tryLock()) {
+      lock.unlock();
+
+      journals.append(journal);
+    }
+  }
+
+  return journals;
+}
+
+QString ProjectAutosave::GetOriginalFilename(const QString &journal)
+{
+  QFile file(journal);
+
+  if (!file.open(QFile::ReadOnly)) {
+    return QString();
+  }
+
+  QDataStream in(&file);
+  in.setVersion(kStreamVersion);
+
+  quint32 magic, version;
+  QString snapshot, original;
+
+  in >> magic >> version >> snapshot >> original;
+
+  return original;
+}
+
+ProjectPtr ProjectAutosave::Recover(const QString &journal, QString *error)
+{
+  QFile file(journal);
+
+  if (!file.open(QFile::ReadOnly)) {
+    *error = tr("Failed to open \"%1\" for reading").arg(journal);
+    return nullptr;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(kStreamVersion);
+
+  quint32 magic, version;
+  QString snapshot, original;
+
+  in >> magic >> version >> snapshot >> original;
+
+  if (in.status() != QDataStream::Ok || magic != kJournalMagic || version != kJournalVersion) {
+    *error = tr("\"%1\" is not a valid autosave").arg(journal);
+    return nullptr;
+  }
+
+  ProjectPtr project = ProjectFile::Load(QFileInfo(journal).dir().filePath(snapshot), error);
+
+  if (project == nullptr) {
+    return nullptr;
+  }
+
+  // The snapshot is deleted along with the journal, so every graph needs to be loaded from it now
+  QHash<int, Sequence*> sequences;
+  ListSequences(project->root(), &sequences);
+
+  foreach (Sequence* sequence, sequences) {
+    sequence->LoadDeferredGraph();
+  }
+
+  while (!in.atEnd()) {
+    quint32 entry_magic;
+    QByteArray entry;
+    quint16 checksum;
+
+    in >> entry_magic >> entry >> checksum;
+
+    // Anything after an incomplete or damaged entry is lost, which is at most what changed in one autosave
+    if (in.status() != QDataStream::Ok
+        || entry_magic != kEntryMagic
+        || checksum != qChecksum(entry.constData(), static_cast<uint>(entry.size()))) {
+      qWarning() << "Ignoring damaged entry in" << journal;
+      break;
+    }
+
+    if (!ApplyEntry(entry, project.get())) {
+      qWarning() << "Failed to apply entry in" << journal;
+      break;
+    }
+  }
+
+  project->set_filename(original);
+
+  if (original.isEmpty()) {
+    project->set_name(QCoreApplication::translate("Project", "(untitled)"));
+  } else {
+    project->set_name(QFileInfo(original).completeBaseName());
+  }
+
+  return project;
+}
+
+void ProjectAutosave::DiscardJournal(const QString &journal)
+{
+  QString snapshot;
+
+  {
+    QFile file(journal);
+
+    if (file.open(QFile::ReadOnly)) {
+      QDataStream in(&file);
+      in.setVersion(kStreamVersion);
+
+      quint32 magic, version;
+
+      in >> magic >> version >> snapshot;
+    }
+  }
+
+  if (!snapshot.isEmpty()) {
+    // Only ever a file name, so nothing outside the autosave directory can be deleted
+    QFile::remove(QFileInfo(journal).dir().filePath(QFileInfo(snapshot).fileName()));
+  }
+
+  QFile::remove(journal);
+}
+
+void ProjectAutosave::Save()
+{
+  if (snapshot_needed_.loadAcquire()
+      || project_->filename() != journaled_filename_
+      || entry_count_ >= kMaxEntries
+      || journal_size_ >= kMaxJournalSize) {
+    QueueSnapshot();
+    return;
+  }
+
+  QVector<Item*> items;
+  QHash<Item*, int> item_keys = ProjectFile::KeyItems(project_, &items);
+
+  TrackSequences(items);
+
+  QByteArray entry;
+
+  {
+    QDataStream out(&entry, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+
+    QList<QPair<int, QByteArray> > graphs;
+
+    foreach (Item* item, items) {
+      if (item->type() != Item::kSequence) {
+        continue;
+      }
+
+      Sequence* sequence = static_cast<Sequence*>(item);
+
+      // Graphs that haven't been loaded can't have changed
+      if (sequence->HasDeferredGraph()) {
+        continue;
+      }
+
+      QList<Node*> modified;
+
+      foreach (Node* node, sequence->nodes()) {
+        if (node->IsModified()) {
+          modified.append(node);
+        }
+      }
+
+      QVector<int32_t> removed = removed_keys_.take(sequence);
+
+      if (modified.isEmpty() && removed.isEmpty()) {
+        continue;
+      }
+
+      graphs.append(qMakePair(item_keys.value(item),
+                              ProjectFile::CreateGraphChunk(sequence, project_, item_keys, modified, removed)));
+
+      foreach (Node* node, modified) {
+        node->SetModified(false);
+      }
+    }
+
+    // Built after the graphs since they may have taken new file keys
+    QByteArray items_chunk = ProjectFile::CreateItemsChunk(project_, items, item_keys, QHash<Sequence*, int>());
+
+    if (graphs.isEmpty() && items_chunk == journaled_items_) {
+      // Nothing has changed
+      return;
+    }
+
+    if (items_chunk == journaled_items_) {
+      out << QByteArray();
+    } else {
+      out << items_chunk;
+
+      journaled_items_ = items_chunk;
+    }
+
+    out << static_cast<qint32>(graphs.size());
+
+    for (int i=0;i<graphs.size();i++) {
+      out << static_cast<qint32>(graphs.at(i).first) << graphs.at(i).second;
+    }
+  }
+
+  entry_count_++;
+  journal_size_ += entry.size();
+
+  WriteTask task;
+  task.entry = entry;
+
+  QueueTask(task);
+}
+
+void ProjectAutosave::QueueSnapshot()
+{
+  snapshot_needed_.storeRelease(0);
+
+  WriteTask task;
+
+  snapshot_count_++;
+  task.snapshot_filename = QStringLiteral("%1.%2.ove").arg(QFileInfo(journal_filename_).completeBaseName(),
+                                                           QString::number(snapshot_count_));
+  task.original_filename = project_->filename();
+
+  ProjectFile::CreateChunks(project_, &task.chunks, nullptr);
+
+  // Everything is in the snapshot, so the next entry starts from here
+  QVector<Item*> items;
+  QHash<Item*, int> item_keys = ProjectFile::KeyItems(project_, &items);
+
+  TrackSequences(items);
+
+  foreach (Item* item, items) {
+    if (item->type() == Item::kSequence) {
+      foreach (Node* node, static_cast<Sequence*>(item)->nodes()) {
+        node->SetModified(false);
+      }
+    }
+  }
+
+  removed_keys_.clear();
+
+  journaled_items_ = ProjectFile::CreateItemsChunk(project_, items, item_keys, QHash<Sequence*, int>());
+  journaled_filename_ = project_->filename();
+  entry_count_ = 0;
+  journal_size_ = 0;
+
+  QueueTask(task);
+}
+
+void ProjectAutosave::QueueTask(const ProjectAutosave::WriteTask &task)
+{
+  QMutexLocker locker(&queue_lock_);
+
+  queue_.append(task);
+
+  queue_cond_.wakeAll();
+}
+
+void ProjectAutosave::TrackSequences(const QVector<Item *> &items)
+{
+  foreach (Item* item, items) {
+    if (item->type() != Item::kSequence) {
+      continue;
+    }
+
+    NodeGraph* graph = static_cast<Sequence*>(item);
+
+    if (tracked_.contains(graph)) {
+      continue;
+    }
+
+    connect(graph, SIGNAL(NodeAdded(Node*)), this, SLOT(SequenceNodeAdded(Node*)));
+    connect(graph, SIGNAL(NodeRemoved(Node*)), this, SLOT(SequenceNodeRemoved(Node*)));
+    connect(graph, SIGNAL(destroyed(QObject*)), this, SLOT(SequenceDestroyed(QObject*)));
+
+    tracked_.insert(graph);
+  }
+}
+
+bool ProjectAutosave::ApplyEntry(const QByteArray &entry, Project *project)
+{
+  QDataStream in(entry);
+  in.setVersion(kStreamVersion);
+
+  QByteArray items_chunk;
+  qint32 graph_count;
+
+  in >> items_chunk >> graph_count;
+
+  if (!items_chunk.isEmpty() && !ProjectFile::ApplyItemsChunk(items_chunk, project, nullptr)) {
+    return false;
+  }
+
+  QHash<int, Sequence*> sequences;
+  ListSequences(project->root(), &sequences);
+
+  for (qint32 i=0;i<graph_count && in.status() == QDataStream::Ok;i++) {
+    qint32 key;
+    QByteArray graph;
+
+    in >> key >> graph;
+
+    Sequence* sequence = sequences.value(key, nullptr);
+
+    if (sequence == nullptr) {
+      continue;
+    }
+
+    if (!ProjectFile::ApplyGraphChunk(graph.constData(), graph.size(), sequence)) {
+      return false;
+    }
+  }
+
+  return (in.status() == QDataStream::Ok);
+}
+
+void ProjectAutosave::WriteLoop()
+{
+  // Set when a write fails, entries are skipped until a snapshot replaces the journal they'd be missing changes from
+  bool broken = false;
+
+  queue_lock_.lock();
+
+  while (!quit_) {
+    if (queue_.isEmpty()) {
+      queue_cond_.wait(&queue_lock_);
+      continue;
+    }
+
+    WriteTask task = queue_.takeFirst();
+
+    queue_lock_.unlock();
+
+    if (!task.snapshot_filename.isEmpty()) {
+      broken = !WriteSnapshot(task);
+    } else if (!broken) {
+      broken = !WriteEntry(task.entry);
+    }
+
+    if (broken) {
+      snapshot_needed_.storeRelease(1);
+    }
+
+    queue_lock_.lock();
+  }
+
+  queue_lock_.unlock();
+}
+
+bool ProjectAutosave::WriteSnapshot(const WriteTask &task)
+{
+  QDir dir = QFileInfo(journal_filename_).dir();
+
+  QString snapshot = dir.filePath(task.snapshot_filename);
+  QString partial_snapshot = QStringLiteral("%1.partial").arg(snapshot);
+
+  if (!ProjectFile::WriteChunks(partial_snapshot, task.chunks) || !QFile::rename(partial_snapshot, snapshot)) {
+    QFile::remove(partial_snapshot);
+    qWarning() << "Failed to write autosave" << snapshot;
+    return false;
+  }
+
+  // Replace the journal with a new one that starts from this snapshot
+  QString partial_journal = QStringLiteral("%1.partial").arg(journal_filename_);
+
+  bool ok;
+
+  {
+    QFile file(partial_journal);
+
+    ok = file.open(QFile::WriteOnly);
+
+    if (ok) {
+      QDataStream out(&file);
+      out.setVersion(kStreamVersion);
+
+      out << kJournalMagic << kJournalVersion << task.snapshot_filename << task.original_filename;
+
+      ok = (out.status() == QDataStream::Ok && file.flush());
+    }
+  }
+
+  if (ok) {
+    ok = ReplaceFile(partial_journal, journal_filename_);
+  }
+
+  if (!ok) {
+    QFile::remove(partial_journal);
+    QFile::remove(snapshot);
+    qWarning() << "Failed to write autosave" << journal_filename_;
+    return false;
+  }
+
+  if (!snapshot_filename_.isEmpty()) {
+    QFile::remove(dir.filePath(snapshot_filename_));
+  }
+
+  snapshot_filename_ = task.snapshot_filename;
+
+  return true;
+}
+
+bool ProjectAutosave::WriteEntry(const QByteArray &entry)
+{
+  QFile file(journal_filename_);
+
+  if (!file.open(QFile::WriteOnly | QFile::Append)) {
+    qWarning() << "Failed to open" << journal_filename_ << "for writing";
+    return false;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(kStreamVersion);
+
+  out << kEntryMagic << entry << qChecksum(entry.constData(), static_cast<uint>(entry.size()));
+
+  if (out.status() != QDataStream::Ok || !file.flush()) {
+    qWarning() << "Failed to write to" << journal_filename_;
+    return false;
+  }
+
+  return true;
+}
+
+void ProjectAutosave::SequenceNodeAdded(Node *node)
+{
+  // Nodes added back (e.g. by undoing their removal) need to be journaled again in full
+  node->SetModified(true);
+
+  if (node->file_key() >= 0) {
+    removed_keys_[static_cast<NodeGraph*>(sender())].removeAll(node->file_key());
+  }
+}
+
+void ProjectAutosave::SequenceNodeRemoved(Node *node)
+{
+  if (node->file_key() >= 0) {
+    removed_keys_[static_cast<NodeGraph*>(sender())].append(node->file_key());
+  }
+}
+
+void ProjectAutosave::SequenceDestroyed(QObject *object)
+{
+  NodeGraph* graph = static_cast<NodeGraph*>(object);
+
+  tracked_.remove(graph);
+  removed_keys_.remove(graph);
+}
+
+ProjectAutosave::Worker::Worker(ProjectAutosave *parent) :
+  parent_(parent)
+{
+}
+
+void ProjectAutosave::Worker::run()
+{
+  parent_->WriteLoop();
+}
@@ -0,0 +1,231 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROJECTAUTOSAVE_H
+#define PROJECTAUTOSAVE_H
+
+#include <QHash>
+#include <QList>
+#include <QLockFile>
+#include <QMutex>
+#include <QSet>
+#include <QThread>
+#include <QTimer>
+#include <QVector>
+#include <QWaitCondition>
+#include <stdint.h>
+
+#include "project/project.h"
+
+class Node;
+class NodeGraph;
+
+/**
+ * @brief Autosaves a project in the background by journaling the changes made to it
+ *
+ * Saving the whole project every time takes longer the larger it gets. Instead, ProjectAutosave starts from a
+ * snapshot of the project and then regularly appends an entry to a journal with only what changed since the last
+ * one: the Items chunk if any Item changed, and for each Sequence a graph chunk (see ProjectFile) of the nodes marked
+ * as modified (see Node::IsModified()) along with the keys of the nodes that were removed. Entries are built on the
+ * main thread, which is quick since they're as small as the changes, and written by a thread of their own.
+ *
+ * Once the journal gets long it's compacted, i.e. replaced by a new snapshot, so recovering never has to replay too
+ * much of it.
+ *
+ * Journals are kept in GetAutosaveLocation() while their project is open and deleted when it's closed normally, so
+ * any found on startup that no running instance of Olive has locked (see FindRecoverable()) were left by a crash.
+ */
+class ProjectAutosave : public QObject
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief Start autosaving a project, which must outlive this object
+   */
+  ProjectAutosave(Project* project, QObject* parent = nullptr);
+
+  /**
+   * @brief Stop autosaving and delete the journal, since the project was closed normally
+   */
+  virtual ~ProjectAutosave() override;
+
+  /**
+   * @brief Return every journal in GetAutosaveLocation() that isn't in use, i.e. projects that can be recovered
+   */
+  static QStringList FindRecoverable();
+
+  /**
+   * @brief Return the filename of the project a journal was autosaving, empty if it had never been saved
+   */
+  static QString GetOriginalFilename(const QString& journal);
+
+  /**
+   * @brief Load a journal's snapshot and replay its entries on it
+   *
+   * Entries after one that's incomplete or damaged (e.g. because it was being written in the crash) are ignored.
+   * The project returned has the filename of the original but hasn't been saved.
+   *
+   * @return
+   *
+   * The recovered project, or nullptr if it couldn't be loaded (with the reason in `error`).
+   */
+  static ProjectPtr Recover(const QString& journal, QString* error);
+
+  /**
+   * @brief Delete a journal and its snapshot
+   */
+  static void DiscardJournal(const QString& journal);
+
+public slots:
+  /**
+   * @brief Journal any changes made since the last autosave
+   *
+   * Called regularly by a timer.
+   */
+  void Save();
+
+private:
+  /**
+   * @brief Thread that runs WriteLoop()
+   */
+  class Worker : public QThread
+  {
+  public:
+    Worker(ProjectAutosave* parent);
+
+  protected:
+    virtual void run() override;
+
+  private:
+    ProjectAutosave* parent_;
+  };
+
+  /**
+   * @brief Something for the worker to write, either a snapshot (which starts a new journal) or an entry
+   */
+  struct WriteTask {
+    /// Set for snapshots
+    QString snapshot_filename;
+    QList<QByteArray> chunks;
+    QString original_filename;
+
+    /// Set for entries
+    QByteArray entry;
+  };
+
+  /**
+   * @brief Main loop of the worker thread
+   */
+  void WriteLoop();
+
+  /**
+   * @brief Write a snapshot from the worker thread and start a new journal from it
+   */
+  bool WriteSnapshot(const WriteTask& task);
+
+  /**
+   * @brief Append an entry to the journal from the worker thread
+   */
+  bool WriteEntry(const QByteArray& entry);
+
+  /**
+   * @brief Queue a snapshot of the whole project, after which the journal starts again
+   */
+  void QueueSnapshot();
+
+  void QueueTask(const WriteTask& task);
+
+  /**
+   * @brief Connect to any Sequences whose removed nodes aren't being tracked yet
+   */
+  void TrackSequences(const QVector<Item*>& items);
+
+  /**
+   * @brief Apply an entry written by Save() to a project
+   */
+  static bool ApplyEntry(const QByteArray& entry, Project* project);
+
+  Project* project_;
+
+  QString journal_filename_;
+
+  /**
+   * @brief Held for as long as the journal is being written so it isn't offered for recovery
+   */
+  QLockFile lock_;
+
+  QTimer timer_;
+
+  Worker worker_;
+
+  QMutex queue_lock_;
+
+  QWaitCondition queue_cond_;
+
+  QList<WriteTask> queue_;
+
+  bool quit_;
+
+  /**
+   * @brief Set by the worker when a write fails, so the next Save() starts over with a snapshot
+   */
+  QAtomicInt snapshot_needed_;
+
+  /**
+   * @brief Number of snapshots written, used to name each one differently from the last
+   */
+  int snapshot_count_;
+
+  /**
+   * @brief Project filename stored in the journal, a new snapshot is written if it changes
+   */
+  QString journaled_filename_;
+
+  /**
+   * @brief The Items chunk as of the last entry, to tell whether any Item has changed
+   */
+  QByteArray journaled_items_;
+
+  int entry_count_;
+
+  qint64 journal_size_;
+
+  /**
+   * @brief Keys of the nodes removed from each Sequence since the last entry
+   */
+  QHash<NodeGraph*, QVector<int32_t> > removed_keys_;
+
+  QSet<NodeGraph*> tracked_;
+
+  /**
+   * @brief The last snapshot written, only used by the worker thread
+   */
+  QString snapshot_filename_;
+
+private slots:
+  void SequenceNodeAdded(Node* node);
+
+  void SequenceNodeRemoved(Node* node);
+
+  void SequenceDestroyed(QObject* object);
+
+};
+
+#endif // PROJECTAUTOSAVE_H
@@ -0,0 +1,1280 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "projectfile.h"
+
+#include <climits>
+#include <cstring>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QFileInfo>
+#include <QXmlStreamWriter>
+
+#include "common/filefunctions.h"
+#include "decoder/probecache.h"
+#include "node/block/block.h"
+#include "node/invalidationbatch.h"
+#include "node/output/timeline/timeline.h"
+#include "node/output/viewer/viewer.h"
+#include "node/processor/renderer/renderer.h"
+#include "node/processor/renderer/renderercachecodec.h"
+#include "project/item/footage/footage.h"
+#include "project/item/sequence/sequence.h"
+
+namespace {
+
+const char kMagic[4] = {'O', 'L', 'V', 'P'};
+const char kItemsChunk[4] = {'I', 'T', 'E', 'M'};
+const char kGraphChunk[4] = {'G', 'R', 'P', 'H'};
+
+/// Arrays in graph chunks (and chunks themselves) start on multiples of this so records can be read in place
+const int kAlignment = 8;
+
+/// Fixed so values written by one version of Qt are read the same way by another
+const QDataStream::Version kStreamVersion = QDataStream::Qt_5_6;
+
+/**
+ * @brief Add every Item below `item` to `list`, parents before their children
+ */
+void ListItems(Item* item, QVector<Item*>* list)
+{
+  for (int i=0;i<item->child_count();i++) {
+    list->append(item->child(i));
+
+    ListItems(item->child(i), list);
+  }
+}
+
+/**
+ * @brief Add every Item below `item` that has a file key to `items` by its key
+ */
+void ListItemsByKey(Item* item, QHash<int, ItemPtr>* items)
+{
+  for (int i=0;i<item->child_count();i++) {
+    Item* child = item->child(i);
+
+    if (child->file_key() >= 0) {
+      items->insert(child->file_key(), item->shared_ptr_from_raw(child));
+    }
+
+    ListItemsByKey(child, items);
+  }
+}
+
+/**
+ * @brief Pad `data` to the next multiple of kAlignment
+ */
+void Align(QByteArray* data)
+{
+  while (data->size() % kAlignment != 0) {
+    data->append('\0');
+  }
+}
+
+/**
+ * @brief Append raw data at an aligned position and return its offset
+ */
+int64_t AppendAligned(QByteArray* data, const char* src, int size)
+{
+  Align(data);
+
+  int64_t offset = data->size();
+
+  data->append(src, size);
+
+  return offset;
+}
+
+template<typename T>
+int64_t AppendRecords(QByteArray* data, const QVector<T>& records)
+{
+  return AppendAligned(data,
+                       reinterpret_cast<const char*>(records.constData()),
+                       records.size() * static_cast<int>(sizeof(T)));
+}
+
+}
+
+ProjectFile::ProjectFile() :
+  map_(nullptr),
+  header_(nullptr),
+  chunks_(nullptr)
+{
+}
+
+ProjectFile::~ProjectFile()
+{
+  Close();
+}
+
+ProjectPtr ProjectFile::Load(const QString &filename, QString *error)
+{
+  ProjectFilePtr file(new ProjectFile());
+
+  if (!file->Map(filename, error)) {
+    return nullptr;
+  }
+
+  const Chunk& chunk = file->chunks_[0];
+
+  ProjectPtr project = std::make_shared<Project>();
+
+  if (memcmp(chunk.type, kItemsChunk, sizeof(kItemsChunk)) != 0
+      || chunk.size > INT_MAX
+      || !ApplyItemsChunk(QByteArray::fromRawData(reinterpret_cast<const char*>(file->map_ + chunk.offset),
+                                                  static_cast<int>(chunk.size)),
+                          project.get(),
+                          file)) {
+    *error = QCoreApplication::translate("ProjectFile", "\"%1\" is damaged").arg(filename);
+    return nullptr;
+  }
+
+  project->set_filename(filename);
+  project->set_name(QFileInfo(filename).completeBaseName());
+
+  return project;
+}
+
+bool ProjectFile::Save(Project *project, const QString &filename, QString *error)
+{
+  QList<QByteArray> chunks;
+  QList<QPair<Sequence*, int> > deferred;
+
+  CreateChunks(project, &chunks, &deferred);
+
+  // Write to a temporary file first so that a failed save doesn't destroy the existing project
+  QString partial_filename = filename;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  if (!WriteChunks(partial_filename, chunks)) {
+    QFile::remove(partial_filename);
+    *error = QCoreApplication::translate("ProjectFile", "Failed to write \"%1\"").arg(filename);
+    return false;
+  }
+
+  // Sequences that haven't been loaded yet still read from the file they were loaded from. If that's the file being
+  // replaced, it needs to be closed first (some platforms can't replace open files) and is then reopened as the new
+  // file, which their graphs were copied to.
+  QFileInfo info(filename);
+  QList<ProjectFile*> replaced;
+
+  for (int i=0;i<deferred.size();i++) {
+    ProjectFile* file = deferred.at(i).first->deferred_file().get();
+
+    if (!replaced.contains(file) && QFileInfo(file->file_.fileName()) == info) {
+      file->Close();
+      replaced.append(file);
+    }
+  }
+
+  bool renamed = ReplaceFile(partial_filename, filename);
+
+  foreach (ProjectFile* file, replaced) {
+    QString map_error;
+
+    if (!file->Map(filename, &map_error)) {
+      qWarning().noquote() << map_error;
+    }
+  }
+
+  if (!renamed) {
+    QFile::remove(partial_filename);
+    *error = QCoreApplication::translate("ProjectFile", "Failed to write \"%1\"").arg(filename);
+    return false;
+  }
+
+  for (int i=0;i<deferred.size();i++) {
+    Sequence* sequence = deferred.at(i).first;
+
+    if (replaced.contains(sequence->deferred_file().get())) {
+      sequence->SetDeferredGraph(sequence->deferred_file(), deferred.at(i).second);
+    }
+  }
+
+  return true;
+}
+
+bool ProjectFile::ExportXml(Project *project, const QString &filename, QString *error)
+{
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly)) {
+    *error = QCoreApplication::translate("ProjectFile", "Failed to open \"%1\" for writing").arg(filename);
+    return false;
+  }
+
+  QVector<Item*> items;
+  ListItems(project->root(), &items);
+
+  QHash<Item*, int> item_indices;
+
+  for (int i=0;i<items.size();i++) {
+    item_indices.insert(items.at(i), i);
+  }
+
+  QXmlStreamWriter writer(&file);
+  writer.setAutoFormatting(true);
+
+  writer.writeStartDocument();
+
+  writer.writeStartElement(QStringLiteral("project"));
+  writer.writeAttribute(QStringLiteral("version"), QString::number(kVersion));
+  writer.writeAttribute(QStringLiteral("name"), project->name());
+
+  for (int i=0;i<items.size();i++) {
+    Item* item = items.at(i);
+
+    switch (item->type()) {
+    case Item::kFolder:
+      writer.writeStartElement(QStringLiteral("folder"));
+      break;
+    case Item::kFootage:
+      writer.writeStartElement(QStringLiteral("footage"));
+      break;
+    case Item::kSequence:
+      writer.writeStartElement(QStringLiteral("sequence"));
+      break;
+    }
+
+    writer.writeAttribute(QStringLiteral("index"), QString::number(i));
+    writer.writeAttribute(QStringLiteral("parent"), QString::number(item_indices.value(item->parent(), -1)));
+    writer.writeAttribute(QStringLiteral("name"), item->name());
+
+    if (item->type() == Item::kFootage) {
+      Footage* footage = static_cast<Footage*>(item);
+
+      writer.writeAttribute(QStringLiteral("filename"), footage->filename());
+      writer.writeAttribute(QStringLiteral("decoder"), footage->decoder());
+    } else if (item->type() == Item::kSequence) {
+      Sequence* sequence = static_cast<Sequence*>(item);
+
+      if (!sequence->LoadDeferredGraph()) {
+        *error = QCoreApplication::translate("ProjectFile", "Failed to load sequence \"%1\"").arg(sequence->name());
+        return false;
+      }
+
+      writer.writeAttribute(QStringLiteral("width"), QString::number(sequence->video_width()));
+      writer.writeAttribute(QStringLiteral("height"), QString::number(sequence->video_height()));
+      writer.writeAttribute(QStringLiteral("timebase"), QStringLiteral("%1/%2").arg(
+                              QString::number(sequence->video_time_base().numerator()),
+                              QString::number(sequence->video_time_base().denominator())));
+
+      QList<Node*> nodes = sequence->nodes();
+
+      QHash<Node*, int> node_indices;
+
+      for (int j=0;j<nodes.size();j++) {
+        node_indices.insert(nodes.at(j), j);
+      }
+
+      for (int j=0;j<nodes.size();j++) {
+        Node* node = nodes.at(j);
+
+        writer.writeStartElement(QStringLiteral("node"));
+        writer.writeAttribute(QStringLiteral("index"), QString::number(j));
+        writer.writeAttribute(QStringLiteral("id"), node->id());
+
+        Block* block = dynamic_cast<Block*>(node);
+
+        if (block != nullptr) {
+          writer.writeAttribute(QStringLiteral("length"), QStringLiteral("%1/%2").arg(
+                                  QString::number(block->length().numerator()),
+                                  QString::number(block->length().denominator())));
+          writer.writeAttribute(QStringLiteral("mediain"), QStringLiteral("%1/%2").arg(
+                                  QString::number(block->media_in().numerator()),
+                                  QString::number(block->media_in().denominator())));
+        }
+
+        foreach (NodeParam* param, node->parameters()) {
+          if (param->type() != NodeParam::kInput) {
+            continue;
+          }
+
+          NodeInput* input = static_cast<NodeInput*>(param);
+
+          writer.writeStartElement(QStringLiteral("input"));
+          writer.writeAttribute(QStringLiteral("id"), input->id());
+          writer.writeAttribute(QStringLiteral("keyframing"), QString::number(input->keyframing() ? 1 : 0));
+
+          foreach (const NodeKeyframe& key, input->keyframes()) {
+            writer.writeStartElement(QStringLiteral("keyframe"));
+            writer.writeAttribute(QStringLiteral("time"), QStringLiteral("%1/%2").arg(
+                                    QString::number(key.time().numerator()),
+                                    QString::number(key.time().denominator())));
+            writer.writeAttribute(QStringLiteral("type"), QString::number(key.type()));
+
+            if (input->inputs().contains(NodeParam::kFootage)) {
+              writer.writeCharacters(QString::number(item_indices.value(Node::ValueToPtr<Footage>(key.value()), -1)));
+            } else if (key.value().userType() == qMetaTypeId<rational>()) {
+              rational r = key.value().value<rational>();
+              writer.writeCharacters(QStringLiteral("%1/%2").arg(QString::number(r.numerator()),
+                                                                 QString::number(r.denominator())));
+            } else {
+              writer.writeCharacters(key.value().toString());
+            }
+
+            writer.writeEndElement(); // keyframe
+          }
+
+          foreach (NodeEdgePtr edge, input->edges()) {
+            writer.writeStartElement(QStringLiteral("edge"));
+            writer.writeAttribute(QStringLiteral("node"), QString::number(node_indices.value(edge->output()->parent(),
+                                                                                             -1)));
+            writer.writeAttribute(QStringLiteral("output"), edge->output()->id());
+            writer.writeEndElement(); // edge
+          }
+
+          writer.writeEndElement(); // input
+        }
+
+        writer.writeEndElement(); // node
+      }
+    }
+
+    writer.writeEndElement(); // folder/footage/sequence
+  }
+
+  writer.writeEndElement(); // project
+
+  writer.writeEndDocument();
+
+  if (writer.hasError()) {
+    *error = QCoreApplication::translate("ProjectFile", "Failed to write \"%1\"").arg(filename);
+    return false;
+  }
+
+  return true;
+}
+
+bool ProjectFile::LoadGraph(int chunk_index, Sequence *sequence)
+{
+  if (header_ == nullptr || chunk_index < 0 || chunk_index >= header_->chunk_count) {
+    return false;
+  }
+
+  const Chunk& chunk = chunks_[chunk_index];
+
+  if (memcmp(chunk.type, kGraphChunk, sizeof(kGraphChunk)) != 0) {
+    return false;
+  }
+
+  return ApplyGraphChunk(reinterpret_cast<const char*>(map_ + chunk.offset), chunk.size, sequence);
+}
+
+bool ProjectFile::Map(const QString &filename, QString *error)
+{
+  file_.setFileName(filename);
+
+  if (!file_.open(QFile::ReadOnly)) {
+    *error = QCoreApplication::translate("ProjectFile", "Failed to open \"%1\" for reading").arg(filename);
+    return false;
+  }
+
+  qint64 file_size = file_.size();
+
+  if (file_size >= static_cast<qint64>(sizeof(Header))) {
+    map_ = file_.map(0, file_size);
+  }
+
+  if (map_ == nullptr) {
+    Close();
+    *error = QCoreApplication::translate("ProjectFile", "\"%1\" is not a valid project file").arg(filename);
+    return false;
+  }
+
+  const Header* header = reinterpret_cast<const Header*>(map_);
+
+  if (memcmp(header->magic, kMagic, sizeof(kMagic)) != 0) {
+    Close();
+    *error = QCoreApplication::translate("ProjectFile", "\"%1\" is not a valid project file").arg(filename);
+    return false;
+  }
+
+  if (header->version != kVersion) {
+    Close();
+    *error = QCoreApplication::translate("ProjectFile",
+                                         "\"%1\" was saved by a different version of Olive").arg(filename);
+    return false;
+  }
+
+  qint64 table_end = static_cast<qint64>(sizeof(Header))
+      + static_cast<qint64>(sizeof(Chunk)) * header->chunk_count;
+
+  if (header->chunk_count < 1 || file_size < table_end) {
+    Close();
+    *error = QCoreApplication::translate("ProjectFile", "\"%1\" is damaged").arg(filename);
+    return false;
+  }
+
+  const Chunk* chunks = reinterpret_cast<const Chunk*>(map_ + sizeof(Header));
+
+  // Make sure every chunk is actually in the file
+  for (int i=0;i<header->chunk_count;i++) {
+    const Chunk& chunk = chunks[i];
+
+    if (chunk.offset < table_end
+        || chunk.offset % kAlignment != 0
+        || chunk.size < 0
+        || chunk.offset + chunk.size > file_size) {
+      Close();
+      *error = QCoreApplication::translate("ProjectFile", "\"%1\" is damaged").arg(filename);
+      return false;
+    }
+  }
+
+  header_ = header;
+  chunks_ = chunks;
+
+  return true;
+}
+
+void ProjectFile::Close()
+{
+  if (map_ != nullptr) {
+    file_.unmap(map_);
+    map_ = nullptr;
+  }
+
+  file_.close();
+
+  header_ = nullptr;
+  chunks_ = nullptr;
+}
+
+QByteArray ProjectFile::GraphChunkData(int chunk_index) const
+{
+  if (header_ == nullptr || chunk_index < 0 || chunk_index >= header_->chunk_count) {
+    return QByteArray();
+  }
+
+  const Chunk& chunk = chunks_[chunk_index];
+
+  if (memcmp(chunk.type, kGraphChunk, sizeof(kGraphChunk)) != 0 || chunk.size > INT_MAX) {
+    return QByteArray();
+  }
+
+  return QByteArray(reinterpret_cast<const char*>(map_ + chunk.offset), static_cast<int>(chunk.size));
+}
+
+void ProjectFile::CreateChunks(Project *project, QList<QByteArray> *chunks, QList<QPair<Sequence *, int> > *deferred)
+{
+  QVector<Item*> items;
+  QHash<Item*, int> item_keys = KeyItems(project, &items);
+
+  QList<QByteArray> graphs;
+  QHash<Sequence*, int> graph_chunks;
+
+  foreach (Item* item, items) {
+    if (item->type() != Item::kSequence) {
+      continue;
+    }
+
+    Sequence* sequence = static_cast<Sequence*>(item);
+
+    QByteArray graph;
+
+    if (sequence->HasDeferredGraph()) {
+      // A graph that hasn't been loaded can't have changed, so it's copied as it is rather than loaded just to be
+      // written out again
+      graph = sequence->deferred_file()->GraphChunkData(sequence->deferred_chunk());
+
+      if (graph.isEmpty()) {
+        sequence->LoadDeferredGraph();
+      } else if (deferred != nullptr) {
+        deferred->append(qMakePair(sequence, graphs.size() + 1));
+      }
+    }
+
+    if (graph.isEmpty()) {
+      graph = CreateGraphChunk(sequence, project, item_keys, sequence->nodes(), QVector<int32_t>());
+    }
+
+    graphs.append(graph);
+
+    // The items chunk goes first, so this is the graph's index
+    graph_chunks.insert(sequence, graphs.size());
+  }
+
+  // Written last since it stores the next file key, which writing graphs may have taken keys from
+  chunks->append(CreateItemsChunk(project, items, item_keys, graph_chunks));
+  chunks->append(graphs);
+}
+
+bool ProjectFile::WriteChunks(const QString &filename, const QList<QByteArray> &chunk_data)
+{
+  // Build the chunk table, every chunk starts on an aligned offset after it
+  QVector<Chunk> chunks(chunk_data.size());
+
+  int64_t offset = static_cast<int64_t>(sizeof(Header)) + static_cast<int64_t>(sizeof(Chunk)) * chunks.size();
+
+  for (int i=0;i<chunks.size();i++) {
+    Chunk& chunk = chunks[i];
+
+    memcpy(chunk.type, (i == 0) ? kItemsChunk : kGraphChunk, sizeof(chunk.type));
+    chunk.reserved = 0;
+
+    offset += (kAlignment - offset % kAlignment) % kAlignment;
+
+    chunk.offset = offset;
+    chunk.size = chunk_data.at(i).size();
+
+    offset += chunk.size;
+  }
+
+  Header header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.chunk_count = chunks.size();
+  header.reserved = 0;
+
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly)) {
+    return false;
+  }
+
+  bool ok = (file.write(reinterpret_cast<const char*>(&header), sizeof(Header))
+             == static_cast<qint64>(sizeof(Header)))
+      && (file.write(reinterpret_cast<const char*>(chunks.constData()),
+                     static_cast<qint64>(sizeof(Chunk)) * chunks.size())
+          == static_cast<qint64>(sizeof(Chunk)) * chunks.size());
+
+  for (int i=0;i<chunks.size() && ok;i++) {
+    // Pad up to the chunk's offset
+    QByteArray padding(static_cast<int>(chunks.at(i).offset - file.pos()), '\0');
+
+    ok = (file.write(padding) == padding.size())
+        && (file.write(chunk_data.at(i)) == chunk_data.at(i).size());
+  }
+
+  file.close();
+
+  return ok;
+}
+
+QHash<Item *, int> ProjectFile::KeyItems(Project *project, QVector<Item *> *items)
+{
+  ListItems(project->root(), items);
+
+  QHash<Item*, int> item_keys;
+  item_keys.reserve(items->size());
+
+  foreach (Item* item, *items) {
+    if (item->file_key() < 0) {
+      item->set_file_key(project->TakeFileKey());
+    }
+
+    item_keys.insert(item, item->file_key());
+  }
+
+  return item_keys;
+}
+
+QByteArray ProjectFile::CreateItemsChunk(Project *project,
+                                         const QVector<Item *> &items,
+                                         const QHash<Item *, int> &item_keys,
+                                         const QHash<Sequence *, int> &graph_chunks)
+{
+  QByteArray data;
+
+  {
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(kStreamVersion);
+
+    out << static_cast<qint32>(project->next_file_key())
+        << static_cast<qint32>(items.size());
+
+    foreach (Item* item, items) {
+      out << static_cast<qint32>(item_keys.value(item))
+          << static_cast<qint32>(item->type())
+          << static_cast<qint32>(item_keys.value(item->parent(), -1))
+          << item->name();
+
+      switch (item->type()) {
+      case Item::kFolder:
+        break;
+      case Item::kFootage:
+      {
+        Footage* footage = static_cast<Footage*>(item);
+
+        out << footage->filename()
+            << footage->timestamp()
+            << footage->decoder()
+            << static_cast<qint32>(footage->status());
+
+        ProbeCache::WriteStreams(out, footage);
+        break;
+      }
+      case Item::kSequence:
+      {
+        Sequence* sequence = static_cast<Sequence*>(item);
+
+        out << static_cast<qint32>(sequence->video_width())
+            << static_cast<qint32>(sequence->video_height())
+            << static_cast<qint64>(sequence->video_time_base().numerator())
+            << static_cast<qint64>(sequence->video_time_base().denominator())
+            << static_cast<qint64>(sequence->audio_time_base().numerator())
+            << static_cast<qint64>(sequence->audio_time_base().denominator())
+            << static_cast<quint64>(sequence->audio_channel_layout())
+            << static_cast<qint32>(sequence->cache_priority())
+            << static_cast<qint32>(graph_chunks.value(sequence, -1));
+        break;
+      }
+      }
+    }
+  }
+
+  return data;
+}
+
+bool ProjectFile::ApplyItemsChunk(const QByteArray &data, Project *project, const ProjectFilePtr &file)
+{
+  QDataStream in(data);
+  in.setVersion(kStreamVersion);
+
+  qint32 next_key, item_count;
+  in >> next_key >> item_count;
+
+  // Items already in the project, any left in here once the chunk has been read aren't in it and are removed
+  QHash<int, ItemPtr> existing;
+  ListItemsByKey(project->root(), &existing);
+
+  QHash<int, ItemPtr> placed;
+
+  for (qint32 i=0;i<item_count && in.status() == QDataStream::Ok;i++) {
+    qint32 key, type, parent;
+    QString name;
+
+    in >> key >> type >> parent >> name;
+
+    ItemPtr item = existing.take(key);
+
+    if (item != nullptr && static_cast<qint32>(item->type()) != type) {
+      return false;
+    }
+
+    switch (static_cast<Item::Type>(type)) {
+    case Item::kFolder:
+      if (item == nullptr) {
+        item = std::make_shared<Folder>();
+      }
+      break;
+    case Item::kFootage:
+    {
+      QString filename, decoder;
+      QDateTime timestamp;
+      qint32 status;
+      QList<StreamPtr> streams;
+
+      in >> filename >> timestamp >> decoder >> status;
+
+      if (!ProbeCache::ReadStreams(in, &streams)) {
+        break;
+      }
+
+      std::shared_ptr<Footage> footage;
+
+      if (item == nullptr) {
+        footage = std::make_shared<Footage>();
+
+        // Streams don't change once Footage has been probed, so they're only added to new Footage
+        foreach (StreamPtr s, streams) {
+          footage->add_stream(s);
+        }
+      } else {
+        footage = std::static_pointer_cast<Footage>(item);
+      }
+
+      footage->set_filename(filename);
+      footage->set_timestamp(timestamp);
+      footage->set_decoder(decoder);
+      footage->set_status(static_cast<Footage::Status>(status));
+
+      item = footage;
+      break;
+    }
+    case Item::kSequence:
+    {
+      qint32 width, height, cache_priority, graph_chunk;
+      qint64 video_timebase_num, video_timebase_den, audio_timebase_num, audio_timebase_den;
+      quint64 channel_layout;
+
+      in >> width >> height
+         >> video_timebase_num >> video_timebase_den
+         >> audio_timebase_num >> audio_timebase_den
+         >> channel_layout >> cache_priority >> graph_chunk;
+
+      bool created = (item == nullptr);
+
+      SequencePtr sequence = created ? std::make_shared<Sequence>() : std::static_pointer_cast<Sequence>(item);
+
+      sequence->set_video_width(width);
+      sequence->set_video_height(height);
+      sequence->set_video_time_base(rational(video_timebase_num, video_timebase_den));
+      sequence->set_audio_time_base(rational(audio_timebase_num, audio_timebase_den));
+      sequence->set_audio_channel_layout(channel_layout);
+      sequence->set_cache_priority(static_cast<olive::CachePriority>(cache_priority));
+
+      if (created) {
+        if (file != nullptr && graph_chunk > 0 && graph_chunk < file->header_->chunk_count) {
+          sequence->SetDeferredGraph(file, graph_chunk);
+        }
+      } else if (!sequence->HasDeferredGraph()) {
+        ConformNodesToSequence(sequence.get());
+      }
+
+      item = sequence;
+      break;
+    }
+    }
+
+    // Items are stored with parents before their children
+    Item* parent_item = (parent < 0) ? project->root() : placed.value(parent).get();
+
+    if (item == nullptr || parent_item == nullptr || !parent_item->CanHaveChildren()) {
+      return false;
+    }
+
+    item->set_file_key(key);
+    item->set_name(name);
+
+    parent_item->add_child(item);
+
+    placed.insert(key, item);
+  }
+
+  if (in.status() != QDataStream::Ok) {
+    return false;
+  }
+
+  foreach (ItemPtr item, existing) {
+    if (item->parent() != nullptr) {
+      item->parent()->remove_child(item.get());
+    }
+  }
+
+  project->set_next_file_key(qMax(project->next_file_key(), static_cast<int>(next_key)));
+
+  return true;
+}
+
+QByteArray ProjectFile::CreateGraphChunk(Sequence *sequence,
+                                         Project *project,
+                                         const QHash<Item *, int> &item_keys,
+                                         const QList<Node *> &node_list,
+                                         const QVector<int32_t> &removed_keys)
+{
+  NodeGraph* graph = sequence;
+
+  QVector<NodeRecord> nodes;
+  QVector<InputRecord> inputs;
+  QVector<KeyframeRecord> keyframes;
+  QVector<EdgeRecord> edges;
+
+  nodes.reserve(node_list.size());
+
+  // IDs repeat a lot, so each one is only stored once
+  QHash<QString, int32_t> string_indices;
+  QVector<StringRecord> strings;
+  QByteArray string_data;
+
+  auto add_string = [&string_indices, &strings, &string_data](const QString& s) -> int32_t {
+    int32_t index = string_indices.value(s, -1);
+
+    if (index < 0) {
+      QByteArray utf8 = s.toUtf8();
+
+      StringRecord record;
+      record.offset = string_data.size();
+      record.size = utf8.size();
+
+      string_data.append(utf8);
+
+      index = strings.size();
+      strings.append(record);
+      string_indices.insert(s, index);
+    }
+
+    return index;
+  };
+
+  QByteArray values;
+  QDataStream value_stream(&values, QIODevice::WriteOnly);
+  value_stream.setVersion(kStreamVersion);
+
+  foreach (Node* node, node_list) {
+    if (node->file_key() < 0) {
+      node->set_file_key(project->TakeFileKey());
+    }
+
+    NodeRecord record;
+    memset(&record, 0, sizeof(NodeRecord));
+
+    record.id = add_string(node->id());
+    record.first_input = inputs.size();
+    record.key = node->file_key();
+
+    Block* block = dynamic_cast<Block*>(node);
+
+    if (block != nullptr) {
+      record.length_num = block->length().numerator();
+      record.length_den = block->length().denominator();
+      record.media_in_num = block->media_in().numerator();
+      record.media_in_den = block->media_in().denominator();
+    }
+
+    foreach (NodeParam* param, node->parameters()) {
+      if (param->type() != NodeParam::kInput) {
+        continue;
+      }
+
+      NodeInput* input = static_cast<NodeInput*>(param);
+
+      InputRecord input_record;
+      input_record.id = add_string(input->id());
+      input_record.flags = input->keyframing() ? static_cast<uint32_t>(kKeyframing) : 0;
+      input_record.first_keyframe = keyframes.size();
+
+      QList<NodeKeyframe> input_keyframes = input->keyframes();
+
+      input_record.keyframe_count = input_keyframes.size();
+
+      foreach (const NodeKeyframe& key, input_keyframes) {
+        KeyframeRecord key_record;
+        key_record.time_num = key.time().numerator();
+        key_record.time_den = key.time().denominator();
+        key_record.type = key.type();
+        key_record.reserved = 0;
+        key_record.value_offset = values.size();
+
+        WriteValue(value_stream, input, key.value(), item_keys);
+
+        key_record.value_size = values.size() - key_record.value_offset;
+
+        keyframes.append(key_record);
+      }
+
+      inputs.append(input_record);
+
+      // Edges are stored in the order they were connected in since some inputs (e.g. a track's) depend on it
+      foreach (NodeEdgePtr edge, input->edges()) {
+        Node* output_node = edge->output()->parent();
+
+        if (output_node->parent() != graph) {
+          continue;
+        }
+
+        // The node the edge comes from may not be written in this chunk, but is referred to by the same key when it is
+        if (output_node->file_key() < 0) {
+          output_node->set_file_key(project->TakeFileKey());
+        }
+
+        EdgeRecord edge_record;
+        edge_record.output_node = output_node->file_key();
+        edge_record.output_id = add_string(edge->output()->id());
+        edge_record.input_node = node->file_key();
+        edge_record.input_id = input_record.id;
+
+        edges.append(edge_record);
+      }
+    }
+
+    record.input_count = inputs.size() - record.first_input;
+
+    nodes.append(record);
+  }
+
+  // Reserve space for the header and fill it in once every array's offset is known
+  QByteArray chunk(static_cast<int>(sizeof(GraphHeader)), '\0');
+
+  GraphHeader header;
+  memset(&header, 0, sizeof(GraphHeader));
+
+  header.node_count = nodes.size();
+  header.input_count = inputs.size();
+  header.keyframe_count = keyframes.size();
+  header.edge_count = edges.size();
+  header.string_count = strings.size();
+  header.removed_count = removed_keys.size();
+  header.nodes_offset = AppendRecords(&chunk, nodes);
+  header.inputs_offset = AppendRecords(&chunk, inputs);
+  header.keyframes_offset = AppendRecords(&chunk, keyframes);
+  header.edges_offset = AppendRecords(&chunk, edges);
+  header.strings_offset = AppendRecords(&chunk, strings);
+  header.string_data_offset = AppendAligned(&chunk, string_data.constData(), string_data.size());
+  header.string_data_size = string_data.size();
+  header.values_offset = AppendAligned(&chunk, values.constData(), values.size());
+  header.values_size = values.size();
+  header.removed_offset = AppendRecords(&chunk, removed_keys);
+
+  memcpy(chunk.data(), &header, sizeof(GraphHeader));
+
+  return chunk;
+}
+
+bool ProjectFile::ApplyGraphChunk(const char *base, int64_t size, Sequence *sequence)
+{
+  if (size < static_cast<int64_t>(sizeof(GraphHeader))) {
+    return false;
+  }
+
+  const GraphHeader* header = reinterpret_cast<const GraphHeader*>(base);
+
+  // Make sure every array is actually in the chunk
+  if (header->node_count < 0
+      || header->input_count < 0
+      || header->keyframe_count < 0
+      || header->edge_count < 0
+      || header->string_count < 0
+      || header->removed_count < 0
+      || !IsInChunk(size, header->nodes_offset, header->node_count * static_cast<int64_t>(sizeof(NodeRecord)))
+      || !IsInChunk(size, header->inputs_offset, header->input_count * static_cast<int64_t>(sizeof(InputRecord)))
+      || !IsInChunk(size,
+                    header->keyframes_offset,
+                    header->keyframe_count * static_cast<int64_t>(sizeof(KeyframeRecord)))
+      || !IsInChunk(size, header->edges_offset, header->edge_count * static_cast<int64_t>(sizeof(EdgeRecord)))
+      || !IsInChunk(size, header->strings_offset, header->string_count * static_cast<int64_t>(sizeof(StringRecord)))
+      || !IsInChunk(size, header->string_data_offset, header->string_data_size)
+      || !IsInChunk(size, header->values_offset, header->values_size)
+      || !IsInChunk(size, header->removed_offset, header->removed_count * static_cast<int64_t>(sizeof(int32_t)))) {
+    return false;
+  }
+
+  const NodeRecord* nodes = reinterpret_cast<const NodeRecord*>(base + header->nodes_offset);
+  const InputRecord* inputs = reinterpret_cast<const InputRecord*>(base + header->inputs_offset);
+  const KeyframeRecord* keyframes = reinterpret_cast<const KeyframeRecord*>(base + header->keyframes_offset);
+  const EdgeRecord* edges = reinterpret_cast<const EdgeRecord*>(base + header->edges_offset);
+  const StringRecord* string_records = reinterpret_cast<const StringRecord*>(base + header->strings_offset);
+  const char* string_data = base + header->string_data_offset;
+  const char* values = base + header->values_offset;
+  const int32_t* removed = reinterpret_cast<const int32_t*>(base + header->removed_offset);
+
+  // IDs repeat a lot, so each string is only decoded once
+  QVector<QString> strings(header->string_count);
+
+  for (int i=0;i<header->string_count;i++) {
+    const StringRecord& record = string_records[i];
+
+    if (record.offset < 0
+        || record.size < 0
+        || record.offset + static_cast<int64_t>(record.size) > header->string_data_size) {
+      return false;
+    }
+
+    strings[i] = QString::fromUtf8(string_data + record.offset, record.size);
+  }
+
+  // Footage is referred to by key, so find every Item in the Sequence's project
+  Item* root = sequence;
+
+  while (root->parent() != nullptr) {
+    root = root->parent();
+  }
+
+  QHash<int, ItemPtr> items;
+  ListItemsByKey(root, &items);
+
+  QHash<int, Node*> existing;
+
+  foreach (Node* node, sequence->nodes()) {
+    if (node->file_key() >= 0) {
+      existing.insert(node->file_key(), node);
+    }
+  }
+
+  // Propagate the invalidations from setting values and connecting edges once at the end
+  NodeInvalidationBatch batch;
+
+  for (int i=0;i<header->removed_count;i++) {
+    Node* node = existing.take(removed[i]);
+
+    if (node == nullptr) {
+      continue;
+    }
+
+    foreach (NodeParam* param, node->parameters()) {
+      while (!param->edges().isEmpty()) {
+        NodeEdgePtr edge = param->edges().first();
+
+        NodeParam::DisconnectEdge(edge);
+      }
+    }
+
+    sequence->TakeNode(node);
+
+    delete node;
+  }
+
+  QVector<Node*> applied;
+  applied.reserve(header->node_count);
+
+  for (int i=0;i<header->node_count;i++) {
+    const NodeRecord& record = nodes[i];
+
+    Node* node = existing.value(record.key, nullptr);
+
+    bool created = (node == nullptr);
+
+    if (created) {
+      QString id = strings.value(record.id);
+
+      node = Node::CreateFromID(id);
+
+      if (node == nullptr) {
+        qWarning() << "Skipping node with unknown ID" << id;
+        continue;
+      }
+
+      node->set_file_key(record.key);
+    } else {
+      // The chunk has every edge connected to the node's inputs, so they replace the ones it has now
+      foreach (NodeParam* param, node->parameters()) {
+        if (param->type() != NodeParam::kInput) {
+          continue;
+        }
+
+        while (!param->edges().isEmpty()) {
+          NodeEdgePtr edge = param->edges().first();
+
+          NodeParam::DisconnectEdge(edge);
+        }
+      }
+    }
+
+    Block* block = dynamic_cast<Block*>(node);
+
+    if (block != nullptr) {
+      block->set_length(rational(record.length_num, record.length_den));
+      block->set_media_in(rational(record.media_in_num, record.media_in_den));
+    }
+
+    if (record.first_input >= 0
+        && record.input_count >= 0
+        && record.first_input + static_cast<int64_t>(record.input_count) <= header->input_count) {
+
+      for (int j=record.first_input;j<record.first_input+record.input_count;j++) {
+        const InputRecord& input_record = inputs[j];
+
+        NodeParam* param = FindParam(node, strings.value(input_record.id));
+
+        if (param == nullptr || param->type() != NodeParam::kInput) {
+          continue;
+        }
+
+        NodeInput* input = static_cast<NodeInput*>(param);
+
+        input->set_keyframing((input_record.flags & kKeyframing) != 0);
+
+        if (input_record.first_keyframe < 0
+            || input_record.keyframe_count < 0
+            || input_record.first_keyframe + static_cast<int64_t>(input_record.keyframe_count)
+               > header->keyframe_count) {
+          continue;
+        }
+
+        QList<NodeKeyframe> input_keyframes;
+        input_keyframes.reserve(input_record.keyframe_count);
+
+        for (int k=input_record.first_keyframe;k<input_record.first_keyframe+input_record.keyframe_count;k++) {
+          const KeyframeRecord& key_record = keyframes[k];
+
+          if (key_record.value_offset < 0
+              || key_record.value_size < 0
+              || key_record.value_offset + key_record.value_size > header->values_size) {
+            continue;
+          }
+
+          NodeKeyframe key;
+          key.set_time(rational(key_record.time_num, key_record.time_den));
+          key.set_type(static_cast<NodeKeyframe::Type>(key_record.type));
+          key.set_value(ReadValue(values + key_record.value_offset, key_record.value_size, items));
+
+          input_keyframes.append(key);
+        }
+
+        input->set_keyframes(input_keyframes);
+      }
+    }
+
+    if (created) {
+      sequence->AddNode(node);
+
+      existing.insert(record.key, node);
+    }
+
+    applied.append(node);
+  }
+
+  for (int i=0;i<header->edge_count;i++) {
+    const EdgeRecord& record = edges[i];
+
+    Node* output_node = existing.value(record.output_node, nullptr);
+    Node* input_node = existing.value(record.input_node, nullptr);
+
+    if (output_node == nullptr || input_node == nullptr) {
+      continue;
+    }
+
+    NodeParam* output = FindParam(output_node, strings.value(record.output_id));
+    NodeParam* input = FindParam(input_node, strings.value(record.input_id));
+
+    if (output == nullptr
+        || input == nullptr
+        || output->type() != NodeParam::kOutput
+        || input->type() != NodeParam::kInput) {
+      continue;
+    }
+
+    NodeParam::ConnectEdge(static_cast<NodeOutput*>(output), static_cast<NodeInput*>(input));
+  }
+
+  ConformNodesToSequence(sequence);
+
+  // The nodes now match the chunk they came from
+  foreach (Node* node, applied) {
+    node->SetModified(false);
+  }
+
+  return true;
+}
+
+void ProjectFile::WriteValue(QDataStream &out,
+                             NodeInput *input,
+                             const QVariant &value,
+                             const QHash<Item *, int> &item_keys)
+{
+  const QList<NodeParam::DataType>& types = input->inputs();
+
+  if (types.contains(NodeParam::kFootage)) {
+    // Footage is referred to by its key
+    out << static_cast<quint8>(kFootageValue)
+        << static_cast<qint32>(item_keys.value(Node::ValueToPtr<Footage>(value), -1));
+  } else if (types.contains(NodeParam::kTexture)
+             || types.contains(NodeParam::kBlock)
+             || types.contains(NodeParam::kTrack)
+             || !value.isValid()) {
+    // These are only ever set through connections
+    out << static_cast<quint8>(kNoValue);
+  } else if (value.userType() == qMetaTypeId<rational>()) {
+    rational r = value.value<rational>();
+
+    out << static_cast<quint8>(kRationalValue)
+        << static_cast<qint64>(r.numerator())
+        << static_cast<qint64>(r.denominator());
+  } else {
+    out << static_cast<quint8>(kVariantValue) << value;
+  }
+}
+
+QVariant ProjectFile::ReadValue(const char *data, int64_t size, const QHash<int, ItemPtr> &items)
+{
+  QByteArray bytes = QByteArray::fromRawData(data, static_cast<int>(size));
+
+  QDataStream in(bytes);
+  in.setVersion(kStreamVersion);
+
+  quint8 tag;
+  in >> tag;
+
+  switch (static_cast<ValueTag>(tag)) {
+  case kVariantValue:
+  {
+    QVariant value;
+    in >> value;
+    return value;
+  }
+  case kRationalValue:
+  {
+    qint64 num, den;
+    in >> num >> den;
+    return QVariant::fromValue(rational(num, den));
+  }
+  case kFootageValue:
+  {
+    qint32 key;
+    in >> key;
+
+    ItemPtr item = items.value(key);
+
+    if (item == nullptr || item->type() != Item::kFootage) {
+      return Node::PtrToValue(nullptr);
+    }
+
+    return Node::PtrToValue(static_cast<Footage*>(item.get()));
+  }
+  case kNoValue:
+    break;
+  }
+
+  return QVariant();
+}
+
+NodeParam *ProjectFile::FindParam(Node *node, const QString &id)
+{
+  foreach (NodeParam* param, node->parameters()) {
+    if (param->id() == id) {
+      return param;
+    }
+  }
+
+  return nullptr;
+}
+
+void ProjectFile::ConformNodesToSequence(Sequence *sequence)
+{
+  foreach (Node* node, sequence->nodes()) {
+    RendererProcessor* renderer = dynamic_cast<RendererProcessor*>(node);
+
+    if (renderer != nullptr) {
+      renderer->SetParameters(sequence->video_width(),
+                              sequence->video_height(),
+                              olive::PIX_FMT_RGBA16F, // FIXME: Make this configurable
+                              olive::RenderMode::kOffline,
+                              2);
+
+      renderer->SetCacheFormat(RendererCacheCodec::FormatForPriority(sequence->cache_priority()));
+
+      renderer->SetTimebase(sequence->video_time_base());
+      continue;
+    }
+
+    TimelineOutput* timeline = dynamic_cast<TimelineOutput*>(node);
+
+    if (timeline != nullptr) {
+      timeline->SetTimebase(sequence->video_time_base());
+      continue;
+    }
+
+    ViewerOutput* viewer = dynamic_cast<ViewerOutput*>(node);
+
+    if (viewer != nullptr) {
+      viewer->SetTimebase(sequence->video_time_base());
+    }
+  }
+}
+
+bool ProjectFile::IsInChunk(int64_t chunk_size, int64_t offset, int64_t size)
+{
+  return (offset >= 0
+          && offset % kAlignment == 0
+          && size >= 0
+          && offset + size <= chunk_size);
+}
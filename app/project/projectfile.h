@@ -0,0 +1,349 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROJECTFILE_H
+#define PROJECTFILE_H
+
+#include <memory>
+#include <QDataStream>
+#include <QFile>
+#include <QHash>
+#include <QPair>
+#include <QVector>
+#include <stdint.h>
+
+#include "project/project.h"
+
+class Node;
+class NodeInput;
+class NodeParam;
+class Sequence;
+
+class ProjectFile;
+using ProjectFilePtr = std::shared_ptr<ProjectFile>;
+
+/**
+ * @brief Olive's binary project file format
+ *
+ * A project file is a container of chunks listed in a table after the header. The first chunk holds every Item in the
+ * project (small enough that it's simply read with a QDataStream), and each Sequence's node graph is stored in a chunk
+ * of its own.
+ *
+ * Graph chunks are laid out to be read straight from a memory-mapped file: the nodes, their inputs, the inputs'
+ * keyframes and the edges are each stored as one contiguous array of fixed-size records, with strings (node and
+ * parameter IDs, which repeat a lot) stored once in a table and values in a blob after it.
+ *
+ * Loading is lazy. Load() only reads the Items, and each Sequence keeps a reference to the file until its graph is
+ * needed (see Sequence::LoadDeferredGraph()), so opening a project doesn't depend on how many nodes it has. The file
+ * stays mapped for as long as any Sequence's graph hasn't been loaded.
+ *
+ * Items and Nodes are identified by keys (see Item::file_key() and Node::file_key()) rather than by their position, so
+ * chunks can also describe changes to a project that's already loaded: a graph chunk may contain only some of a
+ * Sequence's nodes along with the keys of nodes that were removed, which is how ProjectAutosave journals edits.
+ *
+ * Projects can also be exported as XML with ExportXml() for reading by other tools, but are only loaded from the
+ * binary format.
+ */
+class ProjectFile
+{
+public:
+  /// Version of the file layout, projects with a different version can't be loaded
+  static const uint32_t kVersion = 1;
+
+  ~ProjectFile();
+
+  /**
+   * @brief Load the Items of a project file, leaving its Sequences' graphs to be loaded when they're needed
+   *
+   * @return
+   *
+   * The project, or nullptr if the file couldn't be loaded (with the reason in `error`).
+   */
+  static ProjectPtr Load(const QString& filename, QString* error);
+
+  /**
+   * @brief Save a project
+   *
+   * The graphs of Sequences that haven't been loaded yet are copied from the file they're in as they are, and those
+   * Sequences are pointed at the new file if it replaced the one they were loaded from. The project is written to a
+   * temporary file that replaces `filename` once it's complete, so a failed save never leaves a broken project behind.
+   */
+  static bool Save(Project* project, const QString& filename, QString* error);
+
+  /**
+   * @brief Write a project as XML
+   */
+  static bool ExportXml(Project* project, const QString& filename, QString* error);
+
+  /**
+   * @brief Create the nodes and edges of a graph chunk in a Sequence
+   *
+   * Called by Sequence::LoadDeferredGraph().
+   */
+  bool LoadGraph(int chunk, Sequence* sequence);
+
+private:
+  friend class ProjectAutosave;
+
+  /**
+   * @brief Layout of the start of a project file
+   */
+  struct Header {
+    char magic[4];
+    uint32_t version;
+    int32_t chunk_count;
+    int32_t reserved;
+  };
+
+  /**
+   * @brief Layout of each chunk's entry in the table after the header
+   */
+  struct Chunk {
+    char type[4];
+    int32_t reserved;
+
+    /// Byte offset of this chunk from the start of the file
+    int64_t offset;
+
+    int64_t size;
+  };
+
+  /**
+   * @brief Layout of the start of a graph chunk, all offsets are from the start of the chunk
+   */
+  struct GraphHeader {
+    int32_t node_count;
+    int32_t input_count;
+    int32_t keyframe_count;
+    int32_t edge_count;
+    int32_t string_count;
+
+    /// Number of keys of nodes to remove, only used when changes are journaled
+    int32_t removed_count;
+
+    int64_t nodes_offset;
+    int64_t inputs_offset;
+    int64_t keyframes_offset;
+    int64_t edges_offset;
+    int64_t strings_offset;
+    int64_t string_data_offset;
+    int64_t string_data_size;
+    int64_t values_offset;
+    int64_t values_size;
+    int64_t removed_offset;
+  };
+
+  struct NodeRecord {
+    /// Index of the node's ID in the string table
+    int32_t id;
+    int32_t first_input;
+    int32_t input_count;
+
+    /// The node's file key
+    int32_t key;
+
+    /// Only used by Blocks
+    int64_t length_num;
+    int64_t length_den;
+    int64_t media_in_num;
+    int64_t media_in_den;
+  };
+
+  struct InputRecord {
+    /// Index of the parameter's ID in the string table
+    int32_t id;
+    uint32_t flags;
+    int32_t first_keyframe;
+    int32_t keyframe_count;
+  };
+
+  struct KeyframeRecord {
+    int64_t time_num;
+    int64_t time_den;
+    int32_t type;
+    int32_t reserved;
+
+    /// Location of the value in the value blob
+    int64_t value_offset;
+    int64_t value_size;
+  };
+
+  /**
+   * @brief An edge, with the nodes it connects referred to by their keys
+   */
+  struct EdgeRecord {
+    int32_t output_node;
+    int32_t output_id;
+    int32_t input_node;
+    int32_t input_id;
+  };
+
+  struct StringRecord {
+    /// Location of the UTF-8 string in the string data
+    int32_t offset;
+    int32_t size;
+  };
+
+  /// Flags set in InputRecord::flags
+  enum InputFlag {
+    kKeyframing = 0x1
+  };
+
+  /// Tags preceding each value in the value blob
+  enum ValueTag {
+    kNoValue,
+    kVariantValue,
+    kRationalValue,
+    kFootageValue
+  };
+
+  ProjectFile();
+
+  /**
+   * @brief Map a project file and check that its header and chunk table are intact
+   */
+  bool Map(const QString& filename, QString* error);
+
+  /**
+   * @brief Unmap and close the file
+   */
+  void Close();
+
+  /**
+   * @brief Return a copy of a graph chunk's data, or an empty array if there's no such chunk
+   */
+  QByteArray GraphChunkData(int chunk_index) const;
+
+  /**
+   * @brief Build every chunk of a project file
+   *
+   * @param deferred
+   *
+   * Filled with each Sequence whose graph was copied as it is from the file it hasn't been loaded from yet, along
+   * with the index of the chunk it was copied to.
+   */
+  static void CreateChunks(Project* project, QList<QByteArray>* chunks, QList<QPair<Sequence*, int> >* deferred);
+
+  /**
+   * @brief Write chunks built by CreateChunks() to a file
+   *
+   * Doesn't touch anything but its arguments, so it can be called from any thread.
+   */
+  static bool WriteChunks(const QString& filename, const QList<QByteArray>& chunks);
+
+  /**
+   * @brief Give every Item in a project that doesn't have a file key one
+   *
+   * @param items
+   *
+   * Filled with every Item, parents before their children.
+   *
+   * @return
+   *
+   * The key of each Item, for referring to Footage from values without dereferencing pointers to deleted Items.
+   */
+  static QHash<Item*, int> KeyItems(Project* project, QVector<Item*>* items);
+
+  /**
+   * @brief Build the Items chunk of a project
+   *
+   * @param graph_chunks
+   *
+   * The index of the chunk of each Sequence's graph, Sequences that aren't in it are written without one.
+   */
+  static QByteArray CreateItemsChunk(Project* project,
+                                     const QVector<Item*>& items,
+                                     const QHash<Item*, int>& item_keys,
+                                     const QHash<Sequence*, int>& graph_chunks);
+
+  /**
+   * @brief Make a project's Items match an Items chunk
+   *
+   * Items already in the project are matched by their keys and moved, renamed or removed to match. New Sequences get
+   * their graphs from `file` if it's set.
+   */
+  static bool ApplyItemsChunk(const QByteArray& data, Project* project, const ProjectFilePtr& file);
+
+  /**
+   * @brief Build a graph chunk of some of a Sequence's nodes
+   *
+   * Nodes without a file key are given one. Only edges connected to the inputs of the nodes written are stored.
+   *
+   * @param removed_keys
+   *
+   * Keys of nodes that have been removed from the Sequence, for chunks journaling changes.
+   */
+  static QByteArray CreateGraphChunk(Sequence* sequence,
+                                     Project* project,
+                                     const QHash<Item*, int>& item_keys,
+                                     const QList<Node*>& nodes,
+                                     const QVector<int32_t>& removed_keys);
+
+  /**
+   * @brief Apply a graph chunk to a Sequence
+   *
+   * Nodes already in the Sequence with the key of one in the chunk are updated (and their input edges replaced with
+   * the chunk's), the rest are created. Nodes applied are no longer marked as modified.
+   */
+  static bool ApplyGraphChunk(const char* base, int64_t size, Sequence* sequence);
+
+  /**
+   * @brief Write a keyframe's value to the value blob
+   */
+  static void WriteValue(QDataStream& out,
+                         NodeInput* input,
+                         const QVariant& value,
+                         const QHash<Item*, int>& item_keys);
+
+  /**
+   * @brief Read a value written by WriteValue()
+   *
+   * @param items
+   *
+   * Every Item in the project by its key, for resolving Footage.
+   */
+  static QVariant ReadValue(const char* data, int64_t size, const QHash<int, ItemPtr>& items);
+
+  /**
+   * @brief Find a parameter of a Node by its ID
+   */
+  static NodeParam* FindParam(Node* node, const QString& id);
+
+  /**
+   * @brief Make the nodes that are set up from the Sequence's parameters (renderer, viewer and timeline) match them
+   */
+  static void ConformNodesToSequence(Sequence* sequence);
+
+  /**
+   * @brief Returns whether `size` bytes at `offset` of a chunk of `chunk_size` bytes are inside it
+   */
+  static bool IsInChunk(int64_t chunk_size, int64_t offset, int64_t size);
+
+  QFile file_;
+
+  uchar* map_;
+
+  const Header* header_;
+
+  const Chunk* chunks_;
+
+};
+
+#endif // PROJECTFILE_H
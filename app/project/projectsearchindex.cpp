@@ -0,0 +1,208 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "projectsearchindex.h"
+
+#include <algorithm>
+#include <QRegExp>
+#include <QStringList>
+
+#include "project/item/item.h"
+
+ProjectSearchIndex::ProjectSearchIndex()
+{
+}
+
+void ProjectSearchIndex::Insert(Item *item)
+{
+  lock_.lock();
+  InsertInternal(item);
+  lock_.unlock();
+
+  emit Changed();
+}
+
+void ProjectSearchIndex::Remove(Item *item)
+{
+  lock_.lock();
+  RemoveInternal(item);
+  lock_.unlock();
+
+  emit Changed();
+}
+
+void ProjectSearchIndex::Update(Item *item)
+{
+  lock_.lock();
+  RemoveInternal(item);
+  InsertInternal(item);
+  lock_.unlock();
+
+  emit Changed();
+}
+
+QVector<Item *> ProjectSearchIndex::Search(const QString &query) const
+{
+  QStringList terms = query.toLower().split(QRegExp(QStringLiteral("\\s+")), QString::SkipEmptyParts);
+
+  QVector<Item*> results;
+
+  if (terms.isEmpty()) {
+    return results;
+  }
+
+  QMutexLocker locker(&lock_);
+
+  // Narrow down to the items containing every trigram of every term, starting from the rarest trigram so the
+  // intersections stay small
+  QVector<const QSet<Item*>*> postings;
+
+  foreach (const QString& term, terms) {
+    foreach (quint64 trigram, GetTrigrams(term)) {
+      QHash<quint64, QSet<Item*> >::const_iterator it = trigrams_.constFind(trigram);
+
+      if (it == trigrams_.constEnd()) {
+        // No item has this trigram, so nothing can match
+        return results;
+      }
+
+      postings.append(&it.value());
+    }
+  }
+
+  QSet<Item*> candidates;
+
+  if (postings.isEmpty()) {
+    // Every term is shorter than a trigram, so every item is a candidate
+    for (QHash<Item*, QString>::const_iterator it=texts_.constBegin();it!=texts_.constEnd();it++) {
+      candidates.insert(it.key());
+    }
+  } else {
+    std::sort(postings.begin(), postings.end(), [](const QSet<Item*>* a, const QSet<Item*>* b) {
+      return a->size() < b->size();
+    });
+
+    candidates = *postings.first();
+
+    for (int i=1;i<postings.size() && !candidates.isEmpty();i++) {
+      candidates.intersect(*postings.at(i));
+    }
+  }
+
+  // Items having every trigram don't necessarily contain every term, so check the text itself
+  results.reserve(candidates.size());
+
+  foreach (Item* item, candidates) {
+    const QString& text = texts_.value(item);
+    bool match = true;
+
+    foreach (const QString& term, terms) {
+      if (!text.contains(term)) {
+        match = false;
+        break;
+      }
+    }
+
+    if (match) {
+      results.append(item);
+    }
+  }
+
+  return results;
+}
+
+int ProjectSearchIndex::count() const
+{
+  QMutexLocker locker(&lock_);
+
+  return texts_.size();
+}
+
+QString ProjectSearchIndex::GetSearchText(Item *item)
+{
+  // The root folder's name isn't part of any path
+  QStringList path;
+
+  for (Item* folder=item->parent();folder!=nullptr && folder->parent()!=nullptr;folder=folder->parent()) {
+    path.prepend(folder->name());
+  }
+
+  // Fields are kept on separate lines so neither terms nor trigrams match across them
+  QString text = item->name();
+  text.append('\n');
+  text.append(path.join('/'));
+  text.append('\n');
+  text.append(item->SearchMetadata());
+
+  return text.toLower();
+}
+
+QSet<quint64> ProjectSearchIndex::GetTrigrams(const QString &text)
+{
+  QSet<quint64> trigrams;
+
+  for (int i=0;i+2<text.size();i++) {
+    trigrams.insert(static_cast<quint64>(text.at(i).unicode()) << 32
+                    | static_cast<quint64>(text.at(i + 1).unicode()) << 16
+                    | static_cast<quint64>(text.at(i + 2).unicode()));
+  }
+
+  return trigrams;
+}
+
+void ProjectSearchIndex::InsertInternal(Item *item)
+{
+  QString text = GetSearchText(item);
+
+  foreach (quint64 trigram, GetTrigrams(text)) {
+    trigrams_[trigram].insert(item);
+  }
+
+  texts_.insert(item, text);
+
+  for (int i=0;i<item->child_count();i++) {
+    InsertInternal(item->child(i));
+  }
+}
+
+void ProjectSearchIndex::RemoveInternal(Item *item)
+{
+  QHash<Item*, QString>::iterator it = texts_.find(item);
+
+  if (it != texts_.end()) {
+    foreach (quint64 trigram, GetTrigrams(it.value())) {
+      QHash<quint64, QSet<Item*> >::iterator posting = trigrams_.find(trigram);
+
+      if (posting != trigrams_.end()) {
+        posting.value().remove(item);
+
+        if (posting.value().isEmpty()) {
+          trigrams_.erase(posting);
+        }
+      }
+    }
+
+    texts_.erase(it);
+  }
+
+  for (int i=0;i<item->child_count();i++) {
+    RemoveInternal(item->child(i));
+  }
+}
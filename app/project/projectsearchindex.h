@@ -0,0 +1,112 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROJECTSEARCHINDEX_H
+#define PROJECTSEARCHINDEX_H
+
+#include <QHash>
+#include <QMutex>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+
+class Item;
+
+/**
+ * @brief A trigram index over the names, folder paths and metadata of every Item in a Project
+ *
+ * Filtering tens of thousands of items by walking the Folder tree and comparing every name on each keystroke is too
+ * slow, so each Project keeps this index up to date as items are added, removed, renamed or probed (see
+ * Item::search_index()). Each item's searchable text is split into every run of three characters, and a search only
+ * has to compare the items containing all of the query's trigrams rather than every item.
+ *
+ * Thread-safe, since footage is probed (and therefore reindexed) in the background.
+ */
+class ProjectSearchIndex : public QObject
+{
+  Q_OBJECT
+public:
+  ProjectSearchIndex();
+
+  ProjectSearchIndex(const ProjectSearchIndex& other) = delete;
+  ProjectSearchIndex& operator=(const ProjectSearchIndex& other) = delete;
+
+  /**
+   * @brief Index an item and everything inside it
+   */
+  void Insert(Item* item);
+
+  /**
+   * @brief Remove an item and everything inside it from the index
+   */
+  void Remove(Item* item);
+
+  /**
+   * @brief Reindex an item and everything inside it (whose paths include its name)
+   */
+  void Update(Item* item);
+
+  /**
+   * @brief Returns every item matching `query`, in no particular order
+   *
+   * The query is split on whitespace and an item matches if its name, the path of the folder it's in or its metadata
+   * contains every word, ignoring case. An empty query matches nothing.
+   */
+  QVector<Item*> Search(const QString& query) const;
+
+  /**
+   * @brief Returns the number of items in the index
+   */
+  int count() const;
+
+signals:
+  /**
+   * @brief Emitted whenever the index changes, from whichever thread changed it
+   *
+   * Results of an earlier Search() may be out of date after this.
+   */
+  void Changed();
+
+private:
+  /**
+   * @brief Returns the lowercase text `item` is searched by
+   */
+  static QString GetSearchText(Item* item);
+
+  /**
+   * @brief Returns the unique trigrams in `text`
+   */
+  static QSet<quint64> GetTrigrams(const QString& text);
+
+  void InsertInternal(Item* item);
+
+  void RemoveInternal(Item* item);
+
+  /// Searchable text of every item
+  QHash<Item*, QString> texts_;
+
+  /// Items containing each trigram, three UTF-16 code units packed into the low 48 bits
+  QHash<quint64, QSet<Item*> > trigrams_;
+
+  mutable QMutex lock_;
+
+};
+
+#endif // PROJECTSEARCHINDEX_H
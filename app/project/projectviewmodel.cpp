@@ -25,6 +25,8 @@
 #include <QUrl>
 
 #include "core.h"
+#include "decoder/filmstrip.h"
+#include "project/item/footage/footage.h"
 #include "undo/undostack.h"
 
 ProjectViewModel::ProjectViewModel(QObject *parent) :
@@ -48,6 +50,9 @@ void ProjectViewModel::set_project(Project *p)
 
   project_ = p;
 
+  fetched_rows_.clear();
+  thumbnail_icons_.clear();
+
   endResetModel();
 }
 
@@ -95,13 +100,8 @@ int ProjectViewModel::rowCount(const QModelIndex &parent) const
     return 0;
   }
 
-  // If the index is the root, return the root child count
-  if (parent == QModelIndex()) {
-    return project_->root()->child_count();
-  }
-
-  // Otherwise, the index must contain a valid pointer, so we just return its child count
-  return GetItemObjectFromIndex(parent)->child_count();
+  // Only rows that have been fetched exist as far as views are concerned
+  return FetchedRowCount(GetItemObjectFromIndex(parent));
 }
 
 int ProjectViewModel::columnCount(const QModelIndex &parent) const
@@ -142,7 +142,7 @@ QVariant ProjectViewModel::data(const QModelIndex &index, int role) const
   case Qt::DecorationRole:
     // If this is the first column, return the Item's icon
     if (column_type == kName) {
-      return internal_item->icon();
+      return GetItemIcon(internal_item);
     }
     break;
   case Qt::ToolTipRole:
@@ -209,20 +209,33 @@ bool ProjectViewModel::setData(const QModelIndex &index, const QVariant &value,
 
 bool ProjectViewModel::canFetchMore(const QModelIndex &parent) const
 {
-  // Check if this is a valid index
-  if (parent.isValid()) {
-    Item* item = GetItemObjectFromIndex(parent);
+  if (project_ == nullptr) {
+    return false;
+  }
 
-    // Check if this item is a kFolder type
-    // If it's a folder, we always return TRUE in order to always show the "expand triangle" icon,
-    // even when there are no "physical" children
-    if (item->CanHaveChildren()) {
-      return true;
-    }
+  return !IsFullyFetched(GetItemObjectFromIndex(parent));
+}
+
+void ProjectViewModel::fetchMore(const QModelIndex &parent)
+{
+  if (project_ == nullptr) {
+    return;
   }
 
-  // Otherwise, return default behavior
-  return QAbstractItemModel::canFetchMore(parent);
+  Item* folder = GetItemObjectFromIndex(parent);
+
+  int fetched = FetchedRowCount(folder);
+  int count = qMin(kFetchBatchSize, folder->child_count() - fetched);
+
+  if (count <= 0) {
+    return;
+  }
+
+  beginInsertRows(parent, fetched, fetched + count - 1);
+
+  fetched_rows_.insert(folder, fetched + count);
+
+  endInsertRows();
 }
 
 Qt::ItemFlags ProjectViewModel::flags(const QModelIndex &index) const
@@ -388,10 +401,20 @@ void ProjectViewModel::AddChild(Item *parent, ItemPtr child)
     parent_index = CreateIndexFromItem(parent);
   }
 
-  beginInsertRows(parent_index, parent->child_count(), parent->child_count());
+  // If the view hasn't fetched up to the end of this folder yet, it'll see the child once it does
+  if (!IsRowFetched(parent) || !IsFullyFetched(parent)) {
+    parent->add_child(child);
+    return;
+  }
+
+  int row = parent->child_count();
+
+  beginInsertRows(parent_index, row, row);
 
   parent->add_child(child);
 
+  fetched_rows_.insert(parent, row + 1);
+
   endInsertRows();
 }
 
@@ -404,11 +427,22 @@ void ProjectViewModel::RemoveChild(Item *parent, Item *child)
   }
 
   int child_row = IndexOfChild(child);
+  int fetched = FetchedRowCount(parent);
+
+  ForgetItem(child);
+
+  // Views don't know about rows that haven't been fetched so there's nothing to tell them
+  if (!IsRowFetched(parent) || child_row >= fetched) {
+    parent->remove_child(child);
+    return;
+  }
 
   beginRemoveRows(parent_index, child_row, child_row);
 
   parent->remove_child(child);
 
+  fetched_rows_.insert(parent, fetched - 1);
+
   endRemoveRows();
 }
 
@@ -416,6 +450,10 @@ void ProjectViewModel::RenameChild(Item *item, const QString &name)
 {
   item->set_name(name);
 
+  if (!IsRowFetched(item)) {
+    return;
+  }
+
   QModelIndex index = CreateIndexFromItem(item, columns_.indexOf(kName));
 
   emit dataChanged(index, index, {Qt::DisplayRole, Qt::EditRole});
@@ -423,24 +461,12 @@ void ProjectViewModel::RenameChild(Item *item, const QString &name)
 
 int ProjectViewModel::IndexOfChild(Item *item) const
 {
-  // Find parent's index within its own parent
-  // (FIXME: this model should handle sorting, which means it'll have to "know" the indices)
-
+  // Rows always follow the order of the children, ProjectViewSortModel handles sorting
   if (item == project_->root()) {
     return -1;
   }
 
-  Item* parent = item->parent();
-
-  if (parent != nullptr) {
-    for (int i=0;i<parent->child_count();i++) {
-      if (parent->child(i) == item) {
-        return i;
-      }
-    }
-  }
-
-  return -1;
+  return item->row();
 }
 
 int ProjectViewModel::ChildCount(const QModelIndex &index)
@@ -475,24 +501,137 @@ bool ProjectViewModel::ItemIsParentOfChild(Item *parent, Item *child) const
 
 void ProjectViewModel::MoveItemInternal(Item *item, Item *destination)
 {
+  Item* source = item->parent();
+
+  // A move can only be signalled if views know about the row on both ends, otherwise treat it as a removal and an
+  // addition (either of which may be invisible to the views)
+  if (!IsRowFetched(item) || !IsRowFetched(destination) || !IsFullyFetched(destination)) {
+    ItemPtr item_ptr = source->shared_ptr_from_raw(item);
+
+    RemoveChild(source, item);
+    AddChild(destination, item_ptr);
+    return;
+  }
+
   QModelIndex item_index = CreateIndexFromItem(item);
 
-  QModelIndex destination_index = CreateIndexFromItem(destination);
+  QModelIndex destination_index;
+
+  if (destination != project_->root()) {
+    destination_index = CreateIndexFromItem(destination);
+  }
+
+  int destination_row = destination->child_count();
+
+  beginMoveRows(item_index.parent(), item_index.row(), item_index.row(), destination_index, destination_row);
 
-  beginMoveRows(item_index.parent(), item_index.row(), item_index.row(), destination_index, destination->child_count());
+  ItemPtr item_ptr = source->shared_ptr_from_raw(item);
 
-  ItemPtr item_ptr = item->parent()->shared_ptr_from_raw(item);
+  fetched_rows_.insert(source, FetchedRowCount(source) - 1);
 
   destination->add_child(item_ptr);
 
+  fetched_rows_.insert(destination, destination_row + 1);
+
   endMoveRows();
 }
 
+int ProjectViewModel::FetchedRowCount(Item *folder) const
+{
+  // Clamped in case children were removed without going through this model
+  return qMin(fetched_rows_.value(folder, 0), folder->child_count());
+}
+
+bool ProjectViewModel::IsRowFetched(Item *item) const
+{
+  // The root is always "fetched" since it's the invisible top of the tree
+  while (item != project_->root()) {
+    if (item->row() >= FetchedRowCount(item->parent())) {
+      return false;
+    }
+
+    item = item->parent();
+  }
+
+  return true;
+}
+
+bool ProjectViewModel::IsFullyFetched(Item *folder) const
+{
+  return FetchedRowCount(folder) >= folder->child_count();
+}
+
+void ProjectViewModel::ForgetItem(Item *item)
+{
+  fetched_rows_.remove(item);
+  thumbnail_icons_.remove(item);
+
+  for (int i=0;i<item->child_count();i++) {
+    ForgetItem(item->child(i));
+  }
+}
+
+QIcon ProjectViewModel::GetItemIcon(Item *item) const
+{
+  if (item->type() != Item::kFootage) {
+    return item->icon();
+  }
+
+  QHash<Item*, QIcon>::const_iterator cached = thumbnail_icons_.constFind(item);
+
+  if (cached != thumbnail_icons_.constEnd()) {
+    return cached.value();
+  }
+
+  Footage* footage = static_cast<Footage*>(item);
+
+  for (int i=0;i<footage->stream_count();i++) {
+    if (footage->stream(i)->type() == Stream::kVideo) {
+      // The filmstrip may still be generating, in which case we'll try again next time this row is drawn
+      FilmstripPtr filmstrip = Filmstrip::Load(Filmstrip::GetFilename(footage->stream(i).get()));
+
+      if (filmstrip != nullptr && filmstrip->count() > 0) {
+        // Copy the image since the filmstrip's memory goes away when it's unloaded
+        QIcon thumbnail(QPixmap::fromImage(filmstrip->thumbnail(0).copy()));
+
+        thumbnail_icons_.insert(item, thumbnail);
+
+        return thumbnail;
+      }
+
+      break;
+    }
+  }
+
+  return item->icon();
+}
+
 QModelIndex ProjectViewModel::CreateIndexFromItem(Item *item, int column)
 {
   return createIndex(IndexOfChild(item), column, item);
 }
 
+void ProjectViewModel::FetchUpTo(Item *item)
+{
+  if (project_ == nullptr || item == project_->root() || item->root() != project_->root()) {
+    return;
+  }
+
+  Item* parent = item->parent();
+
+  FetchUpTo(parent);
+
+  QModelIndex parent_index;
+
+  if (parent != project_->root()) {
+    parent_index = CreateIndexFromItem(parent);
+  }
+
+  while (FetchedRowCount(parent) <= item->row()) {
+    fetchMore(parent_index);
+  }
+}
+
 ProjectViewModel::MoveItemCommand::MoveItemCommand(ProjectViewModel *model,
                                                    Item *item,
                                                    Folder *destination,
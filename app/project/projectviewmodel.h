@@ -22,6 +22,8 @@
 #define VIEWMODEL_H
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QIcon>
 #include <QUndoCommand>
 
 #include "project.h"
@@ -33,6 +35,10 @@
  * a ProjectViewModel), it may be better to make modifications (e.g. additions/removals/renames) through the
  * ProjectViewModel so that the views can be efficiently and correctly updated. ProjectViewModel contains several
  * "wrapper" functions for Project and Item functions that also signal any connected views to update accordingly.
+ *
+ * Folders are populated incrementally (see canFetchMore() and fetchMore()), so opening a folder with thousands of
+ * items only creates rows for the first kFetchBatchSize of them until the view scrolls further. Rows are always in
+ * the order of the Item's children, sorting is done by ProjectViewSortModel.
  */
 class ProjectViewModel : public QAbstractItemModel
 {
@@ -48,6 +54,9 @@ public:
     kRate
   };
 
+  /// Number of rows added to a folder each time a view asks for more
+  static const int kFetchBatchSize = 256;
+
   /**
    * @brief ProjectViewModel Constructor
    *
@@ -88,6 +97,7 @@ public:
   virtual bool hasChildren(const QModelIndex &parent = QModelIndex()) const override;
   virtual bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole) override;
   virtual bool canFetchMore(const QModelIndex &parent) const override;
+  virtual void fetchMore(const QModelIndex &parent) override;
 
   /** Drag and drop support */
   virtual Qt::ItemFlags flags(const QModelIndex &index) const override;
@@ -105,6 +115,13 @@ public:
    */
   QModelIndex CreateIndexFromItem(Item* item, int column = 0);
 
+  /**
+   * @brief Fetch the rows of every folder above `item` up to and including the row of `item` itself
+   *
+   * Used to make items found by a search appear without waiting for the view to scroll to them.
+   */
+  void FetchUpTo(Item* item);
+
   /**
    * @brief A QUndoCommand for moving an item from one folder to another folder
    */
@@ -211,9 +228,47 @@ private:
    */
   void MoveItemInternal(Item* item, Item* destination);
 
+  /**
+   * @brief Returns how many of a folder's children views have been told about
+   */
+  int FetchedRowCount(Item* folder) const;
+
+  /**
+   * @brief Returns TRUE if views know about an item's row and the rows of all of its parents
+   */
+  bool IsRowFetched(Item* item) const;
+
+  /**
+   * @brief Returns TRUE if views know about every child of a folder, meaning new children need rows inserting
+   */
+  bool IsFullyFetched(Item* folder) const;
+
+  /**
+   * @brief Drop fetch state and cached icons for an item and everything inside it once it leaves the model
+   */
+  void ForgetItem(Item* item);
+
+  /**
+   * @brief Returns the icon for an item, using a thumbnail for video footage once one has been generated
+   *
+   * Only called from data(), which views only call for rows being drawn, so thumbnails are only loaded for visible
+   * items.
+   */
+  QIcon GetItemIcon(Item* item) const;
+
   Project* project_;
 
   QVector<ColumnType> columns_;
+
+  /**
+   * @brief Number of rows fetched for each folder (see fetchMore())
+   */
+  QHash<Item*, int> fetched_rows_;
+
+  /**
+   * @brief Thumbnail icons that have already been loaded for footage
+   */
+  mutable QHash<Item*, QIcon> thumbnail_icons_;
 };
 
 #endif // VIEWMODEL_H
@@ -0,0 +1,151 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "projectviewsortmodel.h"
+
+ProjectViewSortModel::ProjectViewSortModel(QObject *parent) :
+  QSortFilterProxyModel(parent),
+  searching_(false)
+{
+  collator_.setNumericMode(true);
+  collator_.setCaseSensitivity(Qt::CaseInsensitive);
+
+  setSortCaseSensitivity(Qt::CaseInsensitive);
+}
+
+Item *ProjectViewSortModel::GetItemObjectFromIndex(const QModelIndex &index) const
+{
+  if (!index.isValid()) {
+    return nullptr;
+  }
+
+  return static_cast<Item*>(mapToSource(index).internalPointer());
+}
+
+void ProjectViewSortModel::setSourceModel(QAbstractItemModel *source)
+{
+  if (sourceModel() != nullptr) {
+    disconnect(sourceModel(), nullptr, this, nullptr);
+  }
+
+  ClearSortKeys();
+
+  QSortFilterProxyModel::setSourceModel(source);
+
+  if (source != nullptr) {
+    // Don't hold on to keys of items that are no longer in the model
+    connect(source,
+            SIGNAL(rowsAboutToBeRemoved(const QModelIndex&, int, int)),
+            this,
+            SLOT(SourceRowsAboutToBeRemoved(const QModelIndex&, int, int)));
+    connect(source, SIGNAL(modelReset()), this, SLOT(ClearSortKeys()));
+  }
+}
+
+bool ProjectViewSortModel::lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const
+{
+  Item* left = static_cast<Item*>(source_left.internalPointer());
+  Item* right = static_cast<Item*>(source_right.internalPointer());
+
+  // Folders always come first regardless of sort order
+  bool left_folder = left->CanHaveChildren();
+  bool right_folder = right->CanHaveChildren();
+
+  if (left_folder != right_folder) {
+    return (sortOrder() == Qt::AscendingOrder) ? left_folder : right_folder;
+  }
+
+  if (static_cast<ProjectViewModel::ColumnType>(source_left.column()) != ProjectViewModel::kName) {
+    return QSortFilterProxyModel::lessThan(source_left, source_right);
+  }
+
+  return GetSortKey(left).compare(GetSortKey(right)) < 0;
+}
+
+void ProjectViewSortModel::SetSearchResults(const QVector<Item *> &results)
+{
+  search_visible_.clear();
+  search_visible_.reserve(results.size());
+
+  foreach (Item* item, results) {
+    // Stop at the first folder that's already visible, everything above it is too
+    for (Item* i=item;i!=nullptr && !search_visible_.contains(i);i=i->parent()) {
+      search_visible_.insert(i);
+    }
+  }
+
+  searching_ = true;
+
+  invalidateFilter();
+}
+
+void ProjectViewSortModel::ClearSearch()
+{
+  if (!searching_) {
+    return;
+  }
+
+  searching_ = false;
+  search_visible_.clear();
+
+  invalidateFilter();
+}
+
+bool ProjectViewSortModel::IsSearching() const
+{
+  return searching_;
+}
+
+bool ProjectViewSortModel::filterAcceptsRow(int source_row, const QModelIndex &source_parent) const
+{
+  if (!searching_) {
+    return true;
+  }
+
+  QModelIndex index = sourceModel()->index(source_row, 0, source_parent);
+
+  return search_visible_.contains(static_cast<Item*>(index.internalPointer()));
+}
+
+const QCollatorSortKey &ProjectViewSortModel::GetSortKey(Item *item) const
+{
+  QHash<Item*, CachedSortKey>::iterator it = sort_keys_.find(item);
+
+  // Recalculate if the item has been renamed since the key was cached
+  if (it == sort_keys_.end() || it.value().first != item->name()) {
+    it = sort_keys_.insert(item, CachedSortKey(item->name(), collator_.sortKey(item->name())));
+  }
+
+  return it.value().second;
+}
+
+void ProjectViewSortModel::SourceRowsAboutToBeRemoved(const QModelIndex &parent, int first, int last)
+{
+  for (int i=first;i<=last;i++) {
+    QModelIndex index = sourceModel()->index(i, 0, parent);
+
+    sort_keys_.remove(static_cast<Item*>(index.internalPointer()));
+  }
+}
+
+void ProjectViewSortModel::ClearSortKeys()
+{
+  sort_keys_.clear();
+}
@@ -0,0 +1,104 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROJECTVIEWSORTMODEL_H
+#define PROJECTVIEWSORTMODEL_H
+
+#include <QCollator>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <QSortFilterProxyModel>
+#include <QVector>
+
+#include "projectviewmodel.h"
+
+/**
+ * @brief Sorts the rows of a ProjectViewModel
+ *
+ * Folders are always placed before other items. Names are compared "naturally" (e.g. "Clip 2" before "Clip 10") and
+ * each item's collation key is calculated once and cached, since sorting a large folder compares every name many
+ * times.
+ *
+ * Views should be given this model rather than the ProjectViewModel itself, mapping indexes with mapToSource() to
+ * get at the Item objects.
+ *
+ * While searching (see SetSearchResults()), only the results and the folders leading to them are shown.
+ */
+class ProjectViewSortModel : public QSortFilterProxyModel
+{
+  Q_OBJECT
+public:
+  ProjectViewSortModel(QObject* parent = nullptr);
+
+  /**
+   * @brief Returns the Item an index of this model refers to, or nullptr if the index is invalid
+   */
+  Item* GetItemObjectFromIndex(const QModelIndex& index) const;
+
+  virtual void setSourceModel(QAbstractItemModel *sourceModel) override;
+
+  /**
+   * @brief Only show `results` (e.g. from ProjectSearchIndex::Search()) and the folders they're in
+   *
+   * Results the source model hasn't fetched yet appear as it fetches them.
+   */
+  void SetSearchResults(const QVector<Item*>& results);
+
+  /**
+   * @brief Show every item again
+   */
+  void ClearSearch();
+
+  bool IsSearching() const;
+
+protected:
+  virtual bool lessThan(const QModelIndex &source_left, const QModelIndex &source_right) const override;
+
+  virtual bool filterAcceptsRow(int source_row, const QModelIndex &source_parent) const override;
+
+private:
+  /**
+   * @brief Returns the cached collation key of an item's name, calculating it if necessary
+   */
+  const QCollatorSortKey& GetSortKey(Item* item) const;
+
+  QCollator collator_;
+
+  /**
+   * @brief A collation key and the name it was calculated from
+   */
+  using CachedSortKey = QPair<QString, QCollatorSortKey>;
+
+  mutable QHash<Item*, CachedSortKey> sort_keys_;
+
+  bool searching_;
+
+  /// Search results and every folder above them
+  QSet<Item*> search_visible_;
+
+private slots:
+  void SourceRowsAboutToBeRemoved(const QModelIndex& parent, int first, int last);
+
+  void ClearSortKeys();
+
+};
+
+#endif // PROJECTVIEWSORTMODEL_H
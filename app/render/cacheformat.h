@@ -0,0 +1,63 @@
+#ifndef CACHEFORMAT_H
+#define CACHEFORMAT_H
+
+namespace olive {
+
+/**
+ * @brief How frames are stored in the renderer's disk cache
+ */
+enum CacheFormat {
+  /**
+   * Uncompressed pixels with a small header. Largest on disk but the fastest to write, and can be memory mapped
+   * straight into a texture upload when read back.
+   */
+  kCacheFormatRaw,
+
+  /**
+   * Lossless ZIP compressed OpenEXR. Considerably smaller than raw frames and still fairly quick to encode and decode.
+   */
+  kCacheFormatLossless,
+
+  /**
+   * Lossy DWAA compressed OpenEXR. The smallest on disk, but slow to encode and decode.
+   */
+  kCacheFormatEXR,
+
+  /**
+   * BC7 blocks compressed on the GPU before they're read back, and uploaded as they are when played back. A quarter
+   * the size of 8-bit raw frames, but lossy and clipped to 0.0-1.0, so only suited to previews. Needs a GPU that
+   * supports compute shaders and BPTC textures (see BlockCompressor::IsSupported()).
+   */
+  kCacheFormatBC7,
+
+  /**
+   * 10-bit YUV packed on the GPU before it's read back and unpacked in a shader when played back (see YUVPacker).
+   * 2.67 bytes per pixel for 4:2:2 and 2 for 4:2:0, lossy and clipped to 0.0-1.0 with no alpha, so only suited to
+   * offline previews for review. Works on any GPU.
+   */
+  kCacheFormatYUV422,
+  kCacheFormatYUV420
+};
+
+/**
+ * @brief Whether a Sequence's cache should favor render speed or disk space
+ */
+enum CachePriority {
+  kCachePrioritizeSpeed,
+  kCachePrioritizeBalanced,
+  kCachePrioritizeDiskSpace,
+
+  /**
+   * Favor the least data moving between the GPU, RAM and disk over image quality
+   */
+  kCachePrioritizeBandwidth,
+
+  /**
+   * Like kCachePrioritizeBandwidth, but with chroma subsampled YUV that holds up better for editorial review than BC7
+   */
+  kCachePrioritizeReview
+};
+
+}
+
+#endif // CACHEFORMAT_H
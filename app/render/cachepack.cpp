@@ -0,0 +1,562 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "cachepack.h"
+
+#include <algorithm>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+#include "config/config.h"
+
+/// Identifies the start of a record ("OPKR")
+const quint32 kRecordMagic = 0x4F504B52;
+
+/// Size of a record's header (magic, hash size, frame size and time written)
+const qint64 kRecordHeaderSize = static_cast<qint64>(2 * sizeof(quint32) + 2 * sizeof(qint64));
+
+/// Hashes are a fixed size in practice, anything much larger means the record is damaged
+const quint32 kMaximumHashSize = 256;
+
+QHash<QString, CachePack*> CachePack::instances_;
+QMutex CachePack::instances_lock_;
+
+CachePack::CachePack(const QString &dir, const QString &name) :
+  dir_(dir),
+  name_(name),
+  lock_file_(QDir(dir).filePath(QStringLiteral(".%1.lock").arg(name))),
+  owned_(false),
+  active_segment_(0),
+  writeback_start_(0),
+  compacting_segment_(-1)
+{
+  // The lock is held for the rest of the session, so it's only stale if the process that took it has exited
+  lock_file_.setStaleLockTime(0);
+
+  QMutexLocker locker(&lock_);
+
+  if (!TakeOwnership()) {
+    Load();
+  }
+}
+
+CachePack *CachePack::Get(const QString &dir, const QString &name)
+{
+  // There must only be one instance per pack however the directory is spelled, they'd overwrite each other's records
+  QString absolute_dir = QDir(dir).absolutePath();
+  QString key = QDir(absolute_dir).filePath(name);
+
+  QMutexLocker locker(&instances_lock_);
+
+  CachePack* pack = instances_.value(key);
+
+  if (!pack) {
+    // Packs are never freed, so pointers to them stay valid for the rest of the session
+    pack = new CachePack(absolute_dir, name);
+    instances_.insert(key, pack);
+  }
+
+  return pack;
+}
+
+CachePack *CachePack::ForFilename(const QString &filename, QByteArray *hash)
+{
+  QFileInfo info(filename);
+
+  *hash = QByteArray::fromHex(info.completeBaseName().toLatin1());
+
+  return Get(info.absolutePath(), info.suffix());
+}
+
+QList<QPair<QString, CachePack::Record> > CachePack::List(const QString &dir)
+{
+  QList<QPair<QString, Record> > frames;
+
+  QStringList filters;
+  filters.append(QStringLiteral("*.pack"));
+
+  QStringList segment_files = QDir(dir).entryList(filters, QDir::Files);
+  QStringList names;
+
+  foreach (const QString& fn, segment_files) {
+    // Segments are named "<name>-<number>.pack"
+    QString name = fn.left(fn.lastIndexOf('-'));
+
+    if (!name.isEmpty() && !names.contains(name)) {
+      names.append(name);
+    }
+  }
+
+  QDir cache_dir(dir);
+
+  foreach (const QString& name, names) {
+    CachePack* pack = Get(dir, name);
+
+    QMutexLocker locker(&pack->lock_);
+
+    QHash<QByteArray, Location>::const_iterator i;
+
+    for (i=pack->index_.constBegin();i!=pack->index_.constEnd();i++) {
+      QString filename = cache_dir.absoluteFilePath(QStringLiteral("%1.%2").arg(QString(i.key().toHex()), name));
+
+      frames.append(QPair<QString, Record>(filename, i->record));
+    }
+  }
+
+  return frames;
+}
+
+bool CachePack::IsSegmentFile(const QString &filename)
+{
+  return filename.endsWith(QStringLiteral(".pack"));
+}
+
+bool CachePack::IsOwned()
+{
+  QMutexLocker locker(&lock_);
+
+  return TakeOwnership();
+}
+
+bool CachePack::Write(const QByteArray &hash, const QByteArray &data)
+{
+  lock_.lock();
+
+  // Another process is appending to this pack
+  if (!TakeOwnership()) {
+    lock_.unlock();
+    return false;
+  }
+
+  // Frames are named by their content, so if this one is already here it's just as good
+  if (index_.contains(hash)) {
+    lock_.unlock();
+    return true;
+  }
+
+  Location location;
+
+  bool ok = Append(hash, data, QDateTime::currentMSecsSinceEpoch(), &location);
+
+  if (ok) {
+    index_.insert(hash, location);
+  }
+
+  lock_.unlock();
+
+  if (ok) {
+    Compact();
+  }
+
+  return ok;
+}
+
+bool CachePack::Read(const QByteArray &hash, QByteArray *data)
+{
+  // Compaction may move the frame between looking it up and reading it, in which case it's looked up again
+  for (int i=0;i<2;i++) {
+    lock_.lock();
+
+    QHash<QByteArray, Location>::const_iterator it = index_.constFind(hash);
+
+    if (it == index_.constEnd()) {
+      lock_.unlock();
+      return false;
+    }
+
+    Location location = *it;
+
+    lock_.unlock();
+
+    if (ReadAt(location, hash, data)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+qint64 CachePack::Size(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<QByteArray, Location>::const_iterator it = index_.constFind(hash);
+
+  if (it == index_.constEnd()) {
+    return -1;
+  }
+
+  return it->record.size;
+}
+
+void CachePack::Remove(const QByteArray &hash)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<QByteArray, Location>::iterator it = index_.find(hash);
+
+  if (it == index_.end()) {
+    return;
+  }
+
+  segments_[it->segment].live -= it->record.size;
+
+  index_.erase(it);
+}
+
+QList<QByteArray> CachePack::Hashes()
+{
+  QMutexLocker locker(&lock_);
+
+  return index_.keys();
+}
+
+bool CachePack::TakeOwnership()
+{
+  if (owned_) {
+    return true;
+  }
+
+  // Fails if the directory doesn't exist yet too, which is tried again once frames are written to it
+  if (!lock_file_.tryLock(0)) {
+    return false;
+  }
+
+  owned_ = true;
+
+  // The previous owner may have added, moved or left partially written records since this was loaded
+  index_.clear();
+  segments_.clear();
+  active_.close();
+  active_segment_ = 0;
+  writeback_start_ = 0;
+
+  Load();
+
+  return true;
+}
+
+void CachePack::Load()
+{
+  QStringList filters;
+  filters.append(QStringLiteral("%1-*.pack").arg(name_));
+
+  QStringList segment_files = QDir(dir_).entryList(filters, QDir::Files);
+
+  QList<int> segment_numbers;
+
+  foreach (const QString& fn, segment_files) {
+    bool ok;
+
+    int number = QFileInfo(fn).completeBaseName().mid(name_.size() + 1).toInt(&ok);
+
+    if (ok && number >= 0) {
+      segment_numbers.append(number);
+    }
+  }
+
+  std::sort(segment_numbers.begin(), segment_numbers.end());
+
+  foreach (int number, segment_numbers) {
+    QFile file(SegmentFilename(number));
+
+    if (!file.open(owned_ ? QFile::ReadWrite : QFile::ReadOnly)) {
+      qWarning() << "Failed to open cache pack segment" << file.fileName();
+      continue;
+    }
+
+    Segment segment = {0, 0};
+
+    qint64 file_size = file.size();
+
+    // Records are read sequentially, so this is one pass over the headers
+    while (segment.size + kRecordHeaderSize <= file_size) {
+      file.seek(segment.size);
+
+      QDataStream stream(&file);
+
+      quint32 magic, hash_size;
+      qint64 data_size, time;
+
+      stream >> magic >> hash_size >> data_size >> time;
+
+      if (stream.status() != QDataStream::Ok
+          || magic != kRecordMagic
+          || hash_size > kMaximumHashSize
+          || data_size < 0
+          || data_size > file_size
+          || segment.size + kRecordHeaderSize + hash_size + data_size > file_size) {
+        break;
+      }
+
+      Location location;
+
+      location.segment = number;
+      location.offset = segment.size;
+      location.record.hash = file.read(hash_size);
+      location.record.size = kRecordHeaderSize + hash_size + data_size;
+      location.record.time = time;
+
+      if (location.record.hash.size() != static_cast<int>(hash_size)) {
+        break;
+      }
+
+      // Frames appear more than once if they were written again after being removed or if compaction didn't get to
+      // delete the segment it copied them from, the latest copy is used
+      QHash<QByteArray, Location>::iterator existing = index_.find(location.record.hash);
+
+      if (existing != index_.end()) {
+        if (existing->segment == number) {
+          segment.live -= existing->record.size;
+        } else {
+          segments_[existing->segment].live -= existing->record.size;
+        }
+      }
+
+      index_.insert(location.record.hash, location);
+
+      segment.size += location.record.size;
+      segment.live += location.record.size;
+    }
+
+    if (owned_ && segment.size < file_size) {
+      // Anything after the last valid record was only partially written (e.g. the process was killed mid-write)
+      qWarning() << "Truncating damaged cache pack segment" << file.fileName();
+      file.resize(segment.size);
+    }
+
+    segments_.insert(number, segment);
+
+    active_segment_ = number;
+    writeback_start_ = segment.size;
+  }
+}
+
+QString CachePack::SegmentFilename(int segment) const
+{
+  return QDir(dir_).filePath(QStringLiteral("%1-%2.pack").arg(name_, QString::number(segment)));
+}
+
+bool CachePack::Append(const QByteArray &hash, const QByteArray &data, qint64 time, Location *location)
+{
+  qint64 record_size = kRecordHeaderSize + hash.size() + data.size();
+
+  Segment& active = segments_[active_segment_];
+
+  // Start a new segment once this one is full, compaction only ever works on segments before this one
+  if (active.size > 0 && active.size + record_size > kCachePackSegmentSize) {
+    if (active_.isOpen()) {
+      DropWrittenPages(active.size);
+    }
+
+    active_.close();
+    active_segment_++;
+    writeback_start_ = 0;
+
+    segments_.insert(active_segment_, {0, 0});
+  }
+
+  if (!active_.isOpen()) {
+    active_.setFileName(SegmentFilename(active_segment_));
+
+    if (!active_.open(QFile::WriteOnly | QFile::Append)) {
+      qWarning() << "Failed to open cache pack segment" << active_.fileName() << "for writing";
+      return false;
+    }
+  }
+
+  Segment& segment = segments_[active_segment_];
+
+  QByteArray header;
+  QDataStream stream(&header, QIODevice::WriteOnly);
+
+  stream << kRecordMagic
+         << static_cast<quint32>(hash.size())
+         << static_cast<qint64>(data.size())
+         << time;
+
+  bool ok = (active_.write(header) == header.size()
+             && active_.write(hash) == hash.size()
+             && active_.write(data) == data.size()
+             && active_.flush());
+
+  if (!ok) {
+    // Don't leave a partial record behind, it would hide every record after it from Load()
+    qWarning() << "Failed to write to cache pack segment" << active_.fileName();
+    active_.resize(segment.size);
+    return false;
+  }
+
+  location->segment = active_segment_;
+  location->offset = segment.size;
+  location->record.hash = hash;
+  location->record.size = record_size;
+  location->record.time = time;
+
+  DropWrittenPages(segment.size);
+  StartWriteBack(segment.size, record_size);
+
+  segment.size += record_size;
+  segment.live += record_size;
+
+  return true;
+}
+
+void CachePack::StartWriteBack(qint64 offset, qint64 size)
+{
+#ifdef Q_OS_LINUX
+  sync_file_range(active_.handle(), offset, size, SYNC_FILE_RANGE_WRITE);
+#else
+  Q_UNUSED(offset)
+  Q_UNUSED(size)
+#endif
+}
+
+void CachePack::DropWrittenPages(qint64 end)
+{
+#ifdef Q_OS_LINUX
+  if (end > writeback_start_) {
+    // Write-back of this range started when it was appended, so by now this rarely has to wait
+    sync_file_range(active_.handle(),
+                    writeback_start_,
+                    end - writeback_start_,
+                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    posix_fadvise(active_.handle(), writeback_start_, end - writeback_start_, POSIX_FADV_DONTNEED);
+  }
+#endif
+
+  writeback_start_ = end;
+}
+
+bool CachePack::ReadAt(const Location &location, const QByteArray &hash, QByteArray *data) const
+{
+  QFile file(SegmentFilename(location.segment));
+
+  if (!file.open(QFile::ReadOnly) || !file.seek(location.offset)) {
+    return false;
+  }
+
+  QDataStream stream(&file);
+
+  quint32 magic, hash_size;
+  qint64 data_size, time;
+
+  stream >> magic >> hash_size >> data_size >> time;
+
+  if (stream.status() != QDataStream::Ok
+      || magic != kRecordMagic
+      || kRecordHeaderSize + hash_size + data_size != location.record.size
+      || file.read(hash_size) != hash) {
+    return false;
+  }
+
+  data->resize(static_cast<int>(data_size));
+
+  bool ok = (file.read(data->data(), data_size) == data_size);
+
+#ifdef Q_OS_LINUX
+  // The frame goes into the memory cache once it's read, so keeping it in the page cache too would only push out media
+  posix_fadvise(file.handle(), location.offset, location.record.size, POSIX_FADV_DONTNEED);
+#endif
+
+  return ok;
+}
+
+void CachePack::Compact()
+{
+  lock_.lock();
+
+  // Only the owner moves records and deletes segments (Write() has already taken ownership)
+  if (!owned_ || compacting_segment_ != -1) {
+    lock_.unlock();
+    return;
+  }
+
+  QMap<int, Segment>::const_iterator it;
+
+  for (it=segments_.constBegin();it!=segments_.constEnd();it++) {
+    if (it.key() != active_segment_ && it->live * 2 < it->size) {
+      break;
+    }
+  }
+
+  if (it == segments_.constEnd()) {
+    lock_.unlock();
+    return;
+  }
+
+  compacting_segment_ = it.key();
+
+  QList<Location> remaining;
+
+  QHash<QByteArray, Location>::const_iterator i;
+
+  for (i=index_.constBegin();i!=index_.constEnd();i++) {
+    if (i->segment == compacting_segment_) {
+      remaining.append(*i);
+    }
+  }
+
+  lock_.unlock();
+
+  // Frames are copied one at a time so reads and writes of other frames can carry on in between
+  foreach (const Location& location, remaining) {
+    QByteArray data;
+
+    if (!ReadAt(location, location.record.hash, &data)) {
+      continue;
+    }
+
+    QMutexLocker locker(&lock_);
+
+    QHash<QByteArray, Location>::iterator current = index_.find(location.record.hash);
+
+    // Skip frames that were removed while copying
+    if (current == index_.end()
+        || current->segment != location.segment
+        || current->offset != location.offset) {
+      continue;
+    }
+
+    Location moved;
+
+    if (Append(location.record.hash, data, location.record.time, &moved)) {
+      segments_[location.segment].live -= location.record.size;
+      *current = moved;
+    }
+  }
+
+  lock_.lock();
+
+  // If this fails (e.g. a reader still has it open on Windows), the next compaction tries again
+  if (segments_.value(compacting_segment_).live == 0 && QFile::remove(SegmentFilename(compacting_segment_))) {
+    segments_.remove(compacting_segment_);
+  }
+
+  compacting_segment_ = -1;
+
+  lock_.unlock();
+}
@@ -0,0 +1,225 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef CACHEPACK_H
+#define CACHEPACK_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QLockFile>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+/**
+ * @brief Append-only storage for the frames of one render cache directory in a few large segment files
+ *
+ * Storing every frame as a file of its own means an hour of 60 fps is 216,000 files in one directory, which
+ * metadata-heavy filesystems (network shares especially) handle very badly. A pack instead appends frames to segment
+ * files of up to kCachePackSegmentSize bytes and keeps an index of where each frame is in memory, so writing and
+ * reading frames are large sequential I/Os on a handful of files. On Linux, frames are also kept out of the page cache
+ * once they're on disk so caching doesn't push out the media being decoded.
+ *
+ * Frames are identified by their hash and never change once written. Removed frames are only dropped from the index,
+ * their space is reclaimed by compaction: once less than half of an old segment is still in use, the frames left in
+ * it are copied to the end of the pack and the segment is deleted. Frames removed since the last compaction reappear
+ * if the pack is loaded again, which is harmless since they're still valid (DiskCacheManager just removes them again
+ * if the cache is over quota).
+ *
+ * Each pack is named so that frames of different formats (see RendererCacheCodec::GetExtension()) can share a
+ * directory. Only one process at a time may write to a pack, so the first to use it takes a lock file that it holds
+ * until it exits (see IsOwned()). Other Olive processes on the machine can still read the frames they found when
+ * loading it, but they write a file per frame instead, as shared render caches do (see HasSharedRenderCache()). This
+ * class is thread-safe.
+ */
+class CachePack
+{
+public:
+  struct Record {
+    QByteArray hash;
+
+    /// Size of the record on disk, including its header
+    qint64 size;
+
+    /// When the record was written (in milliseconds since epoch)
+    qint64 time;
+  };
+
+  /**
+   * @brief Returns the pack called `name` in `dir`
+   *
+   * Packs are loaded the first time they're used and stay loaded, so each directory's segments are only scanned once.
+   */
+  static CachePack* Get(const QString& dir, const QString& name);
+
+  /**
+   * @brief Returns the pack that `filename` (a frame in the render cache, see RendererCacheCodec) is stored in
+   *
+   * @param hash
+   *
+   * Set to the hash of the frame, which is the filename's base name in hex.
+   */
+  static CachePack* ForFilename(const QString& filename, QByteArray* hash);
+
+  /**
+   * @brief Returns every frame in every pack in `dir` as the filename it would've been stored as otherwise
+   */
+  static QList<QPair<QString, Record> > List(const QString& dir);
+
+  /**
+   * @brief Returns TRUE if `filename` is a segment file of a pack
+   */
+  static bool IsSegmentFile(const QString& filename);
+
+  /**
+   * @brief Returns TRUE if this process holds the pack's lock, so Write() can be used
+   *
+   * If another process held the lock when the pack was loaded, this tries to take it over again (e.g. because that
+   * process has exited since), reloading the pack if it succeeds.
+   */
+  bool IsOwned();
+
+  /**
+   * @brief Append a frame, does nothing if the pack already has a frame with this hash
+   *
+   * Fails if the pack isn't owned by this process (see IsOwned()).
+   */
+  bool Write(const QByteArray& hash, const QByteArray& data);
+
+  /**
+   * @brief Read a frame written with Write()
+   *
+   * @return TRUE on success, FALSE if the pack doesn't have this frame or it couldn't be read
+   */
+  bool Read(const QByteArray& hash, QByteArray* data);
+
+  /**
+   * @brief Returns the size of a frame's record on disk, or -1 if the pack doesn't have it
+   */
+  qint64 Size(const QByteArray& hash);
+
+  /**
+   * @brief Remove a frame so its space can be reclaimed by compaction
+   */
+  void Remove(const QByteArray& hash);
+
+  /**
+   * @brief Returns the hashes of every frame in the pack
+   */
+  QList<QByteArray> Hashes();
+
+private:
+  struct Location {
+    int segment;
+
+    /// Offset of the record's header in the segment
+    qint64 offset;
+
+    Record record;
+  };
+
+  struct Segment {
+    /// Size of the segment file
+    qint64 size;
+
+    /// Bytes of records the index still points to
+    qint64 live;
+  };
+
+  CachePack(const QString& dir, const QString& name);
+
+  /**
+   * @brief Fill the index from every record in every segment
+   *
+   * If this process owns the pack, anything that was only partially written is truncated. Otherwise the owner may be
+   * appending to it right now, so it's just left out.
+   */
+  void Load();
+
+  /**
+   * @brief Take the pack's lock if nobody else holds it, reloading the pack if it's newly taken, assumes lock_ is held
+   */
+  bool TakeOwnership();
+
+  QString SegmentFilename(int segment) const;
+
+  /**
+   * @brief Append a record to the active segment, assumes lock_ is held
+   */
+  bool Append(const QByteArray& hash, const QByteArray& data, qint64 time, Location* location);
+
+  /**
+   * @brief Have the OS start writing a record that was just appended to the active segment without waiting for it
+   */
+  void StartWriteBack(qint64 offset, qint64 size);
+
+  /**
+   * @brief Wait for the active segment to be written up to `end` and drop it from the page cache
+   *
+   * The cache writes far more than is ever read back from the page cache (frames being read go into the memory cache
+   * instead), so keeping it cached would only evict the media files being decoded.
+   */
+  void DropWrittenPages(qint64 end);
+
+  /**
+   * @brief Read a record's frame from its segment, doesn't need lock_ to be held
+   */
+  bool ReadAt(const Location& location, const QByteArray& hash, QByteArray* data) const;
+
+  /**
+   * @brief Copy the frames still in use out of the oldest mostly unused segment and delete it, if there is one
+   */
+  void Compact();
+
+  QString dir_;
+
+  QString name_;
+
+  /// Held by whichever process writes to the pack
+  QLockFile lock_file_;
+
+  /// Whether this process holds lock_file_
+  bool owned_;
+
+  QHash<QByteArray, Location> index_;
+
+  QMap<int, Segment> segments_;
+
+  /// The segment frames are appended to, always the last one
+  QFile active_;
+
+  int active_segment_;
+
+  /// Start of the active segment's range that may still be in the page cache
+  qint64 writeback_start_;
+
+  /// The segment Compact() is currently copying from, -1 if none
+  int compacting_segment_;
+
+  QMutex lock_;
+
+  static QHash<QString, CachePack*> instances_;
+
+  static QMutex instances_lock_;
+
+};
+
+#endif // CACHEPACK_H
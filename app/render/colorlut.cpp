@@ -0,0 +1,291 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "colorlut.h"
+
+#include <cmath>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+
+#include "common/define.h"
+#include "common/filefunctions.h"
+#include "config/config.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define OLIVE_LUT_SSE2
+#include <emmintrin.h>
+#elif defined(__aarch64__)
+#define OLIVE_LUT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const quint32 kLUTFileMagic = 0x54554c4f; // "OLUT"
+
+const int kLatticeEntries = kColorLUTEdgeSize * kColorLUTEdgeSize * kColorLUTEdgeSize;
+
+float Clamp01(float f)
+{
+  // Written so that NaN ends up as 0
+  return (f > 0.0f) ? ((f < 1.0f) ? f : 1.0f) : 0.0f;
+}
+
+/**
+ * @brief Blend four lattice entries as c0 * (1 - w1) + c1 * (w1 - w2) + c2 * (w2 - w3) + c3 * w3, writing RGB of `out`
+ */
+inline void BlendTetrahedron(const float* c0, const float* c1, const float* c2, const float* c3,
+                             float w1, float w2, float w3, float* out)
+{
+  float a = 1.0f - w1;
+  float b = w1 - w2;
+  float c = w2 - w3;
+
+#if defined(OLIVE_LUT_SSE2)
+  __m128 result = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c0), _mm_set1_ps(a)),
+                                        _mm_mul_ps(_mm_loadu_ps(c1), _mm_set1_ps(b))),
+                             _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c2), _mm_set1_ps(c)),
+                                        _mm_mul_ps(_mm_loadu_ps(c3), _mm_set1_ps(w3))));
+
+  alignas(16) float rgba[kRGBAChannels];
+  _mm_store_ps(rgba, result);
+#elif defined(OLIVE_LUT_NEON)
+  float32x4_t result = vmulq_n_f32(vld1q_f32(c0), a);
+  result = vmlaq_n_f32(result, vld1q_f32(c1), b);
+  result = vmlaq_n_f32(result, vld1q_f32(c2), c);
+  result = vmlaq_n_f32(result, vld1q_f32(c3), w3);
+
+  float rgba[kRGBAChannels];
+  vst1q_f32(rgba, result);
+#else
+  float rgba[kRGBAChannels];
+
+  for (int i=0;i<kRGBChannels;i++) {
+    rgba[i] = c0[i] * a + c1[i] * b + c2[i] * c + c3[i] * w3;
+  }
+#endif
+
+  for (int i=0;i<kRGBChannels;i++) {
+    out[i] = rgba[i];
+  }
+}
+
+}
+
+ColorLUT::ColorLUT() :
+  shaper_type_(kShaperUniform),
+  shaper_min_(0.0f),
+  shaper_max_(1.0f),
+  shaper_offset_(0.0f)
+{
+}
+
+ColorLUTPtr ColorLUT::Get(OCIO::ConstConfigRcPtr config, const char *source_space, OCIO::ConstProcessorRcPtr processor)
+{
+  ColorLUTPtr lut(new ColorLUT());
+
+  try {
+    OCIO::ConstColorSpaceRcPtr cs = config->getColorSpace(source_space);
+
+    if (cs) {
+      float vars[3] = {0.0f, 1.0f, 0.0f};
+      int var_count = qMin(cs->getAllocationNumVars(), 3);
+
+      if (var_count > 0) {
+        cs->getAllocationVars(vars);
+      }
+
+      if (var_count >= 2) {
+        lut->shaper_type_ = (cs->getAllocation() == OCIO::ALLOCATION_LG2) ? kShaperLog2 : kShaperUniform;
+        lut->shaper_min_ = vars[0];
+        lut->shaper_max_ = vars[1];
+        lut->shaper_offset_ = (var_count == 3) ? vars[2] : 0.0f;
+      }
+    }
+
+    // Key the cache on everything that affects the result
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArray(config->getCacheID()));
+    hash.addData(QByteArray(processor->getCpuCacheID()));
+    hash.addData(QString("%1:%2:%3:%4:%5").arg(QString::number(lut->shaper_type_),
+                                               QString::number(static_cast<double>(lut->shaper_min_)),
+                                               QString::number(static_cast<double>(lut->shaper_max_)),
+                                               QString::number(static_cast<double>(lut->shaper_offset_)),
+                                               QString::number(kColorLUTEdgeSize)).toUtf8());
+
+    QString filename = QDir(GetColorCacheLocation()).filePath(QString(hash.result().toHex()));
+
+    if (!lut->Load(filename)) {
+      lut->Bake(processor);
+      lut->Save(filename);
+    }
+  } catch (OCIO::Exception& exception) {
+    qWarning() << "Failed to bake OpenColorIO LUT:" << exception.what();
+    return nullptr;
+  }
+
+  return lut;
+}
+
+void ColorLUT::Apply(float *data, int pixel_count) const
+{
+  const int kEdgeMax = kColorLUTEdgeSize - 1;
+
+  // Offsets between neighboring lattice entries along each axis
+  const int kStep[kRGBChannels] = {
+    kRGBAChannels,
+    kRGBAChannels * kColorLUTEdgeSize,
+    kRGBAChannels * kColorLUTEdgeSize * kColorLUTEdgeSize
+  };
+
+  const float* lattice = lattice_.constData();
+
+  for (int i=0;i<pixel_count;i++) {
+    float* pixel = data + i * kRGBAChannels;
+
+    int base = 0;
+    float frac[kRGBChannels];
+
+    for (int j=0;j<kRGBChannels;j++) {
+      float pos = Clamp01(Shape(pixel[j])) * static_cast<float>(kEdgeMax);
+
+      // Keep the upper neighbor inside the lattice, the fraction becomes 1.0 at the top edge instead
+      int index = qMin(static_cast<int>(pos), kEdgeMax - 1);
+
+      frac[j] = pos - static_cast<float>(index);
+      base += index * kStep[j];
+    }
+
+    float fr = frac[0];
+    float fg = frac[1];
+    float fb = frac[2];
+
+    // Pick the tetrahedron containing the point by walking the axes from the largest fraction to the smallest
+    int first, second, third;
+    float w1, w2, w3;
+
+    if (fr >= fg) {
+      if (fg >= fb) {
+        first = 0; second = 1; third = 2; w1 = fr; w2 = fg; w3 = fb;
+      } else if (fr >= fb) {
+        first = 0; second = 2; third = 1; w1 = fr; w2 = fb; w3 = fg;
+      } else {
+        first = 2; second = 0; third = 1; w1 = fb; w2 = fr; w3 = fg;
+      }
+    } else {
+      if (fr >= fb) {
+        first = 1; second = 0; third = 2; w1 = fg; w2 = fr; w3 = fb;
+      } else if (fg >= fb) {
+        first = 1; second = 2; third = 0; w1 = fg; w2 = fb; w3 = fr;
+      } else {
+        first = 2; second = 1; third = 0; w1 = fb; w2 = fg; w3 = fr;
+      }
+    }
+
+    const float* c0 = lattice + base;
+    const float* c1 = c0 + kStep[first];
+    const float* c2 = c1 + kStep[second];
+    const float* c3 = c2 + kStep[third];
+
+    BlendTetrahedron(c0, c1, c2, c3, w1, w2, w3, pixel);
+  }
+}
+
+float ColorLUT::Shape(float value) const
+{
+  if (shaper_type_ == kShaperLog2) {
+    value = std::log2(qMax(value + shaper_offset_, 1e-10f));
+  }
+
+  return (value - shaper_min_) / (shaper_max_ - shaper_min_);
+}
+
+float ColorLUT::Unshape(float value) const
+{
+  value = shaper_min_ + value * (shaper_max_ - shaper_min_);
+
+  if (shaper_type_ == kShaperLog2) {
+    value = std::exp2(value) - shaper_offset_;
+  }
+
+  return value;
+}
+
+void ColorLUT::Bake(OCIO::ConstProcessorRcPtr processor)
+{
+  lattice_.resize(kLatticeEntries * kRGBAChannels);
+
+  float* entry = lattice_.data();
+
+  // Fill the lattice with its own input values and let the processor transform them in place
+  for (int b=0;b<kColorLUTEdgeSize;b++) {
+    for (int g=0;g<kColorLUTEdgeSize;g++) {
+      for (int r=0;r<kColorLUTEdgeSize;r++) {
+        entry[0] = Unshape(static_cast<float>(r) / static_cast<float>(kColorLUTEdgeSize - 1));
+        entry[1] = Unshape(static_cast<float>(g) / static_cast<float>(kColorLUTEdgeSize - 1));
+        entry[2] = Unshape(static_cast<float>(b) / static_cast<float>(kColorLUTEdgeSize - 1));
+        entry[3] = 1.0f;
+
+        entry += kRGBAChannels;
+      }
+    }
+  }
+
+  OCIO::PackedImageDesc img(lattice_.data(), kLatticeEntries, 1, kRGBAChannels);
+  processor->apply(img);
+}
+
+bool ColorLUT::Load(const QString &filename)
+{
+  QFile file(filename);
+
+  if (!file.open(QFile::ReadOnly)) {
+    return false;
+  }
+
+  quint32 magic;
+  qint64 lattice_size = kLatticeEntries * kRGBAChannels * static_cast<qint64>(sizeof(float));
+
+  if (file.size() != static_cast<qint64>(sizeof(magic)) + lattice_size
+      || file.read(reinterpret_cast<char*>(&magic), sizeof(magic)) != static_cast<qint64>(sizeof(magic))
+      || magic != kLUTFileMagic) {
+    return false;
+  }
+
+  lattice_.resize(kLatticeEntries * kRGBAChannels);
+
+  return file.read(reinterpret_cast<char*>(lattice_.data()), lattice_size) == lattice_size;
+}
+
+void ColorLUT::Save(const QString &filename) const
+{
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly)) {
+    qWarning() << "Failed to write LUT cache file" << filename;
+    return;
+  }
+
+  file.write(reinterpret_cast<const char*>(&kLUTFileMagic), sizeof(kLUTFileMagic));
+  file.write(reinterpret_cast<const char*>(lattice_.constData()),
+             kLatticeEntries * kRGBAChannels * static_cast<qint64>(sizeof(float)));
+}
@@ -0,0 +1,91 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef COLORLUT_H
+#define COLORLUT_H
+
+#include <memory>
+#include <OpenColorIO/OpenColorIO.h>
+#include <QVector>
+
+namespace OCIO = OCIO_NAMESPACE::v1;
+
+class ColorLUT;
+using ColorLUTPtr = std::shared_ptr<ColorLUT>;
+
+/**
+ * @brief An OCIO processor baked into a 1D shaper and a 3D LUT for fast CPU transforms
+ *
+ * Applying a baked LUT costs the same small amount per pixel regardless of how complex the processor is. The shaper
+ * comes from the source color space's allocation, the same way OCIO bakes LUTs for its own GPU path, so log and
+ * scene-linear sources are sampled sensibly. Values outside the allocation are clamped to it.
+ *
+ * A ColorLUT is immutable once created and can be used by any number of threads at once.
+ */
+class ColorLUT
+{
+public:
+  /**
+   * @brief Retrieve a baked LUT of `processor`, baking it only if it isn't in the disk cache already
+   *
+   * @param source_space
+   *
+   * The color space `processor` converts from, used to choose the shaper.
+   *
+   * @return The LUT or nullptr if it couldn't be baked.
+   */
+  static ColorLUTPtr Get(OCIO::ConstConfigRcPtr config, const char* source_space, OCIO::ConstProcessorRcPtr processor);
+
+  /**
+   * @brief Apply the LUT to `pixel_count` 32-bit float RGBA pixels, leaving alpha untouched
+   */
+  void Apply(float* data, int pixel_count) const;
+
+private:
+  ColorLUT();
+
+  enum ShaperType {
+    kShaperUniform,
+    kShaperLog2
+  };
+
+  float Shape(float value) const;
+
+  float Unshape(float value) const;
+
+  void Bake(OCIO::ConstProcessorRcPtr processor);
+
+  bool Load(const QString& filename);
+
+  void Save(const QString& filename) const;
+
+  ShaperType shaper_type_;
+
+  float shaper_min_;
+
+  float shaper_max_;
+
+  float shaper_offset_;
+
+  /// RGBA (alpha unused) lattice entries with red changing fastest, padded for aligned vector loads
+  QVector<float> lattice_;
+};
+
+#endif // COLORLUT_H
@@ -1,15 +1,45 @@
 #include "colorservice.h"
 
-#include <QFloat16>
+#include <QAtomicInt>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
 
 #include "common/define.h"
+#include "config/config.h"
+#include "pixelconversion.h"
+#include "pixelservice.h"
+#include "profiler.h"
 
-ColorService::ColorService(const char* source_space, const char* dest_space)
+// Small enough that the alpha and color passes over a band stay in cache, large enough to amortize OCIO's overhead
+const int kRowsPerBand = 16;
+
+QHash<QString, std::weak_ptr<ColorService> > ColorService::instances_;
+QMutex ColorService::instances_lock_;
+
+ColorService::ColorService(const char* source_space, const char* dest_space, const char* look)
 {
   OCIO::ConstConfigRcPtr config = OCIO::GetCurrentConfig();
 
-  processor = config->getProcessor(source_space,
-                                   dest_space);
+  if (look && *look) {
+    OCIO::LookTransformRcPtr transform = OCIO::LookTransform::Create();
+    transform->setSrc(source_space);
+    transform->setDst(dest_space);
+    transform->setLooks(look);
+
+    processor = config->getProcessor(transform);
+  } else {
+    processor = config->getProcessor(source_space,
+                                     dest_space);
+  }
+
+  noop_ = processor->isNoOp();
+
+  if (kUseBakedColorLUT && !noop_) {
+    baked_lut_ = ColorLUT::Get(config, source_space, processor);
+  }
 }
 
 void ColorService::Init()
@@ -23,6 +53,13 @@ void ColorService::Init()
   } catch (OCIO::Exception& exception) {
     qWarning() << "OpenColorIO Error:" << exception.what();
   }*/
+
+  // Parsing the config can take a while, so do it now rather than in the first viewer that needs it
+  try {
+    OCIO::GetCurrentConfig();
+  } catch (OCIO::Exception& exception) {
+    qWarning() << "OpenColorIO Error:" << exception.what();
+  }
 }
 
 ColorServicePtr ColorService::Create(const char *source_space, const char *dest_space)
@@ -30,11 +67,185 @@ ColorServicePtr ColorService::Create(const char *source_space, const char *dest_
   return std::make_shared<ColorService>(source_space, dest_space);
 }
 
+ColorServicePtr ColorService::Get(const char *source_space, const char *dest_space, const char *look)
+{
+  // Include the config so services from a previous config are never reused
+  QString key = QStringLiteral("%1\n%2\n%3\n%4").arg(OCIO::GetCurrentConfig()->getCacheID(),
+                                                      source_space,
+                                                      dest_space,
+                                                      look ? look : "");
+
+  QMutexLocker locker(&instances_lock_);
+
+  ColorServicePtr service = instances_.value(key).lock();
+
+  if (!service) {
+    service = std::make_shared<ColorService>(source_space, dest_space, look);
+    instances_.insert(key, service);
+  }
+
+  return service;
+}
+
+/**
+ * @brief A frame split into row bands that any number of threads can take from until none are left
+ *
+ * If the source and destination are the same 32F frame, bands are processed in place. Otherwise each band is converted
+ * to 32F in a buffer belonging to the thread, processed there and converted to the destination's format (which may be
+ * the source again, so e.g. a half-float frame is converted in place without ever existing as 32F as a whole).
+ */
+class ColorService::BandJob
+{
+public:
+  BandJob(ColorService* service, FramePtr src, FramePtr dst, AlphaAction before, AlphaAction after) :
+    service_(service),
+    src_(src->data()),
+    src_linesize_(src->linesize()),
+    src_format_(static_cast<olive::PixelFormat>(src->format())),
+    dst_(dst->data()),
+    dst_format_(static_cast<olive::PixelFormat>(dst->format())),
+    width_(src->width()),
+    height_(src->height()),
+    before_(before),
+    after_(after)
+  {
+  }
+
+  int band_count() const
+  {
+    return (height_ + kRowsPerBand - 1) / kRowsPerBand;
+  }
+
+  void Run()
+  {
+    bool in_place = (src_ == dst_ && dst_format_ == olive::PIX_FMT_RGBA32F);
+    int dst_row_size = PixelService::BytesPerPixel(dst_format_) * width_;
+
+    QVector<float> buffer;
+    int band;
+
+    while ((band = next_band_.fetchAndAddOrdered(1)) < band_count()) {
+      int row = band * kRowsPerBand;
+      int row_count = qMin(kRowsPerBand, height_ - row);
+      int channel_count = row_count * width_ * kRGBAChannels;
+
+      float* band_data;
+
+      if (in_place) {
+        band_data = reinterpret_cast<float*>(dst_ + row * dst_row_size);
+      } else {
+        buffer.resize(channel_count);
+        band_data = buffer.data();
+
+        // The source may be a region of a larger frame, so its lines aren't necessarily contiguous
+        int row_channels = width_ * kRGBAChannels;
+
+        for (int i=0;i<row_count;i++) {
+          olive::pixel::ToFloat(src_ + (row + i) * src_linesize_,
+                                src_format_,
+                                band_data + i * row_channels,
+                                row_channels);
+        }
+      }
+
+      service_->ConvertBand(band_data, width_, row_count, before_, after_);
+
+      if (!in_place) {
+        olive::pixel::FromFloat(band_data, dst_ + row * dst_row_size, dst_format_, channel_count);
+      }
+    }
+  }
+
+  QSemaphore& finished_workers()
+  {
+    return finished_workers_;
+  }
+
+private:
+  ColorService* service_;
+
+  const uint8_t* src_;
+
+  int src_linesize_;
+
+  olive::PixelFormat src_format_;
+
+  uint8_t* dst_;
+
+  olive::PixelFormat dst_format_;
+
+  int width_;
+
+  int height_;
+
+  AlphaAction before_;
+
+  AlphaAction after_;
+
+  QAtomicInt next_band_;
+
+  QSemaphore finished_workers_;
+};
+
+/**
+ * @brief Helps a BandJob on the shared color thread pool
+ */
+class ColorService::BandWorker : public QRunnable
+{
+public:
+  BandWorker(BandJob* job) :
+    job_(job)
+  {
+  }
+
+  virtual void run() override
+  {
+    job_->Run();
+
+    // The job may be destroyed as soon as this is released
+    job_->finished_workers().release();
+  }
+
+private:
+  BandJob* job_;
+};
+
 void ColorService::ConvertFrame(FramePtr f)
 {
-  OCIO::PackedImageDesc img(reinterpret_cast<float*>(f->data()), f->width(), f->height(), kRGBAChannels);
+  if (noop_) {
+    return;
+  }
+
+  ConvertFrameInternal(f, f, kNoAlphaAction, kNoAlphaAction);
+}
+
+FramePtr ColorService::ConvertFrameAndAssociateAlpha(FramePtr f, const olive::PixelFormat &dest_format, bool alpha_is_associated)
+{
+  // Disassociating and reassociating around an identity transform cancel out
+  if (noop_ && alpha_is_associated && f->format() == dest_format) {
+    return f;
+  }
+
+  FramePtr converted = Frame::Create();
 
-  processor->apply(img);
+  // Copy parameters
+  converted->set_width(f->width());
+  converted->set_height(f->height());
+  converted->set_timestamp(f->timestamp());
+  converted->set_format(dest_format);
+  converted->allocate();
+
+  if (alpha_is_associated) {
+    if (noop_) {
+      ConvertFrameInternal(f, converted, kNoAlphaAction, kNoAlphaAction);
+    } else {
+      ConvertFrameInternal(f, converted, kDisassociate, kReassociate);
+    }
+  } else {
+    ConvertFrameInternal(f, converted, kNoAlphaAction, kAssociate);
+  }
+
+  return converted;
 }
 
 void ColorService::DisassociateAlpha(FramePtr f)
@@ -59,44 +270,94 @@ OpenColorIO::v1::ConstProcessorRcPtr ColorService::GetProcessor()
 
 void ColorService::AssociateAlphaPixFmtFilter(ColorService::AlphaAction action, FramePtr f)
 {
-  int pixel_count = f->width() * f->height() * kRGBAChannels;
+  olive::PixelFormat format = static_cast<olive::PixelFormat>(f->format());
 
-  switch (static_cast<olive::PixelFormat>(f->format())) {
-  case olive::PIX_FMT_INVALID:
-  case olive::PIX_FMT_COUNT:
+  if (format == olive::PIX_FMT_INVALID || format == olive::PIX_FMT_COUNT) {
     qWarning() << "Alpha association functions received an invalid pixel format";
-    break;
-  case olive::PIX_FMT_RGBA8:
-  case olive::PIX_FMT_RGBA16U:
-    qWarning() << "Alpha association functions only works on float-based pixel formats at this time";
-    break;
-  case olive::PIX_FMT_RGBA16F:
-  {
-    AssociateAlphaInternal<qfloat16>(action, reinterpret_cast<qfloat16*>(f->data()), pixel_count);
-    break;
+    return;
   }
-  case olive::PIX_FMT_RGBA32F:
-  {
-    AssociateAlphaInternal<float>(action, reinterpret_cast<float*>(f->data()), pixel_count);
-    break;
+
+  int pixel_count = f->width() * f->height();
+
+  if (format == olive::PIX_FMT_RGBA32F) {
+    AssociateAlphaInternal(action, reinterpret_cast<float*>(f->data()), pixel_count);
+    return;
   }
+
+  // Other formats are processed in place through a small float buffer rather than converted as a whole frame
+  const int kChunkPixels = 1024;
+  float buffer[kChunkPixels * kRGBAChannels];
+
+  int pixel_size = PixelService::BytesPerPixel(format);
+
+  for (int i=0;i<pixel_count;i+=kChunkPixels) {
+    int count = qMin(kChunkPixels, pixel_count - i);
+    uint8_t* chunk = f->data() + i * pixel_size;
+
+    olive::pixel::ToFloat(chunk, format, buffer, count * kRGBAChannels);
+    AssociateAlphaInternal(action, buffer, count);
+    olive::pixel::FromFloat(buffer, chunk, format, count * kRGBAChannels);
   }
 }
 
-template<typename T>
-void ColorService::AssociateAlphaInternal(ColorService::AlphaAction action, T *data, int pix_count)
+void ColorService::ConvertFrameInternal(FramePtr src, FramePtr dst, AlphaAction before, AlphaAction after)
 {
-  for (int i=0;i<pix_count;i+=kRGBAChannels) {
-    T alpha = data[i+kRGBChannels];
+  ProfilerTimer timer(Profiler::kColorConvert);
 
-    if (action == kAssociate || alpha > 0) {
-      for (int j=0;j<kRGBChannels;j++) {
-        if (action == kDisassociate) {
-          data[i+j] /= alpha;
-        } else {
-          data[i+j] *= alpha;
-        }
-      }
+  // Shared by every ColorService so concurrent frames don't oversubscribe the CPU
+  static QThreadPool pool;
+
+  BandJob job(this, src, dst, before, after);
+
+  // Only use threads that are free right now, this thread does whatever work is left over
+  int workers = 0;
+
+  for (int i=1;i<job.band_count() && i<QThread::idealThreadCount();i++) {
+    BandWorker* worker = new BandWorker(&job);
+
+    if (!pool.tryStart(worker)) {
+      delete worker;
+      break;
     }
+
+    workers++;
+  }
+
+  job.Run();
+
+  job.finished_workers().acquire(workers);
+}
+
+void ColorService::ConvertBand(float *data, int width, int height, AlphaAction before, AlphaAction after)
+{
+  int pixel_count = width * height;
+
+  AssociateAlphaInternal(before, data, pixel_count);
+
+  if (baked_lut_) {
+    baked_lut_->Apply(data, pixel_count);
+  } else if (!noop_) {
+    // OCIO processors are safe to apply from multiple threads at once
+    OCIO::PackedImageDesc img(data, width, height, kRGBAChannels);
+    processor->apply(img);
+  }
+
+  AssociateAlphaInternal(after, data, pixel_count);
+}
+
+void ColorService::AssociateAlphaInternal(ColorService::AlphaAction action, float *data, int pixel_count)
+{
+  switch (action) {
+  case kNoAlphaAction:
+    break;
+  case kAssociate:
+    olive::pixel::MultiplyAlpha(data, pixel_count, false);
+    break;
+  case kDisassociate:
+    olive::pixel::DivideAlpha(data, pixel_count);
+    break;
+  case kReassociate:
+    olive::pixel::MultiplyAlpha(data, pixel_count, true);
+    break;
   }
 }
@@ -2,9 +2,12 @@
 #define COLORSERVICE_H
 
 #include <memory>
+#include <QHash>
+#include <QMutex>
 #include <OpenColorIO/OpenColorIO.h>
 namespace OCIO = OCIO_NAMESPACE::v1;
 
+#include "colorlut.h"
 #include "decoder/frame.h"
 #include "render/gl/shadergenerators.h"
 
@@ -14,14 +17,43 @@ using ColorServicePtr = std::shared_ptr<ColorService>;
 class ColorService
 {
 public:
-  ColorService(const char *source_space, const char *dest_space);
+  ColorService(const char *source_space, const char *dest_space, const char *look = nullptr);
 
+  /**
+   * @brief Load the OCIO config, safe to call from any thread
+   */
   static void Init();
 
   static ColorServicePtr Create(const char *source_space, const char *dest_space);
 
+  /**
+   * @brief Retrieve the ColorService for this conversion, shared with everything else currently using it
+   *
+   * Creating an OCIO processor (and baking its LUT) is slow and clips tend to share a handful of color spaces, so this
+   * should be preferred over creating a ColorService directly. ColorServices are thread-safe to share.
+   *
+   * @param look
+   *
+   * Optional OCIO look(s) to apply between the two spaces.
+   */
+  static ColorServicePtr Get(const char *source_space, const char *dest_space, const char *look = nullptr);
+
   void ConvertFrame(FramePtr f);
 
+  /**
+   * @brief Convert a frame of any format into a new frame of `dest_format` with associated alpha
+   *
+   * Equivalent to converting to 32F, disassociating (if `alpha_is_associated`), ConvertFrame(), associating or
+   * reassociating, and converting to `dest_format`, but done in a single pass over the frame. 32F only exists per band
+   * while OCIO runs, so working in RGBA16F keeps half-float's precision (11 significant bits, ~3 decimal digits, with
+   * range up to 65504) while halving bandwidth and memory compared to 32F.
+   *
+   * `f` is left untouched, so frames still held by a decoder's cache are safe to pass. If the transform does nothing
+   * (e.g. a linear EXR already in the reference space), `alpha_is_associated` and `f` is already `dest_format`, `f` is
+   * returned as-is since there's nothing to convert. Otherwise an identity transform only converts the format.
+   */
+  FramePtr ConvertFrameAndAssociateAlpha(FramePtr f, const olive::PixelFormat& dest_format, bool alpha_is_associated);
+
   static void DisassociateAlpha(FramePtr f);
 
   static void AssociateAlpha(FramePtr f);
@@ -33,16 +65,35 @@ public:
 private:
   OCIO::ConstProcessorRcPtr processor;
 
+  /// Baked version of `processor` used instead of it on the CPU if kUseBakedColorLUT is set
+  ColorLUTPtr baked_lut_;
+
+  /// TRUE if `processor` leaves colors as they are, in which case it's never applied
+  bool noop_;
+
+  /// Services handed out by Get(), held weakly so unused ones are freed
+  static QHash<QString, std::weak_ptr<ColorService> > instances_;
+
+  static QMutex instances_lock_;
+
   enum AlphaAction {
+    kNoAlphaAction,
     kAssociate,
     kDisassociate,
     kReassociate
   };
 
+  class BandJob;
+
+  class BandWorker;
+
+  void ConvertFrameInternal(FramePtr src, FramePtr dst, AlphaAction before, AlphaAction after);
+
+  void ConvertBand(float* data, int width, int height, AlphaAction before, AlphaAction after);
+
   static void AssociateAlphaPixFmtFilter(AlphaAction action, FramePtr f);
 
-  template<typename T>
-  static void AssociateAlphaInternal(AlphaAction action, T* data, int pix_count);
+  static void AssociateAlphaInternal(AlphaAction action, float* data, int pixel_count);
 };
 
 #endif // COLORSERVICE_H
@@ -0,0 +1,239 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "diskcachemanager.h"
+
+#include <QDateTime>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+
+#include "cachepack.h"
+#include "common/filefunctions.h"
+#include "config/config.h"
+
+DiskCacheManager olive::disk_cache_manager;
+
+DiskCacheManager::DiskCacheManager() :
+  quota_(kDiskCacheQuota),
+  size_(0),
+  bytes_written_(0)
+{
+}
+
+void DiskCacheManager::Init()
+{
+  lock_.lock();
+
+  entries_.clear();
+  access_order_.clear();
+  size_ = 0;
+
+  lock_.unlock();
+
+  // Scanning can take a while on a large cache, so frames are still tracked by Add() in the meantime
+  QList<QPair<QString, Entry> > scanned;
+
+  QDirIterator it(GetRenderCacheLocation(), QDir::Files, QDirIterator::Subdirectories);
+
+  QStringList pack_dirs;
+
+  while (it.hasNext()) {
+    it.next();
+
+    QFileInfo info = it.fileInfo();
+
+    // Packs are tracked by the frames in them rather than by their segment files
+    if (CachePack::IsSegmentFile(info.fileName())) {
+      if (!pack_dirs.contains(info.absolutePath())) {
+        pack_dirs.append(info.absolutePath());
+      }
+
+      continue;
+    }
+
+    // Files are never modified after being written, so the modified time works as the last access time of a new session
+    Entry entry = {info.size(), info.lastModified().toMSecsSinceEpoch(), false};
+
+    scanned.append({info.absoluteFilePath(), entry});
+  }
+
+  foreach (const QString& dir, pack_dirs) {
+    QList<QPair<QString, CachePack::Record> > frames = CachePack::List(dir);
+
+    for (int i=0;i<frames.size();i++) {
+      Entry entry = {frames.at(i).second.size, frames.at(i).second.time, true};
+
+      scanned.append({frames.at(i).first, entry});
+    }
+  }
+
+  QStringList evicted;
+
+  lock_.lock();
+
+  for (int i=0;i<scanned.size();i++) {
+    // Frames added while we were scanning are already tracked with a newer access time
+    if (!entries_.contains(scanned.at(i).first)) {
+      Insert(scanned.at(i).first, scanned.at(i).second);
+    }
+  }
+
+  Trim(&evicted);
+
+  lock_.unlock();
+
+  EmitEvicted(evicted);
+}
+
+void DiskCacheManager::SetQuota(const qint64 &quota)
+{
+  QStringList evicted;
+
+  lock_.lock();
+
+  quota_ = quota;
+
+  Trim(&evicted);
+
+  lock_.unlock();
+
+  EmitEvicted(evicted);
+}
+
+qint64 DiskCacheManager::quota()
+{
+  QMutexLocker locker(&lock_);
+
+  return quota_;
+}
+
+void DiskCacheManager::Add(const QString &filename)
+{
+  QFileInfo info(filename);
+
+  Entry entry = {info.size(), QDateTime::currentMSecsSinceEpoch(), false};
+
+  if (!info.exists()) {
+    // Frames that aren't files of their own were written to a pack (see RendererCacheCodec::Write())
+    QByteArray hash;
+
+    entry.size = CachePack::ForFilename(filename, &hash)->Size(hash);
+    entry.packed = true;
+
+    if (entry.size < 0) {
+      return;
+    }
+  }
+
+  QStringList evicted;
+
+  lock_.lock();
+
+  QString path = info.absoluteFilePath();
+
+  if (entries_.contains(path)) {
+    Entry old = entries_.take(path);
+
+    access_order_.remove(old.last_access, path);
+    size_ -= old.size;
+  }
+
+  Insert(path, entry);
+  bytes_written_ += entry.size;
+
+  Trim(&evicted);
+
+  lock_.unlock();
+
+  EmitEvicted(evicted);
+}
+
+qint64 DiskCacheManager::size()
+{
+  QMutexLocker locker(&lock_);
+
+  return size_;
+}
+
+qint64 DiskCacheManager::bytes_written()
+{
+  QMutexLocker locker(&lock_);
+
+  return bytes_written_;
+}
+
+void DiskCacheManager::Touch(const QString &filename)
+{
+  QString path = QFileInfo(filename).absoluteFilePath();
+
+  QMutexLocker locker(&lock_);
+
+  QHash<QString, Entry>::iterator it = entries_.find(path);
+
+  if (it == entries_.end()) {
+    return;
+  }
+
+  access_order_.remove(it->last_access, path);
+
+  it->last_access = QDateTime::currentMSecsSinceEpoch();
+
+  access_order_.insert(it->last_access, path);
+}
+
+void DiskCacheManager::Trim(QStringList *evicted)
+{
+  while (size_ > quota_ && !access_order_.isEmpty()) {
+    QMultiMap<qint64, QString>::iterator oldest = access_order_.begin();
+
+    QString path = oldest.value();
+
+    access_order_.erase(oldest);
+
+    Entry entry = entries_.take(path);
+
+    size_ -= entry.size;
+
+    if (entry.packed) {
+      QByteArray hash;
+
+      CachePack::ForFilename(path, &hash)->Remove(hash);
+    } else {
+      QFile::remove(path);
+    }
+
+    evicted->append(path);
+  }
+}
+
+void DiskCacheManager::Insert(const QString &path, const Entry &entry)
+{
+  entries_.insert(path, entry);
+  access_order_.insert(entry.last_access, path);
+  size_ += entry.size;
+}
+
+void DiskCacheManager::EmitEvicted(const QStringList &evicted)
+{
+  foreach (const QString& path, evicted) {
+    emit FileEvicted(path);
+  }
+}
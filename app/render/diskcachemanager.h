@@ -0,0 +1,133 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef DISKCACHEMANAGER_H
+#define DISKCACHEMANAGER_H
+
+#include <QHash>
+#include <QMap>
+#include <QMutex>
+#include <QObject>
+#include <QStringList>
+
+/**
+ * @brief Keeps the render cache on disk within a size quota
+ *
+ * Every frame in GetRenderCacheLocation(), whether a file of its own or in a CachePack, is tracked along with its size
+ * and when it was last used. When the total size exceeds the quota, the least recently used frames are deleted. Frames
+ * are named by their hash and stored in a directory per set of render parameters, so they're shared between Sequences
+ * and reused in later sessions.
+ *
+ * Only metadata is kept, so rebuilding it on startup with Init() is a single directory scan plus reading the record
+ * headers of each pack. This class is thread-safe.
+ */
+class DiskCacheManager : public QObject
+{
+  Q_OBJECT
+public:
+  DiskCacheManager();
+
+  /**
+   * @brief Scan the render cache and evict frames if it's already over quota
+   *
+   * The scan doesn't hold up the other functions, so this can be run in the background while frames are added.
+   */
+  void Init();
+
+  /**
+   * @brief Set the maximum size of the render cache in bytes
+   */
+  void SetQuota(const qint64& quota);
+
+  /**
+   * @brief Returns the maximum size of the render cache in bytes
+   */
+  qint64 quota();
+
+  /**
+   * @brief Start tracking a frame that was just written, evicting older frames if necessary
+   */
+  void Add(const QString& filename);
+
+  /**
+   * @brief Mark a frame as recently used so it isn't evicted before older ones
+   */
+  void Touch(const QString& filename);
+
+  /**
+   * @brief Returns the current size of the render cache in bytes
+   */
+  qint64 size();
+
+  /**
+   * @brief Returns the total size of every frame passed to Add() this session
+   */
+  qint64 bytes_written();
+
+signals:
+  /**
+   * @brief Emitted when a frame is deleted from disk to stay within the quota
+   */
+  void FileEvicted(const QString& filename);
+
+private:
+  struct Entry {
+    qint64 size;
+    qint64 last_access;
+
+    /// TRUE if the frame is in a CachePack rather than a file of its own
+    bool packed;
+  };
+
+  /**
+   * @brief Start tracking a frame, assumes lock_ is already held and that it isn't tracked yet
+   */
+  void Insert(const QString& path, const Entry& entry);
+
+  /**
+   * @brief Evict least recently used frames until the cache is within quota
+   *
+   * Assumes lock_ is already held. Deleted files are appended to `evicted` so FileEvicted() can be emitted once the
+   * lock is released.
+   */
+  void Trim(QStringList* evicted);
+
+  void EmitEvicted(const QStringList& evicted);
+
+  qint64 quota_;
+
+  qint64 size_;
+
+  qint64 bytes_written_;
+
+  QHash<QString, Entry> entries_;
+
+  /// Filenames ordered by last access time
+  QMultiMap<qint64, QString> access_order_;
+
+  QMutex lock_;
+
+};
+
+namespace olive {
+extern DiskCacheManager disk_cache_manager;
+}
+
+#endif // DISKCACHEMANAGER_H
@@ -0,0 +1,257 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "frameserver.h"
+
+#include <cstring>
+#include <QDateTime>
+#include <QDebug>
+
+#include "config/config.h"
+#include "render/pixelservice.h"
+
+/**
+ * @brief Version of the shared memory layout, bump whenever FrameServerHeader or FrameServerSlot change
+ */
+const quint32 kFrameServerVersion = 1;
+
+/**
+ * @brief How many generations CreateFrames() skips past if their segments are still held by consumers
+ */
+const int kFrameServerCreateAttempts = 16;
+
+/**
+ * @brief Parameters of the thread's RenderInstance, which is only used for its context
+ *
+ * RendererThreadBase keeps references to these, so they have to outlive the thread.
+ */
+const int kFrameServerInstanceSize = 1;
+const int kFrameServerInstanceDivider = 1;
+const olive::PixelFormat kFrameServerInstanceFormat = olive::PIX_FMT_RGBA8;
+const olive::RenderMode kFrameServerInstanceMode = olive::RenderMode::kOnline;
+
+FrameServer::FrameServer(QOpenGLContext *share_ctx, const QString &name) :
+  RendererThreadBase(share_ctx,
+                     kFrameServerInstanceSize,
+                     kFrameServerInstanceSize,
+                     kFrameServerInstanceDivider,
+                     kFrameServerInstanceFormat,
+                     kFrameServerInstanceMode),
+  name_(name),
+  cancelled_(false),
+  sequence_(0),
+  warned_(false)
+{
+}
+
+void FrameServer::SetTexture(RenderTexturePtr texture)
+{
+  if (texture == nullptr) {
+    return;
+  }
+
+  latest_lock_.lock();
+  latest_ = texture;
+  wait_cond_.wakeAll();
+  latest_lock_.unlock();
+}
+
+void FrameServer::Cancel()
+{
+  cancelled_ = true;
+
+  latest_lock_.lock();
+  wait_cond_.wakeAll();
+  latest_lock_.unlock();
+
+  wait();
+}
+
+void FrameServer::ProcessLoop()
+{
+  if (!CreateControl()) {
+    qWarning() << "Failed to create frame server" << name_ << "-" << control_.errorString();
+    return;
+  }
+
+  qInfo() << "Publishing frames to shared memory as" << name_;
+
+  DownloadRing ring(render_instance()->context(), kDownloadBufferCount);
+
+  while (!cancelled_) {
+    latest_lock_.lock();
+
+    // Only sleep if there's nothing to finish off either
+    if (latest_ == nullptr && ring.IsEmpty() && !cancelled_) {
+      wait_cond_.wait(&latest_lock_);
+    }
+
+    RenderTexturePtr texture = latest_;
+    latest_ = nullptr;
+
+    latest_lock_.unlock();
+
+    if (texture != nullptr) {
+      if (ring.IsFull()) {
+        FinishReadback(&ring);
+      }
+
+      ring.Start(texture);
+      pending_.append(texture);
+
+      // Publish any that have already finished without waiting on the others
+      while (!ring.IsEmpty() && ring.IsOldestReady()) {
+        FinishReadback(&ring);
+      }
+    } else if (!ring.IsEmpty()) {
+      // Nothing new to start, so wait on the oldest readback
+      FinishReadback(&ring);
+    }
+  }
+
+  pending_.clear();
+
+  header()->running = 0;
+
+  frames_.detach();
+  control_.detach();
+}
+
+bool FrameServer::CreateControl()
+{
+  control_.setNativeKey(name_);
+
+  // A segment left behind by a server that crashed is taken over
+  if (!control_.create(sizeof(FrameServerHeader)) && !control_.attach()) {
+    return false;
+  }
+
+  if (control_.size() < static_cast<int>(sizeof(FrameServerHeader))) {
+    control_.detach();
+    return false;
+  }
+
+  FrameServerHeader* h = header();
+
+  // Carry on from a previous server's generation, so its consumers notice the new frames and re-attach
+  quint32 generation = (memcmp(h->magic, "OLVFRAME", 8) == 0) ? h->generation : 0;
+
+  h->latest_sequence = 0;
+  h->slot_count = 0;
+  h->slot_size = 0;
+  h->generation = generation;
+  h->version = kFrameServerVersion;
+  memcpy(h->magic, "OLVFRAME", 8);
+  h->running = 1;
+
+  return true;
+}
+
+bool FrameServer::CreateFrames(int size)
+{
+  FrameServerHeader* h = header();
+
+  // Stop consumers reading the old segment before it goes
+  h->latest_sequence = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+
+  frames_.detach();
+
+  int slot_size = static_cast<int>(sizeof(FrameServerSlot)) + size;
+  quint32 generation = h->generation;
+
+  for (int i=0;i<kFrameServerCreateAttempts;i++) {
+    generation++;
+
+    frames_.setNativeKey(QStringLiteral("%1.%2").arg(name_, QString::number(generation)));
+
+    if (frames_.create(slot_size * kFrameServerSlotCount)) {
+      memset(frames_.data(), 0, static_cast<size_t>(frames_.size()));
+
+      h->slot_count = kFrameServerSlotCount;
+      h->slot_size = static_cast<quint64>(slot_size);
+      std::atomic_thread_fence(std::memory_order_release);
+      h->generation = generation;
+
+      return true;
+    }
+
+    // Anything but a segment a consumer still holds on to won't go away by trying another name
+    if (frames_.error() != QSharedMemory::AlreadyExists) {
+      break;
+    }
+  }
+
+  return false;
+}
+
+void FrameServer::FinishReadback(DownloadRing *ring)
+{
+  RenderTexturePtr texture = pending_.takeFirst();
+
+  QByteArray pixels = ring->Finish();
+
+  if (pixels.isEmpty()) {
+    return;
+  }
+
+  FrameServerHeader* h = header();
+
+  if (!frames_.isAttached()
+      || static_cast<quint64>(pixels.size()) > h->slot_size - sizeof(FrameServerSlot)) {
+    if (!CreateFrames(pixels.size())) {
+      if (!warned_) {
+        qWarning() << "Frame server" << name_ << "failed to publish a frame -" << frames_.errorString();
+        warned_ = true;
+      }
+      return;
+    }
+  }
+
+  sequence_++;
+
+  char* slot_data = static_cast<char*>(frames_.data())
+      + (sequence_ % h->slot_count) * h->slot_size;
+  FrameServerSlot* slot = reinterpret_cast<FrameServerSlot*>(slot_data);
+
+  // Mark the slot as being written before touching anything else in it
+  slot->sequence = 0;
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->timestamp = QDateTime::currentMSecsSinceEpoch();
+  slot->width = texture->width();
+  slot->height = texture->height();
+  slot->format = texture->format();
+  slot->bytes_per_pixel = PixelService::BytesPerPixel(texture->format());
+  slot->size = static_cast<quint64>(pixels.size());
+
+  memcpy(slot_data + sizeof(FrameServerSlot), pixels.constData(), static_cast<size_t>(pixels.size()));
+
+  std::atomic_thread_fence(std::memory_order_release);
+  slot->sequence = sequence_;
+
+  std::atomic_thread_fence(std::memory_order_release);
+  h->latest_sequence = sequence_;
+}
+
+FrameServerHeader *FrameServer::header()
+{
+  return static_cast<FrameServerHeader*>(control_.data());
+}
@@ -0,0 +1,162 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FRAMESERVER_H
+#define FRAMESERVER_H
+
+#include <atomic>
+#include <QList>
+#include <QMutex>
+#include <QSharedMemory>
+
+#include "node/processor/renderer/rendererthreadbase.h"
+#include "render/gl/downloadring.h"
+
+/**
+ * @brief Header of a FrameServer's control segment, the shared memory segment named after the server
+ *
+ * Every field is little-endian on the platforms Olive runs on, and the layout won't change without bumping version.
+ */
+struct FrameServerHeader {
+  /// "OLVFRAME", not NUL-terminated
+  char magic[8];
+
+  quint32 version;
+
+  /// The frames are in the segment named "<name>.<generation>", a consumer re-attaches whenever this changes
+  quint32 generation;
+
+  quint32 slot_count;
+
+  /// 1 while the server is running, 0 once it has stopped (the last frame is left in place)
+  quint32 running;
+
+  /// Size of each slot in bytes, including its FrameServerSlot header
+  quint64 slot_size;
+
+  /// Sequence number of the newest complete frame, 0 if none has been published yet
+  quint64 latest_sequence;
+};
+
+/**
+ * @brief Header of one slot of a FrameServer's frame segment, followed by the frame's pixels
+ *
+ * Frame n is published in slot n % slot_count. Slots work like a seqlock: sequence is 0 while the slot is being written
+ * and only set to the frame's sequence number once it's complete, so a consumer reading a frame in place checks that
+ * sequence is the same non-zero value before and after reading it, and discards the frame otherwise.
+ */
+struct FrameServerSlot {
+  quint64 sequence;
+
+  /// Milliseconds since the epoch when the frame was published
+  qint64 timestamp;
+
+  qint32 width;
+  qint32 height;
+
+  /// The frame's olive::PixelFormat (see render/pixelformat.h)
+  qint32 format;
+
+  qint32 bytes_per_pixel;
+
+  /// Size of the pixels that follow in bytes, rows are tightly packed in the order RenderTexture::Download() uses
+  quint64 size;
+};
+
+Q_STATIC_ASSERT(sizeof(FrameServerHeader) == 40);
+Q_STATIC_ASSERT(sizeof(FrameServerSlot) == 40);
+
+/**
+ * @brief Publishes frames to other processes (e.g. review or broadcast tools) through shared memory
+ *
+ * Connect SetTexture() to a viewer's TextureChanged() signal. Each texture is read back asynchronously through a
+ * DownloadRing and copied into a ring of kFrameServerSlotCount slots in shared memory, where consumers can read it in
+ * place. Only the latest texture is kept, so if the server falls behind it skips frames rather than adding latency.
+ *
+ * The control segment (see FrameServerHeader) uses the server's name as its native key, so processes that don't use
+ * Qt can open it too: on Windows it's the name of a file mapping, elsewhere it's the path of the file that ftok() is
+ * called on to find the System V segment. The frames are in a second segment that is recreated with a new generation
+ * whenever a frame no longer fits in its slots.
+ */
+class FrameServer : public RendererThreadBase
+{
+  Q_OBJECT
+public:
+  FrameServer(QOpenGLContext* share_ctx, const QString& name);
+
+public slots:
+  /**
+   * @brief Publish a texture, replacing one that hasn't been started yet
+   */
+  void SetTexture(RenderTexturePtr texture);
+
+  virtual void Cancel() override;
+
+protected:
+  virtual void ProcessLoop() override;
+
+private:
+  /**
+   * @brief Create (or take over) the control segment
+   */
+  bool CreateControl();
+
+  /**
+   * @brief Create a new generation of the frame segment with slots large enough for `size` bytes of pixels
+   */
+  bool CreateFrames(int size);
+
+  /**
+   * @brief Wait for the oldest readback and copy its pixels into the next slot
+   */
+  void FinishReadback(DownloadRing* ring);
+
+  FrameServerHeader* header();
+
+  QString name_;
+
+  QSharedMemory control_;
+
+  QSharedMemory frames_;
+
+  /**
+   * @brief Textures being read back by the ring, in the order they were started
+   */
+  QList<RenderTexturePtr> pending_;
+
+  /**
+   * @brief Latest texture set and not yet started, protected by latest_lock_
+   */
+  RenderTexturePtr latest_;
+
+  QMutex latest_lock_;
+
+  std::atomic<bool> cancelled_;
+
+  quint64 sequence_;
+
+  /**
+   * @brief Set once a failure to publish has been logged, so it isn't logged for every frame
+   */
+  bool warned_;
+
+};
+
+#endif // FRAMESERVER_H
@@ -0,0 +1,135 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "blitgeometry.h"
+
+#include <QOpenGLFunctions>
+
+namespace {
+
+const GLfloat blit_vertices[] = {
+  -1.0f, -1.0f, 0.0f,
+  1.0f, -1.0f, 0.0f,
+  1.0f, 1.0f, 0.0f,
+
+  -1.0f, -1.0f, 0.0f,
+  -1.0f, 1.0f, 0.0f,
+  1.0f, 1.0f, 0.0f
+};
+
+const GLfloat blit_texcoords[] = {
+  0.0, 0.0,
+  1.0, 0.0,
+  1.0, 1.0,
+
+  0.0, 0.0,
+  0.0, 1.0,
+  1.0, 1.0
+};
+
+const GLfloat flipped_blit_texcoords[] = {
+  0.0, 1.0,
+  1.0, 1.0,
+  1.0, 0.0,
+
+  0.0, 1.0,
+  0.0, 0.0,
+  1.0, 0.0
+};
+
+// Offsets into the vertex buffer, which holds the three arrays above one after another
+const int kTexcoordOffset = static_cast<int>(sizeof(blit_vertices));
+const int kFlippedTexcoordOffset = kTexcoordOffset + static_cast<int>(sizeof(blit_texcoords));
+const int kBufferSize = kFlippedTexcoordOffset + static_cast<int>(sizeof(flipped_blit_texcoords));
+
+}
+
+QHash<QOpenGLContext*, BlitGeometry*> BlitGeometry::instances_;
+QMutex BlitGeometry::instances_lock_;
+
+BlitGeometry *BlitGeometry::Get(QOpenGLContext *ctx)
+{
+  QMutexLocker locker(&instances_lock_);
+
+  BlitGeometry* geometry = instances_.value(ctx);
+
+  if (geometry == nullptr) {
+    geometry = new BlitGeometry(ctx);
+    instances_.insert(ctx, geometry);
+  }
+
+  return geometry;
+}
+
+void BlitGeometry::Draw(ShaderPtr pipeline, bool flipped)
+{
+  QOpenGLFunctions* func = ctx_->functions();
+
+  vao_.bind();
+  vbo_.bind();
+
+  // Attribute locations belong to the pipeline, so they're set up for every draw (this doesn't upload anything)
+  GLuint vertex_location = static_cast<GLuint>(pipeline->attributeLocation("a_position"));
+  func->glEnableVertexAttribArray(vertex_location);
+  func->glVertexAttribPointer(vertex_location, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+  GLuint tex_location = static_cast<GLuint>(pipeline->attributeLocation("a_texcoord"));
+  func->glEnableVertexAttribArray(tex_location);
+  func->glVertexAttribPointer(tex_location,
+                              2,
+                              GL_FLOAT,
+                              GL_FALSE,
+                              0,
+                              reinterpret_cast<const void*>(static_cast<quintptr>(flipped ? kFlippedTexcoordOffset : kTexcoordOffset)));
+
+  func->glDrawArrays(GL_TRIANGLES, 0, 6);
+
+  vbo_.release();
+  vao_.release();
+}
+
+BlitGeometry::BlitGeometry(QOpenGLContext *ctx) :
+  ctx_(ctx)
+{
+  vao_.create();
+
+  vbo_.create();
+  vbo_.bind();
+  vbo_.allocate(kBufferSize);
+  vbo_.write(0, blit_vertices, kTexcoordOffset);
+  vbo_.write(kTexcoordOffset, blit_texcoords, kFlippedTexcoordOffset - kTexcoordOffset);
+  vbo_.write(kFlippedTexcoordOffset, flipped_blit_texcoords, kBufferSize - kFlippedTexcoordOffset);
+  vbo_.release();
+
+  connect(ctx_, SIGNAL(aboutToBeDestroyed()), this, SLOT(ContextDestroyed()), Qt::DirectConnection);
+}
+
+void BlitGeometry::ContextDestroyed()
+{
+  instances_lock_.lock();
+  instances_.remove(ctx_);
+  instances_lock_.unlock();
+
+  // The context is current while aboutToBeDestroyed() is emitted
+  vbo_.destroy();
+  vao_.destroy();
+
+  delete this;
+}
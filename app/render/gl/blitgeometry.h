@@ -0,0 +1,73 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef BLITGEOMETRY_H
+#define BLITGEOMETRY_H
+
+#include <QHash>
+#include <QMutex>
+#include <QOpenGLBuffer>
+#include <QOpenGLContext>
+#include <QOpenGLVertexArrayObject>
+
+#include "shaderptr.h"
+
+/**
+ * @brief The quad drawn by olive::gl::Blit(), created once per context
+ *
+ * Creating and uploading the geometry for every draw is expensive when a node graph blits many times per frame, so
+ * each context gets one vertex array and one buffer holding the vertices and both the normal and vertically flipped
+ * texture coordinates. They're destroyed along with the context.
+ */
+class BlitGeometry : public QObject
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief Retrieve the geometry belonging to this context, creating it if it doesn't exist yet
+   *
+   * `ctx` must be current.
+   */
+  static BlitGeometry* Get(QOpenGLContext* ctx);
+
+  /**
+   * @brief Draw the quad with a pipeline that's already bound
+   */
+  void Draw(ShaderPtr pipeline, bool flipped);
+
+private:
+  BlitGeometry(QOpenGLContext* ctx);
+
+  QOpenGLContext* ctx_;
+
+  QOpenGLVertexArrayObject vao_;
+
+  QOpenGLBuffer vbo_;
+
+  static QHash<QOpenGLContext*, BlitGeometry*> instances_;
+
+  static QMutex instances_lock_;
+
+private slots:
+  void ContextDestroyed();
+
+};
+
+#endif // BLITGEOMETRY_H
@@ -0,0 +1,137 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "blockcompressor.h"
+
+#include <QDebug>
+#include <QOpenGLExtraFunctions>
+
+#include "shadergenerators.h"
+
+BlockCompressor::BlockCompressor(QOpenGLContext *ctx, int texture_count) :
+  ctx_(ctx),
+  textures_(texture_count),
+  next_texture_(0)
+{
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  pipeline_ = olive::ShaderGenerator::BlockCompressPipeline();
+
+  xf->glGenSamplers(1, &sampler_);
+  xf->glSamplerParameteri(sampler_, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  xf->glSamplerParameteri(sampler_, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  for (int i=0;i<textures_.size();i++) {
+    textures_[i] = {0, 0, 0};
+  }
+}
+
+BlockCompressor::~BlockCompressor()
+{
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  foreach (const BlockTexture& t, textures_) {
+    xf->glDeleteTextures(1, &t.texture);
+  }
+
+  xf->glDeleteSamplers(1, &sampler_);
+}
+
+bool BlockCompressor::IsSupported(QOpenGLContext *ctx)
+{
+  if (!olive::ShaderGenerator::SupportsCompute(ctx)) {
+    return false;
+  }
+
+  if (ctx->isOpenGLES()) {
+    return ctx->hasExtension("GL_EXT_texture_compression_bptc");
+  }
+
+  return ctx->format().version() >= qMakePair(4, 2) || ctx->hasExtension("GL_ARB_texture_compression_bptc");
+}
+
+int BlockCompressor::GetBlockCount(int pixels)
+{
+  return (pixels + 3) / 4;
+}
+
+int BlockCompressor::GetCompressedSize(int width, int height)
+{
+  // Every block is 128 bits
+  return GetBlockCount(width) * GetBlockCount(height) * 16;
+}
+
+GLuint BlockCompressor::Compress(RenderTexturePtr texture)
+{
+  if (pipeline_ == nullptr) {
+    return 0;
+  }
+
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  BlockTexture& blocks = textures_[next_texture_];
+  next_texture_ = (next_texture_ + 1) % textures_.size();
+
+  int blocks_width = GetBlockCount(texture->width());
+  int blocks_height = GetBlockCount(texture->height());
+
+  if (blocks.texture == 0 || blocks.width != blocks_width || blocks.height != blocks_height) {
+    xf->glDeleteTextures(1, &blocks.texture);
+
+    xf->glGenTextures(1, &blocks.texture);
+    xf->glBindTexture(GL_TEXTURE_2D, blocks.texture);
+    xf->glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA32UI, blocks_width, blocks_height);
+    xf->glBindTexture(GL_TEXTURE_2D, 0);
+
+    blocks.width = blocks_width;
+    blocks.height = blocks_height;
+  }
+
+  // The texture was rendered in another context, make sure the GPU has finished it before we read from it
+  texture->WaitFence();
+
+  xf->glActiveTexture(GL_TEXTURE0);
+  texture->Bind();
+  xf->glBindSampler(0, sampler_);
+
+  pipeline_->bind();
+  pipeline_->setUniformValue("input_texture", 0);
+  xf->glUniform2i(pipeline_->uniformLocation("output_size"), blocks_width, blocks_height);
+
+  xf->glBindImageTexture(0, blocks.texture, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32UI);
+
+  int local_size = olive::kComputeLocalSize;
+
+  xf->glDispatchCompute(static_cast<GLuint>((blocks_width + local_size - 1) / local_size),
+                        static_cast<GLuint>((blocks_height + local_size - 1) / local_size),
+                        1);
+
+  // The blocks are read back through a framebuffer into a pixel pack buffer
+  xf->glMemoryBarrier(GL_FRAMEBUFFER_BARRIER_BIT | GL_PIXEL_BUFFER_BARRIER_BIT);
+
+  xf->glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA32UI);
+
+  pipeline_->release();
+
+  xf->glBindSampler(0, 0);
+  texture->Release();
+
+  return blocks.texture;
+}
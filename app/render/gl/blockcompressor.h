@@ -0,0 +1,106 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef BLOCKCOMPRESSOR_H
+#define BLOCKCOMPRESSOR_H
+
+#include <QOpenGLContext>
+#include <QVector>
+
+#include "render/rendertexture.h"
+#include "shaderptr.h"
+
+#ifndef GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+/**
+ * @brief Compresses rendered frames into BC7 blocks on the GPU so only the blocks have to be read back
+ *
+ * Used for olive::kCacheFormatBC7. A frame is encoded by ShaderGenerator::BlockCompressPipeline() into an RGBA32UI
+ * texture holding one 16 byte block per texel, which is read back with GL_RGBA_INTEGER/GL_UNSIGNED_INT (see
+ * DownloadRing::Start()) and stored as-is. Played back frames are uploaded with RenderTexture::CreateCompressed().
+ *
+ * Create and destroy the compressor with its context current, and only use it from that context's thread.
+ */
+class BlockCompressor
+{
+public:
+  /**
+   * @brief Create a compressor that cycles through `texture_count` block textures
+   *
+   * Use one block texture for each readback that can be in flight, so a frame is never compressed into a texture that's
+   * still being read back.
+   */
+  BlockCompressor(QOpenGLContext* ctx, int texture_count);
+
+  ~BlockCompressor();
+
+  BlockCompressor(const BlockCompressor& other) = delete;
+  BlockCompressor& operator=(const BlockCompressor& other) = delete;
+
+  /**
+   * @brief Returns TRUE if `ctx` can both compress frames and draw the results
+   *
+   * Needs compute shaders (see ShaderGenerator::SupportsCompute()) and BPTC textures, which are core in OpenGL 4.2
+   * and an extension everywhere else.
+   */
+  static bool IsSupported(QOpenGLContext* ctx);
+
+  /**
+   * @brief Returns the number of blocks needed to cover `pixels` pixels in one direction
+   */
+  static int GetBlockCount(int pixels);
+
+  /**
+   * @brief Returns the size in bytes of the blocks of a `width` x `height` frame
+   */
+  static int GetCompressedSize(int width, int height);
+
+  /**
+   * @brief Compress a texture into the next block texture and return it
+   *
+   * Waits on the texture's fence on the GPU, so textures rendered in other contexts of the share group can be passed
+   * directly. The block texture is GetBlockCount() texels in each direction and stays valid until this has been called
+   * `texture_count` more times. Returns 0 if the compression pipeline failed to compile.
+   */
+  GLuint Compress(RenderTexturePtr texture);
+
+private:
+  struct BlockTexture {
+    GLuint texture;
+    int width;
+    int height;
+  };
+
+  QOpenGLContext* ctx_;
+
+  ShaderPtr pipeline_;
+
+  /// Samples the source with nearest filtering whatever its own parameters are (they may not be mipmap complete)
+  GLuint sampler_;
+
+  QVector<BlockTexture> textures_;
+
+  int next_texture_;
+
+};
+
+#endif // BLOCKCOMPRESSOR_H
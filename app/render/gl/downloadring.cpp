@@ -0,0 +1,178 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "downloadring.h"
+
+#include <QDebug>
+
+#include "render/pixelservice.h"
+#include "render/profiler.h"
+
+DownloadRing::DownloadRing(QOpenGLContext *ctx, int buffer_count) :
+  ctx_(ctx),
+  buffers_(buffer_count),
+  next_buffer_(0)
+{
+  QOpenGLFunctions* f = ctx_->functions();
+
+  f->glGenFramebuffers(1, &read_buffer_);
+
+  for (int i=0;i<buffers_.size();i++) {
+    f->glGenBuffers(1, &buffers_[i].buffer);
+    buffers_[i].size = 0;
+  }
+}
+
+DownloadRing::~DownloadRing()
+{
+  QOpenGLFunctions* f = ctx_->functions();
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  // Discard readbacks still in progress
+  foreach (const Pending& p, pending_) {
+    xf->glDeleteSync(p.fence);
+  }
+
+  foreach (const Buffer& b, buffers_) {
+    f->glDeleteBuffers(1, &b.buffer);
+  }
+
+  f->glDeleteFramebuffers(1, &read_buffer_);
+}
+
+void DownloadRing::Start(RenderTexturePtr texture)
+{
+  PixelFormatInfo format_info = PixelService::GetPixelFormatInfo(texture->format());
+
+  // The texture was rendered in another context, make sure the GPU has finished it before we read from it
+  texture->WaitFence();
+
+  Start(texture->texture(),
+        texture->width(),
+        texture->height(),
+        format_info.pixel_format,
+        format_info.pixel_type,
+        PixelService::GetBufferSize(texture->format(), texture->width(), texture->height()));
+}
+
+void DownloadRing::Start(GLuint texture, int width, int height, GLenum pixel_format, GLenum pixel_type, int size)
+{
+  Q_ASSERT(!IsFull());
+
+  QOpenGLFunctions* f = ctx_->functions();
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  int index = next_buffer_;
+  next_buffer_ = (next_buffer_ + 1) % buffers_.size();
+
+  Buffer& b = buffers_[index];
+
+  f->glBindBuffer(GL_PIXEL_PACK_BUFFER, b.buffer);
+
+  if (b.size < size) {
+    f->glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+    b.size = size;
+  }
+
+  f->glBindFramebuffer(GL_READ_FRAMEBUFFER, read_buffer_);
+
+  xf->glFramebufferTexture2D(GL_READ_FRAMEBUFFER,
+                             GL_COLOR_ATTACHMENT0,
+                             GL_TEXTURE_2D,
+                             texture,
+                             0);
+
+  // With a pixel pack buffer bound, glReadPixels returns immediately and the copy happens asynchronously
+  f->glReadPixels(0,
+                  0,
+                  width,
+                  height,
+                  pixel_format,
+                  pixel_type,
+                  nullptr);
+
+  f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  xf->glFramebufferTexture2D(GL_READ_FRAMEBUFFER,
+                             GL_COLOR_ATTACHMENT0,
+                             GL_TEXTURE_2D,
+                             0,
+                             0);
+
+  f->glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+  GLsync fence = xf->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  // Make sure the commands are submitted so the fence can actually signal
+  f->glFlush();
+
+  pending_.append({index, size, fence});
+}
+
+QByteArray DownloadRing::Finish()
+{
+  Q_ASSERT(!IsEmpty());
+
+  // Includes any wait on the GPU to finish the frame
+  ProfilerTimer timer(Profiler::kDownload);
+
+  QOpenGLFunctions* f = ctx_->functions();
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  Pending p = pending_.takeFirst();
+
+  xf->glClientWaitSync(p.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+  xf->glDeleteSync(p.fence);
+
+  QByteArray pixels;
+
+  f->glBindBuffer(GL_PIXEL_PACK_BUFFER, buffers_.at(p.buffer).buffer);
+
+  const void* mapped = xf->glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, p.size, GL_MAP_READ_BIT);
+
+  if (mapped) {
+    pixels = QByteArray(static_cast<const char*>(mapped), p.size);
+
+    xf->glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  } else {
+    qWarning() << "Failed to map pixel buffer for frame download";
+  }
+
+  f->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  return pixels;
+}
+
+bool DownloadRing::IsOldestReady() const
+{
+  GLenum status = ctx_->extraFunctions()->glClientWaitSync(pending_.first().fence, 0, 0);
+
+  return (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED);
+}
+
+bool DownloadRing::IsEmpty() const
+{
+  return pending_.isEmpty();
+}
+
+bool DownloadRing::IsFull() const
+{
+  return pending_.size() == buffers_.size();
+}
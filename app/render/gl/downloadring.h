@@ -0,0 +1,108 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef DOWNLOADRING_H
+#define DOWNLOADRING_H
+
+#include <QByteArray>
+#include <QList>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QVector>
+
+#include "render/rendertexture.h"
+
+/**
+ * @brief A ring of pixel pack buffers used to read textures back asynchronously
+ *
+ * With a pixel pack buffer bound, glReadPixels() returns immediately and the GPU copies the pixels in the background.
+ * Each readback is fenced, and its pixels are only mapped once the fence has signalled, so the thread reading back can
+ * keep several frames in flight instead of stalling on every one.
+ *
+ * Readbacks finish in the order they were started. Create and destroy the ring with its context current, and only use
+ * it from that context's thread.
+ */
+class DownloadRing
+{
+public:
+  DownloadRing(QOpenGLContext* ctx, int buffer_count);
+
+  ~DownloadRing();
+
+  DownloadRing(const DownloadRing& other) = delete;
+  DownloadRing& operator=(const DownloadRing& other) = delete;
+
+  /**
+   * @brief Start reading a texture back into the next free buffer
+   *
+   * The ring must not be full (see IsFull()). Waits on the texture's fence on the GPU, so textures rendered in other
+   * contexts of the share group can be passed directly.
+   */
+  void Start(RenderTexturePtr texture);
+
+  /**
+   * @brief Start reading back a texture that isn't a RenderTexture (e.g. BlockCompressor's blocks)
+   *
+   * Same as above, but the caller makes sure the texture has finished rendering and provides the format and type to
+   * read it back with, as well as the resulting `size` in bytes.
+   */
+  void Start(GLuint texture, int width, int height, GLenum pixel_format, GLenum pixel_type, int size);
+
+  /**
+   * @brief Wait for the oldest readback to finish and return its pixels
+   *
+   * The ring must not be empty. Returns an empty array if the buffer couldn't be mapped.
+   */
+  QByteArray Finish();
+
+  /**
+   * @brief Return whether the oldest readback has finished copying without waiting for it
+   */
+  bool IsOldestReady() const;
+
+  bool IsEmpty() const;
+
+  bool IsFull() const;
+
+private:
+  struct Buffer {
+    GLuint buffer;
+    int size;
+  };
+
+  struct Pending {
+    int buffer;
+    int size;
+    GLsync fence;
+  };
+
+  QOpenGLContext* ctx_;
+
+  GLuint read_buffer_;
+
+  QVector<Buffer> buffers_;
+
+  int next_buffer_;
+
+  QList<Pending> pending_;
+
+};
+
+#endif // DOWNLOADRING_H
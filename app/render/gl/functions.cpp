@@ -22,109 +22,71 @@
 
 #include <QOpenGLFunctions>
 #include <QOpenGLExtraFunctions>
-#include <QOpenGLVertexArrayObject>
-#include <QOpenGLBuffer>
-
-const GLfloat blit_vertices[] = {
-  -1.0f, -1.0f, 0.0f,
-  1.0f, -1.0f, 0.0f,
-  1.0f, 1.0f, 0.0f,
-
-  -1.0f, -1.0f, 0.0f,
-  -1.0f, 1.0f, 0.0f,
-  1.0f, 1.0f, 0.0f
-};
-
-const GLfloat blit_texcoords[] = {
-  0.0, 0.0,
-  1.0, 0.0,
-  1.0, 1.0,
-
-  0.0, 0.0,
-  0.0, 1.0,
-  1.0, 1.0
-};
-
-const GLfloat flipped_blit_texcoords[] = {
-  0.0, 1.0,
-  1.0, 1.0,
-  1.0, 0.0,
-
-  0.0, 1.0,
-  0.0, 0.0,
-  1.0, 0.0
-};
+#include <QVector2D>
+
+#include "blitgeometry.h"
+#include "render/gpuprofiler.h"
+#include "render/profiler.h"
 
 /**
- * @brief Set up texture parameters and mipmap for drawing
+ * @brief Set up texture parameters for drawing
  *
- * Internal function used just before drawing to allow mipmapped bilinear filtering when drawing textures small.
+ * Internal function used just before drawing. Mipmaps are only generated (allowing mipmapped bilinear filtering) when
+ * the texture is being drawn small, since regenerating them for every draw is far from free.
  *
  * @param f
  *
  * Currently active QOpenGLFunctions object (use context()->functions() if unsure).
+ *
+ * @param minified
+ *
+ * Whether the texture is being drawn smaller than its actual size
+ *
+ * @param mipmapped
+ *
+ * Whether the texture's mipmaps are already up to date and don't need regenerating
  */
-void PrepareToDraw(QOpenGLFunctions* f) {
-  f->glGenerateMipmap(GL_TEXTURE_2D);
-  f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+void PrepareToDraw(QOpenGLFunctions* f, bool minified, bool mipmapped) {
+  if (minified) {
+    if (!mipmapped) {
+      f->glGenerateMipmap(GL_TEXTURE_2D);
+    }
+
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  } else {
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  }
+
   f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
   f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
   f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 }
 
-void olive::gl::Blit(ShaderPtr pipeline, bool flipped, QMatrix4x4 matrix) {
-  // FIXME: is currentContext() reliable here?
-  QOpenGLFunctions* func = QOpenGLContext::currentContext()->functions();
-
-  PrepareToDraw(func);
-
-  QOpenGLVertexArrayObject m_vao;
-  m_vao.create();
-  m_vao.bind();
+void olive::gl::Blit(ShaderPtr pipeline, bool flipped, QMatrix4x4 matrix, bool minified, bool mipmapped) {
+  ProfilerTimer timer(Profiler::kBlit);
+  GPUTimer gpu_timer(Profiler::kGPUPass);
 
-  QOpenGLBuffer m_vbo;
-  m_vbo.create();
-  m_vbo.bind();
-  m_vbo.allocate(blit_vertices, 18 * static_cast<int>(sizeof(GLfloat)));
-  m_vbo.release();
+  // FIXME: is currentContext() reliable here?
+  QOpenGLContext* ctx = QOpenGLContext::currentContext();
 
-  QOpenGLBuffer m_vbo2;
-  m_vbo2.create();
-  m_vbo2.bind();
-  m_vbo2.allocate(flipped ? flipped_blit_texcoords : blit_texcoords, 12 * static_cast<int>(sizeof(GLfloat)));
-  m_vbo2.release();
+  PrepareToDraw(ctx->functions(), minified, mipmapped);
 
   pipeline->bind();
 
   pipeline->setUniformValue("mvp_matrix", matrix);
   pipeline->setUniformValue("texture", 0);
 
-  GLuint vertex_location = static_cast<GLuint>(pipeline->attributeLocation("a_position"));
-  m_vbo.bind();
-  func->glEnableVertexAttribArray(vertex_location);
-  func->glVertexAttribPointer(vertex_location, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-  m_vbo.release();
-
-  GLuint tex_location = static_cast<GLuint>(pipeline->attributeLocation("a_texcoord"));
-  m_vbo2.bind();
-  func->glEnableVertexAttribArray(tex_location);
-  func->glVertexAttribPointer(tex_location, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-  m_vbo2.release();
-
-  func->glDrawArrays(GL_TRIANGLES, 0, 6);
+  BlitGeometry::Get(ctx)->Draw(pipeline, flipped);
 
   pipeline->release();
-
-  m_vbo2.destroy();
-  m_vbo.destroy();
-  m_vao.release();
-  m_vao.destroy();
 }
 
 void olive::gl::OCIOBlit(ShaderPtr pipeline,
                          GLuint lut,
                          bool flipped,
-                         QMatrix4x4 matrix)
+                         QMatrix4x4 matrix,
+                         bool minified,
+                         bool mipmapped)
 {
   QOpenGLContext* ctx = QOpenGLContext::currentContext();
   QOpenGLExtraFunctions* xf = ctx->extraFunctions();
@@ -137,7 +99,7 @@ void olive::gl::OCIOBlit(ShaderPtr pipeline,
 
   pipeline->setUniformValue("tex2", 2);
 
-  olive::gl::Blit(pipeline, flipped, matrix);
+  olive::gl::Blit(pipeline, flipped, matrix, minified, mipmapped);
 
   pipeline->release();
 
@@ -145,3 +107,14 @@ void olive::gl::OCIOBlit(ShaderPtr pipeline,
   xf->glBindTexture(GL_TEXTURE_3D, 0);
   xf->glActiveTexture(GL_TEXTURE0);
 }
+
+bool olive::gl::IsMinified(const QMatrix4x4 &matrix, int src_height, int dst_width, int dst_height)
+{
+  // Map the quad's vertical half-extent into clip space, then into destination pixels
+  QVector3D half_extent = matrix.mapVector(QVector3D(0.0f, 1.0f, 0.0f));
+
+  QVector2D half_extent_px(half_extent.x() * static_cast<float>(dst_width) * 0.5f,
+                           half_extent.y() * static_cast<float>(dst_height) * 0.5f);
+
+  return half_extent_px.length() * 2.0f < static_cast<float>(src_height);
+}
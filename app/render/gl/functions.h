@@ -31,6 +31,8 @@ namespace gl {
 /**
  * @brief Draw texture on screen
  *
+ * The quad geometry is created once per context and reused for every subsequent draw in that context.
+ *
  * @param pipeline
  *
  * Shader to use for the texture drawing
@@ -42,10 +44,35 @@ namespace gl {
  * @param matrix
  *
  * Transformation matrix to use when drawing (defaults to no transform)
+ *
+ * @param minified
+ *
+ * Generate mipmaps for the bound texture and sample it with trilinear filtering. Only worth doing if the texture is
+ * drawn smaller than its actual size (see IsMinified()), otherwise it's just wasted GPU time (defaults to FALSE)
+ *
+ * @param mipmapped
+ *
+ * The bound texture's mipmaps are already up to date (e.g. a resident still texture that never changes), so a
+ * minified draw samples them without regenerating them first (defaults to FALSE)
  */
-void Blit(ShaderPtr pipeline, bool flipped = false, QMatrix4x4 matrix = QMatrix4x4());
+void Blit(ShaderPtr pipeline,
+          bool flipped = false,
+          QMatrix4x4 matrix = QMatrix4x4(),
+          bool minified = false,
+          bool mipmapped = false);
+
+void OCIOBlit(ShaderPtr pipeline,
+              GLuint lut,
+              bool flipped = false,
+              QMatrix4x4 matrix = QMatrix4x4(),
+              bool minified = false,
+              bool mipmapped = false);
 
-void OCIOBlit(ShaderPtr pipeline, GLuint lut, bool flipped = false, QMatrix4x4 matrix = QMatrix4x4());
+/**
+ * @brief Returns TRUE if a texture `src_height` pixels high drawn with `matrix` onto a `dst_width`x`dst_height` buffer
+ * would be drawn smaller than its actual size
+ */
+bool IsMinified(const QMatrix4x4& matrix, int src_height, int dst_width, int dst_height);
 
 }
 }
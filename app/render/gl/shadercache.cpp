@@ -0,0 +1,237 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "shadercache.h"
+
+#include <QOpenGLFunctions>
+#include <QtMath>
+
+#include "common/define.h"
+#include "config/config.h"
+#include "functions.h"
+#include "render/renderframebuffer.h"
+#include "render/rendertexture.h"
+
+/**
+ * @brief Steps along each axis of the color cube in IsOCIOPipelineAccurate()'s test pattern
+ *
+ * Chosen so that most of the colors fall between the points of OCIO's 3D LUT, where its approximation is furthest off.
+ */
+const int kColorTestSteps = 24;
+
+/**
+ * @brief Dimensions of the test pattern, which holds kColorTestSteps^3 colors
+ */
+const int kColorTestWidth = kColorTestSteps * kColorTestSteps / 4;
+const int kColorTestHeight = kColorTestSteps * 4;
+
+QHash<QOpenGLContext*, ShaderCache*> ShaderCache::instances_;
+QMutex ShaderCache::instances_lock_;
+
+ShaderCache *ShaderCache::Get(QOpenGLContext *ctx)
+{
+  QMutexLocker locker(&instances_lock_);
+
+  ShaderCache* cache = instances_.value(ctx);
+
+  if (cache == nullptr) {
+    cache = new ShaderCache(ctx);
+    instances_.insert(ctx, cache);
+  }
+
+  return cache;
+}
+
+ShaderPtr ShaderCache::DefaultPipeline()
+{
+  QString key = QStringLiteral("default");
+
+  ShaderPtr pipeline = pipelines_.value(key);
+
+  if (pipeline == nullptr) {
+    pipeline = olive::ShaderGenerator::DefaultPipeline();
+    pipelines_.insert(key, pipeline);
+  }
+
+  return pipeline;
+}
+
+ShaderPtr ShaderCache::OCIOPipeline(OCIO::ConstProcessorRcPtr processor, bool alpha_is_associated, GLuint *lut_texture)
+{
+  OCIO::GpuShaderDesc desc;
+  olive::ShaderGenerator::SetUpOCIOShaderDesc(desc);
+
+  // Processors that produce the same shader text can share a pipeline, and likewise for the LUT
+  QString lut_key = processor->getGpuLut3DCacheID(desc);
+  QString key = QStringLiteral("ocio:%1:%2").arg(processor->getGpuShaderTextCacheID(desc),
+                                                 QString::number(alpha_is_associated));
+
+  QHash<QString, GLuint>::const_iterator lut = luts_.constFind(lut_key);
+
+  if (lut == luts_.constEnd()) {
+    lut = luts_.insert(lut_key, olive::ShaderGenerator::CreateOCIOLut(ctx_, processor));
+  }
+
+  *lut_texture = lut.value();
+
+  ShaderPtr pipeline = pipelines_.value(key);
+
+  if (pipeline == nullptr) {
+    pipeline = olive::ShaderGenerator::OCIOPipeline(processor, alpha_is_associated);
+    pipelines_.insert(key, pipeline);
+  }
+
+  return pipeline;
+}
+
+bool ShaderCache::IsOCIOPipelineAccurate(OCIO::ConstProcessorRcPtr processor)
+{
+  QString key = processor->getCpuCacheID();
+
+  QHash<QString, bool>::const_iterator result = accurate_.constFind(key);
+
+  if (result != accurate_.constEnd()) {
+    return result.value();
+  }
+
+  // Every combination of kColorTestSteps levels of red, green and blue, all opaque
+  int pixel_count = kColorTestWidth * kColorTestHeight;
+
+  QVector<float> pattern(pixel_count * kRGBAChannels);
+
+  for (int i=0;i<pixel_count;i++) {
+    float* pixel = pattern.data() + i * kRGBAChannels;
+
+    pixel[0] = static_cast<float>(i % kColorTestSteps) / (kColorTestSteps - 1);
+    pixel[1] = static_cast<float>((i / kColorTestSteps) % kColorTestSteps) / (kColorTestSteps - 1);
+    pixel[2] = static_cast<float>(i / (kColorTestSteps * kColorTestSteps)) / (kColorTestSteps - 1);
+    pixel[3] = 1.0f;
+  }
+
+  // Draw the pattern through the GPU path
+  QOpenGLFunctions* f = ctx_->functions();
+
+  GLint viewport[4];
+  f->glGetIntegerv(GL_VIEWPORT, viewport);
+
+  RenderTexturePtr src = std::make_shared<RenderTexture>();
+  src->Create(ctx_, kColorTestWidth, kColorTestHeight, olive::PIX_FMT_RGBA32F, pattern.data());
+
+  RenderTexturePtr dst = std::make_shared<RenderTexture>();
+  dst->Create(ctx_, kColorTestWidth, kColorTestHeight, olive::PIX_FMT_RGBA32F);
+
+  GLuint lut;
+  ShaderPtr pipeline = OCIOPipeline(processor, false, &lut);
+
+  RenderFramebuffer buffer;
+  buffer.Create(ctx_);
+  buffer.Attach(dst);
+  buffer.Bind();
+
+  f->glViewport(0, 0, kColorTestWidth, kColorTestHeight);
+  f->glBlendFunc(GL_ONE, GL_ZERO);
+
+  src->Bind();
+  olive::gl::OCIOBlit(pipeline, lut);
+  src->Release();
+
+  buffer.Detach();
+  buffer.Release();
+
+  f->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+  float* gpu = reinterpret_cast<float*>(dst->Download());
+
+  // And through the CPU path
+  OCIO::PackedImageDesc img(pattern.data(), kColorTestWidth, kColorTestHeight, kRGBAChannels);
+  processor->apply(img);
+
+  bool accurate = (gpu != nullptr);
+
+  for (int i=0;accurate && i<pixel_count;i++) {
+    for (int j=0;j<3;j++) {
+      float cpu_value = pattern.at(i * kRGBAChannels + j);
+      float gpu_value = gpu[i * kRGBAChannels + j];
+
+      // Linear values above 1 are compared relative to their size
+      if (qAbs(gpu_value - cpu_value) > kGPUColorTolerance * qMax(1.0f, qAbs(cpu_value))) {
+        accurate = false;
+        break;
+      }
+    }
+  }
+
+  delete [] gpu;
+
+  accurate_.insert(key, accurate);
+
+  return accurate;
+}
+
+ShaderPtr ShaderCache::CompositePipeline(int layer_count)
+{
+  QString key = QStringLiteral("composite:%1").arg(layer_count);
+
+  ShaderPtr pipeline = pipelines_.value(key);
+
+  if (pipeline == nullptr) {
+    pipeline = olive::ShaderGenerator::CompositePipeline(layer_count);
+    pipelines_.insert(key, pipeline);
+  }
+
+  return pipeline;
+}
+
+ShaderPtr ShaderCache::ComputePipeline(const QString &id, const QString &kernel_code, const olive::PixelFormat &format)
+{
+  QString key = QStringLiteral("compute:%1:%2").arg(id, QString::number(format));
+
+  QHash<QString, ShaderPtr>::const_iterator pipeline = pipelines_.constFind(key);
+
+  if (pipeline == pipelines_.constEnd()) {
+    pipeline = pipelines_.insert(key, olive::ShaderGenerator::ComputePipeline(kernel_code, format));
+  }
+
+  return pipeline.value();
+}
+
+ShaderCache::ShaderCache(QOpenGLContext *ctx) :
+  ctx_(ctx)
+{
+  connect(ctx_, SIGNAL(aboutToBeDestroyed()), this, SLOT(ContextDestroyed()), Qt::DirectConnection);
+}
+
+void ShaderCache::ContextDestroyed()
+{
+  instances_lock_.lock();
+  instances_.remove(ctx_);
+  instances_lock_.unlock();
+
+  // The context is current while aboutToBeDestroyed() is emitted
+  foreach (GLuint lut, luts_) {
+    ctx_->functions()->glDeleteTextures(1, &lut);
+  }
+
+  luts_.clear();
+  pipelines_.clear();
+  accurate_.clear();
+
+  delete this;
+}
@@ -0,0 +1,115 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <QHash>
+#include <QMutex>
+#include <QOpenGLContext>
+
+#include "shadergenerators.h"
+
+/**
+ * @brief Compiled pipelines and OCIO LUT textures belonging to one context
+ *
+ * Compiling shaders and computing OCIO LUTs is slow, and most of the pipelines used while rendering are identical
+ * (every clip in the same color space uses the same OCIO pipeline, for example). Retrieving them here compiles each
+ * one only once per context. Everything is destroyed along with the context.
+ *
+ * Since cached pipelines are shared between everything drawing in this context, users should set any uniforms they
+ * rely on before each draw rather than only once.
+ */
+class ShaderCache : public QObject
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief Retrieve the cache belonging to this context, creating it if it doesn't exist yet
+   *
+   * `ctx` must be current.
+   */
+  static ShaderCache* Get(QOpenGLContext* ctx);
+
+  /**
+   * @brief Equivalent to olive::ShaderGenerator::DefaultPipeline() with no custom code
+   */
+  ShaderPtr DefaultPipeline();
+
+  /**
+   * @brief Equivalent to olive::ShaderGenerator::OCIOPipeline()
+   *
+   * @param lut_texture
+   *
+   * Set to the LUT texture to bind when drawing with this pipeline. The texture belongs to the cache and must not be
+   * deleted.
+   */
+  ShaderPtr OCIOPipeline(OCIO::ConstProcessorRcPtr processor, bool alpha_is_associated, GLuint* lut_texture);
+
+  /**
+   * @brief Returns TRUE if OCIOPipeline() gives the same colors as the processor's CPU path to within
+   * kGPUColorTolerance
+   *
+   * OpenColorIO v1 approximates transforms on the GPU with a 3D LUT, which is exact enough for simple matrices and
+   * curves but not for everything. The first time each transform is asked about, a test pattern covering the color
+   * cube is converted both ways in this context and compared, and the result is remembered.
+   */
+  bool IsOCIOPipelineAccurate(OCIO::ConstProcessorRcPtr processor);
+
+  /**
+   * @brief Equivalent to olive::ShaderGenerator::CompositePipeline()
+   */
+  ShaderPtr CompositePipeline(int layer_count);
+
+  /**
+   * @brief Equivalent to olive::ShaderGenerator::ComputePipeline()
+   *
+   * @param id
+   *
+   * A name unique to this kernel, used to look it up instead of its code.
+   *
+   * Kernels that fail to compile are remembered too, so they aren't compiled again on every use.
+   */
+  ShaderPtr ComputePipeline(const QString& id, const QString& kernel_code, const olive::PixelFormat& format);
+
+private:
+  ShaderCache(QOpenGLContext* ctx);
+
+  QOpenGLContext* ctx_;
+
+  /// Pipelines keyed by the generator and its parameters
+  QHash<QString, ShaderPtr> pipelines_;
+
+  /// LUT textures keyed by the OCIO processor's LUT cache ID
+  QHash<QString, GLuint> luts_;
+
+  /// Results of IsOCIOPipelineAccurate() keyed by the OCIO processor's CPU cache ID
+  QHash<QString, bool> accurate_;
+
+  static QHash<QOpenGLContext*, ShaderCache*> instances_;
+
+  static QMutex instances_lock_;
+
+private slots:
+  void ContextDestroyed();
+
+};
+
+#endif // SHADERCACHE_H
@@ -20,7 +20,10 @@
 
 #include "shadergenerators.h"
 
+#include <QDebug>
+#include <QGenericMatrix>
 #include <QOpenGLExtraFunctions>
+#include <QVector3D>
 
 namespace olive {
 
@@ -101,8 +104,14 @@ ShaderPtr ShaderGenerator::DefaultPipeline(const QString& function_name, const Q
 
 
   // Add shaders to program
+#if QT_VERSION >= QT_VERSION_CHECK(5, 9, 0)
+  // Where the driver supports it, Qt stores the linked program binary on disk so later runs can skip compiling
+  program->addCacheableShaderFromSourceCode(QOpenGLShader::Vertex, vert_shader);
+  program->addCacheableShaderFromSourceCode(QOpenGLShader::Fragment, frag_shader);
+#else
   program->addShaderFromSourceCode(QOpenGLShader::Vertex, vert_shader);
   program->addShaderFromSourceCode(QOpenGLShader::Fragment, frag_shader);
+#endif
   program->link();
 
   // Set opacity default to 100%
@@ -113,6 +122,672 @@ ShaderPtr ShaderGenerator::DefaultPipeline(const QString& function_name, const Q
   return program;
 }
 
+ShaderPtr ShaderGenerator::YUVPipeline(const YUVInfo &info)
+{
+  QString function_name = "yuv_to_rgb";
+
+  if (info.layout == YUV_LAYOUT_PACKED_RGB10) {
+    // Each texel holds the four bytes of one 32-bit word, R in bits 31-22, G in 21-12 and B in 11-2. GLSL 1.10 has no
+    // integer operations so the fields are pulled apart with floor()/mod() on the byte values.
+    QString unpack_code = QString("vec4 %1(vec4 col) {\n"
+                                  "  vec4 w = floor(col.%2 * 255.0 + 0.5);\n"
+                                  "  vec3 rgb;\n"
+                                  "  rgb.r = w.x * 4.0 + floor(w.y / 64.0);\n"
+                                  "  rgb.g = mod(w.y, 64.0) * 16.0 + floor(w.z / 16.0);\n"
+                                  "  rgb.b = mod(w.z, 16.0) * 64.0 + floor(w.w / 4.0);\n"
+                                  "  return vec4(rgb / 1023.0, 1.0);\n"
+                                  "}\n").arg(function_name, info.big_endian ? "rgba" : "abgr");
+
+    return DefaultPipeline(function_name, unpack_code);
+  }
+
+  QString shader_code = "uniform sampler2D u_tex;\n"
+                        "uniform sampler2D v_tex;\n"
+                        "uniform mat3 yuv_matrix;\n"
+                        "uniform vec3 yuv_offset;\n"
+                        "uniform float sample_scale;\n"
+                        "\n";
+
+  shader_code.append(QString("vec4 %1(vec4 col) {\n"
+                             "  vec3 yuv;\n"
+                             "  yuv.x = col.r;\n").arg(function_name));
+
+  if (info.layout == YUV_LAYOUT_SEMIPLANAR) {
+    shader_code.append("  yuv.yz = texture2D(u_tex, v_texcoord).rg;\n");
+  } else {
+    shader_code.append("  yuv.y = texture2D(u_tex, v_texcoord).r;\n"
+                       "  yuv.z = texture2D(v_tex, v_texcoord).r;\n");
+  }
+
+  shader_code.append("  yuv *= sample_scale;\n"
+                     "  return vec4(yuv_matrix * (yuv - yuv_offset), 1.0);\n"
+                     "}\n");
+
+  ShaderPtr program = DefaultPipeline(function_name, shader_code);
+
+  // Luma/chroma coefficients for each colorspace
+  float kr, kb;
+
+  switch (info.colorspace) {
+  case YUV_COLORSPACE_BT601:
+    kr = 0.299f;
+    kb = 0.114f;
+    break;
+  case YUV_COLORSPACE_BT2020:
+    kr = 0.2627f;
+    kb = 0.0593f;
+    break;
+  case YUV_COLORSPACE_BT709:
+  default:
+    kr = 0.2126f;
+    kb = 0.0722f;
+    break;
+  }
+
+  float kg = 1.0f - kr - kb;
+
+  // Samples stored in the low bits of a 16-bit word need scaling back up to 0.0-1.0
+  float max_value = static_cast<float>((1 << info.bit_depth) - 1);
+  float sample_scale = (info.bit_depth > 8 && !info.msb_aligned) ? 65535.0f / max_value : 1.0f;
+
+  // Offsets and scales to expand limited range samples to full range
+  float depth_mul = static_cast<float>(1 << (info.bit_depth - 8));
+  float y_offset, c_offset, y_scale, c_scale;
+
+  if (info.full_range) {
+    y_offset = 0.0f;
+    y_scale = 1.0f;
+    c_scale = 1.0f;
+  } else {
+    y_offset = 16.0f * depth_mul / max_value;
+    y_scale = max_value / (219.0f * depth_mul);
+    c_scale = max_value / (224.0f * depth_mul);
+  }
+
+  c_offset = 128.0f * depth_mul / max_value;
+
+  // Standard YCbCr to RGB matrix (row-major) with the range expansion folded in
+  const float matrix_values[] = {
+    y_scale, 0.0f,                                    c_scale * 2.0f * (1.0f - kr),
+    y_scale, c_scale * -2.0f * kb * (1.0f - kb) / kg, c_scale * -2.0f * kr * (1.0f - kr) / kg,
+    y_scale, c_scale * 2.0f * (1.0f - kb),            0.0f
+  };
+
+  program->bind();
+  program->setUniformValue("u_tex", 1);
+  program->setUniformValue("v_tex", 2);
+  program->setUniformValue("yuv_matrix", QMatrix3x3(matrix_values));
+  program->setUniformValue("yuv_offset", QVector3D(y_offset, c_offset, c_offset));
+  program->setUniformValue("sample_scale", sample_scale);
+  program->release();
+
+  return program;
+}
+
+/**
+ * @brief BT.709 luma coefficients used by the packed YUV pipelines
+ */
+const float kPackedYUVKr = 0.2126f;
+const float kPackedYUVKb = 0.0722f;
+
+/**
+ * @brief Declarations shared by YUVPackPipeline() and YUVUnpackPipeline()
+ */
+static QString PackedYUVCommonCode(bool vertical_subsampling)
+{
+  // Texel positions need more precision than mediump guarantees on OpenGL ES
+  return QString("#ifdef GL_ES\n"
+                 "precision highp float;\n"
+                 "#endif\n"
+                 "\n"
+                 "uniform vec2 source_size;\n"
+                 "uniform vec2 packed_size;\n"
+                 "uniform vec2 chroma_size;\n"
+                 "uniform float chroma_texels;\n"
+                 "\n"
+                 "const bool vertical_subsampling = %1;\n"
+                 "const float kr = %2;\n"
+                 "const float kb = %3;\n"
+                 "const float kg = 1.0 - kr - kb;\n"
+                 "\n").arg(vertical_subsampling ? "true" : "false",
+                            QString::number(static_cast<double>(kPackedYUVKr)),
+                            QString::number(static_cast<double>(kPackedYUVKb)));
+}
+
+ShaderPtr ShaderGenerator::YUVPackPipeline(bool vertical_subsampling)
+{
+  QString function_name = "yuv_pack";
+
+  QString shader_code = PackedYUVCommonCode(vertical_subsampling);
+
+  // Each output texel holds three consecutive samples of one plane. Luma rows come first, then chroma rows with the U
+  // samples in the first `chroma_texels` texels and V after them. Chroma samples sit between the 2 (or 2x2) pixels
+  // they cover, so the source's bilinear filtering averages them.
+  shader_code.append(QString("vec3 source_rgb(vec2 pos) {\n"
+                             "  vec3 rgb = clamp(texture2D(texture, min(pos, source_size - 0.5) / source_size).rgb,"
+                             " 0.0, 1.0);\n"
+                             "  return mix(rgb * 12.92, 1.055 * pow(rgb, vec3(1.0 / 2.4)) - 0.055,"
+                             " step(vec3(0.0031308), rgb));\n"
+                             "}\n"
+                             "\n"
+                             "float luma(vec3 rgb) {\n"
+                             "  return dot(rgb, vec3(kr, kg, kb));\n"
+                             "}\n"
+                             "\n"
+                             "float chroma(vec3 rgb, bool v) {\n"
+                             "  float y = luma(rgb);\n"
+                             "  return (v ? (rgb.r - y) / (2.0 * (1.0 - kr)) : (rgb.b - y) / (2.0 * (1.0 - kb))) + 0.5;\n"
+                             "}\n"
+                             "\n"
+                             "vec4 %1(vec4 col) {\n"
+                             "  vec2 texel = floor(v_texcoord * packed_size);\n"
+                             "  vec3 samples;\n"
+                             "\n"
+                             "  if (texel.y < source_size.y) {\n"
+                             "    float x = texel.x * 3.0;\n"
+                             "    float row = texel.y + 0.5;\n"
+                             "    samples = vec3(luma(source_rgb(vec2(x + 0.5, row))),\n"
+                             "                   luma(source_rgb(vec2(x + 1.5, row))),\n"
+                             "                   luma(source_rgb(vec2(x + 2.5, row))));\n"
+                             "  } else {\n"
+                             "    bool v = (texel.x >= chroma_texels);\n"
+                             "    float x = (texel.x - (v ? chroma_texels : 0.0)) * 6.0;\n"
+                             "    float cy = texel.y - source_size.y;\n"
+                             "    float row = vertical_subsampling ? cy * 2.0 + 1.0 : cy + 0.5;\n"
+                             "    samples = vec3(chroma(source_rgb(vec2(x + 1.0, row)), v),\n"
+                             "                   chroma(source_rgb(vec2(x + 3.0, row)), v),\n"
+                             "                   chroma(source_rgb(vec2(x + 5.0, row)), v));\n"
+                             "  }\n"
+                             "\n"
+                             "  return vec4(samples, 1.0);\n"
+                             "}\n").arg(function_name));
+
+  return DefaultPipeline(function_name, shader_code);
+}
+
+ShaderPtr ShaderGenerator::YUVUnpackPipeline(bool vertical_subsampling)
+{
+  QString function_name = "yuv_unpack";
+
+  QString shader_code = PackedYUVCommonCode(vertical_subsampling);
+
+  shader_code.append(QString("float fetch(float index, float row, float texel_offset) {\n"
+                             "  float texel = floor(index / 3.0);\n"
+                             "  float component = index - texel * 3.0;\n"
+                             "  vec3 samples = texture2D(texture, vec2(texel + texel_offset + 0.5, row + 0.5) / packed_size).rgb;\n"
+                             "  return dot(samples, vec3(equal(vec3(component), vec3(0.0, 1.0, 2.0))));\n"
+                             "}\n"
+                             "\n"
+                             "float chroma(vec2 pos, float texel_offset) {\n"
+                             "  vec2 p = clamp(pos, vec2(0.0), chroma_size - 1.0);\n"
+                             "  vec2 p0 = floor(p);\n"
+                             "  vec2 p1 = min(p0 + 1.0, chroma_size - 1.0);\n"
+                             "  vec2 f = p - p0;\n"
+                             "  float top = mix(fetch(p0.x, source_size.y + p0.y, texel_offset),\n"
+                             "                  fetch(p1.x, source_size.y + p0.y, texel_offset), f.x);\n"
+                             "  float bottom = mix(fetch(p0.x, source_size.y + p1.y, texel_offset),\n"
+                             "                     fetch(p1.x, source_size.y + p1.y, texel_offset), f.x);\n"
+                             "  return mix(top, bottom, f.y) - 0.5;\n"
+                             "}\n"
+                             "\n"
+                             "vec4 %1(vec4 col) {\n"
+                             "  vec2 pixel = floor(v_texcoord * source_size);\n"
+                             "  vec2 pos = vec2((pixel.x + 0.5) * 0.5 - 0.5,"
+                             " vertical_subsampling ? (pixel.y + 0.5) * 0.5 - 0.5 : pixel.y);\n"
+                             "\n"
+                             "  float y = fetch(pixel.x, pixel.y, 0.0);\n"
+                             "  float u = chroma(pos, 0.0);\n"
+                             "  float v = chroma(pos, chroma_texels);\n"
+                             "\n"
+                             "  vec3 rgb = vec3(y + 2.0 * (1.0 - kr) * v,\n"
+                             "                  y - 2.0 * kb * (1.0 - kb) / kg * u - 2.0 * kr * (1.0 - kr) / kg * v,\n"
+                             "                  y + 2.0 * (1.0 - kb) * u);\n"
+                             "  rgb = clamp(rgb, 0.0, 1.0);\n"
+                             "\n"
+                             "  // Back from sRGB to the linear values that were packed\n"
+                             "  rgb = mix(rgb / 12.92, pow((rgb + 0.055) / 1.055, vec3(2.4)), step(vec3(0.04045), rgb));\n"
+                             "\n"
+                             "  return vec4(rgb, 1.0);\n"
+                             "}\n").arg(function_name));
+
+  return DefaultPipeline(function_name, shader_code);
+}
+
+ShaderPtr ShaderGenerator::CompositePipeline(int layer_count)
+{
+  QString function_name = "composite";
+
+  QString shader_code;
+
+  for (int i=0;i<layer_count;i++) {
+    if (i > 0) {
+      shader_code.append(QString("uniform sampler2D layer%1;\n").arg(i));
+    }
+
+    shader_code.append(QString("uniform float layer%1_opacity;\n").arg(i));
+  }
+
+  // Layer 0 is the standard `texture` sampler, every layer after it goes over the result so far (all premultiplied)
+  shader_code.append(QString("\n"
+                             "vec4 %1(vec4 col) {\n"
+                             "  vec4 layer;\n"
+                             "  col *= layer0_opacity;\n").arg(function_name));
+
+  for (int i=1;i<layer_count;i++) {
+    shader_code.append(QString("  layer = texture2D(layer%1, v_texcoord) * layer%1_opacity;\n"
+                               "  col = layer + col * (1.0 - layer.a);\n").arg(i));
+  }
+
+  shader_code.append("  return col;\n"
+                     "}\n");
+
+  ShaderPtr program = DefaultPipeline(function_name, shader_code);
+
+  program->bind();
+
+  for (int i=0;i<layer_count;i++) {
+    if (i > 0) {
+      program->setUniformValue(QString("layer%1").arg(i).toUtf8().constData(), i);
+    }
+
+    program->setUniformValue(QString("layer%1_opacity").arg(i).toUtf8().constData(), 1.0f);
+  }
+
+  program->release();
+
+  return program;
+}
+
+bool ShaderGenerator::SupportsCompute(QOpenGLContext *ctx)
+{
+  return QOpenGLShader::hasOpenGLShaders(QOpenGLShader::Compute, ctx);
+}
+
+ShaderPtr ShaderGenerator::ComputePipeline(const QString &kernel_code, const PixelFormat &format)
+{
+  QString image_format;
+
+  switch (format) {
+  case PIX_FMT_RGBA8:
+    image_format = "rgba8";
+    break;
+  case PIX_FMT_RGBA16U:
+    image_format = "rgba16";
+    break;
+  case PIX_FMT_RGBA16F:
+    image_format = "rgba16f";
+    break;
+  case PIX_FMT_RGBA32F:
+    image_format = "rgba32f";
+    break;
+  case PIX_FMT_RGB10A2:
+    // Not an image format OpenGL ES can write to
+    if (QOpenGLContext::currentContext()->isOpenGLES()) {
+      return nullptr;
+    }
+
+    image_format = "rgb10_a2";
+    break;
+  case PIX_FMT_INVALID:
+  case PIX_FMT_COUNT:
+    return nullptr;
+  }
+
+  QString version = QOpenGLContext::currentContext()->isOpenGLES() ? "#version 310 es\n"
+                                                                    : "#version 430\n";
+
+  QString compute_shader = QString("%1"
+                                   "\n"
+                                   "#ifdef GL_ES\n"
+                                   "precision highp int;\n"
+                                   "precision highp float;\n"
+                                   "precision highp image2D;\n"
+                                   "#endif\n"
+                                   "\n"
+                                   "layout(local_size_x = %2, local_size_y = %2) in;\n"
+                                   "\n"
+                                   "uniform sampler2D input_texture;\n"
+                                   "layout(binding = 0, %3) writeonly uniform image2D output_image;\n"
+                                   "uniform ivec2 output_size;\n"
+                                   "\n").arg(version, QString::number(kComputeLocalSize), image_format);
+
+  compute_shader.append(kernel_code);
+
+  ShaderPtr program = std::make_shared<QOpenGLShaderProgram>();
+
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Compute, compute_shader) || !program->link()) {
+    qWarning() << "Failed to compile compute pipeline:" << program->log();
+    return nullptr;
+  }
+
+  return program;
+}
+
+ShaderPtr ShaderGenerator::BlockCompressPipeline()
+{
+  QOpenGLContext* ctx = QOpenGLContext::currentContext();
+
+  if (!SupportsCompute(ctx)) {
+    return nullptr;
+  }
+
+  QString version = ctx->isOpenGLES() ? "#version 310 es\n"
+                                      : "#version 430\n";
+
+  QString compute_shader = QString("%1"
+                                   "\n"
+                                   "#ifdef GL_ES\n"
+                                   "precision highp int;\n"
+                                   "precision highp float;\n"
+                                   "precision highp uimage2D;\n"
+                                   "#endif\n"
+                                   "\n"
+                                   "layout(local_size_x = %2, local_size_y = %2) in;\n"
+                                   "\n"
+                                   "uniform sampler2D input_texture;\n"
+                                   "layout(binding = 0, rgba32ui) writeonly uniform uimage2D output_image;\n"
+                                   "uniform ivec2 output_size;\n"
+                                   "\n"
+                                   "vec3 to_srgb(vec3 c) {\n"
+                                   "  c = clamp(c, 0.0, 1.0);\n"
+                                   "  return mix(c * 12.92, 1.055 * pow(c, vec3(1.0 / 2.4)) - 0.055,\n"
+                                   "             step(vec3(0.0031308), c));\n"
+                                   "}\n"
+                                   "\n"
+                                   // Endpoints are 7 bits per channel plus a p-bit shared by the channels as the
+                                   // lowest bit, so pick whichever p-bit reproduces the 8-bit endpoint best
+                                   "uvec4 quantize(vec4 e, out uint pbit) {\n"
+                                   "  vec4 q0 = clamp(floor(e * 0.5 + 0.5), 0.0, 127.0);\n"
+                                   "  vec4 q1 = clamp(floor((e - 1.0) * 0.5 + 0.5), 0.0, 127.0);\n"
+                                   "  vec4 d0 = q0 * 2.0 - e;\n"
+                                   "  vec4 d1 = q1 * 2.0 + 1.0 - e;\n"
+                                   "  if (dot(d1, d1) < dot(d0, d0)) {\n"
+                                   "    pbit = 1u;\n"
+                                   "    return uvec4(q1);\n"
+                                   "  }\n"
+                                   "  pbit = 0u;\n"
+                                   "  return uvec4(q0);\n"
+                                   "}\n"
+                                   "\n"
+                                   "void put_bits(inout uvec4 block, inout int offset, uint value, int count) {\n"
+                                   "  int word = offset >> 5;\n"
+                                   "  int shift = offset & 31;\n"
+                                   "  block[word] |= value << uint(shift);\n"
+                                   "  if (shift + count > 32) {\n"
+                                   "    block[word + 1] |= value >> uint(32 - shift);\n"
+                                   "  }\n"
+                                   "  offset += count;\n"
+                                   "}\n"
+                                   "\n"
+                                   "void main() {\n"
+                                   "  ivec2 pos = ivec2(gl_GlobalInvocationID.xy);\n"
+                                   "\n"
+                                   "  if (pos.x >= output_size.x || pos.y >= output_size.y) {\n"
+                                   "    return;\n"
+                                   "  }\n"
+                                   "\n"
+                                   // Blocks hanging off the edge of the frame repeat its last row and column
+                                   "  ivec2 last_pixel = textureSize(input_texture, 0) - 1;\n"
+                                   "  vec4 px[16];\n"
+                                   "  vec4 mean = vec4(0.0);\n"
+                                   "\n"
+                                   "  for (int i=0;i<16;i++) {\n"
+                                   "    vec4 c = texelFetch(input_texture, min(pos * 4 + ivec2(i & 3, i >> 2), last_pixel), 0);\n"
+                                   "    px[i] = vec4(to_srgb(c.rgb), clamp(c.a, 0.0, 1.0)) * 255.0;\n"
+                                   "    mean += px[i];\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  mean *= 1.0 / 16.0;\n"
+                                   "\n"
+                                   // Find the block's principal axis by power iteration on its covariance
+                                   "  mat4 cov = mat4(0.0);\n"
+                                   "  for (int i=0;i<16;i++) {\n"
+                                   "    vec4 d = px[i] - mean;\n"
+                                   "    cov += outerProduct(d, d);\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  vec4 axis = vec4(1.0);\n"
+                                   "  for (int i=0;i<8;i++) {\n"
+                                   "    axis = cov * axis;\n"
+                                   "    float len = length(axis);\n"
+                                   "    axis = (len > 0.0001) ? axis / len : vec4(0.0);\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  float t_min = 0.0;\n"
+                                   "  float t_max = 0.0;\n"
+                                   "  for (int i=0;i<16;i++) {\n"
+                                   "    float t = dot(px[i] - mean, axis);\n"
+                                   "    t_min = min(t_min, t);\n"
+                                   "    t_max = max(t_max, t);\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  uint p0, p1;\n"
+                                   "  uvec4 e0 = quantize(clamp(mean + axis * t_min, 0.0, 255.0), p0);\n"
+                                   "  uvec4 e1 = quantize(clamp(mean + axis * t_max, 0.0, 255.0), p1);\n"
+                                   "\n"
+                                   // Project each pixel onto the line between the endpoints as they'll be decoded
+                                   "  vec4 r0 = vec4(e0 * 2u + p0);\n"
+                                   "  vec4 line = vec4(e1 * 2u + p1) - r0;\n"
+                                   "  float line_length = dot(line, line);\n"
+                                   "\n"
+                                   "  uint indices[16];\n"
+                                   "  for (int i=0;i<16;i++) {\n"
+                                   "    float t = (line_length > 0.0) ? dot(px[i] - r0, line) / line_length : 0.0;\n"
+                                   "    indices[i] = uint(clamp(floor(t * 15.0 + 0.5), 0.0, 15.0));\n"
+                                   "  }\n"
+                                   "\n"
+                                   // The first index is stored without its top bit, so it has to be below 8
+                                   "  if (indices[0] > 7u) {\n"
+                                   "    uvec4 e = e0;\n"
+                                   "    e0 = e1;\n"
+                                   "    e1 = e;\n"
+                                   "    uint p = p0;\n"
+                                   "    p0 = p1;\n"
+                                   "    p1 = p;\n"
+                                   "    for (int i=0;i<16;i++) {\n"
+                                   "      indices[i] = 15u - indices[i];\n"
+                                   "    }\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  uvec4 block = uvec4(0u);\n"
+                                   "  int offset = 0;\n"
+                                   "\n"
+                                   // Mode 6 is six zero bits followed by a one
+                                   "  put_bits(block, offset, 64u, 7);\n"
+                                   "  for (int c=0;c<4;c++) {\n"
+                                   "    put_bits(block, offset, e0[c], 7);\n"
+                                   "    put_bits(block, offset, e1[c], 7);\n"
+                                   "  }\n"
+                                   "  put_bits(block, offset, p0, 1);\n"
+                                   "  put_bits(block, offset, p1, 1);\n"
+                                   "  put_bits(block, offset, indices[0], 3);\n"
+                                   "  for (int i=1;i<16;i++) {\n"
+                                   "    put_bits(block, offset, indices[i], 4);\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  imageStore(output_image, pos, block);\n"
+                                   "}\n").arg(version, QString::number(kComputeLocalSize));
+
+  ShaderPtr program = std::make_shared<QOpenGLShaderProgram>();
+
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Compute, compute_shader) || !program->link()) {
+    qWarning() << "Failed to compile block compression pipeline:" << program->log();
+    return nullptr;
+  }
+
+  return program;
+}
+
+ShaderPtr ShaderGenerator::ScopeAccumulatePipeline(ScopeType type)
+{
+  if (!SupportsCompute(QOpenGLContext::currentContext())) {
+    return nullptr;
+  }
+
+  QString compute_shader = QString("#version 430\n"
+                                   "\n"
+                                   "layout(local_size_x = %1, local_size_y = %1) in;\n"
+                                   "\n"
+                                   "uniform sampler2D input_texture;\n"
+                                   "layout(binding = 0, r32ui) uniform uimage2D accumulation;\n"
+                                   "uniform ivec2 grid_size;\n"
+                                   "uniform int sample_step;\n"
+                                   "uniform bool clear_pass;\n"
+                                   "\n"
+                                   "const vec3 luma_coeffs = vec3(0.2126, 0.7152, 0.0722);\n"
+                                   "\n"
+                                   "int level(float v, int levels) {\n"
+                                   "  return int(clamp(v, 0.0, 1.0) * float(levels - 1) + 0.5);\n"
+                                   "}\n"
+                                   "\n"
+                                   "void main() {\n"
+                                   "  ivec2 pos = ivec2(gl_GlobalInvocationID.xy);\n"
+                                   "\n"
+                                   "  if (pos.x >= grid_size.x || pos.y >= grid_size.y) {\n"
+                                   "    return;\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  if (clear_pass) {\n"
+                                   "    imageStore(accumulation, pos, uvec4(0u));\n"
+                                   "    return;\n"
+                                   "  }\n"
+                                   "\n"
+                                   "  vec3 col = texelFetch(input_texture, pos * sample_step, 0).rgb;\n"
+                                   "  ivec2 size = imageSize(accumulation);\n"
+                                   "\n").arg(kComputeLocalSize);
+
+  switch (type) {
+  case kScopeWaveform:
+    compute_shader.append("  int x = pos.x * size.x / grid_size.x;\n"
+                          "  imageAtomicAdd(accumulation, ivec2(x, level(dot(col, luma_coeffs), size.y)), 1u);\n");
+    break;
+  case kScopeParade:
+    // Each channel gets its own third of the image
+    compute_shader.append("  int width = size.x / 3;\n"
+                          "  int x = pos.x * width / grid_size.x;\n"
+                          "  for (int i=0;i<3;i++) {\n"
+                          "    imageAtomicAdd(accumulation, ivec2(x + width * i, level(col[i], size.y)), 1u);\n"
+                          "  }\n");
+    break;
+  case kScopeVectorscope:
+    // Rec. 709 chroma, centered in the image
+    compute_shader.append("  float cb = dot(col, vec3(-0.1146, -0.3854, 0.5)) + 0.5;\n"
+                          "  float cr = dot(col, vec3(0.5, -0.4542, -0.0458)) + 0.5;\n"
+                          "  imageAtomicAdd(accumulation, ivec2(level(cb, size.x), level(cr, size.y)), 1u);\n");
+    break;
+  case kScopeHistogram:
+    // One row of bins per channel, then luma
+    compute_shader.append("  for (int i=0;i<3;i++) {\n"
+                          "    imageAtomicAdd(accumulation, ivec2(level(col[i], size.x), i), 1u);\n"
+                          "  }\n"
+                          "  imageAtomicAdd(accumulation, ivec2(level(dot(col, luma_coeffs), size.x), 3), 1u);\n");
+    break;
+  case kScopeTypeCount:
+    return nullptr;
+  }
+
+  compute_shader.append("}\n");
+
+  ShaderPtr program = std::make_shared<QOpenGLShaderProgram>();
+
+  if (!program->addShaderFromSourceCode(QOpenGLShader::Compute, compute_shader) || !program->link()) {
+    qWarning() << "Failed to compile scope pipeline:" << program->log();
+    return nullptr;
+  }
+
+  return program;
+}
+
+ShaderPtr ShaderGenerator::ScopeDisplayPipeline(ScopeType type)
+{
+  // Integer textures need GLSL 1.30 and up, this is only used alongside ScopeAccumulatePipeline() anyway
+  QString vert_shader = "#version 430\n"
+                        "\n"
+                        "uniform mat4 mvp_matrix;\n"
+                        "\n"
+                        "in vec4 a_position;\n"
+                        "in vec2 a_texcoord;\n"
+                        "\n"
+                        "out vec2 v_texcoord;\n"
+                        "\n"
+                        "void main() {\n"
+                        "  gl_Position = mvp_matrix * a_position;\n"
+                        "  v_texcoord = a_texcoord;\n"
+                        "}\n";
+
+  QString frag_shader = "#version 430\n"
+                        "\n"
+                        "uniform usampler2D accumulation;\n"
+                        "uniform float normalization;\n"
+                        "\n"
+                        "in vec2 v_texcoord;\n"
+                        "\n"
+                        "out vec4 frag_color;\n"
+                        "\n"
+                        "float bin(int row) {\n"
+                        "  ivec2 size = textureSize(accumulation, 0);\n"
+                        "  ivec2 pos = ivec2(v_texcoord * vec2(size));\n"
+                        "  if (row >= 0) {\n"
+                        "    pos.y = row;\n"
+                        "  }\n"
+                        "  return float(texelFetch(accumulation, clamp(pos, ivec2(0), size - 1), 0).r);\n"
+                        "}\n"
+                        "\n"
+                        // Counts vary over several orders of magnitude, so traces are drawn on a log scale
+                        "float intensity(float count) {\n"
+                        "  return clamp(log2(1.0 + count) / log2(1.0 + normalization), 0.0, 1.0);\n"
+                        "}\n"
+                        "\n"
+                        "void main() {\n";
+
+  switch (type) {
+  case kScopeWaveform:
+    frag_shader.append("  float i = intensity(bin(-1));\n"
+                       "  frag_color = vec4(i * 0.4, i, i * 0.5, 1.0);\n");
+    break;
+  case kScopeParade:
+    frag_shader.append("  int channel = min(int(v_texcoord.x * 3.0), 2);\n"
+                       "  vec3 tint = vec3(channel == 0 ? 1.0 : 0.2, channel == 1 ? 1.0 : 0.2, "
+                       "channel == 2 ? 1.0 : 0.2);\n"
+                       "  frag_color = vec4(tint * intensity(bin(-1)), 1.0);\n");
+    break;
+  case kScopeVectorscope:
+    frag_shader.append("  float i = intensity(bin(-1));\n"
+                       "  vec2 centered = v_texcoord - vec2(0.5);\n"
+                       "  float graticule = (abs(length(centered) - 0.45) < 0.003) ? 0.25 : 0.0;\n"
+                       "  frag_color = vec4(vec3(max(i, graticule)), 1.0);\n");
+    break;
+  case kScopeHistogram:
+    // Channels are overlaid as bars, so overlapping ones mix
+    frag_shader.append("  vec3 color = vec3(0.0);\n"
+                       "  vec3 tints[4] = vec3[4](vec3(0.8, 0.1, 0.1), vec3(0.1, 0.8, 0.1), vec3(0.1, 0.1, 0.8), "
+                       "vec3(0.35));\n"
+                       "  for (int i=0;i<4;i++) {\n"
+                       "    if (v_texcoord.y < bin(i) / normalization) {\n"
+                       "      color += tints[i];\n"
+                       "    }\n"
+                       "  }\n"
+                       "  frag_color = vec4(min(color, vec3(1.0)), 1.0);\n");
+    break;
+  case kScopeTypeCount:
+    return nullptr;
+  }
+
+  frag_shader.append("}\n");
+
+  ShaderPtr program = std::make_shared<QOpenGLShaderProgram>();
+
+  program->addShaderFromSourceCode(QOpenGLShader::Vertex, vert_shader);
+  program->addShaderFromSourceCode(QOpenGLShader::Fragment, frag_shader);
+
+  if (!program->link()) {
+    qWarning() << "Failed to compile scope display pipeline:" << program->log();
+    return nullptr;
+  }
+
+  return program;
+}
+
 QString ShaderGenerator::AlphaDisassociateFunction(const QString &function_name)
 {
   return QString("vec4 %1(vec4 col) {\n"
@@ -146,14 +821,19 @@ const int OCIO_LUT3D_EDGE_SIZE = 32;
 // copied from source code to OCIODisplay, expanded from 3*LUT3D_EDGE_SIZE*LUT3D_EDGE_SIZE*LUT3D_EDGE_SIZE
 const int OCIO_NUM_3D_ENTRIES = 98304;
 
-ShaderPtr ShaderGenerator::OCIOPipeline(QOpenGLContext* ctx,
-                                     GLuint& lut_texture,
-                                     OCIO::ConstProcessorRcPtr processor,
-                                     bool alpha_is_associated)
+void ShaderGenerator::SetUpOCIOShaderDesc(OCIO::GpuShaderDesc &desc)
 {
+  desc.setLanguage(OCIO::GPU_LANGUAGE_GLSL_1_0);
+  desc.setFunctionName("OCIODisplay");
+  desc.setLut3DEdgeLen(OCIO_LUT3D_EDGE_SIZE);
+}
 
+GLuint ShaderGenerator::CreateOCIOLut(QOpenGLContext *ctx, OCIO::ConstProcessorRcPtr processor)
+{
   QOpenGLExtraFunctions* xf = ctx->extraFunctions();
 
+  GLuint lut_texture;
+
   // Create LUT texture
   xf->glGenTextures(1, &lut_texture);
 
@@ -173,18 +853,11 @@ ShaderPtr ShaderGenerator::OCIOPipeline(QOpenGLContext* ctx,
                    0, GL_RGB,GL_FLOAT, nullptr);
 
   //
-  // SET UP GLSL SHADER
+  // COMPUTE 3D LUT
   //
 
   OCIO::GpuShaderDesc shaderDesc;
-  const char* ocio_func_name = "OCIODisplay";
-  shaderDesc.setLanguage(OCIO::GPU_LANGUAGE_GLSL_1_0);
-  shaderDesc.setFunctionName(ocio_func_name);
-  shaderDesc.setLut3DEdgeLen(OCIO_LUT3D_EDGE_SIZE);
-
-  //
-  // COMPUTE 3D LUT
-  //
+  SetUpOCIOShaderDesc(shaderDesc);
 
   GLfloat* ocio_lut_data = new GLfloat[OCIO_NUM_3D_ENTRIES];
   processor->getGpuLut3D(ocio_lut_data, shaderDesc);
@@ -197,6 +870,24 @@ ShaderPtr ShaderGenerator::OCIOPipeline(QOpenGLContext* ctx,
 
   delete [] ocio_lut_data;
 
+  // Release LUT
+  xf->glBindTexture(GL_TEXTURE_3D, 0);
+
+  return lut_texture;
+}
+
+ShaderPtr ShaderGenerator::OCIOPipeline(OCIO::ConstProcessorRcPtr processor,
+                                        bool alpha_is_associated)
+{
+  //
+  // SET UP GLSL SHADER
+  //
+
+  OCIO::GpuShaderDesc shaderDesc;
+  SetUpOCIOShaderDesc(shaderDesc);
+
+  QString ocio_func_name = shaderDesc.getFunctionName();
+
   // Create OCIO shader code
   QString shader_text(processor->getGpuShaderText(shaderDesc));
 
@@ -243,12 +934,7 @@ ShaderPtr ShaderGenerator::OCIOPipeline(QOpenGLContext* ctx,
 
 
   // Get pipeline-based shader to inject OCIO shader into
-  ShaderPtr shader = ShaderGenerator::DefaultPipeline(process_function_name, shader_text);
-
-  // Release LUT
-  xf->glBindTexture(GL_TEXTURE_3D, 0);
-
-  return shader;
+  return ShaderGenerator::DefaultPipeline(process_function_name, shader_text);
 }
 
 }
@@ -24,6 +24,9 @@
 #include <OpenColorIO/OpenColorIO.h>
 namespace OCIO = OCIO_NAMESPACE::v1;
 
+#include "render/pixelformat.h"
+#include "render/scopetype.h"
+#include "render/yuvformat.h"
 #include "shaderptr.h"
 
 /**
@@ -36,15 +39,125 @@ namespace OCIO = OCIO_NAMESPACE::v1;
 
 namespace olive {
 
+/**
+ * @brief Width and height of the work groups compute pipelines are dispatched in (see ComputePipeline())
+ */
+const int kComputeLocalSize = 16;
+
 class ShaderGenerator {
 public:
   static ShaderPtr DefaultPipeline(const QString &function_name = QString(), const QString &shader_code = QString());
 
-  static ShaderPtr OCIOPipeline(QOpenGLContext *ctx,
-                                GLuint &lut_texture,
-                                OCIO::ConstProcessorRcPtr processor,
+  /**
+   * @brief Create a pipeline that performs an OCIO transform (and alpha association)
+   *
+   * The pipeline samples the transform's 3D LUT (see CreateOCIOLut()) from texture unit 2. Rather than calling this
+   * directly, use ShaderCache::OCIOPipeline() which compiles it and creates the LUT only once per context.
+   */
+  static ShaderPtr OCIOPipeline(OCIO::ConstProcessorRcPtr processor,
                                 bool alpha_is_associated);
 
+  /**
+   * @brief Create and upload the 3D LUT texture used by an OCIOPipeline()
+   *
+   * `ctx` must be current. The caller takes ownership of the texture.
+   */
+  static GLuint CreateOCIOLut(QOpenGLContext *ctx,
+                              OCIO::ConstProcessorRcPtr processor);
+
+  /**
+   * @brief Set up a shader description the way OCIOPipeline() and CreateOCIOLut() use it
+   *
+   * Useful for retrieving matching cache IDs from an OCIO processor.
+   */
+  static void SetUpOCIOShaderDesc(OCIO::GpuShaderDesc& desc);
+
+  /**
+   * @brief Create a pipeline that converts a PlanarTexture's YUV planes to RGBA
+   *
+   * The luma plane is read from the standard `texture` sampler (unit 0) and the chroma plane(s) from units 1 and 2
+   * (see PlanarTexture::Bind()). The output is RGB in whatever transfer function the source uses, color management
+   * still needs to be performed afterwards.
+   *
+   * YUV_LAYOUT_PACKED_RGB10 frames have a single plane, the pipeline unpacks its 10-bit RGB words instead.
+   */
+  static ShaderPtr YUVPipeline(const YUVInfo& info);
+
+  /**
+   * @brief Create a pipeline that packs a frame into 10-bit 4:2:2 (or 4:2:0 with `vertical_subsampling`) YUV
+   *
+   * Drawn into an RGB10_A2 texture laid out as described by YUVPacker, with the frame bound to the standard `texture`
+   * sampler (unit 0). Colors are clipped to 0.0-1.0 and sRGB encoded before conversion with BT.709 coefficients, and
+   * alpha is dropped. Expects the `source_size`, `packed_size`, `chroma_size` and `chroma_texels` uniforms to be set.
+   */
+  static ShaderPtr YUVPackPipeline(bool vertical_subsampling);
+
+  /**
+   * @brief Create a pipeline that reverses YUVPackPipeline(), drawing the packed texture (unit 0) back to RGBA
+   *
+   * Chroma is upsampled bilinearly. Takes the same uniforms as YUVPackPipeline().
+   */
+  static ShaderPtr YUVUnpackPipeline(bool vertical_subsampling);
+
+  /**
+   * @brief Create a pipeline that composites `layer_count` premultiplied textures bottom-up in a single pass
+   *
+   * Layer 0 (the bottom) is read from the standard `texture` sampler (unit 0) and layer `i` from the `layer<i>` sampler
+   * (unit `i`). Each layer is scaled by its `layer<i>_opacity` uniform before being drawn "alpha over" the layers
+   * below it, the result is premultiplied too.
+   */
+  static ShaderPtr CompositePipeline(int layer_count);
+
+  /**
+   * @brief Returns TRUE if compute pipelines can be used in this context (OpenGL 4.3 or OpenGL ES 3.1)
+   *
+   * Olive only requires OpenGL 3.2, so anything using ComputePipeline() needs a fragment shader fallback for when this
+   * returns FALSE. `ctx` must be current.
+   */
+  static bool SupportsCompute(QOpenGLContext* ctx);
+
+  /**
+   * @brief Create a compute pipeline from a kernel, run with RenderInstance::Dispatch()
+   *
+   * The kernel provides main() and is run in kComputeLocalSize x kComputeLocalSize work groups (so it can use
+   * `shared` memory across a group) covering the destination texture. It reads its input from the `input_texture`
+   * sampler (unit 0), e.g. with texelFetch(), and writes every pixel of the destination at gl_GlobalInvocationID.xy
+   * with imageStore(output_image, ...). Invocations outside `output_size` (an ivec2) must not write anything.
+   *
+   * `format` is the destination's pixel format, which the image has to be declared with. Returns nullptr if the
+   * kernel fails to compile or OpenGL ES can't write to the format, in which case the fallback should be used too.
+   */
+  static ShaderPtr ComputePipeline(const QString& kernel_code, const olive::PixelFormat& format);
+
+  /**
+   * @brief Create a compute pipeline that compresses a frame into BC7 blocks
+   *
+   * Each invocation encodes the 4x4 block at its position of `input_texture` (unit 0) and stores it in an RGBA32UI
+   * image (binding 0) as one texel, the first 32 bits of the block in red and so on. Invocations outside `output_size`
+   * (the size of the image, in blocks) write nothing. Colors are clipped to 0.0-1.0 and sRGB encoded, so the blocks are
+   * meant to be sampled as GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM. Every block uses mode 6 (a single RGBA line with
+   * 4-bit indices) with endpoints fitted to the block's principal axis. Returns nullptr if compute shaders aren't
+   * supported.
+   */
+  static ShaderPtr BlockCompressPipeline();
+
+  /**
+   * @brief Create a compute pipeline that accumulates a scope of a frame into an R32UI image (binding 0)
+   *
+   * Dispatched over `grid_size` invocations, each of which adds the pixel at its position times `sample_step` in
+   * `input_texture` (unit 0) to its bins with atomic adds. With `clear_pass` set, the dispatch should cover the
+   * image instead and every bin is reset to 0. Returns nullptr if compute shaders aren't supported.
+   */
+  static ShaderPtr ScopeAccumulatePipeline(ScopeType type);
+
+  /**
+   * @brief Create a pipeline that draws the bins accumulated by ScopeAccumulatePipeline()
+   *
+   * The bins are read from the `accumulation` sampler (unit 0) and are brightest (or tallest for histograms) once they
+   * reach the `normalization` uniform.
+   */
+  static ShaderPtr ScopeDisplayPipeline(ScopeType type);
+
   static QString AlphaDisassociateFunction(const QString& function_name);
   static QString AlphaReassociateFunction(const QString& function_name);
   static QString AlphaAssociateFunction(const QString& function_name);
@@ -0,0 +1,124 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "uploadring.h"
+
+QHash<QOpenGLContext*, UploadRing*> UploadRing::instances_;
+QMutex UploadRing::instances_lock_;
+
+UploadRing *UploadRing::Get(QOpenGLContext *ctx)
+{
+  QMutexLocker locker(&instances_lock_);
+
+  UploadRing* ring = instances_.value(ctx);
+
+  if (ring == nullptr) {
+    ring = new UploadRing(ctx);
+    instances_.insert(ctx, ring);
+  }
+
+  return ring;
+}
+
+void *UploadRing::Map(qint64 size)
+{
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  current_ = (current_ + 1) % kUploadBufferCount;
+
+  Buffer& b = buffers_[current_];
+
+  if (b.fence != nullptr) {
+    // Normally long signalled, this only blocks if uploads are outpacing the GPU
+    xf->glClientWaitSync(b.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    xf->glDeleteSync(b.fence);
+    b.fence = nullptr;
+  }
+
+  if (b.buffer == 0) {
+    xf->glGenBuffers(1, &b.buffer);
+  }
+
+  xf->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, b.buffer);
+
+  if (b.size < size) {
+    xf->glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_DRAW);
+    b.size = size;
+  }
+
+  // Invalidating lets the driver hand us fresh memory rather than synchronizing with any earlier use of the buffer
+  void* data = xf->glMapBufferRange(GL_PIXEL_UNPACK_BUFFER,
+                                    0,
+                                    static_cast<GLsizeiptr>(size),
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+  if (data == nullptr) {
+    xf->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  return data;
+}
+
+void UploadRing::Unmap()
+{
+  ctx_->extraFunctions()->glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+}
+
+void UploadRing::Release()
+{
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  buffers_[current_].fence = xf->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  xf->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+UploadRing::UploadRing(QOpenGLContext *ctx) :
+  ctx_(ctx),
+  current_(0)
+{
+  for (int i=0;i<kUploadBufferCount;i++) {
+    buffers_[i].buffer = 0;
+    buffers_[i].size = 0;
+    buffers_[i].fence = nullptr;
+  }
+
+  connect(ctx_, SIGNAL(aboutToBeDestroyed()), this, SLOT(ContextDestroyed()), Qt::DirectConnection);
+}
+
+void UploadRing::ContextDestroyed()
+{
+  instances_lock_.lock();
+  instances_.remove(ctx_);
+  instances_lock_.unlock();
+
+  // The context is current while aboutToBeDestroyed() is emitted
+  QOpenGLExtraFunctions* xf = ctx_->extraFunctions();
+
+  for (int i=0;i<kUploadBufferCount;i++) {
+    if (buffers_[i].fence != nullptr) {
+      xf->glDeleteSync(buffers_[i].fence);
+    }
+
+    xf->glDeleteBuffers(1, &buffers_[i].buffer);
+  }
+
+  delete this;
+}
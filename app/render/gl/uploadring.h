@@ -0,0 +1,96 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef UPLOADRING_H
+#define UPLOADRING_H
+
+#include <QHash>
+#include <QMutex>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#include "config/config.h"
+
+/**
+ * @brief A ring of pixel unpack buffers used to upload textures asynchronously, created once per context
+ *
+ * glTexSubImage2D() from client memory stalls the calling thread while the driver copies the data. Writing the pixels
+ * into a mapped pixel buffer instead and uploading from there lets the driver transfer them in the background. Each
+ * buffer is fenced after use and only reused once the GPU is done with it, so a few uploads can be in flight at once.
+ * Everything is destroyed along with the context.
+ */
+class UploadRing : public QObject
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief Retrieve the ring belonging to this context, creating it if it doesn't exist yet
+   *
+   * `ctx` must be current.
+   */
+  static UploadRing* Get(QOpenGLContext* ctx);
+
+  /**
+   * @brief Map the next buffer in the ring for writing at least `size` bytes
+   *
+   * Waits for the GPU only if the buffer is still being read from an upload a full ring ago. Must be followed by Unmap()
+   * and Release().
+   *
+   * @return Pointer to write to, or nullptr if mapping failed (in which case upload from client memory instead).
+   */
+  void* Map(qint64 size);
+
+  /**
+   * @brief Unmap the buffer from Map() and leave it bound to GL_PIXEL_UNPACK_BUFFER
+   *
+   * Uploads issued while it's bound (with a data offset rather than a pointer) read from the buffer.
+   */
+  void Unmap();
+
+  /**
+   * @brief Fence the uploads that read from the current buffer and unbind it
+   */
+  void Release();
+
+private:
+  UploadRing(QOpenGLContext* ctx);
+
+  struct Buffer {
+    GLuint buffer;
+    qint64 size;
+    GLsync fence;
+  };
+
+  QOpenGLContext* ctx_;
+
+  Buffer buffers_[kUploadBufferCount];
+
+  int current_;
+
+  static QHash<QOpenGLContext*, UploadRing*> instances_;
+
+  static QMutex instances_lock_;
+
+private slots:
+  void ContextDestroyed();
+
+};
+
+#endif // UPLOADRING_H
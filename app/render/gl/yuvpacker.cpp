@@ -0,0 +1,161 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "yuvpacker.h"
+
+#include <QOpenGLFunctions>
+
+#include "functions.h"
+#include "shadergenerators.h"
+
+YUVPacker::YUVPacker(bool vertical_subsampling) :
+  vertical_subsampling_(vertical_subsampling)
+{
+  pack_pipeline_ = olive::ShaderGenerator::YUVPackPipeline(vertical_subsampling_);
+  unpack_pipeline_ = olive::ShaderGenerator::YUVUnpackPipeline(vertical_subsampling_);
+}
+
+/**
+ * @brief Returns the number of texels needed to hold `samples` samples, three to a texel
+ */
+static int GetTexelCount(int samples)
+{
+  return (samples + 2) / 3;
+}
+
+/**
+ * @brief Chroma is always halved horizontally, odd widths round up so the last column keeps its chroma
+ */
+static int GetChromaWidth(int width)
+{
+  return (width + 1) / 2;
+}
+
+static int GetChromaHeight(int height, bool vertical_subsampling)
+{
+  return vertical_subsampling ? (height + 1) / 2 : height;
+}
+
+int YUVPacker::GetPackedWidth(int width)
+{
+  // Chroma rows hold both the U and V samples
+  return qMax(GetTexelCount(width), GetTexelCount(GetChromaWidth(width)) * 2);
+}
+
+int YUVPacker::GetPackedHeight(int height, bool vertical_subsampling)
+{
+  return height + GetChromaHeight(height, vertical_subsampling);
+}
+
+int YUVPacker::GetPackedSize(int width, int height, bool vertical_subsampling)
+{
+  return GetPackedWidth(width) * GetPackedHeight(height, vertical_subsampling) * 4;
+}
+
+RenderTexturePtr YUVPacker::Pack(RenderInstance *instance, RenderTexturePtr texture)
+{
+  QOpenGLFunctions* f = instance->context()->functions();
+
+  int width = texture->width();
+  int height = texture->height();
+  int packed_width = GetPackedWidth(width);
+  int packed_height = GetPackedHeight(height, vertical_subsampling_);
+
+  RenderTexturePtr packed = instance->texture_pool()->Get(packed_width,
+                                                          packed_height,
+                                                          olive::PIX_FMT_RGB10A2,
+                                                          RenderTexture::kSingleBuffer);
+
+  // The texture was rendered in another context, make sure the GPU has finished it before we read from it
+  texture->WaitFence();
+
+  SetUniforms(pack_pipeline_, width, height);
+
+  f->glBlendFunc(GL_ONE, GL_ZERO);
+
+  instance->buffer()->Attach(packed);
+  instance->buffer()->Bind();
+  f->glViewport(0, 0, packed_width, packed_height);
+
+  texture->Bind();
+
+  olive::gl::Blit(pack_pipeline_);
+
+  texture->Release();
+
+  f->glViewport(0, 0, instance->width(), instance->height());
+  instance->buffer()->Detach();
+  instance->buffer()->Release();
+
+  return packed;
+}
+
+RenderTexturePtr YUVPacker::Unpack(RenderInstance *instance, const QByteArray &packed)
+{
+  QOpenGLFunctions* f = instance->context()->functions();
+
+  int width = instance->width();
+  int height = instance->height();
+
+  RenderTexturePtr packed_tex = instance->texture_pool()->Get(GetPackedWidth(width),
+                                                              GetPackedHeight(height, vertical_subsampling_),
+                                                              olive::PIX_FMT_RGB10A2,
+                                                              RenderTexture::kSingleBuffer);
+
+  packed_tex->Upload(packed.constData());
+
+  RenderTexturePtr texture = instance->texture_pool()->Get(width,
+                                                           height,
+                                                           instance->format(),
+                                                           RenderTexture::kSingleBuffer);
+
+  SetUniforms(unpack_pipeline_, width, height);
+
+  f->glBlendFunc(GL_ONE, GL_ZERO);
+
+  instance->buffer()->Attach(texture);
+  instance->buffer()->Bind();
+  f->glViewport(0, 0, width, height);
+
+  packed_tex->Bind();
+
+  olive::gl::Blit(unpack_pipeline_);
+
+  packed_tex->Release();
+
+  instance->buffer()->Detach();
+  instance->buffer()->Release();
+
+  return texture;
+}
+
+void YUVPacker::SetUniforms(ShaderPtr pipeline, int width, int height)
+{
+  pipeline->bind();
+  pipeline->setUniformValue("source_size", static_cast<float>(width), static_cast<float>(height));
+  pipeline->setUniformValue("packed_size",
+                            static_cast<float>(GetPackedWidth(width)),
+                            static_cast<float>(GetPackedHeight(height, vertical_subsampling_)));
+  pipeline->setUniformValue("chroma_size",
+                            static_cast<float>(GetChromaWidth(width)),
+                            static_cast<float>(GetChromaHeight(height, vertical_subsampling_)));
+  pipeline->setUniformValue("chroma_texels", static_cast<float>(GetTexelCount(GetChromaWidth(width))));
+  pipeline->release();
+}
@@ -0,0 +1,87 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef YUVPACKER_H
+#define YUVPACKER_H
+
+#include "render/renderinstance.h"
+#include "render/rendertexture.h"
+#include "shaderptr.h"
+
+/**
+ * @brief Packs rendered frames into 10-bit YUV on the GPU so less has to be read back and cached, and unpacks them
+ *
+ * Used for olive::kCacheFormatYUV422 and olive::kCacheFormatYUV420. A frame is drawn by
+ * ShaderGenerator::YUVPackPipeline() into an RGB10_A2 texture (PIX_FMT_RGB10A2) where every texel holds three
+ * consecutive 10-bit samples of one plane: the luma rows first, then the chroma rows with the U samples at the start
+ * of each row and the V samples after them. That's 2 bytes per pixel for 4:2:0 and 2.67 for 4:2:2, compared to 8 for
+ * RGBA16F. The texture is read back and stored as-is, and drawn back to RGBA by ShaderGenerator::YUVUnpackPipeline()
+ * when played back.
+ *
+ * Create and use the packer with its context current, and only from that context's thread.
+ */
+class YUVPacker
+{
+public:
+  YUVPacker(bool vertical_subsampling);
+
+  YUVPacker(const YUVPacker& other) = delete;
+  YUVPacker& operator=(const YUVPacker& other) = delete;
+
+  /**
+   * @brief Returns the width in texels of the packed texture for a frame `width` pixels wide
+   */
+  static int GetPackedWidth(int width);
+
+  /**
+   * @brief Returns the height in texels of the packed texture for a frame `height` pixels high
+   */
+  static int GetPackedHeight(int height, bool vertical_subsampling);
+
+  /**
+   * @brief Returns the size in bytes of a packed `width` x `height` frame
+   */
+  static int GetPackedSize(int width, int height, bool vertical_subsampling);
+
+  /**
+   * @brief Pack a texture into a new texture from `instance`'s pool
+   *
+   * Waits on the texture's fence on the GPU, so textures rendered in other contexts of the share group can be passed
+   * directly. The result is a PIX_FMT_RGB10A2 texture that can be read back as-is.
+   */
+  RenderTexturePtr Pack(RenderInstance* instance, RenderTexturePtr texture);
+
+  /**
+   * @brief Draw a packed frame (GetPackedSize() bytes) back into a new `instance`-sized texture of its format
+   */
+  RenderTexturePtr Unpack(RenderInstance* instance, const QByteArray& packed);
+
+private:
+  void SetUniforms(ShaderPtr pipeline, int width, int height);
+
+  bool vertical_subsampling_;
+
+  ShaderPtr pack_pipeline_;
+
+  ShaderPtr unpack_pipeline_;
+
+};
+
+#endif // YUVPACKER_H
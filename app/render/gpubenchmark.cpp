@@ -0,0 +1,469 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "gpubenchmark.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QOpenGLFunctions>
+#include <QTextStream>
+
+#include "config/config.h"
+#include "render/colorservice.h"
+#include "render/gl/downloadring.h"
+#include "render/gl/functions.h"
+#include "render/gl/shadercache.h"
+#include "render/pixelservice.h"
+#include "render/renderinstance.h"
+
+/**
+ * @brief Returns the name of a pixel format as given to `--format`
+ */
+static QString FormatName(const olive::PixelFormat& format)
+{
+  switch (format) {
+  case olive::PIX_FMT_RGBA8:
+    return QStringLiteral("rgba8");
+  case olive::PIX_FMT_RGBA16U:
+    return QStringLiteral("rgba16u");
+  case olive::PIX_FMT_RGBA16F:
+    return QStringLiteral("rgba16f");
+  case olive::PIX_FMT_RGBA32F:
+    return QStringLiteral("rgba32f");
+  case olive::PIX_FMT_RGB10A2:
+    return QStringLiteral("rgb10a2");
+  case olive::PIX_FMT_INVALID:
+  case olive::PIX_FMT_COUNT:
+    break;
+  }
+
+  return QString();
+}
+
+/**
+ * @brief Returns nanoseconds in milliseconds
+ */
+static double ToMilliseconds(qint64 ns)
+{
+  return static_cast<double>(ns) / 1000000.0;
+}
+
+GPUBenchmark::GPUBenchmark()
+{
+  sizes_.append(QSize(1920, 1080));
+  sizes_.append(QSize(3840, 2160));
+
+  formats_.append(olive::PIX_FMT_RGBA8);
+  formats_.append(olive::PIX_FMT_RGBA16F);
+  formats_.append(olive::PIX_FMT_RGBA32F);
+}
+
+void GPUBenchmark::set_sizes(const QVector<QSize> &sizes)
+{
+  sizes_ = sizes;
+}
+
+void GPUBenchmark::set_formats(const QVector<olive::PixelFormat> &formats)
+{
+  formats_ = formats;
+}
+
+bool GPUBenchmark::Run()
+{
+  if (sizes_.isEmpty() || formats_.isEmpty()) {
+    error_ = tr("No resolutions or pixel formats to benchmark");
+    return false;
+  }
+
+  int max_width = 0;
+  int max_height = 0;
+
+  foreach (const QSize& size, sizes_) {
+    if (size.width() < 1 || size.height() < 1) {
+      error_ = tr("Invalid benchmark resolution");
+      return false;
+    }
+
+    max_width = qMax(max_width, size.width());
+    max_height = qMax(max_height, size.height());
+  }
+
+  foreach (const olive::PixelFormat& format, formats_) {
+    if (format <= olive::PIX_FMT_INVALID || format >= olive::PIX_FMT_COUNT) {
+      error_ = tr("Invalid benchmark pixel format");
+      return false;
+    }
+  }
+
+  results_.clear();
+
+  // Only the instance's context, buffer and pipelines are used, the viewport is set for each case
+  RenderInstance instance(max_width, max_height, 1, formats_.first(), olive::RenderMode::kOffline);
+
+  if (!instance.Start()) {
+    error_ = tr("Failed to create an OpenGL context to benchmark");
+    return false;
+  }
+
+  QOpenGLFunctions* f = instance.context()->functions();
+
+  vendor_ = QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_VENDOR)));
+  renderer_ = QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_RENDERER)));
+  version_ = QString::fromLatin1(reinterpret_cast<const char*>(f->glGetString(GL_VERSION)));
+
+  foreach (const QSize& size, sizes_) {
+    foreach (const olive::PixelFormat& format, formats_) {
+      RunCase(&instance, size.width(), size.height(), format);
+    }
+  }
+
+  instance.Stop();
+
+  return true;
+}
+
+const QString &GPUBenchmark::error() const
+{
+  return error_;
+}
+
+const QVector<GPUBenchmark::Result> &GPUBenchmark::results() const
+{
+  return results_;
+}
+
+QString GPUBenchmark::Report() const
+{
+  QStringList lines;
+
+  lines.append(tr("%1 (%2, %3)").arg(renderer_, vendor_, version_));
+
+  lines.append(tr("Test\tVariant\tSize\tFormat\tSubmit (ms)\tTime (ms)\tGB/s"));
+
+  foreach (const Result& r, results_) {
+    lines.append(QStringLiteral("%1\t%2\t%3x%4\t%5\t%6\t%7\t%8").arg(
+                   r.test,
+                   r.variant,
+                   QString::number(r.width),
+                   QString::number(r.height),
+                   FormatName(r.format),
+                   QString::number(r.submit_time, 'f', 3),
+                   QString::number(r.time, 'f', 3),
+                   QString::number(r.bandwidth, 'f', 2)));
+  }
+
+  return lines.join('\n');
+}
+
+bool GPUBenchmark::WriteReport(const QString &filename) const
+{
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    return false;
+  }
+
+  if (filename.endsWith(QStringLiteral(".json"), Qt::CaseInsensitive)) {
+    QJsonArray tests;
+
+    foreach (const Result& r, results_) {
+      QJsonObject o;
+      o.insert("test", r.test);
+      o.insert("variant", r.variant);
+      o.insert("width", r.width);
+      o.insert("height", r.height);
+      o.insert("format", FormatName(r.format));
+      o.insert("iterations", r.iterations);
+      o.insert("submit_ms", r.submit_time);
+      o.insert("time_ms", r.time);
+      o.insert("gb_per_s", r.bandwidth);
+      tests.append(o);
+    }
+
+    QJsonObject root;
+    root.insert("vendor", vendor_);
+    root.insert("renderer", renderer_);
+    root.insert("version", version_);
+    root.insert("tests", tests);
+
+    file.write(QJsonDocument(root).toJson());
+  } else {
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+
+    stream << "test,variant,width,height,format,iterations,submit_ms,time_ms,gb_per_s\n";
+
+    foreach (const Result& r, results_) {
+      stream << r.test << ','
+             << r.variant << ','
+             << r.width << ','
+             << r.height << ','
+             << FormatName(r.format) << ','
+             << r.iterations << ','
+             << QString::number(r.submit_time, 'f', 4) << ','
+             << QString::number(r.time, 'f', 4) << ','
+             << QString::number(r.bandwidth, 'f', 3) << '\n';
+    }
+
+    stream.flush();
+  }
+
+  return file.error() == QFile::NoError;
+}
+
+void GPUBenchmark::RunCase(RenderInstance *instance, int width, int height, const olive::PixelFormat &format)
+{
+  QOpenGLContext* ctx = instance->context();
+  QOpenGLFunctions* f = ctx->functions();
+  RenderFramebuffer* buffer = instance->buffer();
+  ShaderPtr pipeline = instance->default_pipeline();
+
+  f->glViewport(0, 0, width, height);
+
+  qint64 frame_size = PixelService::GetBufferSize(format, width, height);
+
+  // Mid-grey with some alpha is a valid value in every format, and avoids anything special-casing zeros
+  QByteArray pixels(static_cast<int>(frame_size), static_cast<char>(0x5A));
+
+  RenderTexturePtr source = instance->texture_pool()->Get(width, height, format, RenderTexture::kDoubleBuffer);
+  RenderTexturePtr destination = instance->texture_pool()->Get(width, height, format, RenderTexture::kSingleBuffer);
+
+  source->UploadDirect(pixels.constData(), PixelService::BytesPerPixel(format) * width);
+
+  // Uploads
+  Measure(instance, QStringLiteral("upload"), QStringLiteral("direct"), width, height, format, frame_size,
+          [&]() {
+    destination->UploadDirect(pixels.constData(), PixelService::BytesPerPixel(format) * width);
+  });
+
+  Measure(instance, QStringLiteral("upload"), QStringLiteral("pbo"), width, height, format, frame_size,
+          [&]() {
+    destination->Upload(pixels.constData());
+  });
+
+  // Readbacks
+  Measure(instance, QStringLiteral("readback"), QStringLiteral("sync"), width, height, format, frame_size,
+          [&]() {
+    delete [] source->Download();
+  });
+
+  {
+    DownloadRing ring(ctx, kDownloadBufferCount);
+
+    Measure(instance, QStringLiteral("readback"), QStringLiteral("async"), width, height, format, frame_size,
+            [&]() {
+      if (ring.IsFull()) {
+        ring.Finish();
+      }
+
+      ring.Start(source);
+    },
+    [&]() {
+      while (!ring.IsEmpty()) {
+        ring.Finish();
+      }
+    });
+  }
+
+  // Blits, each replacing the destination like most passes do
+  buffer->Attach(destination);
+  buffer->Bind();
+  source->Bind();
+
+  f->glBlendFunc(GL_ONE, GL_ZERO);
+
+  Measure(instance, QStringLiteral("blit"), QStringLiteral("default"), width, height, format, frame_size,
+          [&]() {
+    olive::gl::Blit(pipeline);
+  });
+
+  QMatrix4x4 half;
+  half.scale(0.5f);
+
+  Measure(instance, QStringLiteral("blit"), QStringLiteral("minified"), width, height, format, frame_size / 4,
+          [&]() {
+    olive::gl::Blit(pipeline, false, half, true);
+  });
+
+  try {
+    GLuint lut;
+    ShaderPtr ocio_pipeline = ShaderCache::Get(ctx)->OCIOPipeline(
+          ColorService::Get(OCIO::ROLE_SCENE_LINEAR, "srgb")->GetProcessor(), true, &lut);
+
+    if (ocio_pipeline != nullptr) {
+      Measure(instance, QStringLiteral("blit"), QStringLiteral("ocio"), width, height, format, frame_size,
+              [&]() {
+        olive::gl::OCIOBlit(ocio_pipeline, lut);
+      });
+    }
+  } catch (OCIO::Exception& exception) {
+    qWarning() << "Skipping OCIO blit benchmark:" << exception.what();
+  }
+
+  source->Release();
+  buffer->Release();
+  buffer->Detach();
+
+  // The passes drawn by the built-in nodes
+  Measure(instance, QStringLiteral("node"), QStringLiteral("solid"), width, height, format, frame_size,
+          [&]() {
+    buffer->Attach(destination);
+    buffer->Bind();
+
+    f->glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    f->glClear(GL_COLOR_BUFFER_BIT);
+
+    buffer->Release();
+    buffer->Detach();
+  });
+
+  Measure(instance, QStringLiteral("node"), QStringLiteral("opacity"), width, height, format, frame_size,
+          [&]() {
+    source->set_pending_opacity(0.5f);
+    source = instance->ResolvePendingOps(source);
+  });
+
+  Measure(instance, QStringLiteral("node"), QStringLiteral("alphaover"), width, height, format, frame_size,
+          [&]() {
+    buffer->Attach(destination);
+    buffer->Bind();
+    source->Bind();
+
+    f->glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    olive::gl::Blit(pipeline);
+
+    source->Release();
+    buffer->Release();
+    buffer->Detach();
+  });
+
+  // TimelineOutput composites up to kMaxCompositeLayers tracks in one pass
+  QVector<RenderTexturePtr> layers;
+
+  for (int i=0;i<kMaxCompositeLayers;i++) {
+    RenderTexturePtr layer = instance->texture_pool()->Get(width, height, format, RenderTexture::kSingleBuffer);
+    layer->UploadDirect(pixels.constData(), PixelService::BytesPerPixel(format) * width);
+    layers.append(layer);
+  }
+
+  for (int count=2;count<=kMaxCompositeLayers;count*=2) {
+    ShaderPtr composite = ShaderCache::Get(ctx)->CompositePipeline(count);
+
+    Measure(instance, QStringLiteral("node"), QStringLiteral("composite%1").arg(count), width, height, format,
+            frame_size, [&]() {
+      buffer->Attach(destination);
+      buffer->Bind();
+
+      composite->bind();
+
+      for (int i=0;i<count;i++) {
+        f->glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        layers.at(i)->Bind();
+
+        composite->setUniformValue(QString("layer%1_opacity").arg(i).toUtf8().constData(), 1.0f);
+      }
+
+      f->glActiveTexture(GL_TEXTURE0);
+
+      composite->release();
+
+      f->glBlendFunc(GL_ONE, GL_ZERO);
+
+      olive::gl::Blit(composite);
+
+      for (int i=count-1;i>=0;i--) {
+        f->glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+        layers.at(i)->Release();
+      }
+
+      f->glActiveTexture(GL_TEXTURE0);
+
+      buffer->Release();
+      buffer->Detach();
+    });
+  }
+}
+
+void GPUBenchmark::Measure(RenderInstance *instance,
+                           const QString &test,
+                           const QString &variant,
+                           int width,
+                           int height,
+                           const olive::PixelFormat &format,
+                           qint64 bytes,
+                           const std::function<void ()> &op,
+                           const std::function<void ()> &finish)
+{
+  QOpenGLFunctions* f = instance->context()->functions();
+
+  for (int i=0;i<kGPUBenchmarkWarmup;i++) {
+    op();
+  }
+
+  if (finish) {
+    finish();
+  }
+
+  f->glFinish();
+
+  QElapsedTimer timer;
+  QElapsedTimer submit_timer;
+  qint64 submit_elapsed = 0;
+
+  timer.start();
+
+  for (int i=0;i<kGPUBenchmarkIterations;i++) {
+    submit_timer.start();
+
+    op();
+
+    submit_elapsed += submit_timer.nsecsElapsed();
+  }
+
+  if (finish) {
+    finish();
+  }
+
+  f->glFinish();
+
+  qint64 elapsed = timer.nsecsElapsed();
+
+  Result result;
+  result.test = test;
+  result.variant = variant;
+  result.width = width;
+  result.height = height;
+  result.format = format;
+  result.iterations = kGPUBenchmarkIterations;
+  result.submit_time = ToMilliseconds(submit_elapsed) / kGPUBenchmarkIterations;
+  result.time = ToMilliseconds(elapsed) / kGPUBenchmarkIterations;
+  result.bandwidth = 0.0;
+
+  if (elapsed > 0) {
+    result.bandwidth = static_cast<double>(bytes) * kGPUBenchmarkIterations / static_cast<double>(elapsed);
+  }
+
+  results_.append(result);
+}
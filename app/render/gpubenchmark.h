@@ -0,0 +1,150 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef GPUBENCHMARK_H
+#define GPUBENCHMARK_H
+
+#include <functional>
+#include <QCoreApplication>
+#include <QSize>
+#include <QVector>
+
+#include "render/pixelformat.h"
+
+class RenderInstance;
+
+/**
+ * @brief Measures the raw GPU paths frames take on this machine, without any nodes or media
+ *
+ * Every test runs at each resolution and pixel format on an offscreen context:
+ *
+ * - Uploading a frame, both straight from client memory and through a pixel buffer (see RenderTexture::Upload())
+ * - Reading a frame back, both synchronously with RenderTexture::Download() and asynchronously through a
+ *   DownloadRing like RendererDownloadThread
+ * - olive::gl::Blit() (as is, and minified with mipmaps) and olive::gl::OCIOBlit() with the viewer's transform
+ * - The passes drawn by the built-in nodes: SolidGenerator's clear, resolving deferred opacity, AlphaOverBlend and
+ *   TimelineOutput's composite
+ *
+ * Each test is run a few times untimed and then repeatedly with the GPU left to pipeline the work, reporting how long
+ * the CPU spent issuing each iteration as well as how long each took until the GPU finished it. Used by
+ * `--gpu-benchmark` (see Core::RunHeadless()).
+ */
+class GPUBenchmark
+{
+  Q_DECLARE_TR_FUNCTIONS(GPUBenchmark)
+public:
+  struct Result {
+    /// Path being measured (e.g. "upload") and the way it was taken (e.g. "pbo")
+    QString test;
+    QString variant;
+
+    int width;
+    int height;
+    olive::PixelFormat format;
+
+    int iterations;
+
+    /// Milliseconds per iteration the CPU spent issuing the work
+    double submit_time;
+
+    /// Milliseconds per iteration until the GPU had finished the work
+    double time;
+
+    /// Gigabytes of pixels transferred or drawn per second
+    double bandwidth;
+  };
+
+  GPUBenchmark();
+
+  /**
+   * @brief Set the resolutions to run every test at (1080p and UHD by default)
+   */
+  void set_sizes(const QVector<QSize>& sizes);
+
+  /**
+   * @brief Set the pixel formats to run every test in (8-bit, half-float and float by default)
+   */
+  void set_formats(const QVector<olive::PixelFormat>& formats);
+
+  /**
+   * @brief Run every test, blocking until they're all done
+   *
+   * Must be called from the main thread. Returns FALSE if the benchmark couldn't run, see error().
+   */
+  bool Run();
+
+  const QString& error() const;
+
+  const QVector<Result>& results() const;
+
+  /**
+   * @brief Returns a human-readable table of the results of Run()
+   */
+  QString Report() const;
+
+  /**
+   * @brief Write the results of Run() to a file, as JSON if it ends in ".json" and CSV otherwise
+   */
+  bool WriteReport(const QString& filename) const;
+
+private:
+  /**
+   * @brief Run every test at one resolution and pixel format
+   */
+  void RunCase(RenderInstance* instance, int width, int height, const olive::PixelFormat& format);
+
+  /**
+   * @brief Time `iterations` calls to `op` and append the result
+   *
+   * @param bytes
+   *
+   * Bytes of pixels each call transfers or draws.
+   *
+   * @param finish
+   *
+   * Optionally called once after the timed calls to complete work they left outstanding (e.g. readbacks still in a
+   * ring), counted in the time but not the submit time.
+   */
+  void Measure(RenderInstance* instance,
+               const QString& test,
+               const QString& variant,
+               int width,
+               int height,
+               const olive::PixelFormat& format,
+               qint64 bytes,
+               const std::function<void()>& op,
+               const std::function<void()>& finish = nullptr);
+
+  QVector<QSize> sizes_;
+
+  QVector<olive::PixelFormat> formats_;
+
+  QString error_;
+
+  /// GL_VENDOR, GL_RENDERER and GL_VERSION of the context the tests ran on
+  QString vendor_;
+  QString renderer_;
+  QString version_;
+
+  QVector<Result> results_;
+
+};
+
+#endif // GPUBENCHMARK_H
@@ -0,0 +1,211 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "gpuprofiler.h"
+
+#include "config/config.h"
+
+struct GPUProfiler::Pending {
+  Profiler::Category category;
+
+  int source;
+
+  double frame;
+
+  QOpenGLTimerQuery* begin;
+
+  QOpenGLTimerQuery* end;
+
+  /// Nanoseconds taken by the timers within this one, added as they're resolved (before this one is)
+  qint64 children_duration;
+
+  std::shared_ptr<Pending> parent;
+};
+
+static thread_local GPUProfiler* current_profiler = nullptr;
+
+/**
+ * @brief Innermost GPUTimer running on this thread
+ */
+static thread_local GPUTimer* current_timer = nullptr;
+
+GPUProfiler::GPUProfiler(QOpenGLContext *ctx) :
+  ctx_(ctx),
+  offset_(0),
+  query_count_(0)
+{
+  QOpenGLTimerQuery* query = new QOpenGLTimerQuery();
+
+  supported_ = query->create();
+
+  if (supported_) {
+    // Timestamps are read back later, so match the clocks up now. Reading the GPU's time doesn't wait for it to
+    // finish anything, it just has to get the request.
+    offset_ = olive::profiler.Now() - static_cast<qint64>(query->waitForTimestamp());
+
+    free_queries_.append(query);
+    query_count_++;
+  } else {
+    delete query;
+  }
+}
+
+GPUProfiler::~GPUProfiler()
+{
+  while (!pending_.isEmpty()) {
+    std::shared_ptr<Pending> p = pending_.dequeue();
+
+    free_queries_.append(p->begin);
+    free_queries_.append(p->end);
+  }
+
+  qDeleteAll(free_queries_);
+}
+
+GPUProfiler *GPUProfiler::Current()
+{
+  return current_profiler;
+}
+
+void GPUProfiler::SetCurrent(GPUProfiler *profiler)
+{
+  current_profiler = profiler;
+}
+
+bool GPUProfiler::IsSupported() const
+{
+  return supported_;
+}
+
+void GPUProfiler::Resolve()
+{
+  while (!pending_.isEmpty() && pending_.head()->end->isResultAvailable()) {
+    std::shared_ptr<Pending> p = pending_.dequeue();
+
+    qint64 begin = static_cast<qint64>(p->begin->waitForResult());
+    qint64 duration = static_cast<qint64>(p->end->waitForResult()) - begin;
+
+    if (p->parent != nullptr) {
+      p->parent->children_duration += duration;
+    }
+
+    Profiler::Sample s;
+    s.category = p->category;
+    s.source = p->source;
+    s.frame = p->frame;
+    s.thread = 0;
+    s.start = begin + offset_;
+    s.duration = duration;
+    s.self_duration = duration - p->children_duration;
+
+    olive::profiler.Record(s);
+
+    free_queries_.append(p->begin);
+    free_queries_.append(p->end);
+  }
+}
+
+QOpenGLTimerQuery *GPUProfiler::TakeQuery()
+{
+  if (!free_queries_.isEmpty()) {
+    return free_queries_.takeLast();
+  }
+
+  // Results that never come back (e.g. nothing calls Resolve()) shouldn't grow the pool forever
+  if (query_count_ >= kGPUProfilerMaxQueries) {
+    return nullptr;
+  }
+
+  QOpenGLTimerQuery* query = new QOpenGLTimerQuery();
+
+  if (!query->create()) {
+    delete query;
+    return nullptr;
+  }
+
+  query_count_++;
+
+  return query;
+}
+
+GPUTimer::GPUTimer(Profiler::Category category)
+{
+  if (current_timer != nullptr && current_timer->pending_ != nullptr) {
+    Begin(category, current_timer->pending_->source, current_timer->pending_->frame);
+  } else {
+    Begin(category, -1, -1.0);
+  }
+}
+
+GPUTimer::GPUTimer(Profiler::Category category, int source, const rational &frame)
+{
+  Begin(category, source, frame.toDouble());
+}
+
+GPUTimer::~GPUTimer()
+{
+  if (pending_ == nullptr) {
+    return;
+  }
+
+  current_timer = parent_;
+
+  if (pending_->end != nullptr) {
+    pending_->end->recordTimestamp();
+
+    profiler_->pending_.enqueue(pending_);
+  } else {
+    profiler_->free_queries_.append(pending_->begin);
+  }
+}
+
+void GPUTimer::Begin(Profiler::Category category, int source, double frame)
+{
+  profiler_ = current_profiler;
+  parent_ = nullptr;
+
+  if (profiler_ == nullptr || !profiler_->IsSupported() || !olive::profiler.IsEnabled()) {
+    return;
+  }
+
+  QOpenGLTimerQuery* begin = profiler_->TakeQuery();
+
+  if (begin == nullptr) {
+    return;
+  }
+
+  pending_ = std::make_shared<GPUProfiler::Pending>();
+  pending_->category = category;
+  pending_->source = source;
+  pending_->frame = frame;
+  pending_->begin = begin;
+  pending_->end = profiler_->TakeQuery();
+  pending_->children_duration = 0;
+
+  parent_ = current_timer;
+
+  if (parent_ != nullptr) {
+    pending_->parent = parent_->pending_;
+  }
+
+  current_timer = this;
+
+  begin->recordTimestamp();
+}
@@ -0,0 +1,134 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef GPUPROFILER_H
+#define GPUPROFILER_H
+
+#include <memory>
+#include <QOpenGLContext>
+#include <QOpenGLTimerQuery>
+#include <QQueue>
+#include <QVector>
+
+#include "render/profiler.h"
+
+/**
+ * @brief Times work on the GPU for olive::profiler
+ *
+ * ProfilerTimer only sees how long GL calls take the CPU to queue, so GPU cost is timed separately by GPUTimer with a
+ * pair of GL_TIMESTAMP queries. Results are only ready once the GPU has caught up, so rather than stalling for them,
+ * Resolve() records every sample that's ready (usually a few tasks later) and leaves the rest for next time.
+ *
+ * Each RenderInstance has one for its context and makes it Current() for its thread. Timestamps are converted to
+ * Profiler::Now()'s clock, so GPU samples line up with the CPU samples around them in traces.
+ */
+class GPUProfiler
+{
+public:
+  /**
+   * @brief Create for a context, which must be current
+   */
+  GPUProfiler(QOpenGLContext* ctx);
+
+  /**
+   * @brief Destroy the queries, the context must be current
+   */
+  ~GPUProfiler();
+
+  GPUProfiler(const GPUProfiler& other) = delete;
+  GPUProfiler& operator=(const GPUProfiler& other) = delete;
+
+  /**
+   * @brief Returns the profiler of the calling thread's context, or nullptr if it has none
+   */
+  static GPUProfiler* Current();
+
+  static void SetCurrent(GPUProfiler* profiler);
+
+  /**
+   * @brief Returns TRUE if the context supports timer queries (desktop GL 3.3 or GL_ARB_timer_query)
+   */
+  bool IsSupported() const;
+
+  /**
+   * @brief Record every sample whose queries have a result to olive::profiler without waiting for the rest
+   *
+   * The context must be current.
+   */
+  void Resolve();
+
+private:
+  friend class GPUTimer;
+
+  struct Pending;
+
+  /**
+   * @brief Take a query from the pool, or nullptr if too many are waiting for results already
+   */
+  QOpenGLTimerQuery* TakeQuery();
+
+  QOpenGLContext* ctx_;
+
+  bool supported_;
+
+  /// Profiler::Now() minus the GPU's timestamp at the same moment
+  qint64 offset_;
+
+  QVector<QOpenGLTimerQuery*> free_queries_;
+
+  int query_count_;
+
+  /// Finished timers in the order they finished, which is the order their results become available in
+  QQueue<std::shared_ptr<Pending>> pending_;
+
+};
+
+/**
+ * @brief Times the GPU commands issued in the scope it's declared in with the current thread's GPUProfiler
+ *
+ * Nests like ProfilerTimer: a timer without a source of its own is attributed to the GPUTimer around it, and a timer's
+ * self time excludes the timers within it. Does nothing while olive::profiler is disabled or off render threads.
+ */
+class GPUTimer
+{
+public:
+  /**
+   * @brief Time work for the same source and frame as the timer around it
+   */
+  GPUTimer(Profiler::Category category);
+
+  GPUTimer(Profiler::Category category, int source, const rational& frame);
+
+  ~GPUTimer();
+
+  GPUTimer(const GPUTimer& other) = delete;
+  GPUTimer& operator=(const GPUTimer& other) = delete;
+
+private:
+  void Begin(Profiler::Category category, int source, double frame);
+
+  GPUProfiler* profiler_;
+
+  std::shared_ptr<GPUProfiler::Pending> pending_;
+
+  GPUTimer* parent_;
+};
+
+#endif // GPUPROFILER_H
@@ -20,294 +20,171 @@
 
 #include "imagecache.h"
 
-#include <QDebug>
+#include <limits>
+#include <QtGlobal>
 
-ImageCache::ImageCache() :
-  ctx_(nullptr),
-  width_(0),
-  height_(0)
-{
-}
+#if defined(Q_OS_WIN)
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <unistd.h>
+#endif
 
-ImageCache::~ImageCache()
-{
-  buffer_array_mutex_.lock();
+#include "config/config.h"
 
-  Clear();
+ImageCache olive::image_cache;
 
-  buffer_array_mutex_.unlock();
+ImageCache::Client::~Client()
+{
 }
 
-void ImageCache::SetParameters(QOpenGLContext *ctx, int width, int height)
+ImageCache::ImageCache() :
+  next_client_(0),
+  lock_(QMutex::Recursive)
 {
-  buffer_array_mutex_.lock();
+  budget_[kMemBuf] = kImageCacheMemoryBudget;
 
-  ctx_ = ctx;
+  qint64 system_memory = SystemMemory();
 
-  if (ctx_ != nullptr) {
-    Q_ASSERT(width > 0 && height > 0);
-
-    width_ = width;
-    height_ = height;
+  if (system_memory > 0) {
+    budget_[kMemBuf] = qMin(budget_[kMemBuf], static_cast<qint64>(system_memory * kImageCacheSystemMemoryRatio));
   }
+  budget_[kTexBuf] = kImageCacheTextureBudget;
 
-  Clear();
-
-  buffer_array_mutex_.unlock();
+  for (int i=0;i<kBufferTypeCount;i++) {
+    limit_[i] = std::numeric_limits<qint64>::max();
+    usage_[i] = 0;
+    peak_[i] = 0;
+  }
 }
 
-int ImageCache::RequestBuffer(Ref* r, const BufferType& type, const olive::PixelFormat& format, int width, int height)
+void ImageCache::SetBudget(const ImageCache::BufferType &type, const qint64 &budget)
 {
-  if (type == kTexBuf && (ctx_ == nullptr || width_ == 0 || height_ == 0)) {
-    qWarning() << tr("Texture cache request made without valid parameters (%1: %2, %3").arg(QString::number(reinterpret_cast<quintptr>(ctx_)),
-                                                                                            QString::number(width_),
-                                                                                            QString::number(height_));
-    return -1;
-  }
-
-  buffer_array_mutex_.lock();
-
-  int buffer = RequestBufferInternal(r, type, format, width, height);
+  QMutexLocker locker(&lock_);
 
-  buffer_array_mutex_.unlock();
+  budget_[type] = budget;
 
-  return buffer;
+  // Make room if the new budget is smaller than what's already allocated
+  Allocated(type, 0);
 }
 
-int ImageCache::RequestBufferInternal(Ref *r, const BufferType& type, const olive::PixelFormat& format, int width, int height)
+qint64 ImageCache::budget(const ImageCache::BufferType &type)
 {
-  Q_ASSERT(type != kInvalidBuf);
-
-  QList<int>& relinquished = (type == kMemBuf) ? img_relinquished_ : tex_relinquished_;
-  QList<Ref*>& refs = (type == kMemBuf) ? img_refs_ : tex_refs_;
-  QList<time_t>& access_times = (type == kMemBuf) ? img_access_times_ : tex_access_times_;
-
-  // Try to return a relinquished buffer
-  if (!relinquished.isEmpty()) {
-
-    if (type == kTexBuf) {
-
-      int buf_index = relinquished.takeFirst();
-
-      refs.replace(buf_index, r);
-
-      return buf_index;
-
-    } else if (type == kMemBuf) {
-
-      // Check for a relinquished buffer with the desired size
-
-      //
-      // TODO consider a database for sorting through these buffers
-      //
-      for (int i=0;i<relinquished.size();i++) {
-
-        const MemoryBuffer& b = img_buffers_.at(relinquished.at(i));
-
-        if (b.width() == width && b.height() == height) {
-          // This buffer fits, we'll use it
-          int buffer_index = relinquished.takeAt(i);
-
-          refs.replace(buffer_index, r);
-
-          return buffer_index;
-        }
-      }
-
-    }
-  }
-
-  // If no buffer was available, we may have to create a new one
-
-  // Check if we have enough memory (according to user-defined limits in the Config), if we don't, try to relinquish an
-  // old buffer and return that.
-  if (OutOfMemory()) {
-
-    //
-    // TODO no support for a MemBuf's variable size
-    //
-
-    int least_recent_access = 0;
-
-    // Loop through buffers for the oldest accessed buffer
-    for (int i=1;i<access_times.size();i++) {
-      if (access_times.at(i) < access_times.at(least_recent_access)
-          && refs.at(i) != nullptr) { // ensure this buffer has not been relinquished
-        least_recent_access = i;
-      }
-    }
+  QMutexLocker locker(&lock_);
 
-    // Relinquish this buffer
-    refs.at(least_recent_access)->Relinquish();
-    refs.replace(least_recent_access, r);
-    return least_recent_access;
-  }
+  return budget_[type];
+}
 
-  // Otherwise, just generate a new buffer
-  int index = -1;
-  switch (type) {
-  case kMemBuf:
-    index = img_buffers_.size();
-    img_buffers_.append(MemoryBuffer());
-    img_buffers_.last().Create(width_, height_, format);
-    break;
-  case kTexBuf:
-    index = tex_buffers_.size();
-    tex_buffers_.append(TextureBuffer());
-    tex_buffers_.last().Create(ctx_, format, width_, height_);
-    break;
-  default:
-    Q_ASSERT(false);
-  }
+void ImageCache::SetLimit(const ImageCache::BufferType &type, const qint64 &limit)
+{
+  QMutexLocker locker(&lock_);
 
-  refs.append(r);
-  access_times.append(time(nullptr));
+  limit_[type] = limit;
 
-  return index;
+  Allocated(type, 0);
 }
 
-void ImageCache::RelinquishBuffer(int index, const BufferType &type)
+qint64 ImageCache::usage(const ImageCache::BufferType &type)
 {
-  buffer_array_mutex_.lock();
-
-  switch (type) {
-  case kMemBuf:
-    img_refs_.replace(index, nullptr);
-    img_relinquished_.append(index);
-    break;
-  case kTexBuf:
-    tex_refs_.replace(index, nullptr);
-    tex_relinquished_.append(index);
-    break;
-  default:
-    qFatal("Invalid buffer type on ImageCache::RelinquishBuffer");
-  }
+  QMutexLocker locker(&lock_);
 
-  buffer_array_mutex_.unlock();
+  return usage_[type];
 }
 
-void *ImageCache::Buffer(int index, const BufferType &type)
+qint64 ImageCache::peak(const ImageCache::BufferType &type)
 {
-  switch (type) {
-  case kMemBuf:
-    img_access_times_.replace(index, time(nullptr));
-    return &img_buffers_[index];
-  case kTexBuf:
-    tex_access_times_.replace(index, time(nullptr));
-    return &tex_buffers_[index];
-  default:
-    qFatal("Invalid buffer type on ImageCache::Buffer");
-  }
-}
+  QMutexLocker locker(&lock_);
 
-bool ImageCache::OutOfMemory()
-{
-  // TODO actually check if we have any memory or not
-  return false;
+  return peak_[type];
 }
 
-void ImageCache::Clear()
+void ImageCache::ResetPeak(const ImageCache::BufferType &type)
 {
-  for (int i=0;i<img_refs_.size();i++) {
-    img_refs_.at(i)->Relinquish();
-  }
-
-  for (int i=0;i<tex_refs_.size();i++) {
-    tex_refs_.at(i)->Relinquish();
-  }
-
-  img_refs_.clear();
-  tex_refs_.clear();
+  QMutexLocker locker(&lock_);
 
-  img_buffers_.clear();
-  tex_buffers_.clear();
-
-  img_relinquished_.clear();
-  tex_relinquished_.clear();
+  peak_[type] = usage_[type];
 }
 
-ImageCache::Ref::Ref(ImageCache *cache) :
-  buffer_type_(kInvalidBuf),
-  width_(cache->width_),
-  height_(cache->height_),
-  cache_(cache),
-  buffer_(-1)
+void ImageCache::AddClient(ImageCache::Client *client)
 {
+  QMutexLocker locker(&lock_);
+
+  clients_.append(client);
 }
 
-ImageCache::Ref::~Ref()
+void ImageCache::RemoveClient(ImageCache::Client *client)
 {
-  Relinquish();
+  QMutexLocker locker(&lock_);
+
+  clients_.removeAll(client);
 }
 
-void *ImageCache::Ref::BufferInternal()
+void ImageCache::Allocated(const ImageCache::BufferType &type, const qint64 &bytes)
 {
-  // If we don't have a buffer yet, request one
-  if (buffer_ == -1) {
-    Request();
-  }
+  QMutexLocker locker(&lock_);
 
-  // If we didn't receive one, return null
-  if (buffer_ == -1) {
-    return nullptr;
-  }
+  usage_[type] += bytes;
+  peak_[type] = qMax(peak_[type], usage_[type]);
 
-  // Otherwise, return the buffer we received
-  return cache_->Buffer(buffer_, buffer_type_);
-}
+  // Ask each client once at most, so a client that can't free anything doesn't stall us
+  int attempts = clients_.size();
 
-void ImageCache::Ref::Relinquish()
-{
-  if (buffer_ == -1) {
-    return;
-  }
+  while (usage_[type] > EffectiveBudget(type) && attempts > 0) {
+    next_client_ %= clients_.size();
 
-  cache_->RelinquishBuffer(buffer_, buffer_type_);
-  buffer_ = -1;
-}
+    Client* client = clients_.at(next_client_);
+    qint64 excess = usage_[type] - EffectiveBudget(type);
 
-void ImageCache::Ref::Request()
-{
-  // Check if we already have a buffer, in which case we don't need to request a new one
-  if (buffer_ != -1) {
-    return;
-  }
+    next_client_++;
+    attempts--;
 
-  // Check if we have a valid buffer type to request
-  if (buffer_type_ == kInvalidBuf) {
-    qWarning() << tr("Tried to request an invalid buffer type");
-    return;
+    // Clients will call Freed() from here, which is fine since the lock is recursive
+    client->Evict(type, excess);
   }
-
-  buffer_ = cache_->RequestBuffer(this, buffer_type_, width_, height_);
 }
 
-ImageCache::ImgRef::ImgRef(ImageCache *cache) :
-  Ref(cache)
+void ImageCache::Freed(const ImageCache::BufferType &type, const qint64 &bytes)
 {
-  buffer_type_ = kMemBuf;
+  QMutexLocker locker(&lock_);
+
+  usage_[type] -= bytes;
 }
 
-void ImageCache::ImgRef::SetSize(int w, int h)
+bool ImageCache::OutOfMemory(const ImageCache::BufferType &type)
 {
-  width_ = w;
-  height_ = h;
+  QMutexLocker locker(&lock_);
 
-  Relinquish();
+  return usage_[type] > EffectiveBudget(type);
 }
 
-MemoryBuffer *ImageCache::ImgRef::buffer()
+bool ImageCache::UnderPressure(const ImageCache::BufferType &type)
 {
-  return static_cast<MemoryBuffer*>(BufferInternal());
+  QMutexLocker locker(&lock_);
+
+  return usage_[type] > static_cast<qint64>(EffectiveBudget(type) * kImageCachePressureRatio);
 }
 
-ImageCache::TexRef::TexRef(ImageCache *cache) :
-  Ref(cache)
+qint64 ImageCache::EffectiveBudget(const ImageCache::BufferType &type) const
 {
-  buffer_type_ = kTexBuf;
+  return qMin(budget_[type], limit_[type]);
 }
 
-TextureBuffer *ImageCache::TexRef::buffer()
+qint64 ImageCache::SystemMemory()
 {
-  return static_cast<TextureBuffer*>(BufferInternal());
+#if defined(Q_OS_WIN)
+  MEMORYSTATUSEX status;
+  status.dwLength = sizeof(status);
+
+  if (GlobalMemoryStatusEx(&status)) {
+    return static_cast<qint64>(status.ullTotalPhys);
+  }
+#elif defined(Q_OS_UNIX)
+  long pages = sysconf(_SC_PHYS_PAGES);
+  long page_size = sysconf(_SC_PAGESIZE);
+
+  if (pages > 0 && page_size > 0) {
+    return static_cast<qint64>(pages) * page_size;
+  }
+#endif
+
+  return 0;
 }
@@ -18,94 +18,136 @@
 
 ***/
 
-#ifndef MEMORYCACHE_H
-#define MEMORYCACHE_H
+#ifndef IMAGECACHE_H
+#define IMAGECACHE_H
 
 #include <QList>
 #include <QMutex>
 
-#include "texturebuffer.h"
-#include "memorybuffer.h"
-
-class ImageCache : public QObject
+/**
+ * @brief Central accounting of the image buffers held in system memory and VRAM
+ *
+ * Anything that holds on to image buffers it could free (e.g. RendererMemoryCache's frames or RenderTexturePool's
+ * unused textures) registers itself as a Client and reports every allocation and deallocation with Allocated() and
+ * Freed(). Whenever an allocation takes a buffer type over its budget, clients are asked to evict buffers (starting
+ * with the client after the one that was asked last time) until usage is back within budget.
+ *
+ * Buffers that are in use and can't be evicted (e.g. decoded frames from FrameBufferPool) are reported too, so that
+ * they still count towards the budget and push out buffers that can be freed. Producers that allocate ahead of time
+ * (e.g. DecoderPrefetcher or RendererProcessor's frames in flight) check UnderPressure() and hold back while usage is
+ * close to the budget, so eviction isn't all that keeps usage in check.
+ *
+ * The system memory budget defaults to kImageCacheMemoryBudget, or kImageCacheSystemMemoryRatio of the system's
+ * physical memory if that's less, so smaller machines don't start swapping.
+ *
+ * Clients are evicted from with the image cache's (recursive) lock held so that RemoveClient() can't return while a
+ * client is still being evicted from. Clients must therefore never hold their own locks while calling Allocated() or
+ * Freed(), otherwise two threads could deadlock. This class is thread-safe.
+ */
+class ImageCache
 {
 public:
-
   enum BufferType {
-    kInvalidBuf,  // No buffer
     kMemBuf,      // RAM (CPU) buffer
-    kTexBuf       // VRAM (GPU) buffer
+    kTexBuf,      // VRAM (GPU) buffer
+    kBufferTypeCount
   };
 
-  class Ref {
+  /**
+   * @brief Interface for anything holding buffers that can be freed when memory runs out
+   */
+  class Client
+  {
   public:
-    Ref(ImageCache* cache);
-    ~Ref();
+    virtual ~Client();
+
+    /**
+     * @brief Free approximately `bytes` of buffers of this type that aren't in use
+     *
+     * Implementations should report what they free with Freed() as usual.
+     */
+    virtual void Evict(const BufferType& type, const qint64& bytes) = 0;
+  };
 
-    void Relinquish();
-  protected:
-    void* BufferInternal();
+  ImageCache();
 
-    BufferType buffer_type_;
+  /**
+   * @brief Set the maximum number of bytes that can be used by buffers of this type
+   */
+  void SetBudget(const BufferType& type, const qint64& budget);
 
-    int width_;
-    int height_;
-  private:
-    void Request();
+  qint64 budget(const BufferType& type);
 
-    ImageCache* cache_;
-    int buffer_;
-  };
+  /**
+   * @brief Temporarily hold buffers of this type to less than their budget (e.g. while VRAM is short, see VRAMMonitor)
+   *
+   * The smaller of the budget and the limit is used for eviction and pressure. Unlimited by default.
+   */
+  void SetLimit(const BufferType& type, const qint64& limit);
 
-  class ImgRef : public Ref {
-  public:
-    ImgRef(ImageCache* cache);
+  qint64 usage(const BufferType& type);
 
-    void SetSize(int w, int h);
+  /**
+   * @brief Returns the most bytes buffers of this type have used at once since ResetPeak()
+   */
+  qint64 peak(const BufferType& type);
 
-    MemoryBuffer* buffer();
+  void ResetPeak(const BufferType& type);
 
-  };
+  void AddClient(Client* client);
 
-  class TexRef : public Ref {
-  public:
-    TexRef(ImageCache* cache);
-    TextureBuffer* buffer();
-  };
+  void RemoveClient(Client* client);
 
-  ImageCache();
-  ~ImageCache();
+  /**
+   * @brief Report a new buffer, evicting buffers from clients if it takes this type over budget
+   */
+  void Allocated(const BufferType& type, const qint64& bytes);
 
-  void SetParameters(QOpenGLContext* ctx, int width, int height);
+  /**
+   * @brief Report a buffer being freed
+   */
+  void Freed(const BufferType& type, const qint64& bytes);
 
-private:
-  int RequestBuffer(Ref *r, const BufferType& type, const olive::PixelFormat &format, int width, int height);
-  int RequestBufferInternal(Ref *r, const BufferType& type, const olive::PixelFormat &format, int width, int height);
+  /**
+   * @brief Returns TRUE if buffers of this type are using more than their budget
+   */
+  bool OutOfMemory(const BufferType& type);
 
-  void RelinquishBuffer(int index, const BufferType& type);
+  /**
+   * @brief Returns TRUE if buffers of this type are using more than kImageCachePressureRatio of their budget
+   */
+  bool UnderPressure(const BufferType& type);
 
-  void *Buffer(int index, const BufferType &type);
+  /**
+   * @brief Returns the amount of physical memory in the system in bytes, or 0 if it couldn't be determined
+   */
+  static qint64 SystemMemory();
 
-  bool OutOfMemory();
+private:
+  /**
+   * @brief The smaller of the budget and limit of this type, assumes lock_ is already locked
+   */
+  qint64 EffectiveBudget(const BufferType& type) const;
 
-  void Clear();
+  qint64 budget_[kBufferTypeCount];
 
-  QList<MemoryBuffer> img_buffers_;
-  QList<Ref*> img_refs_;
-  QList<time_t> img_access_times_;
-  QList<int> img_relinquished_;
+  qint64 limit_[kBufferTypeCount];
 
-  QList<TextureBuffer> tex_buffers_;
-  QList<Ref*> tex_refs_;
-  QList<time_t> tex_access_times_;
-  QList<int> tex_relinquished_;
+  qint64 usage_[kBufferTypeCount];
 
-  QOpenGLContext* ctx_;
+  qint64 peak_[kBufferTypeCount];
 
-  int width_;
-  int height_;
+  QList<Client*> clients_;
+
+  /// Index of the next client to ask for eviction
+  int next_client_;
+
+  QMutex lock_;
 
-  QMutex buffer_array_mutex_;
 };
 
-#endif // MEMORYCACHE_H
+namespace olive {
+extern ImageCache image_cache;
+}
+
+#endif // IMAGECACHE_H
@@ -0,0 +1,893 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "pixelconversion.h"
+
+#include <cstring>
+#include <QFloat16>
+#include <QtGlobal>
+
+#include "common/define.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define OLIVE_PIXEL_X86
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#define OLIVE_PIXEL_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+using ToFloatKernel = void (*)(const void*, float*, int);
+using FromFloatKernel = void (*)(const float*, void*, int);
+using MultiplyAlphaKernel = void (*)(float*, int, bool);
+using DivideAlphaKernel = void (*)(float*, int);
+using FillAlphaKernel = void (*)(uint8_t*, int, const uint8_t*, const uint8_t*);
+
+/**
+ * @brief Size of the alpha/mask patterns given to fill alpha kernels, a multiple of every pixel size
+ */
+const int kFillAlphaPatternSize = 16;
+
+float Clamp01(float f)
+{
+  // Written so that NaN ends up as 0
+  return (f > 0.0f) ? ((f < 1.0f) ? f : 1.0f) : 0.0f;
+}
+
+//
+// Scalar reference kernels
+//
+
+void U8ToF32Scalar(const void* src, float* dst, int count)
+{
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+
+  for (int i=0;i<count;i++) {
+    dst[i] = static_cast<float>(s[i]) * (1.0f / 255.0f);
+  }
+}
+
+void U16ToF32Scalar(const void* src, float* dst, int count)
+{
+  const uint16_t* s = static_cast<const uint16_t*>(src);
+
+  for (int i=0;i<count;i++) {
+    dst[i] = static_cast<float>(s[i]) * (1.0f / 65535.0f);
+  }
+}
+
+void F16ToF32Scalar(const void* src, float* dst, int count)
+{
+  const qfloat16* s = static_cast<const qfloat16*>(src);
+
+  for (int i=0;i<count;i++) {
+    dst[i] = static_cast<float>(s[i]);
+  }
+}
+
+void F32ToU8Scalar(const float* src, void* dst, int count)
+{
+  uint8_t* d = static_cast<uint8_t*>(dst);
+
+  for (int i=0;i<count;i++) {
+    d[i] = static_cast<uint8_t>(Clamp01(src[i]) * 255.0f + 0.5f);
+  }
+}
+
+void F32ToU16Scalar(const float* src, void* dst, int count)
+{
+  uint16_t* d = static_cast<uint16_t*>(dst);
+
+  for (int i=0;i<count;i++) {
+    d[i] = static_cast<uint16_t>(Clamp01(src[i]) * 65535.0f + 0.5f);
+  }
+}
+
+void F32ToF16Scalar(const float* src, void* dst, int count)
+{
+  qfloat16* d = static_cast<qfloat16*>(dst);
+
+  for (int i=0;i<count;i++) {
+    d[i] = qfloat16(src[i]);
+  }
+}
+
+/**
+ * @brief Packed 10-bit kernels take a channel count like the others, but read/write one 32-bit word per 4 channels
+ */
+void RGB10A2ToF32Scalar(const void* src, float* dst, int count)
+{
+  const uint32_t* s = static_cast<const uint32_t*>(src);
+
+  for (int i=0;i+kRGBAChannels<=count;i+=kRGBAChannels) {
+    uint32_t word = s[i / kRGBAChannels];
+
+    dst[i] = static_cast<float>(word & 0x3FF) * (1.0f / 1023.0f);
+    dst[i+1] = static_cast<float>((word >> 10) & 0x3FF) * (1.0f / 1023.0f);
+    dst[i+2] = static_cast<float>((word >> 20) & 0x3FF) * (1.0f / 1023.0f);
+    dst[i+3] = static_cast<float>(word >> 30) * (1.0f / 3.0f);
+  }
+}
+
+void F32ToRGB10A2Scalar(const float* src, void* dst, int count)
+{
+  uint32_t* d = static_cast<uint32_t*>(dst);
+
+  for (int i=0;i+kRGBAChannels<=count;i+=kRGBAChannels) {
+    uint32_t r = static_cast<uint32_t>(Clamp01(src[i]) * 1023.0f + 0.5f);
+    uint32_t g = static_cast<uint32_t>(Clamp01(src[i+1]) * 1023.0f + 0.5f);
+    uint32_t b = static_cast<uint32_t>(Clamp01(src[i+2]) * 1023.0f + 0.5f);
+    uint32_t a = static_cast<uint32_t>(Clamp01(src[i+3]) * 3.0f + 0.5f);
+
+    d[i / kRGBAChannels] = r | (g << 10) | (b << 20) | (a << 30);
+  }
+}
+
+void MultiplyAlphaScalar(float* data, int count, bool skip_transparent)
+{
+  for (int i=0;i<count;i++) {
+    float* pixel = data + i * kRGBAChannels;
+    float alpha = pixel[kRGBChannels];
+
+    if (!skip_transparent || alpha > 0.0f) {
+      for (int j=0;j<kRGBChannels;j++) {
+        pixel[j] *= alpha;
+      }
+    }
+  }
+}
+
+void DivideAlphaScalar(float* data, int count)
+{
+  for (int i=0;i<count;i++) {
+    float* pixel = data + i * kRGBAChannels;
+    float alpha = pixel[kRGBChannels];
+
+    if (alpha > 0.0f) {
+      for (int j=0;j<kRGBChannels;j++) {
+        pixel[j] /= alpha;
+      }
+    }
+  }
+}
+
+/**
+ * @brief Replace the bytes of `data` selected by `mask` (repeated every kFillAlphaPatternSize bytes) with `alpha`
+ */
+void FillAlphaScalar(uint8_t* data, int bytes, const uint8_t* alpha, const uint8_t* mask)
+{
+  for (int i=0;i<bytes;i++) {
+    int j = i % kFillAlphaPatternSize;
+
+    data[i] = static_cast<uint8_t>((data[i] & ~mask[j]) | alpha[j]);
+  }
+}
+
+#if defined(OLIVE_PIXEL_X86)
+
+//
+// x86 kernels, compiled for their instruction set and only called if the CPU supports it
+//
+
+__attribute__((target("sse4.1")))
+void U8ToF32SSE41(const void* src, float* dst, int count)
+{
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    int32_t packed;
+    memcpy(&packed, s + i, sizeof(packed));
+
+    __m128i ints = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(packed));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(ints), scale));
+  }
+
+  U8ToF32Scalar(s + i, dst + i, count - i);
+}
+
+__attribute__((target("sse4.1")))
+void U16ToF32SSE41(const void* src, float* dst, int count)
+{
+  const uint16_t* s = static_cast<const uint16_t*>(src);
+  const __m128 scale = _mm_set1_ps(1.0f / 65535.0f);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    __m128i ints = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + i)));
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(ints), scale));
+  }
+
+  U16ToF32Scalar(s + i, dst + i, count - i);
+}
+
+__attribute__((target("sse4.1")))
+void F32ToU8SSE41(const float* src, void* dst, int count)
+{
+  uint8_t* d = static_cast<uint8_t*>(dst);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(255.0f);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    // max() first so NaN becomes 0, then scale and round to nearest
+    __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one);
+    __m128i ints = _mm_cvtps_epi32(_mm_mul_ps(f, scale));
+
+    __m128i packed = _mm_packus_epi16(_mm_packus_epi32(ints, ints), ints);
+
+    int32_t out = _mm_cvtsi128_si32(packed);
+    memcpy(d + i, &out, sizeof(out));
+  }
+
+  F32ToU8Scalar(src + i, d + i, count - i);
+}
+
+__attribute__((target("sse4.1")))
+void F32ToU16SSE41(const float* src, void* dst, int count)
+{
+  uint16_t* d = static_cast<uint16_t*>(dst);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_set1_ps(65535.0f);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one);
+    __m128i ints = _mm_cvtps_epi32(_mm_mul_ps(f, scale));
+
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(d + i), _mm_packus_epi32(ints, ints));
+  }
+
+  F32ToU16Scalar(src + i, d + i, count - i);
+}
+
+__attribute__((target("sse4.1")))
+void RGB10A2ToF32SSE41(const void* src, float* dst, int count)
+{
+  const uint32_t* s = static_cast<const uint32_t*>(src);
+
+  // Mask each channel in place and fold its shift into the scale, alpha is shifted down since its top bit is the sign
+  const __m128i mask = _mm_setr_epi32(0x3FF, 0x3FF << 10, 0x3FF << 20, 0);
+  const __m128 scale = _mm_setr_ps(1.0f / 1023.0f,
+                                   1.0f / (1023.0f * 1024.0f),
+                                   1.0f / (1023.0f * 1048576.0f),
+                                   1.0f / 3.0f);
+
+  int i = 0;
+
+  for (;i+kRGBAChannels<=count;i+=kRGBAChannels) {
+    __m128i word = _mm_set1_epi32(static_cast<int>(s[i / kRGBAChannels]));
+    __m128i ints = _mm_blend_epi16(_mm_and_si128(word, mask), _mm_srli_epi32(word, 30), 0xC0);
+
+    _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_cvtepi32_ps(ints), scale));
+  }
+}
+
+__attribute__((target("sse4.1")))
+void F32ToRGB10A2SSE41(const float* src, void* dst, int count)
+{
+  uint32_t* d = static_cast<uint32_t*>(dst);
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+  const __m128 scale = _mm_setr_ps(1023.0f, 1023.0f, 1023.0f, 3.0f);
+
+  // Multiplying by a power of two shifts each channel into place (alpha overflows into the sign bit, which is fine)
+  const __m128i shift = _mm_setr_epi32(1, 1 << 10, 1 << 20, 1 << 30);
+
+  int i = 0;
+
+  for (;i+kRGBAChannels<=count;i+=kRGBAChannels) {
+    __m128 f = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(src + i), zero), one);
+    __m128i ints = _mm_mullo_epi32(_mm_cvtps_epi32(_mm_mul_ps(f, scale)), shift);
+
+    // OR the four channels together
+    ints = _mm_or_si128(ints, _mm_shuffle_epi32(ints, 0x4E));
+    ints = _mm_or_si128(ints, _mm_shuffle_epi32(ints, 0xB1));
+
+    d[i / kRGBAChannels] = static_cast<uint32_t>(_mm_cvtsi128_si32(ints));
+  }
+}
+
+__attribute__((target("avx2")))
+void U8ToF32AVX2(const void* src, float* dst, int count)
+{
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  const __m256 scale = _mm256_set1_ps(1.0f / 255.0f);
+
+  int i = 0;
+
+  for (;i+8<=count;i+=8) {
+    __m256i ints = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s + i)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(ints), scale));
+  }
+
+  U8ToF32Scalar(s + i, dst + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void U16ToF32AVX2(const void* src, float* dst, int count)
+{
+  const uint16_t* s = static_cast<const uint16_t*>(src);
+  const __m256 scale = _mm256_set1_ps(1.0f / 65535.0f);
+
+  int i = 0;
+
+  for (;i+8<=count;i+=8) {
+    __m256i ints = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i)));
+    _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_cvtepi32_ps(ints), scale));
+  }
+
+  U16ToF32Scalar(s + i, dst + i, count - i);
+}
+
+__attribute__((target("avx2")))
+void F32ToU16AVX2(const float* src, void* dst, int count)
+{
+  uint16_t* d = static_cast<uint16_t*>(dst);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 scale = _mm256_set1_ps(65535.0f);
+
+  int i = 0;
+
+  for (;i+8<=count;i+=8) {
+    __m256 f = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(src + i), zero), one);
+    __m256i ints = _mm256_cvtps_epi32(_mm256_mul_ps(f, scale));
+
+    // Pack within each 128-bit lane, then gather the two halves
+    __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), packed);
+  }
+
+  F32ToU16Scalar(src + i, d + i, count - i);
+}
+
+__attribute__((target("avx,f16c")))
+void F16ToF32F16C(const void* src, float* dst, int count)
+{
+  const uint16_t* s = static_cast<const uint16_t*>(src);
+
+  int i = 0;
+
+  for (;i+8<=count;i+=8) {
+    _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i))));
+  }
+
+  F16ToF32Scalar(s + i, dst + i, count - i);
+}
+
+__attribute__((target("avx,f16c")))
+void F32ToF16F16C(const float* src, void* dst, int count)
+{
+  uint16_t* d = static_cast<uint16_t*>(dst);
+
+  int i = 0;
+
+  for (;i+8<=count;i+=8) {
+    __m128i half = _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(d + i), half);
+  }
+
+  F32ToF16Scalar(src + i, d + i, count - i);
+}
+
+__attribute__((target("avx")))
+void MultiplyAlphaAVX(float* data, int count, bool skip_transparent)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+
+  int i = 0;
+
+  // Two pixels at a time, each in its own 128-bit lane
+  for (;i+2<=count;i+=2) {
+    float* pixels = data + i * kRGBAChannels;
+
+    __m256 px = _mm256_loadu_ps(pixels);
+    __m256 alpha = _mm256_permute_ps(px, _MM_SHUFFLE(3, 3, 3, 3));
+    __m256 result = _mm256_mul_ps(px, _mm256_blend_ps(alpha, one, 0x88));
+
+    if (skip_transparent) {
+      result = _mm256_blendv_ps(px, result, _mm256_cmp_ps(alpha, zero, _CMP_GT_OQ));
+    }
+
+    _mm256_storeu_ps(pixels, result);
+  }
+
+  MultiplyAlphaScalar(data + i * kRGBAChannels, count - i, skip_transparent);
+}
+
+__attribute__((target("avx")))
+void DivideAlphaAVX(float* data, int count)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 one = _mm256_set1_ps(1.0f);
+
+  int i = 0;
+
+  for (;i+2<=count;i+=2) {
+    float* pixels = data + i * kRGBAChannels;
+
+    __m256 px = _mm256_loadu_ps(pixels);
+    __m256 alpha = _mm256_permute_ps(px, _MM_SHUFFLE(3, 3, 3, 3));
+
+    // Transparent pixels divide by zero here but are then discarded by the blend
+    __m256 result = _mm256_div_ps(px, _mm256_blend_ps(alpha, one, 0x88));
+    result = _mm256_blendv_ps(px, result, _mm256_cmp_ps(alpha, zero, _CMP_GT_OQ));
+
+    _mm256_storeu_ps(pixels, result);
+  }
+
+  DivideAlphaScalar(data + i * kRGBAChannels, count - i);
+}
+
+__attribute__((target("sse4.1")))
+void MultiplyAlphaSSE41(float* data, int count, bool skip_transparent)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  for (int i=0;i<count;i++) {
+    float* pixel = data + i * kRGBAChannels;
+
+    __m128 px = _mm_loadu_ps(pixel);
+    __m128 alpha = _mm_shuffle_ps(px, px, _MM_SHUFFLE(3, 3, 3, 3));
+    __m128 result = _mm_mul_ps(px, _mm_blend_ps(alpha, one, 0x8));
+
+    if (skip_transparent) {
+      result = _mm_blendv_ps(px, result, _mm_cmpgt_ps(alpha, zero));
+    }
+
+    _mm_storeu_ps(pixel, result);
+  }
+}
+
+__attribute__((target("sse4.1")))
+void DivideAlphaSSE41(float* data, int count)
+{
+  const __m128 zero = _mm_setzero_ps();
+  const __m128 one = _mm_set1_ps(1.0f);
+
+  for (int i=0;i<count;i++) {
+    float* pixel = data + i * kRGBAChannels;
+
+    __m128 px = _mm_loadu_ps(pixel);
+    __m128 alpha = _mm_shuffle_ps(px, px, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128 result = _mm_div_ps(px, _mm_blend_ps(alpha, one, 0x8));
+    result = _mm_blendv_ps(px, result, _mm_cmpgt_ps(alpha, zero));
+
+    _mm_storeu_ps(pixel, result);
+  }
+}
+
+__attribute__((target("sse2")))
+void FillAlphaSSE2(uint8_t* data, int bytes, const uint8_t* alpha, const uint8_t* mask)
+{
+  const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(alpha));
+  const __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mask));
+
+  int i = 0;
+
+  for (;i+kFillAlphaPatternSize<=bytes;i+=kFillAlphaPatternSize) {
+    __m128i* block = reinterpret_cast<__m128i*>(data + i);
+
+    _mm_storeu_si128(block, _mm_or_si128(_mm_andnot_si128(m, _mm_loadu_si128(block)), a));
+  }
+
+  FillAlphaScalar(data + i, bytes - i, alpha, mask);
+}
+
+#elif defined(OLIVE_PIXEL_NEON)
+
+//
+// ARM64 kernels (NEON is always available on ARM64)
+//
+
+void U8ToF32NEON(const void* src, float* dst, int count)
+{
+  const uint8_t* s = static_cast<const uint8_t*>(src);
+  const float32x4_t scale = vdupq_n_f32(1.0f / 255.0f);
+
+  int i = 0;
+
+  for (;i+8<=count;i+=8) {
+    uint16x8_t wide = vmovl_u8(vld1_u8(s + i));
+
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(wide))), scale));
+    vst1q_f32(dst + i + 4, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(wide))), scale));
+  }
+
+  U8ToF32Scalar(s + i, dst + i, count - i);
+}
+
+void U16ToF32NEON(const void* src, float* dst, int count)
+{
+  const uint16_t* s = static_cast<const uint16_t*>(src);
+  const float32x4_t scale = vdupq_n_f32(1.0f / 65535.0f);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    vst1q_f32(dst + i, vmulq_f32(vcvtq_f32_u32(vmovl_u16(vld1_u16(s + i))), scale));
+  }
+
+  U16ToF32Scalar(s + i, dst + i, count - i);
+}
+
+void F16ToF32NEON(const void* src, float* dst, int count)
+{
+  const float16_t* s = static_cast<const float16_t*>(src);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    vst1q_f32(dst + i, vcvt_f32_f16(vld1_f16(s + i)));
+  }
+
+  F16ToF32Scalar(s + i, dst + i, count - i);
+}
+
+void F32ToU8NEON(const float* src, void* dst, int count)
+{
+  uint8_t* d = static_cast<uint8_t*>(dst);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const float32x4_t scale = vdupq_n_f32(255.0f);
+
+  int i = 0;
+
+  for (;i+8<=count;i+=8) {
+    float32x4_t lo = vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), zero), one), scale);
+    float32x4_t hi = vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i + 4), zero), one), scale);
+
+    uint16x8_t wide = vcombine_u16(vqmovn_u32(vcvtnq_u32_f32(lo)), vqmovn_u32(vcvtnq_u32_f32(hi)));
+    vst1_u8(d + i, vqmovn_u16(wide));
+  }
+
+  F32ToU8Scalar(src + i, d + i, count - i);
+}
+
+void F32ToU16NEON(const float* src, void* dst, int count)
+{
+  uint16_t* d = static_cast<uint16_t*>(dst);
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+  const float32x4_t one = vdupq_n_f32(1.0f);
+  const float32x4_t scale = vdupq_n_f32(65535.0f);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    float32x4_t f = vmulq_f32(vminq_f32(vmaxq_f32(vld1q_f32(src + i), zero), one), scale);
+    vst1_u16(d + i, vqmovn_u32(vcvtnq_u32_f32(f)));
+  }
+
+  F32ToU16Scalar(src + i, d + i, count - i);
+}
+
+void F32ToF16NEON(const float* src, void* dst, int count)
+{
+  float16_t* d = static_cast<float16_t*>(dst);
+
+  int i = 0;
+
+  for (;i+4<=count;i+=4) {
+    vst1_f16(d + i, vcvt_f16_f32(vld1q_f32(src + i)));
+  }
+
+  F32ToF16Scalar(src + i, d + i, count - i);
+}
+
+void MultiplyAlphaNEON(float* data, int count, bool skip_transparent)
+{
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+
+  for (int i=0;i<count;i++) {
+    float* pixel = data + i * kRGBAChannels;
+
+    float32x4_t px = vld1q_f32(pixel);
+    float32x4_t alpha = vdupq_laneq_f32(px, 3);
+    float32x4_t result = vmulq_f32(px, vsetq_lane_f32(1.0f, alpha, 3));
+
+    if (skip_transparent) {
+      result = vbslq_f32(vcgtq_f32(alpha, zero), result, px);
+    }
+
+    vst1q_f32(pixel, result);
+  }
+}
+
+void DivideAlphaNEON(float* data, int count)
+{
+  const float32x4_t zero = vdupq_n_f32(0.0f);
+
+  for (int i=0;i<count;i++) {
+    float* pixel = data + i * kRGBAChannels;
+
+    float32x4_t px = vld1q_f32(pixel);
+    float32x4_t alpha = vdupq_laneq_f32(px, 3);
+    float32x4_t result = vdivq_f32(px, vsetq_lane_f32(1.0f, alpha, 3));
+
+    vst1q_f32(pixel, vbslq_f32(vcgtq_f32(alpha, zero), result, px));
+  }
+}
+
+void FillAlphaNEON(uint8_t* data, int bytes, const uint8_t* alpha, const uint8_t* mask)
+{
+  const uint8x16_t a = vld1q_u8(alpha);
+  const uint8x16_t m = vld1q_u8(mask);
+
+  int i = 0;
+
+  for (;i+kFillAlphaPatternSize<=bytes;i+=kFillAlphaPatternSize) {
+    vst1q_u8(data + i, vbslq_u8(m, a, vld1q_u8(data + i)));
+  }
+
+  FillAlphaScalar(data + i, bytes - i, alpha, mask);
+}
+
+#endif
+
+/**
+ * @brief The kernels chosen for this CPU, indexed by olive::PixelFormat
+ *
+ * 32-bit float to and from itself is a copy and has no kernel. If `vectorized` is false, only the scalar kernels are
+ * used whatever the CPU supports.
+ */
+struct KernelTable {
+  KernelTable(bool vectorized)
+  {
+    to_float[olive::PIX_FMT_RGBA8] = U8ToF32Scalar;
+    to_float[olive::PIX_FMT_RGBA16U] = U16ToF32Scalar;
+    to_float[olive::PIX_FMT_RGBA16F] = F16ToF32Scalar;
+    to_float[olive::PIX_FMT_RGBA32F] = nullptr;
+    to_float[olive::PIX_FMT_RGB10A2] = RGB10A2ToF32Scalar;
+
+    from_float[olive::PIX_FMT_RGBA8] = F32ToU8Scalar;
+    from_float[olive::PIX_FMT_RGBA16U] = F32ToU16Scalar;
+    from_float[olive::PIX_FMT_RGBA16F] = F32ToF16Scalar;
+    from_float[olive::PIX_FMT_RGBA32F] = nullptr;
+    from_float[olive::PIX_FMT_RGB10A2] = F32ToRGB10A2Scalar;
+
+    multiply_alpha = MultiplyAlphaScalar;
+    divide_alpha = DivideAlphaScalar;
+    fill_alpha = FillAlphaScalar;
+
+    if (!vectorized) {
+      return;
+    }
+
+#if defined(OLIVE_PIXEL_X86)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("sse2")) {
+      fill_alpha = FillAlphaSSE2;
+    }
+
+    if (__builtin_cpu_supports("sse4.1")) {
+      to_float[olive::PIX_FMT_RGBA8] = U8ToF32SSE41;
+      to_float[olive::PIX_FMT_RGBA16U] = U16ToF32SSE41;
+      from_float[olive::PIX_FMT_RGBA8] = F32ToU8SSE41;
+      from_float[olive::PIX_FMT_RGBA16U] = F32ToU16SSE41;
+      to_float[olive::PIX_FMT_RGB10A2] = RGB10A2ToF32SSE41;
+      from_float[olive::PIX_FMT_RGB10A2] = F32ToRGB10A2SSE41;
+      multiply_alpha = MultiplyAlphaSSE41;
+      divide_alpha = DivideAlphaSSE41;
+    }
+
+    if (__builtin_cpu_supports("avx")) {
+      multiply_alpha = MultiplyAlphaAVX;
+      divide_alpha = DivideAlphaAVX;
+    }
+
+    if (__builtin_cpu_supports("avx2")) {
+      to_float[olive::PIX_FMT_RGBA8] = U8ToF32AVX2;
+      to_float[olive::PIX_FMT_RGBA16U] = U16ToF32AVX2;
+      from_float[olive::PIX_FMT_RGBA16U] = F32ToU16AVX2;
+    }
+
+    if (__builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c")) {
+      to_float[olive::PIX_FMT_RGBA16F] = F16ToF32F16C;
+      from_float[olive::PIX_FMT_RGBA16F] = F32ToF16F16C;
+    }
+#elif defined(OLIVE_PIXEL_NEON)
+    to_float[olive::PIX_FMT_RGBA8] = U8ToF32NEON;
+    to_float[olive::PIX_FMT_RGBA16U] = U16ToF32NEON;
+    to_float[olive::PIX_FMT_RGBA16F] = F16ToF32NEON;
+    from_float[olive::PIX_FMT_RGBA8] = F32ToU8NEON;
+    from_float[olive::PIX_FMT_RGBA16U] = F32ToU16NEON;
+    from_float[olive::PIX_FMT_RGBA16F] = F32ToF16NEON;
+    multiply_alpha = MultiplyAlphaNEON;
+    divide_alpha = DivideAlphaNEON;
+    fill_alpha = FillAlphaNEON;
+#endif
+  }
+
+  ToFloatKernel to_float[olive::PIX_FMT_COUNT];
+  FromFloatKernel from_float[olive::PIX_FMT_COUNT];
+
+  MultiplyAlphaKernel multiply_alpha;
+  DivideAlphaKernel divide_alpha;
+  FillAlphaKernel fill_alpha;
+};
+
+const KernelTable& Kernels()
+{
+  // Initialized once, thread-safely, on first use
+  static const KernelTable table(true);
+
+  return table;
+}
+
+/**
+ * @brief The scalar kernels, for olive::pixel::reference
+ */
+const KernelTable& ScalarKernels()
+{
+  static const KernelTable table(false);
+
+  return table;
+}
+
+void ToFloatWith(const KernelTable& kernels,
+                 const void *source,
+                 const olive::PixelFormat &source_format,
+                 float *destination,
+                 int count)
+{
+  ToFloatKernel kernel = kernels.to_float[source_format];
+
+  if (kernel == nullptr) {
+    memcpy(destination, source, static_cast<size_t>(count) * sizeof(float));
+  } else {
+    kernel(source, destination, count);
+  }
+}
+
+void FromFloatWith(const KernelTable& kernels,
+                   const float *source,
+                   void *destination,
+                   const olive::PixelFormat &destination_format,
+                   int count)
+{
+  FromFloatKernel kernel = kernels.from_float[destination_format];
+
+  if (kernel == nullptr) {
+    memcpy(destination, source, static_cast<size_t>(count) * sizeof(float));
+  } else {
+    kernel(source, destination, count);
+  }
+}
+
+}
+
+void olive::pixel::ToFloat(const void *source, const olive::PixelFormat &source_format, float *destination, int count)
+{
+  ToFloatWith(Kernels(), source, source_format, destination, count);
+}
+
+void olive::pixel::FromFloat(const float *source, void *destination, const olive::PixelFormat &destination_format, int count)
+{
+  FromFloatWith(Kernels(), source, destination, destination_format, count);
+}
+
+void olive::pixel::MultiplyAlpha(float *data, int count, bool skip_transparent)
+{
+  Kernels().multiply_alpha(data, count, skip_transparent);
+}
+
+void olive::pixel::DivideAlpha(float *data, int count)
+{
+  Kernels().divide_alpha(data, count);
+}
+
+void olive::pixel::FillAlpha(void *data, const olive::PixelFormat &format, int count)
+{
+  // Opaque alpha in this format's channel type
+  uint8_t value[sizeof(float)];
+  int channel_size = 0;
+
+  switch (format) {
+  case olive::PIX_FMT_RGBA8:
+    value[0] = UINT8_MAX;
+    channel_size = 1;
+    break;
+  case olive::PIX_FMT_RGBA16U:
+  {
+    uint16_t u16 = UINT16_MAX;
+    channel_size = sizeof(uint16_t);
+    memcpy(value, &u16, sizeof(uint16_t));
+    break;
+  }
+  case olive::PIX_FMT_RGBA16F:
+  {
+    qfloat16 f16 = 1.0f;
+    channel_size = sizeof(qfloat16);
+    memcpy(value, &f16, sizeof(qfloat16));
+    break;
+  }
+  case olive::PIX_FMT_RGBA32F:
+  {
+    float f32 = 1.0f;
+    channel_size = sizeof(float);
+    memcpy(value, &f32, sizeof(float));
+    break;
+  }
+  case olive::PIX_FMT_RGB10A2:
+    // Alpha is the top two bits of each (little-endian) word, the kernels mask per bit so only those are replaced
+    value[0] = 0xC0;
+    channel_size = 1;
+    break;
+  case olive::PIX_FMT_INVALID:
+  case olive::PIX_FMT_COUNT:
+    qFatal("Invalid pixel format requested");
+  }
+
+  int pixel_size = channel_size * kRGBAChannels;
+  uint8_t mask_value = static_cast<uint8_t>((format == olive::PIX_FMT_RGB10A2) ? 0xC0 : UINT8_MAX);
+
+  // Repeat the alpha channel of one pixel across the pattern so whole blocks of pixels can be filled at once
+  uint8_t alpha[kFillAlphaPatternSize] = {};
+  uint8_t mask[kFillAlphaPatternSize] = {};
+
+  for (int i=0;i<kFillAlphaPatternSize;i+=pixel_size) {
+    int alpha_offset = i + channel_size * (kRGBAChannels - 1);
+
+    memcpy(alpha + alpha_offset, value, static_cast<size_t>(channel_size));
+    memset(mask + alpha_offset, mask_value, static_cast<size_t>(channel_size));
+  }
+
+  Kernels().fill_alpha(static_cast<uint8_t*>(data), count * pixel_size, alpha, mask);
+}
+
+void olive::pixel::reference::ToFloat(const void *source,
+                                      const olive::PixelFormat &source_format,
+                                      float *destination,
+                                      int count)
+{
+  ToFloatWith(ScalarKernels(), source, source_format, destination, count);
+}
+
+void olive::pixel::reference::FromFloat(const float *source,
+                                        void *destination,
+                                        const olive::PixelFormat &destination_format,
+                                        int count)
+{
+  FromFloatWith(ScalarKernels(), source, destination, destination_format, count);
+}
+
+void olive::pixel::reference::MultiplyAlpha(float *data, int count, bool skip_transparent)
+{
+  ScalarKernels().multiply_alpha(data, count, skip_transparent);
+}
+
+void olive::pixel::reference::DivideAlpha(float *data, int count)
+{
+  ScalarKernels().divide_alpha(data, count);
+}
@@ -0,0 +1,87 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PIXELCONVERSION_H
+#define PIXELCONVERSION_H
+
+#include "pixelformat.h"
+
+namespace olive {
+namespace pixel {
+
+/**
+ * @brief Convert `count` channel values of any format to 32-bit float
+ *
+ * Integer formats are normalized to 0.0-1.0. Uses the fastest kernel the CPU supports (AVX2/F16C or SSE4.1 on x86,
+ * NEON on ARM64), chosen once at runtime, and falls back to plain scalar code otherwise.
+ *
+ * For packed formats (PIX_FMT_RGB10A2) `count` must be a multiple of 4, since every 4 channels share one word.
+ */
+void ToFloat(const void* source, const olive::PixelFormat& source_format, float* destination, int count);
+
+/**
+ * @brief Convert `count` 32-bit float channel values to any format
+ *
+ * Values are clamped to 0.0-1.0 and rounded to the nearest value when converting to integer formats. Uses the same
+ * kernels as ToFloat().
+ */
+void FromFloat(const float* source, void* destination, const olive::PixelFormat& destination_format, int count);
+
+/**
+ * @brief Multiply the color of `count` 32-bit float RGBA pixels by their alpha
+ *
+ * If `skip_transparent` is true, pixels with an alpha of 0 or less are left alone, which is what reassociating alpha
+ * that DivideAlpha() removed needs.
+ */
+void MultiplyAlpha(float* data, int count, bool skip_transparent);
+
+/**
+ * @brief Divide the color of `count` 32-bit float RGBA pixels by their alpha, skipping pixels with an alpha of 0 or less
+ */
+void DivideAlpha(float* data, int count);
+
+/**
+ * @brief Set the alpha of `count` RGBA pixels of any format to fully opaque, leaving their color untouched
+ *
+ * Used for images without alpha, which are read straight into RGBA pixels with the alpha left unwritten.
+ */
+void FillAlpha(void* data, const olive::PixelFormat& format, int count);
+
+/**
+ * @brief The plain scalar kernels that the functions above fall back to, whatever the CPU supports
+ *
+ * Only meant as a reference to measure the vectorized kernels against (see the olive-benchmarks target).
+ */
+namespace reference {
+
+void ToFloat(const void* source, const olive::PixelFormat& source_format, float* destination, int count);
+
+void FromFloat(const float* source, void* destination, const olive::PixelFormat& destination_format, int count);
+
+void MultiplyAlpha(float* data, int count, bool skip_transparent);
+
+void DivideAlpha(float* data, int count);
+
+}
+
+}
+}
+
+#endif // PIXELCONVERSION_H
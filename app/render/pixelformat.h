@@ -34,6 +34,9 @@ enum PixelFormat {
   PIX_FMT_RGBA16F,
   PIX_FMT_RGBA32F,
 
+  /// 10-bit RGB and 2-bit alpha packed into one 32-bit word per pixel (R in the low bits), for opaque 10-bit material
+  PIX_FMT_RGB10A2,
+
   PIX_FMT_COUNT
 };
 
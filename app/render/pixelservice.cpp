@@ -25,6 +25,7 @@
 #include <QFloat16>
 
 #include "common/define.h"
+#include "pixelconversion.h"
 
 PixelService::PixelService()
 {
@@ -59,6 +60,14 @@ PixelFormatInfo PixelService::GetPixelFormatInfo(const olive::PixelFormat &forma
     info.pixel_type = GL_FLOAT;
     info.oiio_desc = OIIO::TypeDesc::FLOAT;
     break;
+  case olive::PIX_FMT_RGB10A2:
+    info.name = tr("10-bit Packed");
+    info.internal_format = GL_RGB10_A2;
+    info.pixel_type = GL_UNSIGNED_INT_2_10_10_10_REV;
+
+    // OIIO has no packed type, so these are read and written as 16-bit and converted (see ConvertPixelFormat())
+    info.oiio_desc = OIIO::TypeDesc::UINT16;
+    break;
   case olive::PIX_FMT_INVALID:
   case olive::PIX_FMT_COUNT:
     qFatal("Invalid pixel format requested");
@@ -84,6 +93,7 @@ int PixelService::BytesPerChannel(const olive::PixelFormat &format)
 {
   switch (format) {
   case olive::PIX_FMT_RGBA8:
+  case olive::PIX_FMT_RGB10A2:
     return 1;
   case olive::PIX_FMT_RGBA16U:
   case olive::PIX_FMT_RGBA16F:
@@ -104,6 +114,14 @@ FramePtr PixelService::ConvertPixelFormat(FramePtr frame, const olive::PixelForm
     return frame;
   }
 
+  olive::PixelFormat source_format = static_cast<olive::PixelFormat>(frame->format());
+
+  if (source_format <= olive::PIX_FMT_INVALID || source_format >= olive::PIX_FMT_COUNT
+      || dest_format <= olive::PIX_FMT_INVALID || dest_format >= olive::PIX_FMT_COUNT) {
+    qWarning() << tr("Invalid parameters called for pixel format conversion");
+    return nullptr;
+  }
+
   // FIXME: It'd be nice if this was multithreaded soon
 
   FramePtr converted = Frame::Create();
@@ -115,206 +133,46 @@ FramePtr PixelService::ConvertPixelFormat(FramePtr frame, const olive::PixelForm
   converted->set_format(dest_format);
   converted->allocate();
 
-  int pix_count = frame->width() * frame->height() * kRGBAChannels;
+  ConvertPixels(frame->data(), source_format, converted->data(), dest_format, frame->width() * frame->height());
 
-  bool valid = true;
+  return converted;
+}
 
-  switch (static_cast<olive::PixelFormat>(frame->format())) {
-  case olive::PIX_FMT_RGBA8:
-  {
-    uint8_t* source = frame->data();
-
-    switch (dest_format) {
-    case olive::PIX_FMT_RGBA16U: // 8-bit Integer -> 16-bit Integer
-    {
-      uint16_t* destination = reinterpret_cast<uint16_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint16_t>(source[i] * 257);
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA16F: // 8-bit Integer -> 16-bit Float
-    {
-      qfloat16* destination = reinterpret_cast<qfloat16*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 255.0f;
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA32F: // 8-bit Integer -> 32-bit Float
-    {
-      float* destination = reinterpret_cast<float*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 255.0f;
-      }
-      break;
-    }
-    case olive::PIX_FMT_INVALID:
-    case olive::PIX_FMT_RGBA8:
-    case olive::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
-  }
-  case olive::PIX_FMT_RGBA16U:
-  {
-    uint16_t* source = reinterpret_cast<uint16_t*>(frame->data());
-
-    switch (dest_format) {
-    case olive::PIX_FMT_RGBA8: // 16-bit Integer -> 8-bit Integer
-    {
-      uint8_t* destination = converted->data();
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint8_t>(source[i] / 257);
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA16F: // 16-bit Integer -> 16-bit Float
-    {
-      qfloat16* destination = reinterpret_cast<qfloat16*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 65535.0f;
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA32F: // 16-bit Integer -> 32-bit Float
-    {
-      float* destination = reinterpret_cast<float*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i] / 65535.0f;
-      }
-      break;
-    }
-    case olive::PIX_FMT_INVALID:
-    case olive::PIX_FMT_RGBA16U:
-    case olive::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
-  }
-  case olive::PIX_FMT_RGBA16F:
-  {
-    qfloat16* source = reinterpret_cast<qfloat16*>(frame->data());
-
-    switch (dest_format) {
-    case olive::PIX_FMT_RGBA8: // 16-bit Float -> 8-bit Integer
-    {
-      uint8_t* destination = converted->data();
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint8_t>(source[i] * 255.0f);
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA16U: // 16-bit Float -> 16-bit Integer
-    {
-      uint16_t* destination = reinterpret_cast<uint16_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint16_t>(source[i] * 65535.0f);
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA32F: // 16-bit Float -> 32-bit Float
-    {
-      float* destination = reinterpret_cast<float*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i];
-      }
-      break;
-    }
-    case olive::PIX_FMT_INVALID:
-    case olive::PIX_FMT_RGBA16F:
-    case olive::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
-  }
-  case olive::PIX_FMT_RGBA32F:
-  {
-    float* source = reinterpret_cast<float*>(frame->data());
-
-    switch (dest_format) {
-    case olive::PIX_FMT_RGBA8: // 32-bit Float -> 8-bit Integer
-    {
-      uint8_t* destination = converted->data();
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint8_t>(source[i] * 255.0f);
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA16U: // 32-bit Float -> 16-bit Integer
-    {
-      uint16_t* destination = reinterpret_cast<uint16_t*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = static_cast<uint16_t>(source[i] * 255.0f);
-      }
-      break;
-    }
-    case olive::PIX_FMT_RGBA16F: // 32-bit Float -> 16-bit Float
-    {
-      qfloat16* destination = reinterpret_cast<qfloat16*>(converted->data());
-      for (int i=0;i<pix_count;i++) {
-        destination[i] = source[i];
-      }
-      break;
-    }
-    case olive::PIX_FMT_INVALID:
-    case olive::PIX_FMT_RGBA32F:
-    case olive::PIX_FMT_COUNT:
-      valid = false;
-    }
-    break;
-  }
-  case olive::PIX_FMT_INVALID:
-  case olive::PIX_FMT_COUNT:
-    valid = false;
-  }
+void PixelService::ConvertPixels(const void *source,
+                                 const olive::PixelFormat &source_format,
+                                 void *destination,
+                                 const olive::PixelFormat &dest_format,
+                                 int pixel_count)
+{
+  int pix_count = pixel_count * kRGBAChannels;
 
-  if (valid) {
-    return converted;
-  }
+  if (source_format == olive::PIX_FMT_RGBA32F) {
+    olive::pixel::FromFloat(static_cast<const float*>(source), destination, dest_format, pix_count);
+  } else if (dest_format == olive::PIX_FMT_RGBA32F) {
+    olive::pixel::ToFloat(source, source_format, static_cast<float*>(destination), pix_count);
+  } else {
+    // Go through float in chunks small enough to stay in cache (a whole number of pixels, for packed formats)
+    const int kChunkSize = 4096;
+    float buffer[kChunkSize];
 
-  qWarning() << tr("Invalid parameters called for pixel format conversion");
-  return nullptr;
-}
+    const uint8_t* src = static_cast<const uint8_t*>(source);
+    uint8_t* dst = static_cast<uint8_t*>(destination);
 
-void PixelService::ConvertRGBtoRGBA(FramePtr frame)
-{
-  olive::PixelFormat dest_format = static_cast<olive::PixelFormat>(frame->format());
-
-  int rgb_pixel_size = BytesPerChannel(dest_format) * kRGBChannels;
-  int rgb_frame_size = frame->width() * frame->height() * rgb_pixel_size;
-  int rgb_iter = rgb_frame_size - rgb_pixel_size;
-
-  int rgba_pixel_size = BytesPerChannel(dest_format) * kRGBAChannels;
-  int rgba_frame_size = frame->width() * frame->height() * rgba_pixel_size;
-  int rgba_iter = rgba_frame_size - rgba_pixel_size;
-
-  // Work backwards to save time
-  while (rgb_iter >= 0) {
-    memcpy(&frame->data()[rgba_iter], &frame->data()[rgb_iter], static_cast<size_t>(rgb_pixel_size));
-
-    uint8_t* alpha_ptr = &frame->data()[rgba_iter + rgb_pixel_size];
-
-    // Write a full alpha value according to the format
-    switch (dest_format) {
-    case olive::PIX_FMT_RGBA8:
-      *alpha_ptr = UINT8_MAX;
-      break;
-    case olive::PIX_FMT_RGBA16U:
-      *reinterpret_cast<uint16_t*>(alpha_ptr) = UINT16_MAX;
-      break;
-    case olive::PIX_FMT_RGBA16F:
-      *reinterpret_cast<qfloat16*>(alpha_ptr) = 1.0f;
-      break;
-    case olive::PIX_FMT_RGBA32F:
-      *reinterpret_cast<float*>(alpha_ptr) = 1.0f;
-      break;
-    case olive::PIX_FMT_INVALID:
-    case olive::PIX_FMT_COUNT:
-      qFatal("Invalid pixel format requested");
-    }
+    int src_channel_size = BytesPerChannel(source_format);
+    int dst_channel_size = BytesPerChannel(dest_format);
+
+    for (int i=0;i<pix_count;i+=kChunkSize) {
+      int count = qMin(kChunkSize, pix_count - i);
 
-    rgb_iter -= rgb_pixel_size;
-    rgba_iter -= rgba_pixel_size;
+      olive::pixel::ToFloat(src + i * src_channel_size, source_format, buffer, count);
+      olive::pixel::FromFloat(buffer, dst + i * dst_channel_size, dest_format, count);
+    }
   }
 }
+
+void PixelService::FillAlpha(FramePtr frame)
+{
+  olive::pixel::FillAlpha(frame->data(),
+                          static_cast<olive::PixelFormat>(frame->format()),
+                          frame->width() * frame->height());
+}
@@ -81,12 +81,15 @@ public:
    *
    * Different formats use different sizes of data for pixels. Use this function to determine how many bytes a pixel
    * requires for a certain format. The number of bytes will always be a multiple of 4 since all formats use RGBA and
-   * are at least 1 bpc.
+   * are at least 1 byte per channel, or 4 bytes per packed pixel.
    */
   static int BytesPerPixel(const olive::PixelFormat& format);
 
   /**
    * @brief Returns the number of bytes per channel for a certain format
+   *
+   * Packed formats (PIX_FMT_RGB10A2) don't have whole bytes per channel, they return BytesPerPixel() divided by the
+   * number of channels so that offsets of a whole number of pixels still work out.
    */
   static int BytesPerChannel(const olive::PixelFormat& format);
 
@@ -98,9 +101,20 @@ public:
   static FramePtr ConvertPixelFormat(FramePtr frame, const olive::PixelFormat &dest_format);
 
   /**
-   * @brief Convert an RGB image to an RGBA image
+   * @brief Convert `pixel_count` tightly packed pixels from one format to another
+   */
+  static void ConvertPixels(const void* source,
+                            const olive::PixelFormat& source_format,
+                            void* destination,
+                            const olive::PixelFormat& dest_format,
+                            int pixel_count);
+
+  /**
+   * @brief Make every pixel of an RGBA frame fully opaque
+   *
+   * Used for RGB images, which are read straight into the frame's RGBA pixels with the alpha left unwritten.
    */
-  static void ConvertRGBtoRGBA(FramePtr frame);
+  static void FillAlpha(FramePtr frame);
 
 };
 
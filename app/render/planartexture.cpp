@@ -0,0 +1,307 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "planartexture.h"
+
+#include <cstring>
+#include <QDebug>
+
+#include "render/gl/uploadring.h"
+#include "render/profiler.h"
+
+PlanarTexture::PlanarTexture() :
+  context_(nullptr),
+  width_(0),
+  height_(0)
+{
+  for (int i=0;i<kMaxPlanes;i++) {
+    textures_[i] = 0;
+  }
+}
+
+PlanarTexture::~PlanarTexture()
+{
+  Destroy();
+}
+
+void PlanarTexture::Upload(QOpenGLContext *ctx, FramePtr frame)
+{
+  if (ctx == nullptr) {
+    qWarning() << tr("PlanarTexture::Upload was passed an invalid context");
+    return;
+  }
+
+  ProfilerTimer timer(Profiler::kUpload);
+
+  if (!IsCreated()
+      || context_ != ctx
+      || width_ != frame->width()
+      || height_ != frame->height()
+      || info_ != frame->yuv_info()) {
+    Create(ctx, frame->width(), frame->height(), frame->yuv_info());
+  }
+
+  QOpenGLFunctions* f = context_->functions();
+
+  if (info_.layout == olive::YUV_LAYOUT_PACKED_RGB10) {
+    UploadPacked(frame);
+    return;
+  }
+
+  // Plane rows may be padded, so we let OpenGL know the real row length
+  f->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  for (int i=0;i<PlaneCount() && i<frame->plane_count();i++) {
+    int bytes_per_pixel = BytesPerSample() * PlaneChannels(i);
+
+    f->glBindTexture(GL_TEXTURE_2D, textures_[i]);
+
+    f->glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize(i) / bytes_per_pixel);
+
+    f->glTexSubImage2D(GL_TEXTURE_2D,
+                       0,
+                       0,
+                       0,
+                       PlaneWidth(i),
+                       PlaneHeight(i),
+                       (PlaneChannels(i) == 2) ? GL_RG : GL_RED,
+                       (BytesPerSample() == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE,
+                       frame->const_data(i));
+  }
+
+  f->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  f->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  f->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+bool PlanarTexture::IsCreated() const
+{
+  return (textures_[0] != 0);
+}
+
+void PlanarTexture::Bind()
+{
+  if (context_ == nullptr) {
+    qWarning() << "PlanarTexture::Bind() called with an invalid context";
+    return;
+  }
+
+  QOpenGLFunctions* f = context_->functions();
+
+  for (int i=0;i<PlaneCount();i++) {
+    f->glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+    f->glBindTexture(GL_TEXTURE_2D, textures_[i]);
+  }
+
+  f->glActiveTexture(GL_TEXTURE0);
+}
+
+void PlanarTexture::Release()
+{
+  if (context_ == nullptr) {
+    qWarning() << "PlanarTexture::Release() called with an invalid context";
+    return;
+  }
+
+  QOpenGLFunctions* f = context_->functions();
+
+  for (int i=PlaneCount()-1;i>=0;i--) {
+    f->glActiveTexture(GL_TEXTURE0 + static_cast<GLenum>(i));
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+  }
+}
+
+const olive::YUVInfo &PlanarTexture::info() const
+{
+  return info_;
+}
+
+void PlanarTexture::Destroy()
+{
+  if (context_ != nullptr) {
+    disconnect(context_, SIGNAL(aboutToBeDestroyed()), this, SLOT(Destroy()));
+
+    context_->functions()->glDeleteTextures(kMaxPlanes, textures_);
+
+    for (int i=0;i<kMaxPlanes;i++) {
+      textures_[i] = 0;
+    }
+
+    context_ = nullptr;
+  }
+}
+
+void PlanarTexture::Create(QOpenGLContext *ctx, int width, int height, const olive::YUVInfo &info)
+{
+  Destroy();
+
+  context_ = ctx;
+  width_ = width;
+  height_ = height;
+  info_ = info;
+
+  connect(context_, SIGNAL(aboutToBeDestroyed()), this, SLOT(Destroy()));
+
+  QOpenGLFunctions* f = context_->functions();
+
+  f->glGenTextures(PlaneCount(), textures_);
+
+  if (textures_[0] == 0) {
+    qWarning() << tr("OpenGL texture creation failed");
+    return;
+  }
+
+  for (int i=0;i<PlaneCount();i++) {
+    GLint internal_format;
+    GLenum pixel_format;
+
+    if (PlaneChannels(i) == 4) {
+      internal_format = GL_RGBA8;
+      pixel_format = GL_RGBA;
+    } else if (PlaneChannels(i) == 2) {
+      internal_format = (BytesPerSample() == 2) ? GL_RG16 : GL_RG8;
+      pixel_format = GL_RG;
+    } else {
+      internal_format = (BytesPerSample() == 2) ? GL_R16 : GL_R8;
+      pixel_format = GL_RED;
+    }
+
+    f->glBindTexture(GL_TEXTURE_2D, textures_[i]);
+
+    f->glTexImage2D(GL_TEXTURE_2D,
+                    0,
+                    internal_format,
+                    PlaneWidth(i),
+                    PlaneHeight(i),
+                    0,
+                    pixel_format,
+                    (BytesPerSample() == 2) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE,
+                    nullptr);
+
+    // Chroma planes are upsampled with bilinear filtering, packed words must never be blended before they're unpacked
+    GLint filter = (info_.layout == olive::YUV_LAYOUT_PACKED_RGB10) ? GL_NEAREST : GL_LINEAR;
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  }
+
+  f->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void PlanarTexture::UploadPacked(FramePtr frame)
+{
+  QOpenGLFunctions* f = context_->functions();
+
+  int row_size = width_ * 4;
+  qint64 size = static_cast<qint64>(row_size) * height_;
+
+  f->glBindTexture(GL_TEXTURE_2D, textures_[0]);
+
+  UploadRing* ring = UploadRing::Get(context_);
+  uchar* buffer = static_cast<uchar*>(ring->Map(size));
+
+  if (buffer) {
+    // Copy straight from the frame (usually mapped file pages) into the pixel buffer, the driver takes it from there
+    const uint8_t* src = frame->const_data(0);
+
+    if (frame->linesize(0) == row_size) {
+      memcpy(buffer, src, static_cast<size_t>(size));
+    } else {
+      for (int i=0;i<height_;i++) {
+        memcpy(buffer + i * row_size, src + i * frame->linesize(0), static_cast<size_t>(row_size));
+      }
+    }
+
+    ring->Unmap();
+
+    // With a pixel unpack buffer bound, the data argument is an offset into it
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+
+    ring->Release();
+  } else {
+    f->glPixelStorei(GL_UNPACK_ROW_LENGTH, frame->linesize(0) / 4);
+
+    f->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width_, height_, GL_RGBA, GL_UNSIGNED_BYTE, frame->const_data(0));
+
+    f->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  }
+
+  f->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+int PlanarTexture::PlaneCount() const
+{
+  switch (info_.layout) {
+  case olive::YUV_LAYOUT_PLANAR:
+    return 3;
+  case olive::YUV_LAYOUT_SEMIPLANAR:
+    return 2;
+  case olive::YUV_LAYOUT_PACKED_RGB10:
+    return 1;
+  case olive::YUV_LAYOUT_INVALID:
+    break;
+  }
+
+  return 0;
+}
+
+int PlanarTexture::PlaneWidth(int plane) const
+{
+  if (plane == 0) {
+    return width_;
+  }
+
+  // Round up so odd frame sizes don't lose their last chroma column
+  return (width_ + (1 << info_.chroma_shift_w) - 1) >> info_.chroma_shift_w;
+}
+
+int PlanarTexture::PlaneHeight(int plane) const
+{
+  if (plane == 0) {
+    return height_;
+  }
+
+  return (height_ + (1 << info_.chroma_shift_h) - 1) >> info_.chroma_shift_h;
+}
+
+int PlanarTexture::PlaneChannels(int plane) const
+{
+  if (info_.layout == olive::YUV_LAYOUT_PACKED_RGB10) {
+    // One byte per channel, the shader reassembles the 32-bit word
+    return 4;
+  }
+
+  if (plane == 1 && info_.layout == olive::YUV_LAYOUT_SEMIPLANAR) {
+    return 2;
+  }
+
+  return 1;
+}
+
+int PlanarTexture::BytesPerSample() const
+{
+  if (info_.layout == olive::YUV_LAYOUT_PACKED_RGB10) {
+    return 1;
+  }
+
+  return (info_.bit_depth > 8) ? 2 : 1;
+}
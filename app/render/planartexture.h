@@ -0,0 +1,97 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PLANARTEXTURE_H
+#define PLANARTEXTURE_H
+
+#include <QOpenGLFunctions>
+
+#include "decoder/frame.h"
+#include "render/yuvformat.h"
+
+/**
+ * @brief A set of single/dual-channel textures holding the planes of a native YUV frame
+ *
+ * The planar counterpart to RenderTexture. Frames are uploaded as-is (e.g. 1.5 bytes per pixel for 8-bit 4:2:0) and
+ * converted to RGBA on the GPU by a ShaderGenerator::YUVPipeline() shader. Packed 10-bit RGB frames are held in a single
+ * RGBA8 texture of raw bytes for the shader to unpack.
+ */
+class PlanarTexture : public QObject
+{
+  Q_OBJECT
+public:
+  PlanarTexture();
+  ~PlanarTexture();
+  PlanarTexture(const PlanarTexture& other) = delete;
+  PlanarTexture(PlanarTexture&& other) = delete;
+  PlanarTexture& operator=(const PlanarTexture& other) = delete;
+  PlanarTexture& operator=(PlanarTexture&& other) = delete;
+
+  /**
+   * @brief Upload the planes of a YUV frame, (re)creating the textures if the frame's size or layout changed
+   */
+  void Upload(QOpenGLContext* ctx, FramePtr frame);
+
+  bool IsCreated() const;
+
+  /**
+   * @brief Bind each plane to its own texture unit (plane 0 to GL_TEXTURE0, plane 1 to GL_TEXTURE1, etc.)
+   */
+  void Bind();
+
+  void Release();
+
+  const olive::YUVInfo& info() const;
+
+public slots:
+  void Destroy();
+
+private:
+  void Create(QOpenGLContext* ctx, int width, int height, const olive::YUVInfo& info);
+
+  /**
+   * @brief Upload a YUV_LAYOUT_PACKED_RGB10 frame through the context's UploadRing
+   */
+  void UploadPacked(FramePtr frame);
+
+  int PlaneCount() const;
+
+  int PlaneWidth(int plane) const;
+
+  int PlaneHeight(int plane) const;
+
+  int PlaneChannels(int plane) const;
+
+  int BytesPerSample() const;
+
+  static const int kMaxPlanes = 3;
+
+  QOpenGLContext* context_;
+
+  GLuint textures_[kMaxPlanes];
+
+  int width_;
+
+  int height_;
+
+  olive::YUVInfo info_;
+};
+
+#endif // PLANARTEXTURE_H
@@ -0,0 +1,480 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "profiler.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QTextStream>
+#include <QThread>
+
+#include "config/config.h"
+
+Profiler olive::profiler;
+
+struct Profiler::Ring {
+  Ring() :
+    write_index(0),
+    read_index(0),
+    thread(0)
+  {
+  }
+
+  Sample samples[kProfilerRingSize];
+
+  /// Only written by the thread that owns the ring
+  QAtomicInteger<quint64> write_index;
+
+  /// Only touched by Collect() with lock_ held
+  quint64 read_index;
+
+  int thread;
+};
+
+/**
+ * @brief Holds a thread's ring and returns it to the profiler when the thread exits
+ */
+class Profiler::RingHandle
+{
+public:
+  RingHandle() :
+    ring_(nullptr)
+  {
+  }
+
+  ~RingHandle()
+  {
+    if (ring_ != nullptr) {
+      olive::profiler.ReleaseRing(ring_);
+    }
+  }
+
+  Ring* Get()
+  {
+    if (ring_ == nullptr) {
+      ring_ = olive::profiler.AcquireRing();
+    }
+
+    return ring_;
+  }
+
+private:
+  Ring* ring_;
+};
+
+/**
+ * @brief Innermost ProfilerTimer running on this thread
+ */
+static thread_local ProfilerTimer* current_timer = nullptr;
+
+/**
+ * @brief Quote a string for JSON
+ */
+static QString JsonString(const QString& s)
+{
+  QString quoted;
+  quoted.reserve(s.size() + 2);
+
+  quoted.append('"');
+
+  foreach (QChar c, s) {
+    if (c == '"' || c == '\\') {
+      quoted.append('\\');
+      quoted.append(c);
+    } else if (c.unicode() < 0x20) {
+      quoted.append(QStringLiteral("\\u%1").arg(c.unicode(), 4, 16, QChar('0')));
+    } else {
+      quoted.append(c);
+    }
+  }
+
+  quoted.append('"');
+
+  return quoted;
+}
+
+Profiler::Profiler() :
+  enabled_(0),
+  next_thread_(0),
+  tracing_(false),
+  trace_start_(0)
+{
+  clock_.start();
+}
+
+Profiler::~Profiler()
+{
+}
+
+void Profiler::Enable()
+{
+  enabled_.ref();
+}
+
+void Profiler::Disable()
+{
+  enabled_.deref();
+}
+
+bool Profiler::IsEnabled() const
+{
+  return enabled_.load() > 0;
+}
+
+int Profiler::RegisterSource(const QString &label)
+{
+  QMutexLocker locker(&lock_);
+
+  sources_.append(label);
+
+  return sources_.size() - 1;
+}
+
+QString Profiler::SourceLabel(int source)
+{
+  QMutexLocker locker(&lock_);
+
+  if (source < 0 || source >= sources_.size()) {
+    return QString();
+  }
+
+  return sources_.at(source);
+}
+
+QString Profiler::ThreadName(int thread)
+{
+  QMutexLocker locker(&lock_);
+
+  if (thread < 0 || thread >= thread_names_.size()) {
+    return QString();
+  }
+
+  return thread_names_.at(thread);
+}
+
+QVector<Profiler::Sample> Profiler::Collect()
+{
+  QMutexLocker locker(&lock_);
+
+  QVector<Sample> samples;
+
+  for (const std::unique_ptr<Ring>& ring : rings_) {
+    quint64 end = ring->write_index.loadAcquire();
+
+    // Anything more than a ring behind has already been overwritten
+    quint64 begin = qMax(ring->read_index, (end > kProfilerRingSize) ? end - kProfilerRingSize : Q_UINT64_C(0));
+
+    int first = samples.size();
+
+    for (quint64 i=begin;i<end;i++) {
+      samples.append(ring->samples[i % kProfilerRingSize]);
+    }
+
+    // The owning thread keeps recording while we copy, drop any it may have overwritten in the meantime
+    quint64 written = ring->write_index.loadAcquire();
+
+    if (written > begin + kProfilerRingSize) {
+      int overwritten = static_cast<int>(qMin(written - kProfilerRingSize - begin, end - begin));
+
+      samples.remove(first, overwritten);
+    }
+
+    ring->read_index = end;
+  }
+
+  if (tracing_) {
+    foreach (const Sample& s, samples) {
+      if (s.start >= trace_start_) {
+        trace_.append(s);
+      }
+    }
+  }
+
+  return samples;
+}
+
+void Profiler::StartTrace()
+{
+  QMutexLocker locker(&lock_);
+
+  if (tracing_) {
+    return;
+  }
+
+  tracing_ = true;
+  trace_start_ = Now();
+  trace_.clear();
+
+  locker.unlock();
+
+  Enable();
+}
+
+bool Profiler::StopTrace(const QString &filename)
+{
+  if (!IsTracing()) {
+    return false;
+  }
+
+  // Take what's left in the rings
+  Collect();
+
+  Disable();
+
+  QVector<Sample> trace;
+  QStringList threads;
+  QStringList sources;
+
+  lock_.lock();
+  tracing_ = false;
+  trace.swap(trace_);
+  threads = thread_names_;
+  sources = sources_;
+  lock_.unlock();
+
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    return false;
+  }
+
+  QTextStream stream(&file);
+  stream.setCodec("UTF-8");
+
+  stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+  bool first = true;
+
+  // GPU samples go in a process of their own, on a track per thread that submitted the work. They'd overlap the CPU
+  // samples on the thread's own track, which the trace viewers don't draw properly.
+  for (int pid=1;pid<=2;pid++) {
+    QString process = (pid == 1) ? QStringLiteral("CPU") : QStringLiteral("GPU");
+
+    stream << (first ? "\n" : ",\n")
+           << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+           << ",\"args\":{\"name\":" << JsonString(process) << "}}";
+
+    first = false;
+
+    // Name every thread's track
+    for (int i=0;i<threads.size();i++) {
+      stream << ",\n"
+             << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << i
+             << ",\"args\":{\"name\":" << JsonString(threads.at(i)) << "}}";
+    }
+  }
+
+  foreach (const Sample& s, trace) {
+    QString category = CategoryName(s.category);
+    QString source = (s.source >= 0 && s.source < sources.size()) ? sources.at(s.source) : QString();
+
+    stream << (first ? "\n" : ",\n")
+           << "{\"name\":" << JsonString(source.isEmpty() ? category : source)
+           << ",\"cat\":" << JsonString(category)
+           << ",\"ph\":\"X\",\"pid\":" << (IsGPUCategory(s.category) ? 2 : 1) << ",\"tid\":" << s.thread
+           << ",\"ts\":" << QString::number(static_cast<double>(s.start - trace_start_) / 1000.0, 'f', 3)
+           << ",\"dur\":" << QString::number(static_cast<double>(s.duration) / 1000.0, 'f', 3)
+           << ",\"args\":{";
+
+    if (s.frame >= 0) {
+      stream << "\"frame\":" << QString::number(s.frame, 'f', 6);
+
+      if (s.source >= 0) {
+        stream << ",";
+      }
+    }
+
+    if (s.source >= 0) {
+      stream << "\"node\":" << JsonString(source) << ",\"node_id\":" << s.source;
+    }
+
+    stream << "}}";
+
+    first = false;
+  }
+
+  stream << "\n]}\n";
+
+  stream.flush();
+
+  return file.error() == QFile::NoError;
+}
+
+bool Profiler::IsTracing()
+{
+  QMutexLocker locker(&lock_);
+
+  return tracing_;
+}
+
+QString Profiler::CategoryName(Profiler::Category c)
+{
+  switch (c) {
+  case kNodeRun:
+    return QCoreApplication::translate("Profiler", "Node");
+  case kDecode:
+    return QCoreApplication::translate("Profiler", "Decode");
+  case kColorConvert:
+    return QCoreApplication::translate("Profiler", "Color Conversion");
+  case kUpload:
+    return QCoreApplication::translate("Profiler", "Upload");
+  case kBlit:
+    return QCoreApplication::translate("Profiler", "Blit");
+  case kDownload:
+    return QCoreApplication::translate("Profiler", "Download");
+  case kDiskWrite:
+    return QCoreApplication::translate("Profiler", "Disk Write");
+  case kPrefetch:
+    return QCoreApplication::translate("Profiler", "Prefetch");
+  case kSchedule:
+    return QCoreApplication::translate("Profiler", "Schedule");
+  case kIdle:
+    return QCoreApplication::translate("Profiler", "Idle");
+  case kLockWait:
+    return QCoreApplication::translate("Profiler", "Lock Wait");
+  case kPaint:
+    return QCoreApplication::translate("Profiler", "Paint");
+  case kFrame:
+    return QCoreApplication::translate("Profiler", "Frame");
+  case kGPUNode:
+    return QCoreApplication::translate("Profiler", "GPU Node");
+  case kGPUPass:
+    return QCoreApplication::translate("Profiler", "GPU Pass");
+  case kCategoryCount:
+    break;
+  }
+
+  return QString();
+}
+
+bool Profiler::IsGPUCategory(Profiler::Category c)
+{
+  return (c == kGPUNode || c == kGPUPass);
+}
+
+qint64 Profiler::Now() const
+{
+  return clock_.nsecsElapsed();
+}
+
+void Profiler::Record(const Profiler::Sample &sample)
+{
+  static thread_local RingHandle handle;
+
+  Ring* ring = handle.Get();
+
+  quint64 index = ring->write_index.load();
+
+  ring->samples[index % kProfilerRingSize] = sample;
+  ring->samples[index % kProfilerRingSize].thread = ring->thread;
+
+  ring->write_index.storeRelease(index + 1);
+}
+
+Profiler::Ring *Profiler::AcquireRing()
+{
+  QMutexLocker locker(&lock_);
+
+  Ring* ring;
+
+  if (free_rings_.isEmpty()) {
+    ring = new Ring();
+    rings_.push_back(std::unique_ptr<Ring>(ring));
+  } else {
+    ring = free_rings_.takeLast();
+  }
+
+  ring->thread = next_thread_;
+  next_thread_++;
+
+  // Named for the trace, most of our threads are a QThread subclass of their own
+  QThread* thread = QThread::currentThread();
+  QString name = thread->objectName();
+
+  if (name.isEmpty()) {
+    if (QCoreApplication::instance() != nullptr && thread == QCoreApplication::instance()->thread()) {
+      name = QStringLiteral("Main");
+    } else {
+      name = QString::fromLatin1(thread->metaObject()->className());
+    }
+  }
+
+  thread_names_.append(QStringLiteral("%1 %2").arg(name, QString::number(ring->thread)));
+
+  return ring;
+}
+
+void Profiler::ReleaseRing(Profiler::Ring *ring)
+{
+  QMutexLocker locker(&lock_);
+
+  free_rings_.append(ring);
+}
+
+ProfilerTimer::ProfilerTimer(Profiler::Category category) :
+  active_(false)
+{
+  if (olive::profiler.IsEnabled()) {
+    if (current_timer != nullptr) {
+      Begin(category, current_timer->source_, current_timer->frame_);
+    } else {
+      Begin(category, -1, -1.0);
+    }
+  }
+}
+
+ProfilerTimer::ProfilerTimer(Profiler::Category category, int source, const rational &frame) :
+  active_(false)
+{
+  if (olive::profiler.IsEnabled()) {
+    Begin(category, source, frame.toDouble());
+  }
+}
+
+ProfilerTimer::~ProfilerTimer()
+{
+  if (!active_) {
+    return;
+  }
+
+  qint64 duration = olive::profiler.Now() - start_;
+
+  olive::profiler.Record({category_, source_, frame_, 0, start_, duration, duration - children_duration_});
+
+  if (parent_ != nullptr) {
+    parent_->children_duration_ += duration;
+  }
+
+  current_timer = parent_;
+}
+
+void ProfilerTimer::Begin(Profiler::Category category, int source, double frame)
+{
+  active_ = true;
+  category_ = category;
+  source_ = source;
+  frame_ = frame;
+  children_duration_ = 0;
+  parent_ = current_timer;
+
+  current_timer = this;
+
+  start_ = olive::profiler.Now();
+}
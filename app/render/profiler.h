@@ -0,0 +1,236 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <memory>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+
+#include "common/rational.h"
+
+/**
+ * @brief Collects timings of the work done to render each frame
+ *
+ * Work is timed with a ProfilerTimer, which records a Sample to a ring buffer belonging to the thread it ran on, so
+ * recording never takes a lock or allocates. Collect() gathers whatever has been recorded since it was last called.
+ * Rings are a fixed size, so samples are lost if Collect() isn't called often enough, which is fine for profiling.
+ *
+ * Profiling is disabled by default, in which case a ProfilerTimer costs a single atomic load. It's enabled for as long
+ * as anything that uses the samples (e.g. a ProfilerView or a trace, see StartTrace()) needs it.
+ *
+ * GL calls are timed as the CPU sees them, so a timed upload or blit only includes the time the driver took to queue
+ * it unless it stalled waiting for the GPU. What the GPU spends on them is timed separately by GPUTimer into the GPU
+ * categories (see IsGPUCategory()).
+ */
+class Profiler
+{
+public:
+  enum Category {
+    kNodeRun,
+    kDecode,
+    kColorConvert,
+    kUpload,
+    kBlit,
+    kDownload,
+    kDiskWrite,
+    kPrefetch,
+    kSchedule,
+    kIdle,
+    kLockWait,
+    kPaint,
+    kFrame,
+
+    // Timed on the GPU (see GPUTimer)
+    kGPUNode,
+    kGPUPass,
+
+    kCategoryCount
+  };
+
+  struct Sample {
+    Category category;
+
+    /// Returned by RegisterSource() for what the work was done for (e.g. a Node), -1 if it wasn't for anything specific
+    int source;
+
+    /// Time of the frame the work was done for in seconds, negative if unknown
+    double frame;
+
+    /// Identifies the thread the work was done on
+    int thread;
+
+    /// Nanoseconds since the profiler was created that the work started at
+    qint64 start;
+
+    /// Nanoseconds the work took
+    qint64 duration;
+
+    /// Nanoseconds the work took excluding any other work timed within it
+    qint64 self_duration;
+  };
+
+  Profiler();
+
+  ~Profiler();
+
+  /**
+   * @brief Enable profiling until a matching call to Disable()
+   */
+  void Enable();
+
+  void Disable();
+
+  bool IsEnabled() const;
+
+  /**
+   * @brief Register something that work is timed for and return its ID for samples
+   */
+  int RegisterSource(const QString& label);
+
+  QString SourceLabel(int source);
+
+  /**
+   * @brief Name of a thread that samples were recorded on
+   */
+  QString ThreadName(int thread);
+
+  /**
+   * @brief Return every sample recorded since the last call, from every thread
+   */
+  QVector<Sample> Collect();
+
+  /**
+   * @brief Start keeping every sample collected from now on for a trace
+   *
+   * Samples still have to be collected regularly while tracing so the rings don't overflow.
+   */
+  void StartTrace();
+
+  /**
+   * @brief Stop tracing and write the trace to a file
+   *
+   * The trace is written in Chrome's trace event format, which chrome://tracing and Perfetto's UI can open. Each
+   * sample is an event on its thread's track with the frame and source it was for in its arguments.
+   */
+  bool StopTrace(const QString& filename);
+
+  bool IsTracing();
+
+  static QString CategoryName(Category c);
+
+  /**
+   * @brief Returns TRUE if samples of this category were timed on the GPU rather than the thread they were recorded on
+   */
+  static bool IsGPUCategory(Category c);
+
+  /**
+   * @brief Nanoseconds since the profiler was created
+   */
+  qint64 Now() const;
+
+  /**
+   * @brief Record a sample to the calling thread's ring
+   */
+  void Record(const Sample& sample);
+
+private:
+  struct Ring;
+
+  class RingHandle;
+
+  Ring* AcquireRing();
+
+  void ReleaseRing(Ring* ring);
+
+  QAtomicInt enabled_;
+
+  QElapsedTimer clock_;
+
+  std::vector<std::unique_ptr<Ring>> rings_;
+
+  /// Rings of threads that have exited, reused by new threads
+  QVector<Ring*> free_rings_;
+
+  int next_thread_;
+
+  QStringList sources_;
+
+  QStringList thread_names_;
+
+  bool tracing_;
+
+  qint64 trace_start_;
+
+  QVector<Sample> trace_;
+
+  QMutex lock_;
+
+};
+
+/**
+ * @brief Times the scope it's declared in and records it to olive::profiler
+ *
+ * Timers nest: a timer without a source of its own is attributed to the innermost timer around it on the same thread
+ * (e.g. a decode inside a Node's Run()), and a timer's self time excludes the timers within it.
+ */
+class ProfilerTimer
+{
+public:
+  /**
+   * @brief Time work for the same source and frame as the timer around it
+   */
+  ProfilerTimer(Profiler::Category category);
+
+  ProfilerTimer(Profiler::Category category, int source, const rational& frame);
+
+  ~ProfilerTimer();
+
+  ProfilerTimer(const ProfilerTimer& other) = delete;
+  ProfilerTimer& operator=(const ProfilerTimer& other) = delete;
+
+private:
+  void Begin(Profiler::Category category, int source, double frame);
+
+  bool active_;
+
+  Profiler::Category category_;
+
+  int source_;
+
+  double frame_;
+
+  qint64 start_;
+
+  qint64 children_duration_;
+
+  ProfilerTimer* parent_;
+};
+
+namespace olive {
+extern Profiler profiler;
+}
+
+#endif // PROFILER_H
@@ -0,0 +1,413 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderbenchmark.h"
+
+#include <algorithm>
+#include <QColor>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QEventLoop>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <QTimer>
+#include <QtMath>
+
+#ifdef Q_OS_WIN
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#include "common/filefunctions.h"
+#include "node/block/clip/clip.h"
+#include "node/color/opacity/opacity.h"
+#include "node/generator/solid/solid.h"
+#include "node/output/timeline/timeline.h"
+#include "node/output/track/track.h"
+#include "node/processor/renderer/renderer.h"
+#include "node/processor/renderer/renderercachecodec.h"
+#include "render/diskcachemanager.h"
+#include "render/imagecache.h"
+#include "render/pixelservice.h"
+#include "render/profiler.h"
+
+/**
+ * @brief Format a number of bytes in mebibytes for the report
+ */
+static QString FormatBytes(qint64 bytes)
+{
+  return QCoreApplication::translate("RenderBenchmark", "%1 MiB").arg(static_cast<double>(bytes) / 1048576.0,
+                                                                      0,
+                                                                      'f',
+                                                                      1);
+}
+
+static QString FormatLatency(qint64 nsecs)
+{
+  return QCoreApplication::translate("RenderBenchmark", "%1 ms").arg(static_cast<double>(nsecs) / 1000000.0, 0, 'f', 2);
+}
+
+RenderBenchmark::RenderBenchmark(const RenderBenchmark::Params &params) :
+  params_(params),
+  timebase_(1, 24),
+  timeline_(nullptr),
+  renderer_(nullptr),
+  frames_(0),
+  elapsed_(0),
+  peak_memory_(-1),
+  peak_mem_buf_(0),
+  peak_tex_buf_(0),
+  bytes_written_(0)
+{
+}
+
+RenderBenchmark::~RenderBenchmark()
+{
+  graph_.Release();
+}
+
+RenderBenchmark::Params RenderBenchmark::DefaultParams()
+{
+  Params params;
+
+  params.tracks = 4;
+  params.clips = 10;
+  params.clip_length = 24;
+  params.effects = 2;
+  params.width = 1920;
+  params.height = 1080;
+  params.format = olive::PIX_FMT_RGBA16F;
+
+  return params;
+}
+
+olive::PixelFormat RenderBenchmark::FormatFromName(const QString &name)
+{
+  QString lower = name.toLower();
+
+  if (lower == "rgba8") {
+    return olive::PIX_FMT_RGBA8;
+  } else if (lower == "rgba16u") {
+    return olive::PIX_FMT_RGBA16U;
+  } else if (lower == "rgba16f") {
+    return olive::PIX_FMT_RGBA16F;
+  } else if (lower == "rgba32f") {
+    return olive::PIX_FMT_RGBA32F;
+  } else if (lower == "rgb10a2") {
+    return olive::PIX_FMT_RGB10A2;
+  }
+
+  return olive::PIX_FMT_INVALID;
+}
+
+bool RenderBenchmark::Run()
+{
+  if (params_.tracks < 1
+      || params_.clips < 1
+      || params_.clip_length < 1
+      || params_.effects < 0
+      || params_.width < 1
+      || params_.height < 1) {
+    error_ = tr("Invalid benchmark parameters");
+    return false;
+  }
+
+  if (params_.format == olive::PIX_FMT_INVALID) {
+    error_ = tr("Invalid pixel format");
+    return false;
+  }
+
+  // Render every frame from scratch, unless it's a shared cache that's being benchmarked
+  QTemporaryDir cache_dir;
+  bool temporary_cache = !HasSharedRenderCache();
+
+  if (temporary_cache) {
+    if (!cache_dir.isValid()) {
+      error_ = tr("Failed to create a temporary render cache");
+      return false;
+    }
+
+    SetRenderCacheLocation(cache_dir.path());
+  }
+
+  CreateGraph();
+
+  // Start the backend now so creating its contexts and threads isn't timed
+  if (renderer_->ShareContext() == nullptr) {
+    error_ = tr("Failed to create an OpenGL context");
+
+    if (temporary_cache) {
+      SetRenderCacheLocation(QString());
+    }
+
+    return false;
+  }
+
+  olive::profiler.Enable();
+
+  // Discard anything recorded before now
+  olive::profiler.Collect();
+
+  olive::image_cache.ResetPeak(ImageCache::kMemBuf);
+  olive::image_cache.ResetPeak(ImageCache::kTexBuf);
+
+  qint64 bytes_written = olive::disk_cache_manager.bytes_written();
+
+  QEventLoop loop;
+  connect(renderer_, SIGNAL(CacheFinished()), &loop, SLOT(quit()));
+
+  QTimer collect_timer;
+  collect_timer.setInterval(100);
+  connect(&collect_timer, SIGNAL(timeout()), this, SLOT(CollectSamples()));
+  collect_timer.start();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  // Connecting the sequence to the renderer queues all of it to be cached
+  NodeParam::ConnectEdge(timeline_->length_output(), renderer_->length_input());
+  NodeParam::ConnectEdge(timeline_->texture_output(), renderer_->texture_input());
+
+  loop.exec();
+
+  elapsed_ = timer.nsecsElapsed();
+
+  collect_timer.stop();
+  CollectSamples();
+
+  olive::profiler.Disable();
+
+  std::sort(latencies_.begin(), latencies_.end());
+  frames_ = latencies_.size();
+
+  peak_memory_ = PeakProcessMemory();
+  peak_mem_buf_ = olive::image_cache.peak(ImageCache::kMemBuf);
+  peak_tex_buf_ = olive::image_cache.peak(ImageCache::kTexBuf);
+  bytes_written_ = olive::disk_cache_manager.bytes_written() - bytes_written;
+
+  // Stop the renderer before its temporary cache is deleted
+  graph_.Release();
+
+  if (temporary_cache) {
+    SetRenderCacheLocation(QString());
+  }
+
+  return true;
+}
+
+const QString &RenderBenchmark::error() const
+{
+  return error_;
+}
+
+double RenderBenchmark::Throughput() const
+{
+  double seconds = static_cast<double>(elapsed_) / 1000000000.0;
+
+  return (seconds > 0.0) ? static_cast<double>(frames_) / seconds : 0.0;
+}
+
+QString RenderBenchmark::Report() const
+{
+  QStringList lines;
+
+  lines.append(tr("Sequence: %1 tracks of %2 clips (%3 frames each, %4 effects each) at %5x%6 %7").arg(
+                 QString::number(params_.tracks),
+                 QString::number(params_.clips),
+                 QString::number(params_.clip_length),
+                 QString::number(params_.effects),
+                 QString::number(params_.width),
+                 QString::number(params_.height),
+                 PixelService::GetPixelFormatInfo(params_.format).name));
+
+  double seconds = static_cast<double>(elapsed_) / 1000000000.0;
+
+  lines.append(tr("Frames rendered: %1 in %2 s").arg(QString::number(frames_), QString::number(seconds, 'f', 2)));
+
+  lines.append(tr("Throughput: %1 frames/s").arg(Throughput(), 0, 'f', 2));
+
+  lines.append(tr("Frame latency: %1 (50th percentile), %2 (99th percentile)").arg(FormatLatency(Latency(0.5)),
+                                                                                   FormatLatency(Latency(0.99))));
+
+  lines.append(tr("Peak RAM: %1 (process), %2 (frame buffers)").arg(
+                 peak_memory_ < 0 ? tr("unknown") : FormatBytes(peak_memory_),
+                 FormatBytes(peak_mem_buf_)));
+
+  lines.append(tr("Peak VRAM: %1 (textures)").arg(FormatBytes(peak_tex_buf_)));
+
+  lines.append(tr("Written to disk cache: %1").arg(FormatBytes(bytes_written_)));
+
+  return lines.join('\n');
+}
+
+bool RenderBenchmark::WriteReport(const QString &filename) const
+{
+  QJsonObject params;
+  params.insert("tracks", params_.tracks);
+  params.insert("clips", params_.clips);
+  params.insert("clip_length", params_.clip_length);
+  params.insert("effects", params_.effects);
+  params.insert("width", params_.width);
+  params.insert("height", params_.height);
+  params.insert("format", PixelService::GetPixelFormatInfo(params_.format).name);
+
+  QJsonObject results;
+  results.insert("frames", frames_);
+  results.insert("seconds", static_cast<double>(elapsed_) / 1000000000.0);
+  results.insert("latency_p50_ms", static_cast<double>(Latency(0.5)) / 1000000.0);
+  results.insert("latency_p99_ms", static_cast<double>(Latency(0.99)) / 1000000.0);
+  results.insert("peak_process_memory", static_cast<double>(peak_memory_));
+  results.insert("peak_frame_buffer_memory", static_cast<double>(peak_mem_buf_));
+  results.insert("peak_texture_memory", static_cast<double>(peak_tex_buf_));
+  results.insert("disk_bytes_written", static_cast<double>(bytes_written_));
+
+  QJsonObject root;
+  root.insert("params", params);
+  root.insert("results", results);
+
+  QFile file(filename);
+
+  if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+    return false;
+  }
+
+  file.write(QJsonDocument(root).toJson());
+
+  return true;
+}
+
+void RenderBenchmark::CreateGraph()
+{
+  rational clip_length = rational(params_.clip_length) * timebase_;
+
+  timeline_ = new TimelineOutput();
+  timeline_->SetTimebase(timebase_);
+  graph_.AddNode(timeline_);
+
+  renderer_ = new RendererProcessor();
+  renderer_->SetParameters(params_.width, params_.height, params_.format, olive::RenderMode::kOffline, 1);
+  renderer_->SetCacheFormat(RendererCacheCodec::FormatForPriority(olive::kCachePrioritizeBalanced));
+  renderer_->SetTimebase(timebase_);
+  graph_.AddNode(renderer_);
+
+  TrackOutput* previous_track = nullptr;
+
+  for (int i=0;i<params_.tracks;i++) {
+    TrackOutput* track = new TrackOutput();
+    graph_.AddNode(track);
+
+    // The first track connects to the timeline and every other track connects to the one before it
+    if (previous_track == nullptr) {
+      NodeParam::ConnectEdge(track->track_output(), timeline_->track_input());
+    } else {
+      NodeParam::ConnectEdge(track->track_output(), previous_track->track_input());
+    }
+
+    previous_track = track;
+
+    // Tracks above the first are translucent so every track has to be composited
+    double alpha = (i == 0) ? 1.0 : 0.5;
+
+    for (int j=0;j<params_.clips;j++) {
+      ClipBlock* clip = new ClipBlock();
+      clip->set_length(clip_length);
+      track->AppendBlock(clip);
+
+      SolidGenerator* solid = new SolidGenerator();
+      graph_.AddNode(solid);
+
+      // Animate the color across the clip so no two frames are the same
+      double hue = static_cast<double>((i * params_.clips + j) % 12) / 12.0;
+
+      solid->color_input()->set_value(QColor::fromHsvF(hue, 1.0, 1.0, alpha));
+      solid->color_input()->set_keyframing(true);
+
+      NodeKeyframe end_key;
+      end_key.set_time(clip_length);
+      end_key.set_value(QColor::fromHsvF(hue, 1.0, 0.25, alpha));
+      end_key.set_type(NodeKeyframe::kLinear);
+      solid->color_input()->insert_keyframe(end_key);
+
+      NodeOutput* texture = solid->texture_output();
+
+      for (int k=0;k<params_.effects;k++) {
+        OpacityNode* effect = new OpacityNode();
+        graph_.AddNode(effect);
+
+        NodeParam::ConnectEdge(texture, effect->texture_input());
+
+        texture = effect->texture_output();
+      }
+
+      NodeParam::ConnectEdge(texture, clip->texture_input());
+    }
+  }
+}
+
+qint64 RenderBenchmark::Latency(double p) const
+{
+  if (latencies_.isEmpty()) {
+    return 0;
+  }
+
+  return latencies_.at(qMax(0, qCeil(latencies_.size() * p) - 1));
+}
+
+qint64 RenderBenchmark::PeakProcessMemory()
+{
+#ifdef Q_OS_WIN
+  PROCESS_MEMORY_COUNTERS counters;
+
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+    return -1;
+  }
+
+  return static_cast<qint64>(counters.PeakWorkingSetSize);
+#else
+  struct rusage usage;
+
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return -1;
+  }
+
+#ifdef Q_OS_MAC
+  // macOS reports bytes
+  return static_cast<qint64>(usage.ru_maxrss);
+#else
+  // Everything else reports kilobytes
+  return static_cast<qint64>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+void RenderBenchmark::CollectSamples()
+{
+  QVector<Profiler::Sample> samples = olive::profiler.Collect();
+
+  foreach (const Profiler::Sample& s, samples) {
+    if (s.category == Profiler::kFrame) {
+      latencies_.append(s.duration);
+    }
+  }
+}
@@ -0,0 +1,156 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERBENCHMARK_H
+#define RENDERBENCHMARK_H
+
+#include <QObject>
+#include <QVector>
+
+#include "common/rational.h"
+#include "node/graph.h"
+#include "render/pixelformat.h"
+
+class RendererProcessor;
+class TimelineOutput;
+
+/**
+ * @brief Measures rendering throughput with a generated sequence
+ *
+ * A sequence of solid color clips is generated from the parameters - each clip's color is animated so every frame
+ * hashes (and is therefore rendered) differently, clips on tracks above the first are translucent so every track is
+ * composited, and each clip has a stack of effects. The whole sequence is then cached into an empty render cache, just
+ * like the renderer caches a sequence in the background, and the time taken, each frame's latency, peak memory and
+ * bytes written to disk are reported.
+ *
+ * Nothing here depends on media or a project, so the results of the same parameters are comparable between
+ * versions and machines. Used by `--benchmark` (see Core::RunHeadless()).
+ */
+class RenderBenchmark : public QObject
+{
+  Q_OBJECT
+public:
+  struct Params {
+    int tracks;
+
+    /// Number of clips on each track
+    int clips;
+
+    /// Length of each clip in frames
+    int clip_length;
+
+    /// Number of effects on each clip
+    int effects;
+
+    int width;
+    int height;
+    olive::PixelFormat format;
+  };
+
+  RenderBenchmark(const Params& params);
+
+  virtual ~RenderBenchmark() override;
+
+  /**
+   * @brief Returns the default parameters, a sequence roughly as demanding as a typical edit
+   */
+  static Params DefaultParams();
+
+  /**
+   * @brief Returns the pixel format called `name` (e.g. "rgba16f"), or PIX_FMT_INVALID if there isn't one
+   */
+  static olive::PixelFormat FormatFromName(const QString& name);
+
+  /**
+   * @brief Generate the sequence and render it, blocking until it's finished
+   *
+   * Must be called from the main thread. Returns FALSE if the benchmark couldn't run, see error().
+   */
+  bool Run();
+
+  const QString& error() const;
+
+  /**
+   * @brief Returns how many frames per second Run() rendered
+   */
+  double Throughput() const;
+
+  /**
+   * @brief Returns a human-readable summary of the results of Run()
+   */
+  QString Report() const;
+
+  /**
+   * @brief Write the parameters and results of Run() to a JSON file for comparing with later runs
+   */
+  bool WriteReport(const QString& filename) const;
+
+private:
+  /**
+   * @brief Generate the sequence and the renderer to cache it with in graph_
+   */
+  void CreateGraph();
+
+  /**
+   * @brief Returns the percentile `p` (0.0 - 1.0) of latencies_ in nanoseconds
+   */
+  qint64 Latency(double p) const;
+
+  /**
+   * @brief Returns the peak resident memory of this process in bytes, or -1 if it isn't available
+   */
+  static qint64 PeakProcessMemory();
+
+  Params params_;
+
+  rational timebase_;
+
+  NodeGraph graph_;
+
+  TimelineOutput* timeline_;
+
+  RendererProcessor* renderer_;
+
+  QString error_;
+
+  int frames_;
+
+  qint64 elapsed_;
+
+  /// Duration of every frame rendered in nanoseconds, sorted
+  QVector<qint64> latencies_;
+
+  qint64 peak_memory_;
+
+  qint64 peak_mem_buf_;
+
+  qint64 peak_tex_buf_;
+
+  qint64 bytes_written_;
+
+private slots:
+  /**
+   * @brief Takes the frame timings out of the profiler before its rings fill up
+   */
+  void CollectSamples();
+
+};
+
+#endif // RENDERBENCHMARK_H
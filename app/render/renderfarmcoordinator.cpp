@@ -0,0 +1,268 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderfarmcoordinator.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include "common/filefunctions.h"
+#include "config/config.h"
+
+RenderFarmCoordinator::RenderFarmCoordinator(const QString &project_filename,
+                                             const QString &sequence,
+                                             const int64_t &frame_count,
+                                             const QStringList &workers) :
+  project_filename_(QFileInfo(project_filename).absoluteFilePath()),
+  sequence_(sequence),
+  frame_count_(frame_count),
+  rendered_ranges_(0),
+  range_count_(0)
+{
+  foreach (const QString& worker, workers) {
+    QStringList command = worker.trimmed().split(QRegularExpression(QStringLiteral("\\s+")));
+
+    if (!command.first().isEmpty()) {
+      commands_.append(command);
+    }
+  }
+
+  // Without a farm, run one worker on this machine with the same executable
+  if (commands_.isEmpty()) {
+    commands_.append(QStringList(QCoreApplication::applicationFilePath()));
+  }
+
+  processes_.fill(nullptr, commands_.size());
+  running_ranges_.resize(commands_.size());
+  failed_workers_.fill(false, commands_.size());
+}
+
+RenderFarmCoordinator::~RenderFarmCoordinator()
+{
+  // Don't leave workers rendering for nobody
+  foreach (QProcess* process, processes_) {
+    if (process != nullptr) {
+      process->disconnect(this);
+      process->kill();
+      process->waitForFinished();
+    }
+  }
+}
+
+bool RenderFarmCoordinator::Run()
+{
+  if (frame_count_ <= 0) {
+    error_ = tr("Nothing to render");
+    return false;
+  }
+
+  // Workers on other machines can't write to this one's local cache
+  if (!HasSharedRenderCache()) {
+    error_ = tr("A render farm needs a render cache shared by every worker, use --render-cache");
+    return false;
+  }
+
+  pending_ranges_.clear();
+
+  for (int64_t i=0;i<frame_count_;i+=kRenderFarmRangeFrames) {
+    Range range = {i, qMin(frame_count_, i + kRenderFarmRangeFrames) - 1};
+    pending_ranges_.enqueue(range);
+  }
+
+  range_count_ = pending_ranges_.size();
+  rendered_ranges_ = 0;
+
+  qInfo().noquote() << tr("Rendering %1 frames in %2 ranges with %3 workers").arg(QString::number(frame_count_),
+                                                                                QString::number(range_count_),
+                                                                                QString::number(commands_.size()));
+
+  for (int i=0;i<commands_.size();i++) {
+    StartNextRange(i);
+  }
+
+  // A worker that fails to start may already have been handled
+  if (processes_.count(nullptr) < processes_.size()) {
+    loop_.exec();
+  }
+
+  if (rendered_ranges_ < range_count_) {
+    error_ = tr("%1 of %2 ranges couldn't be rendered, every worker failed").arg(
+          QString::number(range_count_ - rendered_ranges_),
+          QString::number(range_count_));
+    return false;
+  }
+
+  return true;
+}
+
+const QString &RenderFarmCoordinator::error() const
+{
+  return error_;
+}
+
+QString RenderFarmCoordinator::QuoteForShell(const QString &argument)
+{
+  // Nothing is special inside single quotes, so only single quotes themselves need escaping (by closing the quotes,
+  // adding an escaped quote and opening them again)
+  QString quoted = argument;
+
+  quoted.replace(QLatin1Char('\''), QStringLiteral("'\\''"));
+
+  return QStringLiteral("'%1'").arg(quoted);
+}
+
+void RenderFarmCoordinator::StartNextRange(int index)
+{
+  if (pending_ranges_.isEmpty() || failed_workers_.at(index) || processes_.at(index) != nullptr) {
+    return;
+  }
+
+  Range range = pending_ranges_.dequeue();
+
+  QStringList olive_arguments;
+
+  olive_arguments.append(project_filename_);
+
+  if (!sequence_.isEmpty()) {
+    olive_arguments.append(QStringLiteral("--sequence"));
+    olive_arguments.append(sequence_);
+  }
+
+  olive_arguments.append(QStringLiteral("--render-cache"));
+  olive_arguments.append(GetRenderCacheLocation());
+
+  olive_arguments.append(QStringLiteral("--render-range"));
+  olive_arguments.append(QStringLiteral("%1-%2").arg(QString::number(range.start), QString::number(range.end)));
+
+  // Wrappers like ssh hand their arguments to a remote shell, which would split paths and names like "Sequence 1"
+  bool remote_shell = (commands_.at(index).size() > 1);
+
+  QStringList arguments = commands_.at(index).mid(1);
+
+  foreach (const QString& argument, olive_arguments) {
+    arguments.append(remote_shell ? QuoteForShell(argument) : argument);
+  }
+
+  QProcess* process = new QProcess(this);
+
+  // The workers' logs go wherever ours does
+  process->setProcessChannelMode(QProcess::ForwardedChannels);
+
+  connect(process,
+          SIGNAL(finished(int, QProcess::ExitStatus)),
+          this,
+          SLOT(WorkerFinished(int, QProcess::ExitStatus)));
+  connect(process,
+          SIGNAL(errorOccurred(QProcess::ProcessError)),
+          this,
+          SLOT(WorkerError(QProcess::ProcessError)));
+
+  processes_[index] = process;
+  running_ranges_[index] = range;
+
+  process->start(commands_.at(index).first(), arguments);
+}
+
+void RenderFarmCoordinator::WorkerFailed(int index, const QString &reason)
+{
+  const Range& range = running_ranges_.at(index);
+
+  qWarning().noquote() << tr("Worker \"%1\" failed to render frames %2-%3 (%4), it won't be used again").arg(
+                            commands_.at(index).join(' '),
+                            QString::number(range.start),
+                            QString::number(range.end),
+                            reason);
+
+  failed_workers_[index] = true;
+
+  // Render it next, on whichever worker is free first
+  pending_ranges_.prepend(range);
+
+  for (int i=0;i<processes_.size();i++) {
+    if (processes_.at(i) == nullptr) {
+      StartNextRange(i);
+    }
+  }
+}
+
+void RenderFarmCoordinator::CheckFinished()
+{
+  if (processes_.count(nullptr) == processes_.size()) {
+    loop_.quit();
+  }
+}
+
+void RenderFarmCoordinator::WorkerFinished(int exit_code, QProcess::ExitStatus exit_status)
+{
+  QProcess* process = static_cast<QProcess*>(sender());
+  int index = processes_.indexOf(process);
+
+  if (index == -1) {
+    return;
+  }
+
+  processes_[index] = nullptr;
+  process->deleteLater();
+
+  if (exit_status == QProcess::NormalExit && exit_code == 0) {
+    const Range& range = running_ranges_.at(index);
+
+    rendered_ranges_++;
+
+    qInfo().noquote() << tr("Frames %1-%2 rendered by \"%3\" (%4 of %5 ranges)").arg(
+                           QString::number(range.start),
+                           QString::number(range.end),
+                           commands_.at(index).join(' '),
+                           QString::number(rendered_ranges_),
+                           QString::number(range_count_));
+
+    StartNextRange(index);
+  } else if (exit_status == QProcess::CrashExit) {
+    WorkerFailed(index, tr("crashed"));
+  } else {
+    WorkerFailed(index, tr("exit code %1").arg(exit_code));
+  }
+
+  CheckFinished();
+}
+
+void RenderFarmCoordinator::WorkerError(QProcess::ProcessError error)
+{
+  // Anything else is followed by finished()
+  if (error != QProcess::FailedToStart) {
+    return;
+  }
+
+  QProcess* process = static_cast<QProcess*>(sender());
+  int index = processes_.indexOf(process);
+
+  if (index == -1) {
+    return;
+  }
+
+  processes_[index] = nullptr;
+  process->deleteLater();
+
+  WorkerFailed(index, process->errorString());
+
+  CheckFinished();
+}
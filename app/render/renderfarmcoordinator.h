@@ -0,0 +1,151 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERFARMCOORDINATOR_H
+#define RENDERFARMCOORDINATOR_H
+
+#include <QEventLoop>
+#include <QProcess>
+#include <QQueue>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief Splits a sequence into ranges and renders them into the shared render cache with a farm of workers
+ *
+ * Run with `--render-farm` (see Core::RunHeadless()). Each worker is a command that starts Olive on one machine of the
+ * farm (e.g. `ssh gpu01 olive`), which is run with the project, `--render-range` and `--render-cache` appended (see
+ * RenderFarmWorker). The project and the cache must be at the same paths on every machine.
+ *
+ * A command with arguments of its own is a wrapper that runs Olive through a remote shell (like ssh, which joins its
+ * arguments and has the remote shell split them again), so the appended arguments are quoted for a POSIX shell. A
+ * command without arguments is run directly with the arguments unquoted.
+ *
+ * The sequence is split into ranges of kRenderFarmRangeFrames and each worker is given the next range as soon as it
+ * finishes one, so faster machines render more of the sequence. A worker that fails is not used again and its range is
+ * handed to the others.
+ */
+class RenderFarmCoordinator : public QObject
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief RenderFarmCoordinator Constructor
+   *
+   * @param project_filename
+   *
+   * Project each worker loads.
+   *
+   * @param sequence
+   *
+   * Name of the sequence to render, empty for the first.
+   *
+   * @param frame_count
+   *
+   * Number of frames in the sequence.
+   *
+   * @param workers
+   *
+   * Command that starts each worker, with arguments separated by spaces. Commands with arguments must run Olive
+   * through a POSIX shell (see above). If empty, a single worker runs on this machine.
+   */
+  RenderFarmCoordinator(const QString& project_filename,
+                        const QString& sequence,
+                        const int64_t& frame_count,
+                        const QStringList& workers);
+
+  virtual ~RenderFarmCoordinator() override;
+
+  /**
+   * @brief Render every range, blocking until they've all been rendered or every worker has failed
+   *
+   * Must be called from the main thread. Returns FALSE if the sequence couldn't be rendered, see error().
+   */
+  bool Run();
+
+  const QString& error() const;
+
+private:
+  struct Range {
+    int64_t start;
+    int64_t end;
+  };
+
+  /**
+   * @brief Quote an argument so a POSIX shell passes it on as-is, whatever spaces or metacharacters it contains
+   */
+  static QString QuoteForShell(const QString& argument);
+
+  /**
+   * @brief Start worker `index` on the next range, or leave it idle if there are none left
+   */
+  void StartNextRange(int index);
+
+  /**
+   * @brief Stop using worker `index` and hand its range to the others
+   */
+  void WorkerFailed(int index, const QString& reason);
+
+  /**
+   * @brief Stop the event loop in Run() once no worker is running
+   */
+  void CheckFinished();
+
+  QString project_filename_;
+
+  QString sequence_;
+
+  int64_t frame_count_;
+
+  /**
+   * @brief Program and arguments of each worker
+   */
+  QVector<QStringList> commands_;
+
+  /**
+   * @brief Each worker's process, nullptr while it's idle (or after it has failed)
+   */
+  QVector<QProcess*> processes_;
+
+  /**
+   * @brief The range each worker is rendering
+   */
+  QVector<Range> running_ranges_;
+
+  QVector<bool> failed_workers_;
+
+  QQueue<Range> pending_ranges_;
+
+  int rendered_ranges_;
+
+  int range_count_;
+
+  QString error_;
+
+  QEventLoop loop_;
+
+private slots:
+  void WorkerFinished(int exit_code, QProcess::ExitStatus exit_status);
+
+  void WorkerError(QProcess::ProcessError error);
+
+};
+
+#endif // RENDERFARMCOORDINATOR_H
@@ -0,0 +1,97 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderfarmworker.h"
+
+#include <QDebug>
+
+#include "node/processor/renderer/renderer.h"
+
+RenderFarmWorker::RenderFarmWorker(RendererProcessor *renderer, const int64_t &start, const int64_t &end) :
+  renderer_(renderer),
+  start_(start),
+  end_(end),
+  fill_finished_(false)
+{
+}
+
+bool RenderFarmWorker::Run()
+{
+  if (start_ < 0 || end_ < start_) {
+    error_ = tr("Invalid range %1-%2").arg(QString::number(start_), QString::number(end_));
+    return false;
+  }
+
+  // FillCache() has nothing to fill without these, and would never finish
+  if (!renderer_->texture_input()->IsConnected() || renderer_->length_input()->get_value(0).toRational().isNull()) {
+    error_ = tr("Nothing to render");
+    return false;
+  }
+
+  if (renderer_->ShareContext() == nullptr) {
+    error_ = tr("Failed to create an OpenGL context");
+    return false;
+  }
+
+  connect(renderer_, SIGNAL(FillFinished()), this, SLOT(RendererFillFinished()));
+  connect(renderer_, SIGNAL(CacheFinished()), this, SLOT(RendererCacheFinished()));
+
+  renderer_->SetCacheRange(start_, end_);
+
+  // Emits FillFinished() straight away if every frame is already cached
+  fill_finished_ = false;
+  renderer_->FillCache();
+
+  if (!fill_finished_ || renderer_->IsCacheBusy()) {
+    loop_.exec();
+  }
+
+  disconnect(renderer_, SIGNAL(FillFinished()), this, SLOT(RendererFillFinished()));
+  disconnect(renderer_, SIGNAL(CacheFinished()), this, SLOT(RendererCacheFinished()));
+
+  qInfo() << "Rendered frames" << start_ << "to" << end_;
+
+  return true;
+}
+
+const QString &RenderFarmWorker::error() const
+{
+  return error_;
+}
+
+void RenderFarmWorker::CheckFinished()
+{
+  // Rendered frames are only mapped (and CacheFinished() emitted) once they've been written to disk
+  if (fill_finished_ && !renderer_->IsCacheBusy()) {
+    loop_.quit();
+  }
+}
+
+void RenderFarmWorker::RendererFillFinished()
+{
+  fill_finished_ = true;
+
+  CheckFinished();
+}
+
+void RenderFarmWorker::RendererCacheFinished()
+{
+  CheckFinished();
+}
@@ -0,0 +1,88 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERFARMWORKER_H
+#define RENDERFARMWORKER_H
+
+#include <QEventLoop>
+#include <QObject>
+
+class RendererProcessor;
+
+/**
+ * @brief Renders one range of a sequence into the render cache, as one machine of a render farm
+ *
+ * Run with `--render-range` (see Core::RunHeadless()), usually by a RenderFarmCoordinator. Frames are rendered by the
+ * sequence's own RendererProcessor, so they're stored under the same hashes and cache ID as the workstation would
+ * store them. With a shared render cache (see SetSharedRenderCacheLocation()), every machine using it then finds them
+ * with RendererProcessor::HasHash(), and frames another worker already rendered are skipped here.
+ */
+class RenderFarmWorker : public QObject
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief RenderFarmWorker Constructor
+   *
+   * @param renderer
+   *
+   * The renderer of a sequence that's already loaded.
+   *
+   * @param start, end
+   *
+   * First and last frame to render (inclusive, in the renderer's timebase).
+   */
+  RenderFarmWorker(RendererProcessor* renderer, const int64_t& start, const int64_t& end);
+
+  /**
+   * @brief Render the range, blocking until every frame has been written to the cache
+   *
+   * Must be called from the main thread. Returns FALSE if the range couldn't be rendered, see error().
+   */
+  bool Run();
+
+  const QString& error() const;
+
+private:
+  /**
+   * @brief Stop the event loop in Run() once the range is rendered and nothing is left to download
+   */
+  void CheckFinished();
+
+  RendererProcessor* renderer_;
+
+  int64_t start_;
+
+  int64_t end_;
+
+  QString error_;
+
+  bool fill_finished_;
+
+  QEventLoop loop_;
+
+private slots:
+  void RendererFillFinished();
+
+  void RendererCacheFinished();
+
+};
+
+#endif // RENDERFARMWORKER_H
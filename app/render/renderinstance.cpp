@@ -21,8 +21,11 @@
 #include "renderinstance.h"
 
 #include <QDebug>
+#include <QOpenGLExtraFunctions>
 
-#include "render/gl/shadergenerators.h"
+#include "render/gl/functions.h"
+#include "render/gl/shadercache.h"
+#include "render/pixelservice.h"
 
 RenderInstance::RenderInstance(const int& width,
                                const int& height,
@@ -30,11 +33,19 @@ RenderInstance::RenderInstance(const int& width,
                                const olive::PixelFormat& format,
                                const olive::RenderMode& mode) :
   share_ctx_(nullptr),
+  frame_width_(width),
+  frame_height_(height),
+  tile_(0, 0, width, height),
   width_(width),
   height_(height),
   format_(format),
   mode_(mode),
-  divider_(divider)
+  divider_(divider),
+  playback_speed_(0),
+  playback_divider_(1),
+  read_ahead_(false),
+  cancel_flag_(nullptr),
+  supports_compute_(false)
 {
 }
 
@@ -82,7 +93,14 @@ bool RenderInstance::Start()
   ctx_->functions()->glEnable(GL_BLEND);
 
   // Set up default pipeline
-  default_pipeline_ = olive::ShaderGenerator::DefaultPipeline();
+  default_pipeline_ = ShaderCache::Get(ctx_)->DefaultPipeline();
+
+  supports_compute_ = olive::ShaderGenerator::SupportsCompute(ctx_);
+
+  texture_pool_ = std::make_shared<RenderTexturePool>(ctx_);
+
+  gpu_profiler_ = std::unique_ptr<GPUProfiler>(new GPUProfiler(ctx_));
+  GPUProfiler::SetCurrent(gpu_profiler_.get());
 
   return true;
 }
@@ -96,6 +114,15 @@ void RenderInstance::Stop()
   // Destroy pipeline
   default_pipeline_ = nullptr;
 
+  // Destroy unused textures, any still in use are deleted when they're released
+  texture_pool_ = nullptr;
+
+  // Results still pending are dropped
+  if (GPUProfiler::Current() == gpu_profiler_.get()) {
+    GPUProfiler::SetCurrent(nullptr);
+  }
+  gpu_profiler_ = nullptr;
+
   // Destroy buffer
   buffer_.Destroy();
 
@@ -112,6 +139,29 @@ bool RenderInstance::IsStarted()
   return buffer_.IsCreated();
 }
 
+void RenderInstance::Reconfigure(const int &width,
+                                 const int &height,
+                                 const int &divider,
+                                 const olive::PixelFormat &format,
+                                 const olive::RenderMode &mode)
+{
+  frame_width_ = width;
+  frame_height_ = height;
+  tile_ = QRect(0, 0, width, height);
+  width_ = width;
+  height_ = height;
+  format_ = format;
+  mode_ = mode;
+  divider_ = divider;
+
+  if (IsStarted()) {
+    ctx_->functions()->glViewport(0, 0, width_, height_);
+
+    // Nothing of the old size or format would be asked for again
+    texture_pool_->Clear();
+  }
+}
+
 RenderFramebuffer *RenderInstance::buffer()
 {
   return &buffer_;
@@ -132,6 +182,52 @@ const int &RenderInstance::height() const
   return height_;
 }
 
+const int &RenderInstance::frame_width() const
+{
+  return frame_width_;
+}
+
+const int &RenderInstance::frame_height() const
+{
+  return frame_height_;
+}
+
+const QRect &RenderInstance::tile() const
+{
+  return tile_;
+}
+
+void RenderInstance::set_tile(const QRect &tile)
+{
+  QRect new_tile = tile.isNull() ? QRect(0, 0, frame_width_, frame_height_) : tile;
+
+  if (new_tile == tile_) {
+    return;
+  }
+
+  tile_ = new_tile;
+  width_ = tile_.width();
+  height_ = tile_.height();
+
+  if (IsStarted()) {
+    ctx_->functions()->glViewport(0, 0, width_, height_);
+  }
+}
+
+QMatrix4x4 RenderInstance::tile_matrix() const
+{
+  QMatrix4x4 matrix;
+
+  float scale_x = static_cast<float>(frame_width_) / static_cast<float>(width_);
+  float scale_y = static_cast<float>(frame_height_) / static_cast<float>(height_);
+
+  matrix.translate(static_cast<float>(frame_width_ - 2 * tile_.x() - width_) / static_cast<float>(width_),
+                   static_cast<float>(frame_height_ - 2 * tile_.y() - height_) / static_cast<float>(height_));
+  matrix.scale(scale_x, scale_y);
+
+  return matrix;
+}
+
 const int &RenderInstance::divider() const
 {
   return divider_;
@@ -151,3 +247,175 @@ ShaderPtr RenderInstance::default_pipeline() const
 {
   return default_pipeline_;
 }
+
+bool RenderInstance::SupportsCompute() const
+{
+  return supports_compute_;
+}
+
+void RenderInstance::Dispatch(ShaderPtr kernel, RenderTexturePtr source, RenderTexturePtr destination)
+{
+  Q_ASSERT(supports_compute_);
+
+  GPUTimer gpu_timer(Profiler::kGPUPass);
+
+  QOpenGLExtraFunctions* f = ctx_->extraFunctions();
+
+  if (source != nullptr) {
+    f->glActiveTexture(GL_TEXTURE0);
+    source->Bind();
+  }
+
+  kernel->bind();
+  kernel->setUniformValue("input_texture", 0);
+  f->glUniform2i(kernel->uniformLocation("output_size"), destination->width(), destination->height());
+
+  GLenum internal_format = static_cast<GLenum>(PixelService::GetPixelFormatInfo(destination->format()).internal_format);
+
+  f->glBindImageTexture(0, destination->texture(), 0, GL_FALSE, 0, GL_WRITE_ONLY, internal_format);
+
+  // Enough work groups to cover the destination, the kernel ignores the invocations hanging off the edges
+  int local_size = olive::kComputeLocalSize;
+
+  GLuint groups_x = static_cast<GLuint>((destination->width() + local_size - 1) / local_size);
+  GLuint groups_y = static_cast<GLuint>((destination->height() + local_size - 1) / local_size);
+
+  f->glDispatchCompute(groups_x, groups_y, 1);
+
+  // Make the writes visible to whatever samples, draws into or downloads the destination next
+  f->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT
+                     | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT
+                     | GL_FRAMEBUFFER_BARRIER_BIT
+                     | GL_PIXEL_BUFFER_BARRIER_BIT
+                     | GL_TEXTURE_UPDATE_BARRIER_BIT);
+
+  f->glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, internal_format);
+
+  kernel->release();
+
+  if (source != nullptr) {
+    source->Release();
+  }
+}
+
+GPUProfiler *RenderInstance::gpu_profiler() const
+{
+  return gpu_profiler_.get();
+}
+
+const int &RenderInstance::playback_speed() const
+{
+  return playback_speed_;
+}
+
+void RenderInstance::set_playback_speed(const int &speed)
+{
+  playback_speed_ = speed;
+}
+
+const int &RenderInstance::playback_divider() const
+{
+  return playback_divider_;
+}
+
+void RenderInstance::set_playback_divider(const int &divider)
+{
+  playback_divider_ = divider;
+}
+
+const bool &RenderInstance::read_ahead() const
+{
+  return read_ahead_;
+}
+
+void RenderInstance::set_read_ahead(const bool &e)
+{
+  read_ahead_ = e;
+}
+
+const QAtomicInt *RenderInstance::cancel_flag() const
+{
+  return cancel_flag_;
+}
+
+void RenderInstance::set_cancel_flag(const QAtomicInt *flag)
+{
+  cancel_flag_ = flag;
+}
+
+bool RenderInstance::cancelled() const
+{
+  return cancel_flag_ != nullptr && cancel_flag_->loadAcquire() != 0;
+}
+
+RenderTexturePool *RenderInstance::texture_pool() const
+{
+  return texture_pool_.get();
+}
+
+RenderTexturePtr RenderInstance::ResolvePendingOps(RenderTexturePtr texture)
+{
+  if (texture == nullptr || !texture->HasPendingOps()) {
+    return texture;
+  }
+
+  bool in_place = (texture->back_texture() != 0);
+
+  RenderTexturePtr destination;
+
+  if (in_place) {
+    buffer_.AttachBackBuffer(texture);
+  } else {
+    destination = texture_pool_->Get(texture->width(), texture->height(), texture->format(), RenderTexture::kSingleBuffer);
+    buffer_.Attach(destination);
+  }
+
+  DrawResolved(texture);
+
+  if (in_place) {
+    texture->SwapFrontAndBack();
+    texture->set_pending_opacity(1.0f);
+
+    return texture;
+  }
+
+  return destination;
+}
+
+RenderTexturePtr RenderInstance::CopyTexture(RenderTexturePtr texture)
+{
+  RenderTexture::Type type = (texture->back_texture() != 0) ? RenderTexture::kDoubleBuffer
+                                                            : RenderTexture::kSingleBuffer;
+
+  RenderTexturePtr destination = texture_pool_->Get(texture->width(), texture->height(), texture->format(), type);
+
+  buffer_.Attach(destination);
+
+  DrawResolved(texture);
+
+  return destination;
+}
+
+void RenderInstance::DrawResolved(RenderTexturePtr texture)
+{
+  buffer_.Bind();
+
+  texture->Bind();
+
+  default_pipeline_->bind();
+  default_pipeline_->setUniformValue("opacity", texture->pending_opacity());
+  default_pipeline_->release();
+
+  ctx_->functions()->glBlendFunc(GL_ONE, GL_ZERO);
+
+  olive::gl::Blit(default_pipeline_);
+
+  // Reset to full opacity
+  default_pipeline_->bind();
+  default_pipeline_->setUniformValue("opacity", 1.0f);
+  default_pipeline_->release();
+
+  texture->Release();
+  buffer_.Release();
+  buffer_.Detach();
+}
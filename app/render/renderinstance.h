@@ -21,13 +21,18 @@
 #ifndef GLINSTANCE_H
 #define GLINSTANCE_H
 
+#include <memory>
+#include <QAtomicInt>
 #include <QMatrix4x4>
 #include <QOffscreenSurface>
 #include <QOpenGLContext>
+#include <QRect>
 
 #include "render/gl/shaderptr.h"
+#include "render/gpuprofiler.h"
 #include "render/renderframebuffer.h"
 #include "render/rendermodes.h"
+#include "render/rendertexturepool.h"
 
 /**
  * @brief An object containing all resources necessary for each thread to support hardware accelerated rendering
@@ -53,14 +58,66 @@ public:
 
   bool IsStarted();
 
+  /**
+   * @brief Change the size and format this instance renders at, keeping its context
+   *
+   * The context, the shaders compiled in it and the GPU profiler carry on as they are, only the pooled textures (which
+   * are the old size or format) are freed. Must be called from the thread that started the instance while it isn't
+   * rendering anything, as Nodes may be holding on to its dimensions.
+   */
+  void Reconfigure(const int& width,
+                   const int& height,
+                   const int& divider,
+                   const olive::PixelFormat& format,
+                   const olive::RenderMode& mode);
+
   RenderFramebuffer* buffer();
 
   QOpenGLContext* context();
 
+  /**
+   * @brief Width of what Nodes render, which is the width of tile()
+   */
   const int& width() const;
 
+  /**
+   * @brief Height of what Nodes render, which is the height of tile()
+   */
   const int& height() const;
 
+  /**
+   * @brief Width of the whole frame that tile() is a part of
+   *
+   * Nodes that place things in the frame (rather than only processing textures they're given) lay them out based on
+   * the frame's size and then apply tile_matrix().
+   */
+  const int& frame_width() const;
+
+  /**
+   * @brief Height of the whole frame that tile() is a part of
+   */
+  const int& frame_height() const;
+
+  /**
+   * @brief The region of the frame (in pixels, from the bottom-left in GL's convention) being rendered
+   *
+   * Frames too large to render at once (e.g. beyond the GL texture size limit) are rendered in tiles, one after
+   * another, so only one tile's worth of textures needs to be resident. The whole frame by default.
+   */
+  const QRect& tile() const;
+
+  /**
+   * @brief Set the region of the frame to render, a null rect for the whole frame
+   *
+   * Also sets the viewport if the instance is started, so its context must be current.
+   */
+  void set_tile(const QRect& tile);
+
+  /**
+   * @brief A matrix that maps a position in the whole frame (in clip space) to the same position in tile()
+   */
+  QMatrix4x4 tile_matrix() const;
+
   const int& divider() const;
 
   const olive::PixelFormat& format() const;
@@ -69,7 +126,92 @@ public:
 
   ShaderPtr default_pipeline() const;
 
+  /**
+   * @brief Returns TRUE if this instance's context can run compute pipelines (see ShaderGenerator::SupportsCompute())
+   */
+  bool SupportsCompute() const;
+
+  /**
+   * @brief Run a compute pipeline (see ShaderGenerator::ComputePipeline()) over every pixel of `destination`
+   *
+   * `source` (which may be nullptr) is bound as `input_texture`. Textures written here are ready to be sampled or
+   * drawn into afterwards. Must only be called if SupportsCompute() returns TRUE, with this instance's context current.
+   */
+  void Dispatch(ShaderPtr kernel, RenderTexturePtr source, RenderTexturePtr destination);
+
+  /**
+   * @brief Speed of the playback the current task is rendering for (see RendererProcessor::SetPlaybackSpeed())
+   *
+   * Set by the scheduler before each task so that nodes can adapt to it (e.g. MediaInput only decoding keyframes
+   * while shuttling). 0 when not playing.
+   */
+  const int& playback_speed() const;
+  void set_playback_speed(const int& speed);
+
+  /**
+   * @brief How much further than divider() media is reduced for the current task, 1 for not at all
+   *
+   * Raised by RendererProcessor while playback can't keep up (see RendererProcessor::playback_divider()) and set by
+   * the scheduler before each task like playback_speed(). MediaInput decodes at this reduction and upscales, so the
+   * frame's size doesn't change.
+   */
+  const int& playback_divider() const;
+  void set_playback_divider(const int& divider);
+
+  /**
+   * @brief Whether the current task is part of a range rendered in order (export or a background cache fill)
+   *
+   * Set by the scheduler before each task like playback_speed(). MediaInput passes it on to its Decoder (see
+   * Decoder::set_read_ahead()), which can then decode further ahead than it would for something being displayed.
+   */
+  const bool& read_ahead() const;
+  void set_read_ahead(const bool& e);
+
+  /**
+   * @brief Flag raised when the current task's frame is no longer wanted, or nullptr if it can't be cancelled
+   *
+   * Set by the scheduler before each task like playback_speed(). Long running work (e.g. decoding) should check
+   * cancelled() and give up early, the frame's result is discarded anyway.
+   */
+  const QAtomicInt* cancel_flag() const;
+  void set_cancel_flag(const QAtomicInt* flag);
+
+  bool cancelled() const;
+
+  /**
+   * @brief Reusable textures for Nodes to render into on this instance
+   */
+  RenderTexturePool* texture_pool() const;
+
+  /**
+   * @brief Draw a texture's deferred operations (see RenderTexture::HasPendingOps()) into its pixels
+   *
+   * Double buffered textures are resolved in place by drawing into their back buffer and swapping. Otherwise a new
+   * texture is drawn into from the pool. Must be called with this instance's context current.
+   *
+   * @return The resolved texture (which may be `texture` itself)
+   */
+  RenderTexturePtr ResolvePendingOps(RenderTexturePtr texture);
+
+  /**
+   * @brief Draw a texture (with its deferred operations resolved) into a new texture from the pool
+   *
+   * The copy has the same size, format and buffering as `texture`. Must be called with this instance's context
+   * current.
+   */
+  RenderTexturePtr CopyTexture(RenderTexturePtr texture);
+
+  /**
+   * @brief Times GPU work on this instance's context, Current() on the thread that started it
+   */
+  GPUProfiler* gpu_profiler() const;
+
 private:
+  /**
+   * @brief Draw `texture` into whatever is attached to buffer_, drawing its deferred operations in with it
+   */
+  void DrawResolved(RenderTexturePtr texture);
+
   QOpenGLContext* ctx_;
 
   QOpenGLContext* share_ctx_;
@@ -78,6 +220,12 @@ private:
 
   RenderFramebuffer buffer_;
 
+  int frame_width_;
+
+  int frame_height_;
+
+  QRect tile_;
+
   int width_;
 
   int height_;
@@ -88,7 +236,21 @@ private:
 
   int divider_;
 
+  int playback_speed_;
+
+  int playback_divider_;
+
+  bool read_ahead_;
+
+  const QAtomicInt* cancel_flag_;
+
   ShaderPtr default_pipeline_;
+
+  bool supports_compute_;
+
+  RenderTexturePoolPtr texture_pool_;
+
+  std::unique_ptr<GPUProfiler> gpu_profiler_;
 };
 
 #endif // GLINSTANCE_H
@@ -0,0 +1,80 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "renderstats.h"
+
+#include "render/diskcachemanager.h"
+
+RenderStats olive::render_stats;
+
+RenderStats::RenderStats()
+{
+  for (int i=0;i<kValueCount;i++) {
+    values_[i].storeRelease(0);
+  }
+}
+
+void RenderStats::Add(RenderStats::Value v, qint64 amount)
+{
+  values_[v].fetchAndAddRelaxed(amount);
+}
+
+RenderStats::Snapshot RenderStats::GetSnapshot() const
+{
+  Snapshot s;
+
+  for (int i=0;i<kValueCount;i++) {
+    s.values[i] = values_[i].loadAcquire();
+  }
+
+  s.disk_bytes = olive::disk_cache_manager.size();
+
+  return s;
+}
+
+void RenderStats::ResetCounters()
+{
+  for (int i=kVRAMHit;i<=kDecodeTime;i++) {
+    values_[i].storeRelease(0);
+  }
+}
+
+double RenderStats::Snapshot::HitRate() const
+{
+  qint64 hits = values[kVRAMHit] + values[kRAMHit] + values[kDiskHit];
+  qint64 total = hits + values[kMiss];
+
+  if (total == 0) {
+    return 0.0;
+  }
+
+  return static_cast<double>(hits) / static_cast<double>(total);
+}
+
+double RenderStats::Snapshot::AverageDecodeTime() const
+{
+  qint64 decodes = values[kDecodeSeek] + values[kDecodeSequential];
+
+  if (decodes == 0) {
+    return 0.0;
+  }
+
+  return static_cast<double>(values[kDecodeTime]) / static_cast<double>(decodes) / 1000000.0;
+}
@@ -0,0 +1,107 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <QAtomicInteger>
+
+/**
+ * @brief Counters of how frames are found in the caches and how media is decoded, for tuning cache budgets
+ *
+ * Counters (e.g. kDiskHit) only ever go up and are bumped with Add() wherever the event happens, from any thread.
+ * Gauges (e.g. kFramesInFlight) are the current total over every renderer, each renderer adds how much its own value
+ * changed (see RendererProcessor::PublishStats()). Every value is an atomic so nothing here takes a lock.
+ */
+class RenderStats
+{
+public:
+  enum Value {
+    // Frames the viewer asked for that were already uploaded to the GPU
+    kVRAMHit,
+
+    // Frames loaded for the viewer from the in-memory cache
+    kRAMHit,
+
+    // Frames loaded for the viewer from the disk cache
+    kDiskHit,
+
+    // Frames the viewer asked for that hadn't been rendered yet (or failed to load)
+    kMiss,
+
+    // Frames retrieved from a decoder that had to seek to them
+    kDecodeSeek,
+
+    // Frames retrieved from a decoder by decoding forward from where it was (or that it already had)
+    kDecodeSequential,
+
+    // Total nanoseconds spent retrieving frames from decoders
+    kDecodeTime,
+
+    // Frames that have been submitted for rendering but haven't finished yet
+    kFramesInFlight,
+
+    // Frames waiting to be submitted for rendering
+    kQueueLength,
+
+    // Frames rendered but not yet downloaded and written to the disk cache
+    kDownloadBacklog,
+
+    kValueCount
+  };
+
+  struct Snapshot {
+    qint64 values[kValueCount];
+
+    /// Size of the disk cache in bytes
+    qint64 disk_bytes;
+
+    /**
+     * @brief Returns the fraction (0.0 - 1.0) of viewer requests that were in any cache
+     */
+    double HitRate() const;
+
+    /**
+     * @brief Returns the average time retrieving a frame from a decoder took in milliseconds
+     */
+    double AverageDecodeTime() const;
+  };
+
+  RenderStats();
+
+  void Add(Value v, qint64 amount = 1);
+
+  Snapshot GetSnapshot() const;
+
+  /**
+   * @brief Set every counter back to 0 (gauges are left alone since they're still current)
+   */
+  void ResetCounters();
+
+private:
+  QAtomicInteger<qint64> values_[kValueCount];
+
+};
+
+namespace olive {
+extern RenderStats render_stats;
+}
+
+#endif // RENDERSTATS_H
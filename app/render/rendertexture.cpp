@@ -22,16 +22,25 @@
 
 #include <QDateTime>
 #include <QDebug>
+#include <QOpenGLExtraFunctions>
 
+#include "render/gl/blockcompressor.h"
+#include "render/gl/uploadring.h"
 #include "render/pixelservice.h"
+#include "render/profiler.h"
+#include "render/vrammonitor.h"
 
 RenderTexture::RenderTexture() :
   context_(nullptr),
   texture_(0),
   back_texture_(0),
+  fence_(nullptr),
+  pending_opacity_(1.0f),
   width_(0),
   height_(0),
-  format_(olive::PIX_FMT_INVALID)
+  format_(olive::PIX_FMT_INVALID),
+  allocated_bytes_(0),
+  memory_tracker_(MemoryStats::kTextures)
 {
 }
 
@@ -73,6 +82,55 @@ void RenderTexture::Create(QOpenGLContext *ctx, int width, int height, const oli
     // Create back texture
     CreateInternal(&back_texture_, nullptr);
   }
+
+  qint64 buffer_size = PixelService::GetBufferSize(format_, width_, height_);
+  SetAllocatedBytes(((texture_ != 0) ? buffer_size : 0) + ((back_texture_ != 0) ? buffer_size : 0));
+}
+
+void RenderTexture::CreateCompressed(QOpenGLContext *ctx, int width, int height, const void *blocks, int size)
+{
+  if (ctx == nullptr) {
+    qWarning() << tr("RenderTexture::CreateCompressed was passed an invalid context");
+    return;
+  }
+
+  if (context_ != ctx || back_texture_ != 0) {
+    Destroy();
+
+    context_ = ctx;
+
+    connect(context_, SIGNAL(aboutToBeDestroyed()), this, SLOT(Destroy()));
+
+    context_->functions()->glGenTextures(1, &texture_);
+  }
+
+  width_ = width;
+  height_ = height;
+  format_ = olive::PIX_FMT_RGBA8;
+
+  ProfilerTimer timer(Profiler::kUpload);
+
+  QOpenGLFunctions* f = context_->functions();
+
+  f->glBindTexture(GL_TEXTURE_2D, texture_);
+
+  f->glCompressedTexImage2D(GL_TEXTURE_2D,
+                            0,
+                            GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,
+                            width_,
+                            height_,
+                            0,
+                            size,
+                            blocks);
+
+  // Compressed textures can't generate mipmaps, so keep the texture complete with just the first level
+  f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+  f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  f->glBindTexture(GL_TEXTURE_2D, 0);
+
+  SetAllocatedBytes(size);
 }
 
 void RenderTexture::Destroy()
@@ -86,6 +144,13 @@ void RenderTexture::Destroy()
     context_->functions()->glDeleteTextures(1, &back_texture_);
     back_texture_ = 0;
 
+    if (fence_ != nullptr) {
+      context_->extraFunctions()->glDeleteSync(fence_);
+      fence_ = nullptr;
+    }
+
+    SetAllocatedBytes(0);
+
     context_ = nullptr;
   }
 }
@@ -148,16 +213,100 @@ void RenderTexture::SwapFrontAndBack()
 }
 
 void RenderTexture::Upload(const void *data)
+{
+  Upload(data, PixelService::BytesPerPixel(format_) * width_);
+}
+
+void RenderTexture::Upload(const void *data, int linesize)
 {
   if (!IsCreated()) {
     qWarning() << tr("RenderTexture::Upload() called while it wasn't created");
     return;
   }
 
+  ProfilerTimer timer(Profiler::kUpload);
+
+  int bytes_per_pixel = PixelService::BytesPerPixel(format_);
+  int row_size = bytes_per_pixel * width_;
+
+  void* mapped = MapUpload();
+
+  if (mapped != nullptr) {
+    if (linesize == row_size) {
+      memcpy(mapped, data, static_cast<size_t>(PixelService::GetBufferSize(format_, width_, height_)));
+    } else {
+      for (int i=0;i<height_;i++) {
+        memcpy(static_cast<char*>(mapped) + i * row_size,
+               static_cast<const char*>(data) + i * linesize,
+               static_cast<size_t>(row_size));
+      }
+    }
+
+    UploadMapped();
+    return;
+  }
+
+  // Fall back to uploading straight from client memory
+  UploadDirect(data, linesize);
+}
+
+void RenderTexture::UploadDirect(const void *data, int linesize)
+{
+  if (!IsCreated()) {
+    qWarning() << tr("RenderTexture::UploadDirect() called while it wasn't created");
+    return;
+  }
+
+  int bytes_per_pixel = PixelService::BytesPerPixel(format_);
+  int row_size = bytes_per_pixel * width_;
+
+  Bind();
+
+  PixelFormatInfo info = PixelService::GetPixelFormatInfo(format_);
+  QOpenGLFunctions* f = context_->functions();
+
+  if (linesize != row_size) {
+    f->glPixelStorei(GL_UNPACK_ROW_LENGTH, linesize / bytes_per_pixel);
+  }
+
+  f->glTexSubImage2D(GL_TEXTURE_2D,
+                     0,
+                     0,
+                     0,
+                     width_,
+                     height_,
+                     info.pixel_format,
+                     info.pixel_type,
+                     data);
+
+  if (linesize != row_size) {
+    f->glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  }
+
+  Release();
+}
+
+void *RenderTexture::MapUpload()
+{
+  if (!IsCreated()) {
+    qWarning() << tr("RenderTexture::MapUpload() called while it wasn't created");
+    return nullptr;
+  }
+
+  return UploadRing::Get(context_)->Map(PixelService::GetBufferSize(format_, width_, height_));
+}
+
+void RenderTexture::UploadMapped()
+{
+  UploadRing* ring = UploadRing::Get(context_);
+
+  ring->Unmap();
+
   Bind();
 
   PixelFormatInfo info = PixelService::GetPixelFormatInfo(format_);
 
+  // With a pixel unpack buffer bound, the data argument is an offset into it
   context_->functions()->glTexSubImage2D(GL_TEXTURE_2D,
                                          0,
                                          0,
@@ -166,9 +315,11 @@ void RenderTexture::Upload(const void *data)
                                          height_,
                                          info.pixel_format,
                                          info.pixel_type,
-                                         data);
+                                         nullptr);
 
   Release();
+
+  ring->Release();
 }
 
 uchar *RenderTexture::Download() const
@@ -211,7 +362,7 @@ void RenderTexture::CreateInternal(GLuint* tex, void *data)
   f->glGenTextures(1, tex);
 
   // Verify texture
-  if (texture_ == 0) {
+  if (*tex == 0) {
     qWarning() << tr("OpenGL texture creation failed");
     return;
   }
@@ -222,17 +373,38 @@ void RenderTexture::CreateInternal(GLuint* tex, void *data)
   // Allocate storage for texture
   const PixelFormatInfo& bit_depth = PixelService::GetPixelFormatInfo(format_);
 
-  f->glTexImage2D(
-        GL_TEXTURE_2D,
-        0,
-        bit_depth.internal_format,
-        width_,
-        height_,
-        0,
-        bit_depth.pixel_format,
-        bit_depth.pixel_type,
-        data
-        );
+  // Clear any earlier errors so we only see the allocation's
+  while (f->glGetError() != GL_NO_ERROR) {}
+
+  // Try again once if the driver runs out, since AllocationFailed() evicts what it can to make room
+  for (int attempt=0;attempt<2;attempt++) {
+    f->glTexImage2D(
+          GL_TEXTURE_2D,
+          0,
+          bit_depth.internal_format,
+          width_,
+          height_,
+          0,
+          bit_depth.pixel_format,
+          bit_depth.pixel_type,
+          data
+          );
+
+    if (f->glGetError() != GL_OUT_OF_MEMORY) {
+      break;
+    }
+
+    olive::vram_monitor.AllocationFailed(PixelService::GetBufferSize(format_, width_, height_));
+
+    if (attempt > 0) {
+      qWarning() << tr("Not enough VRAM for a %1x%2 texture").arg(QString::number(width_), QString::number(height_));
+
+      f->glBindTexture(GL_TEXTURE_2D, 0);
+      f->glDeleteTextures(1, tex);
+      *tex = 0;
+      return;
+    }
+  }
 
   // Set texture filtering to bilinear
   f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
@@ -241,3 +413,68 @@ void RenderTexture::CreateInternal(GLuint* tex, void *data)
   // Release texture
   f->glBindTexture(GL_TEXTURE_2D, 0);
 }
+
+void RenderTexture::SetAllocatedBytes(qint64 bytes)
+{
+  if (bytes == allocated_bytes_) {
+    return;
+  }
+
+  if (allocated_bytes_ > 0) {
+    olive::vram_monitor.Freed(allocated_bytes_);
+  }
+
+  allocated_bytes_ = bytes;
+  memory_tracker_.SetBytes(allocated_bytes_);
+
+  if (allocated_bytes_ > 0) {
+    olive::vram_monitor.Allocated(allocated_bytes_);
+  }
+}
+
+void RenderTexture::Fence()
+{
+  QOpenGLContext* ctx = QOpenGLContext::currentContext();
+
+  if (ctx == nullptr) {
+    qWarning() << tr("RenderTexture::Fence() called without a current context");
+    return;
+  }
+
+  QOpenGLExtraFunctions* xf = ctx->extraFunctions();
+
+  if (fence_ != nullptr) {
+    xf->glDeleteSync(fence_);
+  }
+
+  fence_ = xf->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  // The fence has to reach the GPU before another context can wait on it
+  ctx->functions()->glFlush();
+}
+
+void RenderTexture::WaitFence() const
+{
+  QOpenGLContext* ctx = QOpenGLContext::currentContext();
+
+  if (fence_ == nullptr || ctx == nullptr) {
+    return;
+  }
+
+  ctx->extraFunctions()->glWaitSync(fence_, 0, GL_TIMEOUT_IGNORED);
+}
+
+const float &RenderTexture::pending_opacity() const
+{
+  return pending_opacity_;
+}
+
+void RenderTexture::set_pending_opacity(const float &opacity)
+{
+  pending_opacity_ = opacity;
+}
+
+bool RenderTexture::HasPendingOps() const
+{
+  return !qFuzzyCompare(pending_opacity_, 1.0f);
+}
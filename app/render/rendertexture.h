@@ -24,6 +24,7 @@
 #include <memory>
 #include <QOpenGLFunctions>
 
+#include "common/memorystats.h"
 #include "pixelformat.h"
 
 class RenderTexture : public QObject
@@ -45,6 +46,15 @@ public:
   void Create(QOpenGLContext* ctx, int width, int height, const olive::PixelFormat &format, void *data = nullptr);
   void Create(QOpenGLContext* ctx, int width, int height, const olive::PixelFormat &format, const Type& type, void *data = nullptr);
 
+  /**
+   * @brief Create the texture from BC7 blocks (see BlockCompressor) instead of pixels
+   *
+   * The blocks are sRGB encoded and the GPU decodes them when they're sampled, so the texture is drawn like any other
+   * (format() returns PIX_FMT_RGBA8). It has no mipmaps and can't be rendered into or uploaded to, but calling this
+   * again replaces the blocks and keeps the same GL texture.
+   */
+  void CreateCompressed(QOpenGLContext* ctx, int width, int height, const void* blocks, int size);
+
   bool IsCreated() const;
 
   void Bind();
@@ -65,25 +75,97 @@ public:
 
   void Upload(const void *data);
 
+  /**
+   * @brief Upload data whose lines are `linesize` bytes apart (e.g. a region of a larger frame)
+   */
+  void Upload(const void *data, int linesize);
+
+  /**
+   * @brief Upload straight from client memory without going through a pixel buffer
+   *
+   * What Upload() falls back to if no buffer can be mapped. Blocks while the driver copies the data, so prefer Upload().
+   */
+  void UploadDirect(const void *data, int linesize);
+
+  /**
+   * @brief Map a pixel buffer to write this texture's next contents into directly
+   *
+   * Lets producers skip the client memory copy Upload() needs. The texture's context must be current. Write
+   * PixelService::GetBufferSize() bytes and then call UploadMapped().
+   *
+   * @return Pointer to write to, or nullptr if no buffer could be mapped (use Upload() instead).
+   */
+  void* MapUpload();
+
+  /**
+   * @brief Upload the contents written to the buffer from MapUpload()
+   *
+   * The transfer happens asynchronously, later commands in the context that use the texture are ordered after it.
+   */
+  void UploadMapped();
+
   uchar *Download() const;
 
+  /**
+   * @brief Mark the point in the command stream where this texture has finished rendering
+   *
+   * Call this with the context that rendered the texture current once it's done drawing. The commands are flushed so
+   * other contexts in the share group can wait on the fence with WaitFence().
+   */
+  void Fence();
+
+  /**
+   * @brief Make the current context wait until the commands before the last Fence() have completed
+   *
+   * The wait happens on the GPU, so the calling thread doesn't block. Does nothing if Fence() was never called.
+   */
+  void WaitFence() const;
+
+  /**
+   * @brief Opacity that has been applied to this texture but not drawn into its pixels yet
+   *
+   * Simple per-pixel operations (currently just opacity) are deferred here rather than costing a full-frame pass each,
+   * and folded into whatever pass next samples the texture (e.g. AlphaOverBlend's blit). Anything that needs the final
+   * pixels must apply them first with RenderInstance::ResolvePendingOps().
+   */
+  const float& pending_opacity() const;
+  void set_pending_opacity(const float& opacity);
+
+  /**
+   * @brief Returns TRUE if there are deferred operations that haven't been drawn into the pixels yet
+   */
+  bool HasPendingOps() const;
+
 public slots:
   void Destroy();
 
 private:
   void CreateInternal(GLuint *tex, void *data = nullptr);
 
+  /**
+   * @brief Report this texture's size to olive::vram_monitor, replacing what was reported before
+   */
+  void SetAllocatedBytes(qint64 bytes);
+
   QOpenGLContext* context_;
 
   GLuint texture_;
 
   GLuint back_texture_;
 
+  GLsync fence_;
+
+  float pending_opacity_;
+
   int width_;
 
   int height_;
 
   olive::PixelFormat format_;
+
+  qint64 allocated_bytes_;
+
+  MemoryTracker memory_tracker_;
 };
 
 using RenderTexturePtr = std::shared_ptr<RenderTexture>;
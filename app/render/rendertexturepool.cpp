@@ -0,0 +1,192 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "rendertexturepool.h"
+
+#include "config/config.h"
+#include "pixelservice.h"
+
+RenderTexturePool::RenderTexturePool(QOpenGLContext *ctx) :
+  ctx_(ctx),
+  free_count_(0),
+  pending_eviction_(0)
+{
+  olive::image_cache.AddClient(this);
+}
+
+RenderTexturePool::~RenderTexturePool()
+{
+  olive::image_cache.RemoveClient(this);
+
+  Clear();
+}
+
+RenderTexturePtr RenderTexturePool::Get(int width, int height, const olive::PixelFormat &format, const RenderTexture::Type &type)
+{
+  bool double_buffered = (type == RenderTexture::kDoubleBuffer);
+
+  RenderTexture* texture = nullptr;
+
+  lock_.lock();
+
+  // Our context is current here, so this is where we can act on evictions the image cache asked for
+  qint64 freed = 0;
+
+  if (pending_eviction_ > 0) {
+    freed = DestroyFreeTextures(pending_eviction_);
+    pending_eviction_ = 0;
+  }
+
+  QHash<QString, QList<RenderTexture*> >::iterator it = free_textures_.find(Key(width, height, format, double_buffered));
+
+  if (it != free_textures_.end()) {
+    texture = it.value().takeLast();
+    free_count_--;
+
+    if (it.value().isEmpty()) {
+      free_textures_.erase(it);
+    }
+  }
+
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kTexBuf, freed);
+
+  if (texture == nullptr) {
+    texture = new RenderTexture();
+    texture->Create(ctx_, width, height, format, type);
+
+    olive::image_cache.Allocated(ImageCache::kTexBuf, TextureSize(texture));
+  }
+
+  // Don't carry over deferred operations from whatever the texture was used for last
+  texture->set_pending_opacity(1.0f);
+
+  return RenderTexturePtr(texture, Returner(shared_from_this()));
+}
+
+void RenderTexturePool::Clear()
+{
+  lock_.lock();
+  qint64 freed = DestroyFreeTextures(-1);
+  pending_eviction_ = 0;
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kTexBuf, freed);
+}
+
+void RenderTexturePool::Evict(const ImageCache::BufferType &type, const qint64 &bytes)
+{
+  if (type != ImageCache::kTexBuf) {
+    return;
+  }
+
+  // We can be called from any thread so we can't destroy textures here, Get() will do it instead
+  QMutexLocker locker(&lock_);
+
+  pending_eviction_ = qMax(pending_eviction_, bytes);
+}
+
+QString RenderTexturePool::Key(int width, int height, const olive::PixelFormat &format, bool double_buffered)
+{
+  return QString("%1:%2:%3:%4").arg(QString::number(width),
+                                    QString::number(height),
+                                    QString::number(format),
+                                    QString::number(double_buffered));
+}
+
+qint64 RenderTexturePool::TextureSize(RenderTexture *texture)
+{
+  qint64 size = PixelService::GetBufferSize(texture->format(), texture->width(), texture->height());
+
+  if (texture->back_texture() != 0) {
+    size *= 2;
+  }
+
+  return size;
+}
+
+void RenderTexturePool::Return(RenderTexture *texture)
+{
+  lock_.lock();
+
+  // Textures whose context was destroyed can't be reused
+  if (!texture->IsCreated() || free_count_ >= kRenderTexturePoolSize) {
+    lock_.unlock();
+
+    qint64 size = TextureSize(texture);
+
+    delete texture;
+
+    olive::image_cache.Freed(ImageCache::kTexBuf, size);
+    return;
+  }
+
+  free_textures_[Key(texture->width(), texture->height(), texture->format(), texture->back_texture() != 0)].append(texture);
+  free_count_++;
+
+  lock_.unlock();
+}
+
+qint64 RenderTexturePool::DestroyFreeTextures(qint64 bytes)
+{
+  qint64 freed = 0;
+
+  QHash<QString, QList<RenderTexture*> >::iterator it = free_textures_.begin();
+
+  while (it != free_textures_.end() && (bytes < 0 || freed < bytes)) {
+    while (!it.value().isEmpty() && (bytes < 0 || freed < bytes)) {
+      RenderTexture* texture = it.value().takeLast();
+
+      freed += TextureSize(texture);
+      free_count_--;
+
+      delete texture;
+    }
+
+    if (it.value().isEmpty()) {
+      it = free_textures_.erase(it);
+    } else {
+      it++;
+    }
+  }
+
+  return freed;
+}
+
+RenderTexturePool::Returner::Returner(std::weak_ptr<RenderTexturePool> pool) :
+  pool_(pool)
+{
+}
+
+void RenderTexturePool::Returner::operator()(RenderTexture *texture) const
+{
+  RenderTexturePoolPtr pool = pool_.lock();
+
+  if (pool != nullptr) {
+    pool->Return(texture);
+  } else {
+    qint64 size = TextureSize(texture);
+
+    delete texture;
+
+    olive::image_cache.Freed(ImageCache::kTexBuf, size);
+  }
+}
@@ -0,0 +1,117 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef RENDERTEXTUREPOOL_H
+#define RENDERTEXTUREPOOL_H
+
+#include <memory>
+#include <QHash>
+#include <QList>
+#include <QMutex>
+
+#include "imagecache.h"
+#include "rendertexture.h"
+
+/**
+ * @brief A pool of reusable RenderTextures belonging to one RenderInstance
+ *
+ * Textures from Get() are returned to the pool when their last RenderTexturePtr is released (from any thread), so
+ * rendering a frame doesn't have to allocate and free GL textures every time. Only textures with the same dimensions,
+ * format, and buffer type are reused.
+ *
+ * The VRAM of every texture the pool creates is accounted for in olive::image_cache. When VRAM runs short, the free
+ * textures are destroyed the next time Get() is called (since that's the only time the pool's context is known to be
+ * current).
+ */
+class RenderTexturePool : public std::enable_shared_from_this<RenderTexturePool>, public ImageCache::Client
+{
+public:
+  RenderTexturePool(QOpenGLContext* ctx);
+
+  virtual ~RenderTexturePool() override;
+
+  /**
+   * @brief Retrieve a free texture matching these parameters, creating one if there are none
+   *
+   * Textures are reused as-is, so their contents are undefined.
+   */
+  RenderTexturePtr Get(int width, int height, const olive::PixelFormat& format, const RenderTexture::Type& type);
+
+  /**
+   * @brief Destroy every texture that isn't currently in use
+   *
+   * Must be called with the pool's context current.
+   */
+  void Clear();
+
+  virtual void Evict(const ImageCache::BufferType& type, const qint64& bytes) override;
+
+private:
+  /**
+   * @brief Deleter for RenderTexturePtrs from Get() that sends the texture back to the pool if it still exists
+   */
+  class Returner {
+  public:
+    Returner(std::weak_ptr<RenderTexturePool> pool);
+
+    void operator()(RenderTexture* texture) const;
+
+  private:
+    std::weak_ptr<RenderTexturePool> pool_;
+  };
+
+  /**
+   * @brief Size class key for textures that can be reused interchangeably
+   */
+  static QString Key(int width, int height, const olive::PixelFormat& format, bool double_buffered);
+
+  /**
+   * @brief Returns the number of VRAM bytes used by a texture
+   */
+  static qint64 TextureSize(RenderTexture* texture);
+
+  void Return(RenderTexture* texture);
+
+  /**
+   * @brief Destroy free textures until at least `bytes` have been freed
+   *
+   * Must be called with the pool's context current and lock_ held.
+   *
+   * @return The number of bytes freed
+   */
+  qint64 DestroyFreeTextures(qint64 bytes);
+
+  QOpenGLContext* ctx_;
+
+  /// Free textures grouped by Key()
+  QHash<QString, QList<RenderTexture*> > free_textures_;
+
+  int free_count_;
+
+  /// Bytes of free textures the image cache asked us to destroy on the next Get()
+  qint64 pending_eviction_;
+
+  QMutex lock_;
+
+};
+
+using RenderTexturePoolPtr = std::shared_ptr<RenderTexturePool>;
+
+#endif // RENDERTEXTUREPOOL_H
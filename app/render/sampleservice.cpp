@@ -0,0 +1,53 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "sampleservice.h"
+
+#include <QtGlobal>
+
+int SampleService::BytesPerSample(const olive::SampleFormat &format)
+{
+  switch (format) {
+  case olive::SAMPLE_FMT_U8:
+    return 1;
+  case olive::SAMPLE_FMT_S16:
+    return 2;
+  case olive::SAMPLE_FMT_S32:
+  case olive::SAMPLE_FMT_FLT:
+    return 4;
+  case olive::SAMPLE_FMT_DBL:
+    return 8;
+  case olive::SAMPLE_FMT_INVALID:
+  case olive::SAMPLE_FMT_COUNT:
+    break;
+  }
+
+  qFatal("Invalid sample format requested");
+}
+
+int SampleService::GetBufferSize(const olive::SampleFormat &format, const int &channels, const int &samples)
+{
+  return BytesPerSample(format) * channels * samples;
+}
+
+char SampleService::SilenceByte(const olive::SampleFormat &format)
+{
+  return (format == olive::SAMPLE_FMT_U8) ? static_cast<char>(0x80) : 0;
+}
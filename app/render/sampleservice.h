@@ -0,0 +1,52 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SAMPLESERVICE_H
+#define SAMPLESERVICE_H
+
+#include "sampleformat.h"
+
+/**
+ * @brief Static helper functions for working with olive::SampleFormat audio data
+ *
+ * All of Olive's internal audio is packed (interleaved), so a "sample frame" below refers to one sample for every
+ * channel.
+ */
+class SampleService {
+public:
+  /**
+   * @brief Returns the number of bytes a single sample of one channel uses in a certain format
+   */
+  static int BytesPerSample(const olive::SampleFormat& format);
+
+  /**
+   * @brief Returns the minimum buffer size (in bytes) necessary for a given format, channel count, and sample count
+   */
+  static int GetBufferSize(const olive::SampleFormat& format, const int& channels, const int& samples);
+
+  /**
+   * @brief Returns the byte value that represents silence in a certain format
+   *
+   * This is 0 for all formats except unsigned 8-bit, whose midpoint is 0x80.
+   */
+  static char SilenceByte(const olive::SampleFormat& format);
+};
+
+#endif // SAMPLESERVICE_H
@@ -0,0 +1,47 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SCOPETYPE_H
+#define SCOPETYPE_H
+
+namespace olive {
+
+/**
+ * @brief The kinds of video scope ScopeWidget can show
+ */
+enum ScopeType {
+  /// Luma level (vertically) of every column of the frame (horizontally)
+  kScopeWaveform,
+
+  /// A waveform for each of the red, green and blue channels, side by side
+  kScopeParade,
+
+  /// Chroma (Cb horizontally, Cr vertically) of every pixel in the frame
+  kScopeVectorscope,
+
+  /// How many pixels have each level, for the red, green, blue and luma channels overlaid
+  kScopeHistogram,
+
+  kScopeTypeCount
+};
+
+}
+
+#endif // SCOPETYPE_H
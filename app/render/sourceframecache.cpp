@@ -0,0 +1,150 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "sourceframecache.h"
+
+#include "config/config.h"
+
+SourceFrameCache *SourceFrameCache::Instance()
+{
+  static SourceFrameCache instance;
+
+  return &instance;
+}
+
+SourceFrameCache::SourceFrameCache() :
+  size_(0)
+{
+  olive::image_cache.AddClient(this);
+}
+
+SourceFrameCache::~SourceFrameCache()
+{
+  olive::image_cache.RemoveClient(this);
+
+  Clear();
+}
+
+QString SourceFrameCache::Key(const QString &filename,
+                              int stream_index,
+                              int64_t timestamp,
+                              int divider,
+                              const olive::PixelFormat &format,
+                              const QString &color_space,
+                              bool alpha_is_associated)
+{
+  return QString("%1:%2:%3:%4:%5:%6:%7").arg(QString::number(stream_index),
+                                             QString::number(timestamp),
+                                             QString::number(divider),
+                                             QString::number(format),
+                                             QString::number(alpha_is_associated),
+                                             color_space,
+                                             filename);
+}
+
+FramePtr SourceFrameCache::Get(const QString &key)
+{
+  QMutexLocker locker(&lock_);
+
+  QHash<QString, FramePtr>::const_iterator it = frames_.constFind(key);
+
+  if (it == frames_.constEnd()) {
+    return nullptr;
+  }
+
+  // Move this frame to the most recently used end
+  usage_.removeOne(key);
+  usage_.append(key);
+
+  return it.value();
+}
+
+void SourceFrameCache::Insert(const QString &key, FramePtr frame)
+{
+  qint64 freed = 0;
+
+  lock_.lock();
+
+  if (frames_.contains(key)) {
+    qint64 sz = FrameSize(frames_.value(key));
+
+    freed += sz;
+    size_ -= sz;
+    usage_.removeOne(key);
+  }
+
+  frames_.insert(key, frame);
+  usage_.append(key);
+  size_ += FrameSize(frame);
+
+  freed += Trim(kSourceFrameCacheSize);
+
+  lock_.unlock();
+
+  // Report outside of our lock since the image cache may call Evict() on us
+  olive::image_cache.Freed(ImageCache::kMemBuf, freed);
+  olive::image_cache.Allocated(ImageCache::kMemBuf, FrameSize(frame));
+}
+
+void SourceFrameCache::Clear()
+{
+  lock_.lock();
+
+  qint64 freed = size_;
+
+  frames_.clear();
+  usage_.clear();
+  size_ = 0;
+
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kMemBuf, freed);
+}
+
+void SourceFrameCache::Evict(const ImageCache::BufferType &type, const qint64 &bytes)
+{
+  if (type != ImageCache::kMemBuf) {
+    return;
+  }
+
+  lock_.lock();
+  qint64 freed = Trim(qMax(Q_INT64_C(0), size_ - bytes));
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kMemBuf, freed);
+}
+
+qint64 SourceFrameCache::FrameSize(FramePtr frame)
+{
+  return static_cast<qint64>(frame->linesize()) * frame->height();
+}
+
+qint64 SourceFrameCache::Trim(const qint64 &limit)
+{
+  qint64 freed = 0;
+
+  while (size_ > limit && !usage_.isEmpty()) {
+    qint64 sz = FrameSize(frames_.take(usage_.takeFirst()));
+
+    size_ -= sz;
+    freed += sz;
+  }
+
+  return freed;
+}
@@ -0,0 +1,117 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef SOURCEFRAMECACHE_H
+#define SOURCEFRAMECACHE_H
+
+#include <QHash>
+#include <QLinkedList>
+#include <QMutex>
+
+#include "decoder/frame.h"
+#include "imagecache.h"
+#include "pixelformat.h"
+
+/**
+ * @brief Decoded video frames that have already been color converted, shared by every media node showing them
+ *
+ * When online, MediaInput converts each frame to the reference space (and associates its alpha) on the CPU, which
+ * costs more than decoding it in many cases. Several clips of the same footage, or the same clip rendered again after
+ * something downstream of it changed, would otherwise convert the same frame again every time. Converted frames are
+ * kept here instead, keyed by everything that affects the conversion, and looked up before the decoder is asked for
+ * the frame.
+ *
+ * Frames must not be modified once they're inserted. Every frame is accounted for in olive::image_cache, which can
+ * evict frames from here when system memory runs short, and once the total size of the cached frames exceeds
+ * kSourceFrameCacheSize the least recently used frames are discarded. This class is thread-safe.
+ */
+class SourceFrameCache : public ImageCache::Client
+{
+public:
+  /**
+   * @brief The cache used by every media node
+   *
+   * Created on first use (so after olive::image_cache, which it registers with, and destroyed before it).
+   */
+  static SourceFrameCache* Instance();
+
+  virtual ~SourceFrameCache() override;
+
+  /**
+   * @brief Returns the key identifying a frame converted with these parameters
+   *
+   * @param timestamp
+   *
+   * The frame's native timestamp (see Decoder::GetTimestampFromTime()).
+   *
+   * @param color_space
+   *
+   * The OCIO color space the frame was converted from.
+   */
+  static QString Key(const QString& filename,
+                     int stream_index,
+                     int64_t timestamp,
+                     int divider,
+                     const olive::PixelFormat& format,
+                     const QString& color_space,
+                     bool alpha_is_associated);
+
+  /**
+   * @brief Retrieve the frame cached under `key` and mark it as recently used, or nullptr if there isn't one
+   */
+  FramePtr Get(const QString& key);
+
+  /**
+   * @brief Cache a converted frame under `key`, replacing any existing frame with the same key
+   */
+  void Insert(const QString& key, FramePtr frame);
+
+  /**
+   * @brief Discard all cached frames
+   */
+  void Clear();
+
+  virtual void Evict(const ImageCache::BufferType& type, const qint64& bytes) override;
+
+private:
+  SourceFrameCache();
+
+  static qint64 FrameSize(FramePtr frame);
+
+  /**
+   * @brief Discard least recently used frames until the cache is at most `limit` bytes
+   *
+   * Assumes lock_ is already held.
+   *
+   * @return The number of bytes freed
+   */
+  qint64 Trim(const qint64& limit);
+
+  qint64 size_;
+
+  QHash<QString, FramePtr> frames_;
+
+  /// Keys of frames_ from least to most recently used
+  QLinkedList<QString> usage_;
+
+  QMutex lock_;
+
+};
+
+#endif // SOURCEFRAMECACHE_H
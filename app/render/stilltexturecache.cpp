@@ -0,0 +1,171 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "stilltexturecache.h"
+
+#include "pixelservice.h"
+
+StillTextureCache *StillTextureCache::Instance()
+{
+  static StillTextureCache instance;
+
+  return &instance;
+}
+
+StillTextureCache::StillTextureCache() :
+  pending_eviction_(0)
+{
+  olive::image_cache.AddClient(this);
+}
+
+StillTextureCache::~StillTextureCache()
+{
+  olive::image_cache.RemoveClient(this);
+
+  // Any contexts are long gone by now, so this only drops the textures and their accounting
+  lock_.lock();
+  qint64 freed = DestroyUnusedTextures(-1);
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kTexBuf, freed);
+}
+
+QString StillTextureCache::Key(QOpenGLContext *ctx,
+                               const QString &filename,
+                               int stream_index,
+                               int divider,
+                               const olive::PixelFormat &format,
+                               bool color_converted)
+{
+  return QString("%1:%2:%3:%4:%5:%6").arg(QString::number(reinterpret_cast<quintptr>(ctx->shareGroup())),
+                                          QString::number(stream_index),
+                                          QString::number(divider),
+                                          QString::number(format),
+                                          QString::number(color_converted),
+                                          filename);
+}
+
+RenderTexturePtr StillTextureCache::Get(const QString &key)
+{
+  RenderTexturePtr texture;
+
+  lock_.lock();
+
+  // A context is current here, so this is where we can act on evictions the image cache asked for
+  qint64 freed = 0;
+
+  if (pending_eviction_ > 0) {
+    freed = DestroyUnusedTextures(pending_eviction_);
+    pending_eviction_ = 0;
+  }
+
+  QHash<QString, RenderTexturePtr>::iterator it = textures_.find(key);
+
+  if (it != textures_.end()) {
+    if (it.value()->IsCreated()) {
+      texture = it.value();
+
+      usage_.removeOne(key);
+      usage_.append(key);
+    } else {
+      // The context the texture was created in has been destroyed, which destroyed the texture too
+      freed += TextureSize(it.value().get());
+
+      textures_.erase(it);
+      usage_.removeOne(key);
+    }
+  }
+
+  lock_.unlock();
+
+  olive::image_cache.Freed(ImageCache::kTexBuf, freed);
+
+  return texture;
+}
+
+void StillTextureCache::Insert(const QString &key, RenderTexturePtr texture)
+{
+  qint64 freed = 0;
+
+  lock_.lock();
+
+  if (pending_eviction_ > 0) {
+    freed = DestroyUnusedTextures(pending_eviction_);
+    pending_eviction_ = 0;
+  }
+
+  // Another thread may have uploaded the same still in the meantime, in which case its texture is replaced
+  if (textures_.contains(key)) {
+    freed += TextureSize(textures_.value(key).get());
+    usage_.removeOne(key);
+  }
+
+  textures_.insert(key, texture);
+  usage_.append(key);
+
+  lock_.unlock();
+
+  // Report outside of our lock since the image cache may call Evict() on us
+  olive::image_cache.Freed(ImageCache::kTexBuf, freed);
+  olive::image_cache.Allocated(ImageCache::kTexBuf, TextureSize(texture.get()));
+}
+
+void StillTextureCache::Evict(const ImageCache::BufferType &type, const qint64 &bytes)
+{
+  if (type != ImageCache::kTexBuf) {
+    return;
+  }
+
+  // We can be called from any thread so we can't destroy textures here, Get() or Insert() will do it instead
+  QMutexLocker locker(&lock_);
+
+  pending_eviction_ = qMax(pending_eviction_, bytes);
+}
+
+qint64 StillTextureCache::TextureSize(RenderTexture *texture)
+{
+  // Mipmaps add another third
+  qint64 size = PixelService::GetBufferSize(texture->format(), texture->width(), texture->height());
+
+  return size + size / 3;
+}
+
+qint64 StillTextureCache::DestroyUnusedTextures(qint64 bytes)
+{
+  qint64 freed = 0;
+
+  QList<QString>::iterator it = usage_.begin();
+
+  while (it != usage_.end() && (bytes < 0 || freed < bytes)) {
+    RenderTexturePtr& texture = textures_[*it];
+
+    // Textures still referenced elsewhere are being drawn from, and their contexts may not be current here anyway
+    if (texture.use_count() > 1 && texture->IsCreated()) {
+      it++;
+      continue;
+    }
+
+    freed += TextureSize(texture.get());
+
+    textures_.remove(*it);
+    it = usage_.erase(it);
+  }
+
+  return freed;
+}
@@ -0,0 +1,117 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef STILLTEXTURECACHE_H
+#define STILLTEXTURECACHE_H
+
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QOpenGLContext>
+
+#include "imagecache.h"
+#include "rendertexture.h"
+
+/**
+ * @brief Textures of still images that stay resident in VRAM, shared by every frame and clip showing them
+ *
+ * A still looks the same at every time, so once it's been uploaded (and its mipmaps generated) any media node drawing
+ * the same footage at the same decode divider, format and color path can draw from that texture instead of
+ * uploading its own. Ten clips of the same logo share one texture, and scrubbing over them uploads nothing.
+ *
+ * Textures are shared between every context in the share group they were created in. An entry is in use while
+ * anything other than the cache holds its RenderTexturePtr. The VRAM of every texture is accounted for in
+ * olive::image_cache, and when VRAM runs short the unused textures are destroyed least recently used first. Like
+ * RenderTexturePool, that's deferred to the next Get() or Insert() since that's when a context is known to be current.
+ * This class is thread-safe.
+ */
+class StillTextureCache : public ImageCache::Client
+{
+public:
+  /**
+   * @brief The cache used by every renderer
+   *
+   * Created on first use (so after olive::image_cache, which it registers with, and destroyed before it).
+   */
+  static StillTextureCache* Instance();
+
+  virtual ~StillTextureCache() override;
+
+  /**
+   * @brief Returns the key identifying the texture of a still decoded with these parameters in `ctx`'s share group
+   *
+   * @param color_converted
+   *
+   * Whether the still's colors were converted on the CPU before uploading (see MediaInput::Value()).
+   */
+  static QString Key(QOpenGLContext* ctx,
+                     const QString& filename,
+                     int stream_index,
+                     int divider,
+                     const olive::PixelFormat& format,
+                     bool color_converted);
+
+  /**
+   * @brief Retrieve the texture cached under `key`, or nullptr if there isn't one
+   *
+   * A context in the texture's share group must be current. If the texture was last drawn into in another context,
+   * call RenderTexture::WaitFence() before sampling it.
+   */
+  RenderTexturePtr Get(const QString& key);
+
+  /**
+   * @brief Cache a still texture under `key`
+   *
+   * The texture must not be modified after this, so upload it, generate its mipmaps and call RenderTexture::Fence()
+   * first. Its context must be current.
+   */
+  void Insert(const QString& key, RenderTexturePtr texture);
+
+  virtual void Evict(const ImageCache::BufferType& type, const qint64& bytes) override;
+
+private:
+  StillTextureCache();
+
+  /**
+   * @brief Returns the VRAM used by a texture including its mipmaps
+   */
+  static qint64 TextureSize(RenderTexture* texture);
+
+  /**
+   * @brief Destroy unused textures (least recently used first) until at least `bytes` are freed, -1 for all of them
+   *
+   * Also drops textures whose context has already destroyed them. Must be called with the lock held, returns the
+   * bytes freed.
+   */
+  qint64 DestroyUnusedTextures(qint64 bytes);
+
+  QHash<QString, RenderTexturePtr> textures_;
+
+  /**
+   * @brief Keys of textures_ from least to most recently used
+   */
+  QList<QString> usage_;
+
+  qint64 pending_eviction_;
+
+  QMutex lock_;
+
+};
+
+#endif // STILLTEXTURECACHE_H
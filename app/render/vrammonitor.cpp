@@ -0,0 +1,152 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#include "vrammonitor.h"
+
+#include <QDebug>
+#include <QOpenGLFunctions>
+
+#include "config/config.h"
+#include "render/imagecache.h"
+
+VRAMMonitor olive::vram_monitor;
+
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+VRAMMonitor::VRAMMonitor() :
+  allocated_(0),
+  driver_available_(-1),
+  allocated_at_query_(0),
+  last_query_(-kVRAMQueryInterval),
+  last_failure_(-1),
+  pressure_(kNormal)
+{
+  clock_.start();
+}
+
+void VRAMMonitor::Allocated(qint64 bytes)
+{
+  allocated_.fetchAndAddOrdered(bytes);
+
+  Update();
+}
+
+void VRAMMonitor::Freed(qint64 bytes)
+{
+  allocated_.fetchAndAddOrdered(-bytes);
+
+  Update();
+}
+
+void VRAMMonitor::AllocationFailed(qint64 bytes)
+{
+  qWarning() << "Failed to allocate" << bytes << "bytes of VRAM," << allocated() << "bytes are in use";
+
+  last_failure_.storeRelease(clock_.elapsed());
+
+  Update();
+
+  // Whatever the driver said, it didn't have room for this, so make some
+  olive::image_cache.SetLimit(ImageCache::kTexBuf,
+                              qMax(Q_INT64_C(0), olive::image_cache.usage(ImageCache::kTexBuf) - bytes));
+}
+
+void VRAMMonitor::Query(QOpenGLContext *ctx)
+{
+  qint64 now = clock_.elapsed();
+  qint64 last = last_query_.loadAcquire();
+
+  // Only one thread queries at a time
+  if (now - last < kVRAMQueryInterval || !last_query_.testAndSetOrdered(last, now)) {
+    return;
+  }
+
+  QOpenGLFunctions* f = ctx->functions();
+  GLint kilobytes[4] = {-1, -1, -1, -1};
+
+  if (ctx->hasExtension(QByteArrayLiteral("GL_NVX_gpu_memory_info"))) {
+    f->glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, kilobytes);
+  } else if (ctx->hasExtension(QByteArrayLiteral("GL_ATI_meminfo"))) {
+    // The first value is the total free in the pool, the rest are about the largest free block and auxiliary memory
+    f->glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, kilobytes);
+  }
+
+  allocated_at_query_.storeRelease(allocated_.loadAcquire());
+  driver_available_.storeRelease((kilobytes[0] >= 0) ? static_cast<qint64>(kilobytes[0]) * 1024 : -1);
+
+  Update();
+  UpdateImageCacheLimit();
+}
+
+qint64 VRAMMonitor::allocated() const
+{
+  return allocated_.loadAcquire();
+}
+
+qint64 VRAMMonitor::available() const
+{
+  qint64 driver_available = driver_available_.loadAcquire();
+
+  if (driver_available < 0) {
+    return kVRAMFallbackBudget - allocated();
+  }
+
+  // The driver's figure is out of date by whatever we've allocated since
+  return driver_available - (allocated() - allocated_at_query_.loadAcquire());
+}
+
+VRAMMonitor::Pressure VRAMMonitor::pressure() const
+{
+  return static_cast<Pressure>(pressure_.loadAcquire());
+}
+
+void VRAMMonitor::Update()
+{
+  qint64 available = this->available();
+  qint64 last_failure = last_failure_.loadAcquire();
+
+  Pressure p;
+
+  if (available < kVRAMCriticalHeadroom
+      || (last_failure >= 0 && clock_.elapsed() - last_failure < kVRAMFailureHoldTime)) {
+    p = kCritical;
+  } else if (available < kVRAMPressureHeadroom) {
+    p = kPressure;
+  } else {
+    p = kNormal;
+  }
+
+  if (pressure_.fetchAndStoreOrdered(p) != p) {
+    emit PressureChanged();
+  }
+}
+
+void VRAMMonitor::UpdateImageCacheLimit()
+{
+  // Leave the headroom free, evicting idle textures if that's what it takes
+  qint64 limit = olive::image_cache.usage(ImageCache::kTexBuf) + available() - kVRAMPressureHeadroom;
+
+  olive::image_cache.SetLimit(ImageCache::kTexBuf, qMax(Q_INT64_C(0), limit));
+}
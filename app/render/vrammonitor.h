@@ -0,0 +1,132 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+#ifndef VRAMMONITOR_H
+#define VRAMMONITOR_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+
+/**
+ * @brief Keeps track of how much VRAM is left so rendering can use less before the driver runs out
+ *
+ * Every RenderTexture reports what it allocates and frees here. Drivers that support GL_NVX_gpu_memory_info or
+ * GL_ATI_meminfo are also asked how much is actually free (which includes other applications' use), otherwise our own
+ * textures are measured against kVRAMFallbackBudget. Allocations that fail with GL_OUT_OF_MEMORY make pressure
+ * critical for kVRAMFailureHoldTime whatever the numbers say.
+ *
+ * Under pressure(), the texture budget of olive::image_cache is limited to what's free so idle textures are evicted
+ * and frames in flight are held back (see ImageCache::SetLimit()), and RendererProcessor reduces its render threads
+ * and then its divider while pressure is critical.
+ *
+ * This class is thread-safe.
+ */
+class VRAMMonitor : public QObject
+{
+  Q_OBJECT
+public:
+  enum Pressure {
+    kNormal,
+    kPressure,
+    kCritical
+  };
+
+  VRAMMonitor();
+
+  /**
+   * @brief Report a texture being allocated
+   */
+  void Allocated(qint64 bytes);
+
+  /**
+   * @brief Report a texture being freed
+   */
+  void Freed(qint64 bytes);
+
+  /**
+   * @brief Report a texture allocation that failed with GL_OUT_OF_MEMORY
+   *
+   * Evicts what olive::image_cache can so the allocation can be tried again.
+   */
+  void AllocationFailed(qint64 bytes);
+
+  /**
+   * @brief Ask the driver how much VRAM is free, if it's been kVRAMQueryInterval since it was last asked
+   *
+   * `ctx` must be current. Cheap enough to call after every frame.
+   */
+  void Query(QOpenGLContext* ctx);
+
+  /**
+   * @brief Bytes our textures are using
+   */
+  qint64 allocated() const;
+
+  /**
+   * @brief Bytes of VRAM that are still free, estimated from the last query and what's been allocated since
+   */
+  qint64 available() const;
+
+  Pressure pressure() const;
+
+  /**
+   * @brief Recalculate pressure() and emit PressureChanged() if it changed
+   *
+   * Done whenever anything is reported, but critical pressure from a failed allocation also has to be checked for
+   * having worn off.
+   */
+  void Update();
+
+signals:
+  /**
+   * @brief Emitted from whichever thread changed the pressure
+   */
+  void PressureChanged();
+
+private:
+  /**
+   * @brief Limit olive::image_cache's texture budget to what's free
+   */
+  void UpdateImageCacheLimit();
+
+  QElapsedTimer clock_;
+
+  QAtomicInteger<qint64> allocated_;
+
+  /// Free VRAM the driver reported, -1 if it can't tell
+  QAtomicInteger<qint64> driver_available_;
+
+  /// allocated_ at the time of the last query
+  QAtomicInteger<qint64> allocated_at_query_;
+
+  QAtomicInteger<qint64> last_query_;
+
+  /// clock_ time of the last failed allocation, -1 if none has failed
+  QAtomicInteger<qint64> last_failure_;
+
+  QAtomicInt pressure_;
+
+};
+
+namespace olive {
+extern VRAMMonitor vram_monitor;
+}
+
+#endif // VRAMMONITOR_H
@@ -0,0 +1,109 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef YUVFORMAT_H
+#define YUVFORMAT_H
+
+namespace olive {
+
+/**
+ * @brief How the planes of a YUV frame are laid out in memory
+ */
+enum YUVLayout {
+  YUV_LAYOUT_INVALID = -1,
+
+  /// Y, U, and V each in their own plane (e.g. YUV420P)
+  YUV_LAYOUT_PLANAR,
+
+  /// Y in one plane, U and V interleaved in a second plane (e.g. NV12, P010)
+  YUV_LAYOUT_SEMIPLANAR,
+
+  /// Not YUV: 10-bit RGB packed into one 32-bit word per pixel (DPX "filled method A"), unpacked on the GPU
+  YUV_LAYOUT_PACKED_RGB10
+};
+
+/**
+ * @brief The matrix coefficients used to convert YUV to RGB
+ */
+enum YUVColorspace {
+  YUV_COLORSPACE_BT601,
+  YUV_COLORSPACE_BT709,
+  YUV_COLORSPACE_BT2020
+};
+
+/**
+ * @brief Description of a frame's native YUV data
+ *
+ * Used for frames that are passed to the renderer as planar YUV so that they can be converted to RGBA on the GPU.
+ */
+struct YUVInfo {
+  YUVInfo() :
+    layout(YUV_LAYOUT_INVALID),
+    chroma_shift_w(0),
+    chroma_shift_h(0),
+    bit_depth(8),
+    msb_aligned(false),
+    colorspace(YUV_COLORSPACE_BT709),
+    full_range(false),
+    big_endian(false)
+  {
+  }
+
+  YUVLayout layout;
+
+  /// Chroma planes are (width >> chroma_shift_w) by (height >> chroma_shift_h)
+  int chroma_shift_w;
+  int chroma_shift_h;
+
+  /// Bits per sample, samples over 8 bits are stored in 16-bit words
+  int bit_depth;
+
+  /// TRUE if samples over 8 bits are stored in the high bits of their 16-bit word (e.g. P010)
+  bool msb_aligned;
+
+  YUVColorspace colorspace;
+
+  /// TRUE if samples use the full range, FALSE if they use "TV"/limited range
+  bool full_range;
+
+  /// Packed layouts only, TRUE if each pixel's word is stored big-endian
+  bool big_endian;
+};
+
+inline bool operator==(const YUVInfo& a, const YUVInfo& b)
+{
+  return a.layout == b.layout
+      && a.chroma_shift_w == b.chroma_shift_w
+      && a.chroma_shift_h == b.chroma_shift_h
+      && a.bit_depth == b.bit_depth
+      && a.msb_aligned == b.msb_aligned
+      && a.colorspace == b.colorspace
+      && a.full_range == b.full_range
+      && a.big_endian == b.big_endian;
+}
+
+inline bool operator!=(const YUVInfo& a, const YUVInfo& b)
+{
+  return !(a == b);
+}
+
+}
+
+#endif // YUVFORMAT_H
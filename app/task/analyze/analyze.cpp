@@ -0,0 +1,350 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "analyze.h"
+
+#include <QFileInfo>
+
+#include "filmstripanalyzer.h"
+#include "indexanalyzer.h"
+#include "proxyanalyzer.h"
+#include "waveformanalyzer.h"
+
+AnalyzeTask::AnalyzeTask(FootagePtr footage) :
+  footage_(footage),
+  fmt_ctx_(nullptr),
+  pkt_(nullptr),
+  frame_(nullptr)
+{
+  QString base_filename = QFileInfo(footage_->filename()).fileName();
+
+  set_text(tr("Analyzing \"%1\"").arg(base_filename));
+  set_category(kCategoryIO);
+  set_device(footage_->filename());
+}
+
+AnalyzeTask::~AnalyzeTask()
+{
+  CleanUp();
+}
+
+bool AnalyzeTask::Action()
+{
+  footage_->LockDeletes();
+
+  // Create an analyzer for everything each stream needs built
+  for (int i=0;i<footage_->stream_count();i++) {
+    StreamPtr s = footage_->stream(i);
+
+    if (s->type() == Stream::kVideo) {
+      analyzers_.append(std::make_shared<IndexAnalyzer>(s));
+      analyzers_.append(std::make_shared<FilmstripAnalyzer>(s));
+
+      if (ProxyAnalyzer::IsProxyNeeded(s.get())) {
+        analyzers_.append(std::make_shared<ProxyAnalyzer>(std::static_pointer_cast<VideoStream>(s)));
+      }
+    } else if (s->type() == Stream::kAudio) {
+      analyzers_.append(std::make_shared<WaveformAnalyzer>(s));
+    }
+  }
+
+  QList<MediaAnalyzerPtr> needed;
+
+  foreach (MediaAnalyzerPtr a, analyzers_) {
+    if (a->IsNeeded()) {
+      needed.append(a);
+    }
+  }
+
+  // Don't touch the file at all if everything was built by a previous import
+  if (needed.isEmpty()) {
+    footage_->UnlockDeletes();
+    return true;
+  }
+
+  bool read_ok = Open(needed);
+
+  int64_t file_size = (fmt_ctx_ != nullptr && fmt_ctx_->pb != nullptr) ? avio_size(fmt_ctx_->pb) : 0;
+
+  while (read_ok && !cancelled()) {
+    int error_code = av_read_frame(fmt_ctx_, pkt_);
+
+    if (error_code == AVERROR_EOF) {
+      break;
+    } else if (error_code < 0) {
+      FFmpegError(error_code);
+      read_ok = false;
+      break;
+    }
+
+    if (pkt_->stream_index >= streams_.size()) {
+      av_packet_unref(pkt_);
+      continue;
+    }
+
+    AnalyzedStream& stream = streams_[pkt_->stream_index];
+
+    for (int i=0;i<stream.analyzers.size();i++) {
+      if (!stream.analyzers.at(i)->Packet(pkt_)) {
+        Fail(stream, i);
+        i--;
+      }
+    }
+
+    if (stream.decoder != nullptr && UsesFrames(stream)) {
+      Decode(stream, pkt_);
+    }
+
+    if (file_size > 0 && pkt_->pos >= 0) {
+      emit ProgressChanged(static_cast<int>(qMin(pkt_->pos * 100 / file_size, static_cast<int64_t>(100))));
+    }
+
+    av_packet_unref(pkt_);
+  }
+
+  bool complete = read_ok && !cancelled();
+
+  if (complete) {
+    // Flush the decoders of any frames they're still holding on to
+    for (int i=0;i<streams_.size();i++) {
+      if (streams_.at(i).decoder != nullptr && UsesFrames(streams_.at(i))) {
+        Decode(streams_[i], nullptr);
+      }
+    }
+  }
+
+  bool result = read_ok;
+
+  foreach (MediaAnalyzerPtr a, needed) {
+    bool failed = failed_.contains(a);
+
+    if (!a->End(complete && !failed) || failed) {
+      if (!a->error().isEmpty()) {
+        set_error(a->error());
+      }
+
+      result = false;
+    }
+  }
+
+  CleanUp();
+
+  footage_->UnlockDeletes();
+
+  return result;
+}
+
+bool AnalyzeTask::Epilogue()
+{
+  foreach (MediaAnalyzerPtr a, analyzers_) {
+    a->Epilogue();
+  }
+
+  analyzers_.clear();
+  failed_.clear();
+
+  return true;
+}
+
+bool AnalyzeTask::CanAnalyze(Footage *footage)
+{
+  return footage->decoder() == QStringLiteral("ffmpeg");
+}
+
+bool AnalyzeTask::Open(const QList<MediaAnalyzerPtr> &analyzers)
+{
+  int error_code;
+
+  QByteArray filename = footage_->filename().toUtf8();
+
+  error_code = avformat_open_input(&fmt_ctx_, filename.constData(), nullptr, nullptr);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  error_code = avformat_find_stream_info(fmt_ctx_, nullptr);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  streams_.resize(static_cast<int>(fmt_ctx_->nb_streams));
+
+  for (int i=0;i<streams_.size();i++) {
+    streams_[i].decoder = nullptr;
+  }
+
+  foreach (MediaAnalyzerPtr a, analyzers) {
+    int index = a->stream()->index();
+
+    if (index < streams_.size()) {
+      streams_[index].analyzers.append(a);
+    }
+  }
+
+  for (int i=0;i<streams_.size();i++) {
+    AnalyzedStream& stream = streams_[i];
+    AVStream* avstream = fmt_ctx_->streams[i];
+
+    // Let the demuxer skip whatever nothing is analyzing
+    if (stream.analyzers.isEmpty()) {
+      avstream->discard = AVDISCARD_ALL;
+      continue;
+    }
+
+    if (UsesFrames(stream)) {
+      const AVCodec* codec = avcodec_find_decoder(avstream->codecpar->codec_id);
+
+      if (codec != nullptr) {
+        stream.decoder = avcodec_alloc_context3(codec);
+
+        error_code = avcodec_parameters_to_context(stream.decoder, avstream->codecpar);
+
+        if (error_code >= 0) {
+          AVDictionary* opts = nullptr;
+          av_dict_set(&opts, "threads", "auto", 0);
+
+          error_code = avcodec_open2(stream.decoder, codec, &opts);
+          av_dict_free(&opts);
+        }
+
+        if (error_code < 0) {
+          avcodec_free_context(&stream.decoder);
+        }
+      }
+
+      if (stream.decoder != nullptr) {
+        // If only keyframes are wanted from this stream, the decoder doesn't need to touch anything else
+        bool keyframes_only = true;
+
+        foreach (MediaAnalyzerPtr a, stream.analyzers) {
+          if (a->frame_usage() == MediaAnalyzer::kAllFrames) {
+            keyframes_only = false;
+            break;
+          }
+        }
+
+        if (keyframes_only) {
+          stream.decoder->skip_frame = AVDISCARD_NONKEY;
+        }
+      }
+    }
+
+    for (int j=0;j<stream.analyzers.size();j++) {
+      MediaAnalyzerPtr a = stream.analyzers.at(j);
+
+      // Without a decoder, analyzers that need frames can't run
+      if (a->frame_usage() != MediaAnalyzer::kNoFrames && stream.decoder == nullptr) {
+        set_error(tr("Failed to find a decoder for stream %1").arg(i));
+        Fail(stream, j);
+        j--;
+      } else if (!a->Begin(avstream, stream.decoder)) {
+        Fail(stream, j);
+        j--;
+      }
+    }
+  }
+
+  pkt_ = av_packet_alloc();
+  frame_ = av_frame_alloc();
+
+  return true;
+}
+
+void AnalyzeTask::Decode(AnalyzedStream &stream, AVPacket *pkt)
+{
+  int error_code = avcodec_send_packet(stream.decoder, pkt);
+
+  while (error_code >= 0) {
+    error_code = avcodec_receive_frame(stream.decoder, frame_);
+
+    if (error_code < 0) {
+      break;
+    }
+
+    for (int i=0;i<stream.analyzers.size();i++) {
+      MediaAnalyzerPtr a = stream.analyzers.at(i);
+
+      if (a->frame_usage() == MediaAnalyzer::kNoFrames
+          || (a->frame_usage() == MediaAnalyzer::kKeyframes && !frame_->key_frame)) {
+        continue;
+      }
+
+      if (!a->Frame(frame_)) {
+        Fail(stream, i);
+        i--;
+      }
+    }
+
+    av_frame_unref(frame_);
+  }
+
+  if (error_code != AVERROR(EAGAIN) && error_code != AVERROR_EOF) {
+    // The decoder can't continue, so neither can anything using its frames
+    for (int i=0;i<stream.analyzers.size();i++) {
+      if (stream.analyzers.at(i)->frame_usage() != MediaAnalyzer::kNoFrames) {
+        FFmpegError(error_code);
+        Fail(stream, i);
+        i--;
+      }
+    }
+  }
+}
+
+void AnalyzeTask::Fail(AnalyzedStream &stream, int index)
+{
+  failed_.append(stream.analyzers.takeAt(index));
+}
+
+bool AnalyzeTask::UsesFrames(const AnalyzedStream &stream)
+{
+  foreach (MediaAnalyzerPtr a, stream.analyzers) {
+    if (a->frame_usage() != MediaAnalyzer::kNoFrames) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void AnalyzeTask::CleanUp()
+{
+  for (int i=0;i<streams_.size();i++) {
+    avcodec_free_context(&streams_[i].decoder);
+  }
+
+  streams_.clear();
+
+  av_frame_free(&frame_);
+  av_packet_free(&pkt_);
+
+  avformat_close_input(&fmt_ctx_);
+}
+
+void AnalyzeTask::FFmpegError(int error_code)
+{
+  char err[1024];
+  av_strerror(error_code, err, 1024);
+
+  set_error(tr("Failed to analyze %1 - %2 %3").arg(footage_->filename(),
+                                                   QString::number(error_code),
+                                                   err));
+}
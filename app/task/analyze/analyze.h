@@ -0,0 +1,122 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef ANALYZETASK_H
+#define ANALYZETASK_H
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <QVector>
+
+#include "mediaanalyzer.h"
+#include "project/item/footage/footage.h"
+#include "task/task.h"
+
+/**
+ * @brief A background task that builds everything an imported Footage file needs in a single read of it
+ *
+ * Indexes, filmstrips, waveforms and proxies all need the whole file read (and mostly decoded), so building each one
+ * in its own task reads and decodes the same media several times over. AnalyzeTask demuxes the file once, decodes each
+ * stream at most once, and hands the packets and frames to a MediaAnalyzer per output. Analyzers are fed
+ * synchronously from the read loop, so the slowest one paces the read and nothing is buffered between them.
+ *
+ * Only FFmpeg footage is read this way (see CanAnalyze()), ImportTask still creates IndexTask, FilmstripTask and
+ * WaveformTask for anything else.
+ */
+class AnalyzeTask : public Task
+{
+  Q_OBJECT
+public:
+  AnalyzeTask(FootagePtr footage);
+
+  virtual ~AnalyzeTask() override;
+
+  virtual bool Action() override;
+
+  virtual bool Epilogue() override;
+
+  /**
+   * @brief Returns whether a Footage file can be read by AnalyzeTask
+   */
+  static bool CanAnalyze(Footage* footage);
+
+private:
+  /**
+   * @brief One stream of the file being read, and the analyzers fed from it
+   */
+  struct AnalyzedStream {
+    QList<MediaAnalyzerPtr> analyzers;
+
+    AVCodecContext* decoder;
+  };
+
+  /**
+   * @brief Open the file and a decoder for each stream whose analyzers use frames, then Begin() every analyzer
+   */
+  bool Open(const QList<MediaAnalyzerPtr>& analyzers);
+
+  /**
+   * @brief Send a packet (or nullptr to flush) to a stream's decoder and hand its analyzers every frame ready
+   */
+  void Decode(AnalyzedStream& stream, AVPacket* pkt);
+
+  /**
+   * @brief Take an analyzer that gave up out of the rest of the read
+   */
+  void Fail(AnalyzedStream& stream, int index);
+
+  /**
+   * @brief Returns whether any of a stream's remaining analyzers use frames
+   */
+  static bool UsesFrames(const AnalyzedStream& stream);
+
+  /**
+   * @brief Free all FFmpeg objects used by Action()
+   */
+  void CleanUp();
+
+  /**
+   * @brief Handle an FFmpeg error code by setting it as this task's error message
+   */
+  void FFmpegError(int error_code);
+
+  FootagePtr footage_;
+
+  /**
+   * @brief Every analyzer created, including those that weren't needed (they may still have something to attach)
+   */
+  QList<MediaAnalyzerPtr> analyzers_;
+
+  /**
+   * @brief Analyzers that gave up before the read finished
+   */
+  QList<MediaAnalyzerPtr> failed_;
+
+  QVector<AnalyzedStream> streams_;
+
+  AVFormatContext* fmt_ctx_;
+  AVPacket* pkt_;
+  AVFrame* frame_;
+};
+
+#endif // ANALYZETASK_H
@@ -0,0 +1,144 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "filmstripanalyzer.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QImage>
+#include <QtMath>
+
+#include "project/item/footage/videostream.h"
+
+FilmstripAnalyzer::FilmstripAnalyzer(StreamPtr stream) :
+  MediaAnalyzer(stream),
+  filename_(Filmstrip::GetFilename(stream.get())),
+  interval_(Filmstrip::kInterval),
+  thumbnail_width_(0),
+  next_time_(0),
+  scale_ctx_(nullptr)
+{
+}
+
+FilmstripAnalyzer::~FilmstripAnalyzer()
+{
+  sws_freeContext(scale_ctx_);
+}
+
+bool FilmstripAnalyzer::IsNeeded()
+{
+  return Filmstrip::Load(filename_) == nullptr;
+}
+
+MediaAnalyzer::FrameUsage FilmstripAnalyzer::frame_usage() const
+{
+  return kKeyframes;
+}
+
+bool FilmstripAnalyzer::Begin(AVStream *stream, AVCodecContext *decoder)
+{
+  Q_UNUSED(decoder)
+
+  VideoStream* video_stream = static_cast<VideoStream*>(this->stream().get());
+
+  if (this->stream()->duration() <= 0 || video_stream->width() <= 0 || video_stream->height() <= 0) {
+    set_error(QCoreApplication::translate("FilmstripAnalyzer", "Failed to generate thumbnails for stream %1")
+              .arg(this->stream()->index()));
+    return false;
+  }
+
+  timebase_ = stream->time_base;
+
+  double duration = rational(this->stream()->duration() * this->stream()->timebase().numerator(),
+                             this->stream()->timebase().denominator()).toDouble();
+
+  interval_ = qMax(static_cast<int>(Filmstrip::kInterval), qCeil(duration / Filmstrip::kMaxThumbnails));
+
+  thumbnail_width_ = qMax(1, qRound(static_cast<double>(Filmstrip::kThumbnailHeight)
+                                    * video_stream->width() / video_stream->height()));
+
+  builder_ = std::unique_ptr<FilmstripBuilder>(new FilmstripBuilder(thumbnail_width_, Filmstrip::kThumbnailHeight));
+
+  return true;
+}
+
+bool FilmstripAnalyzer::Frame(const AVFrame *frame)
+{
+  if (frame->best_effort_timestamp == AV_NOPTS_VALUE) {
+    return true;
+  }
+
+  double frame_time = rational(frame->best_effort_timestamp * timebase_.num, timebase_.den).toDouble();
+
+  if (frame_time < next_time_) {
+    return true;
+  }
+
+  scale_ctx_ = sws_getCachedContext(scale_ctx_,
+                                    frame->width,
+                                    frame->height,
+                                    static_cast<AVPixelFormat>(frame->format),
+                                    thumbnail_width_,
+                                    Filmstrip::kThumbnailHeight,
+                                    AV_PIX_FMT_RGBA,
+                                    SWS_AREA,
+                                    nullptr,
+                                    nullptr,
+                                    nullptr);
+
+  if (scale_ctx_ == nullptr) {
+    set_error(QCoreApplication::translate("FilmstripAnalyzer", "Failed to create thumbnail scaling context"));
+    return false;
+  }
+
+  QImage thumbnail(thumbnail_width_, Filmstrip::kThumbnailHeight, QImage::Format_RGBA8888);
+
+  uint8_t* dst_data[] = {thumbnail.bits()};
+  int dst_linesize[] = {thumbnail.bytesPerLine()};
+
+  sws_scale(scale_ctx_, frame->data, frame->linesize, 0, frame->height, dst_data, dst_linesize);
+
+  builder_->AddThumbnail(frame_time, thumbnail);
+
+  next_time_ = (qFloor(frame_time / interval_) + 1) * interval_;
+
+  return true;
+}
+
+bool FilmstripAnalyzer::End(bool complete)
+{
+  if (!complete || builder_ == nullptr) {
+    return true;
+  }
+
+  // Write to a temporary file first so that painters never map a half-written filmstrip
+  QString partial_filename = filename_;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  if (!builder_->Save(partial_filename)) {
+    set_error(QCoreApplication::translate("FilmstripAnalyzer", "Failed to generate thumbnails for stream %1")
+              .arg(stream()->index()));
+    return false;
+  }
+
+  QFile::remove(filename_);
+
+  return QFile::rename(partial_filename, filename_);
+}
@@ -0,0 +1,76 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FILMSTRIPANALYZER_H
+#define FILMSTRIPANALYZER_H
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#include <memory>
+
+#include "decoder/filmstrip.h"
+#include "mediaanalyzer.h"
+
+/**
+ * @brief Builds the Filmstrip of a video stream from its keyframes
+ *
+ * Like FilmstripTask, a thumbnail is kept every Filmstrip::kInterval seconds (or further apart for long streams so
+ * there are at most Filmstrip::kMaxThumbnails), using the first keyframe at or after each interval.
+ */
+class FilmstripAnalyzer : public MediaAnalyzer
+{
+public:
+  FilmstripAnalyzer(StreamPtr stream);
+
+  virtual ~FilmstripAnalyzer() override;
+
+  virtual bool IsNeeded() override;
+
+  virtual FrameUsage frame_usage() const override;
+
+  virtual bool Begin(AVStream* stream, AVCodecContext* decoder) override;
+
+  virtual bool Frame(const AVFrame* frame) override;
+
+  virtual bool End(bool complete) override;
+
+private:
+  QString filename_;
+
+  std::unique_ptr<FilmstripBuilder> builder_;
+
+  AVRational timebase_;
+
+  int interval_;
+
+  int thumbnail_width_;
+
+  /**
+   * @brief The time (in seconds) the next thumbnail is due at
+   */
+  double next_time_;
+
+  SwsContext* scale_ctx_;
+
+};
+
+#endif // FILMSTRIPANALYZER_H
@@ -0,0 +1,123 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "indexanalyzer.h"
+
+#include <algorithm>
+#include <QCoreApplication>
+#include <QFile>
+
+#include "decoder/decoder.h"
+#include "project/item/footage/footage.h"
+
+IndexAnalyzer::IndexAnalyzer(StreamPtr stream) :
+  MediaAnalyzer(stream),
+  filename_(FrameIndex::GetFilename(stream.get())),
+  packets_usable_(true)
+{
+}
+
+bool IndexAnalyzer::IsNeeded()
+{
+  return FrameIndex::Load(filename_) == nullptr;
+}
+
+MediaAnalyzer::FrameUsage IndexAnalyzer::frame_usage() const
+{
+  return kNoFrames;
+}
+
+bool IndexAnalyzer::Begin(AVStream *stream, AVCodecContext *decoder)
+{
+  Q_UNUSED(decoder)
+
+  timebase_ = stream->time_base;
+
+  return true;
+}
+
+bool IndexAnalyzer::Packet(const AVPacket *pkt)
+{
+  if (!packets_usable_ || (pkt->flags & AV_PKT_FLAG_DISCARD)) {
+    return true;
+  }
+
+  // Without presentation timestamps on every packet we'd need the decoder to work out the frame order
+  if (pkt->pts == AV_NOPTS_VALUE) {
+    packets_usable_ = false;
+    entries_.clear();
+    return true;
+  }
+
+  FrameIndex::Entry entry;
+  entry.pts = pkt->pts;
+  entry.pos = pkt->pos;
+  entry.keyframe = (pkt->flags & AV_PKT_FLAG_KEY);
+  entries_.append(entry);
+
+  return true;
+}
+
+bool IndexAnalyzer::End(bool complete)
+{
+  if (!complete) {
+    return true;
+  }
+
+  if (!packets_usable_ || entries_.isEmpty()) {
+    // Decoding every frame is the only way to index this stream, which the decoder does itself
+    DecoderPtr decoder = Decoder::CreateFromID(stream()->footage()->decoder());
+
+    bool indexed = false;
+
+    if (decoder != nullptr) {
+      decoder->set_stream(stream());
+      indexed = decoder->Analyze();
+      decoder->Close();
+    }
+
+    if (!indexed) {
+      set_error(QCoreApplication::translate("IndexAnalyzer", "Failed to index stream %1").arg(stream()->index()));
+    }
+
+    return indexed;
+  }
+
+  // Packets are read in decode order rather than presentation order, lookups rely on the index being sorted
+  std::sort(entries_.begin(),
+            entries_.end(),
+            [](const FrameIndex::Entry& a, const FrameIndex::Entry& b) {
+    return a.pts < b.pts;
+  });
+
+  // Write to a temporary file first so that decoders never read a half-written index
+  QString partial_filename = filename_;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  if (!FrameIndex::Save(partial_filename, entries_, stream()->index(), timebase_)) {
+    set_error(QCoreApplication::translate("IndexAnalyzer", "Failed to save index for stream %1")
+              .arg(stream()->index()));
+    return false;
+  }
+
+  QFile::remove(filename_);
+
+  return QFile::rename(partial_filename, filename_);
+}
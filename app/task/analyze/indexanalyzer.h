@@ -0,0 +1,65 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef INDEXANALYZER_H
+#define INDEXANALYZER_H
+
+#include <QVector>
+
+#include "decoder/frameindex.h"
+#include "mediaanalyzer.h"
+
+/**
+ * @brief Builds the FrameIndex of a video stream from its packets
+ *
+ * The same as FFmpegDecoder's packet indexing, but fed by AnalyzeTask. If the container doesn't give every packet a
+ * presentation timestamp, the frames need decoding to put them in order, in which case End() falls back to the
+ * decoder's own Analyze().
+ */
+class IndexAnalyzer : public MediaAnalyzer
+{
+public:
+  IndexAnalyzer(StreamPtr stream);
+
+  virtual bool IsNeeded() override;
+
+  virtual FrameUsage frame_usage() const override;
+
+  virtual bool Begin(AVStream* stream, AVCodecContext* decoder) override;
+
+  virtual bool Packet(const AVPacket* pkt) override;
+
+  virtual bool End(bool complete) override;
+
+private:
+  QString filename_;
+
+  rational timebase_;
+
+  QVector<FrameIndex::Entry> entries_;
+
+  /**
+   * @brief Cleared if a packet without a presentation timestamp comes up
+   */
+  bool packets_usable_;
+
+};
+
+#endif // INDEXANALYZER_H
@@ -0,0 +1,71 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "mediaanalyzer.h"
+
+MediaAnalyzer::MediaAnalyzer(StreamPtr stream) :
+  stream_(stream)
+{
+}
+
+MediaAnalyzer::~MediaAnalyzer()
+{
+}
+
+StreamPtr MediaAnalyzer::stream() const
+{
+  return stream_;
+}
+
+bool MediaAnalyzer::Begin(AVStream *stream, AVCodecContext *decoder)
+{
+  Q_UNUSED(stream)
+  Q_UNUSED(decoder)
+
+  return true;
+}
+
+bool MediaAnalyzer::Packet(const AVPacket *pkt)
+{
+  Q_UNUSED(pkt)
+
+  return true;
+}
+
+bool MediaAnalyzer::Frame(const AVFrame *frame)
+{
+  Q_UNUSED(frame)
+
+  return true;
+}
+
+void MediaAnalyzer::Epilogue()
+{
+}
+
+const QString &MediaAnalyzer::error() const
+{
+  return error_;
+}
+
+void MediaAnalyzer::set_error(const QString &error)
+{
+  error_ = error;
+}
@@ -0,0 +1,141 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MEDIAANALYZER_H
+#define MEDIAANALYZER_H
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <memory>
+#include <QString>
+
+#include "project/item/footage/stream.h"
+
+class MediaAnalyzer;
+using MediaAnalyzerPtr = std::shared_ptr<MediaAnalyzer>;
+
+/**
+ * @brief Something built from one stream of a file while AnalyzeTask reads it (e.g. its index or its waveform)
+ *
+ * AnalyzeTask reads the file once and hands every analyzer the packets of its stream, and (if it asks for them with
+ * frame_usage()) the frames decoded from them. Frames are decoded once per stream however many analyzers use them.
+ *
+ * Analyzers are called from the task's thread, one at a time, in the order: IsNeeded(), Begin(), then Packet() and
+ * Frame() as the file is read, End() and finally Epilogue() from the main thread. Whatever an analyzer is handed is
+ * only valid for the duration of the call.
+ */
+class MediaAnalyzer
+{
+public:
+  enum FrameUsage {
+    /// Only packets are used, the stream isn't decoded for this analyzer
+    kNoFrames,
+
+    /// Only keyframes are used, so the rest can be skipped by the decoder (unless another analyzer needs them)
+    kKeyframes,
+
+    /// Every frame is used
+    kAllFrames
+  };
+
+  MediaAnalyzer(StreamPtr stream);
+
+  virtual ~MediaAnalyzer();
+
+  MediaAnalyzer(const MediaAnalyzer& other) = delete;
+  MediaAnalyzer(MediaAnalyzer&& other) = delete;
+  MediaAnalyzer& operator=(const MediaAnalyzer& other) = delete;
+  MediaAnalyzer& operator=(MediaAnalyzer&& other) = delete;
+
+  StreamPtr stream() const;
+
+  /**
+   * @brief Returns whether there's anything to build, e.g. FALSE if it was already built on a previous import
+   *
+   * Called before the file is opened, so it isn't opened at all if no analyzer is needed.
+   */
+  virtual bool IsNeeded() = 0;
+
+  virtual FrameUsage frame_usage() const = 0;
+
+  /**
+   * @brief Set up before the first packet is read
+   *
+   * @param decoder
+   *
+   * The stream's open decoder, or nullptr if no analyzer of this stream uses frames.
+   *
+   * @return
+   *
+   * FALSE (with an error set) if this analyzer can't run, in which case it's left out of the rest of the read.
+   */
+  virtual bool Begin(AVStream* stream, AVCodecContext* decoder);
+
+  /**
+   * @brief Handle a packet of the stream, in the order they appear in the file
+   *
+   * @return
+   *
+   * FALSE (with an error set) to give up, the same as if Begin() had failed.
+   */
+  virtual bool Packet(const AVPacket* pkt);
+
+  /**
+   * @brief Handle a frame decoded from the stream, in presentation order
+   *
+   * Return value is the same as Packet().
+   */
+  virtual bool Frame(const AVFrame* frame);
+
+  /**
+   * @brief Finish up once the whole file has been read, or the read stopped early
+   *
+   * @param complete
+   *
+   * TRUE if every packet was handed over, FALSE if the task was cancelled or this analyzer gave up. Anything built
+   * from an incomplete read should be discarded.
+   *
+   * @return
+   *
+   * FALSE (with an error set) on failure.
+   */
+  virtual bool End(bool complete) = 0;
+
+  /**
+   * @brief Called from the main thread once the task has finished, e.g. to attach what was built to the project
+   */
+  virtual void Epilogue();
+
+  const QString& error() const;
+
+protected:
+  void set_error(const QString& error);
+
+private:
+  StreamPtr stream_;
+
+  QString error_;
+
+};
+
+#endif // MEDIAANALYZER_H
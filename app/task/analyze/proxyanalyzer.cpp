@@ -0,0 +1,362 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "proxyanalyzer.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include "common/filefunctions.h"
+#include "config/config.h"
+#include "decoder/decoder.h"
+
+/**
+ * @brief MJPEG quantizer used for proxies (lower is higher quality, 2-31)
+ */
+const int kProxyQuality = 4;
+
+ProxyAnalyzer::ProxyAnalyzer(VideoStreamPtr stream) :
+  MediaAnalyzer(stream),
+  filename_(GetProxyFilename(stream.get())),
+  out_fmt_ctx_(nullptr),
+  out_stream_(nullptr),
+  enc_ctx_(nullptr),
+  scaled_frame_(nullptr),
+  out_pkt_(nullptr),
+  scale_ctx_(nullptr)
+{
+  partial_filename_ = filename_;
+  partial_filename_.append(QStringLiteral(".partial"));
+}
+
+ProxyAnalyzer::~ProxyAnalyzer()
+{
+  CleanUp();
+}
+
+bool ProxyAnalyzer::IsNeeded()
+{
+  // A proxy left by a previous import only needs attaching
+  if (QFileInfo::exists(filename_)) {
+    LoadProxy();
+    return false;
+  }
+
+  return true;
+}
+
+bool ProxyAnalyzer::LoadExisting()
+{
+  return QFileInfo::exists(filename_) && LoadProxy();
+}
+
+MediaAnalyzer::FrameUsage ProxyAnalyzer::frame_usage() const
+{
+  return kAllFrames;
+}
+
+bool ProxyAnalyzer::Begin(AVStream *stream, AVCodecContext *decoder)
+{
+  int error_code;
+
+  in_timebase_ = stream->time_base;
+
+  // Create the proxy file, writing to a temporary file first so that a cancelled or failed transcode is never
+  // mistaken for a finished proxy
+  QByteArray out_filename = partial_filename_.toUtf8();
+
+  error_code = avformat_alloc_output_context2(&out_fmt_ctx_, nullptr, "mov", out_filename.constData());
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  // MJPEG is intra-frame only, so every frame of the proxy can be decoded without decoding any others
+  const AVCodec* encoder = avcodec_find_encoder(AV_CODEC_ID_MJPEG);
+  if (encoder == nullptr) {
+    set_error(QCoreApplication::translate("ProxyAnalyzer", "Failed to find the MJPEG encoder"));
+    return false;
+  }
+
+  enc_ctx_ = avcodec_alloc_context3(encoder);
+
+  // 4:2:0 requires even dimensions
+  enc_ctx_->width = qMax(2, (decoder->width / kProxyDivider) & ~1);
+  enc_ctx_->height = qMax(2, (decoder->height / kProxyDivider) & ~1);
+  enc_ctx_->sample_aspect_ratio = decoder->sample_aspect_ratio;
+  enc_ctx_->pix_fmt = AV_PIX_FMT_YUVJ420P;
+
+  // Keep the source's timebase so each proxy frame has the same timestamp as its original
+  enc_ctx_->time_base = in_timebase_;
+
+  enc_ctx_->flags |= AV_CODEC_FLAG_QSCALE;
+  enc_ctx_->global_quality = FF_QP2LAMBDA * kProxyQuality;
+
+  if (out_fmt_ctx_->oformat->flags & AVFMT_GLOBALHEADER) {
+    enc_ctx_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+
+  error_code = avcodec_open2(enc_ctx_, encoder, nullptr);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  out_stream_ = avformat_new_stream(out_fmt_ctx_, nullptr);
+  if (out_stream_ == nullptr) {
+    set_error(QCoreApplication::translate("ProxyAnalyzer", "Failed to create proxy stream"));
+    return false;
+  }
+
+  error_code = avcodec_parameters_from_context(out_stream_->codecpar, enc_ctx_);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  out_stream_->time_base = enc_ctx_->time_base;
+
+  error_code = avio_open(&out_fmt_ctx_->pb, out_filename.constData(), AVIO_FLAG_WRITE);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  error_code = avformat_write_header(out_fmt_ctx_, nullptr);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  // Allocate the working buffers
+  out_pkt_ = av_packet_alloc();
+
+  scaled_frame_ = av_frame_alloc();
+  scaled_frame_->width = enc_ctx_->width;
+  scaled_frame_->height = enc_ctx_->height;
+  scaled_frame_->format = enc_ctx_->pix_fmt;
+
+  error_code = av_frame_get_buffer(scaled_frame_, 0);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  return true;
+}
+
+bool ProxyAnalyzer::Frame(const AVFrame *frame)
+{
+  return EncodeFrame(frame);
+}
+
+bool ProxyAnalyzer::End(bool complete)
+{
+  bool result = complete;
+
+  if (result && enc_ctx_ != nullptr) {
+    // Flush the encoder
+    result = EncodeFrame(nullptr);
+
+    if (result) {
+      int error_code = av_write_trailer(out_fmt_ctx_);
+
+      if (error_code < 0) {
+        FFmpegError(error_code);
+        result = false;
+      }
+    }
+  }
+
+  CleanUp();
+
+  if (!result) {
+    QFile::remove(partial_filename_);
+
+    // An incomplete read isn't a failure of this analyzer
+    return !complete;
+  }
+
+  QFile::remove(filename_);
+
+  if (!QFile::rename(partial_filename_, filename_)) {
+    return false;
+  }
+
+  return LoadProxy();
+}
+
+void ProxyAnalyzer::Epilogue()
+{
+  if (proxy_ != nullptr) {
+    std::static_pointer_cast<VideoStream>(stream())->set_proxy(proxy_);
+    proxy_ = nullptr;
+  }
+}
+
+bool ProxyAnalyzer::IsProxyNeeded(Stream *stream)
+{
+  // Only streams too large to decode comfortably in real time get a proxy
+  return stream->type() == Stream::kVideo && static_cast<VideoStream*>(stream)->height() >= kProxyMinimumHeight;
+}
+
+QString ProxyAnalyzer::GetProxyFilename(Stream *stream)
+{
+  QString filename = GetUniqueFileIdentifier(stream->footage()->filename());
+
+  filename.append(QString::number(stream->index()));
+  filename.append(QStringLiteral(".proxy.mov"));
+
+  return QDir(GetMediaCacheLocation()).filePath(filename);
+}
+
+bool ProxyAnalyzer::EncodeFrame(const AVFrame *frame)
+{
+  int error_code;
+
+  if (frame == nullptr) {
+    error_code = avcodec_send_frame(enc_ctx_, nullptr);
+  } else {
+    scale_ctx_ = sws_getCachedContext(scale_ctx_,
+                                      frame->width,
+                                      frame->height,
+                                      static_cast<AVPixelFormat>(frame->format),
+                                      enc_ctx_->width,
+                                      enc_ctx_->height,
+                                      enc_ctx_->pix_fmt,
+                                      SWS_BILINEAR,
+                                      nullptr,
+                                      nullptr,
+                                      nullptr);
+
+    if (scale_ctx_ == nullptr) {
+      set_error(QCoreApplication::translate("ProxyAnalyzer", "Failed to create proxy scaling context"));
+      return false;
+    }
+
+    // The encoder may still be referencing the last frame
+    error_code = av_frame_make_writable(scaled_frame_);
+    if (error_code < 0) {
+      FFmpegError(error_code);
+      return false;
+    }
+
+    sws_scale(scale_ctx_,
+              frame->data,
+              frame->linesize,
+              0,
+              frame->height,
+              scaled_frame_->data,
+              scaled_frame_->linesize);
+
+    scaled_frame_->pts = frame->best_effort_timestamp;
+
+    error_code = avcodec_send_frame(enc_ctx_, scaled_frame_);
+  }
+
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  return WritePackets();
+}
+
+bool ProxyAnalyzer::WritePackets()
+{
+  int error_code;
+
+  while ((error_code = avcodec_receive_packet(enc_ctx_, out_pkt_)) >= 0) {
+    av_packet_rescale_ts(out_pkt_, enc_ctx_->time_base, out_stream_->time_base);
+    out_pkt_->stream_index = out_stream_->index;
+
+    // This takes ownership of the packet's data
+    error_code = av_interleaved_write_frame(out_fmt_ctx_, out_pkt_);
+    if (error_code < 0) {
+      FFmpegError(error_code);
+      return false;
+    }
+  }
+
+  if (error_code != AVERROR(EAGAIN) && error_code != AVERROR_EOF) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  return true;
+}
+
+bool ProxyAnalyzer::LoadProxy()
+{
+  FootagePtr proxy = std::make_shared<Footage>();
+  proxy->set_filename(filename_);
+
+  if (!Decoder::ProbeMedia(proxy.get()) || proxy->stream_count() == 0) {
+    set_error(QCoreApplication::translate("ProxyAnalyzer", "Failed to open proxy for stream %1")
+              .arg(stream()->index()));
+    return false;
+  }
+
+  // Index the proxy now so that it's ready for seeking as soon as it's attached
+  DecoderPtr decoder = Decoder::CreateFromID(proxy->decoder());
+
+  if (decoder != nullptr) {
+    decoder->set_stream(proxy->stream(0));
+    decoder->Analyze();
+    decoder->Close();
+  }
+
+  proxy_ = proxy;
+
+  return true;
+}
+
+void ProxyAnalyzer::CleanUp()
+{
+  sws_freeContext(scale_ctx_);
+  scale_ctx_ = nullptr;
+
+  av_frame_free(&scaled_frame_);
+  av_packet_free(&out_pkt_);
+
+  avcodec_free_context(&enc_ctx_);
+
+  if (out_fmt_ctx_ != nullptr) {
+    if (out_fmt_ctx_->pb != nullptr) {
+      avio_closep(&out_fmt_ctx_->pb);
+    }
+
+    avformat_free_context(out_fmt_ctx_);
+    out_fmt_ctx_ = nullptr;
+  }
+
+  out_stream_ = nullptr;
+}
+
+void ProxyAnalyzer::FFmpegError(int error_code)
+{
+  char err[1024];
+  av_strerror(error_code, err, 1024);
+
+  set_error(QCoreApplication::translate("ProxyAnalyzer", "Failed to generate proxy for stream %1 - %2 %3")
+            .arg(QString::number(stream()->index()), QString::number(error_code), err));
+}
@@ -0,0 +1,121 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROXYANALYZER_H
+#define PROXYANALYZER_H
+
+extern "C" {
+#include <libswscale/swscale.h>
+}
+
+#include "mediaanalyzer.h"
+#include "project/item/footage/footage.h"
+
+/**
+ * @brief Transcodes a large video stream to a lower resolution proxy as it's decoded
+ *
+ * Long-GOP and high resolution footage is often too slow to decode in real time. The proxy is a reduced resolution
+ * intra-frame (MJPEG) file in the media cache, which MediaInput switches to whenever the renderer doesn't need full
+ * quality (see VideoStream::proxy()). Proxies keep the original stream's timestamps so that every frame maps to the
+ * same time as its original.
+ *
+ * A stream that already has a proxy file in the media cache has it attached without transcoding again.
+ */
+class ProxyAnalyzer : public MediaAnalyzer
+{
+public:
+  ProxyAnalyzer(VideoStreamPtr stream);
+
+  virtual ~ProxyAnalyzer() override;
+
+  virtual bool IsNeeded() override;
+
+  virtual FrameUsage frame_usage() const override;
+
+  virtual bool Begin(AVStream* stream, AVCodecContext* decoder) override;
+
+  virtual bool Frame(const AVFrame* frame) override;
+
+  virtual bool End(bool complete) override;
+
+  virtual void Epilogue() override;
+
+  /**
+   * @brief Load the proxy a previous import left in the media cache, without transcoding one if there isn't one
+   *
+   * Returns FALSE if there's no proxy file or it couldn't be loaded. Otherwise Epilogue() attaches it.
+   */
+  bool LoadExisting();
+
+  /**
+   * @brief Returns whether a stream is large enough to be worth a proxy
+   */
+  static bool IsProxyNeeded(Stream* stream);
+
+  /**
+   * @brief Get the filename of the proxy for a stream
+   */
+  static QString GetProxyFilename(Stream* stream);
+
+private:
+  /**
+   * @brief Scale and encode one decoded frame (or flush the encoder if frame is nullptr)
+   */
+  bool EncodeFrame(const AVFrame* frame);
+
+  /**
+   * @brief Write any packets the encoder has ready to the output file
+   */
+  bool WritePackets();
+
+  /**
+   * @brief Probe and index the finished proxy file so it can be attached in Epilogue()
+   */
+  bool LoadProxy();
+
+  /**
+   * @brief Free all FFmpeg objects used for encoding
+   */
+  void CleanUp();
+
+  /**
+   * @brief Handle an FFmpeg error code by setting it as this analyzer's error message
+   */
+  void FFmpegError(int error_code);
+
+  QString filename_;
+
+  QString partial_filename_;
+
+  FootagePtr proxy_;
+
+  AVRational in_timebase_;
+
+  AVFormatContext* out_fmt_ctx_;
+  AVStream* out_stream_;
+  AVCodecContext* enc_ctx_;
+  AVFrame* scaled_frame_;
+  AVPacket* out_pkt_;
+
+  SwsContext* scale_ctx_;
+
+};
+
+#endif // PROXYANALYZER_H
@@ -0,0 +1,140 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "waveformanalyzer.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+#include "project/item/footage/audiostream.h"
+
+WaveformAnalyzer::WaveformAnalyzer(StreamPtr stream) :
+  MediaAnalyzer(stream),
+  filename_(Waveform::GetFilename(stream.get())),
+  channels_(0),
+  resample_ctx_(nullptr)
+{
+}
+
+WaveformAnalyzer::~WaveformAnalyzer()
+{
+  swr_free(&resample_ctx_);
+}
+
+bool WaveformAnalyzer::IsNeeded()
+{
+  return Waveform::Load(filename_) == nullptr;
+}
+
+MediaAnalyzer::FrameUsage WaveformAnalyzer::frame_usage() const
+{
+  return kAllFrames;
+}
+
+bool WaveformAnalyzer::Begin(AVStream *stream, AVCodecContext *decoder)
+{
+  Q_UNUSED(stream)
+
+  AudioStream* audio_stream = static_cast<AudioStream*>(this->stream().get());
+
+  if (this->stream()->duration() <= 0 || audio_stream->sample_rate() <= 0 || decoder->channels <= 0) {
+    set_error(QCoreApplication::translate("WaveformAnalyzer", "Failed to generate waveform for stream %1")
+              .arg(this->stream()->index()));
+    return false;
+  }
+
+  channels_ = decoder->channels;
+
+  builder_ = std::unique_ptr<WaveformBuilder>(new WaveformBuilder(channels_, decoder->sample_rate));
+
+  return true;
+}
+
+bool WaveformAnalyzer::Frame(const AVFrame *frame)
+{
+  if (frame->nb_samples <= 0) {
+    return true;
+  }
+
+  if (resample_ctx_ == nullptr) {
+    int64_t channel_layout = static_cast<int64_t>(frame->channel_layout);
+    if (channel_layout == 0) {
+      channel_layout = av_get_default_channel_layout(channels_);
+    }
+
+    // Only the sample format changes, the waveform is stored at the stream's own rate
+    resample_ctx_ = swr_alloc_set_opts(nullptr,
+                                       channel_layout,
+                                       AV_SAMPLE_FMT_FLT,
+                                       frame->sample_rate,
+                                       channel_layout,
+                                       static_cast<AVSampleFormat>(frame->format),
+                                       frame->sample_rate,
+                                       0,
+                                       nullptr);
+
+    if (resample_ctx_ == nullptr || swr_init(resample_ctx_) < 0) {
+      set_error(QCoreApplication::translate("WaveformAnalyzer", "Failed to create resampling context"));
+      return false;
+    }
+  }
+
+  int max_samples = swr_get_out_samples(resample_ctx_, frame->nb_samples);
+
+  buffer_.resize(max_samples * channels_ * static_cast<int>(sizeof(float)));
+
+  uint8_t* out = reinterpret_cast<uint8_t*>(buffer_.data());
+
+  int converted = swr_convert(resample_ctx_,
+                              &out,
+                              max_samples,
+                              const_cast<const uint8_t**>(frame->extended_data),
+                              frame->nb_samples);
+
+  if (converted < 0) {
+    set_error(QCoreApplication::translate("WaveformAnalyzer", "Failed to convert audio samples"));
+    return false;
+  }
+
+  builder_->AddSamples(out, olive::SAMPLE_FMT_FLT, converted);
+
+  return true;
+}
+
+bool WaveformAnalyzer::End(bool complete)
+{
+  if (!complete || builder_ == nullptr) {
+    return true;
+  }
+
+  // Write to a temporary file first so that painters never map a half-written waveform
+  QString partial_filename = filename_;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  if (!builder_->Save(partial_filename)) {
+    set_error(QCoreApplication::translate("WaveformAnalyzer", "Failed to generate waveform for stream %1")
+              .arg(stream()->index()));
+    return false;
+  }
+
+  QFile::remove(filename_);
+
+  return QFile::rename(partial_filename, filename_);
+}
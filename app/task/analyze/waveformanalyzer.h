@@ -0,0 +1,70 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef WAVEFORMANALYZER_H
+#define WAVEFORMANALYZER_H
+
+extern "C" {
+#include <libswresample/swresample.h>
+}
+
+#include <memory>
+#include <QByteArray>
+
+#include "decoder/waveform.h"
+#include "mediaanalyzer.h"
+
+/**
+ * @brief Builds the Waveform of an audio stream from its decoded samples
+ *
+ * Samples are converted to interleaved float at their native rate and channel count as they arrive, so the whole
+ * stream is read exactly once rather than retrieved in chunks through a Decoder like WaveformTask.
+ */
+class WaveformAnalyzer : public MediaAnalyzer
+{
+public:
+  WaveformAnalyzer(StreamPtr stream);
+
+  virtual ~WaveformAnalyzer() override;
+
+  virtual bool IsNeeded() override;
+
+  virtual FrameUsage frame_usage() const override;
+
+  virtual bool Begin(AVStream* stream, AVCodecContext* decoder) override;
+
+  virtual bool Frame(const AVFrame* frame) override;
+
+  virtual bool End(bool complete) override;
+
+private:
+  QString filename_;
+
+  std::unique_ptr<WaveformBuilder> builder_;
+
+  int channels_;
+
+  SwrContext* resample_ctx_;
+
+  QByteArray buffer_;
+
+};
+
+#endif // WAVEFORMANALYZER_H
@@ -0,0 +1,241 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "conform.h"
+
+extern "C" {
+#include <libavutil/channel_layout.h>
+#include <libswresample/swresample.h>
+}
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSet>
+
+#include "audio/audiomixer.h"
+#include "decoder/conformedaudio.h"
+#include "decoder/decoder.h"
+#include "project/item/footage/audiostream.h"
+#include "project/item/footage/footage.h"
+
+namespace {
+
+/**
+ * @brief Length (in seconds) of the audio retrieved from the decoder at a time
+ */
+const int kConformChunkLength = 10;
+
+/**
+ * @brief Files of every ConformTask that hasn't finished yet
+ */
+QSet<QString> queued_files;
+QMutex queued_files_lock;
+
+}
+
+ConformTask::ConformTask(StreamPtr stream, int sample_rate) :
+  stream_(stream),
+  sample_rate_(sample_rate),
+  filename_(ConformedAudio::GetFilename(stream.get(), sample_rate))
+{
+  QString base_filename = QFileInfo(stream_->footage()->filename()).fileName();
+
+  set_text(tr("Conforming audio for \"%1\"").arg(base_filename));
+
+  queued_files_lock.lock();
+  queued_files.insert(filename_);
+  queued_files_lock.unlock();
+}
+
+ConformTask::~ConformTask()
+{
+  queued_files_lock.lock();
+  queued_files.remove(filename_);
+  queued_files_lock.unlock();
+}
+
+bool ConformTask::Action()
+{
+  Footage* footage = stream_->footage();
+
+  footage->LockDeletes();
+
+  bool result = Conform();
+
+  footage->UnlockDeletes();
+
+  if (!result) {
+    set_error(tr("Failed to conform audio stream %1").arg(stream_->index()));
+  }
+
+  return result;
+}
+
+bool ConformTask::IsQueued(const QString &filename)
+{
+  QMutexLocker locker(&queued_files_lock);
+
+  return queued_files.contains(filename);
+}
+
+bool ConformTask::WriteResampled(SwrContext *resampler, QFile *file, const float *in, int in_count,
+                                 QVector<float> *buffer, int64_t *written)
+{
+  int out_count = swr_get_out_samples(resampler, in_count);
+
+  if (out_count <= 0) {
+    return true;
+  }
+
+  buffer->resize(out_count * ConformedAudio::kChannels);
+
+  const uint8_t* in_data = reinterpret_cast<const uint8_t*>(in);
+  uint8_t* out_data = reinterpret_cast<uint8_t*>(buffer->data());
+
+  int converted = swr_convert(resampler, &out_data, out_count, (in != nullptr) ? &in_data : nullptr, in_count);
+
+  if (converted < 0) {
+    return false;
+  }
+
+  qint64 bytes = static_cast<qint64>(converted) * ConformedAudio::kChannels * static_cast<qint64>(sizeof(float));
+
+  if (file->write(reinterpret_cast<const char*>(buffer->constData()), bytes) != bytes) {
+    return false;
+  }
+
+  *written += converted;
+
+  return true;
+}
+
+bool ConformTask::Conform()
+{
+  // Nothing to do if another task got to it first
+  if (ConformedAudio::Load(filename_) != nullptr) {
+    return true;
+  }
+
+  AudioStream* audio_stream = static_cast<AudioStream*>(stream_.get());
+
+  if (stream_->duration() <= 0 || audio_stream->sample_rate() <= 0) {
+    // Without a duration we can't tell where the audio ends (decoders pad past the end with silence)
+    return false;
+  }
+
+  DecoderPtr decoder = Decoder::CreateFromID(stream_->footage()->decoder());
+
+  if (decoder == nullptr) {
+    return false;
+  }
+
+  decoder->set_stream(stream_);
+
+  if (!decoder->Open()) {
+    return false;
+  }
+
+  int src_rate = audio_stream->sample_rate();
+
+  int64_t total_samples = qRound64(rational(stream_->duration() * stream_->timebase().numerator(),
+                                            stream_->timebase().denominator()).toDouble() * src_rate);
+
+  SwrContext* resampler = swr_alloc_set_opts(nullptr,
+                                             static_cast<int64_t>(AV_CH_LAYOUT_STEREO),
+                                             AV_SAMPLE_FMT_FLT,
+                                             sample_rate_,
+                                             static_cast<int64_t>(AV_CH_LAYOUT_STEREO),
+                                             AV_SAMPLE_FMT_FLT,
+                                             src_rate,
+                                             0,
+                                             nullptr);
+
+  if (resampler == nullptr || swr_init(resampler) < 0) {
+    swr_free(&resampler);
+    decoder->Close();
+    return false;
+  }
+
+  // Write to a temporary file first so that the mixer never maps a half-written file
+  QString partial_filename = filename_;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  QFile f(partial_filename);
+
+  // The sample count is filled in once we know it
+  bool ok = f.open(QFile::WriteOnly) && ConformedAudio::WriteHeader(&f, sample_rate_, 0);
+
+  int64_t written = 0;
+  QVector<float> stereo;
+  QVector<float> resampled;
+
+  // Retrieving contiguous windows means the decoder only ever decodes forward
+  int samples_per_chunk = kConformChunkLength * src_rate;
+
+  for (int64_t i=0;ok && i<total_samples && !cancelled();i+=samples_per_chunk) {
+    int chunk_length = static_cast<int>(qMin(static_cast<int64_t>(samples_per_chunk), total_samples - i));
+
+    FramePtr frame = decoder->Retrieve(rational(i, src_rate), rational(chunk_length, src_rate));
+
+    if (frame == nullptr) {
+      ok = false;
+      break;
+    }
+
+    chunk_length = frame->sample_count();
+    stereo.resize(chunk_length * ConformedAudio::kChannels);
+
+    AudioMixer::ToStereo(frame->const_data(),
+                         static_cast<olive::SampleFormat>(frame->format()),
+                         frame->channel_count(),
+                         chunk_length,
+                         stereo.data());
+
+    ok = WriteResampled(resampler, &f, stereo.constData(), chunk_length, &resampled, &written);
+
+    emit ProgressChanged(static_cast<int>(i * 100 / total_samples));
+  }
+
+  if (ok && !cancelled()) {
+    // Write out whatever the resampler is still holding
+    ok = WriteResampled(resampler, &f, nullptr, 0, &resampled, &written);
+  }
+
+  swr_free(&resampler);
+  decoder->Close();
+
+  if (ok && !cancelled()) {
+    ok = f.seek(0) && ConformedAudio::WriteHeader(&f, sample_rate_, written);
+  }
+
+  f.close();
+
+  if (!ok || cancelled()) {
+    QFile::remove(partial_filename);
+
+    // Cancelling isn't a failure
+    return ok;
+  }
+
+  QFile::remove(filename_);
+
+  return QFile::rename(partial_filename, filename_);
+}
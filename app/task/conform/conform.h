@@ -0,0 +1,80 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef CONFORMTASK_H
+#define CONFORMTASK_H
+
+struct SwrContext;
+
+#include <QFile>
+#include <QVector>
+
+#include "project/item/footage/stream.h"
+#include "task/task.h"
+
+/**
+ * @brief A background task for decoding an audio stream into ConformedAudio at a sequence's sample rate
+ *
+ * The stream is decoded once from start to finish, reduced to stereo, resampled, and written to the file
+ * ConformedAudio::GetFilename() gives for it. AudioEngine decodes the stream itself until the file exists.
+ *
+ * AudioEngine::ConformStreams() creates these for the streams used in a sequence.
+ */
+class ConformTask : public Task
+{
+  Q_OBJECT
+public:
+  ConformTask(StreamPtr stream, int sample_rate);
+
+  virtual ~ConformTask() override;
+
+  virtual bool Action() override;
+
+  /**
+   * @brief Returns TRUE if a ConformTask for this file exists and hasn't finished yet
+   */
+  static bool IsQueued(const QString& filename);
+
+private:
+  /**
+   * @brief Decode the stream and write the conformed file
+   *
+   * @return
+   *
+   * TRUE on success or if the task was cancelled, FALSE on failure.
+   */
+  bool Conform();
+
+  /**
+   * @brief Resample `in_count` stereo samples and append the result to `file`
+   *
+   * Passing nullptr for `in` flushes the samples the resampler is still holding.
+   */
+  static bool WriteResampled(SwrContext* resampler, QFile* file, const float* in, int in_count,
+                             QVector<float>* buffer, int64_t* written);
+
+  StreamPtr stream_;
+
+  int sample_rate_;
+
+  QString filename_;
+};
+
+#endif // CONFORMTASK_H
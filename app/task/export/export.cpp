@@ -0,0 +1,703 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "export.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QQueue>
+#include <QtMath>
+#include <functional>
+
+#include "config/config.h"
+#include "config/performanceprofile.h"
+#include "node/block/clip/clip.h"
+#include "node/input/media/media.h"
+#include "node/output/timeline/timeline.h"
+#include "node/output/track/track.h"
+
+/**
+ * @brief A thread that runs one of ExportTask's stage loops
+ */
+class ExportTask::StageThread : public QThread
+{
+public:
+  StageThread(const std::function<void()>& loop) :
+    loop_(loop)
+  {
+  }
+
+protected:
+  virtual void run() override
+  {
+    loop_();
+  }
+
+private:
+  std::function<void()> loop_;
+};
+
+ExportTask::ExportTask(RendererProcessor *renderer, const ExportParams &params) :
+  ExportTask(renderer, QVector<ExportParams>({params}))
+{
+}
+
+ExportTask::ExportTask(RendererProcessor *renderer, const QVector<ExportParams> &targets) :
+  renderer_(renderer),
+  output_(nullptr),
+  params_(targets.first()),
+  share_ctx_(nullptr),
+  parent_(nullptr),
+  render_threads_(olive::performance_profile.values().render_threads),
+  width_(0),
+  height_(0),
+  divider_(1),
+  format_(olive::PIX_FMT_RGBA16F), // FIXME: Make this configurable
+  mode_(olive::RenderMode::kOnline),
+  readback_queue_(kExportQueueSize),
+  failed_(false),
+  rendered_frames_(0)
+{
+  // Render at the largest target's size, the others are scaled down from it
+  foreach (const ExportParams& target, targets) {
+    if (static_cast<int64_t>(target.width) * target.height > static_cast<int64_t>(params_.width) * params_.height) {
+      params_.width = target.width;
+      params_.height = target.height;
+    }
+
+    ExportParams target_params = target;
+
+    // The range and frame rate are shared by every target
+    target_params.timebase = params_.timebase;
+    target_params.start = params_.start;
+    target_params.end = params_.end;
+
+    targets_.push_back(std::unique_ptr<Target>(new Target(target_params)));
+  }
+
+  width_ = params_.width;
+  height_ = params_.height;
+
+  if (targets_.size() > 1) {
+    set_text(tr("Exporting \"%1\" and %n more", nullptr, static_cast<int>(targets_.size() - 1))
+             .arg(QFileInfo(params_.filename).fileName()));
+  } else {
+    set_text(tr("Exporting \"%1\"").arg(QFileInfo(params_.filename).fileName()));
+  }
+
+  // The user is waiting on an export, so it goes ahead of background work like proxies and waveforms
+  set_priority(1);
+}
+
+bool ExportTask::Prologue()
+{
+  output_ = renderer_->texture_input()->get_connected_output();
+
+  if (output_ == nullptr) {
+    set_error(tr("Nothing to export"));
+    return false;
+  }
+
+  // Export the whole sequence if no range was given
+  if (params_.end <= params_.start) {
+    params_.start = 0;
+    params_.end = renderer_->length_input()->get_value(0).toRational();
+
+    for (const std::unique_ptr<Target>& target : targets_) {
+      target->params.start = params_.start;
+      target->params.end = params_.end;
+    }
+  }
+
+  if (params_.end <= params_.start || params_.timebase.isNull()) {
+    set_error(tr("Nothing to export"));
+    return false;
+  }
+
+  // Share with the renderer so that textures already in the nodes' caches are usable from our contexts
+  share_ctx_ = renderer_->ShareContext();
+
+  if (share_ctx_ == nullptr) {
+    set_error(tr("Failed to create an OpenGL context for exporting"));
+    return false;
+  }
+
+  // The graph can only be walked safely here in the main thread, the source itself is checked in Action()
+  if (params_.segment || targets_.size() > 1 || !FindPassthroughSource()) {
+    passthrough_.filename.clear();
+  }
+
+  // Chunks would each render every frame of their range once per target, which is what several targets avoid
+  if (!params_.segment && targets_.size() == 1) {
+    int chunk_count = ChooseChunkCount();
+
+    if (chunk_count > 1 && !CreateChunks(chunk_count)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ExportTask::Action()
+{
+  if (!passthrough_.filename.isEmpty() && Remux()) {
+    return !failed_;
+  }
+
+  if (!chunks_.empty()) {
+    return RenderChunks();
+  }
+
+  return Render();
+}
+
+QVector<QRect> ExportTask::ChooseTiles() const
+{
+  if (width_ <= kExportMaximumTileSize && height_ <= kExportMaximumTileSize) {
+    return QVector<QRect>();
+  }
+
+  // Split evenly rather than leaving a sliver at the edge
+  int columns = (width_ + kExportMaximumTileSize - 1) / kExportMaximumTileSize;
+  int rows = (height_ + kExportMaximumTileSize - 1) / kExportMaximumTileSize;
+  int tile_width = (width_ + columns - 1) / columns;
+  int tile_height = (height_ + rows - 1) / rows;
+
+  QVector<QRect> tiles;
+
+  for (int y=0;y<height_;y+=tile_height) {
+    for (int x=0;x<width_;x+=tile_width) {
+      tiles.append(QRect(x, y, qMin(tile_width, width_ - x), qMin(tile_height, height_ - y)));
+    }
+  }
+
+  return tiles;
+}
+
+int64_t ExportTask::FrameCount() const
+{
+  return qCeil(((params_.end - params_.start) / params_.timebase).toDouble());
+}
+
+bool ExportTask::Stopped()
+{
+  return cancelled() || (parent_ != nullptr && (parent_->cancelled() || parent_->failed_));
+}
+
+int ExportTask::ChooseChunkCount() const
+{
+  int count = params_.chunks;
+
+  if (count == 0) {
+    // Chunks of inter-frame codecs each start a new GOP and can't reference each other, so only chunk them on request
+    const AVCodecDescriptor* desc = avcodec_descriptor_get(params_.codec);
+
+    if (desc == nullptr || !(desc->props & AV_CODEC_PROP_INTRA_ONLY)) {
+      return 1;
+    }
+
+    count = QThread::idealThreadCount() / kExportThreadsPerChunk;
+  }
+
+  // Short chunks spend more time starting up than encoding
+  int64_t max_count = FrameCount() / kExportMinChunkFrames;
+
+  return static_cast<int>(qMax(Q_INT64_C(1), qMin(max_count, static_cast<int64_t>(count))));
+}
+
+bool ExportTask::CreateChunks(int count)
+{
+  QFileInfo info(params_.filename);
+
+  int64_t frame_count = FrameCount();
+
+  for (int i=0;i<count;i++) {
+    ExportParams chunk_params = params_;
+
+    chunk_params.filename = info.dir().filePath(QStringLiteral(".%1.chunk%2.%3").arg(info.completeBaseName(),
+                                                                                     QString::number(i),
+                                                                                     info.suffix()));
+    chunk_params.start = params_.start + params_.timebase * rational(frame_count * i / count);
+    chunk_params.end = (i == count - 1)
+        ? params_.end
+        : params_.start + params_.timebase * rational(frame_count * (i + 1) / count);
+    chunk_params.chunks = 1;
+    chunk_params.segment = true;
+
+    ExportTask* chunk = new ExportTask(renderer_, chunk_params);
+    chunk->parent_ = this;
+    chunk->render_threads_ = qMax(1, render_threads_ / count);
+
+    chunks_.push_back(std::unique_ptr<ExportTask>(chunk));
+
+    if (!chunk->Prologue()) {
+      set_error(chunk->error());
+      chunks_.clear();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool ExportTask::RenderChunks()
+{
+  std::vector<std::unique_ptr<StageThread>> threads;
+
+  for (const std::unique_ptr<ExportTask>& chunk : chunks_) {
+    threads.push_back(std::unique_ptr<StageThread>(new StageThread(std::bind(&ExportTask::RenderChunk,
+                                                                               chunk.get()))));
+    threads.back()->start();
+  }
+
+  int64_t frame_count = FrameCount();
+
+  for (const std::unique_ptr<StageThread>& thread : threads) {
+    while (!thread->wait(100)) {
+      int64_t rendered_frames = 0;
+
+      for (const std::unique_ptr<ExportTask>& chunk : chunks_) {
+        rendered_frames += chunk->rendered_frames_.load();
+      }
+
+      emit ProgressChanged(static_cast<int>(rendered_frames * 100 / frame_count));
+    }
+  }
+
+  // Report the chunk that failed first rather than the ones it stopped
+  for (const std::unique_ptr<ExportTask>& chunk : chunks_) {
+    if (chunk->failed_) {
+      set_error(chunk->error());
+      break;
+    }
+  }
+
+  if (!failed_ && !cancelled()) {
+    ExportConcatenator concatenator;
+
+    bool result = concatenator.Start(params_.filename, chunks_.front()->params_.filename);
+
+    for (size_t i=0;i<chunks_.size() && result;i++) {
+      result = concatenator.Append(chunks_.at(i)->params_.filename, chunks_.at(i)->params_.start - params_.start);
+    }
+
+    if (result) {
+      result = concatenator.Finish();
+    }
+
+    if (!result) {
+      failed_ = true;
+      set_error(concatenator.error());
+    } else {
+      qInfo() << "Joined" << chunks_.size() << "chunks into" << params_.filename;
+    }
+
+    concatenator.CleanUp();
+  }
+
+  for (const std::unique_ptr<ExportTask>& chunk : chunks_) {
+    QFile::remove(chunk->params_.filename);
+  }
+
+  return !failed_;
+}
+
+void ExportTask::RenderChunk()
+{
+  if (!Render()) {
+    failed_ = true;
+
+    // Stop the other chunks too
+    parent_->failed_ = true;
+  }
+}
+
+bool ExportTask::FindPassthroughSource()
+{
+  Node* output_node = output_->parent();
+
+  // The first frame's plan lists every node it needs
+  NodeExecutionPlan plan = output_node->CachedExecutionPlan(output_, params_.start);
+
+  ClipBlock* clip = nullptr;
+  MediaInput* media = nullptr;
+  rational media_start;
+
+  foreach (const NodeDependency& step, plan.steps()) {
+    Node* node = step.node()->parent();
+
+    if (dynamic_cast<TimelineOutput*>(node) != nullptr || dynamic_cast<TrackOutput*>(node) != nullptr) {
+      // These pass a single layer through untouched
+      continue;
+    }
+
+    if (dynamic_cast<ClipBlock*>(node) != nullptr && (clip == nullptr || clip == node)) {
+      clip = static_cast<ClipBlock*>(node);
+    } else if (dynamic_cast<MediaInput*>(node) != nullptr && (media == nullptr || media == node)) {
+      media = static_cast<MediaInput*>(node);
+      media_start = step.time();
+    } else {
+      // Anything else (an effect, a second clip) changes the pixels
+      return false;
+    }
+  }
+
+  if (clip == nullptr || media == nullptr) {
+    return false;
+  }
+
+  // The clip has to cover the whole range with nothing showing on any other track
+  if (clip->in() > params_.start || clip->out() < params_.end) {
+    return false;
+  }
+
+  foreach (Node* dep, output_node->GetDependencies()) {
+    TrackOutput* track = dynamic_cast<TrackOutput*>(dep);
+
+    if (track == nullptr) {
+      continue;
+    }
+
+    for (Block* b=track->BlockAtTime(params_.start);b!=nullptr && b!=track && b->in()<params_.end;b=b->next()) {
+      if (b != clip && b->type() == Block::kClip) {
+        return false;
+      }
+    }
+  }
+
+  if (media->matrix_input()->IsConnected()
+      || !media->matrix_input()->get_value(params_.start).toMatrix().isIdentity()) {
+    return false;
+  }
+
+  StreamPtr stream = media->GetStream();
+
+  if (stream == nullptr
+      || stream->type() != Stream::kVideo
+      || stream->footage()->decoder() != QStringLiteral("ffmpeg")) {
+    return false;
+  }
+
+  passthrough_.filename = stream->footage()->filename();
+  passthrough_.stream_index = stream->index();
+  passthrough_.start = media_start;
+  passthrough_.end = media_start + (params_.end - params_.start);
+
+  return true;
+}
+
+bool ExportTask::Remux()
+{
+  ExportRemuxer remuxer;
+
+  if (!remuxer.Open(passthrough_.filename, passthrough_.stream_index, params_, passthrough_.start, passthrough_.end)) {
+    qInfo() << "Rendering export rather than copying" << passthrough_.filename << "-" << remuxer.reason();
+    return false;
+  }
+
+  bool result = remuxer.Start();
+
+  while (result && !cancelled() && remuxer.CopyPacket()) {
+    emit ProgressChanged(remuxer.progress());
+  }
+
+  if (result && !cancelled()) {
+    result = remuxer.error().isEmpty() && remuxer.Finish();
+  }
+
+  if (!result) {
+    failed_ = true;
+    set_error(remuxer.error());
+  } else if (!cancelled()) {
+    qInfo() << "Exported" << params_.filename << "by copying" << passthrough_.filename;
+  }
+
+  remuxer.CleanUp();
+
+  return true;
+}
+
+bool ExportTask::Render()
+{
+  for (const std::unique_ptr<Target>& target : targets_) {
+    if (!target->encoder.Open(target->params)) {
+      set_error(target->encoder.error());
+
+      for (const std::unique_ptr<Target>& t : targets_) {
+        t->encoder.CleanUp();
+      }
+
+      return false;
+    }
+  }
+
+  int64_t frame_count = FrameCount();
+
+  scheduler_.Start(share_ctx_, width_, height_, divider_, format_, mode_, render_threads_);
+
+  // Every target's convert stage is fed from the one readback stage
+  QVector<ExportQueue<ExportPixels>*> convert_queues;
+
+  for (const std::unique_ptr<Target>& target : targets_) {
+    convert_queues.append(&target->convert_queue);
+  }
+
+  ExportReadbackThread readback_thread(share_ctx_,
+                                       width_,
+                                       height_,
+                                       divider_,
+                                       format_,
+                                       mode_,
+                                       &readback_queue_,
+                                       convert_queues,
+                                       &readback_stats_);
+  readback_thread.StartThread(QThread::HighPriority);
+
+  std::vector<std::unique_ptr<StageThread>> stage_threads;
+
+  for (const std::unique_ptr<Target>& target : targets_) {
+    stage_threads.push_back(std::unique_ptr<StageThread>(new StageThread(std::bind(&ExportTask::ConvertLoop,
+                                                                                   this,
+                                                                                   target.get()))));
+    stage_threads.push_back(std::unique_ptr<StageThread>(new StageThread(std::bind(&ExportTask::EncodeLoop,
+                                                                                   this,
+                                                                                   target.get()))));
+  }
+
+  for (const std::unique_ptr<StageThread>& thread : stage_threads) {
+    thread->start();
+  }
+
+  // Frames too large to render at once are rendered a tile at a time, which have to go one after another since
+  // tiles of the same time can't be in flight together (see RendererScheduler::Submit())
+  QVector<QRect> tiles = ChooseTiles();
+  int tile_count = tiles.isEmpty() ? 1 : tiles.size();
+  int max_in_flight = tiles.isEmpty() ? kExportFramesInFlight : 1;
+
+  // Render stage, frames are handed to the readback stage in order while the ones after them are still rendering
+  QQueue<RenderFuture> in_flight;
+
+  int64_t next_tile = 0;
+  int64_t rendered_tiles = 0;
+  int64_t tile_total = frame_count * tile_count;
+  int64_t rendered_frames = 0;
+
+  QElapsedTimer timer;
+
+  while (rendered_tiles < tile_total && !Stopped() && !failed_) {
+    while (next_tile < tile_total && in_flight.size() < max_in_flight) {
+      rational time = params_.start + params_.timebase * rational(next_tile / tile_count);
+      QRect tile = tiles.isEmpty() ? QRect() : tiles.at(static_cast<int>(next_tile % tile_count));
+
+      in_flight.enqueue(scheduler_.Submit(NodeDependency(output_, time), tile));
+
+      next_tile++;
+    }
+
+    timer.start();
+
+    RenderResult result = in_flight.dequeue().get();
+
+    render_stats_.busy_time += timer.nsecsElapsed();
+
+    QRect tile = tiles.isEmpty() ? QRect() : tiles.at(static_cast<int>(rendered_tiles % tile_count));
+
+    if (!readback_queue_.Push({rendered_frames, result.texture, tile, tile_count})) {
+      break;
+    }
+
+    rendered_tiles++;
+
+    if (rendered_tiles % tile_count == 0) {
+      render_stats_.frames++;
+
+      rendered_frames++;
+      rendered_frames_ = static_cast<int>(rendered_frames);
+
+      emit ProgressChanged(static_cast<int>(rendered_frames * 100 / frame_count));
+    }
+  }
+
+  bool succeeded = (rendered_frames == frame_count && !Stopped() && !failed_);
+
+  if (succeeded) {
+    // Let the rest of the stages finish off what's queued
+    readback_queue_.Close();
+  } else {
+    AbortPipeline();
+  }
+
+  readback_thread.wait();
+
+  for (const std::unique_ptr<StageThread>& thread : stage_threads) {
+    thread->wait();
+  }
+
+  // Textures belong to the render threads' contexts, so they have to go before the threads do
+  in_flight.clear();
+  scheduler_.Stop();
+
+  if (succeeded && !failed_) {
+    // Every target is finished off even if one of them fails, so the others are still usable
+    for (const std::unique_ptr<Target>& target : targets_) {
+      if (target->encode_stats.frames != frame_count) {
+        failed_ = true;
+
+        if (error().isEmpty()) {
+          set_error(tr("Failed to read back %1 frame(s)").arg(frame_count - target->encode_stats.frames));
+        }
+      } else if (!target->encoder.Close()) {
+        failed_ = true;
+      }
+    }
+  }
+
+  if (failed_ && error().isEmpty()) {
+    for (const std::unique_ptr<Target>& target : targets_) {
+      if (!target->encoder.error().isEmpty()) {
+        set_error(target->encoder.error());
+        break;
+      }
+    }
+  }
+
+  if (succeeded && !failed_) {
+    ReportStats();
+  }
+
+  for (const std::unique_ptr<Target>& target : targets_) {
+    target->encoder.CleanUp();
+  }
+
+  // Cancelling isn't a failure
+  return !failed_;
+}
+
+void ExportTask::ConvertLoop(Target *target)
+{
+  QElapsedTimer timer;
+
+  ExportPixels frame;
+
+  while (target->convert_queue.Pop(&frame)) {
+    timer.start();
+
+    AVFramePtr converted = target->encoder.Convert(frame.index,
+                                                   frame.width,
+                                                   frame.height,
+                                                   frame.format,
+                                                   frame.pixels);
+
+    target->convert_stats.busy_time += timer.nsecsElapsed();
+
+    if (converted == nullptr) {
+      Fail();
+      break;
+    }
+
+    target->convert_stats.frames++;
+
+    if (!target->encode_queue.Push(converted)) {
+      break;
+    }
+  }
+
+  target->encode_queue.Close();
+}
+
+void ExportTask::EncodeLoop(Target *target)
+{
+  QElapsedTimer timer;
+
+  AVFramePtr frame;
+
+  while (target->encode_queue.Pop(&frame)) {
+    timer.start();
+
+    bool encoded = target->encoder.Encode(frame);
+
+    target->encode_stats.busy_time += timer.nsecsElapsed();
+
+    // The encoder may still reference the frame, but we don't need to
+    frame = nullptr;
+
+    if (!encoded) {
+      Fail();
+      break;
+    }
+
+    target->encode_stats.frames++;
+  }
+}
+
+void ExportTask::Fail()
+{
+  failed_ = true;
+
+  AbortPipeline();
+}
+
+void ExportTask::AbortPipeline()
+{
+  readback_queue_.Abort();
+
+  for (const std::unique_ptr<Target>& target : targets_) {
+    target->convert_queue.Abort();
+    target->encode_queue.Abort();
+  }
+}
+
+void ExportTask::ReportStats()
+{
+  // The render and readback stages are shared, the rest are per target
+  QVector<const ExportStageStats*> stages = {&render_stats_, &readback_stats_};
+  QStringList stage_names = {QStringLiteral("render"), QStringLiteral("readback")};
+
+  for (const std::unique_ptr<Target>& target : targets_) {
+    qInfo() << "Exported" << target->encode_stats.frames << "frames to" << target->params.filename
+            << "with" << target->encoder.encoder_name();
+
+    QString suffix = (targets_.size() > 1)
+        ? QStringLiteral(" (%1)").arg(QFileInfo(target->params.filename).fileName())
+        : QString();
+
+    stages.append(&target->convert_stats);
+    stage_names.append(QStringLiteral("convert") + suffix);
+
+    stages.append(&target->encode_stats);
+    stage_names.append(QStringLiteral("encode") + suffix);
+  }
+
+  int slowest = 0;
+
+  for (int i=0;i<stages.size();i++) {
+    qInfo().noquote() << "  " << stage_names.at(i) << "stage:" << stages.at(i)->FramesPerSecond() << "fps";
+
+    if (stages.at(i)->FramesPerSecond() < stages.at(slowest)->FramesPerSecond()) {
+      slowest = i;
+    }
+  }
+
+  qInfo().noquote() << "  Export was" << stage_names.at(slowest) << "bound";
+}
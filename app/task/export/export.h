@@ -0,0 +1,263 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef EXPORTTASK_H
+#define EXPORTTASK_H
+
+#include <memory>
+#include <QAtomicInt>
+#include <QRect>
+#include <QVector>
+#include <vector>
+
+#include "config/config.h"
+#include "exportconcatenator.h"
+#include "exportencoder.h"
+#include "exportparams.h"
+#include "exportqueue.h"
+#include "exportreadbackthread.h"
+#include "exportremuxer.h"
+#include "node/processor/renderer/renderer.h"
+#include "task/task.h"
+
+/**
+ * @brief A background task that renders a sequence and encodes it to a file
+ *
+ * The export runs as a pipeline with each stage on its own thread and a bounded ExportQueue between each, so every
+ * stage works on a different frame at once and none can run more than a few frames ahead of the next:
+ *
+ * 1. Render: frames are submitted to a RendererScheduler of our own (at the export's resolution, bypassing the cache)
+ *    from Action(), with a few in flight at once.
+ * 2. Readback: ExportReadbackThread reads the textures back asynchronously through pixel buffers.
+ * 3. Convert: the pixels are converted to the encoder's YUV format (see ExportEncoder::Convert()).
+ * 4. Encode: the frames are encoded and written to the file.
+ *
+ * Frames larger than kExportMaximumTileSize are rendered in tiles (see RenderInstance::tile()) that the readback stage
+ * stitches back together.
+ *
+ * The throughput of each stage is logged once the export finishes, along with which one the export was bound by.
+ *
+ * If the whole range shows one unmodified clip already in the export's format (see FindPassthroughSource()), its
+ * packets are copied with an ExportRemuxer instead, so nothing is decoded, rendered or encoded.
+ *
+ * A single encoder can't keep a machine with many cores busy, so the range may also be split into chunks (see
+ * ExportParams::chunks), each exported by a pipeline of its own to a segment file in parallel. The segments are then
+ * joined with an ExportConcatenator, which doesn't re-encode them.
+ *
+ * An export may also have several targets (e.g. a mezzanine master and a review copy), in which case each frame is
+ * only rendered and read back once and then handed to a convert and encode stage of each target's own, which run in
+ * parallel. Frames are rendered at the largest target's size and scaled down for the others. Exports with more than
+ * one target are never chunked or copied.
+ */
+class ExportTask : public Task
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief ExportTask Constructor
+   *
+   * @param renderer
+   *
+   * The sequence's renderer. Whatever is connected to its texture input is exported, and the render threads share its
+   * context.
+   */
+  ExportTask(RendererProcessor* renderer, const ExportParams& params);
+
+  /**
+   * @brief Construct an export that renders once and encodes to every one of targets
+   *
+   * The targets may differ in filename, size, codec and bit rate, but the range and timebase of the first are used for
+   * all of them.
+   */
+  ExportTask(RendererProcessor* renderer, const QVector<ExportParams>& targets);
+
+  virtual bool Prologue() override;
+
+  virtual bool Action() override;
+
+private:
+  class StageThread;
+
+  /**
+   * @brief One output of the export, with the stages that only it needs
+   */
+  struct Target {
+    Target(const ExportParams& p) :
+      params(p),
+      convert_queue(kExportQueueSize),
+      encode_queue(kExportQueueSize)
+    {
+    }
+
+    ExportParams params;
+
+    ExportEncoder encoder;
+
+    ExportQueue<ExportPixels> convert_queue;
+    ExportQueue<AVFramePtr> encode_queue;
+
+    ExportStageStats convert_stats;
+    ExportStageStats encode_stats;
+  };
+
+  /**
+   * @brief Number of frames in the export range
+   */
+  int64_t FrameCount() const;
+
+  /**
+   * @brief Split frames larger than kExportMaximumTileSize into tiles, empty if frames can be rendered whole
+   *
+   * Bounds how much video memory each frame needs however large the export is, and keeps textures within GL's size
+   * limits.
+   */
+  QVector<QRect> ChooseTiles() const;
+
+  /**
+   * @brief Returns whether the export should stop, either because it was cancelled or because another chunk failed
+   */
+  bool Stopped();
+
+  /**
+   * @brief Choose how many chunks to split the export into, 1 for none
+   */
+  int ChooseChunkCount() const;
+
+  /**
+   * @brief Create and prepare an ExportTask for each chunk of the range
+   */
+  bool CreateChunks(int count);
+
+  /**
+   * @brief Export every chunk in parallel and join them into the export's file
+   */
+  bool RenderChunks();
+
+  /**
+   * @brief Main loop of a chunk's thread
+   */
+  void RenderChunk();
+
+  /**
+   * @brief Check whether the export range is a single clip that can be copied rather than rendered
+   *
+   * That's the case if every frame of the range is one ClipBlock showing a MediaInput directly (no effects, an
+   * identity matrix and nothing on any other track). If so, the source and the range in media time are stored in
+   * passthrough_.
+   */
+  bool FindPassthroughSource();
+
+  /**
+   * @brief Copy the passthrough source's packets to the export
+   *
+   * @return
+   *
+   * TRUE if the remux went ahead (check failed_ for whether it succeeded), FALSE if the source turned out unsuitable and
+   * the export has to be rendered instead.
+   */
+  bool Remux();
+
+  /**
+   * @brief Render and encode the export through the pipeline
+   */
+  bool Render();
+
+  /**
+   * @brief Main loop of a target's convert stage
+   */
+  void ConvertLoop(Target* target);
+
+  /**
+   * @brief Main loop of a target's encode stage
+   */
+  void EncodeLoop(Target* target);
+
+  /**
+   * @brief Stop every stage after one of them fails
+   */
+  void Fail();
+
+  /**
+   * @brief Unblock every stage and discard the frames between them
+   */
+  void AbortPipeline();
+
+  /**
+   * @brief Log the throughput of each stage, must be called before the encoders are cleaned up
+   */
+  void ReportStats();
+
+  RendererProcessor* renderer_;
+
+  NodeOutput* output_;
+
+  /**
+   * @brief Settings of the export as a whole, the first target's but sized to the largest target
+   */
+  ExportParams params_;
+
+  QOpenGLContext* share_ctx_;
+
+  /**
+   * @brief The chunked export this is a chunk of, nullptr if it isn't one
+   */
+  ExportTask* parent_;
+
+  std::vector<std::unique_ptr<ExportTask>> chunks_;
+
+  int render_threads_;
+
+  // Referenced by the render threads, so these must outlive them
+  int width_;
+  int height_;
+  int divider_;
+  olive::PixelFormat format_;
+  olive::RenderMode mode_;
+
+  RendererScheduler scheduler_;
+
+  std::vector<std::unique_ptr<Target>> targets_;
+
+  ExportQueue<ExportTexture> readback_queue_;
+
+  ExportStageStats render_stats_;
+  ExportStageStats readback_stats_;
+
+  QAtomicInt failed_;
+
+  /**
+   * @brief Frames handed off by the render stage so far, read by a chunk's parent for progress
+   */
+  QAtomicInt rendered_frames_;
+
+  struct PassthroughSource {
+    QString filename;
+    int stream_index;
+    rational start;
+    rational end;
+  };
+
+  /**
+   * @brief Source to remux instead of rendering, an empty filename if there isn't one
+   */
+  PassthroughSource passthrough_;
+};
+
+#endif // EXPORTTASK_H
@@ -0,0 +1,253 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "exportconcatenator.h"
+
+#include <cstring>
+#include <QCoreApplication>
+#include <QFile>
+
+ExportConcatenator::ExportConcatenator() :
+  out_fmt_ctx_(nullptr),
+  out_stream_(nullptr),
+  pkt_(nullptr),
+  last_dts_(AV_NOPTS_VALUE),
+  finished_(false)
+{
+}
+
+ExportConcatenator::~ExportConcatenator()
+{
+  CleanUp();
+}
+
+bool ExportConcatenator::Start(const QString &filename, const QString &first_segment)
+{
+  int error_code;
+
+  filename_ = filename;
+
+  AVFormatContext* in_fmt_ctx = nullptr;
+  AVStream* in_stream = OpenSegment(first_segment, &in_fmt_ctx);
+
+  if (in_stream == nullptr) {
+    avformat_close_input(&in_fmt_ctx);
+    return false;
+  }
+
+  QByteArray out_filename = filename_.toUtf8();
+
+  error_code = avformat_alloc_output_context2(&out_fmt_ctx_, nullptr, nullptr, out_filename.constData());
+  if (error_code < 0) {
+    avformat_close_input(&in_fmt_ctx);
+    FFmpegError(error_code);
+    return false;
+  }
+
+  out_stream_ = avformat_new_stream(out_fmt_ctx_, nullptr);
+  if (out_stream_ == nullptr) {
+    avformat_close_input(&in_fmt_ctx);
+    error_ = QCoreApplication::translate("ExportConcatenator", "Failed to create video stream");
+    return false;
+  }
+
+  error_code = avcodec_parameters_copy(out_stream_->codecpar, in_stream->codecpar);
+  out_stream_->time_base = in_stream->time_base;
+
+  avformat_close_input(&in_fmt_ctx);
+
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  out_stream_->codecpar->codec_tag = 0;
+
+  error_code = avio_open(&out_fmt_ctx_->pb, out_filename.constData(), AVIO_FLAG_WRITE);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  error_code = avformat_write_header(out_fmt_ctx_, nullptr);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  pkt_ = av_packet_alloc();
+
+  return true;
+}
+
+bool ExportConcatenator::Append(const QString &segment, const rational &offset)
+{
+  AVFormatContext* in_fmt_ctx = nullptr;
+  AVStream* in_stream = OpenSegment(segment, &in_fmt_ctx);
+
+  if (in_stream == nullptr) {
+    avformat_close_input(&in_fmt_ctx);
+    return false;
+  }
+
+  const AVCodecParameters* in_par = in_stream->codecpar;
+  const AVCodecParameters* out_par = out_stream_->codecpar;
+
+  // Packets only decode with the parameters they were encoded with
+  if (in_par->codec_id != out_par->codec_id
+      || in_par->width != out_par->width
+      || in_par->height != out_par->height
+      || in_par->format != out_par->format
+      || in_par->extradata_size != out_par->extradata_size
+      || (in_par->extradata_size > 0
+          && memcmp(in_par->extradata, out_par->extradata, static_cast<size_t>(in_par->extradata_size)) != 0)) {
+    avformat_close_input(&in_fmt_ctx);
+    error_ = QCoreApplication::translate("ExportConcatenator", "Export segments were encoded differently");
+    return false;
+  }
+
+  AVRational out_timebase = out_stream_->time_base;
+  int64_t offset_ts = 0;
+
+  if (!offset.isNull()) {
+    offset_ts = av_rescale_q(offset.numerator(), {1, static_cast<int>(offset.denominator())}, out_timebase);
+  }
+
+  int error_code;
+
+  while ((error_code = av_read_frame(in_fmt_ctx, pkt_)) >= 0) {
+    if (pkt_->stream_index != in_stream->index) {
+      av_packet_unref(pkt_);
+      continue;
+    }
+
+    av_packet_rescale_ts(pkt_, in_stream->time_base, out_timebase);
+
+    if (pkt_->pts != AV_NOPTS_VALUE) {
+      pkt_->pts += offset_ts;
+    }
+    if (pkt_->dts != AV_NOPTS_VALUE) {
+      pkt_->dts += offset_ts;
+
+      if (last_dts_ != AV_NOPTS_VALUE && pkt_->dts <= last_dts_) {
+        av_packet_unref(pkt_);
+        error_ = QCoreApplication::translate("ExportConcatenator", "Export segments overlap");
+        break;
+      }
+
+      last_dts_ = pkt_->dts;
+    }
+
+    pkt_->stream_index = out_stream_->index;
+    pkt_->pos = -1;
+
+    // This takes ownership of the packet's data
+    error_code = av_interleaved_write_frame(out_fmt_ctx_, pkt_);
+    if (error_code < 0) {
+      FFmpegError(error_code);
+      break;
+    }
+  }
+
+  if (error_code < 0 && error_code != AVERROR_EOF && error_.isEmpty()) {
+    FFmpegError(error_code);
+  }
+
+  avformat_close_input(&in_fmt_ctx);
+
+  return error_.isEmpty();
+}
+
+bool ExportConcatenator::Finish()
+{
+  int error_code = av_write_trailer(out_fmt_ctx_);
+
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  finished_ = true;
+
+  return true;
+}
+
+void ExportConcatenator::CleanUp()
+{
+  av_packet_free(&pkt_);
+
+  if (out_fmt_ctx_ != nullptr) {
+    if (out_fmt_ctx_->pb != nullptr) {
+      avio_closep(&out_fmt_ctx_->pb);
+    }
+
+    avformat_free_context(out_fmt_ctx_);
+    out_fmt_ctx_ = nullptr;
+
+    // An unfinished file isn't playable, don't leave it behind
+    if (!finished_) {
+      QFile::remove(filename_);
+    }
+  }
+
+  out_stream_ = nullptr;
+  last_dts_ = AV_NOPTS_VALUE;
+  finished_ = false;
+}
+
+const QString &ExportConcatenator::error() const
+{
+  return error_;
+}
+
+AVStream *ExportConcatenator::OpenSegment(const QString &segment, AVFormatContext **fmt_ctx)
+{
+  QByteArray segment_filename = segment.toUtf8();
+
+  int error_code = avformat_open_input(fmt_ctx, segment_filename.constData(), nullptr, nullptr);
+
+  if (error_code >= 0) {
+    error_code = avformat_find_stream_info(*fmt_ctx, nullptr);
+  }
+
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return nullptr;
+  }
+
+  int index = av_find_best_stream(*fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+
+  if (index < 0) {
+    error_ = QCoreApplication::translate("ExportConcatenator", "Export segment has no video stream");
+    return nullptr;
+  }
+
+  return (*fmt_ctx)->streams[index];
+}
+
+void ExportConcatenator::FFmpegError(int error_code)
+{
+  char err[1024];
+  av_strerror(error_code, err, 1024);
+
+  error_ = QCoreApplication::translate("ExportConcatenator", "Failed to export %1 - %2 %3").arg(filename_,
+                                                                                             QString::number(error_code),
+                                                                                             err);
+}
@@ -0,0 +1,97 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef EXPORTCONCATENATOR_H
+#define EXPORTCONCATENATOR_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <QString>
+
+#include "common/rational.h"
+
+/**
+ * @brief Joins separately encoded segments of an export into one file without re-encoding them
+ *
+ * Used by ExportTask for chunked exports, where each chunk of the range is encoded to its own segment file in
+ * parallel. Every segment must have been encoded with the same parameters and start on a keyframe (as every segment
+ * from a fresh encoder does), and must not reorder frames so that the timestamps stay in order across the joins.
+ */
+class ExportConcatenator
+{
+public:
+  ExportConcatenator();
+
+  ~ExportConcatenator();
+
+  ExportConcatenator(const ExportConcatenator& other) = delete;
+  ExportConcatenator& operator=(const ExportConcatenator& other) = delete;
+
+  /**
+   * @brief Create the output file with the stream parameters of the first segment
+   */
+  bool Start(const QString& filename, const QString& first_segment);
+
+  /**
+   * @brief Copy all of a segment's packets to the end of the output
+   *
+   * @param offset
+   *
+   * Time in the output that the segment starts at.
+   */
+  bool Append(const QString& segment, const rational& offset);
+
+  /**
+   * @brief Finish the file once every segment has been appended
+   */
+  bool Finish();
+
+  /**
+   * @brief Free everything, deleting the output file if Finish() was never reached
+   */
+  void CleanUp();
+
+  const QString& error() const;
+
+private:
+  /**
+   * @brief Open a segment and find its video stream
+   */
+  AVStream* OpenSegment(const QString& segment, AVFormatContext** fmt_ctx);
+
+  void FFmpegError(int error_code);
+
+  QString filename_;
+
+  AVFormatContext* out_fmt_ctx_;
+  AVStream* out_stream_;
+
+  AVPacket* pkt_;
+
+  int64_t last_dts_;
+
+  bool finished_;
+
+  QString error_;
+};
+
+#endif // EXPORTCONCATENATOR_H
@@ -0,0 +1,454 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "exportencoder.h"
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include <QDebug>
+#include <QFile>
+
+#include "common/define.h"
+#include "render/pixelconversion.h"
+#include "render/pixelservice.h"
+
+/**
+ * @brief Suffixes of FFmpeg's hardware encoders, appended to a codec's name (e.g. "h264_nvenc")
+ */
+const char* const kHardwareEncoderSuffixes[] = {"nvenc", "qsv", "videotoolbox", "amf"};
+
+static void FreeFrame(AVFrame* frame)
+{
+  av_frame_free(&frame);
+}
+
+ExportEncoder::ExportEncoder() :
+  fmt_ctx_(nullptr),
+  stream_(nullptr),
+  enc_ctx_(nullptr),
+  pkt_(nullptr),
+  closed_(false),
+  scale_ctx_(nullptr)
+{
+}
+
+ExportEncoder::~ExportEncoder()
+{
+  CleanUp();
+}
+
+bool ExportEncoder::Open(const ExportParams &params)
+{
+  int error_code;
+
+  filename_ = params.filename;
+
+  QByteArray filename = filename_.toUtf8();
+
+  error_code = avformat_alloc_output_context2(&fmt_ctx_, nullptr, nullptr, filename.constData());
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  QList<const AVCodec*> candidates = GetEncoderCandidates(params.codec, params.hardware);
+
+  foreach (const AVCodec* encoder, candidates) {
+    if (OpenEncoder(encoder, params)) {
+      break;
+    }
+  }
+
+  if (enc_ctx_ == nullptr) {
+    SetError(QCoreApplication::translate("ExportEncoder", "Failed to open an encoder for %1")
+             .arg(avcodec_get_name(params.codec)));
+    return false;
+  }
+
+  stream_ = avformat_new_stream(fmt_ctx_, nullptr);
+  if (stream_ == nullptr) {
+    SetError(QCoreApplication::translate("ExportEncoder", "Failed to create video stream"));
+    return false;
+  }
+
+  error_code = avcodec_parameters_from_context(stream_->codecpar, enc_ctx_);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  stream_->time_base = enc_ctx_->time_base;
+
+  error_code = avio_open(&fmt_ctx_->pb, filename.constData(), AVIO_FLAG_WRITE);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  error_code = avformat_write_header(fmt_ctx_, nullptr);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  pkt_ = av_packet_alloc();
+
+  return true;
+}
+
+AVFramePtr ExportEncoder::Convert(const int64_t &index,
+                                  int width,
+                                  int height,
+                                  const olive::PixelFormat &format,
+                                  const QByteArray &pixels)
+{
+  const uint8_t* src_data = reinterpret_cast<const uint8_t*>(pixels.constData());
+  AVPixelFormat src_format;
+  int src_bytes_per_pixel = PixelService::BytesPerPixel(format);
+
+  switch (format) {
+  case olive::PIX_FMT_RGBA8:
+    src_format = AV_PIX_FMT_RGBA;
+    break;
+  case olive::PIX_FMT_RGBA16U:
+    src_format = AV_PIX_FMT_RGBA64;
+    break;
+  case olive::PIX_FMT_RGBA16F:
+  case olive::PIX_FMT_RGBA32F:
+  case olive::PIX_FMT_RGB10A2:
+  {
+    // Older versions of swscale can't read float or packed 10-bit formats, convert them to 16-bit integer first
+    int count = width * height * kRGBAChannels;
+
+    float_buffer_.resize(count);
+    olive::pixel::ToFloat(pixels.constData(), format, float_buffer_.data(), count);
+
+    converted_buffer_.resize(count * PixelService::BytesPerChannel(olive::PIX_FMT_RGBA16U));
+    olive::pixel::FromFloat(float_buffer_.constData(), converted_buffer_.data(), olive::PIX_FMT_RGBA16U, count);
+
+    src_data = reinterpret_cast<const uint8_t*>(converted_buffer_.constData());
+    src_format = AV_PIX_FMT_RGBA64;
+    src_bytes_per_pixel = PixelService::BytesPerPixel(olive::PIX_FMT_RGBA16U);
+    break;
+  }
+  default:
+    SetError(QCoreApplication::translate("ExportEncoder", "Unsupported pixel format for export"));
+    return nullptr;
+  }
+
+  SwsContext* last_ctx = scale_ctx_;
+
+  // Frames are normally the export's size, swscale also scales any that aren't
+  scale_ctx_ = sws_getCachedContext(scale_ctx_,
+                                    width,
+                                    height,
+                                    src_format,
+                                    enc_ctx_->width,
+                                    enc_ctx_->height,
+                                    enc_ctx_->pix_fmt,
+                                    SWS_BICUBIC,
+                                    nullptr,
+                                    nullptr,
+                                    nullptr);
+
+  if (scale_ctx_ == nullptr) {
+    SetError(QCoreApplication::translate("ExportEncoder", "Failed to create export scaling context"));
+    return nullptr;
+  }
+
+  if (scale_ctx_ != last_ctx) {
+    // Match the matrix the stream is tagged with (the source coefficients are ignored for RGB)
+    int colorspace = (enc_ctx_->colorspace == AVCOL_SPC_BT709) ? SWS_CS_ITU709 : SWS_CS_ITU601;
+
+    sws_setColorspaceDetails(scale_ctx_,
+                             sws_getCoefficients(SWS_CS_DEFAULT),
+                             1,
+                             sws_getCoefficients(colorspace),
+                             0,
+                             0,
+                             1 << 16,
+                             1 << 16);
+  }
+
+  AVFrame* frame = av_frame_alloc();
+  frame->width = enc_ctx_->width;
+  frame->height = enc_ctx_->height;
+  frame->format = enc_ctx_->pix_fmt;
+
+  int error_code = av_frame_get_buffer(frame, 0);
+  if (error_code < 0) {
+    av_frame_free(&frame);
+    FFmpegError(error_code);
+    return nullptr;
+  }
+
+  const uint8_t* src_planes[] = {src_data};
+  int src_linesizes[] = {width * src_bytes_per_pixel};
+
+  sws_scale(scale_ctx_,
+            src_planes,
+            src_linesizes,
+            0,
+            height,
+            frame->data,
+            frame->linesize);
+
+  frame->pts = index;
+
+  return AVFramePtr(frame, FreeFrame);
+}
+
+bool ExportEncoder::Encode(AVFramePtr frame)
+{
+  int error_code = avcodec_send_frame(enc_ctx_, frame.get());
+
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  return WritePackets();
+}
+
+bool ExportEncoder::Close()
+{
+  if (!Encode(nullptr)) {
+    return false;
+  }
+
+  int error_code = av_write_trailer(fmt_ctx_);
+
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  closed_ = true;
+
+  return true;
+}
+
+void ExportEncoder::CleanUp()
+{
+  sws_freeContext(scale_ctx_);
+  scale_ctx_ = nullptr;
+
+  av_packet_free(&pkt_);
+
+  avcodec_free_context(&enc_ctx_);
+
+  if (fmt_ctx_ != nullptr) {
+    if (fmt_ctx_->pb != nullptr) {
+      avio_closep(&fmt_ctx_->pb);
+    }
+
+    avformat_free_context(fmt_ctx_);
+    fmt_ctx_ = nullptr;
+
+    // An unfinished file isn't playable, don't leave it behind
+    if (!closed_) {
+      QFile::remove(filename_);
+    }
+  }
+
+  stream_ = nullptr;
+  closed_ = false;
+}
+
+QString ExportEncoder::encoder_name() const
+{
+  if (enc_ctx_ == nullptr) {
+    return QString();
+  }
+
+  return QString::fromUtf8(enc_ctx_->codec->name);
+}
+
+QString ExportEncoder::error()
+{
+  QMutexLocker locker(&error_lock_);
+
+  return error_;
+}
+
+QList<const AVCodec *> ExportEncoder::GetEncoderCandidates(AVCodecID codec, bool hardware)
+{
+  QList<const AVCodec*> candidates;
+
+  if (hardware) {
+    QByteArray codec_name = avcodec_get_name(codec);
+
+    for (const char* suffix : kHardwareEncoderSuffixes) {
+      QByteArray encoder_name = codec_name;
+      encoder_name.append('_');
+      encoder_name.append(suffix);
+
+      const AVCodec* encoder = avcodec_find_encoder_by_name(encoder_name.constData());
+
+      if (encoder != nullptr) {
+        candidates.append(encoder);
+      }
+    }
+  }
+
+  const AVCodec* encoder = avcodec_find_encoder(codec);
+
+  if (encoder != nullptr && !candidates.contains(encoder)) {
+    candidates.append(encoder);
+  }
+
+  return candidates;
+}
+
+AVPixelFormat ExportEncoder::GetEncoderPixelFormat(const AVCodec *encoder)
+{
+  if (encoder->pix_fmts == nullptr) {
+    return AV_PIX_FMT_YUV420P;
+  }
+
+  AVPixelFormat first_software = AV_PIX_FMT_NONE;
+
+  for (const AVPixelFormat* f=encoder->pix_fmts;*f!=AV_PIX_FMT_NONE;f++) {
+    const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(*f);
+
+    if (desc == nullptr || (desc->flags & AV_PIX_FMT_FLAG_HWACCEL)) {
+      continue;
+    }
+
+    if (!(desc->flags & AV_PIX_FMT_FLAG_RGB)) {
+      return *f;
+    }
+
+    if (first_software == AV_PIX_FMT_NONE) {
+      first_software = *f;
+    }
+  }
+
+  return first_software;
+}
+
+bool ExportEncoder::OpenEncoder(const AVCodec *encoder, const ExportParams &params)
+{
+  AVPixelFormat pix_fmt = GetEncoderPixelFormat(encoder);
+
+  if (pix_fmt == AV_PIX_FMT_NONE) {
+    return false;
+  }
+
+  AVCodecContext* ctx = avcodec_alloc_context3(encoder);
+
+  ctx->width = params.width;
+  ctx->height = params.height;
+  ctx->sample_aspect_ratio = {1, 1};
+  ctx->pix_fmt = pix_fmt;
+  ctx->time_base = {static_cast<int>(params.timebase.numerator()), static_cast<int>(params.timebase.denominator())};
+  ctx->framerate = {ctx->time_base.den, ctx->time_base.num};
+
+  if (params.bit_rate > 0) {
+    ctx->bit_rate = params.bit_rate;
+  }
+
+  // Without B-frames, decode order matches presentation order so timestamps stay in order across a join
+  if (params.segment) {
+    ctx->max_b_frames = 0;
+  }
+
+  // Tag the stream with the matrix Convert() uses
+  if (params.height >= 720) {
+    ctx->colorspace = AVCOL_SPC_BT709;
+    ctx->color_primaries = AVCOL_PRI_BT709;
+    ctx->color_trc = AVCOL_TRC_BT709;
+  } else {
+    ctx->colorspace = AVCOL_SPC_SMPTE170M;
+    ctx->color_primaries = AVCOL_PRI_SMPTE170M;
+    ctx->color_trc = AVCOL_TRC_SMPTE170M;
+  }
+  ctx->color_range = AVCOL_RANGE_MPEG;
+
+  if (fmt_ctx_->oformat->flags & AVFMT_GLOBALHEADER) {
+    ctx->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+
+  AVDictionary* opts = nullptr;
+  av_dict_set(&opts, "threads", "auto", 0);
+
+  int error_code = avcodec_open2(ctx, encoder, &opts);
+  av_dict_free(&opts);
+
+  if (error_code < 0) {
+    // Hardware encoders fail here if the system doesn't have the hardware, the caller will try the next one
+    char err[1024];
+    av_strerror(error_code, err, 1024);
+    qInfo() << "Failed to open encoder" << encoder->name << "-" << err;
+
+    avcodec_free_context(&ctx);
+    return false;
+  }
+
+  enc_ctx_ = ctx;
+
+  return true;
+}
+
+bool ExportEncoder::WritePackets()
+{
+  int error_code;
+
+  while ((error_code = avcodec_receive_packet(enc_ctx_, pkt_)) >= 0) {
+    av_packet_rescale_ts(pkt_, enc_ctx_->time_base, stream_->time_base);
+    pkt_->stream_index = stream_->index;
+
+    // This takes ownership of the packet's data
+    error_code = av_interleaved_write_frame(fmt_ctx_, pkt_);
+    if (error_code < 0) {
+      FFmpegError(error_code);
+      return false;
+    }
+  }
+
+  if (error_code != AVERROR(EAGAIN) && error_code != AVERROR_EOF) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  return true;
+}
+
+void ExportEncoder::FFmpegError(int error_code)
+{
+  char err[1024];
+  av_strerror(error_code, err, 1024);
+
+  SetError(QCoreApplication::translate("ExportEncoder", "Failed to export %1 - %2 %3").arg(filename_,
+                                                                                         QString::number(error_code),
+                                                                                         err));
+}
+
+void ExportEncoder::SetError(const QString &s)
+{
+  QMutexLocker locker(&error_lock_);
+
+  // Keep the first error, later ones are usually a consequence of it
+  if (error_.isEmpty()) {
+    error_ = s;
+  }
+}
@@ -0,0 +1,145 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef EXPORTENCODER_H
+#define EXPORTENCODER_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+#include <memory>
+#include <QByteArray>
+#include <QCoreApplication>
+#include <QMutex>
+#include <QVector>
+
+#include "exportparams.h"
+#include "render/pixelformat.h"
+
+using AVFramePtr = std::shared_ptr<AVFrame>;
+
+/**
+ * @brief Converts rendered frames to YUV and encodes them to a file with FFmpeg
+ *
+ * Convert() and Encode() are independent so that ExportTask can run them as separate stages on separate threads: each
+ * may only be called from one thread at a time, but they can be called from different threads at the same time. The
+ * conversion uses swscale's SIMD kernels (and olive::pixel's for float formats, which swscale can't read in every
+ * FFmpeg version we support).
+ *
+ * If hardware encoding is requested, the hardware encoders FFmpeg was built with for the codec are tried in order
+ * before falling back to the software encoder, since any of them may fail to open on a system without the hardware.
+ */
+class ExportEncoder
+{
+public:
+  ExportEncoder();
+
+  ~ExportEncoder();
+
+  ExportEncoder(const ExportEncoder& other) = delete;
+  ExportEncoder& operator=(const ExportEncoder& other) = delete;
+
+  /**
+   * @brief Create the output file and open an encoder for it
+   */
+  bool Open(const ExportParams& params);
+
+  /**
+   * @brief Convert a frame read back from the renderer to the encoder's pixel format and size
+   *
+   * @param index
+   *
+   * The frame's index from the start of the export, used as its timestamp.
+   *
+   * @return
+   *
+   * The converted frame or nullptr on failure.
+   */
+  AVFramePtr Convert(const int64_t& index,
+                     int width,
+                     int height,
+                     const olive::PixelFormat& format,
+                     const QByteArray& pixels);
+
+  /**
+   * @brief Encode a converted frame and write any packets the encoder has ready
+   */
+  bool Encode(AVFramePtr frame);
+
+  /**
+   * @brief Flush the encoder and finish the file
+   */
+  bool Close();
+
+  /**
+   * @brief Free everything, deleting the file if Close() was never reached
+   */
+  void CleanUp();
+
+  /**
+   * @brief Name of the encoder in use (e.g. "h264_nvenc")
+   */
+  QString encoder_name() const;
+
+  QString error();
+
+private:
+  /**
+   * @brief Return the encoders to try for a codec, in order of preference
+   */
+  static QList<const AVCodec*> GetEncoderCandidates(AVCodecID codec, bool hardware);
+
+  /**
+   * @brief Choose the pixel format to encode to from what an encoder supports
+   *
+   * Prefers the encoder's first software YUV format, since encoders list their formats in order of preference and the
+   * hardware formats require frames already on the device.
+   */
+  static AVPixelFormat GetEncoderPixelFormat(const AVCodec* encoder);
+
+  bool OpenEncoder(const AVCodec* encoder, const ExportParams& params);
+
+  bool WritePackets();
+
+  void FFmpegError(int error_code);
+
+  void SetError(const QString& s);
+
+  QString filename_;
+
+  AVFormatContext* fmt_ctx_;
+  AVStream* stream_;
+  AVCodecContext* enc_ctx_;
+  AVPacket* pkt_;
+
+  bool closed_;
+
+  // Only touched by Convert()
+  SwsContext* scale_ctx_;
+  QVector<float> float_buffer_;
+  QByteArray converted_buffer_;
+
+  QString error_;
+  QMutex error_lock_;
+};
+
+#endif // EXPORTENCODER_H
@@ -0,0 +1,82 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef EXPORTPARAMS_H
+#define EXPORTPARAMS_H
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <QString>
+
+#include "common/rational.h"
+
+/**
+ * @brief Settings for exporting a sequence with ExportTask
+ */
+struct ExportParams {
+  ExportParams() :
+    width(0),
+    height(0),
+    codec(AV_CODEC_ID_H264),
+    bit_rate(0),
+    hardware(true),
+    start(0),
+    end(0),
+    chunks(0),
+    segment(false)
+  {
+  }
+
+  /// File to export to, its extension chooses the container format
+  QString filename;
+
+  int width;
+  int height;
+
+  /// Duration of one frame (i.e. the inverse of the frame rate)
+  rational timebase;
+
+  AVCodecID codec;
+
+  /// Target bit rate in bits per second, or 0 to leave it to the encoder
+  int64_t bit_rate;
+
+  /// TRUE to try hardware encoders for the codec (e.g. NVENC, QSV, VideoToolbox) before the software one
+  bool hardware;
+
+  /// Range of the sequence to export
+  rational start;
+  rational end;
+
+  /**
+   * @brief Number of chunks to split the range into and encode in parallel
+   *
+   * 0 chooses automatically, which only chunks intra-only codecs since they compress just as well in chunks. 1 never
+   * chunks.
+   */
+  int chunks;
+
+  /// TRUE if this is one chunk of a chunked export, which mustn't reorder frames so the chunks can be joined
+  bool segment;
+};
+
+#endif // EXPORTPARAMS_H
@@ -0,0 +1,196 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef EXPORTQUEUE_H
+#define EXPORTQUEUE_H
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QQueue>
+#include <QWaitCondition>
+#include <stdint.h>
+
+/**
+ * @brief Throughput of one stage of an export
+ *
+ * Only the time a stage spends working is counted, not the time it spends blocked on the queues either side of it, so
+ * the stage with the lowest rate is the one holding the export back.
+ */
+struct ExportStageStats {
+  ExportStageStats() :
+    frames(0),
+    busy_time(0)
+  {
+  }
+
+  /**
+   * @brief Frames per second the stage could sustain on its own
+   */
+  double FramesPerSecond() const
+  {
+    return (busy_time > 0) ? static_cast<double>(frames) * 1000000000.0 / static_cast<double>(busy_time) : 0.0;
+  }
+
+  int64_t frames;
+
+  /// Nanoseconds spent working
+  int64_t busy_time;
+};
+
+/**
+ * @brief A bounded, blocking queue used to hand frames between the stages of an export
+ *
+ * Push() blocks while the queue is full and Pop() blocks while it's empty, so a stage can never run more than
+ * `capacity` frames ahead of the next one and memory use stays flat however fast the stages are relative to each
+ * other.
+ *
+ * The producer calls Close() once it's done, after which consumers drain what's left and Pop() returns FALSE. Abort()
+ * also discards anything still queued, to unblock both sides when an export is cancelled or fails.
+ */
+template<typename T>
+class ExportQueue
+{
+public:
+  ExportQueue(int capacity) :
+    capacity_(capacity),
+    closed_(false)
+  {
+  }
+
+  /**
+   * @brief Add a value, waiting for space if the queue is full
+   *
+   * @return
+   *
+   * FALSE if the queue was closed, in which case the value is discarded.
+   */
+  bool Push(const T& value)
+  {
+    QMutexLocker locker(&lock_);
+
+    while (queue_.size() >= capacity_ && !closed_) {
+      not_full_.wait(&lock_);
+    }
+
+    if (closed_) {
+      return false;
+    }
+
+    queue_.enqueue(value);
+
+    not_empty_.wakeOne();
+
+    return true;
+  }
+
+  /**
+   * @brief Take the oldest value, waiting for one if the queue is empty
+   *
+   * @return
+   *
+   * FALSE if the queue has been closed and there's nothing left to take.
+   */
+  bool Pop(T* value)
+  {
+    QMutexLocker locker(&lock_);
+
+    while (queue_.isEmpty() && !closed_) {
+      not_empty_.wait(&lock_);
+    }
+
+    return TakeFirst(value);
+  }
+
+  /**
+   * @brief Take the oldest value if there is one without waiting
+   */
+  bool TryPop(T* value)
+  {
+    QMutexLocker locker(&lock_);
+
+    return TakeFirst(value);
+  }
+
+  /**
+   * @brief Signal that nothing else will be pushed
+   */
+  void Close()
+  {
+    QMutexLocker locker(&lock_);
+
+    closed_ = true;
+
+    not_empty_.wakeAll();
+    not_full_.wakeAll();
+  }
+
+  /**
+   * @brief Close the queue and discard everything still in it
+   */
+  void Abort()
+  {
+    QMutexLocker locker(&lock_);
+
+    closed_ = true;
+    queue_.clear();
+
+    not_empty_.wakeAll();
+    not_full_.wakeAll();
+  }
+
+  bool IsClosed()
+  {
+    QMutexLocker locker(&lock_);
+
+    return closed_;
+  }
+
+private:
+  /**
+   * @brief Take the oldest value, the lock must be held
+   */
+  bool TakeFirst(T* value)
+  {
+    if (queue_.isEmpty()) {
+      return false;
+    }
+
+    *value = queue_.dequeue();
+
+    not_full_.wakeOne();
+
+    return true;
+  }
+
+  int capacity_;
+
+  bool closed_;
+
+  QQueue<T> queue_;
+
+  QMutex lock_;
+
+  QWaitCondition not_empty_;
+
+  QWaitCondition not_full_;
+
+};
+
+#endif // EXPORTQUEUE_H
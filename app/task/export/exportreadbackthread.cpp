@@ -0,0 +1,207 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "exportreadbackthread.h"
+
+#include <QElapsedTimer>
+
+#include "config/config.h"
+#include "render/pixelservice.h"
+
+ExportReadbackThread::ExportReadbackThread(QOpenGLContext *share_ctx,
+                                           const int &width,
+                                           const int &height,
+                                           const int &divider,
+                                           const olive::PixelFormat &format,
+                                           const olive::RenderMode &mode,
+                                           ExportQueue<ExportTexture> *input,
+                                           const QVector<ExportQueue<ExportPixels>*> &outputs,
+                                           ExportStageStats *stats) :
+  RendererThreadBase(share_ctx, width, height, divider, format, mode),
+  stitched_tiles_(0),
+  stitch_lost_(false),
+  input_(input),
+  outputs_(outputs),
+  stats_(stats)
+{
+}
+
+void ExportReadbackThread::Cancel()
+{
+  input_->Abort();
+
+  foreach (ExportQueue<ExportPixels>* output, outputs_) {
+    output->Abort();
+  }
+
+  wait();
+}
+
+void ExportReadbackThread::ProcessLoop()
+{
+  DownloadRing ring(render_instance()->context(), kDownloadBufferCount);
+
+  QElapsedTimer timer;
+
+  ExportTexture entry;
+
+  while (true) {
+    // Only block on the input if there's nothing in flight to finish off in the meantime
+    bool has_entry = ring.IsEmpty() ? input_->Pop(&entry) : input_->TryPop(&entry);
+
+    if (!has_entry && ring.IsEmpty()) {
+      // The input was closed and everything has been read back
+      break;
+    }
+
+    if (!has_entry) {
+      // Nothing else to start, so wait on the oldest readback
+      FinishReadback(&ring);
+      continue;
+    }
+
+    if (entry.texture == nullptr) {
+      // Nothing was rendered here, the frames before it have to go first to keep them in order
+      while (!ring.IsEmpty()) {
+        FinishReadback(&ring);
+      }
+
+      if (!entry.tile.isNull()) {
+        StitchTile(entry, QByteArray());
+        continue;
+      }
+
+      int width = render_instance()->width();
+      int height = render_instance()->height();
+      olive::PixelFormat format = render_instance()->format();
+
+      Output({entry.index,
+              width,
+              height,
+              format,
+              QByteArray(PixelService::GetBufferSize(format, width, height), 0)});
+      continue;
+    }
+
+    // If every buffer is in use, the oldest has to finish before we can reuse it
+    if (ring.IsFull()) {
+      FinishReadback(&ring);
+    }
+
+    timer.start();
+    ring.Start(entry.texture);
+    stats_->busy_time += timer.nsecsElapsed();
+
+    pending_.append(entry);
+
+    // Pass on any readbacks that have already finished without waiting on the others
+    while (!ring.IsEmpty() && ring.IsOldestReady()) {
+      FinishReadback(&ring);
+    }
+  }
+
+  // Readbacks still in progress (if we were cancelled) are discarded along with the ring
+  pending_.clear();
+
+  foreach (ExportQueue<ExportPixels>* output, outputs_) {
+    output->Close();
+  }
+}
+
+void ExportReadbackThread::Output(const ExportPixels &frame)
+{
+  // Every output gets the frame even if one has been aborted, it's up to ExportTask to stop the others
+  foreach (ExportQueue<ExportPixels>* output, outputs_) {
+    output->Push(frame);
+  }
+}
+
+void ExportReadbackThread::FinishReadback(DownloadRing *ring)
+{
+  ExportTexture entry = pending_.takeFirst();
+
+  QElapsedTimer timer;
+  timer.start();
+
+  QByteArray pixels = ring->Finish();
+
+  stats_->busy_time += timer.nsecsElapsed();
+
+  if (pixels.isEmpty()) {
+    // The frame is lost, ExportTask notices that fewer frames than expected were encoded
+    if (!entry.tile.isNull()) {
+      stitch_lost_ = true;
+      StitchTile(entry, QByteArray());
+    }
+    return;
+  }
+
+  if (!entry.tile.isNull()) {
+    StitchTile(entry, pixels);
+    return;
+  }
+
+  stats_->frames++;
+
+  Output({entry.index,
+          entry.texture->width(),
+          entry.texture->height(),
+          entry.texture->format(),
+          pixels});
+}
+
+void ExportReadbackThread::StitchTile(const ExportTexture &entry, const QByteArray &pixels)
+{
+  int width = render_instance()->frame_width();
+  int height = render_instance()->frame_height();
+  olive::PixelFormat format = render_instance()->format();
+
+  if (stitched_.isEmpty()) {
+    stitched_ = QByteArray(PixelService::GetBufferSize(format, width, height), 0);
+  }
+
+  if (!pixels.isEmpty()) {
+    int bytes_per_pixel = PixelService::BytesPerPixel(format);
+    int tile_row_size = entry.tile.width() * bytes_per_pixel;
+
+    for (int i=0;i<entry.tile.height();i++) {
+      memcpy(stitched_.data() + ((entry.tile.y() + i) * width + entry.tile.x()) * bytes_per_pixel,
+             pixels.constData() + i * tile_row_size,
+             static_cast<size_t>(tile_row_size));
+    }
+  }
+
+  stitched_tiles_++;
+
+  if (stitched_tiles_ < entry.tile_count) {
+    return;
+  }
+
+  // If any tile was lost, so is the frame
+  if (!stitch_lost_) {
+    stats_->frames++;
+
+    Output({entry.index, width, height, format, stitched_});
+  }
+
+  stitched_.clear();
+  stitched_tiles_ = 0;
+  stitch_lost_ = false;
+}
@@ -0,0 +1,136 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef EXPORTREADBACKTHREAD_H
+#define EXPORTREADBACKTHREAD_H
+
+#include <QRect>
+#include <QVector>
+
+#include "exportqueue.h"
+#include "node/processor/renderer/rendererthreadbase.h"
+#include "render/gl/downloadring.h"
+
+/**
+ * @brief A rendered frame waiting to be read back
+ */
+struct ExportTexture {
+  /// Index of the frame from the start of the export
+  int64_t index;
+
+  /// The rendered frame, or nullptr if nothing was rendered at this time (exported as black)
+  RenderTexturePtr texture;
+
+  /// The region of the frame that was rendered (see RenderInstance::tile()), or a null rect for the whole frame
+  QRect tile;
+
+  /// How many tiles the frame is made of, they're passed in one after another
+  int tile_count;
+};
+
+/**
+ * @brief A frame's pixels read back from the GPU
+ */
+struct ExportPixels {
+  int64_t index;
+  int width;
+  int height;
+  olive::PixelFormat format;
+  QByteArray pixels;
+};
+
+/**
+ * @brief The readback stage of ExportTask
+ *
+ * Reads textures back through a DownloadRing so several readbacks are in flight at once, and passes their pixels on in
+ * the order they were rendered. Each frame is passed to every output queue (one per export target), its pixels are
+ * shared between them rather than copied. The output queues are closed once the input queue has been closed and
+ * drained.
+ *
+ * Frames rendered in tiles are stitched back together here, so the rest of the export always sees whole frames.
+ */
+class ExportReadbackThread : public RendererThreadBase
+{
+  Q_OBJECT
+public:
+  ExportReadbackThread(QOpenGLContext* share_ctx,
+                       const int& width,
+                       const int& height,
+                       const int& divider,
+                       const olive::PixelFormat& format,
+                       const olive::RenderMode& mode,
+                       ExportQueue<ExportTexture>* input,
+                       const QVector<ExportQueue<ExportPixels>*>& outputs,
+                       ExportStageStats* stats);
+
+public slots:
+  virtual void Cancel() override;
+
+protected:
+  virtual void ProcessLoop() override;
+
+private:
+  /**
+   * @brief Pass a frame to every output queue
+   */
+  void Output(const ExportPixels& frame);
+
+  /**
+   * @brief Wait for the oldest readback and pass its pixels to the output queue
+   */
+  void FinishReadback(DownloadRing* ring);
+
+  /**
+   * @brief Copy a tile's pixels into the frame being stitched, and pass it on once it has all of its tiles
+   *
+   * @param pixels
+   *
+   * The tile's pixels, or an empty array if nothing was rendered there (left black).
+   */
+  void StitchTile(const ExportTexture& entry, const QByteArray& pixels);
+
+  /**
+   * @brief Frames whose textures are being read back by the ring, in the order they were started
+   *
+   * The textures are kept referenced until they've been read so they can't be reused while the copy is in flight.
+   */
+  QList<ExportTexture> pending_;
+
+  /**
+   * @brief The frame that tiles are being stitched into
+   */
+  QByteArray stitched_;
+
+  int stitched_tiles_;
+
+  /**
+   * @brief Set if a tile of the frame being stitched failed to read back
+   */
+  bool stitch_lost_;
+
+  ExportQueue<ExportTexture>* input_;
+
+  QVector<ExportQueue<ExportPixels>*> outputs_;
+
+  ExportStageStats* stats_;
+
+};
+
+#endif // EXPORTREADBACKTHREAD_H
@@ -0,0 +1,312 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "exportremuxer.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+ExportRemuxer::ExportRemuxer() :
+  in_fmt_ctx_(nullptr),
+  in_stream_(nullptr),
+  out_fmt_ctx_(nullptr),
+  out_stream_(nullptr),
+  pkt_(nullptr),
+  start_ts_(0),
+  end_ts_(0),
+  last_ts_(0),
+  finished_(false)
+{
+}
+
+ExportRemuxer::~ExportRemuxer()
+{
+  CleanUp();
+}
+
+bool ExportRemuxer::Open(const QString &source,
+                         int stream_index,
+                         const ExportParams &params,
+                         const rational &start,
+                         const rational &end)
+{
+  filename_ = params.filename;
+
+  QByteArray source_filename = source.toUtf8();
+
+  if (avformat_open_input(&in_fmt_ctx_, source_filename.constData(), nullptr, nullptr) < 0
+      || avformat_find_stream_info(in_fmt_ctx_, nullptr) < 0
+      || stream_index < 0
+      || stream_index >= static_cast<int>(in_fmt_ctx_->nb_streams)) {
+    reason_ = QCoreApplication::translate("ExportRemuxer", "Failed to open source");
+    return false;
+  }
+
+  in_stream_ = in_fmt_ctx_->streams[stream_index];
+
+  const AVCodecParameters* par = in_stream_->codecpar;
+
+  if (par->codec_id != params.codec) {
+    reason_ = QCoreApplication::translate("ExportRemuxer", "Source is %1").arg(avcodec_get_name(par->codec_id));
+    return false;
+  }
+
+  if (par->width != params.width || par->height != params.height) {
+    reason_ = QCoreApplication::translate("ExportRemuxer", "Source is a different size");
+    return false;
+  }
+
+  if (rational(av_guess_frame_rate(in_fmt_ctx_, in_stream_, nullptr)) != params.timebase.flipped()) {
+    reason_ = QCoreApplication::translate("ExportRemuxer", "Source is a different frame rate");
+    return false;
+  }
+
+  QByteArray out_filename = filename_.toUtf8();
+
+  const AVOutputFormat* out_format = av_guess_format(nullptr, out_filename.constData(), nullptr);
+
+  if (out_format == nullptr || avformat_query_codec(out_format, par->codec_id, FF_COMPLIANCE_NORMAL) != 1) {
+    reason_ = QCoreApplication::translate("ExportRemuxer", "Container doesn't support the source's codec");
+    return false;
+  }
+
+  // Convert the range to the stream's timebase the same way FFmpegDecoder does
+  double ts_per_second = rational(in_stream_->time_base).flipped().toDouble();
+
+  start_ts_ = qRound64(start.toDouble() * ts_per_second);
+  end_ts_ = qRound64(end.toDouble() * ts_per_second);
+
+  if (!IsGOPBoundary(start_ts_) || !IsGOPBoundary(end_ts_)) {
+    reason_ = QCoreApplication::translate("ExportRemuxer", "Range doesn't start and end on keyframes");
+    return false;
+  }
+
+  return true;
+}
+
+bool ExportRemuxer::Start()
+{
+  int error_code;
+
+  QByteArray out_filename = filename_.toUtf8();
+
+  error_code = avformat_alloc_output_context2(&out_fmt_ctx_, nullptr, nullptr, out_filename.constData());
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  out_stream_ = avformat_new_stream(out_fmt_ctx_, nullptr);
+  if (out_stream_ == nullptr) {
+    error_ = QCoreApplication::translate("ExportRemuxer", "Failed to create video stream");
+    return false;
+  }
+
+  error_code = avcodec_parameters_copy(out_stream_->codecpar, in_stream_->codecpar);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  // Let the muxer choose a tag for its own container
+  out_stream_->codecpar->codec_tag = 0;
+  out_stream_->time_base = in_stream_->time_base;
+
+  error_code = avio_open(&out_fmt_ctx_->pb, out_filename.constData(), AVIO_FLAG_WRITE);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  error_code = avformat_write_header(out_fmt_ctx_, nullptr);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  error_code = av_seek_frame(in_fmt_ctx_, in_stream_->index, start_ts_, AVSEEK_FLAG_BACKWARD);
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  pkt_ = av_packet_alloc();
+
+  last_ts_ = start_ts_;
+
+  return true;
+}
+
+bool ExportRemuxer::CopyPacket()
+{
+  int error_code;
+
+  while ((error_code = av_read_frame(in_fmt_ctx_, pkt_)) >= 0) {
+    if (pkt_->stream_index != in_stream_->index || pkt_->pts == AV_NOPTS_VALUE) {
+      av_packet_unref(pkt_);
+      continue;
+    }
+
+    // Decode timestamps only increase and never exceed their packet's presentation timestamp, so once one reaches the
+    // end, no packet left shows a frame inside the range
+    int64_t dts = (pkt_->dts == AV_NOPTS_VALUE) ? pkt_->pts : pkt_->dts;
+
+    if (dts >= end_ts_) {
+      av_packet_unref(pkt_);
+      return false;
+    }
+
+    // Skip frames outside the range (e.g. leading B-frames of the first GOP, which reference the one before it)
+    if (pkt_->pts < start_ts_ || pkt_->pts >= end_ts_) {
+      av_packet_unref(pkt_);
+      continue;
+    }
+
+    last_ts_ = pkt_->pts;
+
+    pkt_->pts -= start_ts_;
+    if (pkt_->dts != AV_NOPTS_VALUE) {
+      pkt_->dts -= start_ts_;
+    }
+
+    av_packet_rescale_ts(pkt_, in_stream_->time_base, out_stream_->time_base);
+    pkt_->stream_index = out_stream_->index;
+    pkt_->pos = -1;
+
+    // This takes ownership of the packet's data
+    error_code = av_interleaved_write_frame(out_fmt_ctx_, pkt_);
+    if (error_code < 0) {
+      FFmpegError(error_code);
+      return false;
+    }
+
+    return true;
+  }
+
+  if (error_code != AVERROR_EOF) {
+    FFmpegError(error_code);
+  }
+
+  return false;
+}
+
+bool ExportRemuxer::Finish()
+{
+  int error_code = av_write_trailer(out_fmt_ctx_);
+
+  if (error_code < 0) {
+    FFmpegError(error_code);
+    return false;
+  }
+
+  finished_ = true;
+
+  return true;
+}
+
+void ExportRemuxer::CleanUp()
+{
+  av_packet_free(&pkt_);
+
+  if (out_fmt_ctx_ != nullptr) {
+    if (out_fmt_ctx_->pb != nullptr) {
+      avio_closep(&out_fmt_ctx_->pb);
+    }
+
+    avformat_free_context(out_fmt_ctx_);
+    out_fmt_ctx_ = nullptr;
+
+    // An unfinished file isn't playable, don't leave it behind
+    if (!finished_) {
+      QFile::remove(filename_);
+    }
+  }
+
+  avformat_close_input(&in_fmt_ctx_);
+
+  in_stream_ = nullptr;
+  out_stream_ = nullptr;
+  finished_ = false;
+}
+
+int ExportRemuxer::progress() const
+{
+  if (end_ts_ <= start_ts_) {
+    return 0;
+  }
+
+  return static_cast<int>((last_ts_ - start_ts_) * 100 / (end_ts_ - start_ts_));
+}
+
+const QString &ExportRemuxer::reason() const
+{
+  return reason_;
+}
+
+const QString &ExportRemuxer::error() const
+{
+  return error_;
+}
+
+bool ExportRemuxer::IsGOPBoundary(int64_t ts)
+{
+  int64_t start_time = (in_stream_->start_time == AV_NOPTS_VALUE) ? 0 : in_stream_->start_time;
+
+  if (in_stream_->duration != AV_NOPTS_VALUE && ts >= start_time + in_stream_->duration) {
+    return true;
+  }
+
+  // Seeking backwards lands on the keyframe at or before the timestamp
+  if (av_seek_frame(in_fmt_ctx_, in_stream_->index, ts, AVSEEK_FLAG_BACKWARD) < 0) {
+    return false;
+  }
+
+  AVPacket* pkt = av_packet_alloc();
+
+  bool boundary = false;
+
+  while (av_read_frame(in_fmt_ctx_, pkt) >= 0) {
+    bool is_stream = (pkt->stream_index == in_stream_->index);
+
+    if (is_stream) {
+      boundary = ((pkt->flags & AV_PKT_FLAG_KEY) && pkt->pts == ts);
+    }
+
+    av_packet_unref(pkt);
+
+    if (is_stream) {
+      break;
+    }
+  }
+
+  av_packet_free(&pkt);
+
+  return boundary;
+}
+
+void ExportRemuxer::FFmpegError(int error_code)
+{
+  char err[1024];
+  av_strerror(error_code, err, 1024);
+
+  error_ = QCoreApplication::translate("ExportRemuxer", "Failed to export %1 - %2 %3").arg(filename_,
+                                                                                         QString::number(error_code),
+                                                                                         err);
+}
@@ -0,0 +1,123 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef EXPORTREMUXER_H
+#define EXPORTREMUXER_H
+
+extern "C" {
+#include <libavformat/avformat.h>
+}
+
+#include <QString>
+
+#include "exportparams.h"
+
+/**
+ * @brief Copies a range of a source video stream's packets to an export without decoding or encoding them
+ *
+ * Used by ExportTask when the whole export range shows one unmodified clip that's already in the export's codec, size
+ * and frame rate, so the export runs at I/O speed instead of rendering every frame. Open() checks the source and the
+ * range: both ends of the range must fall on GOP boundaries (a keyframe, or the end of the stream) since anything else
+ * would need the frames around the cut re-encoded, and our encoder's bitstream can't be spliced into the source's in a
+ * single stream.
+ */
+class ExportRemuxer
+{
+public:
+  ExportRemuxer();
+
+  ~ExportRemuxer();
+
+  ExportRemuxer(const ExportRemuxer& other) = delete;
+  ExportRemuxer& operator=(const ExportRemuxer& other) = delete;
+
+  /**
+   * @brief Open the source and check that its stream can be copied to this export between two media times
+   *
+   * @return
+   *
+   * TRUE if the range can be copied. If not, reason() says why and the export should be rendered instead.
+   */
+  bool Open(const QString& source, int stream_index, const ExportParams& params, const rational& start, const rational& end);
+
+  /**
+   * @brief Create the output file and seek the source to the start of the range
+   */
+  bool Start();
+
+  /**
+   * @brief Copy the next packet of the range
+   *
+   * @return
+   *
+   * FALSE once the whole range has been copied or if an error occurred (see error()).
+   */
+  bool CopyPacket();
+
+  /**
+   * @brief Finish the file after CopyPacket() has returned FALSE without an error
+   */
+  bool Finish();
+
+  /**
+   * @brief Free everything, deleting the output file if Finish() was never reached
+   */
+  void CleanUp();
+
+  /**
+   * @brief Percentage of the range copied so far
+   */
+  int progress() const;
+
+  const QString& reason() const;
+
+  const QString& error() const;
+
+private:
+  /**
+   * @brief Returns whether `ts` is the timestamp of a keyframe (or at or past the end of the stream)
+   */
+  bool IsGOPBoundary(int64_t ts);
+
+  void FFmpegError(int error_code);
+
+  QString filename_;
+
+  AVFormatContext* in_fmt_ctx_;
+  AVStream* in_stream_;
+
+  AVFormatContext* out_fmt_ctx_;
+  AVStream* out_stream_;
+
+  AVPacket* pkt_;
+
+  int64_t start_ts_;
+  int64_t end_ts_;
+
+  int64_t last_ts_;
+
+  bool finished_;
+
+  QString reason_;
+
+  QString error_;
+};
+
+#endif // EXPORTREMUXER_H
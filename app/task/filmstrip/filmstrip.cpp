@@ -0,0 +1,158 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "filmstrip.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtMath>
+
+#include "config/config.h"
+#include "decoder/decoder.h"
+#include "decoder/filmstrip.h"
+#include "project/item/footage/videostream.h"
+#include "render/pixelservice.h"
+
+FilmstripTask::FilmstripTask(FootagePtr footage) :
+  footage_(footage)
+{
+  QString base_filename = QFileInfo(footage_->filename()).fileName();
+
+  set_text(tr("Generating thumbnails for \"%1\"").arg(base_filename));
+}
+
+bool FilmstripTask::Action()
+{
+  footage_->LockDeletes();
+
+  QList<StreamPtr> streams;
+
+  for (int i=0;i<footage_->stream_count();i++) {
+    if (footage_->stream(i)->type() == Stream::kVideo) {
+      streams.append(footage_->stream(i));
+    }
+  }
+
+  bool result = true;
+
+  for (int i=0;i<streams.size() && !cancelled();i++) {
+    if (!BuildFilmstrip(streams.at(i), i, streams.size())) {
+      set_error(tr("Failed to generate thumbnails for stream %1").arg(streams.at(i)->index()));
+      result = false;
+    }
+  }
+
+  footage_->UnlockDeletes();
+
+  return result;
+}
+
+bool FilmstripTask::BuildFilmstrip(StreamPtr stream, int stream_number, int stream_count)
+{
+  QString filename = Filmstrip::GetFilename(stream.get());
+
+  // Nothing to do if this stream already has a filmstrip
+  if (Filmstrip::Load(filename) != nullptr) {
+    return true;
+  }
+
+  VideoStream* video_stream = static_cast<VideoStream*>(stream.get());
+
+  if (stream->duration() <= 0 || video_stream->width() <= 0 || video_stream->height() <= 0) {
+    return false;
+  }
+
+  DecoderPtr decoder = Decoder::CreateFromID(footage_->decoder());
+
+  if (decoder == nullptr) {
+    return false;
+  }
+
+  decoder->set_stream(stream);
+
+  // Thumbnails are tiny, so let the decoder skip most of the detail (but keep enough to scale down smoothly)
+  decoder->set_divider(qMax(1, video_stream->height() / (Filmstrip::kThumbnailHeight * 2)));
+
+  // Only keyframes are needed, so decode them directly like shuttling does rather than seeking through each GOP
+  decoder->set_playback_speed(kShuttleKeyframeSpeed);
+
+  if (!decoder->Open()) {
+    return false;
+  }
+
+  double duration = rational(stream->duration() * stream->timebase().numerator(),
+                             stream->timebase().denominator()).toDouble();
+
+  int interval = qMax(static_cast<int>(Filmstrip::kInterval), qCeil(duration / Filmstrip::kMaxThumbnails));
+  int count = qMax(1, qCeil(duration / interval));
+
+  int thumbnail_width = qMax(1, qRound(static_cast<double>(Filmstrip::kThumbnailHeight)
+                                       * video_stream->width() / video_stream->height()));
+
+  FilmstripBuilder builder(thumbnail_width, Filmstrip::kThumbnailHeight);
+
+  double last_time = -1.0;
+
+  for (int i=0;i<count && !cancelled();i++) {
+    FramePtr frame = decoder->Retrieve(rational(i * interval, 1));
+
+    if (frame == nullptr) {
+      decoder->Close();
+      return false;
+    }
+
+    // Snapping to keyframes means several intervals may land on the same frame, only store it once
+    double frame_time = frame->timestamp().toDouble();
+
+    if (frame_time > last_time) {
+      if (static_cast<olive::PixelFormat>(frame->format()) != olive::PIX_FMT_RGBA8) {
+        frame = PixelService::ConvertPixelFormat(frame, olive::PIX_FMT_RGBA8);
+      }
+
+      builder.AddThumbnail(frame_time, QImage(frame->const_data(),
+                                              frame->width(),
+                                              frame->height(),
+                                              frame->linesize(),
+                                              QImage::Format_RGBA8888));
+
+      last_time = frame_time;
+    }
+
+    emit ProgressChanged((stream_number * 100 + (i * 100 / count)) / stream_count);
+  }
+
+  decoder->Close();
+
+  if (cancelled()) {
+    return true;
+  }
+
+  // Write to a temporary file first so that painters never map a half-written filmstrip
+  QString partial_filename = filename;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  if (!builder.Save(partial_filename)) {
+    return false;
+  }
+
+  QFile::remove(filename);
+
+  return QFile::rename(partial_filename, filename);
+}
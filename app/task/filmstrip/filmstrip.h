@@ -0,0 +1,57 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef FILMSTRIPTASK_H
+#define FILMSTRIPTASK_H
+
+#include "project/item/footage/footage.h"
+#include "task/task.h"
+
+/**
+ * @brief A background task for building the filmstrips of a Footage file's video streams
+ *
+ * Each video stream is decoded at one keyframe per Filmstrip::kInterval (or longer for long media), at a reduced
+ * resolution, and the results are saved as a Filmstrip the timeline can paint from without decoding anything. Streams
+ * that already have a filmstrip are skipped.
+ *
+ * Like WaveformTask, this is created by ImportTask once the Footage has been probed.
+ */
+class FilmstripTask : public Task
+{
+  Q_OBJECT
+public:
+  FilmstripTask(FootagePtr footage);
+
+  virtual bool Action() override;
+
+private:
+  /**
+   * @brief Decode thumbnails of one video stream and save its filmstrip
+   *
+   * @return
+   *
+   * TRUE on success or if the task was cancelled, FALSE on failure.
+   */
+  bool BuildFilmstrip(StreamPtr stream, int stream_number, int stream_count);
+
+  FootagePtr footage_;
+};
+
+#endif // FILMSTRIPTASK_H
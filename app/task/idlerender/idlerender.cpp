@@ -0,0 +1,86 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "idlerender.h"
+
+#include "project/item/sequence/sequence.h"
+
+IdleRenderTask::IdleRenderTask(Sequence *sequence, RendererProcessor *renderer) :
+  renderer_(renderer)
+{
+  set_text(tr("Rendering \"%1\" in the background").arg(sequence->name()));
+
+  // Anything the user asked for goes first
+  set_priority(-1);
+}
+
+bool IdleRenderTask::Prologue()
+{
+  if (renderer_ == nullptr) {
+    return false;
+  }
+
+  connect(renderer_, SIGNAL(FillFinished()), this, SLOT(RendererFillFinished()));
+
+  // Sequences can be deleted while idle, which would leave Action() waiting forever
+  connect(renderer_, SIGNAL(destroyed()), this, SLOT(RendererFillFinished()));
+
+  // May finish straight away if everything is cached already
+  renderer_->FillCache();
+
+  return true;
+}
+
+bool IdleRenderTask::Action()
+{
+  // The renderer's threads do the rendering, so this only has to notice when they're done or when to stop waiting
+  while (!finished_.tryAcquire(1, 100)) {
+    if (cancelled()) {
+      break;
+    }
+  }
+
+  return true;
+}
+
+bool IdleRenderTask::Epilogue()
+{
+  if (renderer_ != nullptr) {
+    disconnect(renderer_, nullptr, this, nullptr);
+  }
+
+  return true;
+}
+
+void IdleRenderTask::Pause()
+{
+  if (status() == kWorking && renderer_ != nullptr) {
+    disconnect(renderer_, nullptr, this, nullptr);
+
+    renderer_->StopFill();
+  }
+
+  Cancel();
+}
+
+void IdleRenderTask::RendererFillFinished()
+{
+  finished_.release();
+}
@@ -0,0 +1,69 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef IDLERENDERTASK_H
+#define IDLERENDERTASK_H
+
+#include <QPointer>
+#include <QSemaphore>
+
+#include "node/processor/renderer/renderer.h"
+#include "task/task.h"
+
+/**
+ * @brief A low priority background task that fills a Sequence's render cache (see RendererProcessor::FillCache())
+ *
+ * The frames are rendered by the RendererProcessor's own threads, this Task just waits for them so that idle rendering
+ * shows up alongside other Tasks and can be cancelled like them. Core creates these for every open Sequence once the
+ * user has been idle for kIdleRenderDelay seconds, and pauses them as soon as there's any input again.
+ */
+class IdleRenderTask : public Task
+{
+  Q_OBJECT
+public:
+  IdleRenderTask(Sequence* sequence, RendererProcessor* renderer);
+
+  virtual bool Prologue() override;
+
+  virtual bool Action() override;
+
+  virtual bool Epilogue() override;
+
+  /**
+   * @brief Stop rendering straight away and cancel the Task
+   *
+   * Must be called from the main thread.
+   */
+  void Pause();
+
+private:
+  QPointer<RendererProcessor> renderer_;
+
+  /**
+   * @brief Released once the renderer emits FillFinished() or is destroyed
+   */
+  QSemaphore finished_;
+
+private slots:
+  void RendererFillFinished();
+
+};
+
+#endif // IDLERENDERTASK_H
@@ -25,17 +25,50 @@
 #include <QDebug>
 #include <QDir>
 #include <QFileInfo>
+#include <QRunnable>
+#include <QThreadPool>
 
 // FIXME: Only used for test code
 #include "panel/panelmanager.h"
 #include "panel/project/project.h"
 // End test code
 
+#include "config/config.h"
+#include "decoder/decoder.h"
+#include "decoder/oiio/oiiodecoder.h"
 #include "project/item/footage/footage.h"
-#include "task/probe/probe.h"
+#include "task/analyze/analyze.h"
+#include "task/filmstrip/filmstrip.h"
+#include "task/index/index.h"
 #include "task/taskmanager.h"
+#include "task/waveform/waveform.h"
 #include "undo/undostack.h"
 
+/**
+ * @brief Probes one Footage file on ImportTask's thread pool
+ */
+class ImportTask::Prober : public QRunnable
+{
+public:
+  Prober(FootagePtr footage, QAtomicInt* probed_count) :
+    footage_(footage),
+    probed_count_(probed_count)
+  {
+  }
+
+  virtual void run() override
+  {
+    Decoder::ProbeMedia(footage_.get());
+
+    probed_count_->ref();
+  }
+
+private:
+  FootagePtr footage_;
+
+  QAtomicInt* probed_count_;
+};
+
 ImportTask::ImportTask(ProjectViewModel *model, Folder *parent, const QStringList &urls) :
   model_(model),
   urls_(urls),
@@ -43,6 +76,7 @@ ImportTask::ImportTask(ProjectViewModel *model, Folder *parent, const QStringLis
   command_(nullptr)
 {
   set_text(tr("Importing %1 files").arg(urls.size()));
+  set_category(kCategoryIO);
 }
 
 bool ImportTask::Action()
@@ -53,6 +87,10 @@ bool ImportTask::Action()
 
   Import(urls_, parent_, command_);
 
+  ProbeAll();
+
+  CreateTasks(command_);
+
   // If this task was cancelled, we won't bother pushing an undo command (we don't end up with anything undoable since
   // the undo command executes the final import anyway)
   if (cancelled()) {
@@ -77,6 +115,9 @@ bool ImportTask::Epilogue()
 
 void ImportTask::Import(const QStringList &files, Folder *folder, QUndoCommand *parent_command)
 {
+  // Image sequences imported so far, their other frames shouldn't be imported separately
+  QList<ImageSequence> sequences;
+
   for (int i=0;i<files.size();i++) {
 
     // Stop here if the Task has been cancelled
@@ -124,15 +165,29 @@ void ImportTask::Import(const QStringList &files, Folder *folder, QUndoCommand *
         Import(full_urls, static_cast<Folder*>(f.get()), parent_command);
       }
 
+    } else if (IsInSequence(sequences, url)) {
+
+      // This frame is already part of an image sequence Footage, skip it
+
     } else {
 
+      QString footage_name = file_info.fileName();
+
+      // If this is part of an image sequence, import the whole sequence as one Footage
+      ImageSequence seq;
+
+      if (OIIODecoder::GetImageSequence(url, &seq)) {
+        sequences.append(seq);
+        footage_name = seq.GetDisplayName();
+      }
+
       FootagePtr f = std::make_shared<Footage>();
 
       // FIXME: Is it possible for a file to go missing between the Import dialog and here?
       //        And what is the behavior/result of that?
 
       f->set_filename(url);
-      f->set_name(file_info.fileName());
+      f->set_name(footage_name);
       f->set_timestamp(file_info.lastModified());
 
       // Create undoable command that adds the items to the model
@@ -141,20 +196,102 @@ void ImportTask::Import(const QStringList &files, Folder *folder, QUndoCommand *
                                            f,
                                            parent_command);
 
-      // Create ProbeTask to analyze this media
-      TaskPtr pt = std::make_shared<ProbeTask>(f);
+      // Probed in Action() once every file has been found
+      footage_.append(f);
+
+    }
+  }
+}
+
+void ImportTask::ProbeAll()
+{
+  if (footage_.isEmpty()) {
+    return;
+  }
+
+  // Probing is mostly spent waiting on file opens (especially over a network), so several can run at once. The pool
+  // keeps the number of files open at the same time bounded.
+  QThreadPool probe_pool;
+  probe_pool.setMaxThreadCount(kMaximumConcurrentProbes);
+
+  QAtomicInt probed_count(0);
+
+  foreach (FootagePtr f, footage_) {
+    probe_pool.start(new Prober(f, &probed_count));
+  }
+
+  while (!probe_pool.waitForDone(100)) {
+    if (cancelled()) {
+      // Drop the probes that haven't started yet, the running ones will finish shortly
+      probe_pool.clear();
+    }
+
+    emit ProgressChanged(probed_count.load() * 100 / footage_.size());
+  }
+}
+
+void ImportTask::CreateTasks(QUndoCommand *parent_command)
+{
+  if (cancelled()) {
+    return;
+  }
+
+  foreach (FootagePtr f, footage_) {
+    if (f->status() != Footage::kReady) {
+      continue;
+    }
+
+    bool has_video = false;
+    bool has_audio = false;
+
+    for (int i=0;i<f->stream_count();i++) {
+      if (f->stream(i)->type() == Stream::kVideo) {
+        has_video = true;
+      } else if (f->stream(i)->type() == Stream::kAudio) {
+        has_audio = true;
+      }
+    }
+
+    QList<TaskPtr> tasks;
 
+    if (AnalyzeTask::CanAnalyze(f.get())) {
+      if (has_video || has_audio) {
+        // Create AnalyzeTask to build indexes, thumbnails, waveforms and proxies in a single read of the file
+        tasks.append(std::make_shared<AnalyzeTask>(f));
+      }
+    } else {
+      if (has_video) {
+        // Create IndexTask to index the media's video
+        tasks.append(std::make_shared<IndexTask>(f));
+
+        // Create FilmstripTask to generate thumbnails for the timeline
+        tasks.append(std::make_shared<FilmstripTask>(f));
+      }
+
+      if (has_audio) {
+        // Create WaveformTask to summarize the audio for the timeline
+        tasks.append(std::make_shared<WaveformTask>(f));
+      }
+    }
+
+    foreach (TaskPtr t, tasks) {
       // The task won't work unless it's in the main thread and we're definitely not
       // FIXME: Should Tasks check what thread they're in and move themselves to the main thread?
-      pt->moveToThread(qApp->thread());
+      t->moveToThread(qApp->thread());
 
       // Queue task in task manager
-      new TaskManager::AddTaskCommand(pt, parent_command);
-      //olive::task_manager.AddTask(pt);
-
+      new TaskManager::AddTaskCommand(t, parent_command);
     }
+  }
+}
 
-    emit ProgressChanged(i * 100 / files.size());
-
+bool ImportTask::IsInSequence(const QList<ImageSequence> &sequences, const QString &filename)
+{
+  foreach (const ImageSequence& seq, sequences) {
+    if (seq.Contains(filename)) {
+      return true;
+    }
   }
+
+  return false;
 }
@@ -21,14 +21,20 @@
 #ifndef IMPORT_H
 #define IMPORT_H
 
+#include "decoder/imagesequence.h"
 #include "project/projectviewmodel.h"
 #include "project/item/folder/folder.h"
+#include "project/item/footage/footage.h"
 #include "task/task.h"
 
 /**
  * @brief The ImportTask class
  *
- * A background task to create Footage objects from a list of URLs, and then create ProbeTasks for each of them.
+ * A background task to create Footage objects from a list of URLs, probe them, and then create the Tasks that
+ * prepare them for use (indexes, waveforms, and proxies).
+ *
+ * Every file is found first and then the whole batch is probed on a pool of threads, so that imports of thousands of
+ * files aren't bound by opening them one at a time. All of the imported items are added with a single undo command.
  *
  * Using this Task is the best way to import media into a project since it will run in the background/multithreaded
  * without pausing the main thread.
@@ -44,13 +50,35 @@ public:
   virtual bool Epilogue() override;
 
 private:
+  class Prober;
+
   void Import(const QStringList& files, Folder* folder, QUndoCommand* parent_command);
 
+  /**
+   * @brief Probe every Footage found by Import() on a thread pool, returning once they've all finished
+   */
+  void ProbeAll();
+
+  /**
+   * @brief Create the background Tasks for each successfully probed Footage
+   */
+  void CreateTasks(QUndoCommand* parent_command);
+
+  /**
+   * @brief Returns TRUE if a file is one of the frames in any of the image sequences provided
+   */
+  static bool IsInSequence(const QList<ImageSequence>& sequences, const QString& filename);
+
   ProjectViewModel* model_;
   QStringList urls_;
   Folder* parent_;
 
   QUndoCommand* command_;
+
+  /**
+   * @brief Footage found by Import() to be probed
+   */
+  QList<FootagePtr> footage_;
 };
 
 #endif // IMPORT_H
@@ -0,0 +1,89 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "index.h"
+
+#include <QFileInfo>
+
+IndexTask::IndexTask(FootagePtr footage) :
+  footage_(footage),
+  stream_count_(0),
+  current_stream_(0)
+{
+  QString base_filename = QFileInfo(footage_->filename()).fileName();
+
+  set_text(tr("Indexing \"%1\"").arg(base_filename));
+  set_category(kCategoryIO);
+  set_device(footage_->filename());
+}
+
+bool IndexTask::Action()
+{
+  footage_->LockDeletes();
+
+  // Collect the streams that need indexing
+  QList<StreamPtr> streams;
+
+  for (int i=0;i<footage_->stream_count();i++) {
+    if (footage_->stream(i)->type() == Stream::kVideo) {
+      streams.append(footage_->stream(i));
+    }
+  }
+
+  stream_count_ = streams.size();
+
+  bool result = true;
+
+  for (current_stream_=0;current_stream_<streams.size() && !cancelled();current_stream_++) {
+    decoder_ = Decoder::CreateFromID(footage_->decoder());
+
+    if (decoder_ == nullptr) {
+      break;
+    }
+
+    decoder_->set_stream(streams.at(current_stream_));
+
+    // Progress is emitted from this thread, so a direct connection lets us respond to cancelling during Analyze()
+    connect(decoder_.get(), SIGNAL(AnalysisProgress(int)), this, SLOT(DecoderProgress(int)), Qt::DirectConnection);
+
+    if (!decoder_->Analyze() && !cancelled()) {
+      set_error(tr("Failed to index stream %1").arg(streams.at(current_stream_)->index()));
+      result = false;
+    }
+
+    decoder_->Close();
+    decoder_ = nullptr;
+  }
+
+  footage_->UnlockDeletes();
+
+  return result;
+}
+
+void IndexTask::DecoderProgress(int p)
+{
+  if (cancelled()) {
+    decoder_->CancelAnalysis();
+  }
+
+  if (stream_count_ > 0) {
+    emit ProgressChanged((current_stream_ * 100 + p) / stream_count_);
+  }
+}
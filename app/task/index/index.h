@@ -0,0 +1,61 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef INDEXTASK_H
+#define INDEXTASK_H
+
+#include "decoder/decoder.h"
+#include "project/item/footage/footage.h"
+#include "task/task.h"
+
+/**
+ * @brief A background task for building the frame indexes of a Footage file's video streams
+ *
+ * Indexing decodes or demuxes the entire file so it can take a long time. Running it as a Task means the renderer
+ * never has to wait for it (decoders estimate timestamps until the index is ready) and the user can see its progress.
+ *
+ * IndexTask is usually created by ImportTask once the Footage has been probed so that its streams are known by the
+ * time Action() runs.
+ */
+class IndexTask : public Task
+{
+  Q_OBJECT
+public:
+  IndexTask(FootagePtr footage);
+
+  virtual bool Action() override;
+
+private:
+  FootagePtr footage_;
+
+  DecoderPtr decoder_;
+
+  int stream_count_;
+
+  int current_stream_;
+
+private slots:
+  /**
+   * @brief Receives progress from the Decoder currently analyzing, also handles cancelling it
+   */
+  void DecoderProgress(int p);
+};
+
+#endif // INDEXTASK_H
@@ -0,0 +1,178 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "mirror.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QSet>
+
+#include "common/filefunctions.h"
+#include "config/config.h"
+#include "decoder/mediamirror.h"
+#include "task/taskmanager.h"
+
+namespace {
+
+/**
+ * @brief Files of every MirrorTask that hasn't finished yet
+ */
+QSet<QString> queued_files;
+QMutex queued_files_lock;
+
+}
+
+MirrorTask::MirrorTask(const QString &filename) :
+  filename_(filename)
+{
+  QString base_filename = QFileInfo(filename_).fileName();
+
+  set_text(tr("Copying \"%1\" to local storage").arg(base_filename));
+  set_category(kCategoryIO);
+  set_device(filename_);
+
+  queued_files_lock.lock();
+  queued_files.insert(filename_);
+  queued_files_lock.unlock();
+}
+
+MirrorTask::~MirrorTask()
+{
+  queued_files_lock.lock();
+  queued_files.remove(filename_);
+  queued_files_lock.unlock();
+}
+
+bool MirrorTask::Action()
+{
+  qint64 size = QFileInfo(filename_).size();
+
+  // Never worth evicting everything else for
+  if (size <= 0 || size > kMediaMirrorSize) {
+    return true;
+  }
+
+  QString identifier = GetUniqueFileIdentifier(filename_);
+
+  if (identifier.isEmpty()) {
+    set_error(tr("Failed to open \"%1\"").arg(filename_));
+    return false;
+  }
+
+  QString destination = MediaMirror::GetMirrorFilename(identifier);
+
+  // A previous session may have already copied this exact file
+  if (QFileInfo(destination).size() != size) {
+    // Write to a temporary file first so that decoders never open a half-written copy
+    QString partial_filename = destination;
+    partial_filename.append(QStringLiteral(".partial"));
+
+    if (!Copy(partial_filename, size)) {
+      QFile::remove(partial_filename);
+      return false;
+    }
+
+    if (cancelled()) {
+      QFile::remove(partial_filename);
+      return true;
+    }
+
+    if (GetUniqueFileIdentifier(filename_) != identifier || QFileInfo(partial_filename).size() != size) {
+      QFile::remove(partial_filename);
+      set_error(tr("\"%1\" changed while it was being copied").arg(filename_));
+      return false;
+    }
+
+    QFile::remove(destination);
+
+    if (!QFile::rename(partial_filename, destination)) {
+      QFile::remove(partial_filename);
+      set_error(tr("Failed to write \"%1\"").arg(destination));
+      return false;
+    }
+  }
+
+  MediaMirror::Instance()->Add(filename_, identifier, size);
+
+  return true;
+}
+
+void MirrorTask::Queue(const QString &filename)
+{
+  if (!kUseMediaMirror
+      || IsQueued(filename)
+      || MediaMirror::Instance()->IsMirrored(filename)
+      || !MediaMirror::IsMirrorable(filename)) {
+    return;
+  }
+
+  olive::task_manager.AddTask(std::make_shared<MirrorTask>(filename));
+}
+
+bool MirrorTask::IsQueued(const QString &filename)
+{
+  QMutexLocker locker(&queued_files_lock);
+
+  return queued_files.contains(filename);
+}
+
+bool MirrorTask::Copy(const QString &destination, qint64 size)
+{
+  QFile source(filename_);
+
+  if (!source.open(QFile::ReadOnly)) {
+    set_error(tr("Failed to open \"%1\"").arg(filename_));
+    return false;
+  }
+
+  QFile copy(destination);
+
+  if (!copy.open(QFile::WriteOnly)) {
+    set_error(tr("Failed to write \"%1\"").arg(destination));
+    return false;
+  }
+
+  QByteArray buffer(kIOBlockSize, Qt::Uninitialized);
+
+  qint64 copied = 0;
+
+  while (!cancelled()) {
+    qint64 read = source.read(buffer.data(), buffer.size());
+
+    if (read < 0) {
+      set_error(tr("Failed to read \"%1\"").arg(filename_));
+      return false;
+    } else if (read == 0) {
+      break;
+    }
+
+    if (copy.write(buffer.constData(), read) != read) {
+      set_error(tr("Failed to write \"%1\"").arg(destination));
+      return false;
+    }
+
+    copied += read;
+
+    emit ProgressChanged(static_cast<int>(qMin(copied * 100 / size, Q_INT64_C(100))));
+  }
+
+  return true;
+}
@@ -0,0 +1,67 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MIRRORTASK_H
+#define MIRRORTASK_H
+
+#include "task/task.h"
+
+/**
+ * @brief A background task for copying a media file on network storage to the MediaMirror
+ *
+ * The copy is only handed to MediaMirror if the source's GetUniqueFileIdentifier() is the same after copying as it was
+ * before, so a file modified mid-copy is never mirrored.
+ *
+ * Core creates these (see Queue()) for the media used by each sequence it opens.
+ */
+class MirrorTask : public Task
+{
+  Q_OBJECT
+public:
+  MirrorTask(const QString& filename);
+
+  virtual ~MirrorTask() override;
+
+  virtual bool Action() override;
+
+  /**
+   * @brief Create a MirrorTask for `filename` unless it's local, already mirrored or already queued
+   */
+  static void Queue(const QString& filename);
+
+  /**
+   * @brief Returns TRUE if a MirrorTask for this file exists and hasn't finished yet
+   */
+  static bool IsQueued(const QString& filename);
+
+private:
+  /**
+   * @brief Copy the source to `destination`
+   *
+   * @return
+   *
+   * TRUE on success or if the task was cancelled, FALSE on failure.
+   */
+  bool Copy(const QString& destination, qint64 size);
+
+  QString filename_;
+};
+
+#endif // MIRRORTASK_H
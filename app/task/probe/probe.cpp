@@ -30,6 +30,8 @@ ProbeTask::ProbeTask(FootagePtr footage) :
   QString base_filename = QFileInfo(footage_->filename()).fileName();
 
   set_text(tr("Probing \"%1\"").arg(base_filename));
+  set_category(kCategoryIO);
+  set_device(footage_->filename());
 }
 
 bool ProbeTask::Action()
@@ -0,0 +1,92 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "proxy.h"
+
+#include <QFileInfo>
+
+#include "common/filefunctions.h"
+#include "task/analyze/analyze.h"
+
+ProxyTask::ProxyTask(FootagePtr footage) :
+  footage_(footage)
+{
+  QString base_filename = QFileInfo(footage_->filename()).fileName();
+
+  set_text(tr("Loading proxies for \"%1\"").arg(base_filename));
+  set_category(kCategoryIO);
+  set_device(GetMediaCacheLocation());
+}
+
+bool ProxyTask::Action()
+{
+  footage_->LockDeletes();
+
+  for (int i=0;i<footage_->stream_count();i++) {
+    StreamPtr s = footage_->stream(i);
+
+    if (!ProxyAnalyzer::IsProxyNeeded(s.get())) {
+      continue;
+    }
+
+    VideoStreamPtr video = std::static_pointer_cast<VideoStream>(s);
+
+    if (video->proxy() != nullptr) {
+      continue;
+    }
+
+    std::shared_ptr<ProxyAnalyzer> analyzer = std::make_shared<ProxyAnalyzer>(video);
+
+    if (analyzer->LoadExisting()) {
+      loaded_.append(analyzer);
+    }
+  }
+
+  footage_->UnlockDeletes();
+
+  return true;
+}
+
+bool ProxyTask::Epilogue()
+{
+  foreach (std::shared_ptr<ProxyAnalyzer> analyzer, loaded_) {
+    analyzer->Epilogue();
+  }
+
+  loaded_.clear();
+
+  return true;
+}
+
+bool ProxyTask::CanHaveProxies(Footage *footage)
+{
+  // Proxies are only made by AnalyzeTask
+  if (footage->status() != Footage::kReady || !AnalyzeTask::CanAnalyze(footage)) {
+    return false;
+  }
+
+  for (int i=0;i<footage->stream_count();i++) {
+    if (ProxyAnalyzer::IsProxyNeeded(footage->stream(i).get())) {
+      return true;
+    }
+  }
+
+  return false;
+}
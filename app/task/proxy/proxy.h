@@ -0,0 +1,56 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROXYTASK_H
+#define PROXYTASK_H
+
+#include "project/item/footage/footage.h"
+#include "task/analyze/proxyanalyzer.h"
+#include "task/task.h"
+
+/**
+ * @brief Reattaches the proxies a Footage's streams already have in the media cache
+ *
+ * Proxies aren't stored in the project, they're attached by the AnalyzeTask an import creates. When a project is
+ * opened, this finds the proxy files those imports left (see ProxyAnalyzer::GetProxyFilename()) and attaches them
+ * again. Streams without a proxy file are left as they are, nothing is transcoded.
+ */
+class ProxyTask : public Task
+{
+  Q_OBJECT
+public:
+  ProxyTask(FootagePtr footage);
+
+  virtual bool Action() override;
+
+  virtual bool Epilogue() override;
+
+  /**
+   * @brief Returns whether any stream of `footage` could have a proxy that isn't attached
+   */
+  static bool CanHaveProxies(Footage* footage);
+
+private:
+  FootagePtr footage_;
+
+  QList<std::shared_ptr<ProxyAnalyzer> > loaded_;
+};
+
+#endif // PROXYTASK_H
@@ -20,13 +20,70 @@
 
 #include "task.h"
 
+#include <QMutex>
+#include <QRunnable>
+#include <QStorageInfo>
+
+#include "task/taskmanager.h"
+
+struct Task::RunState {
+  /// Held for as long as Action() runs
+  QMutex lock;
+
+  /// Set to nullptr when the Task is destroyed
+  Task* task;
+};
+
+class Task::Runner : public QRunnable {
+public:
+  Runner(std::shared_ptr<RunState> state, int generation) :
+    state_(state),
+    generation_(generation)
+  {
+  }
+
+  virtual void run() override
+  {
+    QMutexLocker locker(&state_->lock);
+
+    Task* task = state_->task;
+
+    if (task == nullptr || task->run_generation_.loadAcquire() != generation_) {
+      return;
+    }
+
+    // A Task cancelled before it got a thread doesn't need to run at all
+    bool succeeded = task->cancelled() ? true : task->Action();
+
+    QMetaObject::invokeMethod(task, "ActionComplete", Qt::QueuedConnection,
+                              Q_ARG(int, generation_), Q_ARG(bool, succeeded));
+  }
+
+private:
+  std::shared_ptr<RunState> state_;
+
+  int generation_;
+};
+
 Task::Task() :
   status_(kWaiting),
-  thread_(this),
   text_(tr("Task")),
-  cancelled_(false)
+  category_(kCategoryCPU),
+  priority_(0),
+  cancelled_(0),
+  run_state_(std::make_shared<RunState>()),
+  run_generation_(0)
+{
+  run_state_->task = this;
+}
+
+Task::~Task()
 {
-  connect(&thread_, SIGNAL(finished()), this, SLOT(ThreadComplete()));
+  cancelled_.storeRelease(1);
+
+  // Wait for Action() if it's running, and keep it from running if it's still queued
+  QMutexLocker locker(&run_state_->lock);
+  run_state_->task = nullptr;
 }
 
 bool Task::Start()
@@ -56,7 +113,7 @@ bool Task::Start()
     }
   }
 
-  cancelled_ = false;
+  cancelled_.storeRelease(0);
 
   // Run Prologue() function
   if (!Prologue()) {
@@ -66,7 +123,8 @@ bool Task::Start()
 
   set_status(kWorking);
 
-  thread_.start();
+  olive::task_manager.thread_pool(category_, device_)->start(new Runner(run_state_, run_generation_.loadAcquire()),
+                                                              priority_);
 
   return true;
 }
@@ -109,6 +167,53 @@ void Task::AddDependency(Task *dependency)
   dependencies_.append(dependency);
 }
 
+const QList<Task *> &Task::dependencies()
+{
+  return dependencies_;
+}
+
+const Task::Category &Task::category()
+{
+  return category_;
+}
+
+void Task::set_category(const Task::Category &category)
+{
+  Q_ASSERT(status_ == kWaiting);
+
+  category_ = category;
+}
+
+const QString &Task::device()
+{
+  return device_;
+}
+
+void Task::set_device(const QString &filename)
+{
+  Q_ASSERT(status_ == kWaiting);
+
+  QStorageInfo storage(filename);
+
+  if (storage.isValid()) {
+    device_ = storage.rootPath();
+  } else {
+    device_.clear();
+  }
+}
+
+int Task::priority()
+{
+  return priority_;
+}
+
+void Task::set_priority(int priority)
+{
+  Q_ASSERT(status_ == kWaiting);
+
+  priority_ = priority;
+}
+
 void Task::ResetState()
 {
   if (status_ == kWaiting) {
@@ -119,7 +224,10 @@ void Task::ResetState()
     Cancel();
   }
 
-  cancelled_ = false;
+  // Anything still queued from the previous run is now stale
+  run_generation_.ref();
+
+  cancelled_.storeRelease(0);
 
   set_error(QString());
 
@@ -136,10 +244,12 @@ void Task::Cancel()
     return;
   }
 
-  cancelled_ = true;
+  cancelled_.storeRelease(1);
 
+  // If Action() is running, wait for it to return. If it's still queued, it'll return as soon as it gets a thread.
   // FIXME: Should we limit the wait time?
-  thread_.wait();
+  run_state_->lock.lock();
+  run_state_->lock.unlock();
 }
 
 void Task::set_error(const QString &s)
@@ -154,7 +264,7 @@ void Task::set_text(const QString &s)
 
 bool Task::cancelled()
 {
-  return cancelled_;
+  return cancelled_.loadAcquire() != 0;
 }
 
 void Task::set_status(const Task::Status &status)
@@ -168,10 +278,12 @@ void Task::set_status(const Task::Status &status)
   emit StatusChanged(status_);
 }
 
-void Task::ThreadComplete()
+void Task::ActionComplete(int generation, bool succeeded)
 {
-  // thread_.result() will be set to the return value of Action()
-  bool succeeded = thread_.result();
+  // Ignore runs that were superseded by ResetState()
+  if (generation != run_generation_.loadAcquire() || status_ != kWorking) {
+    return;
+  }
 
   // Run the Prologue() function for any final tasks
   // User cancelling is not considered an error, so we need to check it too
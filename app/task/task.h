@@ -22,15 +22,15 @@
 #define TASK_H
 
 #include <memory>
+#include <QAtomicInt>
 #include <QObject>
 
-#include "task/taskthread.h"
-
 /**
  * @brief A base class for background tasks running in Olive.
  *
- * Tasks are multithreaded by design (i.e. they will always spawn
- * a new thread and run in it).
+ * Tasks are multithreaded by design (i.e. Action() always runs on another thread). Rather than each Task creating a
+ * thread of its own, Action() runs on a thread pool shared by every Task of the same category() (see
+ * TaskManager::thread_pool()), which bounds how many run at once and starts those with a higher priority() first.
  *
  * To subclass your own Task, override Action() and return TRUE on success or FALSE on failure. Note that a Task can
  * provide a "negative" output and still have succeeded. For example, the ProbeTask's role is to determine whether a
@@ -38,8 +38,7 @@
  * has *suceeded* at discovering this. A failure of ProbeTask would indicate a catastrophic failure meaning it was
  * unable to determine anything about the file.
  *
- * Tasks should be used with the TaskManager which will manage starting and deleting them. It'll also only start as
- * many Tasks as there are threads on the system as to not overload them.
+ * Tasks should be used with the TaskManager which will manage starting and deleting them.
  *
  * Tasks support "dependency tasks", i.e. a Task that should be complete before another Task begins.
  */
@@ -57,7 +56,7 @@ public:
     /// This Task is yet to start
     kWaiting,
 
-    /// This Task is currently running (see Action())
+    /// This Task has started (see Action()), though it may still be waiting for a thread in its pool
     kWorking,
 
     /// This Task has completed successfully
@@ -67,16 +66,34 @@ public:
     kError
   };
 
+  /**
+   * @brief What a Task spends its time on, Tasks in each category share a thread pool
+   */
+  enum Category {
+    /// Mostly computing (e.g. decoding or encoding), as many run at once as there are threads on the system
+    kCategoryCPU,
+
+    /// Mostly waiting on storage (e.g. probing or reading through files), fewer run at once to avoid thrashing
+    kCategoryIO
+  };
+
   /**
    * @brief Task Constructor
    */
   Task();
 
+  /**
+   * @brief Task Destructor
+   *
+   * Waits for Action() if it's running and keeps it from running if it's still waiting for a thread.
+   */
+  virtual ~Task() override;
+
   /**
    * @brief Try to start this Task
    *
-   * The main function for starting this Task. If this task is currently waiting, this function will start a new thread
-   * and set the status to kWorking.
+   * The main function for starting this Task. If this task is currently waiting, this function will queue Action() on
+   * the thread pool for its category() and set the status to kWorking.
    *
    * This function also checks its dependency Tasks and will only start if all of them are complete. If they are still
    * working, this function will return FALSE and the status will continue to be kWaiting. If any of them failed, this
@@ -174,6 +191,44 @@ public:
    */
   void AddDependency(Task* dependency);
 
+  /**
+   * @brief Tasks that have been added with AddDependency()
+   */
+  const QList<Task*>& dependencies();
+
+  /**
+   * @brief Which thread pool this Task runs on, must be set before it starts (usually in the constructor)
+   *
+   * Defaults to kCategoryCPU.
+   */
+  const Category& category();
+  void set_category(const Category& category);
+
+  /**
+   * @brief Root path of the storage device (or mount) that this Task reads from or writes to
+   *
+   * kCategoryIO Tasks with a device only run alongside a limited number of other Tasks on the same device (see
+   * TaskManager::thread_pool()) so that many Tasks on one disk or network share don't thrash it. Empty by default.
+   */
+  const QString& device();
+
+  /**
+   * @brief Set device() to whichever device a file is on, must be set before the Task starts
+   *
+   * @param filename
+   *
+   * Any file or directory on the device. If it can't be found, device() is left empty.
+   */
+  void set_device(const QString& filename);
+
+  /**
+   * @brief Tasks with a higher priority are given a thread from their pool first, must be set before the Task starts
+   *
+   * Defaults to 0.
+   */
+  int priority();
+  void set_priority(int priority);
+
   /**
    * @brief Reset this Task back to the waiting state
    */
@@ -186,8 +241,9 @@ public slots:
    * Sends a signal to the Task to stop and waits for the Task to finish before returning. Tasks must be responsive to
    * cancelling so that the main thread doesn't halt for too long.
    *
-   * Cancel()'s function is fairly simple, it sets cancelled_ to TRUE and waits for the thread to return. It's the
-   * responsibility of the code in Action() to be able to respond quickly to cancelled_ changing.
+   * Cancel()'s function is fairly simple, it sets cancelled_ to TRUE and waits for Action() to return. It's the
+   * responsibility of the code in Action() to check cancelled() regularly (e.g. once per frame or file) and return
+   * quickly once it's set. A Task cancelled while it's still waiting for a thread never runs Action() at all.
    */
   void Cancel();
 
@@ -210,7 +266,9 @@ protected:
   void set_text(const QString& s);
 
   /**
-   * @brief Returns whether the thread has been explicitly cancelled or not
+   * @brief Returns whether the Task has been explicitly cancelled or not
+   *
+   * Safe to call from Action().
    */
   bool cancelled();
 
@@ -247,9 +305,17 @@ private:
    */
   void set_status(const Task::Status& status);
 
-  Status status_;
+  /**
+   * @brief Shared by the Task and the runnables queued to run its Action(), which may outlive it
+   */
+  struct RunState;
 
-  TaskThread thread_;
+  /**
+   * @brief Runnable queued on a thread pool to run Action()
+   */
+  class Runner;
+
+  Status status_;
 
   QString text_;
 
@@ -257,13 +323,27 @@ private:
 
   QList<Task*> dependencies_;
 
-  bool cancelled_;
+  Category category_;
+
+  QString device_;
+
+  int priority_;
+
+  QAtomicInt cancelled_;
+
+  std::shared_ptr<RunState> run_state_;
+
+  /**
+   * @brief Incremented every time the Task starts, so Action() from a previous run (e.g. before ResetState()) isn't
+   * run or reported
+   */
+  QAtomicInt run_generation_;
 
 private slots:
   /**
-   * @brief A slot when the inner thread completes either successfully or unsuccessfully
+   * @brief A slot when Action() completes either successfully or unsuccessfully
    */
-  void ThreadComplete();
+  void ActionComplete(int generation, bool succeeded);
 };
 
 using TaskPtr = std::shared_ptr<Task>;
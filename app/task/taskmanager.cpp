@@ -21,18 +21,25 @@
 #include "taskmanager.h"
 
 #include <QDebug>
+#include <QStorageInfo>
 #include <QThread>
 
+#include "common/filefunctions.h"
+#include "config/config.h"
+
 TaskManager olive::task_manager;
 
 TaskManager::TaskManager()
 {
-  maximum_task_count_ = QThread::idealThreadCount();
+  cpu_pool_.setMaxThreadCount(QThread::idealThreadCount());
+  io_pool_.setMaxThreadCount(kMaximumConcurrentIOTasks);
 }
 
 TaskManager::~TaskManager()
 {
   Clear();
+
+  qDeleteAll(device_pools_);
 }
 
 void TaskManager::AddTask(TaskPtr t)
@@ -41,52 +48,68 @@ void TaskManager::AddTask(TaskPtr t)
   connect(t.get(), SIGNAL(StatusChanged(Task::Status)), this, SLOT(TaskCallback(Task::Status)));
 
   // Add the Task to the queue
-  tasks_.append(t);
+  tasks_.insert(t.get(), t);
 
   // Emit signal that a Task was added
   emit TaskAdded(t.get());
 
-  // Scan through queue and start any Tasks that can (including this one)
-  StartNextWaiting();
+  // Count the dependencies this Task still has to wait for
+  int pending = 0;
+
+  foreach (Task* dependency, t->dependencies()) {
+    if (dependency->status() == Task::kWaiting || dependency->status() == Task::kWorking) {
+      pending++;
+
+      dependents_[dependency].append(t.get());
+
+      connect(dependency, SIGNAL(Finished()), this, SLOT(DependencyFinished()), Qt::UniqueConnection);
+    }
+  }
+
+  if (pending > 0) {
+    pending_dependencies_.insert(t.get(), pending);
+  } else {
+    t->Start();
+  }
 }
 
 void TaskManager::Clear()
 {
   // Delete Tasks from memory
-  for (int i=0;i<tasks_.size();i++) {
-    tasks_.at(i)->Cancel();
+  foreach (TaskPtr t, tasks_) {
+    t->Cancel();
   }
   tasks_.clear();
+  pending_dependencies_.clear();
+  dependents_.clear();
 }
 
-void TaskManager::StartNextWaiting()
+QThreadPool *TaskManager::thread_pool(Task::Category category, const QString &device)
 {
-  // Count the tasks that are currently active
-  int working_count = 0;
-
-  for (int i=0;i<tasks_.size();i++) {
-    TaskPtr t = tasks_.at(i);
-
-    if (t->status() == Task::kWorking) {
-
-      // Task is active, add it to the count
-      working_count++;
-
-    } else if (t->status() == Task::kWaiting) {
-
-      // Task is waiting and we have available threads, try to start it
-      if (t->Start()) {
-        // If it started, add it to the working count
-        working_count++;
+  switch (category) {
+  case Task::kCategoryIO:
+    if (!device.isEmpty()) {
+      QThreadPool*& pool = device_pools_[device];
+
+      if (pool == nullptr) {
+        pool = new QThreadPool();
+
+        if (IsNetworkFileSystem(QStorageInfo(device).fileSystemType())) {
+          pool->setMaxThreadCount(kMaximumConcurrentIOTasksPerNetworkDevice);
+        } else {
+          pool->setMaxThreadCount(kMaximumConcurrentIOTasksPerDevice);
+        }
       }
 
+      return pool;
     }
 
-    // Check if the count exceeds our maximum threads, if so stop here
-    if (working_count == maximum_task_count_) {
-      break;
-    }
+    return &io_pool_;
+  case Task::kCategoryCPU:
+    break;
   }
+
+  return &cpu_pool_;
 }
 
 void TaskManager::DeleteTask(Task *t)
@@ -94,25 +117,59 @@ void TaskManager::DeleteTask(Task *t)
   // Cancel the task
   t->Cancel();
 
-  // Remove instances of Task from queue
-  for (int i=0;i<tasks_.size();i++) {
-    if (tasks_.at(i).get() == t) {
-      emit t->Removed();
-      tasks_.removeAt(i);
-      break;
+  // Stop tracking the Task's dependencies and dependents
+  pending_dependencies_.remove(t);
+
+  if (dependents_.remove(t) > 0) {
+    disconnect(t, SIGNAL(Finished()), this, SLOT(DependencyFinished()));
+  }
+
+  foreach (Task* dependency, t->dependencies()) {
+    QHash<Task*, QList<Task*> >::iterator it = dependents_.find(dependency);
+
+    if (it != dependents_.end()) {
+      it.value().removeAll(t);
     }
   }
+
+  // Remove Task from queue
+  TaskPtr task = tasks_.take(t);
+
+  if (task) {
+    emit t->Removed();
+  }
 }
 
 void TaskManager::TaskCallback(Task::Status status)
 {
-  if (status == Task::kFinished || status == Task::kError) {
-    // The Task has finished, we can start a new one
-    StartNextWaiting();
+  if (status == Task::kFinished) {
+    // The Task was successful, remove this Task from the queue
+    DeleteTask(static_cast<Task*>(sender()));
+  }
+}
+
+void TaskManager::DependencyFinished()
+{
+  Task* dependency = static_cast<Task*>(sender());
+
+  disconnect(dependency, SIGNAL(Finished()), this, SLOT(DependencyFinished()));
+
+  QList<Task*> waiting = dependents_.take(dependency);
+
+  foreach (Task* t, waiting) {
+    QHash<Task*, int>::iterator it = pending_dependencies_.find(t);
+
+    if (it == pending_dependencies_.end()) {
+      continue;
+    }
+
+    it.value()--;
+
+    if (it.value() == 0) {
+      pending_dependencies_.erase(it);
 
-    if (status == Task::kFinished) {
-      // The Task was successful, remove this Task from the queue
-      DeleteTask(static_cast<Task*>(sender()));
+      // If the dependency failed, this sets the Task's error instead of starting it
+      t->Start();
     }
   }
 }
@@ -21,7 +21,8 @@
 #ifndef TASKMANAGER_H
 #define TASKMANAGER_H
 
-#include <QVector>
+#include <QHash>
+#include <QThreadPool>
 #include <QUndoCommand>
 
 #include "task/task.h"
@@ -30,9 +31,13 @@
  * @brief An object that manages background Task objects, handling their start and end
  *
  * TaskManager handles the life of a Task object. After a new Task is created, it should be sent to TaskManager through
- * AddTask(). TaskManager will take ownership of the task and add it to a queue until it system resources are available
- * for it to run. Currently, TaskManager will run no more Tasks than there are threads on the system (one task per
- * thread). As Tasks finished, TaskManager will start the next in the queue.
+ * AddTask(). TaskManager will take ownership of the task and start it as soon as all of its dependencies have finished.
+ * Each Task keeps a count of its unfinished dependencies which is decremented as they finish, so nothing has to scan
+ * the queue to find what can start next.
+ *
+ * Started Tasks run on the thread pool for their Task::Category, which bounds how many actually run at once (as many
+ * as there are threads on the system for CPU Tasks, fewer for I/O Tasks) and hands threads to higher priority Tasks
+ * first.
  */
 class TaskManager : public QObject
 {
@@ -92,6 +97,19 @@ public:
    */
   void Clear();
 
+  /**
+   * @brief The thread pool that Tasks of this category run on
+   *
+   * Tasks started outside of TaskManager (e.g. with Task::Start() directly) run on these too.
+   *
+   * I/O Tasks with a Task::device() get a pool of their own for each device, created the first time it's needed. Its
+   * size is tuned to the device's file system, network mounts get fewer threads than local disks since each request
+   * costs a round trip.
+   *
+   * Like AddTask, this function is NOT thread-safe and currently only intended to be run from the main thread.
+   */
+  QThreadPool* thread_pool(Task::Category category, const QString& device = QString());
+
   /**
    * @brief Undoable command for adding a Task to the TaskManager
    */
@@ -129,19 +147,6 @@ signals:
   void TaskAdded(Task* t);
 
 private:
-  /**
-   * @brief Scan through the task queue and start any Tasks that are able to start
-   *
-   * This function is run whenever a Task is added and whenever a Task finishes. It determines how many Tasks are
-   * currently running and therefore how many Tasks can be started (if any). It will then start ones that can.
-   *
-   * This function is aware of "dependency Tasks" and if a Task is waiting but has a dependency that hasn't finished,
-   * it will skip to the next one.
-   *
-   * Like AddTask, this function is NOT thread-safe and currently only intended to be run from the main thread.
-   */
-  void StartNextWaiting();
-
   /**
    * @brief Removes the Task from the queue and deletes it
    *
@@ -154,16 +159,28 @@ private:
   void DeleteTask(Task* t);
 
   /**
-   * @brief Internal task array
+   * @brief Internal task map
    */
-  QVector<TaskPtr> tasks_;
+  QHash<Task*, TaskPtr> tasks_;
 
   /**
-   * @brief Constant set at run-time of how many Tasks can run concurrently
-   *
-   * Currently set in the Constructor to QThread::idealThreadCount()
+   * @brief How many dependencies each added Task that hasn't started yet is still waiting on
    */
-  int maximum_task_count_;
+  QHash<Task*, int> pending_dependencies_;
+
+  /**
+   * @brief Added Tasks that are waiting on each Task
+   */
+  QHash<Task*, QList<Task*> > dependents_;
+
+  QThreadPool cpu_pool_;
+
+  QThreadPool io_pool_;
+
+  /**
+   * @brief I/O thread pools for each Task::device()
+   */
+  QHash<QString, QThreadPool*> device_pools_;
 
 private slots:
   /**
@@ -178,6 +195,11 @@ private slots:
    */
   void TaskCallback(Task::Status status);
 
+  /**
+   * @brief Callback when a Task that others depend on finishes, starts any that were only waiting on it
+   */
+  void DependencyFinished();
+
 };
 
 namespace olive {
@@ -0,0 +1,139 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "waveform.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#include "decoder/decoder.h"
+#include "decoder/waveform.h"
+#include "project/item/footage/audiostream.h"
+
+/**
+ * @brief Length (in seconds) of the audio retrieved from the decoder at a time
+ */
+const int kWaveformChunkLength = 10;
+
+WaveformTask::WaveformTask(FootagePtr footage) :
+  footage_(footage)
+{
+  QString base_filename = QFileInfo(footage_->filename()).fileName();
+
+  set_text(tr("Generating waveform for \"%1\"").arg(base_filename));
+}
+
+bool WaveformTask::Action()
+{
+  footage_->LockDeletes();
+
+  QList<StreamPtr> streams;
+
+  for (int i=0;i<footage_->stream_count();i++) {
+    if (footage_->stream(i)->type() == Stream::kAudio) {
+      streams.append(footage_->stream(i));
+    }
+  }
+
+  bool result = true;
+
+  for (int i=0;i<streams.size() && !cancelled();i++) {
+    if (!BuildWaveform(streams.at(i), i, streams.size())) {
+      set_error(tr("Failed to generate waveform for stream %1").arg(streams.at(i)->index()));
+      result = false;
+    }
+  }
+
+  footage_->UnlockDeletes();
+
+  return result;
+}
+
+bool WaveformTask::BuildWaveform(StreamPtr stream, int stream_number, int stream_count)
+{
+  QString filename = Waveform::GetFilename(stream.get());
+
+  // Nothing to do if this stream already has a waveform
+  if (Waveform::Load(filename) != nullptr) {
+    return true;
+  }
+
+  AudioStream* audio_stream = static_cast<AudioStream*>(stream.get());
+
+  if (stream->duration() <= 0 || audio_stream->sample_rate() <= 0) {
+    // Without a duration we can't tell where the audio ends (decoders pad past the end with silence)
+    return false;
+  }
+
+  DecoderPtr decoder = Decoder::CreateFromID(footage_->decoder());
+
+  if (decoder == nullptr) {
+    return false;
+  }
+
+  decoder->set_stream(stream);
+
+  if (!decoder->Open()) {
+    return false;
+  }
+
+  int sample_rate = audio_stream->sample_rate();
+
+  int64_t total_samples = qRound64(rational(stream->duration() * stream->timebase().numerator(),
+                                            stream->timebase().denominator()).toDouble() * sample_rate);
+
+  WaveformBuilder builder(audio_stream->channels(), sample_rate);
+
+  // Retrieving contiguous windows means the decoder only ever decodes forward
+  int samples_per_chunk = kWaveformChunkLength * sample_rate;
+
+  for (int64_t i=0;i<total_samples && !cancelled();i+=samples_per_chunk) {
+    int chunk_length = static_cast<int>(qMin(static_cast<int64_t>(samples_per_chunk), total_samples - i));
+
+    FramePtr frame = decoder->Retrieve(rational(i, sample_rate), rational(chunk_length, sample_rate));
+
+    if (frame == nullptr) {
+      decoder->Close();
+      return false;
+    }
+
+    builder.AddSamples(frame->const_data(), static_cast<olive::SampleFormat>(frame->format()), frame->sample_count());
+
+    emit ProgressChanged(static_cast<int>((stream_number * 100 + (i * 100 / total_samples)) / stream_count));
+  }
+
+  decoder->Close();
+
+  if (cancelled()) {
+    return true;
+  }
+
+  // Write to a temporary file first so that painters never map a half-written waveform
+  QString partial_filename = filename;
+  partial_filename.append(QStringLiteral(".partial"));
+
+  if (!builder.Save(partial_filename)) {
+    return false;
+  }
+
+  QFile::remove(filename);
+
+  return QFile::rename(partial_filename, filename);
+}
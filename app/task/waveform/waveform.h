@@ -0,0 +1,56 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef WAVEFORMTASK_H
+#define WAVEFORMTASK_H
+
+#include "project/item/footage/footage.h"
+#include "task/task.h"
+
+/**
+ * @brief A background task for building the waveforms of a Footage file's audio streams
+ *
+ * Each audio stream is decoded once from start to finish and summarized into a Waveform file that the timeline can
+ * paint from without decoding anything. Streams that already have a waveform are skipped.
+ *
+ * Like IndexTask, this is created by ImportTask once the Footage has been probed.
+ */
+class WaveformTask : public Task
+{
+  Q_OBJECT
+public:
+  WaveformTask(FootagePtr footage);
+
+  virtual bool Action() override;
+
+private:
+  /**
+   * @brief Decode one audio stream and save its waveform
+   *
+   * @return
+   *
+   * TRUE on success or if the task was cancelled, FALSE on failure.
+   */
+  bool BuildWaveform(StreamPtr stream, int stream_number, int stream_count);
+
+  FootagePtr footage_;
+};
+
+#endif // WAVEFORMTASK_H
@@ -1,3 +1,224 @@
 #include "undostack.h"
 
-QUndoStack olive::undo_stack;
+#include "config/config.h"
+
+UndoStack olive::undo_stack;
+
+UndoStack::UndoStack() :
+  index_(0),
+  memory_usage_(0),
+  memory_budget_(kUndoMemoryBudget),
+  memory_tracker_(MemoryStats::kUndo)
+{
+  memory_tracker_.Set(0, 0);
+}
+
+UndoStack::~UndoStack()
+{
+  clear();
+}
+
+void UndoStack::push(QUndoCommand *command)
+{
+  command->redo();
+
+  DeleteRedoableCommands();
+
+  // Offer the command to the one on top of the stack to merge into it like QUndoStack does
+  if (index_ > 0
+      && command->id() != -1
+      && commands_.last().command->id() == command->id()
+      && commands_.last().command->mergeWith(command)) {
+    delete command;
+
+    Entry& top = commands_.last();
+
+    memory_usage_ -= top.memory_usage;
+    top.memory_usage = CommandMemoryUsage(top.command);
+    memory_usage_ += top.memory_usage;
+  } else {
+    Entry entry;
+    entry.command = command;
+    entry.memory_usage = CommandMemoryUsage(command);
+
+    commands_.append(entry);
+    memory_usage_ += entry.memory_usage;
+    index_++;
+  }
+
+  Trim();
+
+  memory_tracker_.Set(memory_usage_, commands_.size());
+
+  UpdateActions();
+}
+
+void UndoStack::clear()
+{
+  foreach (const Entry& entry, commands_) {
+    delete entry.command;
+  }
+
+  commands_.clear();
+  index_ = 0;
+  memory_usage_ = 0;
+
+  memory_tracker_.Set(0, 0);
+
+  UpdateActions();
+}
+
+bool UndoStack::canUndo() const
+{
+  return (index_ > 0);
+}
+
+bool UndoStack::canRedo() const
+{
+  return (index_ < commands_.size());
+}
+
+QString UndoStack::undoText() const
+{
+  return canUndo() ? commands_.at(index_ - 1).command->actionText() : QString();
+}
+
+QString UndoStack::redoText() const
+{
+  return canRedo() ? commands_.at(index_).command->actionText() : QString();
+}
+
+QAction *UndoStack::createUndoAction(QObject *parent)
+{
+  QAction* action = new QAction(parent);
+
+  connect(action, SIGNAL(triggered()), this, SLOT(undo()));
+  connect(action, SIGNAL(destroyed(QObject*)), this, SLOT(ActionDestroyed(QObject*)));
+
+  undo_actions_.append(action);
+
+  UpdateActions();
+
+  return action;
+}
+
+QAction *UndoStack::createRedoAction(QObject *parent)
+{
+  QAction* action = new QAction(parent);
+
+  connect(action, SIGNAL(triggered()), this, SLOT(redo()));
+  connect(action, SIGNAL(destroyed(QObject*)), this, SLOT(ActionDestroyed(QObject*)));
+
+  redo_actions_.append(action);
+
+  UpdateActions();
+
+  return action;
+}
+
+qint64 UndoStack::memory_usage() const
+{
+  return memory_usage_;
+}
+
+qint64 UndoStack::memory_budget() const
+{
+  return memory_budget_;
+}
+
+void UndoStack::set_memory_budget(qint64 budget)
+{
+  memory_budget_ = budget;
+
+  Trim();
+
+  memory_tracker_.Set(memory_usage_, commands_.size());
+
+  UpdateActions();
+}
+
+void UndoStack::undo()
+{
+  if (!canUndo()) {
+    return;
+  }
+
+  index_--;
+
+  commands_.at(index_).command->undo();
+
+  UpdateActions();
+}
+
+void UndoStack::redo()
+{
+  if (!canRedo()) {
+    return;
+  }
+
+  commands_.at(index_).command->redo();
+
+  index_++;
+
+  UpdateActions();
+}
+
+qint64 UndoStack::CommandMemoryUsage(const QUndoCommand *command)
+{
+  const UndoCommandMemory* measured = dynamic_cast<const UndoCommandMemory*>(command);
+
+  if (measured != nullptr) {
+    return measured->memory_usage();
+  }
+
+  return kDefaultCommandMemory * (1 + command->childCount());
+}
+
+void UndoStack::DeleteRedoableCommands()
+{
+  while (commands_.size() > index_) {
+    Entry entry = commands_.takeLast();
+
+    memory_usage_ -= entry.memory_usage;
+
+    delete entry.command;
+  }
+}
+
+void UndoStack::Trim()
+{
+  // Only commands that are done can be deleted from the bottom of the stack, and the last one is always kept
+  while (memory_usage_ > memory_budget_ && index_ > 1) {
+    Entry entry = commands_.takeFirst();
+
+    memory_usage_ -= entry.memory_usage;
+    index_--;
+
+    delete entry.command;
+  }
+}
+
+void UndoStack::UpdateActions()
+{
+  QString undo_text = undoText();
+  QString redo_text = redoText();
+
+  foreach (QAction* action, undo_actions_) {
+    action->setEnabled(canUndo());
+    action->setText(undo_text.isEmpty() ? tr("Undo") : tr("Undo %1").arg(undo_text));
+  }
+
+  foreach (QAction* action, redo_actions_) {
+    action->setEnabled(canRedo());
+    action->setText(redo_text.isEmpty() ? tr("Redo") : tr("Redo %1").arg(redo_text));
+  }
+
+  emit canUndoChanged(canUndo());
+  emit canRedoChanged(canRedo());
+}
+
+void UndoStack::ActionDestroyed(QObject *object)
+{
+  undo_actions_.removeAll(static_cast<QAction*>(object));
+  redo_actions_.removeAll(static_cast<QAction*>(object));
+}
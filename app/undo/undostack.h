@@ -1,13 +1,160 @@
 #ifndef UNDOSTACK_H
 #define UNDOSTACK_H
 
-#include <QUndoStack>
+#include <QAction>
+#include <QList>
+#include <QUndoCommand>
+
+#include "common/memorystats.h"
+
+/**
+ * @brief Implemented by QUndoCommands that can tell roughly how much memory they keep alive
+ *
+ * UndoStack counts commands that don't implement this as kDefaultCommandMemory bytes each.
+ */
+class UndoCommandMemory
+{
+public:
+  virtual ~UndoCommandMemory() = default;
+
+  /**
+   * @brief Approximate number of bytes this command (including its children) keeps alive
+   */
+  virtual qint64 memory_usage() const = 0;
+};
+
+/**
+ * @brief A stack of QUndoCommands whose history is limited by how much memory it keeps alive
+ *
+ * A drop-in replacement for QUndoStack (with the same names for the parts Olive uses), except that QUndoStack keeps
+ * every command forever, along with everything they refer to. Once the commands in this stack use more than
+ * memory_budget(), the oldest ones that can be undone are deleted until they fit again (the most recent command is
+ * always kept).
+ *
+ * Like QUndoStack, a command pushed with the same id() as the one on top of the stack is offered to it with
+ * QUndoCommand::mergeWith(), so commands that happen in quick succession (e.g. every step of dragging a slider) can
+ * be kept as a single command.
+ */
+class UndoStack : public QObject
+{
+  Q_OBJECT
+public:
+  /**
+   * @brief Default memory_usage() of commands that don't implement UndoCommandMemory
+   */
+  static const qint64 kDefaultCommandMemory = 1024;
+
+  UndoStack();
+
+  virtual ~UndoStack() override;
+
+  /**
+   * @brief Run a command and add it to the stack, which takes ownership of it
+   *
+   * Any commands that were undone are deleted, since they can no longer be redone.
+   */
+  void push(QUndoCommand* command);
+
+  /**
+   * @brief Delete every command
+   */
+  void clear();
+
+  bool canUndo() const;
+  bool canRedo() const;
+
+  QString undoText() const;
+  QString redoText() const;
+
+  /**
+   * @brief Create an action that undoes the last command and is kept up to date with its text
+   */
+  QAction* createUndoAction(QObject* parent);
+
+  /**
+   * @brief Create an action that redoes the last undone command and is kept up to date with its text
+   */
+  QAction* createRedoAction(QObject* parent);
+
+  /**
+   * @brief Approximate number of bytes all the commands in the stack keep alive
+   */
+  qint64 memory_usage() const;
+
+  /**
+   * @brief Number of bytes the commands may keep alive before the oldest are deleted
+   */
+  qint64 memory_budget() const;
+  void set_memory_budget(qint64 budget);
+
+public slots:
+  void undo();
+
+  void redo();
+
+signals:
+  void canUndoChanged(bool can_undo);
+
+  void canRedoChanged(bool can_redo);
+
+private:
+  struct Entry {
+    QUndoCommand* command;
+
+    /// Memory usage of the command as of when it was pushed (or last merged with)
+    qint64 memory_usage;
+  };
+
+  /**
+   * @brief Return the memory usage of a command, see UndoCommandMemory
+   */
+  static qint64 CommandMemoryUsage(const QUndoCommand* command);
+
+  /**
+   * @brief Delete the commands after index_
+   */
+  void DeleteRedoableCommands();
+
+  /**
+   * @brief Delete the oldest commands until memory_usage() fits in memory_budget()
+   */
+  void Trim();
+
+  /**
+   * @brief Let actions and anything listening know the commands that can be undone or redone changed
+   */
+  void UpdateActions();
+
+  /**
+   * @brief Every command, oldest first
+   */
+  QList<Entry> commands_;
+
+  /**
+   * @brief Number of commands that are done (and can be undone), the rest have been undone
+   */
+  int index_;
+
+  qint64 memory_usage_;
+
+  qint64 memory_budget_;
+
+  MemoryTracker memory_tracker_;
+
+  QList<QAction*> undo_actions_;
+
+  QList<QAction*> redo_actions_;
+
+private slots:
+  void ActionDestroyed(QObject* object);
+
+};
 
 namespace olive {
 /**
  * @brief A static undo stack for undoable commands throughout Olive
  */
-extern QUndoStack undo_stack;
+extern UndoStack undo_stack;
 }
 
 #endif // UNDOSTACK_H
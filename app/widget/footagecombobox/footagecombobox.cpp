@@ -1,12 +1,19 @@
 #include "footagecombobox.h"
 
+#include <algorithm>
 #include <QAction>
 #include <QDebug>
+#include <QLineEdit>
 #include <QMenu>
+#include <QWidgetAction>
+
+#include "config/config.h"
+#include "project/projectsearchindex.h"
 
 FootageComboBox::FootageComboBox(QWidget *parent) :
   QComboBox(parent),
   root_(nullptr),
+  menu_(nullptr),
   footage_(nullptr),
   only_show_ready_footage_(true)
 {
@@ -23,10 +30,29 @@ void FootageComboBox::showPopup()
 
   menu.setMinimumWidth(width());
 
+  // Projects can have far too much footage to browse through in menus, so it can be searched too
+  QLineEdit* search_field = new QLineEdit(&menu);
+  search_field->setPlaceholderText(tr("Search..."));
+  search_field->setClearButtonEnabled(true);
+  connect(search_field, SIGNAL(textChanged(const QString&)), this, SLOT(SearchChanged(const QString&)));
+
+  QWidgetAction* search_action = new QWidgetAction(&menu);
+  search_action->setDefaultWidget(search_field);
+  menu.addAction(search_action);
+
+  menu.addSeparator();
+
   TraverseFolder(root_, &menu);
 
+  // Typing goes straight to the search field
+  menu.setActiveAction(search_action);
+
+  menu_ = &menu;
+
   QAction* selected = menu.exec(parentWidget()->mapToGlobal(pos()));
 
+  menu_ = nullptr;
+
   if (selected != nullptr) {
     // Use combobox functions to show the footage name
     clear();
@@ -89,3 +115,87 @@ void FootageComboBox::TraverseFolder(const Folder *f, QMenu *m)
     }
   }
 }
+
+void FootageComboBox::ListSearchResults(const QString &query)
+{
+  ProjectSearchIndex* index = root_->search_index();
+
+  if (index == nullptr) {
+    TraverseFolder(root_, menu_);
+    return;
+  }
+
+  QList<Footage*> results;
+
+  foreach (Item* item, index->Search(query)) {
+    if (item->type() != Item::kFootage) {
+      continue;
+    }
+
+    // Only list footage inside our root
+    Item* parent = item->parent();
+
+    while (parent != nullptr && parent != root_) {
+      parent = parent->parent();
+    }
+
+    if (parent == nullptr) {
+      continue;
+    }
+
+    Footage* footage = static_cast<Footage*>(item);
+
+    if (!only_show_ready_footage_ || footage->status() == Footage::kReady) {
+      results.append(footage);
+    }
+  }
+
+  if (results.isEmpty()) {
+    menu_->addAction(tr("No matching footage"))->setEnabled(false);
+    return;
+  }
+
+  std::sort(results.begin(), results.end(), [](Footage* a, Footage* b) {
+    return a->name().compare(b->name(), Qt::CaseInsensitive) < 0;
+  });
+
+  int count = qMin(results.size(), kFootageSearchMaxResults);
+
+  for (int i=0;i<count;i++) {
+    QAction* footage_action = menu_->addAction(results.at(i)->name());
+    footage_action->setData(reinterpret_cast<quintptr>(results.at(i)));
+  }
+
+  if (results.size() > count) {
+    menu_->addAction(tr("%1 more, refine the search to see them").arg(results.size() - count))->setEnabled(false);
+  }
+}
+
+void FootageComboBox::SearchChanged(const QString &query)
+{
+  if (menu_ == nullptr) {
+    return;
+  }
+
+  // Remove everything below the search field and separator
+  QList<QAction*> actions = menu_->actions();
+
+  for (int i=2;i<actions.size();i++) {
+    QAction* a = actions.at(i);
+
+    if (a->menu() != nullptr) {
+      // Deleting a submenu deletes its action with it
+      delete a->menu();
+    } else {
+      delete a;
+    }
+  }
+
+  if (query.trimmed().isEmpty()) {
+    TraverseFolder(root_, menu_);
+  } else {
+    ListSearchResults(query);
+  }
+
+  menu_->adjustSize();
+}
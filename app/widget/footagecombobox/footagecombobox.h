@@ -30,11 +30,26 @@ signals:
 private:
   void TraverseFolder(const Folder *f, QMenu* m);
 
+  /**
+   * @brief List the footage matching `query` in menu_ (see ProjectSearchIndex::Search())
+   */
+  void ListSearchResults(const QString& query);
+
   const Folder* root_;
 
+  /// The popup while it's open, its first two actions are the search field and a separator
+  QMenu* menu_;
+
   Footage* footage_;
 
   bool only_show_ready_footage_;
+
+private slots:
+  /**
+   * @brief Replace the popup's contents with the footage matching `query`, or the whole tree if it's empty
+   */
+  void SearchChanged(const QString& query);
+
 };
 
 #endif // FOOTAGECOMBOBOX_H
@@ -0,0 +1,157 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "memoryview.h"
+
+#include <QEvent>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+
+enum MemoryViewColumn {
+  kNameColumn,
+  kObjectsColumn,
+  kPeakObjectsColumn,
+  kSizeColumn,
+  kPeakSizeColumn,
+  kAllocationRateColumn,
+  kByteRateColumn,
+
+  kColumnCount
+};
+
+/**
+ * @brief Convert bytes to megabytes rounded to a hundredth, as a number so it's sorted as one
+ */
+static double ToMegabytes(double bytes)
+{
+  return qRound(bytes / 10485.76) / 100.0;
+}
+
+MemoryView::MemoryView(QWidget *parent) :
+  QWidget(parent)
+{
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->setMargin(0);
+
+  QHBoxLayout* toolbar = new QHBoxLayout();
+  toolbar->addStretch();
+
+  QPushButton* reset_btn = new QPushButton(tr("Reset Peaks"), this);
+  connect(reset_btn, SIGNAL(clicked(bool)), this, SLOT(ResetPeaks()));
+  toolbar->addWidget(reset_btn);
+
+  layout->addLayout(toolbar);
+
+  tree_ = new QTreeWidget(this);
+  tree_->setColumnCount(kColumnCount);
+  tree_->setRootIsDecorated(false);
+  layout->addWidget(tree_);
+
+  for (int i=0;i<MemoryStats::kSubsystemCount;i++) {
+    QTreeWidgetItem* item = new QTreeWidgetItem();
+    item->setText(kNameColumn, MemoryStats::SubsystemName(static_cast<MemoryStats::Subsystem>(i)));
+    tree_->addTopLevelItem(item);
+  }
+
+  update_timer_.setInterval(1000);
+  connect(&update_timer_, SIGNAL(timeout()), this, SLOT(Update()));
+
+  Retranslate();
+}
+
+void MemoryView::showEvent(QShowEvent *e)
+{
+  olive::memory_stats.Enable();
+
+  last_snapshot_ = olive::memory_stats.GetSnapshot();
+  last_snapshot_time_.start();
+
+  update_timer_.start();
+
+  QWidget::showEvent(e);
+}
+
+void MemoryView::hideEvent(QHideEvent *e)
+{
+  olive::memory_stats.Disable();
+  update_timer_.stop();
+
+  QWidget::hideEvent(e);
+}
+
+void MemoryView::changeEvent(QEvent *e)
+{
+  if (e->type() == QEvent::LanguageChange) {
+    Retranslate();
+  }
+  QWidget::changeEvent(e);
+}
+
+void MemoryView::Retranslate()
+{
+  tree_->setHeaderLabels({tr("Subsystem"),
+                          tr("Objects"),
+                          tr("Peak Objects"),
+                          tr("Size (MB)"),
+                          tr("Peak Size (MB)"),
+                          tr("Allocations/s"),
+                          tr("Allocated (MB/s)")});
+
+  for (int i=0;i<MemoryStats::kSubsystemCount;i++) {
+    tree_->topLevelItem(i)->setText(kNameColumn, MemoryStats::SubsystemName(static_cast<MemoryStats::Subsystem>(i)));
+  }
+}
+
+void MemoryView::Update()
+{
+  MemoryStats::Snapshot s = olive::memory_stats.GetSnapshot();
+
+  double seconds = static_cast<double>(last_snapshot_time_.restart()) / 1000.0;
+
+  for (int i=0;i<MemoryStats::kSubsystemCount;i++) {
+    const MemoryStats::Counters& c = s.subsystems[i];
+    const MemoryStats::Counters& last = last_snapshot_.subsystems[i];
+
+    QTreeWidgetItem* item = tree_->topLevelItem(i);
+
+    item->setData(kObjectsColumn, Qt::DisplayRole, c.objects);
+    item->setData(kPeakObjectsColumn, Qt::DisplayRole, c.peak_objects);
+    item->setData(kSizeColumn, Qt::DisplayRole, ToMegabytes(static_cast<double>(c.bytes)));
+    item->setData(kPeakSizeColumn, Qt::DisplayRole, ToMegabytes(static_cast<double>(c.peak_bytes)));
+
+    if (seconds > 0) {
+      double allocations = static_cast<double>(c.allocations - last.allocations) / seconds;
+      double bytes = static_cast<double>(c.allocated_bytes - last.allocated_bytes) / seconds;
+
+      item->setData(kAllocationRateColumn, Qt::DisplayRole, qRound(allocations));
+      item->setData(kByteRateColumn, Qt::DisplayRole, ToMegabytes(bytes));
+    }
+  }
+
+  last_snapshot_ = s;
+}
+
+void MemoryView::ResetPeaks()
+{
+  olive::memory_stats.ResetPeaks();
+
+  Update();
+}
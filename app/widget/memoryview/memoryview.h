@@ -0,0 +1,70 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef MEMORYVIEW_H
+#define MEMORYVIEW_H
+
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QTreeWidget>
+
+#include "common/memorystats.h"
+
+/**
+ * @brief A widget that shows olive::memory_stats, one row per subsystem
+ *
+ * Shows live and peak bytes and objects, along with how fast each subsystem is allocating, which is what grows when
+ * something is leaking or being kept around longer than it should be.
+ *
+ * Accounting is enabled while this widget is visible, so unless Olive was started with `--memory-stats`, only objects
+ * created since it was first shown are counted.
+ */
+class MemoryView : public QWidget
+{
+  Q_OBJECT
+public:
+  MemoryView(QWidget* parent);
+
+protected:
+  virtual void showEvent(QShowEvent* e) override;
+
+  virtual void hideEvent(QHideEvent* e) override;
+
+  virtual void changeEvent(QEvent* e) override;
+
+private:
+  void Retranslate();
+
+  QTreeWidget* tree_;
+
+  QTimer update_timer_;
+
+  /// Snapshot the rates were last calculated from
+  MemoryStats::Snapshot last_snapshot_;
+
+  QElapsedTimer last_snapshot_time_;
+
+private slots:
+  void Update();
+
+  void ResetPeaks();
+};
+
+#endif // MEMORYVIEW_H
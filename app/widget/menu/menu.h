@@ -127,7 +127,7 @@ public:
   /**
    * @brief Conform a QAction to Olive's ID/keydefault system
    *
-   * If a QAction was created elsewhere (e.g. through QUndoStack::createUndoAction()), this function will give it
+   * If a QAction was created elsewhere (e.g. through UndoStack::createUndoAction()), this function will give it
    * properties conforming it to Olive's menu item system
    *
    * @param a
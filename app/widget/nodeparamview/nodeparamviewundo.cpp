@@ -0,0 +1,68 @@
+#include "nodeparamviewundo.h"
+
+#include <QCoreApplication>
+
+namespace {
+
+/// id() of NodeParamSetValueCommand, unique among the commands that are merged
+const int kSetValueCommandID = 1;
+
+}
+
+NodeParamSetValueCommand::NodeParamSetValueCommand(NodeInput *input, const QVariant &value, QUndoCommand *parent) :
+  QUndoCommand(parent),
+  input_(input),
+  new_value_(value)
+{
+  QList<NodeKeyframe> keyframes = input_->keyframes();
+
+  if (!keyframes.isEmpty()) {
+    old_value_ = keyframes.first().value();
+  }
+
+  setText(QCoreApplication::translate("NodeParamSetValueCommand", "Set %1").arg(input_->name()));
+}
+
+int NodeParamSetValueCommand::id() const
+{
+  return kSetValueCommandID;
+}
+
+bool NodeParamSetValueCommand::mergeWith(const QUndoCommand *other)
+{
+  const NodeParamSetValueCommand* command = static_cast<const NodeParamSetValueCommand*>(other);
+
+  if (command->input_ != input_) {
+    return false;
+  }
+
+  new_value_ = command->new_value_;
+
+  return true;
+}
+
+void NodeParamSetValueCommand::redo()
+{
+  input_->set_value(new_value_);
+}
+
+void NodeParamSetValueCommand::undo()
+{
+  input_->set_value(old_value_);
+}
+
+qint64 NodeParamSetValueCommand::memory_usage() const
+{
+  qint64 usage = static_cast<qint64>(sizeof(NodeParamSetValueCommand));
+
+  // Strings are the only values that hold on to more than the QVariant itself
+  if (old_value_.type() == QVariant::String) {
+    usage += old_value_.toString().size() * static_cast<qint64>(sizeof(QChar));
+  }
+
+  if (new_value_.type() == QVariant::String) {
+    usage += new_value_.toString().size() * static_cast<qint64>(sizeof(QChar));
+  }
+
+  return usage;
+}
@@ -0,0 +1,35 @@
+#ifndef NODEPARAMVIEWUNDO_H
+#define NODEPARAMVIEWUNDO_H
+
+#include <QUndoCommand>
+
+#include "node/input.h"
+#include "undo/undostack.h"
+
+/**
+ * @brief An undoable command for setting the value of an input that isn't keyframed
+ *
+ * Only stores the value before and after rather than a copy of the input, and merges with the next command setting
+ * the same input so dragging a slider leaves one command behind instead of one for every step.
+ */
+class NodeParamSetValueCommand : public QUndoCommand, public UndoCommandMemory {
+public:
+  NodeParamSetValueCommand(NodeInput* input, const QVariant& value, QUndoCommand* parent = nullptr);
+
+  virtual int id() const override;
+  virtual bool mergeWith(const QUndoCommand* other) override;
+
+  virtual void redo() override;
+  virtual void undo() override;
+
+  virtual qint64 memory_usage() const override;
+
+private:
+  NodeInput* input_;
+
+  QVariant old_value_;
+
+  QVariant new_value_;
+};
+
+#endif // NODEPARAMVIEWUNDO_H
@@ -4,7 +4,10 @@
 #include <QLineEdit>
 #include <QCheckBox>
 
+#include "config/config.h"
+#include "node/interactiveedit.h"
 #include "node/node.h"
+#include "nodeparamviewundo.h"
 #include "widget/footagecombobox/footagecombobox.h"
 #include "widget/slider/floatslider.h"
 #include "widget/slider/integerslider.h"
@@ -15,8 +18,21 @@
 // End test code
 
 NodeParamViewWidgetBridge::NodeParamViewWidgetBridge(QObject* parent) :
-  QObject(parent)
+  QObject(parent),
+  drag_widget_(nullptr),
+  drag_value_pending_(false)
 {
+  drag_timer_.setSingleShot(true);
+  drag_timer_.setInterval(kParamDragUpdateInterval);
+  connect(&drag_timer_, SIGNAL(timeout()), this, SLOT(DragTimerTimeout()));
+}
+
+NodeParamViewWidgetBridge::~NodeParamViewWidgetBridge()
+{
+  // Don't leave renderers holding back their queues if we're destroyed mid-drag
+  if (drag_widget_ != nullptr) {
+    NodeInteractiveEdit::Get()->End();
+  }
 }
 
 void NodeParamViewWidgetBridge::AddInput(NodeInput *input)
@@ -59,6 +75,7 @@ void NodeParamViewWidgetBridge::CreateWidgets()
     IntegerSlider* slider = new IntegerSlider();
     widgets_.append(slider);
     connect(slider, SIGNAL(ValueChanged(int)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(slider);
     break;
   }
   case NodeParam::kFloat:
@@ -76,68 +93,78 @@ void NodeParamViewWidgetBridge::CreateWidgets()
     }
 
     connect(slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(slider);
 
     widgets_.append(slider);
     break;
   }
   case NodeParam::kVec2:
   {
-    QVector2D vec2 = base_input->get_value(0).value<QVector2D>();
+    QVector2D vec2 = base_input->get_value(0).toVec2();
 
     FloatSlider* x_slider = new FloatSlider();
     x_slider->SetValue(static_cast<double>(vec2.x()));
     widgets_.append(x_slider);
     connect(x_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(x_slider);
 
     FloatSlider* y_slider = new FloatSlider();
     y_slider->SetValue(static_cast<double>(vec2.y()));
     widgets_.append(y_slider);
     connect(y_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(y_slider);
     break;
   }
   case NodeParam::kVec3:
   {
-    QVector3D vec3 = base_input->get_value(0).value<QVector3D>();
+    QVector3D vec3 = base_input->get_value(0).toVec3();
 
     FloatSlider* x_slider = new FloatSlider();
     x_slider->SetValue(static_cast<double>(vec3.x()));
     widgets_.append(x_slider);
     connect(x_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(x_slider);
 
     FloatSlider* y_slider = new FloatSlider();
     y_slider->SetValue(static_cast<double>(vec3.y()));
     widgets_.append(y_slider);
     connect(y_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(y_slider);
 
     FloatSlider* z_slider = new FloatSlider();
     z_slider->SetValue(static_cast<double>(vec3.z()));
     widgets_.append(z_slider);
     connect(z_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(z_slider);
     break;
   }
   case NodeParam::kVec4:
   {
-    QVector4D vec4 = base_input->get_value(0).value<QVector4D>();
+    QVector4D vec4 = base_input->get_value(0).toVec4();
 
     FloatSlider* x_slider = new FloatSlider();
     x_slider->SetValue(static_cast<double>(vec4.x()));
     widgets_.append(x_slider);
     connect(x_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(x_slider);
 
     FloatSlider* y_slider = new FloatSlider();
     y_slider->SetValue(static_cast<double>(vec4.y()));
     widgets_.append(y_slider);
     connect(y_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(y_slider);
 
     FloatSlider* z_slider = new FloatSlider();
     z_slider->SetValue(static_cast<double>(vec4.z()));
     widgets_.append(z_slider);
     connect(z_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(z_slider);
 
     FloatSlider* w_slider = new FloatSlider();
     w_slider->SetValue(static_cast<double>(vec4.w()));
     widgets_.append(w_slider);
     connect(w_slider, SIGNAL(ValueChanged(double)), this, SLOT(WidgetCallback()));
+    ConnectSliderDrag(w_slider);
     break;
   }
   case NodeParam::kFile:
@@ -187,7 +214,63 @@ void NodeParamViewWidgetBridge::CreateWidgets()
   }
 }
 
+void NodeParamViewWidgetBridge::ConnectSliderDrag(SliderBase *slider)
+{
+  connect(slider, SIGNAL(DragStarted()), this, SLOT(SliderDragStarted()));
+  connect(slider, SIGNAL(DragFinished()), this, SLOT(SliderDragFinished()));
+}
+
 void NodeParamViewWidgetBridge::WidgetCallback()
+{
+  if (drag_widget_ == sender()) {
+    // Sliders signal for every pixel they're dragged, only apply the latest value once per update interval
+    if (!drag_timer_.isActive()) {
+      drag_timer_.start();
+    }
+
+    drag_value_pending_ = true;
+    return;
+  }
+
+  ApplyWidgetValue(sender());
+}
+
+void NodeParamViewWidgetBridge::SliderDragStarted()
+{
+  drag_widget_ = sender();
+  drag_value_pending_ = false;
+
+  NodeInteractiveEdit::Get()->Begin();
+}
+
+void NodeParamViewWidgetBridge::SliderDragFinished()
+{
+  if (drag_widget_ != sender()) {
+    return;
+  }
+
+  drag_timer_.stop();
+
+  if (drag_value_pending_) {
+    ApplyWidgetValue(drag_widget_);
+    drag_value_pending_ = false;
+  }
+
+  drag_widget_ = nullptr;
+
+  // Renderers queue the whole range now that the value has settled
+  NodeInteractiveEdit::Get()->End();
+}
+
+void NodeParamViewWidgetBridge::DragTimerTimeout()
+{
+  if (drag_widget_ != nullptr && drag_value_pending_) {
+    ApplyWidgetValue(drag_widget_);
+    drag_value_pending_ = false;
+  }
+}
+
+void NodeParamViewWidgetBridge::ApplyWidgetValue(QObject *widget)
 {
   foreach (NodeInput* input, inputs_) {
     switch (input->data_type()) {
@@ -203,23 +286,23 @@ void NodeParamViewWidgetBridge::WidgetCallback()
     case NodeParam::kInt:
     {
       // Widget is a IntegerSlider
-      IntegerSlider* int_slider = static_cast<IntegerSlider*>(sender());
-      input->set_value(int_slider->GetValue());
+      IntegerSlider* int_slider = static_cast<IntegerSlider*>(widget);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, int_slider->GetValue()));
       break;
     }
     case NodeParam::kFloat:
     {
       // Widget is a FloatSlider
-      FloatSlider* float_slider = static_cast<FloatSlider*>(sender());
-      input->set_value(float_slider->GetValue());
+      FloatSlider* float_slider = static_cast<FloatSlider*>(widget);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, float_slider->GetValue()));
       break;
     }
     case NodeParam::kVec2:
     {
       // Widgets are two FloatSliders
-      FloatSlider* slider = static_cast<FloatSlider*>(sender());
+      FloatSlider* slider = static_cast<FloatSlider*>(widget);
 
-      QVector2D val = input->get_value(0).value<QVector2D>();
+      QVector2D val = input->get_value(0).toVec2();
 
       if (slider == widgets_.at(0)) {
         // Slider is X slider
@@ -229,15 +312,15 @@ void NodeParamViewWidgetBridge::WidgetCallback()
         val.setY(static_cast<float>(slider->GetValue()));
       }
 
-      input->set_value(val);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, val));
       break;
     }
     case NodeParam::kVec3:
     {
       // Widgets are three FloatSliders
-      FloatSlider* slider = static_cast<FloatSlider*>(sender());
+      FloatSlider* slider = static_cast<FloatSlider*>(widget);
 
-      QVector3D val = input->get_value(0).value<QVector3D>();
+      QVector3D val = input->get_value(0).toVec3();
 
       if (slider == widgets_.at(0)) {
         // Slider is X slider
@@ -250,15 +333,15 @@ void NodeParamViewWidgetBridge::WidgetCallback()
         val.setZ(static_cast<float>(slider->GetValue()));
       }
 
-      input->set_value(val);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, val));
       break;
     }
     case NodeParam::kVec4:
     {
       // Widgets are three FloatSliders
-      FloatSlider* slider = static_cast<FloatSlider*>(sender());
+      FloatSlider* slider = static_cast<FloatSlider*>(widget);
 
-      QVector4D val = input->get_value(0).value<QVector4D>();
+      QVector4D val = input->get_value(0).toVec4();
 
       if (slider == widgets_.at(0)) {
         // Slider is X slider
@@ -274,7 +357,7 @@ void NodeParamViewWidgetBridge::WidgetCallback()
         val.setW(static_cast<float>(slider->GetValue()));
       }
 
-      input->set_value(val);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, val));
       break;
     }
     case NodeParam::kFile:
@@ -286,29 +369,30 @@ void NodeParamViewWidgetBridge::WidgetCallback()
     case NodeParam::kString:
     {
       // Sender is a QLineEdit
-      QLineEdit* line_edit = static_cast<QLineEdit*>(sender());
-      input->set_value(line_edit->text());
+      QLineEdit* line_edit = static_cast<QLineEdit*>(widget);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, line_edit->text()));
       break;
     }
     case NodeParam::kBoolean:
     {
       // Widget is a QCheckBox
-      QCheckBox* check_box = static_cast<QCheckBox*>(sender());
-      input->set_value(check_box->isChecked());
+      QCheckBox* check_box = static_cast<QCheckBox*>(widget);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, check_box->isChecked()));
       break;
     }
     case NodeParam::kFont:
     {
       // Widget is a QFontComboBox
-      QFontComboBox* font_combobox = static_cast<QFontComboBox*>(sender());
-      input->set_value(font_combobox->currentFont());
+      QFontComboBox* font_combobox = static_cast<QFontComboBox*>(widget);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input, font_combobox->currentFont()));
       break;
     }
     case NodeParam::kFootage:
     {
       // Widget is a FootageComboBox
-      FootageComboBox* footage_combobox = static_cast<FootageComboBox*>(sender());
-      input->set_value(Node::PtrToValue(footage_combobox->SelectedFootage()));
+      FootageComboBox* footage_combobox = static_cast<FootageComboBox*>(widget);
+      olive::undo_stack.push(new NodeParamSetValueCommand(input,
+                                                          Node::PtrToValue(footage_combobox->SelectedFootage())));
       break;
     }
     }
@@ -2,8 +2,10 @@
 #define NODEPARAMVIEWWIDGETBRIDGE_H
 
 #include <QObject>
+#include <QTimer>
 
 #include "node/input.h"
+#include "widget/slider/sliderbase.h"
 
 class NodeParamViewWidgetBridge : public QObject
 {
@@ -11,6 +13,8 @@ class NodeParamViewWidgetBridge : public QObject
 public:
   NodeParamViewWidgetBridge(QObject* parent);
 
+  virtual ~NodeParamViewWidgetBridge() override;
+
   void AddInput(NodeInput* input);
 
   const QList<QWidget*>& widgets();
@@ -22,8 +26,33 @@ private:
 
   void CreateWidgets();
 
+  void ConnectSliderDrag(SliderBase* slider);
+
+  /**
+   * @brief Set every input to the value shown by `widget`
+   */
+  void ApplyWidgetValue(QObject* widget);
+
+  /**
+   * @brief The slider currently being dragged, if any
+   *
+   * Its values are applied at most every kParamDragUpdateInterval milliseconds during the drag (as an interactive
+   * edit, see NodeInteractiveEdit) and once more when it's let go.
+   */
+  QObject* drag_widget_;
+
+  bool drag_value_pending_;
+
+  QTimer drag_timer_;
+
 private slots:
   void WidgetCallback();
+
+  void SliderDragStarted();
+
+  void SliderDragFinished();
+
+  void DragTimerTimeout();
 };
 
 #endif // NODEPARAMVIEWWIDGETBRIDGE_H
@@ -20,6 +20,9 @@
 
 #include "nodeview.h"
 
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
 NodeView::NodeView(QWidget *parent) :
   QGraphicsView(parent),
   graph_(nullptr)
@@ -28,6 +31,10 @@ NodeView::NodeView(QWidget *parent) :
 
   setDragMode(RubberBandDrag);
 
+  // Nodes are found through a BSP tree so that only the ones in the exposed area are drawn or hit-tested. This is
+  // already Qt's default, but it matters enough for large graphs to not leave to chance.
+  scene_.setItemIndexMethod(QGraphicsScene::BspTreeIndex);
+
   connect(&scene_, SIGNAL(changed(const QList<QRectF>&)), this, SLOT(ItemsChanged()));
   connect(&scene_, SIGNAL(selectionChanged()), this, SLOT(SceneSelectionChangedSlot()));
 }
@@ -55,6 +62,8 @@ void NodeView::SetGraph(NodeGraph *graph)
 
   // Clear the scene of all UI objects
   scene_.clear();
+  node_items_.clear();
+  edge_items_.clear();
 
   // Set reference to the graph
   graph_ = graph;
@@ -71,20 +80,23 @@ void NodeView::SetGraph(NodeGraph *graph)
     foreach (Node* node, graph_nodes) {
       AddNode(node);
     }
+
+    // Edges added before the node on their other end existed couldn't be positioned yet
+    ItemsChanged();
   }
+
+  UpdateEdgePath();
 }
 
 NodeViewItem *NodeView::NodeToUIObject(QGraphicsScene *scene, Node *n)
 {
-  QList<QGraphicsItem*> graphics_items = scene->items();
+  QList<QGraphicsView*> views = scene->views();
 
-  for (int i=0;i<graphics_items.size();i++) {
-    NodeViewItem* item = dynamic_cast<NodeViewItem*>(graphics_items.at(i));
+  foreach (QGraphicsView* view, views) {
+    NodeView* node_view = qobject_cast<NodeView*>(view);
 
-    if (item != nullptr) {
-      if (item->node() == n) {
-        return item;
-      }
+    if (node_view != nullptr) {
+      return node_view->node_items_.value(n);
     }
   }
 
@@ -93,15 +105,13 @@ NodeViewItem *NodeView::NodeToUIObject(QGraphicsScene *scene, Node *n)
 
 NodeViewEdge *NodeView::EdgeToUIObject(QGraphicsScene *scene, NodeEdgePtr n)
 {
-  QList<QGraphicsItem*> graphics_items = scene->items();
+  QList<QGraphicsView*> views = scene->views();
 
-  for (int i=0;i<graphics_items.size();i++) {
-    NodeViewEdge* edge = dynamic_cast<NodeViewEdge*>(graphics_items.at(i));
+  foreach (QGraphicsView* view, views) {
+    NodeView* node_view = qobject_cast<NodeView*>(view);
 
-    if (edge != nullptr) {
-      if (edge->edge() == n) {
-        return edge;
-      }
+    if (node_view != nullptr) {
+      return node_view->edge_items_.value(n.get());
     }
   }
 
@@ -126,6 +136,8 @@ void NodeView::AddNode(Node* node)
 
   scene_.addItem(item);
 
+  node_items_.insert(node, item);
+
   // Add a NodeViewEdge for each connection
   QList<NodeParam*> node_params = node->parameters();
 
@@ -145,38 +157,51 @@ void NodeView::AddNode(Node* node)
 
 void NodeView::RemoveNode(Node *node)
 {
-  NodeViewItem* item = NodeToUIObject(scene(), node);
-
-  delete item;
+  delete node_items_.take(node);
 }
 
 void NodeView::AddEdge(NodeEdgePtr edge)
 {
   NodeViewEdge* edge_ui = new NodeViewEdge();
 
-  edge_ui->SetEdge(edge);
+  // Hidden since drawBackground() draws it along with every other edge
+  edge_ui->setVisible(false);
 
   scene_.addItem(edge_ui);
+
+  edge_items_.insert(edge.get(), edge_ui);
+
+  edge_ui->SetEdge(edge);
+
+  UpdateEdgePath();
 }
 
 void NodeView::RemoveEdge(NodeEdgePtr edge)
 {
-  NodeViewEdge* edge_ui = EdgeToUIObject(scene(), edge);
+  delete edge_items_.take(edge.get());
 
-  delete edge_ui;
+  UpdateEdgePath();
 }
 
 void NodeView::ItemsChanged()
 {
-  QList<QGraphicsItem*> items = scene_.items();
+  bool edges_moved = false;
+
+  QHash<NodeEdge*, NodeViewEdge*>::const_iterator i;
 
-  foreach (QGraphicsItem* item, items) {
-    NodeViewEdge* edge = dynamic_cast<NodeViewEdge*>(item);
+  for (i=edge_items_.constBegin();i!=edge_items_.constEnd();i++) {
+    QLineF old_line = i.value()->line();
 
-    if (edge != nullptr) {
-      edge->Adjust();
+    i.value()->Adjust();
+
+    if (i.value()->line() != old_line) {
+      edges_moved = true;
     }
   }
+
+  if (edges_moved) {
+    UpdateEdgePath();
+  }
 }
 
 void NodeView::SceneSelectionChangedSlot()
@@ -197,3 +222,45 @@ void NodeView::SceneSelectionChangedSlot()
 
   emit SelectionChanged(selected_nodes);
 }
+
+void NodeView::drawBackground(QPainter *painter, const QRectF &rect)
+{
+  QGraphicsView::drawBackground(painter, rect);
+
+  if (edge_path_.isEmpty() || !edge_path_.controlPointRect().intersects(rect)) {
+    return;
+  }
+
+  // Match the width NodeViewEdge would draw with, but keep lines at least a pixel wide when zoomed out
+  int edge_width = QFontMetrics(font()).height() / 12;
+  qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+
+  QPen edge_pen(palette().color(QPalette::Active, QPalette::Text), edge_width);
+
+  if (lod * edge_width < 1.0) {
+    edge_pen.setWidth(0);
+  }
+
+  painter->setPen(edge_pen);
+  painter->setBrush(Qt::NoBrush);
+  painter->drawPath(edge_path_);
+}
+
+void NodeView::UpdateEdgePath()
+{
+  QPainterPath path;
+
+  QHash<NodeEdge*, NodeViewEdge*>::const_iterator i;
+
+  for (i=edge_items_.constBegin();i!=edge_items_.constEnd();i++) {
+    QLineF line = i.value()->line();
+
+    path.moveTo(line.p1());
+    path.lineTo(line.p2());
+  }
+
+  edge_path_ = path;
+
+  // The edges are part of the background so the scene won't repaint them by itself
+  viewport()->update();
+}
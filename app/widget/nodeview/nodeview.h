@@ -22,6 +22,8 @@
 #define NODEVIEW_H
 
 #include <QGraphicsView>
+#include <QHash>
+#include <QPainterPath>
 
 #include "node/graph.h"
 #include "widget/nodeview/nodeviewedge.h"
@@ -82,11 +84,40 @@ signals:
    */
   void SelectionChanged(QList<Node*> selected_nodes);
 
+protected:
+  /**
+   * @brief Draws every edge in the graph as one batched path behind the nodes
+   */
+  virtual void drawBackground(QPainter *painter, const QRectF &rect) override;
+
 private:
+  /**
+   * @brief Replace edge_path_ with the current lines of every edge
+   */
+  void UpdateEdgePath();
+
   NodeGraph* graph_;
 
   QGraphicsScene scene_;
 
+  /**
+   * @brief Items for each Node so NodeToUIObject() doesn't need to search the scene
+   */
+  QHash<Node*, NodeViewItem*> node_items_;
+
+  /**
+   * @brief Items for each edge so EdgeToUIObject() doesn't need to search the scene
+   *
+   * These items are hidden and only used for their geometry, with drawBackground() drawing all of them at once.
+   * Painting a separate item per edge gets very slow in graphs with thousands of them.
+   */
+  QHash<NodeEdge*, NodeViewEdge*> edge_items_;
+
+  /**
+   * @brief Lines of every edge in edge_items_
+   */
+  QPainterPath edge_path_;
+
 private slots:
   /**
    * @brief Slot when a Node is added to a graph (SetGraph() connects this)
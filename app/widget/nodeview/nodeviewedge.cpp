@@ -83,6 +83,11 @@ void NodeViewEdge::Adjust()
   NodeViewItem* output = NodeView::NodeToUIObject(scene(), edge_->output()->parent());
   NodeViewItem* input = NodeView::NodeToUIObject(scene(), edge_->input()->parent());
 
+  // One of the nodes may not have been added to the view yet
+  if (output == nullptr || input == nullptr) {
+    return;
+  }
+
   // Create initial values
   QPointF output_point = QPointF(output->pos().x() + output->rect().width(), 0);
   QPointF input_point = QPointF(input->pos().x(), 0);
@@ -34,6 +34,11 @@
 #include "undo/undostack.h"
 #include "window/mainwindow/mainwindow.h"
 
+/**
+ * @brief Level of detail (see QStyleOptionGraphicsItem::levelOfDetailFromTransform()) to draw nodes as plain boxes at
+ */
+const qreal kSimplifiedDetailLevel = 0.4;
+
 NodeViewItem::NodeViewItem(QGraphicsItem *parent) :
   QGraphicsRectItem(parent),
   node_(nullptr),
@@ -175,6 +180,23 @@ void NodeViewItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *opti
 
   QBrush connector_brush(app_pal.color(QPalette::Text));
 
+  // When zoomed far enough out that text would be unreadable, just draw a box so large graphs stay fast to paint
+  qreal lod = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+
+  if (lod < kSimplifiedDetailLevel) {
+    if (option->state & QStyle::State_Selected) {
+      border_pen.setColor(app_pal.color(QPalette::Highlight));
+    }
+
+    // Cosmetic pen so the border doesn't disappear at low zoom levels
+    border_pen.setWidth(0);
+
+    painter->setPen(border_pen);
+    painter->setBrush(css_proxy_.TitleBarColor());
+    painter->drawRect(rect());
+    return;
+  }
+
   painter->setPen(border_pen);
 
   if (expanded_ && node_ != nullptr) {
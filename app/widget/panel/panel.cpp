@@ -59,6 +59,18 @@ void PanelWidget::PlayPause()
 {
 }
 
+void PanelWidget::ShuttleLeft()
+{
+}
+
+void PanelWidget::ShuttleStop()
+{
+}
+
+void PanelWidget::ShuttleRight()
+{
+}
+
 void PanelWidget::NextFrame()
 {
 }
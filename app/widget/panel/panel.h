@@ -75,6 +75,28 @@ public:
    */
   virtual void PlayPause();
 
+  /**
+   * @brief Called whenever this panel is focused and user uses "Shuttle Left" (either in menus or as a keyboard
+   * shortcut)
+   *
+   * Default behavior is a no-op.
+   */
+  virtual void ShuttleLeft();
+
+  /**
+   * @brief Called whenever this panel is focused and user uses "Shuttle Stop"
+   *
+   * Default behavior is a no-op.
+   */
+  virtual void ShuttleStop();
+
+  /**
+   * @brief Called whenever this panel is focused and user uses "Shuttle Right"
+   *
+   * Default behavior is a no-op.
+   */
+  virtual void ShuttleRight();
+
   virtual void NextFrame();
 
   virtual void GoToEnd();
@@ -0,0 +1,198 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "profilerview.h"
+
+#include <algorithm>
+#include <QEvent>
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <QtMath>
+
+#include "config/config.h"
+
+enum ProfilerViewColumn {
+  kNameColumn,
+  kCategoryColumn,
+  kFramesColumn,
+  kAverageColumn,
+  kP99Column,
+
+  kColumnCount
+};
+
+ProfilerView::ProfilerView(QWidget *parent) :
+  QWidget(parent),
+  unknown_frame_(-1.0)
+{
+  QVBoxLayout* layout = new QVBoxLayout(this);
+  layout->setMargin(0);
+
+  QHBoxLayout* toolbar = new QHBoxLayout();
+  toolbar->addStretch();
+
+  QPushButton* clear_btn = new QPushButton(tr("Reset"), this);
+  connect(clear_btn, SIGNAL(clicked(bool)), this, SLOT(Clear()));
+  toolbar->addWidget(clear_btn);
+
+  layout->addLayout(toolbar);
+
+  tree_ = new QTreeWidget(this);
+  tree_->setColumnCount(kColumnCount);
+  tree_->setRootIsDecorated(false);
+  tree_->setSortingEnabled(true);
+  tree_->sortByColumn(kP99Column, Qt::DescendingOrder);
+  layout->addWidget(tree_);
+
+  update_timer_.setInterval(1000);
+  connect(&update_timer_, SIGNAL(timeout()), this, SLOT(Update()));
+
+  Retranslate();
+}
+
+void ProfilerView::Clear()
+{
+  // Drop anything recorded so far too
+  olive::profiler.Collect();
+
+  tree_->clear();
+  rows_.clear();
+}
+
+void ProfilerView::showEvent(QShowEvent *e)
+{
+  olive::profiler.Enable();
+  update_timer_.start();
+
+  QWidget::showEvent(e);
+}
+
+void ProfilerView::hideEvent(QHideEvent *e)
+{
+  olive::profiler.Disable();
+  update_timer_.stop();
+
+  QWidget::hideEvent(e);
+}
+
+void ProfilerView::changeEvent(QEvent *e)
+{
+  if (e->type() == QEvent::LanguageChange) {
+    Retranslate();
+  }
+  QWidget::changeEvent(e);
+}
+
+void ProfilerView::Retranslate()
+{
+  tree_->setHeaderLabels({tr("Name"), tr("Type"), tr("Frames"), tr("Average (ms)"), tr("99th Percentile (ms)")});
+}
+
+void ProfilerView::UpdateRow(ProfilerView::Row *row, const RowKey &key)
+{
+  if (row->item == nullptr) {
+    Profiler::Category category = static_cast<Profiler::Category>(key.first);
+
+    row->item = new QTreeWidgetItem();
+
+    QString name = olive::profiler.SourceLabel(key.second);
+    row->item->setText(kNameColumn, name.isEmpty() ? Profiler::CategoryName(category) : name);
+    row->item->setText(kCategoryColumn, Profiler::CategoryName(category));
+
+    tree_->addTopLevelItem(row->item);
+  }
+
+  QVector<qint64> times;
+  times.reserve(row->frame_times.size());
+
+  qint64 total = 0;
+
+  foreach (qint64 t, row->frame_times) {
+    times.append(t);
+    total += t;
+  }
+
+  std::sort(times.begin(), times.end());
+
+  double average = static_cast<double>(total) / times.size();
+  double p99 = static_cast<double>(times.at(qCeil(times.size() * 0.99) - 1));
+
+  // Round to a hundredth of a millisecond, numbers are set as numbers (rather than text) so they're sorted as such
+  row->item->setData(kFramesColumn, Qt::DisplayRole, times.size());
+  row->item->setData(kAverageColumn, Qt::DisplayRole, qRound(average / 10000.0) / 100.0);
+  row->item->setData(kP99Column, Qt::DisplayRole, qRound(p99 / 10000.0) / 100.0);
+}
+
+void ProfilerView::Update()
+{
+  QVector<Profiler::Sample> samples = olive::profiler.Collect();
+
+  if (samples.isEmpty()) {
+    return;
+  }
+
+  QList<RowKey> changed;
+
+  foreach (const Profiler::Sample& s, samples) {
+    // Time spent waiting for work isn't part of any frame, it's only for traces
+    if (s.category == Profiler::kIdle) {
+      continue;
+    }
+
+    RowKey key(s.category, s.source);
+
+    if (!rows_.contains(key)) {
+      rows_.insert(key, {nullptr, QHash<double, qint64>(), QQueue<double>()});
+    }
+
+    Row& row = rows_[key];
+
+    double frame = s.frame;
+
+    if (frame < 0) {
+      frame = unknown_frame_;
+      unknown_frame_ -= 1.0;
+    }
+
+    if (!row.frame_times.contains(frame)) {
+      row.frame_order.enqueue(frame);
+
+      if (row.frame_order.size() > kProfilerFrameWindow) {
+        row.frame_times.remove(row.frame_order.dequeue());
+      }
+    }
+
+    row.frame_times[frame] += s.self_duration;
+
+    if (!changed.contains(key)) {
+      changed.append(key);
+    }
+  }
+
+  // Don't resort for every row
+  tree_->setSortingEnabled(false);
+
+  foreach (const RowKey& key, changed) {
+    UpdateRow(&rows_[key], key);
+  }
+
+  tree_->setSortingEnabled(true);
+}
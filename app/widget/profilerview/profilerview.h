@@ -0,0 +1,97 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PROFILERVIEW_H
+#define PROFILERVIEW_H
+
+#include <QHash>
+#include <QPair>
+#include <QQueue>
+#include <QTimer>
+#include <QTreeWidget>
+
+#include "render/profiler.h"
+
+/**
+ * @brief A widget that shows where frame time goes, using the samples from olive::profiler
+ *
+ * Each row is a Node (or a kind of work that isn't for any Node, e.g. downloads), with the time it took per frame
+ * averaged over the last frames it was part of along with the 99th percentile, so the one causing dropped frames
+ * stands out even if it's only slow occasionally. Node times are self times, i.e. they exclude the Nodes they depend
+ * on and the work that's listed in its own rows (e.g. a clip's decoding).
+ *
+ * Profiling is only enabled while this widget is visible.
+ */
+class ProfilerView : public QWidget
+{
+  Q_OBJECT
+public:
+  ProfilerView(QWidget* parent);
+
+public slots:
+  /**
+   * @brief Forget every frame seen so far
+   */
+  void Clear();
+
+protected:
+  virtual void showEvent(QShowEvent* e) override;
+
+  virtual void hideEvent(QHideEvent* e) override;
+
+  virtual void changeEvent(QEvent* e) override;
+
+private:
+  struct Row {
+    QTreeWidgetItem* item;
+
+    /// Time spent on each frame in nanoseconds
+    QHash<double, qint64> frame_times;
+
+    /// Frames in the order they were first seen, to forget the oldest
+    QQueue<double> frame_order;
+  };
+
+  /**
+   * @brief Rows are per category and source
+   */
+  using RowKey = QPair<int, int>;
+
+  void Retranslate();
+
+  void UpdateRow(Row* row, const RowKey& key);
+
+  QTreeWidget* tree_;
+
+  QTimer update_timer_;
+
+  QHash<RowKey, Row> rows_;
+
+  /// Stands in for the frame of samples that don't know theirs, so each counts as a frame of its own
+  double unknown_frame_;
+
+private slots:
+  /**
+   * @brief Collect new samples and update the rows
+   */
+  void Update();
+};
+
+#endif // PROFILERVIEW_H
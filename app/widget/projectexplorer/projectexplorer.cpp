@@ -23,13 +23,17 @@
 #include <QDebug>
 #include <QVBoxLayout>
 
+#include "config/config.h"
 #include "projectexplorerdefines.h"
 
 ProjectExplorer::ProjectExplorer(QWidget *parent) :
   QWidget(parent),
   view_type_(olive::TreeView),
-  model_(this)
+  model_(this),
+  sort_model_(this)
 {
+  sort_model_.setSourceModel(&model_);
+
   // Create layout
   QVBoxLayout* layout = new QVBoxLayout(this);
   layout->setSpacing(0);
@@ -57,6 +61,10 @@ ProjectExplorer::ProjectExplorer(QWidget *parent) :
   icon_view_ = new ProjectExplorerIconView(stacked_widget_);
   AddView(icon_view_);
 
+  // Sorting is done by sort_model_, so the tree view's headers can be clicked to sort every view
+  tree_view_->sortByColumn(0, Qt::AscendingOrder);
+  tree_view_->setSortingEnabled(true);
+
   // Set default view to tree view
   set_view_type(olive::TreeView);
 
@@ -66,6 +74,14 @@ ProjectExplorer::ProjectExplorer(QWidget *parent) :
   // Set rename timer timeout
   rename_timer_.setInterval(500);
   connect(&rename_timer_, SIGNAL(timeout()), this, SLOT(RenameTimerSlot()));
+
+  search_timer_.setInterval(kProjectSearchRefreshInterval);
+  search_timer_.setSingleShot(true);
+  connect(&search_timer_, SIGNAL(timeout()), this, SLOT(RunSearch()));
+
+  // Fetches one batch of results per event loop iteration so the view stays responsive
+  search_fetch_timer_.setInterval(0);
+  connect(&search_fetch_timer_, SIGNAL(timeout()), this, SLOT(FetchSearchResults()));
 }
 
 const olive::ProjectViewType &ProjectExplorer::view_type()
@@ -96,12 +112,12 @@ void ProjectExplorer::set_view_type(olive::ProjectViewType type)
 
 void ProjectExplorer::Edit(Item *item)
 {
-  CurrentView()->edit(model_.CreateIndexFromItem(item));
+  CurrentView()->edit(sort_model_.mapFromSource(model_.CreateIndexFromItem(item)));
 }
 
 void ProjectExplorer::AddView(QAbstractItemView *view)
 {
-  view->setModel(&model_);
+  view->setModel(&sort_model_);
   view->setEditTriggers(QAbstractItemView::NoEditTriggers);
   connect(view, SIGNAL(DoubleClickedView(const QModelIndex&)), this, SLOT(DoubleClickViewSlot(const QModelIndex&)));
   connect(view, SIGNAL(clicked(const QModelIndex&)), this, SLOT(ItemClickedSlot(const QModelIndex&)));
@@ -119,7 +135,7 @@ void ProjectExplorer::BrowseToFolder(const QModelIndex &index)
 
   // Set navbar text to folder's name
   if (index.isValid()) {
-    Folder* f = static_cast<Folder*>(index.internalPointer());
+    Folder* f = static_cast<Folder*>(sort_model_.GetItemObjectFromIndex(index));
     nav_bar_->set_text(f->name());
   } else {
     // Or set it to an empty string if the index is valid (which means we're browsing to the root directory)
@@ -159,7 +175,7 @@ void ProjectExplorer::DoubleClickViewSlot(const QModelIndex &index)
   if (index.isValid()) {
 
     // Retrieve source item from index
-    Item* i = static_cast<Item*>(index.internalPointer());
+    Item* i = sort_model_.GetItemObjectFromIndex(index);
 
     // If the item is a folder, browse to it
     if (i->CanHaveChildren()
@@ -218,6 +234,80 @@ Project *ProjectExplorer::project()
 void ProjectExplorer::set_project(Project *p)
 {
   model_.set_project(p);
+
+  if (p != nullptr) {
+    // The index can change from other threads too (e.g. while footage is being probed), those calls are queued.
+    // Changes to other projects are harmless, they just rerun the search, and the connection goes with the project.
+    connect(p->search_index(), SIGNAL(Changed()), this, SLOT(SearchIndexChanged()), Qt::UniqueConnection);
+  }
+
+  RunSearch();
+}
+
+void ProjectExplorer::SetSearch(const QString &query)
+{
+  search_query_ = query;
+
+  RunSearch();
+}
+
+void ProjectExplorer::RunSearch()
+{
+  search_timer_.stop();
+  search_fetch_timer_.stop();
+  search_pending_.clear();
+  search_expanded_.clear();
+
+  if (project() == nullptr || search_query_.trimmed().isEmpty()) {
+    sort_model_.ClearSearch();
+    return;
+  }
+
+  search_pending_ = project()->search_index()->Search(search_query_);
+
+  sort_model_.SetSearchResults(search_pending_);
+
+  FetchSearchResults();
+}
+
+void ProjectExplorer::SearchIndexChanged()
+{
+  if (search_query_.trimmed().isEmpty()) {
+    return;
+  }
+
+  // Results waiting to be fetched may have just been removed, so they're only fetched again once the search reruns
+  search_fetch_timer_.stop();
+  search_pending_.clear();
+
+  search_timer_.start();
+}
+
+void ProjectExplorer::FetchSearchResults()
+{
+  int count = qMin(ProjectViewModel::kFetchBatchSize, search_pending_.size());
+
+  for (int i=0;i<count;i++) {
+    Item* item = search_pending_.at(i);
+
+    model_.FetchUpTo(item);
+
+    // Expand the folders the result is in so the tree view shows it
+    for (Item* folder=item->parent();
+         folder!=project()->root() && !search_expanded_.contains(folder);
+         folder=folder->parent()) {
+      tree_view_->expand(sort_model_.mapFromSource(model_.CreateIndexFromItem(folder)));
+      search_expanded_.insert(folder);
+    }
+  }
+
+  search_pending_.remove(0, count);
+
+  if (search_pending_.isEmpty()) {
+    search_fetch_timer_.stop();
+  } else {
+    search_fetch_timer_.start();
+  }
 }
 
 QList<Item *> ProjectExplorer::SelectedItems()
@@ -231,7 +321,7 @@ QList<Item *> ProjectExplorer::SelectedItems()
   for (int i=0;i<index_list.size();i++) {
     const QModelIndex& index = index_list.at(i);
 
-    Item* item = static_cast<Item*>(index.internalPointer());
+    Item* item = sort_model_.GetItemObjectFromIndex(index);
 
     selected_items.append(item);
   }
@@ -21,12 +21,15 @@
 #ifndef PROJECTEXPLORER_H
 #define PROJECTEXPLORER_H
 
+#include <QSet>
 #include <QStackedWidget>
 #include <QTimer>
 #include <QTreeView>
+#include <QVector>
 
 #include "project/project.h"
 #include "project/projectviewmodel.h"
+#include "project/projectviewsortmodel.h"
 #include "project/projectviewtype.h"
 #include "widget/projectexplorer/projectexplorericonview.h"
 #include "widget/projectexplorer/projectexplorerlistview.h"
@@ -78,6 +81,13 @@ public slots:
 
   void Edit(Item* item);
 
+  /**
+   * @brief Only show items matching `query` (see ProjectSearchIndex::Search()), or every item if it's empty
+   *
+   * Results appear in batches as the model fetches them, and the search is rerun as the project changes.
+   */
+  void SetSearch(const QString& query);
+
 signals:
   /**
    * @brief Emitted when an Item is double clicked
@@ -128,10 +138,29 @@ private:
 
   ProjectViewModel model_;
 
+  /**
+   * @brief Sorted version of model_ that the views actually show
+   */
+  ProjectViewSortModel sort_model_;
+
   QModelIndex clicked_index_;
 
   QTimer rename_timer_;
 
+  QString search_query_;
+
+  /// Reruns the search a moment after the project changes, so a burst of changes only reruns it once
+  QTimer search_timer_;
+
+  /// Search results the model hasn't fetched yet
+  QVector<Item*> search_pending_;
+
+  /// Folders expanded in the tree view to show the current results
+  QSet<Item*> search_expanded_;
+
+  /// Fetches search_pending_ a batch at a time
+  QTimer search_fetch_timer_;
+
 private slots:
   void ItemClickedSlot(const QModelIndex& index);
 
@@ -142,6 +171,12 @@ private slots:
   void DirUpSlot();
 
   void RenameTimerSlot();
+
+  void RunSearch();
+
+  void SearchIndexChanged();
+
+  void FetchSearchResults();
 };
 
 #endif // PROJECTEXPLORER_H
@@ -0,0 +1,240 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "scopewidget.h"
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QPainter>
+
+#include "render/gl/blitgeometry.h"
+#include "render/gl/shadergenerators.h"
+
+namespace {
+
+/// Columns in a waveform (and in each channel of a parade)
+const int kScopeColumns = 512;
+
+/// Levels each channel is binned into
+const int kScopeLevels = 256;
+
+/// Frames wider than this are sampled every few pixels, which looks the same but saves most of the atomic adds
+const int kScopeMaximumSamples = 1024;
+
+GLuint GroupCount(int invocations)
+{
+  return static_cast<GLuint>((invocations + olive::kComputeLocalSize - 1) / olive::kComputeLocalSize);
+}
+
+}
+
+ScopeWidget::ScopeWidget(QWidget *parent) :
+  QOpenGLWidget(parent),
+  type_(olive::kScopeWaveform),
+  supported_(false),
+  pipeline_type_(olive::kScopeTypeCount),
+  accumulation_(0),
+  normalization_(1.0f)
+{
+}
+
+const olive::ScopeType &ScopeWidget::type() const
+{
+  return type_;
+}
+
+void ScopeWidget::SetTexture(RenderTexturePtr tex)
+{
+  texture_ = tex;
+
+  // Hidden scopes aren't computed, they catch up with the latest texture once they're shown
+  if (isVisible()) {
+    update();
+  }
+}
+
+void ScopeWidget::SetType(int type)
+{
+  type_ = static_cast<olive::ScopeType>(type);
+
+  accumulated_texture_ = nullptr;
+
+  update();
+}
+
+void ScopeWidget::initializeGL()
+{
+  supported_ = olive::ShaderGenerator::SupportsCompute(context());
+
+  connect(context(), SIGNAL(aboutToBeDestroyed()), this, SLOT(ContextCleanup()), Qt::DirectConnection);
+}
+
+void ScopeWidget::paintGL()
+{
+  QOpenGLExtraFunctions* f = context()->extraFunctions();
+
+  f->glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  f->glClear(GL_COLOR_BUFFER_BIT);
+
+  if (supported_ && pipeline_type_ != type_) {
+    accumulate_pipeline_ = olive::ShaderGenerator::ScopeAccumulatePipeline(type_);
+    display_pipeline_ = olive::ShaderGenerator::ScopeDisplayPipeline(type_);
+    pipeline_type_ = type_;
+
+    accumulated_texture_ = nullptr;
+  }
+
+  if (accumulate_pipeline_ == nullptr || display_pipeline_ == nullptr) {
+    QPainter p(this);
+    p.setPen(palette().color(QPalette::Text));
+    p.drawText(rect(), Qt::AlignCenter, tr("Scopes require OpenGL 4.3"));
+    return;
+  }
+
+  if (accumulation_ == 0 || accumulated_texture_ != texture_) {
+    Accumulate();
+  }
+
+  f->glActiveTexture(GL_TEXTURE0);
+  f->glBindTexture(GL_TEXTURE_2D, accumulation_);
+
+  display_pipeline_->bind();
+  display_pipeline_->setUniformValue("mvp_matrix", QMatrix4x4());
+  display_pipeline_->setUniformValue("accumulation", 0);
+  display_pipeline_->setUniformValue("normalization", normalization_);
+
+  BlitGeometry::Get(context())->Draw(display_pipeline_, false);
+
+  display_pipeline_->release();
+
+  f->glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+QSize ScopeWidget::AccumulationSize() const
+{
+  switch (type_) {
+  case olive::kScopeWaveform:
+    return QSize(kScopeColumns, kScopeLevels);
+  case olive::kScopeParade:
+    return QSize(kScopeColumns * 3, kScopeLevels);
+  case olive::kScopeVectorscope:
+    return QSize(kScopeLevels, kScopeLevels);
+  case olive::kScopeHistogram:
+    // Red, green, blue and luma
+    return QSize(kScopeLevels, 4);
+  case olive::kScopeTypeCount:
+    break;
+  }
+
+  return QSize();
+}
+
+void ScopeWidget::Accumulate()
+{
+  QOpenGLExtraFunctions* f = context()->extraFunctions();
+
+  accumulated_texture_ = texture_;
+
+  QSize size = AccumulationSize();
+
+  if (accumulation_ == 0 || accumulation_size_ != size) {
+    f->glDeleteTextures(1, &accumulation_);
+
+    f->glGenTextures(1, &accumulation_);
+    f->glBindTexture(GL_TEXTURE_2D, accumulation_);
+    f->glTexStorage2D(GL_TEXTURE_2D, 1, GL_R32UI, size.width(), size.height());
+
+    // Integer textures can't be filtered
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    f->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+
+    accumulation_size_ = size;
+  }
+
+  accumulate_pipeline_->bind();
+
+  f->glBindImageTexture(0, accumulation_, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+
+  // Start from empty bins
+  accumulate_pipeline_->setUniformValue("clear_pass", 1);
+  f->glUniform2i(accumulate_pipeline_->uniformLocation("grid_size"), size.width(), size.height());
+  f->glDispatchCompute(GroupCount(size.width()), GroupCount(size.height()), 1);
+
+  f->glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+  if (texture_ != nullptr && texture_->IsCreated()) {
+    // Make sure the frame has finished rendering in its own context
+    texture_->WaitFence();
+
+    int step = qMax(1, (texture_->width() + kScopeMaximumSamples - 1) / kScopeMaximumSamples);
+    QSize grid(texture_->width() / step, texture_->height() / step);
+
+    f->glActiveTexture(GL_TEXTURE0);
+    f->glBindTexture(GL_TEXTURE_2D, texture_->texture());
+
+    accumulate_pipeline_->setUniformValue("input_texture", 0);
+    accumulate_pipeline_->setUniformValue("clear_pass", 0);
+    accumulate_pipeline_->setUniformValue("sample_step", step);
+    f->glUniform2i(accumulate_pipeline_->uniformLocation("grid_size"), grid.width(), grid.height());
+    f->glDispatchCompute(GroupCount(grid.width()), GroupCount(grid.height()), 1);
+
+    f->glBindTexture(GL_TEXTURE_2D, 0);
+
+    float samples = static_cast<float>(grid.width()) * static_cast<float>(grid.height());
+
+    switch (type_) {
+    case olive::kScopeWaveform:
+    case olive::kScopeParade:
+      // Full brightness once a quarter of a column is at one level
+      normalization_ = samples / static_cast<float>(kScopeColumns) * 0.25f;
+      break;
+    case olive::kScopeVectorscope:
+      normalization_ = samples / 64.0f;
+      break;
+    case olive::kScopeHistogram:
+      // Full height at four times the average bin
+      normalization_ = samples / static_cast<float>(kScopeLevels) * 4.0f;
+      break;
+    case olive::kScopeTypeCount:
+      break;
+    }
+
+    normalization_ = qMax(normalization_, 1.0f);
+  }
+
+  // The bins are read as a texture when they're drawn
+  f->glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+  f->glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_READ_WRITE, GL_R32UI);
+
+  accumulate_pipeline_->release();
+}
+
+void ScopeWidget::ContextCleanup()
+{
+  // The context is current while aboutToBeDestroyed() is emitted
+  context()->functions()->glDeleteTextures(1, &accumulation_);
+  accumulation_ = 0;
+
+  accumulate_pipeline_ = nullptr;
+  display_pipeline_ = nullptr;
+  pipeline_type_ = olive::kScopeTypeCount;
+}
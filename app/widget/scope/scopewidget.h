@@ -0,0 +1,109 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef SCOPEWIDGET_H
+#define SCOPEWIDGET_H
+
+#include <QOpenGLWidget>
+
+#include "render/gl/shaderptr.h"
+#include "render/rendertexture.h"
+#include "render/scopetype.h"
+
+/**
+ * @brief Displays a video scope of the frames a viewer shows
+ *
+ * Scopes are computed on the GPU from the viewer's texture, so the frame never has to be downloaded: a compute
+ * pipeline (see ShaderGenerator::ScopeAccumulatePipeline()) scatters a grid of samples from the frame into a small
+ * accumulation texture with atomic adds, which is then drawn straight into the widget. This happens at most once per
+ * frame and only while the widget is visible.
+ *
+ * Compute shaders need OpenGL 4.3, so without it the widget only says that scopes aren't supported.
+ */
+class ScopeWidget : public QOpenGLWidget
+{
+  Q_OBJECT
+public:
+  ScopeWidget(QWidget* parent);
+
+  const olive::ScopeType& type() const;
+
+public slots:
+  /**
+   * @brief Set the frame to show the scope of, or nullptr for none
+   */
+  void SetTexture(RenderTexturePtr tex);
+
+  void SetType(int type);
+
+protected:
+  virtual void initializeGL() override;
+
+  virtual void paintGL() override;
+
+private:
+  /**
+   * @brief Size of the accumulation texture for the current type (see ShaderGenerator::ScopeAccumulatePipeline())
+   */
+  QSize AccumulationSize() const;
+
+  /**
+   * @brief Reset the accumulation texture and accumulate texture_ into it
+   */
+  void Accumulate();
+
+  olive::ScopeType type_;
+
+  RenderTexturePtr texture_;
+
+  /**
+   * @brief The texture that was last accumulated, so it isn't accumulated again when nothing has changed
+   */
+  RenderTexturePtr accumulated_texture_;
+
+  /**
+   * @brief Whether this widget's context is able to compute scopes, known once it's been initialized
+   */
+  bool supported_;
+
+  /**
+   * @brief The type the pipelines were created for
+   */
+  olive::ScopeType pipeline_type_;
+
+  ShaderPtr accumulate_pipeline_;
+
+  ShaderPtr display_pipeline_;
+
+  GLuint accumulation_;
+
+  QSize accumulation_size_;
+
+  /**
+   * @brief Count at which a bin is drawn at full brightness (or height), scaled from how many samples were taken
+   */
+  float normalization_;
+
+private slots:
+  void ContextCleanup();
+
+};
+
+#endif // SCOPEWIDGET_H
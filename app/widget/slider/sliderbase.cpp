@@ -173,6 +173,10 @@ void SliderBase::LabelClicked()
       SetValue(dragged_diff_);
       break;
     }
+
+    if (mode_ != kString) {
+      emit DragFinished();
+    }
   } else {
     // This was a simple click
 
@@ -212,6 +216,10 @@ void SliderBase::LabelDragged(int i)
 
     temp_dragged_value_ = ClampValue(temp_dragged_value_);
 
+    if (!dragged_) {
+      emit DragStarted();
+    }
+
     UpdateLabel(temp_dragged_value_);
     emit ValueChanged(temp_dragged_value_);
     break;
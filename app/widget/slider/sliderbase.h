@@ -43,6 +43,16 @@ public:
 signals:
   void ValueChanged(QVariant v);
 
+  /**
+   * @brief Emitted when the user starts dragging the value, before the first ValueChanged() of the drag
+   */
+  void DragStarted();
+
+  /**
+   * @brief Emitted when the user lets go of a drag
+   */
+  void DragFinished();
+
 protected:
   const QVariant& Value();
 
@@ -23,6 +23,8 @@
 #include <QDebug>
 #include <QMimeData>
 #include <QMouseEvent>
+#include <QPainter>
+#include <QPaintEvent>
 #include <QScrollBar>
 #include <QtMath>
 #include <QPen>
@@ -30,14 +32,26 @@
 #include "core.h"
 #include "node/input/media/media.h"
 #include "project/item/footage/footage.h"
+#include "task/analyze/analyze.h"
+#include "task/filmstrip/filmstrip.h"
+#include "task/taskmanager.h"
+#include "task/waveform/waveform.h"
 #include "tool/tool.h"
 
+/**
+ * @brief Clips narrower than this (in pixels) are drawn as part of a density bar rather than with their own item
+ */
+const double kMinimumItemWidth = 2.0;
+
 TimelineView::TimelineView(QWidget *parent) :
   QGraphicsView(parent),
   pointer_tool_(this),
   import_tool_(this),
   razor_tool_(this),
-  playhead_(0)
+  scale_(1.0),
+  playhead_(0),
+  timeline_end_(0),
+  scene_cache_valid_(false)
 {
   setScene(&scene_);
   setAlignment(Qt::AlignLeft | Qt::AlignTop);
@@ -45,11 +59,21 @@ TimelineView::TimelineView(QWidget *parent) :
   setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
 
   connect(&scene_, SIGNAL(changed(const QList<QRectF>&)), this, SLOT(UpdateSceneRect()));
+  connect(&scene_, SIGNAL(changed(const QList<QRectF>&)), this, SLOT(InvalidateSceneCache()));
+
+  // Items are only kept for the visible area, so scrolling needs to create them
+  connect(horizontalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(UpdateVisibleItems()));
+
+  // Clips waiting on a waveform or filmstrip pick it up when the Task generating it finishes
+  connect(&olive::task_manager, SIGNAL(TaskAdded(Task*)), this, SLOT(TaskAdded(Task*)));
+
+  visible_items_timer_.setSingleShot(true);
+  visible_items_timer_.setInterval(0);
+  connect(&visible_items_timer_, SIGNAL(timeout()), this, SLOT(UpdateVisibleItems()));
 
-  // Create playhead line
-  playhead_line_ = new TimelineViewPlayheadItem();
+  density_item_ = new TimelineViewDensityItem();
 
-  scene_.addItem(playhead_line_);
+  scene_.addItem(density_item_);
 
   // Set default scale
   SetScale(1.0);
@@ -60,30 +84,15 @@ void TimelineView::AddBlock(Block *block, int track)
   switch (block->type()) {
   case Block::kClip:
   {
-    TimelineViewClipItem* clip_item = new TimelineViewClipItem();
-    ClipBlock* clip = static_cast<ClipBlock*>(block);
+    // The clip's item is created by UpdateVisibleItems() once it's in view
+    clip_tracks_.insert(block, track);
 
-    // Set up clip with view parameters (clip item will automatically size its rect accordingly)
-    clip_item->SetClip(clip);
-    clip_item->SetY(GetTrackY(track));
-    clip_item->SetHeight(GetTrackHeight(track));
-    clip_item->SetScale(scale_);
-    clip_item->SetTrack(track);
+    connect(block, SIGNAL(Refreshed()), this, SLOT(BlockChanged()));
 
-    // Add to list of clip items that can be iterated through
-    clip_items_.insert(clip, clip_item);
-
-    // Add item to graphics scene
-    scene_.addItem(clip_item);
-
-    connect(clip, SIGNAL(Refreshed()), this, SLOT(BlockChanged()));
+    visible_items_timer_.start();
     break;
   }
   case Block::kGap:
-  {
-    clip_items_.insert(block, nullptr);
-    break;
-  }
   case Block::kEnd:
     // Do nothing
     break;
@@ -94,26 +103,22 @@ void TimelineView::AddBlock(Block *block, int track)
 
 void TimelineView::RemoveBlock(Block *block)
 {
-  delete clip_items_[block];
+  delete clip_items_.value(block);
 
   clip_items_.remove(block);
+  clip_tracks_.remove(block);
+
+  visible_items_timer_.start();
 }
 
 void TimelineView::SetScale(const double &scale)
 {
   scale_ = scale;
 
-  QMapIterator<Block*, TimelineViewRect*> iterator(clip_items_);
+  UpdateVisibleItems();
 
-  while (iterator.hasNext()) {
-    iterator.next();
-
-    if (iterator.value() != nullptr) {
-      iterator.value()->SetScale(scale_);
-    }
-  }
-
-  playhead_line_->SetScale(scale_);
+  InvalidateSceneCache();
+  viewport()->update();
 }
 
 void TimelineView::SetTimebase(const rational &timebase)
@@ -121,7 +126,7 @@ void TimelineView::SetTimebase(const rational &timebase)
   timebase_ = timebase;
   timebase_dbl_ = timebase_.toDouble();
 
-  playhead_line_->SetTimebase(timebase_);
+  viewport()->update();
 }
 
 void TimelineView::Clear()
@@ -137,13 +142,105 @@ void TimelineView::Clear()
   }
 
   clip_items_.clear();
+  clip_tracks_.clear();
+
+  UpdateVisibleItems();
 }
 
 void TimelineView::SetTime(const int64_t time)
 {
+  if (playhead_ == time) {
+    return;
+  }
+
+  // Only the columns the playhead leaves and enters need drawing again
+  QRect changed = PlayheadRect(playhead_) | PlayheadRect(time);
+
   playhead_ = time;
 
-  playhead_line_->SetPlayhead(playhead_);
+  playhead_region_ += changed;
+
+  viewport()->update(changed);
+}
+
+QRect TimelineView::PlayheadRect(int64_t time)
+{
+  int x = mapFromScene(QPointF(static_cast<double>(time) * timebase_dbl_ * scale_, 0)).x();
+  int width = qMax(1, qCeil(timebase_dbl_ * scale_));
+
+  return QRect(x, 0, width + 1, viewport()->height());
+}
+
+void TimelineView::DrawPlayhead(QPainter *p)
+{
+  if (timebase_.isNull()) {
+    return;
+  }
+
+  QRect r = PlayheadRect(playhead_).adjusted(0, 0, -1, 0);
+
+  // FIXME: Make adjustable through CSS
+  p->setPen(Qt::NoPen);
+  p->setBrush(playhead_style_.PlayheadHighlightColor());
+  p->drawRect(r);
+
+  p->setPen(playhead_style_.PlayheadColor());
+  p->setBrush(Qt::NoBrush);
+  p->drawLine(r.topLeft(), r.bottomLeft());
+}
+
+void TimelineView::InvalidateSceneCache()
+{
+  scene_cache_valid_ = false;
+}
+
+void TimelineView::paintEvent(QPaintEvent *event)
+{
+  QRegion playhead_region = playhead_region_;
+  playhead_region_ = QRegion();
+
+  // The rubber band is drawn by QGraphicsView::paintEvent() rather than the scene so it's never in the cache
+  bool playhead_only = (!rubberBandRect().isValid() && (event->region() - playhead_region).isEmpty());
+
+  if (playhead_only && !scene_cache_valid_) {
+    // Draw the whole viewport once so the following playhead moves don't need the clips drawn again
+    qreal dpr = viewport()->devicePixelRatioF();
+
+    scene_cache_ = QPixmap(viewport()->size() * dpr);
+    scene_cache_.setDevicePixelRatio(dpr);
+    scene_cache_.fill(Qt::transparent);
+
+    QPainter cache_painter(&scene_cache_);
+    render(&cache_painter, QRectF(), viewport()->rect());
+    cache_painter.end();
+
+    scene_cache_valid_ = true;
+  }
+
+  if (playhead_only) {
+    QPainter p(viewport());
+
+    p.setClipRegion(event->region());
+    p.drawPixmap(0, 0, scene_cache_);
+
+    DrawPlayhead(&p);
+  } else {
+    QGraphicsView::paintEvent(event);
+
+    // Anything the scene drew may have changed, the cache is rebuilt by the next paint that only moves the playhead
+    scene_cache_valid_ = false;
+
+    QPainter p(viewport());
+    p.setClipRegion(event->region());
+    DrawPlayhead(&p);
+  }
+}
+
+void TimelineView::scrollContentsBy(int dx, int dy)
+{
+  QGraphicsView::scrollContentsBy(dx, dy);
+
+  InvalidateSceneCache();
 }
 
 void TimelineView::mousePressEvent(QMouseEvent *event)
@@ -283,6 +380,24 @@ int TimelineView::SceneToTrack(const double &y)
   return track;
 }
 
+void TimelineView::CreateClipItem(ClipBlock *clip, int track)
+{
+  TimelineViewClipItem* clip_item = new TimelineViewClipItem();
+
+  // Set up clip with view parameters (clip item will automatically size its rect accordingly)
+  clip_item->SetClip(clip);
+  clip_item->SetY(GetTrackY(track));
+  clip_item->SetHeight(GetTrackHeight(track));
+  clip_item->SetScale(scale_);
+  clip_item->SetTrack(track);
+
+  // Add to list of clip items that can be iterated through
+  clip_items_.insert(clip, clip_item);
+
+  // Add item to graphics scene
+  scene_.addItem(clip_item);
+}
+
 void TimelineView::ClearGhosts()
 {
   if (!ghost_items_.isEmpty()) {
@@ -294,13 +409,40 @@ void TimelineView::ClearGhosts()
   }
 }
 
+void TimelineView::TaskAdded(Task *t)
+{
+  if (dynamic_cast<AnalyzeTask*>(t) != nullptr
+      || dynamic_cast<WaveformTask*>(t) != nullptr
+      || dynamic_cast<FilmstripTask*>(t) != nullptr) {
+    connect(t, SIGNAL(Finished()), this, SLOT(AnalysisFinished()));
+  }
+}
+
+void TimelineView::AnalysisFinished()
+{
+  QMapIterator<Block*, TimelineViewRect*> iterator(clip_items_);
+
+  while (iterator.hasNext()) {
+    iterator.next();
+
+    TimelineViewClipItem* clip_item = dynamic_cast<TimelineViewClipItem*>(iterator.value());
+
+    if (clip_item != nullptr) {
+      clip_item->UpdateAnalysis();
+    }
+  }
+}
+
 void TimelineView::BlockChanged()
 {
-  TimelineViewRect* rect = clip_items_[static_cast<Block*>(sender())];
+  TimelineViewRect* rect = clip_items_.value(static_cast<Block*>(sender()));
 
   if (rect != nullptr) {
     rect->UpdateRect();
   }
+
+  // The block may have moved into or out of view
+  visible_items_timer_.start();
 }
 
 void TimelineView::UpdateSceneRect()
@@ -310,6 +452,11 @@ void TimelineView::UpdateSceneRect()
   // Ensure the scene left and top are always 0
   bounding_rect.setTopLeft(QPointF(0, 0));
 
+  // Clips out of view don't have items, so make sure the scene still reaches the end of the timeline
+  if (bounding_rect.right() < timeline_end_) {
+    bounding_rect.setRight(timeline_end_);
+  }
+
   // Ensure the scene height is always AT LEAST the height of the view
   // The scrollbar appears to have a 1px margin on the top and bottom, hence the -2
   int minimum_height = height() - horizontalScrollBar()->height() - 2;
@@ -317,9 +464,6 @@ void TimelineView::UpdateSceneRect()
     bounding_rect.setHeight(minimum_height);
   }
 
-  // Ensure playhead is the correct height
-  playhead_line_->UpdateRect();
-
   // If the scene is already this rect, do nothing
   if (scene_.sceneRect() == bounding_rect) {
     return;
@@ -328,3 +472,67 @@ void TimelineView::UpdateSceneRect()
   scene_.setSceneRect(bounding_rect);
 }
 
+
+void TimelineView::UpdateVisibleItems()
+{
+  QRectF visible = mapToScene(viewport()->rect()).boundingRect();
+
+  // Create items a screen ahead on either side so scrolling doesn't reveal missing clips, but only delete them once
+  // they're two screens away so scrolling back and forth doesn't keep recreating them
+  double margin = visible.width();
+  double create_left = visible.left() - margin;
+  double create_right = visible.right() + margin;
+  double delete_left = create_left - margin;
+  double delete_right = create_right + margin;
+
+  QVector<TimelineViewDensityItem::Span> narrow_clips;
+
+  timeline_end_ = 0;
+
+  QMapIterator<Block*, int> iterator(clip_tracks_);
+
+  while (iterator.hasNext()) {
+    iterator.next();
+
+    Block* block = iterator.key();
+    int track = iterator.value();
+
+    double left = block->in().toDouble() * scale_;
+    double right = block->out().toDouble() * scale_;
+
+    timeline_end_ = qMax(timeline_end_, right);
+
+    TimelineViewRect* item = clip_items_.value(block);
+    bool narrow = (right - left < kMinimumItemWidth);
+    bool near_view = (right >= create_left && left <= create_right);
+
+    // Never delete a selected item, the tools rely on the selection to know what to drag
+    bool keep = (item != nullptr && item->isSelected());
+
+    if (!keep && (narrow || right < delete_left || left > delete_right)) {
+      if (item != nullptr) {
+        delete item;
+        clip_items_.remove(block);
+      }
+
+      if (narrow && near_view) {
+        TimelineViewDensityItem::Span span;
+        span.left = left;
+        span.right = right;
+        span.y = GetTrackY(track);
+        span.height = GetTrackHeight(track);
+        narrow_clips.append(span);
+      }
+    } else if (item == nullptr) {
+      if (near_view) {
+        CreateClipItem(static_cast<ClipBlock*>(block), track);
+      }
+    } else if (!qFuzzyCompare(item->Scale(), scale_)) {
+      item->SetScale(scale_);
+    }
+  }
+
+  density_item_->SetSpans(narrow_clips);
+
+  UpdateSceneRect();
+}
@@ -26,11 +26,15 @@
 #include <QDragMoveEvent>
 #include <QDragLeaveEvent>
 #include <QDropEvent>
+#include <QPixmap>
+#include <QTimer>
 
 #include "node/block/clip/clip.h"
+#include "task/task.h"
 #include "timelineviewclipitem.h"
+#include "timelineviewdensityitem.h"
+#include "timelineplayhead.h"
 #include "timelineviewghostitem.h"
-#include "timelineviewplayheaditem.h"
 
 /**
  * @brief A widget for viewing and interacting Sequences
@@ -63,6 +67,12 @@ signals:
   void RequestReplaceBlock(Block* old, Block* replace, int track);
   void RequestSplitAtTime(rational time, int track);
 
+  /**
+   * @brief Emitted around requests that belong to one edit so they're applied and invalidated together
+   */
+  void RequestBeginEdit();
+  void RequestEndEdit();
+
 protected:
   virtual void mousePressEvent(QMouseEvent *event) override;
   virtual void mouseMoveEvent(QMouseEvent *event) override;
@@ -75,6 +85,13 @@ protected:
 
   virtual void resizeEvent(QResizeEvent *event) override;
 
+  /**
+   * @brief Draws the scene from scene_cache_ where possible, and the playhead over it
+   */
+  virtual void paintEvent(QPaintEvent *event) override;
+
+  virtual void scrollContentsBy(int dx, int dy) override;
+
 private:
 
   class Tool
@@ -204,6 +221,18 @@ private:
 
   void ClearGhosts();
 
+  /**
+   * @brief Returns the area of the viewport the playhead covers at `time`
+   */
+  QRect PlayheadRect(int64_t time);
+
+  void DrawPlayhead(QPainter* p);
+
+  /**
+   * @brief Create a clip item for a clip that has come into view
+   */
+  void CreateClipItem(ClipBlock* clip, int track);
+
   QGraphicsScene scene_;
 
   double scale_;
@@ -214,17 +243,60 @@ private:
 
   int64_t playhead_;
 
+  /**
+   * @brief Every clip in the timeline and the track it's on, whether or not it has an item
+   */
+  QMap<Block*, int> clip_tracks_;
+
+  /**
+   * @brief Items of clips that are in or near the visible area
+   *
+   * Creating an item for every clip is slow on timelines with thousands of them, so UpdateVisibleItems() only keeps
+   * items for the visible time range plus a margin.
+   */
   QMap<Block*, TimelineViewRect*> clip_items_;
 
+  /**
+   * @brief Draws the clips that are too narrow for their own items
+   */
+  TimelineViewDensityItem* density_item_;
+
+  /**
+   * @brief Scene X coordinate of the end of the last clip, the scene must be at least this wide
+   */
+  double timeline_end_;
+
+  /**
+   * @brief Coalesces UpdateVisibleItems() calls when many blocks are added, removed, or changed at once
+   */
+  QTimer visible_items_timer_;
+
   QVector<TimelineViewGhostItem*> ghost_items_;
 
   QVector<int> track_heights_;
 
-  TimelineViewPlayheadItem* playhead_line_;
+  TimelinePlayhead playhead_style_;
+
+  /**
+   * @brief The viewport as last drawn, without the playhead
+   *
+   * The playhead isn't an item in the scene so moving it during playback doesn't change the scene. Paints that only
+   * cover where the playhead was and now is (playhead_region_) are drawn from this instead of drawing the clips again.
+   */
+  QPixmap scene_cache_;
+
+  bool scene_cache_valid_;
+
+  /**
+   * @brief Area of the viewport SetTime() has asked to be drawn again since the last paint
+   */
+  QRegion playhead_region_;
 
   Tool* active_tool_;
 
 private slots:
+  void InvalidateSceneCache();
+
   /**
    * @brief Slot for when a Block node changes its parameters and the graphics need to update
    *
@@ -237,6 +309,24 @@ private slots:
    * @brief Slot called whenever the view resizes or the scene contents change to enforce minimum scene sizes
    */
   void UpdateSceneRect();
+
+  /**
+   * @brief Create items for clips that have come into view and delete ones that are far out of view or too narrow
+   *
+   * Only items that exist are rescaled, so zooming and scrolling cost scales with what's on screen rather than the
+   * length of the timeline. Clips that are narrower than kMinimumItemWidth are drawn by density_item_ instead.
+   */
+  void UpdateVisibleItems();
+
+  /**
+   * @brief Listens for Tasks that generate waveforms or filmstrips so clips can show them once they're ready
+   */
+  void TaskAdded(Task* t);
+
+  /**
+   * @brief Slot for when a waveform or filmstrip Task finishes, attaches any newly available data to clip items
+   */
+  void AnalysisFinished();
 };
 
 #endif // TIMELINEVIEW_H
@@ -25,6 +25,10 @@
 #include <QGraphicsSceneMouseEvent>
 #include <QPainter>
 #include <QStyleOptionGraphicsItem>
+#include <QtMath>
+
+#include "node/input/media/media.h"
+#include "project/item/footage/footage.h"
 
 TimelineViewClipItem::TimelineViewClipItem(QGraphicsItem* parent) :
   TimelineViewRect(parent),
@@ -32,6 +36,9 @@ TimelineViewClipItem::TimelineViewClipItem(QGraphicsItem* parent) :
 {
   setBrush(Qt::white);
   setFlag(QGraphicsItem::ItemIsSelectable, true);
+
+  // Lets paint() only draw the part of the waveform and filmstrip that's actually visible
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
 }
 
 ClipBlock *TimelineViewClipItem::clip()
@@ -43,7 +50,32 @@ void TimelineViewClipItem::SetClip(ClipBlock *clip)
 {
   clip_ = clip;
 
+  audio_stream_ = nullptr;
+  waveform_ = nullptr;
+  video_stream_ = nullptr;
+  filmstrip_ = nullptr;
+
   UpdateRect();
+  UpdateWaveform();
+  UpdateFilmstrip();
+}
+
+void TimelineViewClipItem::UpdateAnalysis()
+{
+  bool had_waveform = (waveform_ != nullptr);
+  bool had_filmstrip = (filmstrip_ != nullptr);
+
+  if (!had_waveform) {
+    UpdateWaveform();
+  }
+
+  if (!had_filmstrip) {
+    UpdateFilmstrip();
+  }
+
+  if ((!had_waveform && waveform_ != nullptr) || (!had_filmstrip && filmstrip_ != nullptr)) {
+    update();
+  }
 }
 
 void TimelineViewClipItem::UpdateRect()
@@ -72,6 +104,14 @@ void TimelineViewClipItem::paint(QPainter *painter, const QStyleOptionGraphicsIt
   painter->fillRect(rect(), grad);
 //  painter->fillRect(rect(), QColor(128, 128, 192));
 
+  if (filmstrip_ != nullptr) {
+    PaintFilmstrip(painter, option->exposedRect.intersected(rect()));
+  }
+
+  if (waveform_ != nullptr) {
+    PaintWaveform(painter, option->exposedRect.intersected(rect()));
+  }
+
   if (option->state & QStyle::State_Selected) {
     painter->fillRect(rect(), QColor(0, 0, 0, 64));
   }
@@ -84,3 +124,155 @@ void TimelineViewClipItem::paint(QPainter *painter, const QStyleOptionGraphicsIt
   painter->drawLine(QPointF(rect().left(), rect().bottom() - 1), QPointF(rect().right(), rect().bottom() - 1));
   painter->drawLine(QPointF(rect().right(), rect().bottom() - 1), QPointF(rect().right(), rect().top()));
 }
+
+void TimelineViewClipItem::UpdateWaveform()
+{
+  if (clip_ == nullptr) {
+    return;
+  }
+
+  if (audio_stream_ == nullptr) {
+    Footage* footage = GetFootage();
+
+    if (footage == nullptr) {
+      return;
+    }
+
+    for (int i=0;i<footage->stream_count();i++) {
+      if (footage->stream(i)->type() == Stream::kAudio) {
+        audio_stream_ = footage->stream(i);
+        break;
+      }
+    }
+
+    if (audio_stream_ == nullptr) {
+      return;
+    }
+  }
+
+  waveform_ = Waveform::Load(Waveform::GetFilename(audio_stream_.get()));
+}
+
+void TimelineViewClipItem::PaintWaveform(QPainter *painter, const QRectF &exposed)
+{
+  if (exposed.isEmpty() || scale_ <= 0) {
+    return;
+  }
+
+  double sample_rate = waveform_->sample_rate();
+  double samples_per_pixel = sample_rate / scale_;
+
+  // Only read about one peak per pixel, regardless of how far we're zoomed out
+  int level = waveform_->GetLevelForSamplesPerPixel(samples_per_pixel);
+
+  double media_start = clip_->media_in().toDouble() * sample_rate;
+  double center = rect().center().y();
+  double half_height = rect().height() * 0.5;
+
+  int left = qFloor(exposed.left());
+  int right = qCeil(exposed.right());
+
+  QVector<QLineF> peak_lines;
+  QVector<QLineF> rms_lines;
+  peak_lines.reserve(right - left);
+  rms_lines.reserve(right - left);
+
+  for (int x=left;x<right;x++) {
+    int64_t start_sample = qRound64(media_start + (x - rect().left()) * samples_per_pixel);
+    int64_t end_sample = qRound64(media_start + (x + 1 - rect().left()) * samples_per_pixel);
+
+    // Mix all channels into one waveform
+    float min = 0;
+    float max = 0;
+    float rms = 0;
+
+    for (int i=0;i<waveform_->channels();i++) {
+      Waveform::Peak p = waveform_->GetPeak(level, i, start_sample, qMax(end_sample, start_sample + 1));
+
+      min = qMin(min, p.min);
+      max = qMax(max, p.max);
+      rms = qMax(rms, p.rms);
+    }
+
+    peak_lines.append(QLineF(x, center - static_cast<double>(max) * half_height,
+                             x, center - static_cast<double>(min) * half_height));
+    rms_lines.append(QLineF(x, center - static_cast<double>(rms) * half_height,
+                            x, center + static_cast<double>(rms) * half_height));
+  }
+
+  painter->setPen(QColor(64, 64, 128));
+  painter->drawLines(peak_lines);
+
+  painter->setPen(QColor(96, 96, 176));
+  painter->drawLines(rms_lines);
+}
+
+void TimelineViewClipItem::UpdateFilmstrip()
+{
+  if (clip_ == nullptr) {
+    return;
+  }
+
+  if (video_stream_ == nullptr) {
+    Footage* footage = GetFootage();
+
+    if (footage == nullptr) {
+      return;
+    }
+
+    for (int i=0;i<footage->stream_count();i++) {
+      if (footage->stream(i)->type() == Stream::kVideo) {
+        video_stream_ = footage->stream(i);
+        break;
+      }
+    }
+
+    if (video_stream_ == nullptr) {
+      return;
+    }
+  }
+
+  filmstrip_ = Filmstrip::Load(Filmstrip::GetFilename(video_stream_.get()));
+}
+
+void TimelineViewClipItem::PaintFilmstrip(QPainter *painter, const QRectF &exposed)
+{
+  if (exposed.isEmpty() || scale_ <= 0 || filmstrip_->count() == 0) {
+    return;
+  }
+
+  // Tiles keep the thumbnails' aspect ratio and are laid out from the start of the clip so they don't shift around
+  // as different parts of it are exposed
+  double tile_height = rect().height();
+  double tile_width = tile_height * filmstrip_->thumbnail_width() / filmstrip_->thumbnail_height();
+
+  double media_start = clip_->media_in().toDouble();
+
+  int first = qFloor((exposed.left() - rect().left()) / tile_width);
+  int last = qCeil((exposed.right() - rect().left()) / tile_width);
+
+  painter->save();
+  painter->setClipRect(exposed);
+
+  for (int i=first;i<last;i++) {
+    double x = rect().left() + i * tile_width;
+
+    // Show whichever thumbnail covers the media at the tile's left edge
+    int index = filmstrip_->GetThumbnailAt(media_start + (x - rect().left()) / scale_);
+
+    painter->drawImage(QRectF(x, rect().top(), tile_width, tile_height), filmstrip_->thumbnail(index));
+  }
+
+  painter->restore();
+}
+
+Footage *TimelineViewClipItem::GetFootage()
+{
+  MediaInput* media = qobject_cast<MediaInput*>(clip_->texture_input()->get_connected_node());
+
+  if (media == nullptr) {
+    return nullptr;
+  }
+
+  return media->footage();
+}
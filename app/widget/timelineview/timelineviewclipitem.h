@@ -22,6 +22,8 @@
 #define TIMELINEVIEWCLIPITEM_H
 
 #include "timelineviewrect.h"
+#include "decoder/filmstrip.h"
+#include "decoder/waveform.h"
 #include "node/block/clip/clip.h"
 
 /**
@@ -37,12 +39,58 @@ public:
 
   virtual void UpdateRect() override;
 
+  /**
+   * @brief Load the waveform and filmstrip if they weren't available yet and redraw if either was found
+   *
+   * Called when an analysis Task finishes rather than from paint() so repaints never touch the disk.
+   */
+  void UpdateAnalysis();
+
 protected:
   virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
 
 private:
+  /**
+   * @brief Try to find and load the waveform of the audio this clip uses (if any)
+   */
+  void UpdateWaveform();
+
+  /**
+   * @brief Draw the waveform over the part of the clip that's being repainted
+   */
+  void PaintWaveform(QPainter* painter, const QRectF& exposed);
+
+  /**
+   * @brief Try to find and load the filmstrip of the video this clip uses (if any)
+   */
+  void UpdateFilmstrip();
+
+  /**
+   * @brief Draw thumbnails across the part of the clip that's being repainted
+   */
+  void PaintFilmstrip(QPainter* painter, const QRectF& exposed);
+
+  /**
+   * @brief Returns the footage connected to the clip, or nullptr if there isn't any
+   */
+  Footage* GetFootage();
+
   ClipBlock* clip_;
 
+  /**
+   * @brief Audio stream of the clip's footage, or nullptr if it doesn't have one
+   */
+  StreamPtr audio_stream_;
+
+  WaveformPtr waveform_;
+
+  /**
+   * @brief Video stream of the clip's footage, or nullptr if it doesn't have one
+   */
+  StreamPtr video_stream_;
+
+  FilmstripPtr filmstrip_;
+
 };
 
 #endif // TIMELINEVIEWCLIPITEM_H
@@ -0,0 +1,101 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "timelineviewdensityitem.h"
+
+#include <algorithm>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+
+TimelineViewDensityItem::TimelineViewDensityItem(QGraphicsItem *parent) :
+  TimelineViewRect(parent)
+{
+  // Drawn beneath clip items in case a clip is still being shown at full size nearby
+  setZValue(-1);
+  setPen(Qt::NoPen);
+
+  // Lets paint() skip bars that aren't being repainted
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption, true);
+}
+
+void TimelineViewDensityItem::SetSpans(QVector<TimelineViewDensityItem::Span> spans)
+{
+  std::sort(spans.begin(), spans.end(), [](const Span& a, const Span& b) {
+    return (a.y < b.y) || (a.y == b.y && a.left < b.left);
+  });
+
+  bars_.clear();
+
+  QRectF bounds;
+
+  for (int i=0;i<spans.size();i++) {
+    const Span& span = spans.at(i);
+
+    // Merge with the previous bar if it's on the same track and within a pixel of this span
+    if (!bars_.isEmpty()
+        && bars_.last().y == span.y
+        && span.left <= bars_.last().rect.right() + 1.0) {
+      Bar& bar = bars_.last();
+
+      bar.rect.setRight(qMax(bar.rect.right(), span.right));
+      bar.count++;
+    } else {
+      Bar bar;
+
+      // -1 on height like clip items so we don't overlap the next track
+      bar.rect = QRectF(span.left, span.y, qMax(span.right - span.left, 1.0), span.height - 1);
+      bar.y = span.y;
+      bar.count = 1;
+
+      bars_.append(bar);
+    }
+  }
+
+  for (int i=0;i<bars_.size();i++) {
+    bounds |= bars_.at(i).rect;
+  }
+
+  // setRect() handles prepareGeometryChange() for us
+  setRect(bounds);
+  update();
+}
+
+void TimelineViewDensityItem::UpdateRect()
+{
+  // Spans are already in scene coordinates, TimelineView replaces them whenever the scale changes
+}
+
+void TimelineViewDensityItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+  Q_UNUSED(widget)
+
+  for (int i=0;i<bars_.size();i++) {
+    const Bar& bar = bars_.at(i);
+
+    if (!bar.rect.intersects(option->exposedRect)) {
+      continue;
+    }
+
+    // More clips per pixel means more of the bar is actually covered by clips, so make it more opaque
+    double density = qMin(1.0, bar.count / qMax(bar.rect.width(), 1.0));
+
+    painter->fillRect(bar.rect, QColor(128, 128, 192, 96 + qRound(159 * density)));
+  }
+}
@@ -0,0 +1,74 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef TIMELINEVIEWDENSITYITEM_H
+#define TIMELINEVIEWDENSITYITEM_H
+
+#include <QVector>
+
+#include "timelineviewrect.h"
+
+/**
+ * @brief A graphical representation of many clips that are too narrow to draw individually
+ *
+ * When zoomed far out, a clip may be less than a pixel wide, and giving each one its own TimelineViewClipItem costs
+ * far more than it shows. TimelineView instead passes these clips' extents here, where adjacent ones on the same
+ * track are merged into bars that are more opaque the more clips they contain.
+ */
+class TimelineViewDensityItem : public TimelineViewRect
+{
+public:
+  /**
+   * @brief The extent of a narrow clip in scene coordinates
+   */
+  struct Span {
+    double left;
+    double right;
+    int y;
+    int height;
+  };
+
+  TimelineViewDensityItem(QGraphicsItem* parent = nullptr);
+
+  /**
+   * @brief Replace the clips this item draws
+   */
+  void SetSpans(QVector<Span> spans);
+
+  virtual void UpdateRect() override;
+
+protected:
+  virtual void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+
+private:
+  /**
+   * @brief A bar of merged spans
+   */
+  struct Bar {
+    QRectF rect;
+    int y;
+    int count;
+  };
+
+  QVector<Bar> bars_;
+
+};
+
+#endif // TIMELINEVIEWDENSITYITEM_H
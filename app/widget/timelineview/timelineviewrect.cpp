@@ -63,6 +63,11 @@ void TimelineViewRect::SetTrack(const int &track)
   track_ = track;
 }
 
+const double &TimelineViewRect::Scale()
+{
+  return scale_;
+}
+
 void TimelineViewRect::SetScale(const double &scale)
 {
   scale_ = scale;
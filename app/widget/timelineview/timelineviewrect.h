@@ -42,6 +42,7 @@ public:
   const int& Track();
   void SetTrack(const int& track);
 
+  const double& Scale();
   void SetScale(const double& scale);
 
   virtual void UpdateRect() = 0;
@@ -71,8 +71,16 @@ void TimelineView::ImportTool::DragEnter(QDragEnterEvent *event)
         // If the Item is Footage, we can create a Ghost from it
         Footage* footage = static_cast<Footage*>(item);
 
+        // Prefer the first visual stream since that's what the MediaInput created on drop will show
         StreamPtr stream = footage->stream(0);
 
+        for (int i=0;i<footage->stream_count();i++) {
+          if (footage->stream(i)->type() == Stream::kVideo || footage->stream(i)->type() == Stream::kImage) {
+            stream = footage->stream(i);
+            break;
+          }
+        }
+
         TimelineViewGhostItem* ghost = new TimelineViewGhostItem();
 
         rational footage_duration;
@@ -154,6 +162,9 @@ void TimelineView::ImportTool::DragDrop(QDropEvent *event)
     // of scope will delete the nodes. If there is, they'll become parents of the NodeGraph instead
     QObject node_memory_manager;
 
+    // Placing several clips signals invalidations for every one of them on every track, send them once we're done
+    emit parent()->RequestBeginEdit();
+
     foreach (TimelineViewGhostItem* ghost, parent()->ghost_items_) {
       ClipBlock* clip = new ClipBlock();
       MediaInput* media = new MediaInput();
@@ -167,7 +178,7 @@ void TimelineView::ImportTool::DragDrop(QDropEvent *event)
       opacity->setParent(&node_memory_manager);
 
       clip->set_length(ghost->Length());
-      media->SetFootage(ghost->data(0).value<StreamPtr>()->footage());
+      media->SetStream(ghost->data(0).value<StreamPtr>());
 
       NodeParam::ConnectEdge(opacity->texture_output(), clip->texture_input());
       NodeParam::ConnectEdge(media->texture_output(), opacity->texture_input());
@@ -180,6 +191,8 @@ void TimelineView::ImportTool::DragDrop(QDropEvent *event)
       }
     }
 
+    emit parent()->RequestEndEdit();
+
     parent()->ClearGhosts();
 
     event->accept();
@@ -147,6 +147,9 @@ void TimelineView::PointerTool::MouseRelease(QMouseEvent *event)
 
   QObject block_memory_manager;
 
+  // Moving several blocks signals invalidations for every one of them on every track, send them once we're done
+  emit parent()->RequestBeginEdit();
+
   foreach (TimelineViewGhostItem* ghost, parent()->ghost_items_) {
     Block* b = Node::ValueToPtr<Block>(ghost->data(0));
 
@@ -175,6 +178,8 @@ void TimelineView::PointerTool::MouseRelease(QMouseEvent *event)
     emit parent()->RequestPlaceBlock(b, ghost->GetAdjustedIn(), ghost->GetAdjustedTrack());
   }
 
+  emit parent()->RequestEndEdit();
+
   parent()->ClearGhosts();
 
   dragging_ = false;
@@ -29,12 +29,25 @@
 #include "common/qtversionabstraction.h"
 #include "config/config.h"
 
+/**
+ * @brief Width of the tick cache in multiples of the widget's width
+ */
+const int kTickCacheWidths = 3;
+
+/**
+ * @brief Colors of cached and invalidated frames in the render bar
+ */
+const QColor kCachedRangeColor(64, 160, 64);
+const QColor kDirtyRangeColor(192, 64, 64);
+
 TimeRuler::TimeRuler(bool text_visible, QWidget* parent) :
   QWidget(parent),
   scroll_(0),
   centered_text_(true),
   scale_(1.0), // FIXME: Temporary value
-  time_(0)
+  time_(0),
+  tick_cache_scroll_(0),
+  tick_cache_valid_(false)
 {
   QFontMetrics fm = fontMetrics();
 
@@ -66,7 +79,7 @@ void TimeRuler::SetTextVisible(bool e)
     setMinimumHeight(text_height_);
   }
 
-  update();
+  InvalidateTickCache();
 }
 
 const double &TimeRuler::scale()
@@ -78,7 +91,7 @@ void TimeRuler::SetScale(const double &d)
 {
   scale_ = d;
 
-  update();
+  InvalidateTickCache();
 }
 
 void TimeRuler::SetTimebase(const rational &r)
@@ -89,7 +102,9 @@ void TimeRuler::SetTimebase(const rational &r)
 
   timebase_flipped_dbl_ = timebase_.flipped().toDouble();
 
-  update();
+  timecode_strings_.clear();
+
+  InvalidateTickCache();
 }
 
 const int64_t &TimeRuler::GetTime()
@@ -97,17 +112,47 @@ const int64_t &TimeRuler::GetTime()
   return time_;
 }
 
+void TimeRuler::SetCacheRanges(const FrameRangeSet &cached, const FrameRangeSet &dirty)
+{
+  cached_ranges_ = cached;
+  dirty_ranges_ = dirty;
+
+  update();
+}
+
 void TimeRuler::SetTime(const int64_t &r)
 {
+  if (time_ == r) {
+    return;
+  }
+
+  // Only the areas the playhead leaves and enters need drawing again
+  QRect changed = PlayheadRect(time_) | PlayheadRect(r);
+
   time_ = r;
 
-  update();
+  update(changed);
+}
+
+QRect TimeRuler::PlayheadRect(int64_t time)
+{
+  int x = qFloor(static_cast<double>(time) * scale_ * timebase_dbl_) - scroll_;
+  int half_width = playhead_width_ / 2;
+
+  // Padded by a pixel either side for antialiasing
+  return QRect(x - half_width - 1, 0, playhead_width_ + 3, height());
 }
 
 void TimeRuler::SetScroll(int s)
 {
   scroll_ = s;
 
+  // Only redraw the ticks once we've scrolled outside of what's already cached
+  if (tick_cache_valid_
+      && (scroll_ < tick_cache_scroll_ || scroll_ + width() > tick_cache_scroll_ + width() * kTickCacheWidths)) {
+    tick_cache_valid_ = false;
+  }
+
   update();
 }
 
@@ -118,8 +163,116 @@ void TimeRuler::paintEvent(QPaintEvent *)
     return;
   }
 
+  if (!tick_cache_valid_) {
+    UpdateTickCache();
+  }
+
   QPainter p(this);
 
+  p.drawPixmap(tick_cache_scroll_ - scroll_, 0, tick_cache_);
+
+  DrawCacheRanges(&p, cached_ranges_, kCachedRangeColor);
+  DrawCacheRanges(&p, dirty_ranges_, kDirtyRangeColor);
+
+  // Draw the playhead if it's on screen at the moment
+  int playhead_pos = qFloor(static_cast<double>(time_) * scale_ * timebase_dbl_) - scroll_;
+  if (playhead_pos + playhead_width_ >= 0 && playhead_pos - playhead_width_ < width()) {
+    p.setPen(Qt::NoPen);
+    p.setBrush(style_.PlayheadColor());
+    DrawPlayhead(&p, playhead_pos, height());
+  }
+}
+
+void TimeRuler::resizeEvent(QResizeEvent *e)
+{
+  QWidget::resizeEvent(e);
+
+  InvalidateTickCache();
+}
+
+void TimeRuler::changeEvent(QEvent *e)
+{
+  QWidget::changeEvent(e);
+
+  // The ticks are drawn with the palette and font so they need redrawing if either changes
+  if (e->type() == QEvent::PaletteChange || e->type() == QEvent::FontChange) {
+    InvalidateTickCache();
+  }
+}
+
+void TimeRuler::mousePressEvent(QMouseEvent *event)
+{
+  SeekToScreenPoint(event->pos().x());
+}
+
+void TimeRuler::mouseMoveEvent(QMouseEvent *event)
+{
+  if (event->buttons() & Qt::LeftButton) {
+    SeekToScreenPoint(event->pos().x());
+  }
+}
+
+void TimeRuler::DrawPlayhead(QPainter *p, int x, int y)
+{
+  p->setRenderHint(QPainter::Antialiasing);
+
+  int half_text_height = text_height_ / 3;
+  int half_width = playhead_width_ / 2;
+
+  QPoint points[] = {
+    QPoint(x, y),
+    QPoint(x - half_width, y - half_text_height),
+    QPoint(x - half_width, y - text_height_),
+    QPoint(x + 1 + half_width, y - text_height_),
+    QPoint(x + 1 + half_width, y - half_text_height),
+    QPoint(x + 1, y),
+  };
+
+  p->drawPolygon(points, 6);
+}
+
+void TimeRuler::DrawCacheRanges(QPainter *p, const FrameRangeSet &ranges, const QColor &color)
+{
+  if (ranges.IsEmpty()) {
+    return;
+  }
+
+  int bar_height = qMax(2, text_height_ / 5);
+  double unit_width = scale_ * timebase_dbl_;
+
+  // Only the ranges on screen are looked at, however many there are
+  QVector<FrameRangeSet::Range> visible = ranges.Ranges(qMax(Q_INT64_C(0), ScreenToUnit(0)), ScreenToUnit(width()));
+
+  foreach (const FrameRangeSet::Range& range, visible) {
+    int left = qFloor(static_cast<double>(range.first) * unit_width) - scroll_;
+    int right = qFloor(static_cast<double>(range.second + 1) * unit_width) - scroll_;
+
+    // Keep single frames visible when zoomed far out
+    p->fillRect(left, height() - bar_height, qMax(1, right - left), bar_height, color);
+  }
+}
+
+double TimeRuler::ScreenToUnitFloat(int screen)
+{
+  return (screen + scroll_) / scale_ / timebase_dbl_;
+}
+
+int64_t TimeRuler::ScreenToUnit(int screen)
+{
+  return qFloor(ScreenToUnitFloat(screen));
+}
+
+void TimeRuler::SeekToScreenPoint(int screen)
+{
+  int64_t timestamp = qMax(0, qRound(ScreenToUnitFloat(screen)));
+
+  SetTime(timestamp);
+
+  emit TimeChanged(timestamp);
+}
+
+void TimeRuler::DrawTicks(QPainter *p, int scroll, int width)
+{
   int64_t last_unit = -1;
   int last_sec = -1;
 
@@ -140,16 +293,16 @@ void TimeRuler::paintEvent(QPaintEvent *)
 
   // Set where the loop ends (affected by text)
   int loop_start = - playhead_width_;
-  int loop_end = width() + playhead_width_;
+  int loop_end = width + playhead_width_;
 
   // Determine where it can draw text
   int text_skip = 1;
   int half_average_text_width = 0;
   int text_y = 0;
   if (text_visible_) {
-    QFontMetrics fm = p.fontMetrics();
+    QFontMetrics fm = p->fontMetrics();
     double width_of_second = scale_;
-    int average_text_width = QFontMetricsWidth(&fm, olive::timestamp_to_timecode(0, timebase_, kTimecodeDisplay));
+    int average_text_width = QFontMetricsWidth(&fm, GetTimecodeString(0));
     half_average_text_width = average_text_width/2;
     while (width_of_second * text_skip < average_text_width) {
       text_skip++;
@@ -166,8 +319,8 @@ void TimeRuler::paintEvent(QPaintEvent *)
   }
 
   // Set line color to main text color
-  p.setBrush(Qt::NoBrush);
-  p.setPen(palette().text().color());
+  p->setBrush(Qt::NoBrush);
+  p->setPen(palette().text().color());
 
   // Calculate where each line starts
   int line_top = text_visible_ ? text_height_ : 0;
@@ -179,7 +332,7 @@ void TimeRuler::paintEvent(QPaintEvent *)
   int line_frame_bottom = line_top + line_length / 3;
 
   for (int i=loop_start;i<loop_end;i++) {
-    int64_t unit = ScreenToUnit(i);
+    int64_t unit = qFloor((i + scroll) / scale_ / timebase_dbl_);
 
     // Check if enough space has passed since the last line drawn
     if (qFloor(double(unit)/real_divider) > qFloor(double(last_unit)/real_divider)) {
@@ -189,13 +342,13 @@ void TimeRuler::paintEvent(QPaintEvent *)
 
       if (sec > last_sec) {
         // This line marks a second so we make it long
-        p.drawLine(i, line_top, i, line_sec_bottom);
+        p->drawLine(i, line_top, i, line_sec_bottom);
 
         last_sec = sec;
 
         // Try to draw text here
         if (text_visible_ && sec%text_skip == 0) {
-          QString timecode_string = olive::timestamp_to_timecode(sec, timebase_, kTimecodeDisplay);
+          QString timecode_string = GetTimecodeString(sec);
 
           int text_x = i;
 
@@ -203,82 +356,63 @@ void TimeRuler::paintEvent(QPaintEvent *)
             text_x -= half_average_text_width;
           } else {
             timecode_string.prepend(" ");
-            p.drawLine(i, 0, i, line_top);
+            p->drawLine(i, 0, i, line_top);
           }
 
-          p.drawText(text_x, text_y, timecode_string);
+          p->drawText(text_x, text_y, timecode_string);
         }
       } else if (unit%rough_frames_in_second == rough_frames_in_second/2) {
 
         // This line marks the half second point so we make it somewhere in between
-        p.drawLine(i, line_top, i, line_halfsec_bottom);
+        p->drawLine(i, line_top, i, line_halfsec_bottom);
 
       } else {
 
         // This line just marks a frame so we make it short
-        p.drawLine(i, line_top, i, line_frame_bottom);
+        p->drawLine(i, line_top, i, line_frame_bottom);
 
       }
 
       last_unit = unit;
     }
   }
-
-  // Draw the playhead if it's on screen at the moment
-  int playhead_pos = qFloor(static_cast<double>(time_) * scale_ * timebase_dbl_) - scroll_;
-  if (playhead_pos + playhead_width_ >= 0 && playhead_pos - playhead_width_ < width()) {
-    p.setPen(Qt::NoPen);
-    p.setBrush(style_.PlayheadColor());
-    DrawPlayhead(&p, playhead_pos, height());
-  }
 }
 
-void TimeRuler::mousePressEvent(QMouseEvent *event)
+void TimeRuler::UpdateTickCache()
 {
-  SeekToScreenPoint(event->pos().x());
-}
+  // Cache a widget's width either side of what's visible so that small scrolls can reuse it
+  int cache_width = width() * kTickCacheWidths;
 
-void TimeRuler::mouseMoveEvent(QMouseEvent *event)
-{
-  if (event->buttons() & Qt::LeftButton) {
-    SeekToScreenPoint(event->pos().x());
-  }
-}
+  tick_cache_scroll_ = scroll_ - width();
 
-void TimeRuler::DrawPlayhead(QPainter *p, int x, int y)
-{
-  p->setRenderHint(QPainter::Antialiasing);
+  qreal pixel_ratio = devicePixelRatioF();
 
-  int half_text_height = text_height_ / 3;
-  int half_width = playhead_width_ / 2;
+  tick_cache_ = QPixmap(qMax(1, qCeil(cache_width * pixel_ratio)), qMax(1, qCeil(height() * pixel_ratio)));
+  tick_cache_.setDevicePixelRatio(pixel_ratio);
+  tick_cache_.fill(Qt::transparent);
 
-  QPoint points[] = {
-    QPoint(x, y),
-    QPoint(x - half_width, y - half_text_height),
-    QPoint(x - half_width, y - text_height_),
-    QPoint(x + 1 + half_width, y - text_height_),
-    QPoint(x + 1 + half_width, y - half_text_height),
-    QPoint(x + 1, y),
-  };
+  QPainter p(&tick_cache_);
+  p.setFont(font());
 
-  p->drawPolygon(points, 6);
-}
+  DrawTicks(&p, tick_cache_scroll_, cache_width);
 
-double TimeRuler::ScreenToUnitFloat(int screen)
-{
-  return (screen + scroll_) / scale_ / timebase_dbl_;
+  tick_cache_valid_ = true;
 }
 
-int64_t TimeRuler::ScreenToUnit(int screen)
+void TimeRuler::InvalidateTickCache()
 {
-  return qFloor(ScreenToUnitFloat(screen));
+  tick_cache_valid_ = false;
+
+  update();
 }
 
-void TimeRuler::SeekToScreenPoint(int screen)
+const QString &TimeRuler::GetTimecodeString(int sec)
 {
-  int64_t timestamp = qMax(0, qRound(ScreenToUnitFloat(screen)));
+  QHash<int, QString>::iterator it = timecode_strings_.find(sec);
 
-  SetTime(timestamp);
+  if (it == timecode_strings_.end()) {
+    it = timecode_strings_.insert(sec, olive::timestamp_to_timecode(sec, timebase_, kTimecodeDisplay));
+  }
 
-  emit TimeChanged(timestamp);
+  return it.value();
 }
@@ -21,9 +21,12 @@
 #ifndef TIMERULER_H
 #define TIMERULER_H
 
+#include <QHash>
+#include <QPixmap>
 #include <QTimer>
 #include <QWidget>
 
+#include "common/framerangeset.h"
 #include "common/rational.h"
 #include "widget/timelineview/timelineplayhead.h"
 
@@ -44,6 +47,13 @@ public:
 
   const int64_t& GetTime();
 
+  /**
+   * @brief Show which frames are cached and which have been invalidated as a bar along the bottom of the ruler
+   *
+   * Frames in neither are left out. Pass empty sets to hide the bar.
+   */
+  void SetCacheRanges(const FrameRangeSet& cached, const FrameRangeSet& dirty);
+
 public slots:
   void SetTime(const int64_t &r);
 
@@ -52,6 +62,10 @@ public slots:
 protected:
   virtual void paintEvent(QPaintEvent* e) override;
 
+  virtual void resizeEvent(QResizeEvent* e) override;
+
+  virtual void changeEvent(QEvent* e) override;
+
   virtual void mousePressEvent(QMouseEvent *event) override;
   virtual void mouseMoveEvent(QMouseEvent *event) override;
 
@@ -64,6 +78,36 @@ signals:
 private:
   void DrawPlayhead(QPainter* p, int x, int y);
 
+  /**
+   * @brief Draw the visible part of `ranges` as a bar along the bottom of the ruler
+   */
+  void DrawCacheRanges(QPainter* p, const FrameRangeSet& ranges, const QColor& color);
+
+  /**
+   * @brief Returns the area the playhead covers at `time`, so moving it only redraws what it moved over
+   */
+  QRect PlayheadRect(int64_t time);
+
+  /**
+   * @brief Draw the ticks and timecodes for `width` pixels starting at scroll position `scroll`
+   */
+  void DrawTicks(QPainter* p, int scroll, int width);
+
+  /**
+   * @brief Redraw tick_cache_ so that it covers the current scroll position with a widget's width to spare either side
+   */
+  void UpdateTickCache();
+
+  /**
+   * @brief Mark tick_cache_ as needing a redraw (e.g. because the scale or timebase changed)
+   */
+  void InvalidateTickCache();
+
+  /**
+   * @brief Returns the timecode of a second, formatting it only the first time it's needed
+   */
+  const QString& GetTimecodeString(int sec);
+
   double ScreenToUnitFloat(int screen);
 
   int64_t ScreenToUnit(int screen);
@@ -94,6 +138,23 @@ private:
 
   TimelinePlayhead style_;
 
+  /**
+   * @brief Ticks and timecodes rendered ahead of time so that moving the playhead doesn't redraw them
+   */
+  QPixmap tick_cache_;
+
+  /**
+   * @brief Scroll position of tick_cache_'s left edge
+   */
+  int tick_cache_scroll_;
+
+  bool tick_cache_valid_;
+
+  QHash<int, QString> timecode_strings_;
+
+  FrameRangeSet cached_ranges_;
+  FrameRangeSet dirty_ranges_;
+
 };
 
 #endif // TIMERULER_H
@@ -0,0 +1,74 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "playbackclock.h"
+
+PlaybackClock::PlaybackClock() :
+  synced_to_audio_(false),
+  audio_usecs_(0),
+  audio_sync_time_(0)
+{
+}
+
+void PlaybackClock::Start()
+{
+  synced_to_audio_ = false;
+  audio_usecs_ = 0;
+  audio_sync_time_ = 0;
+
+  timer_.start();
+}
+
+void PlaybackClock::Stop()
+{
+  timer_.invalidate();
+}
+
+bool PlaybackClock::IsRunning() const
+{
+  return timer_.isValid();
+}
+
+void PlaybackClock::SyncToAudio(const qint64 &usecs)
+{
+  if (!IsRunning()) {
+    return;
+  }
+
+  synced_to_audio_ = true;
+  audio_usecs_ = usecs;
+  audio_sync_time_ = timer_.nsecsElapsed() / 1000;
+}
+
+qint64 PlaybackClock::Elapsed() const
+{
+  if (!IsRunning()) {
+    return 0;
+  }
+
+  qint64 now = timer_.nsecsElapsed() / 1000;
+
+  if (synced_to_audio_) {
+    // Audio devices report their position in chunks, so interpolate between reports with the timer
+    return audio_usecs_ + (now - audio_sync_time_);
+  }
+
+  return now;
+}
@@ -0,0 +1,75 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#ifndef PLAYBACKCLOCK_H
+#define PLAYBACKCLOCK_H
+
+#include <QElapsedTimer>
+#include <QtGlobal>
+
+/**
+ * @brief The master clock playback follows
+ *
+ * Runs off a monotonic timer by default. When audio is playing, its device should drive the clock instead by calling
+ * SyncToAudio() as it consumes samples (e.g. with QAudioOutput::processedUSecs()), so video stays locked to what's
+ * actually being heard rather than drifting against it.
+ */
+class PlaybackClock
+{
+public:
+  PlaybackClock();
+
+  /**
+   * @brief Start (or restart) the clock from zero
+   */
+  void Start();
+
+  /**
+   * @brief Stop the clock, Elapsed() returns 0 until it's started again
+   */
+  void Stop();
+
+  bool IsRunning() const;
+
+  /**
+   * @brief Lock the clock to the audio device, which has played `usecs` microseconds since Start()
+   */
+  void SyncToAudio(const qint64& usecs);
+
+  /**
+   * @brief Microseconds of playback since Start()
+   *
+   * When synced to audio, this is the audio device's position plus the time since it was last reported.
+   */
+  qint64 Elapsed() const;
+
+private:
+  QElapsedTimer timer_;
+
+  bool synced_to_audio_;
+
+  qint64 audio_usecs_;
+
+  /// Value of timer_ when audio_usecs_ was reported
+  qint64 audio_sync_time_;
+
+};
+
+#endif // PLAYBACKCLOCK_H
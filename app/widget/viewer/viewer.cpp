@@ -20,16 +20,22 @@
 
 #include "viewer.h"
 
-#include <QDateTime>
 #include <QLabel>
 #include <QResizeEvent>
 #include <QtMath>
 #include <QVBoxLayout>
 
+#include "audio/audioengine.h"
+#include "config/config.h"
 #include "viewersizer.h"
 
 ViewerWidget::ViewerWidget(QWidget *parent) :
-  QWidget(parent)
+  QWidget(parent),
+  start_timestamp_(0),
+  playback_speed_(0),
+  presented_timestamp_(-1),
+  dropped_frames_(0),
+  audio_source_(nullptr)
 {
   // Set up main layout
   QVBoxLayout* layout = new QVBoxLayout(this);
@@ -41,6 +47,11 @@ ViewerWidget::ViewerWidget(QWidget *parent) :
 
   gl_widget_ = new ViewerGLWidget(this);
   sizer->SetWidget(gl_widget_);
+  connect(gl_widget_, SIGNAL(DisplaySizeChanged(const QSize&)), this, SIGNAL(DisplaySizeChanged(const QSize&)));
+
+  // Drawn in the top left of the image when enabled
+  stats_overlay_ = new ViewerStatsOverlay(gl_widget_);
+  stats_overlay_->setVisible(false);
 
   // FIXME: Hardcoded values
   sizer->SetChildSize(1920, 1080);
@@ -69,6 +80,7 @@ ViewerWidget::ViewerWidget(QWidget *parent) :
   layout->addWidget(controls_);
 
   // Connect timer
+  playback_timer_.setTimerType(Qt::PreciseTimer);
   connect(&playback_timer_, SIGNAL(timeout()), this, SLOT(PlaybackTimerUpdate()));
 
   // FIXME: Magic number
@@ -83,7 +95,8 @@ void ViewerWidget::SetTimebase(const rational &r)
   ruler_->SetTimebase(r);
   controls_->SetTimebase(r);
 
-  playback_timer_.setInterval(qFloor(r.toDouble()));
+  // Check the clock twice per frame so a frame is never shown more than half a frame late
+  playback_timer_.setInterval(qMax(1, qFloor(time_base_dbl_ * 500)));
 }
 
 const double &ViewerWidget::scale()
@@ -121,9 +134,44 @@ bool ViewerWidget::IsPlaying()
   return playback_timer_.isActive();
 }
 
-void ViewerWidget::SetTexture(GLuint tex)
+PlaybackClock *ViewerWidget::playback_clock()
+{
+  return &playback_clock_;
+}
+
+void ViewerWidget::SetAudioSource(AudioEngine *engine)
+{
+  audio_source_ = engine;
+}
+
+const int &ViewerWidget::dropped_frames() const
+{
+  return dropped_frames_;
+}
+
+QSize ViewerWidget::display_size() const
+{
+  return gl_widget_->display_size();
+}
+
+void ViewerWidget::SetCacheRanges(const FrameRangeSet &cached, const FrameRangeSet &dirty)
+{
+  ruler_->SetCacheRanges(cached, dirty);
+}
+
+void ViewerWidget::SetTexture(RenderTexturePtr tex)
 {
   gl_widget_->SetTexture(tex);
+
+  // Textures always arrive for the current time (either straight away or once they're ready)
+  presented_timestamp_ = ruler_->GetTime();
+
+  emit TextureChanged(tex);
+}
+
+void ViewerWidget::SetStatsOverlayVisible(bool visible)
+{
+  stats_overlay_->setVisible(visible);
 }
 
 void ViewerWidget::UpdateTimeInternal(int64_t i)
@@ -144,24 +192,80 @@ void ViewerWidget::RulerTimeChange(int64_t i)
 
 void ViewerWidget::Play()
 {
+  SetPlaybackSpeed(1);
+}
+
+void ViewerWidget::Pause()
+{
+  SetPlaybackSpeed(0);
+}
+
+void ViewerWidget::ShuttleLeft()
+{
+  if (playback_speed_ > 1) {
+    SetPlaybackSpeed(playback_speed_ / 2);
+  } else if (playback_speed_ == 1) {
+    SetPlaybackSpeed(0);
+  } else if (playback_speed_ == 0) {
+    SetPlaybackSpeed(-1);
+  } else {
+    SetPlaybackSpeed(qMax(playback_speed_ * 2, -kShuttleMaximumSpeed));
+  }
+}
+
+void ViewerWidget::ShuttleStop()
+{
+  Pause();
+}
+
+void ViewerWidget::ShuttleRight()
+{
+  if (playback_speed_ < -1) {
+    SetPlaybackSpeed(playback_speed_ / 2);
+  } else if (playback_speed_ == -1) {
+    SetPlaybackSpeed(0);
+  } else if (playback_speed_ == 0) {
+    SetPlaybackSpeed(1);
+  } else {
+    SetPlaybackSpeed(qMin(playback_speed_ * 2, kShuttleMaximumSpeed));
+  }
+}
+
+void ViewerWidget::SetPlaybackSpeed(int speed)
+{
+  if (speed == 0) {
+    if (IsPlaying()) {
+      playback_timer_.stop();
+      playback_clock_.Stop();
+      playback_speed_ = 0;
+
+      emit PlaybackSpeedChanged(0);
+    }
+
+    controls_->ShowPlayButton();
+    return;
+  }
+
   if (time_base_.isNull()) {
     qWarning() << "ViewerWidget can't play with an invalid timebase";
     return;
   }
 
-  start_msec_ = QDateTime::currentMSecsSinceEpoch();
+  if (speed == playback_speed_) {
+    return;
+  }
+
+  // Changing speed restarts the clock from wherever we are now
   start_timestamp_ = ruler_->GetTime();
+  playback_speed_ = speed;
+  dropped_frames_ = 0;
 
+  playback_clock_.Start();
   playback_timer_.start();
 
   controls_->ShowPauseButton();
-}
 
-void ViewerWidget::Pause()
-{
-  playback_timer_.stop();
-
-  controls_->ShowPlayButton();
+  emit PlaybackSpeedChanged(playback_speed_);
 }
 
 void ViewerWidget::GoToStart()
@@ -194,11 +298,49 @@ void ViewerWidget::GoToEnd()
 
 void ViewerWidget::PlaybackTimerUpdate()
 {
-  int64_t real_time = QDateTime::currentMSecsSinceEpoch() - start_msec_;
+  // Audio is the master clock once the device has started playing it
+  if (audio_source_ != nullptr && audio_source_->IsRunning()) {
+    qint64 audio_usecs = audio_source_->ElapsedUSecs();
+
+    if (audio_usecs >= 0) {
+      playback_clock_.SyncToAudio(audio_usecs);
+    }
+  }
+
+  // The frame the clock says should be on screen now, the viewer moves `playback_speed_` frames for every frame of
+  // playback time
+  int64_t target = start_timestamp_
+      + playback_speed_ * qFloor(static_cast<double>(playback_clock_.Elapsed()) / (time_base_dbl_ * 1000000.0));
+
+  int64_t current = ruler_->GetTime();
 
-  int64_t frames_since_start = qRound(static_cast<double>(real_time) / (time_base_dbl_ * 1000));
+  if (target == current) {
+    // Still within the current frame's duration, keep showing it
+    return;
+  }
+
+  if (target < 0) {
+    // Reverse playback has reached the start
+    Pause();
+    SetTime(0);
+    return;
+  }
+
+  // Frames between the current one and the target are skipped (faster speeds skip frames anyway, those don't count)
+  int dropped = static_cast<int>((target - current) / playback_speed_ - 1);
+
+  // If the current frame never made it to the screen before its time ran out, it was dropped too
+  if (presented_timestamp_ != current) {
+    dropped++;
+  }
+
+  if (dropped > 0) {
+    dropped_frames_ += dropped;
+
+    emit DroppedFramesChanged(dropped_frames_);
+  }
 
-  SetTime(start_timestamp_ + frames_since_start);
+  SetTime(target);
 }
 
 void ViewerWidget::resizeEvent(QResizeEvent *event)
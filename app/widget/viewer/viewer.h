@@ -28,10 +28,14 @@
 #include <QWidget>
 
 #include "common/rational.h"
+#include "playbackclock.h"
 #include "viewerglwidget.h"
+#include "viewerstatsoverlay.h"
 #include "widget/playbackcontrols/playbackcontrols.h"
 #include "widget/timeruler/timeruler.h"
 
+class AudioEngine;
+
 /**
  * @brief An OpenGL-based viewer widget with playback controls (a PlaybackControls widget).
  */
@@ -59,6 +63,33 @@ public:
 
   bool IsPlaying();
 
+  /**
+   * @brief The clock playback follows, which an audio device can drive with PlaybackClock::SyncToAudio()
+   */
+  PlaybackClock* playback_clock();
+
+  /**
+   * @brief Follow an audio engine's position during playback instead of the timer, nullptr to stop
+   */
+  void SetAudioSource(AudioEngine* engine);
+
+  /**
+   * @brief Wrapper for TimeRuler::SetCacheRanges()
+   */
+  void SetCacheRanges(const FrameRangeSet& cached, const FrameRangeSet& dirty);
+
+  /**
+   * @brief Number of frames skipped or not ready in time since playback last started
+   *
+   * 0 means playback has been real-time.
+   */
+  const int& dropped_frames() const;
+
+  /**
+   * @brief Size the image is drawn at in device pixels (see ViewerGLWidget::display_size())
+   */
+  QSize display_size() const;
+
 public slots:
   /**
    * @brief Set the texture to draw and draw it
@@ -67,7 +98,7 @@ public slots:
    *
    * @param tex
    */
-  void SetTexture(GLuint tex);
+  void SetTexture(RenderTexturePtr tex);
 
   void GoToStart();
 
@@ -77,21 +108,76 @@ public slots:
 
   void Pause();
 
+  /**
+   * @brief Shuttle left (J), starting reverse playback or doubling its speed up to kShuttleMaximumSpeed
+   *
+   * If playing forward, this slows down instead, pausing once it passes 1x.
+   */
+  void ShuttleLeft();
+
+  /**
+   * @brief Shuttle stop (K), identical to Pause()
+   */
+  void ShuttleStop();
+
+  /**
+   * @brief Shuttle right (L), starting forward playback or doubling its speed up to kShuttleMaximumSpeed
+   *
+   * If playing in reverse, this slows down instead, pausing once it passes 1x.
+   */
+  void ShuttleRight();
+
   void NextFrame();
 
   void GoToEnd();
 
+  /**
+   * @brief Show or hide the render statistics over the image (see ViewerStatsOverlay)
+   */
+  void SetStatsOverlayVisible(bool visible);
+
 signals:
   void TimeChanged(const rational&);
 
+  /**
+   * @brief Emitted when playback starts or stops
+   *
+   * @param speed
+   *
+   * Frames advanced per frame of playback (negative for reverse), or 0 if playback has stopped.
+   */
+  void PlaybackSpeedChanged(int speed);
+
+  /**
+   * @brief Emitted during playback whenever frames are dropped, with the new total (see dropped_frames())
+   */
+  void DroppedFramesChanged(int count);
+
+  /**
+   * @brief Emitted whenever a new texture is shown (see SetTexture()), e.g. for scopes to follow the viewer
+   */
+  void TextureChanged(RenderTexturePtr tex);
+
+  /**
+   * @brief Emitted when display_size() changes
+   */
+  void DisplaySizeChanged(const QSize& size);
+
 protected:
   virtual void resizeEvent(QResizeEvent *event) override;
 
 private:
   void UpdateTimeInternal(int64_t i);
 
+  /**
+   * @brief Start playback from the current frame at a speed (negative for reverse), or pause if it's 0
+   */
+  void SetPlaybackSpeed(int speed);
+
   ViewerGLWidget* gl_widget_;
 
+  ViewerStatsOverlay* stats_overlay_;
+
   PlaybackControls* controls_;
 
   TimeRuler* ruler_;
@@ -104,9 +190,27 @@ private:
 
   QTimer playback_timer_;
 
-  qint64 start_msec_;
+  PlaybackClock playback_clock_;
+
   int64_t start_timestamp_;
 
+  /**
+   * @brief Frames advanced per frame of playback, see PlaybackSpeedChanged()
+   */
+  int playback_speed_;
+
+  /**
+   * @brief Timestamp of the last frame sent to the screen
+   */
+  int64_t presented_timestamp_;
+
+  int dropped_frames_;
+
+  /**
+   * @brief Engine playing the audio, see SetAudioSource()
+   */
+  AudioEngine* audio_source_;
+
 private slots:
   void RulerTimeChange(int64_t);
 
@@ -25,69 +25,100 @@
 #include <QOpenGLTexture>
 
 #include "render/gl/functions.h"
-#include "render/gl/shadergenerators.h"
+#include "render/gl/shadercache.h"
+#include "render/profiler.h"
 
 ViewerGLWidget::ViewerGLWidget(QWidget *parent) :
   QOpenGLWidget(parent),
-  texture_(0),
+  swap_pending_(false),
   ocio_lut_(0)
 {
   // FIXME: Hardcoded values for testing
-  color_service_ = ColorService::Create(OCIO::ROLE_SCENE_LINEAR, "srgb");
+  color_service_ = ColorService::Get(OCIO::ROLE_SCENE_LINEAR, "srgb");
+
+  connect(this, SIGNAL(frameSwapped()), this, SLOT(FrameSwapped()));
 }
 
-void ViewerGLWidget::SetTexture(GLuint tex)
+QSize ViewerGLWidget::display_size() const
+{
+  return QSize(qRound(width() * devicePixelRatioF()), qRound(height() * devicePixelRatioF()));
+}
+
+void ViewerGLWidget::SetTexture(RenderTexturePtr tex)
 {
   // Update the texture
   texture_ = tex;
 
-  // Paint the texture
-  update();
+  // Paint the texture, unless a frame is already waiting to be swapped in which case FrameSwapped() will
+  if (!swap_pending_) {
+    update();
+  }
 }
 
 void ViewerGLWidget::initializeGL()
 {
   // Re-retrieve pipeline pertaining to this context
-  pipeline_ = olive::ShaderGenerator::OCIOPipeline(context(),
-                                                   ocio_lut_,
-                                                   color_service_->GetProcessor(),
-                                                   true);
+  pipeline_ = ShaderCache::Get(context())->OCIOPipeline(color_service_->GetProcessor(),
+                                                       true,
+                                                       &ocio_lut_);
 
   connect(context(), SIGNAL(aboutToBeDestroyed()), this, SLOT(ContextCleanup()), Qt::DirectConnection);
 }
 
 void ViewerGLWidget::paintGL()
 {
+  // Includes waiting for the texture to finish rendering
+  ProfilerTimer timer(Profiler::kPaint);
+
   // Get functions attached to this context (they will already be initialized)
   QOpenGLFunctions* f = context()->functions();
 
+  presented_texture_ = texture_;
+  swap_pending_ = true;
+
   // Clear background to empty
   f->glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
   f->glClear(GL_COLOR_BUFFER_BIT);
 
   // Check if we have a texture to draw
-  if (texture_ > 0) {
+  if (texture_ != nullptr && texture_->IsCreated()) {
+    // Make sure the texture has finished rendering in its own context
+    texture_->WaitFence();
+
     // Bind retrieved texture
-    f->glBindTexture(GL_TEXTURE_2D, texture_);
+    f->glBindTexture(GL_TEXTURE_2D, texture_->texture());
+
+    // Only generate mipmaps if the viewer is smaller than the frame
+    bool minified = (texture_->height() > static_cast<int>(height() * devicePixelRatioF()));
 
     // Blit using the pipeline retrieved in initializeGL()
-    olive::gl::OCIOBlit(pipeline_, ocio_lut_, true);
+    olive::gl::OCIOBlit(pipeline_, ocio_lut_, true, QMatrix4x4(), minified);
 
     // Release retrieved texture
     f->glBindTexture(GL_TEXTURE_2D, 0);
   }
 }
 
-void ViewerGLWidget::ContextCleanup()
+void ViewerGLWidget::resizeGL(int w, int h)
+{
+  Q_UNUSED(w)
+  Q_UNUSED(h)
+
+  emit DisplaySizeChanged(display_size());
+}
+
+void ViewerGLWidget::FrameSwapped()
 {
-  makeCurrent();
+  swap_pending_ = false;
 
-  if (ocio_lut_ != 0) {
-    context()->functions()->glDeleteTextures(1, &ocio_lut_);
-    ocio_lut_ = 0;
+  if (texture_ != presented_texture_) {
+    update();
   }
+}
 
+void ViewerGLWidget::ContextCleanup()
+{
+  // The pipeline and LUT belong to the context's ShaderCache, which destroys them itself
+  ocio_lut_ = 0;
   pipeline_ = nullptr;
-
-  doneCurrent();
 }
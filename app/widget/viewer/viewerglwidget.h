@@ -25,6 +25,7 @@
 
 #include "render/colorservice.h"
 #include "render/gl/shaderptr.h"
+#include "render/rendertexture.h"
 
 /**
  * @brief The inner display/rendering widget of a Viewer class.
@@ -32,7 +33,7 @@
  * Actual composition occurs elsewhere offscreen and
  * multithreaded, so its main purpose is receiving a finalized OpenGL texture and displaying it.
  *
- * The main entry point is SetTexture() which will receive an OpenGL texture ID, store it, and then call update() to
+ * The main entry point is SetTexture() which will receive a RenderTexture, store it, and then call update() to
  * draw it on screen. The drawing function is in paintGL() (called during the update() process by Qt) and is fairly
  * simple OpenGL drawing code standardized around OpenGL ES 3.2 Core.
  *
@@ -54,15 +55,26 @@ public:
    */
   ViewerGLWidget(QWidget* parent);
 
+  /**
+   * @brief Size the image is drawn at in device pixels
+   */
+  QSize display_size() const;
+
 public slots:
   /**
    * @brief Set the texture to draw and draw it
    *
-   * Use this function to update the viewer.
+   * Use this function to update the viewer. The texture is kept alive until another one is set, and the widget waits
+   * on its fence (see RenderTexture::Fence()) before drawing it.
+   *
+   * Textures are presented at most once per buffer swap (normally vsync). If several are set before the next swap,
+   * only the latest is drawn.
    *
    * @param tex
+   *
+   * The texture to draw, or nullptr to clear the viewer.
    */
-  void SetTexture(GLuint tex);
+  void SetTexture(RenderTexturePtr tex);
 
 protected:
   /**
@@ -78,11 +90,33 @@ protected:
    * Simple OpenGL drawing function for painting the texture on screen. Standardized around OpenGL ES 3.2 Core.
    */
   virtual void paintGL() override;
+
+  /**
+   * @brief Emits DisplaySizeChanged() whenever the widget is resized
+   */
+  virtual void resizeGL(int w, int h) override;
+
+signals:
+  /**
+   * @brief Emitted when display_size() changes, so renders can follow it (see RendererProcessor::SetDisplaySize())
+   */
+  void DisplaySizeChanged(const QSize& size);
+
 private:
   /**
-   * @brief Internal reference to the OpenGL texture to draw. Set in SetTexture() and used in paintGL().
+   * @brief Internal reference to the texture to draw. Set in SetTexture() and used in paintGL().
+   */
+  RenderTexturePtr texture_;
+
+  /**
+   * @brief Texture drawn by the last paintGL(), used to tell whether a newer one arrived while waiting for the swap
    */
-  GLuint texture_;
+  RenderTexturePtr presented_texture_;
+
+  /**
+   * @brief TRUE while a frame has been drawn but not swapped yet, further updates wait for frameSwapped()
+   */
+  bool swap_pending_;
 
   /**
    * @brief Internal shader object to use as the pipeline shader
@@ -93,6 +127,8 @@ private:
 
   /**
    * @brief OCIO LUT texture used for conversions
+   *
+   * Owned by the context's ShaderCache.
    */
   GLuint ocio_lut_;
 
@@ -103,6 +139,11 @@ private:
 
 private slots:
   void ContextCleanup();
+
+  /**
+   * @brief Receives frameSwapped() and draws again if a newer texture arrived while waiting for the swap
+   */
+  void FrameSwapped();
 };
 
 #endif // VIEWERGLWIDGET_H
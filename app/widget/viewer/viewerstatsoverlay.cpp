@@ -0,0 +1,78 @@
+/***
+
+  Olive - Non-Linear Video Editor
+  Copyright (C) 2019 Olive Team
+
+  This program is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+***/
+
+#include "viewerstatsoverlay.h"
+
+#include "render/renderstats.h"
+
+ViewerStatsOverlay::ViewerStatsOverlay(QWidget *parent) :
+  QLabel(parent)
+{
+  // Readable over any frame
+  setStyleSheet("background: rgba(0, 0, 0, 160); color: white; padding: 4px;");
+  setAttribute(Qt::WA_TransparentForMouseEvents);
+
+  update_timer_.setInterval(500);
+  connect(&update_timer_, SIGNAL(timeout()), this, SLOT(UpdateStats()));
+}
+
+void ViewerStatsOverlay::showEvent(QShowEvent *event)
+{
+  QLabel::showEvent(event);
+
+  UpdateStats();
+  update_timer_.start();
+}
+
+void ViewerStatsOverlay::hideEvent(QHideEvent *event)
+{
+  QLabel::hideEvent(event);
+
+  update_timer_.stop();
+}
+
+void ViewerStatsOverlay::UpdateStats()
+{
+  RenderStats::Snapshot s = olive::render_stats.GetSnapshot();
+
+  QStringList lines;
+
+  lines.append(tr("Cache: %1 VRAM, %2 RAM, %3 disk, %4 misses (%5% hit rate)").arg(
+                 QString::number(s.values[RenderStats::kVRAMHit]),
+                 QString::number(s.values[RenderStats::kRAMHit]),
+                 QString::number(s.values[RenderStats::kDiskHit]),
+                 QString::number(s.values[RenderStats::kMiss]),
+                 QString::number(s.HitRate() * 100.0, 'f', 1)));
+
+  lines.append(tr("Rendering: %1 in flight, %2 queued, %3 waiting to download").arg(
+                 QString::number(s.values[RenderStats::kFramesInFlight]),
+                 QString::number(s.values[RenderStats::kQueueLength]),
+                 QString::number(s.values[RenderStats::kDownloadBacklog])));
+
+  lines.append(tr("Disk cache: %1 MiB").arg(static_cast<double>(s.disk_bytes) / 1048576.0, 0, 'f', 1));
+
+  lines.append(tr("Decoding: %1 sequential, %2 seeks, %3 ms average").arg(
+                 QString::number(s.values[RenderStats::kDecodeSequential]),
+                 QString::number(s.values[RenderStats::kDecodeSeek]),
+                 QString::number(s.AverageDecodeTime(), 'f', 2)));
+
+  setText(lines.join('\n'));
+  adjustSize();
+}
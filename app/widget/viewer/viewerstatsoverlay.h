@@ -18,33 +18,34 @@
 
 ***/
 
-#ifndef TASKTHREAD_H
-#define TASKTHREAD_H
+#ifndef VIEWERSTATSOVERLAY_H
+#define VIEWERSTATSOVERLAY_H
 
-#include <QThread>
-
-class Task;
+#include <QLabel>
+#include <QTimer>
 
 /**
- * @brief An internal class only used by Task.
+ * @brief Shows the current olive::render_stats over a viewer
  *
- * TaskThread is a simple QThread subclass designed to create a thread and run the
- * Task's Action() function. It also stores the result of Action() which can be read using result() when the thread
- * signals that it has finished().
+ * Only updates while it's visible.
  */
-class TaskThread : public QThread
+class ViewerStatsOverlay : public QLabel
 {
+  Q_OBJECT
 public:
-  TaskThread(Task* parent);
+  ViewerStatsOverlay(QWidget* parent);
 
-  virtual void run() override;
+protected:
+  virtual void showEvent(QShowEvent* event) override;
 
-  bool result();
+  virtual void hideEvent(QHideEvent* event) override;
 
 private:
-  Task* parent_;
+  QTimer update_timer_;
+
+private slots:
+  void UpdateStats();
 
-  bool result_;
 };
 
-#endif // TASKTHREAD_H
+#endif // VIEWERSTATSOVERLAY_H
@@ -38,15 +38,15 @@ MainMenu::MainMenu(QWidget *parent) :
   file_menu_ = new Menu(this);
   file_new_menu_ = new Menu(file_menu_);
   olive::menu_shared.AddItemsForNewMenu(file_new_menu_);
-  file_open_item_ = file_menu_->AddItem("openproj", nullptr, nullptr, "Ctrl+O");
+  file_open_item_ = file_menu_->AddItem("openproj", &olive::core, SLOT(DialogOpenProjectShow()), "Ctrl+O");
   file_open_recent_menu_ = new Menu(file_menu_);
   file_open_recent_clear_item_ = file_open_recent_menu_->AddItem("clearopenrecent", nullptr, nullptr);
-  file_save_item_ = file_menu_->AddItem("saveproj", nullptr, nullptr, "Ctrl+S");
-  file_save_as_item_ = file_menu_->AddItem("saveprojas", nullptr, nullptr, "Ctrl+Shift+S");
+  file_save_item_ = file_menu_->AddItem("saveproj", &olive::core, SLOT(SaveActiveProject()), "Ctrl+S");
+  file_save_as_item_ = file_menu_->AddItem("saveprojas", &olive::core, SLOT(SaveActiveProjectAs()), "Ctrl+Shift+S");
   file_menu_->addSeparator();
   file_import_item_ = file_menu_->AddItem("import", &olive::core, SLOT(DialogImportShow()), "Ctrl+I");
   file_menu_->addSeparator();
-  file_export_item_ = file_menu_->AddItem("export", nullptr, nullptr, "Ctrl+M");
+  file_export_item_ = file_menu_->AddItem("export", &olive::core, SLOT(DialogExportShow()), "Ctrl+M");
   file_menu_->addSeparator();
   file_exit_item_ = file_menu_->AddItem("exit", nullptr, nullptr);
 
@@ -179,9 +179,9 @@ MainMenu::MainMenu(QWidget *parent) :
 
   playback_menu_->addSeparator();
 
-  playback_shuttleleft_item_ = playback_menu_->AddItem("decspeed", nullptr, nullptr, "J");
-  playback_shuttlestop_item_ = playback_menu_->AddItem("pause", nullptr, nullptr, "K");
-  playback_shuttleright_item_ = playback_menu_->AddItem("incspeed", nullptr, nullptr, "L");
+  playback_shuttleleft_item_ = playback_menu_->AddItem("decspeed", this, SLOT(ShuttleLeftTriggered()), "J");
+  playback_shuttlestop_item_ = playback_menu_->AddItem("pause", this, SLOT(ShuttleStopTriggered()), "K");
+  playback_shuttleright_item_ = playback_menu_->AddItem("incspeed", this, SLOT(ShuttleRightTriggered()), "L");
 
   playback_menu_->addSeparator();
 
@@ -261,6 +261,15 @@ MainMenu::MainMenu(QWidget *parent) :
 
   tools_menu_->addSeparator();
 
+  tools_record_trace_item_ = tools_menu_->AddItem("recordtrace", nullptr, nullptr);
+  tools_record_trace_item_->setCheckable(true);
+  connect(tools_record_trace_item_, SIGNAL(triggered(bool)), &olive::core, SLOT(SetTraceRecording(bool)));
+  tools_render_stats_item_ = tools_menu_->AddItem("renderstats", nullptr, nullptr);
+  tools_render_stats_item_->setCheckable(true);
+  connect(tools_render_stats_item_, SIGNAL(triggered(bool)), &olive::core, SLOT(SetRenderStatsVisible(bool)));
+
+  tools_menu_->addSeparator();
+
   tools_autocut_silence_item_ = tools_menu_->AddItem("autocutsilence", nullptr, nullptr);
 
   tools_menu_->addSeparator();
@@ -285,6 +294,7 @@ MainMenu::MainMenu(QWidget *parent) :
   tools_menu_->addSeparator();
 
   tools_preferences_item_ = tools_menu_->AddItem("prefs", nullptr, nullptr, "Ctrl+,");
+  tools_performance_item_ = tools_menu_->AddItem("performance", &olive::core, SLOT(DialogPerformanceShow()));
 
   //
   // HELP MENU
@@ -332,6 +342,9 @@ void MainMenu::ToolsMenuAboutToShow()
 
   // Ensure snapping value is correct
   tools_snapping_item_->setChecked(olive::core.snapping());
+
+  tools_record_trace_item_->setChecked(olive::core.IsRecordingTrace());
+  tools_render_stats_item_->setChecked(olive::core.render_stats_visible());
 }
 
 void MainMenu::ZoomInTriggered()
@@ -359,6 +372,21 @@ void MainMenu::PlayPauseTriggered()
   olive::panel_focus_manager->CurrentlyFocused()->PlayPause();
 }
 
+void MainMenu::ShuttleLeftTriggered()
+{
+  olive::panel_focus_manager->CurrentlyFocused()->ShuttleLeft();
+}
+
+void MainMenu::ShuttleStopTriggered()
+{
+  olive::panel_focus_manager->CurrentlyFocused()->ShuttleStop();
+}
+
+void MainMenu::ShuttleRightTriggered()
+{
+  olive::panel_focus_manager->CurrentlyFocused()->ShuttleRight();
+}
+
 void MainMenu::NextFrameTriggered()
 {
   olive::panel_focus_manager->CurrentlyFocused()->NextFrame();
@@ -460,11 +488,14 @@ void MainMenu::Retranslate()
   tools_hand_item_->setText(tr("Hand Tool"));
   tools_transition_item_->setText(tr("Transition Tool"));
   tools_snapping_item_->setText(tr("Enable Snapping"));
+  tools_record_trace_item_->setText(tr("Record Performance Trace"));
+  tools_render_stats_item_->setText(tr("Show Render Statistics"));
   tools_autocut_silence_item_->setText(tr("Auto-Cut Silence"));
   tools_autoscroll_none_item_->setText(tr("No Auto-Scroll"));
   tools_autoscroll_page_item_->setText(tr("Page Auto-Scroll"));
   tools_autoscroll_smooth_item_->setText(tr("Smooth Auto-Scroll"));
   tools_preferences_item_->setText(tr("Preferences"));
+  tools_performance_item_->setText(tr("Performance..."));
 
   // Help menu
   help_menu_->setTitle(tr("&Help"));
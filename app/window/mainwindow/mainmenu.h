@@ -84,6 +84,10 @@ private slots:
    */
   void PlayPauseTriggered();
 
+  void ShuttleLeftTriggered();
+  void ShuttleStopTriggered();
+  void ShuttleRightTriggered();
+
   void NextFrameTriggered();
   void GoToEndTriggered();
 
@@ -170,11 +174,14 @@ private:
   QAction* tools_hand_item_;
   QAction* tools_transition_item_;
   QAction* tools_snapping_item_;
+  QAction* tools_record_trace_item_;
+  QAction* tools_render_stats_item_;
   QAction* tools_autocut_silence_item_;
   QAction* tools_autoscroll_none_item_;
   QAction* tools_autoscroll_page_item_;
   QAction* tools_autoscroll_smooth_item_;
   QAction* tools_preferences_item_;
+  QAction* tools_performance_item_;
 
   Menu* help_menu_;
   QAction* help_action_search_item_;
@@ -24,9 +24,12 @@
 
 // Panel objects
 #include "panel/panelmanager.h"
+#include "panel/memory/memory.h"
 #include "panel/node/node.h"
 #include "panel/param/param.h"
+#include "panel/profiler/profiler.h"
 #include "panel/project/project.h"
+#include "panel/scope/scope.h"
 #include "panel/taskmanager/taskmanager.h"
 #include "panel/timeline/timeline.h"
 #include "panel/tool/tool.h"
@@ -36,7 +39,10 @@
 #include "mainmenu.h"
 
 olive::MainWindow::MainWindow(QWidget *parent) :
-  QMainWindow(parent)
+  QMainWindow(parent),
+  param_panel_(nullptr),
+  viewer_panel_(nullptr),
+  timeline_panel_(nullptr)
 {
   // Create empty central widget - we don't actually want a central widget but some of Qt's docking/undocking fails
   // without it
@@ -57,15 +63,23 @@ olive::MainWindow::MainWindow(QWidget *parent) :
 
 void olive::MainWindow::ProjectOpen(Project* p)
 {
+  // Panels are only created for the first project, any opened after it are shown in the existing Project panel
+  ProjectPanel* existing_project_panel = olive::panel_focus_manager->MostRecentlyFocused<ProjectPanel>();
+
+  if (existing_project_panel != nullptr) {
+    existing_project_panel->set_project(p);
+    return;
+  }
+
   // FIXME Use settings data to create panels and restore state if they exist
   NodePanel* node_panel = olive::panel_focus_manager->CreatePanel<NodePanel>(this);
   addDockWidget(Qt::TopDockWidgetArea, node_panel);
 
-  ParamPanel* param_panel = olive::panel_focus_manager->CreatePanel<ParamPanel>(this);
-  addDockWidget(Qt::TopDockWidgetArea, param_panel);
+  param_panel_ = olive::panel_focus_manager->CreatePanel<ParamPanel>(this);
+  addDockWidget(Qt::TopDockWidgetArea, param_panel_);
 
-  ViewerPanel* viewer_panel2 = olive::panel_focus_manager->CreatePanel<ViewerPanel>(this);
-  addDockWidget(Qt::TopDockWidgetArea, viewer_panel2);
+  viewer_panel_ = olive::panel_focus_manager->CreatePanel<ViewerPanel>(this);
+  addDockWidget(Qt::TopDockWidgetArea, viewer_panel_);
 
   ProjectPanel* project_panel = olive::panel_focus_manager->CreatePanel<ProjectPanel>(this);
   project_panel->set_project(p);
@@ -74,10 +88,32 @@ void olive::MainWindow::ProjectOpen(Project* p)
   ToolPanel* tool_panel = olive::panel_focus_manager->CreatePanel<ToolPanel>(this);
   addDockWidget(Qt::BottomDockWidgetArea, tool_panel);
 
-  TimelinePanel* timeline_panel = olive::panel_focus_manager->CreatePanel<TimelinePanel>(this);
-  addDockWidget(Qt::BottomDockWidgetArea, timeline_panel);
+  timeline_panel_ = olive::panel_focus_manager->CreatePanel<TimelinePanel>(this);
+  addDockWidget(Qt::BottomDockWidgetArea, timeline_panel_);
+
+  connect(node_panel, SIGNAL(SelectionChanged(QList<Node*>)), param_panel_, SLOT(SetNodes(QList<Node*>)));
+
+  QMetaObject::invokeMethod(this, "CreateBackgroundPanels", Qt::QueuedConnection);
+}
+
+void olive::MainWindow::CreateBackgroundPanels()
+{
+  // Tabbed behind the parameters, scopes are only computed while they're visible
+  ScopePanel* scope_panel = olive::panel_focus_manager->CreatePanel<ScopePanel>(this);
+  tabifyDockWidget(param_panel_, scope_panel);
+  param_panel_->raise();
+
+  connect(viewer_panel_, SIGNAL(TextureChanged(RenderTexturePtr)), scope_panel, SLOT(SetTexture(RenderTexturePtr)));
+
+  // Tabbed behind the timeline, profiling only runs while it's visible
+  ProfilerPanel* profiler_panel = olive::panel_focus_manager->CreatePanel<ProfilerPanel>(this);
+  tabifyDockWidget(timeline_panel_, profiler_panel);
+
+  // Same for memory accounting
+  MemoryPanel* memory_panel = olive::panel_focus_manager->CreatePanel<MemoryPanel>(this);
+  tabifyDockWidget(timeline_panel_, memory_panel);
 
-  connect(node_panel, SIGNAL(SelectionChanged(QList<Node*>)), param_panel, SLOT(SetNodes(QList<Node*>)));
+  timeline_panel_->raise();
 }
 
 // FIXME: Test code
@@ -25,6 +25,10 @@
 
 #include "project/project.h"
 
+class ParamPanel;
+class TimelinePanel;
+class ViewerPanel;
+
 namespace olive {
 
 /**
@@ -42,7 +46,19 @@ protected:
   virtual void closeEvent(QCloseEvent* e) override;
 
 private:
+  ParamPanel* param_panel_;
+
+  ViewerPanel* viewer_panel_;
+
+  TimelinePanel* timeline_panel_;
 
+private slots:
+  /**
+   * @brief Create the panels that start tabbed behind others
+   *
+   * Nothing of them is visible at first, so ProjectOpen() leaves them until after the window has been painted.
+   */
+  void CreateBackgroundPanels();
 
 };
 
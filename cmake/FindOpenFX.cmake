@@ -0,0 +1,34 @@
+# - Find the OpenFX API headers
+# OpenFX is header-only on the host side, plugins are loaded at runtime.
+# This module defines
+#  OPENFX_INCLUDE_DIRS, where to find ofxImageEffect.h, set when
+#                       OPENFX_INCLUDE_DIR is found.
+#  OPENFX_ROOT_DIR, the base directory to search for OpenFX.
+#                   This can also be an environment variable.
+#  OPENFX_FOUND, if false, OpenFX plugins aren't supported.
+
+if(NOT OPENFX_ROOT_DIR AND NOT $ENV{OPENFX_ROOT_DIR} STREQUAL "")
+  set(OPENFX_ROOT_DIR $ENV{OPENFX_ROOT_DIR})
+endif()
+
+find_path(OPENFX_INCLUDE_DIR
+  NAMES
+    ofxImageEffect.h
+  HINTS
+    ${OPENFX_ROOT_DIR}
+    /usr/local
+    /opt/local
+  PATH_SUFFIXES
+    include
+    include/openfx
+    include/OpenFX
+)
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(OpenFX DEFAULT_MSG OPENFX_INCLUDE_DIR)
+
+if(OPENFX_FOUND)
+  set(OPENFX_INCLUDE_DIRS ${OPENFX_INCLUDE_DIR})
+endif()
+
+mark_as_advanced(OPENFX_INCLUDE_DIR)